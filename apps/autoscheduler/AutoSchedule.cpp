@@ -1,9 +1,12 @@
 #include <set>
 #include <queue>
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <chrono>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <random>
 #include <unordered_map>
 #include <unordered_set>
@@ -37,6 +40,13 @@ uint64_t get_dropout_threshold() {
 
 static uint64_t random_dropout_threshold = 100;
 
+// On GPU targets the innermost pure loop of each stage is mapped to
+// gpu_threads instead of being vectorized, so the "vector size" of a
+// stage is the warp width. Tilings round that loop to a multiple of it,
+// and the vector-size features measure idle lanes in a warp instead of
+// idle SIMD lanes.
+const int gpu_warp_size = 32;
+
 bool random_dropout() {
     static bool init =
         []() {random_dropout_threshold = get_dropout_threshold(); return true;}();
@@ -257,6 +267,10 @@ struct BoundContents {
         // All the blocks of memory allocated
         mutable std::vector<void *> blocks;
 
+        // Protects pool and blocks, because states are featurized on
+        // multiple threads at once.
+        mutable std::mutex mutex;
+
         Layout() {}
 
         ~Layout() {
@@ -298,6 +312,7 @@ struct BoundContents {
 
         // Make a BoundContents object with this layout
         BoundContents *make() const {
+            std::lock_guard<std::mutex> lock(mutex);
             if (pool.empty()) {
                 allocate_some_more();
             }
@@ -316,6 +331,7 @@ struct BoundContents {
         // Release a BoundContents object with this layout back to the pool
         void release(const BoundContents *b) const {
             internal_assert(b->layout == this) << "Releasing BoundContents onto the wrong pool!";
+            std::lock_guard<std::mutex> lock(mutex);
             pool.push_back(const_cast<BoundContents *>(b));
         }
     };
@@ -616,6 +632,9 @@ struct FunctionDAG {
     vector<Node> nodes;
     vector<Edge> edges;
 
+    // Are we scheduling for a GPU?
+    bool gpu = false;
+
     // We're going to be querying this DAG a lot while searching for
     // an optimal schedule, so we'll also create a variety of
     // auxiliary data structures.
@@ -624,6 +643,8 @@ struct FunctionDAG {
     // Create the function DAG, and do all the dependency and cost
     // analysis. This is done once up-front before the tree search.
     FunctionDAG(const vector<Function> &outputs, const MachineParams &params, const Target &target) {
+        gpu = target.has_gpu_feature();
+
         map<string, Function> env;
         for (Function o : outputs) {
             populate_environment(o, env);
@@ -884,7 +905,7 @@ struct FunctionDAG {
                     node.bytes_per_point = bytes_per_point;
                 }
 
-                stage.vector_size = target.natural_vector_size(checker.narrowest_type);
+                stage.vector_size = gpu ? gpu_warp_size : target.natural_vector_size(checker.narrowest_type);
 
                 if (!should_vectorize) {
                     stage.vector_size = 1;
@@ -1867,6 +1888,10 @@ struct LoopNest {
     // different instances.
     mutable NodeMap<Bound> bounds;
 
+    // Protects bounds. Loop nests are shared between states, and
+    // sibling states are featurized concurrently.
+    mutable std::mutex bounds_mutex;
+
     const FunctionDAG::Node *node = nullptr;
     const FunctionDAG::Node::Stage *stage = nullptr;
     int stage_idx = 0;
@@ -1888,7 +1913,10 @@ struct LoopNest {
         children = n.children;
         inlined = n.inlined;
         store_at = n.store_at;
-        bounds = n.bounds;
+        {
+            std::lock_guard<std::mutex> lock(n.bounds_mutex);
+            bounds = n.bounds;
+        }
         node = n.node;
         stage = n.stage;
         stage_idx = n.stage_idx;
@@ -2303,18 +2331,25 @@ struct LoopNest {
         return node == nullptr;
     }
 
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    // These return bounds by value, because another thread may grow
+    // the map (and so move its contents) as soon as the lock is
+    // released.
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
         return bounds.emplace(f, b);
     }
 
-    const Bound &get_bounds(const FunctionDAG::Node *f) const {
+    Bound get_bounds(const FunctionDAG::Node *f) const {
         // debug(0) << "get_bounds of " << f.name() << " in loop over " << (is_root() ? "root" : func.name()) << '\n';
-        if (bounds.contains(f)) {
-            const Bound &b = bounds.get(f);
-            // debug(0) << "Getting bounds of " << f->func.name() << " at site:\n";
-            // dump("  ");
-            b->validate();
-            return b;
+        {
+            std::lock_guard<std::mutex> lock(bounds_mutex);
+            if (bounds.contains(f)) {
+                Bound b = bounds.get(f);
+                // debug(0) << "Getting bounds of " << f->func.name() << " at site:\n";
+                // dump("  ");
+                b->validate();
+                return b;
+            }
         }
         auto bound = f->make_bound();
         // Compute the region required
@@ -2351,7 +2386,15 @@ struct LoopNest {
             f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
         }
 
-        const Bound &b = set_bounds(f, bound);
+        // If another thread computed the same bounds in the meantime,
+        // keep the ones already stored.
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        if (bounds.contains(f)) {
+            Bound existing = bounds.get(f);
+            Bound discard = bound;
+            return existing;
+        }
+        Bound b = bounds.emplace(f, bound);
         b->validate();
         return b;
     }
@@ -2732,11 +2775,12 @@ struct LoopNest {
                double num_cores,
                int depth,
                const LoopNest *parent,
-               const LoopNest *compute_site) const {
+               const LoopNest *compute_site,
+               bool gpu) const {
         if (is_root()) {
             for (auto &c : children) {
                 Func(c->node->func).compute_root();
-                c->apply(LoopLevel::root(), state_map, num_cores, 1, this, c.get());
+                c->apply(LoopLevel::root(), state_map, num_cores, 1, this, c.get(), gpu);
                 if (c->stage_idx == 0) {
                     auto &state = state_map[c->stage];
                     state.schedule_source << "\n    .compute_root()";
@@ -2786,7 +2830,15 @@ struct LoopNest {
                     const auto &p = parent_bounds->region_computed(i);
                     bytes *= p.second - p.first + 1;
                 }
-                if (bytes < 64000 && depth > 2) {
+                if (gpu) {
+                    // Anything computed inside a tile of a root-level
+                    // stage is inside a GPU block. Stage it through
+                    // shared memory if it fits.
+                    if (bytes < 48 * 1024 && depth > 2) {
+                        Func(node->func).store_in(MemoryType::GPUShared);
+                        state.schedule_source << "\n    .store_in(MemoryType::GPUShared)";
+                    }
+                } else if (bytes < 64000 && depth > 2) {
                     // If it's probably a small allocation, and it's
                     // made more than once, use stack-scoped
                     // storage. Otherwise let the compiler pick heap
@@ -2858,15 +2910,20 @@ struct LoopNest {
                                 // Ugh, we'll be using vector predication
                                 tail_strategy = TailStrategy::GuardWithIf;
                             }
-                            s.split(var_to_vectorize->var, var_to_vectorize->var, vec, split_factor, tail_strategy)
-                                .vectorize(vec);
+                            s.split(var_to_vectorize->var, var_to_vectorize->var, vec, split_factor, tail_strategy);
+                            if (gpu) {
+                                s.gpu_threads(vec);
+                            } else {
+                                s.vectorize(vec);
+                            }
                             state.schedule_source
                                 << "\n    .split("
                                 << var_to_vectorize->var.name() << ", "
                                 << var_to_vectorize->var.name() << ", "
                                 << vec.name() << ", "
                                 << split_factor << ", "
-                                << "TailStrategy::" << tail_strategy << ").vectorize("
+                                << "TailStrategy::" << tail_strategy << ")"
+                                << (gpu ? ".gpu_threads(" : ".vectorize(")
                                 << vec.name() << ")";
                             StageScheduleState::FuncVar v = *var_to_vectorize;
                             v.extent = split_factor;
@@ -2984,7 +3041,7 @@ struct LoopNest {
                 if (c->node != node) {
                     Func(c->node->func).compute_at(here);
                 }
-                c->apply(here, state_map, num_cores, depth + 1, this, compute_site);
+                c->apply(here, state_map, num_cores, depth + 1, this, compute_site, gpu);
                 if (c->node != node && c->stage_idx == 0) {
                     auto &state = state_map[c->stage];
                     state.schedule_source << "\n    .compute" << loop_level;
@@ -3018,6 +3075,46 @@ void destroy<LoopNest>(const LoopNest *t) {delete t;}
 
 namespace {
 
+// Run f(0) ... f(n-1), spread across a shared pool of threads. The
+// number of threads defaults to the number of cores, and can be set
+// with HL_NUM_FEATURIZATION_THREADS; a value of 1 runs everything on
+// the calling thread.
+void featurize_in_parallel(size_t n, const std::function<void(size_t)> &f) {
+    static int num_threads = [] {
+        string str = get_env_variable("HL_NUM_FEATURIZATION_THREADS");
+        if (!str.empty()) {
+            return std::max(1, std::atoi(str.c_str()));
+        }
+        return (int)ThreadPool<void>::num_processors_online();
+    }();
+
+    if (num_threads <= 1 || n <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    static ThreadPool<void> *pool = new ThreadPool<void>(num_threads);
+
+    // Hand out indices dynamically; children vary a lot in size. The
+    // calling thread takes part too.
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) {
+            f(i);
+        }
+    };
+    vector<std::future<void>> results;
+    for (size_t t = 1; t < std::min(n, (size_t)num_threads); t++) {
+        results.emplace_back(pool->async(worker));
+    }
+    worker();
+    for (auto &r : results) {
+        r.wait();
+    }
+}
+
 struct State {
     mutable RefCount ref_count;
     IntrusivePtr<const LoopNest> root;
@@ -3077,9 +3174,36 @@ struct State {
     bool calculate_cost(const FunctionDAG &dag, const MachineParams &params, ThroughputPredictorPipeline *throughput_predictor, bool verbose = false) {
         StageMap<ScheduleFeatures> features;
         compute_featurization(dag, params, &features);
+        return calculate_cost_from_features(dag, params, features, throughput_predictor, verbose);
+    }
 
+    // The part of calculate_cost after featurization. Featurization
+    // is safe to run concurrently for different states, but this
+    // isn't, because it enqueues onto the throughput predictor.
+    bool calculate_cost_from_features(const FunctionDAG &dag, const MachineParams &params,
+                                      const StageMap<ScheduleFeatures> &features,
+                                      ThroughputPredictorPipeline *throughput_predictor, bool verbose = false) {
         cost = 0;
 
+        // Apply the hard limit on memory use. Each Func not inlined is
+        // allocated once per realization, and as many realizations as can
+        // run in parallel may be live at once. The outputs are allocated
+        // by the caller.
+        if (params.max_memory) {
+            int64_t mem_used = 0;
+            for (auto it = features.begin(); it != features.end(); it++) {
+                const auto &stage = *(it.key());
+                const auto &feat = it.value();
+                if (stage.index != 0 || stage.node->is_output) {
+                    continue;
+                }
+                mem_used += feat.bytes_at_realization * std::min(feat.outer_parallelism, (int64_t)params.parallelism);
+            }
+            if (mem_used > (int64_t)params.max_memory) {
+                return false;
+            }
+        }
+
         if (verbose) {
             for (auto it = features.begin(); it != features.end(); it++) {
                 auto &stage = *(it.key());
@@ -3345,7 +3469,10 @@ struct State {
             internal_error << "Pipeline so far doesn't use next Func: " << node->func.name() << '\n';
         }
 
-        int num_children = 0;
+        // Enumerate the children first, then featurize them all at
+        // once, so that the featurization can be spread across
+        // threads.
+        vector<IntrusivePtr<State>> children;
         {
             // 1) Inline it
             if (node->stages.size() == 1 && !node->is_output) {
@@ -3355,14 +3482,8 @@ struct State {
                 new_root->inline_func(node);
                 child->root = new_root;
                 child->num_funcs_scheduled++;
-                // TODO: filter children here instead of calculating the cost of children we don't want.
-                if (child->calculate_cost(dag, params, throughput_predictor)) {
-                    internal_assert(child->root->computes(node)) << "Failed to inline " << node->func.name() << '\n';
-                    num_children++;
-                    accept_child(std::move(child));
-                } else {
-                    // Discarding state....
-                }
+                internal_assert(child->root->computes(node)) << "Failed to inline " << node->func.name() << '\n';
+                children.emplace_back(std::move(child));
             }
         }
 
@@ -3382,11 +3503,25 @@ struct State {
                 auto child = make_child();
                 child->root = std::move(n);
                 child->num_funcs_scheduled++;
-                if (child->calculate_cost(dag, params, throughput_predictor)) {
-                    internal_assert(child->root->computes(node)) << "Failed to inject realization of " << node->func.name() << '\n';
-                    num_children++;
-                    accept_child(std::move(child));
-                }
+                internal_assert(child->root->computes(node)) << "Failed to inject realization of " << node->func.name() << '\n';
+                children.emplace_back(std::move(child));
+            }
+        }
+
+        vector<StageMap<ScheduleFeatures>> features(children.size());
+        featurize_in_parallel(children.size(), [&](size_t i) {
+            children[i]->compute_featurization(dag, params, &features[i]);
+        });
+
+        // Scoring enqueues onto the throughput predictor, which
+        // evaluates the whole batch later in one call, so it happens
+        // serially and in a deterministic order.
+        int num_children = 0;
+        for (size_t i = 0; i < children.size(); i++) {
+            // TODO: filter children here instead of calculating the cost of children we don't want.
+            if (children[i]->calculate_cost_from_features(dag, params, features[i], throughput_predictor)) {
+                num_children++;
+                accept_child(std::move(children[i]));
             }
         }
 
@@ -3394,6 +3529,9 @@ struct State {
             debug(0) << "Warning: Found no legal way to schedule "
                      << node->func.name() << " in the following State:\n";
             dump();
+            user_assert(!params.max_memory)
+                << "No schedule for " << node->func.name() << " fits in "
+                << params.max_memory << " bytes of memory\n";
             internal_error << "Aborted";
         }
     }
@@ -3408,7 +3546,7 @@ struct State {
 
     void apply_schedule(const FunctionDAG &dag, const MachineParams &params) {
         map<const FunctionDAG::Node::Stage *, LoopNest::StageScheduleState> state_map;
-        root->apply(LoopLevel::root(), state_map, params.parallelism, 0, nullptr, nullptr);
+        root->apply(LoopLevel::root(), state_map, params.parallelism, 0, nullptr, nullptr, dag.gpu);
 
         std::ostringstream src;
 
@@ -3461,15 +3599,24 @@ struct State {
             Stage stage(p.first->stage);
 
             // Do all the reorders and pick which vars to
-            // parallelize.
+            // parallelize. On GPUs the parallel loops become the
+            // block loops, of which there can be at most three.
             vector<VarOrRVar> vars;
             int64_t parallel_tasks = 1;
+            int parallel_loops = 0;
             for (auto it = p.second.vars.rbegin(); it != p.second.vars.rend(); it++) {
                 if (!it->exists) continue;
                 if (!it->parallel) break;
+                if (dag.gpu && parallel_loops == 3) break;
                 parallel_tasks *= it->extent;
-                p.second.schedule_source << "\n    .parallel(" << it->var.name() << ")";
-                stage.parallel(it->var);
+                parallel_loops++;
+                if (dag.gpu) {
+                    p.second.schedule_source << "\n    .gpu_blocks(" << it->var.name() << ")";
+                    stage.gpu_blocks(it->var);
+                } else {
+                    p.second.schedule_source << "\n    .parallel(" << it->var.name() << ")";
+                    stage.parallel(it->var);
+                }
                 // Stop at a sufficient number of tasks (TODO: Make this a tiling level in the search space instead).
                 if (parallel_tasks > params.parallelism * 8) break;
             }
@@ -3630,13 +3777,49 @@ void configure_pipeline_features(const FunctionDAG &dag,
     throughput_predictor->set_pipeline_features(pipeline_features, params.parallelism);
 }
 
+// A wall-clock deadline for the search. A default-constructed one
+// never expires.
+struct SearchDeadline {
+    bool enabled = false;
+    std::chrono::steady_clock::time_point end;
+
+    static SearchDeadline after(double seconds) {
+        SearchDeadline d;
+        d.enabled = true;
+        d.end = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        return d;
+    }
+
+    // Seconds left, which is negative once the deadline has passed.
+    double remaining() const {
+        if (!enabled) return std::numeric_limits<double>::infinity();
+        return std::chrono::duration<double>(end - std::chrono::steady_clock::now()).count();
+    }
+
+    bool expired() const {
+        return enabled && remaining() <= 0;
+    }
+};
+
+double seconds_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// One pass of beam search. If the deadline is near, the beam is
+// narrowed for the remaining Funcs so that the pass finishes in time,
+// and once it has passed the schedule is completed greedily. States
+// predicted to cost more than cost_bound (if nonzero) are pruned, and
+// if that prunes every state the pass returns an undefined State.
 IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           vector<Function> outputs,
                                           const MachineParams &params,
                                           ThroughputPredictorPipeline *throughput_predictor,
                                           int beam_size,
                                           int pass_idx,
-                                          std::unordered_set<uint64_t> &permitted_hashes) {
+                                          std::unordered_set<uint64_t> &permitted_hashes,
+                                          const SearchDeadline &deadline,
+                                          double cost_bound) {
 
     if (throughput_predictor) {
         configure_pipeline_features(dag, params, throughput_predictor);
@@ -3694,12 +3877,27 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         q.emplace(std::move(s));
     };
 
+    auto pass_start = std::chrono::steady_clock::now();
+
     for (int i = 0; ; i++) {
         std::unordered_map<uint64_t, int> hashes;
         q.swap(pending);
 
         internal_assert(!pending.empty());
 
+        if (deadline.expired()) {
+            beam_size = 1;
+        } else if (deadline.enabled && i > 0 && beam_size > 1) {
+            // Each step schedules one more Func. If the steps so far
+            // were as slow as the remaining ones will be, would we
+            // finish in time? If not, narrow the beam to fit.
+            double projected = seconds_since(pass_start) / i * (dag.nodes.size() - i);
+            double remaining = deadline.remaining();
+            if (projected > remaining) {
+                beam_size = std::max(1, (int)(beam_size * remaining / projected));
+            }
+        }
+
         if ((int)pending.size() > beam_size * 10000) {
             debug(0) << "Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
@@ -3709,6 +3907,14 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
 
             IntrusivePtr<State> state {pending.pop()};
 
+            if (cost_bound > 0 && !state->penalized && state->cost > cost_bound) {
+                // The predicted cost of a partial schedule covers only
+                // the Funcs scheduled so far, so it is close to a lower
+                // bound on the cost of any way of completing it. This
+                // one can't beat the best schedule already found.
+                continue;
+            }
+
             if (beam_size > 1) {
                 // Apply cost penalties to the queue according to
                 // structural uniqueness.
@@ -3799,6 +4005,11 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         // Drop the other states unconsidered.
         pending.clear();
 
+        if (q.empty()) {
+            internal_assert(cost_bound > 0);
+            return IntrusivePtr<State>();
+        }
+
         if (throughput_predictor) {
             // Now evaluate all the costs and re-sort them in the priority queue
             throughput_predictor->evaluate_costs();
@@ -3831,22 +4042,42 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
     }
 }
 
+int num_passes_for_beam_size(int beam_size) {
+    return (beam_size == 1) ? 1 : 5;
+}
+
+// Run all the passes of beam search, and return the best schedule
+// found. Given a deadline, passes prune against the best schedule
+// found so far, starting with the incumbent if defined, and no new
+// pass is started once it has passed.
 IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
                                      vector<Function> outputs,
                                      const MachineParams &params,
                                      ThroughputPredictorPipeline *throughput_predictor,
-                                     int beam_size) {
+                                     int beam_size,
+                                     const SearchDeadline &deadline = SearchDeadline(),
+                                     IntrusivePtr<State> incumbent = IntrusivePtr<State>()) {
 
-    IntrusivePtr<State> best;
+    IntrusivePtr<State> best = incumbent;
 
     std::unordered_set<uint64_t> permitted_hashes;
-    int num_passes = (beam_size == 1) ? 1 : 5;
+    int num_passes = num_passes_for_beam_size(beam_size);
     for (int i = 0; i < num_passes; i++) {
-        auto pass = optimal_schedule_pass(dag, outputs, params, throughput_predictor, beam_size, i, permitted_hashes);
+        if (best.defined() && deadline.expired()) {
+            debug(0) << "\nOut of time before pass " << i << "\n";
+            break;
+        }
+        double cost_bound = (deadline.enabled && best.defined()) ? best->cost : 0;
+        auto pass = optimal_schedule_pass(dag, outputs, params, throughput_predictor,
+                                          beam_size, i, permitted_hashes, deadline, cost_bound);
+        if (!pass.defined()) {
+            debug(0) << "\nPass " << i << " pruned: nothing predicted to beat " << cost_bound << "\n";
+            continue;
+        }
         debug(0) << "\nPass " << i << " result:\n";
         pass->dump();
 
-        if (i == 0 || pass->cost < best->cost) {
+        if (!best.defined() || pass->cost < best->cost) {
             best = pass;
         }
     }
@@ -3894,18 +4125,32 @@ std::string generate_schedules_new(const std::vector<Function> &outputs,
     IntrusivePtr<State> optimal;
 
     if (time_limit) {
-        // Use a fixed running time
-        auto start = std::chrono::steady_clock::now();
-        for (size_t beam_size = 1; ; beam_size *= 2) {
-            auto s = optimal_schedule(dag, outputs, params, tp, beam_size);
-            if (beam_size == 1 || s->cost < optimal->cost) {
-                optimal = s;
+        // Anytime search within a fixed running time. A greedy pass
+        // first finds a complete schedule however short the budget is,
+        // then each round uses the widest beam predicted to finish in
+        // the time left, growing by at most 4x a round, and up to
+        // HL_BEAM_SIZE if set. Rounds prune partial schedules predicted
+        // to cost more than the best so far, and finish greedily if
+        // they run out of time.
+        SearchDeadline deadline = SearchDeadline::after(time_limit);
+        size_t max_beam_size = beam_size_str.empty() ? std::numeric_limits<int>::max() : beam_size;
+        for (size_t beam_size = 1; ; ) {
+            auto round_start = std::chrono::steady_clock::now();
+            optimal = optimal_schedule(dag, outputs, params, tp, beam_size, deadline, optimal);
+            double seconds_per_pass_per_beam =
+                std::max(seconds_since(round_start), 1e-6) / (num_passes_for_beam_size(beam_size) * beam_size);
+            debug(0) << "Beam size " << beam_size << " took " << seconds_since(round_start)
+                     << "s, best cost so far " << optimal->cost << "\n";
+
+            double remaining = deadline.remaining();
+            if (remaining <= 0 || beam_size >= max_beam_size) {
+                break;
             }
-            auto t = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(t - start).count();
-            if (elapsed > time_limit / 2) {
+            double affordable = remaining / (num_passes_for_beam_size(2) * seconds_per_pass_per_beam);
+            if (affordable < 2) {
                 break;
             }
+            beam_size = (size_t)std::min({affordable, (double)beam_size * 4, (double)max_beam_size});
         }
     } else {
         // Use a fixed beam size
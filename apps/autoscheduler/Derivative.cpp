@@ -1227,17 +1227,25 @@ void ReverseAccumulationVisitor::visit(const Call *op) {
                 t_interval.max = simplify(t_interval.max);
                 Interval r_interval(simplify(rvar.min),
                                     simplify(rvar.min + rvar.extent - 1));
-                if (can_prove(r_interval.min <= t_interval.min &&
-                              r_interval.max >= t_interval.max) &&
-                    false) {
-                    lhs[i] = func_to_update_args[i];
-                    // Replace other occurence of rvar in lhs
-                    for (int j = 0; j < (int) lhs.size(); j++) {
-                        if (j != i) {
-                            lhs[j] = simplify(substitute(
-                                rvar.var, func_to_update_args[i], lhs[j]));
-                        }
+                // The rewrite is only valid if each value of the rvar
+                // writes a distinct site: the rvar must not also appear
+                // in another lhs argument (e.g. a diagonal f(r.x, r.x)).
+                // Scans of non-commutative updates depend on the order
+                // of the rvar, which a pure variable does not have.
+                bool rvar_only_in_this_arg = true;
+                for (int j = 0; j < (int) lhs.size(); j++) {
+                    if (j != i && expr_uses_var(lhs[j], rvar.var)) {
+                        rvar_only_in_this_arg = false;
                     }
+                }
+                if (rvar_only_in_this_arg &&
+                    !is_current_non_overwriting_scan &&
+                    can_prove(r_interval.min <= t_interval.min &&
+                              r_interval.max >= t_interval.max)) {
+                    // This turns a serial scatter into an update over
+                    // a pure variable, which schedules can parallelize
+                    // and vectorize without races.
+                    lhs[i] = func_to_update_args[i];
                     adjoint = simplify(substitute(
                         rvar.var, func_to_update_args[i], adjoint));
                 }
@@ -1561,4 +1569,76 @@ Derivative propagate_adjoints(const Func &output) {
     return propagate_adjoints(output, adjoint, output_bounds);
 }
 
+namespace {
+
+// Is the update an accumulation f(args) = f(args) + e? Adjoint updates
+// all have this form, so their rvars can be reordered and split.
+bool is_accumulation(const Func &f, int update_id) {
+    if (f.outputs() != 1) {
+        return false;
+    }
+    const vector<Expr> &args = f.update_args(update_id);
+    const Internal::Add *add = f.update_value(update_id).as<Internal::Add>();
+    if (add == nullptr) {
+        return false;
+    }
+    const Internal::Call *self = add->a.as<Internal::Call>();
+    if (self == nullptr || self->name != f.name() || self->args.size() != args.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < args.size(); i++) {
+        if (!Internal::equal(self->args[i], args[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+vector<Func> schedule_adjoints(const Derivative &derivative,
+                               const Target &target) {
+    vector<Func> partials;
+    set<string> scheduled;
+    for (const auto &it : derivative.adjoints) {
+        Func f = it.second;
+        if (!f.defined() || !scheduled.insert(f.name()).second) {
+            continue;
+        }
+        f.compute_root();
+        vector<Var> args = f.args();
+        if (args.empty()) {
+            continue;
+        }
+        const int vector_size = target.natural_vector_size(f.value().type());
+        f.parallel(args.back());
+        if (args.size() > 1) {
+            f.vectorize(args[0], vector_size);
+        }
+
+        for (int i = 0; i < f.num_update_definitions(); i++) {
+            const vector<Expr> &lhs = f.update_args(i);
+            bool is_gather = true;
+            for (size_t j = 0; j < lhs.size(); j++) {
+                const Internal::Variable *v = lhs[j].as<Internal::Variable>();
+                if (v == nullptr || v->reduction_domain.defined() ||
+                    v->name != args[j].name()) {
+                    is_gather = false;
+                }
+            }
+            const vector<Internal::ReductionVariable> &rvars =
+                f.function().update(i).schedule().rvars();
+            if (is_gather) {
+                f.update(i).parallel(args.back());
+                if (rvars.empty() && args.size() > 1) {
+                    f.update(i).vectorize(args[0], vector_size, TailStrategy::GuardWithIf);
+                }
+            } else if (!rvars.empty() && is_accumulation(f, i)) {
+                partials.push_back(f.update(i).parallel_reduce(RVar(rvars.back().var)));
+            }
+        }
+    }
+    return partials;
+}
+
 }  // namespace Halide
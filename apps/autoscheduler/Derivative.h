@@ -82,6 +82,20 @@ Derivative propagate_adjoints(const Func &output,
  */
 Derivative propagate_adjoints(const Func &output);
 
+/**
+ *  Give every adjoint Func in a Derivative a reasonable CPU schedule.
+ *  Each adjoint is computed at root. Its pure definition, and any
+ *  update that accumulates over pure variables only (a gather), is
+ *  parallelized over the outermost variable and vectorized over the
+ *  innermost. An update that scatters into locations computed from
+ *  reduction variables is parallelized with Stage::parallel_reduce
+ *  instead, which gives each thread a private partial result rather
+ *  than racing on the shared one. Returns the partial-result Funcs
+ *  created this way, so that they can be scheduled further.
+ */
+std::vector<Func> schedule_adjoints(const Derivative &derivative,
+                                    const Target &target);
+
 }  // namespace Halide
 
 #endif
@@ -0,0 +1,131 @@
+#ifndef SAMPLE_DATABASE_H
+#define SAMPLE_DATABASE_H
+
+// A packed database of samples for training the cost model. It is a
+// single file holding one record per sample, each a small header
+// followed by the contents of the .sample file after augment_sample
+// has appended the runtime, pipeline id and schedule id. Records are
+// only ever appended, under an exclusive lock, so many benchmarking
+// processes can add to one database. The trainer maps the whole file
+// into memory and reads the samples in place, instead of opening
+// thousands of tiny files.
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct SampleRecordHeader {
+    uint32_t magic;
+    // The number of floats in the record that follows.
+    uint32_t num_floats;
+};
+
+const uint32_t sample_record_magic = 0x4c504d53;  // "SMPL"
+
+// Append the contents of an augmented sample file to a database,
+// creating it if necessary.
+inline bool append_to_sample_database(const std::string &db, const std::string &sample_file) {
+    std::vector<char> record(sizeof(SampleRecordHeader));
+    FILE *f = fopen(sample_file.c_str(), "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        record.insert(record.end(), buf, buf + n);
+    }
+    fclose(f);
+
+    size_t payload = record.size() - sizeof(SampleRecordHeader);
+    if (payload == 0 || payload % sizeof(float) != 0) return false;
+    SampleRecordHeader header = {sample_record_magic, (uint32_t)(payload / sizeof(float))};
+    memcpy(record.data(), &header, sizeof(header));
+
+    int fd = open(db.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = flock(fd, LOCK_EX) == 0;
+    const char *p = record.data();
+    size_t remaining = record.size();
+    while (ok && remaining > 0) {
+        ssize_t w = write(fd, p, remaining);
+        if (w <= 0) {
+            ok = false;
+        } else {
+            p += w;
+            remaining -= w;
+        }
+    }
+    flock(fd, LOCK_UN);
+    return (close(fd) == 0) && ok;
+}
+
+// A read-only view of a database, mapped into memory.
+class SampleDatabase {
+    int fd = -1;
+    const char *data = nullptr;
+    size_t size = 0;
+
+public:
+    struct Record {
+        const float *floats;
+        size_t num_floats;
+        // Offset of the record in the file, to name it in messages
+        size_t offset;
+    };
+
+    explicit SampleDatabase(const std::string &path) {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat s;
+        if (fstat(fd, &s) != 0 || s.st_size == 0) return;
+        void *m = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) return;
+        data = (const char *)m;
+        size = s.st_size;
+        // The trainer reads every record once, front to back.
+        madvise(m, size, MADV_SEQUENTIAL);
+    }
+
+    ~SampleDatabase() {
+        if (data) munmap((void *)data, size);
+        if (fd >= 0) close(fd);
+    }
+
+    SampleDatabase(const SampleDatabase &) = delete;
+    SampleDatabase &operator=(const SampleDatabase &) = delete;
+
+    bool valid() const {
+        return data != nullptr;
+    }
+
+    // Call f on each complete record. Returns false if the file ends
+    // with a corrupt or truncated record, which is skipped.
+    template<typename F>
+    bool for_each_record(F f) const {
+        size_t off = 0;
+        while (off + sizeof(SampleRecordHeader) <= size) {
+            SampleRecordHeader header;
+            memcpy(&header, data + off, sizeof(header));
+            size_t bytes = (size_t)header.num_floats * sizeof(float);
+            if (header.magic != sample_record_magic ||
+                off + sizeof(header) + bytes > size) {
+                return false;
+            }
+            // Records are a multiple of four bytes long, so the floats
+            // are aligned.
+            Record r = {(const float *)(data + off + sizeof(header)), header.num_floats, off};
+            f(r);
+            off += sizeof(header) + bytes;
+        }
+        return off == size;
+    }
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -225,25 +226,7 @@ class ThroughputPredictorPipeline {
             get_weights_from_weights_server();
         } else {
             // Update weights locally
-            auto update_weight = [](const Runtime::Buffer<float> &src, Runtime::Buffer<float> &dst) {
-                dst.copy_from(src.sliced(src.dimensions()-1, 0));
-                /*
-                double grad_mag = 0, weight_mag = 0;
-                auto grad = src.sliced(src.dimensions() - 1, 3);
-                grad.for_each_value([&](float f) {grad_mag += f*f;});
-                auto weight = src.sliced(src.dimensions() - 1, 0);
-                weight.for_each_value([&](float f) {weight_mag += f*f;});
-                std::cerr << std::sqrt(grad_mag / grad.number_of_elements()) << " "
-                << std::sqrt(weight_mag / weight.number_of_elements()) << "\n";
-                */
-
-            };
-            update_weight(head1_filter_update, weights.head1_filter);
-            update_weight(head1_bias_update, weights.head1_bias);
-            update_weight(head2_filter_update, weights.head2_filter);
-            update_weight(head2_bias_update, weights.head2_bias);
-            update_weight(conv1_filter_update, weights.conv1_filter);
-            update_weight(conv1_bias_update, weights.conv1_bias);
+            weights_from_updates();
         }
 
         assert(cursor != 0);
@@ -251,6 +234,86 @@ class ThroughputPredictorPipeline {
         return err;
     }
 
+    // Copy the new weights out of the backprop state.
+    void weights_from_updates() {
+        auto update_weight = [](const Runtime::Buffer<float> &src, Runtime::Buffer<float> &dst) {
+            dst.copy_from(src.sliced(src.dimensions()-1, 0));
+            /*
+            double grad_mag = 0, weight_mag = 0;
+            auto grad = src.sliced(src.dimensions() - 1, 3);
+            grad.for_each_value([&](float f) {grad_mag += f*f;});
+            auto weight = src.sliced(src.dimensions() - 1, 0);
+            weight.for_each_value([&](float f) {weight_mag += f*f;});
+            std::cerr << std::sqrt(grad_mag / grad.number_of_elements()) << " "
+            << std::sqrt(weight_mag / weight.number_of_elements()) << "\n";
+            */
+
+        };
+        update_weight(head1_filter_update, weights.head1_filter);
+        update_weight(head1_bias_update, weights.head1_bias);
+        update_weight(head2_filter_update, weights.head2_filter);
+        update_weight(head2_bias_update, weights.head2_bias);
+        update_weight(conv1_filter_update, weights.conv1_filter);
+        update_weight(conv1_bias_update, weights.conv1_bias);
+    }
+
+    // Start from the same weights as another predictor, e.g. so that
+    // randomized weights agree across data-parallel workers.
+    void copy_weights_from(ThroughputPredictorPipeline &other) {
+        Runtime::Buffer<float> *mine[] = {&weights.head1_filter, &weights.head1_bias,
+                                          &weights.head2_filter, &weights.head2_bias,
+                                          &weights.conv1_filter, &weights.conv1_bias};
+        int i = 0;
+        other.for_each_weight([&](Runtime::Buffer<float> &w) {
+                mine[i++]->copy_from(w);
+            });
+    }
+
+    // For data-parallel training. The first num_active predictors
+    // have each taken a backprop step from the same weights on a
+    // different minibatch. Replace the weights, gradients and ADAM
+    // state of all of them with the average over the active ones, so
+    // that they all take the averaged step.
+    static void average_updates(std::vector<ThroughputPredictorPipeline> &tpps, size_t num_active) {
+        Runtime::Buffer<float> ThroughputPredictorPipeline::*updates[] = {
+            &ThroughputPredictorPipeline::head1_filter_update,
+            &ThroughputPredictorPipeline::head1_bias_update,
+            &ThroughputPredictorPipeline::head2_filter_update,
+            &ThroughputPredictorPipeline::head2_bias_update,
+            &ThroughputPredictorPipeline::conv1_filter_update,
+            &ThroughputPredictorPipeline::conv1_bias_update};
+        if (tpps.size() < 2 || !tpps[0].head1_filter_update.data()) return;
+
+        for (auto u : updates) {
+            Runtime::Buffer<float> &sum = tpps[0].*u;
+            const size_t n = sum.number_of_elements();
+            float *dst = sum.data();
+            for (size_t w = 1; w < num_active; w++) {
+                const float *src = (tpps[w].*u).data();
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] += src[i];
+                }
+            }
+            const float scale = 1.0f / num_active;
+            for (size_t i = 0; i < n; i++) {
+                dst[i] *= scale;
+            }
+            for (size_t w = 1; w < tpps.size(); w++) {
+                Runtime::Buffer<float> &b = tpps[w].*u;
+                if (!b.data()) {
+                    // This one hasn't taken a step yet.
+                    b = sum.copy();
+                } else {
+                    b.copy_from(sum);
+                }
+            }
+        }
+        for (size_t w = 0; w < tpps.size(); w++) {
+            tpps[w].timestep = tpps[0].timestep;
+            tpps[w].weights_from_updates();
+        }
+    }
+
     void evaluate_costs() {
         if (cursor == 0 || !schedule_feat_queue.data()) return;
 
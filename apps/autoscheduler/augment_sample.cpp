@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "SampleDatabase.h"
+
 int main(int argc, char **argv) {
-    if (argc != 5) {
-        printf("Usage: record_runtime sample.bin runtime pipeline_id schedule_id\n");
+    if (argc != 5 && argc != 6) {
+        printf("Usage: record_runtime sample.bin runtime pipeline_id schedule_id [samples.db]\n");
         return -1;
     }
 
@@ -19,6 +21,12 @@ int main(int argc, char **argv) {
 
     fclose(f);
 
+    // Also add the completed sample to the packed database for training
+    if (argc == 6 && !append_to_sample_database(argv[5], argv[1])) {
+        printf("Could not append %s to %s\n", argv[1], argv[5]);
+        return -1;
+    }
+
     return 0;
 
 }
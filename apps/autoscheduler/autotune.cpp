@@ -0,0 +1,430 @@
+// A driver for the autotuning loop. Each round it compiles a batch of
+// randomly-perturbed schedules for a generator in parallel, benchmarks
+// them with RunGen on a pool of worker processes, appends the measured
+// runtimes to the samples, retrains the cost model on every sample seen
+// so far, and keeps a copy of the fastest schedule found.
+//
+// Usage: autotune generator pipeline_name samples_dir best_schedule_file [num_batches]
+//
+// Environment variables:
+//   HL_TARGET                   The target to compile for (default host)
+//   HL_AUTOTUNE_BATCH_SIZE      Samples per batch (default 32)
+//   HL_AUTOTUNE_COMPILE_JOBS    Samples compiled at once (default: number of cores)
+//   HL_AUTOTUNE_BENCH_WORKERS   Samples benchmarked at once (default 1)
+//   HL_AUTOTUNE_TRAIN_BATCHES   Training passes after each batch (default 1000)
+//   HL_AUTOTUNE_BIN             Where auto_schedule.so and train_cost_model live (default ./bin)
+//   HL_AUTOTUNE_HALIDE_DIR      The Halide distribution to build benchmarks against (default ../..)
+//   HL_WEIGHTS_DIR              The cost model weights to tune (default ./weights)
+//   HL_AUTOTUNE_PERF_COUNTERS   If set, also measure each benchmark with perf stat.
+//                               Either 1 for a generic set of cache and
+//                               instruction counters, or a comma-separated
+//                               perf event list (e.g. on Skylake-SP:
+//                               L1-dcache-load-misses,l2_rqsts.miss,LLC-load-misses,
+//                               offcore_requests.all_data_rd,
+//                               fp_arith_inst_retired.512b_packed_single)
+//
+// Benchmarks sharing the machine disturb each other, so only raise
+// HL_AUTOTUNE_BENCH_WORKERS if each worker gets its own cores (set
+// HL_NUM_THREADS accordingly).
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SampleDatabase.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+string env_or(const char *name, const string &def) {
+    const char *e = getenv(name);
+    return (e && *e) ? string(e) : def;
+}
+
+int env_int_or(const char *name, int def) {
+    const char *e = getenv(name);
+    if (!e || !*e) return def;
+    int v = atoi(e);
+    return v > 0 ? v : def;
+}
+
+string absolute_path(const string &path) {
+    if (!path.empty() && path[0] == '/') return path;
+    char buf[4096];
+    if (!getcwd(buf, sizeof(buf))) return path;
+    return string(buf) + "/" + path;
+}
+
+bool make_dirs(const string &path) {
+    for (size_t i = 1; i <= path.size(); i++) {
+        if (i == path.size() || path[i] == '/') {
+            string prefix = path.substr(0, i);
+            if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool file_exists(const string &path) {
+    struct stat s;
+    return stat(path.c_str(), &s) == 0;
+}
+
+// Run a shell command, returning true if it exited cleanly.
+bool run(const string &cmd) {
+    return system(cmd.c_str()) == 0;
+}
+
+// Run N jobs on up to num_workers threads. Each job runs its own child
+// processes, so this is a pool of worker processes.
+void run_in_parallel(int n, int num_workers, std::function<void(int)> job) {
+    std::atomic<int> next(0);
+    vector<std::thread> workers;
+    for (int w = 0; w < std::min(n, num_workers); w++) {
+        workers.emplace_back([&]() {
+            for (int i = next++; i < n; i = next++) {
+                job(i);
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
+// Pull the runtime out of RunGen's --benchmarks output, which it
+// measures using tools/halide_benchmark.h. Returns a negative number if
+// the benchmark didn't produce one.
+double parse_benchmark_output(const string &path) {
+    std::ifstream f(path);
+    string line;
+    const string marker = "produces best case of ";
+    while (std::getline(f, line)) {
+        size_t pos = line.find(marker);
+        if (pos != string::npos) {
+            return atof(line.c_str() + pos + marker.size());
+        }
+    }
+    return -1;
+}
+
+// Append the runtime (in ms), pipeline id and schedule id to a sample
+// file, as augment_sample does.
+bool augment_sample(const string &path, double runtime, int32_t pipeline_id, int32_t schedule_id) {
+    FILE *f = fopen(path.c_str(), "ab");
+    if (!f) return false;
+    float r = (float)(runtime * 1000);
+    bool ok = (fwrite(&r, 4, 1, f) == 1 &&
+               fwrite(&pipeline_id, 4, 1, f) == 1 &&
+               fwrite(&schedule_id, 4, 1, f) == 1);
+    return (fclose(f) == 0) && ok;
+}
+
+// Find every sample file under the given directory.
+void find_samples(const string &dir, vector<string> *result) {
+    DIR *d = opendir(dir.c_str());
+    if (!d) return;
+    while (dirent *e = readdir(d)) {
+        string name = e->d_name;
+        if (name == "." || name == "..") continue;
+        string path = dir + "/" + name;
+        struct stat s;
+        if (stat(path.c_str(), &s) != 0) continue;
+        if (S_ISDIR(s.st_mode)) {
+            find_samples(path, result);
+        } else if (name == "sample.sample") {
+            result->push_back(path);
+        }
+    }
+    closedir(d);
+}
+
+// The index after the largest existing batch, so that we don't clobber
+// samples from earlier runs.
+int first_free_batch(const string &samples_dir) {
+    int first = 0;
+    DIR *d = opendir(samples_dir.c_str());
+    if (!d) return first;
+    while (dirent *e = readdir(d)) {
+        if (strncmp(e->d_name, "batch_", 6) == 0) {
+            first = std::max(first, atoi(e->d_name + 6) + 1);
+        }
+    }
+    closedir(d);
+    return first;
+}
+
+bool copy_file(const string &src, const string &dst) {
+    std::ifstream in(src, std::ios::binary);
+    if (!in) return false;
+    string tmp = dst + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out << in.rdbuf();
+        if (!out) return false;
+    }
+    return rename(tmp.c_str(), dst.c_str()) == 0;
+}
+
+struct Config {
+    string generator, pipeline, samples_dir, best_schedule_file;
+    string target, bin_dir, halide_dir, weights_dir;
+    string perf_events;
+    int batch_size, compile_jobs, bench_workers, train_batches;
+};
+
+// Build a single sample of the pipeline with a random schedule, and a
+// RunGen binary to benchmark it.
+bool make_sample(const Config &c, const string &dir, int sample, int32_t seed) {
+    if (!make_dirs(dir)) return false;
+    string feature_file = dir + "/sample.sample";
+    remove(feature_file.c_str());
+
+    std::ostringstream cmd;
+    cmd << "HL_PERMIT_FAILED_UNROLL=1 HL_MACHINE_PARAMS=32,1,1"
+        << " HL_SEED=" << seed
+        << " HL_FEATURE_FILE=" << feature_file
+        << " HL_WEIGHTS_DIR=" << c.weights_dir;
+    if (sample == 0) {
+        // Sample 0 in each batch is best effort beam search, with no randomness
+        cmd << " HL_RANDOM_DROPOUT=100 HL_BEAM_SIZE=50";
+    } else {
+        // The other samples are random probes biased by the cost model
+        cmd << " HL_RANDOM_DROPOUT=90 HL_BEAM_SIZE=1";
+    }
+    cmd << " " << c.generator << " -g " << c.pipeline << " -o " << dir
+        << " -e static_library,h,schedule"
+        << " target=" << c.target << " auto_schedule=true"
+        << " -p " << c.bin_dir << "/auto_schedule.so"
+        << " 2> " << dir << "/compile_log.txt";
+    if (!run(cmd.str())) return false;
+
+    std::ostringstream link;
+    link << "c++ -std=c++11"
+         << " -DHL_RUNGEN_FILTER_HEADER=\"\\\"" << dir << "/" << c.pipeline << ".h\\\"\""
+         << " -I " << c.halide_dir << "/include"
+         << " " << c.halide_dir << "/tools/RunGenMain.cpp"
+         << " " << c.halide_dir << "/tools/RunGenStubs.cpp"
+         << " " << dir << "/" << c.pipeline << ".a"
+         << " -o " << dir << "/bench -ljpeg -ldl -lpthread -lz -lpng"
+         << " 2>> " << dir << "/compile_log.txt";
+    return run(link.str());
+}
+
+// Turn the CSV output of perf stat into a sample.counters file next to
+// the sample. Each line is an event name and its rate per second of
+// task-clock, so counts don't depend on how many iterations the
+// benchmark happened to run. Counters perf couldn't measure are
+// skipped.
+bool write_counters(const string &perf_output, const string &counters_file) {
+    std::ifstream in(perf_output);
+    vector<std::pair<string, double>> counts;
+    double task_clock_ms = 0;
+    string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        // value,unit,event,...
+        std::istringstream fields(line);
+        string value, unit, event;
+        if (!std::getline(fields, value, ',') ||
+            !std::getline(fields, unit, ',') ||
+            !std::getline(fields, event, ',')) {
+            continue;
+        }
+        if (value.empty() || !isdigit((unsigned char)value[0])) continue;
+        if (event == "task-clock") {
+            task_clock_ms = atof(value.c_str());
+        } else {
+            counts.emplace_back(event, atof(value.c_str()));
+        }
+    }
+    if (task_clock_ms <= 0 || counts.empty()) return false;
+
+    std::ofstream out(counters_file);
+    for (const auto &c : counts) {
+        out << c.first << " " << c.second * 1000 / task_clock_ms << "\n";
+    }
+    return (bool)out;
+}
+
+// Benchmark one sample. Returns its runtime in seconds, or a negative
+// number on failure.
+double benchmark_sample(const Config &c, const string &dir) {
+    string out = dir + "/bench.txt";
+    string cmd = dir + "/bench --output_extents=estimate"
+                 " --default_input_buffers=random:0:estimate_then_auto"
+                 " --default_input_scalars=estimate --benchmarks=all"
+                 " --benchmark_min_time=1 > " + out + " 2>&1";
+    string perf_output = dir + "/perf.txt";
+    if (!c.perf_events.empty()) {
+        cmd = "perf stat -x, -o " + perf_output + " -e task-clock," + c.perf_events + " " + cmd;
+    }
+    if (!run(cmd)) return -1;
+    if (!c.perf_events.empty() && !write_counters(perf_output, dir + "/sample.counters")) {
+        printf("No perf counters recorded for %s, see %s\n", dir.c_str(), perf_output.c_str());
+    }
+    return parse_benchmark_output(out);
+}
+
+string sample_database(const Config &c) {
+    return c.samples_dir + "/samples.db";
+}
+
+// Retrain the model weights on all samples seen so far. The trainer
+// starts from the current weights, so each round refines the last. It
+// reads the samples from the database, unless perf counters are being
+// measured, which are only found next to the individual sample files.
+bool retrain(const Config &c) {
+    vector<string> samples;
+    if (c.perf_events.empty()) {
+        if (file_exists(sample_database(c))) {
+            samples.push_back(sample_database(c));
+        }
+    } else {
+        find_samples(c.samples_dir, &samples);
+    }
+    if (samples.empty()) return true;
+
+    string list = c.samples_dir + "/samples.txt";
+    {
+        std::ofstream f(list);
+        for (const string &s : samples) {
+            f << s << "\n";
+        }
+        if (!f) return false;
+    }
+    std::ostringstream cmd;
+    cmd << "HL_NUM_THREADS=" << env_or("HL_NUM_THREADS", "32")
+        << " HL_WEIGHTS_DIR=" << c.weights_dir
+        << " " << c.bin_dir << "/train_cost_model " << c.train_batches
+        << " < " << list;
+    return run(cmd.str());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 5 && argc != 6) {
+        fprintf(stderr, "Usage: %s generator pipeline_name samples_dir best_schedule_file [num_batches]\n", argv[0]);
+        return 1;
+    }
+
+    Config c;
+    c.generator = absolute_path(argv[1]);
+    c.pipeline = argv[2];
+    c.samples_dir = absolute_path(argv[3]);
+    c.best_schedule_file = argv[4];
+    c.target = env_or("HL_TARGET", "host");
+    c.bin_dir = absolute_path(env_or("HL_AUTOTUNE_BIN", "bin"));
+    c.halide_dir = absolute_path(env_or("HL_AUTOTUNE_HALIDE_DIR", "../.."));
+    c.weights_dir = absolute_path(env_or("HL_WEIGHTS_DIR", "weights"));
+    c.batch_size = env_int_or("HL_AUTOTUNE_BATCH_SIZE", 32);
+    c.compile_jobs = env_int_or("HL_AUTOTUNE_COMPILE_JOBS", std::max(1, (int)std::thread::hardware_concurrency()));
+    c.bench_workers = env_int_or("HL_AUTOTUNE_BENCH_WORKERS", 1);
+    c.train_batches = env_int_or("HL_AUTOTUNE_TRAIN_BATCHES", 1000);
+    c.perf_events = env_or("HL_AUTOTUNE_PERF_COUNTERS", "");
+    if (c.perf_events == "1") {
+        c.perf_events = "L1-dcache-load-misses,LLC-load-misses,LLC-store-misses,cycles,instructions";
+    }
+    int num_batches = argc == 6 ? atoi(argv[5]) : 1000000;
+
+    if (!make_dirs(c.samples_dir)) {
+        fprintf(stderr, "Could not create %s\n", c.samples_dir.c_str());
+        return 1;
+    }
+
+    // Samples from runs before there was a database are added to a new one.
+    if (!file_exists(sample_database(c))) {
+        vector<string> samples;
+        find_samples(c.samples_dir, &samples);
+        for (const string &s : samples) {
+            if (!append_to_sample_database(sample_database(c), s)) {
+                fprintf(stderr, "Could not add %s to %s\n", s.c_str(), sample_database(c).c_str());
+                return 1;
+            }
+        }
+    }
+
+    double best_runtime = -1;
+    std::mutex mutex;
+    int first = first_free_batch(c.samples_dir);
+    for (int i = first; i < first + num_batches; i++) {
+        string batch_dir = c.samples_dir + "/batch_" + std::to_string(i);
+        auto sample_dir = [&](int b) { return batch_dir + "/" + std::to_string(b); };
+        auto schedule_id = [&](int b) { return (int32_t)(i * 100 + b); };
+
+        // Compile the batch in parallel.
+        vector<char> compiled(c.batch_size, 0);
+        printf("Compiling batch %d\n", i);
+        run_in_parallel(c.batch_size, c.compile_jobs, [&](int b) {
+            compiled[b] = make_sample(c, sample_dir(b), b, schedule_id(b));
+            if (!compiled[b]) {
+                std::lock_guard<std::mutex> lock(mutex);
+                printf("Sample %d failed to compile, see %s/compile_log.txt\n", b, sample_dir(b).c_str());
+            }
+        });
+
+        // Benchmark it on the worker pool.
+        vector<double> runtimes(c.batch_size, -1);
+        printf("Benchmarking batch %d\n", i);
+        run_in_parallel(c.batch_size, c.bench_workers, [&](int b) {
+            if (!compiled[b]) return;
+            runtimes[b] = benchmark_sample(c, sample_dir(b));
+            std::lock_guard<std::mutex> lock(mutex);
+            if (runtimes[b] < 0) {
+                printf("Sample %d failed to benchmark, see %s/bench.txt\n", b, sample_dir(b).c_str());
+            } else {
+                printf("Sample %d: %f ms\n", b, runtimes[b] * 1000);
+            }
+        });
+
+        // Record the runtimes and keep the best schedule so far.
+        for (int b = 0; b < c.batch_size; b++) {
+            if (runtimes[b] < 0) continue;
+            string dir = sample_dir(b);
+            if (!augment_sample(dir + "/sample.sample", runtimes[b], 0, schedule_id(b))) {
+                printf("Could not record the runtime of sample %d\n", b);
+                continue;
+            }
+            if (!append_to_sample_database(sample_database(c), dir + "/sample.sample")) {
+                printf("Could not add sample %d to %s\n", b, sample_database(c).c_str());
+            }
+            if (best_runtime < 0 || runtimes[b] < best_runtime) {
+                string schedule = dir + "/" + c.pipeline + ".schedule";
+                if (file_exists(schedule) && copy_file(schedule, c.best_schedule_file)) {
+                    best_runtime = runtimes[b];
+                    printf("New best schedule (%f ms) written to %s\n",
+                           best_runtime * 1000, c.best_schedule_file.c_str());
+                }
+            }
+        }
+
+        printf("Retraining model...\n");
+        if (!retrain(c)) {
+            printf("Retraining failed\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -1,8 +1,15 @@
+#include <cmath>
+#include <random>
 #include <string>
 #include <vector>
 #include <set>
 #include <unistd.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SampleDatabase.h"
 #include "ThroughputPredictorPipeline.h"
 
 using std::vector;
@@ -10,14 +17,14 @@ using std::string;
 using std::map;
 using std::set;
 
-const int models = 1;
-
 struct Sample {
     vector<float> runtimes;
-    double prediction[models];
+    double prediction;
     string filename;
     int32_t schedule_id;
     Runtime::Buffer<float> schedule_features;
+    // Hardware counter rates measured while benchmarking, if any
+    map<string, float> counters;
 };
 
 struct PipelineSample {
@@ -25,9 +32,12 @@ struct PipelineSample {
     int32_t num_stages;
     Runtime::Buffer<float> pipeline_features;
     map<uint64_t, Sample> schedules;
+    // The schedules in the order they are batched for training,
+    // reshuffled each epoch.
+    vector<Sample *> schedule_order;
 };
 
-uint64_t hash_floats(uint64_t h, float *begin, float *end) {
+uint64_t hash_floats(uint64_t h, const float *begin, const float *end) {
     while (begin != end) {
         uint32_t bits = *((uint32_t *)begin);
         // From boost
@@ -46,48 +56,95 @@ bool ends_with(const string &str, const string &suffix) {
     return true;
 }
 
-// Load all the samples, reading filenames from stdin
-map<int, PipelineSample> load_samples() {
+// Load the sample.counters file written next to a sample by the
+// autotuning driver when perf counters are enabled. Each line is an
+// event name and its rate per second.
+map<string, float> load_counters(const string &sample_file) {
+    map<string, float> result;
+    string path = sample_file.substr(0, sample_file.size() - 7) + ".counters";
+    std::ifstream file(path);
+    string event;
+    float rate;
+    while (file >> event >> rate) {
+        result[event] = rate;
+    }
+    return result;
+}
+
+// Report how well each hardware counter explains the error left over
+// in the model's predictions. A counter that correlates strongly with
+// the residual is measuring something the features miss.
+void report_counter_correlations(const map<int, PipelineSample> &samples) {
+    map<string, vector<std::pair<double, double>>> points;
+    for (const auto &p : samples) {
+        for (const auto &s : p.second.schedules) {
+            const Sample &sample = s.second;
+            if (sample.counters.empty() || sample.prediction <= 0) continue;
+            double residual = std::log(sample.runtimes[0] / sample.prediction);
+            for (const auto &c : sample.counters) {
+                points[c.first].emplace_back(std::log(c.second + 1), residual);
+            }
+        }
+    }
+    for (const auto &p : points) {
+        const auto &v = p.second;
+        if (v.size() < 2) continue;
+        double mx = 0, my = 0;
+        for (const auto &xy : v) {
+            mx += xy.first;
+            my += xy.second;
+        }
+        mx /= v.size();
+        my /= v.size();
+        double sxy = 0, sxx = 0, syy = 0;
+        for (const auto &xy : v) {
+            sxy += (xy.first - mx) * (xy.second - my);
+            sxx += (xy.first - mx) * (xy.first - mx);
+            syy += (xy.second - my) * (xy.second - my);
+        }
+        if (sxx <= 0 || syy <= 0) continue;
+        std::cout << "Correlation of " << p.first << " with log prediction error: "
+                  << sxy / std::sqrt(sxx * syy) << " (" << v.size() << " samples)\n";
+    }
+}
+
+// Collects samples into pipelines, merging repeated measurements of
+// the same schedule.
+struct SampleLoader {
     map<int, PipelineSample> result;
-    vector<float> scratch(10 * 1024 * 1024);
 
     int best = -1;
     float best_runtime = 1e20f;
 
     size_t num_read = 0, num_unique = 0;
-    while (!std::cin.eof()) {
-        string s;
-        std::cin >> s;
-        if (!ends_with(s, ".sample")) {
-            std::cout << "Skipping file: " << s << "\n";
-            continue;
+
+    // Add a sample, given the contents of its augmented .sample
+    // file. The hardware counters are only found next to sample
+    // files, not in databases.
+    void add(const float *scratch, size_t floats_read, const string &s, bool from_file) {
+        if (floats_read < 3) {
+            std::cout << "Truncated sample: " << s << " " << floats_read << "\n";
+            return;
         }
-        std::ifstream file(s);
-        file.read((char *)(scratch.data()), scratch.size() * sizeof(float));
-        const size_t floats_read = file.gcount() / sizeof(float);
         const size_t num_features = floats_read - 3;
         const size_t features_per_stage = 26 + 57 * 7;
-        file.close();
 
-        if (floats_read == scratch.size()) {
-            std::cout << "Too-large sample: " << s << " " << floats_read << "\n";
-            continue;
-        }
         if (num_features % features_per_stage != 0) {
             std::cout << "Truncated sample: " << s << " " << floats_read << "\n";
-            continue;
+            return;
         }
         const size_t num_stages = num_features / features_per_stage;
 
         const float runtime = scratch[num_features];
         if (runtime <= 0 || runtime > 1000) { // Don't try to predict runtime over 1s
             std::cout << "Implausible runtime in ms: " << runtime << "\n";
-            continue;
+            return;
         }
         // std::cout << "Runtime: " << runtime << "\n";
 
-        const int pipeline_id = *((int32_t *)(&scratch[num_features + 1]));
-        const int schedule_id = *((int32_t *)(&scratch[num_features + 2]));
+        int32_t pipeline_id, schedule_id;
+        memcpy(&pipeline_id, &scratch[num_features + 1], sizeof(pipeline_id));
+        memcpy(&schedule_id, &scratch[num_features + 2], sizeof(schedule_id));
 
         if (runtime < best_runtime) {
             best_runtime = runtime;
@@ -125,6 +182,9 @@ map<int, PipelineSample> load_samples() {
                 it->second.runtimes.push_back(best);
                 it->second.runtimes[0] = runtime;
                 it->second.filename = s;
+                if (from_file) {
+                    it->second.counters = load_counters(s);
+                }
             } else {
                 it->second.runtimes.push_back(runtime);
             }
@@ -132,10 +192,11 @@ map<int, PipelineSample> load_samples() {
             Sample sample;
             sample.filename = s;
             sample.runtimes.push_back(runtime);
-            for (int i = 0; i < models; i++) {
-                sample.prediction[i] = 0.0;
-            }
+            sample.prediction = 0.0;
             sample.schedule_id = schedule_id;
+            if (from_file) {
+                sample.counters = load_counters(s);
+            }
             sample.schedule_features = Runtime::Buffer<float>(26, num_stages);
 
             bool ok = true;
@@ -161,6 +222,54 @@ map<int, PipelineSample> load_samples() {
             std::cout << "Samples loaded: " << num_read << " (" << num_unique << " unique)\n";
         }
     }
+};
+
+// Load all the samples, reading filenames from stdin. Each is either a
+// .sample file, or a .db database of samples written by
+// augment_sample, which is read in place from a memory mapping.
+map<int, PipelineSample> load_samples() {
+    SampleLoader loader;
+    vector<float> scratch(10 * 1024 * 1024);
+
+    while (!std::cin.eof()) {
+        string s;
+        std::cin >> s;
+        if (ends_with(s, ".db")) {
+            SampleDatabase db(s);
+            if (!db.valid()) {
+                std::cout << "Could not map sample database: " << s << "\n";
+                continue;
+            }
+            bool complete = db.for_each_record([&](const SampleDatabase::Record &r) {
+                    loader.add(r.floats, r.num_floats, s + "@" + std::to_string(r.offset), false);
+                });
+            if (!complete) {
+                std::cout << "Sample database ends with a corrupt record: " << s << "\n";
+            }
+            continue;
+        }
+        if (!ends_with(s, ".sample")) {
+            std::cout << "Skipping file: " << s << "\n";
+            continue;
+        }
+        std::ifstream file(s);
+        file.read((char *)(scratch.data()), scratch.size() * sizeof(float));
+        const size_t floats_read = file.gcount() / sizeof(float);
+        file.close();
+
+        if (floats_read == scratch.size()) {
+            std::cout << "Too-large sample: " << s << " " << floats_read << "\n";
+            continue;
+        }
+        loader.add(scratch.data(), floats_read, s, true);
+    }
+
+    map<int, PipelineSample> &result = loader.result;
+    for (auto &p : result) {
+        for (auto &s : p.second.schedules) {
+            p.second.schedule_order.push_back(&s.second);
+        }
+    }
 
     // Check the noise level
     for (const auto &pipe : result) {
@@ -197,113 +306,152 @@ map<int, PipelineSample> load_samples() {
 
     std::cout << "Distinct pipelines: " << result.size() << "\n";
 
-    std::cout << "Best schedule id / runtime: " << best << " / " << best_runtime << "\n";
+    std::cout << "Best schedule id / runtime: " << loader.best << " / " << loader.best_runtime << "\n";
     return result;
 }
 
 
+// A minibatch is up to 1024 schedules of one pipeline, as the cost
+// model takes the features of a single pipeline.
+struct Minibatch {
+    PipelineSample *pipeline;
+    size_t first, size;
+};
+
+struct WorkerStats {
+    float loss_sum = 0, loss_count = 0;
+    float correct_ordering_good = 0, correct_ordering_count = 0;
+};
+
+// Take a backprop step on one minibatch, and measure how often the
+// predictions put random pairs of the pipeline's schedules in the
+// right order.
+void train_on_minibatch(ThroughputPredictorPipeline &tp, const Minibatch &mb,
+                        float learning_rate, int num_cores,
+                        std::mt19937 &rng, WorkerStats &stats) {
+    PipelineSample &p = *mb.pipeline;
+    tp.reset();
+    tp.set_pipeline_features(p.pipeline_features, num_cores);
+
+    Runtime::Buffer<float> runtimes(mb.size);
+
+    for (size_t j = 0; j < mb.size; j++) {
+        Sample &sched = *p.schedule_order[mb.first + j];
+        Runtime::Buffer<float> buf;
+        tp.enqueue(p.num_stages, &buf, &sched.prediction);
+        runtimes(j) = sched.runtimes[0];
+        buf.copy_from(sched.schedule_features);
+    }
+
+    float loss = tp.backprop(runtimes, learning_rate);
+    stats.loss_sum += loss;
+    stats.loss_count++;
+
+    const size_t n = p.schedule_order.size();
+    int good = 0, bad = 0;
+    size_t attempts = 0;
+    while ((size_t)(good + bad) < mb.size && attempts < mb.size * 2) {
+        attempts++;
+        const Sample &sched1 = *p.schedule_order[rng() % n];
+        const Sample &sched2 = *p.schedule_order[rng() % n];
+        if (sched1.prediction == 0 || sched2.prediction == 0) continue;
+        if (sched1.runtimes[0] > 1.5f*sched2.runtimes[0] ||
+            sched2.runtimes[0] > 1.5f*sched1.runtimes[0]) {
+            if ((sched1.prediction > sched2.prediction) ==
+                (sched1.runtimes[0] > sched2.runtimes[0])) {
+                good++;
+            } else {
+                bad++;
+            }
+        }
+    }
+    stats.correct_ordering_good += good;
+    stats.correct_ordering_count += good + bad;
+}
+
 int main(int argc, char **argv) {
     auto samples = load_samples();
 
-    // Iterate through the pipelines
-    ThroughputPredictorPipeline tpp[models];
+    // Training is data-parallel. Each worker has its own copy of the
+    // model, and each step the workers take minibatches from different
+    // pipelines. Their updates are then averaged, so the model takes
+    // one step per group of minibatches. The number of workers is
+    // OMP_NUM_THREADS, or the number of cores.
+    int num_workers = 1;
+    #ifdef _OPENMP
+    num_workers = omp_get_max_threads();
+    #endif
+    vector<ThroughputPredictorPipeline> tpp(num_workers);
+    for (int w = 1; w < num_workers; w++) {
+        tpp[w].copy_weights_from(tpp[0]);
+    }
 
     float rates[] = {0.01f};
 
     int num_cores = atoi(getenv("HL_NUM_THREADS"));
-    
-    for (float learning_rate : rates) {
-        for (int batch = 0; batch < atoi(argv[1]); batch++) {
-            int counter = 0;
-            float loss_sum[models] = {0}, loss_sum_counter[models] = {0};
-            float correct_ordering_rate_sum[models] = {0};
-            float correct_ordering_rate_count[models] = {0};
-            std::cout << "Iterating over " << samples.size() << " samples\n";
-            #pragma omp parallel for
-            for (int model = 0; model < models; model++) {
-                loss_sum[model] = loss_sum_counter[model] = correct_ordering_rate_sum[model] = correct_ordering_rate_count[model] = 0;
-                auto &tp = tpp[model];
-
-                for (auto &p : samples) {
-                    if (p.second.schedules.size() < 8) continue;
-                    tp.reset();
-                    tp.set_pipeline_features(p.second.pipeline_features, num_cores);
-
-                    size_t batch_size = std::min((size_t)1024, p.second.schedules.size());
-
-                    Runtime::Buffer<float> runtimes(batch_size);
-
-                    size_t first = 0;
-                    if (p.second.schedules.size() > 1024) {
-                        first = rand() % (p.second.schedules.size() - 1024);
-                    }
 
-                    for (size_t j = 0; j < batch_size; j++) {
-                        auto it = p.second.schedules.begin();
-                        std::advance(it, j + first);
-                        auto &sched = it->second;
-                        Runtime::Buffer<float> buf;
-                        tp.enqueue(p.second.num_stages, &buf, &sched.prediction[model]);
-                        runtimes(j) = sched.runtimes[0];
-                        buf.copy_from(sched.schedule_features);
-                    }
+    std::mt19937 rng(0);
+    vector<std::mt19937> worker_rngs;
+    for (int w = 0; w < num_workers; w++) {
+        worker_rngs.emplace_back(w + 1);
+    }
 
-                    float loss = tp.backprop(runtimes, learning_rate);
-                    loss_sum[model] += loss;
-                    loss_sum_counter[model] ++;
-
-                    if (true) {
-                        int good = 0, bad = 0;
-                        int attempts = 0;
-                        while (good + bad < batch_size && attempts < batch_size * 2) {                            
-                            attempts++;
-                            int j1 = rand() % p.second.schedules.size();
-                            int j2 = rand() % p.second.schedules.size();
-                            auto it1 = p.second.schedules.begin();
-                            auto it2 = p.second.schedules.begin();
-                            std::advance(it1, j1);
-                            std::advance(it2, j2);
-                            auto &sched1 = it1->second;
-                            auto &sched2 = it2->second;
-                            if (sched1.prediction[model] == 0 || sched2.prediction[model] == 0) continue;
-                            if (sched1.runtimes[0] > 1.5f*sched2.runtimes[0] ||
-                                sched2.runtimes[0] > 1.5f*sched1.runtimes[0]) {
-                                if ((sched1.prediction[model] > sched2.prediction[model]) ==
-                                    (sched1.runtimes[0] > sched2.runtimes[0])) {
-                                    good++;
-                                } else {
-                                    bad++;
-                                }
-                            }
-                        }
-                        correct_ordering_rate_sum[model] += good;
-                        correct_ordering_rate_count[model] += good + bad;
-                    }
+    for (float learning_rate : rates) {
+        for (int batch = 0; batch < atoi(argv[1]); batch++) {
+            // Shuffle the schedules of each pipeline, cut them into
+            // minibatches, and shuffle the minibatches of all the
+            // pipelines together.
+            vector<Minibatch> minibatches;
+            for (auto &p : samples) {
+                PipelineSample &ps = p.second;
+                if (ps.schedule_order.size() < 8) continue;
+                std::shuffle(ps.schedule_order.begin(), ps.schedule_order.end(), rng);
+                for (size_t first = 0; first < ps.schedule_order.size(); first += 1024) {
+                    size_t size = std::min((size_t)1024, ps.schedule_order.size() - first);
+                    minibatches.push_back({&ps, first, size});
                 }
-                counter++;
             }
+            if (minibatches.empty()) {
+                std::cout << "No pipelines with enough samples to train on\n";
+                break;
+            }
+            std::shuffle(minibatches.begin(), minibatches.end(), rng);
 
-            std::cout << "RMS errors: ";
-            for (int model = 0; model < models; model++) {
-                std::cout << loss_sum[model] / loss_sum_counter[model] << " ";
+            // Every active worker takes a minibatch each step, so wrap
+            // around to fill the last step.
+            const size_t active = std::min((size_t)num_workers, minibatches.size());
+            for (size_t i = 0; minibatches.size() % active != 0; i++) {
+                minibatches.push_back(minibatches[i]);
             }
-            std::cout << "\nCorrect ordering rate: ";
-            int best_model = 0;
-            float best_rate = 0;
-            for (int model = 0; model < models; model++) {
-                float rate = correct_ordering_rate_sum[model] / correct_ordering_rate_count[model];
-                if (rate < best_rate) {
-                    best_model = model;
-                    best_rate = rate;
+
+            std::cout << "Iterating over " << samples.size() << " pipelines in "
+                      << minibatches.size() << " minibatches on " << active << " workers\n";
+
+            vector<WorkerStats> stats(num_workers);
+            for (size_t step = 0; step < minibatches.size(); step += active) {
+                #pragma omp parallel for
+                for (int w = 0; w < (int)active; w++) {
+                    train_on_minibatch(tpp[w], minibatches[step + w], learning_rate,
+                                       num_cores, worker_rngs[w], stats[w]);
                 }
-                std::cout << rate << " ";
+                ThroughputPredictorPipeline::average_updates(tpp, active);
+            }
+
+            WorkerStats total;
+            for (const WorkerStats &s : stats) {
+                total.loss_sum += s.loss_sum;
+                total.loss_count += s.loss_count;
+                total.correct_ordering_good += s.correct_ordering_good;
+                total.correct_ordering_count += s.correct_ordering_count;
             }
-            std::cout << "\n";
-            tpp[best_model].save_weights();
+            std::cout << "RMS errors: " << total.loss_sum / total.loss_count << "\n";
+            std::cout << "Correct ordering rate: "
+                      << total.correct_ordering_good / total.correct_ordering_count << "\n";
+            tpp[0].save_weights();
         }
     }
 
-    // tpp.save_weights();
+    report_counter_correlations(samples);
 
     return 0;
 }
@@ -6,6 +6,10 @@ namespace {
 class BilateralGrid : public Halide::Generator<BilateralGrid> {
 public:
     GeneratorParam<int>   s_sigma{"s_sigma", 8};
+    // Process the image in bands of rows, so that the grid for a band
+    // stays in cache (or in shared memory on GPUs) instead of being
+    // written out to memory in full between each stage.
+    GeneratorParam<bool>  streaming{"streaming", false};
 
     Input<Buffer<float>>  input{"input", 2};
     Input<float>          r_sigma{"r_sigma"};
@@ -78,6 +82,28 @@ public:
             blurx.estimate(z, 0, 12);
             blury.estimate(z, 0, 12);
             bilateral_grid.estimate(x, 0, 1536).estimate(y, 0, 2560);
+        } else if (get_target().has_gpu_feature() && streaming) {
+            Var xi("xi"), yi("yi"), zi("zi");
+
+            // Splat and blur in z exactly as below, with the
+            // histogram for each 8x8 tile of the grid in shared memory.
+            blurz.compute_root().reorder(c, z, x, y).gpu_tile(x, y, xi, yi, 8, 8);
+            histogram.reorder(c, z, x, y).compute_at(blurz, x).gpu_threads(x, y);
+            histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+
+            // Fuse the blurs in x and y into a single kernel. Each
+            // block computes the blur in x for its tile plus a two
+            // cell apron in shared memory, and then blurs that in y,
+            // so blurx never goes out to global memory.
+            blury.compute_root().reorder(c, x, y, z)
+                .reorder_storage(c, x, y, z).vectorize(c)
+                .gpu_tile(x, y, z, xi, yi, zi, 16, 16, 1, TailStrategy::RoundUp);
+            blurx.compute_at(blury, x).reorder_storage(c, x, y, z)
+                .vectorize(c).gpu_threads(x, y);
+
+            // Slice.
+            bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+            interpolated.compute_at(bilateral_grid, xi).vectorize(c);
         } else if (get_target().has_gpu_feature()) {
             Var xi("xi"), yi("yi"), zi("zi");
 
@@ -106,6 +132,25 @@ public:
                 .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
             bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
             interpolated.compute_at(bilateral_grid, xi).vectorize(c);
+        } else if (streaming) {
+            // The streaming CPU schedule. Each thread produces a band
+            // of 32 rows of the grid, one grid row at a time. Every
+            // stage of the grid is computed as a sliding window over
+            // those rows, so only the few rows of each stage needed
+            // by the blurs are live at once, and they stay in cache.
+            Var yo("yo"), yi("yi"), ty("ty");
+            bilateral_grid
+                .split(y, yo, yi, 32 * s_sigma)
+                .split(yi, ty, yi, s_sigma)
+                .parallel(yo).vectorize(x, 8);
+            blury.store_at(bilateral_grid, yo).compute_at(bilateral_grid, ty)
+                .reorder(c, x, y, z).vectorize(x, 8).unroll(c);
+            blurx.store_at(bilateral_grid, yo).compute_at(bilateral_grid, ty)
+                .reorder(c, x, y, z).vectorize(x, 8).unroll(c);
+            blurz.store_at(bilateral_grid, yo).compute_at(bilateral_grid, ty)
+                .reorder(c, z, x, y).vectorize(x, 8).unroll(c);
+            histogram.compute_at(blurz, y);
+            histogram.update().reorder(c, r.x, r.y, x, y).unroll(c);
         } else {
             // The CPU schedule.
             blurz.compute_root().reorder(c, z, x, y).parallel(y).vectorize(x, 8).unroll(c);
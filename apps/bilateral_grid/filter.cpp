@@ -5,6 +5,7 @@
 #include "bilateral_grid.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "bilateral_grid_auto_schedule.h"
+#include "bilateral_grid_streaming.h"
 #endif
 
 #include "halide_benchmark.h"
@@ -32,18 +33,31 @@ int main(int argc, char **argv) {
     // Timing code. Timing doesn't include copying the input data to
     // the gpu or copying the output back.
 
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing_iterations;
+
     // Manually-tuned version
-    double min_t_manual = benchmark(timing_iterations, 10, [&]() {
+    config.name = "bilateral_grid_manual";
+    BenchmarkResult manual = benchmark([&]() {
         bilateral_grid(input, r_sigma, output);
-    });
-    printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
+    }, config);
+    printf("Manually-tuned time: %gms\n", manual.wall_time * 1e3);
 
     #ifndef NO_AUTO_SCHEDULE
+    // Manually-tuned version that processes the image in bands
+    config.name = "bilateral_grid_streaming";
+    BenchmarkResult streaming = benchmark([&]() {
+        bilateral_grid_streaming(input, r_sigma, output);
+    }, config);
+    printf("Streaming time: %gms\n", streaming.wall_time * 1e3);
+
     // Auto-scheduled version
-    double min_t_auto = benchmark(timing_iterations, 10, [&]() {
+    config.name = "bilateral_grid_auto_schedule";
+    BenchmarkResult automatic = benchmark([&]() {
         bilateral_grid_auto_schedule(input, r_sigma, output);
-    });
-    printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+    }, config);
+    printf("Auto-scheduled time: %gms\n", automatic.wall_time * 1e3);
     #endif
 
     convert_and_save_image(output, argv[2]);
@@ -10,7 +10,18 @@ using namespace Halide;
 using namespace Halide::ConciseCasts;
 
 // Shared variables
-Var x, y, c, yi, yo, yii, xi;
+Var x, y, c, yi, yo, yii, xi, xo;
+
+// The vector width, in 16-bit lanes, to schedule for.
+int vector_size(const Target &t) {
+    if (t.has_feature(Target::HVX_64)) {
+        return 32;
+    } else if (t.has_feature(Target::HVX_128)) {
+        return 64;
+    } else {
+        return t.natural_vector_size(UInt(16));
+    }
+}
 
 // Average two positive values rounding up
 Expr avg(Expr a, Expr b) {
@@ -154,13 +165,8 @@ public:
         Pipeline p(output);
 
         if (!auto_schedule) {
-            int vec = get_target().natural_vector_size(UInt(16));
+            int vec = vector_size(get_target());
             bool use_hexagon = get_target().features_any_of({Target::HVX_64, Target::HVX_128});
-            if (get_target().has_feature(Target::HVX_64)) {
-                vec = 32;
-            } else if (get_target().has_feature(Target::HVX_128)) {
-                vec = 64;
-            }
             for (Func f : intermediates) {
                 f.compute_at(intermed_compute_at)
                     .store_at(intermed_store_at)
@@ -201,6 +207,181 @@ private:
     vector<Func> intermediates;
 };
 
+Func hot_pixel_suppression(Func input) {
+
+    Expr a = max(input(x - 2, y), input(x + 2, y),
+                 input(x, y - 2), input(x, y + 2));
+
+    Func denoised;
+    denoised(x, y) = clamp(input(x, y), 0, a);
+
+    return denoised;
+}
+
+Func deinterleave(Func raw) {
+    // Deinterleave the color channels
+    Func deinterleaved("deinterleaved");
+
+    deinterleaved(x, y, c) = select(c == 0, raw(2*x, 2*y),
+                                    c == 1, raw(2*x+1, 2*y),
+                                    c == 2, raw(2*x, 2*y+1),
+                                            raw(2*x+1, 2*y+1));
+    return deinterleaved;
+}
+
+// Apply a 4x3 color matrix in Q8.8 fixed point.
+Func apply_color_matrix(Func input, Func matrix) {
+    Func corrected;
+    Expr ir = cast<int32_t>(input(x, y, 0));
+    Expr ig = cast<int32_t>(input(x, y, 1));
+    Expr ib = cast<int32_t>(input(x, y, 2));
+
+    Expr r = matrix(3, 0) + matrix(0, 0) * ir + matrix(1, 0) * ig + matrix(2, 0) * ib;
+    Expr g = matrix(3, 1) + matrix(0, 1) * ir + matrix(1, 1) * ig + matrix(2, 1) * ib;
+    Expr b = matrix(3, 2) + matrix(0, 2) * ir + matrix(1, 2) * ig + matrix(2, 2) * ib;
+
+    r = cast<int16_t>(r/256);
+    g = cast<int16_t>(g/256);
+    b = cast<int16_t>(b/256);
+    corrected(x, y, c) = select(c == 0, r,
+                                c == 1, g,
+                                        b);
+
+    return corrected;
+}
+
+// Look up each value of input, which is in [0, 1024), in a tone
+// curve. If lut_resample is greater than one, the curve only has an
+// entry for every lut_resample values, and is linearly interpolated.
+Func apply_lut(Func input, Func curve, int lut_resample) {
+    Func curved;
+
+    if (lut_resample == 1) {
+        // Use clamp to restrict size of LUT as allocated by compute_root
+        curved(x, y, c) = curve(clamp(input(x, y, c), 0, 1023));
+    } else {
+        // Use linear interpolation to sample the LUT.
+        Expr in = input(x, y, c);
+        Expr u0 = in/lut_resample;
+        Expr u = in%lut_resample;
+        Expr y0 = curve(clamp(u0, 0, 1024/lut_resample - 1));
+        Expr y1 = curve(clamp(u0 + 1, 0, 1024/lut_resample - 1));
+        curved(x, y, c) = cast<uint8_t>((cast<uint16_t>(y0)*lut_resample + (y1 - y0)*u)/lut_resample);
+    }
+
+    return curved;
+}
+
+// Sharpen with an unsharp mask, weighted by a strength in 2.5 fixed
+// point, which allows sharpening in the range [0, 4].
+Func unsharp_mask(Func input, Func strength_x32) {
+    // Make an unsharp mask by blurring in y, then in x.
+    Func unsharp_y("unsharp_y");
+    unsharp_y(x, y, c) = blur121(input(x, y - 1, c), input(x, y, c), input(x, y + 1, c));
+
+    Func unsharp("unsharp");
+    unsharp(x, y, c) = blur121(unsharp_y(x - 1, y, c), unsharp_y(x, y, c), unsharp_y(x + 1, y, c));
+
+    Func mask("mask");
+    mask(x, y, c) = cast<int16_t>(input(x, y, c)) - cast<int16_t>(unsharp(x, y, c));
+
+    // Weight the mask with the sharpening strength, and add it to the
+    // input to get the sharpened result.
+    Func sharpened("sharpened");
+    sharpened(x, y, c) = u8_sat(input(x, y, c) + (mask(x, y, c) * strength_x32()) / 32);
+
+    return sharpened;
+}
+
+// The manual schedule of a camera pipe. The stages between the raw
+// input and the output are computed two rows of the output at a time,
+// in line buffers that slide down the rows. Normally the output is
+// split into strips of rows, computed in parallel, each with its own
+// line buffers. If streaming, the whole output is a single strip,
+// which is split into tiles of columns instead.
+void schedule_camera_pipe(const Target &t, Func processed, Expr out_width, Expr out_height,
+                          const GeneratorInput<Buffer<uint16_t>> &input, Func denoised, Func deinterleaved,
+                          Demosaic &demosaiced, Func corrected, Func curved, bool streaming) {
+    int vec = vector_size(t);
+
+    processed.compute_root()
+        .reorder(c, x, y)
+        .split(y, yi, yii, 2, TailStrategy::RoundUp);
+    LoopLevel store_at;
+    if (streaming) {
+        processed
+            .split(x, xo, xi, 8*2*vec)
+            .reorder(c, xi, yii, yi, xo)
+            .vectorize(xi, 2*vec, TailStrategy::RoundUp)
+            .unroll(c)
+            .parallel(xo);
+        store_at = LoopLevel(processed, xo);
+    } else {
+        // In HVX 128, we need 2 threads to saturate HVX with work,
+        //and in HVX 64 we need 4 threads, and on other devices,
+        // we might need many threads.
+        Expr strip_size;
+        if (t.has_feature(Target::HVX_128)) {
+            strip_size = out_height / 2;
+        } else if (t.has_feature(Target::HVX_64)) {
+            strip_size = out_height / 4;
+        } else {
+            strip_size = 32;
+        }
+        strip_size = (strip_size / 2) * 2;
+
+        processed
+            .split(yi, yo, yi, strip_size / 2)
+            .vectorize(x, 2*vec, TailStrategy::RoundUp)
+            .unroll(c)
+            .parallel(yo);
+        store_at = LoopLevel(processed, yo);
+
+        // We can generate slightly better code if we know the splits divide the extent.
+        processed.bound(y, 0, (out_height/strip_size)*strip_size);
+    }
+    LoopLevel compute_at(processed, yi);
+
+    denoised.compute_at(compute_at).store_at(store_at)
+        .prefetch(input, y, 2)
+        .fold_storage(y, 16)
+        .tile(x, y, x, y, xi, yi, 2*vec, 2)
+        .vectorize(xi)
+        .unroll(yi);
+
+    deinterleaved.compute_at(compute_at).store_at(store_at)
+        .fold_storage(y, 8)
+        .reorder(c, x, y)
+        .vectorize(x, 2*vec, TailStrategy::RoundUp)
+        .unroll(c);
+
+    curved.compute_at(compute_at).store_at(store_at)
+        .reorder(c, x, y)
+        .tile(x, y, x, y, xi, yi, 2*vec, 2, TailStrategy::RoundUp)
+        .vectorize(xi)
+        .unroll(yi)
+        .unroll(c);
+    corrected.compute_at(curved, x)
+        .reorder(c, x, y)
+        .vectorize(x)
+        .unroll(c);
+
+    demosaiced.intermed_compute_at.set(compute_at);
+    demosaiced.intermed_store_at.set(store_at);
+    demosaiced.output_compute_at.set({curved, x});
+
+    if (t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        processed.hexagon();
+        denoised.align_storage(x, vec);
+        deinterleaved.align_storage(x, vec);
+        corrected.align_storage(x, vec);
+    }
+
+    processed
+        .bound(c, 0, 3)
+        .bound(x, 0, ((out_width)/(2*vec))*(2*vec));
+}
+
 class CameraPipe : public Halide::Generator<CameraPipe> {
 public:
     // Parameterized output type, because LLVM PTX (GPU) backend does not
@@ -223,37 +404,11 @@ public:
 
 private:
 
-    Func hot_pixel_suppression(Func input);
-    Func deinterleave(Func raw);
     Func apply_curve(Func input);
     Func color_correct(Func input);
     Func sharpen(Func input);
 };
 
-Func CameraPipe::hot_pixel_suppression(Func input) {
-
-    Expr a = max(input(x - 2, y), input(x + 2, y),
-                 input(x, y - 2), input(x, y + 2));
-
-    Func denoised;
-    denoised(x, y) = clamp(input(x, y), 0, a);
-
-    return denoised;
-}
-
-Func CameraPipe::deinterleave(Func raw) {
-    // Deinterleave the color channels
-    Func deinterleaved("deinterleaved");
-
-    deinterleaved(x, y, c) = select(c == 0, raw(2*x, 2*y),
-                                    c == 1, raw(2*x+1, 2*y),
-                                    c == 2, raw(2*x, 2*y+1),
-                                            raw(2*x+1, 2*y+1));
-    return deinterleaved;
-}
-
-
-
 Func CameraPipe::color_correct(Func input) {
     // Get a color matrix by linearly interpolating between two
     // calibrated matrices using inverse kelvin.
@@ -268,23 +423,7 @@ Func CameraPipe::color_correct(Func input) {
         matrix.compute_root();
     }
 
-    Func corrected;
-    Expr ir = cast<int32_t>(input(x, y, 0));
-    Expr ig = cast<int32_t>(input(x, y, 1));
-    Expr ib = cast<int32_t>(input(x, y, 2));
-
-    Expr r = matrix(3, 0) + matrix(0, 0) * ir + matrix(1, 0) * ig + matrix(2, 0) * ib;
-    Expr g = matrix(3, 1) + matrix(0, 1) * ir + matrix(1, 1) * ig + matrix(2, 1) * ib;
-    Expr b = matrix(3, 2) + matrix(0, 2) * ir + matrix(1, 2) * ig + matrix(2, 2) * ib;
-
-    r = cast<int16_t>(r/256);
-    g = cast<int16_t>(g/256);
-    b = cast<int16_t>(b/256);
-    corrected(x, y, c) = select(c == 0, r,
-                                c == 1, g,
-                                        b);
-
-    return corrected;
+    return apply_color_matrix(input, matrix);
 }
 
 Func CameraPipe::apply_curve(Func input) {
@@ -337,22 +476,7 @@ Func CameraPipe::apply_curve(Func input) {
         curve.add_trace_tag(cfg.to_trace_tag());
     }
 
-    Func curved;
-
-    if (lutResample == 1) {
-        // Use clamp to restrict size of LUT as allocated by compute_root
-        curved(x, y, c) = curve(clamp(input(x, y, c), 0, 1023));
-    } else {
-        // Use linear interpolation to sample the LUT.
-        Expr in = input(x, y, c);
-        Expr u0 = in/lutResample;
-        Expr u = in%lutResample;
-        Expr y0 = curve(clamp(u0, 0, 127));
-        Expr y1 = curve(clamp(u0 + 1, 0, 127));
-        curved(x, y, c) = cast<uint8_t>((cast<uint16_t>(y0)*lutResample + (y1 - y0)*u)/lutResample);
-    }
-
-    return curved;
+    return apply_lut(input, curve, lutResample);
 }
 
 Func CameraPipe::sharpen(Func input) {
@@ -371,22 +495,7 @@ Func CameraPipe::sharpen(Func input) {
         sharpen_strength_x32.add_trace_tag(cfg.to_trace_tag());
     }
 
-    // Make an unsharp mask by blurring in y, then in x.
-    Func unsharp_y("unsharp_y");
-    unsharp_y(x, y, c) = blur121(input(x, y - 1, c), input(x, y, c), input(x, y + 1, c));
-
-    Func unsharp("unsharp");
-    unsharp(x, y, c) = blur121(unsharp_y(x - 1, y, c), unsharp_y(x, y, c), unsharp_y(x + 1, y, c));
-
-    Func mask("mask");
-    mask(x, y, c) = cast<int16_t>(input(x, y, c)) - cast<int16_t>(unsharp(x, y, c));
-
-    // Weight the mask with the sharpening strength, and add it to the
-    // input to get the sharpened result.
-    Func sharpened("sharpened");
-    sharpened(x, y, c) = u8_sat(input(x, y, c) + (mask(x, y, c) * sharpen_strength_x32()) / 32);
-
-    return sharpened;
+    return unsharp_mask(input, sharpen_strength_x32);
 }
 
 void CameraPipe::generate() {
@@ -427,76 +536,9 @@ void CameraPipe::generate() {
             .estimate(y, 0, 1968);
 
     } else {
-
-        Expr out_width = processed.width();
-        Expr out_height = processed.height();
-        // In HVX 128, we need 2 threads to saturate HVX with work,
-        //and in HVX 64 we need 4 threads, and on other devices,
-        // we might need many threads.
-        Expr strip_size;
-        if (get_target().has_feature(Target::HVX_128)) {
-            strip_size = processed.dim(1).extent() / 2;
-        } else if (get_target().has_feature(Target::HVX_64)) {
-            strip_size = processed.dim(1).extent() / 4;
-        } else {
-            strip_size = 32;
-        }
-        strip_size = (strip_size / 2) * 2;
-
-        int vec = get_target().natural_vector_size(UInt(16));
-        if (get_target().has_feature(Target::HVX_64)) {
-            vec = 32;
-        } else if (get_target().has_feature(Target::HVX_128)) {
-            vec = 64;
-        }
-        processed.compute_root()
-            .reorder(c, x, y)
-            .split(y, yi, yii, 2, TailStrategy::RoundUp)
-            .split(yi, yo, yi, strip_size / 2)
-            .vectorize(x, 2*vec, TailStrategy::RoundUp)
-            .unroll(c)
-            .parallel(yo);
-
-        denoised.compute_at(processed, yi).store_at(processed, yo)
-            .prefetch(input, y, 2)
-            .fold_storage(y, 16)
-            .tile(x, y, x, y, xi, yi, 2*vec, 2)
-            .vectorize(xi)
-            .unroll(yi);
-
-        deinterleaved.compute_at(processed, yi).store_at(processed, yo)
-            .fold_storage(y, 8)
-            .reorder(c, x, y)
-            .vectorize(x, 2*vec, TailStrategy::RoundUp)
-            .unroll(c);
-
-        curved.compute_at(processed, yi).store_at(processed, yo)
-            .reorder(c, x, y)
-            .tile(x, y, x, y, xi, yi, 2*vec, 2, TailStrategy::RoundUp)
-            .vectorize(xi)
-            .unroll(yi)
-            .unroll(c);
-        corrected.compute_at(curved, x)
-            .reorder(c, x, y)
-            .vectorize(x)
-            .unroll(c);
-
-        demosaiced->intermed_compute_at.set({processed, yi});
-        demosaiced->intermed_store_at.set({processed, yo});
-        demosaiced->output_compute_at.set({curved, x});
-
-        if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
-            processed.hexagon();
-            denoised.align_storage(x, vec);
-            deinterleaved.align_storage(x, vec);
-            corrected.align_storage(x, vec);
-        }
-
-        // We can generate slightly better code if we know the splits divide the extent.
-        processed
-            .bound(c, 0, 3)
-            .bound(x, 0, ((out_width)/(2*vec))*(2*vec))
-            .bound(y, 0, (out_height/strip_size)*strip_size);
+        schedule_camera_pipe(get_target(), processed, processed.width(), processed.height(),
+                             input, denoised, deinterleaved, *demosaiced,
+                             corrected, curved, false);
 
         /* Optional tags to specify layout for HalideTraceViz */
         {
@@ -540,6 +582,75 @@ void CameraPipe::generate() {
     }
 };
 
+// The camera pipe above, in fixed point throughout, for processing a
+// stream of frames. The color matrix, tone curve and sharpening
+// strength, which the pipe above computes from its float parameters
+// on every call, are computed once by the caller instead. With
+// streaming=true, each call computes a strip of rows of the output,
+// reading only the rows of the input that strip depends on, so that a
+// frame can be processed as its rows arrive from the sensor.
+class CameraPipeFixed : public Halide::Generator<CameraPipeFixed> {
+public:
+    GeneratorParam<bool> streaming{"streaming", false};
+
+    Input<Buffer<uint16_t>> input{"input", 2};
+    // A 4x3 color matrix in Q8.8 fixed point.
+    Input<Buffer<int16_t>> matrix{"matrix", 2};
+    // The tone curve, with an entry for each raw value in [0, 1024).
+    Input<Buffer<uint8_t>> curve{"curve", 1};
+    // The sharpening strength in 2.5 fixed point.
+    Input<uint8_t> sharpen_strength_x32{"sharpen_strength_x32"};
+
+    Output<Buffer<uint8_t>> processed{"processed", 3};
+
+    void generate() {
+        Func shifted;
+        shifted(x, y) = cast<int16_t>(input(x+16, y+12));
+
+        Func denoised = hot_pixel_suppression(shifted);
+
+        Func deinterleaved = deinterleave(denoised);
+
+        auto demosaiced = create<Demosaic>();
+        demosaiced->apply(deinterleaved);
+
+        Func corrected = apply_color_matrix(demosaiced->output, matrix);
+
+        // On HVX, sample every 8th entry of the curve, as above.
+        Func lut("lut");
+        int lut_resample = 1;
+        if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
+            lut_resample = 8;
+            lut(x) = curve(min(x * lut_resample, 1023));
+            lut.compute_root();
+        } else {
+            lut(x) = curve(x);
+        }
+        Func curved = apply_lut(corrected, lut, lut_resample);
+
+        Func strength("strength");
+        strength() = sharpen_strength_x32;
+
+        processed(x, y, c) = unsharp_mask(curved, strength)(x, y, c);
+
+        matrix.dim(0).set_bounds(0, 4).dim(1).set_bounds(0, 3);
+        curve.dim(0).set_bounds(0, 1024);
+
+        if (streaming) {
+            // Each strip must start on an even row, and have an even
+            // number of rows, to line up with the Bayer pattern.
+            processed.dim(1)
+                .set_min((processed.dim(1).min() / 2) * 2)
+                .set_extent((processed.dim(1).extent() / 2) * 2);
+        }
+
+        schedule_camera_pipe(get_target(), processed, processed.width(), processed.height(),
+                             input, denoised, deinterleaved, *demosaiced,
+                             corrected, curved, streaming);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(CameraPipe, camera_pipe)
+HALIDE_REGISTER_GENERATOR(CameraPipeFixed, camera_pipe_fixed)
@@ -64,22 +64,28 @@ int main(int argc, char **argv) {
     int blackLevel = 25;
     int whiteLevel = 1023;
 
-    double best;
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing_iterations;
 
-    best = benchmark(timing_iterations, 1, [&]() {
+    BenchmarkResult best;
+
+    config.name = "camera_pipe_manual";
+    best = benchmark([&]() {
         camera_pipe(input, matrix_3200, matrix_7000,
                     color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
                     output);
-    });
-    fprintf(stderr, "Halide (manual):\t%gus\n", best * 1e6);
+    }, config);
+    fprintf(stderr, "Halide (manual):\t%gus\n", best.wall_time * 1e6);
 
     #ifndef NO_AUTO_SCHEDULE
-    best = benchmark(timing_iterations, 1, [&]() {
+    config.name = "camera_pipe_auto_schedule";
+    best = benchmark([&]() {
         camera_pipe_auto_schedule(input, matrix_3200, matrix_7000,
                                   color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
             output);
-    });
-    fprintf(stderr, "Halide (auto):\t%gus\n", best * 1e6);
+    }, config);
+    fprintf(stderr, "Halide (auto):\t%gus\n", best.wall_time * 1e6);
     #endif
 
     fprintf(stderr, "output: %s\n", argv[7]);
@@ -0,0 +1,169 @@
+#include "halide_benchmark.h"
+
+#include "camera_pipe.h"
+#include "camera_pipe_fixed.h"
+#include "camera_pipe_fixed_streaming.h"
+
+#include "HalideBuffer.h"
+#include "halide_image_io.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+// The number of rows of the output computed by each call to the
+// streaming pipeline.
+const int strip_size = 32;
+
+int main(int argc, char **argv) {
+    if (argc < 8) {
+        printf("Usage: ./process_streaming raw.png color_temp gamma contrast sharpen timing_iterations output.png\n"
+               "e.g. ./process_streaming raw.png 3200 2 50 5 3 output.png");
+        return 0;
+    }
+
+    fprintf(stderr, "input: %s\n", argv[1]);
+    Buffer<uint16_t> input = load_and_convert_image(argv[1]);
+    fprintf(stderr, "       %d %d\n", input.width(), input.height());
+    Buffer<uint8_t> output(((input.width() - 32)/32)*32, ((input.height() - 24)/32)*32, 3);
+    Buffer<uint8_t> streamed(output.width(), output.height(), 3);
+    Buffer<uint8_t> reference(output.width(), output.height(), 3);
+
+    // These color matrices are for the sensor in the Nokia N900 and are
+    // taken from the FCam source.
+    float _matrix_3200[][4] = {{ 1.6697f, -0.2693f, -0.4004f, -42.4346f},
+                                {-0.3576f,  1.0615f,  1.5949f, -37.1158f},
+                                {-0.2175f, -1.8751f,  6.9640f, -26.6970f}};
+
+    float _matrix_7000[][4] = {{ 2.2997f, -0.4478f,  0.1706f, -39.0923f},
+                                {-0.3826f,  1.5906f, -0.2080f, -25.4311f},
+                                {-0.0888f, -0.7344f,  2.2832f, -20.0826f}};
+    Buffer<float> matrix_3200(4, 3), matrix_7000(4, 3);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            matrix_3200(j, i) = _matrix_3200[i][j];
+            matrix_7000(j, i) = _matrix_7000[i][j];
+        }
+    }
+
+    float color_temp = (float) atof(argv[2]);
+    float gamma = (float) atof(argv[3]);
+    float contrast = (float) atof(argv[4]);
+    float sharpen = (float) atof(argv[5]);
+    int timing_iterations = atoi(argv[6]);
+    int blackLevel = 25;
+    int whiteLevel = 1023;
+
+    // Compute the inputs of the fixed-point pipe once, the same way
+    // camera_pipe does on every call. The color matrix is interpolated
+    // between the two calibrated matrices using inverse kelvin.
+    Buffer<int16_t> matrix(4, 3);
+    float alpha = (1.0f/color_temp - 1.0f/3200) / (1.0f/7000 - 1.0f/3200);
+    matrix.for_each_element([&](int x, int y) {
+        float val = matrix_3200(x, y) * alpha + matrix_7000(x, y) * (1 - alpha);
+        matrix(x, y) = (int16_t)(val * 256.0f);
+    });
+
+    // The tone curve: gamma correction followed by a piecewise
+    // quadratic contrast curve.
+    Buffer<uint8_t> curve(1024);
+    float b = 2.0f - powf(2.0f, contrast/100.0f);
+    float a = 2.0f - 2.0f*b;
+    for (int x = 0; x < 1024; x++) {
+        float xf = std::min(std::max((float)(x - blackLevel) / (whiteLevel - blackLevel), 0.0f), 1.0f);
+        float g = powf(xf, 1.0f/gamma);
+        float z = g > 0.5f ?
+            1.0f - (a*(1.0f-g)*(1.0f-g) + b*(1.0f-g)) :
+            a*g*g + b*g;
+        uint8_t val = (uint8_t)std::min(std::max(z*255.0f+0.5f, 0.0f), 255.0f);
+        curve(x) = x <= blackLevel ? 0 : (x > whiteLevel ? 255 : val);
+    }
+
+    uint8_t sharpen_strength_x32 = (uint8_t)std::min(std::max(sharpen * 32, 0.0f), 255.0f);
+
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing_iterations;
+
+    BenchmarkResult best;
+
+    config.name = "camera_pipe_fixed";
+    best = benchmark([&]() {
+        camera_pipe_fixed(input, matrix, curve, sharpen_strength_x32, output);
+    }, config);
+    fprintf(stderr, "Halide (fixed point):\t%gus\n", best.wall_time * 1e6);
+
+    // Find the rows of the input each strip of the output depends on,
+    // with a bounds query.
+    int strips = output.height() / strip_size;
+    std::vector<int> rows_needed(strips);
+    for (int s = 0; s < strips; s++) {
+        Buffer<uint16_t> query(nullptr, 0, 0);
+        Buffer<uint8_t> strip = streamed.cropped(1, s * strip_size, strip_size);
+        if (camera_pipe_fixed_streaming(query, matrix, curve, sharpen_strength_x32, strip) != 0) {
+            fprintf(stderr, "Bounds query for strip %d failed\n", s);
+            return -1;
+        }
+        rows_needed[s] = query.dim(1).max() + 1;
+        if (query.dim(1).min() < 0 || rows_needed[s] > input.height()) {
+            fprintf(stderr, "Strip %d needs input rows [%d, %d], outside of the input\n",
+                    s, query.dim(1).min(), query.dim(1).max());
+            return -1;
+        }
+    }
+
+    // Simulate the rows of the input arriving from the sensor one at a
+    // time, and compute each strip as soon as the rows it needs have
+    // arrived. Only the rows that have arrived are passed in.
+    config.name = "camera_pipe_fixed_streaming";
+    best = benchmark([&]() {
+        int s = 0;
+        for (int row = 1; row <= input.height() && s < strips; row++) {
+            while (s < strips && rows_needed[s] <= row) {
+                camera_pipe_fixed_streaming(input.cropped(1, 0, row), matrix, curve, sharpen_strength_x32,
+                                            streamed.cropped(1, s * strip_size, strip_size));
+                s++;
+            }
+        }
+    }, config);
+    fprintf(stderr, "Halide (streaming):\t%gus for %d strips of %d rows\n",
+            best.wall_time * 1e6, strips, strip_size);
+    fprintf(stderr, "The first strip is ready after %d of %d rows of the input\n",
+            rows_needed[0], input.height());
+
+    // Computing the frame in strips must not change the result.
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < output.height(); y++) {
+            for (int x = 0; x < output.width(); x++) {
+                if (streamed(x, y, c) != output(x, y, c)) {
+                    fprintf(stderr, "streamed(%d, %d, %d) = %d instead of %d\n",
+                            x, y, c, streamed(x, y, c), output(x, y, c));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The curve and matrix are rounded the same way as in the float
+    // pipe, but the float math there may round differently.
+    camera_pipe(input, matrix_3200, matrix_7000,
+                color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                reference);
+    int max_diff = 0;
+    reference.for_each_element([&](int x, int y, int c) {
+        max_diff = std::max(max_diff, std::abs(reference(x, y, c) - output(x, y, c)));
+    });
+    fprintf(stderr, "Maximum difference from camera_pipe: %d\n", max_diff);
+
+    fprintf(stderr, "output: %s\n", argv[7]);
+    convert_and_save_image(output, argv[7]);
+    fprintf(stderr, "        %d %d\n", output.width(), output.height());
+
+    return 0;
+}
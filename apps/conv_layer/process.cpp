@@ -45,17 +45,23 @@ int main(int argc, char **argv) {
 
     // Timing code
 
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = 10;
+
     // Manually-tuned version
-    double min_t_manual = benchmark(10, 10, [&]() {
+    config.name = "conv_layer_manual";
+    BenchmarkResult manual = benchmark([&]() {
         conv_layer(input, filter, bias, output);
-    });
-    printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
+    }, config);
+    printf("Manually-tuned time: %gms\n", manual.wall_time * 1e3);
 
     // Auto-scheduled version
-    double min_t_auto = benchmark(10, 10, [&]() {
+    config.name = "conv_layer_auto_schedule";
+    BenchmarkResult automatic = benchmark([&]() {
         conv_layer_auto_schedule(input, filter, bias, output);
-    });
-    printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+    }, config);
+    printf("Auto-scheduled time: %gms\n", automatic.wall_time * 1e3);
 
     return 0;
 }
@@ -4,6 +4,7 @@
 
 #include "fft.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -263,6 +264,47 @@ ComplexFunc dft1d_c2c(ComplexFunc x, int N, int sign,
     }
 }
 
+// Radices larger than this are computed with Bluestein's algorithm
+// rather than a direct DFT.
+const int kMaxDirectRadix = 64;
+
+// Compute a factorization of N suitable for use in the FFT.
+vector<int> radix_factor(int N) {
+    // Some special cases to optimize.
+    switch (N) {
+    case 16: return { 4, 4 };
+    case 32: return { 8, 4 };
+    case 64: return { 8, 8 };
+    case 128: return { 8, 4, 4 };
+    case 256: return { 8, 8, 4 };
+    }
+
+    // Factor N into factors found in the 'radices' set.
+    static const int radices[] = { 8, 6, 4, 2 };
+    vector<int> R;
+    for (int r : radices) {
+        while (N % r == 0) {
+            R.push_back(r);
+            N /= r;
+        }
+    }
+
+    // Factor what's left into primes. Small primes use a direct DFT,
+    // and sizes with a prime factor larger than kMaxDirectRadix use
+    // Bluestein's algorithm instead (see fft_dim1).
+    for (int p = 3; p * p <= N; p += 2) {
+        while (N % p == 0) {
+            R.push_back(p);
+            N /= p;
+        }
+    }
+    if (N != 1 || R.empty()) {
+        R.push_back(N);
+    }
+
+    return R;
+}
+
 // Map to remember previously computed twiddle factors.
 typedef std::map<int, ComplexFunc> TwiddleFactorSet;
 
@@ -286,6 +328,15 @@ ComplexFunc twiddle_factors(int N, Expr gain, int sign,
     return W;
 }
 
+ComplexFunc fft_dim1_bluestein(ComplexFunc x,
+                               int N,
+                               int sign,
+                               int extent_0,
+                               Expr gain,
+                               bool parallel,
+                               const string& prefix,
+                               const Target& target);
+
 // Compute the N point DFT of dimension 1 (columns) of x using
 // radix R.
 ComplexFunc fft_dim1(ComplexFunc x,
@@ -299,6 +350,10 @@ ComplexFunc fft_dim1(ComplexFunc x,
                      TwiddleFactorSet* twiddle_cache) {
     int N = product(NR);
 
+    if (*std::max_element(NR.begin(), NR.end()) > kMaxDirectRadix) {
+        return fft_dim1_bluestein(x, N, sign, extent_0, gain, parallel, prefix, target);
+    }
+
     vector<Var> args = x.args();
     Var n0(args[0]), n1(args[1]);
     args.erase(args.begin());
@@ -413,6 +468,90 @@ ComplexFunc fft_dim1(ComplexFunc x,
     return x;
 }
 
+// Compute the N point DFT of dimension 1 of x using Bluestein's
+// algorithm. Using nk = (n^2 + k^2 - (k - n)^2) / 2, the DFT becomes
+//
+//   X_k = w_k sum[ (x_n w_n) (w_(k-n))* ],  w_n = e^(sign*pi*i*n^2/N)
+//
+// which is a convolution. We compute it as a circular convolution of
+// length M >= 2N - 1 with power of two FFTs, so this is O(N log N) for
+// any N, including large primes.
+ComplexFunc fft_dim1_bluestein(ComplexFunc x,
+                               int N,
+                               int sign,
+                               int extent_0,
+                               Expr gain,
+                               bool parallel,
+                               const string& prefix,
+                               const Target& target) {
+    int M = 1;
+    while (M < 2 * N - 1) {
+        M *= 2;
+    }
+    vector<int> RM = radix_factor(M);
+
+    vector<Var> args = x.args();
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    string stage_prefix = prefix + "bluestein_" + n1.name() + "_";
+
+    // The chirp w_n. n^2 is reduced modulo 2N (the period of w) in
+    // integers to keep the angle accurate.
+    Var n("n");
+    ComplexFunc w(stage_prefix + "w");
+    Expr n_sq = cast<int>((cast<int64_t>(n) * n) % (2 * N));
+    w(n) = expj((sign * kPi * n_sq) / N);
+    w.compute_root();
+
+    // The convolution kernel (w_m)*, wrapped around to negative m. Its
+    // DFT doesn't depend on the input, so compute it once. The
+    // normalization of the inverse DFT below is folded in here.
+    ComplexFunc b(stage_prefix + "b");
+    Expr m_pos = clamp(n1, 0, N - 1);
+    Expr m_neg = clamp(M - n1, 0, N - 1);
+    b(n0, n1) = select(n1 < N, conj(w(m_pos)),
+                       M - n1 < N, conj(w(m_neg)),
+                       ComplexExpr(0.0f, 0.0f));
+    TwiddleFactorSet b_twiddles;
+    ComplexFunc B = fft_dim1(b, RM, -1, 1, 1.0f / M, false, stage_prefix + "B_", target, &b_twiddles);
+    B.compute_root();
+
+    // Weight the input by the chirp, and zero pad it to M.
+    ComplexFunc a(stage_prefix + "a");
+    a(A({n0, n1}, args)) = select(n1 < N, x(A({n0, m_pos}, args)) * w(m_pos), ComplexExpr(0.0f, 0.0f));
+
+    // Convolve.
+    TwiddleFactorSet fwd_twiddles, inv_twiddles;
+    ComplexFunc a_dft = fft_dim1(a, RM, -1, extent_0, 1.0f, false, stage_prefix + "fwd_", target, &fwd_twiddles);
+    ComplexFunc ab_dft(stage_prefix + "ab_dft");
+    ab_dft(A({n0, n1}, args)) = a_dft(A({n0, n1}, args)) * B(0, n1);
+    ComplexFunc ab = fft_dim1(ab_dft, RM, 1, extent_0, 1.0f, false, stage_prefix + "inv_", target, &inv_twiddles);
+
+    // Weight the result by the chirp again. Like the radix stages, the
+    // pure definition is undefined, and the update is scheduled in
+    // vectorized groups of DFTs.
+    ComplexFunc X(stage_prefix + "X");
+    X(A({n0, n1}, args)) = undef_z(x.output_types()[0]);
+    RDom k(0, N);
+    X(A({n0, k}, args)) = ab(A({n0, k}, args)) * w(k) * gain;
+    X.bound(n1, 0, N);
+
+    int vector_width = std::min(target.natural_vector_size(Float(32)), extent_0);
+    X.update()
+        .split(n0, group, n0, vector_width)
+        .reorder(n0, k, group)
+        .vectorize(n0);
+    if (parallel) {
+        X.update().parallel(group);
+    }
+    a_dft.compute_at(X, group);
+    ab.compute_at(X, group);
+
+    return X;
+}
+
 // transpose the first two dimensions of x.
 template <typename FuncType>
 FuncType transpose(FuncType f) {
@@ -1003,39 +1142,6 @@ Func fft2d_c2r(ComplexFunc c,
     return unzipped;
 }
 
-namespace {
-
-// Compute a factorization of N suitable for use in the FFT.
-vector<int> radix_factor(int N) {
-    // Some special cases to optimize.
-    switch (N) {
-    case 16: return { 4, 4 };
-    case 32: return { 8, 4 };
-    case 64: return { 8, 8 };
-    case 128: return { 8, 4, 4 };
-    case 256: return { 8, 8, 4 };
-    }
-
-    // Factor N into factors found in the 'radices' set.
-    static const int radices[] = { 8, 6, 4, 2 };
-    vector<int> R;
-    for (int r : radices) {
-        while (N % r == 0) {
-            R.push_back(r);
-            N /= r;
-        }
-    }
-
-    // If there are still factors left over, just include them as a radix.
-    if (N != 1 || R.empty()) {
-        R.push_back(N);
-    }
-
-    return R;
-}
-
-}  // namespace
-
 ComplexFunc fft2d_c2c(ComplexFunc x,
                       int N0, int N1,
                       int sign,
@@ -38,6 +38,12 @@ struct Fft2dDesc {
     std::string name = "";
 };
 
+// N0 and N1 may be any size. They are factored into radices of 2, 4, 6, 8 and
+// other small primes, and any prime factor larger than 64 is handled with
+// Bluestein's algorithm, which computes the DFT with power of two FFTs of at
+// least twice the size. Dimensions after the first 2 are a batch of independent
+// transforms; schedule the result to parallelize over them.
+
 // Compute the N0 x N1 2D complex DFT of the first 2 dimensions of a complex
 // valued function x. The first 2 dimensions of x should be defined on at least
 // [0, N0) and [0, N1) for dimensions 0, 1, respectively. sign = -1 indicates a
@@ -54,14 +60,14 @@ ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
 // function r. The first 2 dimensions of r should be defined on at least [0, N0)
 // and [0, N1) for dimensions 0, 1, respectively. Note that the transform domain
 // has dimensions N0 x N1 / 2 + 1 due to the conjugate symmetry of real DFTs.
-// There is no normalization.
+// N0 and N1 must be even. There is no normalization.
 ComplexFunc fft2d_r2c(Halide::Func r, int N0, int N1,
                       const Halide::Target& target,
                       const Fft2dDesc& desc = Fft2dDesc());
 
 // Compute the real valued N0 x N1 2D inverse DFT of dimensions 0, 1 of c. Note
 // that the transform domain has dimensions N0 x N1 / 2 + 1 due to the conjugate
-// symmetry of real DFTs. There is no normalization.
+// symmetry of real DFTs. N0 and N1 must be even. There is no normalization.
 Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target& target,
                        const Fft2dDesc& desc = Fft2dDesc());
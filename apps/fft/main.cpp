@@ -91,8 +91,11 @@ int main(int argc, char **argv) {
         filtered_c2c(x, y) = re(dft_out(x, y));
     }
 
+    // The real transforms need even sizes.
+    const bool real_dft = W % 2 == 0 && H % 2 == 0;
+
     Func filtered_r2c;
-    {
+    if (real_dft) {
         // Compute the DFT of the input and the kernel.
         ComplexFunc dft_in = fft2d_r2c(make_real(in), W, H, target, fwd_desc);
         ComplexFunc dft_kernel = fft2d_r2c(make_real(kernel), W, H, target, fwd_desc);
@@ -108,7 +111,14 @@ int main(int argc, char **argv) {
     }
 
     Buffer<float> result_c2c = filtered_c2c.realize(W, H, target);
-    Buffer<float> result_r2c = filtered_r2c.realize(W, H, target);
+    Buffer<float> result_r2c;
+    if (real_dft) {
+        result_r2c = filtered_r2c.realize(W, H, target);
+    }
+
+    // Sizes with large prime factors go through Bluestein's algorithm,
+    // which does several times more floating point work.
+    const float tolerance = W * H <= 64 * 64 ? 1e-6f : 1e-5f;
 
     for (int y = 0; y < H; y++) {
         for (int x = 0; x < W; x++) {
@@ -119,11 +129,11 @@ int main(int argc, char **argv) {
                 }
             }
             correct /= box*box;
-            if (fabs(result_c2c(x, y) - correct) > 1e-6f) {
+            if (fabs(result_c2c(x, y) - correct) > tolerance) {
                 printf("result_c2c(%d, %d) = %f instead of %f\n", x, y, result_c2c(x, y), correct);
                 return -1;
             }
-            if (fabs(result_r2c(x, y) - correct) > 1e-6f) {
+            if (real_dft && fabs(result_r2c(x, y) - correct) > tolerance) {
                 printf("result_r2c(%d, %d) = %f instead of %f\n", x, y, result_r2c(x, y), correct);
                 return -1;
             }
@@ -180,6 +190,14 @@ int main(int argc, char **argv) {
            5*W*H*(log2(W) + log2(H))/fftw_t,
            fftw_t / halide_t);
 
+    if (!real_dft) {
+        printf("Skipping r2c and c2r, which need even sizes\n");
+#ifdef WITH_FFTW
+        fftwf_destroy_plan(c2c_plan);
+#endif
+        return 0;
+    }
+
     Func r2c_in;
     // All reps read from the same input. See notes on c2c_in.
     r2c_in(x, y, rep) = re_in(x, y);
@@ -0,0 +1,67 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+class Histogram : public Generator<Histogram> {
+public:
+    // Takes an 8 bit image; one channel.
+    Input<Buffer<uint8_t>> input{"input", 2};
+    // Outputs a 256 bucket histogram.
+    Output<Buffer<int32_t>> output{"output", 1};
+
+    // The buckets are shared by every pixel, so there is no parallel
+    // schedule.
+    GeneratorParam<bool> use_parallel_sched{"use_parallel_sched", true};
+    GeneratorParam<bool> use_prefetch_sched{"use_prefetch_sched", true};
+
+    void generate() {
+        r = RDom(0, input.dim(0).extent(), 0, input.dim(1).extent());
+        hist(x) = 0;
+        hist(cast<int>(input(r.x, r.y))) += 1;
+
+        output(x) = hist(x);
+    }
+
+    void schedule() {
+        input.dim(0).set_min(0);
+        input.dim(1).set_min(0);
+
+        output.dim(0).set_bounds(0, 256);
+        output.bound(x, 0, 256);
+
+        if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
+            const int vector_size = get_target().has_feature(Target::HVX_128) ? 128 : 64;
+            const int lanes = vector_size / 4;
+            Expr input_stride = input.dim(1).stride();
+            input.dim(1).set_stride((input_stride/vector_size) * vector_size);
+
+            output
+                .hexagon()
+                .vectorize(x, lanes);
+            hist
+                .compute_at(output, Var::outermost())
+                .vectorize(x, lanes);
+            if (get_target().has_feature(Target::HVX_v65)) {
+                // Accumulate the buckets with vscatter-accumulate,
+                // which needs the histogram to be in VTCM. It
+                // handles lanes that hit the same bucket.
+                hist.store_in(MemoryType::VTCM);
+                hist
+                    .update()
+                    .allow_race_conditions()
+                    .vectorize(r.x, lanes);
+            }
+            if (use_prefetch_sched) {
+                hist.update().prefetch(input, r.y, 2);
+            }
+        } else {
+            hist.compute_root();
+        }
+    }
+private:
+    Var x{"x"};
+    Func hist{"hist"};
+    RDom r;
+};
+
+HALIDE_REGISTER_GENERATOR(Histogram, histogram)
@@ -27,6 +27,10 @@
 #include "conv3x3a32.h"
 #endif
 
+#ifdef HISTOGRAM
+#include "histogram.h"
+#endif
+
 template <typename T>
 T clamp(T val, T min, T max) {
     if (val < min)
@@ -485,4 +489,66 @@ public:
     }
 };
 
+class HistogramDescriptor : public PipelineDescriptorBase {
+    Halide::Runtime::Buffer<uint8_t> u8_in;
+    Halide::Runtime::Buffer<int32_t> i32_out;
+
+public:
+    HistogramDescriptor(int W, int H) : u8_in(nullptr, W, H),
+                                        i32_out(nullptr, 256) {}
+
+    void init() {
+#ifdef HALIDE_RUNTIME_HEXAGON
+        u8_in.device_malloc(halide_hexagon_device_interface());
+        i32_out.device_malloc(halide_hexagon_device_interface());
+#else
+        u8_in.allocate();
+        i32_out.allocate();
+#endif
+
+        u8_in.for_each_value([&](uint8_t &x) {
+            x = static_cast<uint8_t>(rand());
+        });
+        i32_out.fill(0);
+    }
+
+    const char *name() { return "histogram"; };
+
+    bool defined() {
+#ifdef HISTOGRAM
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool verify(const int W, const int H) {
+        int32_t reference[256] = {0};
+        u8_in.for_each_value([&](uint8_t x) {
+            reference[x]++;
+        });
+
+        i32_out.copy_to_host();
+        i32_out.for_each_element([&](int x) {
+            if (i32_out(x) != reference[x]) {
+                printf("Histogram: Mismatch at %d : %d != %d\n", x, i32_out(x), reference[x]);
+                abort();
+            }
+        });
+        return true;
+    }
+
+    int run() {
+#ifdef HISTOGRAM
+        return histogram(u8_in, i32_out);
+#endif
+        return 1;
+    }
+
+    void finalize() {
+        u8_in.device_free();
+        i32_out.device_free();
+    }
+};
+
 #endif
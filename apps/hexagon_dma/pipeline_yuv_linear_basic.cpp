@@ -121,20 +121,20 @@ public:
                 output_uv
                     .tile(x, y, tx, ty, x, y, tile_width, tile_height, TailStrategy::RoundUp);
 
+                // Async copies are double-buffered automatically, so
+                // the DMA for the next tile overlaps this tile's work.
                 input_y_copy
                     .copy_to_host()
                     .async()
                     .compute_at(output_y, tx)
-                    .store_at(output_y, ty)
-                    .fold_storage(x, tile_width * 2);
+                    .store_at(output_y, ty);
 
                 input_uv_copy
                     .copy_to_host()
                     .async()
                     .compute_at(output_uv, tx)
                     .store_at(output_uv, ty)
-                    .reorder_storage(c, x, y)
-                    .fold_storage(x, tile_width * 2);
+                    .reorder_storage(c, x, y);
             break;
             case Schedule::Split: {
                 Var yo, yi;
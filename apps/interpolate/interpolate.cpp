@@ -15,7 +15,7 @@ using std::vector;
 
 int main(int argc, char **argv) {
     if (argc < 3) {
-        std::cerr << "Usage:\n\t./interpolate in.png out.png\n" << std::endl;
+        std::cerr << "Usage:\n\t./interpolate in.png out.png [schedule]\n" << std::endl;
         return 1;
     }
 
@@ -82,6 +82,9 @@ int main(int argc, char **argv) {
     } else {
         sched = 2;
     }
+    if (argc > 3) {
+        sched = atoi(argv[3]);
+    }
 
     switch (sched) {
     case 0:
@@ -199,6 +202,27 @@ int main(int argc, char **argv) {
 
         break;
     }
+    case 5:
+    {
+        Var xi, yi;
+        std::cout << "Pyramid library schedule." << std::endl;
+        // The coarse levels run serially, so only the large levels
+        // pay for forking and joining the thread pool.
+        Pyramid::schedule_levels(std::vector<Func>(downsampled, downsampled + levels), target);
+        Pyramid::schedule_levels(std::vector<Func>(interpolated, interpolated + levels), target);
+        normalize
+            .reorder(c, x, y)
+            .bound(c, 0, 3)
+            .unroll(c)
+            .tile(x, y, xi, yi, 2, 2)
+            .unroll(xi)
+            .unroll(yi)
+            .parallel(y, 8)
+            .vectorize(x, 8)
+            .bound(x, 0, input.width())
+            .bound(y, 0, input.height());
+        break;
+    }
     default:
         assert(0 && "No schedule with this number.");
     }
@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB, gemm_batch
 //
 
 #include <iomanip>
@@ -97,6 +97,8 @@ struct BenchmarksBase {
             this->bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             this->bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batch") {
+            this->bench_gemm_batch(size);
         }
     }
 
@@ -112,6 +114,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) =0;
     virtual void bench_gemm_transB(int N) =0;
     virtual void bench_gemm_transAB(int N) =0;
+    virtual void bench_gemm_batch(int N) =0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -153,6 +156,11 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transAB, "s", cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N,
                                                alpha, &(A[0]), N, &(B[0]), N,
                                                beta, &(C[0]), N))
+
+    L3BatchBenchmark(gemm_batch, "s", for (int i = 0; i < L3_BATCH_SIZE; i++) {
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N,
+                        alpha, A[i], N, B[i], N, beta, C[i], N);
+        })
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -194,6 +202,11 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transAB, "d", cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N,
                                                alpha, &(A[0]), N, &(B[0]), N,
                                                beta, &(C[0]), N))
+
+    L3BatchBenchmark(gemm_batch, "d", for (int i = 0; i < L3_BATCH_SIZE; i++) {
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N,
+                        alpha, A[i], N, B[i], N, beta, C[i], N);
+        })
 };
 
 int main(int argc, char* argv[]) {
@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB, gemm_batch
 //
 
 #include <iomanip>
@@ -80,6 +80,8 @@ struct BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batch") {
+            bench_gemm_batch(size);
         }
     }
 
@@ -95,6 +97,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) =0;
     virtual void bench_gemm_transB(int N) =0;
     virtual void bench_gemm_transAB(int N) =0;
+    virtual void bench_gemm_batch(int N) =0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -130,6 +133,10 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
 
     L3Benchmark(gemm_transAB, "s", halide_sgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    L3BatchBenchmark(gemm_batch, "s", hblas_sgemm_batch(HblasColMajor, HblasNoTrans, HblasNoTrans,
+                                                       N, N, N, alpha, A.data(), N, B.data(), N,
+                                                       beta, C.data(), N, L3_BATCH_SIZE))
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -165,6 +172,10 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
 
     L3Benchmark(gemm_transAB, "d", halide_dgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    L3BatchBenchmark(gemm_batch, "d", hblas_dgemm_batch(HblasColMajor, HblasNoTrans, HblasNoTrans,
+                                                       N, N, N, alpha, A.data(), N, B.data(), N,
+                                                       beta, C.data(), N, L3_BATCH_SIZE))
 };
 
 int main(int argc, char* argv[]) {
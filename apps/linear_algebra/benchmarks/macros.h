@@ -83,3 +83,33 @@ inline void set_math_flags() {
                   << std::setw(20) << L3GFLOPS(N)                       \
                   << std::endl;                                         \
     }
+
+// Batched benchmarks run this many independent N x N gemms per call.
+#define L3_BATCH_SIZE 64
+#define L3BatchGFLOPS(N) L3_BATCH_SIZE * (3.0 + N) * N * N * 1e-3 / elapsed
+#define L3BatchBenchmark(benchmark, type, code)                         \
+    virtual void bench_##benchmark(int N) override {                    \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        std::vector<Matrix> As, Bs, Cs;                                 \
+        std::vector<Scalar *> A, B, C;                                  \
+        for (int i = 0; i < L3_BATCH_SIZE; i++) {                       \
+            As.push_back(random_matrix(N));                             \
+            Bs.push_back(random_matrix(N));                             \
+            Cs.push_back(random_matrix(N));                             \
+        }                                                               \
+        for (int i = 0; i < L3_BATCH_SIZE; i++) {                       \
+            A.push_back(As[i].data());                                  \
+            B.push_back(Bs[i].data());                                  \
+            C.push_back(Cs[i].data());                                  \
+        }                                                               \
+                                                                        \
+        time_it(code)                                                   \
+                                                                        \
+        std::cout << std::setw(8) << name                               \
+                  << std::setw(15) << type << #benchmark                \
+                  << std::setw(8) << std::to_string(N)                  \
+                  << std::setw(20) << std::to_string(elapsed)           \
+                  << std::setw(20) << L3BatchGFLOPS(N)                  \
+                  << std::endl;                                         \
+    }
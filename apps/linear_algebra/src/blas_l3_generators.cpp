@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <vector>
 #include "Halide.h"
+#include "gemm_micro_kernel.h"
 
 using namespace Halide;
 
@@ -37,8 +39,14 @@ class GEMMGenerator :
         const Expr num_cols = B_.height();
         const Expr sum_size = A_.height();
 
+        // The micro-kernel computes an s x nr block of the result in
+        // registers. Tiles of the result hold an even number of
+        // micro-kernel blocks along each dimension.
         const int vec = natural_vector_size(a_.type());
-        const int s = vec * 2;
+        const gemm::MicroKernel kernel = gemm::choose_micro_kernel(get_target());
+        const int s = vec * kernel.vectors;
+        const int nr = kernel.columns;
+        const int blocks = 2 * std::max(1, s / nr);
 
         Input<Buffer<T>> *A_in = &A_;
         Input<Buffer<T>> *B_in = &B_;
@@ -66,17 +74,23 @@ class GEMMGenerator :
 
         A(i, j) = As(i % s, j, i / s);
 
-        Btmp(i, j) = (*B_in)(i, j);
+        Btmp(i, j) = BoundaryConditions::constant_exterior(*B_in, cast<T>(0))(i, j);
         if (transpose_B) {
             B(i, j) = Btmp(j, i);
         } else {
             B(i, j) = Btmp(i, j);
         }
 
+        // Pack B into panels of nr columns, so the micro-kernel reads
+        // the values it broadcasts from one stream.
+        Func Bp = gemm::pack_panels(B, nr, "Bp");
+        Func Bpanel("Bpanel");
+        Bpanel(i, j) = Bp(j % nr, i, j / nr);
+
         Var k("k");
         Func prod;
         // Express all the products we need to do a matrix multiply as a 3D Func.
-        prod(k, i, j) = A(i, k) * B(k, j);
+        prod(k, i, j) = A(i, k) * Bpanel(k, j);
 
         // Reduce the products along k.
         Func AB("AB");
@@ -94,16 +108,17 @@ class GEMMGenerator :
         // Do the part that makes it a 'general' matrix multiply.
         result_(i, j) = (a_ * ABt(i, j) + b_ * C_(i, j));
 
-        result_.tile(i, j, ti[1], tj[1], i, j, 2*s, 2*s, TailStrategy::GuardWithIf);
         if (transpose_AB) {
             result_
-                .tile(i, j, ii, ji, 4, s)
-                .tile(i, j, ti[0], tj[0], i, j, s/4, 1);
+                .tile(i, j, ti[1], tj[1], i, j, blocks*nr, 2*s, TailStrategy::GuardWithIf)
+                .tile(i, j, ii, ji, nr, s)
+                .tile(i, j, ti[0], tj[0], i, j, blocks/2, 1);
 
         } else {
             result_
-                .tile(i, j, ii, ji, s, 4)
-                .tile(i, j, ti[0], tj[0], i, j, 1, s/4);
+                .tile(i, j, ti[1], tj[1], i, j, 2*s, blocks*nr, TailStrategy::GuardWithIf)
+                .tile(i, j, ii, ji, s, nr)
+                .tile(i, j, ti[0], tj[0], i, j, 1, blocks/2);
         }
 
         // If we have enough work per task, parallelize over these tiles.
@@ -116,6 +131,13 @@ class GEMMGenerator :
             .tile(ti[1], tj[1], ti[2], tj[2], ti[1], tj[1], 2, 2)
             .fuse(tj[2], ti[2], t).parallel(t);
 
+        // Tall or wide matrices don't have enough tiles in the short
+        // dimension for the cases above, but if the reduction is
+        // deep enough there is still plenty of work along the long
+        // one to spread across tasks.
+        result_.specialize((num_rows >= 512 || num_cols >= 512) && sum_size >= 64)
+            .fuse(tj[1], ti[1], t).parallel(t);
+
         result_.rename(tj[0], t);
 
         result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
@@ -128,25 +150,23 @@ class GEMMGenerator :
         Atmp.compute_at(As, io)
             .vectorize(i).unroll(j);
 
-        if (transpose_B) {
-            B.compute_at(result_, t)
-                .tile(i, j, ii, ji, 8, 8)
-                .vectorize(ii).unroll(ji);
-            Btmp.reorder_storage(j, i)
-                .compute_at(B, i)
-                .vectorize(i)
-                .unroll(j);
+        // Pack the panels of B the tile uses. If B is transposed, the
+        // columns of a panel are already adjacent in memory;
+        // otherwise, load along k and interleave the columns.
+        Var pj = Bp.args()[0], pk = Bp.args()[1];
+        Bp.compute_at(result_, t).bound_extent(pj, nr).unroll(pj);
+        if (!transpose_B) {
+            Bp.reorder(pk, pj).vectorize(pk, vec);
         }
 
-
         AB.compute_at(result_, i)
-            .bound_extent(j, 4).unroll(j)
+            .bound_extent(j, nr).unroll(j)
             .bound_extent(i, s).vectorize(i)
             .update()
             .reorder(i, j, rv).unroll(j).unroll(rv, 2).vectorize(i);
         if (transpose_AB) {
             ABt.compute_at(result_, i)
-                .bound_extent(i, 4).unroll(i)
+                .bound_extent(i, nr).unroll(i)
                 .bound_extent(j, s).vectorize(j);
         }
 
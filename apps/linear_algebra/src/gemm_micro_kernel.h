@@ -0,0 +1,56 @@
+#ifndef GEMM_MICRO_KERNEL_H
+#define GEMM_MICRO_KERNEL_H
+
+#include "Halide.h"
+
+namespace gemm {
+
+// The shape of the block of the result a matrix multiply keeps in
+// registers in its innermost loop: 'vectors' native vectors down a
+// column, times 'columns' columns. Each step of the reduction loads
+// 'vectors' vectors of a panel of A, broadcasts 'columns' values of
+// a panel of B, and does vectors * columns fused multiply-adds.
+struct MicroKernel {
+    int vectors;
+    int columns;
+};
+
+// Pick the largest block whose accumulators, plus the vectors of A
+// and a broadcast of B, fit in the vector register file. These are
+// the shapes BLIS and OpenBLAS use for sgemm on each ISA.
+inline MicroKernel choose_micro_kernel(const Halide::Target &t) {
+    using Halide::Target;
+    if (t.arch == Target::X86) {
+        if (t.has_feature(Target::AVX512_Skylake) ||
+            t.has_feature(Target::AVX512_Cannonlake) ||
+            t.has_feature(Target::AVX512_Cascadelake) ||
+            t.has_feature(Target::AVX512_KNL) ||
+            t.has_feature(Target::AVX512)) {
+            // 32 zmm registers: 24 accumulators.
+            return {2, 12};
+        } else if (t.has_feature(Target::AVX)) {
+            // 16 ymm registers: 12 accumulators.
+            return {2, 6};
+        }
+    } else if (t.arch == Target::ARM && t.bits == 64) {
+        // 32 q registers: 24 accumulators.
+        return {2, 12};
+    }
+    // 16 registers: 8 accumulators.
+    return {2, 4};
+}
+
+// Copy B into panels of 'columns' adjacent columns, each stored with
+// the columns innermost, so that the micro-kernel reads the values it
+// broadcasts from one contiguous stream instead of one per column.
+// The result is indexed as panels(j % columns, k, j / columns).
+inline Halide::Func pack_panels(Halide::Func B, int columns, const std::string &name) {
+    Halide::Var jj("jj"), k("k"), jo("jo");
+    Halide::Func panels(name);
+    panels(jj, k, jo) = B(k, jo * columns + jj);
+    return panels;
+}
+
+}  // namespace gemm
+
+#endif
@@ -29,6 +29,46 @@ Buffer<T> init_matrix_buffer(const int M, const int N, T *A, const int lda) {
     return Buffer<T>(A, 2, shape);
 }
 
+// The arguments of a batch of gemms that share everything but the
+// matrices.
+template<typename T>
+struct GemmBatch {
+    bool tA, tB;
+    int M, N, K;
+    T alpha, beta;
+    const T *const *A;
+    const T *const *B;
+    T *const *C;
+    int lda, ldb, ldc;
+    int (*gemm)(bool, bool, T, halide_buffer_t *, halide_buffer_t *, T, halide_buffer_t *);
+};
+
+template<typename T>
+int gemm_batch_task(void *user_context, int i, uint8_t *closure) {
+    const GemmBatch<T> *b = (const GemmBatch<T> *)closure;
+    auto buff_A = init_matrix_buffer(b->tA ? b->K : b->M, b->tA ? b->M : b->K, const_cast<T*>(b->A[i]), b->lda);
+    auto buff_B = init_matrix_buffer(b->tB ? b->N : b->K, b->tB ? b->K : b->N, const_cast<T*>(b->B[i]), b->ldb);
+    auto buff_C = init_matrix_buffer(b->M, b->N, b->C[i], b->ldc);
+    return b->gemm(b->tA, b->tB, b->alpha, buff_A, buff_B, b->beta, buff_C);
+}
+
+// The gemm pipelines only parallelize internally once the result
+// is at least 128x128, so run batches of smaller matrices in
+// parallel across the batch instead.
+template<typename T>
+int run_gemm_batch(const GemmBatch<T> &b, const int batch_count) {
+    if (b.M < 128 || b.N < 128) {
+        return halide_do_par_for(nullptr, gemm_batch_task<T>, 0, batch_count, (uint8_t *)&b);
+    }
+    for (int i = 0; i < batch_count; i++) {
+        int result = gemm_batch_task<T>(nullptr, i, (uint8_t *)&b);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
 }
 
 #ifdef __cplusplus
@@ -279,6 +319,42 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
     assert_no_error(halide_dgemm(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
 }
 
+void hblas_sgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const float alpha, const float *const *A,
+                       const int lda, const float *const *B, const int ldb,
+                       const float beta, float *const *C, const int ldc,
+                       const int batch_count) {
+    GemmBatch<float> b;
+    b.tA = TransA != HblasNoTrans;
+    b.tB = TransB != HblasNoTrans;
+    b.M = M; b.N = N; b.K = K;
+    b.alpha = alpha; b.beta = beta;
+    b.A = A; b.B = B; b.C = C;
+    b.lda = lda; b.ldb = ldb; b.ldc = ldc;
+    b.gemm = halide_sgemm;
+
+    assert_no_error(run_gemm_batch(b, batch_count));
+}
+
+void hblas_dgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const double alpha, const double *const *A,
+                       const int lda, const double *const *B, const int ldb,
+                       const double beta, double *const *C, const int ldc,
+                       const int batch_count) {
+    GemmBatch<double> b;
+    b.tA = TransA != HblasNoTrans;
+    b.tB = TransB != HblasNoTrans;
+    b.M = M; b.N = N; b.K = K;
+    b.alpha = alpha; b.beta = beta;
+    b.A = A; b.B = B; b.C = C;
+    b.lda = lda; b.ldb = ldb; b.ldc = ldc;
+    b.gemm = halide_dgemm;
+
+    assert_no_error(run_gemm_batch(b, batch_count));
+}
+
 
 #ifdef __cplusplus
 }
@@ -244,6 +244,24 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc);
 
+/*
+ * Run batch_count independent gemms of the same shape, with the i-th
+ * one reading A[i] and B[i] and updating C[i].
+ */
+void hblas_sgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const float alpha, const float *const *A,
+                       const int lda, const float *const *B, const int ldb,
+                       const float beta, float *const *C, const int ldc,
+                       const int batch_count);
+
+void hblas_dgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const double alpha, const double *const *A,
+                       const int lda, const double *const *B, const int ldb,
+                       const double beta, double *const *C, const int ldc,
+                       const int batch_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -111,6 +111,44 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+#define L3_BATCH_TEST(method, cblas_code, hblas_code)                   \
+    bool test_##method(int N) {                                         \
+        const int batch_count = 4;                                      \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        std::vector<Matrix> eA, eB, eC;                                 \
+        for (int i = 0; i < batch_count; i++) {                         \
+            eA.push_back(random_matrix(N));                             \
+            eB.push_back(random_matrix(N));                             \
+            eC.push_back(random_matrix(N));                             \
+        }                                                               \
+        std::vector<Matrix> aC(eC);                                     \
+                                                                        \
+        for (int i = 0; i < batch_count; i++) {                         \
+            Scalar *A = &(eA[i][0]);                                    \
+            Scalar *B = &(eB[i][0]);                                    \
+            Scalar *C = &(eC[i][0]);                                    \
+            cblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        {                                                               \
+            std::vector<Scalar *> A, B, C;                              \
+            for (int i = 0; i < batch_count; i++) {                     \
+                A.push_back(&(eA[i][0]));                               \
+                B.push_back(&(eB[i][0]));                               \
+                C.push_back(&(aC[i][0]));                               \
+            }                                                           \
+            hblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        for (int i = 0; i < batch_count; i++) {                         \
+            if (!compareMatrices(N, eC[i], aC[i])) {                    \
+                return false;                                           \
+            }                                                           \
+        }                                                               \
+        return true;                                                    \
+    }
+
 
 template<class T>
 struct BLASTestBase {
@@ -210,6 +248,7 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemm_batch);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -241,6 +280,10 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCH_TEST(sgemm_batch,
+                  cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
+                  hblas_sgemm_batch(HblasColMajor, HblasNoTrans, HblasTrans, N, N, N, alpha, A.data(), N,
+                                    B.data(), N, beta, C.data(), N, batch_count));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -257,6 +300,7 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemm_batch);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -288,6 +332,10 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCH_TEST(dgemm_batch,
+                  cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
+                  hblas_dgemm_batch(HblasColMajor, HblasNoTrans, HblasTrans, N, N, N, alpha, A.data(), N,
+                                    B.data(), N, beta, C.data(), N, batch_count));
 };
 
 int main(int argc, char *argv[]) {
@@ -8,6 +8,10 @@ constexpr int maxJ = 20;
 class LocalLaplacian : public Halide::Generator<LocalLaplacian> {
 public:
     GeneratorParam<int>     pyramid_levels{"pyramid_levels", 8, 1, maxJ};
+    // Compute the horizontal pass of each downsampling step in a
+    // sliding window of rows (or in shared memory on GPUs), so that
+    // each pyramid level is built while the level above is in cache.
+    GeneratorParam<bool>    streaming{"streaming", false};
 
     Input<Buffer<uint16_t>> input{"input", 3};
     Input<int>              levels{"levels"};
@@ -37,14 +41,14 @@ public:
         gray(x, y) = 0.299f * floating(x, y, 0) + 0.587f * floating(x, y, 1) + 0.114f * floating(x, y, 2);
 
         // Make the processed Gaussian pyramid.
-        Func gPyramid[maxJ];
+        Func gPyramid[maxJ], gDownx[maxJ];
         // Do a lookup into a lut with 256 entires per intensity level
         Expr level = k * (1.0f / (levels - 1));
         Expr idx = gray(x, y)*cast<float>(levels-1)*256.0f;
         idx = clamp(cast<int>(idx), 0, (levels-1)*256);
         gPyramid[0](x, y, k) = beta*(gray(x, y) - level) + level + remap(idx - 256*k);
         for (int j = 1; j < J; j++) {
-            gPyramid[j](x, y, k) = downsample(gPyramid[j-1])(x, y, k);
+            gPyramid[j](x, y, k) = downsample(gPyramid[j-1], gDownx[j])(x, y, k);
         }
 
         // Get its laplacian pyramid
@@ -55,10 +59,10 @@ public:
         }
 
         // Make the Gaussian pyramid of the input
-        Func inGPyramid[maxJ];
+        Func inGPyramid[maxJ], inDownx[maxJ];
         inGPyramid[0](x, y) = gray(x, y);
         for (int j = 1; j < J; j++) {
-            inGPyramid[j](x, y) = downsample(inGPyramid[j-1])(x, y);
+            inGPyramid[j](x, y) = downsample(inGPyramid[j-1], inDownx[j])(x, y);
         }
 
         // Make the laplacian pyramid of the output
@@ -106,6 +110,26 @@ public:
 
         if (auto_schedule) {
             // Nothing.
+        } else if (get_target().has_gpu_feature() && streaming) {
+            // gpu schedule, with the horizontal pass of each
+            // downsample staged in shared memory.
+            remap.compute_root();
+            Var xi, yi;
+            output.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
+            for (int j = 0; j < J; j++) {
+                int blockw = 16, blockh = 8;
+                if (j > 3) {
+                    blockw = 2;
+                    blockh = 2;
+                }
+                if (j > 0) {
+                    inGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+                    inDownx[j].compute_at(inGPyramid[j], x).gpu_threads(x, y);
+                    gPyramid[j].compute_root().reorder(k, x, y).gpu_tile(x, y, xi, yi, blockw, blockh);
+                    gDownx[j].compute_at(gPyramid[j], x).gpu_threads(x, y);
+                }
+                outGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+            }
         } else if (get_target().has_gpu_feature()) {
             // gpu schedule
             remap.compute_root();
@@ -130,11 +154,28 @@ public:
             output.reorder(c, x, y).split(y, yo, y, 64).parallel(yo).vectorize(x, 8);
             gray.compute_root().parallel(y, 32).vectorize(x, 8);
             for (int j = 1; j < 5; j++) {
-                inGPyramid[j]
-                    .compute_root().parallel(y, 32).vectorize(x, 8);
-                gPyramid[j]
-                    .compute_root().reorder_storage(x, k, y)
-                    .reorder(k, y).parallel(y, 8).vectorize(x, 8);
+                if (streaming) {
+                    // Compute the horizontal pass as a sliding window
+                    // over the rows of each strip of the level below.
+                    Var yo;
+                    inGPyramid[j]
+                        .compute_root().split(y, yo, y, 32).parallel(yo).vectorize(x, 8);
+                    inDownx[j]
+                        .store_at(inGPyramid[j], yo).compute_at(inGPyramid[j], y)
+                        .vectorize(x, 8);
+                    gPyramid[j]
+                        .compute_root().reorder_storage(x, k, y)
+                        .reorder(k, y).split(y, yo, y, 8).parallel(yo).vectorize(x, 8);
+                    gDownx[j]
+                        .store_at(gPyramid[j], yo).compute_at(gPyramid[j], y)
+                        .vectorize(x, 8);
+                } else {
+                    inGPyramid[j]
+                        .compute_root().parallel(y, 32).vectorize(x, 8);
+                    gPyramid[j]
+                        .compute_root().reorder_storage(x, k, y)
+                        .reorder(k, y).parallel(y, 8).vectorize(x, 8);
+                }
                 outGPyramid[j]
                     .store_at(output, yo).compute_at(output, y).fold_storage(y, 8)
                     .vectorize(x, 8);
@@ -211,10 +252,11 @@ public:
 private:
     Var x, y, c, k;
 
-    // Downsample with a 1 3 3 1 filter
-    Func downsample(Func f) {
+    // Downsample with a 1 3 3 1 filter. The horizontal pass is
+    // defined into downx so that it can be scheduled.
+    Func downsample(Func f, Func downx) {
         using Halide::_;
-        Func downx, downy;
+        Func downy;
         downx(x, y, _) = (f(2*x-1, y, _) + 3.0f * (f(2*x, y, _) + f(2*x+1, y, _)) + f(2*x+2, y, _)) / 8.0f;
         downy(x, y, _) = (downx(x, 2*y-1, _) + 3.0f * (downx(x, 2*y, _) + downx(x, 2*y+1, _)) + downx(x, 2*y+2, _)) / 8.0f;
         return downy;
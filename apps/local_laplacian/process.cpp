@@ -4,6 +4,7 @@
 #include "local_laplacian.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "local_laplacian_auto_schedule.h"
+#include "local_laplacian_streaming.h"
 #endif
 
 #include "halide_benchmark.h"
@@ -32,18 +33,31 @@ int main(int argc, char **argv) {
 
     // Timing code
 
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing;
+
     // Manually-tuned version
-    double best_manual = benchmark(timing, 1, [&]() {
+    config.name = "local_laplacian_manual";
+    BenchmarkResult manual = benchmark([&]() {
         local_laplacian(input, levels, alpha/(levels-1), beta, output);
-    });
-    printf("Manually-tuned time: %gms\n", best_manual * 1e3);
+    }, config);
+    printf("Manually-tuned time: %gms\n", manual.wall_time * 1e3);
 
     #ifndef NO_AUTO_SCHEDULE
+    // Manually-tuned version that builds the pyramids in strips
+    config.name = "local_laplacian_streaming";
+    BenchmarkResult streaming = benchmark([&]() {
+        local_laplacian_streaming(input, levels, alpha/(levels-1), beta, output);
+    }, config);
+    printf("Streaming time: %gms\n", streaming.wall_time * 1e3);
+
     // Auto-scheduled version
-    double best_auto = benchmark(timing, 1, [&]() {
+    config.name = "local_laplacian_auto_schedule";
+    BenchmarkResult automatic = benchmark([&]() {
         local_laplacian_auto_schedule(input, levels, alpha/(levels-1), beta, output);
-    });
-    printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
+    }, config);
+    printf("Auto-scheduled time: %gms\n", automatic.wall_time * 1e3);
     #endif
 
     convert_and_save_image(output, argv[6]);
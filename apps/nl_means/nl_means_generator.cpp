@@ -6,6 +6,11 @@ using namespace Halide;
 
 class NonLocalMeans : public Halide::Generator<NonLocalMeans> {
 public:
+    // Compute the patch distances with running box sums instead of
+    // summing over the patch for each pixel. This makes the cost
+    // independent of the patch size.
+    GeneratorParam<bool>  box_filter{"box_filter", false};
+
     Input<Buffer<float>>  input{"input", 3};
     Input<int>            patch_size{"patch_size"};
     Input<int>            search_area{"search_area"};
@@ -39,10 +44,35 @@ public:
         // Find the patch differences by blurring the difference images
         RDom patch_dom(-(patch_size/2), patch_size);
         Func blur_d_y("blur_d_y");
-        blur_d_y(x, y, dx, dy) = sum(d(x, y + patch_dom, dx, dy));
-
         Func blur_d("blur_d");
-        blur_d(x, y, dx, dy) = sum(blur_d_y(x + patch_dom, y, dx, dy));
+        RDom rx, ry;
+        if (box_filter) {
+            // Each output of a box filter differs from its neighbor by
+            // the sample entering the window minus the sample leaving
+            // it. Compute those differences, sum the first window of
+            // each row or column directly, and then take a prefix sum
+            // of the differences along the rest of the row or column.
+            // The running sums stay on the order of a single patch, so
+            // there is no loss of precision as there would be with a
+            // full integral image.
+            Expr lo = -(patch_size/2);
+            Expr hi = lo + patch_size - 1;
+            Expr x_min = non_local_means.dim(0).min();
+            Expr y_min = non_local_means.dim(1).min();
+            rx = RDom(x_min + 1, non_local_means.dim(0).extent() - 1, "rx");
+            ry = RDom(y_min + 1, non_local_means.dim(1).extent() - 1, "ry");
+
+            blur_d_y(x, y, dx, dy) = d(x, y + hi, dx, dy) - d(x, y + lo - 1, dx, dy);
+            blur_d_y(x, y_min, dx, dy) = sum(d(x, y_min + patch_dom, dx, dy));
+            blur_d_y(x, ry, dx, dy) += blur_d_y(x, ry - 1, dx, dy);
+
+            blur_d(x, y, dx, dy) = blur_d_y(x + hi, y, dx, dy) - blur_d_y(x + lo - 1, y, dx, dy);
+            blur_d(x_min, y, dx, dy) = sum(blur_d_y(x_min + patch_dom, y, dx, dy));
+            blur_d(rx, y, dx, dy) += blur_d(rx - 1, y, dx, dy);
+        } else {
+            blur_d_y(x, y, dx, dy) = sum(d(x, y + patch_dom, dx, dy));
+            blur_d(x, y, dx, dy) = sum(blur_d_y(x + patch_dom, y, dx, dy));
+        }
 
         // Compute the weights from the patch differences
         Func w("w");
@@ -70,7 +100,7 @@ public:
         // Require 3 channels for output
         non_local_means.dim(2).set_bounds(0, 3);
 
-        Var tx("tx"), ty("ty"), xi("xi"), yi("yi");
+        Var tx("tx"), ty("ty"), xi("xi"), yi("yi"), xo("xo"), yo("yo");
 
         if (auto_schedule) {
             // Provide estimates on the input image
@@ -85,6 +115,76 @@ public:
             non_local_means.estimate(x, 0, 614)
                 .estimate(y, 0, 1024)
                 .estimate(c, 0, 3);
+        } else if (box_filter && get_target().has_gpu_feature()) {
+            // Loop over the search offsets on the host. For each
+            // offset, compute the patch distances for the whole image
+            // with one thread per column (then per row) for the
+            // running sums, and accumulate the weighted pixels.
+            non_local_means.compute_root()
+                .reorder(c, x, y).unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            non_local_means_sum.compute_root()
+                .reorder(c, x, y)
+                .bound(c, 0, 4).unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            non_local_means_sum.update(0)
+                .reorder(c, x, y, s_dom.x, s_dom.y)
+                .unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            blur_d_y.compute_at(non_local_means_sum, s_dom.x)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            blur_d_y.update(0)
+                .gpu_tile(x, xi, 64);
+            blur_d_y.update(1)
+                .reorder(ry, x)
+                .gpu_tile(x, xi, 64);
+            blur_d.compute_at(non_local_means_sum, s_dom.x)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            blur_d.update(0)
+                .gpu_tile(y, yi, 64);
+            blur_d.update(1)
+                .reorder(rx, y)
+                .gpu_tile(y, yi, 64);
+        } else if (box_filter) {
+            // Loop over the search offsets outermost. For each offset,
+            // the patch distances for the whole image are computed in
+            // parallel over columns (then rows) for the running sums,
+            // and accumulated into the sum in parallel over rows.
+            non_local_means.compute_root()
+                .reorder(c, x, y)
+                .parallel(y, 8)
+                .vectorize(x, 8);
+            non_local_means_sum.compute_root()
+                .reorder(c, x, y)
+                .bound(c, 0, 4).unroll(c)
+                .parallel(y, 8)
+                .vectorize(x, 8);
+            non_local_means_sum.update(0)
+                .reorder(c, x, y, s_dom.x, s_dom.y)
+                .unroll(c)
+                .parallel(y, 8)
+                .vectorize(x, 8);
+            blur_d_y.compute_at(non_local_means_sum, s_dom.x)
+                .parallel(y, 8)
+                .vectorize(x, 8);
+            blur_d_y.update(0)
+                .vectorize(x, 8);
+            blur_d_y.update(1)
+                .split(x, xo, xi, 64)
+                .reorder(xi, ry, xo)
+                .vectorize(xi, 8)
+                .parallel(xo);
+            blur_d.compute_at(non_local_means_sum, s_dom.x)
+                .parallel(y, 8)
+                .vectorize(x, 8);
+            blur_d.update(0)
+                .vectorize(y, 8);
+            // The running sum is serial in x, so vectorize across rows.
+            blur_d.update(1)
+                .split(y, yo, yi, 64)
+                .reorder(yi, rx, yo)
+                .vectorize(yi, 8)
+                .parallel(yo);
         } /*else if (get_target().has_gpu_feature()) {
             // TODO: the GPU schedule is currently using to much shared memory
             // because the simplifier can't simplify the expr (it can't cancel
@@ -3,6 +3,7 @@
 
 #include "nl_means.h"
 #include "nl_means_auto_schedule.h"
+#include "nl_means_box_filter.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -32,17 +33,30 @@ int main(int argc, char **argv) {
     printf("Input size: %d by %d, patch size: %d, search area: %d, sigma: %f\n",
             input.width(), input.height(), patch_size, search_area, sigma);
 
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing_iterations;
+
     // Manually-tuned version
-    double min_t_manual = benchmark(timing_iterations, 1, [&]() {
+    config.name = "nl_means_manual";
+    BenchmarkResult manual = benchmark([&]() {
         nl_means(input, patch_size, search_area, sigma, output);
-    });
-    printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
+    }, config);
+    printf("Manually-tuned time: %gms\n", manual.wall_time * 1e3);
+
+    // Manually-tuned version with patch distances from running box sums
+    config.name = "nl_means_box_filter";
+    BenchmarkResult box_filter = benchmark([&]() {
+        nl_means_box_filter(input, patch_size, search_area, sigma, output);
+    }, config);
+    printf("Box filter time: %gms\n", box_filter.wall_time * 1e3);
 
     // Auto-scheduled version
-    double min_t_auto = benchmark(timing_iterations, 1, [&]() {
+    config.name = "nl_means_auto_schedule";
+    BenchmarkResult automatic = benchmark([&]() {
         nl_means_auto_schedule(input, patch_size, search_area, sigma, output);
-    });
-    printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+    }, config);
+    printf("Auto-scheduled time: %gms\n", automatic.wall_time * 1e3);
 
     convert_and_save_image(output, argv[6]);
 
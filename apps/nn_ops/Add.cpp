@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <limits>
+
+#include "halide_benchmark.h"
+
+#include "Add.h"
+#include "common_reference.h"
+
+#include "HalideBuffer.h"
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        printf("Usage: %s C W H N [input1_offset input2_offset output_min output_max]\n", argv[0]);
+        return 0;
+    }
+
+    int C = atoi(argv[1]);
+    int W = atoi(argv[2]);
+    int H = atoi(argv[3]);
+    int N = atoi(argv[4]);
+
+    printf("Benchmarking %dx%dx%dx%d\n", C, W, H, N);
+
+    // These parameters compute the average of the two inputs, which
+    // keeps the output in range in most cases.
+    int16_t input1_offset = -128;
+    int16_t input2_offset = -128;
+    int input1_multiplier = 1 << 30;
+    int input1_shift = 0;
+    int input2_multiplier = 1 << 30;
+    int input2_shift = 0;
+    int left_shift = 20;
+    int output_multiplier = 1 << 30;
+    int output_shift = 19;
+    int output_offset = 128;
+    uint8_t output_min = 0;
+    uint8_t output_max = 255;
+
+    if (argc > 5) input1_offset = atoi(argv[5]);
+    if (argc > 6) input2_offset = atoi(argv[6]);
+    if (argc > 7) output_min = atoi(argv[7]);
+    if (argc > 8) output_max = atoi(argv[8]);
+
+    // Hexagon's device_malloc implementation will also set the host
+    // pointer if it is null, giving a zero copy buffer.
+    Halide::Runtime::Buffer<uint8_t> input1_tensor(nullptr, C, W, H, N);
+    Halide::Runtime::Buffer<uint8_t> input2_tensor(nullptr, C, W, H, N);
+    Halide::Runtime::Buffer<uint8_t> output_tensor(nullptr, C, W, H, N);
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    input1_tensor.device_malloc(halide_hexagon_device_interface());
+    input2_tensor.device_malloc(halide_hexagon_device_interface());
+    output_tensor.device_malloc(halide_hexagon_device_interface());
+#else
+    input1_tensor.allocate();
+    input2_tensor.allocate();
+    output_tensor.allocate();
+#endif
+
+    input1_tensor.for_each_value([](uint8_t &x) {
+        x = static_cast<uint8_t>(rand());
+    });
+
+    input2_tensor.for_each_value([](uint8_t &x) {
+        x = static_cast<uint8_t>(rand());
+    });
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // To avoid the cost of powering HVX on in each call of the
+    // pipeline, power it on once now. Also, set Hexagon performance to turbo.
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_turbo);
+    halide_hexagon_power_hvx_on(nullptr);
+#endif
+
+    printf("Running pipeline...\n");
+    double time = Halide::Tools::benchmark([&]() {
+        int result = Add(input1_tensor, input2_tensor,
+                         input1_offset, input1_multiplier, input1_shift,
+                         input2_offset, input2_multiplier, input2_shift,
+                         left_shift, output_multiplier, output_shift,
+                         output_offset, output_min, output_max, output_tensor);
+        if (result != 0) {
+            printf("pipeline failed! %d\n", result);
+        }
+    });
+
+    printf("Done, time: %g s\n", time);
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // We're done with HVX, power it off, and reset the performance mode
+    // to default to save power.
+    halide_hexagon_power_hvx_off(nullptr);
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
+#endif
+
+    // Copy the output back to the host. If the buffer is zero-copy (as
+    // it should be on a real device), this will be a no-op.
+    output_tensor.copy_to_host();
+
+    // Validate that the algorithm did what we expect.
+    output_tensor.for_each_element([&](int c, int x, int y, int b) {
+        int32_t input1 = (input1_tensor(c, x, y, b) + input1_offset) * (1 << left_shift);
+        int32_t input2 = (input2_tensor(c, x, y, b) + input2_offset) * (1 << left_shift);
+        input1 = multiply_quantized_multiplier_reference(input1, input1_multiplier, input1_shift);
+        input2 = multiply_quantized_multiplier_reference(input2, input2_multiplier, input2_shift);
+
+        int32_t output = multiply_quantized_multiplier_reference(input1 + input2, output_multiplier, output_shift);
+        output += output_offset;
+        output = std::max(output, (int32_t) output_min);
+        output = std::min(output, (int32_t) output_max);
+        if (output != output_tensor(c, x, y, b)) {
+            printf("Mismatch at %d %d %d %d: %d != %d\n", c, x, y, b, output, output_tensor(c, x, y, b));
+            abort();
+        }
+    });
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,6 @@
+ADD=$1
+# Columns are: schedule C W H N input1_offset input2_offset output_min output_max
+$ADD 8 16 16 1
+$ADD 32 7 7 4
+$ADD 64 17 17 1 -128 -100 0 255
+$ADD 64 17 17 1 -128 -128 64 128
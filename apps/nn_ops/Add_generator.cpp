@@ -0,0 +1,113 @@
+// This generator implements a quantized elementwise addition and schedules for
+// CPU and HVX.
+//
+// The pipeline implements the following operations, which match the
+// quantized add in TensorFlow Lite:
+// (1) an offset is added to each 8-bit input
+// (2) each input is left-shifted, and then scaled by its own multiplier, so
+// that both inputs have the same scale
+// (3) the scaled inputs are added
+// (4) the sum is scaled by the output multiplier
+// (5) an output offset is added to the quantized result
+// (6) the output is saturated and narrowed to 8-bit
+//
+// All of these are computed in one pass over the inputs.
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Generator;
+using Halide::Var;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::i32;
+using Halide::ConciseCasts::u8_sat;
+
+class Add : public Generator<Add> {
+public:
+    // Unsigned 8-bit input tensors, indexed by depth, x, y, batch.
+    Input<Buffer<uint8_t>> input1_{"input1", 4};
+    Input<Buffer<uint8_t>> input2_{"input2", 4};
+
+    // Offsets and multipliers for the inputs.
+    Input<int16_t> input1_offset_{ "input1_offset", 0, -255, 0 };
+    Input<int> input1_multiplier_{ "input1_multiplier" };
+    Input<int> input1_shift_{ "input1_shift" };
+    Input<int16_t> input2_offset_{ "input2_offset", 0, -255, 0 };
+    Input<int> input2_multiplier_{ "input2_multiplier" };
+    Input<int> input2_shift_{ "input2_shift" };
+
+    // The inputs are shifted left by this amount before they are scaled, to
+    // keep some fractional bits in the sum. TensorFlow Lite uses 20.
+    Input<int> left_shift_{ "left_shift", 20, 0, 23 };
+
+    // Parameters for pointwise operations on the output.
+    Input<int> output_multiplier_{ "output_multiplier" };
+    Input<int> output_shift_{ "output_shift" };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+
+        // Add the offsets, and scale the inputs to a common scale.
+        Func input1_scaled("input1_scaled");
+        input1_scaled(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                i32(i16(input1_(depth, x, y, batch)) + input1_offset_) << left_shift_,
+                input1_multiplier_, input1_shift_);
+
+        Func input2_scaled("input2_scaled");
+        input2_scaled(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                i32(i16(input2_(depth, x, y, batch)) + input2_offset_) << left_shift_,
+                input2_multiplier_, input2_shift_);
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                input1_scaled(depth, x, y, batch) + input2_scaled(depth, x, y, batch),
+                output_multiplier_, output_shift_) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, batch) =
+            clamp(u8_sat(scaled_plus_offset(depth, x, y, batch)), output_min_, output_max_);
+
+        // The schedule.
+
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+
+        // Parallelize across vertical strips.
+        Var yi("yi");
+        constexpr int kSplitFactor = 4;
+        output_.split(y, y, yi, kSplitFactor).parallel(y);
+
+        // We only perform vectorization when the depth >= vector size.
+        Expr can_vectorize_across_depth =
+            output_.dim(0).extent() >= vector_size_u8;
+        output_.specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size_u8);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(Add, Add)
@@ -10,3 +10,5 @@ $CONVOLUTION 8 17 17 1 3 3 8 -128 -128 8 2 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -128 8 1 1 1 0
 $CONVOLUTION 8 17 17 1 3 3 16 -128 -140 8 1 1 1 0
 $CONVOLUTION 12 17 17 1 3 3 16 -128 -140 12 1 1 1 0
+$CONVOLUTION 32 18 18 1 3 3 32 -128 -128 32 1 1 1 0
+$CONVOLUTION 128 9 9 1 3 3 32 -128 -128 128 1 1 1 0
@@ -16,14 +16,20 @@
 // Output dimension: {filter_batches, ceil((input_width + 2 * pad_width -
 // filter_width) / stride) + 1, ceil((input_height + 2 * pad_height -
 // filter_height) / stride) + 1, input_batches}
+//
+// On CPUs, 3x3 filters with stride 1 use the Winograd F(2x2, 3x3) algorithm,
+// and everything else uses a direct convolution blocked over x, with the
+// filter repacked so that the output depth is innermost.
 
 #include "common.h"
+#include <functional>
 #include <Halide.h>
 
 using Halide::Generator;
 using Halide::Var;
 using Halide::BoundaryConditions::constant_exterior;
 using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::i32;
 using Halide::ConciseCasts::u16_sat;
 using Halide::ConciseCasts::u8_sat;
 
@@ -99,21 +105,104 @@ public:
         shifted_input_with_offset(depth, x, y, batch) = input_with_offset_bounded(
             depth, x - pad_width_, y - pad_height_, batch);
 
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // On CPUs, repack the filter once so that the output depth is
+        // innermost, which makes the vector loads in the convolution dense.
+        Func packed_filter("packed_filter");
+        if (use_hexagon) {
+            packed_filter = filter_with_offset;
+        } else {
+            packed_filter(depth, x, y, batch) = filter_with_offset(depth, x, y, batch);
+        }
+
         // Do the convolution in 32-bit.
         Func convolved("convolved");
         RDom filter_dom(0, input_depth_, 0, filter_.dim(1).extent(), 0,
                         filter_.dim(2).extent());
         convolved(depth, x, y, batch) +=
-            cast<int32_t>(filter_with_offset(filter_dom[0], filter_dom[1],
-                                             filter_dom[2], depth)) *
+            cast<int32_t>(packed_filter(filter_dom[0], filter_dom[1],
+                                        filter_dom[2], depth)) *
             cast<int32_t>(shifted_input_with_offset(
                 filter_dom[0], x * stride_ + filter_dom[1],
                 y * stride_ + filter_dom[2], batch));
+        Expr convolution = convolved(depth, x, y, batch);
+
+        // Winograd F(2x2, 3x3) computes each 2x2 tile of the output from a
+        // 4x4 tile of the input with 16 multiplies per input channel instead
+        // of 36. The filter transform uses 2G instead of G so that all of the
+        // transforms are exact in integers, which scales the result by 4.
+        // With the inputs and filter coefficients in [-255, 255], the
+        // transformed inputs are in [-1020, 1020], the transformed filter is
+        // in [-2295, 2295] and the inverse transform grows the products by
+        // up to 9x, so the 32-bit accumulators can't overflow if there are at
+        // most 101 input channels.
+        const int max_winograd_depth = 101;
+        Expr use_winograd = filter_.dim(1).extent() == 3 &&
+                            filter_.dim(2).extent() == 3 && stride_ == 1 &&
+                            input_depth_ <= max_winograd_depth;
+        Var c("c"), a("a"), b("b"), tile_x("tile_x"), tile_y("tile_y");
+        RDom winograd_dom(0, input_depth_);
+        Func filter_transformed("filter_transformed");
+        Func input_transformed("input_transformed");
+        Func winograd_products("winograd_products");
+        if (!use_hexagon) {
+            // G' = 2G, B^T and A^T, applied along one dimension.
+            auto g = [](Expr i, std::function<Expr(int)> f) {
+                return select(i == 0, 2 * f(0),
+                              i == 1, f(0) + f(1) + f(2),
+                              i == 2, f(0) - f(1) + f(2),
+                              2 * f(2));
+            };
+            auto bt = [](Expr i, std::function<Expr(int)> d) {
+                return select(i == 0, d(0) - d(2),
+                              i == 1, d(1) + d(2),
+                              i == 2, d(2) - d(1),
+                              d(1) - d(3));
+            };
+            auto at = [](Expr i, std::function<Expr(int)> m) {
+                return select(i == 0, m(0) + m(1) + m(2), m(1) - m(2) - m(3));
+            };
+
+            // The transformed filter, indexed by output depth, input depth
+            // and the position in the 4x4 tile.
+            filter_transformed(depth, c, a, b) = g(a, [&](int i) {
+                return g(b, [&](int j) {
+                    return filter_with_offset(c, i, j, depth);
+                });
+            });
+
+            // The transformed 4x4 input tiles. Tile (tile_x, tile_y) produces
+            // the output at [2 * tile_x, 2 * tile_y] to
+            // [2 * tile_x + 1, 2 * tile_y + 1].
+            input_transformed(c, a, b, tile_x, tile_y, batch) = bt(a, [&](int i) {
+                return bt(b, [&](int j) {
+                    return input_with_offset_bounded(
+                        c, 2 * tile_x + i - pad_width_,
+                        2 * tile_y + j - pad_height_, batch);
+                });
+            });
+
+            // The elementwise products summed over the input depth, which is
+            // a matrix multiply for each position in the tile.
+            winograd_products(depth, a, b, tile_x, tile_y, batch) +=
+                i32(filter_transformed(depth, winograd_dom, a, b)) *
+                i32(input_transformed(winograd_dom, a, b, tile_x, tile_y, batch));
+
+            // The inverse transform.
+            Expr winograd = at(x % 2, [&](int i) {
+                return at(y % 2, [&](int j) {
+                    return winograd_products(depth, i, j, x / 2, y / 2, batch);
+                });
+            }) / 4;
+            convolution = select(use_winograd, winograd, convolution);
+        }
 
         Func scaled_plus_offset("scaled_plus_offset");
         scaled_plus_offset(depth, x, y, batch) =
             multiply_quantized_multiplier(
-                convolved(depth, x, y, batch) + bias_(depth), output_multiplier_,
+                convolution + bias_(depth), output_multiplier_,
                 output_shift_) +
             output_offset_;
 
@@ -123,9 +212,6 @@ public:
                 max(output_min_,
                     u8_sat(u16_sat(scaled_plus_offset(depth, x, y, batch)))));
 
-        const bool use_hexagon =
-            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
-
         // Specifying .hexagon() on a Func will generate an RPC to run this stage
         // on Hexagon. If Hexagon is the host (that is, the architecture is
         // Hexagon), we have to omit the .hexagon() directive as we are already
@@ -141,11 +227,56 @@ public:
         } else if (get_target().has_feature(Target::HVX_128)) {
             vector_size_u8 = 128;
         }
+        const int vector_size_i16 = vector_size_u8 / 2;
         // We only perform vectorization when the depth >= vector size.
         Expr can_vectorize_across_depth =
             filter_.dim(3).extent() >= vector_size_u8;
 
-        output_.parallel(y)
+        if (!use_hexagon) {
+            // The Winograd transforms and products are separate passes, with
+            // the inverse transform fused into the output. The stages of the
+            // path that isn't taken are skipped.
+            output_.specialize(use_winograd)
+                .parallel(y)
+                .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf);
+            filter_transformed.compute_root()
+                .reorder(a, b, depth, c)
+                .unroll(a)
+                .unroll(b);
+            input_transformed.compute_root()
+                .parallel(tile_y)
+                .vectorize(c, vector_size_i16, TailStrategy::GuardWithIf)
+                .unroll(a)
+                .unroll(b);
+            winograd_products.compute_root()
+                .parallel(tile_y)
+                .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf);
+            winograd_products.update()
+                .reorder(depth, winograd_dom, a, b)
+                .parallel(tile_y)
+                .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf)
+                .unroll(a)
+                .unroll(b);
+
+            // The filter's batch dimension is the output depth.
+            packed_filter.compute_root()
+                .reorder_storage(batch, depth, x, y)
+                .reorder(batch, depth, x, y);
+        }
+
+        // The direct convolution accumulates a few adjacent outputs at
+        // once, so that each vector of filter coefficients is loaded once
+        // per block instead of once per output.
+        const int block_x = 4;
+        Var xo("xo"), xi("xi");
+        output_.split(x, xo, xi, block_x, TailStrategy::GuardWithIf)
+            .parallel(y)
+            .specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size_u8);
+        convolved.compute_at(output_, xo);
+        convolved.update()
+            .reorder(depth, x, filter_dom[0], filter_dom[1], filter_dom[2])
+            .unroll(x, block_x, TailStrategy::GuardWithIf)
             .specialize(can_vectorize_across_depth)
             .vectorize(depth, vector_size_u8);
         shifted_input_with_offset.compute_at(output_, batch);
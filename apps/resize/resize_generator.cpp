@@ -79,14 +79,34 @@ public:
         kernel_x, kernel_y,
         kernel_sum_x, kernel_sum_y;
 
+    // The reduction over the taps of the kernel.
+    RDom r;
+
+    // 8-bit images are resampled in fixed point. The kernel weights
+    // have this many fractional bits...
+    static constexpr int weight_bits = 14;
+    // ...and the result of the first pass keeps this many, so that it
+    // fits in 16 bits even with the negative lobes of the kernels.
+    static constexpr int intermediate_bits = 6;
+
+    bool use_fixed_point() const {
+        return input.type() == UInt(8);
+    }
+
     void generate() {
 
         clamped = BoundaryConditions::repeat_edge(input,
                  {{input.dim(0).min(), input.dim(0).extent()},
                   {input.dim(1).min(), input.dim(1).extent()}});
 
-        // Handle different types by just casting to float
-        as_float(x, y, c) = cast<float>(clamped(x, y, c));
+        // Handle different types by just casting to float, or to
+        // 16-bit integers on the fixed point path.
+        const bool fixed_point = use_fixed_point();
+        if (fixed_point) {
+            as_float(x, y, c) = cast<int16_t>(clamped(x, y, c));
+        } else {
+            as_float(x, y, c) = cast<float>(clamped(x, y, c));
+        }
 
         // For downscaling, widen the interpolation kernel to perform lowpass
         // filtering.
@@ -107,7 +127,7 @@ public:
         Expr beginx = cast<int>(ceil(sourcex - kernel_radius));
         Expr beginy = cast<int>(ceil(sourcey - kernel_radius));
 
-        RDom r(0, kernel_taps);
+        r = RDom(0, kernel_taps);
         const KernelInfo &info = kernel_info[interpolation_type];
 
         unnormalized_kernel_x(x, k) = info.kernel((k + beginx - sourcex) * kernel_scaling);
@@ -116,24 +136,58 @@ public:
         kernel_sum_x(x) = sum(unnormalized_kernel_x(x, r), "kernel_sum_x");
         kernel_sum_y(y) = sum(unnormalized_kernel_y(y, r), "kernel_sum_y");
 
-        kernel_x(x, k) = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
-        kernel_y(y, k) = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
+        Expr normalized_x = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
+        Expr normalized_y = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
+        if (fixed_point) {
+            normalized_x = cast<int16_t>(round(normalized_x * (1 << weight_bits)));
+            normalized_y = cast<int16_t>(round(normalized_y * (1 << weight_bits)));
+        }
+        kernel_x(x, k) = normalized_x;
+        kernel_y(y, k) = normalized_y;
+
+        // Multiply a weight by a sample, in 32 bits on the fixed
+        // point path.
+        auto weighted = [&](Expr w, Expr v) {
+            if (fixed_point) {
+                return cast<int32_t>(w) * cast<int32_t>(v);
+            }
+            return w * v;
+        };
+
+        // Round the sum of the first pass to 16 bits on the fixed
+        // point path.
+        Func intermediate("intermediate");
 
         // Perform separable resizing. The resize in x vectorizes
         // poorly compared to the resize in y, so do it first if we're
         // upsampling, and do it second if we're downsampling.
+        const int first_shift = weight_bits - intermediate_bits;
         Func resized;
         if (upsample) {
-            resized_x(x, y, c) = sum(kernel_x(x, r) * as_float(r + beginx, y, c), "resized_x");
-            resized_y(x, y, c) = sum(kernel_y(y, r) * resized_x(x, r + beginy, c), "resized_y");
+            resized_x(x, y, c) += weighted(kernel_x(x, r), as_float(r + beginx, y, c));
+            if (fixed_point) {
+                intermediate(x, y, c) = cast<int16_t>((resized_x(x, y, c) + (1 << (first_shift - 1))) >> first_shift);
+            } else {
+                intermediate(x, y, c) = resized_x(x, y, c);
+            }
+            resized_y(x, y, c) += weighted(kernel_y(y, r), intermediate(x, r + beginy, c));
             resized = resized_y;
         } else {
-            resized_y(x, y, c) = sum(kernel_y(y, r) * as_float(x, r + beginy, c), "resized_y");
-            resized_x(x, y, c) = sum(kernel_x(x, r) * resized_y(r + beginx, y, c), "resized_x");
+            resized_y(x, y, c) += weighted(kernel_y(y, r), as_float(x, r + beginy, c));
+            if (fixed_point) {
+                intermediate(x, y, c) = cast<int16_t>((resized_y(x, y, c) + (1 << (first_shift - 1))) >> first_shift);
+            } else {
+                intermediate(x, y, c) = resized_y(x, y, c);
+            }
+            resized_x(x, y, c) += weighted(kernel_x(x, r), intermediate(r + beginx, y, c));
             resized = resized_x;
         }
 
-        if (input.type().is_float()) {
+        if (fixed_point) {
+            const int final_shift = weight_bits + intermediate_bits;
+            output(x, y, c) = saturating_cast(input.type(),
+                                              (resized(x, y, c) + (1 << (final_shift - 1))) >> final_shift);
+        } else if (input.type().is_float()) {
             output(x, y, c) = clamp(resized(x, y, c), 0.0f, 1.0f);
         } else {
             output(x, y, c) = saturating_cast(input.type(), resized(x, y, c));
@@ -142,6 +196,11 @@ public:
 
     void schedule() {
         Var xi, yi;
+        const int vec = use_fixed_point() ? 16 : 8;
+
+        // The kernel weights only depend on the scale factor and the
+        // size of the output, so compute them once and reuse them
+        // across calls that resize to the same size.
         unnormalized_kernel_x
             .compute_at(kernel_x, x)
             .vectorize(x);
@@ -150,6 +209,7 @@ public:
             .vectorize(x);
         kernel_x
             .compute_root()
+            .memoize()
             .reorder(k, x)
             .vectorize(x, 8);
 
@@ -160,7 +220,8 @@ public:
             .compute_at(kernel_y, y)
             .vectorize(y);
         kernel_y
-            .compute_at(output, y)
+            .compute_root()
+            .memoize()
             .reorder(k, y).vectorize(y, 8);
 
         if (upsample) {
@@ -170,10 +231,12 @@ public:
                 .vectorize(xi);
             resized_x
                 .compute_at(output, x)
-                .vectorize(x, 8);
+                .vectorize(x, vec);
+            resized_x.update()
+                .vectorize(x, vec);
             as_float
                 .compute_at(output, y)
-                .vectorize(x, 8);
+                .vectorize(x, vec);
         } else {
             output
                 .tile(x, y, xi, yi, 32, 8)
@@ -181,9 +244,23 @@ public:
                 .vectorize(xi);
             resized_y
                 .compute_at(output, y)
-                .vectorize(x, 8);
+                .vectorize(x, vec);
+            resized_y.update()
+                .vectorize(x, vec);
             resized_x
                 .compute_at(output, xi);
+
+            // Halving and quartering are the most common downscales.
+            // The number of taps is a constant for them, so unroll the
+            // kernels.
+            for (float factor : {0.5f, 0.25f}) {
+                resized_y.update()
+                    .specialize(scale_factor == factor)
+                    .unroll(r);
+                resized_x.update()
+                    .specialize(scale_factor == factor)
+                    .unroll(r);
+            }
         }
 
         // Allow the input and output to have arbitrary memory layout,
@@ -2,6 +2,7 @@
 #include <chrono>
 
 #include "stencil_chain.h"
+#include "stencil_chain_temporal_block.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "stencil_chain_auto_schedule.h"
 #endif
@@ -38,6 +39,12 @@ int main(int argc, char **argv) {
     });
     printf("Manually-tuned time: %gms\n", best_manual * 1e3);
 
+    // Temporally blocked version
+    double best_blocked = benchmark(timing, 1, [&]() {
+        stencil_chain_temporal_block(input, output);
+    });
+    printf("Temporally blocked time: %gms\n", best_blocked * 1e3);
+
     #ifndef NO_AUTO_SCHEDULE
     // Auto-scheduled version
     double best_auto = benchmark(timing, 1, [&]() {
@@ -5,6 +5,7 @@ namespace {
 class StencilChain : public Halide::Generator<StencilChain> {
 public:
     GeneratorParam<int>     stencils{"stencils", 32, 1, 100};
+    GeneratorParam<bool>    temporal_block{"temporal_block", false};
 
     Input<Buffer<uint16_t>> input{"input", 2};
     Output<Buffer<uint16_t>> output{"output", 2};
@@ -42,6 +43,20 @@ public:
             // Provide estimates on the pipeline output
             output.estimate(x, 0, width)
                 .estimate(y, 0, height);
+        } else if (temporal_block) {
+            // CPU schedule. Compute all the stages of each skewed tile
+            // in turn, without any redundant work.
+            for (size_t i = 1; i < stages.size() - 1; i++) {
+                Func s = stages[i];
+                s.compute_root()
+                    .temporal_block(s.args()[0], s.args()[1], 128, 32)
+                    .vectorize(s.args()[0], 16);
+            }
+            Var yo;
+            output.compute_root()
+                .split(y, yo, y, 64)
+                .parallel(yo)
+                .vectorize(x, 16);
         } else {
             // CPU schedule. No fusion.
             Var yi, yo, xo, xi, t;
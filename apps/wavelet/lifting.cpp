@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "daubechies_x.h"
+#include "lifting_53.h"
+#include "lifting_53_root.h"
+#include "lifting_97.h"
+#include "lifting_97_root.h"
+
+#include "HalideBuffer.h"
+#include "halide_benchmark.h"
+#include "halide_image_io.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+namespace {
+
+// The number of levels the generators were built with.
+const int levels = 3;
+const int size = 1 << levels;
+
+struct Step {
+    bool predict;
+    int sign, mul, add, shift;
+};
+
+const std::vector<Step> steps_53 = {
+    {true, -1, 1, 0, 1},
+    {false, 1, 1, 2, 2},
+};
+
+const std::vector<Step> steps_97 = {
+    {true, -1, 6497, 2048, 12},
+    {false, -1, 217, 2048, 12},
+    {true, 1, 3616, 2048, 12},
+    {false, 1, 1817, 2048, 12},
+};
+
+// A shift right that rounds down, like Halide's, whatever the sign.
+int shift_right(int v, int shift) {
+    return v >= 0 ? v >> shift : -((-v + (1 << shift) - 1) >> shift);
+}
+
+// Lift a signal of even length in place.
+void lift(std::vector<int> &s, const std::vector<Step> &steps) {
+    int half = (int)s.size() / 2;
+    std::vector<int> even(half), odd(half);
+    for (int n = 0; n < half; n++) {
+        even[n] = s[2 * n];
+        odd[n] = s[2 * n + 1];
+    }
+    for (const Step &step : steps) {
+        for (int n = 0; n < half; n++) {
+            int sum = step.predict ?
+                even[n] + even[std::min(n + 1, half - 1)] :
+                odd[std::max(n - 1, 0)] + odd[n];
+            int delta = shift_right(step.mul * sum + step.add, step.shift);
+            int &v = step.predict ? odd[n] : even[n];
+            v += step.sign * delta;
+        }
+    }
+    for (int n = 0; n < half; n++) {
+        s[2 * n] = even[n];
+        s[2 * n + 1] = odd[n];
+    }
+}
+
+// The in-place transform the generators compute, one level at a time.
+Buffer<int> reference(const Buffer<int16_t> &in, const std::vector<Step> &steps) {
+    Buffer<int> t(in.width(), in.height());
+    t.for_each_element([&](int x, int y) { t(x, y) = in(x, y); });
+    for (int l = 0; l < levels; l++) {
+        int step = 1 << l;
+        int w = in.width() >> l, h = in.height() >> l;
+        std::vector<int> s(w);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) s[x] = t(x * step, y * step);
+            lift(s, steps);
+            for (int x = 0; x < w; x++) t(x * step, y * step) = s[x];
+        }
+        s.resize(h);
+        for (int x = 0; x < w; x++) {
+            for (int y = 0; y < h; y++) s[y] = t(x * step, y * step);
+            lift(s, steps);
+            for (int y = 0; y < h; y++) t(x * step, y * step) = s[y];
+        }
+    }
+    return t;
+}
+
+bool check(const Buffer<int16_t> &out, const Buffer<int> &correct, const char *name) {
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            for (int y = 0; y < out.dim(1).extent(); y++) {
+                for (int x = 0; x < out.dim(0).extent(); x++) {
+                    int c = correct(x * size + i, y * size + j);
+                    if (out(x, y, i, j) != c) {
+                        fprintf(stderr, "%s: coefficient at (%d, %d) is %d instead of %d\n",
+                                name, x * size + i, y * size + j, out(x, y, i, j), c);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: lifting <src_image> [timing_iterations]\n");
+        return -1;
+    }
+    int timing_iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+    Buffer<float> image = load_and_convert_image(argv[1]);
+    if (image.dimensions() > 2) {
+        image = image.sliced(2, 0);
+    }
+
+    // Centered 8-bit samples, cropped to a whole number of squares of
+    // the coarsest level.
+    int w = image.width() / size * size, h = image.height() / size * size;
+    Buffer<int16_t> input(w, h);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (int16_t)(image(x, y) * 255.0f + 0.5f) - 128;
+    });
+    Buffer<int16_t> out(w / size, h / size, size, size);
+
+    BenchmarkConfig config;
+    config.warmup_iters = 1;
+    config.min_samples = timing_iterations;
+
+    struct Version {
+        const char *name;
+        int (*fn)(halide_buffer_t *, halide_buffer_t *);
+        const std::vector<Step> &steps;
+    } versions[] = {
+        {"lifting_53", lifting_53, steps_53},
+        {"lifting_53_root", lifting_53_root, steps_53},
+        {"lifting_97", lifting_97, steps_97},
+        {"lifting_97_root", lifting_97_root, steps_97},
+    };
+    for (const Version &v : versions) {
+        if (v.fn(input, out) != 0) {
+            fprintf(stderr, "%s failed\n", v.name);
+            return -1;
+        }
+        if (!check(out, reference(input, v.steps), v.name)) {
+            return -1;
+        }
+        config.name = v.name;
+        BenchmarkResult r = benchmark([&]() { v.fn(input, out); }, config);
+        printf("%-16s %d levels: %gms\n", v.name, levels, r.wall_time * 1e3);
+    }
+
+    // For comparison, the existing app's transform: one level, along
+    // rows only, in floating point.
+    Buffer<float> float_input = image.cropped(0, 0, w).cropped(1, 0, h);
+    Buffer<float> transformed(w / 2, h, 2);
+    config.name = "daubechies_x";
+    BenchmarkResult r = benchmark([&]() { daubechies_x(float_input, transformed); }, config);
+    printf("%-16s 1 level:  %gms\n", "daubechies_x", r.wall_time * 1e3);
+
+    printf("Success!\n");
+    return 0;
+}
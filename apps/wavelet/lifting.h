@@ -0,0 +1,159 @@
+#ifndef LIFTING_H
+#define LIFTING_H
+
+#include "Halide.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Integer wavelet transforms in the lifting scheme. A one-dimensional
+// transform splits a signal into its even and odd samples, and then
+// alternately predicts the odd samples from their even neighbors and
+// updates the even samples from their odd neighbors. The even samples
+// become the low band and the odd samples the high band. Rounding
+// each step to an integer keeps the transform exactly invertible.
+struct LiftingStep {
+    // Whether this step predicts the odd samples from the even ones,
+    // or updates the even samples from the odd ones.
+    bool predict;
+    // The step adds sign * ((mul * sum + add) >> shift) to each
+    // sample, where sum is the sum of its two neighbors.
+    int sign, mul, add, shift;
+};
+
+// Build a multi-level two-dimensional forward transform of the integer
+// image in, which is at least 2^levels times the size of out in x and
+// y, into out. Each level transforms the rows and then the columns of
+// the low band of the level before it. out(x, y, i, j) is the
+// coefficient at (x * 2^levels + i, y * 2^levels + j) in the layout of
+// an in-place transform, where each level's coefficients stay at the
+// positions of the samples they replaced. Indexed that way, each
+// (i, j) plane is a dense part of a single subband, and a row of out
+// needs the same few rows of every level.
+//
+// If streaming is true, the levels are computed together a band of
+// rows at a time, in tile columns of tile_width in parallel. Each
+// stage is a sliding window over its rows, stored in a folded line
+// buffer. Otherwise each stage of each level is computed over the
+// whole image before the next one starts.
+inline void lifting_transform(Halide::Func in, Halide::Func out,
+                              Halide::Expr width, Halide::Expr height,
+                              int levels, const std::vector<LiftingStep> &steps,
+                              bool streaming, int tile_width, int vec) {
+    using namespace Halide;
+    Var x("x"), y("y");
+
+    // Apply the lifting steps along one dimension of f, which has the
+    // given extent in that dimension, and return the low and high
+    // bands.
+    std::vector<Func> stages;
+    auto lift = [&](Func f, int dim, Expr extent, const std::string &name) {
+        Expr half = extent / 2;
+        auto at = [&](Func g, Expr n) {
+            return dim == 0 ? g(n, y) : g(x, n);
+        };
+        Expr n = dim == 0 ? x : y;
+        Func even(name + "_even"), odd(name + "_odd");
+        even(x, y) = at(f, 2 * n);
+        odd(x, y) = at(f, 2 * n + 1);
+        for (size_t i = 0; i < steps.size(); i++) {
+            const LiftingStep &s = steps[i];
+            // Neighbors off the end are mirrored, with the sample at
+            // the edge as the axis.
+            Func step(name + "_step_" + std::to_string(i));
+            Expr sum, value;
+            if (s.predict) {
+                sum = at(even, n) + at(even, min(n + 1, half - 1));
+                value = odd(x, y);
+            } else {
+                sum = at(odd, max(n - 1, 0)) + at(odd, n);
+                value = even(x, y);
+            }
+            Expr delta = (s.mul * sum + s.add) >> s.shift;
+            step(x, y) = s.sign > 0 ? value + delta : value - delta;
+            stages.push_back(step);
+            if (s.predict) {
+                odd = step;
+            } else {
+                even = step;
+            }
+        }
+        return std::make_pair(even, odd);
+    };
+
+    // The subbands of each level, in the order LL, HL, LH, HH, where
+    // HL is high-pass in x and low-pass in y.
+    std::vector<std::vector<Func>> bands(levels);
+    std::vector<size_t> first_stage(levels + 1);
+    Func ll("input");
+    ll(x, y) = cast<int32_t>(in(x, y));
+    for (int l = 0; l < levels; l++) {
+        first_stage[l] = stages.size();
+        // The size of the low band this level transforms.
+        Expr w = width << (levels - l), h = height << (levels - l);
+        std::string name = "level_" + std::to_string(l + 1);
+        auto rows = lift(ll, 0, w, name + "_rows");
+        auto lo = lift(rows.first, 1, h, name + "_lo");
+        auto hi = lift(rows.second, 1, h, name + "_hi");
+        bands[l] = {lo.first, hi.first, lo.second, hi.second};
+        ll = lo.first;
+    }
+    first_stage[levels] = stages.size();
+
+    // Gather the coefficients of each 2^levels square into the planes
+    // of out.
+    Var i("i"), j("j");
+    const int size = 1 << levels;
+    Expr value = bands[levels - 1][0](x, y);
+    for (int yi = 0; yi < size; yi++) {
+        for (int xi = 0; xi < size; xi++) {
+            if (xi == 0 && yi == 0) {
+                continue;
+            }
+            // The level of a position is given by the number of
+            // trailing zeros of its coordinates, and its band by the
+            // bits above them.
+            int l = 0;
+            while (!(((xi | yi) >> l) & 1)) {
+                l++;
+            }
+            int band = ((xi >> l) & 1) + 2 * ((yi >> l) & 1);
+            int scale = 1 << (levels - l - 1);
+            Expr c = bands[l][band](x * scale + (xi >> (l + 1)), y * scale + (yi >> (l + 1)));
+            value = select(i == xi && j == yi, c, value);
+        }
+    }
+    out(x, y, i, j) = cast<int16_t>(value);
+
+    // Unrolling the loops over the position in each square resolves
+    // the selects above at compile time.
+    Var xo("xo"), xi("xi");
+    out.split(x, xo, xi, tile_width)
+        .reorder(xi, i, j, y, xo)
+        .vectorize(xi, vec)
+        .unroll(i)
+        .unroll(j)
+        .parallel(xo);
+
+    for (int l = 0; l < levels; l++) {
+        // The rows of each level needed for a row of out, with the
+        // rows around them the lifting steps read.
+        int rows = (1 << (levels - l)) + 2 * (int)steps.size() + 2;
+        int fold = 1;
+        while (fold < rows) {
+            fold *= 2;
+        }
+        for (size_t s = first_stage[l]; s < first_stage[l + 1]; s++) {
+            Func f = stages[s];
+            if (streaming) {
+                f.store_at(out, xo).compute_at(out, y).fold_storage(y, fold);
+            } else {
+                f.compute_root().parallel(y);
+            }
+            f.vectorize(x, vec);
+        }
+    }
+}
+
+#endif  // LIFTING_H
@@ -0,0 +1,36 @@
+#include "Halide.h"
+
+#include "lifting.h"
+
+namespace {
+
+// The reversible 5/3 wavelet of JPEG 2000.
+class lifting_53 : public Halide::Generator<lifting_53> {
+public:
+    GeneratorParam<int> levels{"levels", 3, 1, 6};
+    GeneratorParam<bool> streaming{"streaming", true};
+    GeneratorParam<int> tile_width{"tile_width", 32};
+
+    Input<Buffer<int16_t>> in_{"in", 2};
+    Output<Buffer<int16_t>> out_{"out", 4};
+
+    void generate() {
+        const std::vector<LiftingStep> steps = {
+            {true, -1, 1, 0, 1},
+            {false, 1, 1, 2, 2},
+        };
+        lifting_transform(in_, out_, out_.dim(0).extent(), out_.dim(1).extent(),
+                          levels, steps, streaming, tile_width,
+                          natural_vector_size<int32_t>());
+
+        const int size = 1 << (int)levels;
+        out_.dim(0).set_min(0);
+        out_.dim(1).set_min(0);
+        out_.dim(2).set_bounds(0, size);
+        out_.dim(3).set_bounds(0, size);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(lifting_53, lifting_53)
@@ -0,0 +1,42 @@
+#include "Halide.h"
+
+#include "lifting.h"
+
+namespace {
+
+// An integer approximation of the 9/7 wavelet of JPEG 2000. The four
+// lifting steps of the Cohen-Daubechies-Feauveau 9/7 wavelet are
+// rounded to multiples of 2^-12, and the final scaling is left out so
+// that the transform stays reversible.
+class lifting_97 : public Halide::Generator<lifting_97> {
+public:
+    GeneratorParam<int> levels{"levels", 3, 1, 6};
+    GeneratorParam<bool> streaming{"streaming", true};
+    GeneratorParam<int> tile_width{"tile_width", 32};
+
+    Input<Buffer<int16_t>> in_{"in", 2};
+    Output<Buffer<int16_t>> out_{"out", 4};
+
+    void generate() {
+        // -1.586134342, -0.052980118, 0.882911076, and 0.443506852.
+        const std::vector<LiftingStep> steps = {
+            {true, -1, 6497, 2048, 12},
+            {false, -1, 217, 2048, 12},
+            {true, 1, 3616, 2048, 12},
+            {false, 1, 1817, 2048, 12},
+        };
+        lifting_transform(in_, out_, out_.dim(0).extent(), out_.dim(1).extent(),
+                          levels, steps, streaming, tile_width,
+                          natural_vector_size<int32_t>());
+
+        const int size = 1 << (int)levels;
+        out_.dim(0).set_min(0);
+        out_.dim(1).set_min(0);
+        out_.dim(2).set_bounds(0, size);
+        out_.dim(3).set_bounds(0, size);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(lifting_97, lifting_97)
@@ -521,7 +521,14 @@ _gengen_closure = rule(
 
 def _discard_useless_features(halide_target_features = []):
   # Discard target features which do not affect the contents of the runtime.
-  useless_features = depset(["user_context", "no_asserts", "no_bounds_query", "profile"])
+  # Instruction set extensions are discarded too (pipelines include the
+  # helpers they need for them), so that pipelines for every variant of a
+  # CPU share one runtime, and so one thread pool, which runs on all of them.
+  useless_features = depset(["user_context", "no_asserts", "no_bounds_query", "profile",
+                             "sse41", "avx", "avx2", "fma", "fma4", "f16c",
+                             "avx512", "avx512_knl", "avx512_skylake",
+                             "avx512_cannonlake", "avx512_cascadelake",
+                             "vsx", "power_arch_2_07"])
   return sorted(depset([f for f in halide_target_features if f not in useless_features.to_list()]).to_list())
 
 def _halide_library_runtime_target_name(halide_target_features = []):
@@ -307,6 +307,27 @@ function(halide_library NAME)
                    EXTRA_OUTPUTS ${args_EXTRA_OUTPUTS})
 endfunction()
 
+# Return (in OUTVAR) the CMake target for the Halide runtime shared by
+# all the libraries generated for HALIDE_TARGET (plus
+# HALIDE_TARGET_FEATURES), for linking with pipelines generated outside
+# of halide_library(), e.g. by running GenGen by hand with
+# target=...-no_runtime. halide_library() links with the same runtime.
+function(halide_runtime_library OUTVAR)
+  set(oneValueArgs HALIDE_TARGET)
+  set(multiValueArgs HALIDE_TARGET_FEATURES)
+  cmake_parse_arguments(args "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  if ("${args_HALIDE_TARGET}" STREQUAL "")
+    set(args_HALIDE_TARGET "host")
+  endif()
+  set(TARGET_WITH_FEATURES "${args_HALIDE_TARGET}")
+  foreach(FEATURE ${args_HALIDE_TARGET_FEATURES})
+    _halide_add_target_features("${TARGET_WITH_FEATURES}" ${FEATURE} TARGET_WITH_FEATURES)
+  endforeach()
+  _halide_library_runtime("${TARGET_WITH_FEATURES}" RUNTIME_NAME)
+  set(${OUTVAR} "${RUNTIME_NAME}" PARENT_SCOPE)
+endfunction()
+
 # ----------------------- Private Functions.
 # All functions, properties, variables, etc. that being with an underscore
 # should be assumed to be private implementation details; don't rely on them externally.
@@ -419,18 +440,33 @@ function(_halide_canonicalize_target HALIDE_TARGET OUTVAR)
   set(${OUTVAR} "${HALIDE_TARGET}" PARENT_SCOPE)
 endfunction()
 
-# Given a HALIDE_TARGET, return the CMake target name for the runtime.
-function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
+# Given a HALIDE_TARGET, return the single target its runtime is built
+# for: the last of the multitargets, without the features that do not
+# affect the contents of the runtime. Instruction set extensions are
+# dropped too (the helpers pipelines need for them are compiled into
+# the pipelines themselves), so that pipelines generated for different
+# variants of a CPU share one runtime, and so one thread pool, which
+# runs on all of them.
+function(_halide_runtime_target HALIDE_TARGET OUTVAR)
   # MULTITARGETS = HALIDE_TARGET.split(",")
   string(REPLACE "," ";" MULTITARGETS "${HALIDE_TARGET}")
   # HALIDE_TARGET = MULTITARGETS.final_element()
   list(GET MULTITARGETS -1 HALIDE_TARGET)
   _halide_canonicalize_target("${HALIDE_TARGET}" HALIDE_TARGET)
   _halide_split_target("${HALIDE_TARGET}" BASE FEATURES)
-  # Discard target features which do not affect the contents of the runtime.
-  list(REMOVE_DUPLICATES FEATURES)
   list(REMOVE_ITEM FEATURES "user_context" "no_asserts" "no_bounds_query" "no_runtime" "profile")
-  list(SORT FEATURES)
+  list(REMOVE_ITEM FEATURES
+       "sse41" "avx" "avx2" "fma" "fma4" "f16c"
+       "avx512" "avx512_knl" "avx512_skylake" "avx512_cannonlake" "avx512_cascadelake"
+       "vsx" "power_arch_2_07")
+  _halide_join_target("${BASE}" "${FEATURES}" HALIDE_TARGET)
+  set(${OUTVAR} "${HALIDE_TARGET}" PARENT_SCOPE)
+endfunction()
+
+# Given a HALIDE_TARGET, return the CMake target name for the runtime.
+function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
+  _halide_runtime_target("${HALIDE_TARGET}" HALIDE_TARGET)
+  _halide_split_target("${HALIDE_TARGET}" BASE FEATURES)
   # Now build up the name
   set(RESULT "halide_rt")
   foreach(B ${BASE})
@@ -470,6 +506,7 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         cuda_capability_35
         cuda_capability_50
         cuda_capability_61
+        cuda_capability_70
         opencl
         cl_doubles
         cl_half
@@ -496,6 +533,7 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         avx512_knl
         avx512_skylake
         avx512_cannonlake
+        avx512_cascadelake
         trace_loads
         trace_stores
         trace_realizations
@@ -509,6 +547,28 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         embed_bitcode
         disable_llvm_loop_vectorize
         disable_llvm_loop_unroll
+        sve
+        arm_dot_prod
+        allocation_arena
+        profile_by_thread
+        profile_roofline
+        auto_specialize
+        auto_prefetch
+        multiversion_loops
+        batch_dimension
+        cuda_fatbin
+        metallib
+        opencl_spirv
+        fast_compile
+        lazy_specializations
+        arm_fp16
+        vulkan
+        wasm_simd128
+        wasm_threads
+        scratch_arena
+        profile_branches
+        memoize_shared
+        cache_shape_checks
       )
     # Synthesize a one-or-two-char abbreviation based on the feature's position
     # in the KNOWN_FEATURES list.
@@ -549,8 +609,7 @@ function(_halide_library_runtime HALIDE_TARGET OUTVAR)
     halide_generator(halide_library_runtime.generator SRCS "")
   endif()
 
-  string(REPLACE "," ";" MULTITARGETS "${HALIDE_TARGET}")
-  list(GET MULTITARGETS -1 HALIDE_TARGET)
+  _halide_runtime_target("${HALIDE_TARGET}" HALIDE_TARGET)
   _halide_runtime_target_name("${HALIDE_TARGET}" RUNTIME_NAME)
   if(NOT TARGET "${RUNTIME_NAME}_runtime_gen")
     set(RUNTIME_LIB "${RUNTIME_NAME}${CMAKE_STATIC_LIBRARY_SUFFIX}")
@@ -84,5 +84,34 @@ def test():
                 assert output_3d[x, y, z] == input_3d[x, y, z] + constant_i8
 
 
+def test_batch():
+    # Each buffer argument is a stack of the buffers for each call, and
+    # each scalar argument is either a list of values for each call, or
+    # one value for all of them.
+    batch = 4
+    constant_i8 = [-7, 0, 5, 50]
+    inputs = [numpy.arange(3 * batch, dtype=t).reshape((batch, 3))
+              for t in (numpy.uint8, numpy.uint16, numpy.uint32, numpy.uint64,
+                        numpy.int8, numpy.int16, numpy.int32, numpy.int64,
+                        numpy.float32, numpy.float64)]
+    input_2d = numpy.arange(6 * batch, dtype=numpy.int8).reshape((batch, 2, 3))
+    input_3d = numpy.arange(8 * batch, dtype=numpy.int8).reshape((batch, 2, 2, 2))
+    outputs = [numpy.zeros_like(i) for i in inputs]
+    output_2d = numpy.zeros_like(input_2d)
+    output_3d = numpy.zeros_like(input_3d)
+
+    addconstant.addconstant_batch(
+        True, 3, 49153, 65537, 5724968371,
+        constant_i8, -30712, -98901, -8163465847, 3.14159, 1.61803,
+        *(inputs + [input_2d, input_3d] + outputs + [output_2d, output_3d]))
+
+    for b in range(batch):
+        assert (output_2d[b] == input_2d[b] + constant_i8[b]).all()
+        assert (output_3d[b] == input_3d[b] + constant_i8[b]).all()
+        assert (outputs[4][b] == inputs[4][b] + constant_i8[b]).all()
+    assert (outputs[0] == inputs[0] + 3).all()
+
+
 if __name__ == "__main__":
   test()
+  test_batch()
@@ -217,6 +217,48 @@ def test_reorder():
     assert b.dim(2).stride() == b2.dim(2).stride()
     assert b.dim(3).stride() == b2.dim(3).stride()
 
+def test_strided_views():
+    # Buffers made from strided and reversed views of an ndarray share
+    # its storage, so realizing into them writes the ndarray in place.
+    a = np.zeros((8, 6), dtype=np.int32)
+    view = a[::2, ::-1]
+    b = hl.Buffer(view)
+    assert b.dim(0).extent() == 4
+    assert b.dim(0).stride() == 12
+    assert b.dim(1).extent() == 6
+    assert b.dim(1).stride() == -1
+
+    x, y = hl.Var("x"), hl.Var("y")
+    f = hl.Func("f")
+    f[x, y] = x * 10 + y
+    f.realize(b)
+    for i in range(4):
+        for j in range(6):
+            assert a[2 * i, 5 - j] == i * 10 + j
+            assert a[2 * i + 1, j] == 0
+
+def test_realize_from_threads():
+    # realize releases the GIL, so several Python threads can run
+    # the same pipeline at once.
+    import threading
+
+    x = hl.Var("x")
+    f = hl.Func("f")
+    f[x] = x * 2
+    f.compile_jit()
+
+    results = [None] * 4
+    def run(i):
+        results[i] = np.array(f.realize(1000 + i), copy = True)
+    threads = [threading.Thread(target = run, args = (i,)) for i in range(len(results))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for i, r in enumerate(results):
+        assert r.shape == (1000 + i,)
+        assert (r == np.arange(1000 + i) * 2).all()
+
 
 if __name__ == "__main__":
     test_make_interleaved()
@@ -228,4 +270,5 @@ if __name__ == "__main__":
     test_bufferinfo_sharing()
     test_float16()
     test_reorder()
-
+    test_strided_views()
+    test_realize_from_threads()
@@ -225,8 +225,19 @@ class PyBuffer : public Buffer<> {
         std::vector<halide_dimension_t> dims;
         dims.reserve(info.ndim);
         for (int i = 0; i < info.ndim; i++) {
-            // TODO: check for ssize_t -> int32_t overflow
-            dims.push_back({0, (int32_t) info.shape[i], (int32_t) (info.strides[i] / t.bytes())});
+            // The buffer is used in place, so its strides (which may
+            // be negative) must be whole elements, and its shape and
+            // strides must fit in a halide_dimension_t.
+            const ssize_t stride = info.strides[i] / t.bytes();
+            if (stride * t.bytes() != info.strides[i]) {
+                throw py::value_error("Cannot make a Buffer<> from a buffer whose strides are not a multiple of its element size.");
+            }
+            if (info.shape[i] > std::numeric_limits<int32_t>::max() ||
+                stride > std::numeric_limits<int32_t>::max() ||
+                stride < std::numeric_limits<int32_t>::min()) {
+                throw py::value_error("Cannot make a Buffer<> from a buffer with an extent or stride that doesn't fit in 32 bits.");
+            }
+            dims.push_back({0, (int32_t) info.shape[i], (int32_t) stride});
         }
         return dims;
     }
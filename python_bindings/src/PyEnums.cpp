@@ -33,6 +33,11 @@ void define_enums(py::module &m) {
         .value("Auto", LoopAlignStrategy::Auto)
     ;
 
+    py::enum_<MemoizeKey>(m, "MemoizeKey")
+        .value("Parameters", MemoizeKey::Parameters)
+        .value("ContentHash", MemoizeKey::ContentHash)
+    ;
+
     py::enum_<MemoryType>(m, "MemoryType")
         .value("Auto", MemoryType::Auto)
         .value("Heap", MemoryType::Heap)
@@ -61,6 +66,7 @@ void define_enums(py::module &m) {
         .value("RoundUp", TailStrategy::RoundUp)
         .value("GuardWithIf", TailStrategy::GuardWithIf)
         .value("ShiftInwards", TailStrategy::ShiftInwards)
+        .value("Predicate", TailStrategy::Predicate)
         .value("Auto", TailStrategy::Auto)
     ;
 
@@ -72,7 +78,8 @@ void define_enums(py::module &m) {
         .value("Android", Target::OS::Android)
         .value("IOS", Target::OS::IOS)
         .value("QuRT", Target::OS::QuRT)
-        .value("NoOS", Target::OS::NoOS);
+        .value("NoOS", Target::OS::NoOS)
+        .value("WebAssemblyRuntime", Target::OS::WebAssemblyRuntime);
 
     py::enum_<Target::Arch>(m, "TargetArch")
         .value("ArchUnknown", Target::Arch::ArchUnknown)
@@ -80,7 +87,9 @@ void define_enums(py::module &m) {
         .value("ARM", Target::Arch::ARM)
         .value("MIPS", Target::Arch::MIPS)
         .value("Hexagon", Target::Arch::Hexagon)
-        .value("POWERPC", Target::Arch::POWERPC);
+        .value("POWERPC", Target::Arch::POWERPC)
+        .value("WebAssembly", Target::Arch::WebAssembly)
+        .value("RISCV", Target::Arch::RISCV);
 
     py::enum_<Target::Feature>(m, "TargetFeature")
         .value("JIT", Target::Feature::JIT)
@@ -95,6 +104,9 @@ void define_enums(py::module &m) {
         .value("F16C", Target::Feature::F16C)
         .value("ARMv7s", Target::Feature::ARMv7s)
         .value("NoNEON", Target::Feature::NoNEON)
+        .value("SVE", Target::Feature::SVE)
+        .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("ARMFp16", Target::Feature::ARMFp16)
         .value("VSX", Target::Feature::VSX)
         .value("POWER_ARCH_2_07", Target::Feature::POWER_ARCH_2_07)
         .value("CUDA", Target::Feature::CUDA)
@@ -103,6 +115,7 @@ void define_enums(py::module &m) {
         .value("CUDACapability35", Target::Feature::CUDACapability35)
         .value("CUDACapability50", Target::Feature::CUDACapability50)
         .value("CUDACapability61", Target::Feature::CUDACapability61)
+        .value("CUDACapability70", Target::Feature::CUDACapability70)
         .value("OpenCL", Target::Feature::OpenCL)
         .value("CLDoubles", Target::Feature::CLDoubles)
         .value("CLHalf", Target::Feature::CLHalf)
@@ -129,6 +142,7 @@ void define_enums(py::module &m) {
         .value("AVX512_KNL", Target::Feature::AVX512_KNL)
         .value("AVX512_Skylake", Target::Feature::AVX512_Skylake)
         .value("AVX512_Cannonlake", Target::Feature::AVX512_Cannonlake)
+        .value("AVX512_Cascadelake", Target::Feature::AVX512_Cascadelake)
         .value("TraceLoads", Target::Feature::TraceLoads)
         .value("TraceStores", Target::Feature::TraceStores)
         .value("TraceRealizations", Target::Feature::TraceRealizations)
@@ -142,13 +156,33 @@ void define_enums(py::module &m) {
         .value("EmbedBitcode", Target::Feature::EmbedBitcode)
         .value("DisableLLVMLoopVectorize", Target::Feature::DisableLLVMLoopVectorize)
         .value("DisableLLVMLoopUnroll", Target::Feature::DisableLLVMLoopUnroll)
+        .value("AllocationArena", Target::Feature::AllocationArena)
+        .value("ProfileByThread", Target::Feature::ProfileByThread)
+        .value("ProfileRoofline", Target::Feature::ProfileRoofline)
+        .value("AutoSpecialize", Target::Feature::AutoSpecialize)
+        .value("AutoPrefetch", Target::Feature::AutoPrefetch)
+        .value("MultiversionLoops", Target::Feature::MultiversionLoops)
+        .value("BatchDimension", Target::Feature::BatchDimension)
+        .value("CUDAFatbin", Target::Feature::CUDAFatbin)
+        .value("MetalLib", Target::Feature::MetalLib)
+        .value("OpenCLSPIRV", Target::Feature::OpenCLSPIRV)
+        .value("FastCompile", Target::Feature::FastCompile)
+        .value("LazySpecializations", Target::Feature::LazySpecializations)
+        .value("Vulkan", Target::Feature::Vulkan)
+        .value("WasmSimd128", Target::Feature::WasmSimd128)
+        .value("WasmThreads", Target::Feature::WasmThreads)
+        .value("ScratchArena", Target::Feature::ScratchArena)
+        .value("ProfileBranches", Target::Feature::ProfileBranches)
+        .value("MemoizeShared", Target::Feature::MemoizeShared)
+        .value("CacheShapeChecks", Target::Feature::CacheShapeChecks)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
         .value("Int", Type::Int)
         .value("UInt", Type::UInt)
         .value("Float", Type::Float)
-        .value("Handle", Type::Handle);
+        .value("Handle", Type::Handle)
+        .value("BFloat", Type::BFloat);
 }
 
 }  // namespace PythonBindings
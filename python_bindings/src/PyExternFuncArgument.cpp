@@ -20,7 +20,10 @@ void define_extern_func_argument(py::module &m) {
         .def("is_expr", &ExternFuncArgument::is_expr)
         .def("is_buffer", &ExternFuncArgument::is_buffer)
         .def("is_image_param", &ExternFuncArgument::is_image_param)
+        .def("is_semaphore", &ExternFuncArgument::is_semaphore)
         .def("defined", &ExternFuncArgument::defined)
+
+        .def_static("completion_semaphore", &ExternFuncArgument::completion_semaphore)
     ;
 
     py::implicitly_convertible<Expr, ExternFuncArgument>();
@@ -46,6 +46,17 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Realize with the GIL released, so that other Python threads can run
+// while the pipeline does.
+template<typename... Args>
+py::object realize_to_object(Func &f, Args &&... args) {
+    Realization r = [&]() {
+        py::gil_scoped_release release;
+        return f.realize(std::forward<Args>(args)...);
+    }();
+    return realization_to_object(r);
+}
+
 }  // namespace
 
 void define_func(py::module &m) {
@@ -83,36 +94,38 @@ void define_func(py::module &m) {
         .def(py::init([](const ImageParam &im) -> Func { return im; }))
 
         .def("realize", [](Func &f, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            f.realize(buffer, target);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            f.realize(buffer, target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(),
+           py::call_guard<py::gil_scoped_release>())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Func &f, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            f.realize(Realization(buffers), t);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            f.realize(Realization(buffers), t, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(),
+           py::call_guard<py::gil_scoped_release>())
 
         .def("realize", [](Func &f, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(sizes, target, param_map));
+            return realize_to_object(f, sizes, target, param_map);
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, target, param_map));
+            return realize_to_object(f, x_size, target, param_map);
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, target, param_map));
+            return realize_to_object(f, x_size, y_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, target, param_map));
+            return realize_to_object(f, x_size, y_size, z_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realize_to_object(f, x_size, y_size, z_size, w_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("defined", &Func::defined)
@@ -149,14 +162,33 @@ void define_func(py::module &m) {
         .def("store_at", (Func &(Func::*)(LoopLevel)) &Func::store_at,
             py::arg("loop_level"))
 
-        .def("memoize", &Func::memoize)
+        .def("memoize", &Func::memoize, py::arg("key") = MemoizeKey::Parameters)
         .def("compute_inline", &Func::compute_inline)
         .def("compute_root", &Func::compute_root)
         .def("store_root", &Func::store_root)
 
+        .def("slide_in_strips", &Func::slide_in_strips,
+            py::arg("strip_size"))
+
+        .def("distribute", &Func::distribute,
+            py::arg("var"))
+
+        .def("temporal_block", &Func::temporal_block,
+            py::arg("x"), py::arg("y"), py::arg("tile_x"), py::arg("tile_y"))
+
         .def("store_in", &Func::store_in,
             py::arg("memory_type"))
 
+        .def("store_in_place_of", (Func &(Func::*)(const Func &)) &Func::store_in_place_of,
+            py::arg("producer"))
+        .def("store_in_place_of", (Func &(Func::*)(const ImageParam &)) &Func::store_in_place_of,
+            py::arg("input"))
+
+        .def("store_nontemporal", &Func::store_nontemporal)
+        .def("store_packed", &Func::store_packed, py::arg("bits"))
+        .def("store_interleaved", &Func::store_interleaved)
+        .def("code_size_budget", &Func::code_size_budget, py::arg("instructions"))
+
         .def("compile_to", &Func::compile_to,
             py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
@@ -231,6 +263,7 @@ void define_func(py::module &m) {
         .def("trace_stores", &Func::trace_stores)
         .def("trace_realizations", &Func::trace_realizations)
         .def("print_loop_nest", &Func::print_loop_nest)
+        .def("print_redundant_work", &Func::print_redundant_work)
         .def("add_trace_tag", &Func::add_trace_tag, py::arg("trace_tag"))
 
         // TODO: also provide to-array versions to avoid requiring filesystem usage
@@ -309,6 +342,9 @@ void define_func(py::module &m) {
         .def("align_storage", &Func::align_storage,
             py::arg("dim"), py::arg("alignment"))
 
+        .def("store_tiled", &Func::store_tiled,
+            py::arg("x"), py::arg("y"), py::arg("tile_x"), py::arg("tile_y"), py::arg("morton") = false)
+
         .def("fold_storage", &Func::fold_storage,
             py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
 
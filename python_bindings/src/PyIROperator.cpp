@@ -129,8 +129,13 @@ void define_operators(py::module &m) {
     m.def("log", &log);
     m.def("pow", &pow);
     m.def("erf", &erf);
-    m.def("fast_log", &fast_log);
-    m.def("fast_exp", &fast_exp);
+    m.def("fast_log", (Expr (*)(Expr)) &fast_log);
+    m.def("fast_log", (Expr (*)(Expr, int)) &fast_log);
+    m.def("fast_exp", (Expr (*)(Expr)) &fast_exp);
+    m.def("fast_exp", (Expr (*)(Expr, int)) &fast_exp);
+    m.def("fast_sin", &fast_sin, py::arg("x"), py::arg("max_ulp_error") = 4);
+    m.def("fast_cos", &fast_cos, py::arg("x"), py::arg("max_ulp_error") = 4);
+    m.def("fast_tanh", &fast_tanh, py::arg("x"), py::arg("max_ulp_error") = 4);
     m.def("fast_pow", &fast_pow);
     m.def("fast_inverse", &fast_inverse);
     m.def("fast_inverse_sqrt", &fast_inverse_sqrt);
@@ -10,8 +10,16 @@ void define_machine_params(py::module &m) {
         .def(py::init<std::string>())
         .def_readwrite("parallelism", &MachineParams::parallelism)
         .def_readwrite("last_level_cache_size", &MachineParams::last_level_cache_size)
+        .def(py::init<int32_t, int32_t, int32_t, int32_t, int32_t>(),
+            py::arg("parallelism"), py::arg("last_level_cache_size"), py::arg("balance"),
+            py::arg("l1_cache_size"), py::arg("l2_cache_size"))
         .def_readwrite("balance", &MachineParams::balance)
+        .def_readwrite("l1_cache_size", &MachineParams::l1_cache_size)
+        .def_readwrite("l2_cache_size", &MachineParams::l2_cache_size)
+        .def_readwrite("max_memory", &MachineParams::max_memory)
+        .def_readwrite("memory_latency", &MachineParams::memory_latency)
         .def_static("generic", &MachineParams::generic)
+        .def_static("host", &MachineParams::host)
         .def("__str__", &MachineParams::to_string)
         .def("__repr__", [](const MachineParams &mp) -> std::string {
             std::ostringstream o;
@@ -20,6 +28,11 @@ void define_machine_params(py::module &m) {
         })
     ;
 
+    auto auto_tile_size_class = py::class_<AutoTileSize>(m, "AutoTileSize")
+        .def(py::init<float, int>(), py::arg("max_redundancy") = 0.1f, py::arg("cache_level") = 2)
+        .def_readwrite("max_redundancy", &AutoTileSize::max_redundancy)
+        .def_readwrite("cache_level", &AutoTileSize::cache_level)
+    ;
 }
 
 }  // namespace PythonBindings
@@ -49,6 +49,8 @@ void define_module(py::module &m) {
     ;
 
     m.def("link_modules", &link_modules, py::arg("name"), py::arg("modules"));
+    m.def("serialize_module_to_file", &serialize_module_to_file, py::arg("module"), py::arg("filename"));
+    m.def("deserialize_module_from_file", &deserialize_module_from_file, py::arg("filename"));
     m.def("compile_standalone_runtime", (void (*)(const std::string &, Target)) &compile_standalone_runtime, py::arg("filename"), py::arg("target"));
     m.def("compile_standalone_runtime", (Outputs (*)(const Outputs &, Target)) &compile_standalone_runtime, py::arg("outputs"), py::arg("target"));
 
@@ -38,6 +38,7 @@ void define_param(py::module &m) {
         .def("set_max_value", &Param<>::set_max_value)
         .def("min_value", &Param<>::min_value)
         .def("max_value", &Param<>::max_value)
+        .def("set_specialization_hints", &Param<>::set_specialization_hints, py::arg("values"))
 
         .def("__repr__", [](const Param<> &param) -> std::string {
             std::ostringstream o;
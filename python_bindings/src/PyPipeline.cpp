@@ -17,6 +17,17 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Realize with the GIL released, so that other Python threads can run
+// while the pipeline does.
+template<typename... Args>
+py::object realize_to_object(Pipeline &p, Args &&... args) {
+    Realization r = [&]() {
+        py::gil_scoped_release release;
+        return p.realize(std::forward<Args>(args)...);
+    }();
+    return realization_to_object(r);
+}
+
 }  // namespace
 
 void define_pipeline(py::module &m) {
@@ -49,6 +60,7 @@ void define_pipeline(py::module &m) {
         .def("get_func", &Pipeline::get_func,
             py::arg("index"))
         .def("print_loop_nest", &Pipeline::print_loop_nest)
+        .def("print_redundant_work", &Pipeline::print_redundant_work)
 
         .def("compile_to", &Pipeline::compile_to,
             py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
@@ -85,36 +97,38 @@ void define_pipeline(py::module &m) {
 
 
         .def("realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffer), target);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            p.realize(Realization(buffer), target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(),
+           py::call_guard<py::gil_scoped_release>())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffers), t);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            p.realize(Realization(buffers), t, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(),
+           py::call_guard<py::gil_scoped_release>())
 
         .def("realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(sizes, target, param_map));
+            return realize_to_object(p, sizes, target, param_map);
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, target, param_map));
+            return realize_to_object(p, x_size, target, param_map);
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, target, param_map));
+            return realize_to_object(p, x_size, y_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, target, param_map));
+            return realize_to_object(p, x_size, y_size, z_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realize_to_object(p, x_size, y_size, z_size, w_size, target, param_map);
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const ParamMap &param_map) -> void {
@@ -23,6 +23,11 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
     .def("unroll", (T &(T::*)(VarOrRVar, Expr, TailStrategy)) &T::unroll,
         py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
 
+    .def("unroll_and_jam", (T &(T::*)(VarOrRVar)) &T::unroll_and_jam,
+        py::arg("var"))
+    .def("unroll_and_jam", (T &(T::*)(VarOrRVar, Expr, TailStrategy)) &T::unroll_and_jam,
+        py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+
     .def("split", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, Expr, TailStrategy)) &T::split,
         py::arg("old"), py::arg("outer"), py::arg("inner"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
 
@@ -36,6 +41,10 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         py::arg("x"), py::arg("y"), py::arg("xo"), py::arg("yo"), py::arg("xi"), py::arg("yi"), py::arg("xfactor"), py::arg("yfactor"), py::arg("tail") = TailStrategy::Auto)
     .def("tile", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, Expr, Expr, TailStrategy)) &T::tile,
         py::arg("x"), py::arg("y"), py::arg("xi"), py::arg("yi"), py::arg("xfactor"), py::arg("yfactor"), py::arg("tail") = TailStrategy::Auto)
+    .def("tile", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, AutoTileSize, TailStrategy)) &T::tile,
+        py::arg("x"), py::arg("y"), py::arg("xo"), py::arg("yo"), py::arg("xi"), py::arg("yi"), py::arg("size"), py::arg("tail") = TailStrategy::Auto)
+    .def("tile", (T &(T::*)(VarOrRVar, VarOrRVar, VarOrRVar, VarOrRVar, AutoTileSize, TailStrategy)) &T::tile,
+        py::arg("x"), py::arg("y"), py::arg("xi"), py::arg("yi"), py::arg("size"), py::arg("tail") = TailStrategy::Auto)
 
     .def("reorder", (T &(T::*)(const std::vector<VarOrRVar> &)) &T::reorder, py::arg("vars"))
     .def("reorder", [](T &t, py::args args) -> T & {
@@ -51,6 +60,8 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         py::arg("var"))
     .def("vectorize", (T &(T::*)(VarOrRVar, Expr, TailStrategy)) &T::vectorize,
         py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+    .def("vectorize_natural", &T::vectorize_natural,
+        py::arg("var"), py::arg("tail") = TailStrategy::Auto)
 
     .def("gpu_blocks", (T &(T::*)(VarOrRVar, DeviceAPI)) &T::gpu_blocks,
         py::arg("block_x"), py::arg("device_api") = DeviceAPI::Default_GPU)
@@ -98,6 +109,18 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
         py::arg("x"), py::arg("y"), py::arg("z"), py::arg("tx"), py::arg("ty"), py::arg("tz"), py::arg("x_size"), py::arg("y_size"), py::arg("z_size"),
         py::arg("tail") = TailStrategy::Auto, py::arg("device_api") = DeviceAPI::Default_GPU)
 
+    .def("gpu_launch_bounds", &T::gpu_launch_bounds,
+        py::arg("max_threads"), py::arg("min_blocks_per_sm") = 0)
+
+    .def("gpu_multi_device", &T::gpu_multi_device,
+        py::arg("var"))
+
+    .def("hetero_split", &T::hetero_split,
+        py::arg("var"), py::arg("device_fraction") = Expr())
+
+    .def("skip_tiles_where", &T::skip_tiles_where,
+        py::arg("tile"), py::arg("condition"))
+
     .def("rename", &T::rename,
         py::arg("old_name"), py::arg("new_name"))
 
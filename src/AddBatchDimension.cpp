@@ -0,0 +1,137 @@
+#include "AddBatchDimension.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+LoweredFunc add_batch_dimension(Module module, const LoweredFunc &fn) {
+    LoweredFunc image_fn = fn;
+    image_fn.name = fn.name + "_batch_image";
+    image_fn.linkage = LinkageType::Internal;
+    module.append(image_fn);
+
+    const string batch_name = "batch";
+    Expr batch = Variable::make(Int(32), batch_name);
+    Expr batch_min = Variable::make(Int(32), batch_name + ".min");
+    Expr batch_extent = Variable::make(Int(32), batch_name + ".extent");
+
+    vector<LoweredArgument> args;
+    vector<Expr> call_args, retire_args;
+    vector<Stmt> checks, input_checks, unslices;
+    vector<pair<string, Expr>> slices;
+    Expr first_output, any_bounds_query = const_false();
+    int first_output_dim = 0;
+    for (LoweredArgument arg : fn.args) {
+        if (!arg.is_buffer()) {
+            args.push_back(arg);
+            call_args.push_back(Variable::make(arg.type, arg.name));
+            continue;
+        }
+
+        Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), arg.name + ".buffer");
+        const int d = arg.dimensions;
+        arg.dimensions = d + 1;
+        if (!arg.argument_estimates.buffer_estimates.empty()) {
+            arg.argument_estimates.buffer_estimates.push_back({Expr(), Expr()});
+        }
+        args.push_back(arg);
+
+        Expr error = Call::make(Int(32), "halide_error_buffer_argument_is_null",
+                                {arg.name}, Call::Extern);
+        checks.push_back(AssertStmt::make(reinterpret<uint64_t>(buf) != 0, error));
+        Expr dimensions = Call::make(Int(32), Call::buffer_get_dimensions, {buf}, Call::Extern);
+        error = Call::make(Int(32), "halide_error_bad_dimensions",
+                           {arg.name, dimensions, d + 1}, Call::Extern);
+        checks.push_back(AssertStmt::make(dimensions == d + 1, error));
+        any_bounds_query = any_bounds_query ||
+            Call::make(Bool(), Call::buffer_is_bounds_query, {buf}, Call::Extern);
+
+        if (arg.is_output() && !first_output.defined()) {
+            first_output = buf;
+            first_output_dim = d;
+        } else {
+            // Every other buffer must cover the same batch.
+            Expr min = Call::make(Int(32), Call::buffer_get_min, {buf, d}, Call::Extern);
+            Expr extent = Call::make(Int(32), Call::buffer_get_extent, {buf, d}, Call::Extern);
+            string dim = "." + std::to_string(d);
+            error = Call::make(Int(32), "halide_error_constraint_violated",
+                               {arg.name + ".min" + dim, min, batch_name + ".min", batch_min},
+                               Call::Extern);
+            input_checks.push_back(AssertStmt::make(min == batch_min, error));
+            error = Call::make(Int(32), "halide_error_constraint_violated",
+                               {arg.name + ".extent" + dim, extent, batch_name + ".extent", batch_extent},
+                               Call::Extern);
+            input_checks.push_back(AssertStmt::make(extent == batch_extent, error));
+        }
+
+        string slice_name = arg.name + ".slice";
+        Expr slice_var = Variable::make(type_of<struct halide_buffer_t *>(), slice_name);
+        Expr alloca_size = Call::make(Int(32), Call::size_of_halide_buffer_t, {}, Call::Intrinsic);
+        Expr slice = Call::make(type_of<struct halide_buffer_t *>(), "_halide_buffer_slice",
+                                {Call::make(type_of<struct halide_buffer_t *>(), Call::alloca,
+                                            {alloca_size}, Call::Intrinsic),
+                                 Call::make(type_of<struct halide_dimension_t *>(), Call::alloca,
+                                            {(int)sizeof(halide_dimension_t) * (d + 1)}, Call::Intrinsic),
+                                 buf, batch},
+                                Call::Extern);
+        slices.emplace_back(slice_name, slice);
+        call_args.push_back(slice_var);
+        retire_args.push_back(slice_var);
+        retire_args.push_back(buf);
+        unslices.push_back(Evaluate::make(Call::make(Int(32), "_halide_buffer_unslice_bounds_query",
+                                                     {buf, slice_var, batch_min, batch_extent},
+                                                     Call::Extern)));
+    }
+    internal_assert(first_output.defined()) << "Pipeline " << fn.name << " has no outputs\n";
+
+    Call::CallType call_type = Call::Extern;
+    if (fn.name_mangling == NameMangling::CPlusPlus ||
+        (fn.name_mangling == NameMangling::Default &&
+         module.target().has_feature(Target::CPlusPlusMangling))) {
+        call_type = Call::ExternCPlusPlus;
+    }
+
+    // Run the pipeline on the image at the batch position, and hand
+    // any device allocations of the slices back to their parents
+    // before returning an error.
+    retire_args.push_back(make_zero(type_of<struct halide_buffer_t *>()));
+    Expr retire = Call::make(Int(32), "_halide_buffer_retire_crops_after_extern_stage",
+                             {Call::make(Handle(), Call::make_struct, retire_args, Call::Intrinsic)},
+                             Call::Extern);
+    string result_name = unique_name('t');
+    Expr result = Variable::make(Int(32), result_name);
+    Stmt run_image = Block::make(Evaluate::make(retire), AssertStmt::make(result == 0, result));
+    Stmt query = Block::make({Evaluate::make(retire), Block::make(unslices),
+                              AssertStmt::make(result == 0, result)});
+    Expr call = Call::make(Int(32), image_fn.name, call_args, call_type);
+    run_image = LetStmt::make(result_name, call, run_image);
+    query = LetStmt::make(result_name, call, query);
+    for (size_t i = slices.size(); i > 0; i--) {
+        run_image = LetStmt::make(slices[i - 1].first, slices[i - 1].second, run_image);
+        query = LetStmt::make(slices[i - 1].first, slices[i - 1].second, query);
+    }
+
+    // A bounds query only needs to look at one image.
+    query = LetStmt::make(batch_name, batch_min, query);
+    Stmt body = For::make(batch_name, batch_min, batch_extent, ForType::Parallel, DeviceAPI::None, run_image);
+    input_checks.push_back(body);
+    body = IfThenElse::make(any_bounds_query, query, Block::make(input_checks));
+    body = LetStmt::make(batch_name + ".extent",
+                         Call::make(Int(32), Call::buffer_get_extent, {first_output, first_output_dim}, Call::Extern),
+                         body);
+    body = LetStmt::make(batch_name + ".min",
+                         Call::make(Int(32), Call::buffer_get_min, {first_output, first_output_dim}, Call::Extern),
+                         body);
+    checks.push_back(body);
+    body = Block::make(checks);
+
+    debug(2) << "Added batch wrapper for " << fn.name << ":\n" << body << "\n\n";
+    return LoweredFunc(fn.name, args, body, fn.linkage, fn.name_mangling);
+}
+
+}  // namespace Internal
+}  // namespace Halide
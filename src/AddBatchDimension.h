@@ -0,0 +1,28 @@
+#ifndef HALIDE_ADD_BATCH_DIMENSION_H
+#define HALIDE_ADD_BATCH_DIMENSION_H
+
+#include "Module.h"
+
+/** \file
+ *
+ * Defines the wrapper that runs a pipeline over a batch of images, for
+ * the batch_dimension feature.
+ */
+
+namespace Halide {
+namespace Internal {
+
+/** Rename fn, and append it to the module as an internal function that
+ * runs the pipeline on one image. Return a function with the name,
+ * linkage and arguments of fn, except that every buffer argument has
+ * an extra outermost dimension, that runs the pipeline on the images
+ * along it in parallel. The batch is as large as the outermost
+ * dimension of the first output, and every input must have the same
+ * bounds in that dimension. Bounds queries are answered for the first
+ * image. */
+LoweredFunc add_batch_dimension(Module module, const LoweredFunc &fn);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,9 +1,13 @@
 #include "AddImageChecks.h"
+#include "IRMutator.h"
+#include "IROperator.h"
 #include "IRVisitor.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Target.h"
 
+#include <set>
+
 namespace Halide {
 namespace Internal {
 
@@ -94,6 +98,351 @@ public:
     }
 };
 
+namespace {
+
+// Find the buffers a flattened statement indexes using a stride in
+// dimension 0 that isn't known to be one.
+class FindUnconstrainedStrides : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        const Parameter &p = op->param;
+        if (p.defined() && p.is_buffer() && p.dimensions() > 0 &&
+            !p.stride_constraint(0).defined() &&
+            ends_with(op->name, ".stride.0")) {
+            buffers[op->name.substr(0, op->name.size() - 9)] = p;
+        }
+    }
+
+public:
+    map<string, Parameter> buffers;
+};
+
+}  // namespace
+
+Stmt add_dense_stride_fast_path(Stmt s) {
+    FindUnconstrainedStrides finder;
+    s.accept(&finder);
+    if (finder.buffers.empty()) {
+        return s;
+    }
+
+    map<string, Expr> dense_strides;
+    Expr dense, not_bounds_query = const_true();
+    string names;
+    for (const auto &b : finder.buffers) {
+        Expr stride = Variable::make(Int(32), b.first + ".stride.0", b.second);
+        dense = dense.defined() ? (dense && stride == 1) : (stride == 1);
+        dense_strides[b.first + ".stride.0"] = 1;
+        Expr host = Variable::make(Handle(), b.first, b.second);
+        not_bounds_query = not_bounds_query && (host != make_zero(host.type()));
+        names += (names.empty() ? "" : ", ") + b.first;
+    }
+    debug(3) << "Adding a dense fast path for " << names << "\n";
+
+    Stmt fast_path = substitute(dense_strides, s);
+    Expr warning = Call::make(Int(32), "halide_strided_fallback_warning", {names}, Call::Extern);
+    Stmt fallback = Block::make(IfThenElse::make(not_bounds_query, Evaluate::make(warning)), s);
+    return IfThenElse::make(dense, fast_path, fallback);
+}
+
+namespace {
+
+// Find the buffers passed in to a flattened statement that it indexes
+// with 64-bit math.
+class FindLargeIndices : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void found(const string &name, const Expr &index, const Buffer<> &image, const Parameter &param) {
+        if (index.type().element_of() != Int(64)) {
+            return;
+        }
+        if (param.defined() && param.is_buffer()) {
+            params[name] = param;
+        } else if (image.defined()) {
+            images[name] = image;
+        }
+    }
+
+    void visit(const Load *op) override {
+        found(op->name, op->index, op->image, op->param);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        found(op->name, op->index, Buffer<>(), op->param);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    map<string, Parameter> params;
+    map<string, Buffer<>> images;
+};
+
+// Rewrite the 64-bit indexing of the buffers passed in to a flattened
+// statement as the same math in 32 bits.
+class NarrowIndices : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr narrow(const Expr &e) {
+        Type t = Int(32, e.type().lanes());
+        if (e.type() == t) {
+            return e;
+        } else if (const Cast *op = e.as<Cast>()) {
+            if (op->value.type() == t) {
+                return op->value;
+            }
+        } else if (const IntImm *op = e.as<IntImm>()) {
+            if (op->value == (int32_t)op->value) {
+                return make_const(t, op->value);
+            }
+        } else if (const Add *op = e.as<Add>()) {
+            return Add::make(narrow(op->a), narrow(op->b));
+        } else if (const Sub *op = e.as<Sub>()) {
+            return Sub::make(narrow(op->a), narrow(op->b));
+        } else if (const Mul *op = e.as<Mul>()) {
+            return Mul::make(narrow(op->a), narrow(op->b));
+        } else if (const Ramp *op = e.as<Ramp>()) {
+            return Ramp::make(narrow(op->base), narrow(op->stride), op->lanes);
+        } else if (const Broadcast *op = e.as<Broadcast>()) {
+            return Broadcast::make(narrow(op->value), op->lanes);
+        }
+        // The index fits in 32 bits, so truncating any other term
+        // gives the same result.
+        return Cast::make(t, e);
+    }
+
+    Expr visit(const Load *op) override {
+        Expr load = IRMutator2::visit(op);
+        op = load.as<Load>();
+        if (op && op->index.type().element_of() == Int(64) &&
+            (op->param.defined() || op->image.defined())) {
+            return Load::make(op->type, op->name, narrow(op->index),
+                              op->image, op->param, op->predicate);
+        }
+        return load;
+    }
+
+    Stmt visit(const Store *op) override {
+        Stmt store = IRMutator2::visit(op);
+        op = store.as<Store>();
+        if (op && op->index.type().element_of() == Int(64) && op->param.defined()) {
+            return Store::make(op->name, op->value, narrow(op->index),
+                               op->param, op->predicate);
+        }
+        return store;
+    }
+};
+
+// Check that a buffer with the given extents and strides is small
+// enough to be indexed with 32-bit math, as it would have to be
+// without large buffers.
+Expr fits_in_32_bits(const vector<Expr> &extents, const vector<Expr> &strides) {
+    Expr max_size = make_const(UInt(64), 0x7fffffff);
+    Expr total = make_const(Int(64), 1);
+    Expr result = const_true();
+    for (size_t i = 0; i < extents.size(); i++) {
+        Expr extent = cast<int64_t>(extents[i]);
+        result = result && abs(extent * strides[i]) <= max_size;
+        total *= extent;
+    }
+    if (!extents.empty()) {
+        result = result && total <= cast<int64_t>(max_size);
+    }
+    return result;
+}
+
+}  // namespace
+
+Stmt add_32_bit_index_fast_path(Stmt s, const Target &t) {
+    if (!t.has_large_buffers()) {
+        return s;
+    }
+    FindLargeIndices finder;
+    s.accept(&finder);
+    if (finder.params.empty() && finder.images.empty()) {
+        return s;
+    }
+
+    // Buffers compiled into the pipeline are checked now.
+    for (const auto &b : finder.images) {
+        vector<Expr> extents, strides;
+        for (int i = 0; i < b.second.dimensions(); i++) {
+            extents.push_back(b.second.dim(i).extent());
+            strides.push_back(b.second.dim(i).stride());
+        }
+        if (!is_one(simplify(fits_in_32_bits(extents, strides)))) {
+            debug(3) << "Not adding a 32-bit index fast path, because "
+                     << b.first << " is too large\n";
+            return s;
+        }
+    }
+
+    Expr fits = const_true();
+    string names;
+    for (const auto &b : finder.params) {
+        vector<Expr> extents, strides;
+        for (int i = 0; i < b.second.dimensions(); i++) {
+            string dim = std::to_string(i);
+            extents.push_back(Variable::make(Int(32), b.first + ".extent." + dim, b.second));
+            strides.push_back(Variable::make(Int(32), b.first + ".stride." + dim, b.second));
+        }
+        fits = fits && fits_in_32_bits(extents, strides);
+        names += (names.empty() ? "" : ", ") + b.first;
+    }
+    debug(3) << "Adding a 32-bit index fast path for " << names << "\n";
+
+    Stmt fast_path = NarrowIndices().mutate(s);
+    if (finder.params.empty()) {
+        return fast_path;
+    }
+    return IfThenElse::make(fits, fast_path, s);
+}
+
+namespace {
+
+// Find the definitions of all the lets in a stmt.
+class FindLets : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Let *op) override {
+        lets.emplace(op->name, op->value);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        lets.emplace(op->name, op->value);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    std::multimap<string, Expr> lets;
+};
+
+// Find the scalar parameters some checks depend on, looking through
+// the lets they refer to. Any other free variable the checks depend
+// on, such as the result of a bounds query of an extern stage, is
+// recorded as unknown.
+class FindCheckInputs : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            // The fields of the buffers are covered separately.
+            if (!op->param.is_buffer()) {
+                params[op->name] = op;
+            }
+        } else if (!op->image.defined() && expanded.insert(op->name).second) {
+            auto range = lets.equal_range(op->name);
+            if (range.first == range.second ||
+                op->name.find(".bounds_query.") != string::npos) {
+                unknown = true;
+            }
+            for (auto it = range.first; it != range.second; ++it) {
+                it->second.accept(this);
+            }
+        }
+    }
+
+    void visit(const Let *op) override {
+        lets.emplace(op->name, op->value);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        lets.emplace(op->name, op->value);
+        IRGraphVisitor::visit(op);
+    }
+
+    std::set<string> expanded;
+
+public:
+    std::multimap<string, Expr> lets;
+    map<string, Expr> params;
+    bool unknown = false;
+};
+
+// Pack a value into a 64-bit word of a shape signature.
+Expr signature_word(Expr e) {
+    Type t = e.type();
+    if (t.is_float()) {
+        e = reinterpret(UInt(t.bits()), e);
+    } else if (t.is_handle()) {
+        e = reinterpret(UInt(64), e);
+    }
+    return cast(UInt(64), e);
+}
+
+// Wrap checks that only depend on the fields of the buffers (other
+// than the host pointers) and on parameter values, so that they are
+// skipped if those are all the same as the last time the checks
+// passed. s is the rest of the pipeline, which defines lets the checks
+// may use.
+Stmt skip_checks_if_cached(Stmt checks, const map<string, FindBuffers::Result> &bufs,
+                           const vector<pair<string, Expr>> &lets, Stmt s) {
+    FindCheckInputs inputs;
+    FindLets s_lets;
+    s.accept(&s_lets);
+    inputs.lets = s_lets.lets;
+    for (const auto &l : lets) {
+        inputs.lets.emplace(l.first, l.second);
+    }
+    checks.accept(&inputs);
+    if (inputs.unknown) {
+        debug(1) << "Not caching shape checks, because they depend on more than the inputs\n";
+        return checks;
+    }
+
+    vector<Expr> signature;
+    for (const auto &buf : bufs) {
+        const string &name = buf.first;
+        const Parameter &param = buf.second.param;
+        if (!param.defined()) {
+            continue;
+        }
+        signature.push_back(Variable::make(UInt(8), name + ".type.code", param));
+        signature.push_back(Variable::make(UInt(8), name + ".type.bits", param));
+        signature.push_back(Variable::make(UInt(16), name + ".type.lanes", param));
+        signature.push_back(Variable::make(Int(32), name + ".dimensions", param));
+        for (int i = 0; i < buf.second.dimensions; i++) {
+            string dim = std::to_string(i);
+            signature.push_back(Variable::make(Int(32), name + ".min." + dim, param));
+            signature.push_back(Variable::make(Int(32), name + ".extent." + dim, param));
+            signature.push_back(Variable::make(Int(32), name + ".stride." + dim, param));
+        }
+    }
+    for (const auto &p : inputs.params) {
+        signature.push_back(p.second);
+    }
+    if (signature.empty()) {
+        return checks;
+    }
+    for (Expr &e : signature) {
+        e = signature_word(e);
+    }
+
+    // The cache lives in the runtime. The pipeline holds a pointer to
+    // it in a mutable global.
+    Buffer<void *> storage = Buffer<void *>::make_scalar("shape_check_cache");
+    storage() = nullptr;
+    Expr storage_buf = Variable::make(type_of<halide_buffer_t *>(), storage.name() + ".buffer", storage);
+    Expr cache = Call::make(Handle(), Call::buffer_get_host, {storage_buf}, Call::Extern);
+
+    string signature_name = unique_name("shape_check_signature");
+    Expr signature_var = Variable::make(type_of<uint64_t *>(), signature_name);
+    Expr size = make_const(Int(32), (int)signature.size());
+    Expr hit = Call::make(Int(32), "halide_shape_check_cache_lookup",
+                          {cache, signature_var, size}, Call::Extern);
+    Stmt store = Evaluate::make(Call::make(Int(32), "halide_shape_check_cache_store",
+                                           {cache, signature_var, size}, Call::Extern));
+    Stmt result = IfThenElse::make(hit == 0, Block::make(checks, store));
+    return LetStmt::make(signature_name,
+                         Call::make(type_of<uint64_t *>(), Call::make_struct, signature, Call::Intrinsic),
+                         result);
+}
+
+}  // namespace
+
 Stmt add_image_checks(Stmt s,
                       const vector<Function> &outputs,
                       const Target &t,
@@ -577,6 +926,23 @@ Stmt add_image_checks(Stmt s,
         }
     }
 
+    // With the cache_shape_checks feature, the checks that depend only
+    // on the shapes of the buffers and on parameter values are skipped
+    // when those are the same as the last time the checks passed. That
+    // includes the checks on the ranges of the parameters, which
+    // add_parameter_checks has put at the start of s.
+    bool cache_checks = t.has_feature(Target::CacheShapeChecks) && !no_asserts;
+    vector<Stmt> param_asserts;
+    if (cache_checks) {
+        while (const Block *b = s.as<Block>()) {
+            if (!b->first.as<AssertStmt>()) {
+                break;
+            }
+            param_asserts.push_back(b->first);
+            s = b->rest;
+        }
+    }
+
     // Inject the code that checks the host pointers.
     if (!no_asserts) {
         for (size_t i = asserts_host_non_null.size(); i > 0; i--) {
@@ -587,7 +953,13 @@ Stmt add_image_checks(Stmt s,
         }
     }
     // Inject the code that checks that no dimension math overflows
-    if (!no_asserts) {
+    Stmt overflow_checks;
+    if (cache_checks) {
+        overflow_checks = Block::make(dims_no_overflow_asserts);
+        for (size_t i = lets_overflow.size(); overflow_checks.defined() && i > 0; i--) {
+            overflow_checks = LetStmt::make(lets_overflow[i-1].first, lets_overflow[i-1].second, overflow_checks);
+        }
+    } else if (!no_asserts) {
         for (size_t i = dims_no_overflow_asserts.size(); i > 0; i--) {
             s = Block::make(dims_no_overflow_asserts[i-1], s);
         }
@@ -608,14 +980,30 @@ Stmt add_image_checks(Stmt s,
     // all in reverse order compared to execution, as we incrementally
     // prepending code.
 
-    // Inject the code that checks the constraints are correct. We
-    // need these regardless of how NoAsserts is set, because they are
-    // what gets Halide to actually exploit the constraint.
-    for (size_t i = asserts_constrained.size(); i > 0; i--) {
-        s = Block::make(asserts_constrained[i-1], s);
+    if (cache_checks) {
+        vector<Stmt> checks;
+        checks.insert(checks.end(), asserts_elem_size.begin(), asserts_elem_size.end());
+        checks.insert(checks.end(), asserts_required.begin(), asserts_required.end());
+        checks.insert(checks.end(), asserts_constrained.begin(), asserts_constrained.end());
+        if (overflow_checks.defined()) {
+            checks.push_back(overflow_checks);
+        }
+        checks.insert(checks.end(), param_asserts.begin(), param_asserts.end());
+        if (!checks.empty()) {
+            vector<pair<string, Expr>> lets = lets_required;
+            lets.insert(lets.end(), lets_constrained.begin(), lets_constrained.end());
+            s = Block::make(skip_checks_if_cached(Block::make(checks), bufs, lets, s), s);
+        }
+    } else {
+        // Inject the code that checks the constraints are correct. We
+        // need these regardless of how NoAsserts is set, because they are
+        // what gets Halide to actually exploit the constraint.
+        for (size_t i = asserts_constrained.size(); i > 0; i--) {
+            s = Block::make(asserts_constrained[i-1], s);
+        }
     }
 
-    if (!no_asserts) {
+    if (!no_asserts && !cache_checks) {
         // Inject the code that checks for out-of-bounds access to the buffers.
         for (size_t i = asserts_required.size(); i > 0; i--) {
             s = Block::make(asserts_required[i-1], s);
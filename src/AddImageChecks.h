@@ -20,7 +20,10 @@ namespace Internal {
 
 /** Insert checks to make sure a statement doesn't read out of bounds
  * on inputs or outputs, and that the inputs and outputs conform to
- * the format required (e.g. stride.0 must be 1).
+ * the format required (e.g. stride.0 must be 1). With the
+ * cache_shape_checks target feature, these checks and the parameter
+ * checks are skipped when the buffer shapes and the parameter values
+ * they depend on match the last ones that passed them.
  */
 Stmt add_image_checks(Stmt s,
                       const std::vector<Function> &outputs,
@@ -29,6 +32,22 @@ Stmt add_image_checks(Stmt s,
                       const std::map<std::string, Function> &env,
                       const FuncValueBounds &fb);
 
+/** Version a flattened statement on the innermost strides of the
+ * buffers whose stride in dimension 0 is unconstrained: if they are
+ * all one, run a copy of the statement specialized for dense access,
+ * and otherwise warn (once) and run the general version. Does nothing
+ * if every buffer's innermost stride is constrained, which is the
+ * default. */
+Stmt add_dense_stride_fast_path(Stmt s);
+
+/** On 64-bit targets with large buffers, version a flattened statement
+ * on the size of the buffers passed in to it: if they are all small
+ * enough to be indexed with 32-bit math, as they must be without large
+ * buffers, run a copy of the statement that does so, and otherwise run
+ * the statement as is. Buffers allocated by the pipeline itself are
+ * indexed with 64-bit math in both. Does nothing for other targets. */
+Stmt add_32_bit_index_fast_path(Stmt s, const Target &t);
+
 }  // namespace Internal
 }  // namespace Halide
 
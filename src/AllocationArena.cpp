@@ -0,0 +1,175 @@
+#include "AllocationArena.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+// Will codegen put this allocation on the heap?
+bool on_heap(const Allocate *op) {
+    if (op->extents.empty() || op->new_expr.defined() || is_zero(op->condition)) {
+        return false;
+    }
+    if (op->memory_type == MemoryType::Heap) {
+        return true;
+    }
+    if (op->memory_type != MemoryType::Auto) {
+        return false;
+    }
+    int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+    return (constant_size == 0 ||
+            !can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes()));
+}
+
+// The number of bytes codegen would ask halide_malloc for, including
+// the padding it adds.
+Expr heap_allocation_size(const Allocate *op) {
+    Expr size = make_const(UInt(64), op->type.bytes());
+    for (const Expr &e : op->extents) {
+        size *= cast(UInt(64), e);
+    }
+    size += op->type.bytes();
+    if (!is_one(op->condition)) {
+        size = select(op->condition, size, make_zero(UInt(64)));
+    }
+    return simplify(size);
+}
+
+class UseAllocationArena : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // Whether we're inside something that may run more than once,
+    // or concurrently, per invocation of the pipeline.
+    bool in_loop = false;
+
+    Stmt visit(const For *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Fork *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Acquire *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (in_loop || !on_heap(op)) {
+            return IRMutator2::visit(op);
+        }
+
+        // The codegen'd padding only applies to allocations it makes
+        // itself, so add it here too.
+        used = true;
+        Expr new_expr = Call::make(Handle(), "halide_arena_malloc",
+                                   {Variable::make(Handle(), arena_name), heap_allocation_size(op)},
+                                   Call::Extern);
+        Stmt body = mutate(op->body);
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, body, new_expr, "halide_arena_free");
+    }
+
+public:
+    const string arena_name = unique_name("allocation_arena");
+    bool used = false;
+};
+
+class UseScratchArenas : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The arena of the innermost enclosing parallel loop, or empty if
+    // allocations here can't use one.
+    string arena;
+    bool used = false;
+
+    // Whether we're inside code offloaded to a device.
+    bool on_device = false;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            ScopedValue<bool> old_on_device(on_device, true);
+            ScopedValue<string> old_arena(arena, "");
+            return IRMutator2::visit(op);
+        }
+        if (op->for_type != ForType::Parallel || on_device) {
+            return IRMutator2::visit(op);
+        }
+
+        // Each iteration claims an arena for the allocations it makes,
+        // and resets it when it's done.
+        string name = unique_name("scratch_arena");
+        ScopedValue<string> old_arena(arena, name);
+        ScopedValue<bool> old_used(used, false);
+        Stmt body = mutate(op->body);
+        if (used) {
+            Expr new_expr = Call::make(Handle(), "halide_scratch_acquire", {}, Call::Extern);
+            body = Block::make(body, Free::make(name));
+            body = Allocate::make(name, UInt(8), MemoryType::Heap, {}, const_true(),
+                                  body, new_expr, "halide_scratch_release");
+        }
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const Fork *op) override {
+        // Both sides of a fork may run on other threads, concurrently
+        // with the rest of the iteration, so they can't share its
+        // arena.
+        ScopedValue<string> old_arena(arena, "");
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (arena.empty() || !on_heap(op)) {
+            return IRMutator2::visit(op);
+        }
+        used = true;
+        Expr new_expr = Call::make(Handle(), "halide_scratch_malloc",
+                                   {Variable::make(Handle(), arena), heap_allocation_size(op)},
+                                   Call::Extern);
+        Stmt body = mutate(op->body);
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, body, new_expr, "halide_scratch_free");
+    }
+};
+
+}  // namespace
+
+Stmt use_scratch_arenas(Stmt s, const Target &t) {
+    if (!t.has_feature(Target::ScratchArena)) {
+        return s;
+    }
+    return UseScratchArenas().mutate(s);
+}
+
+Stmt use_allocation_arena(Stmt s, const Target &t) {
+    if (!t.has_feature(Target::AllocationArena)) {
+        return s;
+    }
+    UseAllocationArena arena;
+    s = arena.mutate(s);
+    if (arena.used) {
+        Expr new_expr = Call::make(Handle(), "halide_arena_create", {}, Call::Extern);
+        s = Block::make(s, Free::make(arena.arena_name));
+        s = Allocate::make(arena.arena_name, UInt(8), MemoryType::Heap, {}, const_true(),
+                           s, new_expr, "halide_arena_destroy");
+    }
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,39 @@
+#ifndef HALIDE_ALLOCATION_ARENA_H
+#define HALIDE_ALLOCATION_ARENA_H
+
+/** \file
+ * Defines the lowering passes that serve the heap allocations of a
+ * pipeline from arenas.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite the heap allocations of a pipeline that happen once per
+ * invocation (those not inside any loop, fork, or acquire) to bump
+ * allocate from a single arena, which is created on entry to the
+ * pipeline and released in one go when it exits. The arena gets its
+ * memory from halide_malloc in large chunks, so a pipeline with many
+ * intermediates makes a handful of calls to the allocator instead of
+ * one per buffer. Memory freed early is not reused until the
+ * pipeline exits. Does nothing unless the target has the
+ * allocation_arena feature. */
+Stmt use_allocation_arena(Stmt s, const Target &t);
+
+/** Rewrite the heap allocations inside parallel loops to bump
+ * allocate from a scratch arena. Each iteration of a parallel loop
+ * claims an arena on entry and resets it on exit, and the worker
+ * threads of the thread pool keep reusing the same arenas, so these
+ * allocations neither go to halide_malloc nor contend with each other
+ * once the arenas have grown to fit. Memory is reclaimed when the most
+ * recent allocation still alive is freed. Does nothing unless the
+ * target has the scratch_arena feature. */
+Stmt use_scratch_arenas(Stmt s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
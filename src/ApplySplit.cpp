@@ -47,7 +47,8 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
         } else if (is_one(split.factor)) {
             // The split factor trivially divides the old extent,
             // but we know nothing new about the outer dimension.
-        } else if (tail == TailStrategy::GuardWithIf) {
+        } else if (tail == TailStrategy::GuardWithIf ||
+                   tail == TailStrategy::Predicate) {
             // It's an exact split but we failed to prove that the
             // extent divides the factor. Use predication.
 
@@ -63,9 +64,15 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
             result.push_back(ApplySplitResult(
                 prefix + split.old_var, rebased_var + old_min, ApplySplitResult::Substitution));
 
-            // Tell Halide to optimize for the case in which this
-            // condition is true by partitioning some outer loop.
-            Expr cond = likely(rebased_var < old_extent);
+            // For GuardWithIf, tell Halide to optimize for the case
+            // in which this condition is true by partitioning some
+            // outer loop. For Predicate, leave it unlikely, so that
+            // it stays in every iteration and gets vectorized into
+            // masked loads and stores.
+            Expr cond = rebased_var < old_extent;
+            if (tail == TailStrategy::GuardWithIf) {
+                cond = likely(cond);
+            }
             result.push_back(ApplySplitResult(cond));
             result.push_back(ApplySplitResult(rebased_var_name, rebased, ApplySplitResult::LetStmt));
 
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <set>
+
+#include "AutoPrefetch.h"
+#include "ExprUsesVar.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The latency assumed when MachineParams doesn't give one, in cycles.
+const int default_memory_latency = 300;
+
+// The furthest ahead to prefetch, in trips of the innermost loop.
+const int64_t max_prefetch_distance = 8;
+
+// Find the variable of a definition a loop variable of its stage was
+// split from, or the empty string if the loop variable is a fusion.
+string root_var(string var, const vector<Split> &splits) {
+    for (auto it = splits.rbegin(); it != splits.rend(); ++it) {
+        if (it->is_fuse()) {
+            if (it->old_var == var) {
+                return "";
+            }
+        } else if (it->outer == var || (it->is_split() && it->inner == var)) {
+            var = it->old_var;
+        }
+    }
+    return var;
+}
+
+// The number of iterations of a loop of a stage, if it's a
+// compile-time constant, and zero otherwise.
+int64_t constant_extent(const string &var, const Function &f, const Definition &def) {
+    for (const Split &s : def.schedule().splits()) {
+        if (s.is_split() && s.inner == var) {
+            const int64_t *factor = as_const_int(s.factor);
+            return factor ? *factor : 0;
+        }
+    }
+    for (const vector<Bound> *bounds : {&f.schedule().bounds(), &f.schedule().estimates()}) {
+        for (const Bound &b : *bounds) {
+            const int64_t *extent = b.extent.defined() ? as_const_int(b.extent) : nullptr;
+            if (b.var == var && extent) {
+                return *extent;
+            }
+        }
+    }
+    return 0;
+}
+
+class ContainsCall : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        result = true;
+    }
+
+    void visit(const Load *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+// Find the inputs a definition reads in rows along the variable of
+// its innermost loop, moving to other rows with the variable of the
+// loop outside it, including through the Funcs inlined into it.
+class FindStreamingLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<string, Function> &env;
+    const string &inner, &outer;
+    set<string> visited;
+
+    // Sites that depend on loaded values aren't predictable.
+    bool streams(const Call *op) {
+        if (op->args.empty() || !expr_uses_var(op->args[0], inner)) {
+            return false;
+        }
+        bool moves = false;
+        for (const Expr &e : op->args) {
+            ContainsCall c;
+            e.accept(&c);
+            if (c.result) {
+                return false;
+            }
+            moves = moves || expr_uses_var(e, outer);
+        }
+        return moves;
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Image && op->param.defined() &&
+            op->param.is_buffer()) {
+            if (streams(op)) {
+                inputs[op->param.name()] = op->param;
+            }
+        } else if (op->call_type == Call::Halide && visited.insert(op->name).second) {
+            auto it = env.find(op->name);
+            if (it == env.end() ||
+                !it->second.can_be_inlined() ||
+                !it->second.schedule().compute_level().is_inlined()) {
+                return;
+            }
+            // Look at the sites the inlined Func reads in terms of
+            // the variables of this stage.
+            const Function &g = it->second;
+            map<string, Expr> args;
+            for (size_t i = 0; i < g.args().size(); i++) {
+                args[g.args()[i]] = op->args[i];
+            }
+            for (const Expr &e : g.definition().values()) {
+                substitute(args, e).accept(this);
+            }
+        }
+    }
+
+public:
+    map<string, Parameter> inputs;
+
+    FindStreamingLoads(const map<string, Function> &env, const string &inner, const string &outer)
+        : env(env), inner(inner), outer(outer) {}
+};
+
+void prefetch_definition(const Function &f, Definition &def,
+                         const map<string, Function> &env, int latency) {
+    StageSchedule &schedule = def.schedule();
+    if (!schedule.prefetches().empty()) {
+        return;
+    }
+
+    // Skip the loops that vectorization and unrolling remove. The
+    // next one is the innermost loop, and the one outside that is
+    // where the rows read by later trips of it get prefetched. The
+    // last dimension is always __outermost.
+    const vector<Dim> &dims = schedule.dims();
+    size_t i = 0;
+    int64_t elements_per_trip = 1;
+    while (i < dims.size() &&
+           (dims[i].for_type == ForType::Vectorized || dims[i].for_type == ForType::Unrolled)) {
+        elements_per_trip *= constant_extent(dims[i].var, f, def);
+        i++;
+    }
+    if (i + 2 >= dims.size()) {
+        return;
+    }
+    const Dim &inner = dims[i], &outer = dims[i + 1];
+    if (inner.for_type != ForType::Serial || outer.for_type != ForType::Serial ||
+        outer.device_api != DeviceAPI::None) {
+        return;
+    }
+    elements_per_trip *= constant_extent(inner.var, f, def);
+
+    string inner_root = root_var(inner.var, schedule.splits());
+    string outer_root = root_var(outer.var, schedule.splits());
+    if (inner_root.empty() || outer_root.empty()) {
+        return;
+    }
+    FindStreamingLoads loads(env, inner_root, outer_root);
+    def.accept(&loads);
+    if (loads.inputs.empty()) {
+        return;
+    }
+
+    // Fetch far enough ahead to cover the memory latency, assuming
+    // about a cycle per element. If the length of a trip isn't known,
+    // it's probably long, so fetch for the next one.
+    int64_t distance = 1;
+    if (elements_per_trip > 0) {
+        distance = std::min(max_prefetch_distance,
+                            std::max((int64_t)1, (latency + elements_per_trip - 1) / elements_per_trip));
+    }
+    for (const auto &p : loads.inputs) {
+        debug(3) << "Prefetching " << p.first << " at " << f.name() << "." << outer.var
+                 << " with distance " << distance << "\n";
+        PrefetchDirective prefetch = {p.first, outer.var, (int)distance,
+                                      PrefetchBoundStrategy::GuardWithIf, p.second};
+        schedule.prefetches().push_back(prefetch);
+    }
+}
+
+}  // namespace
+
+void auto_prefetch(const map<string, Function> &env, const MachineParams &params) {
+    int latency = params.memory_latency > 0 ? params.memory_latency : default_memory_latency;
+    for (const auto &p : env) {
+        Function f = p.second;
+        if (f.has_extern_definition() || f.schedule().compute_level().is_inlined()) {
+            continue;
+        }
+        prefetch_definition(f, f.definition(), env, latency);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            prefetch_definition(f, f.update(i), env, latency);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
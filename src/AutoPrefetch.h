@@ -0,0 +1,34 @@
+#ifndef HALIDE_AUTO_PREFETCH_H
+#define HALIDE_AUTO_PREFETCH_H
+
+/** \file
+ * Defines the pass that adds prefetch directives to the stages of
+ * Funcs that stream through their inputs.
+ */
+
+#include <map>
+
+#include "AutoSchedule.h"
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Add prefetch directives to the stages of the Functions in env
+ * that stream through pipeline inputs: those whose innermost loop
+ * walks along the rows of an input, at sites computed from the loop
+ * variables alone, and whose next loop out moves to other rows. The
+ * rows read by a later trip of the innermost loop are prefetched at
+ * that next loop out, with a distance set by the memory latency in
+ * params and the number of iterations of the innermost loops, where
+ * that is known at compile time. Stages that already have prefetches
+ * are left alone. These directives are then lowered like those from
+ * \ref Func::prefetch. Used when the target has the auto_prefetch
+ * feature. */
+void auto_prefetch(const std::map<std::string, Function> &env,
+                   const MachineParams &params);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
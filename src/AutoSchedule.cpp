@@ -1,4 +1,9 @@
 #include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <random>
 #include <regex>
 
 #include "AutoSchedule.h"
@@ -7,12 +12,14 @@
 #include "FindCalls.h"
 #include "Func.h"
 #include "IREquality.h"
+#include "IRPrinter.h"
 #include "Inline.h"
 #include "ParallelRVar.h"
 #include "RealizationOrder.h"
 #include "RegionCosts.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 namespace Halide {
@@ -194,11 +201,23 @@ struct DependenceAnalysis {
     // Cache for bounds queries (bound queries with the same parameters are
     // common during the grouping process).
     map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
+    // Grouping choices are evaluated in parallel, so the cache is shared
+    // between threads.
+    std::mutex regions_required_mutex;
 
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
         : env(env), order(order), func_val_bounds(func_val_bounds) {}
 
+    // Mutexes can't be moved, so this only moves the analysis itself.
+    DependenceAnalysis &operator=(DependenceAnalysis &&other) {
+        env = std::move(other.env);
+        order = std::move(other.order);
+        func_val_bounds = std::move(other.func_val_bounds);
+        regions_required_cache = std::move(other.regions_required_cache);
+        return *this;
+    }
+
     // Return the regions of the producers ('prods') required to compute the region
     // of the function stage ('f', 'stage_num') specified by 'bounds'. When
     // 'only_regions_computed' is set to true, this only returns the computed
@@ -395,13 +414,16 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
 
     // Check the cache if we've already computed this previously.
     RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-            [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    {
+        std::lock_guard<std::mutex> lock(regions_required_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
+                [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
+            if (it != iter->second.end()) {
+                internal_assert((iter->first == query) && (it->bounds == bounds));
+                return it->regions;
+            }
         }
     }
 
@@ -584,7 +606,10 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
-    regions_required_cache[query].push_back(RegionsRequired(bounds, concrete_regions));
+    {
+        std::lock_guard<std::mutex> lock(regions_required_mutex);
+        regions_required_cache[query].push_back(RegionsRequired(bounds, concrete_regions));
+    }
     return concrete_regions;
 }
 
@@ -988,9 +1013,14 @@ struct Partitioner {
         // Estimate of the parallelism that can be exploited while computing
         // the group.
         Expr parallelism;
+        // Estimate of the peak memory (in bytes) allocated by the group, i.e.
+        // the output of the group at root and the group members computed
+        // within the tiles that are in flight at once.
+        Expr footprint;
 
         GroupAnalysis() : cost(Cost()) , parallelism(Expr()) {}
-        GroupAnalysis(const Cost &c, Expr p) : cost(c), parallelism(std::move(p)) {}
+        GroupAnalysis(const Cost &c, Expr p, Expr f = Expr())
+            : cost(c), parallelism(std::move(p)), footprint(std::move(f)) {}
 
         inline bool defined() const {
             return cost.defined() && parallelism.defined();
@@ -1001,12 +1031,16 @@ struct Partitioner {
             if (parallelism.defined()) {
                 parallelism = Internal::simplify(parallelism);
             }
+            if (footprint.defined()) {
+                footprint = Internal::simplify(footprint);
+            }
         }
 
         friend std::ostream& operator<<(std::ostream &stream, const GroupAnalysis &analysis) {
             stream << "[arith cost:" << analysis.cost.arith << ", ";
             stream << "memory cost:" << analysis.cost.memory << ", ";
-            stream << "parallelism:" << analysis.parallelism << "]\n";
+            stream << "parallelism:" << analysis.parallelism << ", ";
+            stream << "footprint:" << analysis.footprint << "]\n";
             return stream;
         }
     };
@@ -1097,8 +1131,10 @@ struct Partitioner {
     void group(Partitioner::Level level);
 
     // Given a grouping choice, return a configuration for the group that gives
-    // the highest estimated benefits.
-    GroupConfig evaluate_choice(const GroupingChoice &group, Partitioner::Level level);
+    // the highest estimated benefits. If 'parallel' is set, the tile
+    // configurations are evaluated in parallel.
+    GroupConfig evaluate_choice(const GroupingChoice &group, Partitioner::Level level,
+                                bool parallel = true);
 
     // Pick the best choice among all the grouping options currently available. Uses
     // the cost model to estimate the benefit of each choice. This returns a vector of
@@ -1123,8 +1159,10 @@ struct Partitioner {
 
     // Find the best tiling configuration for a group 'g' among a set of tile
     // configurations. This returns a pair of configuration with the highest
-    // estimated benefit and the estimated benefit.
-    pair<map<string, Expr>, GroupAnalysis> find_best_tile_config(const Group &g);
+    // estimated benefit and the estimated benefit. If 'parallel' is set, the
+    // configurations are analyzed in parallel.
+    pair<map<string, Expr>, GroupAnalysis> find_best_tile_config(const Group &g,
+                                                                 bool parallel = true);
 
     // Estimate the benefit (arithmetic + memory) of 'new_grouping' over 'old_grouping'.
     // Positive values indicates that 'new_grouping' may be preferrable over 'old_grouping'.
@@ -1145,6 +1183,14 @@ struct Partitioner {
     // groups within the pipeline.
     Cost get_pipeline_cost();
 
+    // Return the estimate of the peak memory allocated by all groups within
+    // the pipeline.
+    Expr get_pipeline_footprint();
+
+    // Return true if 'footprint' provably fits within the memory limit of
+    // 'arch_params', or if there is no limit.
+    bool fits_in_memory(const Expr &footprint);
+
     // Return the maximum access stride to allocation of 'func_acc' along any
     // loop variable specified in 'vars'. Access expressions along each dimension
     // of the allocation are specified by 'acc_exprs'. The dimension bounds of the
@@ -1176,6 +1222,13 @@ struct Partitioner {
     // auto scheduling.
     void generate_cpu_schedule(const Target &t, AutoSchedule &sched);
 
+    // Fuse the outermost loops of sibling groups computed at root with
+    // compute_with: pure groups with the same bounds and tile sizes that
+    // share a producer and don't depend on each other. Must be called after
+    // the schedules of the groups have been applied, since whether the
+    // outermost loops can be fused depends on them.
+    void fuse_sibling_groups(AutoSchedule &sched);
+
     // Same as \ref Partitioner::generate_cpu_schedule, but this generates and
     // applies schedules for a group of function stages.
 
@@ -1185,6 +1238,14 @@ struct Partitioner {
                                      const set<string> &inlines,
                                      AutoSchedule &sched);
 
+    // Decide whether a member 'f' of a group should be stored one loop level
+    // above the serial tile loop it is computed at, so that its computation
+    // slides along that loop. 'overlaps' are the regions of the members shared
+    // by adjacent iterations of the tile loop, and 'storage' the regions they
+    // span over all iterations of that loop.
+    bool should_slide(const Function &f, const map<string, Box> &overlaps,
+                      const map<string, Box> &storage);
+
     // Split the dimension of stage 'f_handle' along 'v' into inner and outer
     // dimensions. Modify 'estimates' according to the split and append the split
     // schedule to 'sched'.
@@ -1265,6 +1326,28 @@ Cost Partitioner::get_pipeline_cost() {
     return total_cost;
 }
 
+Expr Partitioner::get_pipeline_footprint() {
+    internal_assert(!group_costs.empty());
+
+    Expr footprint = make_zero(Int(64));
+    for (const pair<FStage, Group> &g : groups) {
+        const GroupAnalysis &analysis = get_element(group_costs, g.first);
+        if (!analysis.footprint.defined()) {
+            return Expr();
+        }
+        footprint += analysis.footprint;
+    }
+    return simplify(footprint);
+}
+
+bool Partitioner::fits_in_memory(const Expr &footprint) {
+    if (arch_params.max_memory == 0) {
+        return true;
+    }
+    return footprint.defined() &&
+        can_prove(footprint <= make_const(Int(64), (int64_t)arch_params.max_memory));
+}
+
 void Partitioner::disp_pipeline_costs() {
     internal_assert(!group_costs.empty());
     Cost total_cost(0, 0);
@@ -1418,6 +1501,35 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
                                        Partitioner::Level level) {
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
+
+    // Evaluating a choice only reads the current grouping, so evaluate
+    // all the choices that aren't in the cache in parallel first.
+    vector<GroupingChoice> uncached;
+    for (const auto &p : cands) {
+        const Function &prod_f = get_element(dep_analysis.env, p.first);
+        FStage prod(prod_f, prod_f.updates().size());
+        for (const FStage &c : get_element(children, prod)) {
+            GroupingChoice cand_choice(prod_f.name(), c);
+            if (!grouping_cache.count(cand_choice) &&
+                std::find(uncached.begin(), uncached.end(), cand_choice) == uncached.end()) {
+                uncached.push_back(cand_choice);
+            }
+        }
+    }
+    if (uncached.size() > 1) {
+        vector<GroupConfig> configs(uncached.size());
+        vector<std::function<void()>> jobs;
+        for (size_t i = 0; i < uncached.size(); i++) {
+            jobs.push_back([&, i]() {
+                configs[i] = evaluate_choice(uncached[i], level, false);
+            });
+        }
+        run_compile_jobs(jobs);
+        for (size_t i = 0; i < uncached.size(); i++) {
+            grouping_cache.emplace(uncached[i], configs[i]);
+        }
+    }
+
     for (const auto &p : cands) {
         // Compute the aggregate benefit of inlining into all the children.
         vector<pair<GroupingChoice, GroupConfig>> grouping;
@@ -1581,7 +1693,7 @@ vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg)
 }
 
 pair<map<string, Expr>, Partitioner::GroupAnalysis>
-Partitioner::find_best_tile_config(const Group &g) {
+Partitioner::find_best_tile_config(const Group &g, bool parallel) {
     // Initialize to no tiling
     map<string, Expr> no_tile_config;
     Group no_tile = g;
@@ -1599,12 +1711,44 @@ Partitioner::find_best_tile_config(const Group &g) {
     // Generate tiling configurations
     vector<map<string, Expr>> configs = generate_tile_configs(g.output);
 
+    // Analyze the configurations up front (in parallel if requested), and
+    // then pick the best one in order.
+    vector<GroupAnalysis> analyses(configs.size());
+    vector<std::function<void()>> jobs;
+    for (size_t i = 0; i < configs.size(); i++) {
+        jobs.push_back([&, i]() {
+            Group new_group = g;
+            new_group.tile_sizes = configs[i];
+            analyses[i] = analyze_group(new_group, show_analysis);
+        });
+    }
+    if (parallel) {
+        run_compile_jobs(jobs);
+    } else {
+        for (const auto &job : jobs) {
+            job();
+        }
+    }
+
     Group best_group = g;
-    for (const auto &config : configs) {
+    for (size_t i = 0; i < configs.size(); i++) {
+        const auto &config = configs[i];
         Group new_group = g;
         new_group.tile_sizes = config;
 
-        GroupAnalysis new_analysis = analyze_group(new_group, show_analysis);
+        const GroupAnalysis &new_analysis = analyses[i];
+
+        // Reject configurations that need too much memory, but prefer any
+        // that fits over a best configuration so far that doesn't.
+        if (!fits_in_memory(new_analysis.footprint)) {
+            continue;
+        }
+        if (new_analysis.cost.defined() && !fits_in_memory(best_analysis.footprint)) {
+            best_config = config;
+            best_analysis = new_analysis;
+            best_group = new_group;
+            continue;
+        }
 
         bool no_redundant_work = false;
         Expr benefit = estimate_benefit(best_analysis, new_analysis,
@@ -1958,6 +2102,23 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
 
     // Linear dropoff
     float load_slope = arch_params.balance / arch_params.last_level_cache_size;
+    auto load_cost_factor = [&](const Expr &footprint) -> Expr {
+        if (!arch_params.l1_cache_size || !arch_params.l2_cache_size) {
+            return cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        }
+        // With a known cache hierarchy, loads from footprints that fit
+        // in L1 cost the same as arithmetic; the cost then climbs
+        // linearly to the geometric mean of 1 and 'balance' at the L2
+        // size, and on to 'balance' at the last level cache size.
+        float l1 = (float)arch_params.l1_cache_size;
+        float l2 = (float)arch_params.l2_cache_size;
+        float llc = (float)arch_params.last_level_cache_size;
+        float l2_balance = std::sqrt(arch_params.balance);
+        Expr f = cast<float>(footprint);
+        Expr factor = min(1 + max(f - l1, 0) * ((l2_balance - 1) / (l2 - l1)), l2_balance);
+        factor += max(f - l2, 0) * ((arch_params.balance - l2_balance) / (llc - l2));
+        return cast<int64_t>(min(factor, arch_params.balance));
+    };
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure fuction \"" << f_load.first
@@ -1999,8 +2160,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
 
             if (model_reuse) {
-                Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                Expr initial_factor = load_cost_factor(initial_footprint);
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -2011,7 +2171,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = load_cost_factor(footprint);
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -2026,9 +2186,39 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
         debug(0) << "Per tile arith cost:" << per_tile_cost.arith << '\n';
     }
 
+    // The output of the group is allocated at root, unless it is an output of
+    // the pipeline, and the other members are allocated per tile. Stages of a
+    // function share the allocation, so only the group of the initial stage
+    // accounts for it.
+    Expr footprint = make_zero(Int(64));
+    bool is_pipeline_output = false;
+    for (const Function &f : outputs) {
+        is_pipeline_output |= (f.name() == g.output.func.name());
+    }
+    if ((g.output.stage_num == 0) && !is_pipeline_output) {
+        footprint = costs.region_size(g.output.func.name(),
+                                      get_element(pipeline_bounds, g.output.func.name()));
+    }
+    Expr tile_footprint = make_zero(Int(64));
+    for (const auto &reg : alloc_regions) {
+        if ((group_members.find(reg.first) != group_members.end()) &&
+            (reg.first != g.output.func.name()) &&
+            (g.inlined.find(reg.first) == g.inlined.end())) {
+            Expr size = costs.region_size(reg.first, reg.second);
+            tile_footprint = size.defined() && tile_footprint.defined() ?
+                tile_footprint + size : Expr();
+        }
+    }
+    if (footprint.defined() && tile_footprint.defined()) {
+        Expr tiles_in_flight = min(parallelism, arch_params.parallelism);
+        footprint += tile_footprint * tiles_in_flight;
+    } else {
+        footprint = Expr();
+    }
+
     GroupAnalysis g_analysis(
         Cost(per_tile_cost.arith * estimate_tiles, per_tile_cost.memory * estimate_tiles),
-        parallelism);
+        parallelism, footprint);
     g_analysis.simplify();
 
     return g_analysis;
@@ -2091,7 +2281,8 @@ void Partitioner::merge_groups(const GroupingChoice &choice, const GroupConfig &
 }
 
 Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choice,
-                                                      Partitioner::Level level) {
+                                                      Partitioner::Level level,
+                                                      bool parallel) {
     // Create a group that reflects the grouping choice and evaluate the cost
     // of the group.
     const Function &prod_f = get_element(dep_analysis.env, choice.prod);
@@ -2139,7 +2330,7 @@ Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choi
         best_tile_config = tile_sizes;
 
     } else {
-        pair<map<string, Expr>, GroupAnalysis> config = find_best_tile_config(group);
+        pair<map<string, Expr>, GroupAnalysis> config = find_best_tile_config(group, parallel);
         best_tile_config = config.first;
         group_analysis = config.second;
     }
@@ -2177,7 +2368,7 @@ Expr Partitioner::estimate_benefit(
 
     set<FStage> old_groups;
 
-    GroupAnalysis new_group_analysis(Cost(0, 0), Int(64).max());
+    GroupAnalysis new_group_analysis(Cost(0, 0), Int(64).max(), make_zero(Int(64)));
     for (const auto &g : new_grouping) {
         const Function &prod_f = get_element(dep_analysis.env, g.first.prod);
         int num_prod_stages = prod_f.updates().size() + 1;
@@ -2194,6 +2385,8 @@ Expr Partitioner::estimate_benefit(
             new_group_analysis.cost.memory += analysisg.cost.memory;
             new_group_analysis.parallelism = min(new_group_analysis.parallelism,
                                                  analysisg.parallelism);
+            new_group_analysis.footprint = analysisg.footprint.defined() && new_group_analysis.footprint.defined() ?
+                new_group_analysis.footprint + analysisg.footprint : Expr();
         } else {
             new_group_analysis.cost = Cost();
             new_group_analysis.parallelism = Expr();
@@ -2202,7 +2395,7 @@ Expr Partitioner::estimate_benefit(
     }
     new_group_analysis.simplify();
 
-    GroupAnalysis old_group_analysis(Cost(0, 0), Int(64).max());
+    GroupAnalysis old_group_analysis(Cost(0, 0), Int(64).max(), make_zero(Int(64)));
     for (const auto &g : old_groups) {
         const auto &iter = group_costs.find(g);
         internal_assert(iter != group_costs.end());
@@ -2212,6 +2405,8 @@ Expr Partitioner::estimate_benefit(
             old_group_analysis.cost.memory += analysisg.cost.memory;
             old_group_analysis.parallelism = min(old_group_analysis.parallelism,
                                                  analysisg.parallelism);
+            old_group_analysis.footprint = analysisg.footprint.defined() && old_group_analysis.footprint.defined() ?
+                old_group_analysis.footprint + analysisg.footprint : Expr();
         } else {
             old_group_analysis.cost = Cost();
             old_group_analysis.parallelism = Expr();
@@ -2220,6 +2415,22 @@ Expr Partitioner::estimate_benefit(
     }
     old_group_analysis.simplify();
 
+    // Reject groupings that would take the pipeline over the memory limit,
+    // unless they at least reduce the memory used.
+    if (arch_params.max_memory) {
+        Expr pipeline_footprint = get_pipeline_footprint();
+        if (!new_group_analysis.footprint.defined() ||
+            !old_group_analysis.footprint.defined() || !pipeline_footprint.defined()) {
+            return Expr();
+        }
+        Expr new_footprint = simplify(pipeline_footprint - old_group_analysis.footprint +
+                                      new_group_analysis.footprint);
+        if (!fits_in_memory(new_footprint) &&
+            !can_prove(new_group_analysis.footprint <= old_group_analysis.footprint)) {
+            return Expr();
+        }
+    }
+
     return estimate_benefit(old_group_analysis, new_group_analysis,
                             no_redundant_work, ensure_parallelism);
 }
@@ -2409,6 +2620,9 @@ pair<VarOrRVar, VarOrRVar> Partitioner::split_dim(
         case TailStrategy::ShiftInwards:
             oss << ", TailStrategy::ShiftInwards)";
             break;
+        case TailStrategy::Predicate:
+            oss << ", TailStrategy::Predicate)";
+            break;
         case TailStrategy::Auto:
             oss << ")";
             break;
@@ -2629,6 +2843,37 @@ public :
     }
 };
 
+bool Partitioner::should_slide(const Function &f, const map<string, Box> &overlaps,
+                               const map<string, Box> &storage) {
+    if (f.has_extern_definition() || !f.updates().empty()) {
+        return false;
+    }
+
+    // Sliding only pays off if adjacent tiles share some of the region of 'f'.
+    auto overlap = overlaps.find(f.name());
+    if (overlap == overlaps.end()) {
+        return false;
+    }
+    for (size_t i = 0; i < overlap->second.size(); i++) {
+        Expr extent = get_extent(overlap->second[i]);
+        if (!extent.defined() || !can_prove(extent > 0)) {
+            return false;
+        }
+    }
+
+    // Storage folding might fail, e.g. if the tile loop does not walk the
+    // region of 'f' monotonically, in which case 'f' is allocated for the
+    // whole extent of the tile loop. Only slide if that still fits in the
+    // last level cache.
+    auto strip = storage.find(f.name());
+    if (strip == storage.end()) {
+        return false;
+    }
+    Expr size = costs.region_size(f.name(), strip->second);
+    return size.defined() &&
+        can_prove(size <= make_const(Int(64), (int64_t)arch_params.last_level_cache_size));
+}
+
 void Partitioner::generate_group_cpu_schedule(
         const Group &g, const Target &t,
         const map<FStage, DimBounds> &group_loop_bounds,
@@ -2654,6 +2899,45 @@ void Partitioner::generate_group_cpu_schedule(
     DimBounds stg_bounds = get_bounds(g.output);
     map<string, Expr> stg_estimates = bounds_to_estimates(stg_bounds);
 
+    // Find the regions of the group members that would be shared by adjacent
+    // tiles along each tiled dimension of the group output, and the regions
+    // they would span over a whole row of tiles along that dimension. These
+    // are used to decide whether to slide the members over the tile loops
+    // and need to be computed before the dimensions of the group output are
+    // altered by the schedule.
+    map<string, map<string, Box>> slide_overlaps;
+    map<string, map<string, Box>> slide_storage;
+    if (!g.tile_sizes.empty()) {
+        set<string> members;
+        for (const FStage &mem : g.members) {
+            members.insert(mem.func.name());
+        }
+        DimBounds tile_bounds = get_bounds_from_tile_sizes(g.output, g.tile_sizes);
+        for (const auto &tile : g.tile_sizes) {
+            const string &var = tile.first;
+            // Members can only slide along tiled pure dimensions.
+            const vector<string> &args = g_out.args();
+            if (std::find(args.begin(), args.end(), var) == args.end()) {
+                continue;
+            }
+            Expr extent = get_extent(get_element(stg_bounds, var));
+            if (!extent.defined() || !can_prove(extent >= 2 * tile.second)) {
+                continue;
+            }
+            slide_overlaps[var] = dep_analysis.redundant_regions(
+                g_out, g.output.stage_num, var, tile_bounds, members, true,
+                &costs.input_estimates);
+
+            // If folding fails, the members are allocated for all iterations
+            // of the tile loop.
+            DimBounds strip_bounds = tile_bounds;
+            strip_bounds[var] = get_element(stg_bounds, var);
+            slide_storage[var] = dep_analysis.regions_required(
+                g_out, g.output.stage_num, strip_bounds, members, false,
+                &costs.input_estimates);
+        }
+    }
+
     Stage f_handle = Stage(Func(g_out));
 
     // Get a function handle for scheduling the stage
@@ -2668,6 +2952,9 @@ void Partitioner::generate_group_cpu_schedule(
     // Realize tiling and update the dimension estimates
     vector<VarOrRVar> outer_dims;
     vector<VarOrRVar> inner_dims;
+    // Map from the name of each outer tile dimension to the dimension of
+    // the stage it was split from.
+    map<string, string> outer_dim_origin;
 
     // Get the definition corresponding to the stage
     Definition def = get_stage_definition(g_out, g.output.stage_num);
@@ -2712,6 +2999,7 @@ void Partitioner::generate_group_cpu_schedule(
             const Expr &tile_size = iter->second;
             if (can_prove(tile_size == 1)) {
                 outer_dims.push_back(v);
+                outer_dim_origin[v.name()] = var;
             } else {
                 pair<VarOrRVar, VarOrRVar> tile_vars =
                     split_dim(g, f_handle, g.output.stage_num, def, true, v,
@@ -2719,6 +3007,7 @@ void Partitioner::generate_group_cpu_schedule(
 
                 inner_dims.push_back(tile_vars.first);
                 outer_dims.push_back(tile_vars.second);
+                outer_dim_origin[tile_vars.second.name()] = var;
 
                 if (is_rvar) {
                     rvars.erase(var);
@@ -2826,6 +3115,26 @@ void Partitioner::generate_group_cpu_schedule(
         tile_inner_var = VarOrRVar(var_name, is_rvar);
     }
 
+    // If the loop the members are computed at is serial and nested inside
+    // another loop of the group output, the members can be stored at the
+    // enclosing loop instead. Halide then slides the computation of the
+    // members along the tile loop, so that the regions shared by adjacent
+    // tiles are computed only once, and folds their storage down to the
+    // window that is live across iterations.
+    VarOrRVar store_var("", false);
+    string slide_var;
+    if (!outer_dims.empty() && !tile_inner_var.is_rvar &&
+        (tile_inner_index + 2 < (int)dims.size()) &&
+        (dims[tile_inner_index].for_type == ForType::Serial) &&
+        !dims[tile_inner_index + 1].is_rvar()) {
+        auto origin = outer_dim_origin.find(tile_inner_var.name());
+        if ((origin != outer_dim_origin.end()) &&
+            (slide_overlaps.find(origin->second) != slide_overlaps.end())) {
+            store_var = VarOrRVar(get_base_name(dims[tile_inner_index + 1].var), false);
+            slide_var = origin->second;
+        }
+    }
+
     for (const FStage &mem : g.members) {
         // Skip member stages that have been inlined or stage that is the
         // output stage of the group
@@ -2856,6 +3165,15 @@ void Partitioner::generate_group_cpu_schedule(
             mem_handle = Func(mem.func).update(mem.stage_num - 1);
         } else {
             if (!outer_dims.empty()) {
+                if (!slide_var.empty() &&
+                    should_slide(mem.func, get_element(slide_overlaps, slide_var),
+                                 get_element(slide_storage, slide_var))) {
+                    Func(mem.func).store_at(Func(g_out), store_var.var);
+                    string sanitized_g_out = get_sanitized_name(g_out.name());
+                    sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                        "store_at(" + sanitized_g_out + ", " + store_var.name() + ")",
+                                        {sanitized_g_out, store_var.name()});
+                }
                 if (tile_inner_var.is_rvar) {
                     Func(mem.func).compute_at(Func(g_out), tile_inner_var.rvar);
                 } else {
@@ -2915,6 +3233,138 @@ void Partitioner::generate_cpu_schedule(const Target &t, AutoSchedule &sched) {
         generate_group_cpu_schedule(g.second, t, get_element(loop_bounds, g.first),
                                     get_element(storage_bounds, g.first), inlines, sched);
     }
+
+    fuse_sibling_groups(sched);
+}
+
+void Partitioner::fuse_sibling_groups(AutoSchedule &sched) {
+    // Find the functions each function depends on, directly or
+    // indirectly.
+    map<string, set<string>> consumers;
+    for (const auto &c : children) {
+        for (const FStage &cons : c.second) {
+            if (cons.func.name() != c.first.func.name()) {
+                consumers[c.first.func.name()].insert(cons.func.name());
+            }
+        }
+    }
+    auto depends_on = [&consumers](const string &cons, const string &prod) {
+        set<string> visited;
+        vector<string> pending = {prod};
+        while (!pending.empty()) {
+            string f = pending.back();
+            pending.pop_back();
+            for (const string &c : consumers[f]) {
+                if (c == cons) {
+                    return true;
+                }
+                if (visited.insert(c).second) {
+                    pending.push_back(c);
+                }
+            }
+        }
+        return false;
+    };
+
+    // The candidates are the outputs of groups of single-stage functions,
+    // in realization order.
+    vector<const Group *> candidates;
+    for (const auto &g : groups) {
+        const Function &f = g.second.output.func;
+        if (f.has_extern_definition() || !f.updates().empty() ||
+            !f.definition().specializations().empty()) {
+            continue;
+        }
+        candidates.push_back(&g.second);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [&sched](const Group *a, const Group *b) {
+                  return (get_element(sched.topological_order, a->output.func.name()) <
+                          get_element(sched.topological_order, b->output.func.name()));
+              });
+
+    auto outermost_dim = [](const Function &f) {
+        // The last dimension is __outermost.
+        const vector<Dim> &dims = f.definition().schedule().dims();
+        internal_assert(dims.size() >= 2);
+        return dims[dims.size() - 2];
+    };
+
+    auto can_fuse = [&](const Group &parent, const Group &g) {
+        const Function &pf = parent.output.func;
+        const Function &f = g.output.func;
+
+        // Identical bounds and tiling make the fused loops line up exactly.
+        const Box &pb = get_element(pipeline_bounds, pf.name());
+        const Box &b = get_element(pipeline_bounds, f.name());
+        if (pb.size() != b.size() || parent.tile_sizes.size() != g.tile_sizes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < b.size(); i++) {
+            if (!equal(pb[i].min, b[i].min) || !equal(pb[i].max, b[i].max)) {
+                return false;
+            }
+        }
+        for (const auto &tile : g.tile_sizes) {
+            auto iter = parent.tile_sizes.find(tile.first);
+            if (iter == parent.tile_sizes.end() || !equal(iter->second, tile.second)) {
+                return false;
+            }
+        }
+
+        const Dim &pd = outermost_dim(pf);
+        const Dim &d = outermost_dim(f);
+        if (get_base_name(pd.var) != get_base_name(d.var) ||
+            pd.for_type != d.for_type ||
+            pd.device_api != d.device_api ||
+            pd.dim_type != d.dim_type) {
+            return false;
+        }
+
+        // Fusion only saves memory traffic if they read something in common.
+        set<string> pp = get_parents(pf, 0);
+        set<string> p = get_parents(f, 0);
+        return std::any_of(p.begin(), p.end(),
+                           [&pp](const string &n) { return pp.count(n) > 0; });
+    };
+
+    // Each fused set is a parent and the groups computed with it.
+    vector<vector<const Group *>> fused;
+    for (const Group *g : candidates) {
+        const string &name = g->output.func.name();
+        bool done = false;
+        for (auto &siblings : fused) {
+            const Group *parent = siblings[0];
+            if (!can_fuse(*parent, *g)) {
+                continue;
+            }
+            bool independent = true;
+            for (const Group *m : siblings) {
+                const string &m_name = m->output.func.name();
+                if (depends_on(name, m_name) || depends_on(m_name, name)) {
+                    independent = false;
+                    break;
+                }
+            }
+            if (!independent) {
+                continue;
+            }
+
+            string var = get_base_name(outermost_dim(g->output.func).var);
+            const Function &pf = parent->output.func;
+            debug(1) << "Computing " << name << " with " << pf.name() << " at " << var << "\n";
+            Func(g->output.func).compute_with(Func(pf), Var(var));
+            string sanitized_parent = get_sanitized_name(pf.name());
+            sched.push_schedule(name, 0, "compute_with(" + sanitized_parent + ", " + var + ")",
+                                {sanitized_parent, var});
+            siblings.push_back(g);
+            done = true;
+            break;
+        }
+        if (!done) {
+            fused.push_back({g});
+        }
+    }
 }
 
 Expr Partitioner::find_max_access_stride(const Scope<> &vars,
@@ -3321,6 +3771,275 @@ bool inline_unbounded(const vector<Function> &outputs,
     return inlined;
 }
 
+// Collect the parameters and concrete buffers a pipeline depends on, so
+// that their estimates can be part of the schedule database key.
+class FindPipelineInputs : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+        if (op->image.defined()) {
+            images[op->image.name()] = op->image;
+        }
+    }
+
+public:
+    map<string, Parameter> params;
+    map<string, Buffer<>> images;
+};
+
+// Names made unique within a process get a '$n' suffix, which depends
+// on what else the process has defined. Strip these so that the same
+// pipeline maps to the same database entry in every process.
+string strip_unique_suffixes(const string &name) {
+    string result;
+    result.reserve(name.size());
+    for (size_t i = 0; i < name.size(); i++) {
+        if (name[i] == '$' && i + 1 < name.size() && isdigit((unsigned char)name[i + 1])) {
+            while (i + 1 < name.size() && isdigit((unsigned char)name[i + 1])) {
+                i++;
+            }
+        } else {
+            result += name[i];
+        }
+    }
+    return result;
+}
+
+void print_definition_for_key(std::ostream &key, const Definition &def) {
+    key << " args";
+    for (const Expr &e : def.args()) {
+        key << " " << e;
+    }
+    key << " values";
+    for (const Expr &e : def.values()) {
+        key << " " << e;
+    }
+    key << " predicate " << def.predicate();
+    for (const Specialization &s : def.specializations()) {
+        key << " specialize " << s.condition;
+        print_definition_for_key(key, s.definition);
+    }
+    key << "\n";
+}
+
+// A canonical description of everything the auto-scheduler's result
+// depends on: the function DAG, the estimates on its inputs and
+// outputs, the target, and the machine parameters. This must be computed
+// before any of the inlining pre-passes modify the definitions.
+string schedule_database_key(const vector<string> &order,
+                             const map<string, Function> &env,
+                             const Target &target,
+                             const MachineParams &arch_params) {
+    std::ostringstream key;
+    key << "version 1\n"
+        << "target " << target.to_string() << "\n"
+        << "params " << arch_params.to_string() << "\n";
+    FindPipelineInputs inputs;
+    for (const string &name : order) {
+        const Function &f = env.at(name);
+        key << "func " << name << " " << f.dimensions();
+        for (const Type &t : f.output_types()) {
+            key << " " << t;
+        }
+        key << "\n";
+        if (f.has_extern_definition()) {
+            key << " extern " << f.extern_function_name() << "\n";
+        } else {
+            print_definition_for_key(key, f.definition());
+            for (const Definition &u : f.updates()) {
+                print_definition_for_key(key, u);
+            }
+        }
+        for (const Bound &b : f.schedule().estimates()) {
+            key << " estimate " << b.var << " " << b.min << " " << b.extent << "\n";
+        }
+        f.accept(&inputs);
+    }
+    for (const auto &it : inputs.params) {
+        const Parameter &p = it.second;
+        key << "param " << p.name() << " " << p.type();
+        if (p.is_buffer()) {
+            for (int d = 0; d < p.dimensions(); d++) {
+                key << " [" << p.min_constraint_estimate(d) << ", "
+                    << p.extent_constraint_estimate(d) << "]";
+            }
+        } else {
+            key << " " << p.estimate();
+        }
+        key << "\n";
+    }
+    for (const auto &it : inputs.images) {
+        const Buffer<> &b = it.second;
+        key << "image " << it.first << " " << b.type();
+        for (int d = 0; d < b.dimensions(); d++) {
+            key << " [" << b.dim(d).min() << ", " << b.dim(d).extent() << "]";
+        }
+        key << "\n";
+    }
+    return strip_unique_suffixes(key.str());
+}
+
+uint64_t schedule_database_hash(const string &key, uint64_t seed) {
+    // FNV-1a
+    uint64_t h = seed;
+    for (char c : key) {
+        h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// The path of the database entry for a key, or the empty string if the
+// schedule database is disabled.
+string schedule_database_path(const string &key) {
+    string dir = get_env_variable("HL_AUTOSCHEDULE_DB");
+    if (dir.empty()) {
+        return "";
+    }
+    std::ostringstream path;
+    path << dir << "/" << std::hex << schedule_database_hash(key, 14695981039346656037ULL) << ".sched";
+    return path.str();
+}
+
+// Database entries are a line identifying the key, followed by one
+// line per group:
+//   group <func> <stage> members <n> (<func> <stage>)* inlined <n> <func>* tiles <n> (<var> <bits> <size>)*
+void save_schedule_database_entry(const string &path, const string &key,
+                                  const map<FStage, Partitioner::Group> &groups) {
+    std::ostringstream entry;
+    entry << "halide_autoschedule " << key.size() << " "
+          << schedule_database_hash(key, 0x84222325cbf29ce4ULL) << "\n";
+    for (const auto &g : groups) {
+        const Partitioner::Group &group = g.second;
+        entry << "group " << strip_unique_suffixes(group.output.func.name()) << " " << group.output.stage_num
+              << " members " << group.members.size();
+        for (const FStage &m : group.members) {
+            entry << " " << strip_unique_suffixes(m.func.name()) << " " << m.stage_num;
+        }
+        entry << " inlined " << group.inlined.size();
+        for (const string &i : group.inlined) {
+            entry << " " << strip_unique_suffixes(i);
+        }
+        entry << " tiles " << group.tile_sizes.size();
+        for (const auto &t : group.tile_sizes) {
+            const int64_t *size = as_const_int(t.second);
+            if (!size) {
+                debug(1) << "Not saving schedule with non-constant tile size " << t.second << "\n";
+                return;
+            }
+            entry << " " << t.first << " " << t.second.type().bits() << " " << *size;
+        }
+        entry << "\n";
+    }
+
+    // Write to a temporary file and rename it into place, so that
+    // concurrent builds never see a partial entry.
+    string tmp = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream f(tmp);
+        f << entry.str();
+        if (!f.good()) {
+            debug(1) << "Failed to write schedule database entry " << tmp << "\n";
+            f.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+    }
+}
+
+// Load the grouping stored for a key. Returns false if there is no
+// usable entry, in which case the caller should search from scratch.
+bool load_schedule_database_entry(const string &path, const string &key,
+                                  const map<string, Function> &env,
+                                  map<FStage, Partitioner::Group> &groups) {
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        return false;
+    }
+    string magic;
+    size_t key_size = 0;
+    uint64_t key_hash = 0;
+    f >> magic >> key_size >> key_hash;
+    if (magic != "halide_autoschedule" ||
+        key_size != key.size() ||
+        key_hash != schedule_database_hash(key, 0x84222325cbf29ce4ULL)) {
+        return false;
+    }
+
+    // Entries refer to Funcs by their names without unique suffixes.
+    map<string, Function> funcs;
+    for (const auto &it : env) {
+        if (!funcs.emplace(strip_unique_suffixes(it.first), it.second).second) {
+            // Two Funcs differ only in their suffixes, so we can't
+            // tell which one an entry means.
+            return false;
+        }
+    }
+
+    auto read_stage = [&](FStage *stage) {
+        string name;
+        uint32_t stage_num = 0;
+        if (!(f >> name >> stage_num)) return false;
+        auto it = funcs.find(name);
+        if (it == funcs.end() || stage_num > it->second.updates().size()) return false;
+        *stage = FStage(it->second, stage_num);
+        return true;
+    };
+
+    map<FStage, Partitioner::Group> result;
+    string tag;
+    while (f >> tag) {
+        FStage output(Function(), 0);
+        size_t n = 0;
+        if (tag != "group" || !read_stage(&output) ||
+            !(f >> tag >> n) || tag != "members") {
+            return false;
+        }
+        vector<FStage> members;
+        for (size_t i = 0; i < n; i++) {
+            FStage m(Function(), 0);
+            if (!read_stage(&m)) return false;
+            members.push_back(m);
+        }
+        Partitioner::Group group(output, members);
+        if (!(f >> tag >> n) || tag != "inlined") return false;
+        for (size_t i = 0; i < n; i++) {
+            string name;
+            if (!(f >> name) || !funcs.count(name)) return false;
+            group.inlined.insert(funcs.at(name).name());
+        }
+        if (!(f >> tag >> n) || tag != "tiles") return false;
+        for (size_t i = 0; i < n; i++) {
+            string var;
+            int bits = 0;
+            int64_t size = 0;
+            if (!(f >> var >> bits >> size) ||
+                (bits != 8 && bits != 16 && bits != 32 && bits != 64)) {
+                return false;
+            }
+            group.tile_sizes[var] = make_const(Int(bits), size);
+        }
+        result.emplace(output, group);
+    }
+    if (result.empty()) {
+        return false;
+    }
+    groups.swap(result);
+    return true;
+}
+
 }  // anonymous namespace
 
 // Generate schedules for all functions in the pipeline required to compute the
@@ -3347,6 +4066,14 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     debug(2) << "Computing topological order...\n";
     vector<string> top_order = topological_order(outputs, env);
 
+    // If there is a schedule database, key it on the pipeline as the
+    // user wrote it, before any of the pre-passes below modify it.
+    string db_key, db_path;
+    if (!get_env_variable("HL_AUTOSCHEDULE_DB").empty()) {
+        db_key = schedule_database_key(top_order, env, target, arch_params);
+        db_path = schedule_database_path(db_key);
+    }
+
     // Validate that none of the functions in the pipeline have partial schedules.
     debug(2) << "Validating no partial schedules...\n";
     for (const auto &iter : env) {
@@ -3487,25 +4214,48 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         part.disp_pipeline_bounds();
     }
 
-    debug(2) << "Partitioner initializing groups...\n";
-    part.initialize_groups();
-    if (debug::debug_level() >= 3) {
-        part.disp_pipeline_costs();
-    }
+    if (!db_path.empty() && load_schedule_database_entry(db_path, db_key, env, part.groups)) {
+        // The grouping search is the expensive part, and its result
+        // only depends on the key, so skip straight to generating the
+        // schedule.
+        debug(1) << "Reusing grouping from schedule database entry " << db_path << "\n";
+        if (debug::debug_level() >= 3) {
+            part.disp_grouping();
+        }
+    } else {
+        debug(2) << "Partitioner initializing groups...\n";
+        part.initialize_groups();
+        if (debug::debug_level() >= 3) {
+            part.disp_pipeline_costs();
+        }
 
-    debug(2) << "Partitioner computing inline group...\n";
-    part.group(Partitioner::Level::Inline);
-    if (debug::debug_level() >= 3) {
-        part.disp_grouping();
-    }
+        debug(2) << "Partitioner computing inline group...\n";
+        part.group(Partitioner::Level::Inline);
+        if (debug::debug_level() >= 3) {
+            part.disp_grouping();
+        }
 
-    debug(2) << "Partitioner computing fast-mem group...\n";
-    part.grouping_cache.clear();
-    part.group(Partitioner::Level::FastMem);
-    if (debug::debug_level() >= 3) {
-        part.disp_pipeline_costs();
-        part.disp_grouping();
-        part.disp_pipeline_graph();
+        debug(2) << "Partitioner computing fast-mem group...\n";
+        part.grouping_cache.clear();
+        part.group(Partitioner::Level::FastMem);
+        if (debug::debug_level() >= 3) {
+            part.disp_pipeline_costs();
+            part.disp_grouping();
+            part.disp_pipeline_graph();
+        }
+
+        Expr footprint = part.get_pipeline_footprint();
+        debug(1) << "Estimated peak memory footprint of the schedule: " << footprint << " bytes\n";
+        if (!part.fits_in_memory(footprint)) {
+            user_warning << "Could not find a schedule that provably fits in "
+                         << arch_params.max_memory << " bytes of memory. "
+                         << "The estimated peak memory footprint is " << footprint << " bytes.\n";
+        }
+
+        if (!db_path.empty()) {
+            debug(1) << "Saving grouping to schedule database entry " << db_path << "\n";
+            save_schedule_database_entry(db_path, db_key, part.groups);
+        }
     }
 
     debug(2) << "Initializing AutoSchedule...\n";
@@ -3536,23 +4286,104 @@ MachineParams MachineParams::generic() {
     std::string params = Internal::get_env_variable("HL_MACHINE_PARAMS");
     if (params.empty()) {
         return MachineParams(16, 16 * 1024 * 1024, 40);
+    } else if (params == "host") {
+        return host();
     } else {
         return MachineParams(params);
     }
 }
 
+namespace {
+
+#ifdef __linux__
+// Read a cache size such as "32K" from sysfs. Returns 0 if unavailable.
+uint64_t read_sysfs_cache_size(const std::string &path) {
+    std::ifstream f(path);
+    uint64_t size = 0;
+    std::string suffix;
+    if (!(f >> size)) {
+        return 0;
+    }
+    f >> suffix;
+    if (suffix == "K") {
+        size *= 1024;
+    } else if (suffix == "M") {
+        size *= 1024 * 1024;
+    }
+    return size;
+}
+#endif
+
+}  // namespace
+
+MachineParams MachineParams::host() {
+    MachineParams params(16, 16 * 1024 * 1024, 40);
+    params.parallelism = (int)Internal::ThreadPool<void>::num_processors_online();
+#ifdef __linux__
+    // Walk the data and unified caches of the first CPU.
+    for (int i = 0; i < 8; i++) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        std::ifstream type_file(dir + "type"), level_file(dir + "level");
+        std::string type;
+        int level = 0;
+        if (!(type_file >> type) || !(level_file >> level)) {
+            break;
+        }
+        if (type == "Instruction") {
+            continue;
+        }
+        uint64_t size = read_sysfs_cache_size(dir + "size");
+        if (size == 0) {
+            continue;
+        }
+        if (level == 1) {
+            params.l1_cache_size = size;
+        } else if (level == 2) {
+            params.l2_cache_size = size;
+        } else {
+            params.last_level_cache_size = size;
+        }
+    }
+#endif
+    if (params.l1_cache_size >= params.l2_cache_size ||
+        params.l2_cache_size >= params.last_level_cache_size) {
+        // Only use a hierarchy that makes sense.
+        params.l1_cache_size = params.l2_cache_size = 0;
+    }
+    return params;
+}
+
 std::string MachineParams::to_string() const {
     std::ostringstream o;
     o << parallelism << "," << last_level_cache_size << "," << balance;
+    if ((l1_cache_size && l2_cache_size) || max_memory || memory_latency) {
+        o << "," << l1_cache_size << "," << l2_cache_size;
+    }
+    if (max_memory || memory_latency) {
+        o << "," << max_memory;
+    }
+    if (memory_latency) {
+        o << "," << memory_latency;
+    }
     return o.str();
 }
 
 MachineParams::MachineParams(const std::string &s) {
     std::vector<std::string> v = Internal::split_string(s, ",");
-    user_assert(v.size() == 3) << "Unable to parse MachineParams: " << s;
+    user_assert(v.size() == 3 || v.size() == 5 || v.size() == 6 || v.size() == 7) << "Unable to parse MachineParams: " << s;
     parallelism = std::atoi(v[0].c_str());
     last_level_cache_size = std::atoll(v[1].c_str());
     balance = std::atof(v[2].c_str());
+    if (v.size() >= 5) {
+        l1_cache_size = std::atoll(v[3].c_str());
+        l2_cache_size = std::atoll(v[4].c_str());
+    }
+    if (v.size() >= 6) {
+        max_memory = std::atoll(v[5].c_str());
+    }
+    if (v.size() == 7) {
+        memory_latency = std::atoi(v[6].c_str());
+    }
 }
 
 }  // namespace Halide
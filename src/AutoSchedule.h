@@ -21,17 +21,45 @@ struct MachineParams {
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     float balance;
+    /** Sizes of the L1 data cache and the L2 cache (in bytes), or zero if
+     * unknown. When both are known the auto-scheduler costs loads by which
+     * level of the hierarchy the footprint fits in, rather than by the last
+     * level cache alone. */
+    uint64_t l1_cache_size = 0, l2_cache_size = 0;
+    /** Upper bound on the peak memory (in bytes) the pipeline may
+     * allocate, or zero for no bound. The auto-scheduler rejects
+     * schedules it estimates would exceed it. */
+    uint64_t max_memory = 0;
+    /** Latency (in cycles) of a load that misses every level of the
+     * cache, or zero if unknown. Used to pick how far ahead automatic
+     * prefetches fetch. */
+    int memory_latency = 0;
 
     explicit MachineParams(int parallelism, uint64_t llc, float balance)
         : parallelism(parallelism), last_level_cache_size(llc), balance(balance) {}
 
-    /** Default machine parameters for generic CPU architecture. */
+    explicit MachineParams(int parallelism, uint64_t llc, float balance,
+                           uint64_t l1, uint64_t l2)
+        : parallelism(parallelism), last_level_cache_size(llc), balance(balance),
+          l1_cache_size(l1), l2_cache_size(l2) {}
+
+    /** Default machine parameters for generic CPU architecture. These can
+     * be overridden with HL_MACHINE_PARAMS, which takes either the
+     * canonical string form or "host". */
     static MachineParams generic();
 
+    /** Machine parameters describing the host: its core count and cache
+     * sizes where the OS reports them, with generic values otherwise. */
+    static MachineParams host();
+
     /** Convert the MachineParams into canonical string form. */
     std::string to_string() const;
 
-    /** Reconstruct a MachineParams from canonical string form. */
+    /** Reconstruct a MachineParams from canonical string form, which is
+     * "parallelism,last_level_cache_size,balance", optionally followed by
+     * ",l1_cache_size,l2_cache_size", then ",max_memory" and then
+     * ",memory_latency". Cache sizes and latencies of zero mean
+     * unknown. */
     explicit MachineParams(const std::string &s);
 };
 
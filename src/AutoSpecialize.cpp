@@ -0,0 +1,152 @@
+#include <set>
+
+#include "AutoSpecialize.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The most fast paths added to any one stage. Each one is another
+// copy of the stage's loop nest.
+const int max_specializations_per_stage = 4;
+
+vector<Expr> likely_values(const Parameter &p) {
+    if (!p.specialization_hints().empty()) {
+        return p.specialization_hints();
+    }
+    // Estimates of small integer values are also worth a fast path.
+    Type t = p.type();
+    if (p.estimate().defined() && (t.is_int() || t.is_uint()) && t.bits() <= 32) {
+        return {p.estimate()};
+    }
+    return {};
+}
+
+// Find the parameters a definition reads that are worth specializing
+// on, including those read by the Funcs inlined into it.
+class FindCandidates : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<string, Function> &env;
+    set<string> visited;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Image && op->param.defined() &&
+            op->param.is_buffer() && op->param.dimensions() > 0 &&
+            !op->param.stride_constraint(0).defined()) {
+            strides[op->param.name()] = op->param;
+        } else if (op->call_type == Call::Halide && visited.insert(op->name).second) {
+            auto it = env.find(op->name);
+            if (it != env.end() &&
+                it->second.can_be_inlined() &&
+                it->second.schedule().compute_level().is_inlined()) {
+                it->second.definition().accept(this);
+            }
+        }
+    }
+
+    void visit(const Variable *op) override {
+        if (op->param.defined() && !op->param.is_buffer() &&
+            !likely_values(op->param).empty()) {
+            params[op->param.name()] = op->param;
+        }
+    }
+
+public:
+    map<string, Parameter> strides, params;
+
+    FindCandidates(const map<string, Function> &env) : env(env) {}
+};
+
+void specialize_definition(Definition &def, const map<string, Function> &env) {
+    if (!def.specializations().empty()) {
+        return;
+    }
+    FindCandidates candidates(env);
+    def.accept(&candidates);
+
+    Expr dense;
+    for (const auto &p : candidates.strides) {
+        Expr stride = Variable::make(Int(32), p.first + ".stride.0", p.second);
+        dense = dense.defined() ? (dense && stride == 1) : (stride == 1);
+    }
+
+    // Take the first few combinations of the likely values of the
+    // Params, along with dense inputs. Dense inputs alone are the
+    // last fast path, before the general case.
+    int max_combinations = max_specializations_per_stage - (dense.defined() ? 1 : 0);
+    vector<Expr> combinations;
+    for (const auto &p : candidates.params) {
+        Expr var = Variable::make(p.second.type(), p.first, p.second);
+        vector<Expr> extended;
+        for (const Expr &value : likely_values(p.second)) {
+            if (combinations.empty()) {
+                extended.push_back(var == value);
+            }
+            for (const Expr &c : combinations) {
+                extended.push_back(c && var == value);
+            }
+        }
+        if ((int)extended.size() > max_combinations) {
+            extended.resize(max_combinations);
+        }
+        combinations.swap(extended);
+    }
+
+    for (const Expr &c : combinations) {
+        Expr condition = dense.defined() ? (dense && c) : c;
+        debug(3) << "Automatically specializing on " << condition << "\n";
+        def.add_specialization(condition);
+    }
+    if (dense.defined()) {
+        debug(3) << "Automatically specializing on " << dense << "\n";
+        def.add_specialization(dense);
+    }
+}
+
+}  // namespace
+
+void auto_specialize(const map<string, Function> &env) {
+    // Stages computed with others must keep the same loop structure,
+    // so leave them alone.
+    set<string> fused;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        vector<Definition> defs = f.updates();
+        defs.push_back(f.definition());
+        for (const Definition &def : defs) {
+            const LoopLevel &fuse_level = def.schedule().fuse_level().level;
+            if (!fuse_level.is_inlined() && !fuse_level.is_root()) {
+                fused.insert(f.name());
+                fused.insert(fuse_level.func());
+            }
+            if (!def.schedule().fused_pairs().empty()) {
+                fused.insert(f.name());
+            }
+        }
+    }
+
+    for (const auto &p : env) {
+        Function f = p.second;
+        if (f.has_extern_definition() || fused.count(f.name()) ||
+            f.schedule().compute_level().is_inlined()) {
+            continue;
+        }
+        specialize_definition(f.definition(), env);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            specialize_definition(f.update(i), env);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,30 @@
+#ifndef HALIDE_AUTO_SPECIALIZE_H
+#define HALIDE_AUTO_SPECIALIZE_H
+
+/** \file
+ * Defines the pass that adds specializations for likely parameter
+ * values to the definitions of Funcs.
+ */
+
+#include <map>
+
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Add specializations to the stages of the Functions in env for
+ * the parameter values they are likely to see: each input buffer
+ * with an unconstrained innermost stride having a stride of one, and
+ * each scalar integer Param taking one of its specialization hints
+ * (or its estimate, if it has no hints). Only stages that read those
+ * parameters, and that have no specializations and no compute_with
+ * already, are specialized, and each gets at most a few fast paths
+ * (the general case remains as the fallback). Used when the target
+ * has the auto_specialize feature. */
+void auto_specialize(const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
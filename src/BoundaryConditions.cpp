@@ -46,16 +46,19 @@ Func constant_exterior(const Func &source, Tuple value,
         ") than dimensions (" << source_args.size() << ") Func " <<
         source.name() << "has.\n";
 
-    Expr out_of_bounds = cast<bool>(false);
+    // Test each dimension with its own select, so that loop
+    // partitioning can peel the boundary off each loop
+    // independently. A single condition over all the dimensions
+    // can't be solved for any one loop variable, which leaves the
+    // select in the steady state of every loop.
+    std::vector<Expr> out_of_bounds;
     for (size_t i = 0; i < bounds.size(); i++) {
         Var arg_var = source_args[i];
         Expr min = bounds[i].first;
         Expr extent = bounds[i].second;
 
         if (min.defined() && extent.defined()) {
-            out_of_bounds = (out_of_bounds ||
-                             arg_var < min ||
-                             arg_var >= min + extent);
+            out_of_bounds.push_back(arg_var < min || arg_var >= min + extent);
         } else if (min.defined() || extent.defined()) {
             user_error << "Partially undefined bounds for dimension " << arg_var
                        << " of Func " << source.name() << "\n";
@@ -63,14 +66,24 @@ Func constant_exterior(const Func &source, Tuple value,
     }
 
     Func bounded("constant_exterior");
-    if (value.as_vector().size() > 1) {
-        std::vector<Expr> def;
-        for (size_t i = 0; i < value.as_vector().size(); i++) {
-            def.push_back(select(out_of_bounds, value[i], repeat_edge(source, bounds)(args)[i]));
+    Func interior = repeat_edge(source, bounds);
+    std::vector<Expr> def;
+    for (size_t i = 0; i < value.as_vector().size(); i++) {
+        Expr e;
+        if (value.as_vector().size() > 1) {
+            e = interior(args)[i];
+        } else {
+            e = interior(args);
+        }
+        for (const Expr &c : out_of_bounds) {
+            e = select(c, value[i], likely(e));
         }
+        def.push_back(e);
+    }
+    if (def.size() > 1) {
         bounded(args) = Tuple(def);
     } else {
-        bounded(args) = select(out_of_bounds, value[0], repeat_edge(source, bounds)(args));
+        bounded(args) = def[0];
     }
 
     return bounded;
@@ -1,7 +1,10 @@
 #include <iostream>
+#include <mutex>
+#include <sstream>
 
 #include "Bounds.h"
 #include "CSE.h"
+#include "ConstantInterval.h"
 #include "Debug.h"
 #include "Deinterleave.h"
 #include "ExprUsesVar.h"
@@ -114,6 +117,49 @@ private:
         }
     }
 
+    // Get the bounds of an integer Interval with constant ends as a
+    // ConstantInterval.
+    bool get_const_bounds(Type t, const Interval &i, ConstantInterval *c) {
+        if (!(t.is_int() || t.is_uint()) || !i.is_bounded()) {
+            return false;
+        }
+        const int64_t *min_i = as_const_int(i.min), *max_i = as_const_int(i.max);
+        const uint64_t *min_u = as_const_uint(i.min), *max_u = as_const_uint(i.max);
+        const uint64_t limit = (uint64_t)std::numeric_limits<int64_t>::max();
+        if ((min_u && *min_u > limit) || (max_u && *max_u > limit)) {
+            return false;
+        }
+        if ((min_i || min_u) && (max_i || max_u)) {
+            *c = ConstantInterval(min_i ? *min_i : (int64_t)*min_u,
+                                  max_i ? *max_i : (int64_t)*max_u);
+            return true;
+        }
+        return false;
+    }
+
+    // Set the interval to the result of some arithmetic on constant
+    // bounds. This folds the bounds directly, instead of building
+    // Exprs of constants and then proving that they don't
+    // overflow. Returns false if the symbolic path should be used
+    // instead.
+    bool set_const_bounds(Type t, const ConstantInterval &c) {
+        t = t.element_of();
+        if (!c.is_bounded()) {
+            return false;
+        } else if (!c.is_within(t)) {
+            if (t.is_int() && t.bits() >= 32) {
+                // Overflow of these types is assumed not to happen.
+                return false;
+            }
+            bounds_of_type(t);
+        } else if (c.is_single_point()) {
+            interval = Interval::single_point(make_const(t, c.min));
+        } else {
+            interval = Interval(make_const(t, c.min), make_const(t, c.max));
+        }
+        return true;
+    }
+
     using IRVisitor::visit;
 
     void visit(const IntImm *op) override {
@@ -247,6 +293,13 @@ private:
         op->b.accept(this);
         Interval b = interval;
 
+        ConstantInterval ca, cb;
+        if (get_const_bounds(op->type, a, &ca) &&
+            get_const_bounds(op->type, b, &cb) &&
+            set_const_bounds(op->type, ca + cb)) {
+            return;
+        }
+
         if (a.is_single_point(op->a) && b.is_single_point(op->b)) {
             interval = Interval::single_point(op);
         } else if (a.is_single_point() && b.is_single_point()) {
@@ -286,6 +339,13 @@ private:
         op->b.accept(this);
         Interval b = interval;
 
+        ConstantInterval ca, cb;
+        if (get_const_bounds(op->type, a, &ca) &&
+            get_const_bounds(op->type, b, &cb) &&
+            set_const_bounds(op->type, ca - cb)) {
+            return;
+        }
+
         if (a.is_single_point(op->a) && b.is_single_point(op->b)) {
             interval = Interval::single_point(op);
         } else if (a.is_single_point() && b.is_single_point()) {
@@ -333,6 +393,13 @@ private:
         op->b.accept(this);
         Interval b = interval;
 
+        ConstantInterval ca, cb;
+        if (get_const_bounds(op->type, a, &ca) &&
+            get_const_bounds(op->type, b, &cb) &&
+            set_const_bounds(op->type, ca * cb)) {
+            return;
+        }
+
         // Move constants to the right
         if (a.is_single_point() && !b.is_single_point()) {
             std::swap(a, b);
@@ -400,6 +467,13 @@ private:
         op->b.accept(this);
         Interval b = interval;
 
+        ConstantInterval ca, cb;
+        if (get_const_bounds(op->type, a, &ca) &&
+            get_const_bounds(op->type, b, &cb) &&
+            set_const_bounds(op->type, ca / cb)) {
+            return;
+        }
+
         if (!b.is_bounded()) {
             interval = Interval::everything();
         } else if (a.is_single_point(op->a) && b.is_single_point(op->b)) {
@@ -457,6 +531,13 @@ private:
         }
         Interval b = interval;
 
+        ConstantInterval ca, cb;
+        if (get_const_bounds(op->type, a, &ca) &&
+            get_const_bounds(op->type, b, &cb) &&
+            set_const_bounds(op->type, ca % cb)) {
+            return;
+        }
+
         if (a.is_single_point(op->a) && b.is_single_point(op->b)) {
             interval = Interval::single_point(op);
             return;
@@ -2147,9 +2228,62 @@ Interval compute_pure_function_definition_value_bounds(
     return result;
 }
 
+namespace {
+
+// A pure Func's value bounds depend only on its definition and on the
+// value bounds of the Funcs it calls, never on any schedule. We can
+// therefore reuse them across repeated lowerings of the same pipeline,
+// e.g. while iterating on schedules or autotuning. This builds the key
+// that determines them: the definition's values, plus everything about
+// the leaves they reach that bounds_of_expr_in_scope looks at.
+class ValueBoundsKey : public IRGraphVisitor {
+    const FuncValueBounds &fb;
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        key << "var " << op->name << " " << op->type;
+        if (op->param.defined()) {
+            key << " " << op->param.min_value() << " " << op->param.max_value();
+        }
+        key << "\n";
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        key << "call " << op->name << " " << (int)op->call_type
+            << " " << op->value_index << " " << op->type;
+        auto it = fb.find({op->name, op->value_index});
+        if (it != fb.end()) {
+            key << " [" << it->second.min << ", " << it->second.max << "]";
+        }
+        key << "\n";
+    }
+
+public:
+    std::ostringstream key;
+
+    ValueBoundsKey(const FuncValueBounds &fb) : fb(fb) {}
+
+    void add_definition(const Definition &def, int dim) {
+        key << def.values()[dim] << "\n";
+        def.values()[dim].accept(this);
+        for (const Specialization &s : def.specializations()) {
+            add_definition(s.definition, dim);
+        }
+    }
+};
+
+const size_t max_value_bounds_cache_entries = 4096;
+std::mutex value_bounds_cache_mutex;
+std::map<string, Interval> value_bounds_cache;
+
+}  // namespace
+
 FuncValueBounds compute_function_value_bounds(const vector<string> &order,
                                               const map<string, Function> &env) {
     FuncValueBounds fb;
+    int cache_hits = 0;
 
     for (size_t i = 0; i < order.size(); i++) {
         Function f = env.find(order[i])->second;
@@ -2160,22 +2294,49 @@ FuncValueBounds compute_function_value_bounds(const vector<string> &order,
             Interval result;
 
             if (f.is_pure()) {
-
-                // Make a scope that says the args could be anything.
-                Scope<Interval> arg_scope;
-                for (size_t k = 0; k < f.args().size(); k++) {
-                    arg_scope.push(f_args[k], Interval::everything());
+                ValueBoundsKey cache_key(fb);
+                cache_key.key << f.name() << "." << j << "(";
+                for (const string &a : f_args) {
+                    cache_key.key << a << ",";
                 }
-
-                result = compute_pure_function_definition_value_bounds(f.definition(), arg_scope, fb, j);
-                // These can expand combinatorially as we go down the
-                // pipeline if we don't run CSE on them.
-                if (result.has_lower_bound()) {
-                    result.min = simplify(common_subexpression_elimination(result.min));
+                cache_key.key << ")\n";
+                cache_key.add_definition(f.definition(), j);
+                const string cache_key_str = cache_key.key.str();
+
+                bool cached = false;
+                {
+                    std::lock_guard<std::mutex> lock(value_bounds_cache_mutex);
+                    auto it = value_bounds_cache.find(cache_key_str);
+                    if (it != value_bounds_cache.end()) {
+                        result = it->second;
+                        cached = true;
+                        cache_hits++;
+                    }
                 }
 
-                if (result.has_upper_bound()) {
-                    result.max = simplify(common_subexpression_elimination(result.max));
+                if (!cached) {
+                    // Make a scope that says the args could be anything.
+                    Scope<Interval> arg_scope;
+                    for (size_t k = 0; k < f.args().size(); k++) {
+                        arg_scope.push(f_args[k], Interval::everything());
+                    }
+
+                    result = compute_pure_function_definition_value_bounds(f.definition(), arg_scope, fb, j);
+                    // These can expand combinatorially as we go down the
+                    // pipeline if we don't run CSE on them.
+                    if (result.has_lower_bound()) {
+                        result.min = simplify(common_subexpression_elimination(result.min));
+                    }
+
+                    if (result.has_upper_bound()) {
+                        result.max = simplify(common_subexpression_elimination(result.max));
+                    }
+
+                    std::lock_guard<std::mutex> lock(value_bounds_cache_mutex);
+                    if (value_bounds_cache.size() >= max_value_bounds_cache_entries) {
+                        value_bounds_cache.clear();
+                    }
+                    value_bounds_cache[cache_key_str] = result;
                 }
 
                 fb[key] = result;
@@ -2187,6 +2348,8 @@ FuncValueBounds compute_function_value_bounds(const vector<string> &order,
         }
     }
 
+    debug(1) << "Reused cached value bounds for " << cache_hits << " Func outputs\n";
+
     return fb;
 }
 
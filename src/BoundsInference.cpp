@@ -1,13 +1,16 @@
 #include "BoundsInference.h"
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Inline.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Substitute.h"
 
 #include <algorithm>
+#include <functional>
 #include <iterator>
 
 namespace Halide {
@@ -21,6 +24,10 @@ using std::vector;
 
 namespace {
 
+// Pipelines with fewer stages than this do bounds inference serially,
+// because it isn't worth spinning up threads for them.
+const size_t min_stages_for_parallel_bounds = 16;
+
 bool var_name_match(string candidate, string var) {
     internal_assert(var.find('.') == string::npos)
         << "var_name_match expects unqualified names for the second argument. "
@@ -143,6 +150,50 @@ public:
         set<ReductionVariable, ReductionVariable::Compare> rvars;
         string stage_prefix;
 
+        // Rewrite the condition of skip_tiles_where, which is in terms
+        // of the loop variables of the stage, in terms of the pure
+        // variables and reduction variables of the stage by undoing
+        // its splits. Each loop variable starts at zero, except for
+        // the ones that are not split, which start at the min of the
+        // variable.
+        Expr skip_condition_in_terms_of_args(const Definition &def, const TileSkip &skip) const {
+            map<string, Expr> loop_vars, loop_mins;
+            set<string> fused;
+            for (const Split &split : def.schedule().splits()) {
+                if (split.is_fuse() || fused.count(split.old_var)) {
+                    fused.insert(split.old_var);
+                    fused.insert(split.outer);
+                    fused.insert(split.inner);
+                    continue;
+                }
+                Expr old_var, old_min;
+                auto it = loop_vars.find(split.old_var);
+                if (it != loop_vars.end()) {
+                    old_var = it->second;
+                    old_min = loop_mins[split.old_var];
+                } else {
+                    old_var = Variable::make(Int(32), split.old_var);
+                    old_min = Variable::make(Int(32), stage_prefix + split.old_var + ".min");
+                }
+                if (split.is_split()) {
+                    loop_vars[split.outer] = (old_var - old_min) / split.factor;
+                    loop_vars[split.inner] = (old_var - old_min) % split.factor;
+                    loop_mins[split.outer] = 0;
+                    loop_mins[split.inner] = 0;
+                } else {
+                    loop_vars[split.outer] = old_var;
+                    loop_mins[split.outer] = old_min;
+                }
+            }
+            for (const string &v : fused) {
+                user_assert(!expr_uses_var(skip.condition, v))
+                    << "In schedule for " << name << ", the condition " << skip.condition
+                    << " of skip_tiles_where(" << skip.var << ") depends on the fused variable "
+                    << v << ", which is not supported.\n";
+            }
+            return substitute(loop_vars, skip.condition);
+        }
+
         // Computed expressions on the left and right-hand sides.
         // Note that a function definition might have different LHS or reduction domain
         // (if it's an update def) or RHS per specialization. All specializations
@@ -188,6 +239,13 @@ public:
                 }
             }
 
+            // The conditions under which tiles are skipped are
+            // evaluated for every tile, so the Funcs they call must
+            // be computed over all of them.
+            for (const TileSkip &skip : def.schedule().skip_tiles()) {
+                result[1].push_back(CondValue(const_true(), skip_condition_in_terms_of_args(def, skip)));
+            }
+
             const vector<Specialization> &specializations = def.specializations();
             for (size_t i = specializations.size(); i > 0; i--) {
                 Expr s_cond = specializations[i-1].condition;
@@ -616,6 +674,9 @@ public:
                     // Although we expect ImageParams to be properly initialized and sanitized by the caller,
                     // we create a copy with copy_memory (not msan-aware), so we need to annotate it as initialized.
                     buffers_to_annotate.push_back(bounds_inference_args.back());
+                } else if (args[j].is_semaphore()) {
+                    // Bounds queries are synchronous.
+                    bounds_inference_args.push_back(make_zero(type_of<struct halide_semaphore_t *>()));
                 } else {
                     internal_error << "Bad ExternFuncArgument type";
                 }
@@ -694,7 +755,7 @@ public:
         // A scope giving the bounds for variables used by this stage.
         // We need to take into account specializations which may refer to
         // different reduction variables as well.
-        void populate_scope(Scope<Interval> &result) {
+        void populate_scope(Scope<Interval> &result) const {
             for (const string farg : func.args()) {
                 string arg = name + ".s" + std::to_string(stage) + "." + farg;
                 result.push(farg,
@@ -719,6 +780,62 @@ public:
     };
     vector<Stage> stages;
 
+    // Run one job per stage, in parallel if there are enough stages.
+    void run_stage_jobs(const vector<std::function<void()>> &jobs) const {
+        if (jobs.size() >= min_stages_for_parallel_bounds) {
+            run_compile_jobs(jobs);
+        } else {
+            for (const auto &job : jobs) {
+                job();
+            }
+        }
+    }
+
+    // Compute all the boxes of the producers a consumer stage uses.
+    void compute_boxes_required_by(const Stage &consumer, map<string, Box> &boxes) const {
+        // Set up symbols representing the bounds over which this
+        // stage will be computed.
+        Scope<Interval> scope;
+        consumer.populate_scope(scope);
+
+        if (consumer.func.has_extern_definition() &&
+            !consumer.func.extern_definition_proxy_expr().defined()) {
+
+            const vector<ExternFuncArgument> &args = consumer.func.extern_arguments();
+            // Stage::define_bounds is going to compute a query
+            // buffer_t per producer for bounds inference to
+            // use. We just need to extract those values.
+            for (size_t j = 0; j < args.size(); j++) {
+                if (args[j].is_func()) {
+                    Function f(args[j].func);
+                    string stage_name = f.name() + ".s" + std::to_string(f.updates().size());
+                    Box b(f.dimensions());
+                    for (int d = 0; d < f.dimensions(); d++) {
+                        string buf_name = f.name() + ".o0.bounds_query." + consumer.name;
+                        Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), buf_name);
+                        Expr min = Call::make(Int(32), Call::buffer_get_min,
+                                              {buf, d}, Call::Extern);
+                        Expr max = Call::make(Int(32), Call::buffer_get_max,
+                                              {buf, d}, Call::Extern);
+                        b[d] = Interval(min, max);
+                    }
+                    merge_boxes(boxes[f.name()], b);
+                }
+            }
+        } else {
+            for (const auto &cval : consumer.exprs) {
+                map<string, Box> new_boxes;
+                new_boxes = boxes_required(cval.value, scope, func_bounds);
+                for (auto &i : new_boxes) {
+                    // Add the condition on which this value is evaluated to the box before merging
+                    Box &box = i.second;
+                    box.used = cval.cond;
+                    merge_boxes(boxes[i.first], box);
+                }
+            }
+        }
+    }
+
     BoundsInference(const vector<Function> &f,
                     const vector<vector<Function>> &fg,
                     const vector<set<FusedPair>> &fp,
@@ -754,8 +871,8 @@ public:
             s.func = f[i];
             s.stage = 0;
             s.name = s.func.name();
-            s.compute_exprs();
             s.stage_prefix = s.name + ".s0.";
+            s.compute_exprs();
             stages.push_back(s);
 
             for (size_t j = 0; j < f[i].updates().size(); j++) {
@@ -767,20 +884,23 @@ public:
 
         }
 
-        // Do any pure inlining (TODO: This is currently slow)
-        for (size_t i = f.size(); i > 0; i--) {
-            Function func = f[i-1];
-            if (inlined[i-1]) {
-                for (size_t j = 0; j < stages.size(); j++) {
-                    Stage &s = stages[j];
+        // Do any pure inlining (TODO: This is currently slow). Each
+        // stage is independent, so stages are inlined into in parallel.
+        vector<std::function<void()>> inline_jobs;
+        for (size_t j = 0; j < stages.size(); j++) {
+            inline_jobs.push_back([this, j, &f, &inlined]() {
+                Stage &s = stages[j];
+                for (size_t i = f.size(); i > 0; i--) {
+                    if (!inlined[i-1]) continue;
                     for (size_t k = 0; k < s.exprs.size(); k++) {
                         CondValue &cond_val = s.exprs[k];
                         internal_assert(cond_val.value.defined());
-                        cond_val.value = inline_function(cond_val.value, func);
+                        cond_val.value = inline_function(cond_val.value, f[i-1]);
                     }
                 }
-            }
+            });
         }
+        run_stage_jobs(inline_jobs);
 
         // Remove the inlined stages
         vector<Stage> new_stages;
@@ -800,56 +920,24 @@ public:
         }
         */
 
-        // Then compute relationships between them.
+        // Then compute relationships between them. The boxes each
+        // consumer requires of its producers depend only on the
+        // consumer's own definition, so for large pipelines they are
+        // computed in parallel. The results are then merged into the
+        // producers serially, in stage order.
+        vector<map<string, Box>> consumer_boxes(stages.size());
+        vector<std::function<void()>> jobs;
         for (size_t i = 0; i < stages.size(); i++) {
+            jobs.push_back([this, i, &consumer_boxes]() {
+                compute_boxes_required_by(stages[i], consumer_boxes[i]);
+            });
+        }
+        run_stage_jobs(jobs);
 
-            Stage &consumer = stages[i];
-
-            // Set up symbols representing the bounds over which this
-            // stage will be computed.
-            Scope<Interval> scope;
-            consumer.populate_scope(scope);
-
-            // Compute all the boxes of the producers this consumer
-            // uses.
-            map<string, Box> boxes;
-            if (consumer.func.has_extern_definition() &&
-                !consumer.func.extern_definition_proxy_expr().defined()) {
-
-                const vector<ExternFuncArgument> &args = consumer.func.extern_arguments();
-                // Stage::define_bounds is going to compute a query
-                // buffer_t per producer for bounds inference to
-                // use. We just need to extract those values.
-                for (size_t j = 0; j < args.size(); j++) {
-                    if (args[j].is_func()) {
-                        Function f(args[j].func);
-                        string stage_name = f.name() + ".s" + std::to_string(f.updates().size());
-                        Box b(f.dimensions());
-                        for (int d = 0; d < f.dimensions(); d++) {
-                            string buf_name = f.name() + ".o0.bounds_query." + consumer.name;
-                            Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), buf_name);
-                            Expr min = Call::make(Int(32), Call::buffer_get_min,
-                                                  {buf, d}, Call::Extern);
-                            Expr max = Call::make(Int(32), Call::buffer_get_max,
-                                                  {buf, d}, Call::Extern);
-                            b[d] = Interval(min, max);
-                        }
-                        merge_boxes(boxes[f.name()], b);
-                    }
-                }
-            } else {
-                for (const auto &cval : consumer.exprs) {
-                    map<string, Box> new_boxes;
-                    new_boxes = boxes_required(cval.value, scope, func_bounds);
-                    for (auto &i : new_boxes) {
-                        // Add the condition on which this value is evaluated to the box before merging
-                        Box &box = i.second;
-                        box.used = cval.cond;
-                        merge_boxes(boxes[i.first], box);
-                    }
-                }
-            }
+        for (size_t i = 0; i < stages.size(); i++) {
 
+            Stage &consumer = stages[i];
+            map<string, Box> &boxes = consumer_boxes[i];
             // Expand the bounds required of all the producers found.
             for (size_t j = 0; j < i; j++) {
                 Stage &producer = stages[j];
@@ -423,6 +423,8 @@ public:
     HALIDE_BUFFER_FORWARD(device_malloc)
     HALIDE_BUFFER_FORWARD(device_wrap_native)
     HALIDE_BUFFER_FORWARD(device_detach_native)
+    HALIDE_BUFFER_FORWARD(device_and_host_malloc)
+    HALIDE_BUFFER_FORWARD(device_and_host_free)
     HALIDE_BUFFER_FORWARD(allocate)
     HALIDE_BUFFER_FORWARD(deallocate)
     HALIDE_BUFFER_FORWARD(device_deallocate)
@@ -562,6 +564,16 @@ public:
         return contents->buf.device_malloc(get_device_interface_for_device_api(d, t, "Buffer::device_malloc"));
     }
 
+    /** Allocate the host and device storage together, using the
+     * given device API. Some device APIs can then copy between them
+     * faster, or share the memory between them (see
+     * halide_cuda_set_mapped_host_memory). The host allocation
+     * replaces any existing one, and is freed along with the device
+     * allocation. */
+    int device_and_host_malloc(const DeviceAPI &d, const Target &t = get_jit_target_from_environment()) {
+        return contents->buf.device_and_host_malloc(get_device_interface_for_device_api(d, t, "Buffer::device_and_host_malloc"));
+    }
+
     /** Wrap a native handle, using the given device API.
      * It is a bad idea to pass DeviceAPI::Default_GPU to this routine
      * as the handle argument must match the API that the default
@@ -38,6 +38,17 @@ Type non_null_void_star_type() {
     return Handle(1, &t);
 }
 
+// The type an extern stage receives for one of its arguments.
+Type extern_arg_type(const ExternFuncArgument &arg) {
+    if (arg.is_expr()) {
+        return arg.expr.type();
+    } else if (arg.is_semaphore()) {
+        return type_of<struct halide_semaphore_t *>();
+    } else {
+        return type_of<struct halide_buffer_t *>();
+    }
+}
+
 }  // namespace
 
 namespace WindowsMangling {
@@ -292,7 +303,7 @@ std::string cplusplus_function_mangled_name(const std::string &name, const std::
         result += "X";
     } else {
         for (const auto &arg : args) {
-            result += prev_decls.check_and_enter_type(mangle_type(arg.is_expr() ? arg.expr.type() : type_of<struct halide_buffer_t *>(), target, prev_decls));
+            result += prev_decls.check_and_enter_type(mangle_type(extern_arg_type(arg), target, prev_decls));
         }
         // I think ending in a 'Z' only happens for nested function types, which never
         // occurs with Halide, but putting it in anyway per.
@@ -585,7 +596,7 @@ std::string cplusplus_function_mangled_name(const std::string &name, const std::
     }
 
     for (const auto &arg : args) {
-        result += mangle_type(arg.is_expr() ? arg.expr.type() : type_of<struct halide_buffer_t *>(), target, prevs);
+        result += mangle_type(extern_arg_type(arg), target, prevs);
     }
 
     return result;
@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IREquality.h"
@@ -80,6 +81,9 @@ bool should_extract(const Expr &e, bool lift_all) {
 
 // A global-value-numbering of expressions. Returns canonical form of
 // the Expr and writes out a global value numbering as a side-effect.
+// Exprs are rebuilt bottom-up out of canonical children, so an Expr
+// can be found in the numbering by its structural hash and a shallow
+// comparison, which makes this linear in the number of distinct nodes.
 class GVN : public IRMutator2 {
 public:
     struct Entry {
@@ -88,7 +92,8 @@ public:
     };
     vector<Entry> entries;
 
-    typedef map<ExprWithCompareCache, int> CacheType;
+    // The canonical Exprs, keyed on their structural hash.
+    typedef std::unordered_multimap<uint32_t, int> CacheType;
     CacheType numbering;
 
     map<Expr, int, ExprCompare> shallow_numbering;
@@ -96,17 +101,23 @@ public:
     Scope<int> let_substitutions;
     int number;
 
-    IRCompareCache cache;
-
-    GVN() : number(0), cache(8) {}
+    GVN() : number(0) {}
 
     Stmt mutate(const Stmt &s) override {
         internal_error << "Can't call GVN on a Stmt: " << s << "\n";
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(Expr e) {
-        return ExprWithCompareCache(e, &cache);
+    // Find an Expr with canonical children in the numbering. Returns
+    // -1 if it isn't there.
+    int find_in_numbering(const Expr &e, uint32_t hash) {
+        auto range = numbering.equal_range(hash);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (shallow_equal(entries[iter->second].expr, e)) {
+                return iter->second;
+            }
+        }
+        return -1;
     }
 
     Expr mutate(const Expr &e) override {
@@ -129,24 +140,18 @@ public:
             }
         }
 
-        // If e already has an entry, return that.
-        CacheType::iterator iter = numbering.find(with_cache(e));
-        if (iter != numbering.end()) {
-            number = iter->second;
-            shallow_numbering[e] = number;
-            internal_assert(entries[number].expr.type() == e.type());
-            return entries[number].expr;
-        }
-
-        // Rebuild using things already in the numbering.
+        // Rebuild using things already in the numbering. The
+        // children of the result are canonical.
         Expr old_e = e;
         Expr new_e = IRMutator2::mutate(e);
 
-        // See if it's there in another form after being rebuilt
-        // (e.g. because it was a let variable).
-        iter = numbering.find(with_cache(new_e));
-        if (iter != numbering.end()) {
-            number = iter->second;
+        // See if it's already there, possibly in another form
+        // (e.g. because it was a let variable). The hashes of the
+        // children are already known, so this is constant time.
+        uint32_t hash = structural_hash(new_e);
+        int existing = find_in_numbering(new_e, hash);
+        if (existing >= 0) {
+            number = existing;
             shallow_numbering[old_e] = number;
             internal_assert(entries[number].expr.type() == old_e.type());
             return entries[number].expr;
@@ -155,7 +160,7 @@ public:
         // Add it to the numbering.
         Entry entry = {new_e, 0};
         number = (int)entries.size();
-        numbering[with_cache(new_e)] = number;
+        numbering.emplace(hash, number);
         shallow_numbering[new_e] = number;
         entries.push_back(entry);
         internal_assert(new_e.type() == old_e.type());
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "CodeGen_ARM.h"
+#include "CodeGen_Internal.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
 #include "IREquality.h"
@@ -463,7 +464,108 @@ void CodeGen_ARM::visit(const Div *op) {
     CodeGen_Posix::visit(op);
 }
 
+namespace {
+
+// A multiply-accumulate that sdot or udot does in one instruction:
+// each 32-bit lane of the accumulator gets the dot product of the
+// four narrow lanes of a and b that it overlaps added to it.
+struct DotProduct {
+    string intrin;
+    Expr a, b;
+};
+
+// An i32 accumulator plus four i32(i8)*i32(i8) products can be done
+// with sdot, and plus four i32(u8)*i32(u8) products with udot, by
+// interleaving the narrow factors so that the terms of each 32-bit
+// lane are neighbors. Split the terms of a sum into such groups, and
+// whatever is left over.
+bool should_use_dot_product(const Add *op, vector<DotProduct> &ops, Expr &rest) {
+    Type t = op->type;
+    if (!((t.is_int() || t.is_uint()) && t.bits() == 32 && t.lanes() >= 2)) {
+        return false;
+    }
+
+    vector<Expr> terms;
+    collect_terms(op, terms);
+
+    vector<Expr> signed_a, signed_b, unsigned_a, unsigned_b, others;
+    for (const Expr &e : terms) {
+        Expr a, b;
+        if (match_narrow_product(e, UInt(8), UInt(8), &a, &b)) {
+            unsigned_a.push_back(a);
+            unsigned_b.push_back(b);
+        } else if (match_narrow_product(e, Int(8), Int(8), &a, &b)) {
+            signed_a.push_back(a);
+            signed_b.push_back(b);
+        } else {
+            others.push_back(e);
+        }
+    }
+
+    auto make_groups = [&](const string &intrin, vector<Expr> &a, vector<Expr> &b) {
+        size_t groups = a.size() / 4;
+        for (size_t i = 0; i < groups * 4; i += 4) {
+            DotProduct d;
+            d.intrin = intrin;
+            d.a = Shuffle::make_interleave({a[i], a[i + 1], a[i + 2], a[i + 3]});
+            d.b = Shuffle::make_interleave({b[i], b[i + 1], b[i + 2], b[i + 3]});
+            ops.push_back(d);
+        }
+        // Leftover products are done the usual way.
+        for (size_t i = groups * 4; i < a.size(); i++) {
+            others.push_back(cast(t, a[i]) * cast(t, b[i]));
+        }
+    };
+    make_groups("udot", unsigned_a, unsigned_b);
+    make_groups("sdot", signed_a, signed_b);
+    if (ops.empty()) {
+        return false;
+    }
+
+    rest = Expr();
+    for (const Expr &e : others) {
+        rest = rest.defined() ? rest + e : e;
+    }
+    return true;
+}
+
+}  // namespace
+
 void CodeGen_ARM::visit(const Add *op) {
+    vector<DotProduct> dot_products;
+    Expr rest;
+    if (target.bits == 64 &&
+        target.has_feature(Target::ARMDotProd) &&
+        !neon_intrinsics_disabled() &&
+        should_use_dot_product(op, dot_products, rest)) {
+        // The intrinsics take the narrow operands as byte vectors
+        // with four times the lanes of the accumulator, which
+        // call_intrin slices up along with it.
+        int intrin_lanes = op->type.lanes() >= 4 ? 4 : 2;
+        string suffix = intrin_lanes == 4 ? ".v4i32.v16i8" : ".v2i32.v8i8";
+        Value *acc = codegen(rest.defined() ? rest : make_zero(op->type));
+        for (const DotProduct &d : dot_products) {
+            acc = call_intrin(acc->getType(), intrin_lanes, "llvm.aarch64.neon." + d.intrin + suffix,
+                              {acc, codegen(d.a), codegen(d.b)});
+        }
+        value = acc;
+        return;
+    }
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_ARM::visit(const Block *op) {
+    // Unrolling a short reduction gives a run of stores that each
+    // add one more term into the same accumulator. Fuse them, so that
+    // visit(Add) sees all the products it could accumulate at once.
+    if (target.bits == 64 && target.has_feature(Target::ARMDotProd)) {
+        const Block *rest = op->rest.as<Block>();
+        Stmt fused = fuse_accumulations(op->first, rest ? rest->first : op->rest);
+        if (fused.defined()) {
+            codegen(rest ? Block::make(fused, rest->rest) : fused);
+            return;
+        }
+    }
     CodeGen_Posix::visit(op);
 }
 
@@ -1021,11 +1123,25 @@ string CodeGen_ARM::mattrs() const {
             return "-neon";
         }
     } else {
+        string arch_flags;
+        string separator;
+        if (target.has_feature(Target::SVE)) {
+            arch_flags = "+sve";
+            separator = ",";
+        }
+        if (target.has_feature(Target::ARMDotProd)) {
+            arch_flags += separator + "+dotprod";
+            separator = ",";
+        }
+        if (target.has_feature(Target::ARMFp16)) {
+            // Without this, LLVM does each float16 op in float32.
+            arch_flags += separator + "+fullfp16";
+            separator = ",";
+        }
         if (target.os == Target::IOS || target.os == Target::OSX) {
-            return "+reserve-x18";
-        } else {
-            return "";
+            arch_flags += separator + "+reserve-x18";
         }
+        return arch_flags;
     }
 }
 
@@ -34,6 +34,7 @@ protected:
     void visit(const Store *) override;
     void visit(const Load *) override;
     void visit(const Call *) override;
+    void visit(const Block *) override;
     // @}
 
     /** Various patterns to peephole match against */
@@ -31,6 +31,7 @@ extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenGLCompu
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenGL_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeQurt_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeD3D12Compute_h[];
+extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeVulkan_h[];
 
 namespace {
 
@@ -214,7 +215,8 @@ public:
 };
 
 CodeGen_C::CodeGen_C(ostream &s, Target t, OutputKind output_kind, const std::string &guard) :
-    IRPrinter(s), id("$$ BAD ID $$"), target(t), output_kind(output_kind), extern_c_open(false) {
+    IRPrinter(s), id("$$ BAD ID $$"), target(t), output_kind(output_kind), extern_c_open(false),
+    emit_atomic_stores(false) {
 
     if (is_header()) {
         // If it's a header, emit an include guard.
@@ -320,6 +322,9 @@ CodeGen_C::~CodeGen_C() {
             if (target.has_feature(Target::D3D12Compute)) {
                 stream << halide_internal_runtime_header_HalideRuntimeD3D12Compute_h << '\n';
             }
+            if (target.has_feature(Target::Vulkan)) {
+                stream << halide_internal_runtime_header_HalideRuntimeVulkan_h << '\n';
+            }
         }
         stream << "#endif\n";
     }
@@ -330,7 +335,13 @@ string type_to_c_type(Type type, bool include_space, bool c_plus_plus = true) {
     bool needs_space = true;
     ostringstream oss;
 
-    if (type.is_float()) {
+    if (type.is_bfloat()) {
+        // Stored as bits. See lower_bfloat16_math.
+        oss << "uint16_t";
+        if (type.is_vector()) {
+            oss << type.lanes();
+        }
+    } else if (type.is_float()) {
         if (type.bits() == 32) {
             oss << "float";
         } else if (type.bits() == 64) {
@@ -1904,7 +1915,9 @@ static bool isinf(T x)
 }
 
 void CodeGen_C::visit(const FloatImm *op) {
-    if (isnan(op->value)) {
+    if (op->type.is_bfloat()) {
+        id = std::to_string(bfloat16_t(op->value).to_bits());
+    } else if (isnan(op->value)) {
         id = "nan_f32()";
     } else if (isinf(op->value)) {
         if (op->value > 0) {
@@ -2187,10 +2200,42 @@ void CodeGen_C::visit(const Call *op) {
         rhs << "__builtin_prefetch("
             << "((" << print_type(op->type) << " *)" << print_name(base->name)
             << " + " << print_expr(op->args[1]) << "), 1)";
+    } else if (op->is_intrinsic(Call::copy_memory)) {
+        internal_assert(op->args.size() == 5);
+        const Variable *dst = op->args[0].as<Variable>();
+        const Variable *src = op->args[2].as<Variable>();
+        internal_assert(dst && src);
+        string type = print_type(op->type);
+        string dst_index = print_expr(op->args[1]);
+        string src_index = print_expr(op->args[3]);
+        string count = print_expr(op->args[4]);
+        do_indent();
+        stream << "memcpy(((" << type << " *)" << print_name(dst->name) << " + " << dst_index << "), "
+               << "((const " << type << " *)" << print_name(src->name) << " + " << src_index << "), "
+               << "(size_t)" << count << " * sizeof(" << type << "));\n";
+        rhs << print_expr(0);
+    } else if (op->is_intrinsic(Call::fill_memory)) {
+        internal_assert(op->args.size() == 4);
+        const Variable *dst = op->args[0].as<Variable>();
+        internal_assert(dst);
+        string type = print_type(op->type);
+        string dst_index = print_expr(op->args[1]);
+        string byte = print_expr(op->args[2]);
+        string count = print_expr(op->args[3]);
+        do_indent();
+        stream << "memset(((" << type << " *)" << print_name(dst->name) << " + " << dst_index << "), "
+               << byte << ", (size_t)" << count << " * sizeof(" << type << "));\n";
+        rhs << print_expr(0);
     } else if (op->is_intrinsic(Call::indeterminate_expression)) {
         user_error << "Indeterminate expression occurred during constant-folding.\n";
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         rhs << "(sizeof(halide_buffer_t))";
+    } else if (op->is_intrinsic(Call::nontemporal)) {
+        internal_assert(op->args.size() == 1);
+        rhs << print_expr(op->args[0]);
+    } else if (op->is_intrinsic(Call::branch_weights)) {
+        internal_assert(op->args.size() == 3);
+        rhs << print_expr(op->args[0]);
     } else if (op->is_intrinsic(Call::strict_float)) {
         internal_assert(op->args.size() == 1);
         string arg0 = print_expr(op->args[0]);
@@ -2283,6 +2328,41 @@ void CodeGen_C::visit(const Store *op) {
     user_assert(is_one(op->predicate)) << "Predicated store is not supported by C backend.\n";
 
     Type t = op->value.type();
+
+    if (emit_atomic_stores) {
+        user_assert(t.is_scalar())
+            << "Can't store to " << op->name << " atomically, since the store is vectorized\n";
+        // Compute the new value from the old one, and swap it in
+        // with a compare-and-swap until no other thread has changed
+        // the value in the meantime.
+        string old_name = unique_name('t');
+        Expr value = replace_self_loads(op, Variable::make(t, old_name));
+        string id_index = print_expr(op->index);
+        string ptr = print_name(unique_name('t'));
+        string old_value = print_name(old_name);
+        string new_value = print_name(unique_name('t'));
+        open_scope();
+        do_indent();
+        stream << print_type(t) << " *" << ptr << " = &((" << print_type(t) << " *)"
+               << print_name(op->name) << ")[" << id_index << "];\n";
+        do_indent();
+        stream << print_type(t) << " " << old_value << ", " << new_value << ";\n";
+        do_indent();
+        stream << "__atomic_load(" << ptr << ", &" << old_value << ", __ATOMIC_RELAXED);\n";
+        do_indent();
+        stream << "do {\n";
+        indent++;
+        string id_value = print_expr(value);
+        do_indent();
+        stream << new_value << " = " << id_value << ";\n";
+        cache.clear();
+        indent--;
+        do_indent();
+        stream << "} while (!__atomic_compare_exchange(" << ptr << ", &" << old_value
+               << ", &" << new_value << ", false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));\n";
+        close_scope("");
+        return;
+    }
     string id_value = print_expr(op->value);
     string name = print_name(op->name);
 
@@ -2464,18 +2544,46 @@ void CodeGen_C::visit(const Acquire *op) {
     close_scope("");
 }
 
+void CodeGen_C::visit(const Atomic *op) {
+    ScopedValue<bool> old_emit_atomic_stores(emit_atomic_stores, true);
+    op->body.accept(this);
+}
+
 void CodeGen_C::visit(const For *op) {
     string id_min = print_expr(op->min);
     string id_extent = print_expr(op->extent);
 
     if (op->for_type == ForType::Parallel) {
+        // Run the loop on the Halide thread pool. The body goes in a
+        // lambda that captures everything by reference, and a
+        // captureless lambda that calls it is the task.
+        string body_name = print_name(unique_name("par_for_" + op->name));
+        string result_name = print_name(unique_name('t'));
+        open_scope();
         do_indent();
-        stream << "#pragma omp parallel for\n";
-    } else {
-        internal_assert(op->for_type == ForType::Serial)
-            << "Can only emit serial or parallel for loops to C\n";
+        stream << "auto " << body_name << " = [&](int " << print_name(op->name) << ") -> int {\n";
+        cache.clear();
+        indent++;
+        op->body.accept(this);
+        do_indent();
+        stream << "return 0;\n";
+        cache.clear();
+        indent--;
+        do_indent();
+        stream << "};\n";
+        do_indent();
+        stream << "int " << result_name << " = halide_do_par_for(_ucon, "
+               << "[](void *, int i, uint8_t *closure) -> int { "
+               << "return (*(decltype(" << body_name << ") *)closure)(i); }, "
+               << id_min << ", " << id_extent << ", (uint8_t *)&" << body_name << ");\n";
+        create_assertion("(" + result_name + " == 0)", result_name);
+        close_scope("par_for " + print_name(op->name));
+        return;
     }
 
+    internal_assert(op->for_type == ForType::Serial)
+        << "Can only emit serial or parallel for loops to C\n";
+
     do_indent();
     stream << "for (int "
            << print_name(op->name)
@@ -2533,7 +2641,7 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.type = op->type;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name);
-        stream << op_type << "*" << op_name << " = (" << print_expr(op->new_expr) << ");\n";
+        stream << op_type << "*" << op_name << " = (" << op_type << "*)(" << print_expr(op->new_expr) << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
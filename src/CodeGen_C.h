@@ -146,6 +146,9 @@ protected:
     /** Track current calling convention scope. */
     bool extern_c_open;
 
+    /** Set while generating the body of an Atomic node. */
+    bool emit_atomic_stores;
+
     /** True if at least one gpu-based for loop is used. */
     bool uses_gpu_for_loops;
 
@@ -203,6 +206,7 @@ protected:
     void visit(const Prefetch *) override;
     void visit(const Fork *) override;
     void visit(const Acquire *) override;
+    void visit(const Atomic *) override;
 
     void visit_binop(Type t, Expr a, Expr b, const char *op);
 
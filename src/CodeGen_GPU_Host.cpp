@@ -8,6 +8,7 @@
 #include "CodeGen_OpenGL_Dev.h"
 #include "CodeGen_PTX_Dev.h"
 #include "CodeGen_D3D12Compute_Dev.h"
+#include "CodeGen_Vulkan_Dev.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
 #include "IROperator.h"
@@ -125,6 +126,10 @@ CodeGen_GPU_Host<CodeGen_CPU>::CodeGen_GPU_Host(Target target) : CodeGen_CPU(tar
         debug(1) << "Constructing Direct3D 12 Compute device codegen\n";
         cgdev[DeviceAPI::D3D12Compute] = new CodeGen_D3D12Compute_Dev(target);
     }
+    if (target.has_feature(Target::Vulkan)) {
+        debug(1) << "Constructing Vulkan device codegen\n";
+        cgdev[DeviceAPI::Vulkan] = new CodeGen_Vulkan_Dev(target);
+    }
 
     if (cgdev.empty()) {
         internal_error << "Requested unknown GPU target: " << target.to_string() << "\n";
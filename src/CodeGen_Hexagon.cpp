@@ -110,14 +110,19 @@ Stmt call_halide_qurt_hvx_unlock() {
     return check_hvx_unlock;
 }
 // Wrap the stmt in a call to qurt_hvx_lock, calling qurt_hvx_unlock
-// as a destructor if successful.
-Stmt acquire_hvx_context(Stmt stmt, const Target &target) {
+// as a destructor if successful. The context locked around a whole
+// pipeline may instead be kept by the calling thread for the next
+// pipeline it runs (see halide_qurt_hvx_set_keep_locked).
+Stmt acquire_hvx_context(Stmt stmt, const Target &target, bool whole_pipeline = false) {
     // Modify the stmt to add a call to halide_qurt_hvx_lock, and
     // register a destructor to call halide_qurt_hvx_unlock.
     Stmt check_hvx_lock = call_halide_qurt_hvx_lock(target);
     Expr dummy_obj = reinterpret(Handle(), cast<uint64_t>(1));
+    const char *destructor = whole_pipeline ?
+        "halide_qurt_hvx_unlock_or_keep_as_destructor" :
+        "halide_qurt_hvx_unlock_as_destructor";
     Expr hvx_unlock = Call::make(Int(32), Call::register_destructor,
-                                 {Expr("halide_qurt_hvx_unlock_as_destructor"), dummy_obj}, Call::Intrinsic);
+                                 {Expr(destructor), dummy_obj}, Call::Intrinsic);
 
     stmt = Block::make(Evaluate::make(hvx_unlock), stmt);
     stmt = Block::make(check_hvx_lock, stmt);
@@ -279,7 +284,7 @@ Stmt inject_hvx_lock_unlock(Stmt body, const Target &target) {
     InjectHVXLocks i(target);
     body = i.mutate(body);
     if (i.uses_hvx) {
-        body = acquire_hvx_context(body, target);
+        body = acquire_hvx_context(body, target, true);
     }
     body = substitute("uses_hvx", i.uses_hvx, body);
     body = simplify(body);
@@ -1,9 +1,14 @@
 #include "CodeGen_Internal.h"
 #include "CSE.h"
 #include "Debug.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstdlib>
 
 namespace Halide {
 namespace Internal {
@@ -112,7 +117,11 @@ void unpack_closure(const Closure& closure,
 
 llvm::Type *llvm_type_of(LLVMContext *c, Halide::Type t) {
     if (t.lanes() == 1) {
-        if (t.is_float()) {
+        if (t.is_bfloat()) {
+            // LLVM has no arithmetic on bfloat, so it's stored as
+            // bits. See lower_bfloat16_math.
+            return llvm::Type::getInt16Ty(*c);
+        } else if (t.is_float()) {
             switch (t.bits()) {
             case 16:
                 return llvm::Type::getHalfTy(*c);
@@ -142,6 +151,7 @@ bool function_takes_user_context(const std::string &name) {
         "halide_buffer_copy",
         "halide_copy_to_host",
         "halide_copy_to_device",
+        "halide_copy_region_to_host",
         "halide_current_time_ns",
         "halide_debug_to_file",
         "halide_device_free",
@@ -159,26 +169,44 @@ bool function_takes_user_context(const std::string &name) {
         "halide_error",
         "halide_free",
         "halide_malloc",
+        "halide_arena_create",
+        "halide_arena_malloc",
+        "halide_scratch_acquire",
+        "halide_scratch_malloc",
         "halide_print",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
+        "halide_profiler_measure_roofline",
         "halide_profiler_pipeline_start",
         "halide_profiler_pipeline_end",
+        "halide_profiler_register_branches",
         "halide_profiler_stack_peak_update",
         "halide_spawn_thread",
         "halide_device_release",
         "halide_start_clock",
+        "halide_strided_fallback_warning",
         "halide_trace",
         "halide_trace_helper",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_memoization_cache_release_device",
+        "halide_buffer_content_hash",
         "halide_cuda_run",
+        "halide_cuda_launch_graph_begin",
+        "halide_cuda_launch_graph_flush",
+        "halide_cuda_stream_fence",
+        "halide_cuda_multi_device_count",
+        "halide_cuda_multi_device_begin",
+        "halide_cuda_multi_device_end",
+        "halide_cuda_multi_device_sync",
+        "halide_cuda_buffer_texture",
         "halide_opencl_run",
         "halide_opengl_run",
         "halide_openglcompute_run",
         "halide_metal_run",
         "halide_d3d12compute_run",
+        "halide_vulkan_run",
         "halide_msan_annotate_buffer_is_initialized_as_destructor",
         "halide_msan_annotate_buffer_is_initialized",
         "halide_msan_annotate_memory_is_initialized",
@@ -201,11 +229,20 @@ bool function_takes_user_context(const std::string &name) {
         "halide_openglcompute_initialize_kernels",
         "halide_metal_initialize_kernels",
         "halide_d3d12compute_initialize_kernels",
+        "halide_vulkan_initialize_kernels",
         "halide_get_gpu_device",
+        "halide_hetero_split_fraction",
+        "halide_hetero_split_host_done",
+        "halide_hetero_split_merged",
+        "halide_distributed_rank",
+        "halide_distributed_num_ranks",
+        "halide_distributed_exchange_begin",
+        "halide_distributed_exchange_end",
         "halide_upgrade_buffer_t",
         "halide_downgrade_buffer_t",
         "halide_downgrade_buffer_t_device_fields",
         "_halide_buffer_crop",
+        "_halide_buffer_slice",
         "_halide_buffer_retire_crop_after_extern_stage",
         "_halide_buffer_retire_crops_after_extern_stage",
     };
@@ -222,7 +259,11 @@ bool function_takes_user_context(const std::string &name) {
 
 bool can_allocation_fit_on_stack(int64_t size) {
     user_assert(size > 0) << "Allocation size should be a positive number\n";
-    return (size <= 1024 * 16);
+    static const int64_t max_stack_bytes = []() {
+        std::string limit = get_env_variable("HL_MAX_STACK_ALLOCATION_BYTES");
+        return limit.empty() ? 1024 * 16 : std::max(0LL, std::atoll(limit.c_str()));
+    }();
+    return (size <= max_stack_bytes);
 }
 
 Expr lower_euclidean_div(Expr a, Expr b) {
@@ -363,6 +404,117 @@ Stmt unpredicate_loads_stores(Stmt s) {
     return UnpredicateLoadsStores().mutate(s);
 }
 
+bool match_narrow_product(const Expr &e, Halide::Type a_type, Halide::Type b_type, Expr *a, Expr *b) {
+    const Mul *m = e.as<Mul>();
+    if (!m) {
+        return false;
+    }
+    a_type = a_type.with_lanes(e.type().lanes());
+    b_type = b_type.with_lanes(e.type().lanes());
+    *a = lossless_cast(a_type, m->a);
+    *b = lossless_cast(b_type, m->b);
+    if (a->defined() && b->defined()) {
+        return true;
+    }
+    *a = lossless_cast(a_type, m->b);
+    *b = lossless_cast(b_type, m->a);
+    return a->defined() && b->defined();
+}
+
+void collect_terms(const Expr &e, vector<Expr> &terms) {
+    if (const Add *add = e.as<Add>()) {
+        collect_terms(add->a, terms);
+        collect_terms(add->b, terms);
+    } else {
+        terms.push_back(e);
+    }
+}
+
+namespace {
+
+class LoadsFrom : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        if (op->name == buf) {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    const string &buf;
+
+public:
+    bool result = false;
+    LoadsFrom(const string &buf) : buf(buf) {}
+};
+
+}  // namespace
+
+bool loads_from(const Expr &e, const string &buf) {
+    LoadsFrom l(buf);
+    e.accept(&l);
+    return l.result;
+}
+
+namespace {
+
+class ReplaceSelfLoads : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == store->name && equal(op->index, store->index)) {
+            return replacement;
+        }
+        return IRMutator2::visit(op);
+    }
+
+    const Store *store;
+    const Expr &replacement;
+
+public:
+    ReplaceSelfLoads(const Store *store, const Expr &replacement)
+        : store(store), replacement(replacement) {}
+};
+
+}  // namespace
+
+Expr replace_self_loads(const Store *store, const Expr &replacement) {
+    return ReplaceSelfLoads(store, replacement).mutate(store->value);
+}
+
+Stmt fuse_accumulations(const Stmt &s, const Stmt &next) {
+    const Store *a = s.as<Store>();
+    const Store *b = next.as<Store>();
+    if (!a || !b ||
+        a->name != b->name ||
+        !a->value.type().is_vector() ||
+        a->value.type().element_of() != Int(32) ||
+        !is_one(a->predicate) ||
+        !is_one(b->predicate) ||
+        !equal(a->index, b->index)) {
+        return Stmt();
+    }
+    const Add *add = b->value.as<Add>();
+    if (!add) {
+        return Stmt();
+    }
+    Expr acc = add->a, term = add->b;
+    if (!acc.as<Load>()) {
+        std::swap(acc, term);
+    }
+    const Load *l = acc.as<Load>();
+    if (!l ||
+        l->name != b->name ||
+        !is_one(l->predicate) ||
+        !equal(l->index, b->index) ||
+        loads_from(term, b->name) ||
+        loads_from(b->index, b->name)) {
+        return Stmt();
+    }
+    return Store::make(a->name, a->value + term, a->index, a->param, a->predicate);
+}
+
 bool get_md_bool(llvm::Metadata *value, bool &result) {
     if (!value) {
         return false;
@@ -415,6 +567,25 @@ void get_target_options(const llvm::Module &module, llvm::TargetOptions &options
     options.FloatABIType =
         use_soft_float_abi ? llvm::FloatABI::Soft : llvm::FloatABI::Hard;
     options.RelaxELFRelocations = false;
+
+    // RISC-V defaults to the soft-float ABI even when the F and D
+    // extensions are enabled. Linux uses the hard-float one.
+    llvm::Triple triple(module.getTargetTriple());
+    if (triple.getArch() == llvm::Triple::riscv64) {
+        options.MCOptions.ABIName = "lp64d";
+    } else if (triple.getArch() == llvm::Triple::riscv32) {
+        options.MCOptions.ABIName = "ilp32d";
+    }
+
+    bool fast_compile = false;
+    get_md_bool(module.getModuleFlag("halide_fast_compile"), fast_compile);
+    options.EnableFastISel = fast_compile;
+}
+
+bool use_fast_compile(const llvm::Module &module) {
+    bool fast_compile = false;
+    get_md_bool(module.getModuleFlag("halide_fast_compile"), fast_compile);
+    return fast_compile;
 }
 
 
@@ -437,6 +608,11 @@ void clone_target_options(const llvm::Module &from, llvm::Module &to) {
     if (get_md_string(from.getModuleFlag("halide_mattrs"), mattrs)) {
         to.addModuleFlag(llvm::Module::Warning, "halide_mattrs", llvm::MDString::get(context, mattrs));
     }
+
+    bool fast_compile = false;
+    if (get_md_bool(from.getModuleFlag("halide_fast_compile"), fast_compile)) {
+        to.addModuleFlag(llvm::Module::Warning, "halide_fast_compile", fast_compile ? 1 : 0);
+    }
 }
 
 std::unique_ptr<llvm::TargetMachine> make_target_machine(const llvm::Module &module) {
@@ -460,7 +636,7 @@ std::unique_ptr<llvm::TargetMachine> make_target_machine(const llvm::Module &mod
                                                 options,
                                                 llvm::Reloc::PIC_,
                                                 llvm::CodeModel::Small,
-                                                llvm::CodeGenOpt::Aggressive));
+                                                use_fast_compile(module) ? llvm::CodeGenOpt::Less : llvm::CodeGenOpt::Aggressive));
 }
 
 void set_function_attributes_for_target(llvm::Function *fn, Target t) {
@@ -64,8 +64,9 @@ llvm::Type *llvm_type_of(llvm::LLVMContext *context, Halide::Type t);
 bool function_takes_user_context(const std::string &name);
 
 /** Given a size (in bytes), return True if the allocation size can fit
- * on the stack; otherwise, return False. This routine asserts if size is
- * non-positive. */
+ * on the stack; otherwise, return False. The limit is 16kB, unless
+ * overridden with the HL_MAX_STACK_ALLOCATION_BYTES environment
+ * variable. This routine asserts if size is non-positive. */
 bool can_allocation_fit_on_stack(int64_t size);
 
 /** Given a Halide Euclidean division/mod operation, define it in terms of
@@ -79,9 +80,38 @@ Expr lower_euclidean_mod(Expr a, Expr b);
  * inside branches. */
 Stmt unpredicate_loads_stores(Stmt s);
 
+/** If e is the product of something losslessly castable to a_type and
+ * something losslessly castable to b_type, in either order, set a and
+ * b to the narrowed factors and return true. */
+bool match_narrow_product(const Expr &e, Type a_type, Type b_type, Expr *a, Expr *b);
+
+/** Flatten a tree of Adds into its terms. */
+void collect_terms(const Expr &e, std::vector<Expr> &terms);
+
+/** Does an Expr load from the named buffer anywhere? */
+bool loads_from(const Expr &e, const std::string &buf);
+
+/** Replace the loads of the element a store writes to, in the value
+ * it stores, with the given Expr. Used to generate atomic
+ * read-modify-writes, where the old value comes from elsewhere. */
+Expr replace_self_loads(const Store *store, const Expr &replacement);
+
+/** If s and next are stores of 32-bit integer vectors, and next adds
+ * something to the element s just stored, return a single store of
+ * the whole sum. Otherwise return an undefined Stmt. Unrolling a short
+ * reduction gives runs of such stores, and fusing them lets codegen
+ * see all of the terms being accumulated at once, to pick out dot
+ * product instructions. */
+Stmt fuse_accumulations(const Stmt &s, const Stmt &next);
+
 /** Given an llvm::Module, set llvm:TargetOptions, cpu and attr information */
 void get_target_options(const llvm::Module &module, llvm::TargetOptions &options, std::string &mcpu, std::string &mattrs);
 
+/** Given an llvm::Module, check whether it was compiled for a target
+ * with the fast_compile feature, in which case code generation should
+ * use a lower optimization level. */
+bool use_fast_compile(const llvm::Module &module);
+
 /** Given two llvm::Modules, clone target options from one to the other */
 void clone_target_options(const llvm::Module &from, llvm::Module &to);
 
@@ -12,10 +12,15 @@
 #include "CodeGen_LLVM.h"
 #include "CodeGen_MIPS.h"
 #include "CodeGen_PowerPC.h"
+#include "CodeGen_RISCV.h"
+#include "CodeGen_WebAssembly.h"
 #include "CodeGen_X86.h"
+#include "CodeSize.h"
+#include "CompilerProfiling.h"
 #include "Debug.h"
 #include "Deinterleave.h"
 #include "ExprUsesVar.h"
+#include "IREquality.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "IntegerDivisionTable.h"
@@ -24,6 +29,7 @@
 #include "LLVM_Runtime_Linker.h"
 #include "Lerp.h"
 #include "MatlabWrapper.h"
+#include "MultiversionLoops.h"
 #include "Simplify.h"
 #include "Util.h"
 
@@ -132,6 +138,18 @@ using std::vector;
 #define InitializeHexagonAsmPrinter()   InitializeAsmPrinter(Hexagon)
 #endif
 
+#ifdef WITH_RISCV
+#define InitializeRISCVTarget()       InitializeTarget(RISCV)
+#define InitializeRISCVAsmParser()    InitializeAsmParser(RISCV)
+#define InitializeRISCVAsmPrinter()   InitializeAsmPrinter(RISCV)
+#endif
+
+#ifdef WITH_WEBASSEMBLY
+#define InitializeWebAssemblyTarget()       InitializeTarget(WebAssembly)
+#define InitializeWebAssemblyAsmParser()    InitializeAsmParser(WebAssembly)
+#define InitializeWebAssemblyAsmPrinter()   InitializeAsmPrinter(WebAssembly)
+#endif
+
 namespace {
 
 // Get the LLVM linkage corresponding to a Halide linkage type.
@@ -261,7 +279,9 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
     min_f64(Float(64).min()),
     max_f64(Float(64).max()),
     destructor_block(nullptr),
-    strict_float(t.has_feature(Target::StrictFloat)) {
+    strict_float(t.has_feature(Target::StrictFloat)),
+    in_nontemporal_store(false), emitted_nontemporal_store(false),
+    emit_atomic_stores(false) {
     initialize_llvm();
 }
 
@@ -289,7 +309,8 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
                                 Target::OpenGL,
                                 Target::OpenGLCompute,
                                 Target::Metal,
-                                Target::D3D12Compute})) {
+                                Target::D3D12Compute,
+                                Target::Vulkan})) {
 #ifdef WITH_X86
         if (target.arch == Target::X86) {
             return make_codegen<CodeGen_GPU_Host<CodeGen_X86>>(target, context);
@@ -310,6 +331,11 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
             return make_codegen<CodeGen_GPU_Host<CodeGen_PowerPC>>(target, context);
         }
 #endif
+#ifdef WITH_RISCV
+        if (target.arch == Target::RISCV) {
+            return make_codegen<CodeGen_GPU_Host<CodeGen_RISCV>>(target, context);
+        }
+#endif
 
         user_error << "Invalid target architecture for GPU backend: "
                    << target.to_string() << "\n";
@@ -325,6 +351,10 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
         return make_codegen<CodeGen_PowerPC>(target, context);
     } else if (target.arch == Target::Hexagon) {
         return make_codegen<CodeGen_Hexagon>(target, context);
+    } else if (target.arch == Target::WebAssembly) {
+        return make_codegen<CodeGen_WebAssembly>(target, context);
+    } else if (target.arch == Target::RISCV) {
+        return make_codegen<CodeGen_RISCV>(target, context);
     }
 
     user_error << "Unknown target architecture: "
@@ -457,6 +487,8 @@ bool CodeGen_LLVM::llvm_NVPTX_enabled = false;
 bool CodeGen_LLVM::llvm_Mips_enabled = false;
 bool CodeGen_LLVM::llvm_PowerPC_enabled = false;
 bool CodeGen_LLVM::llvm_AMDGPU_enabled = false;
+bool CodeGen_LLVM::llvm_WebAssembly_enabled = false;
+bool CodeGen_LLVM::llvm_RISCV_enabled = false;
 
 namespace {
 
@@ -508,20 +540,78 @@ MangledNames get_mangled_names(const LoweredFunc &f, const Target &target) {
 
 }  // namespace
 
+void CodeGen_LLVM::add_target_module_flags(llvm::Module &m, bool any_strict_float) {
+    llvm::LLVMContext &ctx = m.getContext();
+    m.addModuleFlag(llvm::Module::Warning, "halide_use_soft_float_abi", use_soft_float_abi() ? 1 : 0);
+    m.addModuleFlag(llvm::Module::Warning, "halide_mcpu", MDString::get(ctx, mcpu()));
+    m.addModuleFlag(llvm::Module::Warning, "halide_mattrs", MDString::get(ctx, mattrs()));
+    m.addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", any_strict_float);
+    m.addModuleFlag(llvm::Module::Warning, "halide_fast_compile", target.has_feature(Target::FastCompile));
+}
+
+namespace {
+
+// The number of LLVM instructions in a module.
+int64_t count_module_instructions(const llvm::Module &m) {
+    int64_t n = 0;
+    for (const auto &f : m) {
+        for (const auto &b : f) {
+            n += b.size();
+        }
+    }
+    return n;
+}
+
+// The number of LLVM instructions in a module, as a measure of its
+// size for the compile-time profile.
+int64_t count_instructions(const llvm::Module &m) {
+    if (!CompilePhaseTimer::enabled()) {
+        return -1;
+    }
+    return count_module_instructions(m);
+}
+
+}  // namespace
+
 std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
+    CompilePhaseTimer timer("codegen");
+
     input_module = &input;
 
-    init_module();
+    {
+        // Link in the runtime modules needed by any loop nests
+        // compiled for targets with more features than ours.
+        class FindRegionTargets : public IRVisitor {
+            using IRVisitor::visit;
+            void visit(const ProducerConsumer *op) override {
+                Target t;
+                if (is_multiversion_region(op, &t)) {
+                    for (int i = 0; i < Target::FeatureEnd; i++) {
+                        if (t.has_feature((Target::Feature)i)) {
+                            link_target.set_feature((Target::Feature)i);
+                        }
+                    }
+                }
+                IRVisitor::visit(op);
+            }
+        public:
+            Target link_target;
+            FindRegionTargets(const Target &t) : link_target(t) {}
+        } find_region_targets(target);
+        for (const auto &f : input.functions()) {
+            f.body.accept(&find_region_targets);
+        }
+        ScopedValue<Target> old_target(target, find_region_targets.link_target);
+        init_module();
+    }
+    timer.lap("initializing module and linking runtime", count_instructions(*module));
 
     debug(1) << "Target triple of initial module: " << module->getTargetTriple() << "\n";
 
     module->setModuleIdentifier(input.name());
 
     // Add some target specific info to the module as metadata.
-    module->addModuleFlag(llvm::Module::Warning, "halide_use_soft_float_abi", use_soft_float_abi() ? 1 : 0);
-    module->addModuleFlag(llvm::Module::Warning, "halide_mcpu", MDString::get(*context, mcpu()));
-    module->addModuleFlag(llvm::Module::Warning, "halide_mattrs", MDString::get(*context, mattrs()));
-    module->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", input.any_strict_float());
+    add_target_module_flags(*module, input.any_strict_float());
 
     internal_assert(module && context && builder)
         << "The CodeGen_LLVM subclass should have made an initial module before calling CodeGen_LLVM::compile\n";
@@ -570,7 +660,17 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     for (const auto &f : input.functions()) {
         const auto names = get_mangled_names(f, get_target());
 
-        compile_func(f, names.simple_name, names.extern_name);
+        if (code_size_report_enabled()) {
+            // The code outside of any producer is the pipeline's own.
+            int64_t before = count_module_instructions(*module);
+            nested_code_size.push_back(0);
+            compile_func(f, names.simple_name, names.extern_name);
+            int64_t size = count_module_instructions(*module) - before;
+            generated_code_size[""] += size - nested_code_size.back();
+            nested_code_size.pop_back();
+        } else {
+            compile_func(f, names.simple_name, names.extern_name);
+        }
 
         // If the Func is externally visible, also create the argv wrapper and metadata.
         // (useful for calling from JIT and other machine interfaces).
@@ -587,12 +687,27 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
 
     debug(2) << module.get() << "\n";
 
+    timer.lap("generating llvm bitcode", count_instructions(*module));
+
+    if (code_size_report_enabled()) {
+        map<string, int64_t> estimated;
+        for (const auto &f : input.functions()) {
+            for (const auto &e : estimate_code_size(f.body, target)) {
+                estimated[e.first] += e.second;
+            }
+        }
+        report_code_size(input.name(), estimated, generated_code_size);
+        generated_code_size.clear();
+    }
+
     // Verify the module is ok
     internal_assert(!verifyModule(*module, &llvm::errs()));
     debug(2) << "Done generating llvm bitcode\n";
+    timer.lap("verifying module");
 
     // Optimize
     CodeGen_LLVM::optimize_module();
+    timer.lap("llvm optimization", count_instructions(*module));
 
     if (target.has_feature(Target::EmbedBitcode)) {
         std::string halide_command = "halide target=" + target.to_string();
@@ -720,7 +835,9 @@ void CodeGen_LLVM::compile_func(const LoweredFunc &f, const std::string &simple_
 
      // Generate the function body.
     debug(1) << "Generating llvm bitcode for function " << f.name << "...\n";
+    emitted_nontemporal_store = false;
     f.body.accept(this);
+    fence_nontemporal_stores();
 
     // Clean up and return.
     end_func(f.args);
@@ -736,6 +853,21 @@ std::vector<llvm::Constant*> get_constants(llvm::Type *t, It begin, It end) {
     return ret;
 }
 
+void CodeGen_LLVM::add_nontemporal_metadata(llvm::StoreInst *store) {
+    if (!in_nontemporal_store) {
+        return;
+    }
+    llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+    store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
+    emitted_nontemporal_store = true;
+}
+
+void CodeGen_LLVM::fence_nontemporal_stores() {
+    if (emitted_nontemporal_store) {
+        builder->CreateFence(AtomicOrdering::SequentiallyConsistent);
+    }
+}
+
 BasicBlock *CodeGen_LLVM::get_destructor_block() {
     if (!destructor_block) {
         // Create it if it doesn't exist.
@@ -1137,11 +1269,20 @@ void CodeGen_LLVM::optimize_module() {
     function_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
 
     PassManagerBuilder b;
-    b.OptLevel = 3;
+    if (get_target().has_feature(Target::FastCompile)) {
+        // Halide has already vectorized and unrolled as scheduled, so
+        // leave LLVM's own loop transformations out.
+        b.OptLevel = 1;
+        b.LoopVectorize = false;
+        b.DisableUnrollLoops = true;
+        b.SLPVectorize = false;
+    } else {
+        b.OptLevel = 3;
+        b.LoopVectorize = !get_target().has_feature(Target::DisableLLVMLoopVectorize);
+        b.DisableUnrollLoops = get_target().has_feature(Target::DisableLLVMLoopUnroll);
+        b.SLPVectorize = true;  // Note: SLP vectorization has no analogue in the Halide scheduling model
+    }
     b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
-    b.LoopVectorize = !get_target().has_feature(Target::DisableLLVMLoopVectorize);
-    b.DisableUnrollLoops = get_target().has_feature(Target::DisableLLVMLoopUnroll);
-    b.SLPVectorize = true;  // Note: SLP vectorization has no analogue in the Halide scheduling model
 
     if (TM) {
         TM->adjustPassManager(b);
@@ -1173,6 +1314,12 @@ void CodeGen_LLVM::optimize_module() {
     b.populateFunctionPassManager(function_pass_manager);
     b.populateModulePassManager(module_pass_manager);
 
+    // Break the optimization time down by LLVM pass too.
+    CompilePhaseTimer timer("llvm_opt");
+    if (CompilePhaseTimer::enabled()) {
+        TimePassesIsEnabled = true;
+    }
+
     // Run optimization passes
     function_pass_manager.doInitialization();
     for (llvm::Module::iterator i = module->begin(); i != module->end(); i++) {
@@ -1196,7 +1343,9 @@ void CodeGen_LLVM::optimize_module() {
         function_pass_manager.run(*i);
     }
     function_pass_manager.doFinalization();
+    timer.lap("function passes", count_instructions(*module));
     module_pass_manager.run(*module);
+    timer.lap("module passes", count_instructions(*module));
 
     debug(3) << "After LLVM optimizations:\n";
     if (debug::debug_level() >= 2) {
@@ -1264,7 +1413,13 @@ void CodeGen_LLVM::visit(const UIntImm *op) {
 }
 
 void CodeGen_LLVM::visit(const FloatImm *op) {
-    value = ConstantFP::get(llvm_type_of(op->type), op->value);
+    if (op->type.is_bfloat()) {
+        // Only the constants in argument metadata get here. The rest
+        // have already been replaced with their bits.
+        value = ConstantInt::get(i16_t, bfloat16_t(op->value).to_bits());
+    } else {
+        value = ConstantFP::get(llvm_type_of(op->type), op->value);
+    }
 }
 
 void CodeGen_LLVM::visit(const StringImm *op) {
@@ -2758,17 +2913,26 @@ void CodeGen_LLVM::visit(const Call *op) {
         builder->CreateCondBr(builder->CreateIsNotNull(loaded_value),
             global_inited_bb, global_not_inited_bb, very_likely_branch);
 
-        // Build the not-already-inited case
+        // Build the not-already-inited case. Evaluate the conditions
+        // in order, and stop at the first one that holds, so that
+        // we don't query the features of targets we won't use.
         builder->SetInsertPoint(global_not_inited_bb);
-        llvm::Value *selected_value = nullptr;
-        for (int i = sub_fns.size() - 1; i >= 0; i--) {
-            const auto sub_fn = sub_fns[i];
-            if (!selected_value) {
-                selected_value = sub_fn.fn_ptr;
-            } else {
-                Value *c = codegen(sub_fn.cond);
-                selected_value = builder->CreateSelect(c, sub_fn.fn_ptr, selected_value);
-            }
+        BasicBlock *store_bb = BasicBlock::Create(*context, "store_fn_ptr_bb", function);
+        vector<std::pair<llvm::Value *, BasicBlock *>> candidates;
+        for (size_t i = 0; i + 1 < sub_fns.size(); i++) {
+            Value *c = codegen(sub_fns[i].cond);
+            BasicBlock *next_bb = BasicBlock::Create(*context, "check_next_fn_bb", function);
+            candidates.push_back({sub_fns[i].fn_ptr, builder->GetInsertBlock()});
+            builder->CreateCondBr(c, store_bb, next_bb);
+            builder->SetInsertPoint(next_bb);
+        }
+        candidates.push_back({sub_fns.back().fn_ptr, builder->GetInsertBlock()});
+        builder->CreateBr(store_bb);
+
+        builder->SetInsertPoint(store_bb);
+        PHINode *selected_value = builder->CreatePHI(sub_fns.back().fn_ptr->getType(), candidates.size());
+        for (const auto &c : candidates) {
+            selected_value->addIncoming(c.first, c.second);
         }
         builder->CreateStore(selected_value, global);
         builder->CreateBr(call_fn_bb);
@@ -2779,7 +2943,7 @@ void CodeGen_LLVM::visit(const Call *op) {
 
         builder->SetInsertPoint(call_fn_bb);
         PHINode *phi = builder->CreatePHI(selected_value->getType(), 2);
-        phi->addIncoming(selected_value, global_not_inited_bb);
+        phi->addIncoming(selected_value, store_bb);
         phi->addIncoming(loaded_value, global_inited_bb);
 
         std::vector<llvm::Value *> call_args;
@@ -2806,6 +2970,27 @@ void CodeGen_LLVM::visit(const Call *op) {
 
         value = builder->CreateCall(prefetch_fn, args);
 
+    } else if (op->is_intrinsic(Call::copy_memory)) {
+        // {dst, dst_index, src, src_index, count}
+        internal_assert(op->args.size() == 5);
+        Value *dst = codegen_buffer_pointer(codegen(op->args[0]), op->type, op->args[1]);
+        Value *src = codegen_buffer_pointer(codegen(op->args[2]), op->type, op->args[3]);
+        Value *size = codegen(cast<int64_t>(op->args[4]) * op->type.bytes());
+        int align = op->type.bytes();
+#if LLVM_VERSION >= 70
+        builder->CreateMemCpy(dst, align, src, align, size);
+#else
+        builder->CreateMemCpy(dst, src, size, align);
+#endif
+        value = UndefValue::get(llvm_type_of(op->type));
+    } else if (op->is_intrinsic(Call::fill_memory)) {
+        // {dst, dst_index, byte, count}
+        internal_assert(op->args.size() == 4);
+        Value *dst = codegen_buffer_pointer(codegen(op->args[0]), op->type, op->args[1]);
+        Value *byte = codegen(op->args[2]);
+        Value *size = codegen(cast<int64_t>(op->args[3]) * op->type.bytes());
+        builder->CreateMemSet(dst, byte, size, op->type.bytes());
+        value = UndefValue::get(llvm_type_of(op->type));
     } else if (op->is_intrinsic(Call::signed_integer_overflow)) {
         user_error << "Signed integer overflow occurred during constant-folding. Signed"
             " integer overflow for int32 and int64 is undefined behavior in"
@@ -2833,6 +3018,12 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         llvm::DataLayout d(module.get());
         value = ConstantInt::get(i32_t, (int)d.getTypeAllocSize(buffer_t_type));
+    } else if (op->is_intrinsic(Call::nontemporal)) {
+        // Only meaningful as the value of a Store.
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::branch_weights)) {
+        // Only meaningful as the condition of an IfThenElse.
+        value = codegen(op->args[0]);
     } else if (op->is_intrinsic(Call::strict_float)) {
         IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>::FastMathFlagGuard guard(*builder);
         llvm::FastMathFlags safe_flags;
@@ -3144,6 +3335,12 @@ void CodeGen_LLVM::return_with_error_code(llvm::Value *error_code) {
 }
 
 void CodeGen_LLVM::visit(const ProducerConsumer *op) {
+    Target region_target;
+    if (is_multiversion_region(op, &region_target)) {
+        do_multiversion_region(region_target, op->body);
+        return;
+    }
+
     string name;
     if (op->is_producer) {
         name = std::string("produce ") + op->name;
@@ -3153,7 +3350,23 @@ void CodeGen_LLVM::visit(const ProducerConsumer *op) {
     BasicBlock *produce = BasicBlock::Create(*context, name, function);
     builder->CreateBr(produce);
     builder->SetInsertPoint(produce);
-    codegen(op->body);
+
+    if (op->is_producer && code_size_report_enabled()) {
+        // Count the instructions generated for this producer, less
+        // those of the producers nested inside it, which are counted
+        // separately.
+        int64_t before = count_module_instructions(*module);
+        nested_code_size.push_back(0);
+        codegen(op->body);
+        int64_t size = count_module_instructions(*module) - before;
+        generated_code_size[op->name] += size - nested_code_size.back();
+        nested_code_size.pop_back();
+        if (!nested_code_size.empty()) {
+            nested_code_size.back() += size;
+        }
+    } else {
+        codegen(op->body);
+    }
 }
 
 void CodeGen_LLVM::visit(const For *op) {
@@ -3465,7 +3678,11 @@ void CodeGen_LLVM::do_parallel_tasks(const vector<ParallelTask> &tasks) {
         }
 
         // Generate the new function body
+        bool parent_emitted_nontemporal_store = emitted_nontemporal_store;
+        emitted_nontemporal_store = false;
         codegen(t.body);
+        fence_nontemporal_stores();
+        emitted_nontemporal_store = parent_emitted_nontemporal_store;
 
         // Return success
         return_with_error_code(ConstantInt::get(i32_t, 0));
@@ -3534,6 +3751,89 @@ void CodeGen_LLVM::do_parallel_tasks(const vector<ParallelTask> &tasks) {
     create_assertion(did_succeed, Expr(), result);
 }
 
+void CodeGen_LLVM::do_multiversion_region(const Target &t, const Stmt &body) {
+    Closure closure;
+    body.accept(&closure);
+
+    // Allocate a closure
+    StructType *closure_t = build_closure_type(closure, buffer_t_type, context);
+    Value *closure_ptr = create_alloca_at_entry(closure_t, 1);
+
+    // Fill in the closure
+    pack_closure(closure_t, closure_ptr, closure, symbol_table, buffer_t_type, builder);
+
+    closure_ptr = builder->CreatePointerCast(closure_ptr, i8_t->getPointerTo());
+
+    llvm::Type *args_t[] = {i8_t->getPointerTo(), i8_t->getPointerTo()};
+    FunctionType *fn_type = FunctionType::get(i32_t, args_t, false);
+
+    // Make a new function that does the body, and compile it for the
+    // given target. The features it is compiled with are set on the
+    // function, as the module is compiled for our own target.
+    llvm::Function *containing_function = function;
+    function = llvm::Function::Create(fn_type, llvm::Function::InternalLinkage,
+                                      unique_name("multiversion_" + replace_all(t.to_string(), "-", "_")),
+                                      module.get());
+    llvm::Function *region_function = function;
+    function->addParamAttr(1, Attribute::NoAlias);
+
+    Target parent_target = target;
+    target = t;
+    set_function_attributes_for_target(function, target);
+    function->addFnAttr("target-cpu", mcpu());
+    function->addFnAttr("target-features", mattrs());
+
+    // Make the initial basic block and jump the builder into the new function
+    IRBuilderBase::InsertPoint call_site = builder->saveIP();
+    BasicBlock *block = BasicBlock::Create(*context, "entry", function);
+    builder->SetInsertPoint(block);
+
+    // Save the destructor block
+    BasicBlock *parent_destructor_block = destructor_block;
+    destructor_block = nullptr;
+
+    // Make a new scope to use
+    Scope<Value *> saved_symbol_table;
+    symbol_table.swap(saved_symbol_table);
+
+    // The user context is first argument of the function, and the
+    // closure is second.
+    llvm::Function::arg_iterator iter = function->arg_begin();
+    sym_push("__user_context", iterator_to_pointer(iter));
+    ++iter;
+    iter->setName("closure");
+    Value *closure_handle = builder->CreatePointerCast(iterator_to_pointer(iter),
+                                                       closure_t->getPointerTo());
+
+    // Load everything from the closure into the new scope
+    unpack_closure(closure, symbol_table, closure_t, closure_handle, builder);
+
+    // Generate the new function body
+    bool parent_emitted_nontemporal_store = emitted_nontemporal_store;
+    emitted_nontemporal_store = false;
+    codegen(body);
+    fence_nontemporal_stores();
+    emitted_nontemporal_store = parent_emitted_nontemporal_store;
+
+    // Return success
+    return_with_error_code(ConstantInt::get(i32_t, 0));
+
+    // Move the builder back to the main function, and restore its
+    // scope, destructor block, and target.
+    builder->restoreIP(call_site);
+    symbol_table.swap(saved_symbol_table);
+    function = containing_function;
+    destructor_block = parent_destructor_block;
+    target = parent_target;
+
+    Value *args[] = {get_user_context(), closure_ptr};
+    Value *result = builder->CreateCall(region_function, args);
+
+    // Check for success
+    Value *did_succeed = builder->CreateICmpEQ(result, ConstantInt::get(i32_t, 0));
+    create_assertion(did_succeed, Expr(), result);
+}
+
 namespace {
 
 string task_debug_name(const std::pair<string, int> &prefix) {
@@ -3616,6 +3916,96 @@ void CodeGen_LLVM::visit(const Fork *op) {
     do_as_parallel_task(op);
 }
 
+void CodeGen_LLVM::visit(const Atomic *op) {
+    ScopedValue<bool> old_emit_atomic_stores(emit_atomic_stores, true);
+    codegen(op->body);
+}
+
+void CodeGen_LLVM::codegen_atomic_store(const Store *op) {
+    Halide::Type value_type = op->value.type();
+    user_assert(value_type.is_scalar() && is_one(op->predicate))
+        << "Can't store to " << op->name << " atomically, since the store is vectorized\n";
+    user_assert(value_type.bits() >= 8 && !value_type.is_handle())
+        << "Can't store to " << op->name << " atomically, since atomic stores of "
+        << value_type << " are not supported\n";
+
+    Value *ptr = codegen_buffer_pointer(op->name, value_type, op->index);
+
+    string old_name = unique_name('t');
+    Expr old_var = Variable::make(value_type, old_name);
+    Expr value = replace_self_loads(op, old_var);
+    if (!expr_uses_var(value, old_name)) {
+        // The value doesn't depend on what's being overwritten, and a
+        // scalar store of at most a word is already atomic.
+        StoreInst *store = builder->CreateAlignedStore(codegen(value), ptr, value_type.bytes());
+        store->setAtomic(AtomicOrdering::Monotonic);
+        return;
+    }
+
+    // Sums, mins, and maxes of a term that doesn't depend on the old
+    // value map to single read-modify-write instructions.
+    Expr term;
+    AtomicRMWInst::BinOp rmw_op = AtomicRMWInst::BAD_BINOP;
+    auto other_term = [&](const Expr &a, const Expr &b) {
+        if (equal(a, old_var) && !expr_uses_var(b, old_name)) {
+            term = b;
+        } else if (equal(b, old_var) && !expr_uses_var(a, old_name)) {
+            term = a;
+        }
+        return term.defined();
+    };
+    if (const Add *add = value.as<Add>()) {
+        if (other_term(add->a, add->b)) {
+            if (value_type.is_float()) {
+#if LLVM_VERSION >= 90
+                rmw_op = AtomicRMWInst::FAdd;
+#endif
+            } else {
+                rmw_op = AtomicRMWInst::Add;
+            }
+        }
+    } else if (const Min *min = value.as<Min>()) {
+        if (other_term(min->a, min->b) && !value_type.is_float()) {
+            rmw_op = value_type.is_uint() ? AtomicRMWInst::UMin : AtomicRMWInst::Min;
+        }
+    } else if (const Max *max = value.as<Max>()) {
+        if (other_term(max->a, max->b) && !value_type.is_float()) {
+            rmw_op = value_type.is_uint() ? AtomicRMWInst::UMax : AtomicRMWInst::Max;
+        }
+    }
+    if (rmw_op != AtomicRMWInst::BAD_BINOP) {
+        builder->CreateAtomicRMW(rmw_op, ptr, codegen(term), AtomicOrdering::Monotonic);
+        return;
+    }
+
+    // Otherwise, compute the new value from the old one and try to
+    // swap it in with a compare-and-swap, until no other thread has
+    // changed the value in the meantime. Floats are swapped as
+    // integers of the same size.
+    llvm::Type *int_t = llvm_type_of(UInt(value_type.bits()));
+    Value *int_ptr = builder->CreatePointerCast(ptr, int_t->getPointerTo(ptr->getType()->getPointerAddressSpace()));
+    Value *orig = builder->CreateAlignedLoad(int_ptr, value_type.bytes());
+
+    BasicBlock *preheader_bb = builder->GetInsertBlock();
+    BasicBlock *loop_bb = BasicBlock::Create(*context, "atomic_cas_loop", function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, "atomic_cas_done", function);
+    builder->CreateBr(loop_bb);
+    builder->SetInsertPoint(loop_bb);
+
+    PHINode *old_int = builder->CreatePHI(int_t, 2);
+    old_int->addIncoming(orig, preheader_bb);
+    sym_push(old_name, builder->CreateBitCast(old_int, llvm_type_of(value_type)));
+    Value *new_int = builder->CreateBitCast(codegen(value), int_t);
+    sym_pop(old_name);
+
+    Value *cmpxchg = builder->CreateAtomicCmpXchg(int_ptr, old_int, new_int,
+                                                  AtomicOrdering::Monotonic,
+                                                  AtomicOrdering::Monotonic);
+    old_int->addIncoming(builder->CreateExtractValue(cmpxchg, {0}), builder->GetInsertBlock());
+    builder->CreateCondBr(builder->CreateExtractValue(cmpxchg, {1}), after_bb, loop_bb);
+    builder->SetInsertPoint(after_bb);
+}
+
 void CodeGen_LLVM::visit(const Store *op) {
     // Even on 32-bit systems, Handles are treated as 64-bit in
     // memory, so convert stores of handles to stores of uint64_ts.
@@ -3625,6 +4015,21 @@ void CodeGen_LLVM::visit(const Store *op) {
         return;
     }
 
+    if (emit_atomic_stores) {
+        codegen_atomic_store(op);
+        return;
+    }
+
+    // Non-temporal store. Strip the marker, and generate the store
+    // with the marker set (possibly in a subclass).
+    if (const Call *c = op->value.as<Call>()) {
+        if (c->is_intrinsic(Call::nontemporal)) {
+            ScopedValue<bool> old_in_nontemporal_store(in_nontemporal_store, true);
+            codegen(Store::make(op->name, c->args[0], op->index, op->param, op->predicate));
+            return;
+        }
+    }
+
     // Predicated store
     if (!is_one(op->predicate)) {
         codegen_predicated_vector_store(op);
@@ -3683,6 +4088,7 @@ void CodeGen_LLVM::visit(const Store *op) {
                 Value *vec_ptr = builder->CreatePointerCast(elt_ptr, slice_val->getType()->getPointerTo());
                 StoreInst *store = builder->CreateAlignedStore(slice_val, vec_ptr, alignment);
                 add_tbaa_metadata(store, op->name, slice_index);
+                add_nontemporal_metadata(store);
             }
         } else if (ramp) {
             Type ptr_type = value_type.element_of();
@@ -3742,7 +4148,20 @@ void CodeGen_LLVM::visit(const IfThenElse *op) {
     BasicBlock *true_bb = BasicBlock::Create(*context, "true_bb", function);
     BasicBlock *false_bb = BasicBlock::Create(*context, "false_bb", function);
     BasicBlock *after_bb = BasicBlock::Create(*context, "after_bb", function);
-    builder->CreateCondBr(codegen(op->condition), true_bb, false_bb);
+    // Branches annotated with measured weights by
+    // apply_branch_profile.
+    const Call *weighted = op->condition.as<Call>();
+    if (weighted && weighted->is_intrinsic(Call::branch_weights)) {
+        internal_assert(weighted->args.size() == 3);
+        const int64_t *taken = as_const_int(weighted->args[1]);
+        const int64_t *not_taken = as_const_int(weighted->args[2]);
+        internal_assert(taken && not_taken);
+        llvm::MDBuilder md_builder(*context);
+        builder->CreateCondBr(codegen(weighted->args[0]), true_bb, false_bb,
+                              md_builder.createBranchWeights((uint32_t)*taken, (uint32_t)*not_taken));
+    } else {
+        builder->CreateCondBr(codegen(op->condition), true_bb, false_bb);
+    }
 
     builder->SetInsertPoint(true_bb);
     codegen(op->then_case);
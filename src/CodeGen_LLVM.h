@@ -19,6 +19,7 @@ class Type;
 class StructType;
 class Instruction;
 class CallInst;
+class StoreInst;
 class ExecutionEngine;
 class AllocaInst;
 class Constant;
@@ -64,6 +65,10 @@ public:
     /** The target we're generating code for */
     const Target &get_target() const { return target; }
 
+    /** Record how code for this target is generated (-mcpu, -mattrs,
+     * float ABI) as module flags on an llvm module. */
+    void add_target_module_flags(llvm::Module &m, bool any_strict_float);
+
     /** Tell the code generator which LLVM context to use. */
     void set_context(llvm::LLVMContext &context);
 
@@ -120,8 +125,18 @@ protected:
     static bool llvm_Mips_enabled;
     static bool llvm_PowerPC_enabled;
     static bool llvm_AMDGPU_enabled;
+    static bool llvm_WebAssembly_enabled;
+    static bool llvm_RISCV_enabled;
 
     const Module *input_module;
+
+    /** The number of LLVM instructions generated for each Func, and
+     * for the producers being generated, for HL_CODE_SIZE_REPORT. */
+    // @{
+    std::map<std::string, int64_t> generated_code_size;
+    std::vector<int64_t> nested_code_size;
+    // @}
+
     std::unique_ptr<llvm::Module> module;
     llvm::Function *function;
     llvm::LLVMContext *context;
@@ -279,6 +294,10 @@ protected:
     void do_parallel_tasks(const std::vector<ParallelTask> &tasks);
     void do_as_parallel_task(Stmt s);
 
+    /** Outline a loop nest duplicated by multiversion_loops into a
+     * function compiled for the given target, and call it. */
+    void do_multiversion_region(const Target &t, const Stmt &body);
+
     /** Return the the pipeline with the given error code. Will run
      * the destructor block. */
     void return_with_error_code(llvm::Value *error_code);
@@ -310,6 +329,15 @@ protected:
      * different buffers */
     void add_tbaa_metadata(llvm::Instruction *inst, std::string buffer, Expr index);
 
+    /** Mark a dense vector store as non-temporal, if it's part of a
+     * Store that should bypass the cache. */
+    void add_nontemporal_metadata(llvm::StoreInst *store);
+
+    /** Non-temporal stores are weakly ordered, so if the current
+     * function made any, emit a fence that makes them visible to
+     * other threads before it returns. */
+    void fence_nontemporal_stores();
+
     /** Get a unique name for the actual block of memory that an
      * allocate node uses. Used so that alias analysis understands
      * when multiple Allocate nodes shared the same memory. */
@@ -365,6 +393,7 @@ protected:
     void visit(const ProducerConsumer *) override;
     void visit(const For *) override;
     void visit(const Acquire *) override;
+    void visit(const Atomic *) override;
     void visit(const Store *) override;
     void visit(const Block *) override;
     void visit(const Fork *) override;
@@ -488,6 +517,22 @@ private:
     /** Turn off all unsafe math flags in scopes while this is set. */
     bool strict_float;
 
+    /** Set while generating a Store whose value is marked with
+     * Call::nontemporal, and whether the function currently being
+     * generated has any such stores. */
+    // @{
+    bool in_nontemporal_store, emitted_nontemporal_store;
+    // @}
+
+    /** Set while generating the body of an Atomic node. Stores are
+     * then generated by codegen_atomic_store. */
+    bool emit_atomic_stores;
+
+    /** Generate a store as an atomic read-modify-write: an atomic
+     * instruction if there is one for the operation, and a
+     * compare-and-swap loop otherwise. */
+    void codegen_atomic_store(const Store *);
+
     /** Embed an instance of halide_filter_metadata_t in the code, using
      * the given name (by convention, this should be ${FUNCTIONNAME}_metadata)
      * as extern "C" linkage. Note that the return value is a function-returning-
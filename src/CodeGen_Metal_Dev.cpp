@@ -17,7 +17,7 @@ using std::vector;
 static ostringstream nil;
 
 CodeGen_Metal_Dev::CodeGen_Metal_Dev(Target t) :
-    metal_c(src_stream, t) {
+    target(t), metal_c(src_stream, t) {
 }
 
 string CodeGen_Metal_Dev::CodeGen_Metal_C::print_type_maybe_storage(Type type, bool storage, AppendSpaceIfNeeded space) {
@@ -313,6 +313,7 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Load *op) {
 
 void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Store *op) {
     user_assert(is_one(op->predicate)) << "Predicated store is not supported inside Metal kernel.\n";
+    user_assert(!emit_atomic_stores) << "Atomic store is not supported inside Metal kernel.\n";
     user_assert(op->value.type().lanes() <= 4) << "Vectorization by widths greater than 4 is not supported by Metal -- type is " << op->value.type() << ".\n";
 
     string id_value = print_expr(op->value);
@@ -647,6 +648,29 @@ vector<char> CodeGen_Metal_Dev::compile_to_src() {
     debug(1) << "Metal kernel:\n" << str << "\n";
     vector<char> buffer(str.begin(), str.end());
     buffer.push_back(0);
+
+    if (target.has_feature(Target::MetalLib)) {
+        // Compile the source the way newLibraryWithSource would
+        // (without fast math), so the runtime can load it with
+        // newLibraryWithData instead.
+        TemporaryFile src("halide_kernels", ".metal");
+        TemporaryFile air("halide_kernels", ".air");
+        TemporaryFile lib("halide_kernels", ".metallib");
+        write_entire_file(src.pathname(), str.data(), str.size());
+
+        const string xcrun = string("xcrun -sdk ") + (target.os == Target::IOS ? "iphoneos" : "macosx");
+        string cmd = xcrun + " metal -c -fno-fast-math " + src.pathname() + " -o " + air.pathname();
+        user_assert(system(cmd.c_str()) == 0)
+            << "The metallib target feature requires the Metal compiler, but running it failed. "
+            << "Is Xcode installed?\n";
+        cmd = xcrun + " metallib " + air.pathname() + " -o " + lib.pathname();
+        user_assert(system(cmd.c_str()) == 0)
+            << "The metallib target feature requires the metallib tool, but running it failed. "
+            << "Is Xcode installed?\n";
+
+        buffer = read_entire_file(lib.pathname());
+        debug(1) << "Embedding a " << buffer.size() << " byte metallib\n";
+    }
     return buffer;
 }
 
@@ -82,6 +82,7 @@ protected:
         void visit(const Cast *op) override;
     };
 
+    Target target;
     std::ostringstream src_stream;
     std::string cur_kernel_name;
     CodeGen_Metal_C metal_c;
@@ -5,6 +5,8 @@
 #include "CodeGen_OpenCL_Dev.h"
 #include "Debug.h"
 #include "EliminateBoolVectors.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 
@@ -17,7 +19,7 @@ using std::string;
 using std::vector;
 
 CodeGen_OpenCL_Dev::CodeGen_OpenCL_Dev(Target t) :
-    clc(src_stream, t) {
+    target(t), clc(src_stream, t) {
 }
 
 string CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_type(Type type, AppendSpaceIfNeeded space) {
@@ -292,6 +294,11 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Load *op) {
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Store *op) {
     user_assert(is_one(op->predicate)) << "Predicated store is not supported inside OpenCL kernel.\n";
 
+    if (emit_atomic_stores) {
+        print_atomic_store(op);
+        return;
+    }
+
     string id_value = print_expr(op->value);
     Type t = op->value.type();
 
@@ -349,7 +356,72 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Store *op) {
     cache.clear();
 }
 
-namespace {
+void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_atomic_store(const Store *op) {
+    Type t = op->value.type();
+    user_assert(t.is_scalar() && t.bits() == 32)
+        << "Can't store to " << op->name << " atomically, since OpenCL only"
+        << " has atomic operations on 32-bit scalars\n";
+
+    string old_name = unique_name('t');
+    Expr old_var = Variable::make(t, old_name);
+    Expr value = replace_self_loads(op, old_var);
+    string id_index = print_expr(op->index);
+    string address = "&((volatile " + get_memory_space(op->name) + " " + print_type(t) + " *)" +
+                     print_name(op->name) + ")[" + id_index + "]";
+
+    // Integer sums, mins, and maxes of a term that doesn't depend on
+    // the old value have atomic functions of their own.
+    Expr a, b;
+    const char *fn = nullptr;
+    if (const Add *add = value.as<Add>()) {
+        a = add->a, b = add->b, fn = "atomic_add";
+    } else if (const Min *min = value.as<Min>()) {
+        a = min->a, b = min->b, fn = "atomic_min";
+    } else if (const Max *max = value.as<Max>()) {
+        a = max->a, b = max->b, fn = "atomic_max";
+    }
+    if (fn && !t.is_float()) {
+        if (equal(b, old_var)) {
+            std::swap(a, b);
+        }
+        if (equal(a, old_var) && !expr_uses_var(b, old_name)) {
+            string id_term = print_expr(b);
+            do_indent();
+            stream << fn << "(" << address << ", " << id_term << ");\n";
+            cache.clear();
+            return;
+        }
+    }
+
+    // Otherwise compute the new value from the old one, and swap it in
+    // with atomic_cmpxchg until no other thread has changed it in the
+    // meantime. Values are swapped as uints.
+    string ptr = print_name(unique_name('t'));
+    string old_bits = print_name(unique_name('t'));
+    string expected = print_name(unique_name('t'));
+    open_scope();
+    do_indent();
+    stream << "volatile " << get_memory_space(op->name) << " uint *" << ptr
+           << " = (volatile " << get_memory_space(op->name) << " uint *)" << address << ";\n";
+    do_indent();
+    stream << "uint " << old_bits << " = *" << ptr << ", " << expected << ";\n";
+    do_indent();
+    stream << "do {\n";
+    indent++;
+    do_indent();
+    stream << expected << " = " << old_bits << ";\n";
+    do_indent();
+    stream << print_type(t) << " " << print_name(old_name)
+           << " = as_" << print_type(t) << "(" << expected << ");\n";
+    string id_value = print_expr(value);
+    do_indent();
+    stream << old_bits << " = atomic_cmpxchg(" << ptr << ", " << expected
+           << ", as_uint(" << id_value << "));\n";
+    cache.clear();
+    indent--;
+    do_indent();
+    stream << "} while (" << old_bits << " != " << expected << ");\n";
+    close_scope("");
 }
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const EQ *op) {
@@ -762,6 +834,29 @@ vector<char> CodeGen_OpenCL_Dev::compile_to_src() {
     debug(1) << "OpenCL kernel:\n" << str << "\n";
     vector<char> buffer(str.begin(), str.end());
     buffer.push_back(0);
+
+    if (target.has_feature(Target::OpenCLSPIRV)) {
+        // The source sizes its constant buffers with macros the
+        // runtime defines from the device limits. Ahead of time, use
+        // the minimums the spec guarantees.
+        TemporaryFile src("halide_kernels", ".cl");
+        TemporaryFile bc("halide_kernels", ".bc");
+        TemporaryFile spv("halide_kernels", ".spv");
+        write_entire_file(src.pathname(), str.data(), str.size());
+
+        string cmd = "clang -c -x cl -cl-std=CL1.2 -target spir64 -O2 -emit-llvm "
+                     "-Xclang -finclude-default-header "
+                     "-D MAX_CONSTANT_BUFFER_SIZE=65536 -D MAX_CONSTANT_ARGS=8 " +
+                     src.pathname() + " -o " + bc.pathname();
+        user_assert(system(cmd.c_str()) == 0)
+            << "The opencl_spirv target feature requires clang, but compiling the kernels failed.\n";
+        cmd = "llvm-spirv " + bc.pathname() + " -o " + spv.pathname();
+        user_assert(system(cmd.c_str()) == 0)
+            << "The opencl_spirv target feature requires llvm-spirv, but running it failed.\n";
+
+        buffer = read_entire_file(spv.pathname());
+        debug(1) << "Embedding " << buffer.size() << " bytes of SPIR-V\n";
+    }
     return buffer;
 }
 
@@ -58,6 +58,10 @@ protected:
 
         std::string get_memory_space(const std::string &);
 
+        /** Generate a store inside an Atomic node using OpenCL's
+         * atomic functions. */
+        void print_atomic_store(const Store *op);
+
         void visit(const For *) override;
         void visit(const Ramp *op) override;
         void visit(const Broadcast *op) override;
@@ -80,6 +84,7 @@ protected:
         void visit(const Max *op) override;
     };
 
+    Target target;
     std::ostringstream src_stream;
     std::string cur_kernel_name;
     CodeGen_OpenCL_C clc;
@@ -603,6 +603,7 @@ void CodeGen_GLSL::visit(const Load *op) {
 
 void CodeGen_GLSL::visit(const Store *op) {
     user_assert(is_one(op->predicate)) << "GLSL: predicated store is not supported.\n";
+    user_assert(!emit_atomic_stores) << "GLSL: atomic store is not supported.\n";
     if (scalar_vars.contains(op->name)) {
         internal_assert(is_zero(op->index));
         string val = print_expr(op->value);
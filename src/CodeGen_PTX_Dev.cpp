@@ -14,6 +14,8 @@
 #include "Target.h"
 
 #include <fstream>
+#include <sstream>
+#include <string.h>
 
 // This is declared in NVPTX.h, which is not exported. Ugly, but seems better than
 // hardcoding a path to the .h file.
@@ -29,6 +31,86 @@ using std::vector;
 
 using namespace llvm;
 
+namespace {
+
+// Find the constant block size of a kernel, if it has one, its
+// constant shared memory use, and any launch bounds from its
+// schedule.
+class FindKernelLaunchInfo : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        const char *names[] = {".__thread_id_x", ".__thread_id_y", ".__thread_id_z"};
+        for (int i = 0; i < 3; i++) {
+            if (ends_with(op->name, names[i])) {
+                const int64_t *extent = as_const_int(op->extent);
+                threads[i] = extent ? (int)(*extent) : 0;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        if (op->name == "__shared") {
+            const int64_t *size = as_const_int(op->extents[0]);
+            shared_bytes = size ? (int)(*size) : 0;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::gpu_launch_bounds)) {
+            max_threads = (int)(*as_const_int(op->args[0]));
+            min_blocks_per_sm = (int)(*as_const_int(op->args[1]));
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int threads[3] = {1, 1, 1};
+    int shared_bytes = 0;
+    int max_threads = 0, min_blocks_per_sm = 0;
+};
+
+// The number of blocks of a kernel that can be resident on one
+// multiprocessor at once, given the resources it uses, and which of
+// them is the limit. This follows the CUDA occupancy calculator, less
+// the finer details of register allocation granularity.
+int blocks_per_sm(int capability, int threads, int registers, int shared_bytes, string *limit) {
+    const int max_threads = 2048;
+    const int max_blocks = capability >= 50 ? 32 : 16;
+    const int max_registers = 65536;
+    const int max_shared = (capability >= 61 ? 96 :
+                            capability >= 50 ? 64 : 48) * 1024;
+
+    const int warps = (threads + 31) / 32;
+    int blocks = max_blocks;
+    *limit = "blocks";
+    if (max_threads / (warps * 32) < blocks) {
+        blocks = max_threads / (warps * 32);
+        *limit = "threads";
+    }
+    if (registers > 0) {
+        // Registers are allocated per warp, in units of 256.
+        const int registers_per_warp = (registers * 32 + 255) / 256 * 256;
+        const int by_registers = max_registers / (registers_per_warp * warps);
+        if (by_registers < blocks) {
+            blocks = by_registers;
+            *limit = "registers";
+        }
+    }
+    if (shared_bytes > 0) {
+        const int by_shared = max_shared / ((shared_bytes + 255) / 256 * 256);
+        if (by_shared < blocks) {
+            blocks = by_shared;
+            *limit = "shared memory";
+        }
+    }
+    return blocks;
+}
+
+}  // namespace
+
 CodeGen_PTX_Dev::CodeGen_PTX_Dev(Target host) : CodeGen_LLVM(host) {
     #if !(WITH_PTX)
     user_error << "ptx not enabled for this build of Halide.\n";
@@ -70,10 +152,15 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
     function = llvm::Function::Create(func_t, llvm::Function::ExternalLinkage, name, module.get());
     set_function_attributes_for_target(function, target);
 
-    // Mark the buffer args as no alias
+    // Mark the buffer args as no alias, and the ones the kernel
+    // doesn't write to as read only. Loads through pointers that are
+    // both use the non-coherent read-only cache (ld.global.nc).
     for (size_t i = 0; i < args.size(); i++) {
         if (args[i].is_buffer) {
             function->addParamAttr(i, Attribute::NoAlias);
+            if (!args[i].write) {
+                function->addParamAttr(i, Attribute::ReadOnly);
+            }
         }
     }
 
@@ -132,6 +219,39 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
 
     module->getOrInsertNamedMetadata("nvvm.annotations")->addOperand(md_node);
 
+    // Tell ptxas the most threads the kernel will be launched with,
+    // so that it never uses too many registers to launch, and the
+    // fewest blocks per multiprocessor the schedule asked for. Both
+    // limit the registers per thread.
+    FindKernelLaunchInfo info;
+    stmt.accept(&info);
+    auto annotate = [&](const char *key, int value) {
+        llvm::Metadata *md_args[] = {
+            llvm::ValueAsMetadata::get(function),
+            MDString::get(*context, key),
+            llvm::ValueAsMetadata::get(ConstantInt::get(i32_t, value))
+        };
+        module->getOrInsertNamedMetadata("nvvm.annotations")->addOperand(MDNode::get(*context, md_args));
+    };
+    const bool constant_block_size = info.threads[0] && info.threads[1] && info.threads[2];
+    const int block_size = info.threads[0] * info.threads[1] * info.threads[2];
+    if (info.max_threads) {
+        user_assert(!constant_block_size || block_size <= info.max_threads)
+            << "Kernel " << name << " has " << block_size
+            << " threads per block, which is more than the " << info.max_threads
+            << " given to gpu_launch_bounds()\n";
+        annotate("maxntidx", info.max_threads);
+    } else if (constant_block_size) {
+        annotate("maxntidx", info.threads[0]);
+        annotate("maxntidy", info.threads[1]);
+        annotate("maxntidz", info.threads[2]);
+    }
+    if (info.min_blocks_per_sm) {
+        annotate("minctasm", info.min_blocks_per_sm);
+    }
+    kernel_launch_info[name] = {constant_block_size ? block_size : info.max_threads,
+                                info.shared_bytes};
+
 
     // Now verify the function is ok
     verifyFunction(*function);
@@ -161,11 +281,134 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
         internal_assert(barrier0) << "Could not find PTX barrier intrinsic (llvm.nvvm.barrier0)\n";
         builder->CreateCall(barrier0);
         value = ConstantInt::get(i32_t, 0);
+    } else if (op->is_intrinsic(Call::gpu_launch_bounds)) {
+        // Already turned into annotations on the kernel by add_kernel.
+        value = ConstantInt::get(i32_t, 0);
+    } else if (starts_with(op->name, "halide_ptx_wmma_m16n16k16_")) {
+        value = codegen_wmma_mat_mul(op);
+    } else if (op->name == "halide_ptx_tex_2d") {
+        // Injected by lower_gpu_textures. The args are a texture object
+        // and normalized coordinates. The texture has one channel,
+        // which is the first element of the texel fetched.
+        internal_assert(op->args.size() == 3);
+        if (op->type.is_vector()) {
+            scalarize(op);
+            return;
+        }
+        llvm::Type *texel_t = StructType::get(*context, {f32_t, f32_t, f32_t, f32_t});
+        FunctionType *fn_type = FunctionType::get(texel_t, {i64_t, f32_t, f32_t}, false);
+        llvm::Function *fn =
+            dyn_cast_or_null<llvm::Function>(module->getOrInsertFunction("llvm.nvvm.tex.unified.2d.v4f32.f32", fn_type));
+        internal_assert(fn) << "Could not find PTX texture intrinsic (llvm.nvvm.tex.unified.2d.v4f32.f32)\n";
+        Value *texel = builder->CreateCall(fn, {codegen(op->args[0]), codegen(op->args[1]), codegen(op->args[2])});
+        value = builder->CreateExtractValue(texel, {0});
     } else {
         CodeGen_LLVM::visit(op);
     }
 }
 
+Value *CodeGen_PTX_Dev::codegen_wmma_mat_mul(const Call *op) {
+    // Injected by lower_tensor_core_mat_mul. The args are the first
+    // elements of the C, A, and B tiles, each followed by its leading
+    // dimension in elements. The name ends with the layouts of A and
+    // B. Returns whether the tiles were aligned well enough to use
+    // wmma; if not, nothing is done and the caller runs the scalar
+    // loop nest instead.
+    internal_assert(op->args.size() == 6);
+#if LLVM_VERSION < 70
+    // The wmma intrinsics were renamed in llvm 7, so only target
+    // those.
+    return ConstantInt::get(i1_t, 0);
+#else
+    const string prefix = "halide_ptx_wmma_m16n16k16_";
+    const string a_layout = op->name.substr(prefix.size(), 3);
+    const string b_layout = op->name.substr(prefix.size() + 4, 3);
+
+    // wmma needs each tile to be 32-byte aligned, and rows of the
+    // tile to be a multiple of 16 bytes apart.
+    llvm::Type *ptr_t = i8_t->getPointerTo();
+    Value *ptrs[3], *strides[3];
+    Value *aligned = ConstantInt::get(i1_t, 1);
+    for (int i = 0; i < 3; i++) {
+        const Load *tile = op->args[2 * i].as<Load>();
+        internal_assert(tile) << "Bad tensor core operand: " << op->args[2 * i] << "\n";
+        Value *ptr = codegen_buffer_pointer(tile->name, tile->type, tile->index);
+        ptrs[i] = builder->CreatePointerBitCastOrAddrSpaceCast(ptr, ptr_t);
+        strides[i] = codegen(op->args[2 * i + 1]);
+        Value *addr = builder->CreatePtrToInt(ptrs[i], i64_t);
+        aligned = builder->CreateAnd(aligned,
+                                     builder->CreateICmpEQ(builder->CreateAnd(addr, 31),
+                                                           ConstantInt::get(i64_t, 0)));
+        int stride_elems = 16 / tile->type.bytes();
+        aligned = builder->CreateAnd(aligned,
+                                     builder->CreateICmpEQ(builder->CreateAnd(strides[i], stride_elems - 1),
+                                                           ConstantInt::get(i32_t, 0)));
+    }
+
+    BasicBlock *before_bb = builder->GetInsertBlock();
+    BasicBlock *wmma_bb = BasicBlock::Create(*context, "wmma", function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, "after_wmma", function);
+    builder->CreateCondBr(aligned, wmma_bb, after_bb);
+    builder->SetInsertPoint(wmma_bb);
+
+    // A and B fragments are eight pairs of halfs. C fragments are
+    // eight floats, or four pairs of halfs.
+    Halide::Type acc_type = op->args[0].type();
+    const string acc = acc_type == Float(16) ? "f16" : "f32";
+    llvm::Type *half2_t = VectorType::get(f16_t, 2);
+    vector<llvm::Type *> ab_regs(8, half2_t);
+    vector<llvm::Type *> acc_regs(acc_type == Float(16) ? 4 : 8,
+                                  acc_type == Float(16) ? half2_t : f32_t);
+    llvm::Type *ab_t = StructType::get(*context, ab_regs);
+    llvm::Type *acc_t = StructType::get(*context, acc_regs);
+
+    auto get_intrin = [&](const string &name, llvm::Type *ret_t, const vector<llvm::Type *> &arg_t) {
+        FunctionType *fn_type = FunctionType::get(ret_t, arg_t, false);
+        llvm::Function *fn = dyn_cast_or_null<llvm::Function>(module->getOrInsertFunction(name, fn_type));
+        internal_assert(fn) << "Could not find PTX wmma intrinsic " << name << "\n";
+        return fn;
+    };
+
+    auto load_fragment = [&](int i, const string &matrix, const string &layout,
+                             const string &type, llvm::Type *frag_t, vector<Value *> &regs) {
+        string name = "llvm.nvvm.wmma.m16n16k16.load." + matrix + "." + layout + ".stride." + type + ".p0i8";
+        Value *frag = builder->CreateCall(get_intrin(name, frag_t, {ptr_t, i32_t}), {ptrs[i], strides[i]});
+        for (unsigned j = 0; j < frag_t->getStructNumElements(); j++) {
+            regs.push_back(builder->CreateExtractValue(frag, {j}));
+        }
+    };
+
+    vector<Value *> args;
+    load_fragment(1, "a", a_layout, "f16", ab_t, args);
+    load_fragment(2, "b", b_layout, "f16", ab_t, args);
+    load_fragment(0, "c", "row", acc, acc_t, args);
+
+    vector<llvm::Type *> mma_arg_t(ab_regs);
+    mma_arg_t.insert(mma_arg_t.end(), ab_regs.begin(), ab_regs.end());
+    mma_arg_t.insert(mma_arg_t.end(), acc_regs.begin(), acc_regs.end());
+    string mma_name = "llvm.nvvm.wmma.m16n16k16.mma." + a_layout + "." + b_layout + "." + acc + "." + acc;
+    Value *d = builder->CreateCall(get_intrin(mma_name, acc_t, mma_arg_t), args);
+
+    vector<Value *> store_args = {ptrs[0]};
+    vector<llvm::Type *> store_arg_t = {ptr_t};
+    for (unsigned j = 0; j < acc_regs.size(); j++) {
+        store_args.push_back(builder->CreateExtractValue(d, {j}));
+        store_arg_t.push_back(acc_regs[j]);
+    }
+    store_args.push_back(strides[0]);
+    store_arg_t.push_back(i32_t);
+    string store_name = "llvm.nvvm.wmma.m16n16k16.store.d.row.stride." + acc + ".p0i8";
+    builder->CreateCall(get_intrin(store_name, void_t, store_arg_t), store_args);
+    builder->CreateBr(after_bb);
+
+    builder->SetInsertPoint(after_bb);
+    PHINode *phi = builder->CreatePHI(i1_t, 2);
+    phi->addIncoming(ConstantInt::get(i1_t, 1), wmma_bb);
+    phi->addIncoming(ConstantInt::get(i1_t, 0), before_bb);
+    return phi;
+#endif
+}
+
 string CodeGen_PTX_Dev::simt_intrinsic(const string &name) {
     if (ends_with(name, ".__thread_id_x")) {
         return "llvm.nvvm.read.ptx.sreg.tid.x";
@@ -243,21 +486,50 @@ void CodeGen_PTX_Dev::visit(const AssertStmt *op) {
     codegen(IfThenElse::make(!op->condition, Evaluate::make(trap)));
 }
 
+namespace {
+// The number of bits in the widest load or store the PTX backend can
+// do in a single instruction.
+const int max_access_bits = 128;
+}
+
+int CodeGen_PTX_Dev::wide_access_lanes(const Halide::Type &t, const Expr &index, const Expr &predicate) {
+    const Ramp *r = index.as<Ramp>();
+    if (!is_one(predicate) || !r || !is_one(r->stride) || t.bits() < 8 || t.is_handle()) {
+        return 0;
+    }
+    // Try 128-bit accesses and then 64-bit ones. The access must be
+    // aligned to its own size, which we can only know for dense
+    // vectors whose base has a known alignment.
+    ModulusRemainder align = modulus_remainder(r->base, alignment_info);
+    for (int bits = max_access_bits; bits >= 64; bits /= 2) {
+        int lanes = bits / t.bits();
+        if (lanes > 1 && r->lanes % lanes == 0 &&
+            align.modulus % lanes == 0 && align.remainder % lanes == 0) {
+            return lanes;
+        }
+    }
+    return 0;
+}
+
 void CodeGen_PTX_Dev::visit(const Load *op) {
 
-    // Do aligned 4-wide 32-bit loads as a single i128 load.
-    const Ramp *r = op->index.as<Ramp>();
-    // TODO: lanes >= 4, not lanes == 4
-    if (is_one(op->predicate) && r && is_one(r->stride) && r->lanes == 4 && op->type.bits() == 32) {
-        ModulusRemainder align = modulus_remainder(r->base, alignment_info);
-        if (align.modulus % 4 == 0 && align.remainder % 4 == 0) {
-            Expr index = simplify(r->base / 4);
-            Expr equiv = Load::make(UInt(128), op->name, index,
+    // Do aligned 64- and 128-bit dense vector loads as single wide
+    // integer loads, so that they become one ld.v2/ld.v4 no matter
+    // what the element type is. Wider vectors are concatenated from
+    // several such loads.
+    int lanes = wide_access_lanes(op->type, op->index, op->predicate);
+    if (lanes) {
+        const Ramp *r = op->index.as<Ramp>();
+        int bits = lanes * op->type.bits();
+        vector<Expr> pieces;
+        for (int i = 0; i < r->lanes; i += lanes) {
+            Expr index = simplify((r->base + i) / lanes);
+            Expr piece = Load::make(UInt(bits), op->name, index,
                                     op->image, op->param, const_true());
-            equiv = reinterpret(op->type, equiv);
-            codegen(equiv);
-            return;
+            pieces.push_back(reinterpret(op->type.with_lanes(lanes), piece));
         }
+        codegen(pieces.size() == 1 ? pieces[0] : Shuffle::make_concat(pieces));
+        return;
     }
 
     CodeGen_LLVM::visit(op);
@@ -265,18 +537,29 @@ void CodeGen_PTX_Dev::visit(const Load *op) {
 
 void CodeGen_PTX_Dev::visit(const Store *op) {
 
-    // Do aligned 4-wide 32-bit stores as a single i128 store.
-    const Ramp *r = op->index.as<Ramp>();
-    // TODO: lanes >= 4, not lanes == 4
-    if (is_one(op->predicate) && r && is_one(r->stride) && r->lanes == 4 && op->value.type().bits() == 32) {
-        ModulusRemainder align = modulus_remainder(r->base, alignment_info);
-        if (align.modulus % 4 == 0 && align.remainder % 4 == 0) {
-            Expr index = simplify(r->base / 4);
-            Expr value = reinterpret(UInt(128), op->value);
-            Stmt equiv = Store::make(op->name, value, index, op->param, const_true());
-            codegen(equiv);
+    // Do aligned 64- and 128-bit dense vector stores as single wide
+    // integer stores.
+    int lanes = wide_access_lanes(op->value.type(), op->index, op->predicate);
+    if (lanes) {
+        const Ramp *r = op->index.as<Ramp>();
+        int bits = lanes * op->value.type().bits();
+        if (r->lanes == lanes) {
+            Expr index = simplify(r->base / lanes);
+            Expr value = reinterpret(UInt(bits), op->value);
+            codegen(Store::make(op->name, value, index, op->param, const_true()));
             return;
         }
+        // Split wider vectors into pieces, computing the value only once.
+        string value_name = unique_name('t');
+        Expr value_var = Variable::make(op->value.type(), value_name);
+        vector<Stmt> pieces;
+        for (int i = 0; i < r->lanes; i += lanes) {
+            Expr index = simplify((r->base + i) / lanes);
+            Expr value = reinterpret(UInt(bits), Shuffle::make_slice(value_var, i, 1, lanes));
+            pieces.push_back(Store::make(op->name, value, index, op->param, const_true()));
+        }
+        codegen(LetStmt::make(value_name, op->value, Block::make(pieces)));
+        return;
     }
 
     CodeGen_LLVM::visit(op);
@@ -287,7 +570,9 @@ string CodeGen_PTX_Dev::march() const {
 }
 
 string CodeGen_PTX_Dev::mcpu() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        return "sm_70";
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "sm_61";
     } else if (target.has_feature(Target::CUDACapability50)) {
         return "sm_50";
@@ -303,7 +588,10 @@ string CodeGen_PTX_Dev::mcpu() const {
 }
 
 string CodeGen_PTX_Dev::mattrs() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        // Need ptx isa 6.0 for sm_70 and wmma.
+        return "+ptx60";
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "+ptx50";
     } else if (target.features_any_of({Target::CUDACapability32,
                                 Target::CUDACapability50})) {
@@ -464,20 +752,15 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
             (void)ret; // Don't care if it fails
         }
 
-        // Note: It works to embed the contents of the .sass file in
-        // the buffer instead of the ptx source, and this could help
-        // with app startup times. Expose via the target?
-        /*
-        {
-            std::ifstream f(sass.pathname());
-            buffer.clear();
-            f.seekg(0, std::ios_base::end);
-            std::streampos sz = f.tellg();
-            buffer.resize(sz);
-            f.seekg(0, std::ios_base::beg);
-            f.read(buffer.data(), sz);
-        }
-        */
+    }
+
+    if (get_env_variable("HL_PTXAS_INFO") == "1") {
+        report_kernel_resources(buffer);
+    }
+
+    if (target.has_feature(Target::CUDAFatbin)) {
+        // cuModuleLoadData accepts a fatbin in place of ptx source.
+        buffer = compile_to_fatbin(buffer);
     }
 
     // Null-terminate the ptx source
@@ -488,6 +771,113 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
 #endif
 }
 
+vector<char> CodeGen_PTX_Dev::compile_to_fatbin(const vector<char> &ptx_src) {
+    TemporaryFile ptx("halide_kernels", ".ptx");
+    TemporaryFile cubin("halide_kernels", ".cubin");
+    TemporaryFile fatbin("halide_kernels", ".fatbin");
+    write_entire_file(ptx.pathname(), ptx_src);
+
+    // The kernels were generated for a single cuda capability, so
+    // there's one SASS image. The PTX lets the driver JIT compile for
+    // newer devices.
+    const string arch = mcpu().substr(strlen("sm_"));
+    string cmd = "ptxas --gpu-name sm_" + arch + " " + ptx.pathname() + " -o " + cubin.pathname();
+    user_assert(system(cmd.c_str()) == 0)
+        << "The cuda_fatbin target feature requires ptxas, but running it failed. "
+        << "Is the CUDA SDK in the path?\n";
+
+    cmd = "fatbinary --create=" + fatbin.pathname() +
+        (target.bits == 64 ? " -64" : " -32") +
+        " --image=profile=sm_" + arch + ",file=" + cubin.pathname() +
+        " --image=profile=compute_" + arch + ",file=" + ptx.pathname();
+    user_assert(system(cmd.c_str()) == 0)
+        << "The cuda_fatbin target feature requires fatbinary, but running it failed. "
+        << "Is the CUDA SDK in the path?\n";
+
+    vector<char> buffer = read_entire_file(fatbin.pathname());
+
+    debug(1) << "Embedding a " << buffer.size() << " byte fatbin for sm_" << arch << "\n";
+    return buffer;
+}
+
+void CodeGen_PTX_Dev::report_kernel_resources(const vector<char> &ptx_src) {
+    TemporaryFile ptx("halide_kernels", ".ptx");
+    TemporaryFile sass("halide_kernels", ".sass");
+    TemporaryFile info("halide_kernels", ".txt");
+
+    std::ofstream f(ptx.pathname());
+    f.write(ptx_src.data(), ptx_src.size());
+    f.close();
+
+    string cmd = "ptxas -v --gpu-name " + mcpu() + " " + ptx.pathname() +
+        " -o " + sass.pathname() + " 2> " + info.pathname();
+    if (system(cmd.c_str()) != 0) {
+        user_warning << "HL_PTXAS_INFO is set, but running ptxas failed. "
+                     << "Is the CUDA SDK in the path?\n";
+        return;
+    }
+
+    // ptxas -v reports each kernel as:
+    // ptxas info    : Compiling entry function 'kernel_f_s0_y___block_id_y' for 'sm_61'
+    // ptxas info    : Function properties for kernel_f_s0_y___block_id_y
+    //     0 bytes stack frame, 0 bytes spill stores, 0 bytes spill loads
+    // ptxas info    : Used 32 registers, 340 bytes cmem[0], 1024 bytes smem
+    struct Resources {
+        int registers = 0, spill_stores = 0, spill_loads = 0, static_shared = 0;
+    };
+    vector<std::pair<string, Resources>> kernels;
+    std::ifstream in(info.pathname());
+    string line;
+    while (std::getline(in, line)) {
+        size_t pos;
+        if ((pos = line.find("Compiling entry function '")) != string::npos) {
+            pos += strlen("Compiling entry function '");
+            kernels.push_back({line.substr(pos, line.find('\'', pos) - pos), Resources()});
+        } else if (kernels.empty()) {
+            continue;
+        } else if ((pos = line.find("bytes spill stores")) != string::npos) {
+            Resources &r = kernels.back().second;
+            int stack = 0;
+            sscanf(line.c_str(), " %d bytes stack frame, %d bytes spill stores, %d bytes spill loads",
+                   &stack, &r.spill_stores, &r.spill_loads);
+        } else if ((pos = line.find("Used ")) != string::npos) {
+            Resources &r = kernels.back().second;
+            sscanf(line.c_str() + pos, "Used %d registers", &r.registers);
+            if ((pos = line.find(" bytes smem")) != string::npos) {
+                size_t start = line.rfind(' ', pos - 1);
+                r.static_shared = atoi(line.c_str() + start + 1);
+            }
+        }
+    }
+
+    const int capability = atoi(mcpu().c_str() + strlen("sm_"));
+    for (const auto &k : kernels) {
+        const Resources &r = k.second;
+        std::ostringstream report;
+        report << k.first << ": " << r.registers << " registers, "
+               << r.spill_stores << " bytes spill stores, "
+               << r.spill_loads << " bytes spill loads";
+        auto it = kernel_launch_info.find(k.first);
+        int threads = 0, shared = r.static_shared;
+        if (it != kernel_launch_info.end()) {
+            threads = it->second.threads;
+            shared += it->second.shared_bytes;
+        }
+        report << ", " << shared << " bytes shared";
+        if (threads > 0) {
+            string limit;
+            int blocks = blocks_per_sm(capability, threads, r.registers, shared, &limit);
+            int warps = blocks * ((threads + 31) / 32);
+            report << ", " << threads << " threads per block: "
+                   << blocks << " blocks per multiprocessor, "
+                   << (100 * warps) / 64 << "% occupancy, limited by " << limit;
+        } else {
+            report << ", block size not known at compile time";
+        }
+        debug(0) << report.str() << "\n";
+    }
+}
+
 int CodeGen_PTX_Dev::native_vector_bits() const {
     // PTX doesn't really do vectorization. The widest type is a double.
     return 64;
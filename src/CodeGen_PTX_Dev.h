@@ -71,9 +71,34 @@ protected:
     int native_vector_bits()  const override;
     bool promote_indices()  const override {return false;}
 
+    /** The number of lanes of each 64- or 128-bit access that a dense
+     * vector load or store of type t at the given index can be split
+     * into, or zero if it isn't aligned well enough for any. */
+    int wide_access_lanes(const Type &t, const Expr &index, const Expr &predicate);
+
+    /** Emit the wmma loads, multiply-accumulate, and store for a call
+     * injected by lower_tensor_core_mat_mul. */
+    llvm::Value *codegen_wmma_mat_mul(const Call *op);
+
     /** Map from simt variable names (e.g. foo.__block_id_x) to the llvm
      * ptx intrinsic functions to call to get them. */
     std::string simt_intrinsic(const std::string &name);
+
+    /** The block size and shared memory of each kernel in the
+     * module, where they are constants, for reporting occupancy. */
+    struct KernelLaunchInfo {
+        int threads, shared_bytes;
+    };
+    std::map<std::string, KernelLaunchInfo> kernel_launch_info;
+
+    /** Run ptxas over the module and report the registers, spills,
+     * and shared memory of each kernel, and the occupancy they allow. */
+    void report_kernel_resources(const std::vector<char> &ptx);
+
+    /** Assemble the module with ptxas, and bundle the SASS and the
+     * PTX into a fatbin, which the driver can load without JIT
+     * compiling on devices of the target's cuda capability. */
+    std::vector<char> compile_to_fatbin(const std::vector<char> &ptx);
 };
 
 }  // namespace Internal
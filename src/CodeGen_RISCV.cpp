@@ -0,0 +1,40 @@
+#include "CodeGen_RISCV.h"
+#include "LLVM_Headers.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+using namespace llvm;
+
+CodeGen_RISCV::CodeGen_RISCV(Target t) : CodeGen_Posix(t) {
+    #if !(WITH_RISCV)
+    user_error << "llvm build not configured with RISCV target enabled.\n";
+    #endif
+    user_assert(llvm_RISCV_enabled) << "llvm build not configured with RISCV target enabled.\n";
+}
+
+string CodeGen_RISCV::mcpu() const {
+    return "";
+}
+
+string CodeGen_RISCV::mattrs() const {
+    // RV32GC/RV64GC, which is what the Linux ABIs assume. The
+    // vector extension isn't supported by the versions of LLVM we
+    // build against, so vectors are scalarized.
+    return "+m,+a,+f,+d,+c";
+}
+
+bool CodeGen_RISCV::use_soft_float_abi() const {
+    return false;
+}
+
+int CodeGen_RISCV::native_vector_bits() const {
+    return 128;
+}
+
+}  // namespace Internal
+}  // namespace Halide
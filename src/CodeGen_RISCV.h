@@ -0,0 +1,31 @@
+#ifndef HALIDE_CODEGEN_RISCV_H
+#define HALIDE_CODEGEN_RISCV_H
+
+/** \file
+ * Defines the code-generator for producing RISC-V machine code.
+ */
+
+#include "CodeGen_Posix.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A code generator that emits RISC-V code from a given Halide stmt. */
+class CodeGen_RISCV : public CodeGen_Posix {
+public:
+    /** Create a RISC-V code generator. */
+    CodeGen_RISCV(Target);
+
+protected:
+    using CodeGen_Posix::visit;
+
+    std::string mcpu() const override;
+    std::string mattrs() const override;
+    bool use_soft_float_abi() const override;
+    int native_vector_bits() const override;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,843 @@
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "CodeGen_Internal.h"
+#include "CodeGen_Vulkan_Dev.h"
+#include "Debug.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Lerp.h"
+#include "Simplify.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The scalar kernel arguments are passed as push constants. Each one
+// takes a slot of at least four bytes, aligned to the slot size. The
+// runtime lays out the push constant block the same way.
+const int max_push_constant_bytes = 128;
+
+int push_constant_slot_bytes(const Type &t) {
+    return std::max(4, t.bytes());
+}
+
+const char *lane_suffix(int i) {
+    internal_assert(i >= 0 && i < 4);
+    static const char *suffixes[] = {".x", ".y", ".z", ".w"};
+    return suffixes[i];
+}
+
+string simt_intrinsic(const string &name) {
+    if (ends_with(name, ".__thread_id_x")) {
+        return "gl_LocalInvocationID.x";
+    } else if (ends_with(name, ".__thread_id_y")) {
+        return "gl_LocalInvocationID.y";
+    } else if (ends_with(name, ".__thread_id_z")) {
+        return "gl_LocalInvocationID.z";
+    } else if (ends_with(name, ".__block_id_x")) {
+        return "gl_WorkGroupID.x";
+    } else if (ends_with(name, ".__block_id_y")) {
+        return "gl_WorkGroupID.y";
+    } else if (ends_with(name, ".__block_id_z")) {
+        return "gl_WorkGroupID.z";
+    }
+    user_error << "Vulkan: 4-dimensional GPU loops are not supported: " << name << "\n";
+    return "";
+}
+
+class FindSharedAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        op->body.accept(this);
+        if (starts_with(op->name, "__shared_")) {
+            allocs.push_back(op);
+        }
+    }
+
+public:
+    vector<const Allocate *> allocs;
+};
+
+// A call to a GLSL builtin with the given return type.
+Expr glsl_call(Type t, const string &name, const vector<Expr> &args) {
+    return Call::make(t, name, args, Call::Extern);
+}
+
+// Apply findMSB, findLSB or bitCount to a 32 or 64-bit unsigned
+// value. GLSL only defines them for 32-bit values, so 64-bit values
+// are handled in halves.
+Expr bit_query(const char *op, Expr x) {
+    Type t = x.type();
+    internal_assert(t.is_uint());
+    Type i32 = Int(32, t.lanes());
+    Type u32 = UInt(32, t.lanes());
+    if (t.bits() == 64) {
+        Expr lo = cast(u32, x);
+        Expr hi = cast(u32, x >> 32);
+        Expr zero = make_zero(u32);
+        if (op == Call::count_leading_zeros) {
+            return select(hi != zero, bit_query(op, hi), 32 + bit_query(op, lo));
+        } else if (op == Call::count_trailing_zeros) {
+            return select(lo != zero, bit_query(op, lo), 32 + bit_query(op, hi));
+        } else {
+            return bit_query(op, lo) + bit_query(op, hi);
+        }
+    }
+    int bits = t.bits();
+    x = cast(u32, x);
+    if (op == Call::count_leading_zeros) {
+        // findMSB returns -1 for zero.
+        return (bits - 1) - glsl_call(i32, "findMSB", {x});
+    } else if (op == Call::count_trailing_zeros) {
+        // findLSB returns -1 for zero.
+        return select(x == make_zero(u32), bits, glsl_call(i32, "findLSB", {x}));
+    } else {
+        return glsl_call(i32, "bitCount", {x});
+    }
+}
+
+}  // namespace
+
+CodeGen_Vulkan_Dev::CodeGen_Vulkan_Dev(Target target)
+    : vk_c(src_stream, target) {
+}
+
+CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::CodeGen_Vulkan_C(std::ostream &s, Target t)
+    : CodeGen_GLSLBase(s, t) {
+    builtin["trunc_f32"] = "trunc";
+    builtin["is_nan_f32"] = "isnan";
+    builtin["fast_inverse_sqrt_f32"] = "inversesqrt";
+    builtin["findMSB"] = "findMSB";
+    builtin["findLSB"] = "findLSB";
+    builtin["bitCount"] = "bitCount";
+
+    // With the explicit arithmetic types extension, the float
+    // builtins are overloaded for float16. Doubles only have the
+    // exact operations.
+    vector<string> f16_names;
+    for (const auto &b : builtin) {
+        if (ends_with(b.first, "_f32")) {
+            f16_names.push_back(b.first.substr(0, b.first.size() - 4));
+        }
+    }
+    for (const string &n : f16_names) {
+        builtin[n + "_f16"] = builtin[n + "_f32"];
+    }
+    for (const char *n : {"sqrt", "abs", "floor", "ceil", "trunc", "round", "is_nan", "fast_inverse_sqrt"}) {
+        builtin[string(n) + "_f64"] = builtin[string(n) + "_f32"];
+    }
+}
+
+string CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::print_type(Type type, AppendSpaceIfNeeded space) {
+    ostringstream oss;
+    user_assert(type.lanes() <= 4)
+        << "Vulkan: vector types wider than 4 aren't supported: " << type << "\n";
+    user_assert(!type.is_handle())
+        << "Vulkan: handles can't be used in kernels.\n";
+
+    if (type.is_scalar()) {
+        if (type.is_bool()) {
+            oss << "bool";
+        } else if (type.is_float()) {
+            switch (type.bits()) {
+            case 16: oss << "float16_t"; break;
+            case 32: oss << "float"; break;
+            case 64: oss << "double"; break;
+            default:
+                user_error << "Vulkan: can't represent a float with " << type.bits() << " bits.\n";
+            }
+        } else {
+            if (type.is_uint()) {
+                oss << 'u';
+            }
+            switch (type.bits()) {
+            case 8: oss << "int8_t"; break;
+            case 16: oss << "int16_t"; break;
+            case 32: oss << "int"; break;
+            case 64: oss << "int64_t"; break;
+            default:
+                user_error << "Vulkan: can't represent an integer with " << type.bits() << " bits.\n";
+            }
+        }
+    } else {
+        if (type.is_bool()) {
+            oss << 'b';
+        } else if (type.is_float()) {
+            switch (type.bits()) {
+            case 16: oss << "f16"; break;
+            case 32: break;
+            case 64: oss << 'd'; break;
+            default:
+                user_error << "Vulkan: can't represent a float with " << type.bits() << " bits.\n";
+            }
+        } else {
+            oss << (type.is_uint() ? 'u' : 'i');
+            if (type.bits() != 32) {
+                oss << type.bits();
+            }
+        }
+        oss << "vec" << type.lanes();
+    }
+
+    if (space == AppendSpace) {
+        oss << " ";
+    }
+    return oss.str();
+}
+
+string CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::print_storage_type(Type type) {
+    if (type.is_bool()) {
+        type = UInt(8, type.lanes());
+    }
+    return print_type(type);
+}
+
+string CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::print_reinterpret(Type type, Expr e) {
+    Type src = e.type();
+    user_assert(type.bits() == src.bits() && type.lanes() == src.lanes() &&
+                !type.is_bool() && !src.is_bool())
+        << "Vulkan: can't reinterpret " << src << " as " << type << "\n";
+
+    string value = print_expr(e);
+    if (type.is_float() == src.is_float()) {
+        // Conversions between signed and unsigned integers keep the bits.
+        return print_type(type) + "(" + value + ")";
+    }
+
+    string fn;
+    if (src.is_float()) {
+        const char *to = type.is_int() ? "Int" : "Uint";
+        switch (src.bits()) {
+        case 16: fn = string("float16BitsTo") + to + "16"; break;
+        case 32: fn = string("floatBitsTo") + to; break;
+        default: fn = string("doubleBitsTo") + to + "64"; break;
+        }
+    } else {
+        const char *from = src.is_int() ? "int" : "uint";
+        switch (src.bits()) {
+        case 16: fn = string(from) + "16BitsToFloat16"; break;
+        case 32: fn = string(from) + "BitsToFloat"; break;
+        default: fn = string(from) + "64BitsToDouble"; break;
+        }
+    }
+    return fn + "(" + value + ")";
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const IntImm *op) {
+    if (op->type == Int(32)) {
+        if (op->value == std::numeric_limits<int32_t>::min()) {
+            id = "(-2147483647 - 1)";
+        } else {
+            id = std::to_string(op->value);
+        }
+    } else if (op->type == Int(64)) {
+        if (op->value == std::numeric_limits<int64_t>::min()) {
+            id = "(-9223372036854775807l - 1l)";
+        } else {
+            id = std::to_string(op->value) + "l";
+        }
+    } else {
+        id = print_type(op->type) + "(" + std::to_string(op->value) + ")";
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const UIntImm *op) {
+    if (op->type.is_bool()) {
+        id = op->value ? "true" : "false";
+    } else if (op->type == UInt(32)) {
+        id = std::to_string(op->value) + "u";
+    } else if (op->type == UInt(64)) {
+        id = std::to_string(op->value) + "ul";
+    } else {
+        id = print_type(op->type) + "(" + std::to_string(op->value) + "u)";
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const FloatImm *op) {
+    if (!std::isfinite(op->value)) {
+        // Infinities and nans have no literal, so build them from
+        // their bits.
+        ostringstream oss;
+        if (op->type.bits() == 64) {
+            double v = op->value;
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            oss << "uint64BitsToDouble(" << bits << "ul)";
+        } else {
+            float v = (float)op->value;
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            oss << "uintBitsToFloat(" << bits << "u)";
+            if (op->type.bits() == 16) {
+                id = "float16_t(" + oss.str() + ")";
+                return;
+            }
+        }
+        id = oss.str();
+    } else if (op->type.bits() == 64) {
+        ostringstream oss;
+        oss << std::setprecision(17) << std::showpoint << op->value << "lf";
+        id = oss.str();
+    } else if (op->type.bits() == 16) {
+        CodeGen_GLSLBase::visit(op);
+        id = "float16_t(" + id + ")";
+    } else {
+        CodeGen_GLSLBase::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Min *op) {
+    // GLSL's min is defined for all the arithmetic types.
+    print_expr(glsl_call(op->type, "min", {op->a, op->b}));
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Max *op) {
+    print_expr(glsl_call(op->type, "max", {op->a, op->b}));
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Div *op) {
+    if (op->type.is_float()) {
+        visit_binop(op->type, op->a, op->b, "/");
+    } else {
+        // Integer division in SPIR-V rounds towards zero, so use the
+        // same lowering as the C backend.
+        CodeGen_C::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Mod *op) {
+    if (op->type.is_float()) {
+        // GLSL's mod is x - y * floor(x / y), which matches Halide.
+        print_expr(glsl_call(op->type, "mod", {op->a, op->b}));
+    } else {
+        CodeGen_C::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Not *op) {
+    if (op->type.is_vector()) {
+        print_assignment(op->type, "not(" + print_expr(op->a) + ")");
+    } else {
+        CodeGen_C::visit(op);
+    }
+}
+
+// The logical operators are only defined for scalar bools, so vectors
+// of bools are combined as vectors of integers.
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const And *op) {
+    if (op->type.is_vector()) {
+        Type u = UInt(32, op->type.lanes());
+        print_expr(Cast::make(op->type, Call::make(u, Call::bitwise_and,
+                                                   {Cast::make(u, op->a), Cast::make(u, op->b)},
+                                                   Call::PureIntrinsic)));
+    } else {
+        CodeGen_C::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Or *op) {
+    if (op->type.is_vector()) {
+        Type u = UInt(32, op->type.lanes());
+        print_expr(Cast::make(op->type, Call::make(u, Call::bitwise_or,
+                                                   {Cast::make(u, op->a), Cast::make(u, op->b)},
+                                                   Call::PureIntrinsic)));
+    } else {
+        CodeGen_C::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Cast *op) {
+    print_assignment(op->type, print_type(op->type) + "(" + print_expr(op->value) + ")");
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Call *op) {
+    if (op->is_intrinsic(Call::gpu_thread_barrier)) {
+        do_indent();
+        stream << "groupMemoryBarrier();\n";
+        do_indent();
+        stream << "barrier();\n";
+        print_assignment(op->type, "0");
+    } else if (op->is_intrinsic(Call::lerp)) {
+        internal_assert(op->args.size() == 3);
+        print_expr(lower_lerp(op->args[0], op->args[1], op->args[2]));
+    } else if (op->is_intrinsic(Call::absd)) {
+        internal_assert(op->args.size() == 2);
+        Expr a = op->args[0];
+        Expr b = op->args[1];
+        print_expr(cast(op->type, select(a < b, b - a, a - b)));
+    } else if (op->is_intrinsic(Call::abs)) {
+        internal_assert(op->args.size() == 1);
+        Expr a = op->args[0];
+        if (a.type().is_float()) {
+            print_expr(glsl_call(op->type, "abs", {a}));
+        } else {
+            print_expr(cast(op->type, select(a > 0, a, -a)));
+        }
+    } else if (op->is_intrinsic(Call::reinterpret)) {
+        internal_assert(op->args.size() == 1);
+        print_assignment(op->type, print_reinterpret(op->type, op->args[0]));
+    } else if (op->is_intrinsic(Call::count_leading_zeros) ||
+               op->is_intrinsic(Call::count_trailing_zeros) ||
+               op->is_intrinsic(Call::popcount)) {
+        internal_assert(op->args.size() == 1);
+        Expr a = op->args[0];
+        a = reinterpret(a.type().with_code(Type::UInt), a);
+        const char *query = op->is_intrinsic(Call::count_leading_zeros) ? Call::count_leading_zeros :
+                                  op->is_intrinsic(Call::count_trailing_zeros) ? Call::count_trailing_zeros :
+                                  Call::popcount;
+        print_expr(cast(op->type, bit_query(query, a)));
+    } else if (op->name == "fast_inverse_f32") {
+        internal_assert(op->args.size() == 1);
+        print_expr(make_one(op->type) / op->args[0]);
+    } else if (op->is_intrinsic(Call::bitwise_and) ||
+               op->is_intrinsic(Call::bitwise_or) ||
+               op->is_intrinsic(Call::bitwise_xor) ||
+               op->is_intrinsic(Call::bitwise_not) ||
+               op->is_intrinsic(Call::shift_left) ||
+               op->is_intrinsic(Call::shift_right) ||
+               op->is_intrinsic(Call::if_then_else) ||
+               op->is_intrinsic(Call::div_round_to_zero) ||
+               op->is_intrinsic(Call::mod_round_to_zero) ||
+               op->is_intrinsic(Call::strict_float)) {
+        // These print the same in GLSL as in C.
+        CodeGen_C::visit(op);
+    } else {
+        CodeGen_GLSLBase::visit(op);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const For *loop) {
+    if (is_gpu_var(loop->name)) {
+        internal_assert((loop->for_type == ForType::GPUBlock) ||
+                        (loop->for_type == ForType::GPUThread))
+            << "kernel loop must be either gpu block or gpu thread\n";
+        internal_assert(is_zero(loop->min));
+
+        // The workgroup size is a specialization constant set by the
+        // runtime, so the thread loop extents need not be constant.
+        do_indent();
+        stream << print_type(Int(32)) << " " << print_name(loop->name)
+               << " = int(" << simt_intrinsic(loop->name) << ");\n";
+
+        loop->body.accept(this);
+    } else {
+        user_assert(loop->for_type != ForType::Parallel)
+            << "Cannot use parallel loops inside a Vulkan kernel\n";
+        CodeGen_C::visit(loop);
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Ramp *op) {
+    string id_base = print_expr(op->base);
+    string id_stride = print_expr(op->stride);
+    ostringstream rhs;
+    rhs << print_type(op->type) << "(" << id_base;
+    for (int i = 1; i < op->lanes; i++) {
+        rhs << ", " << id_base << " + " << print_type(op->base.type()) << "(" << i << ") * " << id_stride;
+    }
+    rhs << ")";
+    print_assignment(op->type, rhs.str());
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Broadcast *op) {
+    string id_value = print_expr(op->value);
+    print_assignment(op->type, print_type(op->type) + "(" + id_value + ")");
+}
+
+string CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::print_element(const string &name, const string &index) {
+    // Buffers are members of a storage block; allocations are arrays.
+    if (allocations.contains(name)) {
+        return print_name(name) + "[" + index + "]";
+    } else {
+        return print_name(name) + ".data[" + index + "]";
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Load *op) {
+    user_assert(is_one(op->predicate)) << "Vulkan: predicated loads are not supported.\n";
+
+    // Vector loads are done a lane at a time, as the buffers are
+    // declared as arrays of scalars.
+    Type elem = op->type.element_of();
+    bool from_buffer = !allocations.contains(op->name);
+    vector<string> lanes;
+    if (op->type.is_scalar()) {
+        lanes.push_back(print_element(op->name, print_expr(op->index)));
+    } else if (const Ramp *ramp = op->index.as<Ramp>()) {
+        string id_base = print_expr(ramp->base);
+        string id_stride = print_expr(ramp->stride);
+        for (int i = 0; i < op->type.lanes(); i++) {
+            lanes.push_back(print_element(op->name, id_base + " + " + std::to_string(i) + " * " + id_stride));
+        }
+    } else {
+        string id_index = print_expr(op->index);
+        for (int i = 0; i < op->type.lanes(); i++) {
+            lanes.push_back(print_element(op->name, id_index + lane_suffix(i)));
+        }
+    }
+
+    ostringstream rhs;
+    if (op->type.is_vector()) {
+        rhs << print_type(op->type) << "(";
+    }
+    for (size_t i = 0; i < lanes.size(); i++) {
+        if (i > 0) {
+            rhs << ", ";
+        }
+        if (elem.is_bool() && from_buffer) {
+            rhs << "bool(" << lanes[i] << ")";
+        } else {
+            rhs << lanes[i];
+        }
+    }
+    if (op->type.is_vector()) {
+        rhs << ")";
+    }
+    print_assignment(op->type, rhs.str());
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Store *op) {
+    user_assert(is_one(op->predicate)) << "Vulkan: predicated stores are not supported.\n";
+    user_assert(!emit_atomic_stores) << "Vulkan: atomic stores are not supported.\n";
+
+    Type t = op->value.type();
+    string elem_type = allocations.contains(op->name) ?
+        print_type(t.element_of()) : print_storage_type(t.element_of());
+    string id_value = print_expr(op->value);
+
+    if (t.is_scalar()) {
+        string id_index = print_expr(op->index);
+        do_indent();
+        stream << print_element(op->name, id_index) << " = "
+               << elem_type << "(" << id_value << ");\n";
+    } else if (const Ramp *ramp = op->index.as<Ramp>()) {
+        string id_base = print_expr(ramp->base);
+        string id_stride = print_expr(ramp->stride);
+        for (int i = 0; i < t.lanes(); i++) {
+            do_indent();
+            stream << print_element(op->name, id_base + " + " + std::to_string(i) + " * " + id_stride)
+                   << " = " << elem_type << "(" << id_value << lane_suffix(i) << ");\n";
+        }
+    } else {
+        string id_index = print_expr(op->index);
+        for (int i = 0; i < t.lanes(); i++) {
+            do_indent();
+            stream << print_element(op->name, id_index + lane_suffix(i))
+                   << " = " << elem_type << "(" << id_value << lane_suffix(i) << ");\n";
+        }
+    }
+
+    // Need a cache clear on stores to avoid reusing stale loaded
+    // values from before the store.
+    cache.clear();
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Select *op) {
+    string true_val = print_expr(op->true_value);
+    string false_val = print_expr(op->false_value);
+    string cond = print_expr(op->condition);
+    ostringstream rhs;
+    if (op->condition.type().is_vector()) {
+        // mix with a bool vector picks lanes without blending.
+        rhs << "mix(" << false_val << ", " << true_val << ", " << cond << ")";
+    } else {
+        rhs << "(" << cond << " ? " << true_val << " : " << false_val << ")";
+    }
+    print_assignment(op->type, rhs.str());
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Allocate *op) {
+    debug(2) << "Vulkan: Allocate " << op->name << " of type " << op->type << " on device\n";
+
+    Allocation alloc;
+    alloc.type = op->type;
+    allocations.push(op->name, alloc);
+
+    if (starts_with(op->name, "__shared_")) {
+        // Shared allocations were already declared at global scope.
+        op->body.accept(this);
+    } else {
+        int32_t size = op->constant_allocation_size();
+        user_assert(size > 0)
+            << "Vulkan: allocation " << op->name << " inside a kernel must have a constant size.\n";
+        do_indent();
+        stream << "{\n";
+        indent += 2;
+        do_indent();
+        stream << print_type(op->type) << " "
+               << print_name(op->name) << "[" << size << "];\n";
+        op->body.accept(this);
+        indent -= 2;
+        do_indent();
+        stream << "}\n";
+    }
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Free *op) {
+    allocations.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const Evaluate *op) {
+    if (is_const(op->value)) return;
+    print_expr(op->value);
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::visit(const AssertStmt *op) {
+    user_warning << "Ignoring assertion inside Vulkan kernel: " << op->condition << "\n";
+}
+
+void CodeGen_Vulkan_Dev::CodeGen_Vulkan_C::add_kernel(Stmt s,
+                                                      const string &name,
+                                                      const vector<DeviceArgument> &args) {
+    debug(2) << "Adding Vulkan kernel " << name << "\n";
+    cache.clear();
+
+    stream << "#version 450\n"
+           << "#extension GL_EXT_shader_explicit_arithmetic_types : require\n"
+           << "#extension GL_EXT_shader_8bit_storage : require\n"
+           << "#extension GL_EXT_shader_16bit_storage : require\n"
+           << "// kernel " << name << "\n";
+
+    // The workgroup size is set by the runtime at dispatch.
+    stream << "layout(local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;\n";
+
+    // Buffers are bound in order to the storage buffer bindings of
+    // descriptor set 0.
+    int binding = 0;
+    for (const DeviceArgument &arg : args) {
+        if (!arg.is_buffer) {
+            continue;
+        }
+        stream << "layout(set = 0, binding = " << binding << ", std430) ";
+        if (!arg.write) {
+            stream << "readonly ";
+        } else if (!arg.read) {
+            stream << "writeonly ";
+        }
+        stream << "buffer B" << binding << " { "
+               << print_storage_type(arg.type) << " data[]; } "
+               << print_name(arg.name) << ";\n";
+        binding++;
+    }
+
+    // Scalars are push constants. Narrow types are widened to a
+    // 32-bit word, and narrowed again at the top of main.
+    int offset = 0;
+    ostringstream unpack;
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            continue;
+        }
+        if (offset == 0) {
+            stream << "layout(push_constant, std430) uniform Args {\n";
+        }
+        int slot = push_constant_slot_bytes(arg.type);
+        offset = (offset + slot - 1) / slot * slot;
+        string member = "args." + print_name(arg.name);
+        stream << "    layout(offset = " << offset << ") ";
+        if (arg.type.bytes() < 4) {
+            stream << "uint ";
+            string value = member;
+            if (arg.type.is_float()) {
+                value = "uint16BitsToFloat16(uint16_t(" + member + "))";
+            }
+            unpack << "  " << print_type(arg.type) << " " << print_name(arg.name)
+                   << " = " << print_type(arg.type) << "(" << value << ");\n";
+        } else {
+            stream << print_type(arg.type, AppendSpace);
+            unpack << "  " << print_type(arg.type) << " " << print_name(arg.name)
+                   << " = " << member << ";\n";
+        }
+        stream << print_name(arg.name) << ";\n";
+        offset += slot;
+    }
+    if (offset > 0) {
+        stream << "} args;\n";
+    }
+    user_assert(offset <= max_push_constant_bytes)
+        << "Vulkan: the scalar arguments of kernel " << name << " take " << offset
+        << " bytes, but only " << max_push_constant_bytes << " bytes of push constants are guaranteed.\n";
+
+    // Find all the shared allocations and declare them at global scope.
+    FindSharedAllocations fsa;
+    s.accept(&fsa);
+    for (const Allocate *op : fsa.allocs) {
+        int32_t size = op->constant_allocation_size();
+        user_assert(size > 0)
+            << "Vulkan: shared allocation " << op->name << " must have a constant size.\n";
+        stream << "shared " << print_type(op->type) << " "
+               << print_name(op->name) << "[" << size << "];\n";
+    }
+
+    stream << "void main()\n{\n";
+    stream << unpack.str();
+    indent += 2;
+    print(s);
+    indent -= 2;
+    stream << "}\n";
+}
+
+void CodeGen_Vulkan_Dev::add_kernel(Stmt s,
+                                    const string &name,
+                                    const vector<DeviceArgument> &args) {
+    debug(2) << "CodeGen_Vulkan_Dev::compile " << name << "\n";
+
+    cur_kernel_name = name;
+    // Each kernel is a separate shader, so print it on its own.
+    src_stream.str("");
+    src_stream.clear();
+    vk_c.add_kernel(s, name, args);
+    kernels.push_back({name, src_stream.str()});
+}
+
+void CodeGen_Vulkan_Dev::init_module() {
+    src_stream.str("");
+    src_stream.clear();
+    cur_kernel_name = "";
+    kernels.clear();
+}
+
+namespace {
+
+void append_word(vector<char> &blob, uint32_t word) {
+    const char *bytes = (const char *)&word;
+    blob.insert(blob.end(), bytes, bytes + sizeof(word));
+}
+
+}  // namespace
+
+vector<char> CodeGen_Vulkan_Dev::compile_to_src() {
+    // The module is a sequence of kernels, each of which is
+    //   uint32 name size, name (nul-terminated, padded to 4 bytes),
+    //   uint32 code size, SPIR-V code.
+    vector<char> blob;
+    for (const auto &k : kernels) {
+        debug(1) << "Vulkan kernel " << k.first << ":\n" << k.second << "\n";
+
+        TemporaryFile src("halide_vulkan", ".comp");
+        TemporaryFile spv("halide_vulkan", ".spv");
+        write_entire_file(src.pathname(), k.second.data(), k.second.size());
+        string cmd = "glslangValidator -V -S comp --target-env vulkan1.1 " +
+                     src.pathname() + " -o " + spv.pathname();
+        user_assert(system(cmd.c_str()) == 0)
+            << "The vulkan target feature requires glslangValidator, but compiling kernel "
+            << k.first << " failed. The source was:\n" << k.second << "\n";
+        vector<char> code = read_entire_file(spv.pathname());
+        internal_assert(!code.empty() && code.size() % 4 == 0);
+
+        uint32_t name_size = (k.first.size() + 1 + 3) & ~3;
+        append_word(blob, name_size);
+        size_t name_start = blob.size();
+        blob.insert(blob.end(), k.first.begin(), k.first.end());
+        blob.resize(name_start + name_size, 0);
+        append_word(blob, code.size());
+        blob.insert(blob.end(), code.begin(), code.end());
+    }
+    debug(1) << "Embedding " << blob.size() << " bytes of SPIR-V\n";
+    return blob;
+}
+
+string CodeGen_Vulkan_Dev::get_current_kernel_name() {
+    return cur_kernel_name;
+}
+
+void CodeGen_Vulkan_Dev::dump() {
+    for (const auto &k : kernels) {
+        std::cerr << k.second << std::endl;
+    }
+}
+
+string CodeGen_Vulkan_Dev::print_gpu_name(const string &name) {
+    return name;
+}
+
+void CodeGen_Vulkan_Dev::test() {
+    // out_buf[i] = in_buf[i] * k, with i split over blocks and threads.
+    Expr block = Variable::make(Int(32), "f.s0.x.__block_id_x");
+    Expr thread = Variable::make(Int(32), "f.s0.x.__thread_id_x");
+    Expr k = Variable::make(Float(32), "k");
+    Expr index = block * 16 + thread;
+    Expr value = Load::make(Float(32), "in_buf", index, Buffer<>(), Parameter(), const_true()) * k;
+    Stmt s = Store::make("out_buf", value, index, Parameter(), const_true());
+    s = For::make("f.s0.x.__thread_id_x", 0, 16, ForType::GPUThread, DeviceAPI::Vulkan, s);
+    s = For::make("f.s0.x.__block_id_x", 0, 4, ForType::GPUBlock, DeviceAPI::Vulkan, s);
+
+    DeviceArgument in_arg("in_buf", true, Float(32), 1);
+    in_arg.read = true;
+    in_arg.write = false;
+    DeviceArgument out_arg("out_buf", true, Float(32), 1);
+    out_arg.read = false;
+    out_arg.write = true;
+    DeviceArgument k_arg("k", false, Float(32), 0, 4);
+    k_arg.read = true;
+    k_arg.write = false;
+
+    CodeGen_Vulkan_Dev cg(get_host_target().with_feature(Target::Vulkan));
+    cg.init_module();
+    cg.add_kernel(s, "test_kernel", {in_arg, out_arg, k_arg});
+    internal_assert(cg.kernels.size() == 1 && cg.kernels[0].first == "test_kernel");
+
+    const string &src = cg.kernels[0].second;
+    const char *expected[] = {
+        "#version 450\n",
+        "layout(set = 0, binding = 0, std430) readonly buffer B0 { float data[]; } in_buf;\n",
+        "layout(set = 0, binding = 1, std430) writeonly buffer B1 { float data[]; } out_buf;\n",
+        "layout(offset = 0) float k;\n",
+        "float k = args.k;\n",
+        " = int(gl_WorkGroupID.x);\n",
+        " = int(gl_LocalInvocationID.x);\n",
+        "in_buf.data[",
+        "out_buf.data[",
+    };
+    for (const char *e : expected) {
+        internal_assert(src.find(e) != string::npos)
+            << "Vulkan kernel source is missing \"" << e << "\":\n" << src;
+    }
+
+    // Compiling to SPIR-V needs glslangValidator, which need not be
+    // installed where the tests run.
+#ifdef _WIN32
+    const char *probe = "glslangValidator --version > NUL 2>&1";
+#else
+    const char *probe = "glslangValidator --version > /dev/null 2>&1";
+#endif
+    if (system(probe) != 0) {
+        std::cout << "glslangValidator not found, skipping the SPIR-V part of the Vulkan test\n";
+        std::cout << "CodeGen_Vulkan_Dev test passed\n";
+        return;
+    }
+
+    // The module holds the kernel name, padded to four bytes, followed
+    // by a SPIR-V module, which starts with the SPIR-V magic number.
+    vector<char> blob = cg.compile_to_src();
+    auto word_at = [&](size_t offset) {
+        internal_assert(offset + 4 <= blob.size()) << "Vulkan module is truncated\n";
+        uint32_t word;
+        memcpy(&word, blob.data() + offset, 4);
+        return word;
+    };
+    uint32_t name_size = word_at(0);
+    internal_assert(name_size == 12 && string(blob.data() + 4) == "test_kernel")
+        << "Vulkan module has the wrong kernel name\n";
+    uint32_t code_size = word_at(4 + name_size);
+    internal_assert(code_size % 4 == 0 && 8 + name_size + code_size == blob.size())
+        << "Vulkan module has the wrong size\n";
+    internal_assert(word_at(8 + name_size) == 0x07230203)
+        << "Vulkan kernel is not a SPIR-V module\n";
+
+    std::cout << "CodeGen_Vulkan_Dev test passed\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,101 @@
+#ifndef HALIDE_CODEGEN_VULKAN_DEV_H
+#define HALIDE_CODEGEN_VULKAN_DEV_H
+
+/** \file
+ * Defines the code-generator for producing SPIR-V kernel code for Vulkan.
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CodeGen_C.h"
+#include "CodeGen_GPU_Dev.h"
+#include "CodeGen_OpenGL_Dev.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Each kernel is printed as a Vulkan-flavoured GLSL compute shader
+ * and compiled offline to SPIR-V with glslangValidator, which must be
+ * on the path at compile time. The module passed to the runtime is a
+ * blob holding the SPIR-V of all the kernels, keyed by kernel name. */
+class CodeGen_Vulkan_Dev : public CodeGen_GPU_Dev {
+public:
+    CodeGen_Vulkan_Dev(Target target);
+
+    void add_kernel(Stmt stmt,
+                    const std::string &name,
+                    const std::vector<DeviceArgument> &args) override;
+
+    void init_module() override;
+
+    std::vector<char> compile_to_src() override;
+
+    std::string get_current_kernel_name() override;
+
+    void dump() override;
+
+    std::string print_gpu_name(const std::string &name) override;
+
+    std::string api_unique_name() override { return "vulkan"; }
+
+    /** Check the shader printed for a simple kernel, and the SPIR-V
+     * module it compiles to if glslangValidator is available. */
+    static void test();
+
+protected:
+
+    class CodeGen_Vulkan_C : public CodeGen_GLSLBase {
+    public:
+        CodeGen_Vulkan_C(std::ostream &s, Target t);
+        void add_kernel(Stmt stmt,
+                        const std::string &name,
+                        const std::vector<DeviceArgument> &args);
+
+    protected:
+        std::string print_type(Type type, AppendSpaceIfNeeded space_option = DoNotAppendSpace) override;
+        // Buffers of bools are stored as bytes.
+        std::string print_storage_type(Type type);
+        std::string print_reinterpret(Type type, Expr e) override;
+
+        using CodeGen_C::visit;
+        void visit(const IntImm *op) override;
+        void visit(const UIntImm *op) override;
+        void visit(const FloatImm *op) override;
+        void visit(const Min *op) override;
+        void visit(const Max *op) override;
+        void visit(const Div *op) override;
+        void visit(const Mod *op) override;
+        void visit(const Not *op) override;
+        void visit(const And *op) override;
+        void visit(const Or *op) override;
+        void visit(const For *op) override;
+        void visit(const Ramp *op) override;
+        void visit(const Broadcast *op) override;
+        void visit(const Load *op) override;
+        void visit(const Store *op) override;
+        void visit(const Cast *op) override;
+        void visit(const Call *op) override;
+        void visit(const Allocate *op) override;
+        void visit(const Free *op) override;
+        void visit(const Select *op) override;
+        void visit(const Evaluate *op) override;
+        void visit(const AssertStmt *op) override;
+
+        // Print the element of a buffer or allocation at a scalar index.
+        std::string print_element(const std::string &name, const std::string &index);
+    };
+
+    std::ostringstream src_stream;
+    std::string cur_kernel_name;
+    // The GLSL source of each kernel, which is compiled separately.
+    std::vector<std::pair<std::string, std::string>> kernels;
+    CodeGen_Vulkan_C vk_c;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,110 @@
+#include "CodeGen_WebAssembly.h"
+#include "ConciseCasts.h"
+#include "IRMatch.h"
+#include "IROperator.h"
+#include "LLVM_Headers.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+using namespace Halide::ConciseCasts;
+using namespace llvm;
+
+CodeGen_WebAssembly::CodeGen_WebAssembly(Target t) : CodeGen_Posix(t) {
+    #if !(WITH_WEBASSEMBLY)
+    user_error << "llvm build not configured with WebAssembly target enabled.\n";
+    #endif
+    user_assert(llvm_WebAssembly_enabled) << "llvm build not configured with WebAssembly target enabled.\n";
+    user_assert(LLVM_VERSION >= 80) << "WebAssembly requires LLVM 8.0 or later.\n";
+    user_assert(target.bits == 32) << "Only wasm32 is supported.\n";
+}
+
+void CodeGen_WebAssembly::visit(const Cast *op) {
+    if (!op->type.is_vector() || !target.has_feature(Target::WasmSimd128)) {
+        // We only have peephole optimizations for simd128 in here.
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    vector<Expr> matches;
+
+    struct Pattern {
+        bool wide_op;
+        Type type;
+        string intrin;
+        Expr pattern;
+    };
+
+    static Pattern patterns[] = {
+        // The backend selects the simd128 saturating add and subtract
+        // instructions for the generic intrinsics.
+        {true, Int(8, 16), "llvm.sadd.sat.v16i8", i8_sat(wild_i16x_ + wild_i16x_)},
+        {true, Int(8, 16), "llvm.ssub.sat.v16i8", i8_sat(wild_i16x_ - wild_i16x_)},
+        {true, UInt(8, 16), "llvm.uadd.sat.v16i8", u8_sat(wild_u16x_ + wild_u16x_)},
+        {true, UInt(8, 16), "llvm.usub.sat.v16i8", u8(max(wild_i16x_ - wild_i16x_, 0))},
+        {true, Int(16, 8), "llvm.sadd.sat.v8i16", i16_sat(wild_i32x_ + wild_i32x_)},
+        {true, Int(16, 8), "llvm.ssub.sat.v8i16", i16_sat(wild_i32x_ - wild_i32x_)},
+        {true, UInt(16, 8), "llvm.uadd.sat.v8i16", u16_sat(wild_u32x_ + wild_u32x_)},
+        {true, UInt(16, 8), "llvm.usub.sat.v8i16", u16(max(wild_i32x_ - wild_i32x_, 0))},
+#if LLVM_VERSION >= 100
+        {true, UInt(8, 16), "llvm.wasm.avgr.unsigned.v16i8", u8(((wild_u16x_ + wild_u16x_) + 1) / 2)},
+        {true, UInt(16, 8), "llvm.wasm.avgr.unsigned.v8i16", u16(((wild_u32x_ + wild_u32x_) + 1) / 2)},
+#endif
+    };
+
+    for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
+        const Pattern &pattern = patterns[i];
+
+        if (expr_match(pattern.pattern, op, matches)) {
+            bool match = true;
+            if (pattern.wide_op) {
+                // Try to narrow the matches to the target type.
+                for (size_t i = 0; i < matches.size(); i++) {
+                    matches[i] = lossless_cast(op->type, matches[i]);
+                    if (!matches[i].defined()) match = false;
+                }
+            }
+            if (match) {
+                value = call_intrin(op->type, pattern.type.lanes(), pattern.intrin, matches);
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+string CodeGen_WebAssembly::mcpu() const {
+    return "";
+}
+
+string CodeGen_WebAssembly::mattrs() const {
+    std::string features;
+    std::string separator;
+    if (target.has_feature(Target::WasmSimd128)) {
+        features += "+simd128";
+        separator = ",";
+    }
+    if (target.has_feature(Target::WasmThreads)) {
+        // Threads share a SharedArrayBuffer, which requires the atomic
+        // instructions and shared memory.
+        features += separator + "+atomics,+bulk-memory";
+        separator = ",";
+    }
+    return features;
+}
+
+bool CodeGen_WebAssembly::use_soft_float_abi() const {
+    return false;
+}
+
+int CodeGen_WebAssembly::native_vector_bits() const {
+    return 128;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <iostream>
 
 #include "CodeGen_X86.h"
+#include "CodeGen_Internal.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
+#include "IREquality.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -60,12 +63,174 @@ bool should_use_pmaddwd(Expr a, Expr b, vector<Expr> &result) {
     return true;
 }
 
+// A multiply-accumulate that AVX512-VNNI does in one instruction:
+// each 32-bit lane of the accumulator gets the dot product of the
+// narrow lanes of a and b that it overlaps added to it.
+struct VNNIOp {
+    string intrin;
+    Expr a, b;
+};
+
+// An i32 accumulator plus four i32(u8)*i32(i8) products can be done
+// with vpdpbusd, and plus two i32(i16)*i32(i16) products with
+// vpdpwssd, by interleaving the narrow factors so that the terms of
+// each 32-bit lane are neighbors. Split the terms of a sum into such
+// groups, and whatever is left over.
+bool should_use_vnni(const Add *op, vector<VNNIOp> &ops, Expr &rest) {
+    Type t = op->type;
+    if (!(t.is_int() && t.bits() == 32 && t.lanes() >= 4)) {
+        return false;
+    }
+
+    vector<Expr> terms;
+    collect_terms(op, terms);
+
+    vector<Expr> byte_a, byte_b, byte_terms, word_a, word_b, word_terms, others;
+    for (const Expr &e : terms) {
+        Expr a, b;
+        if (match_narrow_product(e, UInt(8), Int(8), &a, &b)) {
+            byte_a.push_back(a);
+            byte_b.push_back(b);
+            byte_terms.push_back(e);
+        } else if (match_narrow_product(e, Int(16), Int(16), &a, &b)) {
+            word_a.push_back(a);
+            word_b.push_back(b);
+            word_terms.push_back(e);
+        } else {
+            others.push_back(e);
+        }
+    }
+    // Byte products that don't make up a group of four can still
+    // be done as word products.
+    while (byte_terms.size() % 4) {
+        word_a.push_back(cast(Int(16, t.lanes()), byte_a.back()));
+        word_b.push_back(cast(Int(16, t.lanes()), byte_b.back()));
+        word_terms.push_back(byte_terms.back());
+        byte_a.pop_back();
+        byte_b.pop_back();
+        byte_terms.pop_back();
+    }
+    if (word_terms.size() % 2) {
+        others.push_back(word_terms.back());
+        word_a.pop_back();
+        word_b.pop_back();
+        word_terms.pop_back();
+    }
+
+    if (byte_terms.empty() &&
+        (word_terms.empty() || (word_terms.size() == 2 && others.empty()))) {
+        // Nothing to do, or a lone pair of word products, which is
+        // just as well done with pmaddwd.
+        return false;
+    }
+
+    for (size_t i = 0; i < byte_terms.size(); i += 4) {
+        VNNIOp v;
+        v.intrin = "vpdpbusd";
+        v.a = reinterpret(t, Shuffle::make_interleave({byte_a[i], byte_a[i + 1], byte_a[i + 2], byte_a[i + 3]}));
+        v.b = reinterpret(t, Shuffle::make_interleave({byte_b[i], byte_b[i + 1], byte_b[i + 2], byte_b[i + 3]}));
+        ops.push_back(v);
+    }
+    for (size_t i = 0; i < word_terms.size(); i += 2) {
+        VNNIOp v;
+        v.intrin = "vpdpwssd";
+        v.a = reinterpret(t, Shuffle::make_interleave({word_a[i], word_a[i + 1]}));
+        v.b = reinterpret(t, Shuffle::make_interleave({word_b[i], word_b[i + 1]}));
+        ops.push_back(v);
+    }
+
+    rest = Expr();
+    for (const Expr &e : others) {
+        rest = rest.defined() ? rest + e : e;
+    }
+    return true;
+}
+
+bool has_avx512(const Target &t) {
+    return (t.has_feature(Target::AVX512) ||
+            t.has_feature(Target::AVX512_KNL) ||
+            t.has_feature(Target::AVX512_Skylake) ||
+            t.has_feature(Target::AVX512_Cannonlake) ||
+            t.has_feature(Target::AVX512_Cascadelake));
+}
+
+// Whether a vector access of type t at the given index is a gather or
+// scatter that CodeGen_LLVM would do one lane at a time, and which
+// has elements the hardware gathers and scatters can move. Narrower
+// elements would have to be gathered as 32-bit words, which can read
+// past the end of the buffer.
+bool is_general_gather(Type t, const Expr &index, const Expr &predicate) {
+    return (t.is_vector() &&
+            t.lanes() >= 4 &&
+            !t.is_handle() &&
+            (t.bits() == 32 || t.bits() == 64) &&
+            is_one(predicate) &&
+            index.type().element_of() == Int(32) &&
+            !index.as<Ramp>() &&
+            !index.as<Broadcast>() &&
+            !index.as<Let>());
+}
+
+// Replace loads of a buffer at exactly the given index with some
+// other Expr.
+class ReplaceLoads : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == buf && is_one(op->predicate) && equal(op->index, index)) {
+            return replacement;
+        }
+        return IRMutator2::visit(op);
+    }
+
+    const string &buf;
+    const Expr &index, &replacement;
+
+public:
+    ReplaceLoads(const string &buf, const Expr &index, const Expr &replacement) :
+        buf(buf), index(index), replacement(replacement) {}
+};
+
+class HasImpureCall : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+};
+
+bool has_impure_call(const Expr &e) {
+    HasImpureCall h;
+    e.accept(&h);
+    return h.result;
+}
+
 }
 
 
 void CodeGen_X86::visit(const Add *op) {
     vector<Expr> matches;
-    if (should_use_pmaddwd(op->a, op->b, matches)) {
+    vector<VNNIOp> vnni_ops;
+    Expr rest;
+    if (LLVM_VERSION >= 70 &&
+        target.has_feature(Target::AVX512_Cascadelake) &&
+        should_use_vnni(op, vnni_ops, rest)) {
+        int lanes = op->type.lanes();
+        int intrin_lanes = lanes >= 16 ? 16 : lanes >= 8 ? 8 : 4;
+        string suffix = "." + std::to_string(intrin_lanes * 32);
+        Value *acc = codegen(rest.defined() ? rest : make_zero(op->type));
+        for (const VNNIOp &v : vnni_ops) {
+            acc = call_intrin(acc->getType(), intrin_lanes, "llvm.x86.avx512." + v.intrin + suffix,
+                              {acc, codegen(v.a), codegen(v.b)});
+        }
+        value = acc;
+    } else if (should_use_pmaddwd(op->a, op->b, matches)) {
         codegen(Call::make(op->type, "pmaddwd", matches, Call::Extern));
     } else {
         CodeGen_Posix::visit(op);
@@ -88,6 +253,206 @@ void CodeGen_X86::visit(const Sub *op) {
     }
 }
 
+namespace {
+
+// Whether to build a shuffle of 8 or 16 bit elements that touches
+// more than one 128-bit chunk one output chunk at a time. Each chunk then
+// lowers to a few pshufbs and a blend or por, instead of whatever
+// LLVM manages for the whole shuffle at once (which for three-way
+// interleaves is a long series of inserts and extracts). With
+// AVX512-VBMI, vpermt2b can do any byte shuffle of two full vectors,
+// so leave those to LLVM.
+bool should_shuffle_by_chunks(const Target &target, int element_bits, int lanes) {
+    return (target.has_feature(Target::SSE41) &&
+            !target.has_feature(Target::AVX512_Cannonlake) &&
+            (element_bits == 8 || element_bits == 16) &&
+            lanes * element_bits > 128);
+}
+
+}  // namespace
+
+void CodeGen_X86::visit(const Block *op) {
+    // Unrolling a short reduction gives a run of stores that each
+    // add one more term into the same accumulator. Fuse them, so that
+    // visit(Add) sees all the products it could accumulate at once.
+    if (target.has_feature(Target::AVX512_Cascadelake)) {
+        const Block *rest = op->rest.as<Block>();
+        Stmt fused = fuse_accumulations(op->first, rest ? rest->first : op->rest);
+        if (fused.defined()) {
+            codegen(rest ? Block::make(fused, rest->rest) : fused);
+            return;
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_X86::visit(const Load *op) {
+    Halide::Type t = op->type;
+
+    // Loads of one channel of interleaved data are dense loads
+    // followed by a strided slice, which visit(const Shuffle *) turns
+    // into pshufbs. Otherwise they would be loaded one lane at a time.
+    const Ramp *ramp = op->index.as<Ramp>();
+    const int64_t *stride = ramp ? as_const_int(ramp->stride) : nullptr;
+    if (stride && (*stride == 3 || *stride == 4) && is_one(op->predicate) &&
+        should_shuffle_by_chunks(target, t.bits(), t.lanes() * (int)*stride)) {
+        int s = (int)*stride;
+        // Don't read beyond the last lane of an external buffer (or
+        // of any buffer, in ASAN mode).
+        int dense_lanes = t.lanes() * s;
+        if (op->param.defined() || op->image.defined() || target.has_feature(Target::ASAN)) {
+            dense_lanes -= s - 1;
+        }
+        Expr dense_index = Ramp::make(ramp->base, make_one(ramp->base.type()), dense_lanes);
+        Expr dense = Load::make(t.with_lanes(dense_lanes), op->name, dense_index,
+                                op->image, op->param, const_true(dense_lanes));
+        codegen(Shuffle::make_slice(dense, 0, s, t.lanes()));
+        return;
+    }
+
+    if (!is_general_gather(t, op->index, op->predicate)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    int alignment = t.bytes();
+    if (has_avx512(target)) {
+        // llvm turns a masked gather into vpgather on avx-512, and
+        // splits or widens it as needed.
+        Value *base = codegen_buffer_pointer(op->name, t.element_of(), make_zero(Int(32)));
+        Value *ptrs = builder->CreateInBoundsGEP(base, codegen(op->index));
+        Instruction *gather = builder->CreateMaskedGather(ptrs, alignment);
+        add_tbaa_metadata(gather, op->name, op->index);
+        value = gather;
+        return;
+    }
+
+    // On avx2, llvm scalarizes masked gathers, so call the gather
+    // intrinsics directly. They only come in full widths, so leave
+    // the vectors that don't break up into them to CodeGen_LLVM.
+    Intrinsic::ID id = Intrinsic::not_intrinsic;
+    int intrin_lanes = t.bits() == 32 ? 8 : 4;
+    if (target.has_feature(Target::AVX2) && t.lanes() % intrin_lanes == 0) {
+        if (t.is_float()) {
+            id = t.bits() == 32 ? Intrinsic::x86_avx2_gather_d_ps_256 : Intrinsic::x86_avx2_gather_d_pd_256;
+        } else {
+            id = t.bits() == 32 ? Intrinsic::x86_avx2_gather_d_d_256 : Intrinsic::x86_avx2_gather_d_q_256;
+        }
+    }
+    if (id == Intrinsic::not_intrinsic) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    llvm::Function *fn = Intrinsic::getDeclaration(module.get(), id);
+    llvm::Type *slice_t = llvm_type_of(t.with_lanes(intrin_lanes));
+    Value *base = codegen_buffer_pointer(op->name, UInt(8), make_zero(Int(32)));
+    Value *index = codegen(op->index);
+    // The gather instructions load the lanes whose mask has its top
+    // bit set.
+    Value *mask = ConstantExpr::getBitCast(Constant::getAllOnesValue(llvm_type_of(Int(t.bits(), intrin_lanes))),
+                                           slice_t);
+    Value *scale = ConstantInt::get(i8_t, t.bytes());
+    vector<Value *> slices;
+    for (int i = 0; i < t.lanes(); i += intrin_lanes) {
+        Value *args[] = {UndefValue::get(slice_t), base, slice_vector(index, i, intrin_lanes), mask, scale};
+        CallInst *gather = builder->CreateCall(fn, args);
+        add_tbaa_metadata(gather, op->name, op->index);
+        slices.push_back(gather);
+    }
+    value = concat_vectors(slices);
+}
+
+void CodeGen_X86::visit(const Store *op) {
+    Halide::Type t = op->value.type();
+    if (!has_avx512(target) || !is_general_gather(t, op->index, op->predicate)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    int lanes = t.lanes();
+    int alignment = t.bytes();
+    Value *base = codegen_buffer_pointer(op->name, t.element_of(), make_zero(Int(32)));
+    Value *index = codegen(op->index);
+    Value *ptrs = builder->CreateInBoundsGEP(base, index);
+
+    // Find the part of the value that is read from the elements being
+    // overwritten.
+    string old_name = unique_name(op->name + ".old");
+    Expr old_var = Variable::make(t, old_name);
+    Expr value_of_old = ReplaceLoads(op->name, op->index, old_var).mutate(op->value);
+
+    if (value_of_old.same_as(op->value)) {
+        // A plain scatter. Where lanes collide, the highest one wins,
+        // just as if they were stored one at a time.
+        Instruction *scatter = builder->CreateMaskedScatter(codegen(op->value), ptrs, alignment);
+        add_tbaa_metadata(scatter, op->name, op->index);
+        return;
+    }
+
+    #if LLVM_VERSION >= 70
+    if (!loads_from(value_of_old, op->name) && !has_impure_call(value_of_old)) {
+        // A read-modify-write scatter, such as a histogram update. When
+        // lanes collide, each must see what the lanes before it wrote,
+        // so use vpconflictd to find the lanes that don't depend on a
+        // lane still to be done, update those, and repeat until none
+        // are left. Goes sixteen lanes at a time, in order.
+        llvm::Function *conflict_fn = Intrinsic::getDeclaration(module.get(), Intrinsic::x86_avx512_conflict_d_512);
+        for (int i = 0; i < lanes; i += 16) {
+            int n = std::min(16, lanes - i);
+            llvm::Type *chunk_t = VectorType::get(i1_t, n);
+            llvm::Type *bits_t = llvm::Type::getIntNTy(*context, n);
+
+            // Bit j of lane k of conflicts is set if lane j < k writes
+            // the same element as lane k.
+            Value *conflicts = builder->CreateCall(conflict_fn, {slice_vector(index, i, 16)});
+            conflicts = slice_vector(conflicts, 0, n);
+
+            BasicBlock *pre_bb = builder->GetInsertBlock();
+            BasicBlock *loop_bb = BasicBlock::Create(*context, op->name + "_scatter_loop", function);
+            BasicBlock *after_bb = BasicBlock::Create(*context, op->name + "_scatter_after", function);
+            builder->CreateBr(loop_bb);
+            builder->SetInsertPoint(loop_bb);
+
+            PHINode *todo = builder->CreatePHI(chunk_t, 2);
+            todo->addIncoming(Constant::getAllOnesValue(chunk_t), pre_bb);
+            Value *todo_bits = builder->CreateZExt(builder->CreateBitCast(todo, bits_t), i32_t);
+            Value *blocked = builder->CreateAnd(conflicts, builder->CreateVectorSplat(n, todo_bits));
+            blocked = builder->CreateICmpNE(blocked, Constant::getNullValue(conflicts->getType()));
+            Value *ready = builder->CreateAnd(todo, builder->CreateNot(blocked));
+
+            // Place the chunk's mask among all the lanes.
+            Value *mask = ready;
+            if (n < lanes) {
+                vector<int> indices(lanes);
+                for (int j = 0; j < lanes; j++) {
+                    indices[j] = (j >= i && j < i + n) ? j - i : n;
+                }
+                mask = shuffle_vectors(ready, Constant::getNullValue(chunk_t), indices);
+            }
+
+            Instruction *gather = builder->CreateMaskedGather(ptrs, alignment, mask, UndefValue::get(llvm_type_of(t)));
+            add_tbaa_metadata(gather, op->name, op->index);
+            sym_push(old_name, gather);
+            Value *val = codegen(value_of_old);
+            sym_pop(old_name);
+            Instruction *scatter = builder->CreateMaskedScatter(val, ptrs, alignment, mask);
+            add_tbaa_metadata(scatter, op->name, op->index);
+
+            Value *remaining = builder->CreateAnd(todo, blocked);
+            todo->addIncoming(remaining, builder->GetInsertBlock());
+            Value *done = builder->CreateICmpEQ(builder->CreateBitCast(remaining, bits_t),
+                                                ConstantInt::get(bits_t, 0));
+            builder->CreateCondBr(done, after_bb, loop_bb);
+            builder->SetInsertPoint(after_bb);
+        }
+        return;
+    }
+    #endif
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_X86::visit(const GT *op) {
     if (op->type.is_vector()) {
         // Non-native vector widths get legalized poorly by llvm. We
@@ -366,6 +731,91 @@ void CodeGen_X86::visit(const Cast *op) {
     CodeGen_Posix::visit(op);
 }
 
+Value *CodeGen_X86::shuffle_by_chunks(Value *vec, const vector<int> &indices) {
+    const int chunk_lanes = 128 / vec->getType()->getScalarSizeInBits();
+    const int result_lanes = (int)indices.size();
+
+    vector<Value *> result;
+    for (int c = 0; c < result_lanes; c += chunk_lanes) {
+        // Find the 128-bit chunks of the input that this chunk of the
+        // output reads from, in order of first use.
+        vector<int> sources;
+        for (int i = c; i < std::min(c + chunk_lanes, result_lanes); i++) {
+            if (indices[i] >= 0 &&
+                std::find(sources.begin(), sources.end(), indices[i] / chunk_lanes) == sources.end()) {
+                sources.push_back(indices[i] / chunk_lanes);
+            }
+        }
+
+        // Shuffle in the source chunks one at a time. After step k,
+        // every lane of the output that reads from sources[0..k] is
+        // in place, and the other lanes are undefined.
+        Value *acc = nullptr;
+        for (size_t k = 0; k < sources.size(); k++) {
+            Value *src = slice_vector(vec, sources[k] * chunk_lanes, chunk_lanes);
+            vector<int> chunk_indices(chunk_lanes, -1);
+            for (int i = 0; i < chunk_lanes && c + i < result_lanes; i++) {
+                int idx = indices[c + i];
+                if (idx < 0) {
+                    continue;
+                }
+                int source = idx / chunk_lanes;
+                if (source == sources[k]) {
+                    chunk_indices[i] = idx % chunk_lanes + (acc ? chunk_lanes : 0);
+                } else if (acc && std::find(sources.begin(), sources.begin() + k, source) != sources.begin() + k) {
+                    chunk_indices[i] = i;
+                }
+            }
+            acc = acc ? shuffle_vectors(acc, src, chunk_indices) : shuffle_vectors(src, chunk_indices);
+        }
+        if (!acc) {
+            acc = UndefValue::get(VectorType::get(vec->getType()->getVectorElementType(), chunk_lanes));
+        }
+        result.push_back(acc);
+    }
+
+    return slice_vector(concat_vectors(result), 0, result_lanes);
+}
+
+Value *CodeGen_X86::interleave_vectors(const vector<Value *> &vecs) {
+    // Two- and four-way interleaves are trees of punpckl/punpckh,
+    // which is what the generic implementation produces. Three-way
+    // interleaves (e.g. storing RGB data) are not.
+    if (vecs.size() == 3) {
+        llvm::Type *t = vecs[0]->getType();
+        int lanes = t->getVectorNumElements();
+        if (should_shuffle_by_chunks(target, t->getScalarSizeInBits(), lanes * 3)) {
+            vector<int> indices(lanes * 3);
+            for (int i = 0; i < lanes * 3; i++) {
+                indices[i] = (i % 3) * lanes + i / 3;
+            }
+            return shuffle_by_chunks(concat_vectors(vecs), indices);
+        }
+    }
+    return CodeGen_Posix::interleave_vectors(vecs);
+}
+
+void CodeGen_X86::visit(const Shuffle *op) {
+    // Strided slices with a stride of three or four pull the
+    // channels out of interleaved RGB or RGBA data.
+    if (op->is_slice() &&
+        (op->slice_stride() == 3 || op->slice_stride() == 4)) {
+        int input_lanes = 0;
+        for (const Expr &e : op->vectors) {
+            input_lanes += e.type().lanes();
+        }
+        if (should_shuffle_by_chunks(target, op->type.bits(), input_lanes)) {
+            vector<Value *> vecs;
+            for (const Expr &e : op->vectors) {
+                vecs.push_back(codegen(e));
+            }
+            value = shuffle_by_chunks(concat_vectors(vecs), op->indices);
+            return;
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
 Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
     Type ty = a.type();
     if (ty.is_vector() && ty.bits() == 16) {
@@ -385,6 +835,9 @@ Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
 }
 
 string CodeGen_X86::mcpu() const {
+#if LLVM_VERSION >= 80
+    if (target.has_feature(Target::AVX512_Cascadelake)) return "cascadelake";
+#endif
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
     if (target.has_feature(Target::AVX512_Skylake)) return "skylake-avx512";
     if (target.has_feature(Target::AVX512_KNL)) return "knl";
@@ -414,19 +867,24 @@ string CodeGen_X86::mattrs() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_KNL) ||
         target.has_feature(Target::AVX512_Skylake) ||
-        target.has_feature(Target::AVX512_Cannonlake)) {
+        target.has_feature(Target::AVX512_Cannonlake) ||
+        target.has_feature(Target::AVX512_Cascadelake)) {
         features += separator + "+avx512f,+avx512cd";
         separator = ",";
         if (target.has_feature(Target::AVX512_KNL)) {
             features += ",+avx512pf,+avx512er";
         }
         if (target.has_feature(Target::AVX512_Skylake) ||
-            target.has_feature(Target::AVX512_Cannonlake)) {
+            target.has_feature(Target::AVX512_Cannonlake) ||
+            target.has_feature(Target::AVX512_Cascadelake)) {
             features += ",+avx512vl,+avx512bw,+avx512dq";
         }
         if (target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512ifma,+avx512vbmi";
         }
+        if (target.has_feature(Target::AVX512_Cascadelake)) {
+            features += ",+avx512vnni";
+        }
     }
     return features;
 }
@@ -439,7 +897,8 @@ int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
         target.has_feature(Target::AVX512_KNL) ||
-        target.has_feature(Target::AVX512_Cannonlake)) {
+        target.has_feature(Target::AVX512_Cannonlake) ||
+        target.has_feature(Target::AVX512_Cascadelake)) {
         return 512;
     } else if (target.has_feature(Target::AVX) ||
                target.has_feature(Target::AVX2)) {
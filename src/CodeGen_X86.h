@@ -44,7 +44,19 @@ protected:
     void visit(const EQ *) override;
     void visit(const NE *) override;
     void visit(const Select *) override;
+    void visit(const Block *) override;
+    void visit(const Load *) override;
+    void visit(const Store *) override;
+    void visit(const Shuffle *) override;
     // @}
+
+    /** Interleave three vectors of 8 or 16 bit elements with pshufb
+     * and blends rather than the generic shuffle tree. */
+    llvm::Value *interleave_vectors(const std::vector<llvm::Value *> &) override;
+
+    /** Shuffle a vector one 128-bit chunk of the result at a time,
+     * reading only the 128-bit chunks of the input each one uses. */
+    llvm::Value *shuffle_by_chunks(llvm::Value *vec, const std::vector<int> &indices);
 };
 
 }  // namespace Internal
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "CodeSize.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+class EstimateCodeSize : public IRVisitor {
+    using IRVisitor::visit;
+
+    const Target &target;
+    string func;
+
+    // The product of the constant extents of the enclosing vectorized
+    // loops.
+    int64_t lanes = 1;
+
+    void add(int64_t n) {
+        sizes[func] += n;
+    }
+
+    // An operation costs an instruction per native vector.
+    void add(Type t) {
+        int natural = std::max(1, target.natural_vector_size(t));
+        add((t.lanes() * lanes + natural - 1) / natural);
+    }
+
+    template<typename T>
+    void visit_op(const T *op) {
+        add(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Cast *op) override {
+        visit_op(op);
+    }
+    void visit(const Add *op) override {
+        visit_op(op);
+    }
+    void visit(const Sub *op) override {
+        visit_op(op);
+    }
+    void visit(const Mul *op) override {
+        visit_op(op);
+    }
+    void visit(const Div *op) override {
+        visit_op(op);
+    }
+    void visit(const Mod *op) override {
+        visit_op(op);
+    }
+    void visit(const Min *op) override {
+        visit_op(op);
+    }
+    void visit(const Max *op) override {
+        visit_op(op);
+    }
+    void visit(const EQ *op) override {
+        visit_op(op);
+    }
+    void visit(const NE *op) override {
+        visit_op(op);
+    }
+    void visit(const LT *op) override {
+        visit_op(op);
+    }
+    void visit(const LE *op) override {
+        visit_op(op);
+    }
+    void visit(const GT *op) override {
+        visit_op(op);
+    }
+    void visit(const GE *op) override {
+        visit_op(op);
+    }
+    void visit(const And *op) override {
+        visit_op(op);
+    }
+    void visit(const Or *op) override {
+        visit_op(op);
+    }
+    void visit(const Not *op) override {
+        visit_op(op);
+    }
+    void visit(const Select *op) override {
+        visit_op(op);
+    }
+    void visit(const Load *op) override {
+        visit_op(op);
+    }
+    void visit(const Ramp *op) override {
+        visit_op(op);
+    }
+    void visit(const Shuffle *op) override {
+        visit_op(op);
+    }
+
+    void visit(const Call *op) override {
+        add(op->type);
+        if (op->call_type == Call::Extern ||
+            op->call_type == Call::ExternCPlusPlus) {
+            // Marshalling the arguments, and checking the result.
+            add((int64_t)op->args.size() + 2);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        add(op->value.type());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const IfThenElse *op) override {
+        add(1);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const AssertStmt *op) override {
+        add(2);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        if (op->for_type == ForType::Vectorized) {
+            const IntImm *extent = op->extent.as<IntImm>();
+            ScopedValue<int64_t> old_lanes(lanes, lanes * (extent ? extent->value : 1));
+            op->body.accept(this);
+        } else {
+            // The increment, compare, and branch.
+            add(3);
+            op->body.accept(this);
+        }
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            ScopedValue<string> old_func(func, op->name);
+            IRVisitor::visit(op);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    map<string, int64_t> sizes;
+
+    EstimateCodeSize(const Target &t, const string &func, int lanes)
+        : target(t), func(func), lanes(lanes) {
+    }
+};
+
+}  // namespace
+
+map<string, int64_t> estimate_code_size(const Stmt &s, const Target &t,
+                                        const string &enclosing_func, int lanes) {
+    EstimateCodeSize e(t, enclosing_func, lanes);
+    if (s.defined()) {
+        s.accept(&e);
+    }
+    return e.sizes;
+}
+
+CodeSizeBudget::CodeSizeBudget(const map<string, Function> &env, const Target &t)
+    : target(t) {
+    string limit = get_env_variable("HL_CODE_SIZE_BUDGET");
+    if (!limit.empty()) {
+        pipeline_budget = std::max(0LL, std::atoll(limit.c_str()));
+    }
+    for (const auto &p : env) {
+        int64_t budget = p.second.schedule().code_size_budget();
+        if (budget > 0) {
+            func_budgets[p.first] = budget;
+        }
+    }
+}
+
+void CodeSizeBudget::measure(const Stmt &s) {
+    if (!enabled()) {
+        return;
+    }
+    sizes = estimate_code_size(s, target);
+    total = 0;
+    for (const auto &p : sizes) {
+        total += p.second;
+    }
+}
+
+map<string, int64_t> CodeSizeBudget::estimate(const Stmt &s, const string &func, int lanes) const {
+    return estimate_code_size(s, target, func, lanes);
+}
+
+bool CodeSizeBudget::try_grow(const map<string, int64_t> &growth, string *reason) {
+    if (!enabled()) {
+        return true;
+    }
+    int64_t total_growth = 0;
+    for (const auto &p : growth) {
+        total_growth += p.second;
+        auto it = func_budgets.find(p.first);
+        if (it == func_budgets.end()) {
+            continue;
+        }
+        int64_t size = sizes[p.first] + p.second;
+        if (p.second > 0 && size > it->second) {
+            std::ostringstream s;
+            s << "the code for " << p.first << " would grow to an estimated "
+              << size << " instructions, over its budget of " << it->second;
+            *reason = s.str();
+            return false;
+        }
+    }
+    if (pipeline_budget > 0 && total_growth > 0 && total + total_growth > pipeline_budget) {
+        std::ostringstream s;
+        s << "the code for the pipeline would grow to an estimated "
+          << total + total_growth << " instructions, over the HL_CODE_SIZE_BUDGET of "
+          << pipeline_budget;
+        *reason = s.str();
+        return false;
+    }
+    for (const auto &p : growth) {
+        sizes[p.first] += p.second;
+    }
+    total += total_growth;
+    return true;
+}
+
+bool code_size_report_enabled() {
+    static const bool enabled = !get_env_variable("HL_CODE_SIZE_REPORT").empty();
+    return enabled;
+}
+
+void report_code_size(const string &pipeline,
+                      const map<string, int64_t> &estimated,
+                      const map<string, int64_t> &generated) {
+    map<string, std::pair<int64_t, int64_t>> rows;
+    for (const auto &p : estimated) {
+        rows[p.first].first = p.second;
+    }
+    for (const auto &p : generated) {
+        rows[p.first].second = p.second;
+    }
+
+    std::ostringstream out;
+    out << "Code size of " << pipeline << ":\n"
+        << std::left << std::setw(40) << "Func"
+        << std::right << std::setw(12) << "estimated"
+        << std::setw(12) << "generated" << "\n";
+    int64_t total_estimated = 0, total_generated = 0;
+    for (const auto &r : rows) {
+        // Code outside of any producer is the pipeline's own.
+        out << std::left << std::setw(40) << (r.first.empty() ? "(pipeline)" : r.first)
+            << std::right << std::setw(12) << r.second.first
+            << std::setw(12) << r.second.second << "\n";
+        total_estimated += r.second.first;
+        total_generated += r.second.second;
+    }
+    out << std::left << std::setw(40) << "(total)"
+        << std::right << std::setw(12) << total_estimated
+        << std::setw(12) << total_generated << "\n";
+
+    // Pipelines may be compiled on several threads at once.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    const string destination = get_env_variable("HL_CODE_SIZE_REPORT");
+    if (destination == "1" || destination == "stderr") {
+        std::cerr << out.str();
+        return;
+    }
+    std::ofstream file(destination, std::ios::app);
+    if (!file) {
+        std::cerr << "Could not open HL_CODE_SIZE_REPORT file for writing: " << destination << "\n";
+        return;
+    }
+    file << out.str();
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,80 @@
+#ifndef HALIDE_CODE_SIZE_H
+#define HALIDE_CODE_SIZE_H
+
+/** \file
+ * Defines a model of how much machine code a statement compiles to,
+ * and the code size budgets that limit how far loop unrolling and
+ * loop partitioning may grow a pipeline.
+ */
+
+#include <map>
+#include <string>
+
+#include "Function.h"
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Estimate the number of machine instructions the code for each Func
+ * in a statement compiles to, keyed by Func name. Each operation
+ * costs one instruction per native vector of its type, counting the
+ * lanes of any enclosing vectorized loops. Loop bodies are counted
+ * once, whatever their extent. Code outside any producer is
+ * attributed to enclosing_func, and the statement is treated as if
+ * inside vectorized loops with the given number of lanes in total. */
+std::map<std::string, int64_t> estimate_code_size(const Stmt &s, const Target &t,
+                                                  const std::string &enclosing_func = "",
+                                                  int lanes = 1);
+
+/** The code size budgets of a pipeline: one for the pipeline as a
+ * whole, set by the HL_CODE_SIZE_BUDGET environment variable, and one
+ * per Func, set by Func::code_size_budget. Lowering passes that copy
+ * loop bodies ask for permission to grow the code first. */
+class CodeSizeBudget {
+    Target target;
+    int64_t pipeline_budget = 0;
+    std::map<std::string, int64_t> func_budgets;
+
+    // The current estimated size of each Func's code, and their sum.
+    std::map<std::string, int64_t> sizes;
+    int64_t total = 0;
+
+public:
+    CodeSizeBudget(const std::map<std::string, Function> &env, const Target &t);
+
+    /** Whether there is any budget. If not, growth is always
+     * permitted, and there's no need to estimate it. */
+    bool enabled() const {
+        return pipeline_budget > 0 || !func_budgets.empty();
+    }
+
+    /** Reset the current sizes to the estimated size of a statement. */
+    void measure(const Stmt &s);
+
+    /** Estimate the size of a statement within the producer of func,
+     * and within vectorized loops with the given number of lanes. */
+    std::map<std::string, int64_t> estimate(const Stmt &s, const std::string &func, int lanes = 1) const;
+
+    /** Grow the current sizes by the given amounts, if that keeps
+     * within all the budgets. Otherwise leave them alone, describe the
+     * budget that would be exceeded in reason, and return false. */
+    bool try_grow(const std::map<std::string, int64_t> &growth, std::string *reason);
+};
+
+/** Whether the HL_CODE_SIZE_REPORT environment variable is set. */
+bool code_size_report_enabled();
+
+/** Add a table of the estimated size of each Func's code in a
+ * pipeline, and the number of LLVM instructions generated for it
+ * (before optimization), to the report named by HL_CODE_SIZE_REPORT:
+ * "1" or "stderr" for stderr, or else a file to append to. */
+void report_code_size(const std::string &pipeline,
+                      const std::map<std::string, int64_t> &estimated,
+                      const std::map<std::string, int64_t> &generated);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
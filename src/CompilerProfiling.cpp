@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "CompilerProfiling.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Count the distinct nodes in a Stmt.
+class CountNodes : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    std::set<const IRNode *> seen;
+
+    void include(const Expr &e) override {
+        count += seen.insert(e.get()).second;
+        IRGraphVisitor::include(e);
+    }
+
+    void include(const Stmt &s) override {
+        count += seen.insert(s.get()).second;
+        IRGraphVisitor::include(s);
+    }
+
+public:
+    int64_t count = 0;
+
+    void count_nodes(const Stmt &s) {
+        include(s);
+    }
+};
+
+struct PhaseRecord {
+    string group, phase;
+    double begin_us, duration_us;
+    int64_t size;
+};
+
+class CompileProfile {
+    std::mutex mutex;
+    vector<PhaseRecord> records;
+    const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    void write_trace(std::ostream &out) {
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        for (size_t i = 0; i < records.size(); i++) {
+            const PhaseRecord &r = records[i];
+            out << (i ? ",\n" : "")
+                << "{\"name\": \"" << r.phase
+                << "\", \"cat\": \"" << r.group
+                << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0"
+                << ", \"ts\": " << r.begin_us
+                << ", \"dur\": " << r.duration_us
+                << ", \"args\": {\"size\": " << r.size << "}}";
+        }
+        out << "\n]}\n";
+    }
+
+    void write_table(std::ostream &out) {
+        // Sum up repeated phases (e.g. from compiling many
+        // pipelines), keeping the order they first appeared in.
+        struct Total {
+            double ms = 0;
+            int64_t max_size = -1;
+            int count = 0;
+        };
+        vector<std::pair<string, string>> order;
+        std::map<std::pair<string, string>, Total> totals;
+        std::map<string, double> group_ms;
+        for (const PhaseRecord &r : records) {
+            auto key = std::make_pair(r.group, r.phase);
+            if (!totals.count(key)) {
+                order.push_back(key);
+            }
+            Total &t = totals[key];
+            t.ms += r.duration_us / 1000;
+            t.max_size = std::max(t.max_size, r.size);
+            t.count++;
+            group_ms[r.group] += r.duration_us / 1000;
+        }
+
+        out << "Compile-time profile:\n"
+            << std::left << std::setw(10) << "group"
+            << std::setw(40) << "phase"
+            << std::right << std::setw(12) << "total ms"
+            << std::setw(8) << "count"
+            << std::setw(12) << "max size" << "\n";
+        out << std::fixed << std::setprecision(3);
+        for (const auto &key : order) {
+            const Total &t = totals[key];
+            out << std::left << std::setw(10) << key.first
+                << std::setw(40) << key.second
+                << std::right << std::setw(12) << t.ms
+                << std::setw(8) << t.count
+                << std::setw(12);
+            if (t.max_size >= 0) {
+                out << t.max_size;
+            } else {
+                out << "-";
+            }
+            out << "\n";
+        }
+        for (const auto &g : group_ms) {
+            out << std::left << std::setw(10) << g.first
+                << std::setw(40) << "(total)"
+                << std::right << std::setw(12) << g.second << "\n";
+        }
+    }
+
+public:
+    const string destination = get_env_variable("HL_COMPILE_PROFILE");
+
+    void record(const string &group, const string &phase,
+                std::chrono::steady_clock::time_point begin,
+                std::chrono::steady_clock::time_point end,
+                int64_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        records.push_back({group, phase,
+                           std::chrono::duration<double, std::micro>(begin - origin).count(),
+                           std::chrono::duration<double, std::micro>(end - begin).count(),
+                           size});
+    }
+
+    ~CompileProfile() {
+        if (records.empty()) {
+            return;
+        }
+        if (destination == "1" || destination == "stderr") {
+            write_table(std::cerr);
+            return;
+        }
+        std::ofstream out(destination);
+        if (!out) {
+            std::cerr << "Could not open HL_COMPILE_PROFILE file for writing: " << destination << "\n";
+            return;
+        }
+        if (ends_with(destination, ".json")) {
+            write_trace(out);
+        } else {
+            write_table(out);
+        }
+    }
+};
+
+CompileProfile &compile_profile() {
+    static CompileProfile profile;
+    return profile;
+}
+
+}  // namespace
+
+CompilePhaseTimer::CompilePhaseTimer(const string &group)
+    : group(group), start(std::chrono::steady_clock::now()) {
+}
+
+bool CompilePhaseTimer::enabled() {
+    return !compile_profile().destination.empty();
+}
+
+void CompilePhaseTimer::lap(const string &phase, int64_t size) {
+    if (!enabled()) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    compile_profile().record(group, phase, start, end, size);
+    start = std::chrono::steady_clock::now();
+}
+
+void CompilePhaseTimer::lap(const string &phase, const Stmt &s) {
+    if (!enabled()) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    CountNodes counter;
+    if (s.defined()) {
+        counter.count_nodes(s);
+    }
+    compile_profile().record(group, phase, start, end, s.defined() ? counter.count : -1);
+    start = std::chrono::steady_clock::now();
+}
+
+}  // namespace Internal
+}  // namespace Halide
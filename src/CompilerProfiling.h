@@ -0,0 +1,54 @@
+#ifndef HALIDE_COMPILER_PROFILING_H
+#define HALIDE_COMPILER_PROFILING_H
+
+/** \file
+ * Tools for profiling the compiler itself: how long each lowering
+ * pass and each phase of code generation takes.
+ */
+
+#include <chrono>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Times consecutive phases of compilation, recording each one along
+ * with the size of the code it produced. Nothing is recorded unless
+ * the HL_COMPILE_PROFILE environment variable is set. At exit, the
+ * phases are written to the file it names: as a Chrome trace (for
+ * chrome://tracing or Perfetto) if the name ends in .json, and
+ * otherwise as a table of the total time spent in each phase. If it
+ * is set to "1" or "stderr", the table goes to stderr.
+ *
+ * Also turns on LLVM's own per-pass timers, which report to stderr
+ * when each LLVM pass manager is done. */
+class CompilePhaseTimer {
+public:
+    /** Start timing the first phase of a group of phases, e.g. "lower". */
+    explicit CompilePhaseTimer(const std::string &group);
+
+    /** Record the time since the last lap (or since construction) as
+     * the given phase, and start timing the next one. The size of
+     * the code after the phase is given as the number of distinct IR
+     * nodes in a Stmt, or as a count of anything else that makes
+     * sense for the group (e.g. LLVM instructions), or -1 if
+     * unknown. Counting IR nodes is not included in either phase. */
+    // @{
+    void lap(const std::string &phase, const Stmt &s);
+    void lap(const std::string &phase, int64_t size = -1);
+    // @}
+
+    /** Whether HL_COMPILE_PROFILE is set. */
+    static bool enabled();
+
+private:
+    std::string group;
+    std::chrono::steady_clock::time_point start;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
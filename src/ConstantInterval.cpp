@@ -0,0 +1,582 @@
+#include "ConstantInterval.h"
+#include "IR.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+#include <iostream>
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+const int64_t int64_min = std::numeric_limits<int64_t>::min();
+const int64_t int64_max = std::numeric_limits<int64_t>::max();
+
+}  // namespace
+
+ConstantInterval ConstantInterval::bounds_of_type(Type t) {
+    t = t.element_of();
+    if (t.is_int() && t.bits() < 64) {
+        return ConstantInterval(t.min().as<IntImm>()->value, t.max().as<IntImm>()->value);
+    } else if (t.is_uint() && t.bits() < 64) {
+        return ConstantInterval(0, (int64_t)t.max().as<UIntImm>()->value);
+    } else if (t.is_uint()) {
+        ConstantInterval result;
+        result.min_defined = true;
+        return result;
+    } else {
+        return everything();
+    }
+}
+
+bool ConstantInterval::is_within(Type t) const {
+    t = t.element_of();
+    if (t.is_int() && t.bits() == 64) {
+        return true;
+    }
+    ConstantInterval range = bounds_of_type(t);
+    return (is_bounded() &&
+            (!range.min_defined || min >= range.min) &&
+            (!range.max_defined || max <= range.max));
+}
+
+void ConstantInterval::include(const ConstantInterval &other) {
+    min_defined = min_defined && other.min_defined;
+    max_defined = max_defined && other.max_defined;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+ConstantInterval operator+(const ConstantInterval &a, const ConstantInterval &b) {
+    ConstantInterval result;
+    result.min_defined = a.min_defined && b.min_defined && !add_would_overflow(64, a.min, b.min);
+    result.max_defined = a.max_defined && b.max_defined && !add_would_overflow(64, a.max, b.max);
+    result.min = result.min_defined ? a.min + b.min : 0;
+    result.max = result.max_defined ? a.max + b.max : 0;
+    return result;
+}
+
+ConstantInterval operator-(const ConstantInterval &a, const ConstantInterval &b) {
+    ConstantInterval result;
+    result.min_defined = a.min_defined && b.max_defined && !sub_would_overflow(64, a.min, b.max);
+    result.max_defined = a.max_defined && b.min_defined && !sub_would_overflow(64, a.max, b.min);
+    result.min = result.min_defined ? a.min - b.max : 0;
+    result.max = result.max_defined ? a.max - b.min : 0;
+    return result;
+}
+
+ConstantInterval operator*(const ConstantInterval &a, const ConstantInterval &b) {
+    if (a.is_single_point() && !b.is_single_point()) {
+        return b * a;
+    }
+    if (b.is_single_point()) {
+        int64_t c = b.min;
+        if (c == 0) {
+            return ConstantInterval::single_point(0);
+        }
+        ConstantInterval result;
+        result.min_defined = (c > 0 ? a.min_defined : a.max_defined);
+        result.max_defined = (c > 0 ? a.max_defined : a.min_defined);
+        int64_t lo = c > 0 ? a.min : a.max;
+        int64_t hi = c > 0 ? a.max : a.min;
+        if (result.min_defined && mul_would_overflow(64, lo, c)) {
+            result.min_defined = false;
+        }
+        if (result.max_defined && mul_would_overflow(64, hi, c)) {
+            result.max_defined = false;
+        }
+        result.min = result.min_defined ? lo * c : 0;
+        result.max = result.max_defined ? hi * c : 0;
+        return result;
+    }
+    if (!a.is_bounded() || !b.is_bounded()) {
+        return ConstantInterval::everything();
+    }
+    const int64_t corners[4][2] = {{a.min, b.min}, {a.min, b.max}, {a.max, b.min}, {a.max, b.max}};
+    ConstantInterval result = ConstantInterval::single_point(a.min * b.min);
+    for (const auto &c : corners) {
+        if (mul_would_overflow(64, c[0], c[1])) {
+            return ConstantInterval::everything();
+        }
+        result.include(ConstantInterval::single_point(c[0] * c[1]));
+    }
+    return result;
+}
+
+ConstantInterval operator/(const ConstantInterval &a, const ConstantInterval &b) {
+    // Division by zero gives zero, so divisors that may be zero give
+    // nothing useful.
+    if (!b.is_bounded() || (b.min <= 0 && b.max >= 0)) {
+        return ConstantInterval::everything();
+    }
+    // The only division that overflows.
+    if (a.min_defined && a.min == int64_min && b.min <= -1 && b.max >= -1) {
+        return ConstantInterval::everything();
+    }
+    if (a.is_bounded()) {
+        ConstantInterval result = ConstantInterval::single_point(div_imp(a.min, b.min));
+        result.include(ConstantInterval::single_point(div_imp(a.min, b.max)));
+        result.include(ConstantInterval::single_point(div_imp(a.max, b.min)));
+        result.include(ConstantInterval::single_point(div_imp(a.max, b.max)));
+        return result;
+    }
+    if (b.is_single_point()) {
+        // Division by a constant is monotonic in the numerator.
+        int64_t c = b.min;
+        ConstantInterval result;
+        result.min_defined = (c > 0 ? a.min_defined : a.max_defined);
+        result.max_defined = (c > 0 ? a.max_defined : a.min_defined);
+        result.min = result.min_defined ? div_imp(c > 0 ? a.min : a.max, c) : 0;
+        result.max = result.max_defined ? div_imp(c > 0 ? a.max : a.min, c) : 0;
+        return result;
+    }
+    return ConstantInterval::everything();
+}
+
+ConstantInterval operator%(const ConstantInterval &a, const ConstantInterval &b) {
+    if (a.is_single_point() && b.is_single_point()) {
+        return ConstantInterval::single_point(b.min == 0 ? 0 : mod_imp(a.min, b.min));
+    }
+    // The result is non-negative, and less than the magnitude of the
+    // divisor. Modulo by zero gives zero.
+    ConstantInterval result;
+    result.min_defined = true;
+    if (b.is_bounded() && b.min > int64_min) {
+        int64_t magnitude = std::max(std::abs(b.min), std::abs(b.max));
+        result.max_defined = true;
+        result.max = std::max(magnitude - 1, (int64_t)0);
+        if (a.is_bounded() && a.min >= 0 && a.max < result.max + 1 &&
+            (b.min > a.max || b.max < -a.max)) {
+            // The modulo doesn't wrap.
+            return a;
+        }
+    }
+    return result;
+}
+
+ConstantInterval min(const ConstantInterval &a, const ConstantInterval &b) {
+    ConstantInterval result;
+    result.min_defined = a.min_defined && b.min_defined;
+    result.min = std::min(a.min, b.min);
+    result.max_defined = a.max_defined || b.max_defined;
+    if (a.max_defined && b.max_defined) {
+        result.max = std::min(a.max, b.max);
+    } else {
+        result.max = a.max_defined ? a.max : b.max;
+    }
+    return result;
+}
+
+ConstantInterval max(const ConstantInterval &a, const ConstantInterval &b) {
+    ConstantInterval result;
+    result.max_defined = a.max_defined && b.max_defined;
+    result.max = std::max(a.max, b.max);
+    result.min_defined = a.min_defined || b.min_defined;
+    if (a.min_defined && b.min_defined) {
+        result.min = std::max(a.min, b.min);
+    } else {
+        result.min = a.min_defined ? a.min : b.min;
+    }
+    return result;
+}
+
+namespace {
+
+// The bounds of an Expr, and whether they depend on any variables.
+struct CachedBounds {
+    Expr e;
+    ConstantInterval bounds;
+    bool uses_vars;
+};
+
+class FindConstantBounds : public IRVisitor {
+public:
+    ConstantInterval result;
+    bool uses_vars = false;
+
+    FindConstantBounds(const Scope<Interval> &scope) : scope(scope) {}
+
+    ConstantInterval bounds(const Expr &e) {
+        // The results for Exprs without variables don't depend on
+        // the context, and neither do any results when there is no
+        // context.
+        const bool no_context = scope.empty() && let_bounds.empty();
+        auto &cache = get_cache();
+        auto it = cache.find(e.get());
+        if (it != cache.end() && (no_context || !it->second.uses_vars)) {
+            uses_vars = uses_vars || it->second.uses_vars;
+            return it->second.bounds;
+        }
+
+        bool old_uses_vars = uses_vars;
+        uses_vars = false;
+        e.accept(this);
+        ConstantInterval r = result;
+        const Type t = e.type().element_of();
+        if (t.is_int() && t.bits() >= 32) {
+            // Signed integer overflow of 32 or more bits is
+            // undefined, so the result is assumed to be in range.
+            ConstantInterval range = ConstantInterval::bounds_of_type(t);
+            if (range.min_defined && (!r.min_defined || r.min < range.min || r.min > range.max)) {
+                r.min = range.min;
+                r.min_defined = true;
+            }
+            if (range.max_defined && (!r.max_defined || r.max > range.max || r.max < range.min)) {
+                r.max = range.max;
+                r.max_defined = true;
+            }
+        } else if (!r.is_within(t)) {
+            // Anything outside of the type must have wrapped.
+            r = ConstantInterval::bounds_of_type(t);
+        }
+        if (no_context || !uses_vars) {
+            if (cache.size() >= max_cache_size) {
+                cache.clear();
+            }
+            cache[e.get()] = CachedBounds{e, r, uses_vars};
+        }
+        uses_vars = uses_vars || old_uses_vars;
+        result = r;
+        return r;
+    }
+
+private:
+    const Scope<Interval> &scope;
+    Scope<ConstantInterval> let_bounds;
+
+    static const size_t max_cache_size = 1 << 14;
+
+    // The cache holds a reference to each Expr, so that its address
+    // can't be reused by another Expr while it's in the cache.
+    static std::map<const IRNode *, CachedBounds> &get_cache() {
+        static thread_local std::map<const IRNode *, CachedBounds> cache;
+        return cache;
+    }
+
+    static bool is_integer(const Type &t) {
+        return t.is_int() || t.is_uint();
+    }
+
+    using IRVisitor::visit;
+
+    void visit(const IntImm *op) override {
+        result = ConstantInterval::single_point(op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        if (op->value <= (uint64_t)int64_max) {
+            result = ConstantInterval::single_point((int64_t)op->value);
+        } else {
+            result = ConstantInterval::bounds_of_type(op->type);
+        }
+    }
+
+    void visit(const FloatImm *op) override {
+        result = ConstantInterval::everything();
+    }
+
+    void visit(const StringImm *op) override {
+        result = ConstantInterval::everything();
+    }
+
+    void visit(const Cast *op) override {
+        if (is_integer(op->type) && is_integer(op->value.type())) {
+            // Out of range values wrap, which bounds() deals with.
+            result = bounds(op->value);
+        } else {
+            result = ConstantInterval::bounds_of_type(op->type);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        uses_vars = true;
+        result = ConstantInterval::bounds_of_type(op->type);
+        if (!is_integer(op->type)) {
+            return;
+        }
+        if (let_bounds.contains(op->name)) {
+            result = let_bounds.get(op->name);
+            return;
+        }
+        if (scope.contains(op->name)) {
+            const Interval &i = scope.get(op->name);
+            if (const int64_t *m = as_const_int(i.min)) {
+                result = max(result, ConstantInterval::single_point(*m));
+            }
+            if (const int64_t *m = as_const_int(i.max)) {
+                result = min(result, ConstantInterval::single_point(*m));
+            }
+        }
+        if (op->param.defined() && !op->param.is_buffer()) {
+            if (const int64_t *m = as_const_int(op->param.min_value())) {
+                result = max(result, ConstantInterval::single_point(*m));
+            }
+            if (const int64_t *m = as_const_int(op->param.max_value())) {
+                result = min(result, ConstantInterval::single_point(*m));
+            }
+        }
+    }
+
+    template<typename T>
+    bool visit_arithmetic(const T *op, ConstantInterval &a, ConstantInterval &b) {
+        if (!is_integer(op->type)) {
+            result = ConstantInterval::everything();
+            return false;
+        }
+        a = bounds(op->a);
+        b = bounds(op->b);
+        return true;
+    }
+
+    void visit(const Add *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = a + b;
+        }
+    }
+
+    void visit(const Sub *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = a - b;
+        }
+    }
+
+    void visit(const Mul *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = a * b;
+        }
+    }
+
+    void visit(const Div *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = a / b;
+        }
+    }
+
+    void visit(const Mod *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = a % b;
+        }
+    }
+
+    void visit(const Min *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = min(a, b);
+        }
+    }
+
+    void visit(const Max *op) override {
+        ConstantInterval a, b;
+        if (visit_arithmetic(op, a, b)) {
+            result = max(a, b);
+        }
+    }
+
+    // Decide a comparison of two intervals, given the condition on
+    // their ends that proves it and the one that disproves it.
+    template<typename T>
+    void visit_compare(const T *op, bool (*proves)(const ConstantInterval &, const ConstantInterval &),
+                       bool (*disproves)(const ConstantInterval &, const ConstantInterval &)) {
+        result = ConstantInterval(0, 1);
+        if (!is_integer(op->a.type())) {
+            return;
+        }
+        ConstantInterval a = bounds(op->a);
+        ConstantInterval b = bounds(op->b);
+        if (proves(a, b)) {
+            result = ConstantInterval::single_point(1);
+        } else if (disproves(a, b)) {
+            result = ConstantInterval::single_point(0);
+        }
+    }
+
+    static bool always_lt(const ConstantInterval &a, const ConstantInterval &b) {
+        return a.max_defined && b.min_defined && a.max < b.min;
+    }
+
+    static bool always_le(const ConstantInterval &a, const ConstantInterval &b) {
+        return a.max_defined && b.min_defined && a.max <= b.min;
+    }
+
+    static bool always_gt(const ConstantInterval &a, const ConstantInterval &b) {
+        return always_lt(b, a);
+    }
+
+    static bool always_ge(const ConstantInterval &a, const ConstantInterval &b) {
+        return always_le(b, a);
+    }
+
+    static bool always_eq(const ConstantInterval &a, const ConstantInterval &b) {
+        return a.is_single_point() && b.is_single_point() && a.min == b.min;
+    }
+
+    static bool always_ne(const ConstantInterval &a, const ConstantInterval &b) {
+        return always_lt(a, b) || always_lt(b, a);
+    }
+
+    void visit(const LT *op) override {
+        visit_compare(op, always_lt, always_ge);
+    }
+
+    void visit(const LE *op) override {
+        visit_compare(op, always_le, always_gt);
+    }
+
+    void visit(const GT *op) override {
+        visit_compare(op, always_gt, always_le);
+    }
+
+    void visit(const GE *op) override {
+        visit_compare(op, always_ge, always_lt);
+    }
+
+    void visit(const EQ *op) override {
+        visit_compare(op, always_eq, always_ne);
+    }
+
+    void visit(const NE *op) override {
+        visit_compare(op, always_ne, always_eq);
+    }
+
+    void visit(const And *op) override {
+        ConstantInterval a = bounds(op->a);
+        ConstantInterval b = bounds(op->b);
+        result = ConstantInterval(a.min && b.min, a.max && b.max);
+    }
+
+    void visit(const Or *op) override {
+        ConstantInterval a = bounds(op->a);
+        ConstantInterval b = bounds(op->b);
+        result = ConstantInterval(a.min || b.min, a.max || b.max);
+    }
+
+    void visit(const Not *op) override {
+        ConstantInterval a = bounds(op->a);
+        result = ConstantInterval(1 - a.max, 1 - a.min);
+    }
+
+    void visit(const Select *op) override {
+        if (!is_integer(op->type)) {
+            result = ConstantInterval::everything();
+            return;
+        }
+        ConstantInterval c = bounds(op->condition);
+        if (c.is_single_point()) {
+            result = bounds(c.min ? op->true_value : op->false_value);
+        } else {
+            ConstantInterval t = bounds(op->true_value);
+            result = bounds(op->false_value);
+            result.include(t);
+        }
+    }
+
+    void visit(const Load *op) override {
+        result = ConstantInterval::bounds_of_type(op->type);
+    }
+
+    void visit(const Ramp *op) override {
+        if (!is_integer(op->type)) {
+            result = ConstantInterval::everything();
+            return;
+        }
+        ConstantInterval base = bounds(op->base);
+        ConstantInterval stride = bounds(op->stride);
+        result = base + stride * ConstantInterval(0, op->lanes - 1);
+    }
+
+    void visit(const Broadcast *op) override {
+        result = bounds(op->value);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::likely) ||
+            op->is_intrinsic(Call::likely_if_innermost)) {
+            result = bounds(op->args[0]);
+        } else {
+            result = ConstantInterval::bounds_of_type(op->type);
+        }
+    }
+
+    void visit(const Let *op) override {
+        ConstantInterval value = bounds(op->value);
+        ScopedBinding<ConstantInterval> bind(let_bounds, op->name, value);
+        result = bounds(op->body);
+    }
+
+    void visit(const Shuffle *op) override {
+        if (!is_integer(op->type)) {
+            result = ConstantInterval::everything();
+            return;
+        }
+        ConstantInterval r = bounds(op->vectors[0]);
+        for (size_t i = 1; i < op->vectors.size(); i++) {
+            r.include(bounds(op->vectors[i]));
+        }
+        result = r;
+    }
+};
+
+}  // namespace
+
+ConstantInterval constant_integer_bounds(const Expr &e, const Scope<Interval> &scope) {
+    internal_assert(e.defined());
+    return FindConstantBounds(scope).bounds(e);
+}
+
+void constant_interval_test() {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+    Expr u8 = Variable::make(UInt(8), "u8");
+    Scope<Interval> scope;
+    scope.push("x", Interval(Expr(0), Expr(10)));
+    scope.push("y", Interval(Expr(-3), Interval::pos_inf));
+
+    auto check = [&](Expr e, int64_t min, int64_t max) {
+        ConstantInterval c = constant_integer_bounds(e, scope);
+        internal_assert(c.is_bounded() && c.min == min && c.max == max)
+            << "Expected constant bounds of " << e << " to be [" << min << ", " << max << "], "
+            << "but got [" << (c.min_defined ? std::to_string(c.min) : "-inf") << ", "
+            << (c.max_defined ? std::to_string(c.max) : "inf") << "]\n";
+    };
+
+    check(x + 3, 3, 13);
+    check(x - x, -10, 10);
+    check(x * -2, -20, 0);
+    check(x / 3, 0, 3);
+    check((x - 5) / 2, -3, 2);
+    check(x % 4, 0, 3);
+    check(x % 16, 0, 10);
+    check(min(x, 4), 0, 4);
+    check(cast<int>(u8) + 1, 1, 256);
+    check(u8 + 1, 0, 255);
+    check(cast<uint8_t>(u8 + 1), 0, 255);
+    check(select(x < 11, x, 100), 0, 10);
+    check(Let::make("z", x * 2, Variable::make(Int(32), "z") + 1), 1, 21);
+    check(Ramp::make(x, 2, 4), 0, 16);
+    check(x < 11, 1, 1);
+    check(x >= 11, 0, 0);
+    check(y < 0 && x < 0, 0, 0);
+    check(x < y, 0, 1);
+
+    // 32-bit signed integers are assumed not to overflow, so
+    // unbounded ends are clamped to the range of the type.
+    check(y * 2, -6, 0x7fffffff);
+    check(x / y, -0x7fffffff - 1, 0x7fffffff);
+
+    // A variable not in the scope takes the bounds of its type.
+    ConstantInterval c = constant_integer_bounds(Variable::make(Int(16), "w") + 1);
+    internal_assert(c.min == -32768 && c.max == 32767);
+
+    std::cout << "ConstantInterval test passed" << std::endl;
+}
+
+}  // namespace Internal
+}  // namespace Halide
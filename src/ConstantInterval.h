@@ -0,0 +1,84 @@
+#ifndef HALIDE_CONSTANT_INTERVAL_H
+#define HALIDE_CONSTANT_INTERVAL_H
+
+/** \file
+ * Defines ConstantInterval, and an analysis that finds constant
+ * integer bounds of Exprs without building or simplifying any new IR.
+ */
+
+#include <stdint.h>
+
+#include "Interval.h"
+#include "Scope.h"
+#include "Type.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A range of 64-bit integers that may be unbounded above or below. A
+ * default-constructed ConstantInterval is everything. */
+struct ConstantInterval {
+    int64_t min = 0, max = 0;
+    bool min_defined = false, max_defined = false;
+
+    ConstantInterval() = default;
+    ConstantInterval(int64_t min, int64_t max) :
+        min(min), max(max), min_defined(true), max_defined(true) {}
+
+    static ConstantInterval everything() {
+        return ConstantInterval();
+    }
+
+    static ConstantInterval single_point(int64_t x) {
+        return ConstantInterval(x, x);
+    }
+
+    /** The range of values of a scalar integer or boolean type, or
+     * everything for other types. */
+    static ConstantInterval bounds_of_type(Type t);
+
+    bool is_bounded() const {
+        return min_defined && max_defined;
+    }
+
+    bool is_single_point() const {
+        return is_bounded() && min == max;
+    }
+
+    /** Is every value in the interval representable in the given
+     * type. */
+    bool is_within(Type t) const;
+
+    /** Expand the interval to include another one. */
+    void include(const ConstantInterval &other);
+};
+
+/** Arithmetic on ConstantIntervals, with the semantics of Halide's
+ * integer operators. Ends that would overflow 64 bits are unbounded. */
+// @{
+ConstantInterval operator+(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval operator-(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval operator*(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval operator/(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval operator%(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval min(const ConstantInterval &a, const ConstantInterval &b);
+ConstantInterval max(const ConstantInterval &a, const ConstantInterval &b);
+// @}
+
+/** Find constant bounds of an integer or boolean Expr, over all of its
+ * lanes, using the bounds of the variables in the scope that are
+ * constants. Boolean Exprs have bounds within [0, 1], so a single
+ * point means the Expr is known to be true or false. This is much
+ * cheaper than bounds_of_expr_in_scope followed by simplification,
+ * but can only answer questions whose answers don't depend on
+ * symbolic bounds. Results for subexpressions are cached, so
+ * repeated queries about the same Exprs are cheap. */
+ConstantInterval constant_integer_bounds(const Expr &e,
+                                         const Scope<Interval> &scope = Scope<Interval>::empty_scope());
+
+void constant_interval_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
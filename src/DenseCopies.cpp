@@ -0,0 +1,243 @@
+#include "DenseCopies.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+#include <cmath>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+// Shorter copies and fills are left as loops, which beat the
+// overhead of a call.
+const int64_t min_bytes = 256;
+
+// A copy of count contiguous elements from src to dst, or a fill of
+// count contiguous elements of dst with a repeated byte.
+struct DenseCopy {
+    string dst, src;
+    Expr dst_index, src_index;
+    Expr count;
+    Expr byte;
+    Type type;
+
+    bool is_fill() const {
+        return src.empty();
+    }
+
+    bool is_small() const {
+        const int64_t *c = as_const_int(count);
+        return c && *c * type.bytes() < min_bytes;
+    }
+};
+
+// If all the bytes of a constant are the same, return that byte.
+Expr repeated_byte(const Expr &value) {
+    if (const FloatImm *f = value.as<FloatImm>()) {
+        // Only positive zero is all zero bits.
+        if (f->value == 0 && !std::signbit(f->value)) {
+            return make_zero(UInt(8));
+        }
+        return Expr();
+    }
+
+    uint64_t bits;
+    if (const int64_t *i = as_const_int(value)) {
+        bits = (uint64_t)(*i);
+    } else if (const uint64_t *u = as_const_uint(value)) {
+        bits = *u;
+    } else {
+        return Expr();
+    }
+    uint64_t byte = bits & 0xff;
+    for (int i = 1; i < value.type().bytes(); i++) {
+        if (((bits >> (8 * i)) & 0xff) != byte) {
+            return Expr();
+        }
+    }
+    return make_const(UInt(8), byte);
+}
+
+class LowerDenseCopies : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The values of the enclosing Int(32) lets, in terms of variables
+    // not defined by those lets.
+    map<string, Expr> lets;
+
+    Stmt visit(const LetStmt *op) override {
+        if (op->value.type() != Int(32)) {
+            return IRMutator2::visit(op);
+        }
+        lets[op->name] = substitute(lets, op->value);
+        Stmt body = mutate(op->body);
+        lets.erase(op->name);
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return LetStmt::make(op->name, op->value, body);
+    }
+
+    // Check that an index moves on by the given number of elements on
+    // each iteration of a loop.
+    bool has_stride(const Expr &index, const string &var, const Expr &stride) {
+        Expr v = Variable::make(Int(32), var);
+        Expr delta = simplify(substitute(var, v + 1, index) - index);
+        if (expr_uses_var(delta, var)) {
+            return false;
+        }
+        return can_prove(substitute(lets, delta == stride));
+    }
+
+    bool as_copy(const Stmt &s, DenseCopy &c) {
+        if (const LetStmt *let = s.as<LetStmt>()) {
+            // Look through the lets that define the indices.
+            if (!as_copy(let->body, c)) {
+                return false;
+            }
+            c.dst_index = substitute(let->name, let->value, c.dst_index);
+            c.count = substitute(let->name, let->value, c.count);
+            if (!c.is_fill()) {
+                c.src_index = substitute(let->name, let->value, c.src_index);
+            }
+            return true;
+        }
+
+        auto it = copies.find(s.get());
+        if (it != copies.end()) {
+            c = it->second.copy;
+            return true;
+        }
+
+        const Store *store = s.as<Store>();
+        if (!store ||
+            !is_one(store->predicate) ||
+            !store->value.type().is_scalar() ||
+            store->value.type().is_bool() ||
+            store->value.type().is_handle()) {
+            return false;
+        }
+        c.dst = store->name;
+        c.dst_index = store->index;
+        c.count = 1;
+        c.type = store->value.type();
+        if (const Load *load = store->value.as<Load>()) {
+            if (!is_one(load->predicate) || load->name == store->name) {
+                return false;
+            }
+            c.src = load->name;
+            c.src_index = load->index;
+            return true;
+        }
+        c.byte = repeated_byte(store->value);
+        return c.byte.defined();
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave device code alone.
+            return op;
+        }
+
+        Stmt body = mutate(op->body);
+
+        DenseCopy c;
+        if ((op->for_type == ForType::Serial ||
+             op->for_type == ForType::Vectorized ||
+             op->for_type == ForType::Unrolled) &&
+            as_copy(body, c) &&
+            !expr_uses_var(c.count, op->name) &&
+            has_stride(c.dst_index, op->name, c.count) &&
+            (c.is_fill() || has_stride(c.src_index, op->name, c.count))) {
+            c.dst_index = simplify(substitute(op->name, op->min, c.dst_index));
+            if (!c.is_fill()) {
+                c.src_index = simplify(substitute(op->name, op->min, c.src_index));
+            }
+            c.count = simplify(c.count * max(op->extent, 0));
+
+            Expr dst = Variable::make(Handle(), c.dst);
+            Expr call;
+            if (c.is_fill()) {
+                call = Call::make(c.type, Call::fill_memory,
+                                  {dst, c.dst_index, c.byte, c.count},
+                                  Call::Intrinsic);
+            } else {
+                Expr src = Variable::make(Handle(), c.src);
+                call = Call::make(c.type, Call::copy_memory,
+                                  {dst, c.dst_index, src, c.src_index, c.count},
+                                  Call::Intrinsic);
+            }
+            Stmt result = Evaluate::make(call);
+            Stmt loop = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            copies[result.get()] = {result, loop, c};
+            return result;
+        }
+
+        if (op->for_type == ForType::Vectorized) {
+            // The vectorizer doesn't know these calls, so put back
+            // the loops inside this one.
+            body = revert(body, true);
+        }
+
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    class Revert : public IRMutator2 {
+        using IRMutator2::visit;
+
+        const LowerDenseCopies &parent;
+        bool all;
+
+        Stmt visit(const Evaluate *op) override {
+            auto it = parent.copies.find(op);
+            if (it != parent.copies.end() &&
+                (all || it->second.copy.is_small())) {
+                return mutate(it->second.loop);
+            }
+            return op;
+        }
+
+    public:
+        Revert(const LowerDenseCopies &parent, bool all)
+            : parent(parent), all(all) {}
+    };
+
+public:
+    struct Replacement {
+        // The Evaluate node of the call, kept alive so that its
+        // address stays unique.
+        Stmt call;
+        // The loop nest it replaced.
+        Stmt loop;
+        DenseCopy copy;
+    };
+    map<const IRNode *, Replacement> copies;
+
+    // Put back the loop nests of the calls in a Stmt, or just those
+    // that are too short to be worth a call.
+    Stmt revert(const Stmt &s, bool all) {
+        return Revert(*this, all).mutate(s);
+    }
+};
+
+}  // namespace
+
+Stmt lower_dense_copies(Stmt s) {
+    LowerDenseCopies lower;
+    s = lower.mutate(s);
+    return lower.revert(s, false);
+}
+
+}  // namespace Internal
+}  // namespace Halide
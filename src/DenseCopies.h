@@ -0,0 +1,25 @@
+#ifndef HALIDE_DENSE_COPIES_H
+#define HALIDE_DENSE_COPIES_H
+
+/** \file
+ * Defines the lowering pass that turns dense copy and fill loops into
+ * memcpy and memset.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace serial, vectorized, and unrolled loop nests on the host
+ * that copy a contiguous range of one buffer into a contiguous range
+ * of another, or fill a contiguous range with a repeated byte, with
+ * calls to the copy_memory and fill_memory intrinsics. Parallel loops
+ * are kept, and their bodies replaced instead. Must run after storage
+ * flattening and before vectorization. */
+Stmt lower_dense_copies(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
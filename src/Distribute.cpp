@@ -0,0 +1,383 @@
+#include "Distribute.h"
+#include "Bounds.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "InjectHostDevBufferCopies.h"
+#include "Simplify.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct DistributedFunc {
+    Function func;
+    // The index of the distributed dimension in the Func's args.
+    int dim;
+    bool is_output;
+};
+
+bool is_gpu_loop(const For *op) {
+    return (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane);
+}
+
+class ContainsGPULoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (is_gpu_loop(op)) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+// Does a statement read a Func, either directly or through its
+// buffer?
+class ReadsFunc : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == func) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        if (op->name == func + ".buffer") {
+            result = true;
+        }
+    }
+
+    const string &func;
+
+public:
+    bool result = false;
+    ReadsFunc(const string &func) : func(func) {}
+};
+
+bool reads_func(const Stmt &s, const string &func) {
+    ReadsFunc reads(func);
+    s.accept(&reads);
+    return reads.result;
+}
+
+bool reads_func(const Expr &e, const string &func) {
+    ReadsFunc reads(func);
+    e.accept(&reads);
+    return reads.result;
+}
+
+const string rank_name = "distributed.rank";
+const string num_ranks_name = "distributed.num_ranks";
+
+// Define the slice of [global_min, global_min + global_extent) owned
+// by this rank as prefix.rank_min and prefix.rank_max.
+Stmt define_rank_slice(const string &prefix, Expr global_min, Expr global_extent, Stmt s) {
+    Expr rank = Variable::make(Int(32), rank_name);
+    Expr num_ranks = Variable::make(Int(32), num_ranks_name);
+    Expr min_var = Variable::make(Int(32), prefix + ".global_min");
+    Expr extent_var = Variable::make(Int(32), prefix + ".global_extent");
+    Expr chunk = (extent_var + num_ranks - 1) / num_ranks;
+    Expr rank_min = min_var + rank * chunk;
+    Expr rank_max = min(rank_min + chunk, min_var + extent_var) - 1;
+    s = LetStmt::make(prefix + ".rank_max", rank_max, s);
+    s = LetStmt::make(prefix + ".rank_min", rank_min, s);
+    s = LetStmt::make(prefix + ".global_extent", global_extent, s);
+    s = LetStmt::make(prefix + ".global_min", global_min, s);
+    return s;
+}
+
+// Insert the wait for the halo exchange of a Func just before the
+// first statement that reads it. If that statement is the loop of a
+// distributed consumer, run the iterations of it that only read the
+// slice of the Func owned by this rank before the wait instead.
+class WaitForExchange : public IRMutator2 {
+    using IRMutator2::mutate;
+    using IRMutator2::visit;
+
+    const DistributedFunc &producer;
+    const set<string> &splittable_loops;
+    Stmt wait;
+
+    Stmt split_loop(const For *op) {
+        const string &name = producer.func.name();
+        int dim = producer.dim;
+        Box b = box_required(op->body, name);
+        if ((int)b.size() <= dim || !b[dim].is_bounded()) {
+            return Stmt();
+        }
+
+        // The iterations read the rows in [loop - below, loop + above].
+        Expr loop_var = Variable::make(Int(32), op->name);
+        Expr below = simplify(loop_var - b[dim].min);
+        Expr above = simplify(b[dim].max - loop_var);
+        if (!is_const(below) || !is_const(above)) {
+            return Stmt();
+        }
+
+        Expr rank_min = Variable::make(Int(32), name + ".rank_min");
+        Expr rank_max = Variable::make(Int(32), name + ".rank_max");
+        Expr first = op->min;
+        Expr last = op->min + op->extent - 1;
+
+        // [first, interior_min) and (interior_max, last] may read the
+        // halo. interior_min is clamped to [first, last + 1] and
+        // interior_max to [interior_min - 1, last], so the three loops
+        // partition the original one.
+        string interior_min_name = op->name + ".interior_min";
+        string interior_max_name = op->name + ".interior_max";
+        Expr interior_min = Variable::make(Int(32), interior_min_name);
+        Expr interior_max = Variable::make(Int(32), interior_max_name);
+
+        Stmt interior = For::make(op->name, interior_min, interior_max - interior_min + 1,
+                                  op->for_type, op->device_api, op->body);
+        Stmt lower = For::make(op->name, first, interior_min - first,
+                               op->for_type, op->device_api, op->body);
+        Stmt upper = For::make(op->name, interior_max + 1, last - interior_max,
+                               op->for_type, op->device_api, op->body);
+
+        Stmt s = Block::make({interior, wait, lower, upper});
+        s = LetStmt::make(interior_max_name,
+                          max(min(last, rank_max - above), interior_min - 1), s);
+        s = LetStmt::make(interior_min_name,
+                          min(max(first, rank_min + below), last + 1), s);
+        return s;
+    }
+
+public:
+    bool done = false;
+
+    WaitForExchange(const DistributedFunc &producer, const set<string> &splittable_loops, Stmt wait)
+        : producer(producer), splittable_loops(splittable_loops), wait(wait) {}
+
+    Stmt mutate(const Stmt &s) override {
+        const string &name = producer.func.name();
+        if (done || !reads_func(s, name)) {
+            return s;
+        }
+
+        if (s.as<Block>() || s.as<ProducerConsumer>() || s.as<Realize>()) {
+            return IRMutator2::mutate(s);
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            if (!reads_func(op->value, name)) {
+                return IRMutator2::mutate(s);
+            }
+        } else if (const For *op = s.as<For>()) {
+            if (splittable_loops.count(op->name)) {
+                Stmt split = split_loop(op);
+                if (split.defined()) {
+                    done = true;
+                    return split;
+                }
+            }
+        }
+
+        done = true;
+        return Block::make(wait, s);
+    }
+};
+
+class DistributeAcrossRanks : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The distributed Funcs, keyed by name.
+    map<string, DistributedFunc> funcs;
+
+    // The loops over the distributed dimension of each stage of the
+    // distributed Funcs, and the Func each one belongs to.
+    map<string, string> loops;
+
+    // The loops of pure definitions, which may be split into their
+    // interior and their edges.
+    set<string> splittable_loops;
+
+    bool in_gpu_loop = false;
+
+    Stmt visit(const For *op) override {
+        auto it = loops.find(op->name);
+        if (it == loops.end()) {
+            ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop || is_gpu_loop(op));
+            return IRMutator2::visit(op);
+        }
+
+        const string &func = it->second;
+        ContainsGPULoops gpu_loops;
+        op->accept(&gpu_loops);
+        user_assert(!in_gpu_loop && !gpu_loops.result)
+            << "Func " << func << " is distributed, so it must be computed on the CPU.\n";
+        user_assert(op->for_type == ForType::Serial || op->for_type == ForType::Parallel)
+            << "The loop " << op->name << " over the distributed dimension of " << func
+            << " must be serial or parallel.\n";
+        loops_found.insert(op->name);
+
+        Stmt body = mutate(op->body);
+
+        string min_name = op->name + ".rank_loop_min";
+        string max_name = op->name + ".rank_loop_max";
+        Expr loop_min = Variable::make(Int(32), min_name);
+        Expr loop_max = Variable::make(Int(32), max_name);
+        Expr rank_min = Variable::make(Int(32), func + ".rank_min");
+        Expr rank_max = Variable::make(Int(32), func + ".rank_max");
+
+        Stmt s = For::make(op->name, loop_min, max(loop_max - loop_min + 1, 0),
+                           op->for_type, op->device_api, body);
+        s = LetStmt::make(max_name, min(op->min + op->extent - 1, rank_max), s);
+        s = LetStmt::make(min_name, max(op->min, rank_min), s);
+        return s;
+    }
+
+    Stmt visit(const Realize *op) override {
+        auto it = funcs.find(op->name);
+        if (it == funcs.end()) {
+            return IRMutator2::visit(op);
+        }
+
+        const Range &r = op->bounds[it->second.dim];
+        Stmt body = define_rank_slice(op->name, r.min, r.extent, mutate(op->body));
+        return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        auto it = funcs.find(op->name);
+        if (it == funcs.end() || op->is_producer || it->second.is_output) {
+            return IRMutator2::visit(op);
+        }
+
+        const DistributedFunc &f = it->second;
+        Stmt body = mutate(op->body);
+
+        // Find the part of the Func this rank's share of its
+        // consumers needs.
+        Box b = box_required(body, op->name);
+        if (b.empty()) {
+            return ProducerConsumer::make_consume(op->name, body);
+        }
+        user_assert(b[f.dim].is_bounded())
+            << "Could not bound the region of " << op->name << " needed on each rank "
+            << "along its distributed dimension " << f.func.args()[f.dim] << ".\n";
+
+        Expr buffer = Variable::make(type_of<halide_buffer_t *>(), op->name + ".buffer");
+        Expr global_min = Variable::make(Int(32), op->name + ".global_min");
+        Expr global_extent = Variable::make(Int(32), op->name + ".global_extent");
+        Stmt begin = call_extern_and_assert("halide_distributed_exchange_begin",
+                                            {buffer, f.dim, global_min, global_extent,
+                                             b[f.dim].min, b[f.dim].max - b[f.dim].min + 1});
+        Stmt wait = call_extern_and_assert("halide_distributed_exchange_end", {buffer});
+
+        WaitForExchange waiter(f, splittable_loops, wait);
+        body = waiter.mutate(body);
+        if (!waiter.done) {
+            body = Block::make(wait, body);
+        }
+        return ProducerConsumer::make_consume(op->name, Block::make(begin, body));
+    }
+
+public:
+    set<string> loops_found;
+
+    DistributeAcrossRanks(const map<string, Function> &env, const vector<Function> &outputs) {
+        for (const auto &p : env) {
+            const Function &f = p.second;
+            const string &var = f.schedule().distributed_var();
+            if (var.empty()) {
+                continue;
+            }
+
+            bool is_output = false;
+            for (const Function &o : outputs) {
+                is_output = is_output || o.same_as(f);
+            }
+            user_assert(is_output || f.schedule().compute_level().is_root())
+                << "Func " << f.name() << " is distributed, so it must be compute_root or an output.\n";
+            user_assert(!f.has_extern_definition())
+                << "Func " << f.name() << " is distributed, so it can't be an extern stage.\n";
+            user_assert(!f.schedule().async())
+                << "Func " << f.name() << " is distributed, so it can't be computed asynchronously.\n";
+
+            const vector<string> &args = f.args();
+            int dim = (int)(std::find(args.begin(), args.end(), var) - args.begin());
+            internal_assert(dim < (int)args.size());
+            funcs[f.name()] = {f, dim, is_output};
+
+            for (size_t i = 0; i <= f.updates().size(); i++) {
+                if (i > 0) {
+                    const Variable *v = f.update(i - 1).args()[dim].as<Variable>();
+                    user_assert(v && v->name == var)
+                        << "Func " << f.name() << " is distributed over " << var << ", but update "
+                        << "definition " << i - 1 << " doesn't compute the same site of it.\n";
+                }
+                string loop_name = f.name() + ".s" + std::to_string(i) + "." + var;
+                loops[loop_name] = f.name();
+                if (i == 0) {
+                    splittable_loops.insert(loop_name);
+                }
+            }
+        }
+    }
+
+    const map<string, DistributedFunc> &distributed_funcs() const {
+        return funcs;
+    }
+
+    bool empty() const {
+        return funcs.empty();
+    }
+};
+
+}  // namespace
+
+Stmt distribute_across_ranks(Stmt s, const map<string, Function> &env, const vector<Function> &outputs) {
+    DistributeAcrossRanks distributor(env, outputs);
+    if (distributor.empty()) {
+        return s;
+    }
+    s = distributor.mutate(s);
+
+    for (const auto &p : distributor.distributed_funcs()) {
+        const DistributedFunc &f = p.second;
+        string var = f.func.schedule().distributed_var();
+        for (size_t i = 0; i <= f.func.updates().size(); i++) {
+            string loop_name = f.func.name() + ".s" + std::to_string(i) + "." + var;
+            user_assert(distributor.loops_found.count(loop_name))
+                << "Func " << f.func.name() << " is distributed over " << var
+                << ", but stage " << i << " has no loop over " << var
+                << ". The distributed dimension can't be split or fused.\n";
+        }
+
+        // The slices of the outputs are of the output buffers.
+        if (f.is_output) {
+            string dim = std::to_string(f.dim);
+            Expr global_min = Variable::make(Int(32), f.func.name() + ".min." + dim);
+            Expr global_extent = Variable::make(Int(32), f.func.name() + ".extent." + dim);
+            s = define_rank_slice(f.func.name(), global_min, global_extent, s);
+        }
+    }
+
+    s = LetStmt::make(rank_name,
+                      Call::make(Int(32), "halide_distributed_rank", {}, Call::Extern), s);
+    s = LetStmt::make(num_ranks_name,
+                      Call::make(Int(32), "halide_distributed_num_ranks", {}, Call::Extern), s);
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
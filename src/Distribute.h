@@ -0,0 +1,31 @@
+#ifndef HALIDE_DISTRIBUTE_H
+#define HALIDE_DISTRIBUTE_H
+
+/** \file
+ * Defines the lowering pass that divides Funcs scheduled with
+ * Func::distribute between the ranks of a distributed pipeline.
+ */
+
+#include <map>
+#include <vector>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Restrict the loops over the distributed dimension of each
+ * distributed Func to the slice owned by the current rank, and
+ * exchange the halo of each one that other Funcs consume with the
+ * other ranks. The exchange starts as soon as the Func is computed,
+ * and is waited for just before the first use of the halo. Must be
+ * run after bounds inference and before storage flattening. */
+Stmt distribute_across_ranks(Stmt s, const std::map<std::string, Function> &env,
+                             const std::vector<Function> &outputs);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
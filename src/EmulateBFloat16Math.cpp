@@ -0,0 +1,178 @@
+#include "EmulateBFloat16Math.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::vector;
+
+Expr bfloat16_to_float32(Expr bits) {
+    Type t = bits.type();
+    internal_assert(t.element_of() == UInt(16));
+    Expr wide = cast(UInt(32, t.lanes()), std::move(bits)) << make_const(UInt(32, t.lanes()), 16);
+    return reinterpret(Float(32, t.lanes()), wide);
+}
+
+Expr float32_to_bfloat16(Expr f) {
+    Type t = f.type();
+    internal_assert(t.element_of() == Float(32));
+    Type u32 = UInt(32, t.lanes());
+    Expr bits = reinterpret(u32, std::move(f));
+    Expr sixteen = make_const(u32, 16);
+    // Round to nearest with ties going to even.
+    Expr rounded = (bits + ((bits >> sixteen) & make_one(u32)) + make_const(u32, 0x7fff)) >> sixteen;
+    // Keep the sign of NaNs, and make sure the truncated mantissa
+    // stays nonzero.
+    Expr nan = (bits & make_const(u32, 0x7fffffff)) > make_const(u32, 0x7f800000);
+    Expr quiet_nan = (bits >> sixteen) | make_const(u32, 0x40);
+    return cast(UInt(16, t.lanes()), select(nan, quiet_nan, rounded));
+}
+
+namespace {
+
+Type bits_type(Type t) {
+    return t.is_bfloat() ? UInt(16, t.lanes()) : t;
+}
+
+class LowerBFloat16Math : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // Mutate an Expr that was a bfloat, and widen it to float32.
+    Expr widen(const Expr &e) {
+        return bfloat16_to_float32(mutate(e));
+    }
+
+    template<typename T>
+    Expr visit_arithmetic(const T *op) {
+        if (!op->type.is_bfloat()) {
+            return IRMutator2::visit(op);
+        }
+        return float32_to_bfloat16(T::make(widen(op->a), widen(op->b)));
+    }
+
+    template<typename T>
+    Expr visit_comparison(const T *op) {
+        if (!op->a.type().is_bfloat()) {
+            return IRMutator2::visit(op);
+        }
+        return T::make(widen(op->a), widen(op->b));
+    }
+
+    Expr visit(const Add *op) override { return visit_arithmetic(op); }
+    Expr visit(const Sub *op) override { return visit_arithmetic(op); }
+    Expr visit(const Mul *op) override { return visit_arithmetic(op); }
+    Expr visit(const Div *op) override { return visit_arithmetic(op); }
+    Expr visit(const Mod *op) override { return visit_arithmetic(op); }
+    Expr visit(const Min *op) override { return visit_arithmetic(op); }
+    Expr visit(const Max *op) override { return visit_arithmetic(op); }
+    Expr visit(const EQ *op) override { return visit_comparison(op); }
+    Expr visit(const NE *op) override { return visit_comparison(op); }
+    Expr visit(const LT *op) override { return visit_comparison(op); }
+    Expr visit(const LE *op) override { return visit_comparison(op); }
+    Expr visit(const GT *op) override { return visit_comparison(op); }
+    Expr visit(const GE *op) override { return visit_comparison(op); }
+
+    Expr visit(const FloatImm *op) override {
+        if (!op->type.is_bfloat()) {
+            return op;
+        }
+        return make_const(UInt(16), bfloat16_t(op->value).to_bits());
+    }
+
+    Expr visit(const Variable *op) override {
+        if (!op->type.is_bfloat()) {
+            return op;
+        }
+        return Variable::make(bits_type(op->type), op->name, op->image, op->param, op->reduction_domain);
+    }
+
+    Expr visit(const Cast *op) override {
+        Type from = op->value.type();
+        if (op->type.is_bfloat()) {
+            Expr value = mutate(op->value);
+            if (from.is_bfloat()) {
+                return value;
+            }
+            return float32_to_bfloat16(cast(Float(32, from.lanes()), value));
+        } else if (from.is_bfloat()) {
+            return cast(op->type, widen(op->value));
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Expr visit(const Ramp *op) override {
+        if (!op->type.is_bfloat()) {
+            return IRMutator2::visit(op);
+        }
+        return float32_to_bfloat16(Ramp::make(widen(op->base), widen(op->stride), op->lanes));
+    }
+
+    Expr visit(const Load *op) override {
+        if (!op->type.is_bfloat()) {
+            return IRMutator2::visit(op);
+        }
+        return Load::make(bits_type(op->type), op->name, mutate(op->index),
+                          op->image, op->param, mutate(op->predicate));
+    }
+
+    Expr visit(const Call *op) override {
+        bool uses_bfloat = op->type.is_bfloat();
+        for (const Expr &e : op->args) {
+            uses_bfloat = uses_bfloat || e.type().is_bfloat();
+        }
+        if (!uses_bfloat) {
+            return IRMutator2::visit(op);
+        }
+
+        if (op->is_intrinsic(Call::reinterpret)) {
+            Expr value = mutate(op->args[0]);
+            Type t = bits_type(op->type);
+            return value.type() == t ? value : reinterpret(t, value);
+        } else if (op->is_intrinsic(Call::abs)) {
+            // Clear the sign bit.
+            Expr value = mutate(op->args[0]);
+            return value & make_const(value.type(), 0x7fff);
+        } else if (op->is_intrinsic(Call::absd) ||
+                   op->is_intrinsic(Call::lerp)) {
+            // Compute in float32.
+            vector<Expr> args;
+            for (const Expr &e : op->args) {
+                args.push_back(e.type().is_bfloat() ? widen(e) : mutate(e));
+            }
+            Type t = op->type.is_bfloat() ? Float(32, op->type.lanes()) : op->type;
+            Expr result = Call::make(t, op->name, args, op->call_type);
+            return op->type.is_bfloat() ? float32_to_bfloat16(result) : result;
+        } else {
+            // Everything else, including extern calls, just moves the
+            // bits around.
+            vector<Expr> args;
+            for (const Expr &e : op->args) {
+                args.push_back(mutate(e));
+            }
+            return Call::make(bits_type(op->type), op->name, args, op->call_type,
+                              op->func, op->value_index, op->image, op->param);
+        }
+    }
+
+    Stmt visit(const Allocate *op) override {
+        Stmt s = IRMutator2::visit(op);
+        if (!op->type.is_bfloat()) {
+            return s;
+        }
+        const Allocate *a = s.as<Allocate>();
+        internal_assert(a);
+        return Allocate::make(a->name, bits_type(a->type), a->memory_type, a->extents,
+                              a->condition, a->body, a->new_expr, a->free_function);
+    }
+};
+
+}  // namespace
+
+Stmt lower_bfloat16_math(Stmt s) {
+    return LowerBFloat16Math().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
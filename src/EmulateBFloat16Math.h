@@ -0,0 +1,34 @@
+#ifndef HALIDE_EMULATE_BFLOAT16_MATH_H
+#define HALIDE_EMULATE_BFLOAT16_MATH_H
+
+/** \file
+ * Defines the lowering pass that implements bfloat16 math with float32
+ * math and integer operations on the bits.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace all bfloat16 values with their bits, as UInt(16). Loads,
+ * stores, and selects move the bits unchanged. Arithmetic and
+ * comparisons widen their operands to float32, which is exact, and
+ * arithmetic rounds the float32 result back to the nearest bfloat16
+ * with ties going to even. Conversions are done with shifts and adds,
+ * which vectorize on every target. Backends therefore never see the
+ * bfloat type, except as the type of buffers and scalar arguments,
+ * which they treat as uint16. */
+Stmt lower_bfloat16_math(Stmt s);
+
+/** Convert the bits of a bfloat16 to a float32, or round a float32 to
+ * the bits of the nearest bfloat16. */
+// @{
+Expr bfloat16_to_float32(Expr bits);
+Expr float32_to_bfloat16(Expr f);
+// @}
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
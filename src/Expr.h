@@ -5,6 +5,7 @@
  * Base classes for Halide expressions (\ref Halide::Expr) and statements (\ref Halide::Internal::Stmt)
  */
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -69,6 +70,7 @@ enum class IRNodeType {
     IfThenElse,
     Evaluate,
     Prefetch,
+    Atomic,
 };
 
 /** The abstract base classes for a node in the Halide IR. */
@@ -82,6 +84,14 @@ struct IRNode {
     IRNode(IRNodeType t) : node_type(t) {}
     virtual ~IRNode() {}
 
+    /** IR nodes are small, numerous, and short-lived, so they are
+     * allocated from per-thread size-segregated free lists instead of
+     * going through malloc for every node. */
+    // @{
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    // @}
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
@@ -127,6 +137,12 @@ struct BaseExprNode : public IRNode {
     BaseExprNode(IRNodeType t) : IRNode(t) {}
     virtual Expr mutate_expr(IRMutator2 *v) const = 0;
     Type type;
+
+    /** A hash of the value of the expression, computed on demand by
+     * structural_hash (see IREquality.h) and then reused. Nodes are
+     * immutable, so it never goes stale. Zero means it hasn't been
+     * computed yet. */
+    mutable std::atomic<uint32_t> hash{0};
 };
 
 /** We use the "curiously recurring template pattern" to avoid
@@ -193,25 +209,10 @@ struct IRHandle : public IntrusivePtr<const IRNode> {
 struct IntImm : public ExprNode<IntImm> {
     int64_t value;
 
-    static const IntImm *make(Type t, int64_t value) {
-        internal_assert(t.is_int() && t.is_scalar())
-            << "IntImm must be a scalar Int\n";
-        internal_assert(t.bits() == 8 || t.bits() == 16 || t.bits() == 32 || t.bits() == 64)
-            << "IntImm must be 8, 16, 32, or 64-bit\n";
-
-        // Normalize the value by dropping the high bits.
-        // Since left-shift of negative value is UB in C++, cast to uint64 first;
-        // it's unlikely any compilers we care about will misbehave, but UBSan will complain.
-        value = (int64_t) (((uint64_t) value) << (64 - t.bits()));
-
-        // Then sign-extending to get them back
-        value >>= (64 - t.bits());
-
-        IntImm *node = new IntImm;
-        node->type = t;
-        node->value = value;
-        return node;
-    }
+    /** Make an integer constant. Small values of each type are
+     * interned, so the returned node may be shared with other
+     * expressions. */
+    static const IntImm *make(Type t, int64_t value);
 
     static const IRNodeType _node_type = IRNodeType::IntImm;
 };
@@ -220,21 +221,10 @@ struct IntImm : public ExprNode<IntImm> {
 struct UIntImm : public ExprNode<UIntImm> {
     uint64_t value;
 
-    static const UIntImm *make(Type t, uint64_t value) {
-        internal_assert(t.is_uint() && t.is_scalar())
-            << "UIntImm must be a scalar UInt\n";
-        internal_assert(t.bits() == 1 || t.bits() == 8 || t.bits() == 16 || t.bits() == 32 || t.bits() == 64)
-            << "UIntImm must be 1, 8, 16, 32, or 64-bit\n";
-
-        // Normalize the value by dropping the high bits
-        value <<= (64 - t.bits());
-        value >>= (64 - t.bits());
-
-        UIntImm *node = new UIntImm;
-        node->type = t;
-        node->value = value;
-        return node;
-    }
+    /** Make an unsigned integer constant. Small values of each type
+     * are interned, so the returned node may be shared with other
+     * expressions. */
+    static const UIntImm *make(Type t, uint64_t value);
 
     static const IRNodeType _node_type = IRNodeType::UIntImm;
 };
@@ -250,7 +240,11 @@ struct FloatImm : public ExprNode<FloatImm> {
         node->type = t;
         switch (t.bits()) {
         case 16:
-            node->value = (double)((float16_t)value);
+            if (t.is_bfloat()) {
+                node->value = (double)((bfloat16_t)value);
+            } else {
+                node->value = (double)((float16_t)value);
+            }
             break;
         case 32:
             node->value = (float)value;
@@ -298,17 +292,18 @@ struct Expr : public Internal::IRHandle {
 
     /** Make an expression representing numeric constants of various types. */
     // @{
-    explicit Expr(int8_t x)    : IRHandle(Internal::IntImm::make(Int(8), x)) {}
-    explicit Expr(int16_t x)   : IRHandle(Internal::IntImm::make(Int(16), x)) {}
-             Expr(int32_t x)   : IRHandle(Internal::IntImm::make(Int(32), x)) {}
-    explicit Expr(int64_t x)   : IRHandle(Internal::IntImm::make(Int(64), x)) {}
-    explicit Expr(uint8_t x)   : IRHandle(Internal::UIntImm::make(UInt(8), x)) {}
-    explicit Expr(uint16_t x)  : IRHandle(Internal::UIntImm::make(UInt(16), x)) {}
-    explicit Expr(uint32_t x)  : IRHandle(Internal::UIntImm::make(UInt(32), x)) {}
-    explicit Expr(uint64_t x)  : IRHandle(Internal::UIntImm::make(UInt(64), x)) {}
-             Expr(float16_t x) : IRHandle(Internal::FloatImm::make(Float(16), (double)x)) {}
-             Expr(float x)     : IRHandle(Internal::FloatImm::make(Float(32), x)) {}
-    explicit Expr(double x)    : IRHandle(Internal::FloatImm::make(Float(64), x)) {}
+    explicit Expr(int8_t x)     : IRHandle(Internal::IntImm::make(Int(8), x)) {}
+    explicit Expr(int16_t x)    : IRHandle(Internal::IntImm::make(Int(16), x)) {}
+             Expr(int32_t x)    : IRHandle(Internal::IntImm::make(Int(32), x)) {}
+    explicit Expr(int64_t x)    : IRHandle(Internal::IntImm::make(Int(64), x)) {}
+    explicit Expr(uint8_t x)    : IRHandle(Internal::UIntImm::make(UInt(8), x)) {}
+    explicit Expr(uint16_t x)   : IRHandle(Internal::UIntImm::make(UInt(16), x)) {}
+    explicit Expr(uint32_t x)   : IRHandle(Internal::UIntImm::make(UInt(32), x)) {}
+    explicit Expr(uint64_t x)   : IRHandle(Internal::UIntImm::make(UInt(64), x)) {}
+             Expr(float16_t x)  : IRHandle(Internal::FloatImm::make(Float(16), (double)x)) {}
+             Expr(bfloat16_t x) : IRHandle(Internal::FloatImm::make(BFloat(16), (double)x)) {}
+             Expr(float x)      : IRHandle(Internal::FloatImm::make(Float(32), x)) {}
+    explicit Expr(double x)     : IRHandle(Internal::FloatImm::make(Float(64), x)) {}
     // @}
 
     /** Make an expression representing a const string (i.e. a StringImm) */
@@ -349,6 +344,7 @@ enum class DeviceAPI {
     Hexagon,
     HexagonDma,
     D3D12Compute,
+    Vulkan,
 };
 
 /** An array containing all the device apis. Useful for iterating
@@ -363,7 +359,8 @@ const DeviceAPI all_device_apis[] = {DeviceAPI::None,
                                      DeviceAPI::Metal,
                                      DeviceAPI::Hexagon,
                                      DeviceAPI::HexagonDma,
-                                     DeviceAPI::D3D12Compute};
+                                     DeviceAPI::D3D12Compute,
+                                     DeviceAPI::Vulkan};
 
 /** An enum describing different address spaces to be used with Func::store_in. */
 enum class MemoryType {
@@ -410,12 +407,15 @@ namespace Internal {
  * any order, and multiple iterations may occur
  * simultaneously. Vectorized and GPULane are parallel and
  * synchronous: they act as if all iterations occur at the same time
- * in lockstep. */
+ * in lockstep. UnrolledAndJammed is unrolled into the loops it
+ * contains, so that its iterations are interleaved within each of
+ * their iterations. */
 enum class ForType {
     Serial,
     Parallel,
     Vectorized,
     Unrolled,
+    UnrolledAndJammed,
     Extern,
     GPUBlock,
     GPUThread,
@@ -116,6 +116,15 @@ public:
      *  generating C++ output. */
     bool is_c_plus_plus_source() const { return kind == CPlusPlusSource; }
 
+    /** True if this container holds code for a GPU or other device. */
+    bool is_device_code() const { return kind == DeviceCode; }
+
+    /** Retrieve the target of LLVM bitcode held by this container. */
+    const Target &bitcode_target() const { return llvm_target; }
+
+    /** Retrieve the device API of device code held by this container. */
+    DeviceAPI device_api() const { return device_code_kind; }
+
     /** Retrieve the bytes of external code held by this container. */
     const std::vector<uint8_t> &contents() const { return code; }
 
@@ -57,6 +57,22 @@ uint16_t float_to_half(float value) {
     return bits;
 }
 
+uint16_t float_to_bfloat(float value) {
+    uint32_t bits = reinterpret_bits<uint32_t>(value);
+    if (std::isnan(value)) {
+        // Keep the sign, and make sure the truncated mantissa stays
+        // nonzero.
+        return (bits >> 16) | 0x40;
+    }
+    // Round to nearest with ties going to even.
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return bits >> 16;
+}
+
+float bfloat_to_float(uint16_t value) {
+    return reinterpret_bits<float>((uint32_t)value << 16);
+}
+
 float half_to_float(const uint16_t& value) {
     // There aren't all that many float16_t values, so a few lookup tables suffice.
     static const uint32_t mantissa_table[2048] = {
@@ -429,4 +445,50 @@ uint16_t float16_t::to_bits() const {
     return data;
 }
 
+bfloat16_t::bfloat16_t(float value) : data(float_to_bfloat(value)) {}
+
+bfloat16_t::bfloat16_t(double value) : data(float_to_bfloat((float)value)) {}
+
+bfloat16_t::bfloat16_t(int value) : data(float_to_bfloat((float)value)) {}
+
+bfloat16_t::bfloat16_t() : data(0) {}
+
+bfloat16_t::operator float() const {
+    return bfloat_to_float(data);
+}
+
+bfloat16_t::operator double() const {
+    return bfloat_to_float(data);
+}
+
+bfloat16_t bfloat16_t::make_from_bits(uint16_t bits) {
+    bfloat16_t f;
+    f.data = bits;
+    return f;
+}
+
+bfloat16_t bfloat16_t::operator-() const {
+    return make_from_bits(data ^ sign_mask);
+}
+
+bfloat16_t bfloat16_t::operator+(bfloat16_t rhs) const {
+    return bfloat16_t(bfloat_to_float(data) + bfloat_to_float(rhs.data));
+}
+
+bfloat16_t bfloat16_t::operator-(bfloat16_t rhs) const {
+    return bfloat16_t(bfloat_to_float(data) - bfloat_to_float(rhs.data));
+}
+
+bfloat16_t bfloat16_t::operator*(bfloat16_t rhs) const {
+    return bfloat16_t(bfloat_to_float(data) * bfloat_to_float(rhs.data));
+}
+
+bfloat16_t bfloat16_t::operator/(bfloat16_t rhs) const {
+    return bfloat16_t(bfloat_to_float(data) / bfloat_to_float(rhs.data));
+}
+
+uint16_t bfloat16_t::to_bits() const {
+    return data;
+}
+
 }  // namespace Halide
@@ -117,6 +117,71 @@ private:
 
 static_assert(sizeof(float16_t) == 2, "float16_t should occupy two bytes");
 
+/** Class that provides a type that implements bfloat16 floating point
+ * in software. A bfloat16 is a float32 with the low 16 bits of the
+ * mantissa dropped, so it has the range of a float32 with less
+ * precision.
+ *
+ * Like float16_t, this type holds nothing but the raw bits, so that
+ * it can be used as the element type of buffers.
+ */
+struct bfloat16_t {
+
+    /** Construct from a float, double, or int using
+     * round-to-nearest-ties-to-even. Doubles are first rounded to
+     * float. */
+    // @{
+    explicit bfloat16_t(float value);
+    explicit bfloat16_t(double value);
+    explicit bfloat16_t(int value);
+    // @}
+
+    /** Construct a bfloat16_t with the bits initialised to 0. This
+     * represents positive zero. */
+    bfloat16_t();
+
+    /** Cast to float or double. Both are exact. */
+    // @{
+    explicit operator float() const;
+    explicit operator double() const;
+    // @}
+
+    bfloat16_t(const bfloat16_t&) = default;
+    bfloat16_t& operator=(const bfloat16_t&) = default;
+
+    /** Get a new bfloat16_t with the given raw bits. */
+    static bfloat16_t make_from_bits(uint16_t bits);
+
+    /** Arithmetic operators. These compute in float and round the
+     * result. */
+    // @{
+    bfloat16_t operator-() const;
+    bfloat16_t operator+(bfloat16_t rhs) const;
+    bfloat16_t operator-(bfloat16_t rhs) const;
+    bfloat16_t operator*(bfloat16_t rhs) const;
+    bfloat16_t operator/(bfloat16_t rhs) const;
+    // @}
+
+    /** Comparison operators */
+    // @{
+    bool operator==(bfloat16_t rhs) const { return (float)(*this) == (float)rhs; }
+    bool operator!=(bfloat16_t rhs) const { return !(*this == rhs); }
+    bool operator>(bfloat16_t rhs) const { return (float)(*this) > (float)rhs; }
+    bool operator<(bfloat16_t rhs) const { return (float)(*this) < (float)rhs; }
+    bool operator>=(bfloat16_t rhs) const { return (float)(*this) >= (float)rhs; }
+    bool operator<=(bfloat16_t rhs) const { return (float)(*this) <= (float)rhs; }
+    // @}
+
+    /** Returns the bits that represent this bfloat16_t. */
+    uint16_t to_bits() const;
+
+private:
+    // The raw bits.
+    uint16_t data;
+};
+
+static_assert(sizeof(bfloat16_t) == 2, "bfloat16_t should occupy two bytes");
+
 }  // namespace Halide
 
 template<>
@@ -124,4 +189,9 @@ HALIDE_ALWAYS_INLINE halide_type_t halide_type_of<Halide::float16_t>() {
     return halide_type_t(halide_type_float, 16);
 }
 
+template<>
+HALIDE_ALWAYS_INLINE halide_type_t halide_type_of<Halide::bfloat16_t>() {
+    return halide_type_t(halide_type_bfloat, 16);
+}
+
 #endif
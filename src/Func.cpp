@@ -26,6 +26,7 @@
 #include "Outputs.h"
 #include "Param.h"
 #include "PrintLoopNest.h"
+#include "SelectVectorWidths.h"
 #include "Simplify.h"
 #include "Solve.h"
 #include "Substitute.h"
@@ -278,6 +279,53 @@ std::string Stage::name() const {
     return stage_name;
 }
 
+bool Stage::is_warp_reduction() const {
+    // Lanes of a warp that all update the same location with an
+    // associative and commutative operator are lowered to a tree of
+    // warp shuffles rather than racing. See lower_warp_reductions.
+    if (definition.values().size() != 1) {
+        return false;
+    }
+    for (const Expr &arg : definition.args()) {
+        for (const ReductionVariable &rv : definition.schedule().rvars()) {
+            if (expr_uses_var(arg, rv.var)) {
+                return false;
+            }
+        }
+    }
+    Expr value = definition.values()[0];
+    Expr a, b;
+    if (const Add *op = value.as<Add>()) {
+        a = op->a;
+        b = op->b;
+    } else if (const Mul *op = value.as<Mul>()) {
+        a = op->a;
+        b = op->b;
+    } else if (const Min *op = value.as<Min>()) {
+        a = op->a;
+        b = op->b;
+    } else if (const Max *op = value.as<Max>()) {
+        a = op->a;
+        b = op->b;
+    } else {
+        return false;
+    }
+    auto is_self = [&](const Expr &e) {
+        const Call *call = e.as<Call>();
+        if (!call || call->call_type != Call::Halide || call->name != function.name() ||
+            call->args.size() != definition.args().size()) {
+            return false;
+        }
+        for (size_t i = 0; i < call->args.size(); i++) {
+            if (!equal(call->args[i], definition.args()[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return is_self(a) || is_self(b);
+}
+
 void Stage::set_dim_type(VarOrRVar var, ForType t) {
     bool found = false;
     vector<Dim> &dims = definition.schedule().dims();
@@ -292,7 +340,9 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
                 (t == ForType::Vectorized || t == ForType::Parallel ||
                  t == ForType::GPUBlock || t == ForType::GPUThread ||
                  t == ForType::GPULane)) {
-                user_assert(definition.schedule().allow_race_conditions())
+                user_assert(definition.schedule().allow_race_conditions() ||
+                            (definition.schedule().atomic() && t != ForType::Vectorized) ||
+                            (t == ForType::GPULane && is_warp_reduction()))
                     << "In schedule for " << name()
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
@@ -303,7 +353,11 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
                     << " to accept non-deterministic output, or you can prove"
                     << " that any race conditions in this code do not change"
                     << " the output, or you can prove that there are actually"
-                    << " no race conditions, and that Halide is being too cautious.\n";
+                    << " no race conditions, and that Halide is being too cautious."
+                    << " If the update is an associative reduction, use"
+                    << " parallel_reduce() or atomic() to parallelize it without a race condition,"
+                    << " or on CUDA, gpu_lanes() if it is a sum, product, min, or max"
+                    << " into a location that does not depend on the reduction domain.\n";
             }
 
         } else if (t == ForType::Vectorized) {
@@ -889,6 +943,45 @@ Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     return intm;
 }
 
+Func Stage::parallel_reduce(RVar r, Expr partials) {
+    user_assert(!definition.is_init()) << "parallel_reduce() must be called on an update definition\n";
+    if (!partials.defined()) {
+        partials = 16;
+    }
+
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    const auto &iter = std::find_if(rvars.begin(), rvars.end(),
+        [&r](const ReductionVariable &rv) { return var_name_match(rv.var, r.name()); });
+    user_assert(iter != rvars.end())
+        << "In schedule for " << name()
+        << ", can't perform parallel_reduce() on " << r.name()
+        << " since it is not an unsplit dimension of the reduction domain\n"
+        << dump_argument_list();
+
+    // Give each partial result a contiguous slice of r, and compute
+    // them in parallel.
+    RVar ro, ri;
+    Var u;
+    split(r, ro, ri, (iter->extent + partials - 1) / partials, TailStrategy::GuardWithIf);
+    Func intm = rfactor(ro, u);
+    intm.compute_root().parallel(u);
+
+    // Make the partial results the outermost loop of the
+    // intermediate's update, so that there's one parallel loop
+    // rather than one per value of the pure vars outside it.
+    Stage intm_update = intm.update(0);
+    vector<VarOrRVar> order;
+    for (const Dim &d : intm_update.get_schedule().dims()) {
+        if (d.var != Var::outermost().name() && !var_name_match(d.var, u.name())) {
+            order.push_back(d.is_rvar() ? VarOrRVar(RVar(d.var)) : VarOrRVar(Var(d.var)));
+        }
+    }
+    order.push_back(u);
+    intm_update.reorder(order).parallel(u);
+
+    return intm;
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, Expr factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << name() << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -1030,9 +1123,9 @@ void Stage::split(const string &old, const string &outer, const string &inner, E
     }
 
     if (exact) {
-        user_assert(tail == TailStrategy::GuardWithIf)
+        user_assert(tail == TailStrategy::GuardWithIf || tail == TailStrategy::Predicate)
             << "When splitting Var " << old_name
-            << " the tail strategy must be GuardWithIf or Auto. "
+            << " the tail strategy must be GuardWithIf, Predicate or Auto. "
             << "Anything else may change the meaning of the algorithm\n";
     }
 
@@ -1407,6 +1500,26 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+Stage &Stage::atomic(bool override_associativity_test) {
+    user_assert(!definition.is_init()) << "atomic() must be called on an update definition\n";
+    user_assert(definition.values().size() == 1)
+        << "In schedule for " << name()
+        << ", atomic() can't be used on an update of a Tuple-valued Func\n";
+
+    if (!override_associativity_test) {
+        const auto &prover_result = prove_associativity(function.name(), definition.args(), definition.values());
+        user_assert(prover_result.associative() && prover_result.commutative())
+            << "In schedule for " << name()
+            << ", can't perform the update atomically, since it can't"
+            << " prove that the operator is associative and commutative."
+            << " Use atomic(true) to override this check if you are sure"
+            << " that the update may be applied in any order.\n";
+    }
+
+    definition.schedule().atomic() = true;
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1427,6 +1540,11 @@ Stage &Stage::unroll(VarOrRVar var) {
     return *this;
 }
 
+Stage &Stage::unroll_and_jam(VarOrRVar var) {
+    set_dim_type(var, ForType::UnrolledAndJammed);
+    return *this;
+}
+
 Stage &Stage::parallel(VarOrRVar var, Expr factor, TailStrategy tail) {
     if (var.is_rvar) {
         RVar tmp;
@@ -1452,6 +1570,10 @@ Stage &Stage::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::vectorize_natural(VarOrRVar var, TailStrategy tail) {
+    return vectorize(var, natural_vector_width_placeholder(), tail);
+}
+
 Stage &Stage::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     if (var.is_rvar) {
         RVar tmp;
@@ -1466,6 +1588,20 @@ Stage &Stage::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::unroll_and_jam(VarOrRVar var, Expr factor, TailStrategy tail) {
+    if (var.is_rvar) {
+        RVar tmp;
+        split(var.rvar, var.rvar, tmp, factor, tail);
+        unroll_and_jam(tmp);
+    } else {
+        Var tmp;
+        split(var.var, var.var, tmp, factor, tail);
+        unroll_and_jam(tmp);
+    }
+
+    return *this;
+}
+
 Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
                    VarOrRVar xo, VarOrRVar yo,
                    VarOrRVar xi, VarOrRVar yi,
@@ -1487,6 +1623,37 @@ Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
     return *this;
 }
 
+Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
+                   VarOrRVar xo, VarOrRVar yo,
+                   VarOrRVar xi, VarOrRVar yi,
+                   AutoTileSize size,
+                   TailStrategy tail) {
+    user_assert(size.max_redundancy >= 0)
+        << "In schedule for " << name() << ", the redundant work allowed by an AutoTileSize can't be negative.\n";
+    user_assert(size.cache_level >= 1 && size.cache_level <= 3)
+        << "In schedule for " << name() << ", the cache level of an AutoTileSize must be 1, 2, or 3.\n";
+
+    // Stand in for the tile sizes with variables until they are
+    // picked during lowering.
+    string prefix = function.name() + ".s" + std::to_string(stage_index) + ".";
+    AutoTile t;
+    t.x_size = prefix + x.name() + ".auto_tile_size";
+    t.y_size = prefix + y.name() + ".auto_tile_size";
+    t.tile_var = xo.name();
+    t.size = size;
+    tile(x, y, xo, yo, xi, yi,
+         Variable::make(Int(32), t.x_size), Variable::make(Int(32), t.y_size), tail);
+    definition.schedule().auto_tiles().push_back(t);
+    return *this;
+}
+
+Stage &Stage::tile(VarOrRVar x, VarOrRVar y,
+                   VarOrRVar xi, VarOrRVar yi,
+                   AutoTileSize size,
+                   TailStrategy tail) {
+    return tile(x, y, x, y, xi, yi, size, tail);
+}
+
 Stage &Stage::reorder(const std::vector<VarOrRVar>& vars) {
     const string &func_name = function.name();
     vector<Expr> &args = definition.args();
@@ -1714,6 +1881,76 @@ Stage &Stage::gpu_tile(VarOrRVar x, VarOrRVar y, VarOrRVar z,
     return gpu_tile(x, y, z, x, y, z, tx, ty, tz, x_size, y_size, z_size, tail, device_api);
 }
 
+Stage &Stage::gpu_launch_bounds(int max_threads, int min_blocks_per_sm) {
+    user_assert(max_threads >= 0 && min_blocks_per_sm >= 0)
+        << "In schedule for " << name()
+        << ", gpu_launch_bounds() requires non-negative bounds\n";
+    definition.schedule().gpu_max_threads() = max_threads;
+    definition.schedule().gpu_min_blocks_per_sm() = min_blocks_per_sm;
+    return *this;
+}
+
+Stage &Stage::hetero_split(VarOrRVar var, Expr device_fraction) {
+    const vector<Dim> &dims = definition.schedule().dims();
+    string var_name;
+    for (const Dim &d : dims) {
+        if (var_name_match(d.var, var.name())) {
+            var_name = d.var;
+        }
+    }
+    user_assert(!var_name.empty())
+        << "In schedule for " << name()
+        << ", could not find dimension " << var.name()
+        << " to split between the device and the host in vars for function\n"
+        << dump_argument_list();
+    user_assert(!device_fraction.defined() || device_fraction.type().is_scalar())
+        << "In schedule for " << name()
+        << ", the device fraction of hetero_split() must be a scalar\n";
+    definition.schedule().hetero_split_var() = var_name;
+    if (device_fraction.defined()) {
+        device_fraction = cast<float>(device_fraction);
+    }
+    definition.schedule().hetero_split_fraction() = device_fraction;
+    return *this;
+}
+
+Stage &Stage::gpu_multi_device(VarOrRVar var) {
+    const vector<Dim> &dims = definition.schedule().dims();
+    string var_name;
+    for (const Dim &d : dims) {
+        if (var_name_match(d.var, var.name())) {
+            var_name = d.var;
+        }
+    }
+    user_assert(!var_name.empty())
+        << "In schedule for " << name()
+        << ", could not find dimension " << var.name()
+        << " to distribute across GPUs in vars for function\n"
+        << dump_argument_list();
+    definition.schedule().gpu_multi_device_var() = var_name;
+    return *this;
+}
+
+Stage &Stage::skip_tiles_where(VarOrRVar tile, Expr condition) {
+    user_assert(condition.defined() && condition.type().is_bool() && condition.type().is_scalar())
+        << "In schedule for " << name()
+        << ", the condition passed to skip_tiles_where must be a scalar boolean\n";
+    const vector<Dim> &dims = definition.schedule().dims();
+    string var_name;
+    for (const Dim &d : dims) {
+        if (var_name_match(d.var, tile.name())) {
+            var_name = d.var;
+        }
+    }
+    user_assert(!var_name.empty())
+        << "In schedule for " << name()
+        << ", could not find dimension " << tile.name()
+        << " to skip tiles of in vars for function\n"
+        << dump_argument_list();
+    definition.schedule().skip_tiles().push_back({var_name, condition});
+    return *this;
+}
+
 Stage &Stage::hexagon(VarOrRVar x) {
     set_dim_device_api(x, DeviceAPI::Hexagon);
     return *this;
@@ -1982,9 +2219,10 @@ Func &Func::allow_race_conditions() {
     return *this;
 }
 
-Func &Func::memoize() {
+Func &Func::memoize(MemoizeKey key) {
     invalidate_cache();
     func.schedule().memoized() = true;
+    func.schedule().memoize_key() = key;
     return *this;
 }
 
@@ -2000,6 +2238,49 @@ Func &Func::async() {
     return *this;
 }
 
+Func &Func::code_size_budget(int instructions) {
+    invalidate_cache();
+    user_assert(instructions > 0)
+        << "The code size budget of Func " << name() << " must be positive.\n";
+    func.schedule().code_size_budget() = instructions;
+    return *this;
+}
+
+Func &Func::store_in_place_of(const Func &producer) {
+    invalidate_cache();
+    user_assert(producer.name() != name())
+        << "Func " << name() << " cannot be stored in place of itself.\n";
+    func.schedule().in_place_of() = producer.name();
+    return *this;
+}
+
+Func &Func::store_in_place_of(const ImageParam &input) {
+    invalidate_cache();
+    func.schedule().in_place_of() = input.name();
+    return *this;
+}
+
+Func &Func::store_nontemporal() {
+    invalidate_cache();
+    func.schedule().store_nontemporal() = true;
+    return *this;
+}
+
+Func &Func::store_packed(int bits) {
+    user_assert(bits == 1 || bits == 2 || bits == 4)
+        << "Can't pack the elements of " << name() << " into " << bits
+        << " bits. Only 1, 2, and 4 bits are supported.\n";
+    invalidate_cache();
+    func.schedule().packed_bits() = bits;
+    return *this;
+}
+
+Func &Func::store_interleaved() {
+    invalidate_cache();
+    func.schedule().store_interleaved() = true;
+    return *this;
+}
+
 Stage Func::specialize(Expr c) {
     invalidate_cache();
     return Stage(func, func.definition(), 0, args()).specialize(c);
@@ -2046,12 +2327,30 @@ Func &Func::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Func &Func::vectorize_natural(VarOrRVar var, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).vectorize_natural(var, tail);
+    return *this;
+}
+
 Func &Func::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     invalidate_cache();
     Stage(func, func.definition(), 0, args()).unroll(var, factor, tail);
     return *this;
 }
 
+Func &Func::unroll_and_jam(VarOrRVar var) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).unroll_and_jam(var);
+    return *this;
+}
+
+Func &Func::unroll_and_jam(VarOrRVar var, Expr factor, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).unroll_and_jam(var, factor, tail);
+    return *this;
+}
+
 Func &Func::bound(Var var, Expr min, Expr extent) {
     user_assert(!min.defined() || Int(32).can_represent(min.type())) << "Can't represent min bound in int32\n";
     user_assert(extent.defined()) << "Extent bound of a Func can't be undefined\n";
@@ -2164,6 +2463,25 @@ Func &Func::tile(VarOrRVar x, VarOrRVar y,
     return *this;
 }
 
+Func &Func::tile(VarOrRVar x, VarOrRVar y,
+                 VarOrRVar xo, VarOrRVar yo,
+                 VarOrRVar xi, VarOrRVar yi,
+                 AutoTileSize size,
+                 TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).tile(x, y, xo, yo, xi, yi, size, tail);
+    return *this;
+}
+
+Func &Func::tile(VarOrRVar x, VarOrRVar y,
+                 VarOrRVar xi, VarOrRVar yi,
+                 AutoTileSize size,
+                 TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).tile(x, y, xi, yi, size, tail);
+    return *this;
+}
+
 Func &Func::reorder(const std::vector<VarOrRVar> &vars) {
     invalidate_cache();
     Stage(func, func.definition(), 0, args()).reorder(vars);
@@ -2294,6 +2612,12 @@ Func &Func::gpu_tile(VarOrRVar x, VarOrRVar y, VarOrRVar z,
     return *this;
 }
 
+Func &Func::gpu_launch_bounds(int max_threads, int min_blocks_per_sm) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).gpu_launch_bounds(max_threads, min_blocks_per_sm);
+    return *this;
+}
+
 Func &Func::shader(Var x, Var y, Var c, DeviceAPI device_api) {
     invalidate_cache();
 
@@ -2323,6 +2647,24 @@ Func &Func::glsl(Var x, Var y, Var c) {
     return shader(x, y, c, DeviceAPI::GLSL).vectorize(c);
 }
 
+Func &Func::gpu_multi_device(VarOrRVar var) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).gpu_multi_device(var);
+    return *this;
+}
+
+Func &Func::hetero_split(VarOrRVar var, Expr device_fraction) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).hetero_split(var, device_fraction);
+    return *this;
+}
+
+Func &Func::skip_tiles_where(VarOrRVar tile, Expr condition) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).skip_tiles_where(tile, condition);
+    return *this;
+}
+
 Func &Func::hexagon(VarOrRVar x) {
     invalidate_cache();
     Stage(func, func.definition(), 0, args()).hexagon(x);
@@ -2395,6 +2737,43 @@ Func &Func::align_storage(Var dim, Expr alignment) {
     return *this;
 }
 
+Func &Func::store_tiled(Var x, Var y, int tile_x, int tile_y, bool morton) {
+    user_assert(tile_x > 0 && tile_y > 0)
+        << "Tile sizes for store_tiled must be positive.\n";
+    if (morton) {
+        user_assert(tile_x == tile_y && (tile_x & (tile_x - 1)) == 0 && tile_x <= 32768)
+            << "Morton order storage requires square tiles with a power of two size of at most 32768, "
+            << "but the tile size of " << name() << " is " << tile_x << "x" << tile_y << ".\n";
+    }
+
+    invalidate_cache();
+
+    // Make x and y the innermost storage dimensions, in that order.
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    const Var vars[] = {x, y};
+    for (size_t i = 0; i < 2; i++) {
+        size_t loc = i;
+        while (loc < dims.size() && !var_name_match(dims[loc].var, vars[i].name())) {
+            loc++;
+        }
+        user_assert(loc < dims.size())
+            << "Could not find variable " << vars[i].name()
+            << " to tile the storage of.\n";
+        StorageDim d = dims[loc];
+        dims.erase(dims.begin() + loc);
+        dims.insert(dims.begin() + i, d);
+    }
+
+    for (StorageDim &d : dims) {
+        d.tile_extent = 0;
+        d.morton = false;
+    }
+    dims[0].tile_extent = tile_x;
+    dims[1].tile_extent = tile_y;
+    dims[0].morton = dims[1].morton = morton;
+    return *this;
+}
+
 Func &Func::fold_storage(Var dim, Expr factor, bool fold_forward) {
     invalidate_cache();
 
@@ -2476,6 +2855,42 @@ Func &Func::store_root() {
     return store_at(LoopLevel::root());
 }
 
+Func &Func::slide_in_strips(Expr strip_size) {
+    invalidate_cache();
+    user_assert(strip_size.defined() && strip_size.type().is_int())
+        << "The strip size for " << name() << " must be an integer.\n";
+    func.schedule().strip_size() = strip_size;
+    return *this;
+}
+
+Func &Func::distribute(Var var) {
+    invalidate_cache();
+    const vector<string> &pure_args = func.args();
+    user_assert(std::find(pure_args.begin(), pure_args.end(), var.name()) != pure_args.end())
+        << "Can't distribute " << name() << " over " << var.name()
+        << ", because it isn't one of its pure dimensions.\n";
+    user_assert(func.outputs() == 1)
+        << "Can't distribute " << name() << ", because it has more than one value.\n";
+    func.schedule().distributed_var() = var.name();
+    return *this;
+}
+
+Func &Func::temporal_block(Var x, Var y, int tile_x, int tile_y) {
+    invalidate_cache();
+    const vector<string> &pure_args = func.args();
+    for (const Var &v : {x, y}) {
+        user_assert(std::find(pure_args.begin(), pure_args.end(), v.name()) != pure_args.end())
+            << "Can't temporally block " << name() << " over " << v.name()
+            << ", because it isn't one of its pure dimensions.\n";
+    }
+    user_assert(x.name() != y.name())
+        << "Can't temporally block " << name() << " over " << x.name() << " twice.\n";
+    user_assert(tile_x > 0 && tile_y > 0)
+        << "The tile sizes for temporally blocking " << name() << " must be positive.\n";
+    func.schedule().temporal_block() = {{x.name(), tile_x}, {y.name(), tile_y}};
+    return *this;
+}
+
 Func &Func::compute_inline() {
     return compute_at(LoopLevel::inlined());
 }
@@ -3032,6 +3447,10 @@ void Func::print_loop_nest() {
     pipeline().print_loop_nest();
 }
 
+void Func::print_redundant_work() {
+    pipeline().print_redundant_work();
+}
+
 void Func::compile_to_file(const string &filename_prefix,
                            const vector<Argument> &args,
                            const std::string &fn_name,
@@ -3118,6 +3537,10 @@ void *Func::compile_jit(const Target &target) {
     return pipeline().compile_jit(target);
 }
 
+Callable Func::compile_to_callable(const vector<Argument> &args, const Target &target) {
+    return pipeline().compile_to_callable(args, target);
+}
+
 Var _("_");
 Var _0("_0"), _1("_1"), _2("_2"), _3("_3"), _4("_4"),
            _5("_5"), _6("_6"), _7("_7"), _8("_8"), _9("_9");
@@ -63,6 +63,7 @@ class Stage {
     std::vector<Var> dim_vars;
 
     void set_dim_type(VarOrRVar var, Internal::ForType t);
+    bool is_warp_reduction() const;
     void set_dim_device_api(VarOrRVar var, DeviceAPI device_api);
     void split(const std::string &old, const std::string &outer, const std::string &inner,
                Expr factor, bool exact, TailStrategy tail);
@@ -182,6 +183,33 @@ public:
     Func rfactor(RVar r, Var v);
     // @}
 
+    /** Parallelize an associative update definition over the RVar r
+     * without a race condition. r is split into a number of slices
+     * given by 'partials' (16 by default, which should be at least the
+     * number of threads), and rfactor() computes a partial result per
+     * slice, in parallel, in a new compute_root intermediate Func,
+     * which is returned. This update definition then combines the
+     * partial results. r must be an unsplit dimension of the reduction
+     * domain. For example, a histogram:
+     \code
+     hist(x) = 0;
+     hist(im(r.x, r.y)) += 1;
+     hist.update(0).parallel_reduce(r.y);
+     \endcode
+     * is equivalent to:
+     \code
+     RVar ryo, ryi;
+     Var u;
+     hist.update(0).split(r.y, ryo, ryi, (im.height() + 15) / 16, TailStrategy::GuardWithIf);
+     Func intm = hist.update(0).rfactor(ryo, u);
+     intm.compute_root().parallel(u);
+     intm.update(0).reorder(r.x, ryi, u).parallel(u);
+     \endcode
+     * Throws an error if the update can't be proven associative. If
+     * the operator is associative but not commutative, r must be the
+     * outermost RVar. */
+    Func parallel_reduce(RVar r, Expr partials = Expr());
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -341,7 +369,10 @@ public:
     Stage &unroll(VarOrRVar var);
     Stage &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
     Stage &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &vectorize_natural(VarOrRVar var, TailStrategy tail = TailStrategy::Auto);
     Stage &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &unroll_and_jam(VarOrRVar var);
+    Stage &unroll_and_jam(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
     Stage &tile(VarOrRVar x, VarOrRVar y,
                 VarOrRVar xo, VarOrRVar yo,
                 VarOrRVar xi, VarOrRVar yi, Expr
@@ -351,6 +382,15 @@ public:
                 VarOrRVar xi, VarOrRVar yi,
                 Expr xfactor, Expr yfactor,
                 TailStrategy tail = TailStrategy::Auto);
+    Stage &tile(VarOrRVar x, VarOrRVar y,
+                VarOrRVar xo, VarOrRVar yo,
+                VarOrRVar xi, VarOrRVar yi,
+                AutoTileSize size,
+                TailStrategy tail = TailStrategy::Auto);
+    Stage &tile(VarOrRVar x, VarOrRVar y,
+                VarOrRVar xi, VarOrRVar yi,
+                AutoTileSize size,
+                TailStrategy tail = TailStrategy::Auto);
     Stage &reorder(const std::vector<VarOrRVar> &vars);
 
     template <typename... Args>
@@ -416,8 +456,38 @@ public:
                     TailStrategy tail = TailStrategy::Auto,
                     DeviceAPI device_api = DeviceAPI::Default_GPU);
 
+    Stage &gpu_launch_bounds(int max_threads, int min_blocks_per_sm = 0);
+
+    Stage &hetero_split(VarOrRVar var, Expr device_fraction = Expr());
+
+    Stage &gpu_multi_device(VarOrRVar var);
+
+    Stage &skip_tiles_where(VarOrRVar tile, Expr condition);
+
     Stage &allow_race_conditions();
 
+    /** Perform the stores of this update definition as atomic
+     * read-modify-write operations, so that its RVars may be
+     * parallelized even when several iterations update the same
+     * location, as in a histogram:
+     \code
+     hist(x) = 0;
+     hist(im(r.x, r.y)) += 1;
+     hist.update(0).atomic().parallel(r.y);
+     \endcode
+     * Integer sums, mins and maxes become single atomic instructions,
+     * and other updates a compare-and-swap loop. This is cheap when
+     * updates to the same location from different threads are rare;
+     * when they are common, parallel_reduce() is faster, as it gives
+     * each thread private partial results instead.
+     *
+     * The update must be to a single value, and the operator must be
+     * provably associative and commutative, unless
+     * override_associativity_test is true. Must be called before the
+     * RVars are parallelized. Vectorizing over RVars of an atomic
+     * update is not supported. */
+    Stage &atomic(bool override_associativity_test = false);
+
     Stage &hexagon(VarOrRVar x = Var::outermost());
     Stage &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
                            PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
@@ -895,6 +965,15 @@ public:
      * doing. */
     void print_loop_nest();
 
+    /** Write out how much of the work of each Func computed at a loop
+     * of its consumer is redundant, because neighboring iterations of
+     * the loop compute some of the same points of it, along with the
+     * working set of an iteration, and the tile sizes picked for the
+     * tiles with an AutoTileSize. The footprints are found by bounds
+     * inference, for the estimated sizes of the Funcs where a
+     * dimension isn't split. */
+    void print_redundant_work();
+
     /** Compile to object file and header pair, with the given
      * arguments. The name defaults to the same name as this halide
      * function.
@@ -946,6 +1025,12 @@ public:
      */
     void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Jit compile the function to a Callable that takes the given
+     * arguments, followed by the output buffers. See
+     * Pipeline::compile_to_callable. */
+    Callable compile_to_callable(const std::vector<Argument> &args,
+                                 const Target &target = get_jit_target_from_environment());
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -1441,12 +1526,41 @@ public:
      * split. 'factor' must be an integer. */
     Func &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Split a dimension by a factor chosen during lowering, then
+     * vectorize the inner dimension. The factor is picked per loop
+     * from the narrowest and widest types computed in it: it is the
+     * natural vector width of the narrowest type, capped at four
+     * native vectors of the widest. This keeps pipelines that widen
+     * narrow inputs (e.g. uint8 loads summed into int32) from either
+     * wasting most of each narrow vector or spilling the wide
+     * ones. After this call, var refers to the outer dimension of the
+     * split. */
+    Func &vectorize_natural(VarOrRVar var, TailStrategy tail = TailStrategy::Auto);
+
     /** Split a dimension by the given factor, then unroll the inner
      * dimension. This is how you unroll a loop of unknown size by
      * some constant factor. After this call, var refers to the outer
      * dimension of the split. 'factor' must be an integer. */
     Func &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Mark a dimension to be unrolled and jammed: completely unrolled,
+     * with the copies of its body fused into the innermost of the
+     * loops inside it, rather than each running those loops in
+     * turn. E.g. for a stencil over rows, unrolling and jamming y by
+     * two computes two rows in each iteration of the loop over x, so
+     * that the loads the rows share are only done once. The dimension
+     * should have constant extent. The loops inside it must be serial,
+     * vectorized or unrolled, no other Func may be computed inside it,
+     * and if it is an RVar, it can't be jammed through other RVars
+     * unless the update is associative and commutative. */
+    Func &unroll_and_jam(VarOrRVar var);
+
+    /** Split a dimension by the given factor, then unroll and jam the
+     * inner dimension. This is how to block the rows of a loop nest in
+     * registers. After this call, var refers to the outer dimension of
+     * the split. 'factor' must be an integer. */
+    Func &unroll_and_jam(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+
     /** Statically declare that the range over which a function should
      * be evaluated is given by the second and third arguments. This
      * can let Halide perform some optimizations. E.g. if you know
@@ -1499,6 +1613,31 @@ public:
                Expr xfactor, Expr yfactor,
                TailStrategy tail = TailStrategy::Auto);
 
+    /** Tile two dimensions, with tile sizes that are picked when the
+     * pipeline is lowered. The Funcs computed at xo are computed once
+     * per tile, and redo some of their work at the borders between
+     * tiles. The tiles are made just large enough that this redundant
+     * work stays within the budget of the AutoTileSize, as long as the
+     * Funcs computed per tile still fit in its cache level:
+     *
+     \code
+     blur_x.compute_at(blur_y, xo);
+     blur_y.tile(x, y, xo, yo, xi, yi, AutoTileSize(0.05f));
+     \endcode
+     *
+     * Use print_redundant_work to see the sizes picked. */
+    // @{
+    Func &tile(VarOrRVar x, VarOrRVar y,
+               VarOrRVar xo, VarOrRVar yo,
+               VarOrRVar xi, VarOrRVar yi,
+               AutoTileSize size,
+               TailStrategy tail = TailStrategy::Auto);
+    Func &tile(VarOrRVar x, VarOrRVar y,
+               VarOrRVar xi, VarOrRVar yi,
+               AutoTileSize size,
+               TailStrategy tail = TailStrategy::Auto);
+    // @}
+
     /** Reorder variables to have the given nesting order, from
      * innermost out */
     Func &reorder(const std::vector<VarOrRVar> &vars);
@@ -1746,7 +1885,32 @@ public:
      * warp. GPU warp lanes are distinguished from GPU threads by the
      * fact that all warp lanes run together in lockstep, which
      * permits lightweight communication of data from one lane to
-     * another. */
+     * another.
+     *
+     * On CUDA, an update that sums, multiplies, or takes the min or
+     * max of a term into a location that does not depend on the
+     * reduction domain may mark an RVar as gpu_lanes without
+     * allow_race_conditions(). The lanes each compute a term, the
+     * terms are combined with a tree of warp shuffles, and one lane
+     * performs the update. Combined with rfactor(), this gives a
+     * reduction over a whole row in registers. For example, to sum
+     * each row of a 2D image with one warp per row:
+     \code
+     out(y) = 0.0f;
+     out(y) += in(r, y);
+     RVar ro, ri;
+     Var u;
+     out.update().split(r, ro, ri, 32);
+     Func intm = out.update().rfactor(ri, u);
+     out.update().gpu_blocks(y).gpu_lanes(ri);
+     intm.compute_at(out, y).gpu_lanes(u);
+     intm.update().gpu_lanes(u);
+     \endcode
+     * The warp-level partial sums in intm never leave registers. A
+     * block-level reduction over several warps rfactors once more,
+     * giving a per-warp intermediate stored in shared memory,
+     * computed with gpu_threads over the warps and gpu_lanes within
+     * them, which a final gpu_lanes reduction then combines. */
     Func &gpu_lanes(VarOrRVar thread_x, DeviceAPI device_api = DeviceAPI::Default_GPU);
 
     /** Tell Halide to run this stage using a single gpu thread and
@@ -1816,6 +1980,81 @@ public:
                    DeviceAPI device_api = DeviceAPI::Default_GPU);
     // @}
 
+    /** Give the CUDA compiler launch bounds for the kernel this
+     * stage's gpu_blocks() loops start: the most threads per block
+     * it will run with, and the fewest blocks that should fit on one
+     * multiprocessor at once. The compiler limits the registers each
+     * thread uses to meet them, spilling if it must, so this trades
+     * spills for occupancy. max_threads may be zero to use the block
+     * size of the schedule, which is passed on automatically whenever
+     * it is a constant. Launching the kernel with more threads than
+     * max_threads fails. Ignored by other GPU APIs. Set
+     * HL_PTXAS_INFO=1 to see the registers, spills, and occupancy of
+     * each kernel compiled. */
+    Func &gpu_launch_bounds(int max_threads, int min_blocks_per_sm = 0);
+
+    /** Divide the iterations of the loop over var between the GPU and
+     * the host: the first device_fraction of them run on the device
+     * API the stage's GPU loops use, and the rest run on host threads,
+     * with the GPU block loops inside them made parallel and the
+     * thread loops serial. var must be one of the stage's GPU block
+     * loops or a loop outside them. E.g. to compute 70% of the rows of
+     * an output on an integrated GPU and the rest on the CPU:
+     \code
+     f.gpu_tile(x, y, xo, yo, xi, yi, 16, 16).hetero_split(yo, 0.7f);
+     \endcode
+     * The kernel is launched first, so that it runs while the host
+     * computes its share. Afterwards, only the region the device
+     * computed is copied back to the host. device_fraction may be any
+     * Expr, e.g. a Param, to set the ratio per run. If it is left
+     * undefined, the runtime tunes the ratio from how long each side
+     * took on previous runs. The device always gets at least one
+     * iteration. Ignored when compiling for a target with no GPU
+     * API. */
+    Func &hetero_split(VarOrRVar var, Expr device_fraction = Expr());
+
+    /** Distribute the iterations of the loop over var across all of
+     * the CUDA devices, in contiguous chunks of equal size. Each
+     * device gets its own context and stream, and the kernels of the
+     * chunks run concurrently. var must be one of the stage's GPU
+     * block loops or a loop outside them, e.g. a batch dimension:
+     \code
+     f.gpu_tile(x, y, xo, yo, xi, yi, 16, 16).gpu_multi_device(n);
+     \endcode
+     * Buffers allocated outside of the loop live on the device of the
+     * main context, and the other devices access them directly over
+     * peer-to-peer, so their results land in place with no further
+     * copies. To give a chunk a local copy of the halo region of an
+     * input, compute a wrapper of the input at the loop over var,
+     * e.g. in.in(f).compute_at(f, n).gpu_tile(...), which is
+     * allocated on the chunk's device. The number of devices used
+     * can be limited with halide_cuda_set_multi_device_count or the
+     * HL_CUDA_MULTI_DEVICE_COUNT environment variable. Ignored when
+     * compiling for a target without CUDA. */
+    Func &gpu_multi_device(VarOrRVar var);
+
+    /** Skip the iterations of the loop over tile for which condition
+     * is true. The condition may only depend on tile and the loops
+     * outside it, and is usually a lookup into a cheap downsampled
+     * mask of where the stage has work to do, e.g. to only run an
+     * expensive update where a mask is set:
+     \code
+     mask_small(xo, yo) = maximum(mask(xo * 16 + r.x, yo * 16 + r.y));
+     mask_small.compute_root();
+     f.update().tile(x, y, xo, yo, xi, yi, 16, 16)
+         .skip_tiles_where(xo, mask_small(xo, yo) == 0);
+     g.compute_at(f, xo);
+     \endcode
+     * Funcs computed at the loop over tile are only computed for the
+     * tiles that are not skipped. The skipped tiles of the stage keep
+     * whatever values they had before it ran, so this is most useful
+     * on update definitions, or on stages whose skipped regions are
+     * never read. Unlike the skipping of whole Funcs that happens
+     * automatically when a Func is only used under a condition that
+     * is known before its realization, this decision is made once per
+     * tile. */
+    Func &skip_tiles_where(VarOrRVar tile, Expr condition);
+
     /** Schedule for execution using coordinate-based hardware api.
      * GLSL is an example of this. Conceptually, this is
      * similar to parallelization over 'x' and 'y' (since GLSL shaders compute
@@ -1910,6 +2149,22 @@ public:
      * aligned to multiples of 16, use foo.align_storage(x, 16). */
     Func &align_storage(Var dim, Expr alignment);
 
+    /** Store realizations of this function as a grid of tiles of
+     * size tile_x by tile_y, each of which is contiguous in
+     * memory. Within a tile, elements are stored row by row, or in
+     * Morton (Z-curve) order if morton is true, in which case the
+     * tiles must be square with a power-of-two size. The x and y
+     * dimensions become the innermost two storage dimensions, and the
+     * storage extents of both are rounded up to a multiple of the
+     * tile size. This keeps intermediates that are read along both
+     * dimensions, as in separable filters and transposes, within a
+     * few cache lines and pages per tile.
+     *
+     * Only internal realizations can be tiled. Tiled Funcs can't be
+     * pipeline outputs, or be passed by buffer to extern stages. Don't
+     * reorder the storage of x and y after calling this. */
+    Func &store_tiled(Var x, Var y, int tile_x, int tile_y, bool morton = false);
+
     /** Store realizations of this function in a circular buffer of a
      * given extent. This is more efficient when the extent of the
      * circular buffer is a power of 2. If the fold factor is too
@@ -2070,9 +2325,12 @@ public:
 
     /** Use the halide_memoization_cache_... interface to store a
      *  computed version of this function across invocations of the
-     *  Func.
+     *  Func. With MemoizeKey::ContentHash, the cache key also includes
+     *  a hash of the contents of the input buffers it depends on, so
+     *  that a fresh buffer holding the same data as an earlier one
+     *  hits the cache.
      */
-    Func &memoize();
+    Func &memoize(MemoizeKey key = MemoizeKey::Parameters);
 
     /** Produce this Func asynchronously in a separate
      * thread. Consumers will be run by the task system when the
@@ -2093,6 +2351,21 @@ public:
      */
     Func &async();
 
+    /** Limit how much loop unrolling and loop partitioning may grow
+     * the code for this Func, in estimated machine instructions. Each
+     * unrolled loop and each loop partitioned into a prologue, steady
+     * state, and epilogue adds copies of its body; once the estimated
+     * size of this Func's code would exceed the budget, further loops
+     * are left rolled (with a warning) or unpartitioned. Loops are
+     * considered from the outside in, so the outer ones are the ones
+     * that get transformed. Use this for Funcs with deep nests of
+     * boundary conditions, unrolling, and vectorization whose code no
+     * longer fits in the instruction cache. The environment variable
+     * HL_CODE_SIZE_BUDGET sets a similar budget for the pipeline as a
+     * whole, and HL_CODE_SIZE_REPORT prints the estimated and
+     * generated size of each Func's code. */
+    Func &code_size_budget(int instructions);
+
     /** Allocate storage for this function within f's loop over
      * var. Scheduling storage is optional, and can be used to
      * separate the loop level at which storage occurs from the loop
@@ -2202,6 +2475,88 @@ public:
      * outside the outermost loop. */
     Func &store_root();
 
+    /** Keep the sliding window of a Func that is stored outside of,
+     * and computed inside, a parallel loop of its consumer. Sliding
+     * windows only slide along serial loops, so ordinarily such a Func
+     * is computed from scratch on every iteration. With this, the
+     * consumer's loop is split into strips of strip_size iterations,
+     * which run in parallel, and this Func is stored once per strip
+     * and slides along the iterations within it:
+     *
+     \code
+     blur_x.store_root().compute_at(blur_y, y).slide_in_strips(32);
+     blur_y.parallel(y);
+     \endcode
+     *
+     * is equivalent to:
+     *
+     \code
+     Var ys;
+     blur_y.split(y, ys, y, 32, TailStrategy::GuardWithIf).parallel(ys);
+     blur_x.store_at(blur_y, ys).compute_at(blur_y, y);
+     \endcode
+     *
+     * The first iteration of each strip computes the whole window,
+     * so larger strips do less redundant work, and smaller strips
+     * give more parallelism. Has no effect if the loop this Func is
+     * computed at isn't parallel. */
+    Func &slide_in_strips(Expr strip_size);
+
+    /** Divide the computation of this Func between the processes
+     * (ranks) of a distributed pipeline, such as the ranks of an MPI
+     * job, which each run the whole pipeline. The range of the pure
+     * dimension var covered by the Func is split into one contiguous
+     * slice per rank, and each rank only computes its own slice:
+     *
+     \code
+     blur_x.compute_root().distribute(y);
+     blur_y.distribute(y);
+     \endcode
+     *
+     * Each rank then receives the halo of blur_x that its slice of
+     * blur_y needs from the ranks that computed it. The halo is found
+     * by bounds inference, and the exchange overlaps with the part of
+     * blur_y that doesn't need it. If this Func is an output, each
+     * rank's output buffer only holds that rank's slice.
+     *
+     * This Func must be compute_root or an output, computed on the
+     * CPU, and have one value. Each of its stages must have var as a
+     * loop that hasn't been split or fused. Funcs that aren't
+     * distributed are computed in full by every rank.
+     *
+     * The ranks communicate through the functions installed with
+     * halide_set_distributed_comm, which tools/halide_mpi.h provides
+     * for MPI. Without them, there is one rank, which computes
+     * everything. */
+    Func &distribute(Var var);
+
+    /** Compute a chain of stencils together in tiles, so that the
+     * tile of each stage stays in cache until the next stage has
+     * consumed it. Every Func in the chain must be scheduled with
+     * this, and only be consumed by the next one:
+     *
+     \code
+     for (Func f : stages) {
+         f.compute_root().temporal_block(x, y, 64, 64);
+     }
+     \endcode
+     *
+     * Tiling each Func of the chain separately and computing the tiles
+     * independently would recompute a halo of every stage that grows
+     * with the length of the chain. Instead, the tiles of each stage are
+     * skewed against those of the next by the reach of its stencil, so
+     * that a tile of a stage only reads tiles of its producer that have
+     * already been computed. Each tile of the whole chain is then
+     * computed in one go, without computing anything twice. The tiles
+     * run in parallel in wavefronts along their anti-diagonals.
+     *
+     * Each Func must be compute_root, on the CPU, without update
+     * definitions, and read the previous Func of the chain at constant
+     * offsets along x and y. All the Funcs in a chain must use the
+     * same tile sizes. The Funcs are stored in full, so this saves
+     * memory bandwidth rather than memory. */
+    Func &temporal_block(Var x, Var y, int tile_x, int tile_y);
+
     /** Aggressively inline all uses of this function. This is the
      * default schedule, so you're unlikely to need to call this. For
      * a Func with an update definition, that means it gets computed
@@ -2239,6 +2594,84 @@ public:
      * on MemoryType for more detail. */
     Func &store_in(MemoryType memory_type);
 
+    /** Store this Func in the storage of a producer, instead of in
+     * a buffer of its own, overwriting the producer's values as this
+     * Func's are computed. This halves the memory traffic of
+     * pointwise stages like a tone curve applied to a blurred image:
+     *
+     \code
+     blurred.compute_root();
+     curved(x, y) = lut(blurred(x, y));
+     curved.compute_root().store_in_place_of(blurred);
+     \endcode
+     *
+     * The pure definition of this Func must read the producer only
+     * at the site it is computing, and its update definitions must
+     * not read the producer at all. Nothing may read the producer
+     * once this Func has been computed, and this Func must be stored
+     * at the same loop level as the producer. Splits of this Func's
+     * pure definition may not use TailStrategy::ShiftInwards, which
+     * computes some sites twice. Neither Func may be an output of
+     * the pipeline. The producer's storage is grown if necessary to
+     * cover this Func. */
+    Func &store_in_place_of(const Func &producer);
+
+    /** Store this Func in a pipeline input, overwriting the input
+     * buffer as this Func is computed. This Func must be
+     * compute_root, and the restrictions above apply. Only use this
+     * if the caller has no further use for the contents of the
+     * input, and the input has no device allocation. */
+    Func &store_in_place_of(const ImageParam &input);
+
+    /** Hint that the stores to this Func's buffer should bypass the
+     * cache, because nothing in the pipeline reads them again soon.
+     * This is useful for large outputs that are written once, such as
+     * full-resolution frames, which otherwise evict the cache lines
+     * the pipeline is still using. Dense vector stores are emitted as
+     * non-temporal stores on targets that have them (e.g. movntdq on
+     * x86 and stnp on ARM), followed by a memory fence once the
+     * pipeline (or a parallel task) is done. Other stores are
+     * unaffected. Don't use this on Funcs that are consumed by later
+     * stages while still in the cache. */
+    Func &store_nontemporal();
+
+    /** Store each element of this Func in the given number of bits,
+     * which must be 1, 2, or 4, packing several elements into each
+     * byte. This cuts the memory use and bandwidth of masks and
+     * low-bit data, such as quantized weights, by up to 8x. The Func
+     * must have a single integer or boolean value. Values are
+     * truncated to the low bits when stored, and sign- or
+     * zero-extended when loaded.
+     *
+     * Vector loads and stores that cover whole bytes are packed and
+     * unpacked with shuffles and shifts, so vectorize the innermost
+     * storage dimension by a multiple of 8 / bits, and keep the
+     * vectors aligned (e.g. with TailStrategy::RoundUp). Other
+     * stores update one element at a time, so parallel loops must not
+     * split a byte between tasks.
+     *
+     * Only internal realizations on the host can be packed. Packed
+     * Funcs can't be pipeline outputs, be used in GPU kernels, or be
+     * passed by buffer to extern stages. */
+    Func &store_packed(int bits);
+
+    /** Store the elements of this Func's Tuple interleaved in one
+     * buffer (an array of structs), instead of in a buffer per element
+     * (a struct of arrays, the default). Each site's values are then
+     * adjacent in memory, so stages that read all of them at scattered
+     * locations, such as the index and value of an argmin or the real
+     * and imaginary parts of a complex number, touch one cache line
+     * instead of one per element. Vector loads and stores of all the
+     * elements become dense loads and stores with shuffles. Stages that
+     * read only some of the elements, or read them at contiguous
+     * locations, are usually faster with the default layout. The
+     * elements must all be the same size.
+     *
+     * Only internal realizations can be interleaved. Interleaved Funcs
+     * can't be pipeline outputs, be memoized, have tiled or packed
+     * storage, or be passed by buffer to extern stages. */
+    Func &store_interleaved();
+
     /** Trace all loads from this Func by emitting calls to
      * halide_trace. If the Func is inlined, this has no
      * effect. */
@@ -22,7 +22,7 @@ namespace Halide {
 /** An argument to an extern-defined Func. May be a Function, Buffer,
  * ImageParam or Expr. */
 struct ExternFuncArgument {
-    enum ArgType {UndefinedArg = 0, FuncArg, BufferArg, ExprArg, ImageParamArg};
+    enum ArgType {UndefinedArg = 0, FuncArg, BufferArg, ExprArg, ImageParamArg, SemaphoreArg};
     ArgType arg_type;
     Internal::FunctionPtr func;
     Buffer<> buffer;
@@ -43,10 +43,27 @@ struct ExternFuncArgument {
     }
     ExternFuncArgument() : arg_type(UndefinedArg) {}
 
+    /** An argument that passes the extern stage a halide_semaphore_t *
+     * and makes it asynchronous. The extern stage may return before its
+     * outputs are ready, and must then release the semaphore once (with
+     * halide_semaphore_release) when they are, possibly from another
+     * thread. Consumers of the stage wait for the release on the Halide
+     * thread pool, so the calling thread can do other work in the
+     * meantime. If the extern stage returns an error, it must not go on
+     * to use its buffers, and need not release the semaphore. Bounds
+     * queries pass a null semaphore, and are expected to complete
+     * synchronously. */
+    static ExternFuncArgument completion_semaphore() {
+        ExternFuncArgument arg;
+        arg.arg_type = SemaphoreArg;
+        return arg;
+    }
+
     bool is_func() const {return arg_type == FuncArg;}
     bool is_expr() const {return arg_type == ExprArg;}
     bool is_buffer() const {return arg_type == BufferArg;}
     bool is_image_param() const {return arg_type == ImageParamArg;}
+    bool is_semaphore() const {return arg_type == SemaphoreArg;}
     bool defined() const {return arg_type != UndefinedArg;}
 };
 
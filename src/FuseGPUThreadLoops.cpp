@@ -375,7 +375,7 @@ class ExtractSharedAllocations : public IRMutator2 {
             Expr predicate = mutate(op->predicate);
             Expr index = mutate(op->index);
             shared[op->name].max = barrier_stage;
-            if (device_api == DeviceAPI::OpenGLCompute) {
+            if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
                 return Load::make(op->type, shared_mem_name + "_" + op->name,
                                   index, op->image, op->param, predicate);
             } else {
@@ -395,7 +395,7 @@ class ExtractSharedAllocations : public IRMutator2 {
             Expr predicate = mutate(op->predicate);
             Expr index = mutate(op->index);
             Expr value = mutate(op->value);
-            if (device_api == DeviceAPI::OpenGLCompute) {
+            if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
                 return Store::make(shared_mem_name + "_" + op->name, value, index,
                                    op->param, predicate);
             } else {
@@ -537,9 +537,10 @@ class ExtractSharedAllocations : public IRMutator2 {
 public:
     Stmt rewrap(Stmt s) {
 
-        if (device_api == DeviceAPI::OpenGLCompute) {
+        if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
 
-            // Individual shared allocations.
+            // Individual shared allocations, as GLSL can't view one
+            // shared array as another type.
             for (SharedAllocation alloc : allocations) {
                 s = Allocate::make(shared_mem_name + "_" + alloc.name,
                                    alloc.type, MemoryType::GPUShared,
@@ -824,6 +825,274 @@ public:
 
 };
 
+// Fuse a producer computed at block level into its consumer when both
+// loop over the gpu threads the same way, and every thread of the
+// consumer only loads the values the same thread of the producer
+// stored. The intermediate then lives in registers instead of shared
+// memory, and the barrier between the two thread loops goes away.
+// Only pointwise producers that store a single value (or vector) per
+// thread are handled. Must run before shared allocations are
+// extracted.
+class FusePointwiseThreadStages : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // A nest of gpu thread loops and the lets between them, peeled off
+    // down to the body of the innermost thread loop.
+    struct ThreadNest {
+        vector<Stmt> wrappers;
+        vector<const For *> loops;
+        Stmt body;
+
+        ThreadNest(Stmt s) {
+            while (true) {
+                const For *f = s.as<For>();
+                if (const LetStmt *l = s.as<LetStmt>()) {
+                    wrappers.push_back(s);
+                    s = l->body;
+                } else if (f && CodeGen_GPU_Dev::is_gpu_thread_var(f->name)) {
+                    wrappers.push_back(s);
+                    loops.push_back(f);
+                    s = f->body;
+                } else {
+                    break;
+                }
+            }
+            body = s;
+        }
+
+        // Put the nest back together around a new body.
+        Stmt rewrap(Stmt s) const {
+            for (size_t i = wrappers.size(); i > 0; i--) {
+                if (const LetStmt *l = wrappers[i - 1].as<LetStmt>()) {
+                    s = LetStmt::make(l->name, l->value, s);
+                } else {
+                    const For *f = wrappers[i - 1].as<For>();
+                    s = For::make(f->name, f->min, f->extent, f->for_type, f->device_api, s);
+                }
+            }
+            return s;
+        }
+
+        // The lets of the nest wrapped around a new body, without the loops.
+        Stmt rewrap_lets(Stmt s) const {
+            for (size_t i = wrappers.size(); i > 0; i--) {
+                if (const LetStmt *l = wrappers[i - 1].as<LetStmt>()) {
+                    s = LetStmt::make(l->name, l->value, s);
+                }
+            }
+            return s;
+        }
+    };
+
+    // The loads and stores of one buffer. Also notes whether there
+    // were stores to other buffers, or any loops or ifs.
+    class FindAccesses : public IRGraphVisitor {
+        using IRGraphVisitor::visit;
+
+        const string &name;
+
+        void visit(const Load *op) override {
+            if (op->name == name) {
+                loads.push_back(op);
+            }
+            IRGraphVisitor::visit(op);
+        }
+
+        void visit(const Store *op) override {
+            if (op->name == name) {
+                stores.push_back(op);
+            } else {
+                other_stores = true;
+            }
+            IRGraphVisitor::visit(op);
+        }
+
+        void visit(const For *op) override {
+            control_flow = true;
+            IRGraphVisitor::visit(op);
+        }
+
+        void visit(const IfThenElse *op) override {
+            control_flow = true;
+            IRGraphVisitor::visit(op);
+        }
+
+    public:
+        vector<const Load *> loads;
+        vector<const Store *> stores;
+        bool other_stores = false, control_flow = false;
+
+        FindAccesses(const string &n) : name(n) {}
+    };
+
+    // Point all the loads and stores of a buffer at a single register.
+    class UseRegister : public IRMutator2 {
+        using IRMutator2::visit;
+
+        const string &name;
+
+        Expr index(int lanes) {
+            return lanes == 1 ? Expr(0) : Ramp::make(0, 1, lanes);
+        }
+
+        Expr visit(const Load *op) override {
+            if (op->name == name) {
+                return Load::make(op->type, op->name, index(op->type.lanes()),
+                                  op->image, op->param, op->predicate);
+            }
+            return IRMutator2::visit(op);
+        }
+
+        Stmt visit(const Store *op) override {
+            if (op->name == name) {
+                Expr value = mutate(op->value);
+                return Store::make(op->name, value, index(value.type().lanes()),
+                                   op->param, op->predicate);
+            }
+            return IRMutator2::visit(op);
+        }
+
+    public:
+        UseRegister(const string &n) : name(n) {}
+    };
+
+    static bool same_index(const Expr &a, const Expr &b) {
+        if (a.type() != b.type()) {
+            return false;
+        }
+        const Ramp *ra = a.as<Ramp>(), *rb = b.as<Ramp>();
+        if (ra && rb) {
+            return can_prove(ra->base == rb->base) && can_prove(ra->stride == rb->stride);
+        } else if (a.type().is_scalar()) {
+            return can_prove(a == b);
+        } else {
+            return equal(simplify(a), simplify(b));
+        }
+    }
+
+    Stmt fuse(const Allocate *op, const ProducerConsumer *produce, const ProducerConsumer *consume) {
+        if (op->memory_type != MemoryType::Auto || op->new_expr.defined() ||
+            !produce || !consume || !produce->is_producer || consume->is_producer ||
+            produce->name != op->name || consume->name != op->name) {
+            return Stmt();
+        }
+
+        // Only the first thread nest of the consumer can be fused with
+        // the producer. Nothing after it may touch the buffer.
+        Stmt first = consume->body, rest;
+        if (const Block *b = first.as<Block>()) {
+            first = b->first;
+            rest = b->rest;
+            FindAccesses in_rest(op->name);
+            rest.accept(&in_rest);
+            if (!in_rest.loads.empty() || !in_rest.stores.empty()) {
+                return Stmt();
+            }
+        }
+
+        ThreadNest p_nest(produce->body), c_nest(first);
+        if (p_nest.loops.empty() || p_nest.loops.size() != c_nest.loops.size()) {
+            return Stmt();
+        }
+
+        // The thread loops must match one to one.
+        map<string, Expr> renaming;
+        for (size_t i = 0; i < p_nest.loops.size(); i++) {
+            const For *p = p_nest.loops[i], *c = c_nest.loops[i];
+            if (p->for_type != c->for_type ||
+                !equal(p->min, c->min) ||
+                !equal(p->extent, c->extent)) {
+                return Stmt();
+            }
+            bool same_dim = false;
+            for (const string &t : thread_names) {
+                same_dim = same_dim || (ends_with(p->name, t) && ends_with(c->name, t));
+            }
+            if (!same_dim) {
+                return Stmt();
+            }
+            renaming[p->name] = Variable::make(Int(32), c->name);
+        }
+
+        // The producer must store exactly once per thread, and touch
+        // no other memory.
+        FindAccesses in_producer_body(op->name);
+        p_nest.body.accept(&in_producer_body);
+        if (in_producer_body.other_stores || in_producer_body.control_flow) {
+            return Stmt();
+        }
+        FindAccesses in_producer(op->name);
+        Stmt flat_producer = substitute(renaming, substitute_in_all_lets(produce->body));
+        flat_producer.accept(&in_producer);
+        if (in_producer.stores.size() != 1 || !in_producer.loads.empty() ||
+            !is_one(in_producer.stores[0]->predicate)) {
+            return Stmt();
+        }
+        const Store *store = in_producer.stores[0];
+
+        // The consumer may only load the value the same thread stored.
+        FindAccesses in_consumer(op->name);
+        Stmt flat_consumer = substitute_in_all_lets(first);
+        flat_consumer.accept(&in_consumer);
+        if (in_consumer.loads.empty() || !in_consumer.stores.empty()) {
+            return Stmt();
+        }
+        for (const Load *l : in_consumer.loads) {
+            if (!is_one(l->predicate) || !same_index(l->index, store->index)) {
+                return Stmt();
+            }
+        }
+        // The loads must all be inside the innermost thread loop.
+        FindAccesses in_nest(op->name);
+        c_nest.body.accept(&in_nest);
+        if (in_nest.loads.size() != in_consumer.loads.size()) {
+            return Stmt();
+        }
+
+        debug(3) << "Fusing " << op->name << " into its consumer's thread loops\n";
+
+        Stmt p_body = substitute(renaming, p_nest.rewrap_lets(p_nest.body));
+        Stmt body = Block::make(ProducerConsumer::make_produce(op->name, p_body),
+                                ProducerConsumer::make_consume(op->name, c_nest.body));
+        body = UseRegister(op->name).mutate(body);
+        body = Allocate::make(op->name, op->type, MemoryType::Register,
+                              {store->value.type().lanes()}, const_true(), body);
+        Stmt result = c_nest.rewrap(body);
+        if (rest.defined()) {
+            result = Block::make(result, rest);
+        }
+        return result;
+    }
+
+    Stmt visit(const Allocate *op) override {
+        // Fuse the innermost stages first, so that chains of
+        // pointwise stages collapse into a single thread loop.
+        Stmt stmt = IRMutator2::visit(op);
+        op = stmt.as<Allocate>();
+        internal_assert(op);
+
+        // Peel off any lets between the allocation and its producer.
+        vector<const LetStmt *> lets;
+        Stmt body = op->body;
+        while (const LetStmt *l = body.as<LetStmt>()) {
+            lets.push_back(l);
+            body = l->body;
+        }
+        const Block *b = body.as<Block>();
+        if (!b) {
+            return stmt;
+        }
+        Stmt fused = fuse(op, b->first.as<ProducerConsumer>(), b->rest.as<ProducerConsumer>());
+        if (!fused.defined()) {
+            return stmt;
+        }
+        for (size_t i = lets.size(); i > 0; i--) {
+            fused = LetStmt::make(lets[i - 1]->name, lets[i - 1]->value, fused);
+        }
+        return fused;
+    }
+};
+
 class FuseGPUThreadLoops : public IRMutator2 {
     using IRMutator2::visit;
 
@@ -840,10 +1109,13 @@ class FuseGPUThreadLoops : public IRMutator2 {
             << "thread variables.\n";
 
         if (CodeGen_GPU_Dev::is_gpu_block_var(op->name)) {
+            // Keep the intermediates of pointwise stages that share a
+            // thread mapping in registers.
+            Stmt loop = FusePointwiseThreadStages().mutate(Stmt(op));
+
             // Do the analysis of thread block size and shared memory
             // usage.
             ExtractBlockSize block_size;
-            Stmt loop = Stmt(op);
             loop.accept(&block_size);
 
             ExtractSharedAllocations shared_mem(op->device_api);
@@ -869,7 +1141,8 @@ class ZeroGPULoopMins : public IRMutator2 {
         in_non_glsl_gpu = (in_non_glsl_gpu && op->device_api == DeviceAPI::None) ||
           (op->device_api == DeviceAPI::CUDA) || (op->device_api == DeviceAPI::OpenCL) ||
           (op->device_api == DeviceAPI::Metal) ||
-          (op->device_api == DeviceAPI::D3D12Compute);
+          (op->device_api == DeviceAPI::D3D12Compute) ||
+          (op->device_api == DeviceAPI::Vulkan);
 
         Stmt stmt = IRMutator2::visit(op);
         if (CodeGen_GPU_Dev::is_gpu_var(op->name) && !is_zero(op->min)) {
@@ -924,6 +1197,45 @@ class ValidateGPULoopNesting : public IRVisitor {
     }
 };
 
+class InjectGPULaunchBounds : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<string, Function> &env;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::CUDA || !CodeGen_GPU_Dev::is_gpu_var(op->name)) {
+            return IRMutator2::visit(op);
+        }
+
+        // This is the outermost loop of a kernel. Find the stage it
+        // belongs to from the loop name, which is of the form
+        // func.s<stage>.var.__block_id_x.
+        for (const auto &p : env) {
+            const Function &f = p.second;
+            for (size_t i = 0; i <= f.updates().size(); i++) {
+                if (!starts_with(op->name, f.name() + ".s" + std::to_string(i) + ".")) {
+                    continue;
+                }
+                const StageSchedule &sched =
+                    i == 0 ? f.definition().schedule() : f.update(i - 1).schedule();
+                if (sched.gpu_max_threads() == 0 && sched.gpu_min_blocks_per_sm() == 0) {
+                    return op;
+                }
+                Stmt marker = Evaluate::make(Call::make(Int(32), Call::gpu_launch_bounds,
+                                                        {sched.gpu_max_threads(),
+                                                         sched.gpu_min_blocks_per_sm()},
+                                                        Call::Intrinsic));
+                return For::make(op->name, op->min, op->extent, op->for_type, op->device_api,
+                                 Block::make(marker, op->body));
+            }
+        }
+        return op;
+    }
+
+public:
+    InjectGPULaunchBounds(const map<string, Function> &env) : env(env) {}
+};
+
 // Also used by InjectImageIntrinsics
 Stmt zero_gpu_loop_mins(Stmt s) {
     return ZeroGPULoopMins().mutate(s);
@@ -937,5 +1249,9 @@ Stmt fuse_gpu_thread_loops(Stmt s) {
     return s;
 }
 
+Stmt inject_gpu_launch_bounds(Stmt s, const map<string, Function> &env) {
+    return InjectGPULaunchBounds(env).mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
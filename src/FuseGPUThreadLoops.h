@@ -6,6 +6,9 @@
  * threads to target CUDA, OpenCL, and Metal.
  */
 
+#include <map>
+
+#include "Function.h"
 #include "IR.h"
 
 namespace Halide {
@@ -22,6 +25,12 @@ Stmt zero_gpu_loop_mins(Stmt s);
  * array. */
 Stmt fuse_gpu_thread_loops(Stmt s);
 
+/** Mark each CUDA kernel whose stage was given launch bounds (see
+ * Stage::gpu_launch_bounds) with a gpu_launch_bounds intrinsic at the
+ * top of its outermost loop over blocks, for the device code
+ * generator to find. */
+Stmt inject_gpu_launch_bounds(Stmt s, const std::map<std::string, Function> &env);
+
 }  // namespace Internal
 }  // namespace Halide
 
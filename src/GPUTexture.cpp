@@ -0,0 +1,164 @@
+#include "GPUTexture.h"
+#include "DeviceInterface.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+
+using namespace Internal;
+
+namespace {
+
+// The name of the call that tags the result of sample_bilinear, so
+// that lower_gpu_textures can find it. The args are the name of the
+// image, the location, and the explicit interpolation.
+const char *const sample_bilinear_tag = "halide_sample_bilinear";
+
+}  // namespace
+
+Expr sample_bilinear(const ImageParam &im, Expr x, Expr y) {
+    user_assert(im.dimensions() == 2)
+        << "Can't sample_bilinear ImageParam " << im.name()
+        << ", which has " << im.dimensions() << " dimensions instead of two.\n";
+    x = cast<float>(x);
+    y = cast<float>(y);
+
+    Expr fx = floor(x), fy = floor(y);
+    Expr wx = x - fx, wy = y - fy;
+    Expr ix = cast<int>(fx), iy = cast<int>(fy);
+    Expr x0 = clamp(ix, im.dim(0).min(), im.dim(0).max());
+    Expr x1 = clamp(ix + 1, im.dim(0).min(), im.dim(0).max());
+    Expr y0 = clamp(iy, im.dim(1).min(), im.dim(1).max());
+    Expr y1 = clamp(iy + 1, im.dim(1).min(), im.dim(1).max());
+    Expr top = lerp(cast<float>(im(x0, y0)), cast<float>(im(x1, y0)), wx);
+    Expr bottom = lerp(cast<float>(im(x0, y1)), cast<float>(im(x1, y1)), wx);
+    Expr value = lerp(top, bottom, wy);
+
+    return Call::make(Float(32), sample_bilinear_tag,
+                      {StringImm::make(im.name()), x, y, value},
+                      Call::PureExtern);
+}
+
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+
+namespace {
+
+class FindTextureParams : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Image && op->param.defined() &&
+            op->param.is_buffer() && op->param.gpu_texture()) {
+            params[op->name] = op->param;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    map<string, Parameter> params;
+};
+
+class LowerGPUTextures : public IRMutator2 {
+    using IRMutator2::visit;
+
+    DeviceAPI default_gpu_api;
+    const map<string, Parameter> &params;
+    bool in_kernel = false;
+
+    // The texture objects used by the kernel being mutated, by the name
+    // of the variable that holds each.
+    map<string, pair<Parameter, bool>> textures;
+
+    // A fetch at a location in the coordinates of the image, where
+    // pixel (i, j) is centered at (i, j). Texture coordinates are
+    // normalized, with pixel centers half a pixel in from the edges.
+    Expr fetch(const Parameter &p, bool linear_filter, Expr x, Expr y) {
+        string tex_name = p.name() + (linear_filter ? ".texture_linear" : ".texture");
+        textures[tex_name] = {p, linear_filter};
+        Expr tex = Variable::make(UInt(64), tex_name);
+        Expr u = ((cast<float>(x) - cast<float>(Variable::make(Int(32), p.name() + ".min.0")) + 0.5f) /
+                  cast<float>(Variable::make(Int(32), p.name() + ".extent.0")));
+        Expr v = ((cast<float>(y) - cast<float>(Variable::make(Int(32), p.name() + ".min.1")) + 0.5f) /
+                  cast<float>(Variable::make(Int(32), p.name() + ".extent.1")));
+        return Call::make(Float(32), "halide_ptx_tex_2d", {tex, u, v}, Call::PureExtern);
+    }
+
+    Expr fetch_or(const Parameter &p, bool linear_filter, Expr x, Expr y, Expr fallback) {
+        Expr sample = fetch(p, linear_filter, x, y);
+        const Call *c = sample.as<Call>();
+        return Call::make(Float(32), Call::if_then_else,
+                          {c->args[0] != make_zero(UInt(64)), sample, fallback},
+                          Call::PureIntrinsic);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->call_type == Call::PureExtern && op->name == sample_bilinear_tag) {
+            internal_assert(op->args.size() == 4);
+            const StringImm *name = op->args[0].as<StringImm>();
+            internal_assert(name);
+            Expr fallback = mutate(op->args[3]);
+            auto it = params.find(name->value);
+            if (in_kernel && it != params.end() && it->second.gpu_texture_filtering()) {
+                return fetch_or(it->second, true, mutate(op->args[1]), mutate(op->args[2]), fallback);
+            }
+            return fallback;
+        } else if (in_kernel && op->call_type == Call::Image &&
+                   op->type == Float(32) && op->args.size() == 2 &&
+                   params.count(op->name)) {
+            Expr load = IRMutator2::visit(op);
+            const Call *c = load.as<Call>();
+            internal_assert(c);
+            return fetch_or(params.at(op->name), false, c->args[0], c->args[1], load);
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        bool is_kernel = (!in_kernel && op->for_type == ForType::GPUBlock &&
+                          (op->device_api == DeviceAPI::CUDA ||
+                           (op->device_api == DeviceAPI::Default_GPU &&
+                            default_gpu_api == DeviceAPI::CUDA)));
+        if (!is_kernel) {
+            return IRMutator2::visit(op);
+        }
+
+        textures.clear();
+        in_kernel = true;
+        Stmt s = IRMutator2::visit(op);
+        in_kernel = false;
+
+        // Make the texture objects on the host, before the kernel.
+        for (const auto &t : textures) {
+            const Parameter &p = t.second.first;
+            Expr buffer = Variable::make(type_of<struct halide_buffer_t *>(), p.name() + ".buffer", p);
+            Expr tex = Call::make(UInt(64), "halide_cuda_buffer_texture",
+                                  {buffer, make_bool(t.second.second)}, Call::Extern);
+            s = LetStmt::make(t.first, tex, s);
+        }
+        textures.clear();
+        return s;
+    }
+
+public:
+    LowerGPUTextures(const Target &t, const map<string, Parameter> &params)
+        : default_gpu_api(get_default_device_api_for_target(t)), params(params) {
+    }
+};
+
+}  // namespace
+
+Stmt lower_gpu_textures(Stmt s, const Target &t) {
+    FindTextureParams f;
+    if (t.has_feature(Target::CUDA)) {
+        s.accept(&f);
+    }
+    return LowerGPUTextures(t, f.params).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
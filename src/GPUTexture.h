@@ -0,0 +1,38 @@
+#ifndef HALIDE_GPU_TEXTURE_H
+#define HALIDE_GPU_TEXTURE_H
+
+/** \file
+ * Defines bilinear sampling of images, and the lowering pass that
+ * reads images scheduled with ImageParam::gpu_texture through CUDA
+ * texture objects.
+ */
+
+#include "ImageParam.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** Sample a two-dimensional image at a location between pixels, by
+ * bilinear interpolation of the four pixels around it, where pixel
+ * (i, j) is centered at (i, j). Locations beyond the edge of the
+ * image are clamped to it. The result is a float. In CUDA kernels, if
+ * the image is scheduled with gpu_texture with hardware filtering, it
+ * is a single fetch filtered by the texture unit. */
+Expr sample_bilinear(const ImageParam &im, Expr x, Expr y);
+
+namespace Internal {
+
+/** In CUDA kernels, replace loads from images scheduled with
+ * gpu_texture with texture fetches, and sample_bilinear of those
+ * images with filtered fetches if requested. Each kernel is passed a
+ * texture object per image and filter mode, and falls back to the
+ * original loads when the runtime can't make one for the buffer.
+ * Elsewhere, sample_bilinear becomes the explicit loads and
+ * interpolation. Must be run after bounds inference, and before
+ * storage flattening. */
+Stmt lower_gpu_textures(Stmt s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,11 +1,14 @@
 #include <cmath>
 #include <fstream>
 #include <set>
+#include <sstream>
 
 #ifdef _WIN32
+#include <direct.h>
 #include <windows.h>
 #else
 #include <dlfcn.h>
+#include <sys/stat.h>
 #endif
 
 #include "Generator.h"
@@ -126,9 +129,143 @@ Outputs compute_outputs(const Target &target,
     if (options.emit_schedule) {
         output_files.schedule_name = base_path + get_extension(".schedule", options);
     }
+    if (options.emit_serialized_module) {
+        output_files.serialized_module_name = base_path + get_extension(".hlmod", options);
+    }
     return output_files;
 }
 
+// The files written for a set of Outputs, each paired with a name for
+// its kind of output.
+std::vector<std::pair<std::string, std::string>> output_file_list(const Outputs &o) {
+    const std::vector<std::pair<std::string, std::string>> all = {
+        {"o", o.object_name},
+        {"s", o.assembly_name},
+        {"bc", o.bitcode_name},
+        {"ll", o.llvm_assembly_name},
+        {"h", o.c_header_name},
+        {"cpp", o.c_source_name},
+        {"py.c", o.python_extension_name},
+        {"stmt", o.stmt_name},
+        {"html", o.stmt_html_name},
+        {"a", o.static_library_name},
+        {"schedule", o.schedule_name},
+        {"hlmod", o.serialized_module_name},
+    };
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto &f : all) {
+        if (!f.second.empty()) {
+            files.push_back(f);
+        }
+    }
+    return files;
+}
+
+bool copy_file(const std::string &from, const std::string &to) {
+    std::ifstream in(from, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+    return (bool)out;
+}
+
+// A hash of the binary (the generator itself, or a shared libHalide)
+// that contains the compiler, so that the generator cache misses when
+// Halide changes. Returns the empty string if the binary can't be
+// found.
+std::string compiler_hash() {
+    std::string path;
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    char name[MAX_PATH];
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCSTR)&compiler_hash, &module) &&
+        GetModuleFileNameA(module, name, sizeof(name)) != 0) {
+        path = name;
+    }
+#else
+    Dl_info info;
+    if (dladdr((void *)&compiler_hash, &info) && info.dli_fname) {
+        path = info.dli_fname;
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (path.empty() || !in) {
+        return "";
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return hash_cache_key(contents.str());
+}
+
+// Compile a set of outputs by calling compile, unless the directory
+// named by HL_GENERATOR_CACHE_DIR has the outputs of an earlier
+// compilation with the same key, in which case they are copied from
+// there instead. The key is made from the given description of the
+// compilation, the Modules it compiles, the names of the output files,
+// and the compiler itself. Newly compiled outputs are added to the
+// cache.
+void compile_with_cache(const std::string &description,
+                        const std::vector<Module> &modules,
+                        const Outputs &output_files,
+                        std::function<void()> compile) {
+    std::string dir = get_env_variable("HL_GENERATOR_CACHE_DIR");
+    std::string compiler = dir.empty() ? "" : compiler_hash();
+    if (compiler.empty()) {
+        if (!dir.empty()) {
+            debug(1) << "Generator cache disabled: could not find the binary containing Halide\n";
+        }
+        compile();
+        return;
+    }
+
+    std::vector<std::pair<std::string, std::string>> files = output_file_list(output_files);
+    std::ostringstream key;
+    key << "compiler=" << compiler << "\n"
+        << description;
+    for (const auto &f : files) {
+        // Outputs such as the header name the file they're in.
+        key << "output " << f.first << " " << f.second.substr(f.second.find_last_of("/\\") + 1) << "\n";
+    }
+    for (const Module &m : modules) {
+        write_module_cache_key(key, m);
+    }
+    std::string entry = dir + "/" + hash_cache_key(key.str());
+
+    bool hit = true;
+    for (const auto &f : files) {
+        hit = hit && file_exists(entry + "." + f.first);
+    }
+    for (size_t i = 0; hit && i < files.size(); i++) {
+        hit = copy_file(entry + "." + files[i].first, files[i].second);
+    }
+    if (hit) {
+        debug(1) << "Generator cache hit: " << entry << "\n";
+        return;
+    }
+    debug(1) << "Generator cache miss: " << entry << "\n";
+
+    compile();
+
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+    for (const auto &f : files) {
+        // Write to a temporary and rename, so that concurrent builds
+        // never see a partially-written entry.
+        std::string path = entry + "." + f.first;
+        std::string tmp_path = path + "." + std::to_string((uintptr_t)&key) + ".tmp";
+        if (!copy_file(f.second, tmp_path) || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            debug(1) << "Could not add " << f.second << " to the generator cache\n";
+            std::remove(tmp_path.c_str());
+        }
+    }
+}
+
 Argument to_argument(const Internal::Parameter &param, const Expr &default_value) {
     ArgumentEstimates argument_estimates = param.get_argument_estimates();
     argument_estimates.scalar_def = default_value;
@@ -765,6 +902,7 @@ std::string halide_type_to_c_source(const Type &t) {
         { halide_type_uint, "UInt" },
         { halide_type_float, "Float" },
         { halide_type_handle, "Handle" },
+        { halide_type_bfloat, "BFloat" },
     };
     std::ostringstream oss;
     oss << "Halide::" << m.at(t.code()) << "(" << t.bits() << + ")";
@@ -800,7 +938,7 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         "\n"
         " -e  A comma separated list of files to emit. Accepted values are:\n"
         "     [assembly, bitcode, cpp, h, html, o, static_library,\n"
-        "      stmt, cpp_stub, schedule].\n"
+        "      stmt, cpp_stub, schedule, hlmod].\n"
         "     If omitted, default value is [static_library, h].\n"
         "\n"
         " -x  A comma separated list of file extension pairs to substitute during\n"
@@ -809,7 +947,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         " -p  A comma-separted list of shared libraries that will be loaded before the\n"
         "     generator is run. Useful for custom auto-schedulers. The generator must\n"
         "     either be linked against a shared libHalide or compiled with -rdynamic\n"
-        "     so that references in the shared library to libHalide can resolve.\n";
+        "     so that references in the shared library to libHalide can resolve.\n"
+        "\n"
+        " If the environment variable HL_GENERATOR_CACHE_DIR is set, outputs are\n"
+        " cached in that directory, and reused when the generator, its arguments,\n"
+        " the lowered pipeline and Halide itself are all unchanged.\n";
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -943,9 +1085,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_cpp_stub = true;
             } else if (opt == "schedule") {
                 emit_options.emit_schedule = true;
+            } else if (opt == "hlmod") {
+                emit_options.emit_serialized_module = true;
             } else if (!opt.empty()) {
                 cerr << "Unrecognized emit option: " << opt
-                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub], ignoring.\n";
+                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, hlmod], ignoring.\n";
             }
         }
     }
@@ -971,13 +1115,13 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
     }
 
     if (!runtime_name.empty()) {
-        if (targets.size() != 1) {
-            cerr << "Only one target allowed here";
-            return 1;
-        }
+        // A multitarget pipeline calls the runtime of its last (most
+        // generic) target, whichever variant runs, so that is the one
+        // to build.
+        const Target &runtime_target = targets.back();
         std::string base_path = compute_base_path(output_dir, runtime_name, "");
-        Outputs output_files = compute_outputs(targets[0], base_path, emit_options);
-        compile_standalone_runtime(output_files, targets[0]);
+        Outputs output_files = compute_outputs(runtime_target, base_path, emit_options);
+        compile_standalone_runtime(output_files, runtime_target);
     }
 
     if (!generator_name.empty()) {
@@ -1002,13 +1146,41 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                     gen->set_generator_param_values(sub_generator_args);
                     return gen->build_module(name);
                 };
+
+            // Describe everything about this invocation that isn't in
+            // the Modules, for the generator cache.
+            std::ostringstream description;
+            description << "generator=" << generator_name << "\n"
+                        << "function=" << function_name << "\n";
+            for (const auto &arg : generator_args) {
+                description << "arg " << arg.first << "=" << arg.second.string_value << "\n";
+            }
+            for (const auto &subst : emit_options.substitutions) {
+                description << "substitution " << subst.first << "=" << subst.second << "\n";
+            }
+            const bool use_cache = !get_env_variable("HL_GENERATOR_CACHE_DIR").empty();
+
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
-                compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions);
+                // The Modules compile_multitarget makes aren't
+                // available to key the cache on, so make a copy of each
+                // for the key. This lowers the pipeline twice on a miss.
+                std::vector<Module> modules;
+                for (const Target &target : targets) {
+                    if (use_cache) {
+                        modules.push_back(module_producer(function_name, target));
+                    }
+                }
+                compile_with_cache(description.str(), modules, output_files, [&]() {
+                    compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions);
+                });
             } else {
                 user_assert(emit_options.substitutions.empty()) << "substitutions not supported for single-target";
                 // compile_multitarget() will fail if we request anything but library and/or header,
                 // so defer directly to Module::compile if there is a single target.
-                module_producer(function_name, targets[0]).compile(output_files);
+                Module module = module_producer(function_name, targets[0]);
+                compile_with_cache(description.str(), {module}, output_files, [&]() {
+                    module.compile(output_files);
+                });
             }
         }
     }
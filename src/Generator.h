@@ -1938,16 +1938,20 @@ public:
     HALIDE_FORWARD_METHOD(Func, copy_to_host)
     HALIDE_FORWARD_METHOD(Func, define_extern)
     HALIDE_FORWARD_METHOD_CONST(Func, defined)
+    HALIDE_FORWARD_METHOD(Func, distribute)
     HALIDE_FORWARD_METHOD(Func, estimate)
     HALIDE_FORWARD_METHOD(Func, fold_storage)
     HALIDE_FORWARD_METHOD(Func, fuse)
     HALIDE_FORWARD_METHOD(Func, glsl)
     HALIDE_FORWARD_METHOD(Func, gpu)
     HALIDE_FORWARD_METHOD(Func, gpu_blocks)
+    HALIDE_FORWARD_METHOD(Func, gpu_launch_bounds)
+    HALIDE_FORWARD_METHOD(Func, gpu_multi_device)
     HALIDE_FORWARD_METHOD(Func, gpu_single_thread)
     HALIDE_FORWARD_METHOD(Func, gpu_threads)
     HALIDE_FORWARD_METHOD(Func, gpu_tile)
     HALIDE_FORWARD_METHOD_CONST(Func, has_update_definition)
+    HALIDE_FORWARD_METHOD(Func, hetero_split)
     HALIDE_FORWARD_METHOD(Func, hexagon)
     HALIDE_FORWARD_METHOD(Func, in)
     HALIDE_FORWARD_METHOD(Func, memoize)
@@ -1957,6 +1961,7 @@ public:
     HALIDE_FORWARD_METHOD(Func, parallel)
     HALIDE_FORWARD_METHOD(Func, prefetch)
     HALIDE_FORWARD_METHOD(Func, print_loop_nest)
+    HALIDE_FORWARD_METHOD(Func, print_redundant_work)
     HALIDE_FORWARD_METHOD(Func, rename)
     HALIDE_FORWARD_METHOD(Func, reorder)
     HALIDE_FORWARD_METHOD(Func, reorder_storage)
@@ -2670,6 +2675,7 @@ public:
         bool emit_static_library{true};
         bool emit_cpp_stub{false};
         bool emit_schedule{false};
+        bool emit_serialized_module{false};
 
         // This is an optional map used to replace the default extensions generated for
         // a file: if an key matches an output extension, emit those files with the
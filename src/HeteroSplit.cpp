@@ -0,0 +1,228 @@
+#include "HeteroSplit.h"
+#include "Bounds.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool is_gpu_loop(const For *op) {
+    return (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane);
+}
+
+class ContainsGPULoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (is_gpu_loop(op)) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+// Rewrite the GPU loops in the host part of a split loop to run on
+// the host.
+class MakeHostLoops : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        ForType for_type = op->for_type;
+        if (for_type == ForType::GPUBlock) {
+            for_type = ForType::Parallel;
+        } else if (for_type == ForType::GPUThread ||
+                   for_type == ForType::GPULane) {
+            for_type = ForType::Serial;
+        }
+        DeviceAPI device_api = op->device_api;
+        if (device_api != DeviceAPI::Host) {
+            device_api = DeviceAPI::None;
+        }
+        Stmt body = mutate(op->body);
+        return For::make(op->name, op->min, op->extent, for_type, device_api, body);
+    }
+
+    Stmt visit(const Realize *op) override {
+        if (op->memory_type != MemoryType::GPUShared) {
+            return IRMutator2::visit(op);
+        }
+        Stmt body = mutate(op->body);
+        return Realize::make(op->name, op->types, MemoryType::Auto,
+                             op->bounds, op->condition, body);
+    }
+};
+
+struct SplitStage {
+    Function func;
+    Expr fraction;
+};
+
+class HeteroSplit : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The marked loops, keyed by loop name.
+    map<string, SplitStage> splits;
+
+    bool in_gpu_loop = false, in_parallel_loop = false;
+
+    Stmt visit(const For *op) override {
+        auto it = splits.find(op->name);
+        if (it == splits.end()) {
+            ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop || is_gpu_loop(op));
+            ScopedValue<bool> old_in_parallel_loop(in_parallel_loop,
+                                                   in_parallel_loop || op->for_type == ForType::Parallel);
+            return IRMutator2::visit(op);
+        }
+
+        user_assert(!in_gpu_loop && op->for_type != ForType::GPUThread && op->for_type != ForType::GPULane)
+            << "Loop " << op->name << " is marked with hetero_split, but it is inside a GPU block loop. "
+            << "hetero_split must be applied to a GPU block loop or to a loop outside of them.\n";
+
+        // The device and host parts are synchronized by copies
+        // injected around them, which can't be done per-iteration of
+        // a parallel loop.
+        user_assert(!in_parallel_loop && op->for_type != ForType::Parallel)
+            << "Loop " << op->name << " is marked with hetero_split, but it is a parallel loop "
+            << "or inside one.\n";
+
+        ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, is_gpu_loop(op));
+        Stmt body = mutate(op->body);
+
+        ContainsGPULoops gpu_loops;
+        op->accept(&gpu_loops);
+        user_assert(gpu_loops.result)
+            << "Loop " << op->name << " is marked with hetero_split, but there are no GPU loops "
+            << "at or inside it to split it with.\n";
+
+        const Function &func = it->second.func;
+        Expr fraction = it->second.fraction;
+        Expr name = op->name;
+        bool adaptive = !fraction.defined();
+        if (adaptive) {
+            fraction = Call::make(Float(32), "halide_hetero_split_fraction", {name}, Call::Extern);
+        }
+
+        // The first device_extent iterations go to the device, and the
+        // rest to the host. The device always gets at least one, so
+        // that there is never a kernel launch with no blocks.
+        string fraction_name = op->name + ".hetero_fraction";
+        string device_extent_name = op->name + ".hetero_device_extent";
+        Expr fraction_var = Variable::make(Float(32), fraction_name);
+        Expr device_extent_var = Variable::make(Int(32), device_extent_name);
+        Expr device_extent = cast<int>(floor(cast<float>(op->extent) * fraction_var + 0.5f));
+        device_extent = clamp(device_extent, 1, op->extent);
+        Expr host_extent = op->extent - device_extent_var;
+
+        Stmt device_loop = For::make(op->name, op->min, device_extent_var,
+                                     op->for_type, op->device_api, body);
+
+        ForType host_for_type = op->for_type;
+        if (host_for_type == ForType::GPUBlock) {
+            host_for_type = ForType::Parallel;
+        }
+        DeviceAPI host_device_api = op->device_api;
+        if (host_device_api != DeviceAPI::Host) {
+            host_device_api = DeviceAPI::None;
+        }
+        Stmt host_loop = For::make(op->name, op->min + device_extent_var, host_extent,
+                                   host_for_type, host_device_api, MakeHostLoops().mutate(body));
+
+        vector<Stmt> stmts = {device_loop, host_loop};
+        if (adaptive) {
+            stmts.push_back(Evaluate::make(Call::make(Int(32), "halide_hetero_split_host_done",
+                                                      {name}, Call::Extern)));
+        }
+
+        // Record the region of each of the stage's buffers that the
+        // device part wrote.
+        // Interleaved Tuple elements share one buffer.
+        int buffers = func.schedule().store_interleaved() ? 1 : func.outputs();
+        for (int i = 0; i < buffers; i++) {
+            string buffer = func.name();
+            if (buffers > 1) {
+                buffer += "." + std::to_string(i);
+            }
+            Box box = box_provided(device_loop, buffer);
+            bool bounded = !box.maybe_unused() && !box.empty();
+            for (size_t j = 0; j < box.size(); j++) {
+                bounded = bounded && box[j].is_bounded();
+            }
+            if (!bounded) {
+                user_warning << "Could not bound the region of " << buffer
+                             << " computed on the device by the hetero_split of " << op->name
+                             << ". All of it will be copied back to the host.\n";
+                continue;
+            }
+            vector<Expr> args = {name, Expr(buffer)};
+            for (size_t j = 0; j < box.size(); j++) {
+                args.push_back(box[j].min);
+            }
+            for (size_t j = 0; j < box.size(); j++) {
+                args.push_back(box[j].max - box[j].min + 1);
+            }
+            stmts.push_back(Evaluate::make(Call::make(Int(32), Call::hetero_split_merge,
+                                                      args, Call::Intrinsic)));
+        }
+
+        if (adaptive) {
+            stmts.push_back(Evaluate::make(Call::make(Int(32), "halide_hetero_split_merged",
+                                                      {name, device_extent_var, host_extent},
+                                                      Call::Extern)));
+        }
+
+        Stmt s = Block::make(stmts);
+        s = LetStmt::make(device_extent_name, device_extent, s);
+        s = LetStmt::make(fraction_name, fraction, s);
+        return s;
+    }
+
+public:
+    HeteroSplit(const map<string, Function> &env) {
+        for (const auto &p : env) {
+            const Function &f = p.second;
+            for (size_t i = 0; i <= f.updates().size(); i++) {
+                const StageSchedule &sched =
+                    i == 0 ? f.definition().schedule() : f.update(i - 1).schedule();
+                if (sched.hetero_split_var().empty()) {
+                    continue;
+                }
+                string loop_name = f.name() + ".s" + std::to_string(i) + "." + sched.hetero_split_var();
+                splits[loop_name] = {f, sched.hetero_split_fraction()};
+            }
+        }
+    }
+
+    bool empty() const {
+        return splits.empty();
+    }
+};
+
+}  // namespace
+
+Stmt hetero_split(Stmt s, const map<string, Function> &env, const Target &t) {
+    if (!t.has_gpu_feature()) {
+        return s;
+    }
+    HeteroSplit splitter(env);
+    if (splitter.empty()) {
+        return s;
+    }
+    return splitter.mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
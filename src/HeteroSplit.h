@@ -0,0 +1,31 @@
+#ifndef HALIDE_HETERO_SPLIT_H
+#define HALIDE_HETERO_SPLIT_H
+
+/** \file
+ * Defines the lowering pass that divides loops marked with
+ * Func::hetero_split between a GPU and the host.
+ */
+
+#include <map>
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Split each loop marked with hetero_split into a device part and a
+ * host part. The device part keeps the GPU loops inside it. The host
+ * part turns GPU block loops into parallel loops and GPU thread loops
+ * into serial loops. After both parts, a marker intrinsic records the
+ * region of the stage's buffers the device part wrote, so that
+ * inject_host_dev_buffer_copies can copy only that region back to the
+ * host. Does nothing for targets with no GPU API. */
+Stmt hetero_split(Stmt s, const std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
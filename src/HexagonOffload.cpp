@@ -669,6 +669,69 @@ Stmt replace_params(Stmt s, const std::map<std::string, Parameter> &replacements
     return ReplaceParams(replacements).mutate(s);
 }
 
+// Whether a statement runs entirely on Hexagon: a loop marked with
+// the Hexagon device API, possibly wrapped in produce/consume nodes.
+bool is_offloaded(const Stmt &s) {
+    if (const For *loop = s.as<For>()) {
+        return loop->device_api == DeviceAPI::Hexagon;
+    } else if (const ProducerConsumer *pc = s.as<ProducerConsumer>()) {
+        return is_offloaded(pc->body);
+    }
+    return false;
+}
+
+// Clear the device API of the offloaded loops in an offloaded
+// statement, which is about to become the body of a bigger offload.
+Stmt run_on_device(const Stmt &s) {
+    if (const For *loop = s.as<For>()) {
+        return For::make(loop->name, loop->min, loop->extent, loop->for_type,
+                         DeviceAPI::None, loop->body);
+    } else if (const ProducerConsumer *pc = s.as<ProducerConsumer>()) {
+        return ProducerConsumer::make(pc->name, pc->is_producer, run_on_device(pc->body));
+    }
+    internal_error << "Not an offloaded statement:\n" << s << "\n";
+    return Stmt();
+}
+
+// Each offloaded loop costs a FastRPC round trip, plus cache
+// maintenance on each of its buffers. Merge runs of consecutive
+// offloaded loops into a single offloaded loop of one iteration, so a
+// sequence of small Hexagon stages costs one call.
+class BatchHexagonOffloads : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Block *op) override {
+        vector<Stmt> stmts;
+        Stmt s = op;
+        while (const Block *b = s.as<Block>()) {
+            stmts.push_back(mutate(b->first));
+            s = b->rest;
+        }
+        stmts.push_back(mutate(s));
+
+        vector<Stmt> result;
+        for (size_t i = 0; i < stmts.size();) {
+            size_t end = i;
+            while (end < stmts.size() && is_offloaded(stmts[end])) {
+                end++;
+            }
+            if (end - i < 2) {
+                result.push_back(stmts[i]);
+                i++;
+                continue;
+            }
+            vector<Stmt> batch;
+            for (; i < end; i++) {
+                batch.push_back(run_on_device(stmts[i]));
+            }
+            debug(1) << "Batching " << batch.size() << " consecutive Hexagon offloads into one call\n";
+            result.push_back(For::make(unique_name("hexagon_batch"), 0, 1, ForType::Serial,
+                                       DeviceAPI::Hexagon, Block::make(batch)));
+        }
+        return Block::make(result);
+    }
+};
+
 class InjectHexagonRpc : public IRMutator2 {
     std::map<std::string, Expr> state_bufs;
 
@@ -934,6 +997,7 @@ Stmt inject_hexagon_rpc(Stmt s, const Target &host_target,
 
     Module shared_runtime(runtime_module_name, target);
     Module hexagon_module(pipeline_module_name, target.with_feature(Target::NoRuntime));
+    s = BatchHexagonOffloads().mutate(s);
     InjectHexagonRpc injector(hexagon_module);
     s = injector.inject(s);
 
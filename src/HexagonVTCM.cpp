@@ -0,0 +1,129 @@
+#include <map>
+
+#include "HexagonVTCM.h"
+#include "CodeGen_Internal.h"
+#include "Debug.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+class PlaceAllocationsInVTCM : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const int64_t budget;
+    const int vector_bytes;
+
+    // Whether we're in code that runs on Hexagon, and whether we're
+    // inside a loop (or something else that may run more than once,
+    // or concurrently) of that code.
+    bool in_hexagon;
+    bool in_loop = false;
+
+    // The VTCM allocations currently live, and their total size.
+    map<string, int64_t> live;
+    int64_t live_bytes = 0;
+
+    void release(const string &name) {
+        auto it = live.find(name);
+        if (it != live.end()) {
+            live_bytes -= it->second;
+            live.erase(it);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (!in_hexagon && op->device_api == DeviceAPI::Hexagon) {
+            // The body of an offloaded loop is a whole program
+            // running on Hexagon.
+            ScopedValue<bool> old_in_hexagon(in_hexagon, true);
+            ScopedValue<bool> old_in_loop(in_loop, false);
+            return IRMutator2::visit(op);
+        } else {
+            ScopedValue<bool> old_in_loop(in_loop, true);
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const Fork *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Acquire *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (!in_hexagon || is_zero(op->condition) || op->new_expr.defined()) {
+            return IRMutator2::visit(op);
+        }
+
+        int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        int64_t bytes = (int64_t)constant_size * op->type.bytes() + op->type.bytes() + vector_bytes;
+
+        MemoryType memory_type = op->memory_type;
+        if (memory_type == MemoryType::VTCM) {
+            // Scheduled in VTCM explicitly. It still uses up
+            // space. If we don't know how much, assume all of it.
+            if (constant_size == 0) {
+                bytes = budget;
+            }
+        } else if (memory_type == MemoryType::Auto &&
+                   !in_loop &&
+                   constant_size > 0 &&
+                   !can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes())) {
+            if (live_bytes + bytes <= budget) {
+                debug(1) << "Placing " << op->name << " (" << bytes << " bytes) in VTCM\n";
+                memory_type = MemoryType::VTCM;
+            } else {
+                debug(1) << "Leaving " << op->name << " (" << bytes << " bytes) in DDR: "
+                         << live_bytes << " of " << budget << " bytes of VTCM already in use\n";
+            }
+        }
+
+        if (memory_type != MemoryType::VTCM) {
+            return IRMutator2::visit(op);
+        }
+
+        live[op->name] = bytes;
+        live_bytes += bytes;
+        Stmt body = mutate(op->body);
+        // Released here unless there was an early free.
+        release(op->name);
+
+        return Allocate::make(op->name, op->type, memory_type, op->extents,
+                              op->condition, body, op->new_expr, op->free_function);
+    }
+
+    Stmt visit(const Free *op) override {
+        release(op->name);
+        return op;
+    }
+
+public:
+    PlaceAllocationsInVTCM(int64_t budget, int vector_bytes, bool in_hexagon)
+        : budget(budget), vector_bytes(vector_bytes), in_hexagon(in_hexagon) {}
+};
+
+}  // namespace
+
+Stmt place_allocations_in_vtcm(Stmt s, const Target &t) {
+    if (!t.features_any_of({Target::HVX_v65, Target::HVX_v66})) {
+        return s;
+    }
+    // v65 and v66 both have 256KB of VTCM.
+    const int64_t budget = 256 * 1024;
+    const int vector_bytes = t.has_feature(Target::HVX_128) ? 128 : 64;
+    return PlaceAllocationsInVTCM(budget, vector_bytes, t.arch == Target::Hexagon).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
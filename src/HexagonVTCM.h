@@ -0,0 +1,31 @@
+#ifndef HALIDE_HEXAGON_VTCM_H
+#define HALIDE_HEXAGON_VTCM_H
+
+/** \file
+ * Defines a lowering pass that places intermediate buffers of Hexagon
+ * code in VTCM.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Move allocations made by Hexagon code from DDR into VTCM when
+ * they fit. Only allocations with no memory type scheduled, a
+ * constant size, and which are too big for the stack are
+ * considered, and only those that are not inside a loop of the
+ * Hexagon code, so that each is requested from VTCM once per
+ * offload. Allocations are placed greedily in program order, while
+ * the total size of the ones live at once stays within the VTCM of
+ * the target. An allocation stops being live at its Free, so this
+ * should run after inject_early_frees; sequential stages then reuse
+ * the same VTCM. Allocations that don't fit are left in DDR. Does
+ * nothing for targets without VTCM (before hvx_v65). */
+Stmt place_allocations_in_vtcm(Stmt s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
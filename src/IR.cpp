@@ -1,3 +1,6 @@
+#include <cstdlib>
+#include <mutex>
+
 #include "IR.h"
 #include "IRMutator.h"
 #include "IRPrinter.h"
@@ -6,6 +9,282 @@
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// IR nodes are allocated in size classes of 16-byte granularity,
+// carved out of larger slabs. Freed nodes go onto a free list owned by
+// the freeing thread. A thread keeps at most two batches of nodes per
+// size class, and spills a batch to a shared depot when it has more,
+// so that a thread that frees IR other threads allocated doesn't hoard
+// it. Threads refill from the depot a batch at a time before carving
+// new slabs. When a thread exits its free lists go to the depot too.
+// Slabs are never returned to the system.
+const size_t node_size_granularity = 16;
+const size_t num_node_size_classes = 16;
+const size_t max_pooled_node_size = node_size_granularity * num_node_size_classes;
+const size_t node_slab_size = 64 * 1024;
+const size_t node_batch_size = 256;
+const size_t max_cached_nodes = 2 * node_batch_size;
+
+struct FreeNode {
+    FreeNode *next;
+};
+
+struct NodeDepot {
+    std::mutex mutex;
+    FreeNode *free_lists[num_node_size_classes] = {nullptr};
+};
+
+NodeDepot &node_depot() {
+    // Leaked so that nodes freed during static destruction still have
+    // somewhere to go.
+    static NodeDepot *depot = new NodeDepot;
+    return *depot;
+}
+
+// Move up to max_count nodes from the front of list to the depot, and
+// return how many were moved.
+size_t spill_to_depot(FreeNode *&list, size_t c, size_t max_count) {
+    FreeNode *head = list;
+    if (!head) return 0;
+    FreeNode *tail = head;
+    size_t count = 1;
+    while (tail->next && count < max_count) {
+        tail = tail->next;
+        count++;
+    }
+    list = tail->next;
+
+    NodeDepot &depot = node_depot();
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    tail->next = depot.free_lists[c];
+    depot.free_lists[c] = head;
+    return count;
+}
+
+// Take a list of up to a batch of nodes of the given size class from
+// the depot, or carve up a new slab if it has none.
+FreeNode *take_from_depot(size_t c, size_t *count) {
+    NodeDepot &depot = node_depot();
+    {
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        FreeNode *head = depot.free_lists[c];
+        if (head) {
+            FreeNode *tail = head;
+            size_t n = 1;
+            while (tail->next && n < node_batch_size) {
+                tail = tail->next;
+                n++;
+            }
+            depot.free_lists[c] = tail->next;
+            tail->next = nullptr;
+            *count = n;
+            return head;
+        }
+    }
+
+    size_t size = (c + 1) * node_size_granularity;
+    char *slab = (char *)malloc(node_slab_size);
+    internal_assert(slab) << "Out of memory allocating IR nodes\n";
+    size_t n = node_slab_size / size;
+    FreeNode *head = nullptr;
+    for (size_t i = n; i > 0; i--) {
+        FreeNode *node = (FreeNode *)(slab + (i - 1) * size);
+        node->next = head;
+        head = node;
+    }
+    *count = n;
+    return head;
+}
+
+enum class NodeCacheState : uint8_t {
+    Unused,
+    Active,
+    Destroyed,
+};
+
+// The free lists of a thread. This is trivially destructible, so it
+// stays usable while the thread's other thread_locals and, on the main
+// thread, static objects are destroyed, any of which may free IR. Its
+// lists are handed to the depot by NodeCacheFlusher.
+struct NodeCache {
+    FreeNode *free_lists[num_node_size_classes];
+    uint32_t counts[num_node_size_classes];
+    NodeCacheState state;
+};
+
+thread_local NodeCache node_cache;
+
+struct NodeCacheFlusher {
+    ~NodeCacheFlusher() {
+        for (size_t c = 0; c < num_node_size_classes; c++) {
+            spill_to_depot(node_cache.free_lists[c], c, (size_t)-1);
+            node_cache.counts[c] = 0;
+        }
+        // From here on this thread allocates from and frees to the
+        // depot directly.
+        node_cache.state = NodeCacheState::Destroyed;
+    }
+};
+
+// Returns whether this thread's free lists can be used, registering
+// them to be flushed at thread exit on first use.
+bool node_cache_usable() {
+    if (node_cache.state == NodeCacheState::Unused) {
+        // Constructing the flusher registers its destructor.
+        static thread_local NodeCacheFlusher flusher;
+        (void)flusher;
+        node_cache.state = NodeCacheState::Active;
+    }
+    return node_cache.state == NodeCacheState::Active;
+}
+
+}  // namespace
+
+void *IRNode::operator new(size_t size) {
+    if (size > max_pooled_node_size) {
+        return ::operator new(size);
+    }
+    size_t c = (size - 1) / node_size_granularity;
+    // The lists are empty unless the cache is active.
+    FreeNode *n = node_cache.free_lists[c];
+    if (n) {
+        node_cache.free_lists[c] = n->next;
+        node_cache.counts[c]--;
+        return n;
+    }
+
+    size_t count = 0;
+    n = take_from_depot(c, &count);
+    if (node_cache_usable()) {
+        node_cache.free_lists[c] = n->next;
+        node_cache.counts[c] = (uint32_t)(count - 1);
+    } else {
+        FreeNode *rest = n->next;
+        spill_to_depot(rest, c, (size_t)-1);
+    }
+    return n;
+}
+
+void IRNode::operator delete(void *ptr, size_t size) {
+    if (size > max_pooled_node_size) {
+        ::operator delete(ptr);
+        return;
+    }
+    size_t c = (size - 1) / node_size_granularity;
+    FreeNode *n = (FreeNode *)ptr;
+    if (!node_cache_usable()) {
+        n->next = nullptr;
+        spill_to_depot(n, c, 1);
+        return;
+    }
+    n->next = node_cache.free_lists[c];
+    node_cache.free_lists[c] = n;
+    if (++node_cache.counts[c] > max_cached_nodes) {
+        node_cache.counts[c] -= (uint32_t)spill_to_depot(node_cache.free_lists[c], c, node_batch_size);
+    }
+}
+
+namespace {
+
+// Small integer constants are by far the most frequently constructed
+// IR nodes, and IR nodes are immutable, so there is one shared node
+// per small value of each scalar integer type.
+const int min_interned_imm = -16;
+const int max_interned_imm = 127;
+const int num_interned_imms = max_interned_imm - min_interned_imm + 1;
+
+int interned_bits_index(int bits) {
+    switch (bits) {
+    case 1: return 0;
+    case 8: return 1;
+    case 16: return 2;
+    case 32: return 3;
+    default: return 4;
+    }
+}
+
+struct InternedImms {
+    Expr ints[5][num_interned_imms];
+    Expr uints[5][num_interned_imms];
+
+    InternedImms() {
+        const int bits[] = {1, 8, 16, 32, 64};
+        for (int b = 0; b < 5; b++) {
+            for (int i = 0; i < num_interned_imms; i++) {
+                int64_t value = i + min_interned_imm;
+                if (bits[b] > 1) {
+                    IntImm *node = new IntImm;
+                    node->type = Int(bits[b]);
+                    node->value = value;
+                    ints[b][i] = node;
+                }
+                if (value >= 0 && (bits[b] > 1 || value <= 1)) {
+                    UIntImm *node = new UIntImm;
+                    node->type = UInt(bits[b]);
+                    node->value = (uint64_t)value;
+                    uints[b][i] = node;
+                }
+            }
+        }
+    }
+};
+
+const InternedImms &interned_imms() {
+    // Deliberately leaked, so that Exprs held in other static objects
+    // stay valid during static destruction.
+    static const InternedImms *imms = new InternedImms;
+    return *imms;
+}
+
+}  // namespace
+
+const IntImm *IntImm::make(Type t, int64_t value) {
+    internal_assert(t.is_int() && t.is_scalar())
+        << "IntImm must be a scalar Int\n";
+    internal_assert(t.bits() == 8 || t.bits() == 16 || t.bits() == 32 || t.bits() == 64)
+        << "IntImm must be 8, 16, 32, or 64-bit\n";
+
+    // Normalize the value by dropping the high bits.
+    // Since left-shift of negative value is UB in C++, cast to uint64 first;
+    // it's unlikely any compilers we care about will misbehave, but UBSan will complain.
+    value = (int64_t) (((uint64_t) value) << (64 - t.bits()));
+
+    // Then sign-extending to get them back
+    value >>= (64 - t.bits());
+
+    if (value >= min_interned_imm && value <= max_interned_imm) {
+        const Expr &e = interned_imms().ints[interned_bits_index(t.bits())][value - min_interned_imm];
+        return (const IntImm *)e.get();
+    }
+
+    IntImm *node = new IntImm;
+    node->type = t;
+    node->value = value;
+    return node;
+}
+
+const UIntImm *UIntImm::make(Type t, uint64_t value) {
+    internal_assert(t.is_uint() && t.is_scalar())
+        << "UIntImm must be a scalar UInt\n";
+    internal_assert(t.bits() == 1 || t.bits() == 8 || t.bits() == 16 || t.bits() == 32 || t.bits() == 64)
+        << "UIntImm must be 1, 8, 16, 32, or 64-bit\n";
+
+    // Normalize the value by dropping the high bits
+    value <<= (64 - t.bits());
+    value >>= (64 - t.bits());
+
+    if (value <= (uint64_t)max_interned_imm) {
+        const Expr &e = interned_imms().uints[interned_bits_index(t.bits())][(int)value - min_interned_imm];
+        return (const UIntImm *)e.get();
+    }
+
+    UIntImm *node = new UIntImm;
+    node->type = t;
+    node->value = value;
+    return node;
+}
+
 Expr Cast::make(Type t, Expr v) {
     internal_assert(v.defined()) << "Cast of undefined\n";
     internal_assert(t.lanes() == v.type().lanes()) << "Cast may not change vector widths\n";
@@ -354,6 +633,15 @@ Stmt Acquire::make(Expr semaphore, Expr count, Stmt body) {
     return node;
 }
 
+Stmt Atomic::make(const std::string &producer_name, Stmt body) {
+    internal_assert(body.defined()) << "Atomic must have a body statement.\n";
+
+    Atomic *node = new Atomic;
+    node->producer_name = producer_name;
+    node->body = std::move(body);
+    return node;
+}
+
 Stmt Store::make(const std::string &name, Expr value, Expr index, Parameter param, Expr predicate) {
     internal_assert(predicate.defined()) << "Store with undefined predicate\n";
     internal_assert(value.defined()) << "Store of undefined\n";
@@ -818,6 +1106,7 @@ template<> void StmtNode<Evaluate>::accept(IRVisitor *v) const { v->visit((const
 template<> void StmtNode<Prefetch>::accept(IRVisitor *v) const { v->visit((const Prefetch *)this); }
 template<> void StmtNode<Acquire>::accept(IRVisitor *v) const { v->visit((const Acquire *)this); }
 template<> void StmtNode<Fork>::accept(IRVisitor *v) const { v->visit((const Fork *)this); }
+template<> void StmtNode<Atomic>::accept(IRVisitor *v) const { v->visit((const Atomic *)this); }
 
 template<> Expr ExprNode<IntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const IntImm *)this); }
 template<> Expr ExprNode<UIntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const UIntImm *)this); }
@@ -864,6 +1153,7 @@ template<> Stmt StmtNode<Evaluate>::mutate_stmt(IRMutator2 *v) const { return v-
 template<> Stmt StmtNode<Prefetch>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Prefetch *)this); }
 template<> Stmt StmtNode<Acquire>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Acquire *)this); }
 template<> Stmt StmtNode<Fork>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Fork *)this); }
+template<> Stmt StmtNode<Atomic>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Atomic *)this); }
 
 Call::ConstString Call::debug_to_file = "debug_to_file";
 Call::ConstString Call::reinterpret = "reinterpret";
@@ -899,6 +1189,10 @@ Call::ConstString Call::div_round_to_zero = "div_round_to_zero";
 Call::ConstString Call::mod_round_to_zero = "mod_round_to_zero";
 Call::ConstString Call::call_cached_indirect_function = "call_cached_indirect_function";
 Call::ConstString Call::prefetch = "prefetch";
+Call::ConstString Call::copy_memory = "copy_memory";
+Call::ConstString Call::fill_memory = "fill_memory";
+Call::ConstString Call::load_packed = "load_packed";
+Call::ConstString Call::store_packed = "store_packed";
 Call::ConstString Call::signed_integer_overflow = "signed_integer_overflow";
 Call::ConstString Call::indeterminate_expression = "indeterminate_expression";
 Call::ConstString Call::bool_to_mask = "bool_to_mask";
@@ -912,6 +1206,10 @@ Call::ConstString Call::quiet_div = "quiet_div";
 Call::ConstString Call::quiet_mod = "quiet_mod";
 Call::ConstString Call::unsafe_promise_clamped = "unsafe_promise_clamped";
 Call::ConstString Call::gpu_thread_barrier = "gpu_thread_barrier";
+Call::ConstString Call::gpu_launch_bounds = "gpu_launch_bounds";
+Call::ConstString Call::nontemporal = "nontemporal";
+Call::ConstString Call::hetero_split_merge = "hetero_split_merge";
+Call::ConstString Call::branch_weights = "branch_weights";
 
 Call::ConstString Call::buffer_get_dimensions = "_halide_buffer_get_dimensions";
 Call::ConstString Call::buffer_get_min = "_halide_buffer_get_min";
@@ -520,6 +520,10 @@ struct Call : public ExprNode<Call> {
         mod_round_to_zero,
         call_cached_indirect_function,
         prefetch,
+        copy_memory,
+        fill_memory,
+        load_packed,
+        store_packed,
         signed_integer_overflow,
         indeterminate_expression,
         bool_to_mask,
@@ -532,7 +536,11 @@ struct Call : public ExprNode<Call> {
         quiet_div,
         quiet_mod,
         unsafe_promise_clamped,
-        gpu_thread_barrier;
+        gpu_thread_barrier,
+        gpu_launch_bounds,
+        nontemporal,
+        hetero_split_merge,
+        branch_weights;
 
     // We also declare some symbolic names for some of the runtime
     // functions that we want to construct Call nodes to here to avoid
@@ -673,7 +681,9 @@ struct Variable : public ExprNode<Variable> {
  * 16). An 'Unrolled' for loop compiles to a completely unrolled
  * version of the loop. Each iteration becomes its own
  * statement. Again in this case, 'extent' should be a small
- * integer constant. */
+ * integer constant. An 'UnrolledAndJammed' for loop is moved inside
+ * the loops it contains, and unrolled there, so that its iterations
+ * are fused into the innermost loop body. */
 struct For : public StmtNode<For> {
     std::string name;
     Expr min, extent;
@@ -702,6 +712,19 @@ struct Acquire : public StmtNode<Acquire> {
     static const IRNodeType _node_type = IRNodeType::Acquire;
 };
 
+/** Perform each Store in the body as a single atomic
+ * read-modify-write. The body is the update of the named Func, whose
+ * value reads the location it writes, e.g. f[i] = f[i] + e. Produced
+ * by Stage::atomic(). */
+struct Atomic : public StmtNode<Atomic> {
+    std::string producer_name;
+    Stmt body;
+
+    static Stmt make(const std::string &producer_name, Stmt body);
+
+    static const IRNodeType _node_type = IRNodeType::Atomic;
+};
+
 /** Construct a new vector by taking elements from another sequence of
  * vectors. */
 struct Shuffle : public ExprNode<Shuffle> {
@@ -1,3 +1,6 @@
+#include <cstring>
+#include <functional>
+
 #include "IREquality.h"
 #include "IROperator.h"
 #include "IRVisitor.h"
@@ -35,11 +38,24 @@ public:
      * elimination. */
     IRComparer(IRCompareCache *c = nullptr) : result(Equal), cache(c) {}
 
+    /** Reject Exprs with different structural hashes without looking
+     * inside them. Only valid when the caller just wants to know
+     * whether the IR is equal, because the hashes don't respect the
+     * lexical ordering. */
+    bool use_hashes = false;
+
+    /** Compare children of the root Exprs by identity instead of by
+     * value, except for constants. See shallow_equal. */
+    bool shallow = false;
+
 private:
     Expr expr;
     Stmt stmt;
     IRCompareCache *cache;
 
+    // How deep in the Expr being compared we are.
+    int depth = 0;
+
     CmpResult compare_names(const std::string &a, const std::string &b);
     CmpResult compare_types(Type a, Type b);
     CmpResult compare_expr_vector(const std::vector<Expr> &a, const std::vector<Expr> &b);
@@ -81,6 +97,7 @@ private:
     void visit(const ProducerConsumer *) override;
     void visit(const For *) override;
     void visit(const Acquire *) override;
+    void visit(const Atomic *) override;
     void visit(const Store *) override;
     void visit(const Provide *) override;
     void visit(const Allocate *) override;
@@ -132,11 +149,17 @@ IRComparer::CmpResult IRComparer::compare_expr(const Expr &a, const Expr &b) {
         return result;
     }
 
-    // If in the future we have hashes for Exprs, this is a good place
-    // to compare the hashes:
-    // if (compare_scalar(a.hash(), b.hash()) != Equal) {
-    //   return result;
-    // }
+    if (shallow && depth > 0 && !(is_const(a) && is_const(b))) {
+        // The children of shallowly compared Exprs are canonical, so
+        // they're equal only if they're the same node.
+        compare_scalar((uintptr_t)a.get(), (uintptr_t)b.get());
+        return result;
+    }
+
+    if (use_hashes &&
+        compare_scalar(structural_hash(a), structural_hash(b)) != Equal) {
+        return result;
+    }
 
     if (compare_scalar(a->node_type, b->node_type) != Equal) {
         return result;
@@ -153,7 +176,9 @@ IRComparer::CmpResult IRComparer::compare_expr(const Expr &a, const Expr &b) {
     }
 
     expr = a;
+    depth++;
     b.accept(this);
+    depth--;
 
     if (cache && result == Equal) {
         cache->insert(a, b);
@@ -437,6 +462,13 @@ void IRComparer::visit(const Acquire *op) {
     compare_stmt(s->body, op->body);
 }
 
+void IRComparer::visit(const Atomic *op) {
+    const Atomic *s = stmt.as<Atomic>();
+
+    compare_names(s->producer_name, op->producer_name);
+    compare_stmt(s->body, op->body);
+}
+
 void IRComparer::visit(const Store *op) {
     const Store *s = stmt.as<Store>();
 
@@ -545,26 +577,206 @@ void IRComparer::visit(const Prefetch *op) {
     compare_stmt(s->body, op->body);
 }
 
+/** The class that computes the hash of a single node, given the
+ * hashes of its children. Must agree with IRComparer about which
+ * fields matter. */
+class IRHasher : public IRVisitor {
+public:
+    uint32_t h = 0;
+
+    void mix(uint32_t x) {
+        h ^= x + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+
+    void mix(uint64_t x) {
+        mix((uint32_t)x);
+        mix((uint32_t)(x >> 32));
+    }
+
+    void mix(const string &s) {
+        mix((uint64_t)std::hash<string>()(s));
+    }
+
+    void mix(const Expr &e) {
+        mix(e.defined() ? structural_hash(e) : 0);
+    }
+
+    void mix(Type t) {
+        // Handle types are not included, so handles that differ only
+        // in their C++ types collide, and are told apart by IRComparer.
+        mix((uint32_t)t.code());
+        mix((uint32_t)t.bits());
+        mix((uint32_t)t.lanes());
+    }
+
+private:
+    using IRVisitor::visit;
+
+    template<typename T>
+    void visit_binary_operator(const T *op) {
+        mix(op->a);
+        mix(op->b);
+    }
+
+    void visit(const IntImm *op) override {
+        mix((uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        double value = op->value;
+        if (value == 0) {
+            // -0 and 0 compare equal.
+            value = 0;
+        }
+        if (value != value) {
+            mix((uint32_t)0x7ff8);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            mix(bits);
+        }
+    }
+
+    void visit(const StringImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Cast *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Variable *op) override {
+        mix(op->name);
+    }
+
+    void visit(const Add *op) override {visit_binary_operator(op);}
+    void visit(const Sub *op) override {visit_binary_operator(op);}
+    void visit(const Mul *op) override {visit_binary_operator(op);}
+    void visit(const Div *op) override {visit_binary_operator(op);}
+    void visit(const Mod *op) override {visit_binary_operator(op);}
+    void visit(const Min *op) override {visit_binary_operator(op);}
+    void visit(const Max *op) override {visit_binary_operator(op);}
+    void visit(const EQ *op) override {visit_binary_operator(op);}
+    void visit(const NE *op) override {visit_binary_operator(op);}
+    void visit(const LT *op) override {visit_binary_operator(op);}
+    void visit(const LE *op) override {visit_binary_operator(op);}
+    void visit(const GT *op) override {visit_binary_operator(op);}
+    void visit(const GE *op) override {visit_binary_operator(op);}
+    void visit(const And *op) override {visit_binary_operator(op);}
+    void visit(const Or *op) override {visit_binary_operator(op);}
+
+    void visit(const Not *op) override {
+        mix(op->a);
+    }
+
+    void visit(const Select *op) override {
+        mix(op->condition);
+        mix(op->true_value);
+        mix(op->false_value);
+    }
+
+    void visit(const Load *op) override {
+        mix(op->name);
+        mix(op->predicate);
+        mix(op->index);
+    }
+
+    void visit(const Ramp *op) override {
+        mix(op->base);
+        mix(op->stride);
+    }
+
+    void visit(const Broadcast *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Call *op) override {
+        mix(op->name);
+        mix((uint32_t)op->call_type);
+        mix((uint32_t)op->value_index);
+        for (const Expr &e : op->args) {
+            mix(e);
+        }
+    }
+
+    void visit(const Let *op) override {
+        mix(op->name);
+        mix(op->value);
+        mix(op->body);
+    }
+
+    void visit(const Shuffle *op) override {
+        for (const Expr &e : op->vectors) {
+            mix(e);
+        }
+        for (int i : op->indices) {
+            mix((uint32_t)i);
+        }
+    }
+};
+
 } // namespace
 
 
 // Now the methods exposed in the header.
 bool equal(const Expr &a, const Expr &b) {
-    return IRComparer().compare_expr(a, b) == IRComparer::Equal;
+    if (a.same_as(b)) {
+        return true;
+    }
+    IRComparer cmp;
+    cmp.use_hashes = true;
+    return cmp.compare_expr(a, b) == IRComparer::Equal;
 }
 
 bool graph_equal(const Expr &a, const Expr &b) {
     IRCompareCache cache(8);
-    return IRComparer(&cache).compare_expr(a, b) == IRComparer::Equal;
+    IRComparer cmp(&cache);
+    cmp.use_hashes = true;
+    return cmp.compare_expr(a, b) == IRComparer::Equal;
 }
 
 bool equal(const Stmt &a, const Stmt &b) {
-    return IRComparer().compare_stmt(a, b) == IRComparer::Equal;
+    if (a.same_as(b)) {
+        return true;
+    }
+    IRComparer cmp;
+    cmp.use_hashes = true;
+    return cmp.compare_stmt(a, b) == IRComparer::Equal;
 }
 
 bool graph_equal(const Stmt &a, const Stmt &b) {
     IRCompareCache cache(8);
-    return IRComparer(&cache).compare_stmt(a, b) == IRComparer::Equal;
+    IRComparer cmp(&cache);
+    cmp.use_hashes = true;
+    return cmp.compare_stmt(a, b) == IRComparer::Equal;
+}
+
+uint32_t structural_hash(const Expr &e) {
+    internal_assert(e.defined()) << "structural_hash of undefined Expr\n";
+    uint32_t h = e.get()->hash.load(std::memory_order_relaxed);
+    if (h == 0) {
+        IRHasher hasher;
+        hasher.mix((uint32_t)e->node_type);
+        hasher.mix(e.type());
+        e.accept(&hasher);
+        // Reserve zero to mean not yet computed.
+        h = hasher.h ? hasher.h : 1;
+        e.get()->hash.store(h, std::memory_order_relaxed);
+    }
+    return h;
+}
+
+bool shallow_equal(const Expr &a, const Expr &b) {
+    if (a.same_as(b)) {
+        return true;
+    }
+    IRComparer cmp;
+    cmp.shallow = true;
+    return cmp.compare_expr(a, b) == IRComparer::Equal;
 }
 
 bool IRDeepCompare::operator()(const Expr &a, const Expr &b) const {
@@ -642,6 +854,20 @@ void ir_equality_test() {
     // These are only discovered to be not equal way down the tree:
     e2 = e2*e2 + e2;
     check_not_equal(e1, e2);
+    // Without a cache, this would only terminate because the hashes
+    // of the two Exprs differ.
+    internal_assert(!equal(e1, e2));
+
+    // Equal Exprs have equal hashes.
+    internal_assert(structural_hash(x * 3 + 2) == structural_hash(x * 3 + 2));
+    internal_assert(structural_hash(x * 3 + 2) != structural_hash(x * 3 + 1));
+    internal_assert(structural_hash(make_const(Float(32), 0.0)) ==
+                    structural_hash(make_const(Float(32), -0.0)));
+
+    // Shallow equality only looks inside constant children.
+    Expr y = Variable::make(Int(32), "y");
+    internal_assert(shallow_equal(Add::make(x, 3), Add::make(x, 3)));
+    internal_assert(!shallow_equal(Add::make(x, y), Add::make(x, Variable::make(Int(32), "y"))));
 
     debug(0) << "ir_equality_test passed\n";
 }
@@ -112,6 +112,20 @@ bool graph_equal(const Expr &a, const Expr &b);
 bool graph_equal(const Stmt &a, const Stmt &b);
 // @}
 
+/** A hash of the value of an Expr, consistent with equal(): Exprs
+ * that are equal have the same hash. The hash of each node is stored
+ * on the node the first time it is computed, so hashing a graph of IR
+ * nodes is linear in the number of distinct nodes, and rehashing it is
+ * constant time. The result is never zero. */
+uint32_t structural_hash(const Expr &e);
+
+/** Compare two Exprs whose children are canonical, meaning that equal
+ * children are the same object. Only the fields of the root nodes are
+ * compared by value; children are compared by identity, except for
+ * constants. This is constant time, and is how CSE finds existing
+ * copies of a freshly rebuilt Expr. */
+bool shallow_equal(const Expr &a, const Expr &b);
+
 void ir_equality_test();
 
 }  // namespace Internal
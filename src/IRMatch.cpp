@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <mutex>
 
 #include "IREquality.h"
 #include "IRMatch.h"
@@ -400,11 +402,51 @@ bool equal_helper(const BaseExprNode &a, const BaseExprNode &b) noexcept {
     case IRNodeType::IfThenElse:
     case IRNodeType::Evaluate:
     case IRNodeType::Prefetch:
+    case IRNodeType::Atomic:
         ;
     }
     return false;
 }
 
+#if HALIDE_PROFILE_RULES
+namespace {
+
+struct RuleStats {
+    uint64_t tried = 0, fired = 0, ns = 0;
+};
+
+struct RuleStatsTable {
+    std::mutex mutex;
+    map<std::pair<string, int>, RuleStats> stats;
+
+    ~RuleStatsTable() {
+        vector<std::pair<std::pair<string, int>, RuleStats>> sorted(stats.begin(), stats.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<std::pair<string, int>, RuleStats> &a,
+                     const std::pair<std::pair<string, int>, RuleStats> &b) {
+                      return a.second.ns > b.second.ns;
+                  });
+        std::cerr << "Rewrite rule profile (file:line tried fired ms):\n";
+        for (const auto &it : sorted) {
+            std::cerr << "  " << it.first.first << ":" << it.first.second
+                      << " " << it.second.tried
+                      << " " << it.second.fired
+                      << " " << it.second.ns / 1.0e6 << "\n";
+        }
+    }
+} rule_stats_table;
+
+}  // namespace
+
+void record_rule_stats(const char *file, int line, bool fired, uint64_t ns) {
+    std::lock_guard<std::mutex> lock(rule_stats_table.mutex);
+    RuleStats &s = rule_stats_table.stats[{file, line}];
+    s.tried++;
+    s.fired += fired ? 1 : 0;
+    s.ns += ns;
+}
+#endif
+
 }  // namespace IRMatcher
 }  // namespace Internal
 }  // namespace Halide
@@ -10,6 +10,7 @@
 #include "IROperator.h"
 #include "ModulusRemainder.h"
 
+#include <chrono>
 #include <random>
 #include <set>
 
@@ -171,6 +172,7 @@ Expr make_const_expr(halide_scalar_value_t val, halide_type_t ty) {
         e = UIntImm::make(scalar_type, val.u.u64);
         break;
     case halide_type_float:
+    case halide_type_bfloat:
         e = FloatImm::make(scalar_type, val.u.f64);
         break;
     default:
@@ -530,6 +532,7 @@ struct Const {
             val.u.u64 = (uint64_t)v;
             break;
         case halide_type_float:
+        case halide_type_bfloat:
             val.u.f64 = (double)v;
             break;
         default:
@@ -634,6 +637,7 @@ struct BinOp {
             val.u.u64 = constant_fold_bin_op<Op>(ty, val_a.u.u64, val_b.u.u64);
             break;
         case halide_type_float:
+        case halide_type_bfloat:
             val.u.f64 = constant_fold_bin_op<Op>(ty, val_a.u.f64, val_b.u.f64);
             break;
         default:
@@ -726,6 +730,7 @@ struct CmpOp {
             val.u.u64 = constant_fold_cmp_op<Op>(val_a.u.u64, val_b.u.u64);
             break;
         case halide_type_float:
+        case halide_type_bfloat:
             val.u.u64 = constant_fold_cmp_op<Op>(val_a.u.f64, val_b.u.f64);
             break;
         default:
@@ -1427,7 +1432,7 @@ struct NotOp {
         a.make_folded_const(val, ty, state);
         val.u.u64 = ~val.u.u64;
         val.u.u64 &= 1;
-        ty.lanes |= ((int)ty.code == (int)halide_type_float) ? MatcherState::indeterminate_expression : 0;
+        ty.lanes |= ((int)ty.code == (int)halide_type_float || (int)ty.code == (int)halide_type_bfloat) ? MatcherState::indeterminate_expression : 0;
     }
 };
 
@@ -1706,6 +1711,7 @@ struct NegateOp {
             val.u.u64 = ((-val.u.u64) << dead_bits) >> dead_bits;
             break;
         case halide_type_float:
+        case halide_type_bfloat:
             val.u.f64 = -val.u.f64;
             break;
         default:
@@ -2068,6 +2074,7 @@ void fuzz_test_rule(Before &&before, After &&after, Predicate &&pred,
                 }
                 break;
             case halide_type_float:
+            case halide_type_bfloat:
                 {
                     // Use a very narrow range of precise floats, so
                     // that none of the rules a human is likely to
@@ -2106,6 +2113,7 @@ void fuzz_test_rule(Before &&before, After &&after, Predicate &&pred,
                    constant_fold_bin_op<Add>(output_type, val_after.u.i64, 0));
             break;
         case halide_type_float:
+        case halide_type_bfloat:
             {
                 double error = std::abs(val_before.u.f64 - val_after.u.f64);
                 // We accept an equal bit pattern (e.g. inf vs inf),
@@ -2176,6 +2184,39 @@ bool evaluate_predicate(Pattern p, MatcherState &state) {
 // correctness_simplify with this on.
 #define HALIDE_FUZZ_TEST_RULES 0
 
+// Set to true to count how often each rewrite rule is tried and how
+// often it fires, along with the time spent trying it. Rules are
+// identified by the file and line of the call to the rewriter. The
+// totals are printed to stderr at exit, most expensive rules first.
+#define HALIDE_PROFILE_RULES 0
+
+#if HALIDE_PROFILE_RULES
+void record_rule_stats(const char *file, int line, bool fired, uint64_t ns);
+
+struct RuleProfiler {
+    const char *file;
+    int line;
+    bool fired = false;
+    std::chrono::steady_clock::time_point start;
+
+    RuleProfiler(const char *file, int line) :
+        file(file), line(line), start(std::chrono::steady_clock::now()) {}
+
+    ~RuleProfiler() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        record_rule_stats(file, line, fired, (uint64_t)ns);
+    }
+};
+
+#define HALIDE_RULE_SITE , const char *rule_file = __builtin_FILE(), int rule_line = __builtin_LINE()
+#define HALIDE_PROFILE_RULE RuleProfiler rule_profiler(rule_file, rule_line)
+#define HALIDE_RULE_FIRED rule_profiler.fired = true
+#else
+#define HALIDE_RULE_SITE
+#define HALIDE_PROFILE_RULE
+#define HALIDE_RULE_FIRED
+#endif
+
 template<typename Instance>
 struct Rewriter {
     Instance instance;
@@ -2199,8 +2240,9 @@ struct Rewriter {
              typename = typename enable_if_pattern<Before>::type,
              typename = typename enable_if_pattern<After>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, After after) {
+    bool operator()(Before before, After after HALIDE_RULE_SITE) {
         static_assert((Before::binds & After::binds) == After::binds, "Rule result uses unbound values");
+        HALIDE_PROFILE_RULE;
         #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, after, true, wildcard_type, output_type);
         #endif
@@ -2209,6 +2251,7 @@ struct Rewriter {
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
@@ -2221,12 +2264,14 @@ struct Rewriter {
     template<typename Before,
              typename = typename enable_if_pattern<Before>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, const Expr &after) noexcept {
+    bool operator()(Before before, const Expr &after HALIDE_RULE_SITE) noexcept {
+        HALIDE_PROFILE_RULE;
         if (before.template match<0>(instance, state)) {
             result = after;
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
@@ -2239,7 +2284,8 @@ struct Rewriter {
     template<typename Before,
              typename = typename enable_if_pattern<Before>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, int64_t after) noexcept {
+    bool operator()(Before before, int64_t after HALIDE_RULE_SITE) noexcept {
+        HALIDE_PROFILE_RULE;
         #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, Const(after), true, wildcard_type, output_type);
         #endif
@@ -2248,6 +2294,7 @@ struct Rewriter {
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
@@ -2264,10 +2311,11 @@ struct Rewriter {
              typename = typename enable_if_pattern<After>::type,
              typename = typename enable_if_pattern<Predicate>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, After after, Predicate pred) {
+    bool operator()(Before before, After after, Predicate pred HALIDE_RULE_SITE) {
         static_assert(Predicate::foldable, "Predicates must consist only of operations that can constant-fold");
         static_assert((Before::binds & After::binds) == After::binds, "Rule result uses unbound values");
         static_assert((Before::binds & Predicate::binds) == Predicate::binds, "Rule predicate uses unbound values");
+        HALIDE_PROFILE_RULE;
         #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, after, pred, wildcard_type, output_type);
         #endif
@@ -2277,6 +2325,7 @@ struct Rewriter {
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
@@ -2291,14 +2340,16 @@ struct Rewriter {
              typename = typename enable_if_pattern<Before>::type,
              typename = typename enable_if_pattern<Predicate>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, const Expr &after, Predicate pred) {
+    bool operator()(Before before, const Expr &after, Predicate pred HALIDE_RULE_SITE) {
         static_assert(Predicate::foldable, "Predicates must consist only of operations that can constant-fold");
+        HALIDE_PROFILE_RULE;
         if (before.template match<0>(instance, state) &&
             evaluate_predicate(pred, state)) {
             result = after;
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
@@ -2313,8 +2364,9 @@ struct Rewriter {
              typename = typename enable_if_pattern<Before>::type,
              typename = typename enable_if_pattern<Predicate>::type>
     HALIDE_ALWAYS_INLINE
-    bool operator()(Before before, int64_t after, Predicate pred) {
+    bool operator()(Before before, int64_t after, Predicate pred HALIDE_RULE_SITE) {
         static_assert(Predicate::foldable, "Predicates must consist only of operations that can constant-fold");
+        HALIDE_PROFILE_RULE;
         #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, Const(after), pred, wildcard_type, output_type);
         #endif
@@ -2324,6 +2376,7 @@ struct Rewriter {
             #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
             #endif
+            HALIDE_RULE_FIRED;
             return true;
         } else {
             #if HALIDE_DEBUG_UNMATCHED_RULES
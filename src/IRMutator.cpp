@@ -354,6 +354,14 @@ Stmt IRMutator2::visit(const Acquire *op) {
     }
 }
 
+Stmt IRMutator2::visit(const Atomic *op) {
+    Stmt body = mutate(op->body);
+    if (body.same_as(op->body)) {
+        return op;
+    } else {
+        return Atomic::make(op->producer_name, std::move(body));
+    }
+}
 
 Stmt IRGraphMutator2::mutate(const Stmt &s) {
     auto iter = stmt_replacements.find(s);
@@ -833,6 +833,138 @@ Expr fast_exp(Expr x_full) {
     return result;
 }
 
+Expr fast_exp(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_exp only works for Float(32)";
+    if (max_ulp_error >= 85) {
+        return fast_exp(std::move(x));
+    } else {
+        return Internal::halide_exp(std::move(x));
+    }
+}
+
+Expr fast_log(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_log only works for Float(32)";
+    if (max_ulp_error >= 35) {
+        return fast_log(std::move(x));
+    } else {
+        return Internal::halide_log(std::move(x));
+    }
+}
+
+namespace {
+
+// sin(x) if is_cos is false, and cos(x) if it's true.
+Expr fast_sin_cos(const Expr &x_full, bool is_cos, int max_ulp_error) {
+    Type type = x_full.type();
+
+    // Reduce to r in [-pi/4, pi/4], with x = r + k*pi/2. pi/2 is split
+    // in three so that the first two products with k are exact.
+    Expr k_real = round(x_full * 0.63661977236758134308f);
+    Expr k = cast(Int(32, type.lanes()), k_real);
+    Expr r = x_full - k_real * 1.5703125f;
+    r -= k_real * 4.837512969970703125e-4f;
+    r -= k_real * 7.54978995489188216e-8f;
+    Expr r2 = r * r;
+
+    // Minimax polynomials for sin(r)/r and cos(r) in r^2.
+    Expr sin_r, cos_r;
+    if (max_ulp_error >= 28) {
+        float sin_coeff[] = {
+            0.00816328185050599435f,
+            -0.16663390373503198419f,
+            1.0f};
+        float cos_coeff[] = {
+            -0.0013648714247534156759f,
+            0.041661071300187013373f,
+            -0.5f,
+            1.0f};
+        sin_r = r * evaluate_polynomial(r2, sin_coeff, sizeof(sin_coeff)/sizeof(sin_coeff[0]));
+        cos_r = evaluate_polynomial(r2, cos_coeff, sizeof(cos_coeff)/sizeof(cos_coeff[0]));
+    } else {
+        float sin_coeff[] = {
+            -0.00019515283092737259503f,
+            0.0083321607609441076527f,
+            -0.16666654609528975541f,
+            1.0f};
+        float cos_coeff[] = {
+            2.4433156880602797075e-05f,
+            -0.0013887316252570239903f,
+            0.041666645682931966337f,
+            -0.5f,
+            1.0f};
+        sin_r = r * evaluate_polynomial(r2, sin_coeff, sizeof(sin_coeff)/sizeof(sin_coeff[0]));
+        cos_r = evaluate_polynomial(r2, cos_coeff, sizeof(cos_coeff)/sizeof(cos_coeff[0]));
+    }
+
+    // cos(x) = sin(x + pi/2). Which quadrant x lands in picks between
+    // sin and cos of r, and the sign.
+    if (is_cos) {
+        k += 1;
+    }
+    Expr result = select((k & 1) == 0, sin_r, cos_r);
+    result = select((k & 2) == 0, result, -result);
+    return common_subexpression_elimination(result);
+}
+
+}  // namespace
+
+Expr fast_sin(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_sin only works for Float(32)";
+    return fast_sin_cos(x, false, max_ulp_error);
+}
+
+Expr fast_cos(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_cos only works for Float(32)";
+    return fast_sin_cos(x, true, max_ulp_error);
+}
+
+Expr fast_tanh(Expr x, int max_ulp_error) {
+    user_assert(x.type() == Float(32)) << "fast_tanh only works for Float(32)";
+
+    // Near zero, use a minimax polynomial for tanh(x)/x in x^2, to
+    // avoid the cancellation in the formula below.
+    Expr x2 = x * x;
+    Expr small;
+    int exp_ulp_error;
+    if (max_ulp_error >= 55) {
+        float coeff[] = {
+            -0.040514747387747991056f,
+            0.13048276295807225187f,
+            -0.33315511646108834194f,
+            1.0f};
+        small = x * evaluate_polynomial(x2, coeff, sizeof(coeff)/sizeof(coeff[0]));
+        exp_ulp_error = 85;
+    } else if (max_ulp_error >= 10) {
+        float coeff[] = {
+            0.015195371027101529718f,
+            -0.051947902757240667557f,
+            0.13308175019347241582f,
+            -0.33332341239316139628f,
+            1.0f};
+        small = x * evaluate_polynomial(x2, coeff, sizeof(coeff)/sizeof(coeff[0]));
+        exp_ulp_error = 85;
+    } else {
+        float coeff[] = {
+            -0.0057049863340724751926f,
+            0.020639086574600191889f,
+            -0.053739714847973254543f,
+            0.13331442194778349861f,
+            -0.33333281941855027618f,
+            1.0f};
+        small = x * evaluate_polynomial(x2, coeff, sizeof(coeff)/sizeof(coeff[0]));
+        exp_ulp_error = 0;
+    }
+
+    // Elsewhere tanh(|x|) = 1 - 2/(exp(2|x|) + 1), which goes to one
+    // as exp overflows to infinity.
+    Expr e = fast_exp(2.0f * abs(x), exp_ulp_error);
+    Expr large = 1.0f - 2.0f / (e + 1.0f);
+    large = select(x < 0.0f, -large, large);
+
+    Expr result = select(abs(x) < 0.625f, small, large);
+    return common_subexpression_elimination(result);
+}
+
 Expr stringify(const std::vector<Expr> &args) {
     return Internal::Call::make(type_of<const char *>(), Internal::Call::stringify,
                                 args, Internal::Call::Intrinsic);
@@ -98,6 +98,7 @@ inline Expr make_const(Type t, uint8_t val)   {return make_const(t, (uint64_t)va
 inline Expr make_const(Type t, bool val)      {return make_const(t, (uint64_t)val);}
 inline Expr make_const(Type t, float val)     {return make_const(t, (double)val);}
 inline Expr make_const(Type t, float16_t val) {return make_const(t, (double)val);}
+inline Expr make_const(Type t, bfloat16_t val) {return make_const(t, (double)val);}
 // @}
 
 /** Check if a constant value can be correctly represented as the given type. */
@@ -1255,6 +1256,36 @@ Expr fast_log(Expr x);
  * approaching overflow. Vectorizes cleanly. */
 Expr fast_exp(Expr x);
 
+/** Cleanly vectorizable exp and log for Float(32) with a choice of
+ * precision. max_ulp_error is the largest error, in units in the last
+ * place of the result, that the caller is willing to accept. The
+ * cheapest approximation that meets it is used, or the most accurate
+ * one if none does. fast_exp(x) and fast_log(x) are within about 85
+ * and 35 ulp respectively, and the most accurate versions, which are
+ * what exp and log compile to on cpus, within about 3 ulp. */
+// @{
+Expr fast_exp(Expr x, int max_ulp_error);
+Expr fast_log(Expr x, int max_ulp_error);
+// @}
+
+/** Fast approximate cleanly vectorizable sin and cos for
+ * Float(32). The cheapest approximation whose error is within
+ * max_ulp_error units in the last place is used, or the most accurate
+ * one if none is. That is within 4 ulp for |x| < 100. The cheapest is
+ * within about 30 ulp. The error grows for |x| beyond a few thousand,
+ * where range reduction loses precision. Vectorizes cleanly. */
+// @{
+Expr fast_sin(Expr x, int max_ulp_error = 4);
+Expr fast_cos(Expr x, int max_ulp_error = 4);
+// @}
+
+/** Fast approximate cleanly vectorizable tanh for Float(32). The
+ * cheapest approximation whose error is within max_ulp_error units in
+ * the last place is used, or the most accurate one if none is. That
+ * is within 3 ulp. The cheaper ones are within about 10 and 55
+ * ulp. Vectorizes cleanly. */
+Expr fast_tanh(Expr x, int max_ulp_error = 4);
+
 /** Fast approximate cleanly vectorizable pow for Float(32). Returns
  * nonsense for x < 0.0f. Accurate up to the last 5 bits of the
  * mantissa for typical exponents. Gets worse when approaching
@@ -1299,7 +1330,7 @@ inline Expr floor(Expr x) {
     } else if (t.element_of() == Float(16)) {
         return Internal::Call::make(t, "floor_f16", {std::move(x)}, Internal::Call::PureExtern);
     } else {
-        t = t.with_code(Type::Float);
+        t = Float(32, t.lanes());
         return Internal::Call::make(t, "floor_f32", {cast(t, std::move(x))}, Internal::Call::PureExtern);
     }
 }
@@ -1316,7 +1347,7 @@ inline Expr ceil(Expr x) {
     } else if (x.type().element_of() == Float(16)) {
         return Internal::Call::make(t, "ceil_f16", {std::move(x)}, Internal::Call::PureExtern);
     } else {
-        t = t.with_code(Type::Float);
+        t = Float(32, t.lanes());
         return Internal::Call::make(t, "ceil_f32", {cast(t, std::move(x))}, Internal::Call::PureExtern);
     }
 }
@@ -1334,7 +1365,7 @@ inline Expr round(Expr x) {
     } else if (t.element_of() == Float(16)) {
         return Internal::Call::make(t, "round_f16", {std::move(x)}, Internal::Call::PureExtern);
     } else {
-        t = t.with_code(Type::Float);
+        t = Float(32, t.lanes());
         return Internal::Call::make(t, "round_f32", {cast(t, std::move(x))}, Internal::Call::PureExtern);
     }
 }
@@ -1350,7 +1381,7 @@ inline Expr trunc(Expr x) {
     } else if (t.element_of() == Float(16)) {
         return Internal::Call::make(t, "trunc_f16", {std::move(x)}, Internal::Call::PureExtern);
     } else {
-        t = t.with_code(Type::Float);
+        t = Float(32, t.lanes());
         return Internal::Call::make(t, "trunc_f32", {cast(t, std::move(x))}, Internal::Call::PureExtern);
     }
 }
@@ -1366,7 +1397,7 @@ inline Expr is_nan(Expr x) {
     } else if (x.type().element_of() == Float(16)) {
         return Internal::Call::make(t, "is_nan_f16", {std::move(x)}, Internal::Call::PureExtern);
     } else {
-        Type ft = x.type().with_code(Type::Float);
+        Type ft = Float(32, x.type().lanes());
         return Internal::Call::make(t, "is_nan_f32", {cast(ft, std::move(x))}, Internal::Call::PureExtern);
     }
 }
@@ -27,6 +27,9 @@ ostream &operator<<(ostream &out, const Type &type) {
     case Type::Float:
         out << "float";
         break;
+    case Type::BFloat:
+        out << "bfloat";
+        break;
     case Type::Handle:
         if (type.handle_type) {
             out << "(" << type.handle_type->inner_name.name << " *)";
@@ -103,6 +106,9 @@ ostream &operator<<(ostream &out, const DeviceAPI &api) {
     case DeviceAPI::D3D12Compute:
         out << "<D3D12Compute>";
         break;
+    case DeviceAPI::Vulkan:
+        out << "<Vulkan>";
+        break;
     }
     return out;
 }
@@ -145,6 +151,9 @@ std::ostream &operator<<(std::ostream &out, const TailStrategy &t) {
     case TailStrategy::ShiftInwards:
         out << "ShiftInwards";
         break;
+    case TailStrategy::Predicate:
+        out << "Predicate";
+        break;
     case TailStrategy::RoundUp:
         out << "RoundUp";
         break;
@@ -250,6 +259,9 @@ ostream &operator<<(ostream &out, const ForType &type) {
     case ForType::Unrolled:
         out << "unrolled";
         break;
+    case ForType::UnrolledAndJammed:
+        out << "unrolled_and_jammed";
+        break;
     case ForType::Vectorized:
         out << "vectorized";
         break;
@@ -671,6 +683,16 @@ void IRPrinter::visit(const Acquire *op) {
     stream << "}\n";
 }
 
+void IRPrinter::visit(const Atomic *op) {
+    do_indent();
+    stream << "atomic (" << op->producer_name << ") {\n";
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+    do_indent();
+    stream << "}\n";
+}
+
 void IRPrinter::visit(const Store *op) {
     do_indent();
     const bool has_pred = !is_one(op->predicate);
@@ -177,6 +177,10 @@ void IRVisitor::visit(const Acquire *op) {
     op->body.accept(this);
 }
 
+void IRVisitor::visit(const Atomic *op) {
+    op->body.accept(this);
+}
+
 void IRVisitor::visit(const Store *op) {
     op->predicate.accept(this);
     op->value.accept(this);
@@ -427,6 +431,10 @@ void IRGraphVisitor::visit(const Acquire *op) {
     include(op->body);
 }
 
+void IRGraphVisitor::visit(const Atomic *op) {
+    include(op->body);
+}
+
 void IRGraphVisitor::visit(const Store *op) {
     include(op->predicate);
     include(op->value);
@@ -93,4 +93,12 @@ ImageParam &ImageParam::add_trace_tag(const std::string &trace_tag) {
     return *this;
 }
 
+ImageParam &ImageParam::gpu_texture(bool hardware_filtering) {
+    user_assert(type() == Float(32) && dimensions() == 2)
+        << "Can't read ImageParam " << name() << " through GPU textures: "
+        << "only two-dimensional float images can be textures.\n";
+    param.set_gpu_texture(true, hardware_filtering);
+    return *this;
+}
+
 }  // namespace Halide
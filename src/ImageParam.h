@@ -129,6 +129,19 @@ public:
 
     /** Add a trace tag to this ImageParam's Func. */
     ImageParam &add_trace_tag(const std::string &trace_tag);
+
+    /** Read this image through the texture units in CUDA kernels. Each
+     * kernel that loads from it is passed a texture object viewing the
+     * buffer (see halide_cuda_buffer_texture), and the loads become
+     * texture fetches, which are cached with 2D locality. If
+     * hardware_filtering is true, sample_bilinear of this image is a
+     * single fetch that the texture unit filters, with weights of 8
+     * bits of precision; otherwise it is computed from four fetches.
+     * Only float images of two dimensions can be textures. If the
+     * buffer turns out not to meet the layout and alignment textures
+     * require, the kernels load from it as usual. Other GPU APIs and
+     * the CPU ignore this directive. */
+    ImageParam &gpu_texture(bool hardware_filtering = true);
 };
 
 }  // namespace Halide
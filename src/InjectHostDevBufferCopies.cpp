@@ -35,6 +35,7 @@ class FindBufferUsage : public IRVisitor {
         IRVisitor::visit(op);
         if (op->name == buffer) {
             devices_touched.insert(current_device_api);
+            devices_reading.insert(current_device_api);
         }
     }
 
@@ -56,6 +57,7 @@ class FindBufferUsage : public IRVisitor {
             internal_assert(op->args.size() >= 1);
             if (is_buffer_var(op->args[1])) {
                 devices_touched.insert(current_device_api);
+                devices_reading.insert(current_device_api);
             }
             for (size_t i = 0; i < op->args.size(); i++) {
                 if (i == 1) continue;
@@ -119,7 +121,7 @@ class FindBufferUsage : public IRVisitor {
     string buffer;
     DeviceAPI current_device_api;
 public:
-    std::set<DeviceAPI> devices_writing, devices_touched;
+    std::set<DeviceAPI> devices_reading, devices_writing, devices_touched;
     // Any buffer passed to an extern stage may have had its dirty
     // bits and device allocation messed with.
     std::set<DeviceAPI> devices_touched_by_extern;
@@ -331,9 +333,45 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator2 {
     // stmts, and possibly do copies and update state around each
     // leaf.
 
+    // Check if a stmt contains a hetero_split_merge marker for a
+    // given buffer.
+    class HasMergeMarker : public IRVisitor {
+        using IRVisitor::visit;
+        void visit(const Call *op) override {
+            if (op->is_intrinsic(Call::hetero_split_merge)) {
+                const StringImm *b = op->args[1].as<StringImm>();
+                result = result || (b && b->value == buffer);
+            }
+            IRVisitor::visit(op);
+        }
+        const string &buffer;
+    public:
+        bool result = false;
+        HasMergeMarker(const string &b) : buffer(b) {}
+    };
+
     Stmt visit(const For *op) override {
-        // All copies happen at the same loop level as the allocation.
-        return do_copies(op);
+        HasMergeMarker marker(buffer);
+        if (op->for_type == ForType::Serial &&
+            (op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host)) {
+            op->body.accept(&marker);
+        }
+        if (!marker.result) {
+            // All copies happen at the same loop level as the allocation.
+            return do_copies(op);
+        }
+
+        // A loop split by hetero_split has to be handled where it
+        // is. Go inside the serial loop around it, assuming nothing
+        // about the buffer at the start of each iteration.
+        State entry = state;
+        state.device_dirty = Unknown;
+        state.host_dirty = Unknown;
+        state.device_allocation_exists = Unknown;
+        state.current_device = DeviceAPI::None;
+        Stmt body = mutate(op->body);
+        state.union_with(entry);
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
     }
 
     Stmt visit(const Fork *op) override {
@@ -372,7 +410,109 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator2 {
         bool result = false;
     };
 
+    // Get the hetero_split_merge marker for this buffer in s, if it is one.
+    const Call *merge_marker(const Stmt &s) {
+        const Evaluate *e = s.as<Evaluate>();
+        const Call *c = e ? e->value.as<Call>() : nullptr;
+        if (c && c->is_intrinsic(Call::hetero_split_merge)) {
+            const StringImm *b = c->args[1].as<StringImm>();
+            internal_assert(b);
+            if (b->value == buffer) {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    // A loop split by hetero_split leaves a block of the form:
+    // device_loop; host_loop; ...; marker. If the host loop only
+    // writes the buffer, there is no need to copy the whole buffer to
+    // the host between the two loops, which would serialize them. The
+    // device loop's region is copied back at the marker instead.
+    Stmt merge_hetero_split(const vector<Stmt> &stmts, size_t marker_idx) {
+        const Call *marker = merge_marker(stmts[marker_idx]);
+        const StringImm *loop_name = marker->args[0].as<StringImm>();
+        internal_assert(loop_name);
+        size_t dims = (marker->args.size() - 2) / 2;
+
+        size_t device_idx = 0;
+        while (device_idx + 1 < marker_idx) {
+            const For *device_loop = stmts[device_idx].as<For>();
+            const For *host_loop = stmts[device_idx + 1].as<For>();
+            if (device_loop && host_loop &&
+                device_loop->name == loop_name->value &&
+                host_loop->name == loop_name->value) {
+                break;
+            }
+            device_idx++;
+        }
+
+        bool can_merge = device_idx + 1 < marker_idx;
+        if (can_merge) {
+            FindBufferUsage device_finder(buffer, DeviceAPI::Host);
+            stmts[device_idx].accept(&device_finder);
+            FindBufferUsage host_finder(buffer, DeviceAPI::Host);
+            stmts[device_idx + 1].accept(&host_finder);
+            can_merge = (!device_finder.devices_touched.count(DeviceAPI::Host) &&
+                         device_finder.devices_touched.size() == 1 &&
+                         device_finder.devices_writing.size() == 1 &&
+                         device_finder.devices_touched_by_extern.empty() &&
+                         host_finder.devices_reading.empty() &&
+                         host_finder.devices_touched_by_extern.empty() &&
+                         host_finder.devices_touched.size() == 1 &&
+                         host_finder.devices_touched.count(DeviceAPI::Host));
+        }
+
+        vector<Stmt> result;
+        for (size_t i = 0; i < stmts.size(); i++) {
+            if (can_merge && i == device_idx) {
+                // Any device-side changes must reach the host first,
+                // because only the region the device loop writes is
+                // copied back at the marker. This is a no-op at
+                // runtime unless the buffer is actually device dirty.
+                if (state.device_dirty != False) {
+                    result.push_back(make_copy_to_host());
+                    state.device_dirty = False;
+                }
+                result.push_back(do_copies(stmts[i]));
+            } else if (can_merge && i == device_idx + 1) {
+                // Runs concurrently with the device loop, so no copies
+                // or dirty bits here.
+                result.push_back(stmts[i]);
+            } else if (can_merge && i == marker_idx) {
+                vector<Expr> mins(marker->args.begin() + 2, marker->args.begin() + 2 + dims);
+                vector<Expr> extents(marker->args.begin() + 2 + dims, marker->args.end());
+                Stmt copy = Block::make(
+                    call_extern_and_assert("halide_copy_region_to_host",
+                                           {buffer_var(),
+                                            Call::make(type_of<int *>(), Call::make_struct, mins, Call::Intrinsic),
+                                            Call::make(type_of<int *>(), Call::make_struct, extents, Call::Intrinsic)}),
+                    make_host_dirty());
+                state.device_dirty = False;
+                state.host_dirty = True;
+                last_use = copy;
+                result.push_back(copy);
+            } else {
+                result.push_back(mutate(stmts[i]));
+            }
+        }
+        return Block::make(result);
+    }
+
     Stmt visit(const Block *op) override {
+        vector<Stmt> stmts;
+        Stmt s = op;
+        while (const Block *b = s.as<Block>()) {
+            stmts.push_back(b->first);
+            s = b->rest;
+        }
+        stmts.push_back(s);
+        for (size_t i = 0; i < stmts.size(); i++) {
+            if (merge_marker(stmts[i])) {
+                return merge_hetero_split(stmts, i);
+            }
+        }
+
         // If both sides of the block have no loops (and hence no
         // device transitions), treat it as a single leaf. This stops
         // host dirties from getting in between blocks of store stmts
@@ -537,9 +677,14 @@ class InjectBufferCopies : public IRMutator2 {
         string buffer_name = op->name + ".buffer";
         Expr buffer = Variable::make(Handle(), buffer_name);
 
+        // The host allocation of a memoized Func comes from the cache,
+        // which also keeps the device allocation of a result computed
+        // on a device, so it must be handed back rather than freed.
+        bool memoized = op->free_function == "halide_memoization_cache_release";
+
         // Device what type of allocation to make.
 
-        if (touched_on_host && finder.devices_touched.size() == 2) {
+        if (touched_on_host && finder.devices_touched.size() == 2 && !memoized) {
             // Touched on a single device and the host. Use a combined allocation.
             DeviceAPI touching_device = DeviceAPI::None;
             for (DeviceAPI d : finder.devices_touched) {
@@ -566,7 +711,8 @@ class InjectBufferCopies : public IRMutator2 {
 
             // Make a device_free stmt
             if (injector.last_use.defined()) {
-                Stmt device_free = call_extern_and_assert("halide_device_free", {buffer});
+                Stmt device_free = call_extern_and_assert(memoized ? "halide_memoization_cache_release_device" : "halide_device_free",
+                                                          {buffer});
                 body = FreeAfterLastUse(injector.last_use, device_free).mutate(body);
             }
 
@@ -685,6 +831,103 @@ public:
     InjectBufferCopiesForInputsAndOutputs(Stmt s) : site(s) {}
 };
 
+// Check if a stmt launches any kernels on the given device API.
+class UsesDeviceAPI : public IRVisitor {
+    using IRVisitor::visit;
+    void visit(const For *op) override {
+        if (op->device_api == api) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+    DeviceAPI api;
+public:
+    bool result = false;
+    UsesDeviceAPI(DeviceAPI api) : api(api) {}
+};
+
+bool uses_device_api(const Stmt &s, DeviceAPI api) {
+    UsesDeviceAPI uses(api);
+    s.accept(&uses);
+    return uses.result;
+}
+
+bool uses_cuda(const Stmt &s) {
+    return uses_device_api(s, DeviceAPI::CUDA);
+}
+
+// Remove any hetero_split_merge markers left over once all buffers
+// have been handled.
+class RemoveMergeMarkers : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Evaluate *op) override {
+        const Call *c = op->value.as<Call>();
+        if (c && c->is_intrinsic(Call::hetero_split_merge)) {
+            return Evaluate::make(0);
+        }
+        return op;
+    }
+};
+
+// When the CUDA runtime gives each thread its own stream, kernels
+// launched by different threads are not ordered with respect to each
+// other. Make each thread wait for the kernels it has launched before
+// it hands their results to another thread: before releasing a
+// semaphore, at the end of each branch of a fork or iteration of a
+// parallel loop, and before starting a fork or parallel loop that
+// launches kernels of its own.
+class InjectStreamFences : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // Are we in a fork branch that launches kernels?
+    bool in_cuda_branch = false;
+
+    Stmt fence() {
+        return call_extern_and_assert("halide_cuda_stream_fence", {});
+    }
+
+    Stmt fence_branch(const Stmt &s) {
+        if (!uses_cuda(s)) {
+            return mutate(s);
+        }
+        ScopedValue<bool> old_in_cuda_branch(in_cuda_branch, true);
+        return Block::make(mutate(s), fence());
+    }
+
+    Stmt visit(const Fork *op) override {
+        Stmt first = fence_branch(op->first);
+        Stmt rest = fence_branch(op->rest);
+        Stmt s = Fork::make(first, rest);
+        if (uses_cuda(s)) {
+            s = Block::make(fence(), s);
+        }
+        return s;
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api == DeviceAPI::CUDA) {
+            // A kernel launch. There are no threads of our own inside.
+            return op;
+        } else if (op->for_type == ForType::Parallel && uses_cuda(op->body)) {
+            Stmt body = fence_branch(op->body);
+            Stmt s = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            return Block::make(fence(), s);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        const Call *c = op->value.as<Call>();
+        if (in_cuda_branch && c && c->name == "halide_semaphore_release") {
+            return Block::make(fence(), op);
+        }
+        return op;
+    }
+};
+
 }  // namespace
 
 Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
@@ -700,6 +943,44 @@ Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
         s = InjectBufferCopiesForInputsAndOutputs(outermost.result).mutate(s);
     }
 
+    s = RemoveMergeMarkers().mutate(s);
+
+    if (t.has_feature(Target::CUDA) && uses_cuda(s)) {
+        s = InjectStreamFences().mutate(s);
+
+        // Let the runtime batch the kernel launches of the pipeline
+        // into CUDA graphs. The launches still queued at the end are
+        // issued on success, and the destructor ends the batch however
+        // the pipeline exits.
+        Expr dummy_obj = reinterpret(Handle(), cast<uint64_t>(1));
+        Expr end = Call::make(Int(32), Call::register_destructor,
+                              {Expr("halide_cuda_launch_graph_end"), dummy_obj}, Call::Intrinsic);
+        s = Block::make({call_extern_and_assert("halide_cuda_launch_graph_begin", {}),
+                         Evaluate::make(end),
+                         s,
+                         call_extern_and_assert("halide_cuda_launch_graph_flush", {})});
+    }
+
+    if (t.has_feature(Target::Metal) && uses_device_api(s, DeviceAPI::Metal)) {
+        // The Metal runtime batches the commands of the pipeline into
+        // one command buffer. Commit whatever is left in it however the
+        // pipeline exits, so that the work runs even if nothing waits
+        // for it.
+        Expr dummy_obj = reinterpret(Handle(), cast<uint64_t>(1));
+        Expr commit = Call::make(Int(32), Call::register_destructor,
+                                 {Expr("halide_metal_commit_command_buffer"), dummy_obj}, Call::Intrinsic);
+        s = Block::make(Evaluate::make(commit), s);
+    }
+
+    if (t.has_feature(Target::Vulkan) && uses_device_api(s, DeviceAPI::Vulkan)) {
+        // Likewise for the command buffer the Vulkan runtime records
+        // into.
+        Expr dummy_obj = reinterpret(Handle(), cast<uint64_t>(1));
+        Expr commit = Call::make(Int(32), Call::register_destructor,
+                                 {Expr("halide_vulkan_commit_command_buffer"), dummy_obj}, Call::Intrinsic);
+        s = Block::make(Evaluate::make(commit), s);
+    }
+
     return s;
 }
 
@@ -6,10 +6,16 @@
 #include "LLVM_Headers.h"
 #include "Error.h"
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <set>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // defines backtrace, which gets the call stack as instruction pointers
 #include <execinfo.h>
@@ -48,6 +54,43 @@ inline T load_misaligned(const T *p) {
     return result;
 }
 
+// From the dwarf 4 spec
+const unsigned tag_array_type = 0x01;
+const unsigned tag_class_type = 0x02;
+const unsigned tag_lexical_block = 0x0b;
+const unsigned tag_member = 0x0d;
+const unsigned tag_pointer_type = 0x0f;
+const unsigned tag_reference_type = 0x10;
+const unsigned tag_compile_unit = 0x11;
+const unsigned tag_structure_type = 0x13;
+const unsigned tag_typedef = 0x16;
+const unsigned tag_inlined_subroutine = 0x1d;
+const unsigned tag_subrange_type = 0x21;
+const unsigned tag_base_type = 0x24;
+const unsigned tag_const_type = 0x26;
+const unsigned tag_function = 0x2e;
+const unsigned tag_variable = 0x34;
+const unsigned tag_namespace = 0x39;
+
+const unsigned attr_location = 0x02;
+const unsigned attr_name = 0x03;
+const unsigned attr_byte_size = 0x0b;
+const unsigned attr_stmt_list = 0x10;
+const unsigned attr_low_pc = 0x11;
+const unsigned attr_high_pc = 0x12;
+const unsigned attr_upper_bound = 0x2f;
+const unsigned attr_abstract_origin = 0x31;
+const unsigned attr_count = 0x37;
+const unsigned attr_data_member_location = 0x38;
+const unsigned attr_frame_base = 0x40;
+const unsigned attr_specification = 0x47;
+const unsigned attr_type = 0x49;
+const unsigned attr_ranges = 0x55;
+
+// A constant to use indicating that we don't know the stack
+// offset of a variable.
+const int no_location = 0x80000000;
+
 }
 
 class DebugSections {
@@ -169,13 +212,70 @@ class DebugSections {
 
         TypeInfo() : size(0), def_loc(0), type(Primitive) {}
     };
-    vector<TypeInfo> types;
+    // A deque, so that the TypeInfo pointers held by the functions,
+    // variables and heap objects survive loading more units.
+    std::deque<TypeInfo> types;
+
+    // The debug info is parsed one compilation unit at a time, when a
+    // query first touches an address the unit covers. The index below
+    // says which units cover which addresses. It is built by a quick
+    // pass over the debug info that keeps no names or types, and is
+    // cached on disk between runs. All addresses in it are as they
+    // appear in the debug info, i.e. before adjusting by pc_adjust.
+    struct CompileUnit {
+        uint64_t offset;       // Of the unit header in .debug_info
+        uint64_t line_offset;  // Of the line program in .debug_line, or -1
+    };
+    vector<CompileUnit> units;
+    vector<bool> unit_loaded;
+
+    struct UnitRange {
+        uint64_t pc_begin, pc_end;
+        uint64_t unit;
+        bool operator<(const UnitRange &other) const {
+            return pc_begin < other.pc_begin;
+        }
+    };
+    vector<UnitRange> unit_ranges;
+
+    struct UnitGlobal {
+        uint64_t addr;
+        uint64_t unit;
+        bool operator<(const UnitGlobal &other) const {
+            return addr < other.addr;
+        }
+    };
+    vector<UnitGlobal> unit_globals;
+
+    // The addresses of each copy of HalideIntrospectionCanary::offset_marker
+    vector<uint64_t> canary_pcs;
+
+    // The offset between addresses in the debug info and addresses in
+    // memory, once calibrated.
+    int64_t pc_adjust;
+
+    // The binary, kept mapped so that units can be parsed straight out
+    // of its debug sections when needed.
+    llvm::object::OwningBinary<llvm::object::ObjectFile> object_file;
+    llvm::StringRef debug_info, debug_abbrev, debug_str, debug_line, debug_ranges;
+    uint8_t bytes_in_address;
+    uint64_t binary_size, binary_mtime;
+
+    // The fields of a compilation unit header needed to parse the
+    // entries in it.
+    struct UnitHeader {
+        uint64_t start_of_unit_header, start_of_unit, unit_length;
+        bool dwarf_64;
+        uint16_t dwarf_version;
+        uint8_t address_size;
+    };
 
 public:
 
     bool working;
 
-    DebugSections(std::string binary) : calibrated(false), working(false) {
+    DebugSections(std::string binary) : calibrated(false), pc_adjust(0), bytes_in_address(8),
+                                        binary_size(0), binary_mtime(0), working(false) {
         #ifdef __APPLE__
         size_t last_slash = binary.rfind('/');
         if (last_slash == std::string::npos ||
@@ -205,35 +305,33 @@ public:
     void calibrate_pc_offset(void (*fn)()) {
         // Calibrate for the offset between the instruction pointers
         // in the debug info and the instruction pointers in the
-        // actual file.
+        // actual file. Each compilation unit that includes Halide.h
+        // has its own copy of the marker, and the index knows where
+        // all of them are, so this doesn't need to load any units.
         bool found = false;
         uint64_t pc_real = (uint64_t)fn;
-        int64_t pc_adjust = 0;
-        for (size_t i = 0; i < functions.size(); i++) {
-            if (functions[i].name == "HalideIntrospectionCanary::offset_marker" &&
-                functions[i].pc_begin) {
-
-                uint64_t pc_debug = functions[i].pc_begin;
-
-                if (calibrated) {
-                    // If we're already calibrated, we should find a function with a matching pc
-                    if (pc_debug == pc_real) {
-                        return;
-                    }
-                } else {
-                    int64_t pc_adj = pc_real - pc_debug;
+        int64_t pc_adj_best = 0;
+        for (size_t i = 0; i < canary_pcs.size(); i++) {
+            uint64_t pc_debug = canary_pcs[i];
+
+            if (calibrated) {
+                // If we're already calibrated, we should find a marker with a matching pc
+                if (pc_debug + pc_adjust == pc_real) {
+                    return;
+                }
+            } else {
+                int64_t pc_adj = pc_real - pc_debug;
 
-                    // Offset must be a multiple of 4096
-                    if (pc_adj & (4095)) {
-                        continue;
-                    }
+                // Offset must be a multiple of 4096
+                if (pc_adj & (4095)) {
+                    continue;
+                }
 
-                    // If we find multiple matches, pick the one with more trailing zeros
-                    if (!found ||
-                        count_trailing_zeros(pc_adj) > count_trailing_zeros(pc_adjust)) {
-                        pc_adjust = pc_adj;
-                        found = true;
-                    }
+                // If we find multiple matches, pick the one with more trailing zeros
+                if (!found ||
+                    count_trailing_zeros(pc_adj) > count_trailing_zeros(pc_adj_best)) {
+                    pc_adj_best = pc_adj;
+                    found = true;
                 }
             }
         }
@@ -248,33 +346,41 @@ public:
             return;
         }
 
-        debug(5) << "Program counter adjustment between debug info and actual code: " << pc_adjust << "\n";
+        debug(5) << "Program counter adjustment between debug info and actual code: " << pc_adj_best << "\n";
 
-        for (size_t i = 0; i < functions.size(); i++) {
+        // Adjust anything loaded so far. Units loaded later are
+        // adjusted as they are loaded.
+        adjust_pcs(0, 0, 0, pc_adj_best);
+        pc_adjust = pc_adj_best;
+
+        calibrated = true;
+    }
+
+    void adjust_pcs(size_t first_function, size_t first_line, size_t first_global, int64_t adjust) {
+        for (size_t i = first_function; i < functions.size(); i++) {
             FunctionInfo &f = functions[i];
-            f.pc_begin += pc_adjust;
-            f.pc_end += pc_adjust;
+            f.pc_begin += adjust;
+            f.pc_end += adjust;
             for (size_t j = 0; j < f.variables.size(); j++) {
                 LocalVariable &v = f.variables[j];
                 for (size_t k = 0; k < v.live_ranges.size(); k++) {
-                    v.live_ranges[k].pc_begin += pc_adjust;
-                    v.live_ranges[k].pc_end += pc_adjust;
+                    v.live_ranges[k].pc_begin += adjust;
+                    v.live_ranges[k].pc_end += adjust;
                 }
             }
         }
 
-        for (size_t i = 0; i < source_lines.size(); i++) {
-            source_lines[i].pc += pc_adjust;
+        for (size_t i = first_line; i < source_lines.size(); i++) {
+            source_lines[i].pc += adjust;
         }
 
-        for (size_t i = 0; i < global_variables.size(); i++) {
-            global_variables[i].addr += pc_adjust;
+        for (size_t i = first_global; i < global_variables.size(); i++) {
+            global_variables[i].addr += adjust;
         }
-
-        calibrated = true;
     }
 
     int find_global_variable(const void *global_pointer) {
+        load_unit_with_global((uint64_t)global_pointer);
         if (global_variables.empty()) {
             debug(5) << "Considering possible global at " << global_pointer << " but global_variables is empty\n";
             return -1;
@@ -723,11 +829,6 @@ public:
     std::string get_source_location() {
         debug(5) << "Finding source location\n";
 
-        if (!source_lines.size()) {
-            debug(5) << "Bailing out because we have no source lines\n";
-            return "";
-        }
-
         const int max_stack_frames = 256;
 
         // Get the backtrace
@@ -772,6 +873,11 @@ public:
                 continue;
             }
 
+            if (source_lines.empty()) {
+                debug(5) << "Bailing out because we have no source lines\n";
+                return "";
+            }
+
             // Binary search into source_lines
             size_t hi = source_lines.size();
             size_t lo = 0;
@@ -899,7 +1005,9 @@ private:
     void load_and_parse_object_file(const std::string &binary) {
         llvm::object::ObjectFile *obj = nullptr;
 
-        // Open the object file in question.
+        // Open the object file in question. The file is memory-mapped,
+        // and kept open so that the debug sections can be parsed in
+        // place as units are needed.
         llvm::Expected<llvm::object::OwningBinary<llvm::object::ObjectFile>> maybe_obj =
             llvm::object::ObjectFile::createObjectFile(binary);
 
@@ -909,21 +1017,20 @@ private:
             return;
         }
 
-        obj = maybe_obj.get().getBinary();
+        object_file = std::move(maybe_obj.get());
+        obj = object_file.getBinary();
 
         if (obj) {
             working = true;
-            parse_object_file(obj);
+            parse_object_file(obj, binary);
         } else {
             debug(1) << "Could not load object file: " << binary << "\n";
             working = false;
         }
     }
 
-    void parse_object_file(llvm::object::ObjectFile *obj) {
+    void parse_object_file(llvm::object::ObjectFile *obj, const std::string &binary) {
         // Look for the debug_info, debug_abbrev, debug_line, and debug_str sections
-        llvm::StringRef debug_info, debug_abbrev, debug_str, debug_line, debug_ranges;
-
 #ifdef __APPLE__
         std::string prefix = "__";
 #else
@@ -958,16 +1065,232 @@ private:
             return;
         }
 
-        {
-            // Parse the debug_info section to populate the functions and local variables
-            llvm::DataExtractor extractor(debug_info, true, obj->getBytesInAddress());
-            llvm::DataExtractor debug_abbrev_extractor(debug_abbrev, true, obj->getBytesInAddress());
-            parse_debug_info(extractor, debug_abbrev_extractor, debug_str, debug_ranges);
+        bytes_in_address = obj->getBytesInAddress();
+
+        struct stat st;
+        if (stat(binary.c_str(), &st) == 0) {
+            binary_size = st.st_size;
+            binary_mtime = st.st_mtime;
         }
 
-        {
-            llvm::DataExtractor e(debug_line, true, obj->getBytesInAddress());
-            parse_debug_line(e);
+        std::string cache_path = index_cache_path(binary);
+        if (!read_index_cache(cache_path)) {
+            build_index();
+            write_index_cache(cache_path);
+        }
+        unit_loaded.assign(units.size(), false);
+    }
+
+    // Find the extent of each compilation unit, the addresses of the
+    // global variables in it, and the copies of the introspection
+    // canary in it, without keeping anything else.
+    void build_index() {
+        llvm::DataExtractor e(debug_info, true, bytes_in_address);
+        llvm::DataExtractor abbrev_e(debug_abbrev, true, bytes_in_address);
+
+        uint32_t off = 0;
+        while (off < debug_info.size()) {
+            UnitHeader h;
+            if (!read_unit_header(e, abbrev_e, off, h)) {
+                break;
+            }
+            const uint64_t unit = units.size();
+            CompileUnit cu = {h.start_of_unit_header, (uint64_t)(-1)};
+
+            uint64_t unit_low_pc = 0, unit_high_pc = 0, unit_ranges_offset = (uint64_t)(-1);
+            bool high_pc_is_size = false;
+            bool in_canary_namespace = false;
+            // Declarations of the canary, for definitions elsewhere in the unit that refer to them
+            std::set<uint64_t> canary_decls;
+            vector<pair<bool, int>> namespace_stack;
+            int stack_depth = 0;
+
+            while (off - h.start_of_unit < h.unit_length) {
+                uint64_t location = off;
+                uint64_t abbrev_code = e.getULEB128(&off);
+                if (abbrev_code == 0) {
+                    if (namespace_stack.size() &&
+                        stack_depth == namespace_stack.back().second) {
+                        namespace_stack.pop_back();
+                        in_canary_namespace = namespace_stack.size() && namespace_stack.back().first;
+                    }
+                    stack_depth--;
+                    continue;
+                }
+
+                if (abbrev_code > entry_formats.size()) {
+                    debug(2) << "Bad abbreviation code in debug_info\n";
+                    break;
+                }
+                const EntryFormat &fmt = entry_formats[abbrev_code-1];
+                if (fmt.has_children) {
+                    stack_depth++;
+                }
+
+                const char *name = nullptr;
+                uint64_t low_pc = 0, spec_loc = 0, global_addr = 0;
+                for (size_t i = 0; i < fmt.fields.size(); i++) {
+                    uint64_t val = 0;
+                    const uint8_t *payload = nullptr;
+                    read_field(e, h, fmt.fields[i].form, off, val, payload);
+                    unsigned attr = fmt.fields[i].name;
+                    if (attr == attr_name) {
+                        name = (const char *)payload;
+                    } else if (fmt.tag == tag_compile_unit) {
+                        if (attr == attr_low_pc) {
+                            unit_low_pc = val;
+                        } else if (attr == attr_high_pc) {
+                            unit_high_pc = val;
+                            high_pc_is_size = fmt.fields[i].form != 0x1;
+                        } else if (attr == attr_ranges) {
+                            unit_ranges_offset = val;
+                        } else if (attr == attr_stmt_list) {
+                            cu.line_offset = val;
+                        }
+                    } else if (fmt.tag == tag_function && attr == attr_low_pc) {
+                        low_pc = val;
+                    } else if (fmt.tag == tag_function && attr == attr_specification) {
+                        spec_loc = val;
+                    } else if (fmt.tag == tag_variable && attr == attr_location &&
+                               payload && payload[0] == 0x03 && val == (sizeof(void *) + 1)) {
+                        global_addr = (uint64_t)load_misaligned((const void * const *)(payload + 1));
+                    }
+                }
+
+                if (fmt.tag == tag_namespace && fmt.has_children) {
+                    bool is_canary = name && std::string(name) == "HalideIntrospectionCanary";
+                    namespace_stack.push_back({ is_canary, stack_depth });
+                    in_canary_namespace = is_canary;
+                } else if (fmt.tag == tag_function && in_canary_namespace &&
+                           name && std::string(name) == "offset_marker") {
+                    if (low_pc) {
+                        canary_pcs.push_back(low_pc);
+                    } else {
+                        canary_decls.insert(location);
+                    }
+                } else if (fmt.tag == tag_function && low_pc && spec_loc &&
+                           canary_decls.count(spec_loc)) {
+                    canary_pcs.push_back(low_pc);
+                } else if (fmt.tag == tag_variable && global_addr) {
+                    UnitGlobal g = {global_addr, unit};
+                    unit_globals.push_back(g);
+                }
+            }
+
+            if (unit_ranges_offset < debug_ranges.size()) {
+                // It's an array of addresses relative to the low pc of the unit
+                const void * const * ptr = (const void * const *)(debug_ranges.data() + unit_ranges_offset);
+                const void * const * end = (const void * const *)(debug_ranges.data() + debug_ranges.size());
+                while (load_misaligned(ptr) && ptr < end-1) {
+                    UnitRange r = {(uint64_t)load_misaligned(ptr) + unit_low_pc,
+                                   (uint64_t)load_misaligned(ptr+1) + unit_low_pc,
+                                   unit};
+                    unit_ranges.push_back(r);
+                    ptr += 2;
+                }
+            } else if (unit_low_pc) {
+                UnitRange r = {unit_low_pc, high_pc_is_size ? unit_low_pc + unit_high_pc : unit_high_pc, unit};
+                unit_ranges.push_back(r);
+            }
+
+            units.push_back(cu);
+            off = h.start_of_unit + h.unit_length;
+        }
+
+        std::sort(unit_ranges.begin(), unit_ranges.end());
+        std::sort(unit_globals.begin(), unit_globals.end());
+
+        debug(5) << "Indexed " << units.size() << " compilation units\n";
+    }
+
+    // The index is cached in a file named after the binary, in the
+    // directory given by HL_INTROSPECTION_CACHE_DIR, or the temp
+    // directory. The file records the size and modification time of
+    // the binary, so a rebuilt binary is indexed again.
+    struct IndexCacheHeader {
+        char magic[8];
+        uint64_t binary_size, binary_mtime, debug_info_size;
+        uint64_t num_units, num_ranges, num_globals, num_canaries;
+    };
+
+    std::string index_cache_path(const std::string &binary) {
+        std::string dir = get_env_variable("HL_INTROSPECTION_CACHE_DIR");
+        if (dir.empty()) {
+            dir = "/tmp";
+        }
+        std::ostringstream oss;
+        oss << dir << "/halide_introspection_" << std::hex << std::hash<std::string>()(binary) << ".index";
+        return oss.str();
+    }
+
+    template<typename T>
+    bool read_array(FILE *f, vector<T> &v, uint64_t n) {
+        v.resize(n);
+        return n == 0 || fread(v.data(), sizeof(T), n, f) == n;
+    }
+
+    template<typename T>
+    bool write_array(FILE *f, const vector<T> &v) {
+        return v.empty() || fwrite(v.data(), sizeof(T), v.size(), f) == v.size();
+    }
+
+    bool read_index_cache(const std::string &path) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) {
+            return false;
+        }
+        IndexCacheHeader header;
+        bool ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+                   memcmp(header.magic, "HLINTRO1", 8) == 0 &&
+                   header.binary_size == binary_size &&
+                   header.binary_mtime == binary_mtime &&
+                   header.debug_info_size == debug_info.size() &&
+                   read_array(f, units, header.num_units) &&
+                   read_array(f, unit_ranges, header.num_ranges) &&
+                   read_array(f, unit_globals, header.num_globals) &&
+                   read_array(f, canary_pcs, header.num_canaries));
+        fclose(f);
+        if (ok) {
+            debug(5) << "Read introspection index from " << path << "\n";
+        } else {
+            units.clear();
+            unit_ranges.clear();
+            unit_globals.clear();
+            canary_pcs.clear();
+        }
+        return ok;
+    }
+
+    void write_index_cache(const std::string &path) {
+        if (!binary_size) {
+            return;
+        }
+        IndexCacheHeader header;
+        memcpy(header.magic, "HLINTRO1", 8);
+        header.binary_size = binary_size;
+        header.binary_mtime = binary_mtime;
+        header.debug_info_size = debug_info.size();
+        header.num_units = units.size();
+        header.num_ranges = unit_ranges.size();
+        header.num_globals = unit_globals.size();
+        header.num_canaries = canary_pcs.size();
+
+        // Write to a temporary file and rename it into place, so that
+        // processes starting at the same time never see half an index.
+        std::string tmp_path = path + "." + std::to_string(getpid());
+        FILE *f = fopen(tmp_path.c_str(), "wb");
+        if (!f) {
+            debug(2) << "Could not write introspection index to " << path << "\n";
+            return;
+        }
+        bool ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+                   write_array(f, units) &&
+                   write_array(f, unit_ranges) &&
+                   write_array(f, unit_globals) &&
+                   write_array(f, canary_pcs));
+        ok = (fclose(f) == 0) && ok;
+        if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+            remove(tmp_path.c_str());
         }
     }
 
@@ -1002,51 +1325,320 @@ private:
         }
     }
 
-    void parse_debug_info(const llvm::DataExtractor &e,
-                          const llvm::DataExtractor &debug_abbrev,
-                          llvm::StringRef debug_str,
-                          llvm::StringRef debug_ranges) {
-        // Offset into the section
-        uint32_t off = 0;
+    // Parse the given units of the debug_info section to populate the
+    // functions and variables, and their line programs to populate
+    // the source lines.
+    void load_units(const vector<uint64_t> &to_load) {
+        vector<uint64_t> to_parse;
+        for (uint64_t u : to_load) {
+            if (!unit_loaded[u]) {
+                unit_loaded[u] = true;
+                to_parse.push_back(u);
+            }
+        }
+        if (to_parse.empty()) {
+            return;
+        }
 
-        llvm::StringRef debug_info = e.getData();
+        size_t first_function = functions.size();
+        size_t first_type = types.size();
+        size_t first_global = global_variables.size();
+        size_t first_line = source_lines.size();
 
-        // A constant to use indicating that we don't know the stack
-        // offset of a variable.
-        const int no_location = 0x80000000;
+        llvm::DataExtractor e(debug_info, true, bytes_in_address);
+        llvm::DataExtractor abbrev_e(debug_abbrev, true, bytes_in_address);
+        parse_debug_info(e, abbrev_e, to_parse, first_function, first_type, first_global);
 
-        while (1) {
-            uint64_t start_of_unit_header = off;
-
-            // Parse compilation unit header
-            bool dwarf_64;
-            uint64_t unit_length = e.getU32(&off);
-            if (unit_length == 0xffffffff) {
-                dwarf_64 = true;
-                unit_length = e.getU64(&off);
-            } else {
-                dwarf_64 = false;
+        llvm::DataExtractor line_e(debug_line, true, bytes_in_address);
+        for (uint64_t u : to_parse) {
+            if (units[u].line_offset < debug_line.size()) {
+                parse_debug_line(line_e, units[u].line_offset);
+            }
+        }
+
+        if (calibrated) {
+            adjust_pcs(first_function, first_line, first_global, pc_adjust);
+        }
+
+        // Sort the functions list by program counter
+        std::sort(functions.begin(), functions.end());
+
+        // Sort the global variables by address
+        std::sort(global_variables.begin(), global_variables.end());
+
+        // Sort the sequences by low PC to make searching into it faster.
+        std::sort(source_lines.begin(), source_lines.end());
+
+        debug(5) << "Loaded " << to_parse.size() << " of " << units.size() << " compilation units\n";
+    }
+
+    // Load the unit with the code at the given address, if any.
+    void load_unit_with_pc(uint64_t pc) {
+        uint64_t debug_pc = pc - pc_adjust;
+        UnitRange key = {debug_pc, debug_pc, 0};
+        vector<UnitRange>::iterator it = std::upper_bound(unit_ranges.begin(), unit_ranges.end(), key);
+        if (it != unit_ranges.begin()) {
+            --it;
+            if (debug_pc < it->pc_end) {
+                load_units({it->unit});
             }
+        }
+    }
 
-            if (!unit_length) {
-                // A zero-length compilation unit indicates the end of
-                // the list.
+    // Load the units with the global variable at or just below the
+    // given address, which is the one it must be in if it's in any.
+    void load_unit_with_global(uint64_t addr) {
+        uint64_t debug_addr = addr - pc_adjust;
+        UnitGlobal key = {debug_addr, 0};
+        vector<UnitGlobal>::iterator it = std::upper_bound(unit_globals.begin(), unit_globals.end(), key);
+        if (it == unit_globals.begin()) {
+            return;
+        }
+        --it;
+        vector<uint64_t> to_load;
+        uint64_t closest = it->addr;
+        while (it->addr == closest) {
+            to_load.push_back(it->unit);
+            if (it == unit_globals.begin()) {
                 break;
             }
+            --it;
+        }
+        load_units(to_load);
+    }
+
+    // Read the header of the unit at the given offset, and the
+    // abbreviations it uses. Returns false at the end of the list.
+    bool read_unit_header(const llvm::DataExtractor &e,
+                          const llvm::DataExtractor &debug_abbrev,
+                          uint32_t &off, UnitHeader &h) {
+        h.start_of_unit_header = off;
+
+        // Parse compilation unit header
+        h.unit_length = e.getU32(&off);
+        if (h.unit_length == 0xffffffff) {
+            h.dwarf_64 = true;
+            h.unit_length = e.getU64(&off);
+        } else {
+            h.dwarf_64 = false;
+        }
+
+        if (!h.unit_length) {
+            // A zero-length compilation unit indicates the end of
+            // the list.
+            return false;
+        }
+
+        h.start_of_unit = off;
 
-            uint64_t start_of_unit = off;
+        h.dwarf_version = e.getU16(&off);
+
+        uint64_t debug_abbrev_offset = 0;
+        if (h.dwarf_64) {
+            debug_abbrev_offset = e.getU64(&off);
+        } else {
+            debug_abbrev_offset = e.getU32(&off);
+        }
+        parse_debug_abbrev(debug_abbrev, debug_abbrev_offset);
+
+        h.address_size = e.getU8(&off);
+        return true;
+    }
 
-            uint16_t dwarf_version = e.getU16(&off);
+    // Read the value of one field of an entry.
+    void read_field(const llvm::DataExtractor &e, const UnitHeader &h, uint64_t form,
+                    uint32_t &off, uint64_t &val, const uint8_t *&payload) {
+        const uint64_t start_of_unit_header = h.start_of_unit_header;
+        const bool dwarf_64 = h.dwarf_64;
+        const uint16_t dwarf_version = h.dwarf_version;
+        const uint8_t address_size = h.address_size;
 
-            uint64_t debug_abbrev_offset = 0;
+        switch(form) {
+        case 1: // addr (4 or 8 bytes)
+        {
+            if (address_size == 4) {
+                val = e.getU32(&off);
+            } else {
+                val = e.getU64(&off);
+            }
+            break;
+        }
+        case 2: // There is no case 2
+        {
+            assert(false && "What's form 2?");
+            break;
+        }
+        case 3: // block2 (2 byte length followed by payload)
+        {
+            val = e.getU16(&off);
+            payload = (const uint8_t *)(debug_info.data() + off);
+            off += val;
+            break;
+        }
+        case 4: // block4 (4 byte length followed by payload)
+        {
+            val = e.getU32(&off);
+            payload = (const uint8_t *)(debug_info.data() + off);
+            off += val;
+            break;
+        }
+        case 5: // data2 (2 bytes)
+        {
+            val = e.getU16(&off);
+            break;
+        }
+        case 6: // data4 (4 bytes)
+        {
+            val = e.getU32(&off);
+            break;
+        }
+        case 7: // data8 (8 bytes)
+        {
+            val = e.getU64(&off);
+            break;
+        }
+        case 8: // string (null terminated sequence of bytes)
+        {
+            val = 0;
+            payload = (const uint8_t *)(debug_info.data() + off);
+            while (e.getU8(&off));
+            break;
+        }
+        case 9: // block (uleb128 length followed by payload)
+        {
+            val = e.getULEB128(&off);
+            payload = (const uint8_t *)(debug_info.data() + off);
+            off += val;
+            break;
+        }
+        case 10: // block1 (1 byte length followed by payload)
+        {
+            val = e.getU8(&off);
+            payload = (const uint8_t *)(debug_info.data() + off);
+            off += val;
+            break;
+        }
+        case 11: // data1 (1 byte)
+        {
+            val = e.getU8(&off);
+            break;
+        }
+        case 12: // flag (1 byte)
+        {
+            val = e.getU8(&off);
+            break;
+        }
+        case 13: // sdata (sleb128 constant)
+        {
+            val = (uint64_t)e.getSLEB128(&off);
+            break;
+        }
+        case 14: // strp (offset into debug_str section. 4 bytes in dwarf 32, 8 in dwarf 64)
+        {
+            uint64_t offset;
+            if (dwarf_64) {
+                offset = e.getU64(&off);
+            } else {
+                offset = e.getU32(&off);
+            }
+            val = 0;
+            payload = (const uint8_t *)(debug_str.data() + offset);
+            break;
+        }
+        case 15: // udata (uleb128 constant)
+        {
+            val = e.getULEB128(&off);
+            break;
+        }
+        case 16: // ref_addr (offset from beginning of debug_info. 4 bytes in dwarf 32, 8 in dwarf 64)
+        {
+            if ((dwarf_version <= 2 && address_size == 8) ||
+                (dwarf_version > 2 && dwarf_64)) {
+                val = e.getU64(&off);
+            } else {
+                val = e.getU32(&off);
+            }
+            break;
+        }
+        case 17: // ref1 (1 byte offset from the first byte of the compilation unit header)
+        {
+            val = e.getU8(&off) + start_of_unit_header;
+            break;
+        }
+        case 18: // ref2 (2 byte version of the same)
+        {
+            val = e.getU16(&off) + start_of_unit_header;
+            break;
+        }
+        case 19: // ref4 (4 byte version of the same)
+        {
+            val = e.getU32(&off) + start_of_unit_header;
+            break;
+        }
+        case 20: // ref8 (8 byte version of the same)
+        {
+            val = e.getU64(&off) + start_of_unit_header;
+            break;
+        }
+        case 21: // ref_udata (uleb128 version of the same)
+        {
+            val = e.getULEB128(&off) + start_of_unit_header;
+            break;
+        }
+        case 22: // indirect
+        {
+            assert(false && "Can't handle indirect form");
+            break;
+        }
+        case 23: // sec_offset
+        {
             if (dwarf_64) {
-                debug_abbrev_offset = e.getU64(&off);
+                val = e.getU64(&off);
             } else {
-                debug_abbrev_offset = e.getU32(&off);
+                val = e.getU32(&off);
             }
-            parse_debug_abbrev(debug_abbrev, debug_abbrev_offset);
+            break;
+        }
+        case 24: // exprloc
+        {
+            // Length
+            val = e.getULEB128(&off);
+            // Payload (contains a DWARF expression to evaluate (ugh))
+            payload = (const uint8_t *)(debug_info.data() + off);
+            off += val;
+            break;
+        }
+        case 25: // flag_present
+        {
+            val = 0;
+            // Just the existence of this field is information apparently? There's no data.
+            break;
+        }
+        case 32: // ref_sig8
+        {
+            // 64-bit type signature for a reference in its own type unit
+            val = e.getU64(&off);
+            break;
+        }
+        default:
+            assert(false && "Unknown form");
+            break;
+        }
+    }
 
-            uint8_t address_size = e.getU8(&off);
+    void parse_debug_info(const llvm::DataExtractor &e,
+                          const llvm::DataExtractor &debug_abbrev,
+                          const vector<uint64_t> &to_parse,
+                          size_t first_function, size_t first_type, size_t first_global) {
+        for (uint64_t u : to_parse) {
+            uint32_t off = units[u].offset;
+            UnitHeader h;
+            if (!read_unit_header(e, debug_abbrev, off, h)) {
+                continue;
+            }
+            const uint64_t start_of_unit = h.start_of_unit;
+            const uint64_t unit_length = h.unit_length;
+            const uint8_t address_size = h.address_size;
 
             vector<pair<FunctionInfo, int>> func_stack;
             vector<pair<TypeInfo, int>> type_stack;
@@ -1057,38 +1649,6 @@ private:
 
             uint64_t compile_unit_base_pc = 0;
 
-            // From the dwarf 4 spec
-            const unsigned tag_array_type = 0x01;
-            const unsigned tag_class_type = 0x02;
-            const unsigned tag_lexical_block = 0x0b;
-            const unsigned tag_member = 0x0d;
-            const unsigned tag_pointer_type = 0x0f;
-            const unsigned tag_reference_type = 0x10;
-            const unsigned tag_compile_unit = 0x11;
-            const unsigned tag_structure_type = 0x13;
-            const unsigned tag_typedef = 0x16;
-            const unsigned tag_inlined_subroutine = 0x1d;
-            const unsigned tag_subrange_type = 0x21;
-            const unsigned tag_base_type = 0x24;
-            const unsigned tag_const_type = 0x26;
-            const unsigned tag_function = 0x2e;
-            const unsigned tag_variable = 0x34;
-            const unsigned tag_namespace = 0x39;
-
-            const unsigned attr_location = 0x02;
-            const unsigned attr_name = 0x03;
-            const unsigned attr_byte_size = 0x0b;
-            const unsigned attr_low_pc = 0x11;
-            const unsigned attr_high_pc = 0x12;
-            const unsigned attr_upper_bound = 0x2f;
-            const unsigned attr_abstract_origin = 0x31;
-            const unsigned attr_count = 0x37;
-            const unsigned attr_data_member_location = 0x38;
-            const unsigned attr_frame_base = 0x40;
-            const unsigned attr_specification = 0x47;
-            const unsigned attr_type = 0x49;
-            const unsigned attr_ranges = 0x55;
-
             while (off - start_of_unit < unit_length) {
                 uint64_t location = off;
 
@@ -1165,177 +1725,7 @@ private:
                     // payload size. If val is zero the payload is a
                     // null-terminated string.
 
-                    switch(fmt.fields[i].form) {
-                    case 1: // addr (4 or 8 bytes)
-                    {
-                        if (address_size == 4) {
-                            val = e.getU32(&off);
-                        } else {
-                            val = e.getU64(&off);
-                        }
-                        break;
-                    }
-                    case 2: // There is no case 2
-                    {
-                        assert(false && "What's form 2?");
-                        break;
-                    }
-                    case 3: // block2 (2 byte length followed by payload)
-                    {
-                        val = e.getU16(&off);
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        off += val;
-                        break;
-                    }
-                    case 4: // block4 (4 byte length followed by payload)
-                    {
-                        val = e.getU32(&off);
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        off += val;
-                        break;
-                    }
-                    case 5: // data2 (2 bytes)
-                    {
-                        val = e.getU16(&off);
-                        break;
-                    }
-                    case 6: // data4 (4 bytes)
-                    {
-                        val = e.getU32(&off);
-                        break;
-                    }
-                    case 7: // data8 (8 bytes)
-                    {
-                        val = e.getU64(&off);
-                        break;
-                    }
-                    case 8: // string (null terminated sequence of bytes)
-                    {
-                        val = 0;
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        while (e.getU8(&off));
-                        break;
-                    }
-                    case 9: // block (uleb128 length followed by payload)
-                    {
-                        val = e.getULEB128(&off);
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        off += val;
-                        break;
-                    }
-                    case 10: // block1 (1 byte length followed by payload)
-                    {
-                        val = e.getU8(&off);
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        off += val;
-                        break;
-                    }
-                    case 11: // data1 (1 byte)
-                    {
-                        val = e.getU8(&off);
-                        break;
-                    }
-                    case 12: // flag (1 byte)
-                    {
-                        val = e.getU8(&off);
-                        break;
-                    }
-                    case 13: // sdata (sleb128 constant)
-                    {
-                        val = (uint64_t)e.getSLEB128(&off);
-                        break;
-                    }
-                    case 14: // strp (offset into debug_str section. 4 bytes in dwarf 32, 8 in dwarf 64)
-                    {
-                        uint64_t offset;
-                        if (dwarf_64) {
-                            offset = e.getU64(&off);
-                        } else {
-                            offset = e.getU32(&off);
-                        }
-                        val = 0;
-                        payload = (const uint8_t *)(debug_str.data() + offset);
-                        break;
-                    }
-                    case 15: // udata (uleb128 constant)
-                    {
-                        val = e.getULEB128(&off);
-                        break;
-                    }
-                    case 16: // ref_addr (offset from beginning of debug_info. 4 bytes in dwarf 32, 8 in dwarf 64)
-                    {
-                        if ((dwarf_version <= 2 && address_size == 8) ||
-                            (dwarf_version > 2 && dwarf_64)) {
-                            val = e.getU64(&off);
-                        } else {
-                            val = e.getU32(&off);
-                        }
-                        break;
-                    }
-                    case 17: // ref1 (1 byte offset from the first byte of the compilation unit header)
-                    {
-                        val = e.getU8(&off) + start_of_unit_header;
-                        break;
-                    }
-                    case 18: // ref2 (2 byte version of the same)
-                    {
-                        val = e.getU16(&off) + start_of_unit_header;
-                        break;
-                    }
-                    case 19: // ref4 (4 byte version of the same)
-                    {
-                        val = e.getU32(&off) + start_of_unit_header;
-                        break;
-                    }
-                    case 20: // ref8 (8 byte version of the same)
-                    {
-                        val = e.getU64(&off) + start_of_unit_header;
-                        break;
-                    }
-                    case 21: // ref_udata (uleb128 version of the same)
-                    {
-                        val = e.getULEB128(&off) + start_of_unit_header;
-                        break;
-                    }
-                    case 22: // indirect
-                    {
-                        assert(false && "Can't handle indirect form");
-                        break;
-                    }
-                    case 23: // sec_offset
-                    {
-                        if (dwarf_64) {
-                            val = e.getU64(&off);
-                        } else {
-                            val = e.getU32(&off);
-                        }
-                        break;
-                    }
-                    case 24: // exprloc
-                    {
-                        // Length
-                        val = e.getULEB128(&off);
-                        // Payload (contains a DWARF expression to evaluate (ugh))
-                        payload = (const uint8_t *)(debug_info.data() + off);
-                        off += val;
-                        break;
-                    }
-                    case 25: // flag_present
-                    {
-                        val = 0;
-                        // Just the existence of this field is information apparently? There's no data.
-                        break;
-                    }
-                    case 32: // ref_sig8
-                    {
-                        // 64-bit type signature for a reference in its own type unit
-                        val = e.getU64(&off);
-                        break;
-                    }
-                    default:
-                        assert(false && "Unknown form");
-                        break;
-                    }
+                    read_field(e, h, fmt.fields[i].form, off, val, payload);
 
                     if (fmt.tag == tag_function) {
                         if (attr == attr_name) {
@@ -1610,11 +2000,11 @@ private:
         // Connect function definitions to their declarations
         {
             std::map<uint64_t, FunctionInfo *> func_map;
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 func_map[functions[i].def_loc] = &functions[i];
             }
 
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 if (functions[i].spec_loc) {
                     FunctionInfo *spec = func_map[functions[i].spec_loc];
                     if (spec) {
@@ -1627,13 +2017,13 @@ private:
         // Connect inlined variable instances to their origins
         {
             std::map<uint64_t, LocalVariable *> var_map;
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 for (size_t j = 0; j < functions[i].variables.size(); j++) {
                     var_map[functions[i].variables[j].def_loc] = &(functions[i].variables[j]);
                 }
             }
 
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 for (size_t j = 0; j < functions[i].variables.size(); j++) {
                     LocalVariable &v = functions[i].variables[j];
                     uint64_t loc = v.origin_loc;
@@ -1654,7 +2044,7 @@ private:
         // Connect global variable instances to their prototypes
         {
             std::map<uint64_t, GlobalVariable *> var_map;
-            for (size_t i = 0; i < global_variables.size(); i++) {
+            for (size_t i = first_global; i < global_variables.size(); i++) {
                 GlobalVariable &var = global_variables[i];
                 debug(5) << "var " << var.name << " is at " << var.def_loc << "\n";
                 if (var.spec_loc || var.name.empty()) {
@@ -1664,7 +2054,7 @@ private:
                 var_map[var.def_loc] = &var;
             }
 
-            for (size_t i = 0; i < global_variables.size(); i++) {
+            for (size_t i = first_global; i < global_variables.size(); i++) {
                 GlobalVariable &var = global_variables[i];
                 if (var.name.empty() && var.spec_loc) {
                     GlobalVariable *spec = var_map[var.spec_loc];
@@ -1682,23 +2072,23 @@ private:
         // Hook up the type pointers
         {
             std::map<uint64_t, TypeInfo *> type_map;
-            for (size_t i = 0; i < types.size(); i++) {
+            for (size_t i = first_type; i < types.size(); i++) {
                 type_map[types[i].def_loc] = &types[i];
             }
 
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 for (size_t j = 0; j < functions[i].variables.size(); j++) {
                     functions[i].variables[j].type =
                         type_map[functions[i].variables[j].type_def_loc];
                 }
             }
 
-            for (size_t i = 0; i < global_variables.size(); i++) {
+            for (size_t i = first_global; i < global_variables.size(); i++) {
                 global_variables[i].type =
                     type_map[global_variables[i].type_def_loc];
             }
 
-            for (size_t i = 0; i < types.size(); i++) {
+            for (size_t i = first_type; i < types.size(); i++) {
                 for (size_t j = 0; j < types[i].members.size(); j++) {
                     types[i].members[j].type =
                         type_map[types[i].members[j].type_def_loc];
@@ -1706,7 +2096,7 @@ private:
             }
         }
 
-        for (size_t i = 0; i < types.size(); i++) {
+        for (size_t i = first_type; i < types.size(); i++) {
             // Set the names of the pointer types
             vector<std::string> suffix;
             TypeInfo *t = &types[i];
@@ -1749,7 +2139,7 @@ private:
         }
 
         // Fix up the sizes of typedefs where we know the underlying type
-        for (size_t i = 0; i < types.size(); i++) {
+        for (size_t i = first_type; i < types.size(); i++) {
             TypeInfo *t = &types[i];
             if (types[i].type == TypeInfo::Typedef &&
                 !t->members.empty() &&
@@ -1760,7 +2150,7 @@ private:
 
 
         // Unpack class members into the local variables list.
-        for (size_t i = 0; i < functions.size(); i++) {
+        for (size_t i = first_function; i < functions.size(); i++) {
             vector<LocalVariable> new_vars = functions[i].variables;
             for (size_t j = 0; j < new_vars.size(); j++) {
                 // If new_vars[j] is a class type, unpack its members
@@ -1805,7 +2195,7 @@ private:
         }
 
         // Unpack class members of global variables
-        for (size_t i = 0; i < global_variables.size(); i++) {
+        for (size_t i = first_global; i < global_variables.size(); i++) {
             GlobalVariable v = global_variables[i];
             if (v.type && v.addr &&
                 (v.type->type == TypeInfo::Struct ||
@@ -1836,7 +2226,7 @@ private:
         // name, or type.
         {
             vector<FunctionInfo> trimmed;
-            for (size_t i = 0; i < functions.size(); i++) {
+            for (size_t i = first_function; i < functions.size(); i++) {
                 FunctionInfo &f = functions[i];
                 if (!f.pc_begin ||
                     !f.pc_end ||
@@ -1858,285 +2248,274 @@ private:
                 trimmed.push_back(f);
                 trimmed.back().variables = vars;
             }
-            std::swap(functions, trimmed);
+            functions.resize(first_function);
+            functions.insert(functions.end(), trimmed.begin(), trimmed.end());
         }
 
         // Drop globals for which we don't know the address or name
         {
             vector<GlobalVariable> trimmed;
-            for (size_t i = 0; i < global_variables.size(); i++) {
+            for (size_t i = first_global; i < global_variables.size(); i++) {
                 GlobalVariable &v = global_variables[i];
                 if (!v.name.empty() && v.addr) {
                     trimmed.push_back(v);
                 }
             }
 
-            std::swap(global_variables, trimmed);
+            global_variables.resize(first_global);
+            global_variables.insert(global_variables.end(), trimmed.begin(), trimmed.end());
         }
-
-        // Sort the functions list by program counter
-        std::sort(functions.begin(), functions.end());
-
-        // Sort the global variables by address
-        std::sort(global_variables.begin(), global_variables.end());
     }
 
-    void parse_debug_line(const llvm::DataExtractor &e) {
-        uint32_t off = 0;
+    // Parse the line program of one compilation unit, starting at the
+    // given offset into the debug_line section.
+    void parse_debug_line(const llvm::DataExtractor &e, uint32_t off) {
+        // Parse the header
+        uint32_t unit_length = e.getU32(&off);
 
-        // For every compilation unit
-        while (1) {
-            // Parse the header
-            uint32_t unit_length = e.getU32(&off);
+        if (unit_length == 0) {
+            return;
+        }
 
-            if (unit_length == 0) {
-                // No more units
-                break;
-            }
+        uint32_t unit_end = off + unit_length;
+
+        debug(5) << "Parsing compilation unit from " << off << " to " << unit_end << "\n";
 
-            uint32_t unit_end = off + unit_length;
+        uint16_t version = e.getU16(&off);
+        assert(version >= 2);
 
-            debug(5) << "Parsing compilation unit from " << off << " to " << unit_end << "\n";
+        uint32_t header_length = e.getU32(&off);
+        uint32_t end_header_off = off + header_length;
+        uint8_t min_instruction_length = e.getU8(&off);
+        uint8_t max_ops_per_instruction = 1;
+        if (version >= 4) {
+            // This is for VLIW architectures
+            max_ops_per_instruction = e.getU8(&off);
+        }
+        uint8_t default_is_stmt = e.getU8(&off);
+        int8_t line_base    = (int8_t)e.getU8(&off);
+        uint8_t line_range  = e.getU8(&off);
+        uint8_t opcode_base = e.getU8(&off);
 
-            uint16_t version = e.getU16(&off);
-            assert(version >= 2);
+        vector<uint8_t> standard_opcode_length(opcode_base);
+        for (int i = 1; i < opcode_base; i++) {
+            // Note we don't use entry 0
+            standard_opcode_length[i] = e.getU8(&off);
+        }
 
-            uint32_t header_length = e.getU32(&off);
-            uint32_t end_header_off = off + header_length;
-            uint8_t min_instruction_length = e.getU8(&off);
-            uint8_t max_ops_per_instruction = 1;
-            if (version >= 4) {
-                // This is for VLIW architectures
-                max_ops_per_instruction = e.getU8(&off);
+        vector<std::string> include_dirs;
+        // The current directory is implicitly the first dir.
+        include_dirs.push_back(".");
+        while (off < end_header_off) {
+            const char *s = e.getCStr(&off);
+            if (s && s[0]) {
+                include_dirs.push_back(s);
+            } else {
+                break;
             }
-            uint8_t default_is_stmt = e.getU8(&off);
-            int8_t line_base    = (int8_t)e.getU8(&off);
-            uint8_t line_range  = e.getU8(&off);
-            uint8_t opcode_base = e.getU8(&off);
+        }
+
+        // The first source file index for this compilation unit.
+        int source_files_base = source_files.size();
 
-            vector<uint8_t> standard_opcode_length(opcode_base);
-            for (int i = 1; i < opcode_base; i++) {
-                // Note we don't use entry 0
-                standard_opcode_length[i] = e.getU8(&off);
+        while (off < end_header_off) {
+            const char *name = e.getCStr(&off);
+            if (name && name[0]) {
+                uint64_t dir = e.getULEB128(&off);
+                uint64_t mod_time = e.getULEB128(&off);
+                uint64_t length = e.getULEB128(&off);
+                (void)mod_time;
+                (void)length;
+                assert(dir <= include_dirs.size());
+                source_files.push_back(include_dirs[dir] + "/" + name);
+            } else {
+                break;
             }
+        }
 
-            vector<std::string> include_dirs;
-            // The current directory is implicitly the first dir.
-            include_dirs.push_back(".");
-            while (off < end_header_off) {
-                const char *s = e.getCStr(&off);
-                if (s && s[0]) {
-                    include_dirs.push_back(s);
-                } else {
+        assert(off == end_header_off && "Failed parsing section .debug_line");
+
+        // Now parse the table. It uses a state machine with the following fields:
+        struct {
+            // Current program counter
+            uint64_t address;
+            // Which op within that instruction (for VLIW archs)
+            uint32_t op_index;
+            // File and line index;
+            uint32_t file, line, column;
+            bool is_stmt, basic_block, end_sequence, prologue_end, epilogue_begin;
+            // The ISA of the architecture (e.g. x86-64 vs armv7 vs thumb)
+            uint32_t isa;
+            // The id of the block to which this line belongs
+            uint32_t discriminator;
+
+            void append_row(vector<LineInfo> &lines) {
+                LineInfo l = {address, line, file};
+                lines.push_back(l);
+            }
+        } state, initial_state;
+
+        // Initialize the state table.
+        initial_state.address = 0;
+        initial_state.op_index = 0;
+        initial_state.file = 0;
+        initial_state.line = 1;
+        initial_state.column = 0;
+        initial_state.is_stmt = default_is_stmt;
+        initial_state.basic_block = false;
+        initial_state.end_sequence = false;
+        initial_state.prologue_end = false;
+        initial_state.epilogue_begin = false;
+        initial_state.isa = 0;
+        initial_state.discriminator = 0;
+        state = initial_state;
+
+        // For every sequence.
+        while (off < unit_end) {
+            uint8_t opcode = e.getU8(&off);
+
+            if (opcode == 0) {
+                // Extended opcodes
+                uint32_t ext_offset = off;
+                uint64_t len = e.getULEB128(&off);
+                uint32_t arg_size = len - (off - ext_offset);
+                uint8_t sub_opcode = e.getU8(&off);
+                switch (sub_opcode) {
+                case 1: // end_sequence
+                {
+                    state.end_sequence = true;
+                    state.append_row(source_lines);
+                    state = initial_state;
                     break;
                 }
-            }
-
-            // The first source file index for this compilation unit.
-            int source_files_base = source_files.size();
-
-            while (off < end_header_off) {
-                const char *name = e.getCStr(&off);
-                if (name && name[0]) {
-                    uint64_t dir = e.getULEB128(&off);
+                case 2: // set_address
+                {
+                    state.address = e.getAddress(&off);
+                    break;
+                }
+                case 3: // define_file
+                {
+                    const char *name = e.getCStr(&off);
+                    uint64_t dir_index = e.getULEB128(&off);
                     uint64_t mod_time = e.getULEB128(&off);
                     uint64_t length = e.getULEB128(&off);
                     (void)mod_time;
                     (void)length;
-                    assert(dir <= include_dirs.size());
-                    source_files.push_back(include_dirs[dir] + "/" + name);
-                } else {
+                    assert(dir_index < include_dirs.size());
+                    source_files.push_back(include_dirs[dir_index] + "/" + name);
                     break;
                 }
-            }
-
-            assert(off == end_header_off && "Failed parsing section .debug_line");
-
-            // Now parse the table. It uses a state machine with the following fields:
-            struct {
-                // Current program counter
-                uint64_t address;
-                // Which op within that instruction (for VLIW archs)
-                uint32_t op_index;
-                // File and line index;
-                uint32_t file, line, column;
-                bool is_stmt, basic_block, end_sequence, prologue_end, epilogue_begin;
-                // The ISA of the architecture (e.g. x86-64 vs armv7 vs thumb)
-                uint32_t isa;
-                // The id of the block to which this line belongs
-                uint32_t discriminator;
-
-                void append_row(vector<LineInfo> &lines) {
-                    LineInfo l = {address, line, file};
-                    lines.push_back(l);
+                case 4: // set_discriminator
+                {
+                    state.discriminator = e.getULEB128(&off);
+                    break;
                 }
-            } state, initial_state;
-
-            // Initialize the state table.
-            initial_state.address = 0;
-            initial_state.op_index = 0;
-            initial_state.file = 0;
-            initial_state.line = 1;
-            initial_state.column = 0;
-            initial_state.is_stmt = default_is_stmt;
-            initial_state.basic_block = false;
-            initial_state.end_sequence = false;
-            initial_state.prologue_end = false;
-            initial_state.epilogue_begin = false;
-            initial_state.isa = 0;
-            initial_state.discriminator = 0;
-            state = initial_state;
-
-            // For every sequence.
-            while (off < unit_end) {
-                uint8_t opcode = e.getU8(&off);
-
-                if (opcode == 0) {
-                    // Extended opcodes
-                    uint32_t ext_offset = off;
-                    uint64_t len = e.getULEB128(&off);
-                    uint32_t arg_size = len - (off - ext_offset);
-                    uint8_t sub_opcode = e.getU8(&off);
-                    switch (sub_opcode) {
-                    case 1: // end_sequence
-                    {
-                        state.end_sequence = true;
-                        state.append_row(source_lines);
-                        state = initial_state;
-                        break;
-                    }
-                    case 2: // set_address
-                    {
-                        state.address = e.getAddress(&off);
-                        break;
-                    }
-                    case 3: // define_file
-                    {
-                        const char *name = e.getCStr(&off);
-                        uint64_t dir_index = e.getULEB128(&off);
-                        uint64_t mod_time = e.getULEB128(&off);
-                        uint64_t length = e.getULEB128(&off);
-                        (void)mod_time;
-                        (void)length;
-                        assert(dir_index < include_dirs.size());
-                        source_files.push_back(include_dirs[dir_index] + "/" + name);
-                        break;
-                    }
-                    case 4: // set_discriminator
-                    {
-                        state.discriminator = e.getULEB128(&off);
-                        break;
-                    }
-                    default: // Some unknown thing. Skip it.
-                        off += arg_size;
-                    }
-                } else if (opcode < opcode_base) {
-                    // A standard opcode
-                    switch (opcode) {
-                    case 1: // copy
-                    {
-                        state.append_row(source_lines);
-                        state.basic_block = false;
-                        state.prologue_end = false;
-                        state.epilogue_begin = false;
-                        state.discriminator = 0;
-                        break;
-                    }
-                    case 2: // advance_pc
-                    {
-                        uint64_t advance = e.getULEB128(&off);
-                        state.address += min_instruction_length * ((state.op_index + advance) / max_ops_per_instruction);
-                        state.op_index = (state.op_index + advance) % max_ops_per_instruction;
-                        break;
-                    }
-                    case 3: // advance_line
-                    {
-                        state.line += e.getSLEB128(&off);
-                        break;
-                    }
-                    case 4: // set_file
-                    {
-                        state.file = e.getULEB128(&off) - 1 + source_files_base;
-                        break;
-                    }
-                    case 5: // set_column
-                    {
-                        state.column = e.getULEB128(&off);
-                        break;
-                    }
-                    case 6: // negate_stmt
-                    {
-                        state.is_stmt = !state.is_stmt;
-                        break;
-                    }
-                    case 7: // set_basic_block
-                    {
-                        state.basic_block = true;
-                        break;
-                    }
-                    case 8: // const_add_pc
-                    {
-                        // Same as special opcode 255 (but doesn't emit a row or reset state)
-                        uint8_t adjust_opcode = 255 - opcode_base;
-                        uint64_t advance = adjust_opcode / line_range;
-                        state.address += min_instruction_length * ((state.op_index + advance) / max_ops_per_instruction);
-                        state.op_index = (state.op_index + advance) % max_ops_per_instruction;
-                        break;
-                    }
-                    case 9: // fixed_advance_pc
-                    {
-                        uint16_t advance = e.getU16(&off);
-                        state.address += advance;
-                        break;
-                    }
-                    case 10: // set_prologue_end
-                    {
-                        state.prologue_end = true;
-                        break;
-                    }
-                    case 11: // set_epilogue_begin
-                    {
-                        state.epilogue_begin = true;
-                        break;
-                    }
-                    case 12: // set_isa
-                    {
-                        state.isa = e.getULEB128(&off);
-                        break;
-                    }
-                    default:
-                    {
-                        // Unknown standard opcode. Skip over the args.
-                        uint8_t args = standard_opcode_length[opcode];
-                        for (int i = 0; i < args; i++) {
-                            e.getULEB128(&off);
-                        }
-                    }}
-                } else {
-                    // Special opcode
-                    uint8_t adjust_opcode = opcode - opcode_base;
-                    uint64_t advance_op = adjust_opcode / line_range;
-                    uint64_t advance_line = line_base + adjust_opcode % line_range;
-                    state.address += min_instruction_length * ((state.op_index + advance_op) / max_ops_per_instruction);
-                    state.op_index = (state.op_index + advance_op) % max_ops_per_instruction;
-                    state.line += advance_line;
+                default: // Some unknown thing. Skip it.
+                    off += arg_size;
+                }
+            } else if (opcode < opcode_base) {
+                // A standard opcode
+                switch (opcode) {
+                case 1: // copy
+                {
                     state.append_row(source_lines);
                     state.basic_block = false;
                     state.prologue_end = false;
                     state.epilogue_begin = false;
                     state.discriminator = 0;
+                    break;
+                }
+                case 2: // advance_pc
+                {
+                    uint64_t advance = e.getULEB128(&off);
+                    state.address += min_instruction_length * ((state.op_index + advance) / max_ops_per_instruction);
+                    state.op_index = (state.op_index + advance) % max_ops_per_instruction;
+                    break;
+                }
+                case 3: // advance_line
+                {
+                    state.line += e.getSLEB128(&off);
+                    break;
+                }
+                case 4: // set_file
+                {
+                    state.file = e.getULEB128(&off) - 1 + source_files_base;
+                    break;
+                }
+                case 5: // set_column
+                {
+                    state.column = e.getULEB128(&off);
+                    break;
+                }
+                case 6: // negate_stmt
+                {
+                    state.is_stmt = !state.is_stmt;
+                    break;
+                }
+                case 7: // set_basic_block
+                {
+                    state.basic_block = true;
+                    break;
+                }
+                case 8: // const_add_pc
+                {
+                    // Same as special opcode 255 (but doesn't emit a row or reset state)
+                    uint8_t adjust_opcode = 255 - opcode_base;
+                    uint64_t advance = adjust_opcode / line_range;
+                    state.address += min_instruction_length * ((state.op_index + advance) / max_ops_per_instruction);
+                    state.op_index = (state.op_index + advance) % max_ops_per_instruction;
+                    break;
+                }
+                case 9: // fixed_advance_pc
+                {
+                    uint16_t advance = e.getU16(&off);
+                    state.address += advance;
+                    break;
+                }
+                case 10: // set_prologue_end
+                {
+                    state.prologue_end = true;
+                    break;
+                }
+                case 11: // set_epilogue_begin
+                {
+                    state.epilogue_begin = true;
+                    break;
+                }
+                case 12: // set_isa
+                {
+                    state.isa = e.getULEB128(&off);
+                    break;
                 }
+                default:
+                {
+                    // Unknown standard opcode. Skip over the args.
+                    uint8_t args = standard_opcode_length[opcode];
+                    for (int i = 0; i < args; i++) {
+                        e.getULEB128(&off);
+                    }
+                }}
+            } else {
+                // Special opcode
+                uint8_t adjust_opcode = opcode - opcode_base;
+                uint64_t advance_op = adjust_opcode / line_range;
+                uint64_t advance_line = line_base + adjust_opcode % line_range;
+                state.address += min_instruction_length * ((state.op_index + advance_op) / max_ops_per_instruction);
+                state.op_index = (state.op_index + advance_op) % max_ops_per_instruction;
+                state.line += advance_line;
+                state.append_row(source_lines);
+                state.basic_block = false;
+                state.prologue_end = false;
+                state.epilogue_begin = false;
+                state.discriminator = 0;
             }
         }
-
-        // Sort the sequences and functions by low PC to make searching into it faster.
-        std::sort(source_lines.begin(), source_lines.end());
-
     }
 
     FunctionInfo *find_containing_function(void *addr) {
         uint64_t address = (uint64_t)addr;
         debug(5) << "Searching for function containing address " << addr << "\n";
+        load_unit_with_pc(address);
         size_t hi = functions.size();
         size_t lo = 0;
         while (hi > lo) {
@@ -2201,9 +2580,12 @@ private:
 
 namespace {
 DebugSections *debug_sections = nullptr;
+// Queries may load more of the debug info, so they are serialized.
+std::mutex debug_sections_mutex;
 }
 
 bool dump_stack_frame() {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections || !debug_sections->working) {
         return false;
     }
@@ -2212,6 +2594,7 @@ bool dump_stack_frame() {
 }
 
 std::string get_variable_name(const void *var, const std::string &expected_type) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return "";
     if (!debug_sections->working) return "";
     std::string name = debug_sections->get_stack_variable_name(var, expected_type);
@@ -2228,12 +2611,14 @@ std::string get_variable_name(const void *var, const std::string &expected_type)
 }
 
 std::string get_source_location() {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return "";
     if (!debug_sections->working) return "";
     return debug_sections->get_source_location();
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return;
     if (!debug_sections->working) return;
     if (!helper) return;
@@ -2241,6 +2626,7 @@ void register_heap_object(const void *obj, size_t size, const void *helper) {
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return;
     if (!debug_sections->working) return;
     debug_sections->deregister_heap_object(obj, size);
@@ -2267,6 +2653,9 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
 
     debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(calib) << "\n";
 
+    // Not held while running the test, which makes queries of its own.
+    std::unique_lock<std::mutex> lock(debug_sections_mutex);
+
     if (!debug_sections) {
         char path[2048];
         get_program_name(path, sizeof(path));
@@ -2285,7 +2674,10 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
             return;
         }
 
-        debug_sections->working = (*test)(test_a);
+        lock.unlock();
+        bool passed = (*test)(test_a);
+        lock.lock();
+        debug_sections->working = passed;
         if (!debug_sections->working) {
             debug(5) << "Failed because test routine failed\n";
             return;
@@ -23,6 +23,19 @@ public:
     int increment() {return ++count;} // Increment and return new value
     int decrement() {return --count;} // Decrement and return new value
     bool is_zero() const {return count == 0;}
+    /** Increment the count unless it is zero, in which case the
+     * object is already being destroyed. Used to recover a reference
+     * to an object from a cache that doesn't own one. Returns whether
+     * the count was incremented. */
+    bool increment_if_nonzero() {
+        int c = count;
+        while (c != 0) {
+            if (count.compare_exchange_weak(c, c + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 /**
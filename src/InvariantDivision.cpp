@@ -0,0 +1,205 @@
+#include "InvariantDivision.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+// Loads and impure calls might give a different value on each
+// iteration even if none of their arguments change.
+class ContainsLoadOrImpureCall : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        result = true;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+// Unsigned division of n by d, with d a broadcast of the scalar
+// d_scalar. This is the round-up method of Granlund and Montgomery
+// (and libdivide), which is exact for every numerator and every
+// nonzero divisor:
+//   l = ceil(log2(d))
+//   m = floor(2^bits * (2^l - d) / d) + 1
+//   t = mulhi(m, n)
+//   q = (t + ((n - t) >> min(l, 1))) >> max(l - 1, 0)
+Expr unsigned_divide(Expr n, Expr d_scalar) {
+    Type t = n.type();
+    int bits = t.bits();
+    int lanes = t.lanes();
+    Type scalar = t.element_of();
+    Type wide = scalar.with_bits(bits * 2);
+
+    // Division by zero is undefined, but the multiplier is computed
+    // outside the loop, where the division may never have
+    // happened. Don't let it trap.
+    Expr d = max(d_scalar, make_one(scalar));
+    Expr l = make_const(scalar, bits) - count_leading_zeros(d - make_one(scalar));
+    Expr m = (((make_one(wide) << cast(wide, l)) - cast(wide, d)) << make_const(wide, bits)) / cast(wide, d);
+    m = cast(scalar, m + make_one(wide));
+    Expr sh1 = min(l, make_one(scalar));
+    Expr sh2 = max(l, make_one(scalar)) - make_one(scalar);
+
+    // Written like the patterns that pick out pmulhuw and friends.
+    Type wide_vec = wide.with_lanes(lanes);
+    Expr hi = cast(t, (cast(wide_vec, Broadcast::make(m, lanes)) * cast(wide_vec, n)) /
+                          make_const(wide_vec, (int64_t)1 << bits));
+    Expr q = (hi + ((n - hi) >> Broadcast::make(sh1, lanes))) >> Broadcast::make(sh2, lanes);
+    return q;
+}
+
+// Euclidean division of a signed n by a broadcast of d_scalar, in
+// terms of unsigned division by |d|. For negative n, floor(n / |d|)
+// is ~(~n / |d|), and ~n is non-negative.
+Expr signed_divide(Expr n, Expr d_scalar) {
+    Type t = n.type();
+    int bits = t.bits();
+    int lanes = t.lanes();
+    Type ut = t.with_code(Type::UInt);
+
+    Expr sign = reinterpret(ut, n >> make_const(t, bits - 1));
+    Expr q = unsigned_divide(reinterpret(ut, n) ^ sign, abs(d_scalar)) ^ sign;
+    q = reinterpret(t, q);
+
+    // Negate the quotient if the divisor is negative.
+    Expr d_sign = Broadcast::make(d_scalar >> make_const(t.element_of(), bits - 1), lanes);
+    return (q ^ d_sign) - d_sign;
+}
+
+class LowerInvariantDivision : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The loop variable of the innermost enclosing loop, and
+    // everything defined inside it.
+    Scope<> varying;
+    bool in_loop = false;
+
+    // Vector lets whose value is a broadcast.
+    Scope<Expr> broadcasts;
+
+    // Get the scalar value of the divisor if it is a broadcast of
+    // something worth doing this for.
+    Expr invariant_divisor(const Expr &a, const Expr &b) {
+        Type t = a.type();
+        if (!in_loop || !t.is_vector() ||
+            !(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32)) {
+            return Expr();
+        }
+        Expr d;
+        if (const Broadcast *bc = b.as<Broadcast>()) {
+            d = bc->value;
+        } else if (const Variable *v = b.as<Variable>()) {
+            if (broadcasts.contains(v->name)) {
+                d = broadcasts.get(v->name);
+            }
+        }
+        if (!d.defined() || is_const(d) || expr_uses_vars(d, varying)) {
+            return Expr();
+        }
+        ContainsLoadOrImpureCall check;
+        d.accept(&check);
+        if (check.result) {
+            return Expr();
+        }
+        return d;
+    }
+
+    Expr divide(Expr a, Expr d) {
+        if (a.type().is_uint()) {
+            return unsigned_divide(a, d);
+        } else {
+            return signed_divide(a, d);
+        }
+    }
+
+    Expr visit(const Div *op) override {
+        Expr a = mutate(op->a);
+        Expr b = mutate(op->b);
+        Expr d = invariant_divisor(a, b);
+        if (!d.defined()) {
+            return Div::make(a, b);
+        }
+        string a_name = unique_name('a');
+        Expr a_var = Variable::make(a.type(), a_name);
+        return Let::make(a_name, a, divide(a_var, d));
+    }
+
+    Expr visit(const Mod *op) override {
+        Expr a = mutate(op->a);
+        Expr b = mutate(op->b);
+        Expr d = invariant_divisor(a, b);
+        if (!d.defined()) {
+            return Mod::make(a, b);
+        }
+        // Euclidean modulo is a - (a / b) * b for both signs.
+        string a_name = unique_name('a');
+        Expr a_var = Variable::make(a.type(), a_name);
+        Expr d_vec = Broadcast::make(d, a.type().lanes());
+        return Let::make(a_name, a, a_var - divide(a_var, d) * d_vec);
+    }
+
+    template<typename NodeType, typename LetType>
+    NodeType visit_let(const LetType *op) {
+        Expr value = mutate(op->value);
+        const Broadcast *bc = value.as<Broadcast>();
+        ScopedBinding<Expr> bind_broadcast(bc != nullptr, broadcasts, op->name, bc ? bc->value : Expr());
+        ScopedBinding<> bind_varying(in_loop, varying, op->name);
+        NodeType body = mutate(op->body);
+
+        if (!value.same_as(op->value) || !body.same_as(op->body)) {
+            return LetType::make(op->name, value, body);
+        } else {
+            return op;
+        }
+    }
+
+    Expr visit(const Let *op) override { return visit_let<Expr>(op); }
+    Stmt visit(const LetStmt *op) override { return visit_let<Stmt>(op); }
+
+    Stmt visit(const For *op) override {
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+
+        Scope<> outer_varying;
+        outer_varying.swap(varying);
+        bool outer_in_loop = in_loop;
+        in_loop = true;
+        varying.push(op->name);
+        Stmt body = mutate(op->body);
+        varying.swap(outer_varying);
+        in_loop = outer_in_loop;
+
+        if (min.same_as(op->min) && extent.same_as(op->extent) && body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, min, extent, op->for_type, op->device_api, body);
+    }
+};
+
+}  // namespace
+
+Stmt lower_invariant_division(Stmt s) {
+    return LowerInvariantDivision().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,27 @@
+#ifndef HALIDE_INVARIANT_DIVISION_H
+#define HALIDE_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines the lowering pass that replaces vector division by
+ * loop-invariant runtime values with multiplies and shifts.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite integer vector divisions and modulos whose divisor is a
+ * broadcast of a value that doesn't change over the innermost
+ * enclosing loop as a multiply-high, an add, and two shifts. The
+ * multiplier and shifts are scalar expressions of the divisor, so
+ * loop_invariant_code_motion lifts them out of the loop, and the
+ * divide (which no vector ISA we target has) happens once per loop
+ * rather than once per lane. Division by constants is left to
+ * codegen, which looks up the multipliers in a table. */
+Stmt lower_invariant_division(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -2,6 +2,9 @@
 #include <stdint.h>
 #include <mutex>
 #include <set>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
 
 #ifndef _WIN32
 #include <sys/mman.h>
@@ -12,6 +15,7 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Debug.h"
+#include "IRPrinter.h"
 #include "LLVM_Output.h"
 #include "CodeGen_LLVM.h"
 #include "Pipeline.h"
@@ -114,6 +118,24 @@ void load_metal() {
 #endif
 }
 
+// The modules compiled from Halide Modules so far in this process,
+// keyed by everything that determines their code, so that equivalent
+// pipelines share one compiled module. The entries don't own a
+// reference: each module removes its own entry as it is destroyed,
+// and a module whose reference count has already dropped to zero is
+// never handed out again.
+struct SharedJITModules {
+    std::mutex mutex;
+    std::map<std::string, JITModuleContents *> modules;
+};
+
+SharedJITModules &shared_jit_modules() {
+    // Deliberately leaked, so that modules destroyed during static
+    // destruction can still remove themselves.
+    static SharedJITModules *shared = new SharedJITModules;
+    return *shared;
+}
+
 }  // namespace
 
 using namespace llvm;
@@ -127,6 +149,14 @@ public:
     }
 
     ~JITModuleContents() {
+        if (!shared_key.empty()) {
+            SharedJITModules &shared = shared_jit_modules();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            auto it = shared.modules.find(shared_key);
+            if (it != shared.modules.end() && it->second == this) {
+                shared.modules.erase(it);
+            }
+        }
         if (execution_engine != nullptr) {
             execution_engine->runStaticConstructorsDestructors(true);
             delete execution_engine;
@@ -141,6 +171,9 @@ public:
     JITModule::Symbol argv_entrypoint;
 
     std::string name;
+
+    // The key of this module in shared_jit_modules, if it's there.
+    std::string shared_key;
 };
 
 template <>
@@ -160,7 +193,9 @@ JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &na
         internal_error << "Compiling " << name << " returned nullptr\n";
     }
 
-    JITModule::Symbol symbol(f, fn->getFunctionType());
+    // fn is null if the code came from the persistent JIT cache, in
+    // which case there is no llvm type to report.
+    JITModule::Symbol symbol(f, fn ? fn->getFunctionType() : nullptr);
 
     debug(2) << "Function " << name << " is at " << f << "\n";
 
@@ -236,6 +271,79 @@ public:
 
 };
 
+// An llvm::ObjectCache backed by a single file in the directory named
+// by HL_JIT_CACHE_DIR. A previously validated object, if any, is handed
+// to MCJIT instead of running codegen; otherwise the freshly compiled
+// object is written out for the next process to use.
+class HalideJITObjectCache : public llvm::ObjectCache {
+    std::string path;
+    std::unique_ptr<llvm::MemoryBuffer> cached_object;
+
+public:
+    HalideJITObjectCache(const std::string &path, std::unique_ptr<llvm::MemoryBuffer> cached_object)
+        : path(path), cached_object(std::move(cached_object)) {}
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef obj) override {
+        // Write to a temporary and rename, so that concurrent processes
+        // never observe a partially-written object.
+        std::string tmp_path = path + "." + std::to_string(reinterpret_cast<uintptr_t>(this)) + ".tmp";
+        std::error_code err;
+        {
+            llvm::raw_fd_ostream out(tmp_path, err, llvm::sys::fs::F_None);
+            if (err) {
+                debug(1) << "Could not write JIT cache entry " << tmp_path << ": " << err.message() << "\n";
+                return;
+            }
+            out << obj.getBuffer();
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            debug(1) << "Could not rename JIT cache entry to " << path << "\n";
+            std::remove(tmp_path.c_str());
+        }
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return std::move(cached_object);
+    }
+};
+
+// Returns the path of the on-disk cache entry for a module with the
+// given cache key, or the empty string if the persistent JIT cache is
+// disabled.
+std::string jit_cache_path(const std::string &key) {
+    std::string dir = get_env_variable("HL_JIT_CACHE_DIR");
+    if (dir.empty()) {
+        return "";
+    }
+
+    std::error_code err = llvm::sys::fs::create_directories(dir);
+    if (err) {
+        debug(1) << "Could not create JIT cache directory " << dir << ": " << err.message() << "\n";
+        return "";
+    }
+
+    return dir + "/" + hash_cache_key(key) + ".o";
+}
+
+// Load a cached object, returning nullptr if it is missing or isn't a
+// readable object file.
+std::unique_ptr<llvm::MemoryBuffer> jit_cache_load(const std::string &path) {
+    if (path.empty() || !file_exists(path)) {
+        return nullptr;
+    }
+    auto buf = llvm::MemoryBuffer::getFile(path);
+    if (!buf) {
+        return nullptr;
+    }
+    auto obj = llvm::object::ObjectFile::createObjectFile((*buf)->getMemBufferRef());
+    if (!obj) {
+        llvm::consumeError(obj.takeError());
+        debug(1) << "Ignoring corrupt JIT cache entry " << path << "\n";
+        return nullptr;
+    }
+    return std::move(*buf);
+}
+
 }
 
 JITModule::JITModule() {
@@ -244,17 +352,84 @@ JITModule::JITModule() {
 
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
+    // The key is everything that determines the machine code.
+    std::ostringstream key;
+    key << "function=" << fn.name << "\n";
+    write_module_cache_key(key, m);
+
+    // Symbols are resolved against the dependencies as the code is
+    // loaded, so the code can only be shared between modules that
+    // depend on the same symbols, at the same addresses.
+    std::ostringstream shared_key;
+    shared_key << key.str();
+    for (const JITModule &dep : dependencies) {
+        for (const auto &e : dep.exports()) {
+            shared_key << "dependency " << e.first << " " << e.second.address << "\n";
+        }
+    }
+    std::string shared_hash = hash_cache_key(shared_key.str());
+
+    SharedJITModules &shared = shared_jit_modules();
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        auto it = shared.modules.find(shared_hash);
+        if (it != shared.modules.end() && it->second->ref_count.increment_if_nonzero()) {
+            debug(1) << "Sharing jit-compiled module for " << fn.name << "\n";
+            jit_module = it->second;
+            // Assigning took a reference of its own.
+            it->second->ref_count.decrement();
+            return;
+        }
+    }
+
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
+
+    std::string cache_path = jit_cache_path(key.str());
+    std::unique_ptr<llvm::MemoryBuffer> cached_object = jit_cache_load(cache_path);
+
+    std::unique_ptr<llvm::Module> llvm_module;
+    if (cached_object) {
+        // On a cache hit we skip codegen and optimization entirely. MCJIT
+        // still wants a module to own, so give it an empty one that just
+        // carries the triple, data layout and target flags; the object
+        // cache supplies the machine code.
+        debug(1) << "JIT cache hit for " << fn.name << ": " << cache_path << "\n";
+        CodeGen_LLVM::initialize_llvm();
+        llvm_module.reset(new llvm::Module(m.name(), jit_module->context));
+        llvm_module->setTargetTriple(get_triple_for_target(m.target()).str());
+        std::unique_ptr<CodeGen_LLVM> cg(CodeGen_LLVM::new_for_target(m.target(), jit_module->context));
+        cg->add_target_module_flags(*llvm_module, m.any_strict_float());
+        llvm_module->setDataLayout(make_target_machine(*llvm_module)->createDataLayout());
+    } else {
+        if (!cache_path.empty()) {
+            debug(1) << "JIT cache miss for " << fn.name << ": " << cache_path << "\n";
+        }
+        llvm_module = compile_module_to_llvm_module(m, jit_module->context);
+    }
+
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+
+    std::unique_ptr<HalideJITObjectCache> object_cache;
+    if (!cache_path.empty()) {
+        object_cache.reset(new HalideJITObjectCache(cache_path, std::move(cached_object)));
+    }
+    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime,
+                   std::vector<std::string>(), object_cache.get());
+
+    // If another thread compiled the same module meanwhile, the most
+    // recent one is shared from now on. The other stays valid for as
+    // long as it is referenced.
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    jit_module->shared_key = shared_hash;
+    shared.modules[shared_hash] = jit_module.get();
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
                                const std::vector<JITModule> &dependencies,
-                               const std::vector<std::string> &requested_exports) {
+                               const std::vector<std::string> &requested_exports,
+                               llvm::ObjectCache *object_cache) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -271,6 +446,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
+    CodeGenOpt::Level opt_level = use_fast_compile(*m) ? CodeGenOpt::Less : CodeGenOpt::Aggressive;
 
     llvm::EngineBuilder engine_builder((std::move(m)));
     engine_builder.setTargetOptions(options);
@@ -279,7 +455,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     HalideJITMemoryManager *memory_manager = new HalideJITMemoryManager(dependencies);
     engine_builder.setMCJITMemoryManager(std::unique_ptr<RTDyldMemoryManager>(memory_manager));
 
-    engine_builder.setOptLevel(CodeGenOpt::Aggressive);
+    engine_builder.setOptLevel(opt_level);
     if (!mcpu.empty()) {
         engine_builder.setMCPU(mcpu);
     }
@@ -300,6 +476,13 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     if (!ee) std::cerr << error_string << "\n";
     internal_assert(ee) << "Couldn't create execution engine\n";
 
+    if (object_cache) {
+        ee->setObjectCache(object_cache);
+        // Generate (or load) the object now, while the cache is still
+        // alive, rather than lazily on the first symbol lookup.
+        ee->finalizeObject();
+    }
+
     // Do any target-specific initialization
     std::vector<llvm::JITEventListener *> listeners;
 
@@ -335,6 +518,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     debug(2) << "Finalizing object\n";
     ee->finalizeObject();
+    ee->setObjectCache(nullptr);
 #if LLVM_VERSION < 70
     memory_manager->work_around_llvm_bugs();
 #endif
@@ -459,6 +643,41 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_set_func_size(const std::string &func_name, int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_func_size");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(const char *, int64_t)>(f->second.address))(func_name.c_str(), size);
+    }
+}
+
+int JITModule::memoization_cache_get_stats(halide_memoization_cache_func_stats_t *stats, int max_funcs) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_stats");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(halide_memoization_cache_func_stats_t *, int)>(f->second.address))(stats, max_funcs);
+    }
+    return 0;
+}
+
+void JITModule::device_timing_enable(bool enabled) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_enable_device_timing");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(void *, bool)>(f->second.address))(nullptr, enabled);
+    }
+}
+
+int JITModule::device_timing_get(halide_device_timing_t *timing, bool reset) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_get_device_timing");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(void *, halide_device_timing_t *, bool)>(f->second.address))(nullptr, timing, reset);
+    }
+    *timing = halide_device_timing_t{0, 0, 0, 0};
+    return 0;
+}
+
 bool JITModule::compiled() const {
   return jit_module->execution_engine != nullptr;
 }
@@ -622,6 +841,7 @@ enum RuntimeKind {
     OpenGLCompute,
     Hexagon,
     D3D12Compute,
+    Vulkan,
     OpenCLDebug,
     MetalDebug,
     CUDADebug,
@@ -629,6 +849,7 @@ enum RuntimeKind {
     OpenGLComputeDebug,
     HexagonDebug,
     D3D12ComputeDebug,
+    VulkanDebug,
     MaxRuntimeKind
 };
 
@@ -666,6 +887,7 @@ JITModule &make_module(llvm::Module *for_module, Target target,
         one_gpu.set_feature(Target::OpenGL, false);
         one_gpu.set_feature(Target::OpenGLCompute, false);
         one_gpu.set_feature(Target::D3D12Compute, false);
+        one_gpu.set_feature(Target::Vulkan, false);
         string module_name;
         switch (runtime_kind) {
         case OpenCLDebug:
@@ -740,6 +962,15 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 internal_error << "JIT support for Direct3D 12 is only implemented on Windows 10 and above.\n";
             #endif
             break;
+        case VulkanDebug:
+            one_gpu.set_feature(Target::Debug);
+            one_gpu.set_feature(Target::Vulkan);
+            module_name = "debug_vulkan";
+            break;
+        case Vulkan:
+            one_gpu.set_feature(Target::Vulkan);
+            module_name += "vulkan";
+            break;
         default:
             module_name = "shared runtime";
             break;
@@ -894,6 +1125,13 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
             result.push_back(m);
         }
     }
+    if (target.has_feature(Target::Vulkan)) {
+        auto kind = target.has_feature(Target::Debug) ? VulkanDebug : Vulkan;
+        JITModule m = make_module(for_module, target, kind, result, create);
+        if (m.compiled()) {
+            result.push_back(m);
+        }
+    }
 
     return result;
 }
@@ -935,5 +1173,34 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_set_func_size(const std::string &func_name, int64_t size) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_set_func_size(func_name, size);
+}
+
+std::vector<halide_memoization_cache_func_stats_t> JITSharedRuntime::memoization_cache_get_stats() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    const JITModule &runtime = shared_runtimes(MainShared);
+    std::vector<halide_memoization_cache_func_stats_t> stats(runtime.memoization_cache_get_stats(nullptr, 0));
+    if (!stats.empty()) {
+        int n = runtime.memoization_cache_get_stats(stats.data(), (int)stats.size());
+        stats.resize(std::min((size_t)n, stats.size()));
+    }
+    return stats;
+}
+
+void JITSharedRuntime::device_timing_enable(bool enabled) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).device_timing_enable(enabled);
+}
+
+halide_device_timing_t JITSharedRuntime::device_timing_get() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    halide_device_timing_t timing;
+    int err = shared_runtimes(MainShared).device_timing_get(&timing, true);
+    user_assert(err == 0) << "Getting the device timing failed with error " << err << "\n";
+    return timing;
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -15,6 +15,7 @@
 
 namespace llvm {
 class Module;
+class ObjectCache;
 class Type;
 }
 
@@ -41,6 +42,12 @@ struct JITModule {
     };
 
     JITModule();
+
+    /** Compile a lowered Module for the JIT. If the environment
+     * variable HL_JIT_CACHE_DIR names a directory, the generated
+     * machine code is persisted there, keyed by a hash of the lowered
+     * Stmts, the Target and the LLVM version, and later compilations
+     * of the same pipeline load it directly instead of running LLVM. */
     JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies = std::vector<JITModule>());
     /** The exports map of a JITModule contains all symbols which are
@@ -107,14 +114,21 @@ struct JITModule {
     Symbol find_symbol_by_name(const std::string &) const;
 
     /** Take an llvm module and compile it. The requested exports will
-        be available via the exports method. */
+        be available via the exports method. If an object cache is
+        given, MCJIT consults it before running codegen and notifies it
+        of the compiled object afterwards. */
     void compile_module(std::unique_ptr<llvm::Module> mod,
                         const std::string &function_name, const Target &target,
                         const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
-                        const std::vector<std::string> &requested_exports = std::vector<std::string>());
+                        const std::vector<std::string> &requested_exports = std::vector<std::string>(),
+                        llvm::ObjectCache *object_cache = nullptr);
 
     /** Encapsulate device (GPU) and buffer interactions. */
     void memoization_cache_set_size(int64_t size) const;
+    void memoization_cache_set_func_size(const std::string &func_name, int64_t size) const;
+    int memoization_cache_get_stats(halide_memoization_cache_func_stats_t *stats, int max_funcs) const;
+    void device_timing_enable(bool enabled) const;
+    int device_timing_get(halide_device_timing_t *timing, bool reset) const;
 
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
@@ -153,6 +167,27 @@ public:
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Set the maximum number of bytes used by memoization caching for
+     * the results of a single Func, and query per-Func cache
+     * statistics. The AOT equivalents are
+     * halide_memoization_cache_set_func_size() and
+     * halide_memoization_cache_get_stats().
+     */
+    // @{
+    static void memoization_cache_set_func_size(const std::string &func_name, int64_t size);
+    static std::vector<halide_memoization_cache_func_stats_t> memoization_cache_get_stats();
+    // @}
+
+    /** Control whether the device backends of JIT-compiled pipelines
+     * time their kernel launches and copies on the device, and get the
+     * totals since the last call, after waiting for the timed work to
+     * finish. The AOT equivalents are halide_enable_device_timing() and
+     * halide_get_device_timing(). */
+    // @{
+    static void device_timing_enable(bool enabled);
+    static halide_device_timing_t device_timing_get();
+    // @}
+
     static void release_all();
 };
 
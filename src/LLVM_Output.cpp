@@ -2,6 +2,7 @@
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
 #include "CodeGen_LLVM.h"
+#include "CompilerProfiling.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 
@@ -335,8 +336,14 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream& out, llvm::
     Internal::debug(1) << "emit_file.Compiling to native code...\n";
     Internal::debug(2) << "Target triple: " << module_in.getTargetTriple() << "\n";
 
+    Internal::CompilePhaseTimer timer("llvm_codegen");
+    if (Internal::CompilePhaseTimer::enabled()) {
+        llvm::TimePassesIsEnabled = true;
+    }
+
     // Work on a copy of the module to avoid modifying the original.
     std::unique_ptr<llvm::Module> module = clone_module(module_in);
+    timer.lap("cloning module");
 
     // Get the target specific parser.
     auto target_machine = Internal::make_target_machine(*module);
@@ -376,7 +383,9 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream& out, llvm::
     target_machine->addPassesToEmitFile(pass_manager, out, nullptr, file_type);
 #endif
 
+    timer.lap("setting up passes");
     pass_manager.run(*module);
+    timer.lap(file_type == llvm::TargetMachine::CGFT_ObjectFile ? "emitting object" : "emitting assembly");
 }
 
 std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
@@ -1,6 +1,10 @@
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
 
+#include <functional>
+#include <map>
+#include <mutex>
+
 namespace Halide {
 
 using std::string;
@@ -25,6 +29,47 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
     return result;
 }
 
+// Parsing and linking the runtime modules is a large part of the
+// compile time of small pipelines, and the result only depends on the
+// target. Keep each linked module as bitcode, which, unlike a Module,
+// can be read back into any LLVMContext.
+std::unique_ptr<llvm::Module> get_cached_module(const string &key, llvm::LLVMContext *context,
+                                                const std::function<std::unique_ptr<llvm::Module>()> &make) {
+    struct CachedModule {
+        string id;
+        vector<char> bitcode;
+    };
+    static std::mutex cache_mutex;
+    static std::map<string, CachedModule> cache;
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            const CachedModule &m = it->second;
+            llvm::StringRef sb(m.bitcode.data(), m.bitcode.size());
+            return parse_bitcode_file(sb, context, m.id.c_str());
+        }
+    }
+
+    std::unique_ptr<llvm::Module> module = make();
+
+    CachedModule m;
+    m.id = module->getModuleIdentifier();
+    llvm::SmallVector<char, 16> buffer;
+    llvm::raw_svector_ostream ostream(buffer);
+#if LLVM_VERSION >= 70
+    llvm::WriteBitcodeToFile(*module, ostream);
+#else
+    llvm::WriteBitcodeToFile(module.get(), ostream);
+#endif
+    m.bitcode.assign(buffer.begin(), buffer.end());
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.emplace(key, std::move(m));
+    return module;
+}
+
 }  // namespace
 
 #define DECLARE_INITMOD(mod)                                                              \
@@ -68,6 +113,7 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
 DECLARE_CPP_INITMOD(alignment_128)
 DECLARE_CPP_INITMOD(alignment_32)
 DECLARE_CPP_INITMOD(alignment_64)
+DECLARE_CPP_INITMOD(allocation_arena)
 DECLARE_CPP_INITMOD(android_clock)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
@@ -76,6 +122,7 @@ DECLARE_CPP_INITMOD(android_tempfile)
 DECLARE_CPP_INITMOD(buffer_t)
 DECLARE_CPP_INITMOD(cache)
 DECLARE_CPP_INITMOD(can_use_target)
+DECLARE_CPP_INITMOD(content_hash)
 DECLARE_CPP_INITMOD(cuda)
 #ifdef WITH_D3D12
 DECLARE_LL_INITMOD(d3d12_abi_patch_64)
@@ -86,10 +133,12 @@ DECLARE_NO_INITMOD(d3d12compute)
 #endif
 DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
+DECLARE_CPP_INITMOD(distributed)
 DECLARE_CPP_INITMOD(errors)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(gpu_device_selection)
+DECLARE_CPP_INITMOD(hetero_split)
 DECLARE_CPP_INITMOD(hexagon_dma)
 DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
@@ -137,9 +186,19 @@ DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(scratch_arena)
+DECLARE_CPP_INITMOD(shape_check_cache)
+DECLARE_CPP_INITMOD(shared_cache)
 DECLARE_CPP_INITMOD(ssp)
+DECLARE_CPP_INITMOD(timeline)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(tracing)
+#ifdef WITH_VULKAN
+DECLARE_CPP_INITMOD(vulkan)
+#else
+DECLARE_NO_INITMOD(vulkan)
+#endif
+DECLARE_CPP_INITMOD(wasm_host_cpu_count)
 DECLARE_CPP_INITMOD(windows_clock)
 DECLARE_CPP_INITMOD(windows_cuda)
 DECLARE_CPP_INITMOD(windows_get_symbol)
@@ -190,9 +249,11 @@ DECLARE_NO_INITMOD(arm_cpu_features)
 #ifdef WITH_AARCH64
 DECLARE_LL_INITMOD(aarch64)
 DECLARE_CPP_INITMOD(aarch64_cpu_features)
+DECLARE_CPP_INITMOD(aarch64_linux_cpu_features)
 #else
 DECLARE_NO_INITMOD(aarch64)
 DECLARE_NO_INITMOD(aarch64_cpu_features)
+DECLARE_NO_INITMOD(aarch64_linux_cpu_features)
 #endif  // WITH_AARCH64
 
 #ifdef WITH_PTX
@@ -241,6 +302,22 @@ DECLARE_NO_INITMOD(hvx_128)
 DECLARE_NO_INITMOD(hexagon_cpu_features)
 #endif  // WITH_HEXAGON
 
+#ifdef WITH_RISCV
+DECLARE_LL_INITMOD(riscv)
+DECLARE_CPP_INITMOD(riscv_cpu_features)
+#else
+DECLARE_NO_INITMOD(riscv)
+DECLARE_NO_INITMOD(riscv_cpu_features)
+#endif  // WITH_RISCV
+
+#ifdef WITH_WEBASSEMBLY
+DECLARE_LL_INITMOD(wasm)
+DECLARE_CPP_INITMOD(wasm_cpu_features)
+#else
+DECLARE_NO_INITMOD(wasm)
+DECLARE_NO_INITMOD(wasm_cpu_features)
+#endif  // WITH_WEBASSEMBLY
+
 namespace {
 
 llvm::DataLayout get_data_layout_for_target(Target target) {
@@ -301,6 +378,14 @@ llvm::DataLayout get_data_layout_for_target(Target target) {
         return llvm::DataLayout(
             "e-m:e-p:32:32:32-a:0-n16:32-i64:64:64-i32:32:32-i16:16:16-i1:8:8"
             "-f32:32:32-f64:64:64-v32:32:32-v64:64:64-v512:512:512-v1024:1024:1024-v2048:2048:2048");
+    } else if (target.arch == Target::RISCV) {
+        if (target.bits == 32) {
+            return llvm::DataLayout("e-m:e-p:32:32-i64:64-n32-S128");
+        } else {
+            return llvm::DataLayout("e-m:e-p:64:64-i64:64-i128:128-n64-S128");
+        }
+    } else if (target.arch == Target::WebAssembly) {
+        return llvm::DataLayout("e-m:e-p:32:32-i64:64-n32:64-S128");
     } else {
         internal_error << "Bad target arch: " << target.arch << "\n";
         return llvm::DataLayout("unreachable");
@@ -412,6 +497,31 @@ llvm::Triple get_triple_for_target(const Target &target) {
         triple.setVendor(llvm::Triple::UnknownVendor);
         triple.setArch(llvm::Triple::hexagon);
         triple.setObjectFormat(llvm::Triple::ELF);
+    } else if (target.arch == Target::RISCV) {
+        #if (WITH_RISCV)
+        user_assert(target.os == Target::Linux) << "RISC-V target is Linux-only.\n";
+        triple.setVendor(llvm::Triple::UnknownVendor);
+        triple.setOS(llvm::Triple::Linux);
+        triple.setEnvironment(llvm::Triple::GNU);
+        if (target.bits == 32) {
+            triple.setArch(llvm::Triple::riscv32);
+        } else {
+            user_assert(target.bits == 64) << "Target must be 32- or 64-bit.\n";
+            triple.setArch(llvm::Triple::riscv64);
+        }
+        #else
+        user_error << "RISC-V llvm target not enabled in this build of Halide\n";
+        #endif
+    } else if (target.arch == Target::WebAssembly) {
+        #if (WITH_WEBASSEMBLY)
+        user_assert(target.bits == 32) << "Only wasm32 is supported.\n";
+        triple.setArch(llvm::Triple::wasm32);
+        triple.setVendor(llvm::Triple::UnknownVendor);
+        triple.setOS(llvm::Triple::UnknownOS);
+        triple.setObjectFormat(llvm::Triple::Wasm);
+        #else
+        user_error << "WebAssembly llvm target not enabled in this build of Halide\n";
+        #endif
     } else {
         internal_error << "Bad target arch: " << target.arch << "\n";
     }
@@ -606,8 +716,9 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+std::unique_ptr<llvm::Module> link_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -747,6 +858,23 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+            } else if (t.os == Target::WebAssemblyRuntime) {
+                modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_print(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_io(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_tempfile(c, bits_64, debug));
+                modules.push_back(get_initmod_wasm_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
+                if (t.has_feature(Target::WasmThreads)) {
+                    // Emscripten implements pthreads with web workers
+                    // sharing a SharedArrayBuffer.
+                    modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+                }
+                modules.push_back(get_initmod_posix_get_symbol(c, bits_64, debug));
             }
         }
 
@@ -756,6 +884,15 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_buffer_t(c, bits_64, debug));
             modules.push_back(get_initmod_destructors(c, bits_64, debug));
             modules.push_back(get_initmod_pseudostack(c, bits_64, debug));
+            if (t.has_feature(Target::AllocationArena)) {
+                modules.push_back(get_initmod_allocation_arena(c, bits_64, debug));
+            }
+            if (t.has_feature(Target::ScratchArena)) {
+                modules.push_back(get_initmod_scratch_arena(c, bits_64, debug));
+            }
+            if (t.has_feature(Target::CacheShapeChecks)) {
+                modules.push_back(get_initmod_shape_check_cache(c, bits_64, debug));
+            }
             // Math intrinsics vary slightly across platforms
             if (t.os == Target::Windows) {
                 if (t.bits == 32) {
@@ -771,6 +908,13 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
         if (module_type != ModuleJITInlined && module_type != ModuleAOTNoRuntime) {
             // These modules are always used and shared
             modules.push_back(get_initmod_gpu_device_selection(c, bits_64, debug));
+            modules.push_back(get_initmod_hetero_split(c, bits_64, debug));
+            modules.push_back(get_initmod_distributed(c, bits_64, debug));
+            if (t.os != Target::QuRT) {
+                // The QuRT thread pool provides stubs instead, as
+                // there is no clock to record a timeline with.
+                modules.push_back(get_initmod_timeline(c, bits_64, debug));
+            }
             if (t.arch != Target::Hexagon) {
                 // These modules don't behave correctly on a real
                 // Hexagon device (they do work in the simulator
@@ -780,7 +924,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 
                 // TODO: Support this module in the Hexagon backend,
                 // currently generates assert at src/HexagonOffload.cpp:279
-                modules.push_back(get_initmod_cache(c, bits_64, debug));
+                if (t.has_feature(Target::MemoizeShared) && t.os == Target::Linux) {
+                    modules.push_back(get_initmod_shared_cache(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_cache(c, bits_64, debug));
+                }
+                modules.push_back(get_initmod_content_hash(c, bits_64, debug));
             }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
 
@@ -815,8 +964,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_old_buffer_t(c, bits_64, debug));
 
             // MIPS doesn't support the atomics the profiler requires.
+            // Without threads there is nothing to sample with on
+            // WebAssembly.
             if (t.arch != Target::MIPS && t.os != Target::NoOS &&
-                t.os != Target::QuRT) {
+                t.os != Target::QuRT &&
+                !(t.arch == Target::WebAssembly && !t.has_feature(Target::WasmThreads))) {
                 if (t.os == Target::Windows) {
                     modules.push_back(get_initmod_windows_profiler(c, bits_64, debug));
                 } else {
@@ -853,6 +1005,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.arch == Target::POWERPC) {
                 modules.push_back(get_initmod_powerpc_ll(c));
             }
+            if (t.arch == Target::RISCV) {
+                modules.push_back(get_initmod_riscv_ll(c));
+            }
+            if (t.arch == Target::WebAssembly) {
+                modules.push_back(get_initmod_wasm_ll(c));
+            }
             if (t.arch == Target::Hexagon) {
                 modules.push_back(get_initmod_qurt_hvx(c, bits_64, debug));
                 if (t.has_feature(Target::HVX_64)) {
@@ -889,7 +1047,10 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_x86_cpu_features(c, bits_64, debug));
             }
             if (t.arch == Target::ARM) {
-                if (t.bits == 64) {
+                if (t.bits == 64 && (t.os == Target::Linux || t.os == Target::Android)) {
+                    // Only Linux and Android have getauxval.
+                    modules.push_back(get_initmod_aarch64_linux_cpu_features(c, bits_64, debug));
+                } else if (t.bits == 64) {
                     modules.push_back(get_initmod_aarch64_cpu_features(c, bits_64, debug));
                 } else {
                     modules.push_back(get_initmod_arm_cpu_features(c, bits_64, debug));
@@ -901,6 +1062,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.arch == Target::POWERPC) {
                 modules.push_back(get_initmod_powerpc_cpu_features(c, bits_64, debug));
             }
+            if (t.arch == Target::RISCV) {
+                modules.push_back(get_initmod_riscv_cpu_features(c, bits_64, debug));
+            }
+            if (t.arch == Target::WebAssembly) {
+                modules.push_back(get_initmod_wasm_cpu_features(c, bits_64, debug));
+            }
             if (t.arch == Target::Hexagon) {
                 modules.push_back(get_initmod_hexagon_cpu_features(c, bits_64, debug));
             }
@@ -977,6 +1144,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_d3d12_abi_patch_64_ll(c));
             modules.push_back(get_initmod_d3d12compute(c, bits_64, debug));
         }
+        if (t.has_feature(Target::Vulkan)) {
+            modules.push_back(get_initmod_vulkan(c, bits_64, debug));
+        }
         if (t.arch != Target::Hexagon && t.features_any_of({Target::HVX_64, Target::HVX_128})) {
             modules.push_back(get_initmod_module_jit_ref_count(c, bits_64, debug));
             modules.push_back(get_initmod_hexagon_host(c, bits_64, debug));
@@ -1014,7 +1184,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 }
 
 #ifdef WITH_PTX
-std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
+std::unique_ptr<llvm::Module> link_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
     modules.push_back(get_initmod_ptx_dev_ll(c));
 
@@ -1068,6 +1238,30 @@ std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, l
 }
 #endif
 
+}  // namespace
+
+/** Create an llvm module containing the support code for a given target. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    string key = t.to_string();
+    if (for_shared_jit_runtime) {
+        key += "/shared_jit_runtime";
+    }
+    if (just_gpu) {
+        key += "/just_gpu";
+    }
+    return get_cached_module(key, c, [&]() {
+        return link_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+    });
+}
+
+#ifdef WITH_PTX
+std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
+    return get_cached_module(target.to_string() + "/ptx_device", c, [&]() {
+        return link_initial_module_for_ptx_device(target, c);
+    });
+}
+#endif
+
 void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
                            const std::vector<uint8_t> &bitcode, const std::string &name) {
     llvm::StringRef sb = llvm::StringRef((const char *)&bitcode[0], bitcode.size());
@@ -193,6 +193,16 @@ class LoopCarryOverLoop : public IRMutator2 {
 
     int max_carried_values;
 
+    // Only carry the vectors that slide windows of loads along the
+    // loop. See carry_vector_windows.
+    bool windows_only;
+
+    // The vectors the windows were rewritten in terms of, and the
+    // values to start with for those that would read before the
+    // start of their window on the first iteration.
+    set<const Load *> anchors;
+    map<const Load *, Expr> initial_anchor_values;
+
     using IRMutator2::visit;
 
     Stmt visit(const LetStmt *op) override {
@@ -244,6 +254,111 @@ class LoopCarryOverLoop : public IRMutator2 {
         return Block::make(result);
     }
 
+    bool safe_to_lift(const Load *load) {
+        return (load->image.defined() ||
+                load->param.defined() ||
+                in_consume.contains(load->name));
+    }
+
+    // Reduce an index to the canonical form step_forwards produces,
+    // so that they can be compared.
+    Expr canonical_index(Expr e) {
+        e = common_subexpression_elimination(e);
+        e = simplify(e);
+        return substitute_in_all_lets(e);
+    }
+
+    // Rewrite the dense vector loads of a buffer that slide along the
+    // loop together (e.g. f[x - 1], f[x] and f[x + 1], a vector at a
+    // time) as slices of a few vectors one vector apart. Each of these
+    // is the next one's value on the previous iteration, so all but
+    // the leading one can be carried, and the slices are single
+    // shuffles (e.g. vext on ARM or palignr on x86).
+    Stmt anchor_windows(Stmt graph_stmt) {
+        FindLoads find_loads;
+        graph_stmt.accept(&find_loads);
+
+        struct Window {
+            const Load *leader;
+            vector<pair<const Load *, int64_t>> loads;
+        };
+        vector<Window> windows;
+        for (const Load *load : find_loads.result) {
+            const Ramp *ramp = load->index.as<Ramp>();
+            if (!ramp || !is_one(ramp->stride) || !is_one(load->predicate) || !safe_to_lift(load)) {
+                continue;
+            }
+            bool found = false;
+            for (Window &w : windows) {
+                if (w.leader->name == load->name && w.leader->type == load->type) {
+                    Expr diff = canonical_index(ramp->base - w.leader->index.as<Ramp>()->base);
+                    if (const int64_t *offset = as_const_int(diff)) {
+                        w.loads.push_back({load, *offset});
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (!found) {
+                // The window must move by exactly one vector per iteration.
+                Expr next = step_forwards(ramp->base, linear);
+                if (next.defined() &&
+                    is_const(canonical_index(next - ramp->base), load->type.lanes())) {
+                    windows.push_back({load, {{load, 0}}});
+                }
+            }
+        }
+
+        for (const Window &w : windows) {
+            int64_t lo = w.loads[0].second, hi = lo;
+            for (const auto &l : w.loads) {
+                lo = std::min(lo, l.second);
+                hi = std::max(hi, l.second);
+            }
+            if (lo == hi) {
+                continue;
+            }
+
+            // The leading vector starts at the last load of the
+            // window, so no iteration reads past its end.
+            const Load *leader = w.leader;
+            int lanes = leader->type.lanes();
+            int count = (int)((hi - lo + lanes - 1) / lanes) + 1;
+            Expr base = leader->index.as<Ramp>()->base;
+            auto load_at = [&](int64_t offset) {
+                Expr idx = Ramp::make(canonical_index(base + (int)offset), 1, lanes);
+                return Load::make(leader->type, leader->name, idx, leader->image,
+                                  leader->param, leader->predicate);
+            };
+            vector<Expr> anchor(count);
+            for (int j = 0; j < count; j++) {
+                int64_t start = hi - (int64_t)(count - 1 - j) * lanes;
+                anchor[j] = load_at(start);
+                anchors.insert(anchor[j].as<Load>());
+                if (start < lo) {
+                    // On the first iteration, only the part of this
+                    // vector inside the window is used, so take it
+                    // from the first vector of the window.
+                    vector<int> indices;
+                    for (int k = 0; k < lanes; k++) {
+                        indices.push_back(std::max(0, k - (int)(lo - start)));
+                    }
+                    initial_anchor_values[anchor[j].as<Load>()] = Shuffle::make({load_at(lo)}, indices);
+                }
+            }
+            for (const auto &l : w.loads) {
+                int j = (count - 1) - (int)((hi - l.second + lanes - 1) / lanes);
+                int offset = (int)(l.second - (hi - (int64_t)(count - 1 - j) * lanes));
+                Expr slice = anchor[j];
+                if (offset != 0) {
+                    slice = Shuffle::make_slice(Shuffle::make_concat({anchor[j], anchor[j + 1]}), offset, 1, lanes);
+                }
+                graph_stmt = graph_substitute(l.first, slice, graph_stmt);
+            }
+        }
+        return graph_stmt;
+    }
+
     Stmt lift_carried_values_out_of_stmt(const Stmt &orig_stmt) {
         debug(4) << "About to lift carried values out of stmt: " << orig_stmt << "\n";
 
@@ -252,6 +367,12 @@ class LoopCarryOverLoop : public IRMutator2 {
         // exponential runtime.
         Stmt graph_stmt = substitute_in_all_lets(orig_stmt);
 
+        anchors.clear();
+        initial_anchor_values.clear();
+        if (windows_only) {
+            graph_stmt = anchor_windows(graph_stmt);
+        }
+
         // Find all the loads in these stmts.
         FindLoads find_loads;
         graph_stmt.accept(&find_loads);
@@ -262,10 +383,8 @@ class LoopCarryOverLoop : public IRMutator2 {
         vector<vector<const Load *>> loads;
         for (const Load *load : find_loads.result) {
             // Check if it's safe to lift out.
-            bool safe = (load->image.defined() ||
-                         load->param.defined() ||
-                         in_consume.contains(load->name));
-            if (!safe) continue;
+            if (!safe_to_lift(load)) continue;
+            if (windows_only && !anchors.count(load)) continue;
 
             bool represented = false;
             for (vector<const Load *> &v : loads) {
@@ -370,6 +489,22 @@ class LoopCarryOverLoop : public IRMutator2 {
         }
         chains.swap(trimmed);
 
+        if (windows_only) {
+            // The vectors that would read before the start of their
+            // window must be carried, and not be the leading edge.
+            set<const Load *> carried;
+            for (const vector<int> &c : chains) {
+                for (size_t i = 0; i + 1 < c.size(); i++) {
+                    carried.insert(loads[c[i]][0]);
+                }
+            }
+            for (const auto &p : initial_anchor_values) {
+                if (!carried.count(p.first)) {
+                    return orig_stmt;
+                }
+            }
+        }
+
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
 
@@ -405,7 +540,12 @@ class LoopCarryOverLoop : public IRMutator2 {
                                                         Parameter(), const_true(orig_load->type.lanes()));
                     not_first_iteration_scratch_stores.push_back(store_to_scratch);
                 } else {
-                    initial_scratch_values.push_back(orig_load);
+                    auto initial = initial_anchor_values.find(orig_load);
+                    if (initial != initial_anchor_values.end()) {
+                        initial_scratch_values.push_back(initial->second);
+                    } else {
+                        initial_scratch_values.push_back(orig_load);
+                    }
                 }
                 if (i > 0) {
                     Stmt shuffle = Store::make(scratch, load_from_scratch,
@@ -484,9 +624,15 @@ class LoopCarryOverLoop : public IRMutator2 {
         return op;
     }
 
+    Stmt visit(const Atomic *op) override {
+        // Other threads may change the values an atomic update
+        // loads between iterations.
+        return op;
+    }
+
 public:
-    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values, bool windows_only)
+        : in_consume(s), max_carried_values(max_carried_values), windows_only(windows_only) {
         linear.push(var, 1);
     }
 
@@ -504,6 +650,7 @@ class LoopCarry : public IRMutator2 {
     using IRMutator2::visit;
 
     int max_carried_values;
+    bool windows_only;
     Scope<> in_consume;
 
     Stmt visit(const ProducerConsumer *op) override {
@@ -517,10 +664,13 @@ class LoopCarry : public IRMutator2 {
     }
 
     Stmt visit(const For *op) override {
-        if (op->for_type == ForType::Serial && !is_one(op->extent)) {
+        if (windows_only && op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) {
+            // Leave device code alone.
+            return op;
+        } else if (op->for_type == ForType::Serial && !is_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values, windows_only);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -543,13 +693,19 @@ class LoopCarry : public IRMutator2 {
     }
 
 public:
-    LoopCarry(int max_carried_values) : max_carried_values(max_carried_values) {}
+    LoopCarry(int max_carried_values, bool windows_only)
+        : max_carried_values(max_carried_values), windows_only(windows_only) {}
 };
 
 }  // namespace
 
 Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+    s = LoopCarry(max_carried_values, false).mutate(s);
+    return s;
+}
+
+Stmt carry_vector_windows(Stmt s, int max_carried_values) {
+    s = LoopCarry(max_carried_values, true).mutate(s);
     return s;
 }
 
@@ -14,6 +14,17 @@ namespace Internal {
  * for Hexagon. */
 Stmt loop_carry(Stmt, int max_carried_values = 8);
 
+/** A form of loop_carry for vectorized loops that read a window of
+ * neighbouring values (e.g. f[x - 1], f[x] and f[x + 1], a vector at
+ * a time). The window is rewritten as slices of a few vectors one
+ * vector apart, which are shuffles rather than unaligned loads, and
+ * all but the leading one of those is carried from the previous
+ * iteration, so each iteration loads one new vector per window. No
+ * other loads are carried, and device loops are left alone. Don't
+ * simplify the result, which would collapse the slices back into
+ * loads. */
+Stmt carry_vector_windows(Stmt, int max_carried_values = 8);
+
 }  // namespace Internal
 }  // namespace Halide
 
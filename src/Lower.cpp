@@ -5,26 +5,38 @@
 
 #include "Lower.h"
 
+#include "AddBatchDimension.h"
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
+#include "AllocationArena.h"
 #include "AllocationBoundsInference.h"
 #include "AsyncProducers.h"
+#include "AutoPrefetch.h"
+#include "AutoSpecialize.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
 #include "CSE.h"
 #include "CanonicalizeGPUVars.h"
+#include "CodeSize.h"
+#include "CompilerProfiling.h"
 #include "Debug.h"
 #include "DebugArguments.h"
 #include "DebugToFile.h"
 #include "Deinterleave.h"
+#include "DenseCopies.h"
+#include "Distribute.h"
 #include "EarlyFree.h"
+#include "EmulateBFloat16Math.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
+#include "GPUTexture.h"
+#include "HeteroSplit.h"
 #include "HexagonOffload.h"
+#include "HexagonVTCM.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -32,22 +44,29 @@
 #include "InjectHostDevBufferCopies.h"
 #include "InjectOpenGLIntrinsics.h"
 #include "Inline.h"
+#include "InvariantDivision.h"
 #include "LICM.h"
 #include "LoopCarry.h"
+#include "LowerTensorCoreMatMul.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "MemoryFootprint.h"
+#include "MultiDevice.h"
+#include "PackedStorage.h"
 #include "PartitionLoops.h"
 #include "PurifyIndexMath.h"
 #include "Prefetch.h"
 #include "Profiling.h"
 #include "Qualify.h"
 #include "RealizationOrder.h"
+#include "RedundantWork.h"
 #include "RemoveDeadAllocations.h"
 #include "RemoveExternLoops.h"
 #include "RemoveTrivialForLoops.h"
 #include "RemoveUndef.h"
 #include "ScheduleFunctions.h"
 #include "SelectGPUAPI.h"
+#include "SelectVectorWidths.h"
 #include "Simplify.h"
 #include "SimplifySpecializations.h"
 #include "SkipStages.h"
@@ -55,8 +74,11 @@
 #include "SplitTuples.h"
 #include "StorageFlattening.h"
 #include "StorageFolding.h"
+#include "StorageSharing.h"
+#include "StoreInPlace.h"
 #include "StrictifyFloat.h"
 #include "Substitute.h"
+#include "TemporalBlocking.h"
 #include "Tracing.h"
 #include "TrimNoOps.h"
 #include "UnifyDuplicateLets.h"
@@ -64,6 +86,7 @@
 #include "UnpackBuffers.h"
 #include "UnsafePromises.h"
 #include "UnrollLoops.h"
+#include "Util.h"
 #include "VaryingAttributes.h"
 #include "VectorizeLoops.h"
 #include "WrapCalls.h"
@@ -80,7 +103,10 @@ using std::vector;
 
 Module lower(const vector<Function> &output_funcs, const string &pipeline_name, const Target &t,
              const vector<Argument> &args, const LinkageType linkage_type,
-             const vector<IRMutator2 *> &custom_passes) {
+             const vector<IRMutator2 *> &custom_passes,
+             const map<string, Expr> &specialization_values) {
+    CompilePhaseTimer timer("lower");
+
     std::vector<std::string> namespaces;
     std::string simple_pipeline_name = extract_namespaces(pipeline_name, namespaces);
 
@@ -112,24 +138,56 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
+    // Pick the sizes of the tiles scheduled with AutoTileSize
+    debug(1) << choose_auto_tile_sizes(env);
+
+    // Split parallel loops into strips for the sliding windows
+    // scheduled to slide within them
+    slide_in_parallel_strips(env);
+
+    // Add fast paths for likely parameter values
+    if (t.has_feature(Target::AutoSpecialize)) {
+        auto_specialize(env);
+    }
+
+    // Prefetch the inputs that stages stream through
+    if (t.has_feature(Target::AutoPrefetch)) {
+        auto_prefetch(env, MachineParams::generic());
+    }
+
     // Compute a realization order and determine group of functions which loops
     // are to be fused together
     vector<string> order;
     vector<vector<string>> fused_groups;
     std::tie(order, fused_groups) = realization_order(outputs, env);
 
+    // Resolve the specialization conditions that depend only on values
+    // known ahead of time, so the branches they rule out are pruned.
+    if (!specialization_values.empty()) {
+        substitute_in_specialization_conditions(env, specialization_values);
+    }
+
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
 
+    timer.lap("preparing the environment");
+
     debug(1) << "Creating initial loop nests...\n";
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
+    timer.lap("creating initial loop nests", s);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
+    debug(1) << "Selecting natural vector widths...\n";
+    s = select_vector_widths(s, t);
+    timer.lap("selecting natural vector widths", s);
+    debug(2) << "Lowering after selecting natural vector widths:\n" << s << '\n';
+
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
-        s = inject_memoization(s, env, pipeline_name, outputs);
+        s = inject_memoization(s, env, pipeline_name, outputs, t);
+        timer.lap("injecting memoization", s);
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
     } else {
         debug(1) << "Skipping injecting memoization...\n";
@@ -137,10 +195,12 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     debug(1) << "Injecting tracing...\n";
     s = inject_tracing(s, pipeline_name, env, outputs, t);
+    timer.lap("injecting tracing", s);
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
 
     debug(1) << "Adding checks for parameters\n";
     s = add_parameter_checks(s, t);
+    timer.lap("injecting parameter checks", s);
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
 
     // Compute the maximum and minimum possible value of each
@@ -152,6 +212,7 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // inference.
     debug(1) << "Adding checks for images\n";
     s = add_image_checks(s, outputs, t, order, env, func_bounds);
+    timer.lap("injecting image checks", s);
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
 
     // This pass injects nested definitions of variable names, so we
@@ -159,22 +220,32 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // can still simplify Exprs).
     debug(1) << "Performing computation bounds inference...\n";
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
+    timer.lap("computation bounds inference", s);
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
 
     debug(1) << "Removing extern loops...\n";
     s = remove_extern_loops(s);
+    timer.lap("removing extern loops", s);
     debug(2) << "Lowering after removing extern loops:\n" << s << '\n';
 
     debug(1) << "Performing sliding window optimization...\n";
     s = sliding_window(s, env);
+    timer.lap("sliding window", s);
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
 
+    debug(1) << "Temporally blocking chains of stencils...\n";
+    s = temporal_blocking(s, env, outputs);
+    timer.lap("temporal blocking", s);
+    debug(2) << "Lowering after temporal blocking:\n" << s << '\n';
+
     debug(1) << "Performing allocation bounds inference...\n";
     s = allocation_bounds_inference(s, env, func_bounds);
+    timer.lap("allocation bounds inference", s);
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
 
     debug(1) << "Removing code that depends on undef values...\n";
     s = remove_undef(s);
+    timer.lap("removing code that depends on undef values", s);
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
 
     // This uniquifies the variable names, so we're good to simplify
@@ -182,53 +253,100 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // equivalence means semantic equivalence.
     debug(1) << "Uniquifying variable names...\n";
     s = uniquify_variable_names(s);
+    timer.lap("uniquifying variable names", s);
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
 
     debug(1) << "Simplifying...\n";
     s = simplify(s, false); // Storage folding needs .loop_max symbols
+    timer.lap("first simplification", s);
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
 
+    debug(1) << "Storing Funcs in place of their producers...\n";
+    s = store_in_place(s, env, outputs);
+    timer.lap("storing in place", s);
+    debug(2) << "Lowering after storing in place:\n" << s << "\n\n";
+
     debug(1) << "Performing storage folding optimization...\n";
     s = storage_folding(s, env);
+    timer.lap("storage folding", s);
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
 
     debug(1) << "Injecting debug_to_file calls...\n";
     s = debug_to_file(s, outputs, env);
+    timer.lap("injecting debug_to_file calls", s);
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
 
     debug(1) << "Injecting prefetches...\n";
     s = inject_prefetch(s, env);
+    timer.lap("injecting prefetches", s);
     debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
 
     debug(1) << "Dynamically skipping stages...\n";
     s = skip_stages(s, order);
+    timer.lap("dynamically skipping stages", s);
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
 
     debug(1) << "Forking asynchronous producers...\n";
     s = fork_async_producers(s, env);
+    timer.lap("forking asynchronous producers", s);
     debug(2) << "Lowering after forking asynchronous producers:\n" << s << '\n';
 
     debug(1) << "Destructuring tuple-valued realizations...\n";
     s = split_tuples(s, env);
+    timer.lap("destructuring tuple-valued realizations", s);
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
 
+    debug(1) << "Splitting loops between the GPU and the host...\n";
+    s = hetero_split(s, env, t);
+    timer.lap("splitting loops between the GPU and the host", s);
+    debug(2) << "Lowering after splitting loops between the GPU and the host:\n" << s << "\n\n";
+
+    debug(1) << "Distributing loops across GPUs...\n";
+    s = distribute_across_devices(s, env, t);
+    timer.lap("distributing loops across GPUs", s);
+    debug(2) << "Lowering after distributing loops across GPUs:\n" << s << "\n\n";
+
+    debug(1) << "Distributing Funcs across ranks...\n";
+    s = distribute_across_ranks(s, env, outputs);
+    timer.lap("distributing Funcs across ranks", s);
+    debug(2) << "Lowering after distributing Funcs across ranks:\n" << s << "\n\n";
+
     // OpenGL relies on GPU var canonicalization occurring before
     // storage flattening
     debug(1) << "Canonicalizing GPU var names...\n";
     s = canonicalize_gpu_vars(s);
+    timer.lap("canonicalizing GPU var names", s);
     debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
 
+    debug(1) << "Lowering GPU texture reads...\n";
+    s = lower_gpu_textures(s, t);
+    timer.lap("lowering GPU texture reads", s);
+    debug(2) << "Lowering after lowering GPU texture reads:\n" << s << "\n\n";
+
     debug(1) << "Performing storage flattening...\n";
     s = storage_flattening(s, outputs, env, t);
+    timer.lap("storage flattening", s);
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
 
+    debug(1) << "Adding a dense stride fast path...\n";
+    s = add_dense_stride_fast_path(s);
+    timer.lap("adding a dense stride fast path", s);
+    debug(2) << "Lowering after adding a dense stride fast path:\n" << s << "\n\n";
+
+    debug(1) << "Adding a 32-bit index fast path...\n";
+    s = add_32_bit_index_fast_path(s, t);
+    timer.lap("adding a 32-bit index fast path", s);
+    debug(2) << "Lowering after adding a 32-bit index fast path:\n" << s << "\n\n";
+
     debug(1) << "Unpacking buffer arguments...\n";
     s = unpack_buffers(s);
+    timer.lap("unpacking buffer arguments", s);
     debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
 
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
         s = rewrite_memoized_allocations(s, env);
+        timer.lap("rewriting memoized allocations", s);
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
     } else {
         debug(1) << "Skipping rewriting memoized allocations...\n";
@@ -241,20 +359,24 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
         s = select_gpu_api(s, t);
+        timer.lap("selecting a GPU API", s);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
         debug(1) << "Injecting host <-> dev buffer copies...\n";
         s = inject_host_dev_buffer_copies(s, t);
+        timer.lap("injecting host <-> dev buffer copies", s);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
         debug(1) << "Selecting a GPU API for extern stages...\n";
         s = select_gpu_api(s, t);
+        timer.lap("selecting a GPU API for extern stages", s);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
         s = inject_opengl_intrinsics(s);
+        timer.lap("OpenGL intrinsics", s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
 
@@ -262,95 +384,209 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     s = simplify(s);
     s = unify_duplicate_lets(s);
     s = remove_trivial_for_loops(s);
+    timer.lap("second simplification", s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
     debug(1) << "Reduce prefetch dimension...\n";
     s = reduce_prefetch_dimension(s, t);
+    timer.lap("reduce prefetch dimension", s);
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
+    debug(1) << "Lowering dense copies and fills...\n";
+    s = lower_dense_copies(s);
+    timer.lap("lowering dense copies", s);
+    debug(2) << "Lowering after lowering dense copies and fills:\n" << s << "\n\n";
+
+    // Unrolling and partitioning loops copy their bodies, which can
+    // grow the code past what fits in the instruction cache.
+    CodeSizeBudget code_size_budget(env, t);
+    code_size_budget.measure(s);
+
     debug(1) << "Unrolling...\n";
-    s = unroll_loops(s);
+    s = unroll_loops(s, code_size_budget);
     s = simplify(s);
+    timer.lap("unrolling", s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
     debug(1) << "Vectorizing...\n";
     s = vectorize_loops(s, t);
     s = simplify(s);
+    timer.lap("vectorizing", s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
+    debug(1) << "Lowering packed storage...\n";
+    s = lower_packed_storage(s);
+    timer.lap("lowering packed storage", s);
+    debug(2) << "Lowering after lowering packed storage:\n" << s << "\n\n";
+
+    debug(1) << "Emulating bfloat16 math...\n";
+    s = lower_bfloat16_math(s);
+    timer.lap("emulating bfloat16 math", s);
+    debug(2) << "Lowering after emulating bfloat16 math:\n" << s << "\n\n";
+
+    if (t.has_feature(Target::CUDA) && t.has_feature(Target::CUDACapability70)) {
+        debug(1) << "Mapping matrix multiply tiles onto tensor cores...\n";
+        s = lower_tensor_core_mat_mul(s);
+        timer.lap("mapping matrix multiply tiles onto tensor cores", s);
+        debug(2) << "Lowering after mapping matrix multiply tiles onto tensor cores:\n" << s << "\n\n";
+    }
+
+    if (t.has_feature(Target::CUDA)) {
+        debug(1) << "Lowering reductions across warp lanes...\n";
+        s = lower_warp_reductions(s);
+        timer.lap("lowering reductions across warp lanes", s);
+        debug(2) << "Lowering after lowering reductions across warp lanes:\n" << s << "\n\n";
+    }
+
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
         s = fuse_gpu_thread_loops(s);
+        timer.lap("injecting per-block gpu synchronization", s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
     }
 
     debug(1) << "Detecting vector interleavings...\n";
     s = rewrite_interleavings(s);
     s = simplify(s);
+    timer.lap("rewriting vector interleavings", s);
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
+    code_size_budget.measure(s);
+    s = partition_loops(s, code_size_budget);
     s = simplify(s);
+    timer.lap("partitioning loops", s);
     debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
     s = trim_no_ops(s);
+    timer.lap("loop trimming", s);
     debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
 
     debug(1) << "Injecting early frees...\n";
     s = inject_early_frees(s);
+    timer.lap("injecting early frees", s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
+    debug(1) << "Sharing storage between non-overlapping allocations...\n";
+    s = share_storage(s);
+    timer.lap("sharing storage", s);
+    debug(2) << "Lowering after sharing storage:\n" << s << "\n\n";
+
+    // Branches are counted and weighted at the same point, so that
+    // they are named in the same way.
+    string branch_profile = get_env_variable("HL_PROFILE_INPUT");
+    if (!branch_profile.empty() && !t.has_feature(Target::ProfileBranches)) {
+        debug(1) << "Applying the branch profile...\n";
+        s = apply_branch_profile(s, pipeline_name, branch_profile);
+        timer.lap("applying the branch profile", s);
+        debug(2) << "Lowering after applying the branch profile:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = inject_profiling(s, pipeline_name,
+                             t.has_feature(Target::ProfileByThread),
+                             t.has_feature(Target::ProfileRoofline),
+                             t.has_feature(Target::ProfileBranches));
+        timer.lap("injecting profiling", s);
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
         s = fuzz_float_stores(s);
+        timer.lap("fuzzing floating point stores", s);
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
     debug(1) << "Bounding small allocations...\n";
     s = bound_small_allocations(s);
+    timer.lap("bounding small allocations", s);
     debug(2) << "Lowering after bounding small allocations:\n" << s << "\n\n";
 
+    if (t.arch == Target::Hexagon || t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        debug(1) << "Placing Hexagon allocations in VTCM...\n";
+        s = place_allocations_in_vtcm(s, t);
+        timer.lap("placing Hexagon allocations in VTCM", s);
+        debug(2) << "Lowering after placing Hexagon allocations in VTCM:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
         s = lower_warp_shuffles(s);
+        timer.lap("injecting warp shuffles", s);
         debug(2) << "Lowering after injecting warp shuffles:\n" << s << "\n\n";
     }
 
+    if (t.has_feature(Target::CUDA)) {
+        debug(1) << "Injecting gpu launch bounds...\n";
+        s = inject_gpu_launch_bounds(s, env);
+        timer.lap("injecting gpu launch bounds", s);
+        debug(2) << "Lowering after injecting gpu launch bounds:\n" << s << "\n\n";
+    }
+
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
+    timer.lap("common subexpression elimination", s);
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
         s = find_linear_expressions(s);
+        timer.lap("detecting varying attributes", s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
         s = setup_gpu_vertex_buffer(s);
+        timer.lap("removing varying attributes", s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
 
     debug(1) << "Lowering unsafe promises...\n";
     s = lower_unsafe_promises(s, t);
+    timer.lap("lowering unsafe promises", s);
     debug(2) << "Lowering after lowering unsafe promises:\n" << s << "\n\n";
 
     s = remove_dead_allocations(s);
     s = remove_trivial_for_loops(s);
+
+    if (t.has_feature(Target::AllocationArena)) {
+        debug(1) << "Serving heap allocations from an arena...\n";
+        s = use_allocation_arena(s, t);
+        timer.lap("serving heap allocations from an arena", s);
+        debug(2) << "Lowering after serving heap allocations from an arena:\n" << s << "\n\n";
+    }
+
+    if (t.has_feature(Target::ScratchArena)) {
+        debug(1) << "Serving heap allocations inside parallel loops from scratch arenas...\n";
+        s = use_scratch_arenas(s, t);
+        timer.lap("serving heap allocations from scratch arenas", s);
+        debug(2) << "Lowering after serving heap allocations from scratch arenas:\n" << s << "\n\n";
+    }
+
+    debug(1) << "Lowering division by loop invariants...\n";
+    s = lower_invariant_division(s);
+    timer.lap("lowering division by loop invariants", s);
+    debug(2) << "Lowering after lowering division by loop invariants:\n" << s << "\n\n";
+
     s = simplify(s);
     s = loop_invariant_code_motion(s);
+    timer.lap("final simplification", s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
 
+    if (t.arch == Target::X86 || t.arch == Target::ARM) {
+        // This comes after the final simplification, which would undo it.
+        debug(1) << "Carrying vector windows across loop iterations...\n";
+        s = carry_vector_windows(s);
+        timer.lap("carrying vector windows", s);
+        debug(2) << "Lowering after carrying vector windows:\n" << s << "\n\n";
+    }
+
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
         debug(1) << "Splitting off Hexagon offload...\n";
         s = inject_hexagon_rpc(s, t, result_module);
+        timer.lap("splitting off Hexagon offload", s);
         debug(2) << "Lowering after splitting off Hexagon offload:\n" << s << '\n';
     } else {
         debug(1) << "Skipping Hexagon offload...\n";
@@ -360,6 +596,7 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
             s = custom_passes[i]->mutate(s);
+            timer.lap("custom pass " + std::to_string(i), s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
         }
     }
@@ -373,6 +610,17 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         }
     }
 
+    if (debug::debug_level() >= 1) {
+        Expr num_threads = Variable::make(Int(32), "num_threads");
+        MemoryFootprint footprint = peak_memory_footprint(s, num_threads);
+        debug(1) << "Peak memory footprint:\n"
+                 << "  heap bytes: " << footprint.heap_bytes << "\n"
+                 << "  stack bytes: " << footprint.stack_bytes << "\n"
+                 << "Peak memory footprint at the argument estimates:\n"
+                 << "  heap bytes: " << substitute_argument_estimates(footprint.heap_bytes, public_args, outputs) << "\n"
+                 << "  stack bytes: " << substitute_argument_estimates(footprint.stack_bytes, public_args, outputs) << "\n";
+    }
+
     vector<InferredArgument> inferred_args = infer_arguments(s, outputs);
     for (const InferredArgument &arg : inferred_args) {
         if (arg.param.defined() && arg.param.name() == "__user_context") {
@@ -440,6 +688,12 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     LoweredFunc main_func(pipeline_name, public_args, s, linkage_type);
 
+    // The pipeline compiled above runs on one image. Call it on each
+    // image of the batch from a wrapper.
+    if (t.has_feature(Target::BatchDimension)) {
+        main_func = add_batch_dimension(result_module, main_func);
+    }
+
     // If we're in debug mode, add code that prints the args.
     if (t.has_feature(Target::Debug)) {
         debug_arguments(&main_func);
@@ -454,6 +708,8 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         add_legacy_wrapper(result_module, main_func);
     }
 
+    timer.lap("inferring arguments and finishing up", s);
+
     return result_module;
 }
 
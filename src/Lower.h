@@ -8,6 +8,7 @@
  */
 
 #include <iterator>
+#include <map>
 
 #include "Argument.h"
 #include "IR.h"
@@ -28,7 +29,8 @@ class IRMutator2;
  * calling convention. */
 Module lower(const std::vector<Function> &output_funcs, const std::string &pipeline_name, const Target &t,
                     const std::vector<Argument> &args, const LinkageType linkage_type,
-                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>());
+                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>(),
+                    const std::map<std::string, Expr> &specialization_values = std::map<std::string, Expr>());
 
 /** Given a halide function with a schedule, create a statement that
  * evaluates it. Automatically pulls in all the functions f depends
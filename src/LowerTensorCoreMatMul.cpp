@@ -0,0 +1,256 @@
+#include "LowerTensorCoreMatMul.h"
+#include "Debug.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The m, n, and k extents of the one wmma shape we map onto.
+const int wmma_tile_size = 16;
+
+class HasThreadLoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+bool has_thread_loops(const Stmt &s) {
+    HasThreadLoops h;
+    s.accept(&h);
+    return h.result;
+}
+
+// A load of a matrix element, with the amount its index moves by per
+// iteration of each of the three loops of the tile.
+struct MatrixLoad {
+    const Load *load = nullptr;
+    Expr coeff[3];
+};
+
+class LowerTensorCoreMatMul : public IRMutator2 {
+    using IRMutator2::visit;
+
+    bool in_kernel = false;
+
+    const For *loops[3];
+
+    // The amount 'index' changes by when loop i advances by one, or
+    // an undefined Expr if that depends on any of the loops of the
+    // tile.
+    Expr coefficient(const Expr &index, int i) {
+        Expr var = Variable::make(Int(32), loops[i]->name);
+        Expr delta = simplify(substitute(loops[i]->name, var + 1, index) - index);
+        for (int j = 0; j < 3; j++) {
+            if (expr_uses_var(delta, loops[j]->name)) {
+                return Expr();
+            }
+        }
+        return delta;
+    }
+
+    bool match_load(Expr e, Type accumulator_type, MatrixLoad *result) {
+        if (accumulator_type != Float(16)) {
+            const Cast *c = e.as<Cast>();
+            if (!c || c->type != accumulator_type) {
+                return false;
+            }
+            e = c->value;
+        }
+        result->load = e.as<Load>();
+        if (!result->load ||
+            result->load->type != Float(16) ||
+            !is_one(result->load->predicate)) {
+            return false;
+        }
+        for (int i = 0; i < 3; i++) {
+            result->coeff[i] = coefficient(result->load->index, i);
+            if (!result->coeff[i].defined()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The multiply-accumulate to issue for the tile rooted at 'op', or
+    // an undefined Expr if the loop nest doesn't match.
+    Expr match_tile(const For *op) {
+        Stmt s = op;
+        for (int i = 0; i < 3; i++) {
+            loops[i] = s.as<For>();
+            if (!loops[i] ||
+                loops[i]->for_type != ForType::Serial ||
+                !is_const(loops[i]->extent, wmma_tile_size)) {
+                return Expr();
+            }
+            for (int j = 0; j < i; j++) {
+                if (expr_uses_var(loops[i]->min, loops[j]->name)) {
+                    return Expr();
+                }
+            }
+            s = loops[i]->body;
+        }
+
+        // The body must be C[i] = C[i] + A[...] * B[...]
+        const Store *store = s.as<Store>();
+        if (!store || !is_one(store->predicate)) {
+            return Expr();
+        }
+        Type acc_type = store->value.type();
+        if (acc_type != Float(32) && acc_type != Float(16)) {
+            return Expr();
+        }
+        const Add *add = store->value.as<Add>();
+        if (!add) {
+            return Expr();
+        }
+        const Load *c = add->a.as<Load>();
+        const Mul *mul = add->b.as<Mul>();
+        if (!c || !mul) {
+            c = add->b.as<Load>();
+            mul = add->a.as<Mul>();
+        }
+        if (!c || !mul ||
+            c->name != store->name ||
+            !is_one(c->predicate) ||
+            !equal(c->index, store->index)) {
+            return Expr();
+        }
+
+        MatrixLoad p, q;
+        if (!match_load(mul->a, acc_type, &p) ||
+            !match_load(mul->b, acc_type, &q) ||
+            p.load->name == store->name ||
+            q.load->name == store->name) {
+            return Expr();
+        }
+
+        // The loop C doesn't depend on is the reduction over k, and
+        // the one it's dense in is n. The operand that doesn't depend
+        // on n is A.
+        Expr c_coeff[3];
+        int k = -1, n = -1, m = -1;
+        for (int i = 0; i < 3; i++) {
+            c_coeff[i] = coefficient(store->index, i);
+            if (!c_coeff[i].defined()) {
+                return Expr();
+            } else if (is_zero(c_coeff[i]) && k < 0) {
+                k = i;
+            } else if (is_one(c_coeff[i]) && n < 0) {
+                n = i;
+            } else {
+                m = i;
+            }
+        }
+        if (k < 0 || n < 0 || m < 0 || is_zero(c_coeff[m])) {
+            return Expr();
+        }
+        if (!is_zero(p.coeff[n])) {
+            std::swap(p, q);
+        }
+        if (!is_zero(p.coeff[n]) || !is_zero(q.coeff[m])) {
+            return Expr();
+        }
+
+        // A is m x k and B is k x n. Each is row major if it is dense
+        // along its second dimension, and column major if it is dense
+        // along its first.
+        string a_layout, b_layout;
+        Expr lda, ldb;
+        if (is_one(p.coeff[k]) && !is_zero(p.coeff[m])) {
+            a_layout = "row";
+            lda = p.coeff[m];
+        } else if (is_one(p.coeff[m]) && !is_zero(p.coeff[k])) {
+            a_layout = "col";
+            lda = p.coeff[k];
+        } else {
+            return Expr();
+        }
+        if (is_one(q.coeff[n]) && !is_zero(q.coeff[k])) {
+            b_layout = "row";
+            ldb = q.coeff[k];
+        } else if (is_one(q.coeff[k]) && !is_zero(q.coeff[n])) {
+            b_layout = "col";
+            ldb = q.coeff[n];
+        } else {
+            return Expr();
+        }
+
+        // Point each operand at the first element of its tile.
+        map<string, Expr> at_origin;
+        for (int i = 0; i < 3; i++) {
+            at_origin[loops[i]->name] = loops[i]->min;
+        }
+        auto origin = [&](const Load *l) {
+            return Load::make(l->type, l->name, simplify(substitute(at_origin, l->index)),
+                              l->image, l->param, const_true());
+        };
+        vector<Expr> args = {origin(c), c_coeff[m],
+                             origin(p.load), lda,
+                             origin(q.load), ldb};
+        string name = "halide_ptx_wmma_m16n16k16_" + a_layout + "_" + b_layout;
+        return Call::make(Bool(), name, args, Call::Extern);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock && !in_kernel) {
+            // Only kernels with a single thread per block have their
+            // block-level loops free for us to spread over a warp.
+            if (op->device_api != DeviceAPI::CUDA || has_thread_loops(op->body)) {
+                return op;
+            }
+            ScopedValue<bool> old_in_kernel(in_kernel, true);
+            return IRMutator2::visit(op);
+        } else if (!in_kernel) {
+            return IRMutator2::visit(op);
+        }
+
+        Expr mma = match_tile(op);
+        if (!mma.defined()) {
+            return IRMutator2::visit(op);
+        }
+
+        // All 32 lanes run the multiply-accumulate, which returns
+        // false without touching memory if the operands are
+        // misaligned. In that case one lane runs the original loop
+        // nest. Like any other loop over threads at the block level,
+        // fuse_gpu_thread_loops puts barriers between this and
+        // whatever reads the results.
+        string lane = op->name + ".__thread_id_x";
+        Expr lane_var = Variable::make(Int(32), lane);
+        Stmt fallback = IfThenElse::make(lane_var == 0, op);
+        Stmt body = IfThenElse::make(!mma, fallback);
+        debug(2) << "Mapping " << op->name << " onto tensor cores with " << mma.as<Call>()->name << "\n";
+        return For::make(lane, 0, 32, ForType::GPUThread, DeviceAPI::CUDA, body);
+    }
+};
+
+}  // namespace
+
+Stmt lower_tensor_core_mat_mul(Stmt s) {
+    return LowerTensorCoreMatMul().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,28 @@
+#ifndef HALIDE_LOWER_TENSOR_CORE_MAT_MUL_H
+#define HALIDE_LOWER_TENSOR_CORE_MAT_MUL_H
+
+/** \file
+ * Defines the lowering pass that maps 16x16x16 matrix multiply tiles
+ * in CUDA kernels onto tensor core instructions.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find serial loop nests at the block level of CUDA kernels that
+ * accumulate a 16x16x16 tile of a float16 matrix product into a
+ * float16 or float32 accumulator, and replace each with a loop over
+ * the 32 lanes of a warp that calls a tensor core multiply-accumulate
+ * (which CodeGen_PTX_Dev lowers to wmma intrinsics). The original loop
+ * nest is kept and run by a single lane if the operands turn out not
+ * to meet the alignment wmma requires. Kernels that already loop over
+ * gpu threads are left alone. Must be run before
+ * fuse_gpu_thread_loops. */
+Stmt lower_tensor_core_mat_mul(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
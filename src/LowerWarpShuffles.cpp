@@ -4,6 +4,7 @@
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
 #include "LICM.h"
 #include "Simplify.h"
 #include "Solve.h"
@@ -763,6 +764,199 @@ class HoistWarpShuffles : public IRMutator2 {
     }
 };
 
+class LoadsFrom : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &name;
+
+    void visit(const Load *op) override {
+        result = result || op->name == name;
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+    LoadsFrom(const string &name) : name(name) {}
+};
+
+// Every lane of a warp updating the same location with an
+// associative and commutative operator, as in:
+//
+// for (r, 0, 32) gpu_lanes { f[i] = f[i] + g(r) }
+//
+// is a race condition as written. Rewrite it as a butterfly of warp
+// shuffles, which leaves the total in every lane, followed by a
+// single update from the first lane:
+//
+// for (r, 0, 32) gpu_lanes {
+//   t0 = g(r)
+//   t1 = t0 + shfl.bfly(t0, 16)
+//   ...
+//   t5 = t4 + shfl.bfly(t4, 1)
+//   if (r == 0) f[i] = f[i] + t5
+// }
+//
+// Lane loops with an extent that is not a power of two are widened
+// to the next power of two, with the extra lanes contributing the
+// identity of the operator.
+class LowerWarpReductions : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The operators we know how to reduce across a warp.
+    template<typename T>
+    bool match_update(const Expr &value, const Store *store, IRNodeType *kind, Expr *self, Expr *term) {
+        const T *op = value.as<T>();
+        if (!op) {
+            return false;
+        }
+        auto is_self = [&](const Expr &e) {
+            const Load *load = e.as<Load>();
+            return (load && load->name == store->name &&
+                    equal(load->index, store->index) &&
+                    is_one(load->predicate));
+        };
+        if (is_self(op->a)) {
+            *self = op->a;
+            *term = op->b;
+        } else if (is_self(op->b)) {
+            *self = op->b;
+            *term = op->a;
+        } else {
+            return false;
+        }
+        LoadsFrom loads(store->name);
+        term->accept(&loads);
+        *kind = T::_node_type;
+        return !loads.result;
+    }
+
+    Expr combine(IRNodeType kind, Expr a, Expr b) {
+        switch (kind) {
+        case IRNodeType::Add:
+            return Add::make(a, b);
+        case IRNodeType::Mul:
+            return Mul::make(a, b);
+        case IRNodeType::Min:
+            return Min::make(a, b);
+        default:
+            internal_assert(kind == IRNodeType::Max);
+            return Max::make(a, b);
+        }
+    }
+
+    Expr identity(IRNodeType kind, Type t) {
+        switch (kind) {
+        case IRNodeType::Add:
+            return make_zero(t);
+        case IRNodeType::Mul:
+            return make_one(t);
+        case IRNodeType::Min:
+            return t.max();
+        default:
+            return t.min();
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::GPULane) {
+            return IRMutator2::visit(op);
+        }
+
+        // Look for a single update to a location that doesn't depend
+        // on the lane, possibly under some lets.
+        vector<pair<string, Expr>> lets;
+        Scope<> varying;
+        varying.push(op->name);
+        Stmt body = op->body;
+        while (const LetStmt *let = body.as<LetStmt>()) {
+            lets.push_back({let->name, let->value});
+            if (expr_uses_vars(let->value, varying)) {
+                varying.push(let->name);
+            }
+            body = let->body;
+        }
+
+        const Store *store = body.as<Store>();
+        if (!store ||
+            !is_one(store->predicate) ||
+            !store->value.type().is_scalar() ||
+            expr_uses_vars(store->index, varying)) {
+            return op;
+        }
+
+        IRNodeType kind;
+        Expr self, term;
+        if (!(match_update<Add>(store->value, store, &kind, &self, &term) ||
+              match_update<Mul>(store->value, store, &kind, &self, &term) ||
+              match_update<Min>(store->value, store, &kind, &self, &term) ||
+              match_update<Max>(store->value, store, &kind, &self, &term))) {
+            return op;
+        }
+
+        Type type = term.type();
+        user_assert(op->device_api == DeviceAPI::CUDA)
+            << "Reductions over a gpu_lanes() loop are only supported on CUDA, "
+            << "but the loop over " << op->name << " runs on " << op->device_api << "\n";
+        user_assert(type.bits() <= 32 && !type.is_handle() &&
+                    !(type.is_float() && type.bits() != 32))
+            << "Reductions over a gpu_lanes() loop are not supported for type " << type << "\n";
+
+        const int64_t *loop_size = as_const_int(op->extent);
+        user_assert(loop_size && *loop_size <= 32)
+            << "CUDA gpu lanes loop must have constant extent of at most 32: " << op->extent << "\n";
+        int warp_size = 1;
+        while (warp_size < *loop_size) {
+            warp_size *= 2;
+        }
+
+        Expr lane = Variable::make(Int(32), op->name);
+        if (warp_size != *loop_size) {
+            // Keep the extra lanes reading in bounds, and have them
+            // contribute nothing.
+            Expr last = op->min + op->extent - 1;
+            for (auto &let : lets) {
+                let.second = substitute(op->name, min(lane, last), let.second);
+            }
+            term = substitute(op->name, min(lane, last), term);
+            term = select(lane <= last, term, identity(kind, type));
+        }
+
+        Type shuffle_type = type.bits() < 32 ? UInt(32) : type;
+        string intrin_suffix = shuffle_type.is_float() ? ".f32" : ".i32";
+        Expr mask = ((31 & ~(warp_size - 1)) << 8) | 31;
+
+        vector<pair<string, Expr>> tree;
+        string name = unique_name('t');
+        tree.push_back({name, term});
+        for (int offset = warp_size / 2; offset > 0; offset /= 2) {
+            Expr partial = Variable::make(type, name);
+            Expr shuffled = partial;
+            if (type != shuffle_type) {
+                shuffled = cast(shuffle_type, reinterpret(type.with_code(Type::UInt), shuffled));
+            }
+            shuffled = Call::make(shuffle_type, "llvm.nvvm.shfl.bfly" + intrin_suffix,
+                                  {shuffled, offset, mask}, Call::PureExtern);
+            if (type != shuffle_type) {
+                shuffled = reinterpret(type, cast(type.with_code(Type::UInt), shuffled));
+            }
+            name = unique_name('t');
+            tree.push_back({name, combine(kind, partial, shuffled)});
+        }
+
+        Expr total = Variable::make(type, name);
+        Stmt s = Store::make(store->name, combine(kind, self, total),
+                             store->index, store->param, store->predicate);
+        s = IfThenElse::make(lane == op->min, s);
+        for (size_t i = tree.size(); i > 0; i--) {
+            s = LetStmt::make(tree[i - 1].first, tree[i - 1].second, s);
+        }
+        for (size_t i = lets.size(); i > 0; i--) {
+            s = LetStmt::make(lets[i - 1].first, lets[i - 1].second, s);
+        }
+        return For::make(op->name, op->min, warp_size, op->for_type, op->device_api, s);
+    }
+};
+
 class HasLaneLoop : public IRVisitor {
     using IRVisitor::visit;
 
@@ -810,5 +1004,9 @@ Stmt lower_warp_shuffles(Stmt s) {
     return s;
 };
 
+Stmt lower_warp_reductions(Stmt s) {
+    return LowerWarpReductions().mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
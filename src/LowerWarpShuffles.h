@@ -2,8 +2,9 @@
 #define HALIDE_LOWER_WARP_SHUFFLES_H
 
 /** \file
- * Defines the lowering pass that injects CUDA warp shuffle
- * instructions to access storage outside of a GPULane loop.
+ * Defines the lowering passes that inject CUDA warp shuffle
+ * instructions to access storage outside of a GPULane loop, and to
+ * reduce across the lanes of a warp.
  */
 
 #include "IR.h"
@@ -15,6 +16,13 @@ namespace Internal {
  * use nvidia's warp shuffle instructions. */
 Stmt lower_warp_shuffles(Stmt s);
 
+/** Rewrite updates made by every lane of a GPULane loop to the same
+ * location with an associative and commutative operator, which are
+ * race conditions as written, into trees of warp shuffles followed by
+ * a single update. Must run before the loops over GPU threads are
+ * fused. */
+Stmt lower_warp_reductions(Stmt s);
+
 }  // namespace Internal
 }  // namespace Halide
 
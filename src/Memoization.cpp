@@ -1,13 +1,17 @@
 #include "Memoization.h"
 #include "Error.h"
+#include "FindCalls.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
+#include "Module.h"
 #include "Param.h"
 #include "Scope.h"
 #include "Util.h"
 #include "Var.h"
 
 #include <map>
+#include <sstream>
 
 namespace Halide {
 namespace Internal {
@@ -84,12 +88,20 @@ public:
 
         info.type = parameter.type();
 
-        if (parameter.is_buffer()) {
+        if (parameter.is_buffer() && content_hash) {
+            // Key on a hash of the buffer's contents, computed by the
+            // runtime when the key is built.
+            info.type = UInt(64);
+            info.size_expr = info.type.bytes();
+            Expr buffer = Variable::make(type_of<halide_buffer_t *>(), parameter.name() + ".buffer");
+            info.value_expr = Call::make(info.type, "halide_buffer_content_hash", {buffer}, Call::Extern);
+        } else if (parameter.is_buffer()) {
             internal_error << "Buffer parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
                 "Computations which depend on buffer parameters " <<
                 "cannot be scheduled compute_cached.\n" <<
-                "Use memoize_tag to provide cache key information for buffer.\n";
+                "Use memoize_tag to provide cache key information for buffer, " <<
+                "or memoize(MemoizeKey::ContentHash) to key on its contents.\n";
         } else if (info.type.is_handle()) {
             internal_error << "Handle parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
@@ -139,16 +151,100 @@ public:
     };
 
     std::map<DependencyKey, DependencyInfo> dependency_info;
+
+    // Whether buffer parameters are keyed on a hash of their contents.
+    bool content_hash = false;
 };
 
 typedef std::pair<FindParameterDependencies::DependencyKey, FindParameterDependencies::DependencyInfo> DependencyKeyInfoPair;
 
+class FindProducer : public IRVisitor {
+    const std::string &name;
+
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == name) {
+            producer = op;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    Stmt producer;
+
+    FindProducer(const std::string &name) : name(name) {}
+};
+
+// A hash of everything that determines the values of a memoized Func,
+// other than the parameters in the rest of its key: its lowered
+// producer, the definitions of the Funcs it calls, the target, and the
+// versions of LLVM and of libHalide. The memoize_shared cache outlives
+// the process, so without this a pipeline rebuilt with a different
+// algorithm, or another program using the same names, would find stale
+// results under the same names.
+std::string definition_hash(const Function &f, const Stmt &realize_body, const Target &t) {
+    std::ostringstream key;
+    // There is no release version of Halide to use, so use the time
+    // libHalide was built.
+    key << "halide=" << __DATE__ << " " << __TIME__ << "\n"
+        << "llvm=" << LLVM_VERSION << "\n"
+        << "target=" << t.to_string() << "\n";
+
+    FindProducer producer(f.name());
+    realize_body.accept(&producer);
+    if (producer.producer.defined()) {
+        key << producer.producer;
+    }
+
+    for (const auto &it : find_transitive_calls(f)) {
+        const Function &g = it.second;
+        key << "func " << g.name() << "\n";
+        if (g.has_extern_definition()) {
+            key << "extern " << g.extern_function_name();
+            for (const ExternFuncArgument &arg : g.extern_arguments()) {
+                key << " ";
+                if (arg.is_func()) {
+                    key << Function(arg.func).name();
+                } else if (arg.is_expr()) {
+                    key << arg.expr;
+                } else if (arg.is_buffer()) {
+                    key << arg.buffer.name();
+                } else if (arg.is_image_param()) {
+                    key << arg.image_param.name();
+                }
+            }
+            key << "\n";
+            continue;
+        }
+        std::vector<Definition> definitions = {g.definition()};
+        definitions.insert(definitions.end(), g.updates().begin(), g.updates().end());
+        for (const Definition &d : definitions) {
+            if (!d.defined()) {
+                continue;
+            }
+            key << "(";
+            for (const Expr &a : d.args()) {
+                key << a << ", ";
+            }
+            key << ") = (";
+            for (const Expr &v : d.values()) {
+                key << v << ", ";
+            }
+            key << ") if " << d.predicate() << "\n";
+        }
+    }
+    return hash_cache_key(key.str());
+}
+
 class KeyInfo {
     FindParameterDependencies dependencies;
     Expr key_size_expr;
     const std::string &top_level_name;
     const std::string &function_name;
     int memoize_instance;
+    std::string definition_id;
 
     size_t parameters_alignment() {
         int32_t max_alignment = 0;
@@ -182,11 +278,14 @@ class KeyInfo {
 // It was deleted as part of the address_of intrinsic cleanup).
 
 public:
-    KeyInfo(const Function &function, const std::string &name, int memoize_instance)
+    KeyInfo(const Function &function, const std::string &name, int memoize_instance,
+            const std::string &definition_id = "")
         : top_level_name(name),
           function_name(function.origin_name()),
-          memoize_instance(memoize_instance)
+          memoize_instance(memoize_instance),
+          definition_id(definition_id)
     {
+        dependencies.content_hash = function.schedule().memoize_key() == MemoizeKey::ContentHash;
         dependencies.visit_function(function);
         size_t size_so_far = 0;
         size_so_far += Handle().bytes() + 4;
@@ -216,10 +315,16 @@ public:
         // Store a pointer to a string identifying the filter and
         // function. Assume this will be unique due to CSE. This can
         // break with loading and unloading of code, though the name
-        // mechanism can also break in those conditions.
+        // mechanism can also break in those conditions. The shared
+        // cache keys on the string itself, and needs the hash of the
+        // definition in it too.
+        std::string id = std::to_string(top_level_name.size()) + ":" + top_level_name +
+            std::to_string(function_name.size()) + ":" + function_name;
+        if (!definition_id.empty()) {
+            id += std::to_string(definition_id.size()) + ":" + definition_id;
+        }
         writes.push_back(Store::make(key_name,
-                                     StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
-                                                     std::to_string(function_name.size()) + ":" + function_name),
+                                     StringImm::make(id),
                                      (index / Handle().bytes()), Parameter(), const_true()));
         size_t alignment = Handle().bytes();
         index += Handle().bytes();
@@ -310,12 +415,14 @@ public:
     int memoize_instance;
     const std::string &top_level_name;
     const std::vector<Function> &outputs;
+    const Target &target;
 
     InjectMemoization(const std::map<std::string, Function> &e,
                       int memoize_instance,
                       const std::string &name,
-                      const std::vector<Function> &outputs) :
-        env(e), memoize_instance(memoize_instance), top_level_name(name), outputs(outputs) {}
+                      const std::vector<Function> &outputs,
+                      const Target &target) :
+        env(e), memoize_instance(memoize_instance), top_level_name(name), outputs(outputs), target(target) {}
 private:
 
     using IRMutator2::visit;
@@ -347,7 +454,11 @@ private:
 
             Stmt mutated_body = mutate(op->body);
 
-            KeyInfo key_info(f, top_level_name, memoize_instance);
+            std::string definition_id;
+            if (target.has_feature(Target::MemoizeShared)) {
+                definition_id = definition_hash(f, op->body, target);
+            }
+            KeyInfo key_info(f, top_level_name, memoize_instance, definition_id);
 
             std::string cache_key_name = op->name + ".cache_key";
             std::string cache_result_name = op->name + ".cache_result";
@@ -428,14 +539,22 @@ private:
 
 Stmt inject_memoization(Stmt s, const std::map<std::string, Function> &env,
                         const std::string &name,
-                        const std::vector<Function> &outputs) {
+                        const std::vector<Function> &outputs,
+                        const Target &target) {
     // Cache keys use the addresses of names of Funcs. For JIT, a
     // counter for the pipeline is needed as the address may be reused
     // across pipelines. This isn't a problem when using full names as
-    // the function names already are uniquefied by a counter.
+    // the function names already are uniquefied by a counter. The
+    // shared cache keys on the names and a hash of the definition
+    // instead, which mean the same thing in every process, whereas
+    // the counter doesn't.
     static std::atomic<int> memoize_instance {0};
+    int instance = memoize_instance++;
+    if (target.has_feature(Target::MemoizeShared)) {
+        instance = 0;
+    }
 
-    InjectMemoization injector(env, memoize_instance++, name, outputs);
+    InjectMemoization injector(env, instance, name, outputs, target);
 
     return injector.mutate(s);
 }
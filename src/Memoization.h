@@ -10,6 +10,7 @@
 #include <map>
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -18,11 +19,14 @@ namespace Internal {
  *  lookup call to the runtime cache implementation, and if there is a
  *  miss, compute the results and call the runtime to store it back to
  *  the cache.
+ *  With the memoize_shared feature, the keys also identify the
+ *  definition of each Func, so that they can be shared by processes.
  *  Should leave non-memoized Funcs unchanged.
  */
 Stmt inject_memoization(Stmt s, const std::map<std::string, Function> &env,
                         const std::string &name,
-                        const std::vector<Function> &outputs);
+                        const std::vector<Function> &outputs,
+                        const Target &target);
 
 /** This should be called after Storage Flattening has added Allocation
  *  IR nodes. It connects the memoization cache lookups to the Allocations
@@ -0,0 +1,270 @@
+#include <iostream>
+
+#include "MemoryFootprint.h"
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "IREquality.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+Expr add_bytes(const Expr &a, const Expr &b) {
+    if (!a.defined() || !b.defined()) {
+        return Expr();
+    }
+    return simplify(a + b);
+}
+
+Expr max_bytes(const Expr &a, const Expr &b) {
+    if (!a.defined() || !b.defined()) {
+        return Expr();
+    }
+    return simplify(max(a, b));
+}
+
+Expr scale_bytes(const Expr &a, const Expr &factor) {
+    if (!a.defined() || !factor.defined()) {
+        return Expr();
+    }
+    return simplify(a * factor);
+}
+
+// Compute the peak heap and stack bytes of the statement last
+// visited. Each override leaves the peak of the node it visited in
+// 'heap' and 'stack'; statements without allocations leave them alone,
+// so the nodes with more than one child reset them before visiting
+// each one.
+class PeakMemory : public IRVisitor {
+    using IRVisitor::visit;
+
+    // Symbolic bounds of the loop variables and lets in scope, in terms
+    // of the free variables of the statement.
+    Scope<Interval> scope;
+
+    bool in_device_loop = false;
+
+    void reset() {
+        heap = stack = make_zero(Int(64));
+    }
+
+    // An upper bound on 'e' in terms of the free variables.
+    Expr upper_bound(const Expr &e) {
+        Interval b = bounds_of_expr_in_scope(e, scope);
+        if (!b.has_upper_bound()) {
+            return Expr();
+        }
+        return simplify(cast<int64_t>(b.max));
+    }
+
+    void visit(const LetStmt *op) override {
+        // Lets we can't bound, such as the fields of buffer arguments,
+        // are left as free variables.
+        Interval b = bounds_of_expr_in_scope(op->value, scope);
+        Expr var = Variable::make(op->value.type(), op->name);
+        if (!b.has_lower_bound()) {
+            b.min = var;
+        }
+        if (!b.has_upper_bound()) {
+            b.max = var;
+        }
+        ScopedBinding<Interval> bind(scope, op->name, b);
+        op->body.accept(this);
+    }
+
+    void visit(const For *op) override {
+        Interval min_bounds = bounds_of_expr_in_scope(op->min, scope);
+        Interval max_bounds = bounds_of_expr_in_scope(op->min + op->extent - 1, scope);
+        ScopedBinding<Interval> bind(scope, op->name, Interval::make_union(min_bounds, max_bounds));
+        bool is_device_loop = (op->for_type == ForType::GPUBlock ||
+                               op->for_type == ForType::GPUThread ||
+                               op->for_type == ForType::GPULane ||
+                               (op->device_api != DeviceAPI::None &&
+                                op->device_api != DeviceAPI::Host));
+        ScopedValue<bool> old_in_device_loop(in_device_loop, in_device_loop || is_device_loop);
+
+        reset();
+        op->body.accept(this);
+
+        if (op->for_type == ForType::Parallel) {
+            Expr extent = upper_bound(op->extent);
+            Expr in_flight = extent.defined() ? simplify(min(extent, cast<int64_t>(num_threads))) : Expr();
+            heap = scale_bytes(heap, in_flight);
+            stack = scale_bytes(stack, in_flight);
+        }
+    }
+
+    void visit(const Allocate *op) override {
+        reset();
+        op->body.accept(this);
+
+        if (in_device_loop || is_zero(op->condition) ||
+            op->memory_type == MemoryType::GPUShared ||
+            op->memory_type == MemoryType::LockedCache ||
+            op->memory_type == MemoryType::VTCM) {
+            return;
+        }
+
+        // Mirror the choice made by CodeGen_Posix::create_allocation.
+        int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        int64_t constant_bytes = (int64_t)constant_size * op->type.bytes();
+        bool on_stack = (constant_size > 0 && !op->new_expr.defined() &&
+                         (op->memory_type == MemoryType::Register ||
+                          (op->memory_type != MemoryType::Heap &&
+                           can_allocation_fit_on_stack(constant_bytes))));
+        if (on_stack) {
+            stack = add_bytes(stack, make_const(Int(64), constant_bytes));
+        } else {
+            Expr size = make_const(Int(64), op->type.bytes());
+            for (const Expr &e : op->extents) {
+                size *= cast<int64_t>(e);
+            }
+            heap = add_bytes(heap, upper_bound(size));
+        }
+    }
+
+    void visit(const Block *op) override {
+        reset();
+        op->first.accept(this);
+        Expr first_heap = heap, first_stack = stack;
+        reset();
+        if (op->rest.defined()) {
+            op->rest.accept(this);
+        }
+        heap = max_bytes(first_heap, heap);
+        stack = max_bytes(first_stack, stack);
+    }
+
+    void visit(const Fork *op) override {
+        // Both sides of a fork run at the same time.
+        reset();
+        op->first.accept(this);
+        Expr first_heap = heap, first_stack = stack;
+        reset();
+        op->rest.accept(this);
+        heap = add_bytes(first_heap, heap);
+        stack = add_bytes(first_stack, stack);
+    }
+
+    void visit(const IfThenElse *op) override {
+        reset();
+        op->then_case.accept(this);
+        Expr then_heap = heap, then_stack = stack;
+        reset();
+        if (op->else_case.defined()) {
+            op->else_case.accept(this);
+        }
+        heap = max_bytes(then_heap, heap);
+        stack = max_bytes(then_stack, stack);
+    }
+
+public:
+    Expr heap, stack;
+    Expr num_threads;
+
+    PeakMemory(const Expr &num_threads)
+        : heap(make_zero(Int(64))), stack(make_zero(Int(64))), num_threads(num_threads) {}
+};
+
+}  // namespace
+
+MemoryFootprint peak_memory_footprint(const Stmt &s, const Expr &num_threads) {
+    PeakMemory peak(num_threads);
+    s.accept(&peak);
+    return {peak.heap, peak.stack};
+}
+
+Expr substitute_argument_estimates(const Expr &e,
+                                   const vector<Argument> &args,
+                                   const vector<Function> &outputs) {
+    if (!e.defined()) {
+        return e;
+    }
+    std::map<string, Expr> estimates;
+    for (const Argument &arg : args) {
+        const ArgumentEstimates &est = arg.argument_estimates;
+        if (arg.is_scalar()) {
+            if (est.scalar_estimate.defined()) {
+                estimates[arg.name] = est.scalar_estimate;
+            }
+            continue;
+        }
+        for (size_t d = 0; d < est.buffer_estimates.size(); d++) {
+            const string prefix = arg.name + ".";
+            if (est.buffer_estimates[d].min.defined()) {
+                estimates[prefix + "min." + std::to_string(d)] = est.buffer_estimates[d].min;
+            }
+            if (est.buffer_estimates[d].extent.defined()) {
+                estimates[prefix + "extent." + std::to_string(d)] = est.buffer_estimates[d].extent;
+            }
+        }
+    }
+    for (const Function &f : outputs) {
+        for (const Bound &b : f.schedule().estimates()) {
+            const vector<string> &f_args = f.args();
+            for (size_t d = 0; d < f_args.size(); d++) {
+                if (f_args[d] != b.var) {
+                    continue;
+                }
+                for (const Parameter &buf : f.output_buffers()) {
+                    const string prefix = buf.name() + ".";
+                    estimates.emplace(prefix + "min." + std::to_string(d), b.min);
+                    estimates.emplace(prefix + "extent." + std::to_string(d), b.extent);
+                }
+            }
+        }
+    }
+    return simplify(substitute(estimates, e));
+}
+
+void memory_footprint_test() {
+    Expr n = Variable::make(Int(32), "n");
+    Expr x = Variable::make(Int(32), "x");
+    Expr threads = Variable::make(Int(32), "num_threads");
+
+    auto store = [](const string &name) {
+        return Store::make(name, 0, 0, Parameter(), const_true());
+    };
+    auto check = [&](const Stmt &s, Expr heap, Expr stack) {
+        MemoryFootprint m = peak_memory_footprint(s, threads);
+        if (!equal(m.heap_bytes, simplify(cast<int64_t>(heap))) ||
+            !equal(m.stack_bytes, simplify(cast<int64_t>(stack)))) {
+            internal_error << "Peak memory footprint of:\n" << s
+                           << "is heap: " << m.heap_bytes << " stack: " << m.stack_bytes
+                           << " instead of heap: " << heap << " stack: " << stack << "\n";
+        }
+    };
+
+    // A heap allocation of n floats, with a small stack allocation
+    // nested inside it.
+    Stmt inner = Allocate::make("b", Int(32), MemoryType::Auto, {16}, const_true(), store("b"));
+    Stmt outer = Allocate::make("a", Float(32), MemoryType::Auto, {n}, const_true(),
+                                Block::make(inner, store("a")));
+    check(outer, cast<int64_t>(n) * 4, 64);
+
+    // Sequential allocations reuse memory, so the peak is the largest.
+    Stmt other = Allocate::make("c", UInt(8), MemoryType::Heap, {n * 8}, const_true(), store("c"));
+    check(Block::make(outer, other), max(cast<int64_t>(n) * 4, cast<int64_t>(n * 8)), 64);
+
+    // An allocation whose size depends on a loop variable is bounded
+    // by its size on the last iteration, and parallel loops keep
+    // several iterations in flight.
+    Stmt grow = Allocate::make("d", UInt(8), MemoryType::Heap, {x + 1}, const_true(), store("d"));
+    check(For::make("x", 0, n, ForType::Serial, DeviceAPI::None, grow), max(n, 1), 0);
+    Stmt par = For::make("x", 0, 100, ForType::Parallel, DeviceAPI::None, inner);
+    check(par, 0, min(cast<int64_t>(threads), 100) * 64);
+
+    std::cout << "Memory footprint test passed" << std::endl;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,48 @@
+#ifndef HALIDE_MEMORY_FOOTPRINT_H
+#define HALIDE_MEMORY_FOOTPRINT_H
+
+/** \file
+ * Defines an analysis that estimates the peak memory a lowered
+ * pipeline allocates.
+ */
+
+#include <vector>
+
+#include "Argument.h"
+#include "Function.h"
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** The peak number of bytes a pipeline has allocated at once on the
+ * heap and on the stack. Either may be undefined if the size of some
+ * allocation can't be bounded. */
+struct MemoryFootprint {
+    Expr heap_bytes, stack_bytes;
+};
+
+/** Compute the peak number of bytes of host memory allocated at once
+ * while running a lowered statement, as a function of the free
+ * variables of the statement, e.g. the sizes of the input and output
+ * buffers. Allocations in sequential statements are assumed to be
+ * freed before the next one starts, and at most 'num_threads'
+ * iterations of a parallel loop are assumed to be in flight at
+ * once. Device allocations and allocations inside device loops are
+ * not counted. */
+MemoryFootprint peak_memory_footprint(const Stmt &s, const Expr &num_threads);
+
+/** Substitute the estimates of the arguments of a pipeline into an
+ * expression in terms of their values and buffer sizes. The sizes of
+ * output buffers without estimates of their own are taken from the
+ * estimates of the output Funcs. */
+Expr substitute_argument_estimates(const Expr &e,
+                                   const std::vector<Argument> &args,
+                                   const std::vector<Function> &outputs);
+
+void memory_footprint_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
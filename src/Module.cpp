@@ -1,7 +1,9 @@
 #include "Module.h"
 
 #include <array>
+#include <cstdio>
 #include <fstream>
+#include <functional>
 #include <future>
 
 #include "CodeGen_C.h"
@@ -9,11 +11,14 @@
 #include "Debug.h"
 #include "HexagonOffload.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
+#include "MultiversionLoops.h"
 #include "Outputs.h"
 #include "PythonExtensionGen.h"
+#include "Serialization.h"
 #include "StmtToHtml.h"
 #include "WrapExternStages.h"
 
@@ -72,6 +77,52 @@ private:
 };
 
 
+// Split a module into codegen units that can be compiled to separate
+// objects in parallel and then archived together. Returns an empty
+// vector if the module shouldn't be split. Splitting is opt-in (it
+// requires HL_NUM_COMPILE_THREADS to be set explicitly), because LLVM
+// can no longer inline across the units. The units may only refer to
+// each other through external symbols, so modules with internal
+// functions, external code or mutable (scalar) buffers are left whole.
+std::vector<Module> split_into_codegen_units(const Module &m) {
+    std::vector<Module> units;
+    int num_units = std::min(atoi(get_env_variable("HL_NUM_COMPILE_THREADS").c_str()),
+                             (int)m.functions().size());
+    if (num_units <= 1 || !m.external_code().empty()) {
+        return units;
+    }
+    for (const auto &f : m.functions()) {
+        if (f.linkage == LinkageType::Internal) {
+            return units;
+        }
+    }
+    for (const auto &b : m.buffers()) {
+        if (b.dimensions() == 0) {
+            return units;
+        }
+    }
+
+    for (int i = 0; i < num_units; i++) {
+        // Only the first unit carries the runtime.
+        Target t = (i == 0) ? m.target() : m.target().with_feature(Target::NoRuntime);
+        Module unit(m.name() + "_" + std::to_string(i), t);
+        // Constant buffers are private to each object, so every unit
+        // gets its own copy.
+        for (const auto &b : m.buffers()) {
+            unit.append(b);
+        }
+        for (const auto &it : m.get_metadata_name_map()) {
+            unit.remap_metadata_name(it.first, it.second);
+        }
+        unit.set_any_strict_float(m.any_strict_float());
+        units.push_back(unit);
+    }
+    for (size_t i = 0; i < m.functions().size(); i++) {
+        units[i % num_units].append(m.functions()[i]);
+    }
+    return units;
+}
+
 // Given a pathname of the form /path/to/name.ext, append suffix before ext to produce /path/to/namesuffix.ext
 std::string add_suffix(const std::string &path, const std::string &suffix) {
     const auto found = path.rfind(".");
@@ -105,6 +156,7 @@ Outputs add_suffixes(const Outputs &in, const std::string &suffix) {
     if (!in.stmt_name.empty()) out.stmt_name = add_suffix(in.stmt_name, suffix);
     if (!in.stmt_html_name.empty()) out.stmt_html_name = add_suffix(in.stmt_html_name, suffix);
     if (!in.schedule_name.empty()) out.schedule_name = add_suffix(in.schedule_name, suffix);
+    if (!in.serialized_module_name.empty()) out.serialized_module_name = add_suffix(in.serialized_module_name, suffix);
     return out;
 }
 
@@ -353,6 +405,11 @@ void Module::compile(const Outputs &output_files_arg) const {
         Internal::print_to_html(output_files.stmt_html_name, *this);
         output_files.stmt_html_name.clear();
     }
+    if (!output_files.serialized_module_name.empty()) {
+        debug(1) << "Module.compile(): serialized_module_name " << output_files.serialized_module_name << "\n";
+        serialize_module_to_file(*this, output_files.serialized_module_name);
+        output_files.serialized_module_name.clear();
+    }
 
 
     // If there are submodules, recursively lower submodules to
@@ -366,8 +423,23 @@ void Module::compile(const Outputs &output_files_arg) const {
     if (!output_files.object_name.empty() || !output_files.assembly_name.empty() ||
         !output_files.bitcode_name.empty() || !output_files.llvm_assembly_name.empty() ||
         !output_files.static_library_name.empty()) {
+        // A static library can hold one object per codegen unit, in
+        // which case we only need the whole-module llvm::Module for the
+        // other outputs.
+        std::vector<Module> units;
+        if (!output_files.static_library_name.empty()) {
+            units = split_into_codegen_units(*this);
+        }
+        const bool need_whole_module =
+            units.empty() ||
+            !output_files.object_name.empty() || !output_files.assembly_name.empty() ||
+            !output_files.bitcode_name.empty() || !output_files.llvm_assembly_name.empty();
+
         llvm::LLVMContext context;
-        std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
+        std::unique_ptr<llvm::Module> llvm_module;
+        if (need_whole_module) {
+            llvm_module = compile_module_to_llvm_module(*this, context);
+        }
 
         if (!output_files.object_name.empty()) {
             debug(1) << "Module.compile(): object_name " << output_files.object_name << "\n";
@@ -381,7 +453,23 @@ void Module::compile(const Outputs &output_files_arg) const {
             // at the same time, so there is no meaningful performance advantage
             // to be had.
             TemporaryObjectFileDir temp_dir;
-            {
+            if (!units.empty()) {
+                std::vector<std::function<void()>> jobs;
+                for (size_t i = 0; i < units.size(); i++) {
+                    const Module &unit = units[i];
+                    std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name,
+                                                                            "_" + std::to_string(i), target());
+                    debug(1) << "Module.compile(): codegen unit object_name " << object_name << "\n";
+                    jobs.push_back([unit, object_name]() {
+                        llvm::LLVMContext unit_context;
+                        std::unique_ptr<llvm::Module> unit_module(compile_module_to_llvm_module(unit, unit_context));
+                        auto out = make_raw_fd_ostream(object_name);
+                        compile_llvm_module_to_object(*unit_module, *out);
+                        out->flush();
+                    });
+                }
+                run_compile_jobs(jobs);
+            } else {
                 std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, "", target());
                 debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
                 auto out = make_raw_fd_ostream(object_name);
@@ -494,25 +582,6 @@ void compile_multitarget(const std::string &fn_name,
         return;
     }
 
-    // For safety, the runtime must be built only with features common to all
-    // of the targets; given an unusual ordering like
-    //
-    //     x86-64-linux,x86-64-sse41
-    //
-    // we should still always be *correct*: this ordering would never select sse41
-    // (since x86-64-linux would be selected first due to ordering), but could
-    // crash on non-sse41 machines (if we generated a runtime with sse41 instructions
-    // included). So we'll keep track of the common features as we walk thru the targets.
-
-    // Using something like std::bitset would be arguably cleaner here, but we need an
-    // array-of-uint64 for calls to halide_can_use_target_features() anyway,
-    // so we'll just build and maintain in that form to avoid extra conversion.
-    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
-    uint64_t runtime_features[kFeaturesWordCount] = {(uint64_t)-1LL};
-
-    TemporaryObjectFileDir temp_dir;
-    std::vector<Expr> wrapper_args;
-    std::vector<LoweredArgument> base_target_args;
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -521,12 +590,14 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 8> must_match_features = {{
+        static const std::array<Target::Feature, 10> must_match_features = {{
             Target::ASAN,
+            Target::BatchDimension,
             Target::CPlusPlusMangling,
             Target::JIT,
             Target::Matlab,
             Target::MSAN,
+            Target::MultiversionLoops,
             Target::NoRuntime,
             Target::TSAN,
             Target::UserContext,
@@ -537,7 +608,52 @@ void compile_multitarget(const std::string &fn_name,
                 break;
             }
         }
+    }
+
+    // With multiversion_loops, there's just one copy of the pipeline,
+    // compiled for the base target (which must have a subset of the
+    // features of the others), and only the loop nests that contain
+    // vector code are duplicated for the other targets. The runtime
+    // is compiled for the base target too.
+    if (base_target.has_feature(Target::MultiversionLoops)) {
+        debug(1) << "compile_multitarget: multiversioning loops of " << base_target.to_string() << "\n";
+        std::vector<Target> other_targets(targets.begin(), targets.end() - 1);
+        Module module = module_producer(fn_name, base_target);
+        for (LoweredFunc &f : module.functions()) {
+            f.body = multiversion_loops(f.body, base_target, other_targets);
+        }
+        module.compile(output_files);
+        return;
+    }
+
+    // For safety, the runtime must be built only with features common to all
+    // of the targets; given an unusual ordering like
+    //
+    //     x86-64-linux,x86-64-sse41
+    //
+    // we should still always be *correct*: this ordering would never select sse41
+    // (since x86-64-linux would be selected first due to ordering), but could
+    // crash on non-sse41 machines (if we generated a runtime with sse41 instructions
+    // included). So we'll keep track of the common features as we walk thru the targets.
+
+    // Using something like std::bitset would be arguably cleaner here, but we need an
+    // array-of-uint64 for calls to halide_can_use_target_features() anyway,
+    // so we'll just build and maintain in that form to avoid extra conversion.
+    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+    uint64_t runtime_features[kFeaturesWordCount];
+    for (int i = 0; i < kFeaturesWordCount; ++i) {
+        runtime_features[i] = (uint64_t)-1LL;
+    }
+
+    // Lowering happens serially, as the module_producer is free to touch
+    // front-end state, but the resulting modules are independent, so
+    // their LLVM codegen is queued up and run in parallel at the end.
+    std::vector<std::function<void()>> compile_jobs;
 
+    TemporaryObjectFileDir temp_dir;
+    std::vector<Expr> wrapper_args;
+    std::vector<LoweredArgument> base_target_args;
+    for (const Target &target : targets) {
         // Each sub-target has a function name that is the 'real' name plus a suffix
         // (which defaults to the target string but can be customized via the suffixes map)
         std::string suffix = replace_all(target.to_string(), "-", "_");
@@ -564,7 +680,9 @@ void compile_multitarget(const std::string &fn_name,
         internal_assert(sub_out.object_name.empty());
         sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
         debug(1) << "compile_multitarget: compile_sub_target " << sub_out.object_name << "\n";
-        sub_module.compile(sub_out);
+        compile_jobs.push_back([sub_module, sub_out]() {
+            sub_module.compile(sub_out);
+        });
 
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
@@ -573,24 +691,13 @@ void compile_multitarget(const std::string &fn_name,
             }
         }
 
-        Expr can_use;
-        if (target != base_target) {
-            std::vector<Expr> features_struct_args;
-            for (int i = 0; i < kFeaturesWordCount; ++i) {
-                features_struct_args.push_back(UIntImm::make(UInt(64), cur_target_features[i]));
-            }
-            can_use = Call::make(Int(32), "halide_can_use_target_features",
-                                   {kFeaturesWordCount, Call::make(type_of<uint64_t *>(), Call::make_struct, features_struct_args, Call::Intrinsic)},
-                                   Call::Extern);
-        } else {
-            can_use = IntImm::make(Int(32), 1);
-        }
+        Expr can_use = (target != base_target) ? can_use_target_features(target) : const_true();
 
         for (int i = 0; i < kFeaturesWordCount; ++i) {
             runtime_features[i] &= cur_target_features[i];
         }
 
-        wrapper_args.push_back(can_use != 0);
+        wrapper_args.push_back(can_use);
         wrapper_args.push_back(sub_fn_name);
     }
 
@@ -613,7 +720,9 @@ void compile_multitarget(const std::string &fn_name,
         Outputs runtime_out = Outputs().object(
             temp_dir.add_temp_object_file(output_files.static_library_name, "_runtime", runtime_target));
         debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.static_library_name << "\n";
-        compile_standalone_runtime(runtime_out, runtime_target);
+        compile_jobs.push_back([runtime_out, runtime_target]() {
+            compile_standalone_runtime(runtime_out, runtime_target);
+        });
     }
 
     if (needs_wrapper) {
@@ -652,9 +761,13 @@ void compile_multitarget(const std::string &fn_name,
         Outputs wrapper_out = Outputs().object(
             temp_dir.add_temp_object_file(output_files.static_library_name, "_wrapper", base_target, /* in_front*/ true));
         debug(1) << "compile_multitarget: wrapper " << wrapper_out.object_name << "\n";
-        wrapper_module.compile(wrapper_out);
+        compile_jobs.push_back([wrapper_module, wrapper_out]() {
+            wrapper_module.compile(wrapper_out);
+        });
     }
 
+    run_compile_jobs(compile_jobs);
+
     if (!output_files.c_header_name.empty()) {
         Module header_module(fn_name, base_target);
         header_module.append(LoweredFunc(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata));
@@ -671,4 +784,47 @@ void compile_multitarget(const std::string &fn_name,
     }
 }
 
+namespace Internal {
+
+void write_module_cache_key(std::ostream &key, const Module &m) {
+    key << "llvm=" << LLVM_VERSION << "\n"
+        << "target=" << m.target().to_string() << "\n"
+        << m;
+    for (const auto &b : m.buffers()) {
+        key << "buffer " << b.name() << " " << b.type() << " " << b.dimensions();
+        for (int i = 0; i < b.dimensions(); i++) {
+            key << " " << b.dim(i).min() << " " << b.dim(i).extent() << " " << b.dim(i).stride();
+        }
+        key << "\n";
+        if (b.data()) {
+            key.write((const char *)b.data(), b.size_in_bytes());
+        }
+    }
+    for (const auto &e : m.external_code()) {
+        key << "external " << e.name() << "\n";
+        key.write((const char *)e.contents().data(), e.contents().size());
+    }
+    for (const auto &sub : m.submodules()) {
+        key << "submodule " << sub.name() << "\n";
+        write_module_cache_key(key, sub);
+    }
+}
+
+std::string hash_cache_key(const std::string &key) {
+    // Two independent 64-bit hashes. Keys are long and a collision
+    // would reuse the wrong compiled code, so we spend 128 bits.
+    uint64_t h1 = 0xcbf29ce484222325ULL;
+    uint64_t h2 = 5381;
+    for (unsigned char c : key) {
+        h1 = (h1 ^ c) * 0x100000001b3ULL;
+        h2 = h2 * 33 + c;
+        h2 ^= h2 >> 29;
+    }
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+    return name;
+}
+
+}  // namespace Internal
+
 }  // namespace Halide
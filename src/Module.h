@@ -7,6 +7,7 @@
  */
 
 #include <functional>
+#include <iosfwd>
 
 #include "Argument.h"
 #include "ExternalCode.h"
@@ -170,6 +171,20 @@ void compile_multitarget(const std::string &fn_name,
                          ModuleProducer module_producer,
                          const std::map<std::string, std::string> &suffixes = {});
 
+namespace Internal {
+
+/** Write everything that determines the code compiled from a Module
+ * to a stream, for use as the key of a cache of compiled code: its
+ * printed form (which includes the lowered Stmts), the contents of
+ * its buffers, external code and submodules, its target, and the
+ * version of LLVM. */
+void write_module_cache_key(std::ostream &key, const Module &m);
+
+/** Hash a cache key to 32 hex digits. */
+std::string hash_cache_key(const std::string &key);
+
+}  // namespace Internal
+
 }  // namespace Halide
 
 #endif
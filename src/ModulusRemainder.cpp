@@ -58,6 +58,7 @@ public:
     void visit(const Realize *) override;
     void visit(const Block *) override;
     void visit(const Fork *) override;
+    void visit(const Atomic *) override;
     void visit(const IfThenElse *) override;
     void visit(const Free *) override;
     void visit(const Evaluate *) override;
@@ -468,6 +469,10 @@ void ComputeModulusRemainder::visit(const Fork *) {
     internal_assert(false) << "modulus_remainder of statement\n";
 }
 
+void ComputeModulusRemainder::visit(const Atomic *) {
+    internal_assert(false) << "modulus_remainder of statement\n";
+}
+
 void ComputeModulusRemainder::visit(const Free *) {
     internal_assert(false) << "modulus_remainder of statement\n";
 }
@@ -0,0 +1,151 @@
+#include "MultiDevice.h"
+#include "DeviceInterface.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "InjectHostDevBufferCopies.h"
+#include "Util.h"
+
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+bool is_gpu_loop(const For *op) {
+    return (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane);
+}
+
+// Check that all of the GPU loops at or inside a loop run on CUDA.
+class CheckGPULoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (is_gpu_loop(op)) {
+            found = true;
+            DeviceAPI api = op->device_api;
+            if (api == DeviceAPI::Default_GPU) {
+                api = default_api;
+            }
+            user_assert(api == DeviceAPI::CUDA)
+                << "Loop " << loop << " is distributed across devices with gpu_multi_device, "
+                << "but the GPU loop " << op->name << " inside it does not use CUDA.\n";
+        }
+        IRVisitor::visit(op);
+    }
+
+    const string &loop;
+    DeviceAPI default_api;
+
+public:
+    bool found = false;
+    CheckGPULoops(const string &loop, DeviceAPI default_api) : loop(loop), default_api(default_api) {}
+};
+
+class DistributeAcrossDevices : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The names of the marked loops.
+    std::set<string> loops;
+
+    DeviceAPI default_api;
+
+    bool in_gpu_loop = false;
+
+    Stmt visit(const For *op) override {
+        if (!loops.count(op->name)) {
+            ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, in_gpu_loop || is_gpu_loop(op));
+            return IRMutator2::visit(op);
+        }
+
+        user_assert(!in_gpu_loop && op->for_type != ForType::GPUThread && op->for_type != ForType::GPULane)
+            << "Loop " << op->name << " is marked with gpu_multi_device, but it is inside a GPU block loop. "
+            << "gpu_multi_device must be applied to a GPU block loop or to a loop outside of them.\n";
+
+        ScopedValue<bool> old_in_gpu_loop(in_gpu_loop, is_gpu_loop(op));
+        Stmt body = mutate(op->body);
+
+        CheckGPULoops check(op->name, default_api);
+        op->accept(&check);
+        user_assert(check.found)
+            << "Loop " << op->name << " is marked with gpu_multi_device, but there are no GPU loops "
+            << "at or inside it to distribute.\n";
+
+        // Device d runs the chunk of iterations [d * chunk, (d + 1) * chunk).
+        string device_name = op->name + ".device";
+        string count_name = op->name + ".device_count";
+        string chunk_name = op->name + ".device_chunk";
+        string extent_name = op->name + ".device_extent";
+        Expr device = Variable::make(Int(32), device_name);
+        Expr count = Variable::make(Int(32), count_name);
+        Expr chunk = Variable::make(Int(32), chunk_name);
+        Expr extent = Variable::make(Int(32), extent_name);
+
+        Stmt s = For::make(op->name, op->min + device * chunk, extent,
+                           op->for_type, op->device_api, body);
+
+        // The runtime selects the device by making its context current
+        // on this thread. The kernels are launched asynchronously, so
+        // the chunks run concurrently.
+        s = Block::make({call_extern_and_assert("halide_cuda_multi_device_begin", {device}),
+                         s,
+                         call_extern_and_assert("halide_cuda_multi_device_end", {device})});
+        // Never launch a kernel with no blocks.
+        s = IfThenElse::make(extent > 0, s);
+        s = LetStmt::make(extent_name, min(chunk, op->extent - device * chunk), s);
+        s = For::make(device_name, 0, count, ForType::Serial, DeviceAPI::None, s);
+
+        // Wait for the other devices before anything in the main
+        // context uses their results.
+        s = Block::make(s, call_extern_and_assert("halide_cuda_multi_device_sync", {}));
+        s = LetStmt::make(chunk_name, (op->extent + count - 1) / count, s);
+        s = LetStmt::make(count_name,
+                          Call::make(Int(32), "halide_cuda_multi_device_count", {}, Call::Extern), s);
+        return s;
+    }
+
+public:
+    DistributeAcrossDevices(const map<string, Function> &env, const Target &t)
+        : default_api(get_default_device_api_for_target(t)) {
+        for (const auto &p : env) {
+            const Function &f = p.second;
+            for (size_t i = 0; i <= f.updates().size(); i++) {
+                const StageSchedule &sched =
+                    i == 0 ? f.definition().schedule() : f.update(i - 1).schedule();
+                if (sched.gpu_multi_device_var().empty()) {
+                    continue;
+                }
+                user_assert(sched.hetero_split_var().empty())
+                    << "Stage " << i << " of " << f.name() << " uses both hetero_split and "
+                    << "gpu_multi_device, which can't be combined.\n";
+                loops.insert(f.name() + ".s" + std::to_string(i) + "." + sched.gpu_multi_device_var());
+            }
+        }
+    }
+
+    bool empty() const {
+        return loops.empty();
+    }
+};
+
+}  // namespace
+
+Stmt distribute_across_devices(Stmt s, const map<string, Function> &env, const Target &t) {
+    if (!t.has_feature(Target::CUDA)) {
+        return s;
+    }
+    DistributeAcrossDevices distributor(env, t);
+    if (distributor.empty()) {
+        return s;
+    }
+    return distributor.mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
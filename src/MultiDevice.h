@@ -0,0 +1,28 @@
+#ifndef HALIDE_MULTI_DEVICE_H
+#define HALIDE_MULTI_DEVICE_H
+
+/** \file
+ * Defines the lowering pass that distributes loops marked with
+ * Func::gpu_multi_device across CUDA devices.
+ */
+
+#include <map>
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Wrap each loop marked with gpu_multi_device in a serial loop over
+ * the CUDA devices, which runs a contiguous chunk of the iterations on
+ * each device by making that device's context current around it. Does
+ * nothing for targets without CUDA. */
+Stmt distribute_across_devices(Stmt s, const std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,153 @@
+#include "MultiversionLoops.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const string region_prefix = "halide_multiversion.";
+
+// Check if a loop nest contains vector code, and no parallelism that
+// would have to be outlined separately from it.
+class CanMultiversion : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Ramp *op) override {
+        has_vectors = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Broadcast *op) override {
+        has_vectors = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::Parallel ||
+            (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host)) {
+            has_parallelism = true;
+            return;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Fork *op) override {
+        has_parallelism = true;
+    }
+
+    void visit(const Acquire *op) override {
+        has_parallelism = true;
+    }
+
+public:
+    bool has_vectors = false, has_parallelism = false;
+};
+
+class MultiversionLoops : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const vector<Target> &targets;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+        CanMultiversion check;
+        op->accept(&check);
+        if (!check.has_vectors || check.has_parallelism) {
+            // Look for loop nests worth duplicating further in.
+            return IRMutator2::visit(op);
+        }
+
+        // Dispatch on the targets in order, falling back to the loop
+        // nest compiled for the base target.
+        Stmt s = op;
+        for (size_t i = targets.size(); i > 0; i--) {
+            const Target &t = targets[i - 1];
+            Stmt copy = ProducerConsumer::make(region_prefix + t.to_string(), true, op);
+            s = IfThenElse::make(Variable::make(Bool(), can_use_names[i - 1]), copy, s);
+        }
+        found = true;
+        return s;
+    }
+
+public:
+    vector<string> can_use_names;
+    bool found = false;
+
+    MultiversionLoops(const vector<Target> &targets)
+        : targets(targets) {
+        for (const Target &t : targets) {
+            can_use_names.push_back(unique_name("can_use_" + replace_all(t.to_string(), "-", "_")));
+        }
+    }
+};
+
+}  // namespace
+
+Expr can_use_target_features(const Target &t) {
+    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+    uint64_t features[kFeaturesWordCount] = {0};
+    for (int i = 0; i < Target::FeatureEnd; ++i) {
+        if (t.has_feature((Target::Feature) i)) {
+            features[i >> 6] |= ((uint64_t) 1) << (i & 63);
+        }
+    }
+    vector<Expr> features_struct_args;
+    for (int i = 0; i < kFeaturesWordCount; ++i) {
+        features_struct_args.push_back(UIntImm::make(UInt(64), features[i]));
+    }
+    Expr can_use = Call::make(Int(32), "halide_can_use_target_features",
+                              {kFeaturesWordCount, Call::make(type_of<uint64_t *>(), Call::make_struct,
+                                                              features_struct_args, Call::Intrinsic)},
+                              Call::Extern);
+    return can_use != 0;
+}
+
+Stmt multiversion_loops(Stmt s, const Target &base, const vector<Target> &targets) {
+    // The copies are compiled with the features of their own target,
+    // and everything else about the base target.
+    vector<Target> region_targets;
+    for (const Target &t : targets) {
+        Target r = base;
+        for (int i = 0; i < Target::FeatureEnd; i++) {
+            Target::Feature f = (Target::Feature) i;
+            user_assert(t.has_feature(f) || !base.has_feature(f))
+                << "Target " << t.to_string() << " must have all the features of the baseline target "
+                << base.to_string() << " to use multiversion_loops.\n";
+            if (t.has_feature(f)) {
+                r.set_feature(f);
+            }
+        }
+        region_targets.push_back(r);
+    }
+
+    MultiversionLoops mutator(region_targets);
+    s = mutator.mutate(s);
+    if (!mutator.found) {
+        return s;
+    }
+    for (size_t i = 0; i < targets.size(); i++) {
+        s = LetStmt::make(mutator.can_use_names[i], can_use_target_features(targets[i]), s);
+    }
+    return s;
+}
+
+bool is_multiversion_region(const ProducerConsumer *op, Target *t) {
+    if (!op->is_producer || !starts_with(op->name, region_prefix)) {
+        return false;
+    }
+    if (t) {
+        *t = Target(op->name.substr(region_prefix.size()));
+    }
+    return true;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,42 @@
+#ifndef HALIDE_MULTIVERSION_LOOPS_H
+#define HALIDE_MULTIVERSION_LOOPS_H
+
+/** \file
+ * Defines the pass that duplicates vectorized loop nests for several
+ * CPU targets, with a dispatch on the features available at runtime.
+ */
+
+#include <vector>
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make an expression that is true when the CPU running the pipeline
+ * supports all the features of the given target, according to
+ * halide_can_use_target_features. */
+Expr can_use_target_features(const Target &t);
+
+/** Wrap each outermost loop nest in s that contains vector code, and
+ * no parallelism of its own, in a dispatch on the given targets: the
+ * first of them whose features are available at runtime runs a copy
+ * of the loop nest compiled for that target, and the base target's
+ * copy is the fallback. The availability of each target is checked
+ * once, at the top of s. The copies are marked with a ProducerConsumer
+ * node that \ref is_multiversion_region recognizes. Every target must
+ * have all the features of the base target. Used by
+ * compile_multitarget when the targets have the multiversion_loops
+ * feature. */
+Stmt multiversion_loops(Stmt s, const Target &base, const std::vector<Target> &targets);
+
+/** Check if a ProducerConsumer node marks a copy of a loop nest made
+ * by \ref multiversion_loops. If so, and t is non-null, set t to the
+ * target that copy should be compiled for. */
+bool is_multiversion_region(const ProducerConsumer *op, Target *t = nullptr);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -58,6 +58,11 @@ struct Outputs {
      * output is desired. */
     std::string schedule_name;
 
+    /** The name of the emitted serialized Module file, which can be
+     * loaded with deserialize_module_from_file. Empty if no serialized
+     * Module output is desired. */
+    std::string serialized_module_name;
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an object file with the given name. */
     Outputs object(const std::string &object_name) const {
@@ -145,6 +150,14 @@ struct Outputs {
         updated.schedule_name = schedule_name;
         return updated;
     }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also a serialized Module file with the given name. */
+    Outputs serialized_module(const std::string &serialized_module_name) const {
+        Outputs updated = *this;
+        updated.serialized_module_name = serialized_module_name;
+        return updated;
+    }
 };
 
 }  // namespace Halide
@@ -0,0 +1,192 @@
+#include "PackedStorage.h"
+#include "Deinterleave.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+class LowerPackedStorage : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The values of the enclosing Int(32) lets, in terms of variables
+    // not defined by those lets.
+    map<string, Expr> lets;
+
+    Stmt visit(const LetStmt *op) override {
+        if (op->value.type() != Int(32)) {
+            return IRMutator2::visit(op);
+        }
+        lets[op->name] = substitute(lets, op->value);
+        Stmt body = mutate(op->body);
+        lets.erase(op->name);
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return LetStmt::make(op->name, op->value, body);
+    }
+
+    // The vectorizer widens all the args of the intrinsics, including
+    // the buffer and the number of bits.
+    static Expr scalar_arg(const Expr &e) {
+        if (const Broadcast *b = e.as<Broadcast>()) {
+            return b->value;
+        }
+        return e;
+    }
+
+    // If an index is a dense vector that starts at the start of a
+    // byte and covers whole bytes, return its first element.
+    Expr aligned_base(const Expr &index, int bits) {
+        const Ramp *r = index.as<Ramp>();
+        int elems_per_byte = 8 / bits;
+        if (r && is_one(r->stride) &&
+            r->lanes % elems_per_byte == 0 &&
+            can_prove(substitute(lets, r->base % elems_per_byte == 0))) {
+            return r->base;
+        }
+        return Expr();
+    }
+
+    // The dense index of the n bytes starting at a byte index.
+    static Expr dense(const Expr &byte_index, int n) {
+        if (n == 1) {
+            return byte_index;
+        }
+        return Ramp::make(byte_index, make_one(byte_index.type()), n);
+    }
+
+    // The offsets in bits of a dense vector of elements within their
+    // bytes.
+    static Expr dense_shifts(int bits, int lanes) {
+        int elems_per_byte = 8 / bits;
+        Expr pattern = Ramp::make(make_zero(UInt(8)), make_const(UInt(8), bits), elems_per_byte);
+        if (lanes == elems_per_byte) {
+            return pattern;
+        }
+        return Shuffle::make_concat(vector<Expr>(lanes / elems_per_byte, pattern));
+    }
+
+    Expr visit(const Call *op) override {
+        if (!op->is_intrinsic(Call::load_packed)) {
+            return IRMutator2::visit(op);
+        }
+        // {buffer, index, bits}
+        internal_assert(op->args.size() == 3);
+        const Variable *buf = scalar_arg(op->args[0]).as<Variable>();
+        const int64_t *b = as_const_int(scalar_arg(op->args[2]));
+        internal_assert(buf && b);
+        int bits = (int)(*b);
+        int elems_per_byte = 8 / bits;
+        int lanes = op->type.lanes();
+
+        Expr index = simplify(mutate(op->args[1]));
+        Expr base = aligned_base(index, bits);
+        Expr bytes, shift;
+        if (base.defined()) {
+            // Load the bytes, and give each element a copy of its byte.
+            int n = lanes / elems_per_byte;
+            Expr packed = Load::make(UInt(8, n), buf->name, dense(base / elems_per_byte, n),
+                                     Buffer<>(), Parameter(), const_true(n));
+            if (n == 1) {
+                bytes = Broadcast::make(packed, lanes);
+            } else {
+                vector<int> indices(lanes);
+                for (int i = 0; i < lanes; i++) {
+                    indices[i] = i / elems_per_byte;
+                }
+                bytes = Shuffle::make({packed}, indices);
+            }
+            shift = dense_shifts(bits, lanes);
+        } else {
+            bytes = Load::make(UInt(8, lanes), buf->name, index / elems_per_byte,
+                               Buffer<>(), Parameter(), const_true(lanes));
+            shift = cast(UInt(8, lanes), (index % elems_per_byte) * bits);
+        }
+
+        Expr value = (bytes >> shift) & make_const(UInt(8, lanes), (1 << bits) - 1);
+        if (op->type.is_bool()) {
+            return value != make_zero(value.type());
+        } else if (op->type.is_int()) {
+            // Sign-extend from the top bit of the element.
+            Expr s = make_const(Int(8, lanes), 8 - bits);
+            value = (cast(Int(8, lanes), value) << s) >> s;
+        }
+        return cast(op->type, value);
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        const Call *call = op->value.as<Call>();
+        if (!call || !call->is_intrinsic(Call::store_packed)) {
+            return IRMutator2::visit(op);
+        }
+        // {buffer, index, value, bits}
+        internal_assert(call->args.size() == 4);
+        const Variable *buf = scalar_arg(call->args[0]).as<Variable>();
+        const int64_t *b = as_const_int(scalar_arg(call->args[3]));
+        internal_assert(buf && b);
+        int bits = (int)(*b);
+        int elems_per_byte = 8 / bits;
+        int lanes = call->type.lanes();
+
+        Expr index = simplify(mutate(call->args[1]));
+        Expr mask = make_const(UInt(8, lanes), (1 << bits) - 1);
+        Expr value = cast(UInt(8, lanes), mutate(call->args[2])) & mask;
+
+        Expr base = aligned_base(index, bits);
+        if (base.defined()) {
+            // The elements cover whole bytes, so OR together the
+            // elements at each position within a byte, and store the
+            // bytes.
+            int n = lanes / elems_per_byte;
+            value = value << dense_shifts(bits, lanes);
+            Expr packed;
+            for (int k = 0; k < elems_per_byte; k++) {
+                vector<int> indices(n);
+                for (int j = 0; j < n; j++) {
+                    indices[j] = j * elems_per_byte + k;
+                }
+                Expr e = Shuffle::make({value}, indices);
+                packed = packed.defined() ? (packed | e) : e;
+            }
+            return Store::make(buf->name, packed, dense(base / elems_per_byte, n),
+                               Parameter(), const_true(n));
+        }
+
+        // Elements may share a byte, so read, modify, and write each
+        // one in turn.
+        string index_name = unique_name('t'), value_name = unique_name('t');
+        Expr index_var = Variable::make(index.type(), index_name);
+        Expr value_var = Variable::make(value.type(), value_name);
+        vector<Stmt> stores;
+        for (int i = 0; i < lanes; i++) {
+            Expr idx = lanes == 1 ? index_var : extract_lane(index_var, i);
+            Expr v = lanes == 1 ? value_var : extract_lane(value_var, i);
+            Expr byte_index = idx / elems_per_byte;
+            Expr shift = cast<uint8_t>((idx % elems_per_byte) * bits);
+            Expr old = Load::make(UInt(8), buf->name, byte_index, Buffer<>(), Parameter(), const_true());
+            Expr updated = (old & ~(make_const(UInt(8), (1 << bits) - 1) << shift)) | (v << shift);
+            stores.push_back(Store::make(buf->name, updated, byte_index, Parameter(), const_true()));
+        }
+        Stmt result = Block::make(stores);
+        result = LetStmt::make(value_name, value, result);
+        return LetStmt::make(index_name, index, result);
+    }
+};
+
+}  // namespace
+
+Stmt lower_packed_storage(Stmt s) {
+    return LowerPackedStorage().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,25 @@
+#ifndef HALIDE_PACKED_STORAGE_H
+#define HALIDE_PACKED_STORAGE_H
+
+/** \file
+ * Defines the lowering pass that turns accesses to bit-packed
+ * realizations into loads and stores of bytes.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace the load_packed and store_packed intrinsics emitted by
+ * storage flattening for Funcs scheduled with Func::store_packed
+ * with loads and stores of the bytes that contain them. Dense vectors
+ * that cover whole bytes are packed and unpacked with shuffles and
+ * shifts. Other stores update the bytes one element at a time. Must
+ * run after vectorization. */
+Stmt lower_packed_storage(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
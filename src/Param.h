@@ -251,6 +251,21 @@ public:
     }
     // @}
 
+    /** Suggest values of this parameter worth compiling a fast path
+     * for, e.g. the common radii of a blur. Stages that use the
+     * parameter are specialized for each value when the target has
+     * the auto_specialize feature. */
+    void set_specialization_hints(const std::vector<Expr> &values) {
+        std::vector<Expr> hints;
+        for (Expr v : values) {
+            if (v.type() != param.type()) {
+                v = Internal::Cast::make(param.type(), v);
+            }
+            hints.push_back(v);
+        }
+        param.set_specialization_hints(hints);
+    }
+
     template<typename SOME_TYPE>
     void set_estimate(const SOME_TYPE &value) {
         user_assert(Internal::IsRoundtrippable<T>::value(value))
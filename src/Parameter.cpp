@@ -21,13 +21,16 @@ struct ParameterContents {
     Buffer<> buffer;
     uint64_t data;
     int host_alignment;
+    bool gpu_texture, gpu_texture_filtering;
     std::vector<BufferConstraint> buffer_constraints;
     Expr scalar_min, scalar_max, scalar_estimate;
+    std::vector<Expr> scalar_specialization_hints;
     const bool is_buffer;
 
     ParameterContents(Type t, bool b, int d, const std::string &n)
         : type(t), dimensions(d), name(n), buffer(Buffer<>()), data(0),
-          host_alignment(t.bytes()), buffer_constraints(dimensions), is_buffer(b) {
+          host_alignment(t.bytes()), gpu_texture(false), gpu_texture_filtering(false),
+          buffer_constraints(dimensions), is_buffer(b) {
         // stride_constraint[0] defaults to 1. This is important for
         // dense vectorization. You can unset it by setting it to a
         // null expression. (param.set_stride(0, Expr());)
@@ -95,7 +98,10 @@ bool Parameter::is_buffer() const {
 Expr Parameter::scalar_expr() const {
     check_is_scalar();
     const Type t = type();
-    if (t.is_float()) {
+    if (t.is_bfloat()) {
+        internal_assert(t.bits() == 16);
+        return Expr(scalar<bfloat16_t>());
+    } else if (t.is_float()) {
         switch (t.bits()) {
         case 16: return Expr(scalar<float16_t>());
         case 32: return Expr(scalar<float>());
@@ -232,6 +238,23 @@ int Parameter::host_alignment() const {
     check_is_buffer();
     return contents->host_alignment;
 }
+
+void Parameter::set_gpu_texture(bool enabled, bool hardware_filtering) {
+    check_is_buffer();
+    contents->gpu_texture = enabled;
+    contents->gpu_texture_filtering = enabled && hardware_filtering;
+}
+
+bool Parameter::gpu_texture() const {
+    check_is_buffer();
+    return contents->gpu_texture;
+}
+
+bool Parameter::gpu_texture_filtering() const {
+    check_is_buffer();
+    return contents->gpu_texture_filtering;
+}
+
 void Parameter::set_min_value(Expr e) {
     check_is_scalar();
     if (e.defined()) {
@@ -276,6 +299,16 @@ Expr Parameter::estimate() const {
     return contents->scalar_estimate;
 }
 
+void Parameter::set_specialization_hints(const std::vector<Expr> &values) {
+    check_is_scalar();
+    contents->scalar_specialization_hints = values;
+}
+
+const std::vector<Expr> &Parameter::specialization_hints() const {
+    check_is_scalar();
+    return contents->scalar_specialization_hints;
+}
+
 ArgumentEstimates Parameter::get_argument_estimates() const {
     ArgumentEstimates argument_estimates;
     if (!is_buffer()) {
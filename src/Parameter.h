@@ -141,6 +141,15 @@ public:
     int host_alignment() const;
     //@}
 
+    /** Get and set whether CUDA kernels read this buffer through a
+     * texture object, and whether sample_bilinear uses the texture
+     * units' linear filtering. See ImageParam::gpu_texture. */
+    //@{
+    void set_gpu_texture(bool enabled, bool hardware_filtering);
+    bool gpu_texture() const;
+    bool gpu_texture_filtering() const;
+    //@}
+
     /** Get and set constraints for scalar parameters. These are used
      * directly by Param, so they must be exported. */
     // @{
@@ -150,6 +159,8 @@ public:
     Expr max_value() const;
     void set_estimate(Expr e);
     Expr estimate() const;
+    void set_specialization_hints(const std::vector<Expr> &values);
+    const std::vector<Expr> &specialization_hints() const;
     // @}
 
     /** Order Parameters by their IntrusivePtr so they can be used
@@ -3,6 +3,7 @@
 
 #include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
+#include "CodeSize.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMutator.h"
@@ -490,6 +491,20 @@ class PartitionLoops : public IRMutator2 {
 
     bool in_gpu_loop = false;
 
+    CodeSizeBudget &budget;
+
+    // The Func whose producer we're in, to attribute the code in
+    // prologues and epilogues to.
+    string func;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            ScopedValue<string> old_func(func, op->name);
+            return IRMutator2::visit(op);
+        }
+        return IRMutator2::visit(op);
+    }
+
     Stmt visit(const For *op) override {
         Stmt body = op->body;
 
@@ -578,6 +593,19 @@ class PartitionLoops : public IRMutator2 {
             }
         }
 
+        if (middle_simps.empty()) {
+            // There were likely tags, but we couldn't find a range of
+            // the loop variable over which any of them hold. This
+            // usually means a condition also depends on a loop
+            // further in, or isn't affine in this one.
+            debug(1) << "Could not partition loop over " << op->name
+                     << ": no interval found for the conditions:\n";
+            for (const auto &s : finder.simplifications) {
+                debug(1) << "  " << s.condition << "\n";
+            }
+            return IRMutator2::visit(op);
+        }
+
         // In general we can't simplify the prologue - it may run up
         // to after the epilogue starts for small images. However if
         // we can prove the epilogue starts after the prologue ends,
@@ -640,6 +668,25 @@ class PartitionLoops : public IRMutator2 {
         bool make_prologue = !equal(prologue, simpler_body);
         bool make_epilogue = !equal(epilogue, simpler_body);
 
+        // The prologue and epilogue are extra copies of the body.
+        if (budget.enabled()) {
+            map<string, int64_t> growth;
+            if (make_prologue) {
+                growth = budget.estimate(prologue, func);
+            }
+            if (make_epilogue) {
+                for (const auto &g : budget.estimate(epilogue, func)) {
+                    growth[g.first] += g.second;
+                }
+            }
+            string reason;
+            if (!budget.try_grow(growth, &reason)) {
+                debug(1) << "Not partitioning loop over " << op->name
+                         << ", because " << reason << "\n";
+                return IRMutator2::visit(op);
+            }
+        }
+
         // Recurse on the middle section.
         simpler_body = mutate(simpler_body);
 
@@ -742,6 +789,8 @@ class PartitionLoops : public IRMutator2 {
         if (can_prove(epilogue_val <= prologue_val)) {
             // The steady state is empty. I've made a huge
             // mistake. Try to partition a loop further in.
+            debug(1) << "Could not partition loop over " << op->name
+                     << ": the steady state is empty\n";
             return IRMutator2::visit(op);
         }
 
@@ -751,6 +800,10 @@ class PartitionLoops : public IRMutator2 {
 
         return stmt;
     }
+
+public:
+    PartitionLoops(CodeSizeBudget &budget) : budget(budget) {
+    }
 };
 
 class ExprContainsLoad : public IRVisitor {
@@ -1052,11 +1105,11 @@ bool has_likely_tag(Expr e) {
     return h.result;
 }
 
-Stmt partition_loops(Stmt s) {
+Stmt partition_loops(Stmt s, CodeSizeBudget &budget) {
     s = LowerLikelyIfInnermost().mutate(s);
     s = MarkClampedRampsAsLikely().mutate(s);
     s = ExpandSelects().mutate(s);
-    s = PartitionLoops().mutate(s);
+    s = PartitionLoops(budget).mutate(s);
     s = RenormalizeGPULoops().mutate(s);
     s = RemoveLikelyTags().mutate(s);
     s = CollapseSelects().mutate(s);
@@ -12,6 +12,8 @@
 namespace Halide {
 namespace Internal {
 
+class CodeSizeBudget;
+
 /** Return true if an expression uses a likely tag that isn't captured
  * by an enclosing Select, Min, or Max. */
 bool has_uncaptured_likely_tag(Expr e);
@@ -21,8 +23,9 @@ bool has_likely_tag(Expr e);
 
 /** Partitions loop bodies into a prologue, a steady state, and an
  * epilogue. Finds the steady state by hunting for use of clamped
- * ramps, or the 'likely' intrinsic. */
-Stmt partition_loops(Stmt s);
+ * ramps, or the 'likely' intrinsic. Loops whose prologue and
+ * epilogue would exceed the code size budget are left whole. */
+Stmt partition_loops(Stmt s, CodeSizeBudget &budget);
 
 }  // namespace Internal
 }  // namespace Halide
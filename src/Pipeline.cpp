@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <mutex>
 
 #include "Argument.h"
 #include "FindCalls.h"
@@ -13,6 +14,9 @@
 #include "Pipeline.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "RedundantWork.h"
+#include "Simplify.h"
+#include "Substitute.h"
 
 using namespace Halide::Internal;
 
@@ -32,6 +36,76 @@ std::string output_name(const string &filename, const Module &m, const char* ext
     return output_name(filename, m.name(), ext);
 }
 
+void find_specialization_conditions(const Definition &def, vector<Expr> &conditions) {
+    for (const Specialization &s : def.specializations()) {
+        conditions.push_back(s.condition);
+        find_specialization_conditions(s.definition, conditions);
+    }
+}
+
+// Find the current values of the parameters and buffer fields that
+// some expressions refer to. 'known' is false if any of them are
+// unknown.
+class FindSpecializationValues : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    const ParamMap &param_map;
+    const std::map<string, Buffer<>> &named_outputs;
+
+    void visit(const Variable *op) override {
+        if (values.count(op->name)) {
+            return;
+        }
+
+        Buffer<> buf = op->image;
+        if (op->param.defined()) {
+            Buffer<> *unused = nullptr;
+            const Parameter &p = param_map.map(op->param, unused);
+            if (!p.is_buffer()) {
+                if (p.type().is_handle()) {
+                    known = false;
+                } else {
+                    values[op->name] = p.scalar_expr();
+                }
+                return;
+            }
+            buf = p.buffer();
+            auto it = named_outputs.find(p.name());
+            if (!buf.defined() && it != named_outputs.end()) {
+                buf = it->second;
+            }
+        }
+
+        // Buffer fields are named buffer.field.dim
+        size_t last = op->name.rfind('.');
+        size_t field_start = last == string::npos ? string::npos : op->name.rfind('.', last - 1);
+        if (!buf.defined() || field_start == string::npos) {
+            known = false;
+            return;
+        }
+        string field = op->name.substr(field_start + 1, last - field_start - 1);
+        int d = std::atoi(op->name.c_str() + last + 1);
+        if (d < 0 || d >= buf.dimensions()) {
+            known = false;
+        } else if (field == "min") {
+            values[op->name] = buf.dim(d).min();
+        } else if (field == "extent") {
+            values[op->name] = buf.dim(d).extent();
+        } else if (field == "stride") {
+            values[op->name] = buf.dim(d).stride();
+        } else {
+            known = false;
+        }
+    }
+
+public:
+    std::map<string, Expr> values;
+    bool known = true;
+
+    FindSpecializationValues(const ParamMap &param_map, const std::map<string, Buffer<>> &named_outputs)
+        : param_map(param_map), named_outputs(named_outputs) {}
+};
+
 Outputs static_library_outputs(const string &filename_prefix, const Target &target) {
     Outputs outputs = Outputs().c_header(filename_prefix + ".h");
     if (target.os == Target::Windows && !target.has_feature(Target::MinGW)) {
@@ -44,6 +118,18 @@ Outputs static_library_outputs(const string &filename_prefix, const Target &targ
 
 }  // namespace
 
+namespace Internal {
+
+// The jit-compiled code for a Pipeline, the target it was compiled
+// for, and the arguments of its main function.
+struct JITCache {
+    JITModule jit_module;
+    Target jit_target;
+    vector<InferredArgument> inferred_args;
+};
+
+}  // namespace Internal
+
 struct PipelineContents {
     mutable RefCount ref_count;
 
@@ -53,15 +139,26 @@ struct PipelineContents {
     // Name of the generated function
     string name;
 
-    // Cached jit-compiled code
-    JITModule jit_module;
-    Target jit_target;
+    // Cached jit-compiled code. Replaced as a whole when the
+    // pipeline is recompiled, so that concurrent calls to realize
+    // each see a consistent version. Guarded by jit_mutex.
+    std::shared_ptr<const JITCache> jit_cache;
+    std::mutex jit_mutex;
+
+    // Cached jit-compiled code for each combination of
+    // specializations taken so far, with the lazy_specializations
+    // target feature. Guarded by jit_mutex.
+    std::map<std::string, std::shared_ptr<const JITCache>> jit_specializations;
+
+    // The values to resolve specialization conditions with in the next
+    // lowering. Only set while compiling one of jit_specializations.
+    std::map<std::string, Expr> specialization_values;
 
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
-        jit_module = JITModule();
-        jit_target = Target();
+        jit_cache.reset();
+        jit_specializations.clear();
         inferred_args.clear();
     }
 
@@ -81,9 +178,7 @@ struct PipelineContents {
     /** A set of custom passes to use when lowering this Func. */
     vector<CustomLoweringPass> custom_lowering_passes;
 
-    /** The inferred arguments. Also the arguments to the main
-     * function in the jit_module above. The two must be updated
-     * together. */
+    /** The inferred arguments. */
     vector<InferredArgument> inferred_args;
 
     /** List of C funtions and Funcs to satisfy HalideExtern* and
@@ -158,7 +253,8 @@ string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_p
     }
 
     user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
-                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+                target.arch == Target::POWERPC || target.arch == Target::MIPS ||
+                target.arch == Target::WebAssembly || target.arch == Target::RISCV)
         << "Automatic scheduling is currently supported only on these architectures.";
     return generate_schedules(contents->outputs, target, arch_params);
 }
@@ -254,6 +350,11 @@ void Pipeline::print_loop_nest() {
     std::cerr << Halide::Internal::print_loop_nest(contents->outputs);
 }
 
+void Pipeline::print_redundant_work() {
+    user_assert(defined()) << "Can't print redundant work of undefined Pipeline.\n";
+    std::cerr << Halide::Internal::redundant_work_report(contents->outputs);
+}
+
 void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        const vector<Argument> &args,
                                        StmtOutputFormat fmt,
@@ -389,6 +490,8 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
     same_compile = same_compile && std::equal(lowering_args.begin(), lowering_args.end(), old_module.functions().front().args.begin());
     // Linkage is the same.
     same_compile = same_compile && old_module.functions().front().linkage == linkage_type;
+    // Not compiling for particular specializations.
+    same_compile = same_compile && contents->specialization_values.empty();
     // The outputs of a Pipeline cannot change, so no need to test them.
 
     if (same_compile) {
@@ -400,7 +503,8 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
             custom_passes.push_back(p.pass);
         }
 
-        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes);
+        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes,
+                                 contents->specialization_values);
     }
 
     return contents->module;
@@ -419,7 +523,13 @@ std::string Pipeline::generate_function_name() const {
 }
 
 void *Pipeline::compile_jit(const Target &target_arg) {
+    return compile_jit_cache(target_arg)->jit_module.main_function();
+}
+
+std::shared_ptr<const JITCache> Pipeline::compile_jit_cache(const Target &target_arg) {
     user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(target_arg.arch != Target::WebAssembly)
+        << "WebAssembly targets can only be compiled ahead-of-time.\n";
 
     Target target(target_arg);
     target.set_feature(Target::JIT);
@@ -427,19 +537,126 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     debug(2) << "jit-compiling for: " << target_arg << "\n";
 
+    // Only one thread compiles at a time. The others wait for it,
+    // and then reuse what it compiled.
+    std::lock_guard<std::mutex> lock(contents->jit_mutex);
+
     // If we're re-jitting for the same target, we can just keep the
     // old jit module.
-    if (contents->jit_target == target &&
-        contents->jit_module.compiled()) {
-        debug(2) << "Reusing old jit module compiled for :\n" << contents->jit_target << "\n";
-        return contents->jit_module.main_function();
+    if (contents->jit_cache &&
+        contents->jit_cache->jit_target == target) {
+        debug(2) << "Reusing old jit module compiled for :\n" << target << "\n";
+        return contents->jit_cache;
     }
 
     // Clear all cached info in case there is an error.
     contents->invalidate_cache();
 
-    contents->jit_target = target;
+    std::shared_ptr<JITCache> jit = compile_jit_module(target, target_arg);
+    contents->jit_cache = jit;
+    return jit;
+}
+
+std::shared_ptr<const JITCache> Pipeline::compile_jit_specialized(const Target &target_arg,
+                                                                  RealizationArg &outputs,
+                                                                  const ParamMap &param_map) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    if (!target_arg.has_feature(Target::LazySpecializations)) {
+        return compile_jit_cache(target_arg);
+    }
+
+    vector<Expr> conditions;
+    std::map<string, Function> env;
+    for (Function f : contents->outputs) {
+        populate_environment(f, env);
+    }
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        if (f.definition().defined()) {
+            find_specialization_conditions(f.definition(), conditions);
+        }
+        for (const Definition &u : f.updates()) {
+            find_specialization_conditions(u, conditions);
+        }
+    }
+    if (conditions.empty()) {
+        return compile_jit_cache(target_arg);
+    }
 
+    // The output buffers may be referred to by name.
+    vector<Buffer<>> output_buffers;
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            output_buffers.push_back((*outputs.r)[i]);
+        }
+    } else if (outputs.buf) {
+        output_buffers.push_back(Buffer<>(*outputs.buf));
+    } else {
+        output_buffers = *outputs.buffer_list;
+    }
+    std::map<string, Buffer<>> named_outputs;
+    size_t idx = 0;
+    for (Function f : contents->outputs) {
+        for (const Parameter &p : f.output_buffers()) {
+            if (idx < output_buffers.size()) {
+                named_outputs[p.name()] = output_buffers[idx++];
+            }
+        }
+    }
+
+    // Resolve every condition with the current values. If any of them
+    // depends on something else, compile all the specializations.
+    FindSpecializationValues find(param_map, named_outputs);
+    for (const Expr &c : conditions) {
+        c.accept(&find);
+    }
+    string key;
+    for (const Expr &c : conditions) {
+        Expr value = find.known ? simplify(substitute(find.values, c)) : Expr();
+        if (is_one(value)) {
+            key += '1';
+        } else if (is_zero(value)) {
+            key += '0';
+        } else {
+            debug(2) << "Can't resolve specialization condition " << c << " ahead of time\n";
+            return compile_jit_cache(target_arg);
+        }
+    }
+
+    Target target(target_arg);
+    target.set_feature(Target::JIT);
+    target.set_feature(Target::UserContext);
+    key = target.to_string() + "/" + key;
+
+    std::lock_guard<std::mutex> lock(contents->jit_mutex);
+
+    auto it = contents->jit_specializations.find(key);
+    if (it != contents->jit_specializations.end()) {
+        debug(2) << "Reusing jit module for specializations " << key << "\n";
+        return it->second;
+    }
+
+    debug(2) << "jit-compiling for specializations " << key << "\n";
+
+    // Make sure neither this compile nor the next one reuses a module
+    // lowered for other values, even if compilation fails.
+    struct ResetSpecializationValues {
+        PipelineContents *contents;
+        ~ResetSpecializationValues() {
+            contents->specialization_values.clear();
+            contents->module = Module("", Target());
+        }
+    } reset{contents.get()};
+    contents->module = Module("", Target());
+    contents->specialization_values = find.values;
+
+    std::shared_ptr<JITCache> jit = compile_jit_module(target, target_arg);
+    contents->jit_specializations[key] = jit;
+    return jit;
+}
+
+std::shared_ptr<JITCache> Pipeline::compile_jit_module(const Target &target, const Target &target_arg) {
     // Infer an arguments vector
     infer_arguments();
 
@@ -476,9 +693,53 @@ void *Pipeline::compile_jit(const Target &target_arg) {
         module.compile(Outputs().bitcode(file_name));
     }
 
-    contents->jit_module = jit_module;
+    std::shared_ptr<JITCache> jit(new JITCache);
+    jit->jit_module = jit_module;
+    jit->jit_target = target;
+    jit->inferred_args = contents->inferred_args;
 
-    return jit_module.main_function();
+    return jit;
+}
+
+namespace Internal {
+
+struct CallableContents {
+    JITModule jit_module;
+    JITHandlers jit_handlers;
+};
+
+}  // namespace Internal
+
+Callable Pipeline::compile_to_callable(const vector<Argument> &args_in, const Target &target_arg) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    Target target(target_arg);
+    target.set_feature(Target::JIT);
+    target.set_feature(Target::UserContext);
+
+    debug(2) << "jit-compiling to callable for: " << target_arg << "\n";
+
+    vector<Argument> args = args_in;
+    args.insert(args.begin(), contents->user_context_arg.arg);
+
+    string name = generate_function_name();
+    Module module("", Target());
+    {
+        // compile_to_module updates the cached Module.
+        std::lock_guard<std::mutex> lock(contents->jit_mutex);
+        module = compile_to_module(args, name, target).resolve_submodules();
+    }
+    auto f = module.get_function_by_name(name);
+
+    std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
+
+    std::shared_ptr<CallableContents> callable_contents(new CallableContents);
+    callable_contents->jit_module = JITModule(module, f, make_externs_jit_module(target_arg, lowered_externs));
+    callable_contents->jit_handlers = jit_handlers();
+
+    // The arguments after the user context, including the outputs.
+    vector<Argument> callable_args(f.args.begin() + 1, f.args.end());
+    return Callable(callable_contents, callable_contents->jit_module.argv_function(), callable_args);
 }
 
 
@@ -722,19 +983,18 @@ private:
 // Make a vector of void *'s to pass to the jit call using the
 // currently bound value for all of the params and image
 // params.
-void Pipeline::prepare_jit_call_arguments(RealizationArg &outputs, const Target &target,
+void Pipeline::prepare_jit_call_arguments(const JITCache &jit, RealizationArg &outputs,
                                           const ParamMap &param_map, void *user_context,
                                           bool is_bounds_inference, JITCallArgs &args_result) {
     user_assert(defined()) << "Can't realize an undefined Pipeline\n";
 
-    JITModule &compiled_module = contents->jit_module;
-    internal_assert(compiled_module.argv_function());
+    internal_assert(jit.jit_module.argv_function());
 
     const bool no_param_map = &param_map == &ParamMap::empty_map();
 
     // Come up with the void * arguments to pass to the argv function
     size_t arg_index = 0;
-    for (const InferredArgument &arg : contents->inferred_args) {
+    for (const InferredArgument &arg : jit.inferred_args) {
         if (arg.param.defined()) {
             if (arg.param.same_as(contents->user_context_arg.param)) {
                 args_result.store[arg_index++] = user_context;
@@ -801,17 +1061,16 @@ Pipeline::make_externs_jit_module(const Target &target,
          iter++) {
         Pipeline pipeline = iter->second.pipeline();
         if (pipeline.defined()) {
-            PipelineContents &pipeline_contents(*pipeline.contents);
-
             // Ensure that the pipeline is compiled.
-            pipeline.compile_jit(target);
+            std::shared_ptr<const JITCache> jit = pipeline.compile_jit_cache(target);
 
-            free_standing_jit_externs.add_dependency(pipeline_contents.jit_module);
-            free_standing_jit_externs.add_symbol_for_export(iter->first, pipeline_contents.jit_module.entrypoint_symbol());
-            void *address = pipeline_contents.jit_module.entrypoint_symbol().address;
+            JITModule dependency = jit->jit_module;
+            free_standing_jit_externs.add_dependency(dependency);
+            free_standing_jit_externs.add_symbol_for_export(iter->first, jit->jit_module.entrypoint_symbol());
+            void *address = jit->jit_module.entrypoint_symbol().address;
             std::vector<Type> arg_types;
             // Add the arguments to the compiled pipeline
-            for (const InferredArgument &arg : pipeline_contents.inferred_args) {
+            for (const InferredArgument &arg : jit->inferred_args) {
                 // TODO: it's not clear whether arg.arg.type is correct for
                 // the arg.is_buffer() case (AFAIK, is_buffer()==true isn't possible
                 // in current mtrunk Halide, but may be in some side branches that
@@ -822,7 +1081,7 @@ Pipeline::make_externs_jit_module(const Target &target,
                                     arg.arg.type);
             }
             // Add the outputs of the pipeline
-            for (size_t i = 0; i < pipeline_contents.outputs.size(); i++) {
+            for (size_t i = 0; i < pipeline.outputs().size(); i++) {
                 arg_types.push_back(type_of<struct buffer_t *>());
             }
             ExternSignature signature(Int(32), false, arg_types);
@@ -865,8 +1124,9 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // If target is unspecified...
     if (target.os == Target::OSUnknown) {
         // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
+        std::lock_guard<std::mutex> lock(contents->jit_mutex);
+        if (contents->jit_cache) {
+            target = contents->jit_cache->jit_target;
         } else {
             // Otherwise get the target from the environment
             target = get_jit_target_from_environment();
@@ -895,15 +1155,17 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // user_context is just a pointer to a JITUserContext, which is a
     // member of the JITFuncCallContext which we will declare now:
 
-    // Ensure the module is compiled.
-    compile_jit(target);
+    // Ensure the module is compiled. We hold a reference to the
+    // compiled code, so it stays valid for this call even if another
+    // thread recompiles the pipeline.
+    std::shared_ptr<const JITCache> jit = compile_jit_specialized(target, outputs, param_map);
 
     // This has to happen after a runtime has been compiled in compile_jit.
     JITFuncCallContext jit_context(jit_handlers());
     void *user_context_storage = &jit_context.jit_context;
 
-    JITCallArgs args(contents->inferred_args.size() + outputs.size());
-    prepare_jit_call_arguments(outputs, target, param_map,
+    JITCallArgs args(jit->inferred_args.size() + outputs.size());
+    prepare_jit_call_arguments(*jit, outputs, param_map,
                                &user_context_storage, false, args);
 
 
@@ -945,15 +1207,15 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // exception.
 
     debug(2) << "Calling jitted function\n";
-    int exit_status = contents->jit_module.argv_function()(args.store);
+    int exit_status = jit->jit_module.argv_function()(args.store);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
     if (target.has_feature(Target::Profile)) {
         JITModule::Symbol report_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_report");
+            jit->jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
+            jit->jit_module.find_symbol_by_name("halide_profiler_reset");
         if (report_sym.address && reset_sym.address) {
             void *uc = &jit_context.jit_context;
             void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
@@ -967,18 +1229,54 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     jit_context.finalize(exit_status);
 }
 
+Callable::Callable(std::shared_ptr<const CallableContents> contents,
+                   int (*argv_function)(const void **),
+                   const vector<Argument> &args)
+    : contents(contents), argv_function(argv_function), args(args) {
+}
+
+void Callable::fail_bad_arg_count(size_t count) const {
+    user_assert(defined()) << "Can't call an undefined Callable\n";
+    user_error << "Callable takes " << args.size()
+               << " arguments (including the outputs), but was passed " << count << "\n";
+}
+
+void Callable::fail_bad_arg(size_t i, const char *passed, Type type, int dimensions) const {
+    const Argument &a = args[i];
+    std::ostringstream expected;
+    if (a.is_buffer()) {
+        expected << "a buffer of type " << a.type << " with " << (int)a.dimensions << " dimensions";
+    } else {
+        expected << "a scalar of type " << a.type;
+    }
+    user_error << "Argument " << i << " (" << a.name << ") of Callable should be "
+               << expected.str() << ", but was passed " << passed << " of type " << type
+               << (a.is_buffer() ? " with " + std::to_string(dimensions) + " dimensions" : "")
+               << "\n";
+}
+
+int Callable::call_argv(const void **argv) const {
+    user_assert(defined()) << "Can't call an undefined Callable\n";
+    JITFuncCallContext jit_context(contents->jit_handlers);
+    void *user_context_storage = &jit_context.jit_context;
+    argv[0] = &user_context_storage;
+    int exit_status = argv_function(argv);
+    jit_context.finalize(exit_status);
+    return exit_status;
+}
+
 void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_map) {
     Target target = get_jit_target_from_environment();
 
-    compile_jit(target);
+    std::shared_ptr<const JITCache> jit = compile_jit_cache(target);
 
     // This has to happen after a runtime has been compiled in compile_jit.
     JITFuncCallContext jit_context(jit_handlers());
     void *user_context_storage = &jit_context.jit_context;
 
-    size_t args_size = contents->inferred_args.size() + outputs.size();
+    size_t args_size = jit->inferred_args.size() + outputs.size();
     JITCallArgs args(args_size);
-    prepare_jit_call_arguments(outputs, target, param_map,
+    prepare_jit_call_arguments(*jit, outputs, param_map,
                                &user_context_storage, true, args);
 
     struct TrackedBuffer {
@@ -991,10 +1289,10 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
     vector<TrackedBuffer> tracked_buffers(args_size);
 
     vector<size_t> query_indices;
-    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+    for (size_t i = 0; i < jit->inferred_args.size(); i++) {
         if (args.store[i] == nullptr) {
             query_indices.push_back(i);
-            InferredArgument ia = contents->inferred_args[i];
+            InferredArgument ia = jit->inferred_args[i];
             internal_assert(ia.param.defined() && ia.param.is_buffer());
             // Make some empty Buffers of the right dimensionality
             vector<int> initial_shape(ia.param.dimensions(), 0);
@@ -1020,7 +1318,7 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         }
 
         Internal::debug(2) << "Calling jitted function\n";
-        int exit_status = contents->jit_module.argv_function()(args.store);
+        int exit_status = jit->jit_module.argv_function()(args.store);
         jit_context.report_if_error(exit_status);
         Internal::debug(2) << "Back from jitted function\n";
         bool changed = false;
@@ -1051,7 +1349,7 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
 
     // Now allocate the resulting buffers
     for (size_t i : query_indices) {
-        InferredArgument ia = contents->inferred_args[i];
+        InferredArgument ia = jit->inferred_args[i];
         Buffer<> *buf_out_param = nullptr;
         Parameter &p = param_map.map(ia.param, buf_out_param);
 
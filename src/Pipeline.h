@@ -7,8 +7,10 @@
  * pipeline.
  */
 
+#include <memory>
 #include <vector>
 
+#include "Argument.h"
 #include "AutoSchedule.h"
 #include "ExternalCode.h"
 #include "IntrusivePtr.h"
@@ -54,6 +56,121 @@ struct CustomLoweringPass {
 
 struct JITExtern;
 
+namespace Internal {
+struct CallableContents;
+struct JITCache;
+}  // namespace Internal
+
+/** A pipeline jit-compiled with a fixed argument list. Made by
+ * Pipeline::compile_to_callable. Calling it with the arguments, in
+ * order, followed by the output buffers, runs the pipeline with much
+ * less overhead than Pipeline::realize: the arguments are passed
+ * straight to the compiled code after a check of their types, with
+ * no lookups of the values bound to Params, and no allocation. Buffer
+ * arguments may be Halide::Buffers, Runtime::Buffers or
+ * halide_buffer_t pointers, and scalar arguments must have exactly
+ * the type of the corresponding Param. For example:
+ \code
+ ImageParam in(UInt(8), 2);
+ Param<float> gain;
+ Func f;
+ f(x, y) = cast<uint8_t>(clamp(in(x, y) * gain, 0, 255));
+ Callable c = f.compile_to_callable({in, gain});
+ for (...) {
+     c(in_tile, 1.5f, out_tile);
+ }
+ \endcode
+ * The JIT handlers (e.g. the custom error handler) are those set on
+ * the Pipeline when it was compiled. Returns the exit status of the
+ * pipeline. As with realize(), errors are reported through the
+ * error handler. */
+class Callable {
+    std::shared_ptr<const Internal::CallableContents> contents;
+    int (*argv_function)(const void **){nullptr};
+    // The arguments, followed by the outputs.
+    std::vector<Argument> args;
+
+    // Report a mismatch between the arguments passed and those the
+    // pipeline was compiled with.
+    void fail_bad_arg_count(size_t count) const;
+    void fail_bad_arg(size_t i, const char *passed, Type type, int dimensions) const;
+
+    // Call the compiled code. argv[0] is reserved for the user context.
+    int call_argv(const void **argv) const;
+
+    const void *check_buffer(size_t i, const halide_buffer_t *buf, Type type) const {
+        const Argument &a = args[i];
+        if (!a.is_buffer() || buf == nullptr ||
+            type != a.type || buf->dimensions != a.dimensions) {
+            fail_bad_arg(i, "a buffer", type, buf ? buf->dimensions : 0);
+        }
+        return buf;
+    }
+
+    const void *check_arg(size_t i, const halide_buffer_t *buf) const {
+        return check_buffer(i, buf, buf ? Type(buf->type) : Type());
+    }
+
+    const void *check_arg(size_t i, halide_buffer_t *buf) const {
+        return check_arg(i, (const halide_buffer_t *)buf);
+    }
+
+    template<typename T>
+    const void *check_arg(size_t i, const Buffer<T> &buf) const {
+        return check_arg(i, buf.raw_buffer());
+    }
+
+    template<typename T, int D>
+    const void *check_arg(size_t i, const Runtime::Buffer<T, D> &buf) const {
+        return check_arg(i, buf.raw_buffer());
+    }
+
+    template<typename T,
+             typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    const void *check_arg(size_t i, const T &scalar) const {
+        const Argument &a = args[i];
+        if (a.is_buffer() || a.type != type_of<T>()) {
+            fail_bad_arg(i, "a scalar", type_of<T>(), 0);
+        }
+        return &scalar;
+    }
+
+    void fill_argv(const void **argv, size_t i) const {
+    }
+
+    template<typename First, typename... Rest>
+    void fill_argv(const void **argv, size_t i, First &&first, Rest &&... rest) const {
+        argv[i + 1] = check_arg(i, first);
+        fill_argv(argv, i + 1, std::forward<Rest>(rest)...);
+    }
+
+public:
+    /** Make an undefined Callable. */
+    Callable() = default;
+
+    /** Make a Callable from the compiled code. Use
+     * Pipeline::compile_to_callable instead. */
+    Callable(std::shared_ptr<const Internal::CallableContents> contents,
+             int (*argv_function)(const void **),
+             const std::vector<Argument> &args);
+
+    bool defined() const {
+        return contents != nullptr;
+    }
+
+    /** Run the pipeline. The arguments are those passed to
+     * compile_to_callable, followed by the output buffers. */
+    template<typename... Args>
+    int operator()(Args &&... call_args) const {
+        if (sizeof...(Args) != args.size()) {
+            fail_bad_arg_count(sizeof...(Args));
+        }
+        const void *argv[sizeof...(Args) + 1];
+        fill_argv(argv, 0, std::forward<Args>(call_args)...);
+        return call_argv(argv);
+    }
+};
+
 /** A class representing a Halide pipeline. Constructed from the Func
  * or Funcs that it outputs. */
 class Pipeline {
@@ -94,8 +211,24 @@ public:
 
     struct JITCallArgs; // Opaque structure to optimize away dynamic allocation in this path.
 
+    // Jit compile the pipeline if it hasn't already been compiled
+    // for the target, and return the compiled code. Safe to call
+    // from multiple threads.
+    std::shared_ptr<const Internal::JITCache> compile_jit_cache(const Target &target);
+
+    // With the lazy_specializations target feature, jit compile only
+    // the specializations that the current parameter values select,
+    // and keep one version per combination of specializations
+    // taken. Otherwise the same as compile_jit_cache.
+    std::shared_ptr<const Internal::JITCache> compile_jit_specialized(const Target &target,
+                                                                      RealizationArg &outputs,
+                                                                      const ParamMap &param_map);
+
+    // Jit compile the pipeline. The caller must hold the jit mutex.
+    std::shared_ptr<Internal::JITCache> compile_jit_module(const Target &target, const Target &target_arg);
+
     // For the three method below, precisely one of the first two args should be non-null
-    void prepare_jit_call_arguments(RealizationArg &output, const Target &target, const ParamMap &param_map,
+    void prepare_jit_call_arguments(const Internal::JITCache &jit, RealizationArg &output, const ParamMap &param_map,
                                     void *user_context, bool is_bounds_inference, JITCallArgs &args_result);
 
     static std::vector<Internal::JITModule> make_externs_jit_module(const Target &target,
@@ -219,6 +352,10 @@ public:
      * doing. */
     void print_loop_nest();
 
+    /** Write out how much of the work of each Func computed at a loop
+     * of its consumer is redundant. See \ref Func::print_redundant_work */
+    void print_redundant_work();
+
     /** Compile to object file and header pair, with the given
      * arguments. */
     void compile_to_file(const std::string &filename_prefix,
@@ -258,9 +395,23 @@ public:
      * then you can call this ahead of time. Returns the raw function
      * pointer to the compiled pipeline. Default is to use the Target
      * returned from Halide::get_jit_target_from_environment()
+     *
+     * Pipelines in the same process that lower to identical code
+     * (which requires their Funcs and Params to have the same names)
+     * share one compiled module, so building the same pipeline many
+     * times only compiles it once. The module is freed once no
+     * pipeline refers to it.
      */
      void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Jit compile the pipeline to a Callable that takes the given
+     * arguments, in order, followed by the output buffers. Compiling
+     * once and calling the Callable avoids the per-call overhead of
+     * realize(), which matters for pipelines that run on small
+     * inputs at a high rate. See Callable. */
+    Callable compile_to_callable(const std::vector<Argument> &args,
+                                 const Target &target = get_jit_target_from_environment());
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -397,7 +548,13 @@ public:
     /** Get the custom lowering passes. */
     const std::vector<CustomLoweringPass> &custom_lowering_passes();
 
-    /** See Func::realize */
+    /** See Func::realize. Calls to realize on the same Pipeline may
+     * be made concurrently from multiple threads: the first call for
+     * a target compiles the pipeline while the others wait, and then
+     * they all share the compiled code. Bind Params and ImageParams
+     * per call with the param_map, rather than by setting them, so
+     * that the threads don't race. Don't change the schedule or the
+     * JIT handlers while another thread is realizing the Pipeline. */
     // @{
     Realization realize(std::vector<int32_t> sizes, const Target &target = Target(),
                         const ParamMap &param_map = ParamMap::empty_map());
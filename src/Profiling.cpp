@@ -1,6 +1,8 @@
 #include <algorithm>
+#include <fstream>
 #include <limits>
 #include <map>
+#include <sstream>
 #include <string>
 
 #include "CodeGen_Internal.h"
@@ -19,6 +21,181 @@ using std::map;
 using std::string;
 using std::vector;
 
+namespace {
+
+// Count the arithmetic operations (one per vector lane) and the bytes
+// loaded and stored by a statement, leaving out any loops inside it,
+// which are counted separately. Address and predicate arithmetic isn't
+// counted. The cost of each operation is one, as in RegionCosts.
+class CountOps : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *) override {}
+
+    template<typename T>
+    void visit_arith(const T *op) {
+        IRVisitor::visit(op);
+        ops += op->type.lanes();
+    }
+
+    void visit(const Cast *op) override { visit_arith(op); }
+    void visit(const Add *op) override { visit_arith(op); }
+    void visit(const Sub *op) override { visit_arith(op); }
+    void visit(const Mul *op) override { visit_arith(op); }
+    void visit(const Div *op) override { visit_arith(op); }
+    void visit(const Mod *op) override { visit_arith(op); }
+    void visit(const Min *op) override { visit_arith(op); }
+    void visit(const Max *op) override { visit_arith(op); }
+    void visit(const EQ *op) override { visit_arith(op); }
+    void visit(const NE *op) override { visit_arith(op); }
+    void visit(const LT *op) override { visit_arith(op); }
+    void visit(const LE *op) override { visit_arith(op); }
+    void visit(const GT *op) override { visit_arith(op); }
+    void visit(const GE *op) override { visit_arith(op); }
+    void visit(const And *op) override { visit_arith(op); }
+    void visit(const Or *op) override { visit_arith(op); }
+    void visit(const Not *op) override { visit_arith(op); }
+    void visit(const Select *op) override { visit_arith(op); }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::PureExtern ||
+            op->call_type == Call::PureIntrinsic) {
+            ops += op->type.lanes();
+        }
+    }
+
+    void visit(const Load *op) override {
+        bytes += op->type.bytes() * op->type.lanes();
+    }
+
+    void visit(const Store *op) override {
+        op->value.accept(this);
+        bytes += op->value.type().bytes() * op->value.type().lanes();
+    }
+
+public:
+    uint64_t ops = 0, bytes = 0;
+};
+
+class ContainsLoop : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+bool contains_loop(const Stmt &s) {
+    ContainsLoop c;
+    s.accept(&c);
+    return c.result;
+}
+
+// Names the if statements on the host, in the same way for the pass
+// that counts how often they go each way and for the pass that uses
+// those counts in a later compile. A branch is named by the Func it
+// is in, its index among the branches of that Func, and its
+// condition.
+class NameBranches : public IRMutator2 {
+    vector<string> funcs;
+    map<string, int> next_index;
+
+protected:
+    using IRMutator2::visit;
+
+    virtual Stmt rewrite_branch(const string &name, Expr condition,
+                                Stmt then_case, Stmt else_case) = 0;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (!op->is_producer) {
+            return IRMutator2::visit(op);
+        }
+        funcs.push_back(split_string(op->name, ".")[0]);
+        Stmt s = IRMutator2::visit(op);
+        funcs.pop_back();
+        return s;
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        const string func = funcs.empty() ? "overhead" : funcs.back();
+        std::ostringstream name;
+        name << func << "." << next_index[func]++ << " " << op->condition;
+        string n = name.str();
+        std::replace(n.begin(), n.end(), '\n', ' ');
+        Stmt then_case = mutate(op->then_case);
+        Stmt else_case = mutate(op->else_case);
+        return rewrite_branch(n, op->condition, then_case, else_case);
+    }
+};
+
+// Count how often each branch goes each way.
+class CountBranches : public NameBranches {
+    Stmt rewrite_branch(const string &name, Expr condition,
+                        Stmt then_case, Stmt else_case) override {
+        int id = (int)names.size();
+        names.push_back(name);
+        string var = unique_name("branch_condition");
+        Expr c = Variable::make(Bool(), var);
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Stmt count = Evaluate::make(Call::make(Int(32), "halide_profiler_count_branch",
+                                               {profiler_pipeline_state, id, select(c, 1, 0)},
+                                               Call::Extern));
+        Stmt s = Block::make(count, IfThenElse::make(c, then_case, else_case));
+        return LetStmt::make(var, condition, s);
+    }
+
+public:
+    vector<string> names;
+};
+
+// The fewest times a branch must have run for its counts to be used.
+const uint64_t min_branch_samples = 16;
+
+// Tell codegen how often each branch went each way.
+class ApplyBranchProfile : public NameBranches {
+    const map<string, std::pair<uint64_t, uint64_t>> &counts;
+
+    Stmt rewrite_branch(const string &name, Expr condition,
+                        Stmt then_case, Stmt else_case) override {
+        auto it = counts.find(name);
+        if (it != counts.end() &&
+            it->second.first + it->second.second >= min_branch_samples) {
+            uint64_t taken = it->second.first, not_taken = it->second.second;
+            // Branch weights are 32-bit.
+            while (taken >= (1 << 30) || not_taken >= (1 << 30)) {
+                taken >>= 1;
+                not_taken >>= 1;
+            }
+            condition = Call::make(Bool(), Call::branch_weights,
+                                   {condition, make_const(Int(32), (int64_t)taken),
+                                    make_const(Int(32), (int64_t)not_taken)},
+                                   Call::PureIntrinsic);
+            applied++;
+        }
+        return IfThenElse::make(condition, then_case, else_case);
+    }
+
+public:
+    int applied = 0;
+
+    ApplyBranchProfile(const map<string, std::pair<uint64_t, uint64_t>> &counts)
+        : counts(counts) {}
+};
+
+}  // namespace
+
 class InjectProfiling : public IRMutator2 {
 public:
     map<string, int> indices;   // maps from func name -> index in buffer.
@@ -27,7 +204,16 @@ public:
 
     string pipeline_name;
 
-    InjectProfiling(const string &pipeline_name) : pipeline_name(pipeline_name) {
+    // Whether to also track the current func of each thread (for
+    // per-thread hardware counters). Off inside offloaded code.
+    bool by_thread;
+
+    // Whether to count the operations and memory traffic of each
+    // func, for the roofline report. Off inside offloaded code.
+    bool count_ops;
+
+    InjectProfiling(const string &pipeline_name, bool by_thread, bool count_ops)
+        : pipeline_name(pipeline_name), by_thread(by_thread), count_ops(count_ops) {
         indices["overhead"] = 0;
         stack.push_back(0);
     }
@@ -208,10 +394,73 @@ private:
                                    {profiler_state, profiler_token, idx}, Call::Extern);
 
         body = Block::make(Evaluate::make(set_task), body);
+        if (by_thread) {
+            body = Block::make(set_thread_func(idx), body);
+        }
 
         return ProducerConsumer::make(op->name, op->is_producer, body);
     }
 
+    Stmt set_thread_func(Expr idx) {
+        Expr profiler_token = Variable::make(Int(32), "profiler_token");
+        Expr thread_state = Variable::make(Handle(), "profiler_thread_state");
+        return Evaluate::make(Call::make(Int(32), "halide_profiler_set_thread_current_func",
+                                         {thread_state, profiler_token, idx}, Call::Extern));
+    }
+
+    Stmt set_thread_idle() {
+        // halide_profiler_outside_of_halide
+        Expr thread_state = Variable::make(Handle(), "profiler_thread_state");
+        return Evaluate::make(Call::make(Int(32), "halide_profiler_set_thread_current_func",
+                                         {thread_state, 0, -1}, Call::Extern));
+    }
+
+    // Wrap the body of a task that may run on a thread pool worker
+    // so that the worker bills its counters to the right func while
+    // running it, and to nothing afterwards.
+    Stmt track_thread(Stmt s) {
+        Expr state = Variable::make(Handle(), "profiler_state");
+        Expr get_thread_state = Call::make(Handle(), "halide_profiler_get_thread_state",
+                                           {state}, Call::Extern);
+        s = Block::make({set_thread_func(stack.back()), s, set_thread_idle()});
+        return LetStmt::make("profiler_thread_state", get_thread_state, s);
+    }
+
+    // The calling thread may have run some of the tasks itself, and
+    // so be marked idle. Restore its func afterwards.
+    Stmt restore_thread_func(Stmt s) {
+        return Block::make(s, set_thread_func(stack.back()));
+    }
+
+    Stmt count_ops_call(Expr ops, Expr bytes) {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        return Evaluate::make(Call::make(Int(32), "halide_profiler_count_ops",
+                                         {profiler_pipeline_state, stack.back(), ops, bytes},
+                                         Call::Extern));
+    }
+
+    // Bill the operations and memory traffic of a loop to the current
+    // func. The straight-line code in the body of an innermost loop is
+    // counted once, before the loop, and the statement to do that is
+    // returned. Otherwise it's counted at the top of every iteration,
+    // leaving the inner loops to count themselves.
+    Stmt count_loop_ops(const For *op, Stmt *body) {
+        CountOps counter;
+        op->body.accept(&counter);
+        if (counter.ops == 0 && counter.bytes == 0) {
+            return Stmt();
+        }
+        if (!contains_loop(op->body)) {
+            Expr extent = cast<uint64_t>(max(op->extent, 0));
+            return count_ops_call(simplify(extent * make_const(UInt(64), counter.ops)),
+                                  simplify(extent * make_const(UInt(64), counter.bytes)));
+        }
+        *body = Block::make(count_ops_call(make_const(UInt(64), counter.ops),
+                                           make_const(UInt(64), counter.bytes)),
+                            *body);
+        return Stmt();
+    }
+
     Stmt incr_active_threads() {
         Expr state = Variable::make(Handle(), "profiler_state");
         return Evaluate::make(Call::make(Int(32), "halide_profiler_incr_active_threads",
@@ -230,18 +479,30 @@ private:
         } else if (const Acquire *a = s.as<Acquire>()) {
             return Acquire::make(a->semaphore, a->count, visit_parallel_task(a->body));
         } else {
-            return Block::make({incr_active_threads(), mutate(s), decr_active_threads()});
+            Stmt body = Block::make({incr_active_threads(), mutate(s), decr_active_threads()});
+            if (by_thread) {
+                body = track_thread(body);
+            }
+            return body;
         }
     }
 
     Stmt visit(const Acquire *op) override {
         Stmt s = visit_parallel_task(op);
-        return Block::make({decr_active_threads(), s, incr_active_threads()});
+        s = Block::make({decr_active_threads(), s, incr_active_threads()});
+        if (by_thread) {
+            s = restore_thread_func(s);
+        }
+        return s;
     }
 
     Stmt visit(const Fork *op) override {
         Stmt s = visit_parallel_task(op);
-        return Block::make({decr_active_threads(), s, incr_active_threads()});
+        s = Block::make({decr_active_threads(), s, incr_active_threads()});
+        if (by_thread) {
+            s = restore_thread_func(s);
+        }
+        return s;
     }
 
     Stmt visit(const For *op) override {
@@ -254,6 +515,9 @@ private:
         bool update_active_threads = (op->device_api == DeviceAPI::Hexagon ||
                                       op->is_parallel());
 
+        // Op counting to do before the loop, if any.
+        Stmt count_before;
+
         if (update_active_threads) {
             body = Block::make({incr_active_threads(), body, decr_active_threads()});
         }
@@ -266,6 +530,8 @@ private:
             // which means we can't do memory accounting.
             bool old_profiling_memory = profiling_memory;
             profiling_memory = false;
+            ScopedValue<bool> old_by_thread(by_thread, false);
+            ScopedValue<bool> old_count_ops(count_ops, false);
             body = mutate(body);
             profiling_memory = old_profiling_memory;
 
@@ -278,6 +544,12 @@ private:
         } else if (op->device_api == DeviceAPI::None ||
                    op->device_api == DeviceAPI::Host) {
             body = mutate(body);
+            if (count_ops) {
+                count_before = count_loop_ops(op, &body);
+            }
+            if (by_thread && op->is_parallel()) {
+                body = track_thread(body);
+            }
         } else {
             body = op->body;
         }
@@ -287,12 +559,26 @@ private:
         if (update_active_threads) {
             stmt = Block::make({decr_active_threads(), stmt, incr_active_threads()});
         }
+        if (by_thread && op->is_parallel()) {
+            stmt = restore_thread_func(stmt);
+        }
+        if (count_before.defined()) {
+            stmt = Block::make(count_before, stmt);
+        }
         return stmt;
     }
 };
 
-Stmt inject_profiling(Stmt s, string pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
+Stmt inject_profiling(Stmt s, string pipeline_name, bool by_thread, bool roofline,
+                      bool count_branches) {
+    vector<string> branch_names;
+    if (count_branches) {
+        CountBranches counter;
+        s = counter.mutate(s);
+        branch_names = counter.names;
+    }
+
+    InjectProfiling profiling(pipeline_name, by_thread, roofline);
     s = profiling.mutate(s);
 
     int num_funcs = (int)(profiling.indices.size());
@@ -330,6 +616,25 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
                                   {profiler_state}, Call::Extern));
     s = Block::make({incr_active_threads, s, decr_active_threads});
 
+    if (by_thread) {
+        // The calling thread is marked idle again by
+        // halide_profiler_pipeline_end.
+        Expr get_thread_state = Call::make(Handle(), "halide_profiler_get_thread_state",
+                                           {profiler_state}, Call::Extern);
+        s = LetStmt::make("profiler_thread_state", get_thread_state, s);
+    }
+
+    if (!branch_names.empty()) {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Expr branch_names_buf = Variable::make(Handle(), "profiling_branch_names");
+        Expr register_branches = Call::make(Int(32), "halide_profiler_register_branches",
+                                            {profiler_pipeline_state, (int)branch_names.size(), branch_names_buf},
+                                            Call::Extern);
+        Expr registered = Variable::make(Int(32), "profiler_branches_registered");
+        s = Block::make(AssertStmt::make(registered == 0, registered), s);
+        s = LetStmt::make("profiler_branches_registered", register_branches, s);
+    }
+
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
     s = LetStmt::make("profiler_state", get_state, s);
     // If there was a problem starting the profiler, it will call an
@@ -338,6 +643,13 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     s = Block::make(AssertStmt::make(profiler_token >= 0, profiler_token), s);
     s = LetStmt::make("profiler_token", start_profiler, s);
 
+    if (roofline) {
+        // Done before the pipeline starts, so that the time it takes
+        // isn't billed to any func.
+        Expr measure = Call::make(Int(32), "halide_profiler_measure_roofline", {}, Call::Extern);
+        s = Block::make(Evaluate::make(measure), s);
+    }
+
     if (!no_stack_alloc) {
         for (int i = num_funcs-1; i >= 0; --i) {
             s = Block::make(Store::make("profiling_func_stack_peak_buf",
@@ -356,10 +668,48 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     s = Block::make(s, Free::make("profiling_func_names"));
     s = Allocate::make("profiling_func_names", Handle(),
                        MemoryType::Auto, {num_funcs}, const_true(), s);
+
+    if (!branch_names.empty()) {
+        for (size_t i = 0; i < branch_names.size(); i++) {
+            s = Block::make(Store::make("profiling_branch_names", branch_names[i], (int)i,
+                                        Parameter(), const_true()), s);
+        }
+        s = Block::make(s, Free::make("profiling_branch_names"));
+        s = Allocate::make("profiling_branch_names", Handle(),
+                           MemoryType::Auto, {(int)branch_names.size()}, const_true(), s);
+    }
+
     s = Block::make(Evaluate::make(stop_profiler), s);
 
     return s;
 }
 
+Stmt apply_branch_profile(Stmt s, const string &pipeline_name, const string &filename) {
+    std::ifstream in(filename);
+    user_assert(in) << "Could not open profile " << filename << "\n";
+
+    // Sum the counts over all the runs in the profile.
+    map<string, std::pair<uint64_t, uint64_t>> counts;
+    string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        string tag, pipeline, name;
+        uint64_t taken, not_taken;
+        if (!(fields >> tag >> pipeline >> taken >> not_taken) ||
+            tag != "branch" || pipeline != pipeline_name) {
+            continue;
+        }
+        std::getline(fields >> std::ws, name);
+        counts[name].first += taken;
+        counts[name].second += not_taken;
+    }
+
+    ApplyBranchProfile apply(counts);
+    s = apply.mutate(s);
+    debug(1) << "Applied the profile of " << apply.applied << " of " << counts.size()
+             << " branches of pipeline " << pipeline_name << "\n";
+    return s;
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -33,10 +33,28 @@ namespace Internal {
  * high-resolution timing into the generated code (via spawning a
  * thread that acts as a sampling profiler); summaries of execution
  * times and counts will be logged at the end. Should be done before
- * storage flattening, but after all bounds inference.
- *
+ * storage flattening, but after all bounds inference. If by_thread
+ * is set, the current Func of each thread is also tracked, so that
+ * per-thread hardware performance counters can be billed to it. If
+ * roofline is set, the arithmetic operations and bytes loaded and
+ * stored by each Func are counted, and reported as achieved rates
+ * against the machine's peak arithmetic rate and bandwidth. If
+ * count_branches is set, the number of times each branch of each if
+ * statement on the host goes each way is counted, for use by
+ * apply_branch_profile in later compiles.
  */
-Stmt inject_profiling(Stmt, std::string);
+Stmt inject_profiling(Stmt, std::string, bool by_thread = false, bool roofline = false,
+                      bool count_branches = false);
+
+/** Annotate the if statements on the host with how often they went
+ * each way in the profile written by a build of the same pipeline
+ * with the profile_branches feature (see
+ * halide_profiler_write_profile), so that the branches are laid out
+ * for the common case. Must be done at the same point in lowering as
+ * inject_profiling, so that the branches are numbered in the same
+ * way. Branches whose condition has changed since the profile was
+ * taken are left alone. */
+Stmt apply_branch_profile(Stmt, const std::string &pipeline_name, const std::string &filename);
 
 }  // namespace Internal
 }  // namespace Halide
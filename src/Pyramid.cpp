@@ -0,0 +1,128 @@
+#include "Pyramid.h"
+#include "BoundaryConditions.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+namespace Pyramid {
+
+namespace {
+
+// The share of the bounds of level zero covered by a coarser level.
+std::vector<std::pair<Expr, Expr>> level_bounds(const std::vector<std::pair<Expr, Expr>> &bounds,
+                                                int level) {
+    std::vector<std::pair<Expr, Expr>> result;
+    for (const auto &b : bounds) {
+        Expr min = b.first / (1 << level);
+        Expr max = (b.first + b.second - 1) / (1 << level);
+        result.push_back({min, max - min + 1});
+    }
+    return result;
+}
+
+}  // namespace
+
+Func downsample(const Func &f) {
+    using Halide::_;
+    Var x("x"), y("y");
+    Func downx("downx"), downy("downsampled");
+    downx(x, y, _) = (f(2*x-1, y, _) + 3.0f * (f(2*x, y, _) + f(2*x+1, y, _)) + f(2*x+2, y, _)) / 8.0f;
+    downy(x, y, _) = (downx(x, 2*y-1, _) + 3.0f * (downx(x, 2*y, _) + downx(x, 2*y+1, _)) + downx(x, 2*y+2, _)) / 8.0f;
+    return downy;
+}
+
+Func upsample(const Func &f) {
+    using Halide::_;
+    Var x("x"), y("y");
+    Func upx("upx"), upy("upsampled");
+    upx(x, y, _) = 0.25f * f((x/2) - 1 + 2*(x % 2), y, _) + 0.75f * f(x/2, y, _);
+    upy(x, y, _) = 0.25f * upx(x, (y/2) - 1 + 2*(y % 2), _) + 0.75f * upx(x, y/2, _);
+    return upy;
+}
+
+std::vector<Func> gaussian_pyramid(const Func &input, int levels) {
+    return gaussian_pyramid(input, levels, {});
+}
+
+std::vector<Func> gaussian_pyramid(const Func &input, int levels,
+                                   const std::vector<std::pair<Expr, Expr>> &bounds) {
+    user_assert(levels >= 1)
+        << "A pyramid needs at least one level, not " << levels << "\n";
+    user_assert(bounds.empty() || bounds.size() == 2)
+        << "gaussian_pyramid takes bounds for the first two dimensions only\n";
+
+    std::vector<Func> pyramid(levels);
+    pyramid[0] = bounds.empty() ? input : BoundaryConditions::repeat_edge(input, bounds);
+    for (int l = 1; l < levels; l++) {
+        Func prev = pyramid[l - 1];
+        if (!bounds.empty() && l > 1) {
+            prev = BoundaryConditions::repeat_edge(prev, level_bounds(bounds, l - 1));
+        }
+        pyramid[l] = downsample(prev);
+    }
+    return pyramid;
+}
+
+std::vector<Func> laplacian_pyramid(const std::vector<Func> &gaussian) {
+    using Halide::_;
+    user_assert(!gaussian.empty()) << "laplacian_pyramid called with an empty pyramid\n";
+
+    const int levels = (int)gaussian.size();
+    std::vector<Func> pyramid(levels);
+    pyramid[levels - 1] = gaussian[levels - 1];
+    for (int l = levels - 2; l >= 0; l--) {
+        Func up = upsample(gaussian[l + 1]);
+        pyramid[l] = Func("laplacian");
+        pyramid[l](_) = gaussian[l](_) - up(_);
+    }
+    return pyramid;
+}
+
+Func collapse_pyramid(const std::vector<Func> &laplacian,
+                      std::vector<Func> *collapsed_levels) {
+    using Halide::_;
+    user_assert(!laplacian.empty()) << "collapse_pyramid called with an empty pyramid\n";
+
+    const int levels = (int)laplacian.size();
+    std::vector<Func> collapsed(levels);
+    collapsed[levels - 1] = laplacian[levels - 1];
+    for (int l = levels - 2; l >= 0; l--) {
+        Func up = upsample(collapsed[l + 1]);
+        collapsed[l] = Func("collapsed");
+        collapsed[l](_) = up(_) + laplacian[l](_);
+    }
+    if (collapsed_levels) {
+        *collapsed_levels = collapsed;
+    }
+    return collapsed[0];
+}
+
+void schedule_levels(const std::vector<Func> &levels, const Target &target,
+                     int parallel_levels) {
+    for (size_t l = 1; l < levels.size(); l++) {
+        Func f = levels[l];
+        std::vector<Var> args = f.args();
+        user_assert(args.size() >= 2)
+            << "Pyramid level " << f.name() << " has fewer than two dimensions\n";
+        Var x = args[0], y = args[1];
+        Var xi("xi"), yi("yi"), yo("yo");
+
+        if (target.has_gpu_feature()) {
+            const int block_w = l > 3 ? 2 : 16;
+            const int block_h = l > 3 ? 2 : 8;
+            f.compute_root().gpu_tile(x, y, xi, yi, block_w, block_h);
+        } else {
+            const int vector_size = target.natural_vector_size(f.output_types()[0]);
+            f.compute_root();
+            if ((int)l < parallel_levels) {
+                f.split(y, yo, yi, 8).parallel(yo).vectorize(x, vector_size);
+            } else {
+                f.vectorize(x, vector_size, TailStrategy::GuardWithIf);
+            }
+        }
+    }
+}
+
+}  // namespace Pyramid
+
+}  // namespace Halide
@@ -0,0 +1,83 @@
+#ifndef HALIDE_PYRAMID_H
+#define HALIDE_PYRAMID_H
+
+/** \file
+ * Helpers for building and scheduling multi-scale image pyramids.
+ */
+
+#include <utility>
+#include <vector>
+
+#include "Func.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** namespace to hold functions that build and schedule Gaussian and
+ *  Laplacian pyramids.
+ *
+ *  All of these operate on the first two dimensions of a Func (x and
+ *  y). Any further dimensions (e.g. color channels) pass through
+ *  unchanged. A pyramid is a std::vector of Funcs, with the full
+ *  resolution level first.
+ */
+namespace Pyramid {
+
+/** Downsample a Func by a factor of two with a separable 1 3 3 1
+ *  filter. */
+Func downsample(const Func &f);
+
+/** Upsample a Func by a factor of two with bilinear interpolation. */
+Func upsample(const Func &f);
+
+/** Build a Gaussian pyramid with the given number of levels. Level
+ *  zero is the input itself.
+ *
+ *  If bounds are given for the first two dimensions of the input,
+ *  level zero imposes a repeat_edge boundary condition over them, and
+ *  each coarser level reads the level above it through a boundary
+ *  condition over that level's share of the bounds. This keeps the
+ *  footprint of the coarse levels from growing off the edge of the
+ *  image. */
+// @{
+std::vector<Func> gaussian_pyramid(const Func &input, int levels);
+std::vector<Func> gaussian_pyramid(const Func &input, int levels,
+                                   const std::vector<std::pair<Expr, Expr>> &bounds);
+// @}
+
+/** Build the Laplacian pyramid of a Gaussian pyramid. Each level is
+ *  the difference between a level of the Gaussian pyramid and the
+ *  upsampled level below it, except for the coarsest, which is the
+ *  coarsest Gaussian level. */
+std::vector<Func> laplacian_pyramid(const std::vector<Func> &gaussian);
+
+/** Collapse a Laplacian pyramid into a full resolution Func, by
+ *  repeatedly upsampling and adding the next finer level. The
+ *  intermediate levels of the collapse are returned in
+ *  collapsed_levels, if it is not null, so that they can be
+ *  scheduled. */
+Func collapse_pyramid(const std::vector<Func> &laplacian,
+                      std::vector<Func> *collapsed_levels = nullptr);
+
+/** Schedule the levels of a pyramid as compute_root stages, skipping
+ *  level zero (which is usually best left inlined into its
+ *  consumers).
+ *
+ *  On CPUs, levels finer than parallel_levels are computed in
+ *  parallel strips of rows and vectorized. The remaining coarse
+ *  levels are small, so they are computed serially and vectorized,
+ *  which avoids paying a thread pool fork and join per level that
+ *  would cost more than the level itself. The buffers of the
+ *  compute_root levels share storage where their lifetimes do not
+ *  overlap.
+ *
+ *  On GPUs, each level is a kernel of its own, with the block size
+ *  shrinking for the coarse levels. */
+void schedule_levels(const std::vector<Func> &levels, const Target &target,
+                     int parallel_levels = 4);
+
+}  // namespace Pyramid
+
+}  // namespace Halide
+
+#endif
@@ -108,20 +108,69 @@ std::pair<string, string> print_type(const LoweredArgument* arg) {
 void PythonExtensionGen::convert_buffer(string name, const LoweredArgument* arg) {
     assert(arg->is_buffer());
     assert(arg->dimensions);
-    dest << "    halide_buffer_t buffer_" << name << ";\n";
-    dest << "    halide_dimension_t dimensions_" << name << "[" << (int)arg->dimensions << "];\n";
     dest << "    if (_convert_py_buffer_to_halide(";
-    dest << /*pyobj*/ "py_" << name << ", ";
+    dest << /*pyobj*/ "o, ";
     dest << /*dimensions*/ (int)arg->dimensions << ", ";
     dest << /*flags*/ (arg->is_output() ? "PyBUF_WRITABLE" : "0") << ", ";
-    dest << /*dim*/ "dimensions_" << name << ", ";
-    dest << /*out*/ "&buffer_" << name << ", ";
+    dest << /*buf*/ "&a->view_" << name << ", ";
+    dest << /*dim*/ "a->dimensions_" << name << ", ";
+    dest << /*out*/ "&a->buffer_" << name << ", ";
     dest << /*name*/ "\"" << name << "\"";
     dest << ") < 0) {\n";
-    dest << "        return NULL;\n";
+    dest << "        return -1;\n";
     dest << "    }\n";
 }
 
+void PythonExtensionGen::convert_scalar(string name, const LoweredArgument* arg) {
+    const string ctype = print_type(arg).second;
+    auto check_range = [&](const string &out_of_range) {
+        dest << "        if (" << out_of_range << ") {\n";
+        dest << "            PyErr_Format(PyExc_OverflowError, \"Argument " << name << " out of range\");\n";
+        dest << "            return -1;\n";
+        dest << "        }\n";
+    };
+    if (arg->type.is_handle()) {
+        dest << "    a->py_" << name << " = o;\n";
+    } else if (arg->type.is_float()) {
+        dest << "    a->py_" << name << " = (" << ctype << ")PyFloat_AsDouble(o);\n";
+        dest << "    if (a->py_" << name << " == -1 && PyErr_Occurred()) {\n";
+        dest << "        return -1;\n";
+        dest << "    }\n";
+    } else if (arg->type.bits() == 1) {
+        dest << "    {\n";
+        dest << "        int v = PyObject_IsTrue(o);\n";
+        dest << "        if (v < 0) {\n";
+        dest << "            return -1;\n";
+        dest << "        }\n";
+        dest << "        a->py_" << name << " = v;\n";
+        dest << "    }\n";
+    } else if (arg->type.is_int()) {
+        dest << "    {\n";
+        dest << "        long long v = PyLong_AsLongLong(o);\n";
+        dest << "        if (v == -1 && PyErr_Occurred()) {\n";
+        dest << "            return -1;\n";
+        dest << "        }\n";
+        if (arg->type.bits() < 64) {
+            const int64_t max = (((int64_t)1) << (arg->type.bits() - 1)) - 1;
+            check_range("v < " + std::to_string(-max - 1) + "LL || v > " + std::to_string(max) + "LL");
+        }
+        dest << "        a->py_" << name << " = (" << ctype << ")v;\n";
+        dest << "    }\n";
+    } else {
+        dest << "    {\n";
+        dest << "        unsigned long long v = PyLong_AsUnsignedLongLong(o);\n";
+        dest << "        if (v == (unsigned long long)-1 && PyErr_Occurred()) {\n";
+        dest << "            return -1;\n";
+        dest << "        }\n";
+        if (arg->type.bits() < 64) {
+            const uint64_t max = (((uint64_t)1) << arg->type.bits()) - 1;
+            check_range("v > " + std::to_string(max) + "ULL");
+        }
+        dest << "        a->py_" << name << " = (" << ctype << ")v;\n";
+        dest << "    }\n";
+    }
+}
+
 PythonExtensionGen::PythonExtensionGen(std::ostream &dest, const std::string &header_name, Target target)
     : dest(dest), header_name(header_name), target(target) {
 }
@@ -147,14 +196,16 @@ extern "C" {
 
 static __attribute__((unused)) int _convert_py_buffer_to_halide(
         PyObject* pyobj, int dimensions, int flags,
+        Py_buffer* view,  // the caller releases it if view->obj is set
         halide_dimension_t* dim,  // array of size `dimensions`
         halide_buffer_t* out, const char* name) {
-    Py_buffer buf;
     int ret = PyObject_GetBuffer(
-      pyobj, &buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | flags);
+      pyobj, view, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | flags);
     if (ret < 0) {
+      view->obj = NULL;
       return ret;
     }
+    Py_buffer buf = *view;
     if (dimensions && buf.ndim != dimensions) {
       PyErr_Format(PyExc_ValueError, "Invalid argument %s: Expected %d dimensions, got %d",
                    name, dimensions, buf.ndim);
@@ -235,6 +286,74 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
     return 0;
 }
 
+#if PY_VERSION_HEX >= 0x03070000
+/* Python 3.7 and up can pass the arguments of a call in a C array, with
+ * the names of any keyword arguments in a tuple, which saves building
+ * an argument tuple and dict on every call. */
+#define _HALIDE_CALL_FLAGS (METH_FASTCALL | METH_KEYWORDS)
+#define _HALIDE_CALL_PARAMS PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+#define _HALIDE_CALL_ARGS args, nargs, kwnames
+#else
+#define _HALIDE_CALL_FLAGS (METH_VARARGS | METH_KEYWORDS)
+#define _HALIDE_CALL_PARAMS PyObject* args, PyObject* kwargs
+#define _HALIDE_CALL_ARGS args, kwargs
+#endif
+
+/* Put the arguments of a call to fname, given by position or keyword,
+ * into objs in the order of kwlist. The references are borrowed. */
+static __attribute__((unused)) int _gather_args(
+        const char* fname, const char* const* kwlist, int n,
+        PyObject** objs, _HALIDE_CALL_PARAMS) {
+    int i;
+#if PY_VERSION_HEX >= 0x03070000
+    Py_ssize_t k, nkw = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+#else
+    Py_ssize_t nargs = PyTuple_GET_SIZE(args), found = 0;
+#endif
+    if (nargs > n) {
+        PyErr_Format(PyExc_TypeError, "%s() takes %d arguments (%d given)",
+                     fname, n, (int)nargs);
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+#if PY_VERSION_HEX >= 0x03070000
+        objs[i] = i < nargs ? args[i] : NULL;
+#else
+        objs[i] = i < nargs ? PyTuple_GET_ITEM(args, i) :
+                  kwargs ? PyDict_GetItemString(kwargs, kwlist[i]) : NULL;
+        found += i >= nargs && objs[i];
+#endif
+    }
+#if PY_VERSION_HEX >= 0x03070000
+    for (k = 0; k < nkw; k++) {
+        PyObject* key = PyTuple_GET_ITEM(kwnames, k);
+        for (i = 0; i < n; i++) {
+            if (PyUnicode_CompareWithASCIIString(key, kwlist[i]) == 0) {
+                break;
+            }
+        }
+        if (i == n || objs[i]) {
+            PyErr_Format(PyExc_TypeError, "%s() got an unexpected or repeated keyword argument '%U'",
+                         fname, key);
+            return -1;
+        }
+        objs[i] = args[nargs + k];
+    }
+#else
+    if (kwargs && found != PyDict_Size(kwargs)) {
+        PyErr_Format(PyExc_TypeError, "%s() got an unexpected or repeated keyword argument", fname);
+        return -1;
+    }
+#endif
+    for (i = 0; i < n; i++) {
+        if (!objs[i]) {
+            PyErr_Format(PyExc_TypeError, "%s() missing argument '%s'", fname, kwlist[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 )INLINE_CODE";
 
     for (auto &f : module.functions()) {
@@ -250,8 +369,10 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
          * twice, once with new and once with old buffers. Ignore the latter. */
         if (!has_legacy_buffers(f)) {
             const string basename = remove_namespaces(f.name);
-            dest << "    {\"" << basename << "\", (PyCFunction)_f_" << basename
-                 << ", METH_VARARGS|METH_KEYWORDS, NULL},\n";
+            dest << "    {\"" << basename << "\", (PyCFunction)(void (*)(void))_f_" << basename
+                 << ", _HALIDE_CALL_FLAGS, NULL},\n";
+            dest << "    {\"" << basename << "_batch\", (PyCFunction)_f_" << basename
+                 << "_batch, METH_VARARGS, NULL},\n";
         }
     }
     dest << "    {0, 0, 0, NULL},  // sentinel\n";
@@ -290,60 +411,110 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
     const string basename = remove_namespaces(f.name);
     std::vector<string> arg_names(args.size());
     dest << "// " << f.name << "\n";
-    dest << "static PyObject* _f_" << basename << "(PyObject* module, PyObject* args, PyObject* kwargs) {\n";
     for (size_t i = 0; i < args.size(); i++) {
         arg_names[i] = sanitize_name(args[i].name);
         if (!can_convert(&args[i])) {
             /* Some arguments can't be converted to Python yet. In those
-             * cases, just add a dummy function that always throws an
+             * cases, just add dummy functions that always throw an
              * Exception. */
             // TODO: Add support for handles and vectors.
-            dest << "    PyErr_Format(PyExc_NotImplementedError, "
-                 << "\"Can't convert argument " << args[i].name << " from Python\");\n";
-            dest << "    return NULL;\n";
-            dest << "}";
+            for (const char *suffix : {"", "_batch"}) {
+                dest << "static PyObject* _f_" << basename << suffix << "(PyObject* module, "
+                     << (*suffix ? "PyObject* args" : "_HALIDE_CALL_PARAMS") << ") {\n";
+                dest << "    PyErr_Format(PyExc_NotImplementedError, "
+                     << "\"Can't convert argument " << args[i].name << " from Python\");\n";
+                dest << "    return NULL;\n";
+                dest << "}\n";
+            }
             return;
         }
     }
-    dest << "    static const char* kwlist[] = {";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << "\"" << arg_names[i] << "\", ";
-    }
-    dest << "NULL};\n";
+    const string n = std::to_string(args.size());
+    // Arrays of size n, which C doesn't allow to be empty.
+    const string array_size = args.empty() ? "1" : n;
+
+    // Everything one call needs, so that a batch of calls can be
+    // converted up front and then run without the GIL.
+    dest << "typedef struct {\n";
     for (size_t i = 0; i < args.size(); i++) {
-        dest << "    " << print_type(&args[i]).second << " py_" << arg_names[i] << ";\n";
+        const string &name = arg_names[i];
+        if (args[i].is_buffer()) {
+            dest << "    Py_buffer view_" << name << ";\n";
+            dest << "    halide_buffer_t buffer_" << name << ";\n";
+            dest << "    halide_dimension_t dimensions_" << name << "[" << (int)args[i].dimensions << "];\n";
+        } else {
+            dest << "    " << print_type(&args[i]).second << " py_" << name << ";\n";
+        }
     }
-    dest << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << print_type(&args[i]).first;
+    if (args.empty()) {
+        dest << "    int unused;\n";
     }
-    dest << "\", (char**)kwlist";
+    dest << "} _args_" << basename << ";\n\n";
+
+    dest << "static const char* _kwlist_" << basename << "[] = {";
     for (size_t i = 0; i < args.size(); i++) {
-        dest << ", ";
-        dest << "&py_" << arg_names[i];
+        dest << "\"" << arg_names[i] << "\", ";
     }
-    dest << ")) {\n";
-    dest << "        return NULL;\n";
-    dest << "    }\n";
+    dest << "NULL};\n\n";
+
+    dest << "static int _parse_" << basename << "(PyObject** objs, _args_" << basename << "* a) {\n";
+    dest << "    PyObject* o;\n";
+    dest << "    memset(a, 0, sizeof(*a));\n";
     for (size_t i = 0; i < args.size(); i++) {
+        dest << "    o = objs[" << i << "];\n";
         if (args[i].is_buffer()) {
             convert_buffer(arg_names[i], &args[i]);
         } else {
-            // Python already converted this.
+            convert_scalar(arg_names[i], &args[i]);
         }
     }
-    dest << "    int result = " << f.name << "(";
+    dest << "    return 0;\n";
+    dest << "}\n\n";
+
+    dest << "static void _release_" << basename << "(_args_" << basename << "* a) {\n";
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].is_buffer()) {
+            dest << "    if (a->view_" << arg_names[i] << ".obj) {\n";
+            dest << "        PyBuffer_Release(&a->view_" << arg_names[i] << ");\n";
+            dest << "    }\n";
+        }
+    }
+    dest << "}\n\n";
+
+    dest << "static int _run_" << basename << "(void* user_context, int i, uint8_t* closure) {\n";
+    dest << "    _args_" << basename << "* a = (_args_" << basename << "*)closure + i;\n";
+    dest << "    return " << f.name << "(";
     for (size_t i = 0; i < args.size(); i++) {
         if (i > 0) {
             dest << ", ";
         }
         if (args[i].is_buffer()) {
-            dest << "&buffer_" << arg_names[i];
+            dest << "&a->buffer_" << arg_names[i];
         } else {
-            dest << "py_" << arg_names[i];
+            dest << "a->py_" << arg_names[i];
         }
     }
-    dest << ");";
+    dest << ");\n";
+    dest << "}\n\n";
+
+    // Release the GIL while the pipeline runs, so that other Python
+    // threads can run too.
+    dest << "static PyObject* _f_" << basename << "(PyObject* module, _HALIDE_CALL_PARAMS) {\n";
+    dest << "    PyObject* objs[" << array_size << "];\n";
+    dest << "    _args_" << basename << " a;\n";
+    dest << "    int result;\n";
+    dest << "    if (_gather_args(\"" << basename << "\", _kwlist_" << basename << ", " << n
+         << ", objs, _HALIDE_CALL_ARGS) < 0) {\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    if (_parse_" << basename << "(objs, &a) < 0) {\n";
+    dest << "        _release_" << basename << "(&a);\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    Py_BEGIN_ALLOW_THREADS\n";
+    dest << "    result = _run_" << basename << "(NULL, 0, (uint8_t*)&a);\n";
+    dest << "    Py_END_ALLOW_THREADS\n";
+    dest << "    _release_" << basename << "(&a);";
     dest << R"INLINE_CODE(
     if (result != 0) {
         /* In the optimal case, we'd be generating an exception declared
@@ -355,6 +526,91 @@ void PythonExtensionGen::compile(const LoweredFunc &f) {
     Py_INCREF(Py_True);
     return Py_True;
 )INLINE_CODE";
+    dest << "}\n\n";
+
+    /* The batched entry point takes, for each argument, a sequence of
+     * the values for each call (a list, or an array stacked along its
+     * first dimension). A scalar argument may be given once for all
+     * the calls instead. The calls run in parallel on the Halide
+     * thread pool. */
+    dest << "static PyObject* _f_" << basename << "_batch(PyObject* module, PyObject* args) {\n";
+    dest << "    PyObject* columns[" << array_size << "] = {NULL};\n";
+    dest << "    PyObject* objs[" << array_size << "];\n";
+    dest << "    _args_" << basename << "* a = NULL;\n";
+    dest << "    PyObject* ret = NULL;\n";
+    dest << "    Py_ssize_t count = -1, i;\n";
+    dest << "    int j, result;\n";
+    dest << "    if (PyTuple_GET_SIZE(args) != " << n << ") {\n";
+    dest << "        PyErr_Format(PyExc_TypeError, \"" << basename << "_batch() takes " << n
+         << " arguments (%d given)\", (int)PyTuple_GET_SIZE(args));\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    for (size_t i = 0; i < args.size(); i++) {
+        const string item = "PyTuple_GET_ITEM(args, " + std::to_string(i) + ")";
+        const string fast = "columns[" + std::to_string(i) + "] = PySequence_Fast(" + item +
+                            ", \"Argument " + arg_names[i] + " of " + basename + "_batch() must be a sequence\");\n";
+        if (args[i].is_buffer()) {
+            dest << "    " << fast;
+        } else if (args[i].type.is_handle()) {
+            // The user context is shared by all the calls.
+            continue;
+        } else {
+            dest << "    if (PySequence_Check(" << item << ")) {\n";
+            dest << "        " << fast;
+            dest << "    }\n";
+        }
+        dest << "    if (PyErr_Occurred()) {\n";
+        dest << "        goto done;\n";
+        dest << "    }\n";
+    }
+    dest << "    for (j = 0; j < " << n << "; j++) {\n";
+    dest << "        if (!columns[j]) {\n";
+    dest << "            continue;\n";
+    dest << "        }\n";
+    dest << "        if (count >= 0 && PySequence_Fast_GET_SIZE(columns[j]) != count) {\n";
+    dest << "            PyErr_Format(PyExc_ValueError, \"The arguments of " << basename
+         << "_batch() must all be sequences of the same length\");\n";
+    dest << "            goto done;\n";
+    dest << "        }\n";
+    dest << "        count = PySequence_Fast_GET_SIZE(columns[j]);\n";
+    dest << "    }\n";
+    dest << "    if (count < 0) {\n";
+    dest << "        PyErr_Format(PyExc_TypeError, \"" << basename
+         << "_batch() needs at least one argument that is a sequence\");\n";
+    dest << "        goto done;\n";
+    dest << "    }\n";
+    dest << "    a = (_args_" << basename << "*)PyMem_Malloc((count ? count : 1) * sizeof(*a));\n";
+    dest << "    if (!a) {\n";
+    dest << "        PyErr_NoMemory();\n";
+    dest << "        goto done;\n";
+    dest << "    }\n";
+    dest << "    memset(a, 0, count * sizeof(*a));\n";
+    dest << "    for (i = 0; i < count; i++) {\n";
+    dest << "        for (j = 0; j < " << n << "; j++) {\n";
+    dest << "            objs[j] = columns[j] ? PySequence_Fast_GET_ITEM(columns[j], i) : PyTuple_GET_ITEM(args, j);\n";
+    dest << "        }\n";
+    dest << "        if (_parse_" << basename << "(objs, &a[i]) < 0) {\n";
+    dest << "            goto done;\n";
+    dest << "        }\n";
+    dest << "    }\n";
+    dest << "    Py_BEGIN_ALLOW_THREADS\n";
+    dest << "    result = halide_do_par_for(NULL, _run_" << basename << ", 0, (int)count, (uint8_t*)a);\n";
+    dest << "    Py_END_ALLOW_THREADS\n";
+    dest << "    if (result != 0) {\n";
+    dest << "        PyErr_Format(PyExc_ValueError, \"Halide error %d\", result);\n";
+    dest << "        goto done;\n";
+    dest << "    }\n";
+    dest << "    Py_INCREF(Py_True);\n";
+    dest << "    ret = Py_True;\n";
+    dest << "done:\n";
+    dest << "    for (i = 0; a && i < count; i++) {\n";
+    dest << "        _release_" << basename << "(&a[i]);\n";
+    dest << "    }\n";
+    dest << "    PyMem_Free(a);\n";
+    dest << "    for (j = 0; j < " << n << "; j++) {\n";
+    dest << "        Py_XDECREF(columns[j]);\n";
+    dest << "    }\n";
+    dest << "    return ret;\n";
     dest << "}\n";
 }
 
@@ -20,6 +20,7 @@ public:
     void compile(const LoweredFunc &f);
 private:
     void convert_buffer(std::string name, const LoweredArgument* arg);
+    void convert_scalar(std::string name, const LoweredArgument* arg);
     std::ostream &dest;
     std::string header_name;
     Target target;
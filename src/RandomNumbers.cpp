@@ -0,0 +1,209 @@
+#include "RandomNumbers.h"
+#include "IROperator.h"
+
+namespace Halide {
+
+namespace RandomNumbers {
+
+using namespace Halide::Internal;
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The multipliers and Weyl sequence increments of Philox4x32.
+const uint32_t philox_m0 = 0xD2511F53;
+const uint32_t philox_m1 = 0xCD9E8D57;
+const uint32_t philox_w0 = 0x9E3779B9;
+const uint32_t philox_w1 = 0xBB67AE85;
+
+// The second word of the key. The first is the seed.
+const uint32_t key_word = 0x5BD1E995;
+
+// The largest lambda for which Poisson samples are drawn by inversion.
+const float max_inversion_lambda = 10.0f;
+// The number of steps of the inversion. The chance of a sample
+// larger than this when lambda is 10 is about 1e-7.
+const int inversion_steps = 32;
+
+// A chain of lets. Each round of Philox refers to the words of the
+// previous one several times, and so does each step of the Poisson
+// inversion to the previous step, so without the lets the
+// expressions would blow up.
+class LetChain {
+    vector<pair<string, Expr>> lets;
+
+public:
+    Expr bind(const string &name, Expr value) {
+        lets.push_back({name, value});
+        return Variable::make(value.type(), name);
+    }
+
+    Expr wrap(Expr e) const {
+        for (size_t i = lets.size(); i > 0; i--) {
+            e = Let::make(lets[i - 1].first, lets[i - 1].second, e);
+        }
+        return e;
+    }
+};
+
+Expr to_uint32(Expr e, const char *what) {
+    user_assert(e.defined() && e.type().is_scalar() &&
+                (e.type().is_int() || e.type().is_uint()) && e.type().bits() <= 32)
+        << "The " << what << " of a random number must be a scalar integer "
+        << "of at most 32 bits: " << e << "\n";
+    return cast(UInt(32), e);
+}
+
+vector<Expr> philox_words(LetChain &lets, const vector<Expr> &counter,
+                          const vector<Expr> &key, int rounds) {
+    user_assert(counter.size() == 4) << "philox4x32 takes a counter of four words\n";
+    user_assert(key.size() == 2) << "philox4x32 takes a key of two words\n";
+    user_assert(rounds > 0) << "philox4x32 needs at least one round\n";
+
+    vector<Expr> c(4);
+    for (int i = 0; i < 4; i++) {
+        c[i] = to_uint32(counter[i], "counter");
+    }
+    Expr k0 = to_uint32(key[0], "key");
+    Expr k1 = to_uint32(key[1], "key");
+
+    const string prefix = unique_name("philox");
+    for (int r = 0; r < rounds; r++) {
+        const string round = prefix + ".round" + std::to_string(r);
+        // The only thing in a round that needs 64 bits is the
+        // products. Taking the high half of one is the widening
+        // multiply pattern that the backends turn into a 32-bit
+        // multiply-high of a whole vector.
+        Expr p0 = lets.bind(round + ".p0", cast(UInt(64), c[0]) * make_const(UInt(64), philox_m0));
+        Expr p1 = lets.bind(round + ".p1", cast(UInt(64), c[2]) * make_const(UInt(64), philox_m1));
+        Expr hi0 = cast(UInt(32), p0 >> 32), lo0 = cast(UInt(32), p0);
+        Expr hi1 = cast(UInt(32), p1 >> 32), lo1 = cast(UInt(32), p1);
+        // The key is bumped by a Weyl sequence between rounds.
+        Expr rk0 = k0 + make_const(UInt(32), (uint32_t)(philox_w0 * (uint32_t)r));
+        Expr rk1 = k1 + make_const(UInt(32), (uint32_t)(philox_w1 * (uint32_t)r));
+        vector<Expr> next = {hi1 ^ c[1] ^ rk0, lo1, hi0 ^ c[3] ^ rk1, lo0};
+        for (int i = 0; i < 4; i++) {
+            c[i] = lets.bind(round + ".c" + std::to_string(i), next[i]);
+        }
+    }
+    return c;
+}
+
+// The random words for a site of a Func.
+vector<Expr> site_words(LetChain &lets, const vector<Expr> &coords, Expr seed, int stream) {
+    user_assert(coords.size() <= 3)
+        << "Random numbers can depend on at most three coordinates, but "
+        << coords.size() << " were given\n";
+    vector<Expr> counter(coords);
+    while (counter.size() < 3) {
+        counter.push_back(0);
+    }
+    counter.push_back(make_const(UInt(32), (uint32_t)stream));
+    return philox_words(lets, counter, {seed, make_const(UInt(32), key_word)}, 10);
+}
+
+// A float in [0, 1) made from the top 24 bits of a word, so that
+// every value is exactly representable.
+Expr unit_float(Expr word) {
+    return cast(Float(32), word >> 8) * (1.0f / (1 << 24));
+}
+
+// A standard normal sample from two words, by the Box-Muller transform.
+Expr box_muller(Expr w0, Expr w1) {
+    // In (0, 1], so that the log is finite.
+    Expr u1 = cast(Float(32), (w0 >> 8) + 1) * (1.0f / (1 << 24));
+    Expr u2 = unit_float(w1);
+    return sqrt(-2.0f * fast_log(u1)) * fast_cos(u2 * 6.28318530718f);
+}
+
+}  // namespace
+
+vector<Expr> philox4x32(const vector<Expr> &counter, const vector<Expr> &key, int rounds) {
+    LetChain lets;
+    vector<Expr> words = philox_words(lets, counter, key, rounds);
+    for (Expr &w : words) {
+        w = lets.wrap(w);
+    }
+    return words;
+}
+
+Expr uniform(const vector<Expr> &coords, Expr seed, int stream) {
+    LetChain lets;
+    vector<Expr> words = site_words(lets, coords, seed, stream);
+    return lets.wrap(unit_float(words[0]));
+}
+
+Expr normal(const vector<Expr> &coords, Expr seed, int stream) {
+    LetChain lets;
+    vector<Expr> words = site_words(lets, coords, seed, stream);
+    return lets.wrap(box_muller(words[0], words[1]));
+}
+
+Expr poisson(const vector<Expr> &coords, Expr lambda, Expr seed, int stream) {
+    user_assert(lambda.defined() && lambda.type().is_scalar())
+        << "The lambda of a Poisson distribution must be a scalar\n";
+    LetChain lets;
+    vector<Expr> words = site_words(lets, coords, seed, stream);
+    const string prefix = unique_name("poisson");
+    Expr lam = lets.bind(prefix + ".lambda", cast(Float(32), lambda));
+
+    // Small lambdas: count how many terms of the cumulative
+    // distribution the uniform sample exceeds. Every lane takes the
+    // same number of steps, so this vectorizes.
+    Expr small_lam = lets.bind(prefix + ".small_lambda", min(lam, max_inversion_lambda));
+    Expr u = lets.bind(prefix + ".u", unit_float(words[2]));
+    Expr p = lets.bind(prefix + ".p0", fast_exp(-small_lam));
+    Expr cdf = p;
+    Expr count = 0;
+    for (int i = 1; i <= inversion_steps; i++) {
+        const string step = prefix + ".step" + std::to_string(i);
+        count = lets.bind(step + ".count", count + select(u > cdf, 1, 0));
+        p = lets.bind(step + ".p", p * small_lam * (1.0f / i));
+        cdf = lets.bind(step + ".cdf", cdf + p);
+    }
+
+    // Large lambdas: the normal approximation.
+    Expr z = box_muller(words[0], words[1]);
+    Expr approx = max(0, cast(Int(32), floor(lam + sqrt(lam) * z + 0.5f)));
+
+    return lets.wrap(select(lam <= max_inversion_lambda, count, approx));
+}
+
+Func uniform(int dimensions, Expr seed, int stream) {
+    user_assert(dimensions >= 0 && dimensions <= 3)
+        << "Random Funcs can have at most three dimensions\n";
+    vector<Var> args = {Var("x"), Var("y"), Var("z")};
+    args.resize(dimensions);
+    vector<Expr> coords(args.begin(), args.end());
+    Func f("uniform");
+    f(args) = uniform(coords, seed, stream);
+    return f;
+}
+
+Func normal(int dimensions, Expr seed, Expr mean, Expr stddev, int stream) {
+    user_assert(dimensions >= 0 && dimensions <= 3)
+        << "Random Funcs can have at most three dimensions\n";
+    vector<Var> args = {Var("x"), Var("y"), Var("z")};
+    args.resize(dimensions);
+    vector<Expr> coords(args.begin(), args.end());
+    Func f("normal");
+    f(args) = cast(Float(32), mean) + cast(Float(32), stddev) * normal(coords, seed, stream);
+    return f;
+}
+
+Func poisson(const Func &lambda, Expr seed, int stream) {
+    user_assert(lambda.defined() && lambda.outputs() == 1)
+        << "The lambda of a Poisson distribution must be a Func with a single output\n";
+    vector<Var> args = lambda.args();
+    vector<Expr> coords(args.begin(), args.end());
+    Func f("poisson");
+    f(args) = poisson(coords, lambda(args), seed, stream);
+    return f;
+}
+
+}  // namespace RandomNumbers
+
+}  // namespace Halide
@@ -0,0 +1,75 @@
+#ifndef HALIDE_RANDOM_NUMBERS_H
+#define HALIDE_RANDOM_NUMBERS_H
+
+/** \file
+ * Counter-based random number generation that vectorizes cleanly.
+ */
+
+#include <vector>
+
+#include "Func.h"
+#include "IR.h"
+
+namespace Halide {
+
+/** namespace to hold functions for generating random numbers inside
+ *  Halide pipelines.
+ *
+ *  These are built on the Philox4x32 counter-based generator of
+ *  Salmon et al. ("Parallel Random Numbers: As Easy as 1, 2, 3",
+ *  SC'11). A counter-based generator is a pure function of a counter
+ *  and a key, so the random numbers at each site of a Func are fully
+ *  determined by its coordinates, a seed, and a stream number, no
+ *  matter how the Func is scheduled. Each round of Philox is two
+ *  32-bit multiplies that keep both halves of the product, which
+ *  every backend can do a whole vector at a time (pmuludq on x86,
+ *  umull on ARM, mul.hi on PTX), so unlike Halide::random_float these
+ *  vectorize well everywhere, including on GPUs.
+ *
+ *  Coordinates and seeds are Int(32). At most three coordinates can
+ *  be given; the stream selects one of 2^32 independent sequences
+ *  over the same coordinates.
+ */
+namespace RandomNumbers {
+
+/** The Philox4x32 generator. Maps a counter of four UInt(32) words
+ * and a key of two UInt(32) words to four UInt(32) random words. Ten
+ * rounds is the standard strength, and passes BigCrush. Fewer rounds
+ * are faster; seven is the fewest the authors found to be crush
+ * resistant. */
+std::vector<Expr> philox4x32(const std::vector<Expr> &counter,
+                             const std::vector<Expr> &key,
+                             int rounds = 10);
+
+/** A Float(32) drawn uniformly from [0, 1) at the given coordinates. */
+Expr uniform(const std::vector<Expr> &coords, Expr seed, int stream = 0);
+
+/** A Float(32) drawn from the standard normal distribution at the
+ * given coordinates, using the Box-Muller transform. */
+Expr normal(const std::vector<Expr> &coords, Expr seed, int stream = 0);
+
+/** An Int(32) drawn from the Poisson distribution with mean lambda at
+ * the given coordinates. Lambdas up to 10 are sampled exactly by
+ * inversion, with a fixed number of steps so that it vectorizes
+ * cleanly. Larger ones use the normal approximation, which is within
+ * a few percent of the exact distribution there. */
+Expr poisson(const std::vector<Expr> &coords, Expr lambda, Expr seed, int stream = 0);
+
+/** Funcs of the given number of dimensions (at most three) whose
+ * values are random numbers drawn from a distribution. Different
+ * seeds, or different streams with the same seed, give independent
+ * Funcs. */
+// @{
+Func uniform(int dimensions, Expr seed, int stream = 0);
+Func normal(int dimensions, Expr seed, Expr mean = 0.0f, Expr stddev = 1.0f, int stream = 0);
+// @}
+
+/** A Func of Int(32) samples from the Poisson distribution whose mean
+ * at each site is the value of lambda there. */
+Func poisson(const Func &lambda, Expr seed, int stream = 0);
+
+}  // namespace RandomNumbers
+
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,498 @@
+#include "RedundantWork.h"
+#include "AutoSchedule.h"
+#include "Bounds.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Util.h"
+#include "WrapCalls.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+const Definition &get_stage(const Function &f, int stage) {
+    return stage == 0 ? f.definition() : f.update(stage - 1);
+}
+
+int64_t bytes_per_point(const Function &f) {
+    int64_t bytes = 0;
+    for (const Type &t : f.output_types()) {
+        bytes += t.bytes();
+    }
+    return bytes;
+}
+
+// A loop of a stage of a Func, that other Funcs may be computed at.
+struct Loop {
+    Function func;
+    int stage;
+    string var;
+
+    string name() const {
+        return func.name() + ".s" + std::to_string(stage) + "." + var;
+    }
+};
+
+// Find the loop a LoopLevel refers to.
+bool find_loop(const Function &f, const LoopLevel &level, Loop &loop) {
+    for (int s = 0; s <= (int)f.updates().size(); s++) {
+        for (const Dim &d : get_stage(f, s).schedule().dims()) {
+            if (level.match(f.name() + ".s" + std::to_string(s) + "." + d.var)) {
+                loop = Loop{f, s, d.var};
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// The extent of a pure dimension of a stage that one iteration of a
+// loop of it covers, or undefined if one iteration covers all of
+// it.
+class CoveredExtent {
+    const vector<Split> &splits;
+    const vector<Dim> &dims;
+    size_t loop_index;
+
+public:
+    CoveredExtent(const Definition &def, size_t loop_index) :
+        splits(def.schedule().splits()), dims(def.schedule().dims()), loop_index(loop_index) {}
+
+    Expr operator()(const string &var) const {
+        for (const Split &s : splits) {
+            if (s.is_split() && s.old_var == var) {
+                // If the inner loop doesn't cover all of its range,
+                // the outer one doesn't move.
+                Expr inner = (*this)(s.inner);
+                if (inner.defined()) {
+                    return inner;
+                }
+                Expr outer = (*this)(s.outer);
+                return outer.defined() ? outer * s.factor : Expr();
+            } else if ((s.is_rename() || s.is_purify()) && s.old_var == var) {
+                return (*this)(s.outer);
+            } else if (s.is_fuse() && (s.inner == var || s.outer == var)) {
+                return (*this)(s.old_var).defined() ? make_one(Int(32)) : Expr();
+            }
+        }
+        // The loops inside the loop cover all of their range, and
+        // the ones outside cover one point.
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (dims[i].var == var) {
+                return i < loop_index ? Expr() : make_one(Int(32));
+            }
+        }
+        return Expr();
+    }
+};
+
+bool is_inlined(const Function &f) {
+    return f.schedule().compute_level().is_inlined() && !f.has_extern_definition();
+}
+
+// Add the regions of the Funcs in within that a definition reads
+// while computing the given box of its Func.
+void add_required(const Function &f, const Definition &def, const Box &box,
+                  const set<string> &within, map<string, Box> &regions) {
+    Scope<Interval> scope;
+    const vector<string> &args = f.args();
+    for (size_t i = 0; i < args.size(); i++) {
+        scope.push(args[i], box[i]);
+    }
+    for (const ReductionVariable &rv : def.schedule().rvars()) {
+        scope.push(rv.var, Interval(rv.min, simplify(rv.min + rv.extent - 1)));
+    }
+    vector<Expr> exprs = def.values();
+    exprs.insert(exprs.end(), def.args().begin(), def.args().end());
+    for (const Expr &e : exprs) {
+        for (const auto &b : boxes_required(e, scope)) {
+            if (within.count(b.first)) {
+                merge_boxes(regions[b.first], b.second);
+            }
+        }
+    }
+}
+
+// Order the Funcs of within that a Func reads, so that each comes
+// after all of its consumers.
+void order_producers(const Function &f, const set<string> &within,
+                     set<string> &visited, vector<Function> &order) {
+    for (const auto &p : find_direct_calls(f)) {
+        if (within.count(p.first) && visited.insert(p.first).second) {
+            order_producers(p.second, within, visited, order);
+            order.push_back(p.second);
+        }
+    }
+}
+
+// The number of points in a box, or -1 if it isn't constant.
+int64_t box_points(const Box &box) {
+    int64_t points = 1;
+    for (const Interval &i : box.bounds) {
+        if (!i.is_bounded()) {
+            return -1;
+        }
+        const int64_t *extent = as_const_int(simplify(i.max - i.min + 1));
+        if (!extent) {
+            return -1;
+        }
+        points *= std::max(*extent, (int64_t)0);
+    }
+    return points;
+}
+
+// The work done by one iteration of a loop.
+struct IterationWork {
+    // False if the footprints aren't constant.
+    bool known = false;
+    // The points computed per iteration of each Func computed at or
+    // within the loop.
+    map<string, int64_t> points;
+    // The points computed per iteration that neighboring iterations
+    // compute too.
+    map<string, int64_t> redundant;
+    // The extents of the consumer covered by an iteration.
+    vector<int64_t> tile;
+    // The bytes of the Funcs computed per iteration and of the
+    // consumer's tile, or -1 if the extent of a dimension of the
+    // consumer that isn't split isn't known.
+    int64_t working_set = -1;
+
+    double redundancy() const {
+        int64_t total = 0, redo = 0;
+        for (const auto &p : points) {
+            total += p.second;
+            redo += redundant.at(p.first);
+        }
+        return total > 0 ? (double)redo / total : 0.0;
+    }
+};
+
+IterationWork analyze_loop(const Loop &loop, const map<string, Function> &env,
+                           const map<string, Expr> &sizes) {
+    IterationWork work;
+    const Function &c = loop.func;
+    const Definition &def = get_stage(c, loop.stage);
+    const vector<Dim> &dims = def.schedule().dims();
+    size_t loop_index = 0;
+    while (loop_index < dims.size() && dims[loop_index].var != loop.var) {
+        loop_index++;
+    }
+    if (loop_index == dims.size()) {
+        return work;
+    }
+
+    // The Funcs computed at or within the loop, and the inlined Funcs
+    // that may lie between them.
+    set<string> within;
+    for (const auto &p : env) {
+        const LoopLevel &level = p.second.schedule().compute_level();
+        if (is_inlined(p.second)) {
+            within.insert(p.first);
+        } else if (!level.is_root() && level.func() == c.name()) {
+            for (size_t i = 0; i <= loop_index; i++) {
+                if (level.match(loop.func.name() + ".s" + std::to_string(loop.stage) + "." + dims[i].var)) {
+                    within.insert(p.first);
+                }
+            }
+        }
+    }
+    for (size_t size = 0; size != within.size();) {
+        size = within.size();
+        for (const auto &p : env) {
+            const LoopLevel &level = p.second.schedule().compute_level();
+            if (!level.is_root() && !level.is_inlined() && within.count(level.func())) {
+                within.insert(p.first);
+            }
+        }
+    }
+
+    // The extent of each dimension of the consumer that an iteration
+    // covers. The ones split by the loop, or by loops outside of it,
+    // are tiled.
+    CoveredExtent covered(def, loop_index);
+    const vector<string> &args = c.args();
+    vector<int64_t> extents;
+    vector<size_t> tiled;
+    work.working_set = 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        Expr e = covered(args[i]);
+        if (e.defined()) {
+            const int64_t *extent = as_const_int(simplify(substitute(sizes, e)));
+            if (!extent) {
+                return work;
+            }
+            extents.push_back(*extent);
+            tiled.push_back(i);
+        } else {
+            const int64_t *extent = nullptr;
+            for (const Bound &b : c.schedule().estimates()) {
+                if (b.var == args[i] && b.extent.defined()) {
+                    extent = as_const_int(b.extent);
+                }
+            }
+            // Without an estimate, assume one point. The share of
+            // the work that is redundant doesn't depend on it.
+            extents.push_back(extent ? *extent : 1);
+            if (!extent) {
+                work.working_set = -1;
+            }
+        }
+    }
+    work.tile = extents;
+
+    // Find the footprint of each Func for the tile, and for the tile
+    // with each subset of its tiled dimensions doubled. Counting the
+    // points with alternating signs over the subsets leaves the
+    // points that a tile computes that no neighboring tile does.
+    vector<Function> order;
+    set<string> visited;
+    order_producers(c, within, visited, order);
+    std::reverse(order.begin(), order.end());
+    map<string, int64_t> new_points;
+    for (int subset = 0; subset < (1 << tiled.size()); subset++) {
+        Box box;
+        int sign = 1;
+        for (size_t i = 0; i < extents.size(); i++) {
+            int64_t extent = extents[i];
+            for (size_t j = 0; j < tiled.size(); j++) {
+                if (tiled[j] == i) {
+                    if (subset & (1 << j)) {
+                        extent *= 2;
+                    } else {
+                        sign = -sign;
+                    }
+                }
+            }
+            box.push_back(Interval(0, (int)(extent - 1)));
+        }
+
+        map<string, Box> regions;
+        add_required(c, def, box, within, regions);
+        // Producers computed within this loop are realized in full
+        // for each of the stages that read them.
+        for (const Function &f : order) {
+            if (!regions.count(f.name()) || f.has_extern_definition()) {
+                continue;
+            }
+            Box region = regions[f.name()];
+            for (int s = 0; s <= (int)f.updates().size(); s++) {
+                add_required(f, get_stage(f, s), region, within, regions);
+            }
+        }
+
+        for (const auto &r : regions) {
+            if (is_inlined(env.at(r.first))) {
+                continue;
+            }
+            int64_t points = box_points(r.second);
+            if (points < 0) {
+                return work;
+            }
+            if (subset == 0) {
+                work.points[r.first] = points;
+            }
+            new_points[r.first] += sign * points;
+        }
+    }
+
+    for (const auto &p : work.points) {
+        work.redundant[p.first] = std::max(p.second - new_points[p.first], (int64_t)0);
+        if (work.working_set >= 0) {
+            work.working_set += p.second * bytes_per_point(env.at(p.first));
+        }
+    }
+    if (work.working_set >= 0) {
+        int64_t tile_points = 1;
+        for (int64_t e : extents) {
+            tile_points *= e;
+        }
+        work.working_set += tile_points * bytes_per_point(c);
+    }
+    work.known = true;
+    return work;
+}
+
+string describe_extents(const vector<int64_t> &extents) {
+    std::ostringstream s;
+    for (size_t i = 0; i < extents.size(); i++) {
+        s << (i > 0 ? "x" : "") << extents[i];
+    }
+    return s.str();
+}
+
+uint64_t cache_size(const MachineParams &params, int level) {
+    if (level <= 1 && params.l1_cache_size) {
+        return params.l1_cache_size;
+    } else if (level <= 2 && params.l2_cache_size) {
+        return params.l2_cache_size;
+    } else {
+        return params.last_level_cache_size;
+    }
+}
+
+}  // namespace
+
+string choose_auto_tile_sizes(map<string, Function> &env) {
+    std::ostringstream log;
+    map<string, Expr> sizes;
+    const MachineParams params = MachineParams::generic();
+
+    for (auto &p : env) {
+        Function &f = p.second;
+        for (int s = 0; s <= (int)f.updates().size(); s++) {
+            for (const AutoTile &t : get_stage(f, s).schedule().auto_tiles()) {
+                Loop loop{f, s, ""};
+                for (const Dim &d : get_stage(f, s).schedule().dims()) {
+                    if (d.var == t.tile_var || ends_with(d.var, "." + t.tile_var)) {
+                        loop.var = d.var;
+                    }
+                }
+                uint64_t cache = cache_size(params, t.size.cache_level);
+
+                // Try square-ish power-of-two tiles, and take the
+                // smallest one within the budget for redundant work
+                // that fits in the cache. Failing that, take the one
+                // that fits with the least redundant work.
+                int best_x = 0, best_y = 0;
+                bool best_in_budget = false;
+                double best_redundancy = 0;
+                for (int x = 8; x <= 512; x *= 2) {
+                    for (int y = 8; y <= 512; y *= 2) {
+                        map<string, Expr> candidate = sizes;
+                        candidate[t.x_size] = x;
+                        candidate[t.y_size] = y;
+                        IterationWork work = analyze_loop(loop, env, candidate);
+                        if (!work.known ||
+                            (work.working_set >= 0 && (uint64_t)work.working_set > cache)) {
+                            continue;
+                        }
+                        double redundancy = work.redundancy();
+                        bool in_budget = redundancy <= t.size.max_redundancy;
+                        bool better;
+                        if (best_x == 0 || in_budget != best_in_budget) {
+                            better = best_x == 0 || in_budget;
+                        } else if (in_budget) {
+                            better = (x * y < best_x * best_y ||
+                                      (x * y == best_x * best_y && x > best_x));
+                        } else {
+                            better = redundancy < best_redundancy;
+                        }
+                        if (better) {
+                            best_x = x;
+                            best_y = y;
+                            best_in_budget = in_budget;
+                            best_redundancy = redundancy;
+                        }
+                    }
+                }
+
+                if (best_x == 0) {
+                    user_warning << "Couldn't find the redundant work of tiles of " << f.name()
+                                 << " that fit in the cache. Using 64x64 tiles.\n";
+                    best_x = best_y = 64;
+                } else if (!best_in_budget) {
+                    user_warning << "No tiles of " << f.name() << " that fit in the cache keep the redundant work within "
+                                 << t.size.max_redundancy * 100 << "%. Using the tiles with the least.\n";
+                }
+                sizes[t.x_size] = best_x;
+                sizes[t.y_size] = best_y;
+                log << "Picked " << best_x << "x" << best_y << " tiles for " << loop.name()
+                    << ", with " << std::fixed << std::setprecision(1) << best_redundancy * 100
+                    << "% redundant work\n";
+            }
+        }
+    }
+
+    if (!sizes.empty()) {
+        for (auto &p : env) {
+            Function &f = p.second;
+            for (int s = 0; s <= (int)f.updates().size(); s++) {
+                Definition &def = s == 0 ? f.definition() : f.update(s - 1);
+                for (Split &split : def.schedule().splits()) {
+                    if (split.factor.defined()) {
+                        split.factor = substitute(sizes, split.factor);
+                    }
+                }
+            }
+        }
+    }
+    return log.str();
+}
+
+string redundant_work_report(const vector<Function> &output_funcs) {
+    map<string, Function> env;
+    for (Function f : output_funcs) {
+        populate_environment(f, env);
+    }
+    vector<Function> outputs;
+    std::tie(outputs, env) = deep_copy(output_funcs, env);
+    for (Function f : outputs) {
+        Func(f).compute_root().store_root();
+    }
+    for (auto &iter : env) {
+        iter.second.lock_loop_levels();
+    }
+    env = wrap_func_calls(env);
+
+    std::ostringstream report;
+    report << choose_auto_tile_sizes(env);
+
+    // Group the Funcs by the loops they are computed at.
+    map<string, Loop> loops;
+    map<string, vector<string>> computed_at;
+    for (const auto &p : env) {
+        const LoopLevel &level = p.second.schedule().compute_level();
+        Loop loop;
+        if (level.is_root() || level.is_inlined() ||
+            !find_loop(env.at(level.func()), level, loop)) {
+            continue;
+        }
+        loops.emplace(loop.name(), loop);
+        computed_at[loop.name()].push_back(p.first);
+    }
+
+    if (loops.empty()) {
+        report << "No Funcs are computed at loops of their consumers\n";
+    }
+    for (const auto &l : loops) {
+        IterationWork work = analyze_loop(l.second, env, map<string, Expr>());
+        report << "Computed at " << l.first;
+        if (!work.known) {
+            report << ": footprints aren't constant\n";
+            continue;
+        }
+        report << " (tiles of " << describe_extents(work.tile) << ", working set ";
+        if (work.working_set >= 0) {
+            report << work.working_set << " bytes):\n";
+        } else {
+            report << "unknown):\n";
+        }
+        for (const string &name : computed_at[l.first]) {
+            int64_t points = work.points.count(name) ? work.points[name] : 0;
+            int64_t redundant = work.redundant.count(name) ? work.redundant[name] : 0;
+            report << "  " << name << ": " << points << " points per iteration, "
+                   << std::fixed << std::setprecision(1)
+                   << (points > 0 ? 100.0 * redundant / points : 0.0) << "% redundant\n";
+        }
+    }
+    return report.str();
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,34 @@
+#ifndef HALIDE_REDUNDANT_WORK_H
+#define HALIDE_REDUNDANT_WORK_H
+
+/** \file
+ * Defines an analysis of the work that Funcs computed at loops of
+ * their consumers redo between iterations of those loops, and the
+ * step of lowering that picks tile sizes with it.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Describe, for each loop that Funcs are computed at, the points of
+ * each of them computed per iteration, the fraction of those that
+ * neighboring iterations also compute, and the working set of an
+ * iteration. Also lists the tile sizes picked for the tiles with an
+ * AutoTileSize. */
+std::string redundant_work_report(const std::vector<Function> &outputs);
+
+/** Pick the sizes of the tiles scheduled with an AutoTileSize, and
+ * substitute them into the splits of the stages. Returns a
+ * description of the sizes picked. */
+std::string choose_auto_tile_sizes(std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
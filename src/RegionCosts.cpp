@@ -434,6 +434,15 @@ Cost RegionCosts::region_cost(const map<string, Box> &regions, const set<string>
 map<string, Expr>
 RegionCosts::stage_detailed_load_costs(string func, int stage,
                                        const set<string> &inlines) {
+    StageCostQuery query{func, stage, inlines};
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto iter = stage_load_cost_cache.find(query);
+        if (iter != stage_load_cost_cache.end()) {
+            return iter->second;
+        }
+    }
+
     map<string, Expr> load_costs;
     Function curr_f = get_element(env, func);
 
@@ -460,6 +469,8 @@ RegionCosts::stage_detailed_load_costs(string func, int stage,
         }
     }
 
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    stage_load_cost_cache.emplace(std::move(query), load_costs);
     return load_costs;
 }
 
@@ -561,6 +572,15 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage,
         return Cost();
     }
 
+    StageCostQuery query{f.name(), stage, inlines};
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto iter = stage_cost_cache.find(query);
+        if (iter != stage_cost_cache.end()) {
+            return iter->second;
+        }
+    }
+
     Definition def = get_stage_definition(f, stage);
 
     Cost cost(0, 0);
@@ -592,6 +612,9 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage,
     }
 
     cost.simplify();
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    stage_cost_cache.emplace(std::move(query), cost);
     return cost;
 }
 
@@ -8,6 +8,8 @@
  */
 
 #include <limits>
+#include <map>
+#include <mutex>
 #include <set>
 
 #include "AutoScheduleUtils.h"
@@ -54,6 +56,27 @@ struct RegionCosts {
      * in the pipeline. */
     Scope<Interval> input_estimates;
 
+    /** The per-value costs and load costs of a function stage depend only
+     * on which functions are inlined into it. The auto scheduler asks for
+     * the same ones many times while evaluating groupings, so they are
+     * memoized here. The caches may be queried from several threads. */
+    struct StageCostQuery {
+        std::string func;
+        int stage;
+        std::set<std::string> inlines;
+        bool operator<(const StageCostQuery &other) const {
+            if (stage != other.stage) {
+                return stage < other.stage;
+            } else if (func != other.func) {
+                return func < other.func;
+            }
+            return inlines < other.inlines;
+        }
+    };
+    std::map<StageCostQuery, Cost> stage_cost_cache;
+    std::map<StageCostQuery, std::map<std::string, Expr>> stage_load_cost_cache;
+    std::mutex cache_mutex;
+
     /** Return the cost of producing a region (specified by 'bounds') of a
      * function stage (specified by 'func' and 'stage'). 'inlines' specifies
      * names of all the inlined functions. */
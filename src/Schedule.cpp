@@ -213,11 +213,20 @@ struct FuncScheduleContents {
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     MemoryType memory_type;
-    bool memoized, async;
+    bool memoized, async, store_nontemporal, store_interleaved;
+    MemoizeKey memoize_key;
+    int packed_bits;
+    int64_t code_size_budget;
+    std::string in_place_of;
+    Expr strip_size;
+    std::string distributed_var;
+    std::vector<TemporalBlockDim> temporal_block;
 
     FuncScheduleContents() :
         store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-        memory_type(MemoryType::Auto), memoized(false), async(false) {};
+        memory_type(MemoryType::Auto), memoized(false), async(false),
+        store_nontemporal(false), store_interleaved(false),
+        memoize_key(MemoizeKey::Parameters), packed_bits(0), code_size_budget(0) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -249,6 +258,9 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        if (strip_size.defined()) {
+            strip_size = mutator->mutate(strip_size);
+        }
     }
 };
 
@@ -276,9 +288,17 @@ struct StageScheduleContents {
     std::vector<FusedPair> fused_pairs;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
+    int gpu_max_threads, gpu_min_blocks_per_sm;
+    std::string hetero_split_var;
+    Expr hetero_split_fraction;
+    std::string gpu_multi_device_var;
+    std::vector<AutoTile> auto_tiles;
+    std::vector<TileSkip> skip_tiles;
 
     StageScheduleContents() : fuse_level(FuseLoopLevel()), touched(false),
-                              allow_race_conditions(false) {};
+                              allow_race_conditions(false), atomic(false),
+                              gpu_max_threads(0), gpu_min_blocks_per_sm(0) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the StageScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -300,6 +320,12 @@ struct StageScheduleContents {
                 p.offset = mutator->mutate(p.offset);
             }
         }
+        if (hetero_split_fraction.defined()) {
+            hetero_split_fraction = mutator->mutate(hetero_split_fraction);
+        }
+        for (TileSkip &t : skip_tiles) {
+            t.condition = mutator->mutate(t.condition);
+        }
     }
 };
 
@@ -328,7 +354,16 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->estimates = contents->estimates;
     copy.contents->memory_type = contents->memory_type;
     copy.contents->memoized = contents->memoized;
+    copy.contents->memoize_key = contents->memoize_key;
     copy.contents->async = contents->async;
+    copy.contents->in_place_of = contents->in_place_of;
+    copy.contents->store_nontemporal = contents->store_nontemporal;
+    copy.contents->store_interleaved = contents->store_interleaved;
+    copy.contents->packed_bits = contents->packed_bits;
+    copy.contents->code_size_budget = contents->code_size_budget;
+    copy.contents->strip_size = contents->strip_size;
+    copy.contents->distributed_var = contents->distributed_var;
+    copy.contents->temporal_block = contents->temporal_block;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -356,6 +391,14 @@ bool FuncSchedule::memoized() const {
     return contents->memoized;
 }
 
+MemoizeKey &FuncSchedule::memoize_key() {
+    return contents->memoize_key;
+}
+
+MemoizeKey FuncSchedule::memoize_key() const {
+    return contents->memoize_key;
+}
+
 bool &FuncSchedule::async() {
     return contents->async;
 }
@@ -364,6 +407,70 @@ bool FuncSchedule::async() const {
     return contents->async;
 }
 
+std::string &FuncSchedule::in_place_of() {
+    return contents->in_place_of;
+}
+
+const std::string &FuncSchedule::in_place_of() const {
+    return contents->in_place_of;
+}
+
+Expr &FuncSchedule::strip_size() {
+    return contents->strip_size;
+}
+
+Expr FuncSchedule::strip_size() const {
+    return contents->strip_size;
+}
+
+std::string &FuncSchedule::distributed_var() {
+    return contents->distributed_var;
+}
+
+const std::string &FuncSchedule::distributed_var() const {
+    return contents->distributed_var;
+}
+
+std::vector<TemporalBlockDim> &FuncSchedule::temporal_block() {
+    return contents->temporal_block;
+}
+
+const std::vector<TemporalBlockDim> &FuncSchedule::temporal_block() const {
+    return contents->temporal_block;
+}
+
+bool &FuncSchedule::store_nontemporal() {
+    return contents->store_nontemporal;
+}
+
+bool FuncSchedule::store_nontemporal() const {
+    return contents->store_nontemporal;
+}
+
+bool &FuncSchedule::store_interleaved() {
+    return contents->store_interleaved;
+}
+
+bool FuncSchedule::store_interleaved() const {
+    return contents->store_interleaved;
+}
+
+int64_t &FuncSchedule::code_size_budget() {
+    return contents->code_size_budget;
+}
+
+int64_t FuncSchedule::code_size_budget() const {
+    return contents->code_size_budget;
+}
+
+int &FuncSchedule::packed_bits() {
+    return contents->packed_bits;
+}
+
+int FuncSchedule::packed_bits() const {
+    return contents->packed_bits;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -454,6 +561,9 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
             b.remainder.accept(visitor);
         }
     }
+    if (strip_size().defined()) {
+        strip_size().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator2 *mutator) {
@@ -476,6 +586,14 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->fused_pairs = contents->fused_pairs;
     copy.contents->touched = contents->touched;
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
+    copy.contents->atomic = contents->atomic;
+    copy.contents->gpu_max_threads = contents->gpu_max_threads;
+    copy.contents->gpu_min_blocks_per_sm = contents->gpu_min_blocks_per_sm;
+    copy.contents->hetero_split_var = contents->hetero_split_var;
+    copy.contents->hetero_split_fraction = contents->hetero_split_fraction;
+    copy.contents->gpu_multi_device_var = contents->gpu_multi_device_var;
+    copy.contents->auto_tiles = contents->auto_tiles;
+    copy.contents->skip_tiles = contents->skip_tiles;
     return copy;
 }
 
@@ -543,6 +661,70 @@ bool StageSchedule::allow_race_conditions() const {
     return contents->allow_race_conditions;
 }
 
+bool &StageSchedule::atomic() {
+    return contents->atomic;
+}
+
+bool StageSchedule::atomic() const {
+    return contents->atomic;
+}
+
+int &StageSchedule::gpu_max_threads() {
+    return contents->gpu_max_threads;
+}
+
+int StageSchedule::gpu_max_threads() const {
+    return contents->gpu_max_threads;
+}
+
+int &StageSchedule::gpu_min_blocks_per_sm() {
+    return contents->gpu_min_blocks_per_sm;
+}
+
+int StageSchedule::gpu_min_blocks_per_sm() const {
+    return contents->gpu_min_blocks_per_sm;
+}
+
+const std::string &StageSchedule::hetero_split_var() const {
+    return contents->hetero_split_var;
+}
+
+std::string &StageSchedule::hetero_split_var() {
+    return contents->hetero_split_var;
+}
+
+const Expr &StageSchedule::hetero_split_fraction() const {
+    return contents->hetero_split_fraction;
+}
+
+Expr &StageSchedule::hetero_split_fraction() {
+    return contents->hetero_split_fraction;
+}
+
+const std::string &StageSchedule::gpu_multi_device_var() const {
+    return contents->gpu_multi_device_var;
+}
+
+std::string &StageSchedule::gpu_multi_device_var() {
+    return contents->gpu_multi_device_var;
+}
+
+const std::vector<AutoTile> &StageSchedule::auto_tiles() const {
+    return contents->auto_tiles;
+}
+
+std::vector<AutoTile> &StageSchedule::auto_tiles() {
+    return contents->auto_tiles;
+}
+
+const std::vector<TileSkip> &StageSchedule::skip_tiles() const {
+    return contents->skip_tiles;
+}
+
+std::vector<TileSkip> &StageSchedule::skip_tiles() {
+    return contents->skip_tiles;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
@@ -562,6 +744,12 @@ void StageSchedule::accept(IRVisitor *visitor) const {
             p.offset.accept(visitor);
         }
     }
+    if (hetero_split_fraction().defined()) {
+        hetero_split_fraction().accept(visitor);
+    }
+    for (const TileSkip &t : skip_tiles()) {
+        t.condition.accept(visitor);
+    }
 }
 
 void StageSchedule::mutate(IRMutator2 *mutator) {
@@ -61,6 +61,20 @@ enum class TailStrategy {
      * instead of a multiple of the split factor as with RoundUp. */
     ShiftInwards,
 
+    /** Guard the inner loop with a condition that prevents
+     * evaluation beyond the original extent, like GuardWithIf, but
+     * don't split off a separate tail case. When the inner loop is
+     * vectorized, the condition becomes a mask on its loads and
+     * stores, so every iteration including the last is a full
+     * vector iteration. Always legal. Pros: no epilogue, so less
+     * code and no scalar tail; masks are cheap on targets with
+     * masked memory operations (e.g. AVX-512). Cons: every
+     * iteration pays for the mask, and if the loop body can't be
+     * predicated (e.g. it has side-effects, or the target lacks
+     * masked loads and stores of its types) the whole loop is
+     * scalarized. */
+    Predicate,
+
     /** For pure definitions use ShiftInwards. For pure vars in
      * update definitions use RoundUp. For RVars in update
      * definitions use GuardWithIf. */
@@ -104,6 +118,36 @@ enum class PrefetchBoundStrategy {
     NonFaulting
 };
 
+/** Different ways for a memoized Func to identify its inputs in the
+ * cache key. */
+enum class MemoizeKey {
+    /** By the values of the scalar parameters it depends on, and any
+     * memoize_tag values. Depending on an input buffer that isn't
+     * wrapped in a memoize_tag is an error. */
+    Parameters,
+
+    /** Also by a hash of the contents of each input buffer it depends
+     * on, along with its type and shape. Results are reused whenever
+     * the same data is passed in, no matter where it lives, at the cost
+     * of reading all of it on every run. */
+    ContentHash
+};
+
+/** Pass to Func::tile in place of the tile sizes to have them picked
+ * when the pipeline is lowered. The picked sizes are the smallest
+ * ones for which the Funcs computed per tile redo at most
+ * max_redundancy of their work at the borders between tiles, and
+ * for which the working set of a tile fits in the given level of
+ * the cache (1, 2, or 3 for the last level) described by
+ * MachineParams::generic(). */
+struct AutoTileSize {
+    float max_redundancy;
+    int cache_level;
+
+    explicit AutoTileSize(float max_redundancy = 0.1f, int cache_level = 2) :
+        max_redundancy(max_redundancy), cache_level(cache_level) {}
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -310,6 +354,18 @@ struct StorageDim {
     Expr alignment;
     Expr fold_factor;
     bool fold_forward;
+    /** The tile size along this dimension set by Func::store_tiled,
+     * or zero if the dimension isn't tiled. */
+    int tile_extent;
+    /** Whether the elements within each tile are in Morton order. */
+    bool morton;
+};
+
+/** A dimension of the tiles that a chain of Funcs scheduled with
+ * Func::temporal_block is computed in. */
+struct TemporalBlockDim {
+    std::string var;
+    int tile_size;
 };
 
 /** This represents two stages with fused loop nests from outermost to a specific
@@ -360,6 +416,28 @@ struct PrefetchDirective {
     Parameter param;
 };
 
+/** A tile of a stage whose sizes are picked during lowering. See
+ * \ref Stage::tile with an AutoTileSize */
+struct AutoTile {
+    /** The names of the variables standing in for the tile sizes in
+     * the splits of the stage. */
+    std::string x_size, y_size;
+    /** The loop over the tiles. The Funcs computed at it are the
+     * ones computed once per tile. */
+    std::string tile_var;
+    AutoTileSize size;
+};
+
+/** A loop of a stage whose iterations are skipped when a condition
+ * holds. See \ref Stage::skip_tiles_where */
+struct TileSkip {
+    /** The loop over the tiles. */
+    std::string var;
+    /** The condition, in terms of var and the loops outside it, under
+     * which an iteration of the loop is skipped. */
+    Expr condition;
+};
+
 struct FuncScheduleContents;
 struct StageScheduleContents;
 struct FunctionContents;
@@ -393,10 +471,78 @@ public:
     bool memoized() const;
     // @}
 
+    /** How a memoized Func identifies its inputs in the cache key. */
+    // @{
+    MemoizeKey &memoize_key();
+    MemoizeKey memoize_key() const;
+    // @}
+
     /** Is the production of this Function done asynchronously */
     bool &async();
     bool async() const;
 
+    /** The name of the Func or pipeline input this Function is
+     * stored in, or empty if it has storage of its own. See
+     * \ref Func::store_in_place_of */
+    // @{
+    std::string &in_place_of();
+    const std::string &in_place_of() const;
+    // @}
+
+    /** The number of iterations of the parallel loop this Function
+     * is computed at to give each strip that slides a window of
+     * it, or undefined. See \ref Func::slide_in_strips */
+    // @{
+    Expr &strip_size();
+    Expr strip_size() const;
+    // @}
+
+    /** The pure dimension of this Function that is divided between
+     * the ranks of a distributed pipeline, or empty if every rank
+     * computes all of it. See \ref Func::distribute */
+    // @{
+    std::string &distributed_var();
+    const std::string &distributed_var() const;
+    // @}
+
+    /** The dimensions of the tiles this Function is computed in
+     * together with the rest of its chain of stencils, or empty if
+     * it isn't temporally blocked. See \ref Func::temporal_block */
+    // @{
+    std::vector<TemporalBlockDim> &temporal_block();
+    const std::vector<TemporalBlockDim> &temporal_block() const;
+    // @}
+
+    /** Should the stores to this Function bypass the cache. See
+     * \ref Func::store_nontemporal */
+    // @{
+    bool &store_nontemporal();
+    bool store_nontemporal() const;
+    // @}
+
+    /** Are the elements of this Function's Tuple stored interleaved
+     * in one buffer. See \ref Func::store_interleaved */
+    // @{
+    bool &store_interleaved();
+    bool store_interleaved() const;
+    // @}
+
+    /** The estimated number of instructions that loop unrolling and
+     * partitioning may grow this Function's code to, or zero if it
+     * is unlimited. See \ref Func::code_size_budget */
+    // @{
+    int64_t &code_size_budget();
+    int64_t code_size_budget() const;
+    // @}
+
+    /** The number of bits each element of this Function is packed
+     * into in memory, or zero if it isn't packed. See
+     * \ref Func::store_packed */
+    // @{
+    int &packed_bits();
+    int packed_bits() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -542,6 +688,57 @@ public:
     bool &allow_race_conditions();
     // @}
 
+    /** Should the stores of this update definition be performed as
+     * atomic read-modify-write operations? See \ref Stage::atomic */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
+    /** Launch bounds for the CUDA kernel this stage is computed in:
+     * the most threads per block it will be launched with, and the
+     * fewest blocks that should fit on a multiprocessor at
+     * once. Zero means unspecified. See \ref Stage::gpu_launch_bounds */
+    // @{
+    int gpu_max_threads() const;
+    int &gpu_max_threads();
+    int gpu_min_blocks_per_sm() const;
+    int &gpu_min_blocks_per_sm();
+    // @}
+
+    /** The loop dimension whose iterations are divided between the
+     * device API and host threads, and the fraction of them that runs
+     * on the device. An undefined fraction is tuned at runtime. Empty
+     * if the stage runs entirely on one side. See \ref Stage::hetero_split */
+    // @{
+    const std::string &hetero_split_var() const;
+    std::string &hetero_split_var();
+    const Expr &hetero_split_fraction() const;
+    Expr &hetero_split_fraction();
+    // @}
+
+    /** The loop dimension whose iterations are distributed across
+     * all of the available GPUs. Empty if the stage runs on a single
+     * GPU. See \ref Stage::gpu_multi_device */
+    // @{
+    const std::string &gpu_multi_device_var() const;
+    std::string &gpu_multi_device_var();
+    // @}
+
+    /** The tiles of this stage whose sizes are left to be picked when
+     * lowering. See \ref Stage::tile with an AutoTileSize */
+    // @{
+    const std::vector<AutoTile> &auto_tiles() const;
+    std::vector<AutoTile> &auto_tiles();
+    // @}
+
+    /** The loops of this stage whose iterations are skipped when a
+     * condition holds. See \ref Stage::skip_tiles_where */
+    // @{
+    const std::vector<TileSkip> &skip_tiles() const;
+    std::vector<TileSkip> &skip_tiles();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
@@ -4,6 +4,7 @@
 
 #include "ScheduleFunctions.h"
 #include "ApplySplit.h"
+#include "Associativity.h"
 #include "CodeGen_GPU_Dev.h"
 #include "ExprUsesVar.h"
 #include "Func.h"
@@ -76,6 +77,25 @@ bool contains_impure_call(const Expr &expr) {
     return is_not_pure.result;
 }
 
+// Guard the body of the loop over a tile so that it does nothing when
+// the skip condition of the tile is true. The condition is bound to a
+// let so that InjectFunctionRealization can recognize the guard, and
+// compute the Funcs computed per tile inside of it.
+Stmt build_tile_skip(Stmt body, const string &prefix, const TileSkip &skip,
+                     const vector<Dim> &dims, int dim_idx, const Function &func) {
+    Expr cond = qualify(prefix, skip.condition);
+    for (int i = 0; i < dim_idx; i++) {
+        user_assert(!expr_uses_var(cond, prefix + dims[i].var))
+            << "In schedule for " << func.name()
+            << ", the condition " << skip.condition
+            << " of skip_tiles_where(" << skip.var << ") depends on "
+            << dims[i].var << ", which is a loop inside of " << skip.var << ".\n";
+    }
+    string name = prefix + skip.var + ".skip_tile";
+    body = IfThenElse::make(!Variable::make(Bool(), name), body);
+    return LetStmt::make(name, cond, body);
+}
+
 // Build a loop nest about a provide node using a schedule
 Stmt build_loop_nest(
         const Stmt &body,
@@ -267,6 +287,11 @@ Stmt build_loop_nest(
         } else {
             internal_assert(nest[i].type == Container::For);
             const Dim &dim = stage_s.dims()[nest[i].dim_idx];
+            for (const TileSkip &skip : stage_s.skip_tiles()) {
+                if (skip.var == dim.var) {
+                    stmt = build_tile_skip(stmt, prefix, skip, stage_s.dims(), nest[i].dim_idx, func);
+                }
+            }
             Expr min = Variable::make(Int(32), nest[i].name + ".loop_min");
             Expr extent = Variable::make(Int(32), nest[i].name + ".loop_extent");
             stmt = For::make(nest[i].name, min, extent, dim.for_type, dim.device_api, stmt);
@@ -350,6 +375,16 @@ Stmt build_provide_loop_nest(const map<string, Function> &env,
     // Make the (multi-dimensional multi-valued) store node.
     Stmt body = Provide::make(func.name(), values, site);
 
+    if (def.schedule().atomic()) {
+        for (const Dim &d : def.schedule().dims()) {
+            user_assert(d.for_type != ForType::Vectorized)
+                << "In schedule for " << func.name()
+                << ", can't vectorize " << d.var
+                << " of an update marked atomic().\n";
+        }
+        body = Atomic::make(func.name(), body);
+    }
+
     // Default schedule/values if there is no specialization
     Stmt stmt = build_loop_nest(body, prefix, start_fuse, func, def, is_update);
     stmt = inject_placeholder_prefetch(stmt, env, prefix, def.schedule().prefetches());
@@ -413,6 +448,7 @@ Stmt build_extern_produce(const map<string, Function> &env, Function f, const Ta
     vector<pair<Expr, int>> buffers_to_annotate;
     vector<Expr> buffers_contents_to_annotate;
     vector<pair<Expr, Expr>> cropped_buffers;
+    Expr completion;
     for (const ExternFuncArgument &arg : args) {
         if (arg.is_expr()) {
             extern_call_args.push_back(arg.expr);
@@ -497,6 +533,11 @@ Stmt build_extern_produce(const map<string, Function> &env, Function f, const Ta
             // if we mark it here, we might mask a missed initialization.
             // buffers_to_annotate.push_back(buf);
             // buffers_contents_to_annotate.push_back(buf);
+        } else if (arg.is_semaphore()) {
+            user_assert(!completion.defined())
+                << "Extern stage " << f.name() << " has more than one completion semaphore.\n";
+            completion = Variable::make(type_of<struct halide_semaphore_t *>(), f.name() + ".completion_semaphore");
+            extern_call_args.push_back(completion);
         } else {
             internal_error << "Bad ExternFuncArgument type\n";
         }
@@ -619,6 +660,7 @@ Stmt build_extern_produce(const map<string, Function> &env, Function f, const Ta
                             {extern_name, result}, Call::Extern);
     Stmt check = AssertStmt::make(EQ::make(result, 0), error);
 
+    Stmt cleanup;
     if (!cropped_buffers.empty()) {
         // We need to clean up the temporary crops we made for the
         // outputs in case any of them have device allocations.
@@ -642,13 +684,27 @@ Stmt build_extern_produce(const map<string, Function> &env, Function f, const Ta
                                          cleanup_args,
                                          Call::Intrinsic);
 
-        // Insert cleanup before checking the result of the extern stage.
         string destructor_name = unique_name('d');
         const char *fn = (cropped_buffers.size() == 1 ?
                           "_halide_buffer_retire_crop_after_extern_stage" :
                           "_halide_buffer_retire_crops_after_extern_stage");
-        Expr cleanup = Call::make(Int(32), fn, {cleanup_struct}, Call::Extern);
-        check = Block::make(Evaluate::make(cleanup), check);
+        cleanup = Evaluate::make(Call::make(Int(32), fn, {cleanup_struct}, Call::Extern));
+    }
+
+    if (completion.defined()) {
+        // An asynchronous extern stage may still be using its buffers
+        // after it returns. Check the result, then wait on the thread
+        // pool for the stage to release the semaphore before retiring
+        // any crops. If the stage failed, it's done with the buffers
+        // already.
+        if (cleanup.defined()) {
+            check = Block::make(IfThenElse::make(NE::make(result, 0), cleanup), check);
+        }
+        Stmt wait = Acquire::make(completion, 1, cleanup.defined() ? cleanup : Evaluate::make(0));
+        check = Block::make(check, wait);
+    } else if (cleanup.defined()) {
+        // Insert cleanup before checking the result of the extern stage.
+        check = Block::make(cleanup, check);
     }
 
     check = LetStmt::make(result_name, e, check);
@@ -661,6 +717,13 @@ Stmt build_extern_produce(const map<string, Function> &env, Function f, const Ta
         check = LetStmt::make(let.first, let.second, check);
     }
 
+    if (completion.defined()) {
+        const Variable *var = completion.as<Variable>();
+        Expr sema_space = Call::make(type_of<struct halide_semaphore_t *>(), "halide_make_semaphore",
+                                     {0}, Call::Extern);
+        check = LetStmt::make(var->name, sema_space, check);
+    }
+
     Definition f_def_no_pred = f.definition().get_copy();
     f_def_no_pred.predicate() = const_true();
     return build_loop_nest(check, f.name() + ".s0.", -1, f, f_def_no_pred, false);
@@ -994,10 +1057,30 @@ protected:
                 // side-effecty, so we stop here.
                 break;
             }
+            if (ends_with(l->name, ".skip_tile") && uses_funcs(l->value)) {
+                // The condition of a skip_tiles_where guard reads one
+                // of the Funcs we're injecting, so they must be
+                // computed before it.
+                break;
+            }
             lets.emplace_back(l->name, l->value);
             body = l->body;
         }
 
+        // Dig through the guard of a tile skipped by
+        // skip_tiles_where, so that the Funcs computed per tile are
+        // skipped along with it.
+        const IfThenElse *skip_guard = nullptr;
+        if (!lets.empty() && ends_with(lets.back().first, ".skip_tile")) {
+            const IfThenElse *if_then = body.as<IfThenElse>();
+            const Not *n = if_then ? if_then->condition.as<Not>() : nullptr;
+            const Variable *v = n ? n->a.as<Variable>() : nullptr;
+            if (v && v->name == lets.back().first && !if_then->else_case.defined()) {
+                skip_guard = if_then;
+                body = if_then->then_case;
+            }
+        }
+
         // Fused pairs (compute_with) cannot have extern definitions. Thus this condition is only true when funcs
         // contains a single function to be lowered. Can't schedule extern things inside a vector for loop.
         if (funcs[0].has_extern_definition() &&
@@ -1027,6 +1110,11 @@ protected:
             _found_store_level = true;
         }
 
+        // Reinstate the tile skipping guard
+        if (skip_guard) {
+            body = IfThenElse::make(skip_guard->condition, body);
+        }
+
         // Reinstate the let statements
         for (size_t i = lets.size(); i > 0; i--) {
             body = LetStmt::make(lets[i - 1].first, lets[i - 1].second, body);
@@ -1081,6 +1169,16 @@ private:
     const LoopLevel &compute_level;
     const LoopLevel &store_level;
 
+    bool uses_funcs(const Expr &e) const {
+        Stmt s = Evaluate::make(e);
+        for (const Function &f : funcs) {
+            if (function_is_used_in_stmt(f, s)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     Stmt build_realize(Stmt s, const Function &func, bool is_output) {
         if (!is_output) {
             Region bounds;
@@ -1699,6 +1797,7 @@ bool validate_schedule(Function f, const Stmt &s, const Target &target, bool is_
             case ForType::Serial:
             case ForType::Parallel:
             case ForType::Unrolled:
+            case ForType::UnrolledAndJammed:
                 is_extern = false;
                 break;
             default:
@@ -1766,6 +1865,36 @@ bool validate_schedule(Function f, const Stmt &s, const Target &target, bool is_
             allow_race_conditions_count++;
         }
 
+        // Unrolling and jamming a loop moves it inside the loops within
+        // it, so they must run in order, and the move must not reorder
+        // RVars unless the update is associative and commutative.
+        const vector<Dim> &dims = s.dims();
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (dims[i].for_type != ForType::UnrolledAndJammed) {
+                continue;
+            }
+            for (size_t j = 0; j < i; j++) {
+                if (dims[j].for_type != ForType::Serial &&
+                    dims[j].for_type != ForType::Vectorized &&
+                    dims[j].for_type != ForType::Unrolled &&
+                    dims[j].for_type != ForType::UnrolledAndJammed) {
+                    user_error << "In schedule for " << f.name()
+                               << ", can't unroll and jam " << dims[i].var
+                               << " into the " << dims[j].for_type
+                               << " loop over " << dims[j].var << ".\n";
+                }
+                if (!dims[i].is_pure() && !dims[j].is_pure()) {
+                    const auto &prover_result = prove_associativity(f.name(), def.args(), def.values());
+                    if (!(prover_result.associative() && prover_result.commutative())) {
+                        user_error << "In schedule for " << f.name()
+                                   << ", can't unroll and jam RVar " << dims[i].var
+                                   << " into the loop over RVar " << dims[j].var
+                                   << " because it may change the meaning of the algorithm.\n";
+                    }
+                }
+            }
+        }
+
         // For purposes of race-detection-warning, any split that
         // is the child of a parallel var is also 'parallel'.
         //
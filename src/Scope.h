@@ -142,6 +142,12 @@ public:
         return iter->second.top_ref();
     }
 
+    /** Tests if there are no names in this scope or any containing
+     * scope. */
+    bool empty() const {
+        return table.empty() && (!containing_scope || containing_scope->empty());
+    }
+
     /** Tests if a name is in scope */
     bool contains(const std::string &name) const {
         typename std::map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
@@ -0,0 +1,162 @@
+#include "SelectVectorWidths.h"
+#include "Debug.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Substitute.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+const char *placeholder_prefix = "natural_vector_width";
+
+bool is_placeholder(const Expr &e) {
+    const Variable *v = e.as<Variable>();
+    return v && (v->name == placeholder_prefix ||
+                 starts_with(v->name, string(placeholder_prefix) + "$"));
+}
+
+// Find the narrowest and widest types a loop body computes with. Call
+// and Provide arguments are excluded, as they're index math that
+// doesn't get vectorized at the width of the values.
+class FindValueTypes : public IRVisitor {
+    using IRVisitor::visit;
+
+    void include(Type t) {
+        if (t.is_bool() || t.is_handle()) {
+            return;
+        }
+        narrowest = std::min(narrowest, t.bits());
+        widest = std::max(widest, t.bits());
+        if (t.bits() == narrowest) {
+            narrowest_type = t.element_of();
+        }
+        if (t.bits() == widest) {
+            widest_type = t.element_of();
+        }
+    }
+
+    void visit(const Cast *op) override {
+        include(op->type);
+        include(op->value.type());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        include(op->type);
+        if (op->call_type == Call::Halide ||
+            op->call_type == Call::Image) {
+            return;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) override {
+        for (const Expr &v : op->values) {
+            include(v.type());
+            v.accept(this);
+        }
+    }
+
+public:
+    int narrowest = 256, widest = 0;
+    Type narrowest_type, widest_type;
+};
+
+class SelectVectorWidths : public IRVisitor {
+    using IRVisitor::visit;
+
+    const Target &target;
+    Scope<Expr> lets;
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets.push(op->name, op->value);
+        op->body.accept(this);
+        lets.pop(op->name);
+    }
+
+    void visit(const For *op) override {
+        Expr extent = op->extent;
+        while (const Variable *v = extent.as<Variable>()) {
+            if (!lets.contains(v->name)) {
+                break;
+            }
+            extent = lets.get(v->name);
+        }
+
+        if (op->for_type == ForType::Vectorized && is_placeholder(extent)) {
+            FindValueTypes types;
+            op->body.accept(&types);
+            int w = target.natural_vector_size(Int(32));
+            if (types.widest > 0) {
+                w = std::min(target.natural_vector_size(types.narrowest_type),
+                             4 * target.natural_vector_size(types.widest_type));
+            }
+            // The same placeholder can show up in several loops,
+            // e.g. once per specialization. Use the narrowest choice.
+            const string &name = extent.as<Variable>()->name;
+            auto it = widths.find(name);
+            if (it == widths.end() || *as_const_int(it->second) > w) {
+                widths[name] = w;
+            }
+            debug(3) << "Vectorizing " << op->name << " by " << w
+                     << " (narrowest type " << types.narrowest_type
+                     << ", widest type " << types.widest_type << ")\n";
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    map<string, Expr> widths;
+
+    SelectVectorWidths(const Target &t) : target(t) {}
+};
+
+// Placeholders that didn't end up as the extent of a vectorized loop
+class FindPlaceholders : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (is_placeholder(op)) {
+            names.insert(op->name);
+        }
+    }
+
+public:
+    std::set<string> names;
+};
+
+}  // namespace
+
+Expr natural_vector_width_placeholder() {
+    return Variable::make(Int(32), unique_name(string(placeholder_prefix)));
+}
+
+Stmt select_vector_widths(Stmt s, const Target &t) {
+    SelectVectorWidths select(t);
+    s.accept(&select);
+    FindPlaceholders leftover;
+    s.accept(&leftover);
+    for (const string &name : leftover.names) {
+        if (!select.widths.count(name)) {
+            select.widths[name] = t.natural_vector_size(Int(32));
+        }
+    }
+    if (select.widths.empty()) {
+        return s;
+    }
+    return substitute(select.widths, s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
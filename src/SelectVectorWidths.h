@@ -0,0 +1,32 @@
+#ifndef HALIDE_SELECT_VECTOR_WIDTHS_H
+#define HALIDE_SELECT_VECTOR_WIDTHS_H
+
+/** \file
+ * Defines the lowering pass that picks the widths of loops scheduled
+ * with Func::vectorize_natural.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make the placeholder split factor Func::vectorize_natural uses. It
+ * is a fresh variable that select_vector_widths replaces with a
+ * constant once the loop it applies to is known. */
+Expr natural_vector_width_placeholder();
+
+/** Replace each placeholder made by natural_vector_width_placeholder
+ * with a constant width for the vectorized loop it is the extent
+ * of. The width is the natural vector size of the narrowest type
+ * computed in the loop, capped at four times the natural vector size
+ * of the widest, so that narrow loads widened to wide arithmetic
+ * fill whole vectors without blowing out the register file. Must be
+ * run before bounds inference. */
+Stmt select_vector_widths(Stmt s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,1062 @@
+#include "Serialization.h"
+#include "IR.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Halide {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace Internal {
+
+namespace {
+
+// Bump this whenever the format changes.
+const char serialized_module_magic[] = "HLMOD";
+const uint32_t serialized_module_version = 1;
+
+// Write a Module. Integers are written as LEB128 varints. Strings, IR
+// nodes, Parameters and Buffers are each written in full once, and
+// after that referred to by their index in the order they were
+// written, so that names and shared subexpressions aren't repeated.
+// For the IR nodes, this also preserves the sharing of subexpressions
+// between Stmts.
+class ModuleWriter : public IRVisitor {
+public:
+    vector<uint8_t> out;
+
+    void write_uint(uint64_t x) {
+        do {
+            uint8_t byte = x & 0x7f;
+            x >>= 7;
+            out.push_back(byte | (x ? 0x80 : 0));
+        } while (x);
+    }
+
+    void write_int(int64_t x) {
+        // Zig-zag encode so that small negative numbers stay small.
+        write_uint(((uint64_t)x << 1) ^ (uint64_t)(x >> 63));
+    }
+
+    void write_bytes(const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    void write_string(const string &s) {
+        auto it = strings.find(s);
+        if (it != strings.end()) {
+            write_uint(it->second + 1);
+            return;
+        }
+        write_uint(0);
+        write_uint(s.size());
+        write_bytes(s.data(), s.size());
+        size_t id = strings.size();
+        strings[s] = id;
+    }
+
+    void write_strings(const vector<string> &v) {
+        write_uint(v.size());
+        for (const string &s : v) {
+            write_string(s);
+        }
+    }
+
+    void write_cplusplus_type_name(const halide_cplusplus_type_name &n) {
+        write_uint(n.cpp_type_type);
+        write_string(n.name);
+    }
+
+    void write_type(const Type &t) {
+        write_uint(t.code());
+        write_uint(t.bits());
+        write_uint(t.lanes());
+        if (t.is_handle()) {
+            write_uint(t.handle_type != nullptr);
+            if (t.handle_type) {
+                const halide_handle_cplusplus_type *h = t.handle_type;
+                write_cplusplus_type_name(h->inner_name);
+                write_strings(h->namespaces);
+                write_uint(h->enclosing_types.size());
+                for (const auto &e : h->enclosing_types) {
+                    write_cplusplus_type_name(e);
+                }
+                write_uint(h->cpp_type_modifiers.size());
+                write_bytes(h->cpp_type_modifiers.data(), h->cpp_type_modifiers.size());
+                write_uint(h->reference_type);
+            }
+        }
+    }
+
+    void write_types(const vector<Type> &v) {
+        write_uint(v.size());
+        for (const Type &t : v) {
+            write_type(t);
+        }
+    }
+
+    void write_parameter(const Parameter &p) {
+        if (!p.defined()) {
+            write_uint(0);
+            return;
+        }
+        auto it = parameters.find(p);
+        if (it != parameters.end()) {
+            write_uint(it->second + 2);
+            return;
+        }
+        write_uint(1);
+        write_type(p.type());
+        write_uint(p.is_buffer());
+        write_uint(p.dimensions());
+        write_string(p.name());
+        if (p.is_buffer()) {
+            write_uint(p.host_alignment());
+        }
+        size_t id = parameters.size();
+        parameters[p] = id;
+    }
+
+    void write_buffer(const Buffer<> &b) {
+        if (!b.defined()) {
+            write_uint(0);
+            return;
+        }
+        const void *key = b.raw_buffer();
+        auto it = buffers.find(key);
+        if (it != buffers.end()) {
+            write_uint(it->second + 2);
+            return;
+        }
+        user_assert(!b.device_dirty())
+            << "Can't serialize Buffer " << b.name() << ", because it is dirty on a device.\n";
+        write_uint(1);
+        write_string(b.name());
+        write_type(b.type());
+        write_uint(b.dimensions());
+        for (int i = 0; i < b.dimensions(); i++) {
+            write_int(b.dim(i).min());
+            write_int(b.dim(i).extent());
+            write_int(b.dim(i).stride());
+        }
+        // The strides are kept, so the bytes spanned by the data can
+        // be written as they are.
+        write_uint(b.size_in_bytes());
+        write_bytes(b.begin(), b.size_in_bytes());
+        size_t id = buffers.size();
+        buffers[key] = id;
+    }
+
+    void write_expr(const Expr &e) {
+        if (!e.defined()) {
+            write_uint(0);
+            return;
+        }
+        auto it = exprs.find(e.get());
+        if (it != exprs.end()) {
+            write_uint(it->second + 2);
+            return;
+        }
+        write_uint(1);
+        write_uint((int)e->node_type);
+        write_type(e.type());
+        e.accept(this);
+        // Nodes are numbered in the order they are finished, so the
+        // reader can number them the same way.
+        size_t id = exprs.size();
+        exprs[e.get()] = id;
+    }
+
+    void write_exprs(const vector<Expr> &v) {
+        write_uint(v.size());
+        for (const Expr &e : v) {
+            write_expr(e);
+        }
+    }
+
+    void write_region(const Region &r) {
+        write_uint(r.size());
+        for (const Range &range : r) {
+            write_expr(range.min);
+            write_expr(range.extent);
+        }
+    }
+
+    void write_stmt(const Stmt &s) {
+        if (!s.defined()) {
+            write_uint(0);
+            return;
+        }
+        auto it = stmts.find(s.get());
+        if (it != stmts.end()) {
+            write_uint(it->second + 2);
+            return;
+        }
+        write_uint(1);
+        write_uint((int)s->node_type);
+        s.accept(this);
+        size_t id = stmts.size();
+        stmts[s.get()] = id;
+    }
+
+    void write_argument(const LoweredArgument &arg) {
+        write_string(arg.name);
+        write_uint(arg.kind);
+        write_uint(arg.dimensions);
+        write_type(arg.type);
+        const ArgumentEstimates &e = arg.argument_estimates;
+        write_expr(e.scalar_def);
+        write_expr(e.scalar_min);
+        write_expr(e.scalar_max);
+        write_expr(e.scalar_estimate);
+        write_uint(e.buffer_estimates.size());
+        for (const auto &b : e.buffer_estimates) {
+            write_expr(b.min);
+            write_expr(b.extent);
+        }
+        write_int(arg.alignment.modulus);
+        write_int(arg.alignment.remainder);
+    }
+
+    void write_function(const LoweredFunc &f) {
+        write_string(f.name);
+        write_uint(f.args.size());
+        for (const LoweredArgument &arg : f.args) {
+            write_argument(arg);
+        }
+        write_stmt(f.body);
+        write_uint((int)f.linkage);
+        write_uint((int)f.name_mangling);
+    }
+
+    void write_external_code(const ExternalCode &c) {
+        string kind = c.is_c_plus_plus_source() ? "c++" : c.is_device_code() ? "device" : "bitcode";
+        write_string(kind);
+        write_string(kind == "bitcode" ? c.bitcode_target().to_string() : "");
+        write_uint((int)c.device_api());
+        write_string(c.name());
+        write_uint(c.contents().size());
+        write_bytes(c.contents().data(), c.contents().size());
+    }
+
+    void write_module(const Module &m) {
+        write_string(m.name());
+        write_string(m.target().to_string());
+        write_string(m.auto_schedule());
+        write_uint(m.any_strict_float());
+        write_uint(m.buffers().size());
+        for (const Buffer<> &b : m.buffers()) {
+            write_buffer(b);
+        }
+        write_uint(m.functions().size());
+        for (const LoweredFunc &f : m.functions()) {
+            write_function(f);
+        }
+        write_uint(m.submodules().size());
+        for (const Module &sub : m.submodules()) {
+            write_module(sub);
+        }
+        write_uint(m.external_code().size());
+        for (const ExternalCode &c : m.external_code()) {
+            write_external_code(c);
+        }
+        map<string, string> names = m.get_metadata_name_map();
+        write_uint(names.size());
+        for (const auto &p : names) {
+            write_string(p.first);
+            write_string(p.second);
+        }
+    }
+
+private:
+    map<string, size_t> strings;
+    map<Parameter, size_t> parameters;
+    map<const void *, size_t> buffers;
+    map<const IRNode *, size_t> exprs, stmts;
+
+    using IRVisitor::visit;
+
+    void visit(const IntImm *op) override {
+        write_int(op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        write_uint(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        write_bytes(&op->value, sizeof(op->value));
+    }
+
+    void visit(const StringImm *op) override {
+        write_string(op->value);
+    }
+
+    void visit(const Cast *op) override {
+        write_expr(op->value);
+    }
+
+    template<typename T>
+    void visit_binary_operator(const T *op) {
+        write_expr(op->a);
+        write_expr(op->b);
+    }
+
+    void visit(const Add *op) override {visit_binary_operator(op);}
+    void visit(const Sub *op) override {visit_binary_operator(op);}
+    void visit(const Mul *op) override {visit_binary_operator(op);}
+    void visit(const Div *op) override {visit_binary_operator(op);}
+    void visit(const Mod *op) override {visit_binary_operator(op);}
+    void visit(const Min *op) override {visit_binary_operator(op);}
+    void visit(const Max *op) override {visit_binary_operator(op);}
+    void visit(const EQ *op) override {visit_binary_operator(op);}
+    void visit(const NE *op) override {visit_binary_operator(op);}
+    void visit(const LT *op) override {visit_binary_operator(op);}
+    void visit(const LE *op) override {visit_binary_operator(op);}
+    void visit(const GT *op) override {visit_binary_operator(op);}
+    void visit(const GE *op) override {visit_binary_operator(op);}
+    void visit(const And *op) override {visit_binary_operator(op);}
+    void visit(const Or *op) override {visit_binary_operator(op);}
+
+    void visit(const Not *op) override {
+        write_expr(op->a);
+    }
+
+    void visit(const Select *op) override {
+        write_expr(op->condition);
+        write_expr(op->true_value);
+        write_expr(op->false_value);
+    }
+
+    void visit(const Load *op) override {
+        write_string(op->name);
+        write_expr(op->predicate);
+        write_expr(op->index);
+        write_buffer(op->image);
+        write_parameter(op->param);
+    }
+
+    void visit(const Ramp *op) override {
+        write_expr(op->base);
+        write_expr(op->stride);
+        write_uint(op->lanes);
+    }
+
+    void visit(const Broadcast *op) override {
+        write_expr(op->value);
+        write_uint(op->lanes);
+    }
+
+    void visit(const Call *op) override {
+        user_assert(!op->func.defined())
+            << "Can't serialize the call to " << op->name
+            << ", because it refers to a Func. Only lowered Modules can be serialized.\n";
+        write_string(op->name);
+        write_exprs(op->args);
+        write_uint(op->call_type);
+        write_uint(op->value_index);
+        write_buffer(op->image);
+        write_parameter(op->param);
+    }
+
+    void visit(const Let *op) override {
+        write_string(op->name);
+        write_expr(op->value);
+        write_expr(op->body);
+    }
+
+    void visit(const Shuffle *op) override {
+        write_exprs(op->vectors);
+        write_uint(op->indices.size());
+        for (int i : op->indices) {
+            write_int(i);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        user_assert(!op->reduction_domain.defined())
+            << "Can't serialize the variable " << op->name
+            << ", because it refers to a reduction domain. Only lowered Modules can be serialized.\n";
+        write_string(op->name);
+        write_buffer(op->image);
+        write_parameter(op->param);
+    }
+
+    void visit(const LetStmt *op) override {
+        write_string(op->name);
+        write_expr(op->value);
+        write_stmt(op->body);
+    }
+
+    void visit(const AssertStmt *op) override {
+        write_expr(op->condition);
+        write_expr(op->message);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        write_string(op->name);
+        write_uint(op->is_producer);
+        write_stmt(op->body);
+    }
+
+    void visit(const For *op) override {
+        write_string(op->name);
+        write_expr(op->min);
+        write_expr(op->extent);
+        write_uint((int)op->for_type);
+        write_uint((int)op->device_api);
+        write_stmt(op->body);
+    }
+
+    void visit(const Acquire *op) override {
+        write_expr(op->semaphore);
+        write_expr(op->count);
+        write_stmt(op->body);
+    }
+
+    void visit(const Store *op) override {
+        write_string(op->name);
+        write_expr(op->predicate);
+        write_expr(op->value);
+        write_expr(op->index);
+        write_parameter(op->param);
+    }
+
+    void visit(const Provide *op) override {
+        write_string(op->name);
+        write_exprs(op->values);
+        write_exprs(op->args);
+    }
+
+    void visit(const Allocate *op) override {
+        write_string(op->name);
+        write_type(op->type);
+        write_uint((int)op->memory_type);
+        write_exprs(op->extents);
+        write_expr(op->condition);
+        write_expr(op->new_expr);
+        write_string(op->free_function);
+        write_stmt(op->body);
+    }
+
+    void visit(const Free *op) override {
+        write_string(op->name);
+    }
+
+    void visit(const Realize *op) override {
+        write_string(op->name);
+        write_types(op->types);
+        write_uint((int)op->memory_type);
+        write_region(op->bounds);
+        write_expr(op->condition);
+        write_stmt(op->body);
+    }
+
+    void visit(const Block *op) override {
+        write_stmt(op->first);
+        write_stmt(op->rest);
+    }
+
+    void visit(const Fork *op) override {
+        write_stmt(op->first);
+        write_stmt(op->rest);
+    }
+
+    void visit(const IfThenElse *op) override {
+        write_expr(op->condition);
+        write_stmt(op->then_case);
+        write_stmt(op->else_case);
+    }
+
+    void visit(const Evaluate *op) override {
+        write_expr(op->value);
+    }
+
+    void visit(const Prefetch *op) override {
+        write_string(op->name);
+        write_types(op->types);
+        write_region(op->bounds);
+        write_string(op->prefetch.name);
+        write_string(op->prefetch.var);
+        write_expr(op->prefetch.offset);
+        write_uint((int)op->prefetch.strategy);
+        write_parameter(op->prefetch.param);
+        write_expr(op->condition);
+        write_stmt(op->body);
+    }
+
+    void visit(const Atomic *op) override {
+        write_string(op->producer_name);
+        write_stmt(op->body);
+    }
+};
+
+// The handle types of deserialized Types. Types refer to these by
+// pointer, so they live as long as the process does.
+const halide_handle_cplusplus_type *intern_handle_type(const halide_handle_cplusplus_type &h) {
+    static std::mutex mutex;
+    static vector<std::unique_ptr<halide_handle_cplusplus_type>> handle_types;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &existing : handle_types) {
+        if (existing->inner_name == h.inner_name &&
+            existing->namespaces == h.namespaces &&
+            existing->enclosing_types == h.enclosing_types &&
+            existing->cpp_type_modifiers == h.cpp_type_modifiers &&
+            existing->reference_type == h.reference_type) {
+            return existing.get();
+        }
+    }
+    handle_types.emplace_back(new halide_handle_cplusplus_type(h));
+    return handle_types.back().get();
+}
+
+class ModuleReader {
+    const vector<uint8_t> &in;
+    size_t pos = 0;
+
+    vector<string> strings;
+    vector<Parameter> parameters;
+    vector<Buffer<>> buffers;
+    vector<Expr> exprs;
+    vector<Stmt> stmts;
+
+    void check(bool condition) {
+        user_assert(condition) << "Can't deserialize a corrupt or truncated Module.\n";
+    }
+
+public:
+    ModuleReader(const vector<uint8_t> &in) : in(in) {}
+
+    bool at_end() const {
+        return pos == in.size();
+    }
+
+    uint64_t read_uint() {
+        uint64_t x = 0;
+        for (int shift = 0;; shift += 7) {
+            check(pos < in.size() && shift < 64);
+            uint8_t byte = in[pos++];
+            x |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return x;
+            }
+        }
+    }
+
+    int64_t read_int() {
+        uint64_t x = read_uint();
+        return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+    }
+
+    const uint8_t *read_bytes(size_t size) {
+        check(size <= in.size() - pos);
+        const uint8_t *bytes = in.data() + pos;
+        pos += size;
+        return bytes;
+    }
+
+    string read_string() {
+        uint64_t id = read_uint();
+        if (id > 0) {
+            check(id - 1 < strings.size());
+            return strings[id - 1];
+        }
+        size_t size = read_uint();
+        const char *chars = (const char *)read_bytes(size);
+        strings.emplace_back(chars, size);
+        return strings.back();
+    }
+
+    vector<string> read_strings() {
+        vector<string> v(read_uint());
+        for (string &s : v) {
+            s = read_string();
+        }
+        return v;
+    }
+
+    halide_cplusplus_type_name read_cplusplus_type_name() {
+        auto cpp_type_type = (halide_cplusplus_type_name::CPPTypeType)read_uint();
+        return halide_cplusplus_type_name(cpp_type_type, read_string());
+    }
+
+    Type read_type() {
+        auto code = (halide_type_code_t)read_uint();
+        int bits = read_uint();
+        int lanes = read_uint();
+        const halide_handle_cplusplus_type *handle_type = nullptr;
+        if (code == halide_type_handle && read_uint()) {
+            halide_cplusplus_type_name inner_name = read_cplusplus_type_name();
+            vector<string> namespaces = read_strings();
+            vector<halide_cplusplus_type_name> enclosing_types;
+            for (size_t n = read_uint(); n > 0; n--) {
+                enclosing_types.push_back(read_cplusplus_type_name());
+            }
+            size_t num_modifiers = read_uint();
+            const uint8_t *modifiers = read_bytes(num_modifiers);
+            auto reference_type = (halide_handle_cplusplus_type::ReferenceType)read_uint();
+            handle_type = intern_handle_type(
+                halide_handle_cplusplus_type(inner_name, namespaces, enclosing_types,
+                                             vector<uint8_t>(modifiers, modifiers + num_modifiers),
+                                             reference_type));
+        }
+        return Type(code, bits, lanes, handle_type);
+    }
+
+    vector<Type> read_types() {
+        vector<Type> v(read_uint());
+        for (Type &t : v) {
+            t = read_type();
+        }
+        return v;
+    }
+
+    Parameter read_parameter() {
+        uint64_t id = read_uint();
+        if (id == 0) {
+            return Parameter();
+        } else if (id > 1) {
+            check(id - 2 < parameters.size());
+            return parameters[id - 2];
+        }
+        Type type = read_type();
+        bool is_buffer = read_uint();
+        int dimensions = read_uint();
+        string name = read_string();
+        Parameter p(type, is_buffer, dimensions, name);
+        if (is_buffer) {
+            p.set_host_alignment(read_uint());
+        }
+        parameters.push_back(p);
+        return p;
+    }
+
+    Buffer<> read_buffer() {
+        uint64_t id = read_uint();
+        if (id == 0) {
+            return Buffer<>();
+        } else if (id > 1) {
+            check(id - 2 < buffers.size());
+            return buffers[id - 2];
+        }
+        string name = read_string();
+        Type type = read_type();
+        vector<halide_dimension_t> shape(read_uint());
+        for (halide_dimension_t &d : shape) {
+            d.min = read_int();
+            d.extent = read_int();
+            d.stride = read_int();
+        }
+        Buffer<> b(type, nullptr, (int)shape.size(), shape.data(), name);
+        b.allocate();
+        size_t size = read_uint();
+        check(size == b.size_in_bytes());
+        memcpy(b.begin(), read_bytes(size), size);
+        buffers.push_back(b);
+        return b;
+    }
+
+    Expr read_expr() {
+        uint64_t id = read_uint();
+        if (id == 0) {
+            return Expr();
+        } else if (id > 1) {
+            check(id - 2 < exprs.size());
+            return exprs[id - 2];
+        }
+
+        auto node_type = (IRNodeType)read_uint();
+        Type t = read_type();
+        Expr e;
+        switch (node_type) {
+        case IRNodeType::IntImm:
+            e = IntImm::make(t, read_int());
+            break;
+        case IRNodeType::UIntImm:
+            e = UIntImm::make(t, read_uint());
+            break;
+        case IRNodeType::FloatImm: {
+            double value;
+            memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+            e = FloatImm::make(t, value);
+            break;
+        }
+        case IRNodeType::StringImm:
+            e = StringImm::make(read_string());
+            break;
+        case IRNodeType::Cast:
+            e = Cast::make(t, read_expr());
+            break;
+#define READ_BINARY_OPERATOR(Op)                \
+        case IRNodeType::Op: {                  \
+            Expr a = read_expr();               \
+            Expr b = read_expr();               \
+            e = Op::make(a, b);                 \
+            break;                              \
+        }
+        READ_BINARY_OPERATOR(Add)
+        READ_BINARY_OPERATOR(Sub)
+        READ_BINARY_OPERATOR(Mul)
+        READ_BINARY_OPERATOR(Div)
+        READ_BINARY_OPERATOR(Mod)
+        READ_BINARY_OPERATOR(Min)
+        READ_BINARY_OPERATOR(Max)
+        READ_BINARY_OPERATOR(EQ)
+        READ_BINARY_OPERATOR(NE)
+        READ_BINARY_OPERATOR(LT)
+        READ_BINARY_OPERATOR(LE)
+        READ_BINARY_OPERATOR(GT)
+        READ_BINARY_OPERATOR(GE)
+        READ_BINARY_OPERATOR(And)
+        READ_BINARY_OPERATOR(Or)
+#undef READ_BINARY_OPERATOR
+        case IRNodeType::Not:
+            e = Not::make(read_expr());
+            break;
+        case IRNodeType::Select: {
+            Expr condition = read_expr();
+            Expr true_value = read_expr();
+            Expr false_value = read_expr();
+            e = Select::make(condition, true_value, false_value);
+            break;
+        }
+        case IRNodeType::Load: {
+            string name = read_string();
+            Expr predicate = read_expr();
+            Expr index = read_expr();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            e = Load::make(t, name, index, image, param, predicate);
+            break;
+        }
+        case IRNodeType::Ramp: {
+            Expr base = read_expr();
+            Expr stride = read_expr();
+            e = Ramp::make(base, stride, read_uint());
+            break;
+        }
+        case IRNodeType::Broadcast: {
+            Expr value = read_expr();
+            e = Broadcast::make(value, read_uint());
+            break;
+        }
+        case IRNodeType::Call: {
+            string name = read_string();
+            vector<Expr> args = read_exprs();
+            auto call_type = (Call::CallType)read_uint();
+            int value_index = read_uint();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            e = Call::make(t, name, args, call_type, FunctionPtr(), value_index, image, param);
+            break;
+        }
+        case IRNodeType::Let: {
+            string name = read_string();
+            Expr value = read_expr();
+            Expr body = read_expr();
+            e = Let::make(name, value, body);
+            break;
+        }
+        case IRNodeType::Shuffle: {
+            vector<Expr> vectors = read_exprs();
+            vector<int> indices(read_uint());
+            for (int &i : indices) {
+                i = read_int();
+            }
+            e = Shuffle::make(vectors, indices);
+            break;
+        }
+        case IRNodeType::Variable: {
+            string name = read_string();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            e = Variable::make(t, name, image, param, ReductionDomain());
+            break;
+        }
+        default:
+            check(false);
+        }
+        check(e.type() == t);
+        exprs.push_back(e);
+        return e;
+    }
+
+    vector<Expr> read_exprs() {
+        vector<Expr> v(read_uint());
+        for (Expr &e : v) {
+            e = read_expr();
+        }
+        return v;
+    }
+
+    Region read_region() {
+        Region r(read_uint());
+        for (Range &range : r) {
+            range.min = read_expr();
+            range.extent = read_expr();
+        }
+        return r;
+    }
+
+    Stmt read_stmt() {
+        uint64_t id = read_uint();
+        if (id == 0) {
+            return Stmt();
+        } else if (id > 1) {
+            check(id - 2 < stmts.size());
+            return stmts[id - 2];
+        }
+
+        auto node_type = (IRNodeType)read_uint();
+        Stmt s;
+        switch (node_type) {
+        case IRNodeType::LetStmt: {
+            string name = read_string();
+            Expr value = read_expr();
+            Stmt body = read_stmt();
+            s = LetStmt::make(name, value, body);
+            break;
+        }
+        case IRNodeType::AssertStmt: {
+            Expr condition = read_expr();
+            Expr message = read_expr();
+            s = AssertStmt::make(condition, message);
+            break;
+        }
+        case IRNodeType::ProducerConsumer: {
+            string name = read_string();
+            bool is_producer = read_uint();
+            s = ProducerConsumer::make(name, is_producer, read_stmt());
+            break;
+        }
+        case IRNodeType::For: {
+            string name = read_string();
+            Expr min = read_expr();
+            Expr extent = read_expr();
+            auto for_type = (ForType)read_uint();
+            auto device_api = (DeviceAPI)read_uint();
+            s = For::make(name, min, extent, for_type, device_api, read_stmt());
+            break;
+        }
+        case IRNodeType::Acquire: {
+            Expr semaphore = read_expr();
+            Expr count = read_expr();
+            s = Acquire::make(semaphore, count, read_stmt());
+            break;
+        }
+        case IRNodeType::Store: {
+            string name = read_string();
+            Expr predicate = read_expr();
+            Expr value = read_expr();
+            Expr index = read_expr();
+            Parameter param = read_parameter();
+            s = Store::make(name, value, index, param, predicate);
+            break;
+        }
+        case IRNodeType::Provide: {
+            string name = read_string();
+            vector<Expr> values = read_exprs();
+            vector<Expr> args = read_exprs();
+            s = Provide::make(name, values, args);
+            break;
+        }
+        case IRNodeType::Allocate: {
+            string name = read_string();
+            Type type = read_type();
+            auto memory_type = (MemoryType)read_uint();
+            vector<Expr> extents = read_exprs();
+            Expr condition = read_expr();
+            Expr new_expr = read_expr();
+            string free_function = read_string();
+            Stmt body = read_stmt();
+            s = Allocate::make(name, type, memory_type, extents, condition, body, new_expr, free_function);
+            break;
+        }
+        case IRNodeType::Free:
+            s = Free::make(read_string());
+            break;
+        case IRNodeType::Realize: {
+            string name = read_string();
+            vector<Type> types = read_types();
+            auto memory_type = (MemoryType)read_uint();
+            Region bounds = read_region();
+            Expr condition = read_expr();
+            s = Realize::make(name, types, memory_type, bounds, condition, read_stmt());
+            break;
+        }
+        case IRNodeType::Block: {
+            Stmt first = read_stmt();
+            Stmt rest = read_stmt();
+            s = Block::make(first, rest);
+            break;
+        }
+        case IRNodeType::Fork: {
+            Stmt first = read_stmt();
+            Stmt rest = read_stmt();
+            s = Fork::make(first, rest);
+            break;
+        }
+        case IRNodeType::IfThenElse: {
+            Expr condition = read_expr();
+            Stmt then_case = read_stmt();
+            Stmt else_case = read_stmt();
+            s = IfThenElse::make(condition, then_case, else_case);
+            break;
+        }
+        case IRNodeType::Evaluate:
+            s = Evaluate::make(read_expr());
+            break;
+        case IRNodeType::Prefetch: {
+            string name = read_string();
+            vector<Type> types = read_types();
+            Region bounds = read_region();
+            PrefetchDirective prefetch;
+            prefetch.name = read_string();
+            prefetch.var = read_string();
+            prefetch.offset = read_expr();
+            prefetch.strategy = (PrefetchBoundStrategy)read_uint();
+            prefetch.param = read_parameter();
+            Expr condition = read_expr();
+            s = Prefetch::make(name, types, bounds, prefetch, condition, read_stmt());
+            break;
+        }
+        case IRNodeType::Atomic: {
+            string producer_name = read_string();
+            s = Atomic::make(producer_name, read_stmt());
+            break;
+        }
+        default:
+            check(false);
+        }
+        stmts.push_back(s);
+        return s;
+    }
+
+    LoweredArgument read_argument() {
+        LoweredArgument arg;
+        arg.name = read_string();
+        arg.kind = (Argument::Kind)read_uint();
+        arg.dimensions = read_uint();
+        arg.type = read_type();
+        ArgumentEstimates &e = arg.argument_estimates;
+        e.scalar_def = read_expr();
+        e.scalar_min = read_expr();
+        e.scalar_max = read_expr();
+        e.scalar_estimate = read_expr();
+        e.buffer_estimates.resize(read_uint());
+        for (auto &b : e.buffer_estimates) {
+            b.min = read_expr();
+            b.extent = read_expr();
+        }
+        arg.alignment.modulus = read_int();
+        arg.alignment.remainder = read_int();
+        return arg;
+    }
+
+    LoweredFunc read_function() {
+        string name = read_string();
+        vector<LoweredArgument> args(read_uint());
+        for (LoweredArgument &arg : args) {
+            arg = read_argument();
+        }
+        Stmt body = read_stmt();
+        auto linkage = (LinkageType)read_uint();
+        auto name_mangling = (NameMangling)read_uint();
+        return LoweredFunc(name, args, body, linkage, name_mangling);
+    }
+
+    ExternalCode read_external_code() {
+        string kind = read_string();
+        string target = read_string();
+        auto device_api = (DeviceAPI)read_uint();
+        string name = read_string();
+        size_t size = read_uint();
+        const uint8_t *bytes = read_bytes(size);
+        vector<uint8_t> code(bytes, bytes + size);
+        if (kind == "c++") {
+            return ExternalCode::c_plus_plus_code_wrapper(code, name);
+        } else if (kind == "device") {
+            return ExternalCode::device_code_wrapper(device_api, code, name);
+        } else {
+            check(kind == "bitcode");
+            return ExternalCode::bitcode_wrapper(Target(target), code, name);
+        }
+    }
+
+    Module read_module() {
+        string name = read_string();
+        Target target(read_string());
+        Module m(name, target);
+        string auto_schedule = read_string();
+        if (!auto_schedule.empty()) {
+            m.set_auto_schedule(auto_schedule);
+        }
+        m.set_any_strict_float(read_uint());
+        for (size_t n = read_uint(); n > 0; n--) {
+            m.append(read_buffer());
+        }
+        for (size_t n = read_uint(); n > 0; n--) {
+            m.append(read_function());
+        }
+        for (size_t n = read_uint(); n > 0; n--) {
+            m.append(read_module());
+        }
+        for (size_t n = read_uint(); n > 0; n--) {
+            m.append(read_external_code());
+        }
+        for (size_t n = read_uint(); n > 0; n--) {
+            string from = read_string();
+            m.remap_metadata_name(from, read_string());
+        }
+        return m;
+    }
+};
+
+}  // namespace
+
+}  // namespace Internal
+
+using namespace Halide::Internal;
+
+vector<uint8_t> serialize_module(const Module &module) {
+    ModuleWriter writer;
+    writer.write_bytes(serialized_module_magic, sizeof(serialized_module_magic));
+    writer.write_uint(serialized_module_version);
+    writer.write_module(module);
+    return writer.out;
+}
+
+void serialize_module_to_file(const Module &module, const string &filename) {
+    vector<uint8_t> data = serialize_module(module);
+    write_entire_file(filename, data.data(), data.size());
+}
+
+Module deserialize_module(const vector<uint8_t> &data) {
+    ModuleReader reader(data);
+    user_assert(data.size() >= sizeof(serialized_module_magic) &&
+                memcmp(reader.read_bytes(sizeof(serialized_module_magic)),
+                       serialized_module_magic, sizeof(serialized_module_magic)) == 0)
+        << "Can't deserialize a Module from data that wasn't written by serialize_module.\n";
+    uint32_t version = reader.read_uint();
+    user_assert(version == serialized_module_version)
+        << "Can't deserialize a Module written in version " << version
+        << " of the format. This version of Halide reads version " << serialized_module_version << ".\n";
+    Module m = reader.read_module();
+    user_assert(reader.at_end()) << "Can't deserialize a corrupt or truncated Module.\n";
+    return m;
+}
+
+Module deserialize_module_from_file(const string &filename) {
+    vector<char> data = read_entire_file(filename);
+    return deserialize_module(vector<uint8_t>(data.begin(), data.end()));
+}
+
+}  // namespace Halide
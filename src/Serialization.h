@@ -0,0 +1,38 @@
+#ifndef HALIDE_SERIALIZATION_H
+#define HALIDE_SERIALIZATION_H
+
+/** \file
+ * Defines a compact binary format for lowered Modules, so that the
+ * front end and lowering can be run once at build time, and the
+ * lowered Module later compiled with LLVM or the JIT.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Module.h"
+
+namespace Halide {
+
+/** Serialize a lowered Module, including its lowered functions, the
+ * Buffers compiled into it, its submodules and its external code. The
+ * Stmts of the functions must not refer to Funcs or reduction
+ * domains, which is always the case for Modules returned by
+ * compile_to_module. */
+// @{
+std::vector<uint8_t> serialize_module(const Module &module);
+void serialize_module_to_file(const Module &module, const std::string &filename);
+// @}
+
+/** Reconstruct a Module written by serialize_module. The result can be
+ * compiled with Module::compile, or for the JIT with
+ * Internal::JITModule. It is an error for the data not to have been
+ * written by the same version of Halide. */
+// @{
+Module deserialize_module(const std::vector<uint8_t> &data);
+Module deserialize_module_from_file(const std::string &filename);
+// @}
+
+}  // namespace Halide
+
+#endif
@@ -2,6 +2,7 @@
 #include "Simplify_Internal.h"
 
 #include "CSE.h"
+#include "ConstantInterval.h"
 #include "IRMutator.h"
 #include "Substitute.h"
 
@@ -261,6 +262,13 @@ bool can_prove(Expr e, const Scope<Interval> &bounds) {
     internal_assert(e.type().is_bool())
         << "Argument to can_prove is not a boolean Expr: " << e << "\n";
 
+    // Many queries can be decided from the constant bounds of the
+    // variables alone, which is much cheaper than simplifying.
+    ConstantInterval c = constant_integer_bounds(e, bounds);
+    if (c.is_single_point()) {
+        return c.min == 1;
+    }
+
     // Remove likelies
     struct RemoveLikelies : public IRMutator2 {
         using IRMutator2::visit;
@@ -151,8 +151,28 @@ vector<Definition> propagate_specialization_in_definition(Definition &def, const
     return result;
 }
 
+void substitute_in_specialization_conditions(Definition &def, const map<string, Expr> &values) {
+    for (Specialization &s : def.specializations()) {
+        s.condition = simplify(substitute(values, s.condition));
+        substitute_in_specialization_conditions(s.definition, values);
+    }
+}
+
 }  // namespace
 
+void substitute_in_specialization_conditions(map<string, Function> &env,
+                                             const map<string, Expr> &values) {
+    for (auto &iter : env) {
+        Function &func = iter.second;
+        if (func.definition().defined()) {
+            substitute_in_specialization_conditions(func.definition(), values);
+        }
+        for (size_t i = 0; i < func.updates().size(); i++) {
+            substitute_in_specialization_conditions(func.update(i), values);
+        }
+    }
+}
+
 void simplify_specializations(map<string, Function> &env) {
     for (auto &iter : env) {
         Function &func = iter.second;
@@ -18,6 +18,13 @@ namespace Internal {
  * specializations. */
 void simplify_specializations(std::map<std::string, Function> &env);
 
+/** Substitute values known ahead of time for some variables (such as
+ * the current values of Params) into the conditions of all
+ * specializations, so that simplify_specializations can prune the
+ * ones that can't be taken. */
+void substitute_in_specialization_conditions(std::map<std::string, Function> &env,
+                                             const std::map<std::string, Expr> &values);
+
 }  // namespace Internal
 }  // namespace Halide
 
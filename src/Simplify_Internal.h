@@ -7,6 +7,7 @@
  * exported in Halide.h. */
 
 #include "Bounds.h"
+#include "ConstantInterval.h"
 #include "IRMatch.h"
 #include "IRVisitor.h"
 #include "Scope.h"
@@ -35,10 +36,7 @@ public:
     Simplify(bool r, const Scope<Interval> *bi, const Scope<ModulusRemainder> *ai);
 
     // We track constant integer bounds when they exist
-    struct ConstBounds {
-        int64_t min = 0, max = 0;
-        bool min_defined = false, max_defined = false;
-    };
+    typedef ConstantInterval ConstBounds;
 
 #if LOG_EXPR_MUTATIONS
     static int debug_indent;
@@ -252,6 +250,7 @@ public:
     Stmt visit(const Free *op);
     Stmt visit(const Acquire *op);
     Stmt visit(const Fork *op);
+    Stmt visit(const Atomic *op);
 };
 
 }
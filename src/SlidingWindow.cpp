@@ -1,6 +1,7 @@
 #include "SlidingWindow.h"
 #include "Bounds.h"
 #include "Debug.h"
+#include "Func.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -14,6 +15,7 @@ namespace Internal {
 
 using std::map;
 using std::string;
+using std::vector;
 
 namespace {
 
@@ -407,5 +409,75 @@ Stmt sliding_window(Stmt s, const map<string, Function> &env) {
     return SlidingWindow(env).mutate(s);
 }
 
+void slide_in_parallel_strips(const map<string, Function> &env) {
+    for (const auto &p : env) {
+        Function f = p.second;
+        Expr strip_size = f.schedule().strip_size();
+        const LoopLevel &compute_at = f.schedule().compute_level();
+        const LoopLevel &store_at = f.schedule().store_level();
+        if (!strip_size.defined() || compute_at.is_inlined() || compute_at.is_root() ||
+            store_at == compute_at) {
+            continue;
+        }
+
+        // Find the stage and the loop this Func is computed at.
+        Function consumer = env.at(compute_at.func());
+        int stage = -1;
+        size_t dim = 0;
+        for (size_t i = 0; i <= consumer.updates().size(); i++) {
+            const Definition &def = i == 0 ? consumer.definition() : consumer.update(i - 1);
+            const vector<Dim> &dims = def.schedule().dims();
+            for (size_t j = 0; j < dims.size(); j++) {
+                if (compute_at.match(consumer.name() + ".s" + std::to_string(i) + "." + dims[j].var)) {
+                    user_assert(stage == -1)
+                        << "Func " << f.name() << " cannot slide in strips of "
+                        << consumer.name() << "." << compute_at.var().name()
+                        << ", because more than one stage of " << consumer.name()
+                        << " has that loop. Compute it at the loop of one stage.\n";
+                    stage = (int)i;
+                    dim = j;
+                }
+            }
+        }
+        internal_assert(stage >= 0);
+        Definition def = stage == 0 ? consumer.definition() : consumer.update(stage - 1);
+        const Dim &d = def.schedule().dims()[dim];
+        if (d.for_type != ForType::Parallel) {
+            // A serial loop already slides.
+            continue;
+        }
+
+        // If it's stored inside the loop, there's no window to keep.
+        bool stored_outside = true;
+        if (!store_at.is_root() && store_at.func() == consumer.name()) {
+            const vector<Dim> &dims = def.schedule().dims();
+            for (size_t j = 0; j <= dim; j++) {
+                if (store_at.match(consumer.name() + ".s" + std::to_string(stage) + "." + dims[j].var)) {
+                    stored_outside = false;
+                }
+            }
+        }
+        if (!stored_outside) {
+            continue;
+        }
+
+        // Split the loop into parallel strips, keeping its name for
+        // the serial loop within each strip, so that everything
+        // computed at it still is.
+        string var = compute_at.var().name();
+        string strip = unique_name(var + "_strip");
+        bool is_rvar = d.is_rvar();
+        VarOrRVar inner = is_rvar ? VarOrRVar(RVar(var)) : VarOrRVar(Var(var));
+        VarOrRVar outer = is_rvar ? VarOrRVar(RVar(strip)) : VarOrRVar(Var(strip));
+        debug(3) << "Sliding " << f.name() << " in strips of " << strip_size
+                 << " iterations of " << consumer.name() << "." << var << "\n";
+        Stage(consumer, def, stage, consumer.args())
+            .split(inner, outer, inner, strip_size, TailStrategy::GuardWithIf)
+            .parallel(outer)
+            .serial(inner);
+        f.schedule().store_level() = LoopLevel(consumer, outer, stage).lock();
+    }
+}
+
 }  // namespace Internal
 }  // namespace Halide
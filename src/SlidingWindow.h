@@ -20,6 +20,14 @@ namespace Internal {
  */
 Stmt sliding_window(Stmt s, const std::map<std::string, Function> &env);
 
+/** For each Function scheduled with Func::slide_in_strips and
+ * computed at a parallel loop of its consumer, split that loop into
+ * parallel strips, make the loop within each strip serial, and store
+ * the Function once per strip, so that sliding_window can slide
+ * along the serial loop. Must be run on the schedules, before
+ * lowering the pipeline. */
+void slide_in_parallel_strips(const std::map<std::string, Function> &env);
+
 }  // namespace Internal
 }  // namespace Halide
 
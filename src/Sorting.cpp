@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include "Sorting.h"
+#include "CSE.h"
+#include "IROperator.h"
+#include "RDom.h"
+
+namespace Halide {
+
+namespace Sorting {
+
+std::vector<Expr> sorting_network(const std::vector<Expr> &values) {
+    user_assert(!values.empty()) << "sorting_network called with no values\n";
+
+    std::vector<Expr> v = values;
+    const int n = (int)v.size();
+    int padded = 1;
+    while (padded < n) {
+        padded <<= 1;
+    }
+
+    // Batcher's odd-even merge sort for the padded size. The padding
+    // is notionally +infinity, so a compare-exchange that involves
+    // it leaves both elements where they are, and can be skipped.
+    for (int p = 1; p < padded; p <<= 1) {
+        for (int k = p; k >= 1; k >>= 1) {
+            for (int j = k % p; j + k < padded; j += 2 * k) {
+                for (int i = 0; i < k && i + j + k < padded; i++) {
+                    int a = i + j, b = i + j + k;
+                    if (a / (2 * p) != b / (2 * p) || b >= n) {
+                        continue;
+                    }
+                    Expr lo = min(v[a], v[b]);
+                    Expr hi = max(v[a], v[b]);
+                    v[a] = lo;
+                    v[b] = hi;
+                }
+            }
+        }
+    }
+
+    return v;
+}
+
+Expr kth_smallest(const std::vector<Expr> &values, int k) {
+    user_assert(k >= 0 && k < (int)values.size())
+        << "kth_smallest called with k = " << k
+        << " for a list of " << values.size() << " values\n";
+    // The network is a DAG in which most values are used twice. Lift
+    // the shared values into lets, or the Expr tree would be
+    // exponential in the depth of the network.
+    return Internal::common_subexpression_elimination(sorting_network(values)[k]);
+}
+
+Expr median(const std::vector<Expr> &values) {
+    return kth_smallest(values, ((int)values.size() - 1) / 2);
+}
+
+Func bitonic_sort(const Func &input, int size) {
+    user_assert(input.defined() && input.dimensions() == 1)
+        << "bitonic_sort requires a one-dimensional Func\n";
+    user_assert(size > 0 && (size & (size - 1)) == 0)
+        << "bitonic_sort requires a power of two size, not " << size << "\n";
+
+    Var x("x"), xo("xo"), xi("xi");
+    const int block = std::min(size, 1024);
+    const int vector_size = std::min(block, 8);
+
+    Func prev = input;
+    Func next("bitonic_sort");
+    if (size == 1) {
+        next(x) = input(x);
+    }
+    for (int pass_size = 1; pass_size < size; pass_size <<= 1) {
+        for (int chunk_size = pass_size; chunk_size > 0; chunk_size >>= 1) {
+            next = Func("bitonic_pass");
+            Expr chunk_start = (x / (2 * chunk_size)) * (2 * chunk_size);
+            Expr chunk_end = chunk_start + 2 * chunk_size;
+            Expr chunk_middle = chunk_start + chunk_size;
+            Expr partner;
+            if (pass_size == chunk_size && pass_size > 1) {
+                // Flipped pass. The clamp helps out bounds inference.
+                partner = clamp(2 * chunk_middle - x - 1, chunk_start, chunk_end - 1);
+            } else {
+                partner = chunk_start + (x - chunk_start + chunk_size) % (2 * chunk_size);
+            }
+            next(x) = select(x < chunk_middle,
+                             min(prev(x), prev(partner)),
+                             max(prev(x), prev(partner)));
+
+            // Each pass is elementwise, so it can be split into
+            // blocks however we like.
+            next.compute_root()
+                .split(x, xo, xi, block)
+                .parallel(xo)
+                .vectorize(xi, vector_size);
+            prev = next;
+        }
+    }
+    next.compute_root();
+
+    return next;
+}
+
+Func radix_sort(const Func &input, Expr size, int key_bits) {
+    user_assert(input.defined() && input.dimensions() == 1 && input.outputs() == 1)
+        << "radix_sort requires a one-dimensional Func with a single value\n";
+    const Type t = input.value().type();
+    user_assert(t.is_uint())
+        << "radix_sort requires unsigned integer values, not " << t << "\n";
+    user_assert(key_bits > 0 && key_bits <= t.bits())
+        << "radix_sort called with " << key_bits << " key bits for values of type " << t << "\n";
+
+    const int digit_bits = 4;
+    const int radix = 1 << digit_bits;
+    // The number of values each thread histograms and scatters. The
+    // running counts for a chunk take radix * chunk_size ints.
+    const int chunk_size = 1024;
+    Expr num_chunks = (size + chunk_size - 1) / chunk_size;
+
+    Var i("i"), d("d"), c("c"), r("r");
+
+    Func in = input;
+    Func out;
+    for (int shift = 0; shift < key_bits; shift += digit_bits) {
+        auto value = [&](Expr idx) {
+            return in(clamp(idx, 0, size - 1));
+        };
+        auto digit = [&](Expr idx) {
+            return cast<int>((value(idx) >> shift) & (radix - 1));
+        };
+
+        // How many values of each digit are in each chunk.
+        Func counts("radix_counts");
+        counts(d, c) = 0;
+        RDom rc(0, chunk_size);
+        Expr idx = c * chunk_size + rc;
+        counts(digit(idx), c) += select(idx < size, 1, 0);
+
+        // Where the first value of each digit in each chunk goes: an
+        // exclusive prefix sum over the counts, digit-major.
+        Func offsets("radix_offsets");
+        offsets(d, c) = 0;
+        RDom ro(0, num_chunks, 0, radix);
+        Expr prev_d = select(ro.x == 0, max(ro.y - 1, 0), ro.y);
+        Expr prev_c = select(ro.x == 0, num_chunks - 1, ro.x - 1);
+        offsets(ro.y, ro.x) = select(ro.x == 0 && ro.y == 0, 0,
+                                     offsets(prev_d, prev_c) + counts(prev_d, prev_c));
+
+        // How many values of each digit are at or before each
+        // position in a chunk. This keeps the sort stable.
+        Func rank("radix_rank");
+        rank(d, r, c) = select(digit(c * chunk_size + r) == d, 1, 0);
+        RDom rr(1, chunk_size - 1);
+        rank(d, rr, c) += rank(d, rr - 1, c);
+
+        // Scatter each value to its place. The destinations are all
+        // distinct, so chunks can be scattered in parallel.
+        out = Func("radix_pass");
+        out(i) = cast(t, 0);
+        RDom rs(0, chunk_size, 0, num_chunks);
+        Expr src = rs.y * chunk_size + rs.x;
+        rs.where(src < size);
+        Expr src_digit = digit(src);
+        Expr dst = clamp(offsets(src_digit, rs.y) + rank(src_digit, rs.x, rs.y) - 1, 0, size - 1);
+        out(dst) = value(src);
+
+        counts.compute_root()
+            .bound(d, 0, radix)
+            .vectorize(d);
+        counts.update()
+            .parallel(c);
+        offsets.compute_root();
+        rank.compute_at(out, rs.y)
+            .bound(d, 0, radix)
+            .vectorize(d);
+        rank.update()
+            .reorder(d, rr)
+            .vectorize(d);
+        out.compute_root()
+            .vectorize(i, 8, TailStrategy::GuardWithIf);
+        out.update()
+            .allow_race_conditions()
+            .parallel(rs.y);
+
+        in = out;
+    }
+
+    return out;
+}
+
+}  // namespace Sorting
+
+}  // namespace Halide
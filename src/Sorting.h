@@ -0,0 +1,73 @@
+#ifndef HALIDE_SORTING_H
+#define HALIDE_SORTING_H
+
+/** \file
+ * Sorting and selection primitives built out of Halide Funcs and Exprs.
+ */
+
+#include <vector>
+
+#include "Func.h"
+#include "IR.h"
+
+namespace Halide {
+
+/** namespace to hold functions that sort or select values.
+ *
+ *  The small-N helpers operate on lists of Exprs and are built
+ *  entirely out of min and max, so they vectorize along whatever
+ *  dimension their consumer is vectorized over. The helpers that sort
+ *  a whole Func return a compute_root Func that holds the sorted
+ *  values, with the intermediate stages already scheduled.
+ */
+namespace Sorting {
+
+/** Sort a list of values in ascending order using Batcher's odd-even
+ *  merge sort network. Any number of values may be passed; lists
+ *  whose size is not a power of two use the network for the next
+ *  power of two, with the comparisons against the padding
+ *  removed. The outputs share subexpressions, so this is meant for
+ *  small lists (up to a few dozen values). */
+std::vector<Expr> sorting_network(const std::vector<Expr> &values);
+
+/** Return the k-th smallest of a list of values (counting from
+ *  zero). Only the comparisons of the sorting network that the k-th
+ *  output depends on are kept. */
+Expr kth_smallest(const std::vector<Expr> &values, int k);
+
+/** Return the median of a list of values. For lists of even size,
+ *  this is the lower of the two middle values. E.g. a 3x3 median
+ *  filter is:
+ \code
+ std::vector<Expr> window;
+ for (int dy = -1; dy <= 1; dy++) {
+     for (int dx = -1; dx <= 1; dx++) {
+         window.push_back(input(x + dx, y + dy));
+     }
+ }
+ median_filtered(x, y) = Sorting::median(window);
+ \endcode
+ */
+Expr median(const std::vector<Expr> &values);
+
+/** Sort the values of a one-dimensional Func over [0, size) with a
+ *  bitonic sorting network. size must be a power of two. Each pass of
+ *  the network is a compute_root stage, vectorized and parallelized
+ *  over blocks of the input. */
+Func bitonic_sort(const Func &input, int size);
+
+/** Sort the values of a one-dimensional Func over [0, size) with a
+ *  stable least-significant-digit radix sort, four bits at a
+ *  time. The values must be unsigned integers, and only the low
+ *  key_bits bits of each value are used as the key. Each pass
+ *  histograms the digits of independent chunks of the input in
+ *  parallel, takes a prefix sum over the histograms to find where each
+ *  chunk's values of each digit go, and then scatters the chunks in
+ *  parallel. */
+Func radix_sort(const Func &input, Expr size, int key_bits = 32);
+
+}  // namespace Sorting
+
+}  // namespace Halide
+
+#endif
@@ -1,6 +1,8 @@
 #include "SplitTuples.h"
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
+#include "IROperator.h"
 
 namespace Halide {
 namespace Internal {
@@ -56,9 +58,41 @@ class SplitTuples : public IRMutator2 {
 
     map<string, set<int>> func_value_indices;
 
+    // Is a Tuple-valued Func stored interleaved in one buffer, as the
+    // innermost dimension of it. Outputs aren't realized here, so they
+    // are always split.
+    bool interleaved(const string &name) {
+        if (!realizations.contains(name)) {
+            return false;
+        }
+        auto it = env.find(name);
+        internal_assert(it != env.end());
+        return it->second.outputs() > 1 && it->second.schedule().store_interleaved();
+    }
+
     Stmt visit(const Realize *op) override {
         ScopedBinding<int> bind(realizations, op->name, 0);
-        if (op->types.size() > 1) {
+        if (interleaved(op->name)) {
+            user_assert(!env.at(op->name).schedule().memoized())
+                << "The Tuple elements of " << op->name << " can't be stored interleaved, "
+                << "because it is memoized.\n";
+            for (Type t : op->types) {
+                user_assert(t.bits() == op->types[0].bits() && t.lanes() == op->types[0].lanes())
+                    << "The Tuple elements of " << op->name << " can't be stored interleaved, "
+                    << "because they are of different sizes (" << op->types[0] << " and " << t << ").\n";
+            }
+            for (size_t i = 0; i < op->types.size(); i++) {
+                user_assert(!stmt_uses_var(op->body, op->name + "." + std::to_string(i) + ".buffer"))
+                    << "The Tuple elements of " << op->name << " are stored interleaved, so they "
+                    << "can't be accessed through a buffer, as extern stages, tracing, and "
+                    << "debug_to_file do.\n";
+            }
+            // One realization, with the Tuple index as a new innermost
+            // dimension.
+            Region bounds = {Range(0, (int)op->types.size())};
+            bounds.insert(bounds.end(), op->bounds.begin(), op->bounds.end());
+            return Realize::make(op->name, {op->types[0]}, op->memory_type, bounds, op->condition, mutate(op->body));
+        } else if (op->types.size() > 1) {
             // Make a nested set of realize nodes for each tuple element
             Stmt body = mutate(op->body);
             for (int i = (int)op->types.size() - 1; i >= 0; i--) {
@@ -83,7 +117,11 @@ class SplitTuples : public IRMutator2 {
     }
 
     Stmt visit(const Prefetch *op) override {
-        if (!op->prefetch.param.defined() && (op->types.size() > 1)) {
+        if (!op->prefetch.param.defined() && interleaved(op->name)) {
+            Region bounds = {Range(0, (int)op->types.size())};
+            bounds.insert(bounds.end(), op->bounds.begin(), op->bounds.end());
+            return Prefetch::make(op->name, {op->types[0]}, bounds, op->prefetch, op->condition, mutate(op->body));
+        } else if (!op->prefetch.param.defined() && (op->types.size() > 1)) {
             Stmt body = mutate(op->body);
             // Split the prefetch from a multi-dimensional halide tuple to
             // prefetches of each tuple element. Keep only prefetches of
@@ -107,10 +145,13 @@ class SplitTuples : public IRMutator2 {
             internal_assert(it != env.end());
             Function f = it->second;
             string name = op->name;
-            if (f.outputs() > 1) {
+            vector<Expr> args;
+            bool is_interleaved = interleaved(op->name);
+            if (is_interleaved) {
+                args.push_back(op->value_index);
+            } else if (f.outputs() > 1) {
                 name += "." + std::to_string(op->value_index);
             }
-            vector<Expr> args;
             for (Expr e : op->args) {
                 args.push_back(mutate(e));
             }
@@ -118,6 +159,12 @@ class SplitTuples : public IRMutator2 {
             // unconditionally. This expr never gets held by a
             // Function, so there can't be a cycle. We do this even
             // for scalar provides.
+            if (is_interleaved) {
+                // The buffer holds the type of the first element.
+                Type t = f.output_types()[0].with_lanes(op->type.lanes());
+                Expr load = Call::make(t, name, args, op->call_type, f.get_contents());
+                return t == op->type ? load : reinterpret(op->type, load);
+            }
             return Call::make(op->type, name, args, op->call_type, f.get_contents());
         } else {
             return IRMutator2::visit(op);
@@ -165,6 +212,7 @@ class SplitTuples : public IRMutator2 {
         vector<Stmt> provides;
         vector<pair<string, Expr>> lets;
 
+        bool is_interleaved = interleaved(op->name);
         for (size_t i = 0; i < op->values.size(); i++) {
             string name = op->name + "." + std::to_string(i);
             string var_name = name + ".value";
@@ -173,7 +221,19 @@ class SplitTuples : public IRMutator2 {
                 lets.push_back({ var_name, val });
                 val = Variable::make(val.type(), var_name);
             }
-            provides.push_back(Provide::make(name, {val}, args));
+            if (is_interleaved) {
+                // Store the values next to each other, so that
+                // vectors of them become one interleaved store.
+                Type t = f.output_types()[0].with_lanes(val.type().lanes());
+                if (!is_undef(val) && val.type() != t) {
+                    val = reinterpret(t, val);
+                }
+                vector<Expr> interleaved_args = {(int)i};
+                interleaved_args.insert(interleaved_args.end(), args.begin(), args.end());
+                provides.push_back(Provide::make(op->name, {val}, interleaved_args));
+            } else {
+                provides.push_back(Provide::make(name, {val}, args));
+            }
         }
 
         Stmt result = Block::make(provides);
@@ -2,10 +2,13 @@
 #include "IRVisitor.h"
 #include "IROperator.h"
 #include "Scope.h"
+#include "Simplify.h"
+#include "Util.h"
 
 #include <iterator>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <stdio.h>
 
@@ -22,6 +25,82 @@ std::string to_string(T value) {
     return os.str() ;
 }
 
+string escape_html(const string &s) {
+    string result;
+    for (char c : s) {
+        if (c == '<') {
+            result += "&lt;";
+        } else if (c == '>') {
+            result += "&gt;";
+        } else if (c == '&') {
+            result += "&amp;";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Sum up the bytes loaded and stored by a statement, multiplying
+// those inside inner loops by the loop extents. Both branches of
+// conditionals are counted, so this is an upper bound.
+class LoopFootprint : public IRVisitor {
+    using IRVisitor::visit;
+
+    Expr multiplier = make_const(Int(64), 1);
+
+    void visit(const Load *op) override {
+        IRVisitor::visit(op);
+        loaded += multiplier * (op->type.bytes() * op->type.lanes());
+    }
+
+    void visit(const Store *op) override {
+        IRVisitor::visit(op);
+        stored += multiplier * (op->value.type().bytes() * op->value.type().lanes());
+    }
+
+    void visit(const For *op) override {
+        Expr old_multiplier = multiplier;
+        multiplier *= cast<int64_t>(op->extent);
+        op->body.accept(this);
+        multiplier = old_multiplier;
+    }
+
+public:
+    Expr loaded = make_const(Int(64), 0), stored = make_const(Int(64), 0);
+};
+
+// Read the per-Func lines of a report printed by the profiler (a
+// pipeline compiled with the profile feature) into a map from Func
+// name to the stats on its line. Funcs are indented by two spaces.
+std::map<string, string> load_profile(const string &filename) {
+    std::map<string, string> result;
+    std::ifstream in(filename);
+    user_assert(in) << "Could not open profile " << filename << " to annotate the html output\n";
+    string line;
+    while (std::getline(in, line)) {
+        if (line.size() < 3 || line[0] != ' ' || line[1] != ' ' || line[2] == ' ') {
+            continue;
+        }
+        size_t colon = line.find(": ");
+        if (colon == string::npos) {
+            continue;
+        }
+        string name = line.substr(2, colon - 2);
+        // Collapse the padding between the columns.
+        string stats;
+        for (size_t i = colon + 2; i < line.size(); i++) {
+            if (line[i] != ' ' || (!stats.empty() && stats.back() != ' ')) {
+                stats += line[i];
+            }
+        }
+        if (!result.count(name)) {
+            result[name] = stats;
+        }
+    }
+    return result;
+}
+
 class StmtToHtml : public IRVisitor {
 
     static const std::string css, js;
@@ -29,6 +108,9 @@ class StmtToHtml : public IRVisitor {
     // This allows easier access to individual elements.
     int id_count;
 
+    // Stats per Func from a profiler report, if one was given.
+    std::map<string, string> profile;
+
 private:
     std::ofstream stream;
 
@@ -88,6 +170,26 @@ private:
     string open_line() { return "<p class=WrapLine>"; }
     string close_line() { return "</p>"; }
 
+    string comment(const string &x) { return span("Comment", "// " + escape_html(x)); }
+    string profile_comment(const string &x) { return span("Profile", "// " + escape_html(x)); }
+
+    // The profile stats for a Func or one of its buffers (e.g. f.0),
+    // as a comment, if there are any.
+    string profile_of(const string &name) {
+        auto it = profile.find(split_string(name, ".")[0]);
+        if (it == profile.end()) {
+            return "";
+        }
+        return " " + profile_comment("profile: " + it->second);
+    }
+
+    string bytes_to_string(Expr e) {
+        e = simplify(e);
+        std::ostringstream s;
+        s << e;
+        return s.str();
+    }
+
     string keyword(const string &x) { return span("Keyword", x); }
     string type(const string &x) { return span("Type", x); }
     string symbol(const string &x) { return span("Symbol", x); }
@@ -334,6 +436,9 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();;
+        if (op->is_producer) {
+            stream << profile_of(op->name);
+        }
         stream << open_div(op->is_producer ? "ProduceBody Indent" : "ConsumeBody Indent", produce_id);
         print(op->body);
         stream << close_div();
@@ -357,6 +462,8 @@ private:
             stream << keyword("vectorized");
         } else if (op->for_type == ForType::Unrolled) {
             stream << keyword("unrolled");
+        } else if (op->for_type == ForType::UnrolledAndJammed) {
+            stream << keyword("unrolled_and_jammed");
         } else if (op->for_type == ForType::GPUBlock) {
             stream << keyword("gpu_block");
         } else if (op->for_type == ForType::GPUThread) {
@@ -372,6 +479,13 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        LoopFootprint footprint;
+        op->body.accept(&footprint);
+        if (!is_zero(simplify(footprint.loaded + footprint.stored))) {
+            stream << " " << comment("per iteration: " +
+                                     bytes_to_string(footprint.loaded) + " bytes loaded, " +
+                                     bytes_to_string(footprint.stored) + " bytes stored");
+        }
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
@@ -400,6 +514,23 @@ private:
         stream << close_div();
     }
 
+    void visit(const Atomic *op) override {
+        stream << open_div("Atomic");
+        int id = unique_id();
+        stream << open_span("Matched");
+        stream << open_expand_button(id);
+        stream << keyword("atomic (");
+        stream << close_span();
+        stream << var(op->producer_name);
+        stream << matched(")");
+        stream << close_expand_button() << " {";
+        stream << open_div("Atomic Indent", id);
+        print(op->body);
+        stream << close_div();
+        stream << matched("}");
+        stream << close_div();
+    }
+
     void visit(const Store *op) override {
         stream << open_div("Store WrapLine");
         stream << open_span("Matched");
@@ -465,6 +596,13 @@ private:
             stream << matched("}");
         }
 
+        Expr size = make_const(Int(64), op->type.bytes() * op->type.lanes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        stream << " " << comment(bytes_to_string(size) + " bytes");
+        stream << profile_of(op->name);
+
         stream << open_div("AllocateBody");
         print(op->body);
         stream << close_div();
@@ -727,6 +865,10 @@ public:
     }
 
     StmtToHtml(string filename) : id_count(0), context_stack(1, 0) {
+        string profile_file = get_env_variable("HL_STMT_HTML_PROFILE");
+        if (!profile_file.empty()) {
+            profile = load_profile(profile_file);
+        }
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -758,6 +900,7 @@ div.WrapLine { margin-left: 30px; text-indent:-30px; } \n \
 div.Indent { padding-left: 15px; }\n \
 div.ShowHide { position:absolute; left:-12px; width:12px; height:12px; } \n \
 span.Comment { color: #998; font-style: italic; }\n \
+span.Profile { color: #c33; font-style: italic; }\n \
 span.Keyword { color: #333; font-weight: bold; }\n \
 span.Assign { color: #d14; font-weight: bold; }\n \
 span.Symbol { color: #990073; }\n \
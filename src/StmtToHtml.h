@@ -11,7 +11,14 @@ namespace Halide {
 namespace Internal {
 
 /**
- * Dump an HTML-formatted print of a Stmt to filename.
+ * Dump an HTML-formatted print of a Stmt to filename. Each loop is
+ * annotated with a static estimate of the bytes loaded and stored per
+ * iteration, and each allocation with its size. If the
+ * HL_STMT_HTML_PROFILE environment variable names a file holding a
+ * report printed by the profiler (e.g. from a run with the profile
+ * and profile_by_thread features), the produce node and allocations
+ * of each Func are also annotated with its stats from that report:
+ * time, memory, and hardware counters such as cache misses.
  */
 void print_to_html(std::string filename, Stmt s);
 
@@ -1,12 +1,15 @@
 #include "StorageFlattening.h"
 
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "FuseGPUThreadLoops.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Parameter.h"
 #include "Scope.h"
+#include "Simplify.h"
 
+#include <algorithm>
 #include <sstream>
 
 namespace Halide {
@@ -21,6 +24,120 @@ using std::set;
 
 namespace {
 
+// Check whether consecutive threads of a GPU block access a function
+// along a dimension other than its innermost storage dimension, as in a
+// transpose. In shared memory such accesses are a row apart, and hit the
+// same bank whenever the row size is a multiple of the bank stride.
+class FindThreadStridedAccess : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &func;
+    int innermost;
+
+    // The innermost thread loop variables, and the lets that depend on
+    // them.
+    Scope<> varying;
+
+    void check(const vector<Expr> &args) {
+        if (args.size() < 2 ||
+            expr_uses_vars(args[innermost], varying)) {
+            return;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            if ((int)i != innermost && expr_uses_vars(args[i], varying)) {
+                result = true;
+            }
+        }
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        if ((op->for_type == ForType::GPUThread ||
+             op->for_type == ForType::GPULane) &&
+            ends_with(op->name, ".__thread_id_x")) {
+            ScopedBinding<> bind(varying, op->name);
+            op->body.accept(this);
+        } else {
+            op->body.accept(this);
+        }
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(expr_uses_vars(op->value, varying), varying, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(expr_uses_vars(op->value, varying), varying, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Provide *op) override {
+        IRVisitor::visit(op);
+        if (op->name == func) {
+            check(op->args);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide && op->name == func) {
+            check(op->args);
+        }
+    }
+
+public:
+    bool result = false;
+    FindThreadStridedAccess(const string &func, int innermost) : func(func), innermost(innermost) {}
+};
+
+// The dimensions of a Func tiled by store_tiled.
+struct Tiling {
+    // The positions of the tiled dimensions in the Func's args.
+    int x, y;
+    int tile_x, tile_y;
+    bool morton;
+};
+
+bool get_tiling(const Function &f, Tiling &t) {
+    const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
+    if (storage_dims.size() < 2 || storage_dims[0].tile_extent == 0) {
+        for (const StorageDim &d : storage_dims) {
+            user_assert(d.tile_extent == 0)
+                << "The storage of " << f.name() << " is tiled, but its tiled dimensions "
+                << "are no longer its innermost storage dimensions.\n";
+        }
+        return false;
+    }
+    user_assert(storage_dims[1].tile_extent > 0)
+        << "The storage of " << f.name() << " is tiled, but its tiled dimensions "
+        << "are no longer its innermost storage dimensions.\n";
+    const vector<string> &args = f.args();
+    t.x = (int)(std::find(args.begin(), args.end(), storage_dims[0].var) - args.begin());
+    t.y = (int)(std::find(args.begin(), args.end(), storage_dims[1].var) - args.begin());
+    t.tile_x = storage_dims[0].tile_extent;
+    t.tile_y = storage_dims[1].tile_extent;
+    t.morton = storage_dims[0].morton;
+    return true;
+}
+
+// Spread the low bits of a non-negative value out to the even bit
+// positions.
+Expr spread_bits(Expr v, int bits) {
+    const struct {
+        int shift, mask;
+    } steps[] = {{8, 0x00ff00ff}, {4, 0x0f0f0f0f}, {2, 0x33333333}, {1, 0x55555555}};
+    for (const auto &s : steps) {
+        if (bits > s.shift) {
+            v = (v | (v << s.shift)) & s.mask;
+        }
+    }
+    return v;
+}
+
 class FlattenDimensions : public IRMutator2 {
 public:
     FlattenDimensions(const map<string, pair<Function, int>> &e,
@@ -29,6 +146,13 @@ public:
         : env(e), target(t) {
         for (auto &f : o) {
             outputs.insert(f.name());
+            Tiling tiling;
+            user_assert(!get_tiling(f, tiling))
+                << "The storage of " << f.name() << " can't be tiled, because it is an output.\n";
+            user_assert(f.schedule().packed_bits() == 0)
+                << "The storage of " << f.name() << " can't be packed, because it is an output.\n";
+            user_assert(!f.schedule().store_interleaved() || f.outputs() == 1)
+                << "The Tuple elements of " << f.name() << " can't be stored interleaved, because it is an output.\n";
         }
     }
 private:
@@ -37,6 +161,32 @@ private:
     const Target &target;
     Scope<> realizations, shader_scope_realizations;
     bool in_shader = false;
+    bool in_gpu_block = false, in_gpu_threads = false;
+
+    // The number of bits the elements of a realization are packed
+    // into, or zero if they aren't packed.
+    int packed_bits(const string &name) {
+        if (!realizations.contains(name)) {
+            return 0;
+        }
+        auto it = env.find(name);
+        if (it == env.end()) {
+            return 0;
+        }
+        int bits = it->second.first.schedule().packed_bits();
+        user_assert(bits == 0 || !(in_gpu_block || in_gpu_threads || in_shader))
+            << "The storage of " << name << " is packed, so it can't be used on a GPU.\n";
+        return bits;
+    }
+
+    // Is a name the single realization of a Tuple-valued Func whose
+    // elements are stored interleaved. See split_tuples.
+    bool is_interleaved(const string &name) {
+        auto it = env.find(name);
+        return (it != env.end() &&
+                it->second.first.outputs() > 1 &&
+                it->first == it->second.first.name());
+    }
 
     Expr make_shape_var(string name, string field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
@@ -48,6 +198,12 @@ private:
     Expr flatten_args(const string &name, vector<Expr> args,
                       const Buffer<> &buf, const Parameter &param) {
         bool internal = realizations.contains(name);
+        Tiling tiling;
+        bool tiled = false;
+        if (internal) {
+            auto it = env.find(name);
+            tiled = it != env.end() && get_tiling(it->second.first, tiling);
+        }
         Expr idx = target.has_large_buffers() ? make_zero(Int(64)) : 0;
         vector<Expr> mins(args.size()), strides(args.size());
 
@@ -65,6 +221,10 @@ private:
         // taps can share the same base address.
         Expr constant_term = zero;
         for (size_t i = 0; i < args.size(); i++) {
+            if (tiled && ((int)i == tiling.x || (int)i == tiling.y)) {
+                // An offset may move to another tile.
+                continue;
+            }
             const Add *add = args[i].as<Add>();
             if (add && is_const(add->b)) {
                 constant_term += strides[i] * add->b;
@@ -77,8 +237,40 @@ private:
             // strategy makes sense when we expect x to cancel with
             // something in xmin.  We use this for internal allocations.
             for (size_t i = 0; i < args.size(); i++) {
+                if (tiled && ((int)i == tiling.x || (int)i == tiling.y)) {
+                    continue;
+                }
                 idx += (args[i] - mins[i]) * strides[i];
             }
+            if (tiled) {
+                // The tiles are stored one after the other in row
+                // major order. The y stride is the row size of the
+                // untiled layout, so a row of tiles is tile_y times
+                // that.
+                Expr x = args[tiling.x] - mins[tiling.x];
+                Expr y = args[tiling.y] - mins[tiling.y];
+                Expr tile_x = x / tiling.tile_x, tile_y = y / tiling.tile_y;
+                x = x % tiling.tile_x;
+                y = y % tiling.tile_y;
+                Expr within;
+                if (tiling.morton) {
+                    int bits = 0;
+                    while ((1 << bits) < tiling.tile_x) {
+                        bits++;
+                    }
+                    within = spread_bits(x, bits) | (spread_bits(y, bits) << 1);
+                } else {
+                    within = x + y * tiling.tile_x;
+                }
+                Expr tile_size = tiling.tile_x * tiling.tile_y;
+                if (target.has_large_buffers()) {
+                    within = cast<int64_t>(within);
+                    tile_x = cast<int64_t>(tile_x);
+                    tile_y = cast<int64_t>(tile_y);
+                    tile_size = cast<int64_t>(tile_size);
+                }
+                idx += within + tile_x * tile_size + tile_y * strides[tiling.y] * tiling.tile_y;
+            }
         } else {
             // f(x, y) -> f[x*stride + y*ystride - (xstride*xmin +
             // ystride*ymin)]. The idea here is that the last term
@@ -131,30 +323,98 @@ private:
         // also affects the device allocation in some backends).
         vector<Expr> allocation_extents(extents.size());
         vector<int> storage_permutation;
+        Tiling tiling;
+        bool tiled = false;
+        int bits = 0;
         {
             auto iter = env.find(op->name);
             internal_assert(iter != env.end()) << "Realize node refers to function not in environment.\n";
             Function f = iter->second.first;
+            // The Tuple index of interleaved storage is the innermost
+            // dimension, before those of the Func.
+            int interleaved = is_interleaved(op->name) ? 1 : 0;
+            if (interleaved) {
+                storage_permutation.push_back(0);
+                allocation_extents[0] = extents[0];
+            }
             const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
             const vector<string> &args = f.args();
             for (size_t i = 0; i < storage_dims.size(); i++) {
                 for (size_t j = 0; j < args.size(); j++) {
                     if (args[j] == storage_dims[i].var) {
-                        storage_permutation.push_back((int)j);
+                        int k = (int)j + interleaved;
+                        storage_permutation.push_back(k);
                         Expr alignment = storage_dims[i].alignment;
                         if (alignment.defined()) {
-                            allocation_extents[j] = ((extents[j] + alignment - 1)/alignment)*alignment;
+                            allocation_extents[k] = ((extents[k] + alignment - 1)/alignment)*alignment;
                         } else {
-                            allocation_extents[j] = extents[j];
+                            allocation_extents[k] = extents[k];
                         }
                     }
                 }
-                internal_assert(storage_permutation.size() == i+1);
+                internal_assert(storage_permutation.size() == i + 1 + interleaved);
+            }
+
+            if (get_tiling(f, tiling)) {
+                user_assert(!interleaved)
+                    << "The storage of " << f.name() << " can't be both tiled and interleaved.\n";
+                tiled = true;
+                user_assert(!stmt_uses_var(op->body, op->name + ".buffer"))
+                    << "The storage of " << f.name() << " is tiled, so it can't be "
+                    << "accessed through a buffer, as extern stages, tracing, and "
+                    << "debug_to_file do.\n";
+                // Round the tiled dimensions up to whole tiles.
+                Expr &x = allocation_extents[tiling.x];
+                Expr &y = allocation_extents[tiling.y];
+                x = ((x + tiling.tile_x - 1) / tiling.tile_x) * tiling.tile_x;
+                y = ((y + tiling.tile_y - 1) / tiling.tile_y) * tiling.tile_y;
             }
+
+            bits = f.schedule().packed_bits();
         }
 
         internal_assert(storage_permutation.size() == op->bounds.size());
 
+        if (bits) {
+            Type t = op->types[0];
+            user_assert(!(in_gpu_block || in_gpu_threads || in_shader))
+                << "The storage of " << op->name << " is packed, so it can't be used on a GPU.\n";
+            user_assert(t.is_bool() || t.is_int() || t.is_uint())
+                << "The storage of " << op->name << " can't be packed, because its type "
+                << t << " isn't an integer or boolean type.\n";
+            user_assert(!stmt_uses_var(op->body, op->name + ".buffer"))
+                << "The storage of " << op->name << " is packed, so it can't be "
+                << "accessed through a buffer, as extern stages, tracing, and "
+                << "debug_to_file do.\n";
+            if (!tiled && !storage_permutation.empty()) {
+                // Start each row on a byte boundary, so that aligned
+                // vectors in the innermost dimension cover whole bytes.
+                Expr &e = allocation_extents[storage_permutation[0]];
+                e = ((e + 7) / 8) * 8;
+            }
+        }
+
+        // Realizations at GPU block level live in shared memory. If
+        // threads access them strided by the row size, pad the rows so
+        // that consecutive rows start in different banks. The padding
+        // makes the row size an odd number of 32-bit words.
+        if (in_gpu_block && !in_gpu_threads && !in_shader && !tiled &&
+            (op->memory_type == MemoryType::Auto ||
+             op->memory_type == MemoryType::GPUShared) &&
+            op->bounds.size() > 1) {
+            int innermost = storage_permutation[0];
+            FindThreadStridedAccess strided(op->name, innermost);
+            op->body.accept(&strided);
+            if (strided.result) {
+                int elems_per_word = std::max(1, 4 / op->types[0].bytes());
+                Expr e = allocation_extents[innermost];
+                Expr pad = select(e % (2 * elems_per_word) == 0, elems_per_word, 0);
+                allocation_extents[innermost] = simplify(e + pad);
+                debug(3) << "Padding rows of shared allocation " << op->name
+                         << " to avoid bank conflicts: " << allocation_extents[innermost] << "\n";
+            }
+        }
+
         Stmt stmt = body;
         internal_assert(op->types.size() == 1);
 
@@ -187,7 +447,18 @@ private:
         stmt = LetStmt::make(op->name + ".buffer", builder.build(), stmt);
 
         // Make the allocation node
-        stmt = Allocate::make(op->name, op->types[0], op->memory_type, allocation_extents, condition, stmt);
+        if (bits) {
+            // Packed realizations are accessed a byte at a time.
+            Expr size = 1;
+            for (const Expr &e : allocation_extents) {
+                size *= e;
+            }
+            int elems_per_byte = 8 / bits;
+            size = (size + elems_per_byte - 1) / elems_per_byte;
+            stmt = Allocate::make(op->name, UInt(8), op->memory_type, {size}, condition, stmt);
+        } else {
+            stmt = Allocate::make(op->name, op->types[0], op->memory_type, allocation_extents, condition, stmt);
+        }
 
         // Compute the strides
         for (int i = (int)op->bounds.size()-1; i > 0; i--) {
@@ -215,10 +486,12 @@ private:
         internal_assert(op->values.size() == 1);
 
         Parameter output_buf;
+        bool nontemporal = false;
         auto it = env.find(op->name);
         if (it != env.end()) {
             const Function &f = it->second.first;
             int idx = it->second.second;
+            nontemporal = f.schedule().store_nontemporal();
 
             // We only want to do this for actual pipeline outputs,
             // even though every Function has an output buffer. Any
@@ -243,8 +516,19 @@ private:
             Expr store = Call::make(value.type(), Call::image_store,
                                     args, Call::Intrinsic);
             return Evaluate::make(store);
+        } else if (int bits = packed_bits(op->name)) {
+            Expr idx = mutate(flatten_args(op->name, op->args, Buffer<>(), output_buf));
+            Expr store = Call::make(value.type(), Call::store_packed,
+                                    {Variable::make(Handle(), op->name), idx, value, bits},
+                                    Call::Intrinsic);
+            return Evaluate::make(store);
         } else {
             Expr idx = mutate(flatten_args(op->name, op->args, Buffer<>(), output_buf));
+            if (nontemporal) {
+                // Mark the value so that codegen emits a store that
+                // bypasses the cache.
+                value = Call::make(value.type(), Call::nontemporal, {value}, Call::PureIntrinsic);
+            }
             return Store::make(op->name, value, idx, output_buf, const_true(value.type().lanes()));
         }
     }
@@ -287,6 +571,11 @@ private:
                                   0,
                                   op->image,
                                   op->param);
+            } else if (int bits = packed_bits(op->name)) {
+                Expr idx = mutate(flatten_args(op->name, op->args, op->image, op->param));
+                return Call::make(op->type, Call::load_packed,
+                                  {Variable::make(Handle(), op->name), idx, bits},
+                                  Call::Intrinsic);
             } else {
                 Expr idx = mutate(flatten_args(op->name, op->args, op->image, op->param));
                 return Load::make(op->type, op->name, idx, op->image, op->param,
@@ -324,15 +613,19 @@ private:
             vector<int> storage_permutation;
             {
                 Function f = iter->second.first;
+                int interleaved = is_interleaved(op->name) ? 1 : 0;
+                if (interleaved) {
+                    storage_permutation.push_back(0);
+                }
                 const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
                 const vector<string> &args = f.args();
                 for (size_t i = 0; i < storage_dims.size(); i++) {
                     for (size_t j = 0; j < args.size(); j++) {
                         if (args[j] == storage_dims[i].var) {
-                            storage_permutation.push_back((int)j);
+                            storage_permutation.push_back((int)j + interleaved);
                         }
                     }
-                    internal_assert(storage_permutation.size() == i+1);
+                    internal_assert(storage_permutation.size() == i + 1 + interleaved);
                 }
             }
             internal_assert(storage_permutation.size() == op->bounds.size());
@@ -364,6 +657,10 @@ private:
             op->device_api == DeviceAPI::GLSL) {
             in_shader = true;
         }
+        ScopedValue<bool> old_in_gpu_block(in_gpu_block, in_gpu_block || op->for_type == ForType::GPUBlock);
+        ScopedValue<bool> old_in_gpu_threads(in_gpu_threads, in_gpu_threads ||
+                                             op->for_type == ForType::GPUThread ||
+                                             op->for_type == ForType::GPULane);
         Stmt stmt = IRMutator2::visit(op);
         in_shader = old_in_shader;
         return stmt;
@@ -434,6 +731,11 @@ Stmt storage_flattening(Stmt s,
             for (int i = 0; i < p.second.outputs(); i++) {
                 tuple_env[p.first + "." + std::to_string(i)] = {p.second, i};
             }
+            if (p.second.schedule().store_interleaved()) {
+                // The Tuple elements are realized together, under the
+                // name of the Function.
+                tuple_env[p.first] = {p.second, 0};
+            }
         } else {
             tuple_env[p.first] = {p.second, 0};
         }
@@ -417,7 +417,40 @@ class AttemptStorageFoldingOfFunction : public IRMutator2 {
         }
     }
 
+    // The lets and loops between the realization of the Func and
+    // the current node. Fold factors computed at runtime must not
+    // depend on anything defined in here.
+    vector<std::pair<string, Expr>> lets_inside;
+    Scope<> defined_inside;
+
+    // Find an upper bound on an expression over all iterations of a
+    // loop that can be computed where the Func is realized, or return
+    // an undefined Expr if there isn't one.
+    Expr upper_bound_at_realization(Expr e, const Scope<Interval> &loop_bounds) {
+        Interval i = bounds_of_expr_in_scope(e, loop_bounds);
+        if (!i.has_upper_bound()) {
+            return Expr();
+        }
+        Expr b = i.max;
+        for (auto it = lets_inside.rbegin(); it != lets_inside.rend(); it++) {
+            b = substitute(it->first, it->second, b);
+        }
+        if (!is_pure(b) || expr_uses_vars(b, defined_inside)) {
+            return Expr();
+        }
+        return simplify(b);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        lets_inside.push_back({op->name, op->value});
+        ScopedBinding<> bind(defined_inside, op->name);
+        Stmt stmt = IRMutator2::visit(op);
+        lets_inside.pop_back();
+        return stmt;
+    }
+
     Stmt visit(const For *op) override {
+        ScopedBinding<> bind(defined_inside, op->name);
         if (op->for_type != ForType::Serial && op->for_type != ForType::Unrolled) {
             // We can't proceed into a parallel for loop.
 
@@ -614,7 +647,14 @@ class AttemptStorageFoldingOfFunction : public IRMutator2 {
                 const int max_fold = 1024;
                 const int64_t *const_max_extent = as_const_int(max_extent);
                 if (const_max_extent && *const_max_extent <= max_fold) {
-                    factor = static_cast<int>(next_power_of_two(*const_max_extent));
+                    // A power-of-two factor makes the modulus a mask,
+                    // but the modulus by any other constant is only a
+                    // multiply and a shift, and it's usually hoisted
+                    // out of the innermost loop. Only round up if it
+                    // wastes little memory.
+                    int64_t tight = *const_max_extent;
+                    int64_t pow2 = next_power_of_two(tight);
+                    factor = static_cast<int>(pow2 * 4 <= tight * 5 ? pow2 : tight);
                 } else {
                         // Try a little harder to find a bounding power of two
                         int e = max_fold * 2;
@@ -623,8 +663,24 @@ class AttemptStorageFoldingOfFunction : public IRMutator2 {
                             success = true;
                             e /= 2;
                         }
+                        Expr runtime_factor;
+                        if (!success && !func.schedule().async() && dynamic_footprint.empty()) {
+                            runtime_factor = upper_bound_at_realization(extent, bounds);
+                        }
                         if (success) {
                             factor = e;
+                        } else if (runtime_factor.defined()) {
+                            // The extent depends on something only
+                            // known at runtime (e.g. a Param). Fold
+                            // by a factor computed where the Func is
+                            // realized, and check it's large enough.
+                            string name = unique_name(func.name() + ".fold_factor");
+                            factor = Variable::make(Int(32), name);
+                            runtime_factors.push_back({name, Halide::max(runtime_factor, 1)});
+                            Expr error = Call::make(Int(32), "halide_error_fold_factor_too_small",
+                                                    {func.name(), storage_dim.var, factor, op->name, extent},
+                                                    Call::Extern);
+                            body = Block::make(AssertStmt::make(extent <= factor, error), body);
                         } else {
                             debug(3) << "Not folding because extent not bounded by a constant not greater than " << max_fold << "\n"
                                      << "extent = " << extent << "\n"
@@ -633,6 +689,17 @@ class AttemptStorageFoldingOfFunction : public IRMutator2 {
                             continue;
                         }
                 }
+
+                if (func.schedule().async()) {
+                    // A circular buffer that only holds one
+                    // iteration's footprint would make the producer
+                    // wait for the consumer to release all of it
+                    // before producing the next, so nothing would
+                    // overlap. Double-buffer it instead, so the
+                    // producer (e.g. a DMA copy) can fill the next
+                    // tile while the consumer works on this one.
+                    factor = simplify(factor * 2);
+                }
             }
 
             internal_assert(factor.defined());
@@ -804,6 +871,8 @@ public:
         bool fold_forward;
     };
     vector<Fold> dims_folded;
+    // The names and values of the fold factors computed at runtime.
+    vector<std::pair<string, Expr>> runtime_factors;
 
     AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
         : func(f), explicit_only(explicit_only) {}
@@ -877,6 +946,17 @@ class StorageFolding : public IRMutator2 {
                 }
             }
 
+            // A fold factor computed at runtime needn't be larger
+            // than the unfolded extent.
+            for (const auto &fold : folder.dims_folded) {
+                for (const auto &p : folder.runtime_factors) {
+                    const Variable *v = fold.factor.as<Variable>();
+                    if (v && v->name == p.first) {
+                        stmt = LetStmt::make(p.first, min(p.second, op->bounds[fold.dim].extent), stmt);
+                    }
+                }
+            }
+
             return stmt;
         }
     }
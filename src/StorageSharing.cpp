@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <map>
+
+#include "StorageSharing.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// An allocation that may share storage with others. Times count the
+// Allocate and Free nodes outside of loops in program order.
+struct Candidate {
+    const Allocate *op;
+    int start, end;
+    bool has_free;
+    // The allocations whose bodies this one is nested inside.
+    vector<string> enclosing;
+    // The number of names bound before this allocation.
+    size_t bound_before;
+};
+
+class FindCandidates : public IRVisitor {
+    using IRVisitor::visit;
+
+    int time = 0;
+    bool in_loop = false;
+    vector<string> open;
+
+    void visit(const For *op) override {
+        bound.push_back(op->name);
+        op->min.accept(this);
+        op->extent.accept(this);
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        op->body.accept(this);
+    }
+
+    void visit(const Fork *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Acquire *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        op->then_case.accept(this);
+        if (op->else_case.defined()) {
+            op->else_case.accept(this);
+        }
+    }
+
+    void visit(const LetStmt *op) override {
+        bound.push_back(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Let *op) override {
+        bound.push_back(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (ends_with(op->name, ".buffer")) {
+            has_buffer.insert(op->name.substr(0, op->name.size() - 7));
+        }
+    }
+
+    // Could this allocation be placed in the same memory as another
+    // one of the same memory type?
+    bool eligible(const Allocate *op) {
+        return (!op->extents.empty() &&
+                !op->new_expr.defined() &&
+                is_one(op->condition) &&
+                (op->memory_type == MemoryType::Auto ||
+                 op->memory_type == MemoryType::Heap ||
+                 op->memory_type == MemoryType::Stack));
+    }
+
+    void visit(const Allocate *op) override {
+        if (in_loop || !eligible(op)) {
+            IRVisitor::visit(op);
+            return;
+        }
+        for (const Expr &e : op->extents) {
+            e.accept(this);
+        }
+        index[op->name] = candidates.size();
+        candidates.push_back({op, time++, -1, false, open, bound.size()});
+        open.push_back(op->name);
+        op->body.accept(this);
+        open.pop_back();
+        Candidate &c = candidates[index[op->name]];
+        if (c.end < 0) {
+            c.end = time++;
+        }
+    }
+
+    void visit(const Free *op) override {
+        auto it = index.find(op->name);
+        if (!in_loop && it != index.end() && candidates[it->second].end < 0) {
+            candidates[it->second].end = time++;
+            candidates[it->second].has_free = true;
+        }
+    }
+
+public:
+    vector<Candidate> candidates;
+    map<string, size_t> index;
+    // Every name bound by a let or a loop, in program order.
+    vector<string> bound;
+    // The allocations that have a buffer_t referring to them.
+    set<string> has_buffer;
+};
+
+// A set of allocations that share the storage of the first one.
+struct Group {
+    vector<size_t> members;
+    int end;
+};
+
+class ShareStorage : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = groups.find(op->name);
+        if (it != groups.end()) {
+            Stmt body = mutate(op->body);
+            const Allocate *a = it->second.as<Allocate>();
+            return Allocate::make(op->name, a->type, op->memory_type, a->extents,
+                                  op->condition, body);
+        } else if (renamed.count(op->name)) {
+            return mutate(op->body);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const Free *op) override {
+        auto it = renamed.find(op->name);
+        if (it == renamed.end()) {
+            return op;
+        } else if (last_frees.count(op->name)) {
+            return Free::make(it->second);
+        } else {
+            return Evaluate::make(0);
+        }
+    }
+
+    Expr visit(const Load *op) override {
+        auto it = renamed.find(op->name);
+        if (it == renamed.end()) {
+            return IRMutator2::visit(op);
+        }
+        return Load::make(op->type, it->second, mutate(op->index), op->image,
+                          op->param, mutate(op->predicate));
+    }
+
+    Stmt visit(const Store *op) override {
+        auto it = renamed.find(op->name);
+        if (it == renamed.end()) {
+            return IRMutator2::visit(op);
+        }
+        return Store::make(it->second, mutate(op->value), mutate(op->index),
+                           op->param, mutate(op->predicate));
+    }
+
+    Expr visit(const Variable *op) override {
+        auto it = renamed.find(op->name);
+        if (it == renamed.end()) {
+            return op;
+        }
+        return Variable::make(op->type, it->second);
+    }
+
+public:
+    // The allocations that lead a group, with a placeholder for their
+    // new type and size.
+    map<string, Stmt> groups;
+    // Every member of a group, including its leader, mapped to the
+    // name of the leader.
+    map<string, string> renamed;
+    // The members whose Free ends the lifetime of their group.
+    set<string> last_frees;
+};
+
+Expr size_in_bytes(const Allocate *op) {
+    Expr size = make_const(Int(64), op->type.bytes());
+    for (const Expr &e : op->extents) {
+        size *= cast(Int(64), e);
+    }
+    return size;
+}
+
+}  // namespace
+
+Stmt share_storage(Stmt s) {
+    FindCandidates finder;
+    s.accept(&finder);
+    const vector<Candidate> &candidates = finder.candidates;
+
+    // Two allocations interfere if their lifetimes overlap, so this
+    // is coloring an interval graph: visiting the allocations in the
+    // order they start, put each one in the first group it doesn't
+    // interfere with, or start a new group.
+    vector<Group> groups;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Candidate &c = candidates[i];
+        if (finder.has_buffer.count(c.op->name)) {
+            continue;
+        }
+        Group *chosen = nullptr;
+        for (Group &g : groups) {
+            const Candidate &leader = candidates[g.members[0]];
+            if (g.end >= c.start ||
+                leader.op->memory_type != c.op->memory_type ||
+                std::find(c.enclosing.begin(), c.enclosing.end(),
+                          leader.op->name) == c.enclosing.end()) {
+                continue;
+            }
+            // The size of this allocation must be computable where
+            // the leader is allocated.
+            Scope<> bound_since;
+            for (size_t j = leader.bound_before; j < c.bound_before; j++) {
+                bound_since.push(finder.bound[j]);
+            }
+            bool in_scope = true;
+            for (const Expr &e : c.op->extents) {
+                in_scope &= !expr_uses_vars(e, bound_since);
+            }
+            if (in_scope) {
+                chosen = &g;
+                break;
+            }
+        }
+        if (chosen) {
+            chosen->members.push_back(i);
+            chosen->end = c.end;
+        } else {
+            groups.push_back({{i}, c.end});
+        }
+    }
+
+    ShareStorage sharer;
+    for (const Group &g : groups) {
+        if (g.members.size() < 2) {
+            continue;
+        }
+        const Allocate *leader = candidates[g.members[0]].op;
+        // Use the widest type of any member, so that the padding
+        // codegen adds past the end is enough for all of them.
+        Type type = leader->type;
+        Expr bytes;
+        for (size_t i : g.members) {
+            const Allocate *op = candidates[i].op;
+            if (op->type.bytes() > type.bytes()) {
+                type = op->type;
+            }
+            Expr size = size_in_bytes(op);
+            bytes = bytes.defined() ? max(bytes, size) : size;
+            sharer.renamed[op->name] = leader->name;
+            debug(3) << "Allocation " << op->name << " shares storage with " << leader->name << "\n";
+        }
+        Expr elem_bytes = make_const(Int(64), type.bytes());
+        Expr extent = simplify(cast(Int(32), (bytes + elem_bytes - 1) / elem_bytes));
+        sharer.groups[leader->name] =
+            Allocate::make(leader->name, type, leader->memory_type, {extent},
+                           const_true(), Evaluate::make(0));
+        const Candidate &last = candidates[g.members.back()];
+        if (last.has_free) {
+            sharer.last_frees.insert(last.op->name);
+        }
+    }
+
+    if (sharer.renamed.empty()) {
+        return s;
+    }
+    return sharer.mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,27 @@
+#ifndef HALIDE_STORAGE_SHARING_H
+#define HALIDE_STORAGE_SHARING_H
+
+/** \file
+ * Defines the lowering pass that lets realizations with disjoint
+ * lifetimes share one allocation.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find the host allocations outside of any loop whose lifetimes
+ * (from the Allocate to the Free injected by inject_early_frees) do
+ * not overlap, and merge each set of them into a single allocation
+ * big enough for the largest. A deep chain of compute_root stages
+ * then needs two buffers instead of one per stage. An allocation
+ * only joins another if it is nested inside it, and its size can be
+ * computed where the other is allocated. Should be run after
+ * inject_early_frees. */
+Stmt share_storage(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,291 @@
+#include "StoreInPlace.h"
+#include "ExprUsesVar.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the calls to the producer in a definition. If args is
+// non-empty, they must all be at that site.
+class FindProducerCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->name != producer) {
+            return;
+        }
+        if (!args.empty()) {
+            bool pointwise = op->args.size() == args.size();
+            for (size_t i = 0; pointwise && i < args.size(); i++) {
+                const Variable *v = op->args[i].as<Variable>();
+                pointwise = v && v->name == args[i];
+            }
+            user_assert(pointwise)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because it reads " << producer << " at a site other than"
+                << " the one it is computing: " << Expr(op) << "\n";
+        }
+        call = op;
+    }
+
+public:
+    const string &consumer, &producer;
+    vector<string> args;
+    const Call *call = nullptr;
+
+    FindProducerCalls(const string &consumer, const string &producer)
+        : consumer(consumer), producer(producer) {}
+};
+
+class StoreInPlace : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &consumer, &producer;
+    // A call to the producer to copy when rewriting calls to the consumer.
+    const Call *call;
+    bool input;
+
+    // Whether we're inside the realization of the producer. Pipeline
+    // inputs are realized outside of everything.
+    bool in_producer_realize;
+    // The names bound, and the number of loops, inside the
+    // realization of the producer.
+    Scope<> bound_inside;
+    int loops_inside = 0;
+    bool in_produce = false;
+
+    Stmt visit(const Realize *op) override {
+        if (op->name == producer) {
+            ScopedValue<bool> old_in_producer_realize(in_producer_realize, true);
+            Stmt body = mutate(op->body);
+            if (!found) {
+                return Realize::make(op->name, op->types, op->memory_type, op->bounds,
+                                     op->condition, body);
+            }
+            // Grow the producer's realization to cover the consumer's.
+            Region bounds = op->bounds;
+            internal_assert(bounds.size() == consumer_bounds.size());
+            for (size_t i = 0; i < bounds.size(); i++) {
+                Expr min_a = bounds[i].min, min_b = consumer_bounds[i].min;
+                Expr max_a = min_a + bounds[i].extent, max_b = min_b + consumer_bounds[i].extent;
+                Expr new_min = simplify(min(min_a, min_b));
+                bounds[i] = Range(new_min, simplify(max(max_a, max_b) - new_min));
+            }
+            return Realize::make(op->name, op->types, op->memory_type, bounds,
+                                 op->condition, body);
+        } else if (op->name == consumer) {
+            user_assert(in_producer_realize && loops_inside == 0)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because it is not stored at the same loop level as "
+                << producer << (input ? " (the root of the pipeline).\n" : ".\n");
+            for (const Range &r : op->bounds) {
+                user_assert(!expr_uses_vars(r.min, bound_inside) &&
+                            !expr_uses_vars(r.extent, bound_inside))
+                    << "Func " << consumer << " cannot be stored in place of " << producer
+                    << ", because its size is not known where " << producer
+                    << " is allocated.\n";
+            }
+            found = true;
+            consumer_bounds = op->bounds;
+            return mutate(op->body);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (!in_producer_realize) {
+            return IRMutator2::visit(op);
+        }
+        ScopedBinding<> bind(bound_inside, op->name);
+        ScopedValue<int> old_loops_inside(loops_inside, loops_inside + 1);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        if (!in_producer_realize) {
+            return IRMutator2::visit(op);
+        }
+        ScopedBinding<> bind(bound_inside, op->name);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == consumer) {
+            ScopedValue<bool> old_in_produce(in_produce, true);
+            Stmt stmt = IRMutator2::visit(op);
+            produced = true;
+            return stmt;
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Provide *op) override {
+        if (op->name != consumer) {
+            return IRMutator2::visit(op);
+        }
+        internal_assert(op->values.size() == 1);
+        Expr value = mutate(op->values[0]);
+        vector<Expr> args;
+        for (const Expr &e : op->args) {
+            args.push_back(mutate(e));
+        }
+        if (!input) {
+            return Provide::make(producer, {value}, args);
+        }
+        // There's no realization to provide to, so store to the
+        // input buffer directly, the way storage flattening indexes
+        // it.
+        Expr idx = 0;
+        for (size_t i = 0; i < args.size(); i++) {
+            string dim = std::to_string(i);
+            Expr min = Variable::make(Int(32), producer + ".min." + dim, call->param);
+            Expr stride = Variable::make(Int(32), producer + ".stride." + dim, call->param);
+            idx += (args[i] - min) * stride;
+        }
+        return Store::make(producer, value, idx, call->param, const_true());
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->name == producer) {
+            user_assert(!produced || in_produce)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because " << producer << " is read after " << consumer
+                << " has been computed.\n";
+        } else if (op->name == consumer && op->call_type == Call::Halide) {
+            vector<Expr> args;
+            for (const Expr &e : op->args) {
+                args.push_back(mutate(e));
+            }
+            return Call::make(call->type, producer, args, call->call_type,
+                              call->func, call->value_index, call->image, call->param);
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Expr visit(const Variable *op) override {
+        if (op->name == consumer + ".buffer") {
+            return Variable::make(op->type, producer + ".buffer", call->image, call->param,
+                                  ReductionDomain());
+        }
+        return op;
+    }
+
+public:
+    bool found = false, produced = false;
+    Region consumer_bounds;
+
+    StoreInPlace(const string &consumer, const string &producer, const Call *call, bool input)
+        : consumer(consumer), producer(producer), call(call), input(input),
+          in_producer_realize(input) {}
+};
+
+}  // namespace
+
+Stmt store_in_place(Stmt s, const map<string, Function> &env,
+                    const vector<Function> &outputs) {
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        const string &producer = f.schedule().in_place_of();
+        if (producer.empty()) {
+            continue;
+        }
+        const string &consumer = f.name();
+
+        for (const Function &o : outputs) {
+            user_assert(o.name() != consumer && o.name() != producer)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because " << o.name() << " is an output of the pipeline.\n";
+        }
+        user_assert(f.outputs() == 1 && !f.has_extern_definition())
+            << "Func " << consumer << " cannot be stored in place of another, because"
+            << " it is " << (f.has_extern_definition() ? "an extern stage" : "Tuple-valued") << ".\n";
+        user_assert(!f.schedule().memoized() && !f.schedule().async())
+            << "Func " << consumer << " cannot be stored in place of another, because"
+            << " it is " << (f.schedule().memoized() ? "memoized" : "async") << ".\n";
+        for (const Split &split : f.definition().schedule().splits()) {
+            user_assert(!split.is_split() || split.tail != TailStrategy::ShiftInwards)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because the split of " << split.old_var << " uses"
+                << " TailStrategy::ShiftInwards, which may compute some sites twice."
+                << " Use TailStrategy::GuardWithIf or TailStrategy::RoundUp instead.\n";
+        }
+
+        // A pipeline input is read through a wrapper Func, which
+        // is inlined.
+        bool input = !env.count(producer);
+        string wrapper = input ? producer + "_im" : producer;
+        user_assert(env.count(wrapper))
+            << "Func " << consumer << " cannot be stored in place of " << producer
+            << ", because it doesn't read " << producer << ".\n";
+        const Function &read = env.at(wrapper);
+        user_assert(read.outputs() == 1 &&
+                    input == read.schedule().compute_level().is_inlined())
+            << "Func " << consumer << " cannot be stored in place of " << producer
+            << ", because " << wrapper << " is "
+            << (read.outputs() != 1 ? "Tuple-valued" : input ? "not inlined" : "inlined") << ".\n";
+
+        // The pure definition must read the producer pointwise, and
+        // the update definitions not at all.
+        FindProducerCalls calls(consumer, wrapper);
+        calls.args = f.args();
+        for (const Expr &e : f.definition().values()) {
+            e.accept(&calls);
+        }
+        user_assert(calls.call)
+            << "Func " << consumer << " cannot be stored in place of " << producer
+            << ", because its pure definition doesn't read " << producer << ".\n";
+        calls.args.clear();
+        calls.call = nullptr;
+        for (const Definition &def : f.updates()) {
+            def.accept(&calls);
+            user_assert(!calls.call)
+                << "Func " << consumer << " cannot be stored in place of " << producer
+                << ", because an update definition reads " << producer << ".\n";
+        }
+        user_assert(read.output_types()[0] == f.output_types()[0])
+            << "Func " << consumer << " cannot be stored in place of " << producer
+            << ", because it has type " << f.output_types()[0] << " and "
+            << producer << " has type " << read.output_types()[0] << ".\n";
+
+        // Find a call to the producer to copy when rewriting calls to
+        // the consumer. For an input, the wrapper's definition has one.
+        const Call *call = nullptr;
+        Expr call_to_func;
+        if (input) {
+            FindProducerCalls image_calls(wrapper, producer);
+            for (const Expr &e : read.definition().values()) {
+                e.accept(&image_calls);
+            }
+            call = image_calls.call;
+            internal_assert(call && call->param.defined());
+        } else {
+            vector<Expr> args(f.args().size(), 0);
+            call_to_func = Call::make(read, args);
+            call = call_to_func.as<Call>();
+        }
+
+        debug(3) << "Storing " << consumer << " in place of " << producer << "\n";
+        StoreInPlace rewriter(consumer, producer, call, input);
+        s = rewriter.mutate(s);
+        user_assert(rewriter.found)
+            << "Func " << consumer << " cannot be stored in place of " << producer
+            << ", because it is inlined, or not computed inside the realization of "
+            << producer << ".\n";
+    }
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,30 @@
+#ifndef HALIDE_STORE_IN_PLACE_H
+#define HALIDE_STORE_IN_PLACE_H
+
+/** \file
+ * Defines the lowering pass that stores Funcs in the storage of the
+ * producers they overwrite.
+ */
+
+#include <map>
+#include <vector>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** For each Func scheduled with Func::store_in_place_of, remove its
+ * realization, and make it write to and be read from its producer
+ * (a Func or a pipeline input) instead. The producer's realization
+ * is grown to cover the Func's if necessary. Raises a user error if
+ * the Func doesn't read its producer pointwise, or if anything reads
+ * the producer after the Func has been computed. Should be run
+ * before storage folding. */
+Stmt store_in_place(Stmt s, const std::map<std::string, Function> &env,
+                    const std::vector<Function> &outputs);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
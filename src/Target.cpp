@@ -10,7 +10,7 @@
 #include "Util.h"
 #include "DeviceInterface.h"
 
-#if defined(__powerpc__) && defined(__linux__)
+#if (defined(__powerpc__) || defined(__aarch64__)) && defined(__linux__)
 // This uses elf.h and must be included after "LLVM_Headers.h", which
 // uses llvm/support/Elf.h.
 #include <sys/auxv.h>
@@ -76,9 +76,26 @@ Target calculate_host_target() {
 
 #if __mips__ || __mips || __MIPS__
     Target::Arch arch = Target::MIPS;
+#elif defined(__riscv)
+    Target::Arch arch = Target::RISCV;
 #else
 #if defined(__arm__) || defined(__aarch64__)
     Target::Arch arch = Target::ARM;
+
+#if defined(__aarch64__) && defined(__linux__)
+    // HWCAP_FPHP, HWCAP_ASIMDHP, HWCAP_ASIMDDP and HWCAP_SVE, which
+    // older headers don't define.
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if ((hwcap & (1 << 9)) && (hwcap & (1 << 10))) {
+        initial_features.push_back(Target::ARMFp16);
+    }
+    if (hwcap & (1 << 20)) {
+        initial_features.push_back(Target::ARMDotProd);
+    }
+    if (hwcap & (1 << 22)) {
+        initial_features.push_back(Target::SVE);
+    }
+#endif
 #else
 #if defined(__powerpc__) && defined(__linux__)
     Target::Arch arch = Target::POWERPC;
@@ -139,6 +156,7 @@ Target calculate_host_target() {
         const uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         const uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma; // Assume ifma => vbmi
+        const uint32_t avx512vnni = 1U << 11; // Reported in ecx rather than ebx
         if ((info2[1] & avx2) == avx2) {
             initial_features.push_back(Target::AVX2);
         }
@@ -153,6 +171,10 @@ Target calculate_host_target() {
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
                 initial_features.push_back(Target::AVX512_Cannonlake);
             }
+            if ((info2[1] & avx512_skylake) == avx512_skylake &&
+                (info2[2] & avx512vnni) == avx512vnni) {
+                initial_features.push_back(Target::AVX512_Cascadelake);
+            }
         }
     }
 #ifdef _WIN32
@@ -200,8 +222,10 @@ Target::Feature calculate_host_cuda_capability(Target t) {
         return Target::CUDACapability35;
     } else if (ver < 61) {
         return Target::CUDACapability50;
-    } else {
+    } else if (ver < 70) {
         return Target::CUDACapability61;
+    } else {
+        return Target::CUDACapability70;
     }
 }
 
@@ -219,6 +243,7 @@ const std::map<std::string, Target::OS> os_name_map = {
     {"ios", Target::IOS},
     {"qurt", Target::QuRT},
     {"noos", Target::NoOS},
+    {"wasmrt", Target::WebAssemblyRuntime},
 };
 
 bool lookup_os(const std::string &tok, Target::OS &result) {
@@ -237,6 +262,8 @@ const std::map<std::string, Target::Arch> arch_name_map = {
     {"mips", Target::MIPS},
     {"powerpc", Target::POWERPC},
     {"hexagon", Target::Hexagon},
+    {"wasm", Target::WebAssembly},
+    {"riscv", Target::RISCV},
 };
 
 bool lookup_arch(const std::string &tok, Target::Arch &result) {
@@ -261,6 +288,9 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"f16c", Target::F16C},
     {"armv7s", Target::ARMv7s},
     {"no_neon", Target::NoNEON},
+    {"sve", Target::SVE},
+    {"arm_dot_prod", Target::ARMDotProd},
+    {"arm_fp16", Target::ARMFp16},
     {"vsx", Target::VSX},
     {"power_arch_2_07", Target::POWER_ARCH_2_07},
     {"cuda", Target::CUDA},
@@ -269,6 +299,7 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"cuda_capability_35", Target::CUDACapability35},
     {"cuda_capability_50", Target::CUDACapability50},
     {"cuda_capability_61", Target::CUDACapability61},
+    {"cuda_capability_70", Target::CUDACapability70},
     {"opencl", Target::OpenCL},
     {"cl_doubles", Target::CLDoubles},
     {"cl_half", Target::CLHalf},
@@ -295,6 +326,7 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"avx512_knl", Target::AVX512_KNL},
     {"avx512_skylake", Target::AVX512_Skylake},
     {"avx512_cannonlake", Target::AVX512_Cannonlake},
+    {"avx512_cascadelake", Target::AVX512_Cascadelake},
     {"trace_loads", Target::TraceLoads},
     {"trace_stores", Target::TraceStores},
     {"trace_realizations", Target::TraceRealizations},
@@ -308,6 +340,25 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"embed_bitcode", Target::EmbedBitcode},
     {"disable_llvm_loop_vectorize", Target::DisableLLVMLoopVectorize},
     {"disable_llvm_loop_unroll", Target::DisableLLVMLoopUnroll},
+    {"allocation_arena", Target::AllocationArena},
+    {"profile_by_thread", Target::ProfileByThread},
+    {"profile_roofline", Target::ProfileRoofline},
+    {"auto_specialize", Target::AutoSpecialize},
+    {"auto_prefetch", Target::AutoPrefetch},
+    {"multiversion_loops", Target::MultiversionLoops},
+    {"batch_dimension", Target::BatchDimension},
+    {"cuda_fatbin", Target::CUDAFatbin},
+    {"metallib", Target::MetalLib},
+    {"opencl_spirv", Target::OpenCLSPIRV},
+    {"fast_compile", Target::FastCompile},
+    {"lazy_specializations", Target::LazySpecializations},
+    {"vulkan", Target::Vulkan},
+    {"wasm_simd128", Target::WasmSimd128},
+    {"wasm_threads", Target::WasmThreads},
+    {"scratch_arena", Target::ScratchArena},
+    {"profile_branches", Target::ProfileBranches},
+    {"memoize_shared", Target::MemoizeShared},
+    {"cache_shape_checks", Target::CacheShapeChecks},
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -419,7 +470,8 @@ bool merge_string(Target &t, const std::string &target) {
         !t.has_feature(Target::CUDACapability32) &&
         !t.has_feature(Target::CUDACapability35) &&
         !t.has_feature(Target::CUDACapability50) &&
-        !t.has_feature(Target::CUDACapability61)) {
+        !t.has_feature(Target::CUDACapability61) &&
+        !t.has_feature(Target::CUDACapability70)) {
         // Detect host cuda capability
         t.set_feature(get_host_cuda_capability(t));
     }
@@ -566,6 +618,12 @@ bool Target::supported() const {
 #if !defined(WITH_HEXAGON)
     bad |= arch == Target::Hexagon;
 #endif
+#if !defined(WITH_WEBASSEMBLY)
+    bad |= arch == Target::WebAssembly;
+#endif
+#if !defined(WITH_RISCV)
+    bad |= arch == Target::RISCV;
+#endif
 #if !defined(WITH_PTX)
     bad |= has_feature(Target::CUDA);
 #endif
@@ -580,6 +638,9 @@ bool Target::supported() const {
 #endif
 #if !defined(WITH_D3D12)
     bad |= has_feature(Target::D3D12Compute);
+#endif
+#if !defined(WITH_VULKAN)
+    bad |= has_feature(Target::Vulkan);
 #endif
     return !bad;
 }
@@ -633,7 +694,8 @@ Target Target::without_feature(Feature f) const {
 }
 
 bool Target::has_gpu_feature() const {
-    return has_feature(CUDA) || has_feature(OpenCL) || has_feature(Metal) || has_feature(D3D12Compute);
+    return (has_feature(CUDA) || has_feature(OpenCL) || has_feature(Metal) ||
+            has_feature(D3D12Compute) || has_feature(Vulkan));
 }
 
 bool Target::supports_type(const Type &t) const {
@@ -674,6 +736,10 @@ bool Target::supports_type(const Type &t, DeviceAPI device) const {
         // Shader Model 5.x can optionally support double-precision; 64-bit int
         // types are not supported.
         return t.bits() < 64;
+    } else if (device == DeviceAPI::Vulkan) {
+        // 64-bit types are optional device features, which the runtime
+        // enables where the device has them.
+        return true;
     }
 
     return true;
@@ -699,6 +765,7 @@ Target::Feature target_feature_for_device_api(DeviceAPI api) {
     case DeviceAPI::Metal:         return Target::Metal;
     case DeviceAPI::Hexagon:       return Target::HVX_128;
     case DeviceAPI::D3D12Compute:  return Target::D3D12Compute;
+    case DeviceAPI::Vulkan:        return Target::Vulkan;
     default:                       return Target::FeatureEnd;
     }
 }
@@ -727,13 +794,15 @@ int Target::natural_vector_size(const Halide::Type &t) const {
         }
     } else if (arch == Target::X86) {
         if (is_integer && (has_feature(Halide::Target::AVX512_Skylake) ||
-                           has_feature(Halide::Target::AVX512_Cannonlake))) {
-            // AVX512BW exists on Skylake and Cannonlake
+                           has_feature(Halide::Target::AVX512_Cannonlake) ||
+                           has_feature(Halide::Target::AVX512_Cascadelake))) {
+            // AVX512BW exists on Skylake, Cannonlake and Cascadelake
             return 64 / data_size;
         } else if (t.is_float() && (has_feature(Halide::Target::AVX512) ||
                                     has_feature(Halide::Target::AVX512_KNL) ||
                                     has_feature(Halide::Target::AVX512_Skylake) ||
-                                    has_feature(Halide::Target::AVX512_Cannonlake))) {
+                                    has_feature(Halide::Target::AVX512_Cannonlake) ||
+                                    has_feature(Halide::Target::AVX512_Cascadelake))) {
             // AVX512F is on all AVX512 architectures
             return 64 / data_size;
         } else if (has_feature(Halide::Target::AVX2)) {
@@ -22,7 +22,7 @@ struct Target {
     /** The operating system used by the target. Determines which
      * system calls to generate.
      * Corresponds to os_name_map in Target.cpp. */
-    enum OS {OSUnknown = 0, Linux, Windows, OSX, Android, IOS, QuRT, NoOS} os;
+    enum OS {OSUnknown = 0, Linux, Windows, OSX, Android, IOS, QuRT, NoOS, WebAssemblyRuntime} os;
 
     /** The architecture used by the target. Determines the
      * instruction set to use.
@@ -34,6 +34,8 @@ struct Target {
         MIPS,
         Hexagon,
         POWERPC,
+        WebAssembly,
+        RISCV,
     } arch;
 
     /** The bit-width of the target machine. Must be 0 for unknown, or 32 or 64. */
@@ -56,6 +58,9 @@ struct Target {
         F16C = halide_target_feature_f16c,
         ARMv7s = halide_target_feature_armv7s,
         NoNEON = halide_target_feature_no_neon,
+        SVE = halide_target_feature_sve,
+        ARMDotProd = halide_target_feature_arm_dot_prod,
+        ARMFp16 = halide_target_feature_arm_fp16,
         VSX = halide_target_feature_vsx,
         POWER_ARCH_2_07 = halide_target_feature_power_arch_2_07,
         CUDA = halide_target_feature_cuda,
@@ -64,6 +69,7 @@ struct Target {
         CUDACapability35 = halide_target_feature_cuda_capability35,
         CUDACapability50 = halide_target_feature_cuda_capability50,
         CUDACapability61 = halide_target_feature_cuda_capability61,
+        CUDACapability70 = halide_target_feature_cuda_capability70,
         OpenCL = halide_target_feature_opencl,
         CLDoubles = halide_target_feature_cl_doubles,
         CLHalf = halide_target_feature_cl_half,
@@ -91,6 +97,7 @@ struct Target {
         AVX512_KNL = halide_target_feature_avx512_knl,
         AVX512_Skylake = halide_target_feature_avx512_skylake,
         AVX512_Cannonlake = halide_target_feature_avx512_cannonlake,
+        AVX512_Cascadelake = halide_target_feature_avx512_cascadelake,
         TraceLoads = halide_target_feature_trace_loads,
         TraceStores = halide_target_feature_trace_stores,
         TraceRealizations = halide_target_feature_trace_realizations,
@@ -103,6 +110,25 @@ struct Target {
         EmbedBitcode = halide_target_feature_embed_bitcode,
         DisableLLVMLoopVectorize = halide_target_feature_disable_llvm_loop_vectorize,
         DisableLLVMLoopUnroll = halide_target_feature_disable_llvm_loop_unroll,
+        AllocationArena = halide_target_feature_allocation_arena,
+        ProfileByThread = halide_target_feature_profile_by_thread,
+        ProfileRoofline = halide_target_feature_profile_roofline,
+        AutoSpecialize = halide_target_feature_auto_specialize,
+        AutoPrefetch = halide_target_feature_auto_prefetch,
+        MultiversionLoops = halide_target_feature_multiversion_loops,
+        BatchDimension = halide_target_feature_batch_dimension,
+        CUDAFatbin = halide_target_feature_cuda_fatbin,
+        MetalLib = halide_target_feature_metallib,
+        OpenCLSPIRV = halide_target_feature_opencl_spirv,
+        FastCompile = halide_target_feature_fast_compile,
+        LazySpecializations = halide_target_feature_lazy_specializations,
+        Vulkan = halide_target_feature_vulkan,
+        WasmSimd128 = halide_target_feature_wasm_simd128,
+        WasmThreads = halide_target_feature_wasm_threads,
+        ScratchArena = halide_target_feature_scratch_arena,
+        ProfileBranches = halide_target_feature_profile_branches,
+        MemoizeShared = halide_target_feature_memoize_shared,
+        CacheShapeChecks = halide_target_feature_cache_shape_checks,
         FeatureEnd = halide_target_feature_end
     };
     Target() : os(OSUnknown), arch(ArchUnknown), bits(0) {}
@@ -155,7 +181,7 @@ struct Target {
 
     /** Is a fully feature GPU compute runtime enabled? I.e. is
      * Func::gpu_tile and similar going to work? Currently includes
-     * CUDA, OpenCL, Metal and D3D12Compute. We do not include OpenGL,
+     * CUDA, OpenCL, Metal, D3D12Compute and Vulkan. We do not include OpenGL,
      * because it is not capable of gpgpu, and is not scheduled via
      * Func::gpu_tile.
      * TODO: Should OpenGLCompute be included here? */
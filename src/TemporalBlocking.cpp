@@ -0,0 +1,339 @@
+#include "TemporalBlocking.h"
+#include "Bounds.h"
+#include "FindCalls.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool is_output(const Function &f, const vector<Function> &outputs) {
+    for (const Function &o : outputs) {
+        if (o.same_as(f)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_inlined(const Function &f, const vector<Function> &outputs) {
+    return !is_output(f, outputs) && f.schedule().compute_level().is_inlined();
+}
+
+// Find the Funcs that a Func reads, looking through the Funcs inlined
+// into it.
+void find_calls(const Function &f, const vector<Function> &outputs, set<string> &result) {
+    for (const auto &p : find_direct_calls(f)) {
+        if (result.insert(p.first).second && is_inlined(p.second, outputs)) {
+            find_calls(p.second, outputs, result);
+        }
+    }
+}
+
+class ContainsGPULoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+// Find the productions of the Funcs in a chain.
+class FindProductions : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && names.count(op->name)) {
+            internal_assert(!productions.count(op->name))
+                << "Temporally blocked Func " << op->name << " is produced more than once\n";
+            productions[op->name] = op->body;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const set<string> &names;
+    map<string, Stmt> productions;
+
+    FindProductions(const set<string> &names) : names(names) {}
+};
+
+// Find how far the pure definition of a Func reaches into its
+// producer, given the lowered production of the Func.
+class FindStencil : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Provide *op) override {
+        if (op->name == func.name()) {
+            for (const Expr &v : op->values) {
+                box = box_union(box, box_required(v, producer.name()));
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+    const Function &func;
+    const Function &producer;
+
+public:
+    Box box;
+
+    FindStencil(const Function &func, const Function &producer) :
+        func(func), producer(producer) {}
+};
+
+// The greatest offset along each tiled dimension at which a Func of a
+// chain reads the previous one. The tiles of the previous Func are
+// shifted by this much against those of the Func, so that each tile of
+// the Func only reads tiles of the previous Func that have already
+// been computed.
+vector<int> stencil_reach(const Function &func, const Function &producer, Stmt production) {
+    FindStencil finder(func, producer);
+    production.accept(&finder);
+
+    const vector<string> &producer_args = producer.args();
+    const vector<TemporalBlockDim> &dims = func.schedule().temporal_block();
+    const vector<TemporalBlockDim> &producer_dims = producer.schedule().temporal_block();
+    vector<int> reach;
+    for (size_t d = 0; d < dims.size(); d++) {
+        size_t i = std::find(producer_args.begin(), producer_args.end(), producer_dims[d].var) - producer_args.begin();
+        Expr var = Variable::make(Int(32), func.name() + ".s0." + dims[d].var);
+        Expr offset;
+        if (i < finder.box.size() && finder.box[i].is_bounded()) {
+            offset = simplify(finder.box[i].max - var);
+        }
+        const int64_t *c = offset.defined() ? as_const_int(offset) : nullptr;
+        user_assert(c)
+            << "Can't temporally block " << func.name() << " with " << producer.name()
+            << ", because it doesn't read " << producer.name() << " at a constant offset along "
+            << dims[d].var << ".\n";
+        reach.push_back((int)*c);
+    }
+    return reach;
+}
+
+// Replace the productions of a chain of temporally blocked Funcs. The
+// production of the last Func becomes the loop nest over the tiles
+// that computes all of them, and the others are removed.
+class ReplaceProductions : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == last) {
+            return tiled;
+        } else if (op->is_producer && names.count(op->name)) {
+            return Evaluate::make(0);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    const set<string> &names;
+    string last;
+    Stmt tiled;
+
+public:
+    ReplaceProductions(const set<string> &names, const string &last, Stmt tiled) :
+        names(names), last(last), tiled(tiled) {}
+};
+
+Stmt block_chain(Stmt s, const vector<Function> &chain) {
+    set<string> names;
+    for (const Function &f : chain) {
+        names.insert(f.name());
+    }
+
+    FindProductions finder(names);
+    s.accept(&finder);
+    for (const Function &f : chain) {
+        internal_assert(finder.productions.count(f.name()))
+            << "Production of temporally blocked Func " << f.name() << " not found\n";
+        ContainsGPULoops gpu;
+        finder.productions[f.name()].accept(&gpu);
+        user_assert(!gpu.result)
+            << "Can't temporally block " << f.name() << ", because it is computed on a GPU.\n";
+    }
+
+    const Function &last = chain.back();
+    const vector<TemporalBlockDim> &last_dims = last.schedule().temporal_block();
+    const size_t num_dims = last_dims.size();
+
+    // Shift the tiles of each Func against those of the last one by
+    // the sum of the reaches of the stencils that consume it.
+    vector<vector<int>> shifts(chain.size(), vector<int>(num_dims, 0));
+    for (size_t k = chain.size() - 1; k > 0; k--) {
+        vector<int> reach = stencil_reach(chain[k], chain[k - 1],
+                                          finder.productions[chain[k].name()]);
+        for (size_t d = 0; d < num_dims; d++) {
+            shifts[k - 1][d] = shifts[k][d] + reach[d];
+        }
+    }
+
+    auto bound = [&](size_t k, size_t d, const char *which) {
+        const Function &f = chain[k];
+        return Variable::make(Int(32), f.name() + ".s0." + f.schedule().temporal_block()[d].var + which);
+    };
+
+    // Line up the tiles so that the first tile of each Func covers its
+    // min, and count enough tiles to cover the max of each Func.
+    string prefix = last.name() + ".temporal_block.";
+    vector<Expr> origin(num_dims), count(num_dims), tile(num_dims);
+    vector<string> origin_names(num_dims), count_names(num_dims);
+    for (size_t d = 0; d < num_dims; d++) {
+        Expr first, end;
+        for (size_t k = 0; k < chain.size(); k++) {
+            Expr min_k = bound(k, d, ".min") - shifts[k][d];
+            Expr max_k = bound(k, d, ".max") - shifts[k][d];
+            first = first.defined() ? min(first, min_k) : min_k;
+            end = end.defined() ? max(end, max_k) : max_k;
+        }
+        origin_names[d] = prefix + last_dims[d].var + ".origin";
+        count_names[d] = prefix + last_dims[d].var + ".count";
+        origin[d] = simplify(first);
+        count[d] = simplify((end - first) / last_dims[d].tile_size + 1);
+        tile[d] = Variable::make(Int(32), prefix + last_dims[d].var);
+    }
+
+    // Compute the tile of each Func in turn.
+    vector<Stmt> stages;
+    for (size_t k = 0; k < chain.size(); k++) {
+        Stmt stage = ProducerConsumer::make_produce(chain[k].name(), finder.productions[chain[k].name()]);
+        for (size_t d = 0; d < num_dims; d++) {
+            int size = last_dims[d].tile_size;
+            Expr o = Variable::make(Int(32), origin_names[d]) + shifts[k][d];
+            Expr lo = max(o + tile[d] * size, bound(k, d, ".min"));
+            Expr hi = min(o + (tile[d] + 1) * size - 1, bound(k, d, ".max"));
+            stage = LetStmt::make(chain[k].name() + ".s0." + chain[k].schedule().temporal_block()[d].var + ".max",
+                                  simplify(hi), stage);
+            stage = LetStmt::make(chain[k].name() + ".s0." + chain[k].schedule().temporal_block()[d].var + ".min",
+                                  simplify(lo), stage);
+        }
+        stages.push_back(stage);
+    }
+    Stmt body = Block::make(stages);
+
+    // A tile depends on the tiles before it along each dimension, so
+    // the tiles on each anti-diagonal can be computed in parallel once
+    // the previous anti-diagonal is done. The tile index along the
+    // first dimension follows from the wavefront and the other tile
+    // indices.
+    Expr count_0 = Variable::make(Int(32), count_names[0]);
+    Expr count_1 = Variable::make(Int(32), count_names[1]);
+    string wave_name = prefix + "wave";
+    Expr wave = Variable::make(Int(32), wave_name);
+    body = LetStmt::make(prefix + last_dims[0].var, wave - tile[1], body);
+    Expr tile_1_min = max(0, wave - count_0 + 1);
+    Expr tile_1_max = min(wave, count_1 - 1);
+    body = For::make(prefix + last_dims[1].var, tile_1_min, tile_1_max - tile_1_min + 1,
+                     ForType::Parallel, DeviceAPI::Host, body);
+    body = For::make(wave_name, 0, count_0 + count_1 - 1, ForType::Serial, DeviceAPI::Host, body);
+    for (size_t d = num_dims; d > 0; d--) {
+        body = LetStmt::make(count_names[d - 1], count[d - 1], body);
+        body = LetStmt::make(origin_names[d - 1], origin[d - 1], body);
+    }
+
+    return ReplaceProductions(names, last.name(), body).mutate(s);
+}
+
+// Find the chains of temporally blocked Funcs, from the first
+// producer to the last consumer.
+vector<vector<Function>> find_chains(const map<string, Function> &env, const vector<Function> &outputs) {
+    map<string, set<string>> calls;
+    for (const auto &p : env) {
+        if (!is_inlined(p.second, outputs)) {
+            find_calls(p.second, outputs, calls[p.first]);
+        }
+    }
+
+    map<string, string> next, prev;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (f.schedule().temporal_block().empty()) {
+            continue;
+        }
+        user_assert(!is_output(f, outputs) && f.schedule().compute_level().is_root())
+            << "Can't temporally block " << f.name() << ", because it isn't compute_root.\n";
+        user_assert(!f.has_extern_definition() && f.updates().empty())
+            << "Can't temporally block " << f.name()
+            << ", because it has an extern or update definition.\n";
+        user_assert(!f.schedule().async())
+            << "Can't temporally block " << f.name() << ", because it is async.\n";
+        for (const string &c : calls[f.name()]) {
+            const Function &g = env.find(c)->second;
+            if (g.schedule().temporal_block().empty() || c == f.name()) {
+                continue;
+            }
+            user_assert(!prev.count(f.name()))
+                << "Can't temporally block " << f.name() << ", because it reads both "
+                << prev[f.name()] << " and " << c << ", which are temporally blocked.\n";
+            user_assert(!next.count(c))
+                << "Can't temporally block " << c << ", because both "
+                << next[c] << " and " << f.name() << " read it.\n";
+            prev[f.name()] = c;
+            next[c] = f.name();
+        }
+    }
+
+    // Only the last Func of a chain may have consumers outside it.
+    for (const auto &p : next) {
+        for (const auto &c : calls) {
+            user_assert(c.first == p.first || c.first == p.second || !c.second.count(p.first))
+                << "Can't temporally block " << p.first << " with " << p.second
+                << ", because " << c.first << " reads it too.\n";
+        }
+    }
+
+    vector<vector<Function>> chains;
+    for (const auto &p : env) {
+        if (p.second.schedule().temporal_block().empty() || prev.count(p.first)) {
+            continue;
+        }
+        vector<Function> chain = {p.second};
+        for (auto it = next.find(p.first); it != next.end(); it = next.find(it->second)) {
+            const Function &f = env.find(it->second)->second;
+            const vector<TemporalBlockDim> &dims = f.schedule().temporal_block();
+            const vector<TemporalBlockDim> &first_dims = p.second.schedule().temporal_block();
+            for (size_t d = 0; d < dims.size(); d++) {
+                user_assert(dims[d].tile_size == first_dims[d].tile_size)
+                    << "Can't temporally block " << f.name() << " with " << p.first
+                    << ", because their tile sizes differ.\n";
+            }
+            chain.push_back(f);
+        }
+        chains.push_back(chain);
+    }
+    return chains;
+}
+
+}  // namespace
+
+Stmt temporal_blocking(Stmt s, const map<string, Function> &env, const vector<Function> &outputs) {
+    for (const vector<Function> &chain : find_chains(env, outputs)) {
+        s = block_chain(s, chain);
+    }
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
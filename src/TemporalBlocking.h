@@ -0,0 +1,31 @@
+#ifndef HALIDE_TEMPORAL_BLOCKING_H
+#define HALIDE_TEMPORAL_BLOCKING_H
+
+/** \file
+ * Defines the lowering pass that computes chains of stencils scheduled
+ * with Func::temporal_block together in skewed tiles.
+ */
+
+#include <map>
+#include <vector>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Replace the productions of each chain of temporally blocked Funcs
+ * with a single loop nest over skewed tiles, which computes the tile
+ * of every Func in the chain in turn. The tiles are visited in
+ * wavefronts along their anti-diagonals, and the tiles in a wavefront
+ * run in parallel. Must be run after bounds inference and before
+ * allocation bounds inference. */
+Stmt temporal_blocking(Stmt s, const std::map<std::string, Function> &env,
+                       const std::vector<Function> &outputs);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -164,6 +164,7 @@ HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(uint32_t);
 HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(int64_t);
 HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(uint64_t);
 HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(Halide::float16_t);
+HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(Halide::bfloat16_t);
 HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(float);
 HALIDE_DECLARE_EXTERN_SIMPLE_TYPE(double);
 HALIDE_DECLARE_EXTERN_STRUCT_TYPE(buffer_t);
@@ -277,6 +278,7 @@ struct Type {
     static const halide_type_code_t UInt = halide_type_uint;
     static const halide_type_code_t Float = halide_type_float;
     static const halide_type_code_t Handle = halide_type_handle;
+    static const halide_type_code_t BFloat = halide_type_bfloat;
     // @}
 
     /** The number of bytes required to store a single scalar value of this type. Ignores vector lanes. */
@@ -359,9 +361,14 @@ struct Type {
     HALIDE_ALWAYS_INLINE
     bool is_scalar() const {return lanes() == 1;}
 
-    /** Is this type a floating point type (float or double). */
+    /** Is this type a floating point type (float, double, or bfloat). */
     HALIDE_ALWAYS_INLINE
-    bool is_float() const {return code() == Float;}
+    bool is_float() const {return code() == Float || code() == BFloat;}
+
+    /** Is this type a bfloat, which is a float32 with the low 16 bits
+     * of the mantissa dropped? */
+    HALIDE_ALWAYS_INLINE
+    bool is_bfloat() const {return code() == BFloat;}
 
     /** Is this type a signed integer type? */
     HALIDE_ALWAYS_INLINE
@@ -443,6 +450,11 @@ inline Type Float(int bits, int lanes = 1) {
     return Type(Type::Float, bits, lanes);
 }
 
+/** Construct a bfloat type. Only 16 bits are supported. */
+inline Type BFloat(int bits, int lanes = 1) {
+    return Type(Type::BFloat, bits, lanes);
+}
+
 /** Construct a boolean type */
 inline Type Bool(int lanes = 1) {
     return UInt(1, lanes);
@@ -1,19 +1,153 @@
 #include "UnrollLoops.h"
+#include "CodeSize.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "Simplify.h"
 #include "Substitute.h"
 
+using std::map;
+using std::string;
 using std::vector;
 
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+class ContainsProducer : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+// Move the iterations of a loop over 'var' from 'min' to 'min + extent'
+// inside the loops in 's', and unroll them there. Lets and
+// conditions that depend on the loop variable are moved along with
+// it.
+class Jam {
+    const string &var;
+    Expr min;
+    int extent;
+    Scope<> dependent;
+    vector<Stmt> moved;
+
+    bool depends_on_var(Expr e) {
+        return expr_uses_var(e, var) || expr_uses_vars(e, dependent);
+    }
+
+public:
+    Jam(const string &var, Expr min, int extent)
+        : var(var), min(min), extent(extent) {
+    }
+
+    Stmt jam(const Stmt &s) {
+        if (const For *op = s.as<For>()) {
+            if (op->for_type == ForType::Serial ||
+                op->for_type == ForType::Vectorized ||
+                op->for_type == ForType::Unrolled ||
+                op->for_type == ForType::UnrolledAndJammed) {
+                user_assert(!depends_on_var(op->min) && !depends_on_var(op->extent))
+                    << "Can't unroll and jam loop over " << var
+                    << " into the loop over " << op->name
+                    << ", because the bounds of the inner loop depend on it.\n";
+                Stmt body = jam(op->body);
+                return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            }
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            // Lets inside a moved condition may only be valid when
+            // it holds, so they move with it.
+            if (moved.empty() && !depends_on_var(op->value)) {
+                return LetStmt::make(op->name, op->value, jam(op->body));
+            }
+            dependent.push(op->name);
+            moved.push_back(s);
+            Stmt body = jam(op->body);
+            dependent.pop(op->name);
+            return body;
+        } else if (const IfThenElse *op = s.as<IfThenElse>()) {
+            if (!op->else_case.defined() && depends_on_var(op->condition)) {
+                moved.push_back(s);
+                return jam(op->then_case);
+            }
+        }
+
+        // Put back the lets and conditions that depend on the loop
+        // variable, and unroll the loop around them.
+        Stmt body = s;
+        for (size_t i = moved.size(); i > 0; i--) {
+            if (const LetStmt *let = moved[i - 1].as<LetStmt>()) {
+                body = LetStmt::make(let->name, let->value, body);
+            } else {
+                const IfThenElse *if_stmt = moved[i - 1].as<IfThenElse>();
+                body = IfThenElse::make(if_stmt->condition, body);
+            }
+        }
+        moved.clear();
+
+        vector<Stmt> iters;
+        for (int i = 0; i < extent; i++) {
+            iters.push_back(substitute(var, min + i, body));
+        }
+        return Block::make(iters);
+    }
+};
+
+}  // namespace
+
 class UnrollLoops : public IRMutator2 {
     using IRMutator2::visit;
 
+    CodeSizeBudget &budget;
+
+    // The Func whose producer we're in, and the product of the
+    // constant extents of the enclosing vectorized loops, for
+    // estimating the code size of loop bodies.
+    string func;
+    int lanes = 1;
+
+    // Check that making n copies of a loop body keeps within the code
+    // size budget. If not, warn that the loop won't be unrolled.
+    bool within_budget(const For *for_loop, const Stmt &body, int n) {
+        if (!budget.enabled()) {
+            return true;
+        }
+        map<string, int64_t> growth = budget.estimate(body, func, lanes);
+        for (auto &g : growth) {
+            g.second *= n - 1;
+        }
+        // The loop itself goes away.
+        growth[func] -= 3;
+        string reason;
+        if (!budget.try_grow(growth, &reason)) {
+            user_warning << "Warning: Not unrolling loop over " << for_loop->name
+                         << ", because " << reason << ".\n";
+            return false;
+        }
+        return true;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            ScopedValue<string> old_func(func, op->name);
+            return IRMutator2::visit(op);
+        }
+        return IRMutator2::visit(op);
+    }
+
     Stmt visit(const For *for_loop) override {
-        if (for_loop->for_type == ForType::Unrolled) {
+        if (for_loop->for_type == ForType::Vectorized) {
+            const IntImm *e = for_loop->extent.as<IntImm>();
+            ScopedValue<int> old_lanes(lanes, lanes * (e ? (int)e->value : 1));
+            return IRMutator2::visit(for_loop);
+        } else if (for_loop->for_type == ForType::Unrolled ||
+            for_loop->for_type == ForType::UnrolledAndJammed) {
             // Give it one last chance to simplify to an int
             Expr extent = simplify(for_loop->extent);
             const IntImm *e = extent.as<IntImm>();
@@ -28,12 +162,36 @@ class UnrollLoops : public IRMutator2 {
             user_assert(e)
                 << "Can only unroll for loops over a constant extent.\n"
                 << "Loop over " << for_loop->name << " has extent " << extent << ".\n";
-            Stmt body = mutate(for_loop->body);
 
             if (e->value == 1) {
                 user_warning << "Warning: Unrolling a for loop of extent 1: " << for_loop->name << "\n";
             }
 
+            if (for_loop->for_type == ForType::UnrolledAndJammed) {
+                // Jamming reorders the iterations of the loops inside
+                // this one, which is only safe if nothing else is
+                // computed inside them.
+                ContainsProducer c;
+                for_loop->body.accept(&c);
+                user_assert(!c.result)
+                    << "Can't unroll and jam loop over " << for_loop->name
+                    << ", because other Funcs are computed inside it.\n";
+                if (!within_budget(for_loop, for_loop->body, (int)e->value)) {
+                    Stmt body = mutate(for_loop->body);
+                    return For::make(for_loop->name, for_loop->min, for_loop->extent,
+                                     ForType::Serial, for_loop->device_api, std::move(body));
+                }
+                Stmt jammed = Jam(for_loop->name, for_loop->min, (int)e->value).jam(for_loop->body);
+                return mutate(jammed);
+            }
+
+            Stmt body = mutate(for_loop->body);
+
+            if (!within_budget(for_loop, body, (int)e->value)) {
+                return For::make(for_loop->name, for_loop->min, for_loop->extent,
+                                 ForType::Serial, for_loop->device_api, std::move(body));
+            }
+
             vector<Stmt> iters;
             // Make n copies of the body, each wrapped in a let that defines the loop var for that body
             for (int i = 0; i < e->value; i++) {
@@ -47,7 +205,7 @@ class UnrollLoops : public IRMutator2 {
     }
     bool permit_failed_unroll = false;
 public:
-    UnrollLoops() {
+    UnrollLoops(CodeSizeBudget &budget) : budget(budget) {
         // Experimental autoschedulers may want to unroll without
         // being totally confident the loop will indeed turn out
         // to be constant-sized. If this feature continues to be
@@ -61,8 +219,8 @@ public:
     }
 };
 
-Stmt unroll_loops(Stmt s) {
-    return UnrollLoops().mutate(s);
+Stmt unroll_loops(Stmt s, CodeSizeBudget &budget) {
+    return UnrollLoops(budget).mutate(s);
 }
 
 }  // namespace Internal
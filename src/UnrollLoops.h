@@ -10,10 +10,14 @@
 namespace Halide {
 namespace Internal {
 
+class CodeSizeBudget;
+
 /** Take a statement with for loops marked for unrolling, and convert
  * each into several copies of the innermost statement. I.e. unroll
- * the loop. */
-Stmt unroll_loops(Stmt);
+ * the loop. Loops marked for unrolling and jamming are first moved
+ * inside the loops they contain. Loops whose unrolling would exceed
+ * the code size budget are left rolled, with a warning. */
+Stmt unroll_loops(Stmt, CodeSizeBudget &budget);
 
 }  // namespace Internal
 }  // namespace Halide
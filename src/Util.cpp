@@ -2,8 +2,11 @@
 #include "Debug.h"
 #include "Error.h"
 #include "Introspection.h"
+#include "ThreadPool.h"
 #include <atomic>
 #include <chrono>
+#include <exception>
+#include <fstream>
 #include <iomanip>
 #include <map>
 #include <mutex>
@@ -298,6 +301,29 @@ FileStat file_stat(const std::string &name) {
             static_cast<uint32_t>(a.st_mode)};
 }
 
+std::vector<char> read_entire_file(const std::string &pathname) {
+    std::ifstream f(pathname, std::ios::in | std::ios::binary);
+    std::vector<char> result;
+
+    f.seekg(0, std::ifstream::end);
+    size_t size = f.tellg();
+    result.resize(size);
+    f.seekg(0, std::ifstream::beg);
+    f.read(result.data(), result.size());
+    internal_assert(f.good()) << "Unable to read file: " << pathname;
+    f.close();
+    return result;
+}
+
+void write_entire_file(const std::string &pathname, const void *source, size_t source_len) {
+    std::ofstream f(pathname, std::ios::out | std::ios::binary);
+
+    f.write(reinterpret_cast<const char *>(source), source_len);
+    f.flush();
+    internal_assert(f.good()) << "Unable to write file: " << pathname;
+    f.close();
+}
+
 #ifdef _WIN32
 namespace {
 
@@ -438,6 +464,54 @@ bool mul_would_overflow(int bits, int64_t a, int64_t b) {
     }
 }
 
+int num_compile_threads() {
+    std::string n = get_env_variable("HL_NUM_COMPILE_THREADS");
+    if (!n.empty()) {
+        return std::max(1, atoi(n.c_str()));
+    }
+    return (int)ThreadPool<void>::num_processors_online();
+}
+
+void run_compile_jobs(const std::vector<std::function<void()>> &jobs) {
+    size_t num_threads = std::min(jobs.size(), (size_t)num_compile_threads());
+    if (num_threads <= 1) {
+        for (const auto &job : jobs) {
+            job();
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors;
+    {
+        ThreadPool<std::exception_ptr> pool(num_threads);
+        std::vector<std::future<std::exception_ptr>> results;
+        for (const auto &job : jobs) {
+            results.push_back(pool.async([job]() -> std::exception_ptr {
+#ifdef WITH_EXCEPTIONS
+                try {
+                    job();
+                } catch (...) {
+                    return std::current_exception();
+                }
+#else
+                job();
+#endif
+                return nullptr;
+            }));
+        }
+        for (auto &r : results) {
+            errors.push_back(r.get());
+        }
+    }
+#ifdef WITH_EXCEPTIONS
+    for (const auto &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+#endif
+}
+
 struct TickStackEntry {
     std::chrono::time_point<std::chrono::high_resolution_clock> time;
     string file;
@@ -15,6 +15,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <string>
 #include <utility>
@@ -262,6 +263,19 @@ void dir_rmdir(const std::string &name);
 /** Wrapper for stat(). Asserts upon error. */
 FileStat file_stat(const std::string &name);
 
+/** Read the entire contents of a file into a vector<char>. The file
+ * is read in binary mode. Errors trigger an assertion failure. */
+std::vector<char> read_entire_file(const std::string &pathname);
+
+/** Create or replace the contents of a file with a given pointer-and-length
+ * of memory. If the file doesn't exist, it is created; if it does exist, it
+ * is completely overwritten. Any error triggers an assertion failure. */
+void write_entire_file(const std::string &pathname, const void *source, size_t source_len);
+
+inline void write_entire_file(const std::string &pathname, const std::vector<char> &source) {
+    write_entire_file(pathname, source.data(), source.size());
+}
+
 /** A simple utility class that creates a temporary file in its ctor and
  * deletes that file in its dtor; this is useful for temporary files that you
  * want to ensure are deleted when exiting a certain scope. Since this is essentially
@@ -293,6 +307,17 @@ bool sub_would_overflow(int bits, int64_t a, int64_t b);
 bool mul_would_overflow(int bits, int64_t a, int64_t b);
 // @}
 
+/** The number of threads the compiler uses for independent pieces of
+ * work, such as codegen for separate targets or bounds inference for
+ * separate stages. This defaults to one per core; HL_NUM_COMPILE_THREADS
+ * overrides it, and setting it to 1 does everything serially. */
+int num_compile_threads();
+
+/** Run a set of independent jobs across up to num_compile_threads()
+ * threads, and wait for them all to finish. Errors are reported in job
+ * order, as they would be if the jobs had run serially. */
+void run_compile_jobs(const std::vector<std::function<void()>> &jobs);
+
 /** Helper class for saving/restoring variable values on the stack, to allow
  * for early-exit that preserves correctness */
 template<typename T>
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <set>
 
 #include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
@@ -249,9 +250,24 @@ class PredicateLoadStore : public IRMutator2 {
                 << "We are inside a hexagon loop, but the target doesn't have hexagon's features\n";
             return true;
         } else if (target.arch == Target::X86) {
+            if (target.has_feature(Target::AVX512_Skylake) ||
+                target.has_feature(Target::AVX512_Cannonlake) ||
+                target.has_feature(Target::AVX512_Cascadelake)) {
+                // AVX512BW has masked loads and stores of every
+                // lane size
+                return bit_size >= 8;
+            } else if (target.has_feature(Target::AVX512) ||
+                       target.has_feature(Target::AVX512_KNL)) {
+                // AVX512F only masks 32- and 64-bit lanes
+                return bit_size >= 32;
+            }
             // Should only attempt to predicate store/load if the lane size is
             // no less than 4
             return (bit_size == 32) && (lanes >= 4);
+        } else if (target.arch == Target::ARM && target.bits == 64 &&
+                   target.has_feature(Target::SVE)) {
+            // SVE has masked loads and stores of every lane size
+            return bit_size >= 8;
         }
         // For other architecture, do not predicate vector load/store
         return false;
@@ -343,6 +359,132 @@ public:
     }
 };
 
+// If-convert a branch by blending the values it stores with the
+// values already in memory, for targets without masked stores. Only
+// valid for branches that would be safe to run on every lane, and
+// that store to distinct addresses in each lane.
+class BlendStores : public IRMutator2 {
+    Expr predicate;
+    int lanes;
+    bool valid;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const Store *op) override {
+        const Ramp *r = op->index.as<Ramp>();
+        if (!r || !is_const(r->stride) || is_zero(r->stride) ||
+            op->value.type().lanes() != lanes) {
+            valid = false;
+            return op;
+        }
+        Expr old_value = Load::make(op->value.type(), op->name, op->index,
+                                    Buffer<>(), op->param, const_true(lanes));
+        Expr value = Select::make(predicate, op->value, old_value);
+        return Store::make(op->name, value, op->index, op->param,
+                           op->predicate);
+    }
+
+    Expr visit(const Call *op) override {
+        // Calls with side-effects can't be run on inactive lanes.
+        valid = valid && op->is_pure();
+        return IRMutator2::visit(op);
+    }
+
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        // Anything other than straight-line code might do something
+        // on inactive lanes we can't undo.
+        switch (s->node_type) {
+        case IRNodeType::Store:
+        case IRNodeType::LetStmt:
+        case IRNodeType::Block:
+        case IRNodeType::IfThenElse:
+        case IRNodeType::Evaluate:
+            return IRMutator2::mutate(s);
+        default:
+            valid = false;
+            return s;
+        }
+    }
+
+    BlendStores(Expr p) : predicate(p), lanes(p.type().lanes()), valid(true) {}
+
+    bool is_valid() const {
+        return valid;
+    }
+};
+
+// Check if a vector condition is data-dependent, i.e. it only varies
+// across the lanes because of values loaded from memory. Bounds
+// inference can't have used such a condition to shrink the region
+// accessed by the branches, so they are safe to run on every lane.
+class IsDataDependent : public IRVisitor {
+    const Scope<Expr> &scope;
+    const string &widening_suffix;
+    int in_load = 0;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        in_load++;
+        IRVisitor::visit(op);
+        in_load--;
+    }
+
+    void visit(const Ramp *op) override {
+        result = result && in_load > 0;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (in_load == 0 && ends_with(op->name, widening_suffix)) {
+            string name = op->name.substr(0, op->name.size() - widening_suffix.size());
+            if (scope.contains(name)) {
+                scope.get(name).accept(this);
+            } else {
+                result = false;
+            }
+        }
+    }
+
+public:
+    bool result = true;
+
+    IsDataDependent(const Scope<Expr> &s, const string &suffix) :
+        scope(s), widening_suffix(suffix) {}
+};
+
+// A rough count of the operations needed to run a Stmt once.
+class BranchCost : public IRGraphVisitor {
+    std::set<const IRNode *> counted;
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Load *op) override {
+        cost += 4;
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        cost += 4;
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    using IRGraphVisitor::include;
+
+    int cost = 0;
+
+    void include(const Expr &e) override {
+        if (counted.insert(e.get()).second) {
+            cost++;
+        }
+        IRGraphVisitor::include(e);
+    }
+};
+
 // Substitutes a vector for a scalar var in a Stmt. Used on the
 // body of every vectorized loop.
 class VectorSubs : public IRMutator2 {
@@ -701,6 +843,33 @@ class VectorSubs : public IRMutator2 {
         return (op->condition.type().lanes() > 1) ? scalarize(op) : op;
     }
 
+    // Decide whether an if-converted branch is expensive enough that
+    // it's worth checking if any lanes are active, and skipping it if
+    // none are.
+    Stmt skip_if_no_lanes_active(Expr cond, Stmt s) {
+        int lanes = cond.type().lanes();
+        int log2_lanes = 0;
+        while ((1 << log2_lanes) < lanes) {
+            log2_lanes++;
+        }
+        // Reducing the condition across the lanes takes about one
+        // shuffle and one op per halving, plus a compare and branch.
+        int skip_cost = 2 * log2_lanes + 4;
+        BranchCost cost;
+        s.accept(&cost);
+        // Only skip when the check would cost at most a quarter of
+        // the work it might save, so it's cheap even when it never
+        // skips anything.
+        if (cost.cost < 4 * skip_cost) {
+            return s;
+        }
+        Expr any_active = extract_lane(cond, 0);
+        for (int i = 1; i < lanes; i++) {
+            any_active = any_active || extract_lane(cond, i);
+        }
+        return IfThenElse::make(any_active, s);
+    }
+
     Stmt visit(const IfThenElse *op) override {
         Expr cond = mutate(op->condition);
         int lanes = cond.type().lanes();
@@ -716,18 +885,53 @@ class VectorSubs : public IRMutator2 {
             // which would mean control flow divergence within the
             // SIMD lanes.
 
+            // Compute the condition once, and use it as a mask for
+            // both branches.
+            string mask_name = unique_name('t');
+            Expr mask = Variable::make(cond.type(), mask_name);
+
             bool vectorize_predicate = !uses_gpu_vars(cond);
-            Stmt predicated_stmt;
+            Stmt predicated_then, predicated_else;
             if (vectorize_predicate) {
-                PredicateLoadStore p(var, cond, in_hexagon, target);
-                predicated_stmt = p.mutate(then_case);
+                PredicateLoadStore p(var, mask, in_hexagon, target);
+                predicated_then = p.mutate(then_case);
                 vectorize_predicate = p.is_vectorized();
             }
             if (vectorize_predicate && else_case.defined()) {
-                PredicateLoadStore p(var, !cond, in_hexagon, target);
-                predicated_stmt = Block::make(predicated_stmt, p.mutate(else_case));
+                PredicateLoadStore p(var, !mask, in_hexagon, target);
+                predicated_else = p.mutate(else_case);
                 vectorize_predicate = p.is_vectorized();
             }
+            if (!vectorize_predicate && !uses_gpu_vars(cond)) {
+                // The target can't mask these loads and stores, but if
+                // the branches are safe to run on every lane we can
+                // blend their stores instead.
+                IsDataDependent data_dependent(scope, widening_suffix);
+                cond.accept(&data_dependent);
+                if (data_dependent.result) {
+                    BlendStores blend_then(mask);
+                    predicated_then = blend_then.mutate(then_case);
+                    vectorize_predicate = blend_then.is_valid();
+                    if (vectorize_predicate && else_case.defined()) {
+                        BlendStores blend_else(!mask);
+                        predicated_else = blend_else.mutate(else_case);
+                        vectorize_predicate = blend_else.is_valid();
+                    }
+                }
+            }
+
+            Stmt predicated_stmt, skipping_stmt;
+            if (vectorize_predicate) {
+                predicated_stmt = predicated_then;
+                skipping_stmt = skip_if_no_lanes_active(mask, predicated_then);
+                if (else_case.defined()) {
+                    predicated_stmt = Block::make(predicated_stmt, predicated_else);
+                    skipping_stmt = Block::make(skipping_stmt,
+                                                skip_if_no_lanes_active(!mask, predicated_else));
+                }
+                predicated_stmt = LetStmt::make(mask_name, cond, predicated_stmt);
+                skipping_stmt = LetStmt::make(mask_name, cond, skipping_stmt);
+            }
 
             debug(4) << "IfThenElse should vectorize predicate over var " << var << "? " << vectorize_predicate << "; cond: " << cond << "\n";
             debug(4) << "Predicated stmt:\n" << predicated_stmt << "\n";
@@ -775,7 +979,7 @@ class VectorSubs : public IRMutator2 {
                     debug(4) << "...Scalarizing vector predicate: \n" << Stmt(op) << "\n";
                     return scalarize(op);
                 } else {
-                    Stmt stmt = predicated_stmt;
+                    Stmt stmt = skipping_stmt;
                     debug(4) << "...Predicated IfThenElse: \n" << stmt << "\n";
                     return stmt;
                 }
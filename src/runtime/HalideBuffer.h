@@ -12,6 +12,7 @@
 #include <atomic>
 #include <algorithm>
 #include <limits>
+#include <mutex>
 #include <stdint.h>
 #include <string.h>
 
@@ -89,6 +90,149 @@ struct DeviceRefCount {
     BufferDeviceOwnership ownership{BufferDeviceOwnership::Allocated};
 };
 
+/** A thread-safe cache of host allocations. Blocks are binned by
+ * size class (powers of two), and freed blocks are kept for reuse by
+ * later allocations of the same class rather than handed back to the
+ * system, which avoids allocator churn when buffers of the same
+ * shape are made over and over. There is a single pool per process.
+ *
+ * To allocate a Buffer from the pool, pass allocate and deallocate
+ * to Buffer::allocate or Buffer::make_with_shape_of, e.g.:
+ \code
+ Buffer<float> out(nullptr, width, height);
+ out.allocate(BufferPool::allocate, BufferPool::deallocate);
+ \endcode
+ *
+ * halide_malloc and halide_free have the signatures of the Halide
+ * runtime allocator, so the internal allocations of pipelines can
+ * use the pool too: pass them to halide_set_custom_malloc and
+ * halide_set_custom_free in AOT code, or to
+ * Func::set_custom_allocator when JIT compiling. All blocks are
+ * aligned to 128 bytes, and may be read slightly beyond either end,
+ * as halide_malloc requires.
+ */
+class BufferPool {
+    // Stored just before each block handed out.
+    struct BlockHeader {
+        void *raw;
+        size_t size_class;
+    };
+
+    static constexpr size_t alignment = 128;
+    static constexpr size_t min_size_class = 6;
+    static constexpr size_t num_size_classes = 8 * sizeof(size_t);
+
+    std::mutex mutex;
+    std::vector<void *> free_blocks[num_size_classes];
+    size_t cached = 0;
+    size_t max_cached = (size_t)256 << 20;
+
+    static BufferPool &get() {
+        // Never destroyed, so that Buffers that outlive static
+        // destruction can still give their memory back.
+        static BufferPool *pool = new BufferPool;
+        return *pool;
+    }
+
+    static size_t size_class_of(size_t size) {
+        size_t c = min_size_class;
+        while (c + 1 < num_size_classes && ((size_t)1 << c) < size) {
+            c++;
+        }
+        return c;
+    }
+
+public:
+    /** Allocate a block of at least size bytes, reusing a cached
+     * block if there is one. Returns nullptr on failure. */
+    static void *allocate(size_t size) {
+        BufferPool &pool = get();
+        const size_t c = size_class_of(size);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            std::vector<void *> &blocks = pool.free_blocks[c];
+            if (!blocks.empty()) {
+                void *ptr = blocks.back();
+                blocks.pop_back();
+                pool.cached -= (size_t)1 << c;
+                return ptr;
+            }
+        }
+        // Leave room for the header and alignment before the block,
+        // and for overreads after it.
+        void *raw = malloc(((size_t)1 << c) + 2 * alignment);
+        if (!raw) {
+            return nullptr;
+        }
+        uintptr_t start = (uintptr_t)raw + sizeof(BlockHeader) + alignment - 1;
+        void *ptr = (void *)(start & ~(uintptr_t)(alignment - 1));
+        BlockHeader *header = (BlockHeader *)ptr - 1;
+        header->raw = raw;
+        header->size_class = c;
+        return ptr;
+    }
+
+    /** Return a block from allocate to the pool. The block is freed
+     * instead if the pool already holds max_cached_bytes. */
+    static void deallocate(void *ptr) {
+        if (!ptr) {
+            return;
+        }
+        BufferPool &pool = get();
+        BlockHeader *header = (BlockHeader *)ptr - 1;
+        const size_t bytes = (size_t)1 << header->size_class;
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (pool.cached + bytes <= pool.max_cached) {
+                pool.free_blocks[header->size_class].push_back(ptr);
+                pool.cached += bytes;
+                return;
+            }
+        }
+        free(header->raw);
+    }
+
+    /** Versions of allocate and deallocate with the signatures of
+     * halide_malloc and halide_free. */
+    // @{
+    static void *halide_malloc(void *user_context, size_t size) {
+        return allocate(size);
+    }
+    static void halide_free(void *user_context, void *ptr) {
+        deallocate(ptr);
+    }
+    // @}
+
+    /** Free all cached blocks. Blocks in use are unaffected. */
+    static void release_cached() {
+        BufferPool &pool = get();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        for (std::vector<void *> &blocks : pool.free_blocks) {
+            for (void *ptr : blocks) {
+                free(((BlockHeader *)ptr - 1)->raw);
+            }
+            blocks.clear();
+        }
+        pool.cached = 0;
+    }
+
+    /** Get the total size of the blocks cached for reuse. */
+    static size_t cached_bytes() {
+        BufferPool &pool = get();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        return pool.cached;
+    }
+
+    /** Set the most memory the pool may hold on to for reuse. The
+     * default is 256MB. Does not free blocks already cached; call
+     * release_cached for that. */
+    static void set_max_cached_bytes(size_t bytes) {
+        BufferPool &pool = get();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.max_cached = bytes;
+    }
+};
+
 /** A templated Buffer class that wraps halide_buffer_t and adds
  * functionality. When using Halide from C++, this is the preferred
  * way to create input and output buffers. The overhead of using this
@@ -164,6 +308,18 @@ public:
         return alloc != nullptr;
     }
 
+    /** Take ownership of host memory this Buffer already points to,
+     * but which was allocated by something other than allocate()
+     * (e.g. a memory-mapped file). The caller constructs the header,
+     * typically as the first member of a larger struct recording how
+     * to release the memory. When the last Buffer sharing the memory
+     * goes away, header->deallocate_fn is called on the header. The
+     * Buffer must not already own its host memory. */
+    void adopt_host_allocation(AllocationHeader *header) {
+        assert(!owns_host_memory() && header && header->ref_count == 1);
+        alloc = header;
+    }
+
 private:
     /** Increment the reference count of any owned allocation */
     void incref() const {
@@ -1190,9 +1346,16 @@ public:
      * sprite onto a framebuffer, you'll want to translate the sprite
      * to the correct location first like so: \code
      * framebuffer.copy_from(sprite.translated({x, y})); \endcode
+     *
+     * Dense runs are copied with memcpy, and conversions between
+     * interleaved and planar layouts with up to four channels use
+     * loops the compiler can vectorize. Large copies can be split
+     * across a thread pool by passing a parallel for loop, e.g.
+     * halide_do_par_for if the Halide runtime is linked in: \code
+     * dst.copy_from(src, halide_do_par_for); \endcode
     */
     template<typename T2, int D2>
-    void copy_from(const Buffer<T2, D2> &other) {
+    void copy_from(const Buffer<T2, D2> &other, halide_do_par_for_t do_par_for = nullptr) {
         static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
@@ -1215,28 +1378,20 @@ public:
         }
 
         // If T is void, we need to do runtime dispatch to an
-        // appropriately-typed lambda. We're copying, so we only care
+        // appropriately-typed copy. We're copying, so we only care
         // about the element size.
         if (type().bytes() == 1) {
             using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_from_impl((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, do_par_for);
         } else if (type().bytes() == 2) {
             using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_from_impl((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, do_par_for);
         } else if (type().bytes() == 4) {
             using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_from_impl((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, do_par_for);
         } else if (type().bytes() == 8) {
             using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_from_impl((Buffer<MemType, D> &)dst, (Buffer<const MemType, D> &)src, do_par_for);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -1630,7 +1785,13 @@ public:
     }
 
     int device_and_host_malloc(const struct halide_device_interface_t *device_interface, void *ctx = nullptr) {
-        return device_interface->device_and_host_malloc(ctx, &buf, device_interface);
+        int ret = device_interface->device_and_host_malloc(ctx, &buf, device_interface);
+        if (ret == 0 && buf.device) {
+            // Make sure the destructor frees the host side too.
+            dev_ref_count = new DeviceRefCount;
+            dev_ref_count->ownership = BufferDeviceOwnership::AllocatedDeviceAndHost;
+        }
+        return ret;
     }
 
     int device_and_host_free(const struct halide_device_interface_t *device_interface, void *ctx = nullptr) {
@@ -2050,6 +2211,169 @@ private:
     }
     // @}
 
+    /** Helper functions for copy_from. */
+    // @{
+
+    // Copy from an interleaved layout to a planar one, or vice
+    // versa. With the channel count known at compile time, these
+    // loops vectorize into shuffles.
+    template<typename MemType, int C>
+    static void copy_deinterleave(MemType *dst, int plane_stride, const MemType *src, int n) {
+        for (int x = 0; x < n; x++) {
+            for (int c = 0; c < C; c++) {
+                dst[c * plane_stride + x] = src[x * C + c];
+            }
+        }
+    }
+
+    template<typename MemType, int C>
+    static void copy_interleave(MemType *dst, const MemType *src, int plane_stride, int n) {
+        for (int x = 0; x < n; x++) {
+            for (int c = 0; c < C; c++) {
+                dst[x * C + c] = src[c * plane_stride + x];
+            }
+        }
+    }
+
+    // Copy the innermost two dimensions of a loop nest, which are in
+    // the given order. Returns false if they don't form a channel
+    // permutation we have a special case for.
+    template<typename MemType>
+    static bool copy_transpose(const for_each_value_task_dim<2> &a, const for_each_value_task_dim<2> &b,
+                               MemType *dst, const MemType *src) {
+        if (a.stride[0] != 1 || b.stride[1] != 1) {
+            return false;
+        }
+        if (a.stride[1] == b.extent) {
+            // The source is interleaved and the destination is planar.
+            switch (b.extent) {
+            case 2: copy_deinterleave<MemType, 2>(dst, b.stride[0], src, a.extent); return true;
+            case 3: copy_deinterleave<MemType, 3>(dst, b.stride[0], src, a.extent); return true;
+            case 4: copy_deinterleave<MemType, 4>(dst, b.stride[0], src, a.extent); return true;
+            }
+        } else if (b.stride[0] == a.extent) {
+            // The source is planar and the destination is interleaved.
+            switch (a.extent) {
+            case 2: copy_interleave<MemType, 2>(dst, src, a.stride[1], b.extent); return true;
+            case 3: copy_interleave<MemType, 3>(dst, src, a.stride[1], b.extent); return true;
+            case 4: copy_interleave<MemType, 4>(dst, src, a.stride[1], b.extent); return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename MemType>
+    static void copy_helper(int d, const for_each_value_task_dim<2> *t, MemType *dst, const MemType *src) {
+        if (d == 0) {
+            if (t[0].stride[0] == 1 && t[0].stride[1] == 1) {
+                memcpy(dst, src, t[0].extent * sizeof(MemType));
+            } else {
+                for (int i = 0; i < t[0].extent; i++) {
+                    dst[i * t[0].stride[0]] = src[i * t[0].stride[1]];
+                }
+            }
+        } else if (d == 1 && copy_transpose(t[0], t[1], dst, src)) {
+            return;
+        } else {
+            for (int i = t[d].extent; i != 0; i--) {
+                copy_helper(d - 1, t, dst, src);
+                dst += t[d].stride[0];
+                src += t[d].stride[1];
+            }
+        }
+    }
+
+    template<typename MemType>
+    struct copy_task {
+        const for_each_value_task_dim<2> *t;
+        int d, split_dim, chunk;
+        MemType *dst;
+        const MemType *src;
+    };
+
+    // Copy one chunk of the split dimension of a loop nest.
+    template<typename MemType>
+    static int copy_task_fn(void *user_context, int i, uint8_t *closure) {
+        const copy_task<MemType> *task = (const copy_task<MemType> *)closure;
+        for_each_value_task_dim<2> *t =
+            (for_each_value_task_dim<2> *)HALIDE_ALLOCA(task->d * sizeof(for_each_value_task_dim<2>));
+        for (int j = 0; j < task->d; j++) {
+            t[j] = task->t[j];
+        }
+        for_each_value_task_dim<2> &split = t[task->split_dim];
+        int min = i * task->chunk;
+        split.extent = std::min(task->chunk, split.extent - min);
+        copy_helper(task->d - 1, t,
+                    task->dst + (ptrdiff_t)min * split.stride[0],
+                    task->src + (ptrdiff_t)min * split.stride[1]);
+        return 0;
+    }
+
+    template<typename MemType>
+    static void copy_from_impl(Buffer<MemType, D> &dst, const Buffer<const MemType, D> &src, halide_do_par_for_t do_par_for) {
+        for_each_value_task_dim<2> *t =
+            (for_each_value_task_dim<2> *)HALIDE_ALLOCA((dst.dimensions()+1) * sizeof(for_each_value_task_dim<2>));
+        t[0].extent = 1;
+        t[0].stride[0] = t[0].stride[1] = 1;
+
+        // Order the dimensions by the destination stride, so that the
+        // writes are cache-coherent, and flatten the dimensions that
+        // are contiguous in both buffers.
+        int d = 0;
+        size_t size = 1;
+        for (int i = 0; i < dst.dimensions(); i++) {
+            for_each_value_task_dim<2> dim;
+            dim.extent = dst.dim(i).extent();
+            dim.stride[0] = dst.dim(i).stride();
+            dim.stride[1] = src.dim(i).stride();
+            size *= dim.extent;
+            if (dim.extent == 1) {
+                continue;
+            }
+            int j = d++;
+            t[j] = dim;
+            for (; j > 0 && t[j].stride[0] < t[j-1].stride[0]; j--) {
+                std::swap(t[j], t[j-1]);
+            }
+        }
+        for (int i = 1; i < d; i++) {
+            if (t[i-1].stride[0] * t[i-1].extent == t[i].stride[0] &&
+                t[i-1].stride[1] * t[i-1].extent == t[i].stride[1]) {
+                t[i-1].extent *= t[i].extent;
+                for (int j = i; j < d - 1; j++) {
+                    t[j] = t[j+1];
+                }
+                i--;
+                d--;
+            }
+        }
+        if (d == 0) {
+            // A single element.
+            d = 1;
+        }
+
+        // Below this many bytes, the overhead of the thread pool
+        // isn't worth it.
+        const size_t min_parallel_size = 1 << 18;
+        if (do_par_for && size * sizeof(MemType) >= min_parallel_size) {
+            // Split the outermost dimension into tasks. If there are
+            // only two dimensions left, split the longer one instead,
+            // so that the interleaving special cases still apply.
+            int s = d - 1;
+            if (d == 2 && t[0].extent > t[1].extent) {
+                s = 0;
+            }
+            size_t slice_size = size / t[s].extent * sizeof(MemType);
+            int chunk = (int)std::max((size_t)1, (min_parallel_size / 4 + slice_size - 1) / slice_size);
+            int tasks = (t[s].extent + chunk - 1) / chunk;
+            copy_task<MemType> task = {t, d, s, chunk, dst.begin(), src.begin()};
+            do_par_for(nullptr, copy_task_fn<MemType>, 0, tasks, (uint8_t *)&task);
+        } else {
+            copy_helper(d - 1, t, dst.begin(), src.begin());
+        }
+    }
+    // @}
+
 public:
     /** Call a function on every value in the buffer, and the
      * corresponding values in some number of other buffers of the
@@ -281,6 +281,158 @@ extern int halide_default_semaphore_release(struct halide_semaphore_t *, int n);
 extern bool halide_default_semaphore_try_acquire(struct halide_semaphore_t *, int n);
 // @}
 
+/** An alternative do_par_for built on the default thread pool that
+ * splits the loop into one contiguous range per thread up front. Idle
+ * threads steal the back half of another thread's remaining range
+ * using lock-free compare-and-swap, so the work queue lock is only
+ * taken a handful of times per loop instead of once per
+ * iteration. This helps many-core machines running lots of small
+ * parallel loops. Async producers and do_parallel_tasks are
+ * unaffected. Install it with halide_set_custom_do_par_for or
+ * halide_set_custom_parallel_runtime. */
+extern int halide_work_stealing_do_par_for(void *user_context,
+                                           halide_task_t task,
+                                           int min, int size, uint8_t *closure);
+
+/** An alternative do_par_for built on the default thread pool that
+ * hands out iterations in chunks. Each thread claims its next chunk
+ * with an atomic fetch-add on a shared counter, and sizes it from its
+ * own measurements of how long an iteration takes, so that every
+ * chunk takes tens of microseconds. Cheap iterations are batched to
+ * amortize the cost of claiming them, expensive ones are handed out
+ * individually, and faster cores claim more than slower ones. This
+ * makes the split factor before parallel() much less important. Loop
+ * tasks run through do_parallel_tasks already claim adaptively sized
+ * chunks in the default thread pool. Install it with
+ * halide_set_custom_do_par_for or halide_set_custom_parallel_runtime. */
+extern int halide_adaptive_do_par_for(void *user_context,
+                                      halide_task_t task,
+                                      int min, int size, uint8_t *closure);
+
+/** How threads of the default thread pool wait when there is no
+ * work for them. A thread that runs out of work first polls for new
+ * work spin_count times, then polls yield_count more times, yielding
+ * its timeslice between polls, and only then parks on a condition
+ * variable (a futex on Linux) until it is woken. Polling cuts the
+ * latency of picking up work that arrives soon after, at the cost of
+ * burning CPU time while idle. The default is to park straight away,
+ * i.e. both counts zero. */
+struct halide_spin_policy_t {
+    int spin_count;
+    int yield_count;
+};
+
+/** Set or get the spin policy of the default thread pool. Pipelines
+ * can override it with a halide_pipeline_control_t. */
+// @{
+extern void halide_set_spin_policy(const struct halide_spin_policy_t *policy);
+extern void halide_get_spin_policy(struct halide_spin_policy_t *policy);
+// @}
+
+/** Counters describing how the threads of the default thread pool
+ * have waited for work. The wake-up latency is the time from work
+ * being enqueued (or a job completing or a semaphore being released)
+ * to a parked thread running again. It is approximate, as a thread
+ * may be woken for a reason other than the latest one. */
+struct halide_thread_pool_stats_t {
+    /** How many times a thread parked. */
+    uint64_t parks;
+    /** How many times a parked thread woke up, and the total and
+     * largest latency of those wake-ups. */
+    uint64_t wakeups;
+    uint64_t total_wakeup_latency_ns;
+    uint64_t max_wakeup_latency_ns;
+    /** How many times a polling thread saw new work arrive, and so
+     * avoided parking. */
+    uint64_t polls_woken;
+};
+
+/** Get or reset the counters of the default thread pool. */
+// @{
+extern void halide_get_thread_pool_stats(struct halide_thread_pool_stats_t *stats);
+extern void halide_reset_thread_pool_stats();
+// @}
+
+/** Scheduling controls for one invocation of a pipeline, honored by
+ * the default thread pool. Jobs of invocations with a higher priority
+ * are run before jobs of invocations with a lower one whenever both
+ * are runnable, and the priority may be changed at any time, e.g. to
+ * deprioritize a pipeline that is already running. Invocations
+ * without a control have priority zero. The priority and cancelled
+ * fields must be updated with atomic stores, or with the functions
+ * below.
+ *
+ * If spin_policy is not NULL, it overrides the thread pool's spin
+ * policy for the thread that waits for the invocation to complete,
+ * and for worker threads that have just run one of its tasks.
+ *
+ * If thread_pool is not NULL, the invocation's parallel work runs on
+ * that isolated thread pool instead of the default one. It must not
+ * be changed while an invocation using the control is running. */
+struct halide_pipeline_control_t {
+    int priority;
+    int cancelled;
+    const struct halide_spin_policy_t *spin_policy;
+    struct halide_thread_pool_t *thread_pool;
+};
+
+/** Initialize a pipeline control with the given priority, not
+ * cancelled, with no spin policy of its own, and running on the
+ * default thread pool. */
+extern void halide_pipeline_control_init(struct halide_pipeline_control_t *control, int priority);
+
+/** Change the priority of the invocations using a control. */
+extern void halide_set_pipeline_priority(struct halide_pipeline_control_t *control, int priority);
+
+/** Run the invocations using a control on an isolated thread pool, or
+ * on the default one if pool is NULL. */
+extern void halide_set_pipeline_thread_pool(struct halide_pipeline_control_t *control,
+                                            struct halide_thread_pool_t *pool);
+
+/** Cancel the invocations using a control. This may be called from
+ * any thread. Cancellation is checked between the tasks of parallel
+ * loops, so a cancelled pipeline stops starting new tasks, finishes
+ * the ones in flight, and returns
+ * halide_error_code_cancelled. Pipelines with no parallel loops run to
+ * completion. */
+extern void halide_cancel_pipeline(struct halide_pipeline_control_t *control);
+
+/** The thread pool finds the control for an invocation by calling
+ * this with the invocation's user_context. The default returns NULL,
+ * i.e. no control. Replace it to map user contexts to controls, e.g.
+ * by storing a control in the struct that the user_context points
+ * to. It is called whenever a parallel loop starts, so it should be
+ * cheap. Returns the old handler. */
+//@{
+typedef struct halide_pipeline_control_t *(*halide_get_pipeline_control_t)(void *user_context);
+extern halide_get_pipeline_control_t halide_set_custom_get_pipeline_control(halide_get_pipeline_control_t handler);
+extern struct halide_pipeline_control_t *halide_get_pipeline_control(void *user_context);
+//@}
+
+/** An isolated thread pool, with its own worker threads and work
+ * queue, so that the pipelines running on it don't compete for
+ * threads with those running on other pools. Pipelines run on the
+ * default thread pool unless their halide_pipeline_control_t names
+ * another one, so a pool is selected per invocation via the
+ * user_context. Isolated pools are only supported by the default
+ * implementation of the thread pool. */
+struct halide_thread_pool_t;
+
+/** Create an isolated thread pool with the given name. num_threads is
+ * the number of threads doing work, as for halide_set_num_threads,
+ * with zero meaning the default. If numa_node is non-negative, the
+ * worker threads are pinned to that NUMA node. Threads are created
+ * when work is first run on the pool. Returns NULL on failure. */
+extern struct halide_thread_pool_t *halide_thread_pool_create(const char *name, int num_threads, int numa_node);
+
+/** Find an isolated thread pool by name. Returns NULL if there is
+ * none. */
+extern struct halide_thread_pool_t *halide_thread_pool_find(const char *name);
+
+/** Stop the threads of an isolated thread pool and free it. No
+ * pipeline may be running on it. */
+extern void halide_thread_pool_destroy(struct halide_thread_pool_t *pool);
+
 struct halide_thread;
 
 /** Spawn a thread. Returns a handle to the thread for the purposes of
@@ -305,6 +457,16 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Enable or disable NUMA-aware scheduling in Halide's thread
+ * pool. When enabled on a host with several NUMA nodes, worker
+ * threads are pinned to nodes and parallel loops are split into
+ * contiguous per-node chunks, so that a consumer tends to run on the
+ * node where a parallel producer wrote the same rows. Can also be
+ * enabled by setting HL_NUMA_AWARE=1. Pinning only applies to threads
+ * created afterwards, so call this before running any
+ * pipelines. Returns the old setting. */
+extern bool halide_set_numa_aware(bool numa_aware);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -333,6 +495,28 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** Set the size in bytes at or above which halide_default_malloc
+ * aligns allocations to 2MB and asks the OS to back them with
+ * transparent huge pages (madvise(MADV_HUGEPAGE) on Linux and
+ * Android; ignored elsewhere). This cuts TLB misses when streaming
+ * through large intermediates. Zero, the default, disables it. Can
+ * also be set in megabytes with the environment variable
+ * HL_HUGE_PAGE_THRESHOLD_MB. Returns the old threshold. */
+extern size_t halide_set_huge_page_threshold(size_t bytes);
+
+/** On NUMA hosts, pages are placed on the node of the thread that
+ * first writes them. If a first-touch handler is set, the default
+ * halide_malloc calls it on every allocation of at least 1MB before
+ * returning it. halide_default_first_touch writes one byte per page
+ * from a parallel loop, which spreads the pages over the nodes the
+ * same way a NUMA-aware parallel loop over the buffer's outermost
+ * dimension would. Returns the old handler. */
+//@{
+typedef void (*halide_first_touch_t)(void *user_context, void *ptr, size_t size);
+extern halide_first_touch_t halide_set_custom_first_touch(halide_first_touch_t user_first_touch);
+extern void halide_default_first_touch(void *user_context, void *ptr, size_t size);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -380,7 +564,8 @@ typedef enum halide_type_code_t
     halide_type_int = 0,   //!< signed integers
     halide_type_uint = 1,  //!< unsigned integers
     halide_type_float = 2, //!< floating point numbers
-    halide_type_handle = 3 //!< opaque pointer type (void *)
+    halide_type_handle = 3, //!< opaque pointer type (void *)
+    halide_type_bfloat = 4  //!< floating point numbers in the bfloat format
 } halide_type_code_t;
 
 // Note that while __attribute__ can go before or after the declaration,
@@ -644,7 +829,11 @@ struct halide_trace_packet_t {
  * Halide checks the for existence of an environment variable called
  * HL_TRACE_FILE and opens that file. If HL_TRACE_FILE is not defined,
  * it outputs trace information to stdout in a human-readable
- * format. */
+ * format. When writing to HL_TRACE_FILE, setting HL_TRACE_SAMPLE to N
+ * keeps only one in every N load and store events. Load and store
+ * events from different threads are buffered separately, so they may
+ * be written out of order relative to each other, but always before
+ * the end of the realization they belong to. */
 extern void halide_set_trace_file(int fd);
 
 /** Halide calls this to retrieve the file descriptor to write binary
@@ -659,6 +848,20 @@ extern int halide_get_trace_file(void *user_context);
  * (flushing the trace). Returns zero on success. */
 extern int halide_shutdown_trace();
 
+/** Record a timeline of the work done by the runtime (thread pool
+ * tasks, GPU kernel launches and buffer copies) and write it to the
+ * named file in the Chrome trace event JSON format, which can be
+ * loaded into chrome://tracing or Perfetto. If never called, Halide
+ * checks for an environment variable called HL_TIMELINE_FILE. Pass
+ * NULL to stop recording. The file is written by
+ * halide_timeline_flush, and at process exit. */
+extern void halide_set_timeline_file(const char *filename);
+
+/** Write the timeline recorded so far to the file set by
+ * halide_set_timeline_file. Should not be called while pipelines are
+ * running. Returns zero on success. */
+extern int halide_timeline_flush();
+
 /** All Halide GPU or device backend implementations provide an
  * interface to be used with halide_device_malloc, etc. This is
  * accessed via the functions below.
@@ -718,6 +921,89 @@ struct halide_device_interface_t {
 extern void halide_device_release(void *user_context,
                                   const struct halide_device_interface_t *device_interface);
 
+/** Control whether the device backends keep device allocations freed
+ * by Halide in a cache, to be reused by later allocations of a similar
+ * size, instead of returning them to the driver. Allocations made while
+ * reuse is enabled are rounded up to one of a set of size classes, which
+ * wastes at most an eighth of each allocation. Disabling reuse releases
+ * all cached allocations. Reuse is off by default unless the environment
+ * variable HL_REUSE_DEVICE_ALLOCATIONS is set to 1, which lets AOT
+ * pipelines opt in without any code changes. The cached allocations of a
+ * device context are released by halide_device_release. */
+extern int halide_reuse_device_allocations(void *user_context, bool);
+
+/** Determine whether device allocations are being reused. See
+ * halide_reuse_device_allocations. */
+extern bool halide_can_reuse_device_allocations(void *user_context);
+
+/** Set the maximum number of bytes each device backend keeps in its
+ * cache of freed allocations. Allocations freed while the cache is full
+ * are returned to the driver. The default is 256 MB, or the number of
+ * megabytes in the environment variable HL_DEVICE_ALLOCATION_CACHE_MB
+ * if it is set. */
+extern void halide_set_device_allocation_cache_limit(size_t bytes);
+
+/** Get the maximum number of bytes each device backend keeps in its
+ * cache of freed allocations. */
+extern size_t halide_device_allocation_cache_limit(void *user_context);
+
+/** Return all cached device allocations not in use by a buffer to the
+ * driver. */
+extern int halide_release_unused_device_allocations(void *user_context);
+
+/** A cache of device allocations, registered by a device backend so that
+ * halide_release_unused_device_allocations can empty it. */
+struct halide_device_allocation_pool {
+    int (*release_unused)(void *user_context);
+    struct halide_device_allocation_pool *next;
+};
+
+/** Register a device backend's allocation cache. Backends call this the
+ * first time they allocate through the cache; it should not be called
+ * directly. */
+extern void halide_register_device_allocation_pool(struct halide_device_allocation_pool *);
+
+/** The time spent by the device on the work of Halide pipelines, as
+ * measured by the device itself, with CUDA events, OpenCL profiling
+ * info, or Metal GPU timestamps. See halide_enable_device_timing. */
+struct halide_device_timing_t {
+    /** The total time spent running kernels, in nanoseconds. */
+    uint64_t kernel_ns;
+    /** The total time spent copying between host and device memory,
+     * or within device memory, in nanoseconds. */
+    uint64_t copy_ns;
+    /** The number of kernel launches and copies timed. Launches
+     * batched into one command are counted once. */
+    uint64_t kernels, copies;
+};
+
+/** Control whether the device backends time kernel launches and copies
+ * on the device. Timing adds a little work to each launch and copy,
+ * and is off by default unless the environment variable
+ * HL_DEVICE_TIMING is set to 1. On OpenCL, only command queues made
+ * while timing is enabled can be timed. */
+extern void halide_enable_device_timing(void *user_context, bool);
+
+/** Determine whether the device backends time their work. See
+ * halide_enable_device_timing. */
+extern bool halide_device_timing_is_enabled();
+
+/** Wait for the timed device work queued so far to finish, and get the
+ * totals accumulated since they were last reset. Resets the totals if
+ * reset is true. Returns zero on success. */
+extern int halide_get_device_timing(void *user_context, struct halide_device_timing_t *timing, bool reset);
+
+/** A source of device timings, registered by a device backend so that
+ * halide_get_device_timing can wait for the work it has timed. */
+struct halide_device_timer {
+    int (*collect)(void *user_context);
+    struct halide_device_timer *next;
+};
+
+/** Register a device backend's timer. Backends call this the first time
+ * they time some work; it should not be called directly. */
+extern void halide_register_device_timer(struct halide_device_timer *);
+
 /** Copy image data from device memory to host memory. This must be called
  * explicitly to copy back the results of a GPU-based filter. */
 extern int halide_copy_to_host(void *user_context, struct halide_buffer_t *buf);
@@ -745,6 +1031,16 @@ extern int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
                               const struct halide_device_interface_t *dst_device_interface,
                               struct halide_buffer_t *dst);
 
+/** Copy the box of a buffer with the given mins and extents from
+ * device memory to host memory, leaving the rest of the host memory
+ * untouched, and then clear the device_dirty flag. Used by loops
+ * scheduled with hetero_split, after which only the region computed
+ * on the device is newer on the device than on the host. The box is
+ * clamped to the bounds of the buffer. This should not be called
+ * directly. */
+extern int halide_copy_region_to_host(void *user_context, struct halide_buffer_t *buf,
+                                      const int *min, const int *extent);
+
 /** Give the destination buffer a device allocation which is an alias
  * for the same coordinate range in the source buffer. Modifies the
  * device, device_interface, and the device_dirty flag only. Only
@@ -836,11 +1132,90 @@ extern void halide_set_gpu_device(int n);
  * HL_GPU_DEVICE. */
 extern int halide_get_gpu_device(void *user_context);
 
+/** Halide calls these around loops scheduled with hetero_split and no
+ * fixed device fraction. halide_hetero_split_fraction returns the
+ * fraction of the loop's iterations to run on the device.
+ * halide_hetero_split_host_done is called once the host's share is
+ * done, and halide_hetero_split_merged once the device's share has
+ * been copied back too. The default implementation tunes the fraction
+ * from the time between these calls on previous runs. Implement all
+ * three yourself to use a different policy. */
+// @{
+extern float halide_hetero_split_fraction(void *user_context, const char *loop_name);
+extern int halide_hetero_split_host_done(void *user_context, const char *loop_name);
+extern int halide_hetero_split_merged(void *user_context, const char *loop_name,
+                                      int device_iterations, int host_iterations);
+// @}
+
+/** The functions the ranks of a distributed pipeline communicate
+ * with. See Func::distribute. All but rank and num_ranks return zero
+ * on success, or an error code on failure. tools/halide_mpi.h
+ * implements them with MPI. */
+struct halide_distributed_comm_t {
+    /** Return the rank of this process, and the number of ranks. */
+    // @{
+    int (*rank)(void *user_context);
+    int (*num_ranks)(void *user_context);
+    // @}
+
+    /** Gather size bytes from every rank into recv, in order of rank,
+     * on every rank. Must not return until it is done. */
+    int (*allgather)(void *user_context, const void *send, void *recv, size_t size);
+
+    /** Start sending size bytes to, or receiving them from, another
+     * rank, and return a handle to a request to wait for in
+     * *request. The data must not be touched until it is waited
+     * for. Messages between two ranks with the same tag arrive in the
+     * order they are sent. */
+    // @{
+    int (*isend)(void *user_context, const void *data, size_t size, int dest, int tag, void **request);
+    int (*irecv)(void *user_context, void *data, size_t size, int src, int tag, void **request);
+    // @}
+
+    /** Wait for a request started by isend or irecv to complete. */
+    int (*wait)(void *user_context, void *request);
+};
+
+/** Set the functions the ranks of distributed pipelines communicate
+ * with, and return the previous ones. If they are NULL, which is the
+ * default, there is a single rank, and it computes everything. Must
+ * not be called while a pipeline is running. */
+extern const struct halide_distributed_comm_t *
+halide_set_distributed_comm(const struct halide_distributed_comm_t *comm);
+
+/** Get the rank of this process in a distributed pipeline, and the
+ * number of ranks. */
+// @{
+extern int halide_distributed_rank(void *user_context);
+extern int halide_distributed_num_ranks(void *user_context);
+// @}
+
+/** Start and finish the halo exchange of a distributed Func. Halide
+ * calls these once the Func has been computed. The range
+ * [global_min, global_min + global_extent) of dimension dim of the
+ * buffer is divided evenly between the ranks, and each rank has
+ * computed its own slice of it. halide_distributed_exchange_begin
+ * starts sending the parts of this rank's slice that other ranks
+ * need, and receiving the parts of [needed_min, needed_min +
+ * needed_extent) that other ranks computed.
+ * halide_distributed_exchange_end waits for the exchange to finish,
+ * and does nothing if none is in progress for the buffer. */
+// @{
+extern int halide_distributed_exchange_begin(void *user_context, struct halide_buffer_t *buf, int dim,
+                                             int global_min, int global_extent,
+                                             int needed_min, int needed_extent);
+extern int halide_distributed_exchange_end(void *user_context, struct halide_buffer_t *buf);
+// @}
+
 /** Set the soft maximum amount of memory, in bytes, that the LRU
  *  cache will use to memoize Func results.  This is not a strict
  *  maximum in that concurrency and simultaneous use of memoized
  *  reults larger than the cache size can both cause it to
  *  temporariliy be larger than the size specified here.
+ *
+ *  With the memoize_shared target feature, this is instead the size of
+ *  the shared memory segment, and only has an effect before the segment
+ *  is created by the first process to use it.
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
@@ -901,11 +1276,61 @@ extern int halide_memoization_cache_store(void *user_context, const uint8_t *cac
   */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Pipelines call this instead of halide_device_free when they are
+ * done with the device allocation of a memoized result. A result
+ * computed on a device is stored in the cache along with its device
+ * allocation, and hits return the same allocation, so that memoized
+ * GPU Funcs stay on the device. This frees the allocation only if the
+ * cache doesn't own it. Either way, it is detached from the buffer.
+ * The cache frees the allocations it owns with halide_device_free when
+ * it evicts their results.
+ */
+extern int halide_memoization_cache_release_device(void *user_context, struct halide_buffer_t *buf);
+
+/** Compute a 64-bit hash of the contents, type and shape of a
+ * buffer. Funcs memoized with MemoizeKey::ContentHash put this in
+ * their cache key for each input buffer instead of rejecting
+ * them. Elements are hashed in logical order, so buffers with the same
+ * contents hash alike whatever their strides. Large buffers are hashed
+ * in chunks with halide_do_par_for. A device-dirty buffer is copied
+ * to the host first; if that fails, a value that matches no other key
+ * is returned.
+ */
+extern uint64_t halide_buffer_content_hash(void *user_context, struct halide_buffer_t *buf);
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Set a budget, in bytes, for the results of one memoized Func,
+ * identified by name. The Func's least recently used results are
+ * evicted when it goes over. Zero means no per-Func budget, which is
+ * the default. The overall budget set by
+ * halide_memoization_cache_set_size still applies.
+ */
+extern void halide_memoization_cache_set_func_size(const char *func_name, int64_t size);
+
+/** Statistics about one memoized Func in the default cache
+ * implementation. compute_time_ns is the total time spent between
+ * cache misses and the corresponding stores, i.e. computing the
+ * results. Eviction prefers entries that took less time to compute
+ * per byte. */
+struct halide_memoization_cache_func_stats_t {
+    const char *func_name;
+    uint64_t hits, misses, evictions;
+    uint64_t compute_time_ns;
+    int64_t bytes, max_bytes;
+};
+
+/** Fill in stats for up to max_funcs memoized Funcs. Returns the
+ * number of Funcs the cache has seen, which may be more than
+ * max_funcs. The func_name pointers remain valid until
+ * halide_memoization_cache_cleanup is called. With the memoize_shared
+ * target feature, the stats are those of all processes sharing the
+ * segment, and there are no evictions. */
+extern int halide_memoization_cache_get_stats(struct halide_memoization_cache_func_stats_t *stats, int max_funcs);
+
 /** Create a unique file with a name of the form prefixXXXXXsuffix in an arbitrary
  * (but writable) directory; this is typically $TMP or /tmp, but the specific
  * location is not guaranteed. (Note that the exact form of the file name
@@ -1127,6 +1552,10 @@ enum halide_error_code_t {
      * by zero was evaluated. */
     halide_error_code_integer_division_by_zero = -44,
 
+    /** The pipeline was cancelled with halide_cancel_pipeline before
+     * it completed. */
+    halide_error_code_cancelled = -45,
+
 };
 
 /** Halide calls the functions below on various error conditions. The
@@ -1186,6 +1615,11 @@ extern int halide_error_debug_to_file_failed(void *user_context, const char *fun
                                              const char *filename, int error_code);
 extern int halide_error_unaligned_host_ptr(void *user_context, const char *func_name, int alignment);
 extern int halide_error_host_is_null(void *user_context, const char *func_name);
+
+/** Called the first time a pipeline falls back to the version of
+ * itself that handles input or output buffers without a stride of
+ * one in dimension 0. Prints a warning once per process. */
+extern int halide_strided_fallback_warning(void *user_context, const char *buffer_names);
 extern int halide_error_failed_to_upgrade_buffer_t(void *user_context,
                                                    const char *input_name,
                                                    const char *reason);
@@ -1285,7 +1719,31 @@ typedef enum halide_target_feature_t {
     halide_target_feature_embed_bitcode = 57,  ///< Emulate clang -fembed-bitcode flag.
     halide_target_feature_disable_llvm_loop_vectorize = 58,  ///< Disable loop vectorization in LLVM. (Ignored for non-LLVM targets.)
     halide_target_feature_disable_llvm_loop_unroll = 59,  ///< Disable loop unrolling in LLVM. (Ignored for non-LLVM targets.)
-    halide_target_feature_end = 60 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_cuda_capability70 = 60,  ///< Enable CUDA compute capability 7.0 (Volta)
+    halide_target_feature_avx512_cascadelake = 61,  ///< Enable the AVX512 features supported by Cascade Lake processors. This includes all of the Skylake features, plus AVX512-VNNI.
+    halide_target_feature_sve = 62,  ///< Enable the ARM Scalable Vector Extension. Only relevant for 64-bit ARM.
+    halide_target_feature_arm_dot_prod = 63,  ///< Enable the ARMv8.2 dot product instructions (sdot and udot). Only relevant for 64-bit ARM.
+    halide_target_feature_allocation_arena = 64,  ///< Serve the heap allocations of each pipeline invocation from one arena, freed when the pipeline exits.
+    halide_target_feature_profile_by_thread = 65,  ///< Used together with profile. Also track the current Func of each thread, and bill per-thread hardware performance counters (Linux perf_event) to it.
+    halide_target_feature_profile_roofline = 66,  ///< Used together with profile. Also count the arithmetic operations and memory traffic of each Func, and report them against the machine's measured peaks.
+    halide_target_feature_auto_specialize = 67,  ///< Specialize the stages that read them for likely parameter values: input strides of one, and the specialization hints of Params.
+    halide_target_feature_auto_prefetch = 68,  ///< Prefetch the input rows read by the stages that stream through them, at a distance set by the memory latency in MachineParams.
+    halide_target_feature_multiversion_loops = 69,  ///< For compile_multitarget: compile one copy of the pipeline for the baseline target, and dispatch on the other targets only around the loop nests that contain vector code.
+    halide_target_feature_batch_dimension = 70,  ///< Give every input and output buffer an extra outermost dimension, and run the pipeline on each image along it, in parallel.
+    halide_target_feature_cuda_fatbin = 71,  ///< Assemble CUDA kernels ahead of time with ptxas, and embed a fatbin holding the SASS for the target's cuda capability and the PTX as a fallback, instead of just the PTX.
+    halide_target_feature_metallib = 72,  ///< Compile Metal kernels ahead of time with the Metal toolchain, and embed a metallib instead of the source.
+    halide_target_feature_opencl_spirv = 73,  ///< Compile OpenCL kernels ahead of time to SPIR-V with clang and llvm-spirv, and embed that instead of the source. Requires OpenCL 2.1 or cl_khr_il_program on the device.
+    halide_target_feature_fast_compile = 74,  ///< Trade the quality of the code LLVM generates for compile speed, with a lighter optimization pipeline and fast instruction selection. Halide's own vectorization is unaffected.
+    halide_target_feature_lazy_specializations = 75,  ///< When jitting, only compile the specializations that the current parameter values select, on the first realization that takes them, and keep one version per combination of specializations.
+    halide_target_feature_arm_fp16 = 76,  ///< Enable the ARMv8.2 half-precision arithmetic instructions, so that float16 math isn't done in float32. Only relevant for 64-bit ARM.
+    halide_target_feature_vulkan = 77,  ///< Enable the Vulkan compute runtime. Kernels are compiled to SPIR-V with glslangValidator.
+    halide_target_feature_wasm_simd128 = 78,  ///< Enable the WebAssembly SIMD128 instructions.
+    halide_target_feature_wasm_threads = 79,  ///< Use Emscripten pthreads over a SharedArrayBuffer for parallel loops in WebAssembly.
+    halide_target_feature_scratch_arena = 80,  ///< Serve the heap allocations inside parallel loops from per-thread arenas, reset at the end of each iteration.
+    halide_target_feature_profile_branches = 81,  ///< Used together with profile. Also count how often each branch of each if statement on the host is taken, and write the counts to the profile named by HL_PROFILE_OUTPUT.
+    halide_target_feature_memoize_shared = 82,  ///< On Linux, keep the memoization cache in a shared memory segment named by HL_MEMOIZATION_SEGMENT, so that every process on the host shares the results.
+    halide_target_feature_cache_shape_checks = 83,  ///< Remember the shapes of the buffers and the parameter values that last passed a pipeline's checks on its inputs and outputs, and skip the checks when a call matches them.
+    halide_target_feature_end = 84 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
@@ -1659,6 +2117,27 @@ struct halide_profiler_func_stats {
     /** Total time taken evaluating this Func (in nanoseconds). */
     uint64_t time;
 
+    /** Total cycles a remote processor (e.g. a Hexagon DSP) spent
+     * evaluating this Func. Zero if it never ran remotely, or if the
+     * remote side can't report cycle counts. */
+    uint64_t remote_cycles;
+
+    /** Of those, the cycles remote threads spent waiting for a
+     * resource shared between them (e.g. an HVX context). */
+    uint64_t remote_lock_wait_cycles;
+
+    /** Hardware performance counter totals for this Func, summed
+     * over all threads that ran it. Only gathered by pipelines
+     * compiled with profile_by_thread, and only where the OS exposes
+     * the counters (Linux perf_event). Indexed by
+     * halide_profiler_counter_t. */
+    uint64_t counters[4];
+
+    /** The number of arithmetic operations (counting each vector
+     * lane) and the number of bytes loaded or stored by this Func,
+     * counted by pipelines compiled with profile_roofline. */
+    uint64_t ops, bytes;
+
     /** The current memory allocation of this Func. */
     uint64_t memory_current;
 
@@ -1681,6 +2160,25 @@ struct halide_profiler_func_stats {
     int num_allocs;
 };
 
+/** A heap allocation made by a pipeline, recorded during its first
+ * run when the HL_PROFILER_MEMORY_LIFETIMES environment variable is
+ * set, to find allocations that could share storage or live on the
+ * stack. */
+struct halide_profiler_allocation {
+    /** The size of the allocation in bytes. */
+    uint64_t size;
+
+    /** When the allocation was made and freed, in nanoseconds since
+     * the run started. end is zero if it was never freed. */
+    uint64_t start, end;
+
+    /** The thread that made the allocation. */
+    uint64_t thread_id;
+
+    /** The Func the allocation belongs to. */
+    int func_id;
+};
+
 /** Per-pipeline state tracked by the sampling profiler. These exist
  * in a linked list. */
 struct halide_profiler_pipeline_stats {
@@ -1706,6 +2204,24 @@ struct halide_profiler_pipeline_stats {
     /** An array containing states for each Func in this pipeline. */
     struct halide_profiler_func_stats *funcs;
 
+    /** The heap allocations made during the first run, if
+     * HL_PROFILER_MEMORY_LIFETIMES was set when this pipeline was
+     * first run, or NULL. */
+    struct halide_profiler_allocation *allocations;
+
+    /** How often each branch counted by pipelines compiled with
+     * profile_branches went each way. Entry 2*i is the number of
+     * times branch i was taken, and entry 2*i + 1 the number of times
+     * it wasn't. NULL if no branches are counted. */
+    uint64_t *branch_counts;
+
+    /** The name of each counted branch: the Func it is in, its index
+     * within that Func, and its condition. Global constant strings. */
+    const char **branch_names;
+
+    /** When the first run started, in nanoseconds. */
+    uint64_t first_run_start;
+
     /** The next pipeline_stats pointer. It's a void * because types
      * in the Halide runtime may not currently be recursive. */
     void *next;
@@ -1724,6 +2240,45 @@ struct halide_profiler_pipeline_stats {
 
     /** The total number of memory allocation of funcs in this pipeline. */
     int num_allocs;
+
+    /** The number of entries of allocations used, and the number of
+     * allocations that didn't fit. */
+    int num_allocations, dropped_allocations;
+
+    /** The number of branches counted. */
+    int num_branches;
+};
+
+/** The hardware performance counters read per thread by pipelines
+ * compiled with profile_by_thread. */
+typedef enum halide_profiler_counter_t {
+    halide_profiler_counter_cycles = 0,
+    halide_profiler_counter_instructions = 1,
+    halide_profiler_counter_llc_misses = 2,
+    halide_profiler_counter_stall_cycles = 3,
+    halide_profiler_num_counters = 4
+} halide_profiler_counter_t;
+
+/** Per-thread state tracked by the sampling profiler for pipelines
+ * compiled with profile_by_thread. */
+struct halide_profiler_thread_state {
+    /** An identifier for the OS thread. */
+    uint64_t thread_id;
+
+    /** The counter values at the last sample. */
+    uint64_t last_counts[4];
+
+    /** Handles to the counters of this thread, or -1 for counters
+     * that couldn't be opened. */
+    int counter_handles[4];
+
+    /** The id of the Func this thread is running. Set by the
+     * pipeline, read periodically by the profiler thread. */
+    int current_func;
+
+    /** The next thread_state pointer. It's a void * because types in
+     * the Halide runtime may not currently be recursive. */
+    void *next;
 };
 
 /** The global state of the profiler. */
@@ -1756,8 +2311,30 @@ struct halide_profiler_state {
      * e.g. on a DSP. If null, it reads from the int above instead. */
     void (*get_remote_profiler_state)(int *func, int *active_workers);
 
+    /** Retrieve a cycle counter of the remote processor, so that
+     * cycles can be billed to remote Funcs alongside time. If null,
+     * no cycles are billed. */
+    void (*get_remote_profiler_cycles)(uint64_t *cycles);
+
+    /** Retrieve the total cycles remote threads have spent waiting
+     * for shared resources, billed like the cycle counter above. If
+     * null, no lock wait is billed. */
+    void (*get_remote_profiler_lock_wait)(uint64_t *cycles);
+
     /** Sampling thread reference to be joined at shutdown. */
     struct halide_thread *sampling_thread;
+
+    /** A linked list of the threads that have run pipelines compiled
+     * with profile_by_thread. Threads are added to the front and
+     * never removed while the profiler is running. */
+    struct halide_profiler_thread_state *threads;
+
+    /** The peak rate of arithmetic operations (in billions per
+     * second) and of memory traffic (in GB/s) of this machine, using
+     * all threads of the thread pool. Measured the first time a
+     * pipeline compiled with profile_roofline runs, and zero until
+     * then. */
+    double peak_gops, peak_gbytes;
 };
 
 /** Profiler func ids with special meanings. */
@@ -1778,6 +2355,12 @@ extern struct halide_profiler_state *halide_profiler_get_state();
  * This function grabs the global profiler state's lock on entry. */
 extern struct halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state(const char *pipeline_name);
 
+/** Measure the peak arithmetic rate and memory bandwidth of the
+ * machine for the roofline report, if that hasn't been done
+ * already. Called at the start of pipelines compiled with
+ * profile_roofline. */
+extern int halide_profiler_measure_roofline(void *user_context);
+
 /** Reset profiler state cheaply. May leave threads running or some
  * memory allocated but all accumluated statistics are reset.
  * WARNING: Do NOT call this method while any halide pipeline is
@@ -1794,9 +2377,20 @@ extern void halide_profiler_reset();
 void halide_profiler_shutdown();
 
 /** Print out timing statistics for everything run since the last
- * reset. Also happens at process exit. */
+ * reset. Also happens at process exit. If the HL_PROFILE_OUTPUT
+ * environment variable is set, the profile is also written to the
+ * file it names, as with halide_profiler_write_profile. */
 extern void halide_profiler_report(void *user_context);
 
+/** Write the time spent in each pipeline and Func, and the branch
+ * counts of pipelines compiled with profile_branches, to a file, for
+ * use in later compiles (see HL_PROFILE_INPUT). One record per line:
+ *   pipeline <name> <runs> <time in ns>
+ *   func <pipeline> <name> <time in ns>
+ *   branch <pipeline> <taken> <not taken> <func>.<index> <condition>
+ * Returns zero on success. */
+extern int halide_profiler_write_profile(void *user_context, const char *filename);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
@@ -59,6 +59,90 @@ extern int halide_cuda_detach_device_ptr(void *user_context, struct halide_buffe
  */
 extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buffer_t *buf);
 
+/** Make the default halide_cuda_get_stream give each thread its own
+ * stream (CU_STREAM_PER_THREAD) instead of the legacy default stream,
+ * so that kernels and copies issued by independent threads, such as
+ * async producers and their consumers, can overlap. Host-to-device
+ * copies on these streams are staged through pinned memory and run
+ * asynchronously. Off by default, unless the environment variable
+ * HL_CUDA_STREAM_PER_THREAD is set to 1. Must be set before any
+ * pipeline uses the GPU. */
+extern void halide_cuda_set_stream_per_thread(bool per_thread);
+
+/** Wait for the work the calling thread has queued on its CUDA stream
+ * to complete. Halide calls this before handing the results of kernels
+ * to another thread. A no-op when using the legacy default stream. */
+extern int halide_cuda_stream_fence(void *user_context);
+
+/** Make pipelines batch their kernel launches into CUDA graphs. While
+ * a pipeline that uses CUDA runs, its kernel launches are queued, and
+ * issued together as one graph when something depends on them: a
+ * copy, a free, a device sync, or the end of the pipeline. Graphs are
+ * cached by the sequence of kernels and launch shapes (which usually
+ * follow from the buffer shapes), and replayed with updated arguments
+ * when the pipeline runs again, which removes most of the per-kernel
+ * launch overhead. Requires a CUDA 10 driver (10.1 to replay graphs
+ * with different arguments). Off by default, unless the environment
+ * variable HL_CUDA_LAUNCH_GRAPHS is set to 1. */
+extern void halide_cuda_set_launch_graphs(bool use_graphs);
+
+/** Called by pipelines that use CUDA around their body, when launch
+ * graphs are enabled. halide_cuda_launch_graph_end is registered as a
+ * destructor, so it runs however the pipeline exits. */
+// @{
+extern int halide_cuda_launch_graph_begin(void *user_context);
+extern int halide_cuda_launch_graph_flush(void *user_context);
+extern void halide_cuda_launch_graph_end(void *user_context, void *obj);
+// @}
+
+/** Make halide_cuda_device_and_host_malloc (and so
+ * Buffer<>::device_and_host_malloc) map its page-locked host
+ * allocations into the device address space, so that kernels read and
+ * write host memory directly and no copies are made. Otherwise the
+ * host allocation is page-locked and paired with a separate device
+ * allocation, which makes the copies between them faster. Off by
+ * default, unless the environment variable HL_CUDA_MAPPED_HOST_MEMORY
+ * is set to 1. */
+extern void halide_cuda_set_mapped_host_memory(bool mapped);
+
+/** Limit the number of devices that loops scheduled with
+ * gpu_multi_device are distributed across. The first chunk of the
+ * loop runs in the main context (see halide_cuda_acquire_context), and
+ * the others on the other devices in order, each in a context of its
+ * own. Zero, the default, means all of the devices, unless the
+ * environment variable HL_CUDA_MULTI_DEVICE_COUNT is set. */
+extern void halide_cuda_set_multi_device_count(int count);
+
+/** Called by pipelines around loops scheduled with
+ * gpu_multi_device. halide_cuda_multi_device_begin makes the context
+ * of the index'th device current on the calling thread, so that the
+ * kernels and allocations of a chunk of the loop go to that device,
+ * until the matching halide_cuda_multi_device_end.
+ * halide_cuda_multi_device_sync waits for the work on all the devices
+ * other than the main context's. */
+// @{
+extern int halide_cuda_multi_device_count(void *user_context);
+extern int halide_cuda_multi_device_begin(void *user_context, int index);
+extern int halide_cuda_multi_device_end(void *user_context, int index);
+extern int halide_cuda_multi_device_sync(void *user_context);
+// @}
+
+/** Return the allocations cached for reuse by the CUDA backend in the
+ * context acquired for user_context to the driver. See
+ * halide_reuse_device_allocations. */
+extern int halide_cuda_release_unused_device_allocations(void *user_context);
+
+/** Return a CUDA texture object that views a buffer in device memory,
+ * with normalized coordinates and clamped addressing, and linear or
+ * point filtering. Copies the buffer to the device if necessary. Made
+ * for and called by pipelines that read an ImageParam scheduled with
+ * gpu_texture. Returns zero if the buffer can't be viewed as a
+ * texture: it must be a two-dimensional float buffer with dense rows,
+ * aligned in device memory as textures require. The texture objects
+ * are cached, and destroyed when the memory they view is returned to
+ * the driver. */
+extern uint64_t halide_cuda_buffer_texture(void *user_context, struct halide_buffer_t *buf, bool linear_filter);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -50,7 +50,10 @@ extern uint64_t halide_hexagon_get_device_size(void *user_context, struct halide
  * small but possibly significant amount of time for short running
  * pipelines. To avoid this cost, HVX can be powered on prior to
  * running several pipelines, and powered off afterwards. If HVX is
- * powered on, subsequent calls to power HVX on will be cheap. */
+ * powered on, subsequent calls to power HVX on will be cheap. While
+ * HVX is powered on this way, the HVX context locked by the DSP for
+ * one pipeline is also kept for the next one, and only released when
+ * HVX is powered off. */
 // @{
 extern int halide_hexagon_power_hvx_on(void *user_context);
 extern int halide_hexagon_power_hvx_off(void *user_context);
@@ -113,6 +116,29 @@ extern int halide_hexagon_set_performance_mode(void *user_context, halide_hexago
 extern int halide_hexagon_set_performance(void *user_context, halide_hexagon_power_t *perf);
 // @}
 
+/** Vote for a performance level for Hexagon automatically, so that
+ * each pipeline offloaded to it takes about target_latency_us
+ * microseconds. After each offload, the vote is raised if the offload
+ * came close to the target, and lowered after a run of offloads that
+ * finished well within it. Pass 0 to stop voting and go back to the
+ * default performance level. Calling
+ * halide_hexagon_set_performance_mode or
+ * halide_hexagon_set_performance also stops automatic voting. */
+extern int halide_hexagon_set_performance_target(void *user_context, uint64_t target_latency_us);
+
+/** How many worker threads the DSP runs parallel loops on. */
+typedef enum halide_hexagon_thread_policy_t {
+    /** One thread per hardware thread of the DSP (the default). */
+    halide_hexagon_thread_policy_per_core = 0,
+    /** One thread per HVX context, so that threads of parallel loops
+     * using HVX don't wait for each other to release a context. */
+    halide_hexagon_thread_policy_per_hvx_context = 1,
+} halide_hexagon_thread_policy_t;
+
+/** Set the thread policy used by the DSP side of pipelines loaded
+ * after this call. */
+extern int halide_hexagon_set_thread_policy(void *user_context, halide_hexagon_thread_policy_t policy);
+
 /** These are forward declared here to allow clients to override the
  *  Halide Hexagon runtime. Do not call them. */
 // @{
@@ -91,6 +91,26 @@ extern int halide_metal_acquire_context(void *user_context, struct halide_metal_
  */
 extern int halide_metal_release_context(void *user_context);
 
+/** Kernel dispatches and device to device copies are encoded into one
+ * command buffer, which is committed when a device sync or host access
+ * needs its results. Pipelines that use Metal register this as a
+ * destructor, so the command buffer is also committed (without waiting
+ * for it) when the pipeline exits. The second argument is unused. */
+extern void halide_metal_commit_command_buffer(void *user_context, void *obj);
+
+/** Make halide_metal_device_malloc suballocate buffers of up to 4MB from
+ * 16MB MTLHeaps, instead of making a new MTLBuffer for each of them.
+ * Requires a device and OS that support shared heaps with hazard
+ * tracking; otherwise buffers are allocated on their own. Off by
+ * default, unless the environment variable HL_METAL_HEAP_ALLOCATION is
+ * set to 1. */
+extern void halide_metal_set_heap_allocation(bool use_heaps);
+
+/** Return the allocations cached for reuse by the Metal backend in the
+ * context acquired for user_context to the driver. See
+ * halide_reuse_device_allocations. */
+extern int halide_metal_release_unused_device_allocations(void *user_context);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
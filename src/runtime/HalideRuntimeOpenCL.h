@@ -63,6 +63,30 @@ extern void halide_opencl_set_device_type(const char *n);
  * halide_set_ocl_device_type. */
 extern const char *halide_opencl_get_device_type(void *user_context);
 
+/** Set the directory in which to cache built OpenCL program binaries,
+ * so that later processes can skip compiling the program source. The
+ * argument is copied internally. Binaries are keyed by the device,
+ * driver version, build options and program source. Pass NULL or an
+ * empty string to disable caching. If never called, Halide uses the
+ * environment variable HL_OCL_PROGRAM_CACHE_DIR, and caches nothing if
+ * that is unset. */
+extern void halide_opencl_set_program_cache_dir(const char *dir);
+
+/** Halide calls this to get the directory in which to cache built
+ * program binaries. Implement this yourself to use a different cache
+ * per user_context. The default implementation returns the value set
+ * by halide_opencl_set_program_cache_dir, or the environment variable
+ * HL_OCL_PROGRAM_CACHE_DIR. */
+extern const char *halide_opencl_get_program_cache_dir(void *user_context);
+
+/** Make the default context use an out-of-order command queue, if the
+ * device supports one. Commands that use the same buffer are still
+ * ordered by events, while independent kernels and transfers may
+ * overlap. Must be called before the context is created. If never
+ * called, Halide uses an out-of-order queue if the environment
+ * variable HL_OCL_OUT_OF_ORDER_QUEUE is set to 1. */
+extern void halide_opencl_set_out_of_order_queue(bool out_of_order);
+
 /** Set the underlying cl_mem for a halide_buffer_t. This memory should be
  * allocated using clCreateBuffer or similar and must have an extent
  * large enough to cover that specified by the halide_buffer_t extent
@@ -91,6 +115,11 @@ extern uintptr_t halide_opencl_get_cl_mem(void *user_context, struct halide_buff
 /** Returns the offset associated with the OpenCL memory allocation via device_crop or device_slice. */
 extern uint64_t halide_opencl_get_crop_offset(void *user_context, halide_buffer_t *buf);
 
+/** Return the allocations cached for reuse by the OpenCL backend in the
+ * context acquired for user_context to the driver. See
+ * halide_reuse_device_allocations. */
+extern int halide_opencl_release_unused_device_allocations(void *user_context);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -70,6 +70,16 @@ extern int halide_opengl_detach_texture(void *user_context, struct halide_buffer
  */
 extern uintptr_t halide_opengl_get_texture(void *user_context, struct halide_buffer_t *buf);
 
+/** Start reading the texture of a buffer back to the host without
+ * waiting for it, so that work submitted afterwards (e.g. the next
+ * frame) overlaps the transfer. The next halide_copy_to_host of the
+ * buffer waits for this read to finish instead of reading the texture
+ * synchronously. Writing to the texture in between cancels the
+ * read. Does nothing if the buffer is not dirty on the device, is a
+ * render target, or the context doesn't support pixel buffer objects
+ * and fence sync objects (OpenGL 3.2 or OpenGL ES 3.0). */
+extern int halide_opengl_begin_copy_to_host(void *user_context, struct halide_buffer_t *buf);
+
 /** Forget all state associated with the previous OpenGL context.  This is
  * similar to halide_opengl_release, except that we assume that all OpenGL
  * resources have already been reclaimed by the OS. */
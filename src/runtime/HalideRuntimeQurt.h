@@ -20,6 +20,25 @@ extern int halide_qurt_hvx_unlock(void *user_context);
 extern void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*/);
 // @}
 
+/** The destructor registered for the HVX context locked around a
+ * whole pipeline. Unlocks the context, unless
+ * halide_qurt_hvx_set_keep_locked has been called, in which case the
+ * calling thread keeps it for the next pipeline it runs. */
+extern void halide_qurt_hvx_unlock_or_keep_as_destructor(void *user_context, void * /*obj*/);
+
+/** Set whether threads keep the HVX context locked for a pipeline
+ * after the pipeline returns. Consecutive pipelines run on the same
+ * thread then lock it only once, which matters for small
+ * pipelines. Whoever turns this on is responsible for calling
+ * qurt_hvx_unlock on that thread when it is done running
+ * pipelines. The HVX contexts locked by parallel tasks are always
+ * released at the end of each task. Off by default. */
+extern void halide_qurt_hvx_set_keep_locked(int keep);
+
+/** The total number of processor cycles threads have spent waiting
+ * to lock an HVX context. */
+extern uint64_t halide_qurt_hvx_lock_wait_cycles();
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -0,0 +1,35 @@
+#include "HalideRuntime.h"
+#include "cpu_features.h"
+
+#define AT_HWCAP    16
+
+#define HWCAP_FPHP      (1 << 9)
+#define HWCAP_ASIMDHP   (1 << 10)
+#define HWCAP_ASIMDDP   (1 << 20)
+#define HWCAP_SVE       (1 << 22)
+
+extern "C" unsigned long int getauxval(unsigned long int);
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK CpuFeatures halide_get_cpu_features() {
+    CpuFeatures features;
+    features.set_known(halide_target_feature_arm_fp16);
+    features.set_known(halide_target_feature_arm_dot_prod);
+    features.set_known(halide_target_feature_sve);
+
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+
+    if ((hwcap & HWCAP_FPHP) && (hwcap & HWCAP_ASIMDHP)) {
+        features.set_available(halide_target_feature_arm_fp16);
+    }
+    if (hwcap & HWCAP_ASIMDDP) {
+        features.set_available(halide_target_feature_arm_dot_prod);
+    }
+    if (hwcap & HWCAP_SVE) {
+        features.set_available(halide_target_feature_sve);
+    }
+    return features;
+}
+
+}}} // namespace Halide::Runtime::Internal
@@ -0,0 +1,89 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Allocations are carved out of chunks obtained from halide_malloc,
+// one after another. Chunks are only freed when the arena is.
+struct arena_chunk {
+    arena_chunk *next;
+    uint8_t *cursor, *end;
+};
+
+struct allocation_arena {
+    arena_chunk *chunks;
+    size_t last_chunk_size;
+};
+
+// The smallest chunk we'll ask halide_malloc for. Later chunks
+// double in size.
+#define ARENA_MIN_CHUNK_SIZE (1 << 20)
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+// Called once at the start of a pipeline compiled with the
+// allocation_arena feature.
+WEAK __attribute__((used)) void *halide_arena_create(void *user_context) {
+    allocation_arena *arena = (allocation_arena *)halide_malloc(user_context, sizeof(allocation_arena));
+    if (arena) {
+        arena->chunks = NULL;
+        arena->last_chunk_size = 0;
+    }
+    return arena;
+}
+
+// Serves a heap allocation of the pipeline from the arena.
+WEAK __attribute__((used)) void *halide_arena_malloc(void *user_context, void *ptr, uint64_t size) {
+    allocation_arena *arena = (allocation_arena *)ptr;
+    const uintptr_t alignment = halide_malloc_alignment();
+    arena_chunk *chunk = arena->chunks;
+    if (chunk) {
+        uint8_t *start = (uint8_t *)(((uintptr_t)chunk->cursor + alignment - 1) & ~(alignment - 1));
+        if (start + size <= chunk->end) {
+            chunk->cursor = start + size;
+            return start;
+        }
+    }
+
+    // Start a new chunk. Whatever was left in the last one is wasted.
+    size_t chunk_size = arena->last_chunk_size ? arena->last_chunk_size * 2 : ARENA_MIN_CHUNK_SIZE;
+    const size_t needed = sizeof(arena_chunk) + alignment + size;
+    if (chunk_size < needed) {
+        chunk_size = needed;
+    }
+    chunk = (arena_chunk *)halide_malloc(user_context, chunk_size);
+    if (!chunk) {
+        return NULL;
+    }
+    arena->last_chunk_size = chunk_size;
+    chunk->next = arena->chunks;
+    chunk->end = (uint8_t *)chunk + chunk_size;
+    arena->chunks = chunk;
+
+    uint8_t *start = (uint8_t *)(((uintptr_t)(chunk + 1) + alignment - 1) & ~(alignment - 1));
+    chunk->cursor = start + size;
+    return start;
+}
+
+// The free function of allocations served from the arena. Their
+// memory is reclaimed all at once by halide_arena_destroy.
+WEAK __attribute__((used)) void halide_arena_free(void *user_context, void *ptr) {
+}
+
+// Called at pipeline exit (or on error) to release everything.
+WEAK __attribute__((used)) void halide_arena_destroy(void *user_context, void *ptr) {
+    allocation_arena *arena = (allocation_arena *)ptr;
+    arena_chunk *chunk = arena->chunks;
+    while (chunk) {
+        arena_chunk *next = chunk->next;
+        halide_free(user_context, chunk);
+        chunk = next;
+    }
+    halide_free(user_context, arena);
+}
+
+}
@@ -3,10 +3,45 @@
 extern "C" {
 
 extern long sysconf(int);
+extern void *pthread_self();
+extern int madvise(void *addr, size_t length, int advice);
 
 WEAK int halide_host_cpu_count() {
     // Works for Android ARMv7. Probably bogus on other platforms.
     return sysconf(97);
 }
 
+// No NUMA support. Treat the machine as a single node.
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_host_current_numa_node() {
+    return 0;
+}
+
+WEAK int halide_host_pin_thread_to_numa_node(int node) {
+    return 0;
+}
+
+WEAK int halide_host_advise_huge_pages(void *ptr, size_t size) {
+    return madvise(ptr, size, 14 /* MADV_HUGEPAGE */);
+}
+
+WEAK uint64_t halide_host_current_thread_id() {
+    return (uint64_t)pthread_self();
+}
+
+// No hardware performance counters.
+WEAK int halide_host_open_perf_counter(int counter) {
+    return -1;
+}
+
+WEAK int halide_host_read_perf_counter(int handle, uint64_t *value) {
+    return -1;
+}
+
+WEAK void halide_host_close_perf_counter(int handle) {
+}
+
 }
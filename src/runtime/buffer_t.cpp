@@ -170,6 +170,59 @@ halide_buffer_t *_halide_buffer_crop(void *user_context,
     return dst;
 }
 
+// Make dst the image at position pos along the outermost dimension of
+// src, with one fewer dimension. dst_shape must have room for all the
+// dimensions of src. Retire it like a crop when done with it. Used by
+// pipelines compiled with the batch_dimension feature.
+HALIDE_BUFFER_HELPER_ATTRS
+halide_buffer_t *_halide_buffer_slice(void *user_context,
+                                      halide_buffer_t *dst,
+                                      halide_dimension_t *dst_shape,
+                                      const halide_buffer_t *src,
+                                      int pos) {
+    const int d = src->dimensions - 1;
+    *dst = *src;
+    dst->dim = dst_shape;
+    for (int i = 0; i <= d; i++) {
+        dst->dim[i] = src->dim[i];
+    }
+    dst->dim[d].min = pos;
+    dst->dim[d].extent = 1;
+    if (dst->host) {
+        dst->host += (int64_t)(pos - src->dim[d].min) * src->dim[d].stride * src->type.bytes();
+    }
+    dst->device_interface = 0;
+    dst->device = 0;
+    if (src->device_interface) {
+        src->device_interface->device_crop(user_context, src, dst);
+    }
+    dst->dimensions = d;
+    return dst;
+}
+
+// Called after a bounds query on a slice of src made by
+// _halide_buffer_slice. If src is a bounds query too, give it the
+// shape asked of the slice, with the given bounds in the outermost
+// dimension.
+HALIDE_BUFFER_HELPER_ATTRS
+int _halide_buffer_unslice_bounds_query(halide_buffer_t *src,
+                                        const halide_buffer_t *slice,
+                                        int min, int extent) {
+    if (src->host || src->device) {
+        return 0;
+    }
+    const int d = slice->dimensions;
+    int stride = 1;
+    for (int i = 0; i < d; i++) {
+        src->dim[i] = slice->dim[i];
+        stride = slice->dim[i].stride * slice->dim[i].extent;
+    }
+    src->dim[d].min = min;
+    src->dim[d].extent = extent;
+    src->dim[d].stride = stride;
+    return 0;
+}
+
 
 // Called on return from an extern stage where the output buffer was a
 // crop of some other larger buffer. This happens for extern stages
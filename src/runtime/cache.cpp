@@ -65,6 +65,109 @@ WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t
     return true;
 }
 
+// Per-Func statistics and budgets. Funcs are identified by name. The
+// records live in a fixed array that is only appended to, so lookups
+// can scan it without a lock.
+struct CacheFuncStats {
+    // The identifying string from the most recent cache key seen for
+    // this Func, to skip the name comparison on the common path.
+    const char *key_id;
+    char *name;
+    size_t name_len;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t compute_time_ns;
+    int64_t bytes;
+    int64_t max_bytes;
+};
+
+#define MAX_CACHE_FUNCS 256
+
+WEAK CacheFuncStats cache_func_stats[MAX_CACHE_FUNCS];
+WEAK int num_cache_funcs = 0;
+WEAK halide_mutex cache_func_stats_lock = { { 0 } };
+
+WEAK CacheFuncStats *find_func_stats(const char *name, size_t name_len, bool create) {
+    int n = __atomic_load_n(&num_cache_funcs, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        if (cache_func_stats[i].name_len == name_len &&
+            strncmp(cache_func_stats[i].name, name, name_len) == 0) {
+            return &cache_func_stats[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    ScopedMutexLock lock(&cache_func_stats_lock);
+    // Someone else may have added it in the meantime.
+    for (int i = n; i < num_cache_funcs; i++) {
+        if (cache_func_stats[i].name_len == name_len &&
+            strncmp(cache_func_stats[i].name, name, name_len) == 0) {
+            return &cache_func_stats[i];
+        }
+    }
+    if (num_cache_funcs == MAX_CACHE_FUNCS) {
+        return NULL;
+    }
+    char *name_copy = (char *)halide_malloc(NULL, name_len + 1);
+    if (name_copy == NULL) {
+        return NULL;
+    }
+    memcpy(name_copy, name, name_len);
+    name_copy[name_len] = 0;
+    CacheFuncStats *stats = &cache_func_stats[num_cache_funcs];
+    memset(stats, 0, sizeof(CacheFuncStats));
+    stats->name = name_copy;
+    stats->name_len = name_len;
+    __atomic_store_n(&num_cache_funcs, num_cache_funcs + 1, __ATOMIC_RELEASE);
+    return stats;
+}
+
+// Generated code starts every cache key with a pointer to a string of
+// the form "<n>:<pipeline name><m>:<func name>". Find the stats for
+// the Func the key belongs to.
+WEAK CacheFuncStats *func_stats_for_key(const uint8_t *cache_key, int32_t size) {
+    if (size < (int32_t)sizeof(const char *)) {
+        return NULL;
+    }
+    const char *id;
+    memcpy(&id, cache_key, sizeof(const char *));
+    if (id == NULL) {
+        return NULL;
+    }
+
+    int n = __atomic_load_n(&num_cache_funcs, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        if (__atomic_load_n(&cache_func_stats[i].key_id, __ATOMIC_RELAXED) == id) {
+            return &cache_func_stats[i];
+        }
+    }
+
+    // Skip over the pipeline name, then read the func name.
+    const char *p = id;
+    size_t len = 0;
+    for (int part = 0; part < 2; part++) {
+        len = 0;
+        while (*p >= '0' && *p <= '9') {
+            len = len * 10 + (*p++ - '0');
+        }
+        if (*p++ != ':') {
+            return NULL;
+        }
+        if (part == 0) {
+            p += len;
+        }
+    }
+
+    CacheFuncStats *stats = find_func_stats(p, len, true);
+    if (stats) {
+        __atomic_store_n(&stats->key_id, id, __ATOMIC_RELAXED);
+    }
+    return stats;
+}
+
 struct CacheEntry {
     CacheEntry *next;
     CacheEntry *more_recent;
@@ -72,7 +175,7 @@ struct CacheEntry {
     uint8_t *metadata_storage;
     size_t key_size;
     uint8_t *key;
-    uint32_t hash;
+    uint64_t hash;
     uint32_t in_use_count; // 0 if none returned from halide_cache_lookup
     uint32_t tuple_count;
     // The shape of the computed data. There may be more data allocated than this.
@@ -80,9 +183,13 @@ struct CacheEntry {
     halide_dimension_t *computed_bounds;
     // The actual stored data.
     halide_buffer_t *buf;
+    // The Func this is a result of, and what it cost to produce.
+    CacheFuncStats *func;
+    uint64_t bytes;
+    uint64_t cost_ns;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
-              uint32_t key_hash,
+              uint64_t key_hash,
               const halide_buffer_t *computed_bounds_buf,
               int32_t tuples, halide_buffer_t **tuple_buffers);
     void destroy();
@@ -92,7 +199,10 @@ struct CacheEntry {
 
 struct CacheBlockHeader {
     CacheEntry *entry;
-    uint32_t hash;
+    uint64_t hash;
+    // When the lookup missed, so the store can tell how long the
+    // producer took.
+    int64_t miss_time_ns;
 };
 
 // Each host block has extra space to store a header just before the
@@ -111,7 +221,7 @@ WEAK CacheBlockHeader *get_pointer_to_header(uint8_t * host) {
 }
 
 WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
-                           uint32_t key_hash, const halide_buffer_t *computed_bounds_buf,
+                           uint64_t key_hash, const halide_buffer_t *computed_bounds_buf,
                            int32_t tuples, halide_buffer_t **tuple_buffers) {
     next = NULL;
     more_recent = NULL;
@@ -120,6 +230,9 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     hash = key_hash;
     in_use_count = 0;
     tuple_count = tuples;
+    func = NULL;
+    bytes = 0;
+    cost_ns = 0;
     dimensions = computed_bounds_buf->dimensions;
 
     // Allocate all the necessary space (or die)
@@ -169,7 +282,134 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     return true;
 }
 
+// The device allocations that belong to cache entries, and the entry
+// each belongs to. A memoized result computed on a device stays
+// there: the entry keeps the device allocation along with the host
+// one, and hits get both back, so that they need no copies. Pipelines
+// hand back device allocations with
+// halide_memoization_cache_release_device instead of freeing them,
+// which only frees the ones that aren't in this table. It is open
+// addressed, with deletion by backward shifting.
+struct OwnedDeviceAllocation {
+    uint64_t device;
+    CacheEntry *entry;
+};
+
+WEAK halide_mutex owned_devices_lock = { { 0 } };
+WEAK OwnedDeviceAllocation *owned_devices = NULL;
+WEAK size_t owned_devices_capacity = 0;
+WEAK size_t num_owned_devices = 0;
+
+WEAK __attribute((always_inline)) size_t owned_device_slot(uint64_t device, size_t capacity) {
+    return (size_t)((device * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+// Returns the index of the device allocation in the table, or the
+// capacity if it isn't there. Must be called with the table locked.
+WEAK size_t find_owned_device(uint64_t device) {
+    if (owned_devices_capacity == 0) {
+        return 0;
+    }
+    size_t mask = owned_devices_capacity - 1;
+    for (size_t i = owned_device_slot(device, owned_devices_capacity);
+         owned_devices[i].device != 0; i = (i + 1) & mask) {
+        if (owned_devices[i].device == device) {
+            return i;
+        }
+    }
+    return owned_devices_capacity;
+}
+
+// Must be called with the table locked.
+WEAK bool insert_owned_device(uint64_t device, CacheEntry *entry) {
+    if ((num_owned_devices + 1) * 2 > owned_devices_capacity) {
+        size_t new_capacity = owned_devices_capacity ? owned_devices_capacity * 2 : 64;
+        OwnedDeviceAllocation *new_table =
+            (OwnedDeviceAllocation *)halide_malloc(NULL, sizeof(OwnedDeviceAllocation) * new_capacity);
+        if (new_table == NULL) {
+            return false;
+        }
+        memset(new_table, 0, sizeof(OwnedDeviceAllocation) * new_capacity);
+        for (size_t i = 0; i < owned_devices_capacity; i++) {
+            if (owned_devices[i].device != 0) {
+                size_t j = owned_device_slot(owned_devices[i].device, new_capacity);
+                while (new_table[j].device != 0) {
+                    j = (j + 1) & (new_capacity - 1);
+                }
+                new_table[j] = owned_devices[i];
+            }
+        }
+        if (owned_devices) {
+            halide_free(NULL, owned_devices);
+        }
+        owned_devices = new_table;
+        owned_devices_capacity = new_capacity;
+    }
+    size_t mask = owned_devices_capacity - 1;
+    size_t i = owned_device_slot(device, owned_devices_capacity);
+    while (owned_devices[i].device != 0) {
+        i = (i + 1) & mask;
+    }
+    owned_devices[i].device = device;
+    owned_devices[i].entry = entry;
+    num_owned_devices++;
+    return true;
+}
+
+// Must be called with the table locked.
+WEAK void erase_owned_device(uint64_t device) {
+    size_t i = find_owned_device(device);
+    if (i == owned_devices_capacity) {
+        return;
+    }
+    size_t mask = owned_devices_capacity - 1;
+    owned_devices[i].device = 0;
+    num_owned_devices--;
+    // Move back any later entries of the run that could no longer be
+    // found past the hole.
+    for (size_t j = (i + 1) & mask; owned_devices[j].device != 0; j = (j + 1) & mask) {
+        size_t home = owned_device_slot(owned_devices[j].device, owned_devices_capacity);
+        bool reachable = (j > i) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!reachable) {
+            owned_devices[i] = owned_devices[j];
+            owned_devices[j].device = 0;
+            i = j;
+        }
+    }
+}
+
+// Record that the entry owns the device allocations of its
+// buffers. Either all of them are recorded or none are.
+WEAK bool own_device_allocations(CacheEntry *entry) {
+    ScopedMutexLock lock(&owned_devices_lock);
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        if (entry->buf[i].device != 0 && !insert_owned_device(entry->buf[i].device, entry)) {
+            for (uint32_t j = 0; j < i; j++) {
+                erase_owned_device(entry->buf[j].device);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK __attribute((always_inline)) uint32_t device_allocation_count(const CacheEntry *entry) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        count += entry->buf[i].device != 0;
+    }
+    return count;
+}
+
 WEAK void CacheEntry::destroy() {
+    {
+        ScopedMutexLock lock(&owned_devices_lock);
+        for (uint32_t i = 0; i < tuple_count; i++) {
+            if (buf[i].device != 0) {
+                erase_owned_device(buf[i].device);
+            }
+        }
+    }
     for (uint32_t i = 0; i < tuple_count; i++) {
         halide_device_free(NULL, &buf[i]);
         halide_free(NULL, get_pointer_to_header(buf[i].host));
@@ -177,42 +417,150 @@ WEAK void CacheEntry::destroy() {
     halide_free(NULL, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size)  {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+// A 64-bit hash that consumes the key eight bytes at a time, with a
+// murmur3-style finalizer. Cache keys are usually a few dozen bytes, so
+// this is several times faster than a byte-at-a-time hash.
+WEAK uint64_t hash_key(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (key_size * m);
+    size_t i = 0;
+    for (; i + 8 <= key_size; i += 8) {
+        uint64_t w;
+        memcpy(&w, key + i, 8);
+        w *= m;
+        w ^= w >> 47;
+        w *= m;
+        h ^= w;
+        h *= m;
+    }
+    if (i < key_size) {
+        uint64_t w = 0;
+        memcpy(&w, key + i, key_size - i);
+        h ^= w;
+        h *= m;
     }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
     return h;
 }
 
-WEAK halide_mutex memoization_lock = { { 0 } };
-
-const size_t kHashTableSize = 256;
-
-WEAK CacheEntry *cache_entries[kHashTableSize];
+// The cache is split into shards selected by the top bits of the key
+// hash. Each shard has its own lock, hash table and LRU list, so
+// threads looking up different keys rarely contend. The byte budget
+// is shared by all shards.
+#define CACHE_SHARD_BITS 4
+const int kNumShards = 1 << CACHE_SHARD_BITS;
+const size_t kInitialBuckets = 16;
+
+struct CacheShard {
+    halide_mutex lock;
+    // A power-of-two sized table of chains, which doubles whenever the
+    // average chain length reaches two.
+    CacheEntry **buckets;
+    size_t num_buckets;
+    size_t num_entries;
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+    // Keep shards on separate cache lines.
+    char padding[64];
+};
 
-WEAK CacheEntry *most_recently_used = NULL;
-WEAK CacheEntry *least_recently_used = NULL;
+WEAK CacheShard cache_shards[kNumShards];
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
+// The total size of all shards. Updated atomically.
 WEAK int64_t current_cache_size = 0;
 
+WEAK __attribute((always_inline)) int shard_index(uint64_t h) {
+    return (int)(h >> (64 - CACHE_SHARD_BITS));
+}
+
+WEAK __attribute((always_inline)) CacheEntry **bucket(CacheShard *shard, uint64_t h) {
+    return &shard->buckets[h & (shard->num_buckets - 1)];
+}
+
+WEAK __attribute((always_inline)) bool cache_over_budget() {
+    return __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED) >
+        __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+}
+
+// Make sure the shard has room for one more entry, growing the table
+// if necessary. Returns false if the shard has no table and one can't
+// be allocated. Must be called with the shard locked.
+WEAK bool reserve_bucket(CacheShard *shard) {
+    if (shard->buckets != NULL && shard->num_entries < 2 * shard->num_buckets) {
+        return true;
+    }
+    size_t new_num_buckets = shard->buckets ? shard->num_buckets * 2 : kInitialBuckets;
+    CacheEntry **new_buckets = (CacheEntry **)halide_malloc(NULL, sizeof(CacheEntry *) * new_num_buckets);
+    if (new_buckets == NULL) {
+        // Carry on with longer chains if there is a table already.
+        return shard->buckets != NULL;
+    }
+    memset(new_buckets, 0, sizeof(CacheEntry *) * new_num_buckets);
+    for (size_t i = 0; i < shard->num_buckets; i++) {
+        CacheEntry *entry = shard->buckets[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            CacheEntry **b = &new_buckets[entry->hash & (new_num_buckets - 1)];
+            entry->next = *b;
+            *b = entry;
+            entry = next;
+        }
+    }
+    if (shard->buckets) {
+        halide_free(NULL, shard->buckets);
+    }
+    shard->buckets = new_buckets;
+    shard->num_buckets = new_num_buckets;
+    return true;
+}
+
+WEAK void unlink_from_lru(CacheShard *shard, CacheEntry *entry) {
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_assert(NULL, shard->least_recently_used == entry);
+        shard->least_recently_used = entry->more_recent;
+    }
+    if (entry->more_recent != NULL) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        halide_assert(NULL, shard->most_recently_used == entry);
+        shard->most_recently_used = entry->less_recent;
+    }
+    entry->more_recent = NULL;
+    entry->less_recent = NULL;
+}
+
+WEAK void push_most_recent(CacheShard *shard, CacheEntry *entry) {
+    entry->more_recent = NULL;
+    entry->less_recent = shard->most_recently_used;
+    if (shard->most_recently_used != NULL) {
+        shard->most_recently_used->more_recent = entry;
+    }
+    shard->most_recently_used = entry;
+    if (shard->least_recently_used == NULL) {
+        shard->least_recently_used = entry;
+    }
+}
+
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(NULL) << "validating cache, "
-                << "current size " << current_cache_size
-                << " of maximum " << max_cache_size << "\n";
+WEAK void validate_shard(CacheShard *shard) {
     int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+    for (size_t i = 0; i < shard->num_buckets; i++) {
+        CacheEntry *entry = shard->buckets[i];
         while (entry != NULL) {
             entries_in_hash_table++;
-            if (entry->more_recent == NULL && entry != most_recently_used) {
+            if (entry->more_recent == NULL && entry != shard->most_recently_used) {
                 halide_print(NULL, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == NULL && entry != least_recently_used) {
+            if (entry->less_recent == NULL && entry != shard->least_recently_used) {
                 halide_print(NULL, "cache invalid case 2\n");
                 __builtin_trap();
             }
@@ -220,21 +568,23 @@ WEAK void validate_cache() {
         }
     }
     int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    CacheEntry *mru_chain = shard->most_recently_used;
     while (mru_chain != NULL) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
     int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    CacheEntry *lru_chain = shard->least_recently_used;
     while (lru_chain != NULL) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
     }
-    print(NULL) << "hash entries " << entries_in_hash_table
+    print(NULL) << "shard " << (int)(shard - cache_shards)
+                << " hash entries " << entries_in_hash_table
                 << ", mru entries " << entries_from_mru
                 << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
+    if (entries_in_hash_table != entries_from_mru ||
+        entries_in_hash_table != (int)shard->num_entries) {
         halide_print(NULL, "cache invalid case 3\n");
         __builtin_trap();
     }
@@ -249,62 +599,100 @@ WEAK void validate_cache() {
 }
 #endif
 
-WEAK void prune_cache() {
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != NULL) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_assert(NULL, prev_hash_entry != NULL);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+// Remove an unused entry from its shard and free it. Must be called
+// with the shard locked.
+WEAK void evict_entry(CacheShard *shard, CacheEntry *entry) {
+    // Remove from hash table
+    CacheEntry **prev_ptr = bucket(shard, entry->hash);
+    while (*prev_ptr != NULL && *prev_ptr != entry) {
+        prev_ptr = &(*prev_ptr)->next;
+    }
+    halide_assert(NULL, *prev_ptr != NULL);
+    *prev_ptr = entry->next;
+    shard->num_entries--;
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != NULL) {
-                more_recent->less_recent = prune_candidate->less_recent;
-            }
+    unlink_from_lru(shard, entry);
+
+    // Decrease cache used amount.
+    __atomic_fetch_sub(&current_cache_size, (int64_t)entry->bytes, __ATOMIC_RELAXED);
+    if (entry->func) {
+        __atomic_fetch_sub(&entry->func->bytes, (int64_t)entry->bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&entry->func->evictions, (uint64_t)1, __ATOMIC_RELAXED);
+    }
+
+    // Deallocate the entry.
+    entry->destroy();
+    halide_free(NULL, entry);
+}
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
+// Eviction considers this many of the least recently used entries in
+// a shard and picks the one that is cheapest to recompute per
+// byte. One would make it pure LRU.
+const int kEvictionWindow = 4;
+
+WEAK __attribute((always_inline)) double cost_per_byte(const CacheEntry *entry) {
+    return (double)entry->cost_ns / (double)(entry->bytes + 1);
+}
+
+// Evict unused entries from one shard until the cache is within
+// budget. Must be called with the shard locked.
+WEAK void prune_shard(CacheShard *shard) {
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+    while (cache_over_budget()) {
+        CacheEntry *victim = NULL;
+        int considered = 0;
+        for (CacheEntry *e = shard->least_recently_used;
+             e != NULL && considered < kEvictionWindow;
+             e = e->more_recent) {
+            if (e->in_use_count != 0) {
+                continue;
             }
-            if (prune_candidate->less_recent != NULL) {
-                prune_candidate->less_recent = more_recent;
+            considered++;
+            if (victim == NULL || cost_per_byte(e) < cost_per_byte(victim)) {
+                victim = e;
             }
+        }
+        if (victim == NULL) {
+            break;
+        }
+        evict_entry(shard, victim);
+    }
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+}
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
+// Evict a Func's unused entries, least recently used first, until it
+// is within its own budget. Must be called with no shard locked.
+WEAK void prune_func(CacheFuncStats *func) {
+    for (int s = 0; s < kNumShards; s++) {
+        CacheShard *shard = &cache_shards[s];
+        ScopedMutexLock lock(&shard->lock);
+        CacheEntry *candidate = shard->least_recently_used;
+        while (candidate != NULL &&
+               __atomic_load_n(&func->bytes, __ATOMIC_RELAXED) > func->max_bytes) {
+            CacheEntry *more_recent = candidate->more_recent;
+            if (candidate->func == func && candidate->in_use_count == 0) {
+                evict_entry(shard, candidate);
             }
-
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(NULL, prune_candidate);
+            candidate = more_recent;
+        }
+        if (__atomic_load_n(&func->bytes, __ATOMIC_RELAXED) <= func->max_bytes) {
+            break;
         }
+    }
+}
 
-        prune_candidate = more_recent;
+// Prune shards one at a time, starting with the given one, until the
+// cache is within budget. Must be called with no shard locked.
+WEAK void prune_cache(int first_shard) {
+    for (int i = 0; i < kNumShards && cache_over_budget(); i++) {
+        CacheShard *shard = &cache_shards[(first_shard + i) % kNumShards];
+        ScopedMutexLock lock(&shard->lock);
+        prune_shard(shard);
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
 }
 
 }}} // namespace Halide::Runtime::Internal
@@ -316,18 +704,15 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
-
-    max_cache_size = size;
-    prune_cache();
+    __atomic_store_n(&max_cache_size, size, __ATOMIC_RELAXED);
+    prune_cache(0);
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
+    uint64_t h = hash_key(cache_key, size);
+    CacheShard *shard = &cache_shards[shard_index(h)];
+    CacheFuncStats *func = func_stats_for_key(cache_key, size);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -342,52 +727,58 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
+    {
+        ScopedMutexLock lock(&shard->lock);
 
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    if (entry->less_recent != NULL) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    entry->more_recent->less_recent = entry->less_recent;
+        CacheEntry *entry = shard->buckets ? *bucket(shard, h) : NULL;
+        while (entry != NULL) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                // Check all the tuple buffers have the same bounds (they
+                // should), and that a result on a device is on the
+                // caller's device, if it has said which.
+                bool all_bounds_equal = true;
+                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                    const halide_device_interface_t *interface = tuple_buffers[i]->device_interface;
+                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim) &&
+                        (interface == NULL || entry->buf[i].device == 0 ||
+                         entry->buf[i].device_interface == interface);
+                }
 
-                    entry->more_recent = NULL;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != NULL) {
-                        most_recently_used->more_recent = entry;
+                if (all_bounds_equal) {
+                    if (entry != shard->most_recently_used) {
+                        unlink_from_lru(shard, entry);
+                        push_most_recent(shard, entry);
                     }
-                    most_recently_used = entry;
-                }
 
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        *buf = entry->buf[i];
+                    }
 
-                entry->in_use_count += tuple_count;
+                    // Each device allocation is handed back separately.
+                    entry->in_use_count += tuple_count + device_allocation_count(entry);
 
-                return 0;
+                    if (func) {
+                        __atomic_fetch_add(&func->hits, (uint64_t)1, __ATOMIC_RELAXED);
+                    }
+                    return 0;
+                }
             }
+            entry = entry->next;
         }
-        entry = entry->next;
     }
 
+    // A miss. Allocate the storage for the caller to compute into
+    // without holding the shard lock.
+    if (func) {
+        __atomic_fetch_add(&func->misses, (uint64_t)1, __ATOMIC_RELAXED);
+    }
+    halide_start_clock(user_context);
+    int64_t miss_time = halide_current_time_ns(user_context);
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -403,12 +794,9 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = NULL;
+        header->miss_time_ns = miss_time;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-
     return 1;
 }
 
@@ -417,11 +805,18 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
     debug(user_context) << "halide_memoization_cache_store\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
-
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
+    CacheBlockHeader *first_header = get_pointer_to_header(tuple_buffers[0]->host);
+    uint64_t h = first_header->hash;
+    int index = shard_index(h);
+    CacheShard *shard = &cache_shards[index];
+    CacheFuncStats *func = func_stats_for_key(cache_key, size);
+    int64_t cost = halide_current_time_ns(user_context) - first_header->miss_time_ns;
+    if (cost < 0) {
+        cost = 0;
+    }
+    if (func) {
+        __atomic_fetch_add(&func->compute_time_ns, (uint64_t)cost, __ATOMIC_RELAXED);
+    }
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
@@ -436,88 +831,99 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
+    // Build the new entry before taking the lock.
+    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+    bool inited = false;
+    if (new_entry) {
+        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
+    }
+    if (inited) {
+        new_entry->func = func;
+        new_entry->cost_ns = (uint64_t)cost;
+        for (int32_t i = 0; i < tuple_count; i++) {
+            new_entry->bytes += tuple_buffers[i]->size_in_bytes();
+        }
+    }
 
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
+    bool stored = false;
+    {
+        ScopedMutexLock lock(&shard->lock);
+
+        bool already_stored = false;
+        CacheEntry *entry = shard->buckets ? *bucket(shard, h) : NULL;
+        while (entry != NULL) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
                     }
                 }
-            }
-            if (all_bounds_equal) {
-                halide_assert(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-
+                if (all_bounds_equal) {
+                    halide_assert(user_context, no_host_pointers_equal);
+                    // Another thread stored the same result first.
+                    already_stored = true;
+                    break;
                 }
-                return 0;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
-        }
-    }
-    current_cache_size += added_size;
-    prune_cache();
+        if (inited && !already_stored && reserve_bucket(shard) &&
+            own_device_allocations(new_entry)) {
+            CacheEntry **b = bucket(shard, h);
+            new_entry->next = *b;
+            *b = new_entry;
+            shard->num_entries++;
+            push_most_recent(shard, new_entry);
 
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
+            new_entry->in_use_count = tuple_count + device_allocation_count(new_entry);
+
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+            }
+            __atomic_fetch_add(&current_cache_size, (int64_t)new_entry->bytes, __ATOMIC_RELAXED);
+            if (func) {
+                __atomic_fetch_add(&func->bytes, (int64_t)new_entry->bytes, __ATOMIC_RELAXED);
+            }
+
+#if CACHE_DEBUGGING
+            validate_shard(shard);
+#endif
+            stored = true;
+        }
     }
-    if (!inited) {
-        current_cache_size -= added_size;
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
+    if (!stored) {
+        // The buffers are still in use by the caller. Mark them as
+        // having no cache entry so halide_memoization_cache_release
+        // can free them.
         for (int32_t i = 0; i < tuple_count; i++) {
             get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
         }
-
         if (new_entry) {
+            if (inited) {
+                halide_free(NULL, new_entry->metadata_storage);
+            }
             halide_free(user_context, new_entry);
         }
-        return 0;
-    }
-
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != NULL) {
-        most_recently_used->more_recent = new_entry;
     }
-    most_recently_used = new_entry;
-    if (least_recently_used == NULL) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
-
-    new_entry->in_use_count = tuple_count;
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+    prune_cache(index);
+    if (func && func->max_bytes > 0 &&
+        __atomic_load_n(&func->bytes, __ATOMIC_RELAXED) > func->max_bytes) {
+        prune_func(func);
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return 0;
@@ -531,33 +937,110 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == NULL) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard *shard = &cache_shards[shard_index(entry->hash)];
+        ScopedMutexLock lock(&shard->lock);
 
         halide_assert(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_shard(shard);
 #endif
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
 }
 
+WEAK int halide_memoization_cache_release_device(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    CacheEntry *entry = NULL;
+    {
+        ScopedMutexLock lock(&owned_devices_lock);
+        size_t i = find_owned_device(buf->device);
+        if (i != owned_devices_capacity) {
+            entry = owned_devices[i].entry;
+        }
+    }
+    if (entry == NULL) {
+        // The result was never stored, or was stored without this
+        // device allocation.
+        return halide_device_free(user_context, buf);
+    }
+
+    {
+        CacheShard *shard = &cache_shards[shard_index(entry->hash)];
+        ScopedMutexLock lock(&shard->lock);
+        halide_assert(user_context, entry->in_use_count > 0);
+        entry->in_use_count--;
+    }
+    // The entry keeps the allocation.
+    buf->device = 0;
+    buf->device_interface = NULL;
+    buf->set_device_dirty(false);
+    return 0;
+}
+
 WEAK void halide_memoization_cache_cleanup() {
     debug(NULL) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = NULL;
-        while (entry != NULL) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(NULL, entry);
-            entry = next;
+    for (int s = 0; s < kNumShards; s++) {
+        CacheShard *shard = &cache_shards[s];
+        for (size_t i = 0; i < shard->num_buckets; i++) {
+            CacheEntry *entry = shard->buckets[i];
+            while (entry != NULL) {
+                CacheEntry *next = entry->next;
+                entry->destroy();
+                halide_free(NULL, entry);
+                entry = next;
+            }
+        }
+        if (shard->buckets) {
+            halide_free(NULL, shard->buckets);
         }
+        shard->buckets = NULL;
+        shard->num_buckets = 0;
+        shard->num_entries = 0;
+        shard->most_recently_used = NULL;
+        shard->least_recently_used = NULL;
     }
     current_cache_size = 0;
-    most_recently_used = NULL;
-    least_recently_used = NULL;
+    if (owned_devices) {
+        halide_free(NULL, owned_devices);
+    }
+    owned_devices = NULL;
+    owned_devices_capacity = 0;
+    num_owned_devices = 0;
+    for (int i = 0; i < num_cache_funcs; i++) {
+        halide_free(NULL, cache_func_stats[i].name);
+    }
+    memset(cache_func_stats, 0, sizeof(cache_func_stats));
+    num_cache_funcs = 0;
+}
+
+WEAK void halide_memoization_cache_set_func_size(const char *func_name, int64_t size) {
+    CacheFuncStats *func = find_func_stats(func_name, strlen(func_name), true);
+    if (func == NULL) {
+        return;
+    }
+    __atomic_store_n(&func->max_bytes, size, __ATOMIC_RELAXED);
+    if (size > 0 && __atomic_load_n(&func->bytes, __ATOMIC_RELAXED) > size) {
+        prune_func(func);
+    }
+}
+
+WEAK int halide_memoization_cache_get_stats(halide_memoization_cache_func_stats_t *stats, int max_funcs) {
+    int n = __atomic_load_n(&num_cache_funcs, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n && i < max_funcs; i++) {
+        const CacheFuncStats &f = cache_func_stats[i];
+        stats[i].func_name = f.name;
+        stats[i].hits = __atomic_load_n(&f.hits, __ATOMIC_RELAXED);
+        stats[i].misses = __atomic_load_n(&f.misses, __ATOMIC_RELAXED);
+        stats[i].evictions = __atomic_load_n(&f.evictions, __ATOMIC_RELAXED);
+        stats[i].compute_time_ns = __atomic_load_n(&f.compute_time_ns, __ATOMIC_RELAXED);
+        stats[i].bytes = __atomic_load_n(&f.bytes, __ATOMIC_RELAXED);
+        stats[i].max_bytes = __atomic_load_n(&f.max_bytes, __ATOMIC_RELAXED);
+    }
+    return n;
 }
 
 namespace {
@@ -164,6 +164,15 @@ CL_FN(cl_program,
                                   const char **     /* strings */,
                                   const size_t *    /* lengths */,
                                   cl_int *          /* errcode_ret */));
+CL_FN(cl_program,
+      clCreateProgramWithBinary, (cl_context                     /* context */,
+                                  cl_uint                        /* num_devices */,
+                                  const cl_device_id *           /* device_list */,
+                                  const size_t *                 /* lengths */,
+                                  const unsigned char **         /* binaries */,
+                                  cl_int *                       /* binary_status */,
+                                  cl_int *                       /* errcode_ret */));
+
 CL_FN(cl_int,
       clRetainProgram, (cl_program /* program */));
 
@@ -186,6 +195,13 @@ CL_FN(cl_int,
                               void *                /* param_value */,
                               size_t *              /* param_value_size_ret */));
 
+CL_FN(cl_int,
+      clGetProgramInfo, (cl_program         /* program */,
+                         cl_program_info    /* param_name */,
+                         size_t             /* param_value_size */,
+                         void *             /* param_value */,
+                         size_t *           /* param_value_size_ret */));
+
 /* Kernel Object APIs */
 CL_FN(cl_kernel,
       clCreateKernel, (cl_program      /* program */,
@@ -204,6 +220,25 @@ CL_FN(cl_int,
                        size_t       /* arg_size */,
                        const void * /* arg_value */));
 
+/* Event Object APIs */
+CL_FN(cl_int,
+      clWaitForEvents, (cl_uint             /* num_events */,
+                        const cl_event *    /* event_list */));
+
+CL_FN(cl_int,
+      clRetainEvent, (cl_event /* event */));
+
+CL_FN(cl_int,
+      clReleaseEvent, (cl_event /* event */));
+
+/* Profiling APIs */
+CL_FN(cl_int,
+      clGetEventProfilingInfo, (cl_event          /* event */,
+                                cl_profiling_info /* param_name */,
+                                size_t            /* param_value_size */,
+                                void *            /* param_value */,
+                                size_t *          /* param_value_size_ret */));
+
 /* Flush and Finish APIs */
 CL_FN(cl_int,
       clFlush, (cl_command_queue /* command_queue */));
@@ -278,6 +313,21 @@ CL_FN(cl_int,
                             const cl_event *   /* event_wait_list */,
                             cl_event *         /* event */));
 
+CL_FN(cl_int,
+      clEnqueueCopyBufferRect, (cl_command_queue    /* command_queue */,
+                                cl_mem              /* src_buffer */,
+                                cl_mem              /* dst_buffer */,
+                                const size_t *      /* src_origin */,
+                                const size_t *      /* dst_origin */,
+                                const size_t *      /* region */,
+                                size_t              /* src_row_pitch */,
+                                size_t              /* src_slice_pitch */,
+                                size_t              /* dst_row_pitch */,
+                                size_t              /* dst_slice_pitch */,
+                                cl_uint             /* num_events_in_wait_list */,
+                                const cl_event *    /* event_wait_list */,
+                                cl_event *          /* event */));
+
 CL_FN(cl_int,
       clEnqueueReadImage, (cl_command_queue     /* command_queue */,
                            cl_mem               /* image */,
@@ -0,0 +1,257 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// A 64-bit hash in the style of XXH3. The input is consumed in stripes
+// of 64 bytes by eight independent lanes, each of which adds the
+// product of the two 32-bit halves of its input word mixed with a key,
+// which compilers turn into a few vector multiplies (pmuludq on x86,
+// umlal on ARM) per stripe. The lanes are scrambled every 16 stripes so
+// that the state doesn't just accumulate, and folded together at the
+// end. It is not meant to resist attack, only to tell different
+// buffers apart with overwhelming probability.
+
+const uint64_t kHashPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kHashPrime3 = 0x165667B19E3779F9ULL;
+const uint32_t kHashPrime32 = 0x9E3779B1U;
+
+const uint64_t kStripeKey[8] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL};
+
+const uint64_t kScrambleKey[8] = {
+    0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL, 0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+    0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL, 0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL};
+
+const int kStripeBytes = 64;
+const int kStripesPerScramble = 16;
+
+struct ContentHasher {
+    uint64_t acc[8];
+    uint8_t pending[kStripeBytes];
+    uint32_t num_pending;
+    uint32_t stripes;
+    uint64_t length;
+
+    void init() {
+        for (int i = 0; i < 8; i++) {
+            acc[i] = kStripeKey[i] ^ kHashPrime1;
+        }
+        num_pending = 0;
+        stripes = 0;
+        length = 0;
+    }
+
+    __attribute__((always_inline)) void accumulate(const uint8_t *p) {
+        for (int i = 0; i < 8; i++) {
+            uint64_t data;
+            memcpy(&data, p + 8 * i, 8);
+            uint64_t keyed = data ^ kStripeKey[i];
+            acc[i ^ 1] += data;
+            acc[i] += (keyed & 0xffffffffULL) * (keyed >> 32);
+        }
+        if (++stripes == kStripesPerScramble) {
+            for (int i = 0; i < 8; i++) {
+                acc[i] ^= acc[i] >> 47;
+                acc[i] ^= kScrambleKey[i];
+                acc[i] *= kHashPrime32;
+            }
+            stripes = 0;
+        }
+    }
+
+    void update(const uint8_t *p, size_t n) {
+        length += n;
+        if (num_pending) {
+            size_t take = kStripeBytes - num_pending;
+            if (take > n) {
+                take = n;
+            }
+            memcpy(pending + num_pending, p, take);
+            num_pending += take;
+            p += take;
+            n -= take;
+            if (num_pending < kStripeBytes) {
+                return;
+            }
+            accumulate(pending);
+            num_pending = 0;
+        }
+        while (n >= kStripeBytes) {
+            accumulate(p);
+            p += kStripeBytes;
+            n -= kStripeBytes;
+        }
+        memcpy(pending, p, n);
+        num_pending = n;
+    }
+
+    uint64_t finish() {
+        if (num_pending) {
+            memset(pending + num_pending, 0, kStripeBytes - num_pending);
+            accumulate(pending);
+        }
+        uint64_t h = length * kHashPrime1;
+        for (int i = 0; i < 8; i += 2) {
+            uint64_t a = acc[i] ^ kScrambleKey[i];
+            uint64_t b = acc[i + 1] ^ kScrambleKey[i + 1];
+            uint64_t m = (a ^ ((b << 29) | (b >> 35))) * kHashPrime2;
+            h += m ^ (m >> 32);
+            h = ((h << 27) | (h >> 37)) * kHashPrime1;
+        }
+        h ^= h >> 37;
+        h *= kHashPrime3;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
+// Buffers are hashed in chunks of this many bytes of their contents,
+// which can be hashed in parallel. The hash of a buffer is the hash of
+// its type, its shape and the hashes of its chunks, so it is the same
+// however many threads computed it.
+const uint64_t kChunkBytes = 256 * 1024;
+// Chunk hashes for up to this many chunks are kept on the stack.
+const int kMaxStackChunks = 64;
+
+WEAK bool is_dense(const halide_buffer_t *buf) {
+    int64_t expected = 1;
+    for (int i = 0; i < buf->dimensions; i++) {
+        if (buf->dim[i].stride != expected) {
+            return false;
+        }
+        expected *= buf->dim[i].extent;
+    }
+    return true;
+}
+
+// Hash the elements with indices [begin, end), numbering the elements
+// with the innermost dimension fastest, so that the result doesn't
+// depend on the strides.
+WEAK void hash_elements(const halide_buffer_t *buf, bool dense,
+                        uint64_t begin, uint64_t end, ContentHasher *h) {
+    const size_t elem_size = buf->type.bytes();
+    if (dense) {
+        h->update(buf->host + begin * elem_size, (end - begin) * elem_size);
+        return;
+    }
+
+    const int d = buf->dimensions;
+    const uint64_t row_length = d > 0 ? buf->dim[0].extent : 1;
+    const int64_t inner_stride = d > 0 ? buf->dim[0].stride : 0;
+    uint64_t i = begin;
+    while (i < end) {
+        uint64_t row = i / row_length;
+        uint64_t x = i % row_length;
+        uint64_t n = row_length - x;
+        if (n > end - i) {
+            n = end - i;
+        }
+        int64_t offset = (int64_t)x * inner_stride;
+        for (int k = 1; k < d; k++) {
+            offset += (int64_t)(row % buf->dim[k].extent) * buf->dim[k].stride;
+            row /= buf->dim[k].extent;
+        }
+        const uint8_t *p = buf->host + offset * (int64_t)elem_size;
+        if (inner_stride == 1) {
+            h->update(p, n * elem_size);
+        } else {
+            for (uint64_t j = 0; j < n; j++) {
+                h->update(p + (int64_t)j * inner_stride * (int64_t)elem_size, elem_size);
+            }
+        }
+        i += n;
+    }
+}
+
+struct ContentHashClosure {
+    const halide_buffer_t *buf;
+    bool dense;
+    uint64_t num_elements;
+    uint64_t chunk_elements;
+    uint64_t *chunk_hashes;
+};
+
+WEAK uint64_t hash_chunk(const ContentHashClosure *c, uint64_t chunk) {
+    uint64_t begin = chunk * c->chunk_elements;
+    uint64_t end = begin + c->chunk_elements;
+    if (end > c->num_elements) {
+        end = c->num_elements;
+    }
+    ContentHasher h;
+    h.init();
+    hash_elements(c->buf, c->dense, begin, end, &h);
+    return h.finish();
+}
+
+WEAK int content_hash_task(void *user_context, int idx, uint8_t *closure) {
+    ContentHashClosure *c = (ContentHashClosure *)closure;
+    c->chunk_hashes[idx] = hash_chunk(c, (uint64_t)idx);
+    return 0;
+}
+
+// Returned when a buffer can't be hashed, so that its results are
+// never found in the cache.
+WEAK uint64_t content_hash_failures = 0;
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK uint64_t halide_buffer_content_hash(void *user_context, halide_buffer_t *buf) {
+    if (buf->device_dirty() && halide_copy_to_host(user_context, buf) != 0) {
+        buf = NULL;
+    }
+    if (buf == NULL || buf->host == NULL) {
+        return __atomic_fetch_add(&content_hash_failures, (uint64_t)1, __ATOMIC_RELAXED) ^ kHashPrime3;
+    }
+
+    ContentHashClosure c;
+    c.buf = buf;
+    c.dense = is_dense(buf);
+    c.num_elements = buf->number_of_elements();
+    c.chunk_elements = kChunkBytes / buf->type.bytes();
+    if (c.chunk_elements == 0) {
+        c.chunk_elements = 1;
+    }
+    uint64_t num_chunks = (c.num_elements + c.chunk_elements - 1) / c.chunk_elements;
+
+    // The type and the shape, including the mins, are part of the key,
+    // as the Func may depend on them.
+    ContentHasher h;
+    h.init();
+    h.update((const uint8_t *)&buf->type, sizeof(buf->type));
+    h.update((const uint8_t *)&buf->dimensions, sizeof(buf->dimensions));
+    for (int i = 0; i < buf->dimensions; i++) {
+        h.update((const uint8_t *)&buf->dim[i].min, sizeof(buf->dim[i].min));
+        h.update((const uint8_t *)&buf->dim[i].extent, sizeof(buf->dim[i].extent));
+    }
+
+    uint64_t stack_hashes[kMaxStackChunks];
+    c.chunk_hashes = NULL;
+    if (num_chunks > 1 && num_chunks <= 0x7fffffff) {
+        c.chunk_hashes = num_chunks <= kMaxStackChunks ? stack_hashes :
+            (uint64_t *)halide_malloc(user_context, num_chunks * sizeof(uint64_t));
+    }
+    if (c.chunk_hashes != NULL &&
+        halide_do_par_for(user_context, content_hash_task, 0, (int)num_chunks, (uint8_t *)&c) == 0) {
+        h.update((const uint8_t *)c.chunk_hashes, num_chunks * sizeof(uint64_t));
+    } else {
+        // One chunk, or no memory for the chunk hashes. Hash the
+        // chunks in order instead.
+        for (uint64_t i = 0; i < num_chunks; i++) {
+            uint64_t chunk_hash = hash_chunk(&c, i);
+            h.update((const uint8_t *)&chunk_hash, sizeof(chunk_hash));
+        }
+    }
+    if (c.chunk_hashes != NULL && c.chunk_hashes != stack_hashes) {
+        halide_free(user_context, c.chunk_hashes);
+    }
+    return h.finish();
+}
+
+}
@@ -1,4 +1,5 @@
 #include "HalideRuntimeCuda.h"
+#include "device_allocation_cache.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
 #include "printer.h"
@@ -80,6 +81,104 @@ CUcontext WEAK context = 0;
 // This spinlock protexts the above context variable.
 volatile int WEAK context_lock = 0;
 
+// Whether the default halide_cuda_get_stream gives each thread its own
+// stream. Set by halide_cuda_set_stream_per_thread, or by the
+// HL_CUDA_STREAM_PER_THREAD environment variable.
+WEAK bool stream_per_thread = false;
+WEAK bool stream_per_thread_initialized = false;
+volatile int WEAK stream_per_thread_lock = 0;
+
+WEAK bool use_stream_per_thread() {
+    ScopedSpinLock spinlock(&stream_per_thread_lock);
+    if (!stream_per_thread_initialized) {
+        const char *var = getenv("HL_CUDA_STREAM_PER_THREAD");
+        stream_per_thread = (var && atoi(var) != 0);
+        stream_per_thread_initialized = true;
+    }
+    return stream_per_thread;
+}
+
+// Whether halide_cuda_device_and_host_malloc maps its pinned host
+// allocations into the device address space instead of making a
+// separate device allocation. Set by halide_cuda_set_mapped_host_memory,
+// or by the HL_CUDA_MAPPED_HOST_MEMORY environment variable.
+WEAK bool mapped_host_memory = false;
+WEAK bool mapped_host_memory_initialized = false;
+volatile int WEAK mapped_host_memory_lock = 0;
+
+WEAK bool use_mapped_host_memory() {
+    ScopedSpinLock spinlock(&mapped_host_memory_lock);
+    if (!mapped_host_memory_initialized) {
+        const char *var = getenv("HL_CUDA_MAPPED_HOST_MEMORY");
+        mapped_host_memory = (var && atoi(var) != 0);
+        mapped_host_memory_initialized = true;
+    }
+    return mapped_host_memory;
+}
+
+// Whether pipelines batch their kernel launches into CUDA graphs. Set
+// by halide_cuda_set_launch_graphs, or by the HL_CUDA_LAUNCH_GRAPHS
+// environment variable.
+WEAK bool launch_graphs_enabled = false;
+WEAK bool launch_graphs_initialized = false;
+volatile int WEAK launch_graphs_lock = 0;
+
+WEAK bool use_launch_graphs() {
+    ScopedSpinLock spinlock(&launch_graphs_lock);
+    if (!launch_graphs_initialized) {
+        const char *var = getenv("HL_CUDA_LAUNCH_GRAPHS");
+        launch_graphs_enabled = (var && atoi(var) != 0);
+        launch_graphs_initialized = true;
+    }
+    return launch_graphs_enabled;
+}
+
+// The contexts of the devices other than the main context's device,
+// used by loops distributed across devices with gpu_multi_device. They
+// are created on first use, in device order, and can access the main
+// context's allocations peer-to-peer.
+const int max_multi_device_contexts = 15;
+WEAK CUcontext multi_device_contexts[max_multi_device_contexts];
+WEAK int num_multi_device_contexts = 0;
+// This spinlock protects the above contexts.
+volatile int WEAK multi_device_lock = 0;
+
+// How many devices loops distributed across devices use at most. Set
+// by halide_cuda_set_multi_device_count, or by the
+// HL_CUDA_MULTI_DEVICE_COUNT environment variable. Zero means all of
+// them.
+WEAK int multi_device_count_limit = 0;
+WEAK bool multi_device_count_limit_initialized = false;
+
+WEAK int get_multi_device_count_limit() {
+    ScopedSpinLock spinlock(&multi_device_lock);
+    if (!multi_device_count_limit_initialized) {
+        const char *var = getenv("HL_CUDA_MULTI_DEVICE_COUNT");
+        multi_device_count_limit = var ? atoi(var) : 0;
+        multi_device_count_limit_initialized = true;
+    }
+    return multi_device_count_limit;
+}
+
+// If this thread is running a chunk of a loop distributed across
+// devices on a device other than the main context's, the context of
+// that device is current. Returns it, or NULL.
+WEAK CUcontext current_multi_device_context() {
+    if (num_multi_device_contexts == 0) {
+        return NULL;
+    }
+    CUcontext current = NULL;
+    if (cuCtxGetCurrent(&current) != CUDA_SUCCESS || current == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < num_multi_device_contexts; i++) {
+        if (multi_device_contexts[i] == current) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
 }}}} // namespace Halide::Runtime::Internal::Cuda
 
 using namespace Halide::Runtime::Internal;
@@ -150,12 +249,31 @@ WEAK int halide_cuda_release_context(void *user_context) {
 // halide_cuda_acquire_context/halide_cuda_release_context pair, not this call.
 WEAK int halide_cuda_get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
     // There are two default streams we could use. stream 0 is fully
-    // synchronous. stream 2 gives a separate non-blocking stream per
-    // thread.
-    *stream = 0;
+    // synchronous. stream 2 gives a separate stream per thread, so
+    // that kernels launched by independent threads, such as the
+    // branches of an async producer, can overlap.
+    *stream = use_stream_per_thread() ? CU_STREAM_PER_THREAD : 0;
     return 0;
 }
 
+WEAK void halide_cuda_set_stream_per_thread(bool per_thread) {
+    ScopedSpinLock spinlock(&stream_per_thread_lock);
+    stream_per_thread = per_thread;
+    stream_per_thread_initialized = true;
+}
+
+WEAK void halide_cuda_set_launch_graphs(bool use_graphs) {
+    ScopedSpinLock spinlock(&launch_graphs_lock);
+    launch_graphs_enabled = use_graphs;
+    launch_graphs_initialized = true;
+}
+
+WEAK void halide_cuda_set_mapped_host_memory(bool mapped) {
+    ScopedSpinLock spinlock(&mapped_host_memory_lock);
+    mapped_host_memory = mapped;
+    mapped_host_memory_initialized = true;
+}
+
 } // extern "C"
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Cuda {
@@ -190,6 +308,13 @@ public:
         halide_assert(user_context, context != NULL);
         halide_assert(user_context, cuInit != NULL);
 
+        // Within a chunk of a loop distributed across devices, work
+        // goes to the chunk's device instead.
+        CUcontext multi_device_context = current_multi_device_context();
+        if (multi_device_context != NULL) {
+            context = multi_device_context;
+        }
+
         error = cuCtxPushCurrent(context);
     }
 
@@ -224,11 +349,19 @@ struct module_state {
 struct registered_filters {
     module_state *modules;
     registered_filters *next;
+    // The kernel code, to load the module into the contexts of other
+    // devices when a loop is distributed across devices.
+    const char *src;
+    int size;
 };
 WEAK registered_filters *filters_list = NULL;
 // This spinlock protects the above filters_list.
 volatile int WEAK filters_list_lock = 0;
 
+// Device allocations freed while halide_can_reuse_device_allocations is
+// true, keyed by the CUcontext they were made in.
+WEAK device_allocation_cache allocation_cache;
+
 WEAK module_state *find_module_for_context(const registered_filters *filters, CUcontext ctx) {
     module_state *modules = filters->modules;
     while (modules != NULL) {
@@ -388,7 +521,10 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
 
     // Create context
     debug(user_context) <<  "    cuCtxCreate " << dev << " -> ";
-    err = cuCtxCreate(ctx, 0, dev);
+    // Allow pinned host allocations to be mapped into the device
+    // address space (only needed on devices without unified
+    // addressing).
+    err = cuCtxCreate(ctx, CU_CTX_MAP_HOST, dev);
     if (err != CUDA_SUCCESS) {
         debug(user_context) << get_error_name(err) << "\n";
         error(user_context) << "CUDA: cuCtxCreate failed: "
@@ -418,6 +554,62 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
 // it prevents using debug mode with cuda.
 #define ENABLE_POINTER_VALIDATION 0
 
+// The page-locked host allocations made by
+// halide_cuda_device_and_host_malloc. 'device' is the device view of
+// the allocation if it is mapped into the device address space, or
+// zero if the buffer has a separate device allocation.
+struct host_allocation {
+    uint8_t *host;
+    CUdeviceptr device;
+    size_t size;
+    host_allocation *next;
+};
+WEAK host_allocation *host_allocations = NULL;
+// This spinlock protects the above list.
+volatile int WEAK host_allocations_lock = 0;
+
+// Remove the record of the allocation starting at 'host' from the list
+// and return it, or return NULL if there is none.
+WEAK host_allocation *unregister_host_allocation(const uint8_t *host) {
+    ScopedSpinLock spinlock(&host_allocations_lock);
+    host_allocation **prev_ptr = &host_allocations;
+    for (host_allocation *a = host_allocations; a; a = a->next) {
+        if (a->host == host) {
+            *prev_ptr = a->next;
+            return a;
+        }
+        prev_ptr = &a->next;
+    }
+    return NULL;
+}
+
+// Is this host pointer inside a page-locked allocation? Copies to and
+// from such memory can run asynchronously without staging.
+WEAK bool is_pinned_host_memory(const uint8_t *host) {
+    ScopedSpinLock spinlock(&host_allocations_lock);
+    for (host_allocation *a = host_allocations; a; a = a->next) {
+        if (host >= a->host && host < a->host + a->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Are the host and device fields of this buffer two views of the same
+// mapped allocation? If so there is nothing to copy between them.
+WEAK bool is_mapped_buffer(const halide_buffer_t *buf) {
+    if (buf->host == NULL || buf->device == 0) {
+        return false;
+    }
+    ScopedSpinLock spinlock(&host_allocations_lock);
+    for (host_allocation *a = host_allocations; a; a = a->next) {
+        if (a->device != 0 && buf->host >= a->host && buf->host < a->host + a->size) {
+            return buf->device == a->device + (CUdeviceptr)(buf->host - a->host);
+        }
+    }
+    return false;
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
 // The technique using cuPointerGetAttribute and CU_POINTER_ATTRIBUTE_CONTEXT
 // requires unified virtual addressing is enabled and that is not the case
@@ -446,242 +638,1063 @@ WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size
 #endif
 }
 
-}}}} // namespace Halide::Runtime::Internal
-
-extern "C" {
-WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, const char* ptx_src, int size) {
-    debug(user_context) << "CUDA: halide_cuda_initialize_kernels (user_context: " << user_context
-                        << ", state_ptr: " << state_ptr
-                        << ", ptx_src: " << (void *)ptx_src
-                        << ", size: " << size << "\n";
-
-    Context ctx(user_context);
-    if (ctx.error != 0) {
-        return ctx.error;
+// Texture objects made by halide_cuda_buffer_texture. A texture object
+// views device memory rather than holding a copy of it, so it stays
+// valid, whatever the buffer using that memory holds, until the memory
+// is returned to the driver.
+struct texture_object {
+    CUcontext context;
+    CUdeviceptr ptr;
+    size_t width, height, pitch;
+    bool linear_filter;
+    CUtexObject texture;
+    texture_object *next;
+};
+WEAK texture_object *texture_objects = NULL;
+volatile int WEAK texture_objects_lock = 0;
+
+// Destroy the texture objects of a context that view memory in [base,
+// base + size), or all of them if size is zero.
+WEAK void release_textures(void *user_context, CUcontext ctx, CUdeviceptr base, size_t size) {
+    ScopedSpinLock spinlock(&texture_objects_lock);
+    texture_object **prev_ptr = &texture_objects;
+    while (*prev_ptr != NULL) {
+        texture_object *t = *prev_ptr;
+        if (t->context == ctx &&
+            (size == 0 || (t->ptr >= base && t->ptr < base + size))) {
+            debug(user_context) << "    cuTexObjectDestroy " << (uint64_t)t->texture << "\n";
+            cuTexObjectDestroy(t->texture);
+            *prev_ptr = t->next;
+            free(t);
+        } else {
+            prev_ptr = &t->next;
+        }
     }
+}
 
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
-
+// Return an allocation to the driver, along with any texture objects
+// that view it.
+WEAK CUresult free_device_memory(void *user_context, CUcontext ctx, CUdeviceptr dev_ptr) {
+    CUdeviceptr base = 0;
+    size_t size = 0;
+    bool has_textures = texture_objects != NULL &&
+        cuMemGetAddressRange(&base, &size, dev_ptr) == CUDA_SUCCESS;
+    debug(user_context) << "    cuMemFree " << (void *)dev_ptr << "\n";
+    CUresult err = cuMemFree(dev_ptr);
+    if (has_textures && size > 0) {
+        release_textures(user_context, ctx, base, size);
+    }
+    return err;
+}
 
-    halide_assert(user_context, &filters_list_lock != NULL);
-    {
-        ScopedSpinLock spinlock(&filters_list_lock);
+WEAK void free_cached_allocation(void *user_context, void *context, uint64_t handle) {
+    CUresult err = free_device_memory(user_context, (CUcontext)context, (CUdeviceptr)handle);
+    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+}
 
-        // Create the state object if necessary. This only happens once, regardless
-        // of how many times halide_initialize_kernels/halide_release is called.
-        // halide_release traverses this list and releases the module objects, but
-        // it does not modify the list nodes created/inserted here.
-        registered_filters **filters = (registered_filters**)state_ptr;
-        if (!(*filters)) {
-            *filters = (registered_filters*)malloc(sizeof(registered_filters));
-            (*filters)->modules = NULL;
-            (*filters)->next = filters_list;
-            filters_list = *filters;
+// Kernel launches and copies timed with events, while device timing is
+// enabled (see halide_enable_device_timing). The elapsed times are
+// collected when the timing is read, or when the list fills up.
+struct timed_interval {
+    CUcontext context;
+    CUevent start, stop;
+    bool is_copy;
+};
+const int max_timed_intervals = 256;
+WEAK timed_interval timed_intervals[max_timed_intervals];
+WEAK int num_timed_intervals = 0;
+WEAK halide_mutex timed_intervals_mutex;
+WEAK halide_device_timer cuda_device_timer;
+
+// Wait for the timed intervals of a context, or of all contexts if ctx
+// is NULL, and add their elapsed times to the totals.
+WEAK CUresult collect_timed_intervals_already_locked(CUcontext ctx) {
+    CUresult result = CUDA_SUCCESS;
+    int kept = 0;
+    for (int i = 0; i < num_timed_intervals; i++) {
+        timed_interval &t = timed_intervals[i];
+        if (ctx != NULL && t.context != ctx) {
+            timed_intervals[kept++] = t;
+            continue;
         }
-
-        // Create the module itself if necessary.
-        module_state *loaded_module = find_module_for_context(*filters, ctx.context);
-        if (loaded_module == NULL) {
-            loaded_module = (module_state *)malloc(sizeof(module_state));
-            debug(user_context) <<  "    cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
-
-            CUjit_option options[] = { CU_JIT_MAX_REGISTERS };
-            unsigned int max_regs_per_thread = 64;
-
-            // A hack to enable control over max register count for
-            // testing. This should be surfaced in the schedule somehow
-            // instead.
-            char *regs = getenv("HL_CUDA_JIT_MAX_REGISTERS");
-            if (regs) {
-                max_regs_per_thread = atoi(regs);
+        CUresult err = cuCtxPushCurrent(t.context);
+        if (err == CUDA_SUCCESS) {
+            float ms = 0;
+            err = cuEventSynchronize(t.stop);
+            if (err == CUDA_SUCCESS) {
+                err = cuEventElapsedTime(&ms, t.start, t.stop);
             }
-            void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
-            CUresult err = cuModuleLoadDataEx(&loaded_module->module, ptx_src, 1, options, optionValues);
-
-            if (err != CUDA_SUCCESS) {
-                free(loaded_module);
-                error(user_context) << "CUDA: cuModuleLoadData failed: "
-                                    << get_error_name(err);
-                return err;
+            if (err == CUDA_SUCCESS) {
+                halide_device_timing_add(t.is_copy, (uint64_t)(ms * 1e6f));
             } else {
-                debug(user_context) << (void *)(loaded_module->module) << "\n";
+                result = err;
             }
-            loaded_module->context = ctx.context;
-            loaded_module->next = (*filters)->modules;
-            (*filters)->modules = loaded_module;
+            cuEventDestroy(t.start);
+            cuEventDestroy(t.stop);
+            CUcontext old;
+            cuCtxPopCurrent(&old);
         }
-    }  // spinlock
-
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_after = halide_current_time_ns(user_context);
-    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-    #endif
+    }
+    num_timed_intervals = kept;
+    return result;
+}
 
+WEAK int collect_cuda_device_timing(void *user_context) {
+    ScopedMutexLock lock(&timed_intervals_mutex);
+    CUresult err = collect_timed_intervals_already_locked(NULL);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: collecting device timing failed: "
+                            << get_error_name(err);
+        return err;
+    }
     return 0;
 }
 
-WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t* buf) {
-    // halide_device_free, at present, can be exposed to clients and they
-    // should be allowed to call halide_device_free on any halide_buffer_t
-    // including ones that have never been used with a GPU.
-    if (buf->device == 0) {
-        return 0;
+// Record the start of a launch or copy on a stream, if device timing is
+// enabled. Returns NULL if it isn't, or the event couldn't be recorded.
+WEAK CUevent begin_timed_interval(CUstream stream) {
+    if (!halide_device_timing_is_enabled()) {
+        return NULL;
     }
+    CUevent start = NULL;
+    if (cuEventCreate(&start, CU_EVENT_DEFAULT) != CUDA_SUCCESS) {
+        return NULL;
+    }
+    if (cuEventRecord(start, stream) != CUDA_SUCCESS) {
+        cuEventDestroy(start);
+        return NULL;
+    }
+    return start;
+}
 
-    CUdeviceptr dev_ptr = (CUdeviceptr)buf->device;
-
-    debug(user_context)
-        <<  "CUDA: halide_cuda_device_free (user_context: " << user_context
-        << ", buf: " << buf << ")\n";
-
-    Context ctx(user_context);
-    if (ctx.error != CUDA_SUCCESS)
-        return ctx.error;
+WEAK void end_timed_interval(CUcontext ctx, CUstream stream, CUevent start, bool is_copy) {
+    if (start == NULL) {
+        return;
+    }
+    CUevent stop = NULL;
+    if (cuEventCreate(&stop, CU_EVENT_DEFAULT) != CUDA_SUCCESS) {
+        cuEventDestroy(start);
+        return;
+    }
+    if (cuEventRecord(stop, stream) != CUDA_SUCCESS) {
+        cuEventDestroy(start);
+        cuEventDestroy(stop);
+        return;
+    }
+    ScopedMutexLock lock(&timed_intervals_mutex);
+    if (cuda_device_timer.collect == NULL) {
+        cuda_device_timer.collect = collect_cuda_device_timing;
+        halide_register_device_timer(&cuda_device_timer);
+    }
+    if (num_timed_intervals == max_timed_intervals) {
+        collect_timed_intervals_already_locked(NULL);
+    }
+    timed_intervals[num_timed_intervals++] = {ctx, start, stop, is_copy};
+}
 
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
+// Host-to-device copies on a stream other than the legacy default
+// stream go through blocks of pinned host memory, so that the copy
+// proceeds asynchronously once the data has been staged. Each block
+// records an event after the copy out of it is queued, and is reused
+// once that event has completed.
+struct staging_block {
+    CUcontext context;
+    void *host;
+    CUevent event;
+    bool busy;
+};
 
-    halide_assert(user_context, validate_device_pointer(user_context, buf));
+const int num_staging_blocks = 4;
+const size_t staging_block_size = 1 << 20;
+WEAK staging_block staging_blocks[num_staging_blocks];
+WEAK int next_staging_block = 0;
+// This spinlock protects the above staging blocks.
+volatile int WEAK staging_blocks_lock = 0;
+
+// Claim a staging block for the given context, creating it if
+// necessary. Returns NULL if every block is in use, or belongs to
+// another context, in which case the caller should copy directly from
+// the source.
+WEAK staging_block *claim_staging_block(void *user_context, CUcontext ctx) {
+    staging_block *block = NULL;
+    {
+        ScopedSpinLock spinlock(&staging_blocks_lock);
+        for (int i = 0; i < num_staging_blocks && block == NULL; i++) {
+            staging_block *b = &staging_blocks[(next_staging_block + i) % num_staging_blocks];
+            if (!b->busy && (b->host == NULL || b->context == ctx)) {
+                b->busy = true;
+                block = b;
+                next_staging_block = (next_staging_block + i + 1) % num_staging_blocks;
+            }
+        }
+    }
+    if (block == NULL) {
+        return NULL;
+    }
 
-    debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
-    CUresult err = cuMemFree(dev_ptr);
-    // If cuMemFree fails, it isn't likely to succeed later, so just drop
-    // the reference.
-    buf->device_interface->impl->release_module();
-    buf->device_interface = NULL;
-    buf->device = 0;
+    CUresult err = CUDA_SUCCESS;
+    if (block->host == NULL) {
+        err = cuMemHostAlloc(&block->host, staging_block_size, CU_MEMHOSTALLOC_PORTABLE);
+        if (err == CUDA_SUCCESS) {
+            err = cuEventCreate(&block->event, CU_EVENT_DISABLE_TIMING);
+            if (err != CUDA_SUCCESS) {
+                cuMemFreeHost(block->host);
+            }
+        }
+        if (err != CUDA_SUCCESS) {
+            debug(user_context) << "    failed to create a staging block: " << get_error_name(err) << "\n";
+            block->host = NULL;
+        } else {
+            block->context = ctx;
+        }
+    }
+    if (err == CUDA_SUCCESS) {
+        // Wait for the last copy out of this block to finish. This
+        // returns immediately if the event has never been recorded.
+        err = cuEventSynchronize(block->event);
+    }
     if (err != CUDA_SUCCESS) {
-        // We may be called as a destructor, so don't raise an error here.
-        return err;
+        ScopedSpinLock spinlock(&staging_blocks_lock);
+        block->busy = false;
+        return NULL;
     }
+    return block;
+}
 
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_after = halide_current_time_ns(user_context);
-    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-    #endif
+WEAK void release_staging_block(staging_block *block) {
+    ScopedSpinLock spinlock(&staging_blocks_lock);
+    block->busy = false;
+}
 
-    return 0;
+// Free the staging blocks of a context. The context must be current.
+WEAK void free_staging_blocks(void *user_context, CUcontext ctx) {
+    ScopedSpinLock spinlock(&staging_blocks_lock);
+    for (int i = 0; i < num_staging_blocks; i++) {
+        staging_block *b = &staging_blocks[i];
+        if (b->host != NULL && b->context == ctx) {
+            halide_assert(user_context, !b->busy);
+            cuEventSynchronize(b->event);
+            cuEventDestroy(b->event);
+            cuMemFreeHost(b->host);
+            b->host = NULL;
+            b->event = NULL;
+            b->context = NULL;
+        }
+    }
 }
 
-WEAK int halide_cuda_device_release(void *user_context) {
-    debug(user_context)
-        << "CUDA: halide_cuda_device_release (user_context: " <<  user_context << ")\n";
+// Wait for the work this thread has queued on its stream, if it has
+// one. Work on the legacy default stream is already ordered with
+// respect to all other work in the context.
+WEAK CUresult flush_own_launch_queue(void *user_context, CUcontext ctx);
 
-    // If we haven't even loaded libcuda, don't load it just to quit.
-    if (!lib_cuda) {
-        return 0;
+WEAK CUresult synchronize_own_stream(void *user_context, CUcontext ctx) {
+    if (cuStreamSynchronize == NULL) {
+        return CUDA_SUCCESS;
     }
-
-    int err;
-    CUcontext ctx;
-    err = halide_cuda_acquire_context(user_context, &ctx, false);
+    CUresult err = flush_own_launch_queue(user_context, ctx);
     if (err != CUDA_SUCCESS) {
         return err;
     }
+    CUstream stream;
+    int result = halide_cuda_get_stream(user_context, ctx, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: halide_cuda_get_stream returned " << result << "\n";
+        return (CUresult)result;
+    }
+    if (stream == 0) {
+        return CUDA_SUCCESS;
+    }
+    return cuStreamSynchronize(stream);
+}
 
-    if (ctx) {
-        // It's possible that this is being called from the destructor of
-        // a static variable, in which case the driver may already be
-        // shutting down.
-        err = cuCtxPushCurrent(ctx);
+// Copy from host to device on a stream through the staging blocks.
+WEAK CUresult staged_copy_to_device(void *user_context, CUcontext ctx, CUstream stream,
+                                    CUdeviceptr dst, const uint8_t *src, size_t size) {
+    while (size > 0) {
+        staging_block *block = claim_staging_block(user_context, ctx);
+        if (block == NULL) {
+            debug(user_context) << "cuMemcpyHtoDAsync(" << (void *)dst << ", " << (void *)src << ", " << (uint64_t)size << ")\n";
+            return cuMemcpyHtoDAsync(dst, src, size, stream);
+        }
+        size_t chunk = size < staging_block_size ? size : staging_block_size;
+        memcpy(block->host, src, chunk);
+        debug(user_context) << "cuMemcpyHtoDAsync(" << (void *)dst << ", staging " << block->host << ", " << (uint64_t)chunk << ")\n";
+        CUresult err = cuMemcpyHtoDAsync(dst, block->host, chunk, stream);
+        if (err == CUDA_SUCCESS) {
+            err = cuEventRecord(block->event, stream);
+        }
+        release_staging_block(block);
         if (err != CUDA_SUCCESS) {
-            err = cuCtxSynchronize();
+            return err;
         }
-        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-
-        {
-            ScopedSpinLock spinlock(&filters_list_lock);
-
-            // Unload the modules attached to this context. Note that the list
-            // nodes themselves are not freed, only the module objects are
-            // released. Subsequent calls to halide_init_kernels might re-create
-            // the program object using the same list node to store the module
-            // object.
-            registered_filters *filters = filters_list;
-            while (filters) {
-                module_state **prev_ptr = &filters->modules;
-                module_state *loaded_module = filters->modules;
-                while (loaded_module != NULL) {
-                    if (loaded_module->context == ctx) {
-                        debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
-                        err = cuModuleUnload(loaded_module->module);
-                        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-                        *prev_ptr = loaded_module->next;
-                        free(loaded_module);
-                        loaded_module = *prev_ptr;
-                    } else {
-                        loaded_module = loaded_module->next;
-                        prev_ptr = &loaded_module->next;
-                    }
-                }
-                filters = filters->next;
-            }
-        }  // spinlock
+        dst += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    return CUDA_SUCCESS;
+}
 
-        CUcontext old_ctx;
-        cuCtxPopCurrent(&old_ctx);
+// While a pipeline runs with launch graphs enabled, its kernel launches
+// are queued instead of being issued one at a time. At the next
+// operation that depends on them (a copy, a free, a sync, or the end of
+// the pipeline), the queued launches are issued together as a CUDA
+// graph, which costs one driver call instead of one per kernel. The
+// graphs are cached by the sequence of kernels and launch shapes, and
+// replayed with updated kernel arguments when the same sequence is
+// queued again.
 
-        // Only destroy the context if we own it
+const int max_cached_launch_graphs = 16;
 
-        {
-            ScopedSpinLock spinlock(&context_lock);
+struct kernel_launch {
+    CUfunction f;
+    unsigned int grid[3];
+    unsigned int block[3];
+    unsigned int shared_mem_bytes;
+    size_t num_args;
+    size_t *arg_sizes;
+    // Pointers to copies of the argument values, NULL-terminated.
+    void **args;
+};
 
-            if (ctx == context) {
-                debug(user_context) << "    cuCtxDestroy " << context << "\n";
-                err = cuProfilerStop();
-                err = cuCtxDestroy(context);
-                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-                context = NULL;
-            }
-        }  // spinlock
-    }
+struct launch_graph {
+    CUcontext context;
+    uint64_t signature;
+    size_t num_launches;
+    // The launches whose arguments the executable graph currently has.
+    kernel_launch **launches;
+    CUgraphNode *nodes;
+    CUgraph graph;
+    CUgraphExec exec;
+    launch_graph *next;
+};
 
-    halide_cuda_release_context(user_context);
+struct launch_graph_state {
+    halide_mutex mutex;
+    // The number of pipelines running with launch graphs enabled.
+    int depth;
+    // The context of the queued launches and of done_event.
+    CUcontext context;
+    kernel_launch **queue;
+    size_t queue_size, queue_capacity;
+    // The cached graphs, most recently used first.
+    launch_graph *graphs;
+    // Recorded after each graph launch, so that work on other streams
+    // can wait for it.
+    CUevent done_event;
+    CUstream done_stream;
+};
 
-    return 0;
+WEAK launch_graph_state launch_graphs;
+
+// Copy the arguments of a launch, which only live until halide_cuda_run
+// returns.
+WEAK kernel_launch *make_kernel_launch(CUfunction f, const unsigned int grid[3], const unsigned int block[3],
+                                       unsigned int shared_mem_bytes, size_t num_args,
+                                       const size_t *arg_sizes, void **args) {
+    size_t header_size = sizeof(kernel_launch) + (num_args + 1) * sizeof(void *) + num_args * sizeof(size_t);
+    header_size = (header_size + 7) & ~(size_t)7;
+    size_t values_size = 0;
+    for (size_t i = 0; i < num_args; i++) {
+        values_size += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    uint8_t *mem = (uint8_t *)malloc(header_size + values_size);
+    if (mem == NULL) {
+        return NULL;
+    }
+    kernel_launch *launch = (kernel_launch *)mem;
+    launch->f = f;
+    for (int i = 0; i < 3; i++) {
+        launch->grid[i] = grid[i];
+        launch->block[i] = block[i];
+    }
+    launch->shared_mem_bytes = shared_mem_bytes;
+    launch->num_args = num_args;
+    launch->args = (void **)(mem + sizeof(kernel_launch));
+    launch->arg_sizes = (size_t *)(launch->args + num_args + 1);
+    uint8_t *value = mem + header_size;
+    for (size_t i = 0; i < num_args; i++) {
+        memcpy(value, args[i], arg_sizes[i]);
+        launch->args[i] = value;
+        launch->arg_sizes[i] = arg_sizes[i];
+        value += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    launch->args[num_args] = NULL;
+    return launch;
 }
 
-WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
-    debug(user_context)
-        << "CUDA: halide_cuda_device_malloc (user_context: " << user_context
-        << ", buf: " << buf << ")\n";
-
-    Context ctx(user_context);
-    if (ctx.error != CUDA_SUCCESS) {
-        return ctx.error;
+WEAK bool same_launch_shape(const kernel_launch *a, const kernel_launch *b) {
+    if (a->f != b->f ||
+        a->shared_mem_bytes != b->shared_mem_bytes ||
+        a->num_args != b->num_args) {
+        return false;
     }
-
-    size_t size = buf->size_in_bytes();
-    halide_assert(user_context, size != 0);
-    if (buf->device) {
-        // This buffer already has a device allocation
-        halide_assert(user_context, validate_device_pointer(user_context, buf, size));
-        return 0;
+    for (int i = 0; i < 3; i++) {
+        if (a->grid[i] != b->grid[i] || a->block[i] != b->block[i]) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a->num_args; i++) {
+        if (a->arg_sizes[i] != b->arg_sizes[i]) {
+            return false;
+        }
     }
+    return true;
+}
 
-    // Check all strides positive.
-    for (int i = 0; i < buf->dimensions; i++) {
-        halide_assert(user_context, buf->dim[i].stride >= 0);
+WEAK bool same_launch_args(const kernel_launch *a, const kernel_launch *b) {
+    for (size_t i = 0; i < a->num_args; i++) {
+        if (memcmp(a->args[i], b->args[i], a->arg_sizes[i]) != 0) {
+            return false;
+        }
     }
+    return true;
+}
 
-    debug(user_context) << "    allocating " << *buf << "\n";
+// A hash of the kernels and launch shapes of a sequence of launches.
+WEAK uint64_t launch_signature(kernel_launch **launches, size_t num_launches) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < num_launches; i++) {
+        const kernel_launch *l = launches[i];
+        uint64_t values[] = {(uint64_t)l->f, l->grid[0], l->grid[1], l->grid[2],
+                             l->block[0], l->block[1], l->block[2],
+                             l->shared_mem_bytes, l->num_args};
+        for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); j++) {
+            h = (h ^ values[j]) * 0x100000001b3ULL;
+        }
+    }
+    return h;
+}
 
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
+WEAK void kernel_node_params(const kernel_launch *l, CUDA_KERNEL_NODE_PARAMS *params) {
+    params->func = l->f;
+    params->gridDimX = l->grid[0];
+    params->gridDimY = l->grid[1];
+    params->gridDimZ = l->grid[2];
+    params->blockDimX = l->block[0];
+    params->blockDimY = l->block[1];
+    params->blockDimZ = l->block[2];
+    params->sharedMemBytes = l->shared_mem_bytes;
+    params->kernelParams = l->args;
+    params->extra = NULL;
+}
 
-    CUdeviceptr p;
-    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
-    CUresult err = cuMemAlloc(&p, size);
+WEAK void destroy_launch_graph(launch_graph *g) {
+    if (g->exec) {
+        cuGraphExecDestroy(g->exec);
+    }
+    if (g->graph) {
+        cuGraphDestroy(g->graph);
+    }
+    for (size_t i = 0; i < g->num_launches; i++) {
+        free(g->launches[i]);
+    }
+    free(g->launches);
+    free(g->nodes);
+    free(g);
+}
+
+// Build and instantiate a graph that runs the launches one after the
+// other, as they would have run on a stream. On success the graph owns
+// the launches.
+WEAK launch_graph *build_launch_graph(void *user_context, CUcontext ctx, uint64_t signature,
+                                      kernel_launch **launches, size_t num_launches) {
+    launch_graph *g = (launch_graph *)malloc(sizeof(launch_graph));
+    if (g == NULL) {
+        return NULL;
+    }
+    memset(g, 0, sizeof(launch_graph));
+    g->context = ctx;
+    g->signature = signature;
+    g->launches = (kernel_launch **)malloc(num_launches * sizeof(kernel_launch *));
+    g->nodes = (CUgraphNode *)malloc(num_launches * sizeof(CUgraphNode));
+    CUresult err = CUDA_ERROR_OUT_OF_MEMORY;
+    if (g->launches && g->nodes) {
+        err = cuGraphCreate(&g->graph, 0);
+    }
+    for (size_t i = 0; err == CUDA_SUCCESS && i < num_launches; i++) {
+        CUDA_KERNEL_NODE_PARAMS params;
+        kernel_node_params(launches[i], &params);
+        err = cuGraphAddKernelNode(&g->nodes[i], g->graph, i > 0 ? &g->nodes[i - 1] : NULL, i > 0 ? 1 : 0, &params);
+    }
+    if (err == CUDA_SUCCESS) {
+        err = cuGraphInstantiate(&g->exec, g->graph, NULL, NULL, 0);
+    }
+    if (err != CUDA_SUCCESS) {
+        debug(user_context) << "    building a graph of " << (uint64_t)num_launches
+                            << " launches failed: " << get_error_name(err) << "\n";
+        destroy_launch_graph(g);
+        return NULL;
+    }
+    for (size_t i = 0; i < num_launches; i++) {
+        g->launches[i] = launches[i];
+    }
+    g->num_launches = num_launches;
+    debug(user_context) << "    built a graph of " << (uint64_t)num_launches << " launches\n";
+    return g;
+}
+
+// Give a cached graph the arguments of a sequence of launches of the
+// same shape. On success the graph owns the new launches and the old
+// ones are freed. On failure the launches are left as they were.
+WEAK bool update_launch_graph(void *user_context, launch_graph *g, kernel_launch **launches) {
+    size_t updated = 0;
+    for (size_t i = 0; i < g->num_launches; i++) {
+        if (!same_launch_args(g->launches[i], launches[i])) {
+            CUresult err = CUDA_ERROR_NOT_SUPPORTED;
+            if (cuGraphExecKernelNodeSetParams != NULL) {
+                CUDA_KERNEL_NODE_PARAMS params;
+                kernel_node_params(launches[i], &params);
+                err = cuGraphExecKernelNodeSetParams(g->exec, g->nodes[i], &params);
+            }
+            if (err != CUDA_SUCCESS) {
+                debug(user_context) << "    updating a graph failed: " << get_error_name(err) << "\n";
+                // Give back the launches already swapped in below.
+                for (size_t j = 0; j < i; j++) {
+                    kernel_launch *l = g->launches[j];
+                    g->launches[j] = launches[j];
+                    launches[j] = l;
+                }
+                return false;
+            }
+            updated++;
+        }
+        kernel_launch *l = g->launches[i];
+        g->launches[i] = launches[i];
+        launches[i] = l;
+    }
+    for (size_t i = 0; i < g->num_launches; i++) {
+        free(launches[i]);
+    }
+    debug(user_context) << "    replaying a graph of " << (uint64_t)g->num_launches
+                        << " launches with " << (uint64_t)updated << " updated\n";
+    return true;
+}
+
+// Issue the queued launches on the given stream, or if nothing is
+// queued, make the stream wait for the last graph issued on another
+// stream. The context must be current.
+WEAK CUresult flush_launch_queue(void *user_context, CUcontext ctx, CUstream stream) {
+    ScopedMutexLock lock(&launch_graphs.mutex);
+    launch_graph_state &state = launch_graphs;
+    if (state.queue_size == 0) {
+        if (state.done_event != NULL && state.context == ctx && state.done_stream != stream) {
+            return cuStreamWaitEvent(stream, state.done_event, 0);
+        }
+        return CUDA_SUCCESS;
+    }
+    halide_assert(user_context, state.context == ctx);
+
+    size_t num_launches = state.queue_size;
+    kernel_launch **launches = state.queue;
+    state.queue_size = 0;
+    uint64_t signature = launch_signature(launches, num_launches);
+
+    // Look for a cached graph of the same sequence of launches.
+    launch_graph **prev_ptr = &state.graphs;
+    launch_graph *g = state.graphs;
+    while (g) {
+        if (g->context == ctx && g->signature == signature && g->num_launches == num_launches) {
+            bool match = true;
+            for (size_t i = 0; match && i < num_launches; i++) {
+                match = same_launch_shape(g->launches[i], launches[i]);
+            }
+            if (match) {
+                break;
+            }
+        }
+        prev_ptr = &g->next;
+        g = g->next;
+    }
+
+    if (g) {
+        *prev_ptr = g->next;
+        if (!update_launch_graph(user_context, g, launches)) {
+            destroy_launch_graph(g);
+            g = NULL;
+        }
+    }
+
+    if (g == NULL) {
+        g = build_launch_graph(user_context, ctx, signature, launches, num_launches);
+        if (g == NULL) {
+            // Fall back to launching the kernels one at a time.
+            CUresult err = CUDA_SUCCESS;
+            CUevent timing_start = begin_timed_interval(stream);
+            for (size_t i = 0; i < num_launches; i++) {
+                const kernel_launch *l = launches[i];
+                if (err == CUDA_SUCCESS) {
+                    err = cuLaunchKernel(l->f, l->grid[0], l->grid[1], l->grid[2],
+                                         l->block[0], l->block[1], l->block[2],
+                                         l->shared_mem_bytes, stream, l->args, NULL);
+                }
+                free(launches[i]);
+            }
+            end_timed_interval(ctx, stream, timing_start, false);
+            return err;
+        }
+
+        // Evict the least recently used graphs if we have too many.
+        int count = 1;
+        launch_graph **p = &state.graphs;
+        while (*p) {
+            if (++count > max_cached_launch_graphs) {
+                launch_graph *evicted = *p;
+                *p = evicted->next;
+                destroy_launch_graph(evicted);
+            } else {
+                p = &(*p)->next;
+            }
+        }
+    }
+
+    g->next = state.graphs;
+    state.graphs = g;
+
+    debug(user_context) << "    cuGraphLaunch " << (uint64_t)num_launches << " launches on stream " << stream << "\n";
+    CUevent timing_start = begin_timed_interval(stream);
+    CUresult err = cuGraphLaunch(g->exec, stream);
+    end_timed_interval(ctx, stream, timing_start, false);
+    if (err == CUDA_SUCCESS && state.done_event == NULL) {
+        err = cuEventCreate(&state.done_event, CU_EVENT_DISABLE_TIMING);
+    }
+    if (err == CUDA_SUCCESS) {
+        err = cuEventRecord(state.done_event, stream);
+        state.done_stream = stream;
+    }
+    return err;
+}
+
+// Queue a launch if a pipeline is running with launch graphs
+// enabled. Returns false if the caller should launch the kernel itself.
+WEAK bool queue_kernel_launch(CUcontext ctx, CUfunction f, const unsigned int grid[3], const unsigned int block[3],
+                              unsigned int shared_mem_bytes, size_t num_args,
+                              const size_t *arg_sizes, void **args) {
+    if (cuGraphCreate == NULL) {
+        return false;
+    }
+    ScopedMutexLock lock(&launch_graphs.mutex);
+    launch_graph_state &state = launch_graphs;
+    if (state.depth == 0) {
+        return false;
+    }
+    if (state.context != ctx) {
+        // Launches in another context are independent of the queued
+        // ones, so don't bother batching them.
+        if (state.queue_size > 0) {
+            return false;
+        }
+        if (state.done_event != NULL) {
+            cuEventDestroy(state.done_event);
+            state.done_event = NULL;
+        }
+        state.context = ctx;
+    }
+    if (state.queue_size == state.queue_capacity) {
+        size_t new_capacity = state.queue_capacity ? state.queue_capacity * 2 : 64;
+        kernel_launch **new_queue = (kernel_launch **)malloc(new_capacity * sizeof(kernel_launch *));
+        if (new_queue == NULL) {
+            return false;
+        }
+        if (state.queue_size > 0) {
+            memcpy(new_queue, state.queue, state.queue_size * sizeof(kernel_launch *));
+        }
+        free(state.queue);
+        state.queue = new_queue;
+        state.queue_capacity = new_capacity;
+    }
+    kernel_launch *launch = make_kernel_launch(f, grid, block, shared_mem_bytes, num_args, arg_sizes, args);
+    if (launch == NULL) {
+        return false;
+    }
+    state.queue[state.queue_size++] = launch;
+    return true;
+}
+
+// Issue the queued launches on this thread's stream, before doing
+// something that depends on them. The context must be current.
+WEAK CUresult flush_own_launch_queue(void *user_context, CUcontext ctx) {
+    if (cuGraphCreate == NULL || !use_launch_graphs()) {
+        return CUDA_SUCCESS;
+    }
+    CUstream stream = 0;
+    int result = halide_cuda_get_stream(user_context, ctx, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: halide_cuda_get_stream returned " << result << "\n";
+        return (CUresult)result;
+    }
+    CUresult err = flush_launch_queue(user_context, ctx, stream);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: launching queued kernels failed: "
+                            << get_error_name(err);
+    }
+    return err;
+}
+
+// Drop the graphs and queued launches of a context that is being
+// released. The context must be current.
+WEAK void release_launch_graphs(CUcontext ctx) {
+    ScopedMutexLock lock(&launch_graphs.mutex);
+    launch_graph_state &state = launch_graphs;
+    launch_graph **prev_ptr = &state.graphs;
+    while (*prev_ptr) {
+        launch_graph *g = *prev_ptr;
+        if (g->context == ctx) {
+            *prev_ptr = g->next;
+            destroy_launch_graph(g);
+        } else {
+            prev_ptr = &g->next;
+        }
+    }
+    if (state.context == ctx) {
+        for (size_t i = 0; i < state.queue_size; i++) {
+            free(state.queue[i]);
+        }
+        state.queue_size = 0;
+        if (state.done_event != NULL) {
+            cuEventDestroy(state.done_event);
+            state.done_event = NULL;
+        }
+        state.context = NULL;
+    }
+}
+
+// Load the kernel code of a filter into the current context. The
+// filters_list_lock must be held.
+WEAK CUresult load_module(void *user_context, registered_filters *filters, CUcontext ctx,
+                          module_state **result) {
+    module_state *loaded_module = (module_state *)malloc(sizeof(module_state));
+    debug(user_context) <<  "    cuModuleLoadData " << (void *)filters->src << ", " << filters->size << " -> ";
+
+    CUjit_option options[] = { CU_JIT_MAX_REGISTERS };
+    unsigned int max_regs_per_thread = 64;
+
+    // A hack to enable control over max register count for
+    // testing. This should be surfaced in the schedule somehow
+    // instead.
+    char *regs = getenv("HL_CUDA_JIT_MAX_REGISTERS");
+    if (regs) {
+        max_regs_per_thread = atoi(regs);
+    }
+    void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
+    // The source is either ptx, or with the cuda_fatbin target
+    // feature, a fatbin. The driver only JIT compiles the
+    // latter if it has no SASS for the device.
+    CUresult err = cuModuleLoadDataEx(&loaded_module->module, filters->src, 1, options, optionValues);
+
+    if (err != CUDA_SUCCESS) {
+        free(loaded_module);
+        error(user_context) << "CUDA: cuModuleLoadData failed: "
+                            << get_error_name(err);
+        return err;
+    } else {
+        debug(user_context) << (void *)(loaded_module->module) << "\n";
+    }
+    loaded_module->context = ctx;
+    loaded_module->next = filters->modules;
+    filters->modules = loaded_module;
+    *result = loaded_module;
+    return CUDA_SUCCESS;
+}
+
+// Synchronize a context, and release the modules, graphs, cached
+// allocations, texture objects, and staging blocks made in it.
+WEAK void release_context_resources(void *user_context, CUcontext ctx) {
+    // It's possible that this is being called from the destructor of
+    // a static variable, in which case the driver may already be
+    // shutting down.
+    CUresult err = cuCtxPushCurrent(ctx);
+    if (err != CUDA_SUCCESS) {
+        err = cuCtxSynchronize();
+    }
+    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+
+    // The graphs refer to the modules unloaded below.
+    release_launch_graphs(ctx);
+
+    {
+        ScopedSpinLock spinlock(&filters_list_lock);
+
+        // Unload the modules attached to this context. Note that the list
+        // nodes themselves are not freed, only the module objects are
+        // released. Subsequent calls to halide_init_kernels might re-create
+        // the program object using the same list node to store the module
+        // object.
+        registered_filters *filters = filters_list;
+        while (filters) {
+            module_state **prev_ptr = &filters->modules;
+            module_state *loaded_module = filters->modules;
+            while (loaded_module != NULL) {
+                if (loaded_module->context == ctx) {
+                    debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
+                    err = cuModuleUnload(loaded_module->module);
+                    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                    *prev_ptr = loaded_module->next;
+                    free(loaded_module);
+                    loaded_module = *prev_ptr;
+                } else {
+                    loaded_module = loaded_module->next;
+                    prev_ptr = &loaded_module->next;
+                }
+            }
+            filters = filters->next;
+        }
+    }  // spinlock
+
+    // Return the cached allocations made in this context to the driver.
+    device_allocation_cache_release(user_context, &allocation_cache, ctx, free_cached_allocation);
+    if (cuTexObjectDestroy != NULL) {
+        release_textures(user_context, ctx, 0, 0);
+    }
+    free_staging_blocks(user_context, ctx);
+    {
+        ScopedMutexLock lock(&timed_intervals_mutex);
+        collect_timed_intervals_already_locked(ctx);
+    }
+
+    CUcontext old_ctx;
+    cuCtxPopCurrent(&old_ctx);
+}
+
+}}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, const char* ptx_src, int size) {
+    debug(user_context) << "CUDA: halide_cuda_initialize_kernels (user_context: " << user_context
+                        << ", state_ptr: " << state_ptr
+                        << ", ptx_src: " << (void *)ptx_src
+                        << ", size: " << size << "\n";
+
+    Context ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+
+    halide_assert(user_context, &filters_list_lock != NULL);
+    {
+        ScopedSpinLock spinlock(&filters_list_lock);
+
+        // Create the state object if necessary. This only happens once, regardless
+        // of how many times halide_initialize_kernels/halide_release is called.
+        // halide_release traverses this list and releases the module objects, but
+        // it does not modify the list nodes created/inserted here.
+        registered_filters **filters = (registered_filters**)state_ptr;
+        if (!(*filters)) {
+            *filters = (registered_filters*)malloc(sizeof(registered_filters));
+            (*filters)->modules = NULL;
+            (*filters)->next = filters_list;
+            filters_list = *filters;
+        }
+        (*filters)->src = ptx_src;
+        (*filters)->size = size;
+
+        // Create the module itself if necessary.
+        module_state *loaded_module = find_module_for_context(*filters, ctx.context);
+        if (loaded_module == NULL) {
+            CUresult err = load_module(user_context, *filters, ctx.context, &loaded_module);
+            if (err != CUDA_SUCCESS) {
+                return err;
+            }
+        }
+    }  // spinlock
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t* buf) {
+    // halide_device_free, at present, can be exposed to clients and they
+    // should be allowed to call halide_device_free on any halide_buffer_t
+    // including ones that have never been used with a GPU.
+    if (buf->device == 0) {
+        return 0;
+    }
+
+    CUdeviceptr dev_ptr = (CUdeviceptr)buf->device;
+
+    debug(user_context)
+        <<  "CUDA: halide_cuda_device_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    if (is_mapped_buffer(buf)) {
+        // The device view of a mapped host allocation is released
+        // along with the host allocation, by
+        // halide_cuda_device_and_host_free.
+        debug(user_context) << "    dropping device view " << (void *)dev_ptr << " of mapped host memory\n";
+        buf->device_interface->impl->release_module();
+        buf->device_interface = NULL;
+        buf->device = 0;
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS)
+        return ctx.error;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    halide_assert(user_context, validate_device_pointer(user_context, buf));
+
+    // Queued kernels may still use the allocation.
+    CUresult err = flush_own_launch_queue(user_context, ctx.context);
+    if (err != CUDA_SUCCESS) {
+        return err;
+    }
+
+    CUdeviceptr base;
+    size_t allocation_size;
+    if (halide_can_reuse_device_allocations(user_context) &&
+        // The allocation may be handed to another thread, so wait for
+        // the work queued on this thread's stream to finish with it.
+        synchronize_own_stream(user_context, ctx.context) == CUDA_SUCCESS &&
+        cuMemGetAddressRange(&base, &allocation_size, dev_ptr) == CUDA_SUCCESS &&
+        base == dev_ptr &&
+        device_allocation_cache_put(user_context, &allocation_cache, ctx.context,
+                                    allocation_size, (uint64_t)dev_ptr)) {
+        debug(user_context) << "    caching allocation " << (void *)(dev_ptr)
+                            << " of " << (uint64_t)allocation_size << " bytes\n";
+    } else {
+        err = free_device_memory(user_context, ctx.context, dev_ptr);
+    }
+    // If cuMemFree fails, it isn't likely to succeed later, so just drop
+    // the reference.
+    buf->device_interface->impl->release_module();
+    buf->device_interface = NULL;
+    buf->device = 0;
+    if (err != CUDA_SUCCESS) {
+        // We may be called as a destructor, so don't raise an error here.
+        return err;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_cuda_device_release(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_device_release (user_context: " <<  user_context << ")\n";
+
+    // If we haven't even loaded libcuda, don't load it just to quit.
+    if (!lib_cuda) {
+        return 0;
+    }
+
+    int err;
+    CUcontext ctx;
+    err = halide_cuda_acquire_context(user_context, &ctx, false);
+    if (err != CUDA_SUCCESS) {
+        return err;
+    }
+
+    if (ctx) {
+        // The contexts of the other devices are always ours.
+        {
+            ScopedSpinLock spinlock(&multi_device_lock);
+            for (int i = 0; i < num_multi_device_contexts; i++) {
+                CUcontext c = multi_device_contexts[i];
+                release_context_resources(user_context, c);
+                debug(user_context) << "    cuCtxDestroy " << c << "\n";
+                err = cuCtxDestroy(c);
+                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                multi_device_contexts[i] = NULL;
+            }
+            num_multi_device_contexts = 0;
+        }  // spinlock
+
+        release_context_resources(user_context, ctx);
+
+        // Only destroy the context if we own it
+
+        {
+            ScopedSpinLock spinlock(&context_lock);
+
+            if (ctx == context) {
+                debug(user_context) << "    cuCtxDestroy " << context << "\n";
+                err = cuProfilerStop();
+                err = cuCtxDestroy(context);
+                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                context = NULL;
+            }
+        }  // spinlock
+    }
+
+    halide_cuda_release_context(user_context);
+
+    return 0;
+}
+
+WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
+    debug(user_context)
+        << "CUDA: halide_cuda_device_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    size_t size = buf->size_in_bytes();
+    halide_assert(user_context, size != 0);
+    if (buf->device) {
+        // This buffer already has a device allocation
+        halide_assert(user_context, validate_device_pointer(user_context, buf, size));
+        return 0;
+    }
+
+    // Check all strides positive.
+    for (int i = 0; i < buf->dimensions; i++) {
+        halide_assert(user_context, buf->dim[i].stride >= 0);
+    }
+
+    debug(user_context) << "    allocating " << *buf << "\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    CUdeviceptr p;
+    CUresult err = CUDA_SUCCESS;
+    bool reused = false;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        device_allocation_cache_register(&allocation_cache, halide_cuda_release_unused_device_allocations);
+        size = device_allocation_size_class(size);
+        uint64_t handle;
+        reused = device_allocation_cache_take(&allocation_cache, ctx.context, size, &handle);
+        p = (CUdeviceptr)handle;
+    }
+    if (reused) {
+        debug(user_context) << "    reusing cached allocation " << (void *)p << "\n";
+    } else {
+        debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
+        err = cuMemAlloc(&p, size);
+        if (err == CUDA_ERROR_OUT_OF_MEMORY &&
+            !device_allocation_cache_empty(&allocation_cache)) {
+            // Return the unused allocations to the driver and try again.
+            device_allocation_cache_release(user_context, &allocation_cache, ctx.context, free_cached_allocation);
+            err = cuMemAlloc(&p, size);
+        }
+    }
     if (err != CUDA_SUCCESS) {
         debug(user_context) << get_error_name(err) << "\n";
         error(user_context) << "CUDA: cuMemAlloc failed: "
                             << get_error_name(err);
         return err;
-    } else {
+    } else if (!reused) {
         debug(user_context) << (void *)p << "\n";
     }
     halide_assert(user_context, p);
@@ -698,24 +1711,95 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 }
 
 namespace {
-WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
-                                       uint64_t src, uint64_t dst, int d, bool from_host, bool to_host) {
+WEAK int cuda_do_multidimensional_copy(void *user_context, CUcontext ctx, CUstream stream, bool pinned_host,
+                                       const device_copy &c,
+                                       uint64_t src, uint64_t dst, int d, int rect_dims,
+                                       bool from_host, bool to_host) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
+    } else if (d == rect_dims && d > 0) {
+        // Copy a rectangle of rows, or a stack of them, in one call.
+        CUDA_MEMCPY3D copy;
+        memset(&copy, 0, sizeof(copy));
+        if (from_host) {
+            copy.srcMemoryType = CU_MEMORYTYPE_HOST;
+            copy.srcHost = (const void *)src;
+        } else {
+            copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+            copy.srcDevice = (CUdeviceptr)src;
+        }
+        if (to_host) {
+            copy.dstMemoryType = CU_MEMORYTYPE_HOST;
+            copy.dstHost = (void *)dst;
+        } else {
+            copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+            copy.dstDevice = (CUdeviceptr)dst;
+        }
+        copy.srcPitch = c.src_stride_bytes[0];
+        copy.dstPitch = c.dst_stride_bytes[0];
+        copy.WidthInBytes = c.chunk_size;
+        copy.Height = c.extent[0];
+        if (d == 2) {
+            copy.srcHeight = c.src_stride_bytes[1] / c.src_stride_bytes[0];
+            copy.dstHeight = c.dst_stride_bytes[1] / c.dst_stride_bytes[0];
+            copy.Depth = c.extent[1];
+        } else {
+            copy.srcHeight = copy.dstHeight = copy.Height;
+            copy.Depth = 1;
+        }
+
+        debug(user_context) << "    from " << (from_host ? "host" : "device")
+                            << " to " << (to_host ? "host" : "device") << ", "
+                            << (void *)src << " -> " << (void *)dst << ", "
+                            << (uint64_t)copy.Depth << " x " << (uint64_t)copy.Height << " rows of "
+                            << c.chunk_size << " bytes\n";
+        CUresult err;
+        if (stream != 0) {
+            err = cuMemcpy3DAsync(&copy, stream);
+        } else {
+            err = cuMemcpy3D(&copy);
+        }
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuMemcpy3D failed: " << get_error_name(err);
+            return (int)err;
+        }
     } else if (d == 0) {
         CUresult err = CUDA_SUCCESS;
-        const char *copy_name;
+        const char *copy_name = "memcpy";
         debug(user_context) << "    from " << (from_host ? "host" : "device")
                             << " to " << (to_host ? "host" : "device") << ", "
                             << (void *)src << " -> " << (void *)dst << ", " << c.chunk_size << " bytes\n";
-        if (!from_host && to_host) {
+        if (stream != 0 && from_host != to_host) {
+            // Copies on a stream of our own are queued behind the
+            // kernels on that stream. The caller synchronizes with the
+            // stream before the host reads the result.
+            if (to_host) {
+                copy_name = "cuMemcpyDtoHAsync";
+                debug(user_context) << "cuMemcpyDtoHAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+                err = cuMemcpyDtoHAsync((void *)dst, (CUdeviceptr)src, c.chunk_size, stream);
+            } else if (pinned_host) {
+                copy_name = "cuMemcpyHtoDAsync";
+                debug(user_context) << "cuMemcpyHtoDAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+                err = cuMemcpyHtoDAsync((CUdeviceptr)dst, (void *)src, c.chunk_size, stream);
+            } else {
+                copy_name = "cuMemcpyHtoDAsync";
+                err = staged_copy_to_device(user_context, ctx, stream, (CUdeviceptr)dst, (const uint8_t *)src, c.chunk_size);
+            }
+        } else if (stream != 0 && !from_host && !to_host) {
+            copy_name = "cuMemcpyDtoDAsync";
+            debug(user_context) << "cuMemcpyDtoDAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+            err = cuMemcpyDtoDAsync((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size, stream);
+        } else if (!from_host && to_host) {
+            copy_name = "cuMemcpyDtoH";
             debug(user_context) << "cuMemcpyDtoH(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
             err = cuMemcpyDtoH((void *)dst, (CUdeviceptr)src, c.chunk_size);
         } else if (from_host && !to_host) {
+            copy_name = "cuMemcpyHtoD";
             debug(user_context) << "cuMemcpyHtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
             err = cuMemcpyHtoD((CUdeviceptr)dst, (void *)src, c.chunk_size);
         } else if (!from_host && !to_host) {
+            copy_name = "cuMemcpyDtoD";
             debug(user_context) << "cuMemcpyDtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
             err = cuMemcpyDtoD((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size);
         } else if (dst != src) {
@@ -732,7 +1816,8 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d-1]; i++) {
-            int err = cuda_do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host);
+            int err = cuda_do_multidimensional_copy(user_context, ctx, stream, pinned_host, c, src + src_off, dst + dst_off,
+                                                    d - 1, rect_dims, from_host, to_host);
             dst_off += c.dst_stride_bytes[d-1];
             src_off += c.src_stride_bytes[d-1];
             if (err) {
@@ -758,6 +1843,37 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         return halide_error_code_incompatible_device_interface;
     }
 
+    if (src == dst && is_mapped_buffer(src)) {
+        // The host and device views share memory. Copying to the host
+        // only needs to wait for the kernels writing to it.
+        if (!dst_device_interface) {
+            Context ctx(user_context);
+            if (ctx.error != CUDA_SUCCESS) {
+                return ctx.error;
+            }
+            debug(user_context)
+                << "CUDA: halide_cuda_buffer_copy of mapped buffer " << src << " (user_context: " << user_context << ")\n";
+            if (flush_own_launch_queue(user_context, ctx.context) != CUDA_SUCCESS) {
+                return halide_error_code_device_buffer_copy_failed;
+            }
+            CUstream stream = 0;
+            if (cuStreamSynchronize != NULL) {
+                int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+                if (result != 0) {
+                    error(user_context) << "CUDA: In halide_cuda_buffer_copy, halide_cuda_get_stream returned " << result << "\n";
+                    return result;
+                }
+            }
+            CUresult err = (stream != 0) ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+            if (err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: synchronizing mapped buffer failed: "
+                                    << get_error_name(err);
+                return err;
+            }
+        }
+        return 0;
+    }
+
     bool from_host = (src->device_interface != &cuda_device_interface) ||
                      (src->device == 0) ||
                      (src->host_dirty() && src->host != NULL);
@@ -779,6 +1895,12 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
             << "CUDA: halide_cuda_buffer_copy (user_context: " << user_context
             << ", src: " << src << ", dst: " << dst << ")\n";
 
+        // The copy may read the results of queued kernels, or
+        // overwrite what they read.
+        if (flush_own_launch_queue(user_context, ctx.context) != CUDA_SUCCESS) {
+            return halide_error_code_device_buffer_copy_failed;
+        }
+
         #ifdef DEBUG_RUNTIME
         uint64_t t_before = halide_current_time_ns(user_context);
         if (!from_host) {
@@ -789,7 +1911,35 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         }
         #endif
 
-        err = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host);
+        CUstream stream = NULL;
+        if (cuStreamSynchronize != NULL) {
+            int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+            if (result != 0) {
+                error(user_context) << "CUDA: In halide_cuda_buffer_copy, halide_cuda_get_stream returned " << result << "\n";
+            }
+        }
+
+        bool pinned_host = ((from_host && is_pinned_host_memory((const uint8_t *)c.src)) ||
+                            (to_host && is_pinned_host_memory((const uint8_t *)c.dst)));
+        // Strided copies go to the driver a rectangle at a time, unless
+        // they are staged through pinned memory, or don't touch the
+        // device at all.
+        bool staged = stream != 0 && from_host && !to_host && !pinned_host;
+        int rect_dims = (staged || (from_host && to_host)) ? 0 : rect_copy_dims(c);
+        CUevent timing_start = begin_timed_interval(stream);
+        err = cuda_do_multidimensional_copy(user_context, ctx.context, stream, pinned_host, c, c.src + c.src_begin, c.dst,
+                                            dst->dimensions, rect_dims, from_host, to_host);
+        end_timed_interval(ctx.context, stream, timing_start, true);
+
+        if (err == 0 && stream != 0 && to_host) {
+            // The host may read the result as soon as we return.
+            CUresult sync_err = cuStreamSynchronize(stream);
+            if (sync_err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuStreamSynchronize failed: "
+                                    << get_error_name(sync_err);
+                err = sync_err;
+            }
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -866,7 +2016,10 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUresult err;
+    CUresult err = flush_own_launch_queue(user_context, ctx.context);
+    if (err != CUDA_SUCCESS) {
+        return err;
+    }
     if (cuStreamSynchronize != NULL) {
         CUstream stream;
         int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -891,6 +2044,66 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     return 0;
 }
 
+WEAK int halide_cuda_stream_fence(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_stream_fence (user_context: " << user_context << ")\n";
+
+    // Nothing was queued if we haven't even loaded libcuda.
+    if (cuStreamSynchronize == NULL) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    CUresult err = synchronize_own_stream(user_context, ctx.context);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuStreamSynchronize failed: "
+                            << get_error_name(err);
+        return err;
+    }
+    return 0;
+}
+
+WEAK int halide_cuda_launch_graph_begin(void *user_context) {
+    if (use_launch_graphs()) {
+        ScopedMutexLock lock(&launch_graphs.mutex);
+        launch_graphs.depth++;
+    }
+    return 0;
+}
+
+WEAK int halide_cuda_launch_graph_flush(void *user_context) {
+    // Nothing was queued if we haven't even loaded libcuda.
+    if (cuGraphCreate == NULL) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    return flush_own_launch_queue(user_context, ctx.context);
+}
+
+WEAK void halide_cuda_launch_graph_end(void *user_context, void *obj) {
+    bool flush = false;
+    {
+        ScopedMutexLock lock(&launch_graphs.mutex);
+        if (launch_graphs.depth > 0 && --launch_graphs.depth == 0) {
+            flush = launch_graphs.queue_size > 0;
+        }
+    }
+    if (flush) {
+        // We are called as a destructor, so the error has already been
+        // reported by the time we return.
+        halide_cuda_launch_graph_flush(user_context);
+    }
+}
+
 WEAK int halide_cuda_run(void *user_context,
                          void *state_ptr,
                          const char* entry_name,
@@ -925,7 +2138,20 @@ WEAK int halide_cuda_run(void *user_context,
     #endif
 
     halide_assert(user_context, state_ptr);
-    module_state *loaded_module = find_module_for_context((registered_filters *)state_ptr, ctx.context);
+    module_state *loaded_module = NULL;
+    {
+        ScopedSpinLock spinlock(&filters_list_lock);
+        registered_filters *filters = (registered_filters *)state_ptr;
+        loaded_module = find_module_for_context(filters, ctx.context);
+        if (loaded_module == NULL && current_multi_device_context() != NULL) {
+            // The first launch on another device of a loop distributed
+            // across devices.
+            err = load_module(user_context, filters, ctx.context, &loaded_module);
+            if (err != CUDA_SUCCESS) {
+                return err;
+            }
+        }
+    }  // spinlock
     halide_assert(user_context, loaded_module != NULL);
     CUmodule mod = loaded_module->module;
     debug(user_context) << "Got module " << mod << "\n";
@@ -964,6 +2190,16 @@ WEAK int halide_cuda_run(void *user_context,
         }
     }
 
+    unsigned int grid[3] = {(unsigned int)blocksX, (unsigned int)blocksY, (unsigned int)blocksZ};
+    unsigned int block[3] = {(unsigned int)threadsX, (unsigned int)threadsY, (unsigned int)threadsZ};
+    if (queue_kernel_launch(ctx.context, f, grid, block, shared_mem_bytes,
+                            num_args, arg_sizes, translated_args)) {
+        debug(user_context) << "    queued launch for a graph\n";
+        free(dev_handles);
+        free(translated_args);
+        return 0;
+    }
+
     CUstream stream = NULL;
     // We use whether this routine was defined in the cuda driver library
     // as a test for streams support in the cuda implementation.
@@ -974,6 +2210,10 @@ WEAK int halide_cuda_run(void *user_context,
         }
     }
 
+    // The launch is asynchronous, so this only records the time the
+    // host spends issuing it.
+    uint64_t t_begin = halide_timeline_begin();
+    CUevent timing_start = begin_timed_interval(stream);
     err = cuLaunchKernel(f,
                          blocksX,  blocksY,  blocksZ,
                          threadsX, threadsY, threadsZ,
@@ -981,6 +2221,9 @@ WEAK int halide_cuda_run(void *user_context,
                          stream,
                          translated_args,
                          NULL);
+    end_timed_interval(ctx.context, stream, timing_start, false);
+    halide_timeline_end(entry_name, "gpu", t_begin, blocksX * blocksY * blocksZ,
+                        threadsX * threadsY * threadsZ);
     free(dev_handles);
     free(translated_args);
     if (err != CUDA_SUCCESS) {
@@ -1002,12 +2245,282 @@ WEAK int halide_cuda_run(void *user_context,
     return 0;
 }
 
+WEAK void halide_cuda_set_multi_device_count(int count) {
+    ScopedSpinLock spinlock(&multi_device_lock);
+    multi_device_count_limit = count;
+    multi_device_count_limit_initialized = true;
+}
+
+WEAK int halide_cuda_multi_device_count(void *user_context) {
+    int limit = get_multi_device_count_limit();
+
+    // Errors surface in halide_cuda_multi_device_begin instead.
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return 1;
+    }
+    int count = 0;
+    if (cuDeviceGetCount(&count) != CUDA_SUCCESS) {
+        return 1;
+    }
+    if (limit > 0 && limit < count) {
+        count = limit;
+    }
+    return max(1, min(count, max_multi_device_contexts + 1));
+}
+
+WEAK int halide_cuda_multi_device_begin(void *user_context, int index) {
+    debug(user_context)
+        << "CUDA: halide_cuda_multi_device_begin (user_context: " << user_context
+        << ", index: " << index << ")\n";
+
+    if (index == 0) {
+        // The first chunk runs in the main context.
+        return 0;
+    }
+    halide_assert(user_context, index > 0 && index <= max_multi_device_contexts);
+
+    CUcontext multi_device_context = NULL;
+    {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+
+        ScopedSpinLock spinlock(&multi_device_lock);
+        while (num_multi_device_contexts < index) {
+            // The devices other than the main context's, in order.
+            CUdevice main_device;
+            CUresult err = cuCtxGetDevice(&main_device);
+            if (err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuCtxGetDevice failed: "
+                                    << get_error_name(err);
+                return err;
+            }
+            int ordinal = num_multi_device_contexts;
+            if (ordinal >= main_device) {
+                ordinal++;
+            }
+            CUdevice dev;
+            err = cuDeviceGet(&dev, ordinal);
+            if (err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: Failed to get device " << ordinal
+                                    << " to distribute a loop across: "
+                                    << get_error_name(err);
+                return err;
+            }
+
+            int can_access_peer = 0;
+            err = cuDeviceCanAccessPeer(&can_access_peer, dev, main_device);
+            if (err != CUDA_SUCCESS || !can_access_peer) {
+                error(user_context) << "CUDA: Device " << ordinal << " can't access the memory of device "
+                                    << main_device << " peer-to-peer, so a loop can't be distributed across them.";
+                return CUDA_ERROR_PEER_ACCESS_UNSUPPORTED;
+            }
+
+            debug(user_context) <<  "    cuCtxCreate " << dev << " -> ";
+            CUcontext c;
+            err = cuCtxCreate(&c, CU_CTX_MAP_HOST, dev);
+            if (err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuCtxCreate failed: "
+                                    << get_error_name(err);
+                return err;
+            }
+            debug(user_context) << c << "\n";
+
+            // Creation makes c current. Let it access the allocations of
+            // the main context, and then the other way around.
+            err = cuCtxEnablePeerAccess(ctx.context, 0);
+            CUcontext old;
+            cuCtxPopCurrent(&old);
+            if (err == CUDA_SUCCESS || err == CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED) {
+                err = cuCtxEnablePeerAccess(c, 0);
+            }
+            if (err != CUDA_SUCCESS && err != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED) {
+                error(user_context) << "CUDA: cuCtxEnablePeerAccess failed: "
+                                    << get_error_name(err);
+                cuCtxDestroy(c);
+                return err;
+            }
+
+            multi_device_contexts[num_multi_device_contexts++] = c;
+        }
+        multi_device_context = multi_device_contexts[index - 1];
+    }
+
+    // Work on this thread goes to the device until the matching
+    // halide_cuda_multi_device_end.
+    CUresult err = cuCtxPushCurrent(multi_device_context);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuCtxPushCurrent failed: "
+                            << get_error_name(err);
+    }
+    return err;
+}
+
+WEAK int halide_cuda_multi_device_end(void *user_context, int index) {
+    debug(user_context)
+        << "CUDA: halide_cuda_multi_device_end (user_context: " << user_context
+        << ", index: " << index << ")\n";
+
+    if (index == 0) {
+        return 0;
+    }
+
+    CUresult err;
+    {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+        halide_assert(user_context, current_multi_device_context() == ctx.context);
+        // Issue any launches batched into a graph now, so that the
+        // devices run concurrently.
+        err = flush_own_launch_queue(user_context, ctx.context);
+    }
+
+    CUcontext old;
+    cuCtxPopCurrent(&old);
+    return err;
+}
+
+WEAK int halide_cuda_multi_device_sync(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_multi_device_sync (user_context: " << user_context << ")\n";
+
+    ScopedSpinLock spinlock(&multi_device_lock);
+    for (int i = 0; i < num_multi_device_contexts; i++) {
+        CUresult err = cuCtxPushCurrent(multi_device_contexts[i]);
+        if (err == CUDA_SUCCESS) {
+            err = cuCtxSynchronize();
+            CUcontext old;
+            cuCtxPopCurrent(&old);
+        }
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuCtxSynchronize failed: "
+                                << get_error_name(err);
+            return err;
+        }
+    }
+    return 0;
+}
+
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    size_t size = buf->size_in_bytes();
+    halide_assert(user_context, size != 0);
+    halide_assert(user_context, buf->device == 0);
+
+    host_allocation *record = (host_allocation *)malloc(sizeof(host_allocation));
+    if (record == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+
+    bool mapped = use_mapped_host_memory();
+    void *host;
+    debug(user_context) << "    cuMemHostAlloc " << (uint64_t)size << (mapped ? " mapped" : "") << " -> ";
+    CUresult err = cuMemHostAlloc(&host, size, CU_MEMHOSTALLOC_PORTABLE | (mapped ? CU_MEMHOSTALLOC_DEVICEMAP : 0));
+    if (err != CUDA_SUCCESS) {
+        debug(user_context) << get_error_name(err) << "\n";
+        error(user_context) << "CUDA: cuMemHostAlloc failed: "
+                            << get_error_name(err);
+        free(record);
+        return err;
+    }
+    debug(user_context) << host << "\n";
+
+    CUdeviceptr dev_ptr = 0;
+    if (mapped) {
+        err = cuMemHostGetDevicePointer(&dev_ptr, host, 0);
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuMemHostGetDevicePointer failed: "
+                                << get_error_name(err);
+            cuMemFreeHost(host);
+            free(record);
+            return err;
+        }
+        debug(user_context) << "    mapped to device pointer " << (void *)dev_ptr << "\n";
+    }
+
+    record->host = (uint8_t *)host;
+    record->device = dev_ptr;
+    record->size = size;
+    {
+        ScopedSpinLock spinlock(&host_allocations_lock);
+        record->next = host_allocations;
+        host_allocations = record;
+    }
+
+    buf->host = (uint8_t *)host;
+    if (mapped) {
+        buf->device = dev_ptr;
+        buf->device_interface = &cuda_device_interface;
+        buf->device_interface->impl->use_module();
+        return 0;
+    }
+
+    int result = halide_cuda_device_malloc(user_context, buf);
+    if (result != 0) {
+        free(unregister_host_allocation(buf->host));
+        cuMemFreeHost(host);
+        buf->host = NULL;
+    }
+    return result;
 }
 
 WEAK int halide_cuda_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    host_allocation *record = unregister_host_allocation(buf->host);
+    if (record == NULL) {
+        // Not allocated by halide_cuda_device_and_host_malloc.
+        return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    }
+
+    int result = 0;
+    if (buf->device) {
+        if (record->device != 0) {
+            // Wait for any kernels still using the mapped memory.
+            Context ctx(user_context);
+            if (ctx.error == CUDA_SUCCESS) {
+                synchronize_own_stream(user_context, ctx.context);
+                cuCtxSynchronize();
+            }
+            buf->device_interface->impl->release_module();
+            buf->device_interface = NULL;
+            buf->device = 0;
+        } else {
+            result = halide_cuda_device_free(user_context, buf);
+        }
+    }
+
+    {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            free(record);
+            return ctx.error;
+        }
+        debug(user_context) << "    cuMemFreeHost " << (void *)record->host << "\n";
+        CUresult err = cuMemFreeHost(record->host);
+        if (err != CUDA_SUCCESS && result == 0) {
+            result = err;
+        }
+    }
+    free(record);
+    buf->host = NULL;
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_cuda_wrap_device_ptr(void *user_context, struct halide_buffer_t *buf, uint64_t device_ptr) {
@@ -1048,6 +2561,127 @@ WEAK uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buff
     return (uintptr_t)buf->device;
 }
 
+WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_release_unused_device_allocations (user_context: " << user_context << ")\n";
+
+    // If we haven't even loaded libcuda, there is nothing to release.
+    if (!lib_cuda) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    device_allocation_cache_release(user_context, &allocation_cache, ctx.context, free_cached_allocation);
+    return 0;
+}
+
+WEAK uint64_t halide_cuda_buffer_texture(void *user_context, halide_buffer_t *buf, bool linear_filter) {
+    debug(user_context)
+        << "CUDA: halide_cuda_buffer_texture (user_context: " << user_context
+        << ", buf: " << buf << ", linear_filter: " << linear_filter << ")\n";
+
+    // Only dense rows of floats can be viewed as a pitched 2D texture.
+    if (buf->type != halide_type_of<float>() ||
+        buf->dimensions != 2 ||
+        buf->dim[0].stride != 1 ||
+        buf->dim[1].stride < buf->dim[0].extent ||
+        buf->dim[0].extent <= 0 ||
+        buf->dim[1].extent <= 0 ||
+        is_mapped_buffer(buf)) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS || cuTexObjectCreate == NULL) {
+        return 0;
+    }
+
+    if (halide_copy_to_device(user_context, buf, &cuda_device_interface) != 0 ||
+        buf->device_interface != &cuda_device_interface) {
+        return 0;
+    }
+
+    CUdeviceptr ptr = (CUdeviceptr)buf->device;
+    size_t width = buf->dim[0].extent;
+    size_t height = buf->dim[1].extent;
+    size_t pitch = (size_t)buf->dim[1].stride * sizeof(float);
+
+    ScopedSpinLock spinlock(&texture_objects_lock);
+
+    for (texture_object *t = texture_objects; t != NULL; t = t->next) {
+        if (t->context == ctx.context && t->ptr == ptr &&
+            t->width == width && t->height == height &&
+            t->pitch == pitch && t->linear_filter == linear_filter) {
+            return t->texture;
+        }
+    }
+
+    // The start of the memory and the pitch must be aligned as the
+    // device requires. Allocations made by cuMemAlloc always are, but
+    // crops may not be.
+    CUdevice dev;
+    int texture_alignment = 0, pitch_alignment = 0;
+    if (cuCtxGetDevice(&dev) != CUDA_SUCCESS ||
+        cuDeviceGetAttribute(&texture_alignment, CU_DEVICE_ATTRIBUTE_TEXTURE_ALIGNMENT, dev) != CUDA_SUCCESS ||
+        cuDeviceGetAttribute(&pitch_alignment, CU_DEVICE_ATTRIBUTE_TEXTURE_PITCH_ALIGNMENT, dev) != CUDA_SUCCESS ||
+        texture_alignment <= 0 || pitch_alignment <= 0 ||
+        ptr % texture_alignment != 0 ||
+        pitch % pitch_alignment != 0) {
+        debug(user_context) << "    buffer is not aligned for use as a texture\n";
+        return 0;
+    }
+
+    CUDA_RESOURCE_DESC res_desc;
+    memset(&res_desc, 0, sizeof(res_desc));
+    res_desc.resType = CU_RESOURCE_TYPE_PITCH2D;
+    res_desc.res.pitch2D.devPtr = ptr;
+    res_desc.res.pitch2D.format = CU_AD_FORMAT_FLOAT;
+    res_desc.res.pitch2D.numChannels = 1;
+    res_desc.res.pitch2D.width = width;
+    res_desc.res.pitch2D.height = height;
+    res_desc.res.pitch2D.pitchInBytes = pitch;
+
+    // Coordinates outside the buffer clamp to its edge, as the loads
+    // the texture reads replace do.
+    CUDA_TEXTURE_DESC tex_desc;
+    memset(&tex_desc, 0, sizeof(tex_desc));
+    tex_desc.addressMode[0] = CU_TR_ADDRESS_MODE_CLAMP;
+    tex_desc.addressMode[1] = CU_TR_ADDRESS_MODE_CLAMP;
+    tex_desc.addressMode[2] = CU_TR_ADDRESS_MODE_CLAMP;
+    tex_desc.filterMode = linear_filter ? CU_TR_FILTER_MODE_LINEAR : CU_TR_FILTER_MODE_POINT;
+    tex_desc.flags = CU_TRSF_NORMALIZED_COORDINATES;
+
+    CUtexObject texture = 0;
+    CUresult err = cuTexObjectCreate(&texture, &res_desc, &tex_desc, NULL);
+    if (err != CUDA_SUCCESS || texture == 0) {
+        debug(user_context) << "    cuTexObjectCreate failed: " << get_error_name(err) << "\n";
+        return 0;
+    }
+    debug(user_context) << "    cuTexObjectCreate " << (uint64_t)texture
+                        << " viewing " << (void *)ptr << " (" << (uint64_t)width
+                        << "x" << (uint64_t)height << ")\n";
+
+    texture_object *t = (texture_object *)malloc(sizeof(texture_object));
+    if (t == NULL) {
+        cuTexObjectDestroy(texture);
+        return 0;
+    }
+    t->context = ctx.context;
+    t->ptr = ptr;
+    t->width = width;
+    t->height = height;
+    t->pitch = pitch;
+    t->linear_filter = linear_filter;
+    t->texture = texture;
+    t->next = texture_objects;
+    texture_objects = t;
+    return texture;
+}
+
 WEAK const halide_device_interface_t *halide_cuda_device_interface() {
     return &cuda_device_interface;
 }
@@ -33,10 +33,23 @@ CUDA_FN(CUresult, cuModuleUnload, (CUmodule module));
 CUDA_FN(CUresult, cuModuleGetFunction, (CUfunction *hfunc, CUmodule hmod, const char *name));
 CUDA_FN_3020(CUresult, cuMemAlloc, cuMemAlloc_v2, (CUdeviceptr *dptr, size_t bytesize));
 CUDA_FN_3020(CUresult, cuMemFree, cuMemFree_v2, (CUdeviceptr dptr));
+CUDA_FN_3020(CUresult, cuMemGetAddressRange, cuMemGetAddressRange_v2, (CUdeviceptr *pbase, size_t *psize, CUdeviceptr dptr));
 CUDA_FN_3020(CUresult, cuMemcpyHtoD, cuMemcpyHtoD_v2, (CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpyDtoH, cuMemcpyDtoH_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpyDtoD, cuMemcpyDtoD_v2, (CUdeviceptr dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpy3D, cuMemcpy3D_v2, (const CUDA_MEMCPY3D *pCopy));
+CUDA_FN_3020(CUresult, cuMemcpy3DAsync, cuMemcpy3DAsync_v2, (const CUDA_MEMCPY3D *pCopy, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyHtoDAsync, cuMemcpyHtoDAsync_v2, (CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoHAsync, cuMemcpyDtoHAsync_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoDAsync, cuMemcpyDtoDAsync_v2, (CUdeviceptr dstDevice, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
+CUDA_FN(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN(CUresult, cuMemFreeHost, (void *p));
+CUDA_FN_3020(CUresult, cuMemHostGetDevicePointer, cuMemHostGetDevicePointer_v2, (CUdeviceptr *pdptr, void *p, unsigned int Flags));
+CUDA_FN(CUresult, cuEventCreate, (CUevent *phEvent, unsigned int Flags));
+CUDA_FN_4000(CUresult, cuEventDestroy, cuEventDestroy_v2, (CUevent hEvent));
+CUDA_FN(CUresult, cuEventRecord, (CUevent hEvent, CUstream hStream));
+CUDA_FN(CUresult, cuEventSynchronize, (CUevent hEvent));
+CUDA_FN(CUresult, cuEventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
 CUDA_FN(CUresult, cuLaunchKernel, (CUfunction f,
                                    unsigned int gridDimX,
                                    unsigned int gridDimY,
@@ -52,10 +65,33 @@ CUDA_FN(CUresult, cuCtxSynchronize, ());
 
 CUDA_FN_4000(CUresult, cuCtxPushCurrent, cuCtxPushCurrent_v2, (CUcontext ctx));
 CUDA_FN_4000(CUresult, cuCtxPopCurrent, cuCtxPopCurrent_v2, (CUcontext *pctx));
+CUDA_FN(CUresult, cuCtxGetCurrent, (CUcontext *pctx));
+CUDA_FN(CUresult, cuCtxEnablePeerAccess, (CUcontext peerContext, unsigned int Flags));
+CUDA_FN(CUresult, cuDeviceCanAccessPeer, (int *canAccessPeer, CUdevice dev, CUdevice peerDev));
 
 CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr ptr));
 
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
+CUDA_FN(CUresult, cuStreamWaitEvent, (CUstream hStream, CUevent hEvent, unsigned int Flags));
+
+// Graphs are only available from CUDA 10 on, and updating the
+// parameters of an instantiated graph from CUDA 10.1 on.
+CUDA_FN_OPTIONAL(CUresult, cuGraphCreate, (CUgraph *phGraph, unsigned int flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
+CUDA_FN_OPTIONAL(CUresult, cuGraphAddKernelNode, (CUgraphNode *phGraphNode, CUgraph hGraph,
+                                                  const CUgraphNode *dependencies, size_t numDependencies,
+                                                  const CUDA_KERNEL_NODE_PARAMS *nodeParams));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiate, (CUgraphExec *phGraphExec, CUgraph hGraph,
+                                                CUgraphNode *phErrorNode, char *logBuffer, size_t bufferSize));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecKernelNodeSetParams, (CUgraphExec hGraphExec, CUgraphNode hNode,
+                                                            const CUDA_KERNEL_NODE_PARAMS *nodeParams));
+
+// Texture objects need a device of compute capability 3.0 or later.
+CUDA_FN_OPTIONAL(CUresult, cuTexObjectCreate, (CUtexObject *pTexObject, const CUDA_RESOURCE_DESC *pResDesc,
+                                               const CUDA_TEXTURE_DESC *pTexDesc, const void *pResViewDesc));
+CUDA_FN_OPTIONAL(CUresult, cuTexObjectDestroy, (CUtexObject texObject));
 
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
@@ -507,6 +507,7 @@ struct d3d12_library {
 struct d3d12_function {
     ID3DBlob *shaderBlob;
     ID3D12RootSignature *rootSignature;
+    d3d12_compute_pipeline_state *pipelineState;    // created on first dispatch
 };
 
 enum ResourceBindingSlots {
@@ -521,18 +522,37 @@ static const uint32_t ResourceBindingLimits [NumSlots] = {
     16, // UAV
     14, // CBV
     25, // SRV (the actual tier-1 limit is 128, but will allow only 25 for now)
-    // TODO(marcos): we may consider increasing it to the limit once we have a
-    // pool of d3d12_binder objects that are recycled whenever kernels are run
-    // (at the moment, a new binder is created/destroyed with every kernel run)
 };
 
+static const uint32_t DescriptorsPerBinder = ResourceBindingLimits[UAV]
+                                           + ResourceBindingLimits[CBV]
+                                           + ResourceBindingLimits[SRV];
+
+// A binder is a region of the shared descriptor heap; 'CPU' advances as
+// descriptors are written, starting from 'CPUBase'.
 struct d3d12_binder {
     ID3D12DescriptorHeap *descriptorHeap;
+    D3D12_CPU_DESCRIPTOR_HANDLE CPUBase [NumSlots];
     D3D12_CPU_DESCRIPTOR_HANDLE CPU [NumSlots];
     D3D12_GPU_DESCRIPTOR_HANDLE GPU [NumSlots];
     UINT descriptorSize;
 };
 
+// Command lists, with their allocators, are recycled through a ring of
+// slots instead of being created and destroyed for every dispatch. Each
+// slot also owns a region of the shader-visible descriptor heap and a
+// constant buffer for kernel arguments. Everything in a slot can be
+// reused once the queue fence shows that the slot's last submission has
+// completed.
+struct d3d12_command_slot {
+    d3d12_command_allocator *allocator;
+    d3d12_command_list *cmdList;
+    d3d12_binder *binder;       // created on first dispatch
+    d3d12_buffer args_buffer;   // grown as needed
+};
+
+static const int NumCommandSlots = 16;
+
 struct d3d12_profiler {
     d3d12_buffer queryResultsBuffer;
     UINT64 tick_frequency;  // in Hz, may vary per command queue
@@ -571,6 +591,10 @@ WEAK ID3D12RootSignature *rootSignature = NULL;
 WEAK d3d12_buffer upload   = { };   // staging buffer to transfer data to the device
 WEAK d3d12_buffer readback = { };   // staging buffer to retrieve data from the device
 
+WEAK ID3D12DescriptorHeap *descriptor_heap = NULL;   // NumCommandSlots binders
+WEAK d3d12_command_slot command_slots [NumCommandSlots] = { };
+WEAK int next_command_slot = 0;
+
 template<typename d3d12_T>
 static void release_d3d12_object(d3d12_T *obj) {
     TRACELOG;
@@ -658,6 +682,10 @@ void release_d3d12_object<d3d12_function>(d3d12_function *function) {
     TRACELOG;
     Release_ID3D12Object(function->shaderBlob);
     Release_ID3D12Object(function->rootSignature);
+    if (function->pipelineState != NULL) {
+        ID3D12PipelineState *p = *(function->pipelineState);
+        Release_ID3D12Object(p);
+    }
     d3d12_free(function);
 }
 
@@ -1487,16 +1515,13 @@ static void end_recording(d3d12_compute_command_list *cmdList) {
     (*cmdList)->Close();
 }
 
-static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
+static ID3D12DescriptorHeap *new_descriptor_heap(d3d12_device *device, uint32_t num_binders) {
     TRACELOG;
     ID3D12DescriptorHeap *descriptorHeap = NULL;
     D3D12_DESCRIPTOR_HEAP_DESC dhd = { };
     {
         dhd.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        dhd.NumDescriptors  = 0;
-        dhd.NumDescriptors += ResourceBindingLimits[UAV];
-        dhd.NumDescriptors += ResourceBindingLimits[CBV];
-        dhd.NumDescriptors += ResourceBindingLimits[SRV];
+        dhd.NumDescriptors = DescriptorsPerBinder * num_binders;
         dhd.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         dhd.NodeMask = 0;
     }
@@ -1504,28 +1529,15 @@ static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
     if (D3DError(result, descriptorHeap, NULL, "Unable to create the Direct3D 12 descriptor heap")) {
         return NULL;
     }
+    return descriptorHeap;
+}
 
-    UINT descriptorSize = (*device)->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    TRACEPRINT("descriptor handle increment size: " << descriptorSize << "\n");
-
-    d3d12_binder *binder = malloct<d3d12_binder>();
-    binder->descriptorHeap = descriptorHeap;
-    binder->descriptorSize = descriptorSize;
-
-    D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = Call_ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(descriptorHeap);
-    TRACEPRINT("descriptor heap base for CPU: " << baseCPU.ptr << "\n");
-    binder->CPU[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
-    binder->CPU[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-    binder->CPU[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
-
-    D3D12_GPU_DESCRIPTOR_HANDLE baseGPU = Call_ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(descriptorHeap);
-    TRACEPRINT("descriptor heap base for GPU: " << baseGPU.ptr << "\n");
-    binder->GPU[UAV].ptr = (baseGPU.ptr += descriptorSize * 0);
-    binder->GPU[CBV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-    binder->GPU[SRV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
-
-    // initialize everything with null descriptors...
-    for (uint32_t i = 0; i < ResourceBindingLimits[UAV]; ++i) {
+// Write null descriptors to the first 'count[slot]' entries of each of
+// the binder's descriptor tables.
+static void clear_descriptors(d3d12_device *device, d3d12_binder *binder, const uint32_t count [NumSlots]) {
+    TRACELOG;
+    UINT descriptorSize = binder->descriptorSize;
+    for (uint32_t i = 0; i < count[UAV]; ++i) {
         D3D12_UNORDERED_ACCESS_VIEW_DESC NullDescUAV = { };
         {
             NullDescUAV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
@@ -1536,21 +1548,21 @@ static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
             NullDescUAV.Buffer.CounterOffsetInBytes = 0;
             NullDescUAV.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[UAV];
+        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPUBase[UAV];
         hCPU.ptr += i*descriptorSize;
         (*device)->CreateUnorderedAccessView(NULL, NULL, &NullDescUAV, hCPU);
     }
-    for (uint32_t i = 0; i < ResourceBindingLimits[CBV]; ++i) {
+    for (uint32_t i = 0; i < count[CBV]; ++i) {
         D3D12_CONSTANT_BUFFER_VIEW_DESC NullDescCBV = { };
         {
             NullDescCBV.BufferLocation = 0;
             NullDescCBV.SizeInBytes = 0;
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[CBV];
+        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPUBase[CBV];
         hCPU.ptr += i*descriptorSize;
         Call_ID3D12Device_CreateConstantBufferView((*device), &NullDescCBV, hCPU);
     }
-    for (uint32_t i = 0; i < ResourceBindingLimits[SRV]; ++i) {
+    for (uint32_t i = 0; i < count[SRV]; ++i) {
         D3D12_SHADER_RESOURCE_VIEW_DESC NullDescSRV = { };
         {
             NullDescSRV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
@@ -1561,14 +1573,61 @@ static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
             NullDescSRV.Buffer.StructureByteStride = 0;
             NullDescSRV.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[SRV];
+        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPUBase[SRV];
         hCPU.ptr += i*descriptorSize;
         Call_ID3D12Device_CreateShaderResourceView((*device), NULL, &NullDescSRV, hCPU);
     }
+}
+
+// Make a binder out of region 'index' of the shared descriptor heap.
+static d3d12_binder *new_descriptor_binder(d3d12_device *device, ID3D12DescriptorHeap *descriptorHeap, uint32_t index) {
+    TRACELOG;
+    UINT descriptorSize = (*device)->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    TRACEPRINT("descriptor handle increment size: " << descriptorSize << "\n");
+
+    d3d12_binder *binder = malloct<d3d12_binder>();
+    binder->descriptorHeap = descriptorHeap;
+    binder->descriptorSize = descriptorSize;
+    descriptorHeap->AddRef();
+
+    UINT64 regionOffset = (UINT64)descriptorSize * DescriptorsPerBinder * index;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = Call_ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(descriptorHeap);
+    baseCPU.ptr += regionOffset;
+    TRACEPRINT("descriptor heap base for CPU: " << baseCPU.ptr << "\n");
+    binder->CPUBase[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
+    binder->CPUBase[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
+    binder->CPUBase[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+    for (int slot = 0; slot < NumSlots; ++slot) {
+        binder->CPU[slot] = binder->CPUBase[slot];
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE baseGPU = Call_ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(descriptorHeap);
+    baseGPU.ptr += regionOffset;
+    TRACEPRINT("descriptor heap base for GPU: " << baseGPU.ptr << "\n");
+    binder->GPU[UAV].ptr = (baseGPU.ptr += descriptorSize * 0);
+    binder->GPU[CBV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
+    binder->GPU[SRV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+
+    // initialize everything with null descriptors...
+    clear_descriptors(device, binder, ResourceBindingLimits);
 
     return binder;
 }
 
+// Null out the descriptors written since the binder was last reset, and
+// rewind it so that the next dispatch binds from the start again. Only
+// safe once the GPU is done with the previous dispatch.
+static void reset_descriptor_binder(d3d12_device *device, d3d12_binder *binder) {
+    TRACELOG;
+    uint32_t used [NumSlots];
+    for (int slot = 0; slot < NumSlots; ++slot) {
+        used[slot] = (uint32_t)((binder->CPU[slot].ptr - binder->CPUBase[slot].ptr) / binder->descriptorSize);
+        binder->CPU[slot] = binder->CPUBase[slot];
+    }
+    clear_descriptors(device, binder, used);
+}
+
 static d3d12_library *new_library_with_source(d3d12_device *device, const char *source, size_t source_len) {
     TRACELOG;
     // Unlike Metal, Direct3D 12 does not have the concept of a "shader library"
@@ -1671,6 +1730,7 @@ static d3d12_function *new_function_with_name(d3d12_device *device, d3d12_librar
     function = malloct<d3d12_function>();
     function->shaderBlob = shaderBlob;
     function->rootSignature = rootSignature;
+    function->pipelineState = NULL;
     rootSignature->AddRef();
 
     // cache the compiled function for future use:
@@ -1783,18 +1843,21 @@ static void commit_command_list(d3d12_compute_command_list *cmdList) {
     (*queue)->Signal(queue_fence, cmdList->signal);
 }
 
-static void wait_until_completed(d3d12_compute_command_list *cmdList) {
+static void wait_for_signal(uint64_t signal) {
     TRACELOG;
 
-    // TODO(marcos): perhaps replace the busy-wait loop below by a blocking wait event?
-    // HANDLE hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-    // queue->fence->SetEventOnCompletion(cmdList->signal, hEvent);
-    // WaitForSingleObject(hEvent, INFINITE);
-    // CloseHandle(hEvent);
+    if (queue_fence->GetCompletedValue() >= signal) {
+        return;
+    }
 
     HRESULT result_before = (*device)->GetDeviceRemovedReason();
 
-    while (queue_fence->GetCompletedValue() < cmdList->signal) { }
+    // With a NULL event, SetEventOnCompletion blocks until the fence
+    // reaches the value, rather than us spinning on GetCompletedValue().
+    HRESULT result = queue_fence->SetEventOnCompletion(signal, NULL);
+    if (FAILED(result)) {
+        while (queue_fence->GetCompletedValue() < signal) { }
+    }
 
     HRESULT result_after = (*device)->GetDeviceRemovedReason();
     if (FAILED(result_after)) {
@@ -1806,6 +1869,85 @@ static void wait_until_completed(d3d12_compute_command_list *cmdList) {
     }
 }
 
+static void wait_until_completed(d3d12_compute_command_list *cmdList) {
+    TRACELOG;
+
+    wait_for_signal(cmdList->signal);
+}
+
+// Wait for everything submitted to the queue so far.
+static void wait_until_idle() {
+    TRACELOG;
+    if (queue_fence != NULL) {
+        wait_for_signal(__atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST));
+    }
+}
+
+// Get the next command slot in the ring, with its command list reset and
+// open for recording. If the slot's previous submission is still in
+// flight, this is where the host waits for it.
+static d3d12_command_slot *acquire_command_slot(d3d12_device *device) {
+    TRACELOG;
+    d3d12_command_slot *slot = &command_slots[next_command_slot];
+    next_command_slot = (next_command_slot + 1) % NumCommandSlots;
+
+    if (slot->cmdList == NULL) {
+        // a newly created command list is already open for recording
+        slot->allocator = new_command_allocator<HALIDE_D3D12_COMMAND_LIST_TYPE>(device);
+        if (slot->allocator == NULL) {
+            return NULL;
+        }
+        slot->cmdList = new_command_list<HALIDE_D3D12_COMMAND_LIST_TYPE>(device, slot->allocator);
+        if (slot->cmdList == NULL) {
+            release_object(slot->allocator);
+            slot->allocator = NULL;
+            return NULL;
+        }
+        return slot;
+    }
+
+    wait_until_completed(slot->cmdList);
+
+    ID3D12CommandAllocator *pCommandAllocator = (*slot->allocator);
+    HRESULT result = pCommandAllocator->Reset();
+    if (D3DError(result, pCommandAllocator, NULL, "Unable to reset the Direct3D 12 command allocator")) {
+        return NULL;
+    }
+    ID3D12PipelineState *pInitialState = NULL;
+    result = (*slot->cmdList)->Reset(pCommandAllocator, pInitialState);
+    if (D3DError(result, slot->cmdList->p, NULL, "Unable to reset the Direct3D 12 command list")) {
+        return NULL;
+    }
+    if (slot->binder != NULL) {
+        reset_descriptor_binder(device, slot->binder);
+    }
+    return slot;
+}
+
+// Give up on recording into a slot acquired with acquire_command_slot()
+// without submitting it, so that it can be reset the next time around.
+static void abandon_command_slot(d3d12_command_slot *slot) {
+    TRACELOG;
+    end_recording(slot->cmdList);
+}
+
+static void release_command_slots() {
+    TRACELOG;
+    wait_until_idle();
+    for (int i = 0; i < NumCommandSlots; ++i) {
+        d3d12_command_slot *slot = &command_slots[i];
+        release_object(slot->cmdList);
+        release_object(slot->allocator);
+        release_object(slot->binder);
+        release_object(&slot->args_buffer);
+        d3d12_command_slot empty = { };
+        *slot = empty;
+    }
+    next_command_slot = 0;
+    Release_ID3D12Object(descriptor_heap);
+    descriptor_heap = NULL;
+}
+
 class D3D12ContextHolder {
     void *user_context;
 
@@ -1944,14 +2086,19 @@ static void d3d12compute_device_sync_internal(d3d12_device *device, d3d12_buffer
     // use the main compute queue and issue copies via compute command lists.
     //static const D3D12_COMMAND_LIST_TYPE Type = D3D12_COMMAND_LIST_TYPE_COPY;
 
-    static const D3D12_COMMAND_LIST_TYPE Type = HALIDE_D3D12_COMMAND_LIST_TYPE;
-    d3d12_command_allocator *sync_command_allocator = new_command_allocator<Type>(device);
-    d3d12_compute_command_list *blitCmdList = new_command_list<Type>(device, sync_command_allocator);
+    d3d12_command_slot *slot = acquire_command_slot(device);
+    if (slot == NULL) {
+        d3d12_halt("D3D12Compute: Could not get a command list for synchronization.");
+        return;
+    }
+    d3d12_compute_command_list *blitCmdList = slot->cmdList;
     if (dev_buffer != NULL) {
         if (is_buffer_managed(dev_buffer)) {
             synchronize_host_and_device_buffer_contents(blitCmdList, dev_buffer);
         }
     }
+    // the queue executes in order, so this also waits for any kernels
+    // that are still in flight
     commit_command_list(blitCmdList);
     wait_until_completed(blitCmdList);
 
@@ -1964,9 +2111,6 @@ static void d3d12compute_device_sync_internal(d3d12_device *device, d3d12_buffer
             dev_buffer->xfer = NULL;
         }
     }
-
-    release_object(blitCmdList);
-    release_object(sync_command_allocator);
 }
 
 static int d3d12compute_buffer_copy(d3d12_device *device,
@@ -2028,19 +2172,19 @@ static int d3d12compute_buffer_copy(d3d12_device *device,
     // ReadWrite, ReadOnly and WriteOnly are shader usage hints, not copy hints
     // (there's no need to worry about them during device-to-device transfers)
 
-    // TODO(marcos): this command list allocation is overkill: needs refactoring
-
-    static const D3D12_COMMAND_LIST_TYPE Type = HALIDE_D3D12_COMMAND_LIST_TYPE;
-    d3d12_command_allocator *sync_command_allocator = new_command_allocator<Type>(device);
-    d3d12_compute_command_list *blitCmdList = new_command_list<Type>(device, sync_command_allocator);
+    // the copy is ordered after any kernels in flight by the queue, and
+    // kernels submitted later are ordered after it, so there is no need
+    // to wait for it here
+    d3d12_command_slot *slot = acquire_command_slot(device);
+    if (slot == NULL) {
+        d3d12_halt("D3D12Compute: Could not get a command list for the copy.");
+        return halide_error_code_device_buffer_copy_failed;
+    }
+    d3d12_compute_command_list *blitCmdList = slot->cmdList;
 
     buffer_copy_command(blitCmdList, src, dst, src_byte_offset, dst_byte_offset, num_bytes);
 
     commit_command_list(blitCmdList);
-    wait_until_completed(blitCmdList);
-
-    release_object(blitCmdList);
-    release_object(sync_command_allocator);
 
     return 0;
 }
@@ -2426,6 +2570,8 @@ WEAK int halide_d3d12compute_device_release(void *user_context) {
 
         // Release the device itself, if we created it.
         if (acquired_device == device) {
+            release_command_slots();
+
             release_object(&upload);
             release_object(&readback);
             d3d12_buffer empty = { };
@@ -2610,18 +2756,6 @@ WEAK int halide_d3d12compute_run(void *user_context,
     StartCapturingGPUActivity();
     #endif
 
-    d3d12_command_allocator *command_allocator = new_command_allocator<HALIDE_D3D12_COMMAND_LIST_TYPE>(device);
-    if (command_allocator == 0) {
-        d3d12_halt("D3D12Compute: Could not create compute command allocator.");
-        return halide_error_code_device_run_failed;
-    }
-
-    d3d12_compute_command_list *cmdList = new_compute_command_list(device, command_allocator);
-    if (cmdList == 0) {
-        d3d12_halt("D3D12Compute: Could not create compute command list.");
-        return halide_error_code_device_run_failed;
-    }
-
     halide_assert(user_context, state_ptr);
     module_state *state = (module_state*)state_ptr;
 
@@ -2629,14 +2763,36 @@ WEAK int halide_d3d12compute_run(void *user_context,
                                                       shared_mem_bytes, threadsX, threadsY, threadsZ);
     halide_assert(user_context, function);
 
-    // prepare buffer resource binding:
-    d3d12_binder *binder = new_descriptor_binder(device);
-    d3d12_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(d3d12_context.device, function);
-    if (pipeline_state == 0) {
-        d3d12_halt("D3D12Compute: Could not allocate pipeline state.");
-        release_object(function);
+    // the pipeline state object is cached with the function, which is
+    // itself cached per entry point, block size and shared memory size:
+    if (function->pipelineState == NULL) {
+        function->pipelineState = new_compute_pipeline_state_with_function(d3d12_context.device, function);
+        if (function->pipelineState == NULL) {
+            d3d12_halt("D3D12Compute: Could not allocate pipeline state.");
+            return halide_error_code_device_run_failed;
+        }
+    }
+    d3d12_compute_pipeline_state *pipeline_state = function->pipelineState;
+
+    d3d12_command_slot *slot = acquire_command_slot(device);
+    if (slot == NULL) {
+        d3d12_halt("D3D12Compute: Could not get a compute command list.");
         return halide_error_code_device_run_failed;
     }
+    d3d12_compute_command_list *cmdList = slot->cmdList;
+
+    // prepare buffer resource binding:
+    if (slot->binder == NULL) {
+        if (descriptor_heap == NULL) {
+            descriptor_heap = new_descriptor_heap(device, NumCommandSlots);
+            if (descriptor_heap == NULL) {
+                abandon_command_slot(slot);
+                return halide_error_code_device_run_failed;
+            }
+        }
+        slot->binder = new_descriptor_binder(device, descriptor_heap, (uint32_t)(slot - command_slots));
+    }
+    d3d12_binder *binder = slot->binder;
     set_compute_pipeline_state(cmdList, pipeline_state, function, binder);
 
     // pack all non-buffer arguments into a single "constant" allocation block:
@@ -2658,15 +2814,18 @@ WEAK int halide_d3d12compute_run(void *user_context,
         total_args_size = (total_args_size + argsize - 1) & ~(argsize - 1);
         total_args_size += argsize;
     }
-    d3d12_buffer args_buffer = { };
+    d3d12_buffer &args_buffer = slot->args_buffer;
     if (total_args_size > 0) {
         // Direct3D 12 expects constant buffers to have sizes multiple of 256:
         size_t constant_buffer_size = (total_args_size + 255) & ~255;
-        args_buffer = new_constant_buffer(d3d12_context.device, constant_buffer_size);
-        if (!args_buffer) {
-            d3d12_halt("D3D12Compute: Could not allocate arguments buffer.");
-            release_object(function);
-            return halide_error_code_device_run_failed;
+        if (args_buffer.sizeInBytes < constant_buffer_size) {
+            release_object(&args_buffer);
+            args_buffer = new_constant_buffer(d3d12_context.device, constant_buffer_size);
+            if (!args_buffer) {
+                d3d12_halt("D3D12Compute: Could not allocate arguments buffer.");
+                abandon_command_slot(slot);
+                return halide_error_code_device_run_failed;
+            }
         }
         uint8_t *args_ptr = (uint8_t*)buffer_contents(&args_buffer);
         size_t offset = 0;
@@ -2705,7 +2864,7 @@ WEAK int halide_d3d12compute_run(void *user_context,
     }
 
     // setup/bind the argument buffer:
-    if (args_buffer) {
+    if (total_args_size > 0) {
         // always bind argument buffer at constant buffer binding 0
         int32_t cb_index = 0;   // a.k.a. register(c0)
         set_input_buffer(binder, &args_buffer, cb_index);
@@ -2755,7 +2914,12 @@ WEAK int halide_d3d12compute_run(void *user_context,
 
     commit_command_list(cmdList);
 
+    // the kernel runs asynchronously: the host only waits for it when its
+    // results are needed (copies back to host and device_sync), when a
+    // buffer it uses is freed, or when its command slot comes around again
+    #if HALIDE_D3D12_RENDERDOC || HALIDE_D3D12_PROFILING
     wait_until_completed(cmdList);
+    #endif
 
     #if HALIDE_D3D12_RENDERDOC
     FinishCapturingGPUActivity();
@@ -2770,12 +2934,6 @@ WEAK int halide_d3d12compute_run(void *user_context,
     release_object(profiler);
     #endif
 
-    release_object(cmdList);
-    release_object(command_allocator);
-    release_object(&args_buffer);
-    release_object(pipeline_state);
-    release_object(binder);
-
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
     TRACEPRINT("Time for halide_d3d12compute_device_run: " << (t_after - t_before) / 1.0e6 << " ms\n");
@@ -3082,6 +3240,10 @@ WEAK int halide_d3d12compute_detach_buffer(void *user_context, struct halide_buf
     d3d12_buffer *dbuffer = peel_buffer(buf);
     unwrap_buffer(buf);
 
+    // kernels and copies run asynchronously, so the resource may still be
+    // in use by the GPU:
+    wait_until_idle();
+
     // it is safe to simply call release_d3d12_object() here:
     // if 'buf' holds an user resource (from halide_d3d12compute_wrap_buffer),
     // the reference count of the resource will just get decremented without
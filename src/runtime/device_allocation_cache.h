@@ -0,0 +1,170 @@
+#ifndef HALIDE_RUNTIME_DEVICE_ALLOCATION_CACHE_H
+#define HALIDE_RUNTIME_DEVICE_ALLOCATION_CACHE_H
+
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// A cache of device allocations that have been freed by the pipeline but not
+// yet returned to the driver, for the backends to reuse instead of calling
+// into the driver on every device_malloc and device_free. Each backend keeps
+// its own cache, keyed by the context (CUcontext, cl_context, MTLDevice) the
+// allocation was made in, so that device_release can drop the allocations
+// of the context it is about to destroy.
+
+// Allocations are binned by size class: each power of two is split into
+// eight classes, so rounding a size up to its class wastes at most an eighth
+// of the allocation.
+const int device_allocation_class_bits = 3;
+const int device_allocation_num_bins = 64 << device_allocation_class_bits;
+const size_t device_allocation_min_size = 256;
+
+struct cached_device_allocation {
+    void *context;
+    uint64_t handle;
+    size_t size;
+    cached_device_allocation *next;
+};
+
+struct device_allocation_cache {
+    halide_mutex mutex;
+    // The total size of the allocations in the bins.
+    size_t cached_bytes;
+    cached_device_allocation *bins[device_allocation_num_bins];
+    // Lets halide_release_unused_device_allocations reach this cache.
+    halide_device_allocation_pool pool;
+    bool pool_registered;
+};
+
+// The size of the allocation made for a buffer of 'size' bytes when
+// allocations are being reused.
+WEAK size_t device_allocation_size_class(size_t size) {
+    if (size <= device_allocation_min_size) {
+        return device_allocation_min_size;
+    }
+    int log2_size = 63 - __builtin_clzll((uint64_t)size);
+    size_t step = (size_t)1 << (log2_size - device_allocation_class_bits);
+    return (size + step - 1) & ~(step - 1);
+}
+
+WEAK int device_allocation_bin(size_t rounded_size) {
+    int log2_size = 63 - __builtin_clzll((uint64_t)rounded_size);
+    int fraction = (int)(rounded_size >> (log2_size - device_allocation_class_bits)) &
+        ((1 << device_allocation_class_bits) - 1);
+    return (log2_size << device_allocation_class_bits) + fraction;
+}
+
+// Register the cache with the device interface the first time the backend
+// allocates through it, so that halide_release_unused_device_allocations can
+// empty it.
+WEAK void device_allocation_cache_register(device_allocation_cache *cache,
+                                           int (*release_unused)(void *user_context)) {
+    bool needs_registration = false;
+    {
+        ScopedMutexLock lock(&cache->mutex);
+        if (!cache->pool_registered) {
+            cache->pool.release_unused = release_unused;
+            cache->pool.next = NULL;
+            cache->pool_registered = true;
+            needs_registration = true;
+        }
+    }
+    if (needs_registration) {
+        halide_register_device_allocation_pool(&cache->pool);
+    }
+}
+
+// Take an allocation of exactly 'rounded_size' bytes made in 'context' out
+// of the cache. Returns false if there is none.
+WEAK bool device_allocation_cache_take(device_allocation_cache *cache, void *context,
+                                       size_t rounded_size, uint64_t *handle) {
+    ScopedMutexLock lock(&cache->mutex);
+    cached_device_allocation **prev_ptr = &cache->bins[device_allocation_bin(rounded_size)];
+    for (cached_device_allocation *entry = *prev_ptr; entry; entry = entry->next) {
+        if (entry->context == context && entry->size == rounded_size) {
+            *prev_ptr = entry->next;
+            cache->cached_bytes -= entry->size;
+            *handle = entry->handle;
+            free(entry);
+            return true;
+        }
+        prev_ptr = &entry->next;
+    }
+    return false;
+}
+
+// Offer a freed allocation to the cache. Returns false if reuse is disabled,
+// the allocation was not made with a size class, or caching it would take the
+// cache over its limit, in which case the caller must free it.
+WEAK bool device_allocation_cache_put(void *user_context, device_allocation_cache *cache,
+                                      void *context, size_t size, uint64_t handle) {
+    if (!halide_can_reuse_device_allocations(user_context) ||
+        size != device_allocation_size_class(size)) {
+        return false;
+    }
+    ScopedMutexLock lock(&cache->mutex);
+    if (cache->cached_bytes + size > halide_device_allocation_cache_limit(user_context)) {
+        return false;
+    }
+    cached_device_allocation *entry =
+        (cached_device_allocation *)malloc(sizeof(cached_device_allocation));
+    if (entry == NULL) {
+        return false;
+    }
+    int bin = device_allocation_bin(size);
+    entry->context = context;
+    entry->handle = handle;
+    entry->size = size;
+    entry->next = cache->bins[bin];
+    cache->bins[bin] = entry;
+    cache->cached_bytes += size;
+    return true;
+}
+
+// Remove the allocations made in 'context', or all of them if 'context' is
+// NULL, from the cache, and pass each one to 'release' to return it to the
+// driver. The caller must have made the context current if the driver
+// requires it.
+WEAK void device_allocation_cache_release(void *user_context, device_allocation_cache *cache,
+                                          void *context,
+                                          void (*release)(void *user_context, void *context, uint64_t handle)) {
+    cached_device_allocation *to_release = NULL;
+    {
+        ScopedMutexLock lock(&cache->mutex);
+        for (int i = 0; i < device_allocation_num_bins; i++) {
+            cached_device_allocation **prev_ptr = &cache->bins[i];
+            cached_device_allocation *entry = *prev_ptr;
+            while (entry) {
+                cached_device_allocation *next = entry->next;
+                if (context == NULL || entry->context == context) {
+                    *prev_ptr = next;
+                    cache->cached_bytes -= entry->size;
+                    entry->next = to_release;
+                    to_release = entry;
+                } else {
+                    prev_ptr = &entry->next;
+                }
+                entry = next;
+            }
+        }
+    }
+    while (to_release) {
+        cached_device_allocation *next = to_release->next;
+        debug(user_context) << "    releasing cached device allocation " << (void *)to_release->handle
+                            << " of " << (uint64_t)to_release->size << " bytes\n";
+        release(user_context, to_release->context, to_release->handle);
+        free(to_release);
+        to_release = next;
+    }
+}
+
+WEAK bool device_allocation_cache_empty(device_allocation_cache *cache) {
+    ScopedMutexLock lock(&cache->mutex);
+    return cache->cached_bytes == 0;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+#endif
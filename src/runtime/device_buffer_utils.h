@@ -158,6 +158,32 @@ WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
     return c;
 }
 
+// The driver APIs can copy a 2D or 3D rectangle of rows in a single
+// call, if the rows are evenly spaced in both source and destination,
+// and the slices are evenly spaced at a multiple of the row pitch.
+// Returns how many of the innermost dimensions of the copy (zero, one,
+// or two) can be folded into such a rectangle with rows of chunk_size
+// bytes.
+WEAK int rect_copy_dims(const device_copy &c) {
+    int64_t src_row_pitch = (int64_t)c.src_stride_bytes[0];
+    int64_t dst_row_pitch = (int64_t)c.dst_stride_bytes[0];
+    if (c.extent[0] == 1 ||
+        src_row_pitch < (int64_t)c.chunk_size ||
+        dst_row_pitch < (int64_t)c.chunk_size) {
+        return 0;
+    }
+    int64_t src_slice_pitch = (int64_t)c.src_stride_bytes[1];
+    int64_t dst_slice_pitch = (int64_t)c.dst_stride_bytes[1];
+    if (c.extent[1] == 1 ||
+        src_slice_pitch % src_row_pitch != 0 ||
+        dst_slice_pitch % dst_row_pitch != 0 ||
+        src_slice_pitch < src_row_pitch * (int64_t)c.extent[0] ||
+        dst_slice_pitch < dst_row_pitch * (int64_t)c.extent[0]) {
+        return 1;
+    }
+    return 2;
+}
+
 WEAK device_copy make_host_to_device_copy(const halide_buffer_t *buf) {
     return make_buffer_copy(buf, true, buf, false);
 }
@@ -3,6 +3,7 @@
 #include "device_interface.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "scoped_spin_lock.h"
 
 extern "C" {
 
@@ -26,6 +27,38 @@ struct device_handle_wrapper {
 // need to be able to do a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+// Settings shared by the device allocation caches of all the backends.
+WEAK bool halide_reuse_device_allocations_flag = false;
+WEAK size_t halide_device_allocation_cache_limit_bytes = 256 * 1024 * 1024;
+WEAK bool halide_device_allocation_settings_initialized = false;
+WEAK int halide_device_allocation_settings_lock = 0;
+
+// The allocation caches registered by the backends.
+WEAK halide_device_allocation_pool *device_allocation_pools = NULL;
+WEAK halide_mutex device_allocation_pools_mutex;
+
+// The device timing totals, and the timers registered by the backends.
+WEAK bool halide_device_timing_flag = false;
+WEAK bool halide_device_timing_initialized = false;
+WEAK int halide_device_timing_lock = 0;
+WEAK halide_device_timing_t halide_device_timing_totals = {0, 0, 0, 0};
+WEAK halide_device_timer *device_timers = NULL;
+WEAK halide_mutex device_timers_mutex;
+
+WEAK void initialize_device_allocation_settings_already_locked() {
+    if (!halide_device_allocation_settings_initialized) {
+        const char *reuse = getenv("HL_REUSE_DEVICE_ALLOCATIONS");
+        if (reuse) {
+            halide_reuse_device_allocations_flag = (atoi(reuse) != 0);
+        }
+        const char *limit = getenv("HL_DEVICE_ALLOCATION_CACHE_MB");
+        if (limit) {
+            halide_device_allocation_cache_limit_bytes = (size_t)atoi(limit) * 1024 * 1024;
+        }
+        halide_device_allocation_settings_initialized = true;
+    }
+}
+
 WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t *buf) {
     if (!buf->device_dirty()) {
         return 0;  // my, that was easy
@@ -41,7 +74,9 @@ WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t
         debug(user_context) << "copy_to_host_already_locked " << buf << " interface is NULL\n";
         return halide_error_code_no_device_interface;
     }
+    uint64_t t_begin = halide_timeline_begin();
     int result = interface->impl->copy_to_host(user_context, buf);
+    halide_timeline_end("copy_to_host", "copy", t_begin, buf->size_in_bytes(), 0);
     if (result != 0) {
         debug(user_context) << "copy_to_host_already_locked " << buf << " device copy_to_host returned an error\n";
         return halide_error_code_copy_to_host_failed;
@@ -106,6 +141,109 @@ WEAK void halide_device_release(void *user_context, const halide_device_interfac
     device_interface->impl->device_release(user_context);
 }
 
+WEAK int halide_reuse_device_allocations(void *user_context, bool flag) {
+    {
+        ScopedSpinLock lock(&halide_device_allocation_settings_lock);
+        initialize_device_allocation_settings_already_locked();
+        halide_reuse_device_allocations_flag = flag;
+    }
+    if (!flag) {
+        return halide_release_unused_device_allocations(user_context);
+    }
+    return 0;
+}
+
+WEAK bool halide_can_reuse_device_allocations(void *user_context) {
+    ScopedSpinLock lock(&halide_device_allocation_settings_lock);
+    initialize_device_allocation_settings_already_locked();
+    return halide_reuse_device_allocations_flag;
+}
+
+WEAK void halide_set_device_allocation_cache_limit(size_t bytes) {
+    ScopedSpinLock lock(&halide_device_allocation_settings_lock);
+    initialize_device_allocation_settings_already_locked();
+    halide_device_allocation_cache_limit_bytes = bytes;
+}
+
+WEAK size_t halide_device_allocation_cache_limit(void *user_context) {
+    ScopedSpinLock lock(&halide_device_allocation_settings_lock);
+    initialize_device_allocation_settings_already_locked();
+    return halide_device_allocation_cache_limit_bytes;
+}
+
+WEAK void halide_register_device_allocation_pool(struct halide_device_allocation_pool *pool) {
+    ScopedMutexLock lock(&device_allocation_pools_mutex);
+    pool->next = device_allocation_pools;
+    device_allocation_pools = pool;
+}
+
+WEAK int halide_release_unused_device_allocations(void *user_context) {
+    ScopedMutexLock lock(&device_allocation_pools_mutex);
+    int result = 0;
+    for (halide_device_allocation_pool *pool = device_allocation_pools; pool; pool = pool->next) {
+        int err = pool->release_unused(user_context);
+        if (err != 0) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+WEAK void halide_enable_device_timing(void *user_context, bool flag) {
+    ScopedSpinLock lock(&halide_device_timing_lock);
+    halide_device_timing_flag = flag;
+    halide_device_timing_initialized = true;
+}
+
+WEAK bool halide_device_timing_is_enabled() {
+    ScopedSpinLock lock(&halide_device_timing_lock);
+    if (!halide_device_timing_initialized) {
+        const char *timing = getenv("HL_DEVICE_TIMING");
+        halide_device_timing_flag = timing && atoi(timing) != 0;
+        halide_device_timing_initialized = true;
+    }
+    return halide_device_timing_flag;
+}
+
+WEAK void halide_device_timing_add(bool is_copy, uint64_t ns) {
+    ScopedSpinLock lock(&halide_device_timing_lock);
+    if (is_copy) {
+        halide_device_timing_totals.copy_ns += ns;
+        halide_device_timing_totals.copies++;
+    } else {
+        halide_device_timing_totals.kernel_ns += ns;
+        halide_device_timing_totals.kernels++;
+    }
+}
+
+WEAK void halide_register_device_timer(struct halide_device_timer *timer) {
+    ScopedMutexLock lock(&device_timers_mutex);
+    timer->next = device_timers;
+    device_timers = timer;
+}
+
+WEAK int halide_get_device_timing(void *user_context, struct halide_device_timing_t *timing, bool reset) {
+    int result = 0;
+    {
+        ScopedMutexLock lock(&device_timers_mutex);
+        for (halide_device_timer *timer = device_timers; timer; timer = timer->next) {
+            int err = timer->collect(user_context);
+            if (err != 0) {
+                result = err;
+            }
+        }
+    }
+    ScopedSpinLock lock(&halide_device_timing_lock);
+    *timing = halide_device_timing_totals;
+    if (reset) {
+        halide_device_timing_totals.kernel_ns = 0;
+        halide_device_timing_totals.copy_ns = 0;
+        halide_device_timing_totals.kernels = 0;
+        halide_device_timing_totals.copies = 0;
+    }
+    return result;
+}
+
 /** Copy image data from device memory to host memory. This must be called
  * explicitly to copy back the results of a GPU-based filter. */
 WEAK int halide_copy_to_host(void *user_context, struct halide_buffer_t *buf) {
@@ -159,7 +297,9 @@ WEAK int copy_to_device_already_locked(void *user_context,
             debug(user_context) << "halide_copy_to_device " << buf << " dev_dirty is true error\n";
             return halide_error_code_copy_to_device_failed;
         } else {
+            uint64_t t_begin = halide_timeline_begin();
             result = device_interface->impl->copy_to_device(user_context, buf);
+            halide_timeline_end("copy_to_device", "copy", t_begin, buf->size_in_bytes(), 0);
             if (result == 0) {
                 buf->set_host_dirty(false);
             } else {
@@ -600,7 +740,9 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
         src->device_interface->impl->use_module();
     }
 
+    uint64_t t_begin = halide_timeline_begin();
     int err = halide_buffer_copy_already_locked(user_context, src, dst_device_interface, dst);
+    halide_timeline_end("buffer_copy", "copy", t_begin, dst->size_in_bytes(), 0);
 
     if (dst_device_interface) {
         dst_device_interface->impl->release_module();
@@ -612,6 +754,71 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
     return err;
 }
 
+WEAK int halide_copy_region_to_host(void *user_context, struct halide_buffer_t *buf,
+                                    const int *region_min, const int *region_extent) {
+    ScopedMutexLock lock(&device_copy_mutex);
+
+    int result = debug_log_and_validate_buf(user_context, buf, "halide_copy_region_to_host");
+    if (result != 0) {
+        return result;
+    }
+
+    if (!buf->device_dirty()) {
+        return 0;
+    }
+
+    const halide_device_interface_t *interface = buf->device_interface;
+    if (interface == NULL) {
+        return halide_error_code_no_device_interface;
+    }
+    if (buf->host == NULL) {
+        return halide_error_code_host_is_null;
+    }
+
+    // Make a host-only buffer aliasing the region of buf's host
+    // allocation, clamped to the bounds of buf.
+    halide_dimension_t *dims =
+        (halide_dimension_t *)__builtin_alloca(buf->dimensions * sizeof(halide_dimension_t));
+    halide_buffer_t dst = *buf;
+    dst.device = 0;
+    dst.device_interface = NULL;
+    dst.flags = 0;
+    dst.dim = dims;
+    int64_t offset = 0;
+    bool empty = false;
+    for (int i = 0; i < buf->dimensions; i++) {
+        int lo = max(region_min[i], buf->dim[i].min);
+        int hi = min(region_min[i] + region_extent[i], buf->dim[i].min + buf->dim[i].extent);
+        empty = empty || hi <= lo;
+        dims[i] = buf->dim[i];
+        dims[i].min = lo;
+        dims[i].extent = hi - lo;
+        offset += (int64_t)(lo - buf->dim[i].min) * buf->dim[i].stride;
+    }
+    if (!empty) {
+        dst.host = buf->host + offset * buf->type.bytes();
+
+        debug(user_context) << "halide_copy_region_to_host " << buf << " region: " << dst << "\n";
+
+        interface->impl->use_module();
+        uint64_t t_begin = halide_timeline_begin();
+        result = interface->impl->buffer_copy(user_context, buf, NULL, &dst);
+        halide_timeline_end("copy_region_to_host", "copy", t_begin, dst.size_in_bytes(), 0);
+        interface->impl->release_module();
+
+        if (result != 0) {
+            // Copying the whole buffer instead would clobber whatever
+            // was computed on the host outside of the region.
+            halide_error(user_context, "The device interface does not support copying a region "
+                         "of a buffer to the host, which hetero_split requires.\n");
+            return halide_error_code_copy_to_host_failed;
+        }
+        halide_msan_annotate_memory_is_initialized(user_context, dst.host, dst.size_in_bytes());
+    }
+
+    buf->set_device_dirty(false);
+    return 0;
+}
 
 WEAK int halide_default_device_crop(void *user_context,
                                     const struct halide_buffer_t *src,
@@ -0,0 +1,269 @@
+#include "HalideRuntime.h"
+#include "device_buffer_utils.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+// Runtime support for Funcs scheduled with distribute(). Each rank
+// computes a slice of the Func, and then sends the parts of it that
+// other ranks need to them, while it receives the parts it needs from
+// them. The ranks must start the exchanges of their pipelines in the
+// same order, so a rank must not run distributed pipelines
+// concurrently.
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK const halide_distributed_comm_t *distributed_comm = NULL;
+
+// A slab [min, min + extent) of the distributed dimension of a
+// buffer, on its way to or from another rank in a dense scratch
+// allocation.
+struct distributed_message {
+    void *request;
+    void *data;
+    int min, extent;
+    bool is_recv;
+};
+
+struct distributed_exchange {
+    halide_buffer_t *buf;
+    int dim;
+    int num_messages;
+    distributed_message *messages;
+};
+
+const int max_distributed_exchanges = 16;
+
+WEAK distributed_exchange distributed_exchanges[max_distributed_exchanges];
+WEAK int distributed_exchange_lock = 0;
+WEAK int distributed_next_tag = 0;
+
+// The largest tag every MPI implementation supports.
+const int max_distributed_tag = 32767;
+
+// Make a buffer for the slab [min, min + extent) of dimension dim of
+// buf. If dense_data is NULL, the slab is in place in buf. Otherwise
+// it is stored densely in dense_data.
+WEAK void make_slab(const halide_buffer_t *buf, int dim, int min, int extent,
+                    uint8_t *dense_data, halide_dimension_t *dims, halide_buffer_t *slab) {
+    *slab = *buf;
+    slab->dim = dims;
+    slab->device = 0;
+    slab->device_interface = NULL;
+    for (int i = 0; i < buf->dimensions; i++) {
+        dims[i] = buf->dim[i];
+    }
+    dims[dim].min = min;
+    dims[dim].extent = extent;
+    if (dense_data) {
+        int stride = 1;
+        for (int i = 0; i < buf->dimensions; i++) {
+            dims[i].stride = stride;
+            stride *= dims[i].extent;
+        }
+        slab->host = dense_data;
+    } else {
+        int64_t offset = (int64_t)(min - buf->dim[dim].min) * buf->dim[dim].stride;
+        slab->host = buf->host + offset * buf->type.bytes();
+    }
+}
+
+WEAK size_t slab_size_in_bytes(const halide_buffer_t *buf, int dim, int extent) {
+    size_t size = buf->type.bytes();
+    for (int i = 0; i < buf->dimensions; i++) {
+        size *= (i == dim) ? extent : buf->dim[i].extent;
+    }
+    return size;
+}
+
+// Wait for all of the messages of an exchange, unpack the ones
+// received into the buffer, and free them. Returns the first error.
+WEAK int finish_exchange(void *user_context, const distributed_exchange &ex) {
+    int result = 0;
+    halide_dimension_t dims[MAX_COPY_DIMS], dense_dims[MAX_COPY_DIMS];
+    for (int i = 0; i < ex.num_messages; i++) {
+        const distributed_message &m = ex.messages[i];
+        int err = m.request ? distributed_comm->wait(user_context, m.request) : 0;
+        if (err != 0) {
+            error(user_context) << "halide_distributed_exchange_end: waiting for a message failed with error "
+                                << err << "\n";
+            if (result == 0) {
+                result = err;
+            }
+        } else if (m.is_recv && m.request) {
+            halide_buffer_t slab, dense;
+            make_slab(ex.buf, ex.dim, m.min, m.extent, NULL, dims, &slab);
+            make_slab(ex.buf, ex.dim, m.min, m.extent, (uint8_t *)m.data, dense_dims, &dense);
+            copy_memory(make_buffer_copy(&dense, true, &slab, true), user_context);
+        }
+        halide_free(user_context, m.data);
+    }
+    halide_free(user_context, ex.messages);
+    return result;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK const halide_distributed_comm_t *halide_set_distributed_comm(const halide_distributed_comm_t *comm) {
+    const halide_distributed_comm_t *result = distributed_comm;
+    distributed_comm = comm;
+    return result;
+}
+
+WEAK int halide_distributed_rank(void *user_context) {
+    return distributed_comm ? distributed_comm->rank(user_context) : 0;
+}
+
+WEAK int halide_distributed_num_ranks(void *user_context) {
+    return distributed_comm ? distributed_comm->num_ranks(user_context) : 1;
+}
+
+WEAK int halide_distributed_exchange_begin(void *user_context, halide_buffer_t *buf, int dim,
+                                           int global_min, int global_extent,
+                                           int needed_min, int needed_extent) {
+    const halide_distributed_comm_t *comm = distributed_comm;
+    if (comm == NULL) {
+        return 0;
+    }
+    int num_ranks = comm->num_ranks(user_context);
+    if (num_ranks <= 1) {
+        return 0;
+    }
+    int rank = comm->rank(user_context);
+
+    if (buf->device_dirty()) {
+        error(user_context) << "halide_distributed_exchange_begin: the buffer is dirty on a device.\n";
+        return halide_error_code_generic_error;
+    }
+    if (buf->dimensions > MAX_COPY_DIMS || dim < 0 || dim >= buf->dimensions) {
+        error(user_context) << "halide_distributed_exchange_begin: can't exchange dimension " << dim
+                            << " of a buffer with " << buf->dimensions << " dimensions.\n";
+        return halide_error_code_generic_error;
+    }
+
+    // Find out which part of the buffer every rank needs.
+    int32_t needed[2] = {needed_min, needed_extent};
+    int32_t *all_needed = (int32_t *)halide_malloc(user_context, num_ranks * sizeof(needed));
+    distributed_message *messages =
+        (distributed_message *)halide_malloc(user_context, 2 * num_ranks * sizeof(distributed_message));
+    if (all_needed == NULL || messages == NULL) {
+        if (all_needed) {
+            halide_free(user_context, all_needed);
+        }
+        if (messages) {
+            halide_free(user_context, messages);
+        }
+        return halide_error_code_out_of_memory;
+    }
+    int err = comm->allgather(user_context, needed, all_needed, sizeof(needed));
+    if (err != 0) {
+        error(user_context) << "halide_distributed_exchange_begin: allgather failed with error " << err << "\n";
+        halide_free(user_context, all_needed);
+        halide_free(user_context, messages);
+        return err;
+    }
+
+    int tag;
+    {
+        ScopedSpinLock lock(&distributed_exchange_lock);
+        tag = distributed_next_tag;
+        distributed_next_tag = (distributed_next_tag + 1) % (max_distributed_tag + 1);
+    }
+
+    // Rank r owns [global_min + r * chunk, global_min + (r + 1) * chunk),
+    // clamped to the global range.
+    int chunk = (global_extent + num_ranks - 1) / num_ranks;
+    int global_end = global_min + global_extent;
+    int my_min = min(global_min + rank * chunk, global_end);
+    int my_end = min(my_min + chunk, global_end);
+
+    distributed_exchange ex = {buf, dim, 0, messages};
+    halide_dimension_t dims[MAX_COPY_DIMS];
+    for (int r = 0; r < num_ranks && err == 0; r++) {
+        if (r == rank) {
+            continue;
+        }
+        int r_min = min(global_min + r * chunk, global_end);
+        int r_end = min(r_min + chunk, global_end);
+
+        // Send the part of our slice that rank r needs, and receive
+        // the part of its slice that we need.
+        for (int is_recv = 0; is_recv < 2 && err == 0; is_recv++) {
+            int lo, hi;
+            if (is_recv) {
+                lo = max(r_min, needed_min);
+                hi = min(r_end, needed_min + needed_extent);
+            } else {
+                lo = max(my_min, all_needed[2 * r]);
+                hi = min(my_end, all_needed[2 * r] + all_needed[2 * r + 1]);
+            }
+            if (lo >= hi) {
+                continue;
+            }
+
+            size_t size = slab_size_in_bytes(buf, dim, hi - lo);
+            distributed_message &m = messages[ex.num_messages];
+            m.request = NULL;
+            m.data = halide_malloc(user_context, size);
+            m.min = lo;
+            m.extent = hi - lo;
+            m.is_recv = is_recv;
+            if (m.data == NULL) {
+                err = halide_error_code_out_of_memory;
+                break;
+            }
+            ex.num_messages++;
+
+            if (is_recv) {
+                err = comm->irecv(user_context, m.data, size, r, tag, &m.request);
+            } else {
+                halide_buffer_t dense;
+                make_slab(buf, dim, lo, hi - lo, (uint8_t *)m.data, dims, &dense);
+                copy_memory(make_buffer_copy(buf, true, &dense, true), user_context);
+                err = comm->isend(user_context, m.data, size, r, tag, &m.request);
+            }
+            if (err != 0) {
+                error(user_context) << "halide_distributed_exchange_begin: starting a message to rank "
+                                    << r << " failed with error " << err << "\n";
+            }
+        }
+    }
+    halide_free(user_context, all_needed);
+
+    if (err == 0) {
+        ScopedSpinLock lock(&distributed_exchange_lock);
+        for (int i = 0; i < max_distributed_exchanges; i++) {
+            if (distributed_exchanges[i].buf == NULL) {
+                distributed_exchanges[i] = ex;
+                return 0;
+            }
+        }
+        err = halide_error_code_generic_error;
+        error(user_context) << "halide_distributed_exchange_begin: too many exchanges in progress.\n";
+    }
+
+    // Don't leave messages in flight into memory we are about to free.
+    finish_exchange(user_context, ex);
+    return err;
+}
+
+WEAK int halide_distributed_exchange_end(void *user_context, halide_buffer_t *buf) {
+    distributed_exchange ex = {NULL, 0, 0, NULL};
+    {
+        ScopedSpinLock lock(&distributed_exchange_lock);
+        for (int i = 0; i < max_distributed_exchanges; i++) {
+            if (distributed_exchanges[i].buf == buf) {
+                ex = distributed_exchanges[i];
+                distributed_exchanges[i].buf = NULL;
+                break;
+            }
+        }
+    }
+    if (ex.buf == NULL) {
+        return 0;
+    }
+    return finish_exchange(user_context, ex);
+}
+
+}
@@ -291,3 +291,24 @@ WEAK int halide_error_integer_division_by_zero(void *user_context) {
 }
 
 }  // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK int strided_fallback_warned = 0;
+
+}}}  // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK int halide_strided_fallback_warning(void *user_context, const char *buffer_names) {
+    if (__sync_bool_compare_and_swap(&Halide::Runtime::Internal::strided_fallback_warned, 0, 1)) {
+        print(user_context)
+            << "Warning: " << buffer_names << " did not have a stride of one in dimension 0,"
+            << " so a slower general version of the pipeline is running. If the innermost"
+            << " dimension is always dense, constrain its stride with dim(0).set_stride(1)."
+            << " This warning is only printed once.\n";
+    }
+    return 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,107 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "printer.h"
+#include "scoped_spin_lock.h"
+
+// Runtime state for loops scheduled with hetero_split and no fixed
+// device fraction. The fraction of iterations given to the device is
+// tuned from how long each side took on previous runs.
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct hetero_split_state {
+    const char *loop_name;
+    float fraction;
+    int64_t start_ns, host_done_ns;
+};
+
+const int max_hetero_split_loops = 16;
+
+WEAK hetero_split_state hetero_split_loops[max_hetero_split_loops];
+WEAK int hetero_split_lock = 0;
+
+// Where to start before there is any timing information.
+const float initial_hetero_split_fraction = 0.5f;
+
+// Never give either side nothing, so that there is always some
+// timing information for both.
+const float min_hetero_split_fraction = 0.05f;
+const float max_hetero_split_fraction = 0.95f;
+
+WEAK hetero_split_state *find_hetero_split_state(const char *loop_name) {
+    for (int i = 0; i < max_hetero_split_loops; i++) {
+        hetero_split_state &s = hetero_split_loops[i];
+        if (s.loop_name == NULL) {
+            s.loop_name = loop_name;
+            s.fraction = initial_hetero_split_fraction;
+            s.start_ns = 0;
+            s.host_done_ns = 0;
+            return &s;
+        } else if (s.loop_name == loop_name || strcmp(s.loop_name, loop_name) == 0) {
+            return &s;
+        }
+    }
+    return NULL;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK float halide_hetero_split_fraction(void *user_context, const char *loop_name) {
+    ScopedSpinLock lock(&hetero_split_lock);
+    hetero_split_state *s = find_hetero_split_state(loop_name);
+    if (s == NULL) {
+        return initial_hetero_split_fraction;
+    }
+    s->start_ns = halide_current_time_ns(user_context);
+    s->host_done_ns = 0;
+    return s->fraction;
+}
+
+WEAK int halide_hetero_split_host_done(void *user_context, const char *loop_name) {
+    ScopedSpinLock lock(&hetero_split_lock);
+    hetero_split_state *s = find_hetero_split_state(loop_name);
+    if (s != NULL) {
+        s->host_done_ns = halide_current_time_ns(user_context);
+    }
+    return 0;
+}
+
+WEAK int halide_hetero_split_merged(void *user_context, const char *loop_name,
+                                    int device_iterations, int host_iterations) {
+    int64_t now = halide_current_time_ns(user_context);
+    ScopedSpinLock lock(&hetero_split_lock);
+    hetero_split_state *s = find_hetero_split_state(loop_name);
+    if (s == NULL || s->start_ns == 0 || s->host_done_ns == 0) {
+        return 0;
+    }
+
+    float host_ns = (float)(s->host_done_ns - s->start_ns);
+    float wait_ns = (float)(now - s->host_done_ns);
+    float f = s->fraction;
+    float target = f;
+    if (wait_ns > host_ns * 0.1f && device_iterations > 0 && host_iterations > 0) {
+        // The host waited for the device, so the device took about
+        // host_ns + wait_ns. Give each side a share of the iterations
+        // proportional to its rate.
+        float device_rate = device_iterations / (host_ns + wait_ns);
+        float host_rate = host_iterations / host_ns;
+        target = device_rate / (device_rate + host_rate);
+    } else {
+        // The device was done first, so it can take more. We can't
+        // tell by how much, so move towards it gradually.
+        target = f + (1.0f - f) * 0.1f;
+    }
+
+    // Smooth out the noise from individual runs.
+    f = 0.5f * (f + target);
+    s->fraction = max(min_hetero_split_fraction, min(f, max_hetero_split_fraction));
+
+    debug(user_context) << "halide_hetero_split_merged " << loop_name
+                        << " host: " << (int64_t)host_ns
+                        << "ns, waited for device: " << (int64_t)wait_ns
+                        << "ns, new device fraction: " << s->fraction << "\n";
+    return 0;
+}
+
+}
@@ -32,9 +32,12 @@ typedef int (*remote_run_fn)(halide_hexagon_handle_t, int,
 typedef int (*remote_release_library_fn)(halide_hexagon_handle_t);
 typedef int (*remote_poll_log_fn)(char *, int, int *);
 typedef void (*remote_poll_profiler_state_fn)(int *, int *);
+typedef void (*remote_poll_profiler_cycles_fn)(uint64_t *);
+typedef void (*remote_poll_profiler_hvx_lock_wait_fn)(uint64_t *);
 typedef int (*remote_profiler_set_current_func_fn)(int);
 typedef int (*remote_power_fn)();
 typedef int (*remote_power_mode_fn)(int);
+typedef int (*remote_thread_policy_fn)(int);
 typedef int (*remote_power_perf_fn)(int, unsigned int, unsigned int, int, unsigned int, unsigned int, int, int);
 
 typedef void (*host_malloc_init_fn)();
@@ -47,11 +50,14 @@ WEAK remote_run_fn remote_run = NULL;
 WEAK remote_release_library_fn remote_release_library = NULL;
 WEAK remote_poll_log_fn remote_poll_log = NULL;
 WEAK remote_poll_profiler_state_fn remote_poll_profiler_state = NULL;
+WEAK remote_poll_profiler_cycles_fn remote_poll_profiler_cycles = NULL;
+WEAK remote_poll_profiler_hvx_lock_wait_fn remote_poll_profiler_hvx_lock_wait = NULL;
 WEAK remote_profiler_set_current_func_fn remote_profiler_set_current_func = NULL;
 WEAK remote_power_fn remote_power_hvx_on = NULL;
 WEAK remote_power_fn remote_power_hvx_off = NULL;
 WEAK remote_power_perf_fn remote_set_performance = NULL;
 WEAK remote_power_mode_fn remote_set_performance_mode = NULL;
+WEAK remote_thread_policy_fn remote_set_thread_policy = NULL;
 
 WEAK host_malloc_init_fn host_malloc_init = NULL;
 WEAK host_malloc_init_fn host_malloc_deinit = NULL;
@@ -91,6 +97,105 @@ WEAK void get_remote_profiler_state(int *func, int *threads) {
     remote_poll_profiler_state(func, threads);
 }
 
+WEAK void get_remote_profiler_cycles(uint64_t *cycles) {
+    if (!remote_poll_profiler_cycles) {
+        error(NULL) << "Hexagon: remote_poll_profiler_cycles not found\n";
+    }
+
+    remote_poll_profiler_cycles(cycles);
+}
+
+WEAK void get_remote_profiler_lock_wait(uint64_t *cycles) {
+    if (!remote_poll_profiler_hvx_lock_wait) {
+        error(NULL) << "Hexagon: remote_poll_profiler_hvx_lock_wait not found\n";
+    }
+
+    remote_poll_profiler_hvx_lock_wait(cycles);
+}
+
+// State of automatic performance voting (see
+// halide_hexagon_set_performance_target).
+WEAK halide_mutex perf_vote_lock = { { 0 } };
+// The target duration of each offload, or 0 if voting is off.
+WEAK uint64_t perf_target_ns = 0;
+// The current vote, as a level of perf_level_mode.
+WEAK int perf_level = 0;
+// How many offloads in a row have finished well within the target.
+WEAK int perf_fast_runs = 0;
+
+const int perf_num_levels = 6;
+
+// The performance modes voted for, slowest first.
+WEAK halide_hexagon_power_mode_t perf_level_mode(int level) {
+    switch (level) {
+    case 0: return halide_hexagon_power_low_2;
+    case 1: return halide_hexagon_power_low;
+    case 2: return halide_hexagon_power_low_plus;
+    case 3: return halide_hexagon_power_nominal;
+    case 4: return halide_hexagon_power_nominal_plus;
+    default: return halide_hexagon_power_turbo;
+    }
+}
+
+WEAK int vote_perf_level(void *user_context, int level) {
+    perf_level = level;
+    perf_fast_runs = 0;
+    if (!remote_set_performance_mode) {
+        return 0;
+    }
+    debug(user_context) << "    remote_set_performance_mode(" << perf_level_mode(level) << ") -> ";
+    int result = remote_set_performance_mode(perf_level_mode(level));
+    debug(user_context) << "        " << result << "\n";
+    if (result != 0) {
+        error(user_context) << "remote_set_performance_mode failed.\n";
+    }
+    return result;
+}
+
+// Adjust the vote after an offload that took duration_ns. The vote
+// goes up as soon as an offload comes close to the target, but only
+// goes down after many offloads finish well within it, so it doesn't
+// oscillate between two levels.
+WEAK int update_perf_vote(void *user_context, uint64_t duration_ns) {
+    ScopedMutexLock lock(&perf_vote_lock);
+    if (perf_target_ns == 0) {
+        return 0;
+    }
+
+    // Adjacent levels differ in clock rate by roughly 25%, so an
+    // offload that took less than 60% of the target should still meet
+    // it one level down.
+    const int fast_runs_to_step_down = 16;
+    int level = perf_level;
+    if (duration_ns * 10 >= perf_target_ns * 6) {
+        perf_fast_runs = 0;
+    }
+    if (duration_ns * 2 > perf_target_ns * 3) {
+        // Far too slow. Don't miss more deadlines getting there one
+        // level at a time.
+        level = perf_num_levels - 1;
+    } else if (duration_ns * 10 > perf_target_ns * 9) {
+        level = min(level + 1, perf_num_levels - 1);
+    } else if (duration_ns * 10 < perf_target_ns * 6) {
+        if (++perf_fast_runs >= fast_runs_to_step_down) {
+            level = max(level - 1, 0);
+        }
+    }
+
+    if (level != perf_level) {
+        debug(user_context) << "Hexagon: offload took " << duration_ns / 1000
+                            << " us for a target of " << perf_target_ns / 1000 << " us\n";
+        return vote_perf_level(user_context, level);
+    }
+    return 0;
+}
+
+// Stop voting automatically, because the application has taken over.
+WEAK void stop_perf_vote() {
+    ScopedMutexLock lock(&perf_vote_lock);
+    perf_target_ns = 0;
+}
+
 template <typename T>
 __attribute__((always_inline)) void get_symbol(void *user_context, void *host_lib, const char* name, T &sym, bool required = true) {
     debug(user_context) << "    halide_get_library_symbol('" << name << "') -> \n";
@@ -144,6 +249,8 @@ WEAK int init_hexagon_runtime(void *user_context) {
     // These symbols are optional.
     get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_log", remote_poll_log, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_state", remote_poll_profiler_state, /* required */ false);
+    get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_cycles", remote_poll_profiler_cycles, /* required */ false);
+    get_symbol(user_context, host_lib, "halide_hexagon_remote_poll_profiler_hvx_lock_wait", remote_poll_profiler_hvx_lock_wait, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_profiler_set_current_func", remote_profiler_set_current_func, /* required */ false);
 
     // If these are unavailable, then the runtime always powers HVX on and so these are not necessary.
@@ -151,6 +258,7 @@ WEAK int init_hexagon_runtime(void *user_context) {
     get_symbol(user_context, host_lib, "halide_hexagon_remote_power_hvx_off", remote_power_hvx_off, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_set_performance", remote_set_performance, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_set_performance_mode", remote_set_performance_mode, /* required */ false);
+    get_symbol(user_context, host_lib, "halide_hexagon_remote_set_thread_policy", remote_set_thread_policy, /* required */ false);
 
     host_malloc_init();
 
@@ -357,9 +465,7 @@ WEAK int halide_hexagon_run(void *user_context,
                                            input_scalars);
     if (input_scalar_count < 0) return input_scalar_count;
 
-    #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
 
     // If remote profiling is supported, tell the profiler to call
     // get_remote_profiler_func to retrieve the current
@@ -367,6 +473,12 @@ WEAK int halide_hexagon_run(void *user_context,
     // will be billed to the calling Func.
     if (remote_poll_profiler_state) {
         halide_profiler_get_state()->get_remote_profiler_state = get_remote_profiler_state;
+        if (remote_poll_profiler_cycles) {
+            halide_profiler_get_state()->get_remote_profiler_cycles = get_remote_profiler_cycles;
+        }
+        if (remote_poll_profiler_hvx_lock_wait) {
+            halide_profiler_get_state()->get_remote_profiler_lock_wait = get_remote_profiler_lock_wait;
+        }
         if (remote_profiler_set_current_func) {
             remote_profiler_set_current_func(halide_profiler_get_state()->current_func);
         }
@@ -386,11 +498,13 @@ WEAK int halide_hexagon_run(void *user_context,
     }
 
     halide_profiler_get_state()->get_remote_profiler_state = NULL;
+    halide_profiler_get_state()->get_remote_profiler_cycles = NULL;
+    halide_profiler_get_state()->get_remote_profiler_lock_wait = NULL;
 
-    #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
     debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-    #endif
+
+    result = update_perf_vote(user_context, t_after - t_before);
 
     return result != 0 ? -1 : 0;
 }
@@ -834,6 +948,7 @@ WEAK int halide_hexagon_set_performance_mode(void *user_context, halide_hexagon_
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_set_performance_mode\n";
+    stop_perf_vote();
     if (!remote_set_performance_mode) {
         // This runtime doesn't support changing the performance target.
         return 0;
@@ -855,6 +970,7 @@ WEAK int halide_hexagon_set_performance(void *user_context, halide_hexagon_power
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_set_performance\n";
+    stop_perf_vote();
     if (!remote_set_performance) {
         // This runtime doesn't support changing the performance target.
         return 0;
@@ -879,6 +995,52 @@ WEAK int halide_hexagon_set_performance(void *user_context, halide_hexagon_power
     return 0;
 }
 
+WEAK int halide_hexagon_set_performance_target(void *user_context, uint64_t target_latency_us) {
+    int result = init_hexagon_runtime(user_context);
+    if (result != 0) return result;
+
+    debug(user_context) << "halide_hexagon_set_performance_target(" << target_latency_us << ")\n";
+    ScopedMutexLock lock(&perf_vote_lock);
+    bool was_voting = perf_target_ns != 0;
+    perf_target_ns = target_latency_us * 1000;
+    if (perf_target_ns == 0) {
+        // Back to the default vote.
+        if (was_voting && remote_set_performance_mode) {
+            result = remote_set_performance_mode(halide_hexagon_power_default);
+            if (result != 0) {
+                error(user_context) << "remote_set_performance_mode failed.\n";
+                return result;
+            }
+        }
+        return 0;
+    } else if (!was_voting) {
+        // Start in the middle, and let the offloads find the level.
+        return vote_perf_level(user_context, perf_num_levels / 2);
+    }
+    return 0;
+}
+
+WEAK int halide_hexagon_set_thread_policy(void *user_context, halide_hexagon_thread_policy_t policy) {
+    int result = init_hexagon_runtime(user_context);
+    if (result != 0) return result;
+
+    debug(user_context) << "halide_hexagon_set_thread_policy\n";
+    if (!remote_set_thread_policy) {
+        // This runtime only has the default policy.
+        return 0;
+    }
+
+    debug(user_context) << "    remote_set_thread_policy -> ";
+    result = remote_set_thread_policy(policy);
+    debug(user_context) << "        " << result << "\n";
+    if (result != 0) {
+        error(user_context) << "remote_set_thread_policy failed.\n";
+        return result;
+    }
+
+    return 0;
+}
+
 WEAK const halide_device_interface_t *halide_hexagon_device_interface() {
     return &hexagon_device_interface;
 }
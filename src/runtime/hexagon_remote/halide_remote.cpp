@@ -79,6 +79,65 @@ static bool use_dlopenbuf() {
     return dlopenbuf != NULL;
 }
 
+static void *get_library_symbol(void *lib, const char *name) {
+    if (use_dlopenbuf()) {
+        return dlsym(lib, name);
+    } else {
+        return mmap_dlsym(lib, name);
+    }
+}
+
+// The thread policy (a halide_hexagon_thread_policy_t) applied to
+// runtimes loaded from now on.
+int thread_policy = halide_hexagon_thread_policy_per_core;
+
+// The HVX lock wait counter of the last runtime loaded. Pipelines
+// offloaded from one host module share one runtime.
+typedef uint64_t (*lock_wait_cycles_fn)();
+lock_wait_cycles_fn hvx_lock_wait_cycles = NULL;
+
+// The number of HVX contexts pipelines can lock at once.
+static int hvx_context_count() {
+    // Bits 15:8 are the number of 128 byte contexts, bits 7:0 the
+    // number of 64 byte contexts. Pipelines are usually compiled for
+    // 128 byte vectors, and older DSPs can only run one size at a
+    // time, so count the 128 byte contexts if there are any.
+    int units = qurt_hvx_get_units();
+    int count = (units >> 8) & 0xff;
+    if (count == 0) {
+        count = units & 0xff;
+    }
+    return count > 0 ? count : 1;
+}
+
+// Set up a newly loaded library if it contains a Halide runtime.
+static void init_runtime(void *lib) {
+    // Pipelines run one after another on run_context's thread, so the
+    // HVX context a pipeline locks can be kept for the next one. It
+    // is released when HVX is powered off.
+    typedef void (*set_keep_locked_fn)(int);
+    set_keep_locked_fn set_keep_locked =
+        (set_keep_locked_fn)get_library_symbol(lib, "halide_qurt_hvx_set_keep_locked");
+    if (set_keep_locked) {
+        set_keep_locked(1);
+    }
+
+    lock_wait_cycles_fn lock_wait =
+        (lock_wait_cycles_fn)get_library_symbol(lib, "halide_qurt_hvx_lock_wait_cycles");
+    if (lock_wait) {
+        hvx_lock_wait_cycles = lock_wait;
+    }
+
+    if (thread_policy == halide_hexagon_thread_policy_per_hvx_context) {
+        typedef int (*set_num_threads_fn)(int);
+        set_num_threads_fn set_num_threads =
+            (set_num_threads_fn)get_library_symbol(lib, "halide_set_num_threads");
+        if (set_num_threads) {
+            set_num_threads(hvx_context_count());
+        }
+    }
+}
+
 int halide_hexagon_remote_load_library(const char *soname, int sonameLen,
                                        const unsigned char *code, int codeLen,
                                        handle_t *module_ptr) {
@@ -99,6 +158,8 @@ int halide_hexagon_remote_load_library(const char *soname, int sonameLen,
         }
     }
 
+    init_runtime(lib);
+
     *module_ptr = reinterpret_cast<handle_t>(lib);
 
     return 0;
@@ -122,9 +183,21 @@ int halide_hexagon_remote_power_hvx_on() {
     return 0;
 }
 
+// Unlock the HVX context kept by the thread pipelines run on, if any.
+static int release_kept_hvx_context(void **) {
+    if (qurt_hvx_get_mode() >= 0) {
+        qurt_hvx_unlock();
+    }
+    return 0;
+}
+
 int halide_hexagon_remote_power_hvx_off() {
     power_ref_count--;
     if (power_ref_count == 0) {
+        // This is the end of the session, so give back the HVX
+        // context for other users of the DSP.
+        run_context.run(release_kept_hvx_context, NULL);
+
         HAP_power_request_t request;
         request.type = HAP_power_set_HVX;
         request.hvx.power_up = FALSE;
@@ -137,6 +210,16 @@ int halide_hexagon_remote_power_hvx_off() {
     return 0;
 }
 
+int halide_hexagon_remote_set_thread_policy(int policy) {
+    if (policy != halide_hexagon_thread_policy_per_core &&
+        policy != halide_hexagon_thread_policy_per_hvx_context) {
+        log_printf("Unknown thread policy (%d)\n", policy);
+        return -1;
+    }
+    thread_policy = policy;
+    return 0;
+}
+
 int halide_hexagon_remote_set_performance(
     int set_mips,
     unsigned int mipsPerThread,
@@ -411,6 +494,14 @@ int halide_hexagon_remote_poll_profiler_state(int *func, int *threads) {
     *threads = halide_profiler_get_state()->active_threads;
     return 0;
 }
+int halide_hexagon_remote_poll_profiler_cycles(uint64 *cycles) {
+    *cycles = qurt_get_core_pcycles();
+    return 0;
+}
+int halide_hexagon_remote_poll_profiler_hvx_lock_wait(uint64 *cycles) {
+    *cycles = hvx_lock_wait_cycles ? hvx_lock_wait_cycles() : 0;
+    return 0;
+}
 int halide_hexagon_remote_profiler_set_current_func(int current_func) {
     halide_profiler_get_state()->current_func = current_func;
     return 0;
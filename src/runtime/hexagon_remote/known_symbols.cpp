@@ -22,6 +22,7 @@ extern "C" {
 // More symbols we need to support.
 extern int qurt_hvx_lock;
 extern int qurt_hvx_unlock;
+extern int qurt_hvx_get_mode;
 extern int __hexagon_muldf3;
 extern int __hexagon_divdf3;
 extern int __hexagon_adddf3;
@@ -108,6 +109,7 @@ void *get_known_symbol(const char *name) {
         {"halide_profiler_get_state", (char *)(&halide_profiler_get_state)},
         {"qurt_hvx_lock", (char *)(&qurt_hvx_lock)},
         {"qurt_hvx_unlock", (char *)(&qurt_hvx_unlock)},
+        {"qurt_hvx_get_mode", (char *)(&qurt_hvx_get_mode)},
 
         {"__hexagon_divdf3", (char *)(&__hexagon_divdf3)},
         {"__hexagon_muldf3", (char *)(&__hexagon_muldf3)},
@@ -194,6 +194,8 @@ int read_memory(void *dest, int src, int size) {
 
 // A frequently-updated local copy of the remote profiler state.
 int profiler_current_func;
+// The number of cycles simulated so far.
+uint64_t profiler_cycles;
 
 int send_message(int msg, const std::vector<int> &arguments) {
     assert(sim);
@@ -263,6 +265,7 @@ int send_message(int msg, const std::vector<int> &arguments) {
         do {
             HEX_4u_t cycles;
             state = sim->Step(1000, &cycles);
+            profiler_cycles += cycles;
             if (read_memory(&msg, remote_msg, 4) != 0) {
                 return -1;
             }
@@ -495,6 +498,11 @@ int halide_hexagon_remote_poll_profiler_state(int *func, int *threads) {
     return 0;
 }
 DLLEXPORT
+int halide_hexagon_remote_poll_profiler_cycles(uint64_t *cycles) {
+    *cycles = profiler_cycles;
+    return 0;
+}
+DLLEXPORT
 int halide_hexagon_remote_profiler_set_current_func(int current_func) {
     profiler_current_func = current_func;
     return 0;
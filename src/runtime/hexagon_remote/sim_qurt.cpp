@@ -4,8 +4,14 @@ extern "C" {
 
 // Provide an implementation of qurt to redirect to the appropriate
 // simulator calls.
+
+// The mode of the HVX context held, or -1 if none. The simulator only
+// runs one thread.
+static int hvx_mode = -1;
+
 int qurt_hvx_lock(int mode) {
     SIM_ACQUIRE_HVX;
+    hvx_mode = mode;
     if (mode == 0) {
         SIM_CLEAR_HVX_DOUBLE_MODE;
     } else {
@@ -16,7 +22,12 @@ int qurt_hvx_lock(int mode) {
 
 int qurt_hvx_unlock() {
     SIM_RELEASE_HVX;
+    hvx_mode = -1;
     return 0;
 }
 
+int qurt_hvx_get_mode() {
+    return hvx_mode;
+}
+
 }  // extern "C"
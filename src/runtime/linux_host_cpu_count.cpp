@@ -1,11 +1,247 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 extern "C" {
 
 extern long sysconf(int);
+extern int open(const char *, int, ...);
+extern ssize_t read(int, void *, size_t);
+extern int close(int);
+extern int sched_getcpu();
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int madvise(void *addr, size_t length, int advice);
+extern int syscall(int num, ...);
+extern int uname(void *buf);
+extern void *pthread_self();
 
 WEAK int halide_host_cpu_count() {
     return sysconf(84);
 }
 
 }
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+#define MAX_NUMA_CPUS 1024
+#define MAX_NUMA_NODES 64
+
+// The NUMA topology as reported by sysfs. Nodes are renumbered
+// densely, so node indices are always in [0, num_nodes). The other
+// fields may only be read after seeing initialized set, with an
+// acquire load.
+struct numa_topology_t {
+    int initialized;
+    int num_nodes;
+    uint64_t node_cpus[MAX_NUMA_NODES][MAX_NUMA_CPUS / 64];
+    int8_t cpu_node[MAX_NUMA_CPUS];
+};
+
+WEAK numa_topology_t numa_topology = {};
+WEAK halide_mutex numa_topology_mutex = { { 0 } };
+
+// Parse a sysfs list such as "0-3,8-11\n" into a bit mask. Returns
+// false if the file can't be read.
+WEAK bool read_sysfs_list(const char *path, uint64_t *bits, int max_bits) {
+    char buf[1024];
+    int fd = open(path, 0 /* O_RDONLY */);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) {
+        return false;
+    }
+    buf[len] = 0;
+
+    const char *p = buf;
+    while (*p >= '0' && *p <= '9') {
+        int first = 0;
+        while (*p >= '0' && *p <= '9') {
+            first = first * 10 + (*p++ - '0');
+        }
+        int last = first;
+        if (*p == '-') {
+            p++;
+            last = 0;
+            while (*p >= '0' && *p <= '9') {
+                last = last * 10 + (*p++ - '0');
+            }
+        }
+        for (int i = first; i <= last && i < max_bits; i++) {
+            bits[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return true;
+}
+
+WEAK void read_numa_topology() {
+    numa_topology.num_nodes = 1;
+
+    uint64_t online[MAX_NUMA_NODES / 64] = {0};
+    if (!read_sysfs_list("/sys/devices/system/node/online", online, MAX_NUMA_NODES)) {
+        return;
+    }
+
+    int num_nodes = 0;
+    for (int n = 0; n < MAX_NUMA_NODES; n++) {
+        if (!(online[n / 64] & ((uint64_t)1 << (n % 64)))) {
+            continue;
+        }
+        char path[64];
+        char *dst = halide_string_to_string(path, path + sizeof(path), "/sys/devices/system/node/node");
+        dst = halide_int64_to_string(dst, path + sizeof(path), n, 1);
+        halide_string_to_string(dst, path + sizeof(path), "/cpulist");
+        if (read_sysfs_list(path, numa_topology.node_cpus[num_nodes], MAX_NUMA_CPUS)) {
+            for (int c = 0; c < MAX_NUMA_CPUS; c++) {
+                if (numa_topology.node_cpus[num_nodes][c / 64] & ((uint64_t)1 << (c % 64))) {
+                    numa_topology.cpu_node[c] = num_nodes;
+                }
+            }
+            num_nodes++;
+        }
+    }
+    if (num_nodes > 0) {
+        numa_topology.num_nodes = num_nodes;
+    }
+}
+
+// Read the topology on first use. Concurrent callers wait for the
+// first one to finish.
+WEAK void init_numa_topology() {
+    if (__atomic_load_n(&numa_topology.initialized, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    ScopedMutexLock lock(&numa_topology_mutex);
+    if (numa_topology.initialized) {
+        return;
+    }
+    read_numa_topology();
+    __atomic_store_n(&numa_topology.initialized, 1, __ATOMIC_RELEASE);
+}
+
+// The subset of struct perf_event_attr we need. This is the original
+// layout (PERF_ATTR_SIZE_VER0), which all kernels accept.
+struct perf_event_attr_t {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+// The syscall number of perf_event_open varies across architectures,
+// and this module is shared by all of them, so ask the kernel which
+// one we're on. Returns -1 if we don't know.
+WEAK int perf_event_open_syscall() {
+    // struct utsname is six 65-byte strings. We want the fifth.
+    char buf[6 * 65];
+    if (uname(buf) != 0) {
+        return -1;
+    }
+    const char *machine = buf + 4 * 65;
+    const bool is_64 = sizeof(void *) == 8;
+    if (machine[0] == 'x' && machine[1] == '8' && machine[2] == '6') {
+        return is_64 ? 298 : 336;
+    } else if (machine[0] == 'i' && machine[2] == '8' && machine[3] == '6') {
+        return 336;
+    } else if (machine[0] == 'a' && machine[1] == 'a' && machine[2] == 'r') {
+        // aarch64, possibly running 32-bit arm code.
+        return is_64 ? 241 : 364;
+    } else if (machine[0] == 'a' && machine[1] == 'r' && machine[2] == 'm') {
+        return 364;
+    }
+    return -1;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    init_numa_topology();
+    return numa_topology.num_nodes;
+}
+
+WEAK int halide_host_current_numa_node() {
+    // Called on hot paths, so don't read the topology here. Nothing
+    // is pinned to a node until something else has.
+    if (!__atomic_load_n(&numa_topology.initialized, __ATOMIC_ACQUIRE) ||
+        numa_topology.num_nodes <= 1) {
+        return 0;
+    }
+    int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= MAX_NUMA_CPUS) {
+        return 0;
+    }
+    return numa_topology.cpu_node[cpu];
+}
+
+WEAK int halide_host_pin_thread_to_numa_node(int node) {
+    init_numa_topology();
+    if (numa_topology.num_nodes <= 1 || node < 0 || node >= numa_topology.num_nodes) {
+        return 0;
+    }
+    return sched_setaffinity(0, sizeof(numa_topology.node_cpus[node]), numa_topology.node_cpus[node]);
+}
+
+WEAK uint64_t halide_host_current_thread_id() {
+    return (uint64_t)pthread_self();
+}
+
+WEAK int halide_host_open_perf_counter(int counter) {
+    static int nr = -2;
+    if (nr == -2) {
+        nr = perf_event_open_syscall();
+    }
+    if (nr < 0) {
+        return -1;
+    }
+
+    // PERF_TYPE_HARDWARE events, in halide_profiler_counter_t order:
+    // CPU_CYCLES, INSTRUCTIONS, CACHE_MISSES (usually the last level
+    // cache), STALLED_CYCLES_BACKEND.
+    static const uint64_t configs[] = {0, 1, 3, 8};
+    if (counter < 0 || counter >= (int)(sizeof(configs) / sizeof(configs[0]))) {
+        return -1;
+    }
+
+    perf_event_attr_t attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = 0;
+    attr.size = sizeof(attr);
+    attr.config = configs[counter];
+    // Count user space only (exclude_kernel, exclude_hv), so that
+    // this works without privileges at the default
+    // perf_event_paranoid level.
+    attr.flags = (1 << 5) | (1 << 6);
+    // Count the calling thread, on any cpu.
+    return syscall(nr, &attr, 0, -1, -1, 0);
+}
+
+WEAK int halide_host_read_perf_counter(int handle, uint64_t *value) {
+    return read(handle, value, sizeof(*value)) == sizeof(*value) ? 0 : -1;
+}
+
+WEAK void halide_host_close_perf_counter(int handle) {
+    close(handle);
+}
+
+WEAK int halide_host_advise_huge_pages(void *ptr, size_t size) {
+    // Fails harmlessly with EINVAL on kernels built without
+    // transparent huge pages.
+    return madvise(ptr, size, 14 /* MADV_HUGEPAGE */);
+}
+
+}
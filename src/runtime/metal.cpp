@@ -1,5 +1,6 @@
 #include "HalideRuntimeMetal.h"
 #include "scoped_spin_lock.h"
+#include "device_allocation_cache.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
 #include "printer.h"
@@ -11,6 +12,8 @@
 extern "C" {
 extern objc_id MTLCreateSystemDefaultDevice();
 extern struct ObjectiveCClass _NSConcreteGlobalBlock;
+void *dispatch_data_create(const void *buffer, size_t size, void *queue, void *destructor);
+void dispatch_release(void *object);
 }
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Metal {
@@ -25,6 +28,7 @@ struct mtl_compute_pipeline_state;
 struct mtl_library;
 struct mtl_function;
 struct mtl_compile_options;
+struct mtl_heap;
 
 WEAK mtl_buffer *new_buffer(mtl_device *device, size_t length) {
     typedef mtl_buffer *(*new_buffer_method)(objc_id device, objc_sel sel, size_t length, size_t options);
@@ -33,6 +37,48 @@ WEAK mtl_buffer *new_buffer(mtl_device *device, size_t length) {
                      length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */);
 }
 
+// Returns NULL if the device can't make shared heaps whose resources are
+// hazard tracked like the buffers made by new_buffer.
+WEAK mtl_heap *new_heap(mtl_device *device, size_t size) {
+    objc_id descriptor = objc_msgSend(objc_getClass("MTLHeapDescriptor"), sel_getUid("alloc"));
+    descriptor = objc_msgSend(descriptor, sel_getUid("init"));
+    if (descriptor == NULL) {
+        return NULL;
+    }
+
+    typedef bool (*responds_to_selector_method)(objc_id obj, objc_sel sel_1, objc_sel sel_2);
+    responds_to_selector_method method1 = (responds_to_selector_method)&objc_msgSend;
+    objc_sel set_hazard_tracking_mode_sel = sel_getUid("setHazardTrackingMode:");
+    if (!(*method1)(descriptor, sel_getUid("respondsToSelector:"), set_hazard_tracking_mode_sel)) {
+        release_ns_object(descriptor);
+        return NULL;
+    }
+
+    typedef void (*set_size_t_method)(objc_id obj, objc_sel sel, size_t value);
+    set_size_t_method method2 = (set_size_t_method)&objc_msgSend;
+    (*method2)(descriptor, sel_getUid("setSize:"), size);
+    (*method2)(descriptor, sel_getUid("setStorageMode:"), 0 /* MTLStorageModeShared */);
+    (*method2)(descriptor, set_hazard_tracking_mode_sel, 2 /* MTLHazardTrackingModeTracked */);
+
+    mtl_heap *heap = (mtl_heap *)objc_msgSend(device, sel_getUid("newHeapWithDescriptor:"), descriptor);
+    release_ns_object(descriptor);
+    return heap;
+}
+
+// Returns NULL if the heap doesn't have room for the buffer.
+WEAK mtl_buffer *new_buffer_from_heap(mtl_heap *heap, size_t length) {
+    typedef mtl_buffer *(*new_buffer_method)(objc_id heap, objc_sel sel, size_t length, size_t options);
+    new_buffer_method method = (new_buffer_method)&objc_msgSend;
+    return (*method)(heap, sel_getUid("newBufferWithLength:options:"),
+                     length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */);
+}
+
+WEAK size_t heap_used_size(mtl_heap *heap) {
+    typedef size_t (*used_size_method)(objc_id obj, objc_sel sel);
+    used_size_method method = (used_size_method)&objc_msgSend;
+    return (*method)(heap, sel_getUid("usedSize"));
+}
+
 WEAK mtl_command_queue *new_command_queue(mtl_device *device) {
     return (mtl_command_queue *)objc_msgSend(device, sel_getUid("newCommandQueue"));
 }
@@ -157,6 +203,30 @@ WEAK mtl_library *new_library_with_source(mtl_device *device, const char *source
     return result;
 }
 
+// A library compiled ahead of time, with the metallib target feature.
+WEAK bool is_metallib(const char *source, size_t source_len) {
+    return source_len >= 4 && memcmp(source, "MTLB", 4) == 0;
+}
+
+WEAK mtl_library *new_library_with_data(mtl_device *device, const char *data, size_t data_len) {
+    objc_id error_return;
+    // A null destructor makes dispatch copy the data.
+    void *dispatch_data = dispatch_data_create(data, data_len, NULL, NULL);
+
+    typedef mtl_library *(*new_library_with_data_method)(objc_id device, objc_sel sel, void *data, objc_id *error_return);
+    new_library_with_data_method method = (new_library_with_data_method)&objc_msgSend;
+    mtl_library *result = (*method)(device, sel_getUid("newLibraryWithData:error:"),
+                                    dispatch_data, &error_return);
+
+    dispatch_release(dispatch_data);
+
+    if (result == NULL) {
+        ns_log_object(error_return);
+    }
+
+    return result;
+}
+
 WEAK mtl_function *new_function_with_name(mtl_library *library, const char *name, size_t name_len) {
     objc_id name_str = wrap_string_as_ns_string(name, name_len);
     typedef mtl_function *(*new_function_with_name_method)(objc_id library, objc_sel sel, objc_id name);
@@ -198,10 +268,30 @@ WEAK void wait_until_completed(mtl_command_buffer *buffer) {
     objc_msgSend(buffer, sel_getUid("waitUntilCompleted"));
 }
 
+// The GPUStartTime or GPUEndTime of a completed command buffer, in
+// seconds, or zero if the OS doesn't report it.
+WEAK double command_buffer_gpu_time(mtl_command_buffer *buffer, const char *name) {
+    typedef bool (*responds_to_selector_method)(objc_id obj, objc_sel sel_1, objc_sel sel_2);
+    responds_to_selector_method method1 = (responds_to_selector_method)&objc_msgSend;
+    objc_sel sel = sel_getUid(name);
+    if (!(*method1)(buffer, sel_getUid("respondsToSelector:"), sel)) {
+        return 0;
+    }
+    typedef double (*gpu_time_method)(objc_id buffer, objc_sel sel);
+    gpu_time_method method2 = (gpu_time_method)&objc_msgSend;
+    return (*method2)(buffer, sel);
+}
+
 WEAK void *buffer_contents(mtl_buffer *buffer) {
     return objc_msgSend(buffer, sel_getUid("contents"));
 }
 
+WEAK size_t buffer_length(mtl_buffer *buffer) {
+    typedef size_t (*length_method)(objc_id buffer, objc_sel sel);
+    length_method method = (length_method)&objc_msgSend;
+    return (*method)(buffer, sel_getUid("length"));
+}
+
 extern WEAK halide_device_interface_t metal_device_interface;
 
 volatile int WEAK thread_lock = 0;
@@ -223,6 +313,127 @@ struct module_state {
 };
 WEAK module_state *state_list = NULL;
 
+// Device allocations freed while halide_can_reuse_device_allocations is
+// true, keyed by the device they were made on.
+WEAK device_allocation_cache allocation_cache;
+
+WEAK void free_cached_allocation(void *user_context, void *context, uint64_t handle) {
+    debug(user_context) << "Metal - Releasing: cached buffer " << (void *)handle << "\n";
+    release_ns_object((mtl_buffer *)handle);
+}
+
+// Whether device_malloc suballocates buffers from MTLHeaps. Set by
+// halide_metal_set_heap_allocation, or by the HL_METAL_HEAP_ALLOCATION
+// environment variable.
+WEAK bool heap_allocation = false;
+WEAK bool heap_allocation_initialized = false;
+volatile int WEAK heap_allocation_lock = 0;
+
+WEAK bool use_heap_allocation() {
+    ScopedSpinLock spinlock(&heap_allocation_lock);
+    if (!heap_allocation_initialized) {
+        const char *var = getenv("HL_METAL_HEAP_ALLOCATION");
+        heap_allocation = (var && atoi(var) != 0);
+        heap_allocation_initialized = true;
+    }
+    return heap_allocation;
+}
+
+// The heaps that small device allocations are suballocated from. Each
+// heap is created at heap_block_size; larger allocations get buffers of
+// their own, as they gain little from sharing a heap. Only touched with
+// the context acquired.
+struct metal_heap {
+    mtl_device *device;
+    mtl_heap *heap;
+    metal_heap *next;
+};
+WEAK metal_heap *heaps = NULL;
+const size_t heap_block_size = 16 * 1024 * 1024;
+const size_t max_heap_allocation_size = heap_block_size / 4;
+
+// The last device on which creating a heap failed. We don't try again on
+// it, as the failure usually means the device or OS doesn't support
+// shared, tracked heaps.
+WEAK mtl_device *heapless_device = NULL;
+
+// Suballocate a buffer from one of the heaps made on 'device', making a
+// new heap if none of them has room. Returns NULL if the buffer should
+// be allocated on its own instead.
+WEAK mtl_buffer *allocate_from_heap(void *user_context, mtl_device *device, size_t size) {
+    if (size > max_heap_allocation_size || device == heapless_device) {
+        return NULL;
+    }
+    for (metal_heap *h = heaps; h; h = h->next) {
+        if (h->device == device) {
+            mtl_buffer *buffer = new_buffer_from_heap(h->heap, size);
+            if (buffer) {
+                return buffer;
+            }
+        }
+    }
+
+    debug(user_context) << "Metal - Allocating: new_heap of " << (uint64_t)heap_block_size << " bytes\n";
+    mtl_heap *heap = new_heap(device, heap_block_size);
+    if (heap == NULL) {
+        debug(user_context) << "    heap creation failed; not suballocating on this device\n";
+        heapless_device = device;
+        return NULL;
+    }
+    metal_heap *h = (metal_heap *)malloc(sizeof(metal_heap));
+    if (h == NULL) {
+        release_ns_object(heap);
+        return NULL;
+    }
+    h->device = device;
+    h->heap = heap;
+    h->next = heaps;
+    heaps = h;
+    return new_buffer_from_heap(heap, size);
+}
+
+// Release the heaps made on 'device'. If 'only_unused' is set, only
+// release the heaps no buffer is suballocated from.
+WEAK void release_heaps(void *user_context, mtl_device *device, bool only_unused) {
+    metal_heap **prev_ptr = &heaps;
+    while (*prev_ptr) {
+        metal_heap *h = *prev_ptr;
+        if (h->device == device && (!only_unused || heap_used_size(h->heap) == 0)) {
+            debug(user_context) << "Metal - Releasing: new_heap " << h->heap << "\n";
+            release_ns_object(h->heap);
+            *prev_ptr = h->next;
+            free(h);
+        } else {
+            prev_ptr = &h->next;
+        }
+    }
+    if (heapless_device == device) {
+        heapless_device = NULL;
+    }
+}
+
+// Kernel dispatches and device to device copies are encoded into a
+// single command buffer, which is only committed when its results are
+// needed: by a device sync, by host access to a buffer, or at the end
+// of the pipeline. Errors are reported by the completed handler rather
+// than waited for. We only wait for the last committed command buffer,
+// which completes after those committed before it on the same queue.
+// These are retained, and only touched with the context acquired.
+WEAK mtl_command_buffer *pending_command_buffer = NULL;
+WEAK mtl_command_queue *pending_command_buffer_queue = NULL;
+WEAK mtl_command_buffer *last_committed_command_buffer = NULL;
+
+// Command buffers committed while device timing is enabled (see
+// halide_enable_device_timing), retained until their GPU times are
+// collected, when the timing is read or the list fills up. Dispatches
+// and device to device copies share command buffers, so all of their
+// time is counted as kernel time. Also only touched with the context
+// acquired.
+const int max_timed_command_buffers = 64;
+WEAK mtl_command_buffer *timed_command_buffers[max_timed_command_buffers];
+WEAK int num_timed_command_buffers = 0;
+WEAK halide_device_timer metal_device_timer;
+
 // API Capabilities.  If more capabilities need to be checked,
 // this can be refactored to something more robust/general.
 WEAK bool metal_api_supports_set_bytes;
@@ -373,6 +584,77 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     &command_buffer_completed_handler_descriptor
 };
 
+WEAK void collect_timed_command_buffers() {
+    for (int i = 0; i < num_timed_command_buffers; i++) {
+        mtl_command_buffer *buffer = timed_command_buffers[i];
+        wait_until_completed(buffer);
+        double start = command_buffer_gpu_time(buffer, "GPUStartTime");
+        double end = command_buffer_gpu_time(buffer, "GPUEndTime");
+        if (end > start) {
+            halide_device_timing_add(false, (uint64_t)((end - start) * 1e9));
+        }
+        release_ns_object(buffer);
+    }
+    num_timed_command_buffers = 0;
+}
+
+WEAK int collect_metal_device_timing(void *user_context);
+
+WEAK void commit_pending_command_buffer() {
+    if (pending_command_buffer == NULL) {
+        return;
+    }
+    commit_command_buffer(pending_command_buffer);
+    if (halide_device_timing_is_enabled()) {
+        if (metal_device_timer.collect == NULL) {
+            metal_device_timer.collect = collect_metal_device_timing;
+            halide_register_device_timer(&metal_device_timer);
+        }
+        if (num_timed_command_buffers == max_timed_command_buffers) {
+            collect_timed_command_buffers();
+        }
+        retain_ns_object(pending_command_buffer);
+        timed_command_buffers[num_timed_command_buffers++] = pending_command_buffer;
+    }
+    if (last_committed_command_buffer) {
+        release_ns_object(last_committed_command_buffer);
+    }
+    last_committed_command_buffer = pending_command_buffer;
+    pending_command_buffer = NULL;
+    pending_command_buffer_queue = NULL;
+}
+
+// The command buffer to encode the next commands on 'queue' into.
+WEAK mtl_command_buffer *get_pending_command_buffer(void *user_context, mtl_command_queue *queue) {
+    if (pending_command_buffer && pending_command_buffer_queue != queue) {
+        commit_pending_command_buffer();
+    }
+    if (pending_command_buffer == NULL) {
+        mtl_command_buffer *command_buffer = new_command_buffer(queue);
+        if (command_buffer == NULL) {
+            return NULL;
+        }
+        // The command buffer is autoreleased, and must outlive the pool
+        // of the current call.
+        retain_ns_object(command_buffer);
+        add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
+        debug(user_context) << "Metal - Allocating: command buffer " << command_buffer << "\n";
+        pending_command_buffer = command_buffer;
+        pending_command_buffer_queue = queue;
+    }
+    return pending_command_buffer;
+}
+
+WEAK int collect_metal_device_timing(void *user_context) {
+    MetalContextHolder metal_context(user_context, true);
+    if (metal_context.error != 0) {
+        return metal_context.error;
+    }
+    commit_pending_command_buffer();
+    collect_timed_command_buffers();
+    return 0;
+}
+
 }}}} // namespace Halide::Runtime::Internal::Metal
 
 using namespace Halide::Runtime::Internal::Metal;
@@ -413,7 +695,27 @@ WEAK int halide_metal_device_malloc(void *user_context, halide_buffer_t* buf) {
         return halide_error_code_out_of_memory;
     }
 
-    mtl_buffer *metal_buf = new_buffer(metal_context.device, size);
+    mtl_buffer *metal_buf = NULL;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        device_allocation_cache_register(&allocation_cache, halide_metal_release_unused_device_allocations);
+        size = device_allocation_size_class(size);
+        uint64_t cached;
+        if (device_allocation_cache_take(&allocation_cache, metal_context.device, size, &cached)) {
+            metal_buf = (mtl_buffer *)cached;
+            debug(user_context) << "    reusing cached buffer " << metal_buf << "\n";
+        }
+    }
+    if (metal_buf == 0 && use_heap_allocation()) {
+        metal_buf = allocate_from_heap(user_context, metal_context.device, size);
+    }
+    if (metal_buf == 0) {
+        metal_buf = new_buffer(metal_context.device, size);
+    }
+    if (metal_buf == 0 && !device_allocation_cache_empty(&allocation_cache)) {
+        // Return the unused allocations to the driver and try again.
+        device_allocation_cache_release(user_context, &allocation_cache, metal_context.device, free_cached_allocation);
+        metal_buf = new_buffer(metal_context.device, size);
+    }
     if (metal_buf == 0) {
         free(handle);
         error(user_context) << "Metal: Failed to allocate buffer of size " << (int64_t)size << ".\n";
@@ -449,7 +751,18 @@ WEAK int halide_metal_device_free(void *user_context, halide_buffer_t* buf) {
     device_handle *handle = (device_handle *)buf->device;
     halide_assert(user_context, (((device_handle *)buf->device)->offset == 0) && "halide_metal_device_free on buffer obtained from halide_device_crop");
 
-    release_ns_object(handle->buf);
+    bool cached = false;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        MetalContextHolder metal_context(user_context, false);
+        cached = (metal_context.error == 0 && metal_context.device != NULL &&
+                  device_allocation_cache_put(user_context, &allocation_cache, metal_context.device,
+                                              buffer_length(handle->buf), (uint64_t)handle->buf));
+    }
+    if (cached) {
+        debug(user_context) << "    caching buffer " << handle->buf << "\n";
+    } else {
+        release_ns_object(handle->buf);
+    }
     free(handle);
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -490,11 +803,20 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
         uint64_t t_before_compile = halide_current_time_ns(user_context);
         #endif
 
-        debug(user_context) << "Metal - Allocating: new_library_with_source " << (*state)->library << "\n";
-        (*state)->library = new_library_with_source(metal_context.device, source, source_size);
-        if ((*state)->library == 0) {
-            error(user_context) << "Metal: new_library_with_source failed.\n";
-            return -1;
+        if (is_metallib(source, source_size)) {
+            debug(user_context) << "Metal - Allocating: new_library_with_data " << (*state)->library << "\n";
+            (*state)->library = new_library_with_data(metal_context.device, source, source_size);
+            if ((*state)->library == 0) {
+                error(user_context) << "Metal: new_library_with_data failed.\n";
+                return -1;
+            }
+        } else {
+            debug(user_context) << "Metal - Allocating: new_library_with_source " << (*state)->library << "\n";
+            (*state)->library = new_library_with_source(metal_context.device, source, source_size);
+            if ((*state)->library == 0) {
+                error(user_context) << "Metal: new_library_with_source failed.\n";
+                return -1;
+            }
         }
 
         #ifdef DEBUG_RUNTIME
@@ -513,18 +835,24 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
 
 namespace {
 
-inline void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
-    mtl_command_buffer *sync_command_buffer = new_command_buffer(queue);
-    if (buffer != NULL) {
+inline void halide_metal_device_sync_internal(void *user_context, mtl_command_queue *queue, struct halide_buffer_t *buffer) {
+    if (buffer != NULL && buffer->device) {
         mtl_buffer *metal_buffer = ((device_handle *)buffer->device)->buf;
         if (is_buffer_managed(metal_buffer)) {
-            mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(sync_command_buffer);
-            synchronize_resource(blit_encoder, metal_buffer);
-            end_encoding(blit_encoder);
+            mtl_command_buffer *sync_command_buffer = get_pending_command_buffer(user_context, queue);
+            if (sync_command_buffer) {
+                mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(sync_command_buffer);
+                synchronize_resource(blit_encoder, metal_buffer);
+                end_encoding(blit_encoder);
+            }
         }
     }
-    commit_command_buffer(sync_command_buffer);
-    wait_until_completed(sync_command_buffer);
+    commit_pending_command_buffer();
+    if (last_committed_command_buffer) {
+        wait_until_completed(last_committed_command_buffer);
+        release_ns_object(last_committed_command_buffer);
+        last_committed_command_buffer = NULL;
+    }
 }
 
 }
@@ -539,7 +867,7 @@ WEAK int halide_metal_device_sync(void *user_context, struct halide_buffer_t *bu
         return metal_context.error;
     }
 
-    halide_metal_device_sync_internal(metal_context.queue, buffer);
+    halide_metal_device_sync_internal(user_context, metal_context.queue, buffer);
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -561,7 +889,12 @@ WEAK int halide_metal_device_release(void *user_context) {
     }
 
     if (device) {
-        halide_metal_device_sync_internal(queue, NULL);
+        halide_metal_device_sync_internal(user_context, queue, NULL);
+        collect_timed_command_buffers();
+
+        // Return the cached allocations made on this device to the driver.
+        device_allocation_cache_release(user_context, &allocation_cache, acquired_device, free_cached_allocation);
+        release_heaps(user_context, acquired_device, false);
 
         // Unload the modules attached to this device. Note that the list
         // nodes themselves are not freed, only the program objects are
@@ -595,6 +928,33 @@ WEAK int halide_metal_device_release(void *user_context) {
     return 0;
 }
 
+WEAK void halide_metal_commit_command_buffer(void *user_context, void *obj) {
+    MetalContextHolder metal_context(user_context, false);
+    if (metal_context.error == 0) {
+        commit_pending_command_buffer();
+    }
+}
+
+WEAK void halide_metal_set_heap_allocation(bool use_heaps) {
+    ScopedSpinLock spinlock(&heap_allocation_lock);
+    heap_allocation = use_heaps;
+    heap_allocation_initialized = true;
+}
+
+WEAK int halide_metal_release_unused_device_allocations(void *user_context) {
+    MetalContextHolder metal_context(user_context, false);
+    if (metal_context.error != 0) {
+        return metal_context.error;
+    }
+    if (metal_context.device == NULL) {
+        return 0;
+    }
+
+    device_allocation_cache_release(user_context, &allocation_cache, metal_context.device, free_cached_allocation);
+    release_heaps(user_context, metal_context.device, true);
+    return 0;
+}
+
 WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer) {
     #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
@@ -607,6 +967,9 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
 
     halide_assert(user_context, buffer->host && buffer->device);
 
+    // Wait for the commands that use the buffer before overwriting it.
+    halide_metal_device_sync_internal(user_context, metal_context.queue, NULL);
+
     device_copy c = make_host_to_device_copy(buffer);
     mtl_buffer *metal_buffer = ((device_handle *)c.dst)->buf;
     c.dst = (uint64_t)buffer_contents(metal_buffer) + ((device_handle *)c.dst)->offset;
@@ -625,7 +988,6 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
         total_extent.length = total_size;
         did_modify_range(metal_buffer, total_extent);
     }
-    halide_metal_device_sync_internal(metal_context.queue, buffer);
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -646,7 +1008,7 @@ WEAK int halide_metal_copy_to_host(void *user_context, halide_buffer_t* buffer)
         return metal_context.error;
     }
 
-    halide_metal_device_sync_internal(metal_context.queue, buffer);
+    halide_metal_device_sync_internal(user_context, metal_context.queue, buffer);
 
     halide_assert(user_context, buffer->host && buffer->device);
     halide_assert(user_context, buffer->dimensions <= MAX_COPY_DIMS);
@@ -689,7 +1051,7 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error;
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue);
+    mtl_command_buffer *command_buffer = get_pending_command_buffer(user_context, metal_context.queue);
     if (command_buffer == 0) {
         error(user_context) << "Metal: Could not allocate command buffer.\n";
         return -1;
@@ -809,9 +1171,8 @@ WEAK int halide_metal_run(void *user_context,
                           threadsX, threadsY, threadsZ);
     end_encoding(encoder);
 
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
+    // The dispatch is committed along with the commands encoded after it,
+    // when something needs its results.
 
     // We deliberately don't release the function here; this was causing
     // crashes on Mojave (issues #3395 and #3408).
@@ -895,17 +1256,20 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
         // Device only case
         if (!from_host && !to_host) {
             debug(user_context) << "halide_metal_buffer_copy device to device case.\n";
-            mtl_command_buffer *blit_command_buffer = new_command_buffer(metal_context.queue);
+            mtl_command_buffer *blit_command_buffer = get_pending_command_buffer(user_context, metal_context.queue);
+            if (blit_command_buffer == 0) {
+                error(user_context) << "Metal: Could not allocate command buffer.\n";
+                return halide_error_code_device_buffer_copy_failed;
+            }
             mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(blit_command_buffer);
             do_device_to_device_copy(user_context, blit_encoder, c, ((device_handle *)c.src)->offset,
                                      ((device_handle *)c.dst)->offset, dst->dimensions);
             end_encoding(blit_encoder);
-            commit_command_buffer(blit_command_buffer);
         } else {
             if (!from_host) {
                 // Need to make sure all reads and writes to/from source
                 // are complete.
-                halide_metal_device_sync_internal(metal_context.queue, src);
+                halide_metal_device_sync_internal(user_context, metal_context.queue, src);
 
                 c.src = (uint64_t)buffer_contents(((device_handle *)c.src)->buf) + ((device_handle *)c.src)->offset;
             }
@@ -914,7 +1278,7 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
             if (!to_host) {
                 // Need to make sure all reads and writes to/from destination
                 // are complete.
-                halide_metal_device_sync_internal(metal_context.queue, dst);
+                halide_metal_device_sync_internal(user_context, metal_context.queue, dst);
 
                 dst_buffer = ((device_handle *)c.dst)->buf;
                 halide_assert(user_context, from_host);
@@ -932,8 +1296,6 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
                     total_extent.length = total_size;
                     did_modify_range(dst_buffer, total_extent);
                 }
-                // Synchronize as otherwise host source memory might still be read from after return.
-                halide_metal_device_sync_internal(metal_context.queue, dst);
             }
         }
 
@@ -1040,6 +1402,14 @@ WEAK int halide_metal_detach_buffer(void *user_context, struct halide_buffer_t *
         return 0;
     }
     halide_assert(user_context, buf->device_interface == &metal_device_interface);
+    {
+        // The caller takes the buffer back, so submit the commands that
+        // use it.
+        MetalContextHolder metal_context(user_context, false);
+        if (metal_context.error == 0) {
+            commit_pending_command_buffer();
+        }
+    }
     buf->device_interface->impl->release_module();
     buf->device_interface = NULL;
     free((device_handle *)buf->device);
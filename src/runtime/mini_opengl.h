@@ -221,6 +221,25 @@ typedef void (*PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint* buffers);
 typedef void (*PFNGLGETACTIVEUNIFORM)(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name);
 typedef GLint (*PFNGLGETUNIFORMLOCATION)(GLuint program, const GLchar *name);
 
+// ---------- Pixel buffer objects and sync objects (OpenGL 3.2, OpenGL ES 3.0) ----------
+
+#define GL_PIXEL_PACK_BUFFER            0x88EB
+#define GL_STREAM_READ                  0x88E1
+
+#define GL_SYNC_GPU_COMMANDS_COMPLETE   0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT      0x00000001
+#define GL_ALREADY_SIGNALED             0x911A
+#define GL_TIMEOUT_EXPIRED              0x911B
+#define GL_CONDITION_SATISFIED          0x911C
+#define GL_WAIT_FAILED                  0x911D
+
+typedef uint64_t GLuint64;
+typedef struct __GLsync *GLsync;
+
+typedef GLsync (*PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef GLenum (*PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (*PFNGLDELETESYNCPROC) (GLsync sync);
+
 #endif  // MINI_OPENGL_H
 
 
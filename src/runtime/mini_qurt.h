@@ -233,6 +233,8 @@ typedef enum {
 
 extern int qurt_hvx_lock(qurt_hvx_mode_t lock_mode);
 extern int qurt_hvx_unlock(void);
+// Returns the mode of the context held by the calling thread, or a
+// negative value if it holds none.
 extern int qurt_hvx_get_mode(void);
 
 typedef unsigned int qurt_size_t;
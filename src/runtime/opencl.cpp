@@ -1,5 +1,6 @@
 #include "HalideRuntimeOpenCL.h"
 #include "scoped_spin_lock.h"
+#include "device_allocation_cache.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
 #include "printer.h"
@@ -84,6 +85,27 @@ WEAK char device_type[256];
 WEAK int device_type_lock = 0;
 WEAK bool device_type_initialized = false;
 
+WEAK char program_cache_dir[1024];
+WEAK int program_cache_dir_lock = 0;
+WEAK bool program_cache_dir_initialized = false;
+
+// Whether create_opencl_context makes an out-of-order command queue.
+// Set by halide_opencl_set_out_of_order_queue, or by the
+// HL_OCL_OUT_OF_ORDER_QUEUE environment variable.
+WEAK bool out_of_order_queue = false;
+WEAK bool out_of_order_queue_initialized = false;
+WEAK int out_of_order_queue_lock = 0;
+
+WEAK bool use_out_of_order_queue() {
+    ScopedSpinLock lock(&out_of_order_queue_lock);
+    if (!out_of_order_queue_initialized) {
+        const char *var = getenv("HL_OCL_OUT_OF_ORDER_QUEUE");
+        out_of_order_queue = (var && atoi(var) != 0);
+        out_of_order_queue_initialized = true;
+    }
+    return out_of_order_queue;
+}
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 using namespace Halide::Runtime::Internal::OpenCL;
@@ -130,6 +152,30 @@ WEAK const char *halide_opencl_get_device_type(void *user_context) {
     return device_type;
 }
 
+WEAK void halide_opencl_set_program_cache_dir(const char *dir) {
+    if (dir) {
+        strncpy(program_cache_dir, dir, sizeof(program_cache_dir) - 1);
+    } else {
+        program_cache_dir[0] = 0;
+    }
+    program_cache_dir_initialized = true;
+}
+
+WEAK const char *halide_opencl_get_program_cache_dir(void *user_context) {
+    ScopedSpinLock lock(&program_cache_dir_lock);
+    if (!program_cache_dir_initialized) {
+        const char *dir = getenv("HL_OCL_PROGRAM_CACHE_DIR");
+        halide_opencl_set_program_cache_dir(dir);
+    }
+    return program_cache_dir;
+}
+
+WEAK void halide_opencl_set_out_of_order_queue(bool out_of_order) {
+    ScopedSpinLock lock(&out_of_order_queue_lock);
+    out_of_order_queue = out_of_order;
+    out_of_order_queue_initialized = true;
+}
+
 // The default implementation of halide_acquire_cl_context uses the global
 // pointers above, and serializes access with a spin lock.
 // Overriding implementations of acquire/release must implement the following
@@ -226,6 +272,189 @@ struct module_state {
 };
 WEAK module_state *state_list = NULL;
 
+// With an out-of-order command queue, commands only wait for the
+// events they are given. We order the commands that use a buffer by
+// keeping the event of the last command that used each cl_mem, and
+// making the next command that uses it wait for that event. Kernel
+// arguments are conservatively treated as both read and written. This
+// state is only touched with the context acquired, which serializes
+// access to it.
+struct mem_event {
+    cl_mem mem;
+    cl_event event;
+    mem_event *next;
+};
+
+const int num_mem_event_buckets = 256;
+WEAK mem_event *mem_events[num_mem_event_buckets];
+
+// The command queue last checked by is_out_of_order_queue or
+// is_profiling_queue, and its properties.
+WEAK cl_command_queue checked_queue = NULL;
+WEAK cl_command_queue_properties checked_queue_properties = 0;
+
+WEAK cl_command_queue_properties get_queue_properties(cl_command_queue q) {
+    if (q != checked_queue) {
+        cl_command_queue_properties properties = 0;
+        cl_int err = clGetCommandQueueInfo(q, CL_QUEUE_PROPERTIES, sizeof(properties), &properties, NULL);
+        checked_queue = q;
+        checked_queue_properties = (err == CL_SUCCESS) ? properties : 0;
+    }
+    return checked_queue_properties;
+}
+
+WEAK bool is_out_of_order_queue(cl_command_queue q) {
+    return (get_queue_properties(q) & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+}
+
+WEAK bool is_profiling_queue(cl_command_queue q) {
+    return (get_queue_properties(q) & CL_QUEUE_PROFILING_ENABLE) != 0;
+}
+
+// The events of kernels and copies timed while device timing is
+// enabled (see halide_enable_device_timing). The elapsed times are
+// collected when the timing is read, or when the list fills up.
+struct timed_event {
+    cl_event event;
+    bool is_copy;
+};
+const int max_timed_events = 256;
+WEAK timed_event timed_events[max_timed_events];
+WEAK int num_timed_events = 0;
+WEAK halide_mutex timed_events_mutex;
+WEAK halide_device_timer opencl_device_timer;
+
+WEAK cl_int collect_timed_events_already_locked() {
+    cl_int result = CL_SUCCESS;
+    for (int i = 0; i < num_timed_events; i++) {
+        cl_event event = timed_events[i].event;
+        cl_ulong start = 0, end = 0;
+        cl_int err = clWaitForEvents(1, &event);
+        if (err == CL_SUCCESS) {
+            err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+        }
+        if (err == CL_SUCCESS) {
+            err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+        }
+        if (err == CL_SUCCESS) {
+            halide_device_timing_add(timed_events[i].is_copy, end > start ? end - start : 0);
+        } else {
+            result = err;
+        }
+        clReleaseEvent(event);
+    }
+    num_timed_events = 0;
+    return result;
+}
+
+WEAK int collect_opencl_device_timing(void *user_context) {
+    ScopedMutexLock lock(&timed_events_mutex);
+    cl_int err = collect_timed_events_already_locked();
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: collecting device timing failed: "
+                            << get_opencl_error_name(err);
+        return err;
+    }
+    return 0;
+}
+
+// Keep the event of a timed command until its times are collected.
+WEAK void add_timed_event(cl_event event, bool is_copy) {
+    ScopedMutexLock lock(&timed_events_mutex);
+    if (opencl_device_timer.collect == NULL) {
+        opencl_device_timer.collect = collect_opencl_device_timing;
+        halide_register_device_timer(&opencl_device_timer);
+    }
+    if (num_timed_events == max_timed_events) {
+        collect_timed_events_already_locked();
+    }
+    clRetainEvent(event);
+    timed_events[num_timed_events++] = {event, is_copy};
+}
+
+WEAK mem_event **mem_event_bucket(cl_mem mem) {
+    uint64_t h = (uint64_t)mem;
+    h ^= h >> 17;
+    h *= 0xed5ad4bbULL;
+    h ^= h >> 11;
+    return &mem_events[h % num_mem_event_buckets];
+}
+
+// The event of the last command that used 'mem', or NULL.
+WEAK cl_event last_mem_event(cl_mem mem) {
+    for (mem_event *e = *mem_event_bucket(mem); e; e = e->next) {
+        if (e->mem == mem) {
+            return e->event;
+        }
+    }
+    return NULL;
+}
+
+// Record that 'event' is the last command to use 'mem'.
+WEAK void set_last_mem_event(cl_mem mem, cl_event event) {
+    mem_event **bucket = mem_event_bucket(mem);
+    mem_event *e = *bucket;
+    while (e && e->mem != mem) {
+        e = e->next;
+    }
+    if (e == NULL) {
+        e = (mem_event *)malloc(sizeof(mem_event));
+        if (e == NULL) {
+            // We can't track this buffer, so wait for the command now.
+            clWaitForEvents(1, &event);
+            return;
+        }
+        e->mem = mem;
+        e->event = NULL;
+        e->next = *bucket;
+        *bucket = e;
+    }
+    clRetainEvent(event);
+    if (e->event) {
+        clReleaseEvent(e->event);
+    }
+    e->event = event;
+}
+
+// Forget the last command to use a cl_mem that is being released.
+WEAK void forget_mem_event(cl_mem mem) {
+    mem_event **prev_ptr = mem_event_bucket(mem);
+    for (mem_event *e = *prev_ptr; e; e = e->next) {
+        if (e->mem == mem) {
+            *prev_ptr = e->next;
+            if (e->event) {
+                clReleaseEvent(e->event);
+            }
+            free(e);
+            return;
+        }
+        prev_ptr = &e->next;
+    }
+}
+
+WEAK void forget_all_mem_events() {
+    for (int i = 0; i < num_mem_event_buckets; i++) {
+        while (mem_events[i]) {
+            mem_event *e = mem_events[i];
+            mem_events[i] = e->next;
+            if (e->event) {
+                clReleaseEvent(e->event);
+            }
+            free(e);
+        }
+    }
+}
+
+// Device allocations freed while halide_can_reuse_device_allocations is
+// true, keyed by the cl_context they were made in.
+WEAK device_allocation_cache allocation_cache;
+
+WEAK void free_cached_allocation(void *user_context, void *context, uint64_t handle) {
+    debug(user_context) << "    clReleaseMemObject " << (void *)handle << "\n";
+    forget_mem_event((cl_mem)handle);
+    clReleaseMemObject((cl_mem)handle);
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
     if (buf->device == 0) {
         return true;
@@ -253,6 +482,133 @@ WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size
     return true;
 }
 
+// Built program binaries are cached on disk in files with this layout:
+// a magic number, the key the binary was built for, the size of the
+// binary, and the binary itself.
+const uint64_t program_cache_magic = 0x314e4942434c4348ULL;  // "HCLCBIN1"
+
+WEAK uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Whether the kernels were compiled to SPIR-V ahead of time, rather
+// than embedded as OpenCL C source.
+WEAK bool is_spirv(const char *src, int size) {
+    const uint32_t magic = 0x07230203;
+    return size >= 4 && memcmp(src, &magic, 4) == 0;
+}
+
+// Compute the key of a program built from 'src' with 'options' for
+// 'dev', and the path of its cached binary. Returns false if caching is
+// disabled.
+WEAK bool program_cache_path(void *user_context, cl_device_id dev, const char *options,
+                             const char *src, int size, uint64_t *key, char *path, size_t path_size) {
+    const char *dir = halide_opencl_get_program_cache_dir(user_context);
+    if (dir == NULL || *dir == '\0') {
+        return false;
+    }
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const cl_device_info infos[] = {CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION};
+    for (size_t i = 0; i < sizeof(infos) / sizeof(infos[0]); i++) {
+        char info[256];
+        size_t info_size = 0;
+        if (clGetDeviceInfo(dev, infos[i], sizeof(info), info, &info_size) != CL_SUCCESS) {
+            return false;
+        }
+        h = hash_bytes(h, info, info_size);
+    }
+    h = hash_bytes(h, options, strlen(options) + 1);
+    h = hash_bytes(h, src, size);
+    *key = h;
+
+    char *dst = path, *end = path + path_size;
+    dst = halide_string_to_string(dst, end, dir);
+    dst = halide_string_to_string(dst, end, "/halide_cl_");
+    for (int i = 60; i >= 0; i -= 4) {
+        char digit[2] = {"0123456789abcdef"[(h >> i) & 0xf], 0};
+        dst = halide_string_to_string(dst, end, digit);
+    }
+    dst = halide_string_to_string(dst, end, ".bin");
+    // Don't use a truncated path.
+    return dst < end - 1;
+}
+
+// Create a program from the binary cached at 'path', if it was built
+// for 'key'. Returns NULL if there is no usable binary.
+WEAK cl_program load_cached_program(void *user_context, cl_context ctx, cl_device_id dev,
+                                    const char *path, uint64_t key) {
+    void *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    uint64_t header[3];
+    unsigned char *binary = NULL;
+    bool ok = (fread(header, sizeof(header), 1, f) == 1 &&
+               header[0] == program_cache_magic &&
+               header[1] == key &&
+               header[2] > 0);
+    if (ok) {
+        binary = (unsigned char *)malloc(header[2]);
+        ok = (binary != NULL && fread(binary, header[2], 1, f) == 1);
+    }
+    fclose(f);
+
+    cl_program program = NULL;
+    if (ok) {
+        size_t length = header[2];
+        const unsigned char *binaries[] = {binary};
+        cl_int binary_status = CL_SUCCESS, err = CL_SUCCESS;
+        debug(user_context) << "    clCreateProgramWithBinary " << path << " -> ";
+        program = clCreateProgramWithBinary(ctx, 1, &dev, &length, binaries, &binary_status, &err);
+        if (err != CL_SUCCESS || binary_status != CL_SUCCESS) {
+            debug(user_context) << get_opencl_error_name(err != CL_SUCCESS ? err : binary_status) << "\n";
+            if (program) {
+                clReleaseProgram(program);
+            }
+            program = NULL;
+        } else {
+            debug(user_context) << (void *)program << "\n";
+        }
+    }
+    free(binary);
+    return program;
+}
+
+// Write the binary of a program built for a single device to 'path'.
+// Failures only cost a rebuild next time, so they are not errors.
+WEAK void save_program_binary(void *user_context, cl_program program, const char *path, uint64_t key) {
+    size_t size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, NULL) != CL_SUCCESS ||
+        size == 0) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(size);
+    if (binary == NULL) {
+        return;
+    }
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) == CL_SUCCESS) {
+        void *f = fopen(path, "wb");
+        if (f) {
+            uint64_t header[3] = {program_cache_magic, key, size};
+            bool ok = (fwrite(header, sizeof(header), 1, f) == 1 &&
+                       fwrite(binary, size, 1, f) == 1);
+            fclose(f);
+            if (ok) {
+                debug(user_context) << "    cached program binary of " << (uint64_t)size << " bytes in " << path << "\n";
+            } else {
+                // Don't leave a truncated binary behind.
+                remove(path);
+            }
+        }
+    }
+    free(binary);
+}
+
 // Initializes the context used by the default implementation
 // of halide_acquire_context.
 WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_queue *q) {
@@ -455,8 +811,22 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
         debug(user_context) << *ctx << "\n";
     }
 
+    cl_command_queue_properties queue_properties = 0;
+    if (use_out_of_order_queue()) {
+        cl_command_queue_properties supported = 0;
+        err = clGetDeviceInfo(dev, CL_DEVICE_QUEUE_PROPERTIES, sizeof(supported), &supported, NULL);
+        if (err == CL_SUCCESS && (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)) {
+            queue_properties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        } else {
+            debug(user_context) << "    Device does not support out-of-order queues\n";
+        }
+    }
+    if (halide_device_timing_is_enabled()) {
+        queue_properties |= CL_QUEUE_PROFILING_ENABLE;
+    }
+
     debug(user_context) << "    clCreateCommandQueue ";
-    *q = clCreateCommandQueue(*ctx, dev, 0, &err);
+    *q = clCreateCommandQueue(*ctx, dev, queue_properties, &err);
     if (err != CL_SUCCESS) {
         debug(user_context) << get_opencl_error_name(err);
         error(user_context) << "CL: clCreateCommandQueue failed: "
@@ -498,8 +868,19 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
+    cl_int result = CL_SUCCESS;
+    size_t allocation_size;
+    if (halide_can_reuse_device_allocations(user_context) &&
+        clGetMemObjectInfo(dev_ptr, CL_MEM_SIZE, sizeof(allocation_size), &allocation_size, NULL) == CL_SUCCESS &&
+        device_allocation_cache_put(user_context, &allocation_cache, ctx.context,
+                                    allocation_size, (uint64_t)dev_ptr)) {
+        debug(user_context) << "    caching allocation " << (void *)dev_ptr
+                            << " of " << (uint64_t)allocation_size << " bytes\n";
+    } else {
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        forget_mem_event(dev_ptr);
+        result = clReleaseMemObject((cl_mem)dev_ptr);
+    }
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
     // we just end our reference to it regardless.
     free((device_handle *)buf->device);
@@ -587,41 +968,96 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
         options << "-D MAX_CONSTANT_BUFFER_SIZE=" << max_constant_buffer_size
                 << " -D MAX_CONSTANT_ARGS=" << max_constant_args;
 
-        const char * sources[] = { src };
-        debug(user_context) << "    clCreateProgramWithSource -> ";
-        cl_program program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
-        if (err != CL_SUCCESS) {
-            debug(user_context) << get_opencl_error_name(err) << "\n";
-            error(user_context) << "CL: clCreateProgramWithSource failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        } else {
-            debug(user_context) << (void *)program << "\n";
+        // Look for a binary built for the same device, options and
+        // source by an earlier process.
+        uint64_t cache_key = 0;
+        char cache_path[1024];
+        bool use_cache = program_cache_path(user_context, dev, options.str(), src, size,
+                                            &cache_key, cache_path, sizeof(cache_path));
+        cl_program program = NULL;
+        if (use_cache) {
+            program = load_cached_program(user_context, ctx.context, dev, cache_path, cache_key);
+        }
+        if (program) {
+            debug(user_context) << "    clBuildProgram " << (void *)program
+                                << " from cached binary\n";
+            err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL);
+            if (err == CL_SUCCESS) {
+                (*state)->program = program;
+            } else {
+                // The binary is stale or corrupt, so build from source.
+                debug(user_context) << "    " << get_opencl_error_name(err) << "\n";
+                clReleaseProgram(program);
+                program = NULL;
+            }
         }
-        (*state)->program = program;
-
-        debug(user_context) << "    clBuildProgram " << (void *)program
-                            << " " << options.str() << "\n";
-        err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
-        if (err != CL_SUCCESS) {
 
-            // Allocate an appropriately sized buffer for the build log.
-            char buffer[8192];
-
-            // Get build log
-            if (clGetProgramBuildInfo(program, dev,
-                                      CL_PROGRAM_BUILD_LOG,
-                                      sizeof(buffer), buffer,
-                                      NULL) == CL_SUCCESS) {
-                error(user_context) << "CL: clBuildProgram failed: "
-                                    << get_opencl_error_name(err)
-                                    << "\nBuild Log:\n"
-                                    << buffer << "\n";
+        if (program == NULL && is_spirv(src, size)) {
+            // Compiled ahead of time, with the opencl_spirv target
+            // feature. clCreateProgramWithIL is new in OpenCL 2.1, so
+            // it isn't one of the functions we always load.
+            typedef cl_program (CL_API_CALL *create_program_with_il_fn)(cl_context, const void *, size_t, cl_int *);
+            create_program_with_il_fn create_program_with_il =
+                (create_program_with_il_fn)halide_opencl_get_symbol(user_context, "clCreateProgramWithIL");
+            if (!create_program_with_il) {
+                error(user_context) << "CL: The kernels were compiled to SPIR-V, "
+                                    << "but clCreateProgramWithIL is not available\n";
+                return CL_INVALID_OPERATION;
+            }
+            debug(user_context) << "    clCreateProgramWithIL -> ";
+            program = create_program_with_il(ctx.context, src, size, &err);
+            if (err != CL_SUCCESS) {
+                debug(user_context) << get_opencl_error_name(err) << "\n";
+                error(user_context) << "CL: clCreateProgramWithIL failed: "
+                                    << get_opencl_error_name(err);
+                return err;
             } else {
-                error(user_context) << "clGetProgramBuildInfo failed";
+                debug(user_context) << (void *)program << "\n";
             }
+        } else if (program == NULL) {
+            const char * sources[] = { src };
+            debug(user_context) << "    clCreateProgramWithSource -> ";
+            program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
+            if (err != CL_SUCCESS) {
+                debug(user_context) << get_opencl_error_name(err) << "\n";
+                error(user_context) << "CL: clCreateProgramWithSource failed: "
+                                    << get_opencl_error_name(err);
+                return err;
+            } else {
+                debug(user_context) << (void *)program << "\n";
+            }
+        }
 
-            return err;
+        if ((*state)->program == NULL) {
+            (*state)->program = program;
+
+            debug(user_context) << "    clBuildProgram " << (void *)program
+                                << " " << options.str() << "\n";
+            err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
+            if (err != CL_SUCCESS) {
+
+                // Allocate an appropriately sized buffer for the build log.
+                char buffer[8192];
+
+                // Get build log
+                if (clGetProgramBuildInfo(program, dev,
+                                          CL_PROGRAM_BUILD_LOG,
+                                          sizeof(buffer), buffer,
+                                          NULL) == CL_SUCCESS) {
+                    error(user_context) << "CL: clBuildProgram failed: "
+                                        << get_opencl_error_name(err)
+                                        << "\nBuild Log:\n"
+                                        << buffer << "\n";
+                } else {
+                    error(user_context) << "clGetProgramBuildInfo failed";
+                }
+
+                return err;
+            }
+
+            if (use_cache) {
+                save_program_binary(user_context, program, cache_path, cache_key);
+            }
         }
     }
 
@@ -677,6 +1113,18 @@ WEAK int halide_opencl_device_release(void *user_context) {
         err = clFinish(q);
         halide_assert(user_context, err == CL_SUCCESS);
 
+        // Return the cached allocations made in this context to the driver.
+        device_allocation_cache_release(user_context, &allocation_cache, ctx, free_cached_allocation);
+
+        // The queue is empty, so the commands we were ordering against
+        // have all completed.
+        forget_all_mem_events();
+        checked_queue = NULL;
+        {
+            ScopedMutexLock lock(&timed_events_mutex);
+            collect_timed_events_already_locked();
+        }
+
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the program objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -745,17 +1193,37 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
         return CL_OUT_OF_HOST_MEMORY;
     }
 
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
-    if (err != CL_SUCCESS || dev_ptr == 0) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateBuffer failed: "
-                            << get_opencl_error_name(err);
-        free(dev_handle);
-        return err;
+    cl_int err = CL_SUCCESS;
+    cl_mem dev_ptr = NULL;
+    bool reused = false;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        device_allocation_cache_register(&allocation_cache, halide_opencl_release_unused_device_allocations);
+        size = device_allocation_size_class(size);
+        uint64_t handle;
+        reused = device_allocation_cache_take(&allocation_cache, ctx.context, size, &handle);
+        dev_ptr = (cl_mem)handle;
+    }
+    if (reused) {
+        debug(user_context) << "    reusing cached allocation " << (void *)dev_ptr
+                            << " device_handle: " << dev_handle << "\n";
     } else {
-        debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+        debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
+        dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+        if ((err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES) &&
+            !device_allocation_cache_empty(&allocation_cache)) {
+            // Return the unused allocations to the driver and try again.
+            device_allocation_cache_release(user_context, &allocation_cache, ctx.context, free_cached_allocation);
+            dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+        }
+        if (err != CL_SUCCESS || dev_ptr == 0) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateBuffer failed: "
+                                << get_opencl_error_name(err);
+            free(dev_handle);
+            return err;
+        } else {
+            debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+        }
     }
 
     dev_handle->mem = dev_ptr;
@@ -782,30 +1250,88 @@ namespace {
 WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
                                          const device_copy &c,
                                          int64_t src_idx, int64_t dst_idx,
-                                         int d, bool from_host, bool to_host) {
+                                         int d, int rect_dims, bool from_host, bool to_host) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
-    } else if (d == 0) {
+    } else if (d == 0 || d == rect_dims) {
         cl_int err = 0;
 
+        // On an out-of-order queue, wait for the last commands to use the
+        // device buffers involved, and become the last command to use them.
+        bool track_events = is_out_of_order_queue(ctx.cmd_queue);
+        cl_mem mems[2];
+        int num_mems = 0;
+        if (!from_host) {
+            mems[num_mems++] = ((device_handle *)c.src)->mem;
+        }
+        if (!to_host) {
+            mems[num_mems++] = ((device_handle *)c.dst)->mem;
+        }
+        cl_event wait_list[2];
+        cl_uint num_wait = 0;
+        if (track_events) {
+            for (int i = 0; i < num_mems; i++) {
+                cl_event e = last_mem_event(mems[i]);
+                if (e) {
+                    wait_list[num_wait++] = e;
+                }
+            }
+        }
+        bool timed = halide_device_timing_is_enabled() && is_profiling_queue(ctx.cmd_queue);
+        cl_event event = NULL;
+        cl_event *event_ptr = (track_events || timed) ? &event : NULL;
+        const cl_event *wait_ptr = num_wait ? wait_list : NULL;
+
         debug(user_context) << "    from " << (from_host ? "host" : "device")
                             << " to " << (to_host ? "host" : "device") << ", "
                             << (void *)c.src << " + " << src_idx
                             << " -> " << (void *)c.dst << " + " << dst_idx
                             << ", " << c.chunk_size << " bytes\n";
-        if (!from_host && to_host) {
+        if (d > 0) {
+            // Copy a rectangle of rows, or a stack of them, in one
+            // command. The origins are byte offsets, which the driver
+            // adds to the row and slice offsets.
+            size_t region[3] = {(size_t)c.chunk_size, (size_t)c.extent[0], d == 2 ? (size_t)c.extent[1] : 1};
+            size_t src_row_pitch = c.src_stride_bytes[0], dst_row_pitch = c.dst_stride_bytes[0];
+            size_t src_slice_pitch = d == 2 ? c.src_stride_bytes[1] : 0;
+            size_t dst_slice_pitch = d == 2 ? c.dst_stride_bytes[1] : 0;
+            size_t src_origin[3] = {(size_t)src_idx, 0, 0}, dst_origin[3] = {(size_t)dst_idx, 0, 0};
+            if (!from_host) {
+                src_origin[0] += ((device_handle *)c.src)->offset;
+            }
+            if (!to_host) {
+                dst_origin[0] += ((device_handle *)c.dst)->offset;
+            }
+            debug(user_context) << "    in " << (uint64_t)region[2] << " x " << (uint64_t)region[1] << " rows\n";
+            if (!from_host && to_host) {
+                err = clEnqueueReadBufferRect(ctx.cmd_queue, ((device_handle *)c.src)->mem, CL_FALSE,
+                                              src_origin, dst_origin, region,
+                                              src_row_pitch, src_slice_pitch, dst_row_pitch, dst_slice_pitch,
+                                              (void *)c.dst, num_wait, wait_ptr, event_ptr);
+            } else if (from_host && !to_host) {
+                err = clEnqueueWriteBufferRect(ctx.cmd_queue, ((device_handle *)c.dst)->mem, CL_FALSE,
+                                               dst_origin, src_origin, region,
+                                               dst_row_pitch, dst_slice_pitch, src_row_pitch, src_slice_pitch,
+                                               (void *)c.src, num_wait, wait_ptr, event_ptr);
+            } else {
+                err = clEnqueueCopyBufferRect(ctx.cmd_queue, ((device_handle *)c.src)->mem, ((device_handle *)c.dst)->mem,
+                                              src_origin, dst_origin, region,
+                                              src_row_pitch, src_slice_pitch, dst_row_pitch, dst_slice_pitch,
+                                              num_wait, wait_ptr, event_ptr);
+            }
+        } else if (!from_host && to_host) {
             err = clEnqueueReadBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem,
                                       CL_FALSE, src_idx + ((device_handle *)c.src)->offset, c.chunk_size, (void *)(c.dst + dst_idx),
-                                      0, NULL, NULL);
+                                      num_wait, wait_ptr, event_ptr);
         } else if (from_host && !to_host) {
             err = clEnqueueWriteBuffer(ctx.cmd_queue, ((device_handle *)c.dst)->mem,
                                        CL_FALSE, dst_idx + ((device_handle *)c.dst)->offset, c.chunk_size, (void *)(c.src + src_idx),
-                                       0, NULL, NULL);
+                                       num_wait, wait_ptr, event_ptr);
         } else if (!from_host && !to_host) {
             err = clEnqueueCopyBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem, ((device_handle *)c.dst)->mem,
                                       src_idx + ((device_handle *)c.src)->offset, dst_idx  + ((device_handle *)c.dst)->offset,
-                                      c.chunk_size, 0, NULL, NULL);
+                                      c.chunk_size, num_wait, wait_ptr, event_ptr);
         } else if ((c.dst + dst_idx) != (c.src + src_idx)) {
             // Could reach here if a user called directly into the
             // opencl API for a device->host copy on a source buffer
@@ -817,12 +1343,24 @@ WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
             error(user_context) << "CL: buffer copy failed: " << get_opencl_error_name(err);
             return (int)err;
         }
+
+        if (event) {
+            if (track_events) {
+                for (int i = 0; i < num_mems; i++) {
+                    set_last_mem_event(mems[i], event);
+                }
+            }
+            if (timed) {
+                add_timed_event(event, true);
+            }
+            clReleaseEvent(event);
+        }
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d-1]; i++) {
             int err = opencl_do_multidimensional_copy(user_context, ctx, c,
                                                src_idx + src_off, dst_idx + dst_off,
-                                               d - 1, from_host, to_host);
+                                               d - 1, rect_dims, from_host, to_host);
             dst_off += c.dst_stride_bytes[d-1];
             src_off += c.src_stride_bytes[d-1];
             if (err) {
@@ -879,12 +1417,25 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
         #endif
 
-        err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        // Strided copies go to the driver a rectangle at a time,
+        // unless they don't touch the device at all.
+        int rect_dims = (from_host && to_host) ? 0 : rect_copy_dims(c);
+        err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, rect_dims, from_host, to_host);
 
         // The reads/writes above are all non-blocking, so empty the command
         // queue before we proceed so that other host code won't write
-        // to the buffer while the above writes are still running.
-        clFinish(ctx.cmd_queue);
+        // to the buffer while the above writes are still running. On an
+        // out-of-order queue it is enough to wait for the last command to
+        // use the device buffer, which other commands need not wait for.
+        if (!is_out_of_order_queue(ctx.cmd_queue)) {
+            clFinish(ctx.cmd_queue);
+        } else if (from_host != to_host) {
+            cl_mem mem = ((device_handle *)(to_host ? c.src : c.dst))->mem;
+            cl_event e = last_mem_event(mem);
+            if (e) {
+                clWaitForEvents(1, &e);
+            }
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -962,7 +1513,9 @@ WEAK int halide_opencl_run(void *user_context,
 
     // Count sub buffers needed for crops.
     int sub_buffers_needed = 0;
+    int num_buffer_args = 0;
     while (arg_sizes[i] != 0) {
+        num_buffer_args += arg_is_buffer[i] ? 1 : 0;
         if (arg_is_buffer[i] &&
             ((device_handle *)((halide_buffer_t *)args[i])->device)->offset != 0) {
             sub_buffers_needed++;
@@ -979,6 +1532,31 @@ WEAK int halide_opencl_run(void *user_context,
         memset(sub_buffers, 0, sizeof(cl_mem) * sub_buffers_needed);
     }
 
+    // On an out-of-order queue, the kernel waits for the last commands to
+    // use each of its buffer arguments.
+    bool track_events = is_out_of_order_queue(ctx.cmd_queue) && num_buffer_args > 0;
+    cl_mem *arg_mems = NULL;
+    cl_event *wait_list = NULL;
+    cl_uint num_wait = 0;
+    if (track_events) {
+        arg_mems = (cl_mem *)malloc((sizeof(cl_mem) + sizeof(cl_event)) * num_buffer_args);
+        if (arg_mems == NULL) {
+            free(sub_buffers);
+            return halide_error_code_out_of_memory;
+        }
+        wait_list = (cl_event *)(arg_mems + num_buffer_args);
+        int b = 0;
+        for (i = 0; arg_sizes[i] != 0; i++) {
+            if (arg_is_buffer[i]) {
+                arg_mems[b++] = ((device_handle *)((halide_buffer_t *)args[i])->device)->mem;
+                cl_event e = last_mem_event(arg_mems[b - 1]);
+                if (e) {
+                    wait_list[num_wait++] = e;
+                }
+            }
+        }
+    }
+
     i = 0;
     while (arg_sizes[i] != 0) {
         debug(user_context) << "    clSetKernelArg " << i
@@ -1015,6 +1593,7 @@ WEAK int halide_opencl_run(void *user_context,
                 clReleaseMemObject(sub_buffers[sub_buf_index]);
             }
             free(sub_buffers);
+            free(arg_mems);
             return err;
         }
         i++;
@@ -1027,6 +1606,11 @@ WEAK int halide_opencl_run(void *user_context,
     if (err != CL_SUCCESS) {
         error(user_context) << "CL: clSetKernelArg failed "
                             << get_opencl_error_name(err);
+        for (int sub_buf_index = 0; sub_buf_index < sub_buffers_saved; sub_buf_index++) {
+            clReleaseMemObject(sub_buffers[sub_buf_index]);
+        }
+        free(sub_buffers);
+        free(arg_mems);
         return err;
     }
 
@@ -1035,13 +1619,29 @@ WEAK int halide_opencl_run(void *user_context,
         << "    clEnqueueNDRangeKernel "
         << blocksX << "x" << blocksY << "x" << blocksZ << ", "
         << threadsX << "x" << threadsY << "x" << threadsZ << " -> ";
+    bool timed = halide_device_timing_is_enabled() && is_profiling_queue(ctx.cmd_queue);
+    cl_event event = NULL;
     err = clEnqueueNDRangeKernel(ctx.cmd_queue, f,
                                  // NDRange
                                  3, NULL, global_dim, local_dim,
                                  // Events
-                                 0, NULL, NULL);
+                                 num_wait, num_wait ? wait_list : NULL,
+                                 (track_events || timed) ? &event : NULL);
     debug(user_context) << get_opencl_error_name(err) << "\n";
 
+    if (err == CL_SUCCESS && event) {
+        if (track_events) {
+            for (int b = 0; b < num_buffer_args; b++) {
+                set_last_mem_event(arg_mems[b], event);
+            }
+        }
+        if (timed) {
+            add_timed_event(event, false);
+        }
+        clReleaseEvent(event);
+    }
+    free(arg_mems);
+
     // Now that the kernel is enqueued, OpenCL is holding its own
     // references to sub buffers and the local ones can be released.
     for (int sub_buf_index = 0; sub_buf_index < sub_buffers_saved; sub_buf_index++) {
@@ -1110,6 +1710,19 @@ WEAK int halide_opencl_detach_cl_mem(void *user_context, halide_buffer_t *buf) {
         return 0;
     }
     halide_assert(user_context, buf->device_interface == &opencl_device_interface);
+    {
+        // The caller takes the cl_mem back, so finish the commands we have
+        // ordered against it.
+        ClContext ctx(user_context);
+        if (ctx.error == CL_SUCCESS) {
+            cl_mem mem = ((device_handle *)buf->device)->mem;
+            cl_event e = last_mem_event(mem);
+            if (e) {
+                clWaitForEvents(1, &e);
+            }
+            forget_mem_event(mem);
+        }
+    }
     free((device_handle *)buf->device);
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -1217,6 +1830,19 @@ WEAK int halide_opencl_device_release_crop(void *user_context,
     return 0;
 }
 
+WEAK int halide_opencl_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CL: halide_opencl_release_unused_device_allocations (user_context: " << user_context << ")\n";
+
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+
+    device_allocation_cache_release(user_context, &allocation_cache, ctx.context, free_cached_allocation);
+    return 0;
+}
+
 WEAK const struct halide_device_interface_t *halide_opencl_device_interface() {
     return &opencl_device_interface;
 }
@@ -74,7 +74,12 @@
     GLFUNC(PFNGLGENVERTEXARRAYS, GenVertexArrays);                      \
     GLFUNC(PFNGLBINDVERTEXARRAY, BindVertexArray);                      \
     GLFUNC(PFNGLDELETEVERTEXARRAYS, DeleteVertexArrays);                \
-    GLFUNC(PFNDRAWBUFFERS, DrawBuffers)
+    GLFUNC(PFNDRAWBUFFERS, DrawBuffers);                                \
+    GLFUNC(PFNGLMAPBUFFERRANGEPROC, MapBufferRange);                    \
+    GLFUNC(PFNGLUNMAPBUFFERPROC, UnmapBuffer);                          \
+    GLFUNC(PFNGLFENCESYNCPROC, FenceSync);                              \
+    GLFUNC(PFNGLCLIENTWAITSYNCPROC, ClientWaitSync);                    \
+    GLFUNC(PFNGLDELETESYNCPROC, DeleteSync)
 
 // ---------- Types ----------
 
@@ -170,6 +175,31 @@ struct ModuleState {
     ModuleState *next;
 };
 
+// A texture freed by halide_opengl_device_free, kept for reuse by a later
+// halide_opengl_device_malloc of a buffer with the same size and format.
+struct PooledTexture {
+    GLuint id;
+    GLint width, height;
+    GLint internal_format, format, type;
+    PooledTexture *next;
+};
+
+// A readback of a texture into a pixel buffer object, started by
+// halide_opengl_begin_copy_to_host and finished by the next
+// halide_opengl_copy_to_host of the texture. Readbacks with a texture of
+// zero are idle, and keep their pixel buffer object for reuse.
+struct Readback {
+    GLuint texture;
+    GLuint pbo;
+    size_t pbo_size;
+    GLsync fence;
+    // The number of bytes read, and the type and number of channels they
+    // were read with.
+    size_t size;
+    GLint type, channels;
+    Readback *next;
+};
+
 
 // All persistent state maintained by the runtime.
 struct GlobalState {
@@ -185,6 +215,7 @@ struct GlobalState {
     bool have_texture_rg;
     bool have_texture_float;
     bool have_texture_rgb8_rgba8;
+    bool have_async_readback;
 
     // Various objects shared by all filter kernels
     GLuint framebuffer_id;
@@ -211,6 +242,15 @@ WEAK bool GlobalState::CheckAndReportError(void *user_context, const char *locat
 
 WEAK GlobalState global_state;
 
+// Freed textures, most recently freed first. The number kept is bounded,
+// so that a pipeline that changes its buffer sizes doesn't accumulate
+// textures that are never reused.
+WEAK PooledTexture *texture_pool = NULL;
+WEAK int texture_pool_count = 0;
+const int max_pooled_textures = 16;
+
+WEAK Readback *readbacks = NULL;
+
 // Saves & restores OpenGL state
 class GLStateSaver {
     public:
@@ -558,6 +598,7 @@ WEAK void GlobalState::init() {
     have_vertex_array_objects = false;
     have_texture_rg = false;
     have_texture_rgb8_rgba8 = false;
+    have_async_readback = false;
     // Initialize all GL function pointers to NULL
 #define GLFUNC(type, name) name = NULL;
     USED_GL_FUNCTIONS;
@@ -609,6 +650,22 @@ WEAK void init_extensions(void *user_context) {
     }
     load_gl_func(user_context, "glDrawBuffers", (void**)&global_state.DrawBuffers, false);
 
+    // Pixel buffer objects with mapping, and fence sync objects, are core
+    // in OpenGL ES 3.0 and OpenGL 3.2.
+    if ((global_state.profile == OpenGLES && global_state.major_version >= 3) ||
+        (global_state.profile == OpenGL &&
+         (global_state.major_version > 3 ||
+          (global_state.major_version == 3 && global_state.minor_version >= 2)))) {
+        load_gl_func(user_context, "glMapBufferRange", (void**)&global_state.MapBufferRange, false);
+        load_gl_func(user_context, "glUnmapBuffer", (void**)&global_state.UnmapBuffer, false);
+        load_gl_func(user_context, "glFenceSync", (void**)&global_state.FenceSync, false);
+        load_gl_func(user_context, "glClientWaitSync", (void**)&global_state.ClientWaitSync, false);
+        load_gl_func(user_context, "glDeleteSync", (void**)&global_state.DeleteSync, false);
+        global_state.have_async_readback =
+            global_state.MapBufferRange && global_state.UnmapBuffer &&
+            global_state.FenceSync && global_state.ClientWaitSync && global_state.DeleteSync;
+    }
+
     global_state.have_texture_rg =
         global_state.major_version >= 3 ||
         (global_state.profile == OpenGL &&
@@ -699,7 +756,8 @@ WEAK int halide_opengl_init(void *user_context) {
         << "  vertex_array_objects: " << (global_state.have_vertex_array_objects ? "yes\n" : "no\n")
         << "  texture_rg: " << (global_state.have_texture_rg ? "yes\n" : "no\n")
         << "  have_texture_rgb8_rgba8: " << (global_state.have_texture_rgb8_rgba8 ? "yes\n" : "no\n")
-        << "  texture_float: " << (global_state.have_texture_float ? "yes\n" : "no\n");
+        << "  texture_float: " << (global_state.have_texture_float ? "yes\n" : "no\n")
+        << "  async_readback: " << (global_state.have_async_readback ? "yes\n" : "no\n");
 
     // Initialize framebuffer.
     global_state.GenFramebuffers(1, &global_state.framebuffer_id);
@@ -730,6 +788,113 @@ WEAK int halide_opengl_init(void *user_context) {
     return 0;
 }
 
+// Take a texture of the given size and format from the pool, or return zero
+// if there is none.
+WEAK GLuint take_pooled_texture(GLint width, GLint height, GLint internal_format,
+                                GLint format, GLint type) {
+    for (PooledTexture **p = &texture_pool; *p; p = &(*p)->next) {
+        PooledTexture *t = *p;
+        if (t->width == width && t->height == height &&
+            t->internal_format == internal_format &&
+            t->format == format && t->type == type) {
+            GLuint id = t->id;
+            *p = t->next;
+            free(t);
+            texture_pool_count--;
+            return id;
+        }
+    }
+    return 0;
+}
+
+// Add a texture to the pool, deleting the least recently freed texture if
+// the pool is full. Returns false if the texture should be deleted instead.
+WEAK bool pool_texture(void *user_context, GLuint id, GLint width, GLint height,
+                       GLint internal_format, GLint format, GLint type) {
+    PooledTexture *t = (PooledTexture *)malloc(sizeof(PooledTexture));
+    if (!t) {
+        return false;
+    }
+    t->id = id;
+    t->width = width;
+    t->height = height;
+    t->internal_format = internal_format;
+    t->format = format;
+    t->type = type;
+    t->next = texture_pool;
+    texture_pool = t;
+    texture_pool_count++;
+
+    if (texture_pool_count > max_pooled_textures) {
+        PooledTexture **p = &texture_pool;
+        while ((*p)->next) {
+            p = &(*p)->next;
+        }
+        debug(user_context) << "Evicting pooled texture " << (*p)->id << "\n";
+        global_state.DeleteTextures(1, &(*p)->id);
+        free(*p);
+        *p = NULL;
+        texture_pool_count--;
+    }
+    return true;
+}
+
+// Forget all pooled textures, deleting them unless the context that owned
+// them is gone.
+WEAK void release_texture_pool(bool delete_textures) {
+    while (texture_pool) {
+        PooledTexture *t = texture_pool;
+        if (delete_textures) {
+            global_state.DeleteTextures(1, &t->id);
+        }
+        texture_pool = t->next;
+        free(t);
+    }
+    texture_pool_count = 0;
+}
+
+WEAK Readback *find_readback(GLuint texture) {
+    for (Readback *r = readbacks; r; r = r->next) {
+        if (r->texture == texture) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+// Make a readback idle, dropping the data it read, if any.
+WEAK void discard_readback(Readback *r) {
+    if (r->fence) {
+        global_state.DeleteSync(r->fence);
+        r->fence = NULL;
+    }
+    r->texture = 0;
+}
+
+// Discard any readback of a texture that is about to change or go away.
+WEAK void discard_readback_of(GLuint texture) {
+    if (texture == 0) {
+        return;
+    }
+    if (Readback *r = find_readback(texture)) {
+        discard_readback(r);
+    }
+}
+
+// Forget all readbacks, deleting their fences and pixel buffer objects
+// unless the context that owned them is gone.
+WEAK void release_readbacks(bool delete_objects) {
+    while (readbacks) {
+        Readback *r = readbacks;
+        if (delete_objects) {
+            discard_readback(r);
+            global_state.DeleteBuffers(1, &r->pbo);
+        }
+        readbacks = r->next;
+        free(r);
+    }
+}
+
 // Release all data allocated by the runtime.
 //
 // The OpenGL context itself is generally managed by the host application, so
@@ -759,6 +924,9 @@ WEAK int halide_opengl_device_release(void *user_context) {
         global_state.DeleteVertexArrays(1, &global_state.vertex_array_object);
     }
 
+    release_texture_pool(true);
+    release_readbacks(true);
+
     global_state = GlobalState();
 
     return 0;
@@ -916,29 +1084,9 @@ WEAK int halide_opengl_device_malloc(void *user_context, halide_buffer_t *buf) {
             return 1;
         }
 
-        // Generate texture ID
-        global_state.GenTextures(1, &tex);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc GenTextures")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
-        }
-
-        // Set parameters for this texture: no interpolation and clamp to edges.
-        global_state.BindTexture(GL_TEXTURE_2D, tex);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc binding texture")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
-        }
-
-        // Create empty texture here and fill it with glTexSubImage2D later.
         GLint internal_format, format, type;
         if (!get_texture_format(user_context, buf, &internal_format, &format, &type)) {
             error(user_context) << "Invalid texture format";
-            global_state.DeleteTextures(1, &tex);
             return 1;
         }
 
@@ -948,20 +1096,47 @@ WEAK int halide_opengl_device_malloc(void *user_context, halide_buffer_t *buf) {
             return 1;
         }
 
-        global_state.TexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, NULL);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc TexImage2D")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
+        // Reuse a freed texture of the same size and format if there is one.
+        tex = take_pooled_texture(width, height, internal_format, format, type);
+        if (tex) {
+            debug(user_context) << "Reusing pooled texture " << tex
+                                << " of size " << width << " x " << height << "\n";
+        } else {
+            // Generate texture ID
+            global_state.GenTextures(1, &tex);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc GenTextures")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+
+            // Set parameters for this texture: no interpolation and clamp to edges.
+            global_state.BindTexture(GL_TEXTURE_2D, tex);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc binding texture")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+
+            // Create empty texture here and fill it with glTexSubImage2D later.
+            global_state.TexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, NULL);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc TexImage2D")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+
+            debug(user_context) << "Allocated texture " << tex
+                                << " of size " << width << " x " << height << "\n";
+
+            global_state.BindTexture(GL_TEXTURE_2D, 0);
         }
 
         buf->device = tex;
         buf->device_interface = &opengl_device_interface;
         buf->device_interface->impl->use_module();
         halide_allocated = true;
-        debug(user_context) << "Allocated texture " << tex
-                            << " of size " << width << " x " << height << "\n";
-
-        global_state.BindTexture(GL_TEXTURE_2D, 0);
     }
 
     return 0;
@@ -981,13 +1156,27 @@ WEAK int halide_opengl_device_free(void *user_context, halide_buffer_t *buf) {
     uint64_t handle = buf->device;
     GLuint tex = (handle == HALIDE_OPENGL_RENDER_TARGET) ? 0 : (GLuint)handle;
 
+    discard_readback_of(tex);
+
+    // Keep the texture for reuse if we can describe it.
+    GLint internal_format, format, type;
+    GLint width, height, channels;
+    bool pooled = (tex != 0 &&
+                   get_texture_format(user_context, buf, &internal_format, &format, &type) &&
+                   get_texture_dimensions(user_context, buf, &width, &height, &channels) &&
+                   pool_texture(user_context, tex, width, height, internal_format, format, type));
+
     int result = 0;
-    debug(user_context) << "halide_opengl_device_free: Deleting texture " << tex << "\n";
-    global_state.DeleteTextures(1, &tex);
-    if (global_state.CheckAndReportError(user_context, "halide_opengl_device_free DeleteTextures")) {
-        result = 1;
-        // do not return: we want to zero out the interface and
-        // device fields even if we can't delete the texture.
+    if (pooled) {
+        debug(user_context) << "halide_opengl_device_free: Pooling texture " << tex << "\n";
+    } else {
+        debug(user_context) << "halide_opengl_device_free: Deleting texture " << tex << "\n";
+        global_state.DeleteTextures(1, &tex);
+        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_free DeleteTextures")) {
+            result = 1;
+            // do not return: we want to zero out the interface and
+            // device fields even if we can't delete the texture.
+        }
     }
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -1086,6 +1275,7 @@ WEAK int halide_opengl_copy_to_device(void *user_context, halide_buffer_t *buf)
     }
     GLuint tex = (GLuint)handle;
     debug(user_context) << "halide_opengl_copy_to_device: " << tex << "\n";
+    discard_readback_of(tex);
 
     global_state.BindTexture(GL_TEXTURE_2D, tex);
     if (global_state.CheckAndReportError(user_context, "halide_opengl_copy_to_device BindTexture")) {
@@ -1147,34 +1337,23 @@ WEAK int halide_opengl_copy_to_device(void *user_context, halide_buffer_t *buf)
     return 0;
 }
 
-// Copy image data from texture back to host memory.
-WEAK int halide_opengl_copy_to_host(void *user_context, halide_buffer_t *buf) {
-    if (!global_state.initialized) {
-        error(user_context) << "OpenGL runtime not initialized (halide_opengl_copy_to_host).";
-        return 1;
-    }
-
-    GLStateSaver state_saver;
-
-    if (!buf->host || !buf->device) {
-        debug_buffer(user_context, buf);
-        error(user_context) << "Invalid copy_to_host operation: host or dev NULL";
-        return 1;
-    }
-
-    GLint internal_format, format, type;
-    if (!get_texture_format(user_context, buf, &internal_format, &format, &type)) {
+// Bind the framebuffer to the texture of a buffer so that it can be read with
+// ReadPixels, and pick the format and type to read it with. The number of
+// channels read may be more than the buffer has.
+WEAK int setup_readback(void *user_context, halide_buffer_t *buf,
+                        GLint *format, GLint *type, GLint *width, GLint *height,
+                        GLint *buffer_channels, GLint *texture_channels) {
+    GLint internal_format;
+    if (!get_texture_format(user_context, buf, &internal_format, format, type)) {
         error(user_context) << "Invalid texture format";
         return 1;
     }
 
-    GLint width, height, buffer_channels;
-    if (!get_texture_dimensions(user_context, buf, &width, &height, &buffer_channels)) {
+    if (!get_texture_dimensions(user_context, buf, width, height, buffer_channels)) {
         error(user_context) << "Invalid texture dimensions";
         return 1;
     }
-    GLint texture_channels = buffer_channels;
-
+    *texture_channels = *buffer_channels;
 
     uint64_t handle = buf->device;
     if (handle != HALIDE_OPENGL_RENDER_TARGET) {
@@ -1207,27 +1386,202 @@ WEAK int halide_opengl_copy_to_host(void *user_context, halide_buffer_t *buf) {
     // what we need (usually GL_RGB).
     // NOTE: this requires the currently-bound Framebuffer is correct.
     // TODO: short and float will require even more effort on top of this.
-    if (global_state.profile == OpenGLES && format == GL_RGB) {
+    if (global_state.profile == OpenGLES && *format == GL_RGB) {
         GLint extra_format, extra_type;
         global_state.GetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &extra_type);
-        if (type != GL_UNSIGNED_BYTE && type != extra_type) {
+        if (*type != GL_UNSIGNED_BYTE && *type != extra_type) {
             error(user_context) << "ReadPixels does not support our type; we don't handle this yet.\n";
             return 1;
         }
         global_state.GetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &extra_format);
-        if (format != GL_RGBA && format != extra_format) {
+        if (*format != GL_RGBA && *format != extra_format) {
             debug(user_context) << "ReadPixels does not support our format; falling back to GL_RGBA\n";
-            format = GL_RGBA;
-            texture_channels = 4;
+            *format = GL_RGBA;
+            *texture_channels = 4;
         }
     }
 
-    // To download the texture directly, the colors must be stored interleaved
-    // and rows must be stored consecutively.
-    // (Single-channel buffers are "interleaved" for our purposes here.)
+    return 0;
+}
+
+// To download the texture directly, the colors must be stored interleaved
+// and rows must be stored consecutively.
+// (Single-channel buffers are "interleaved" for our purposes here.)
+WEAK bool is_direct_readback(const halide_buffer_t *buf, GLint buffer_channels, GLint texture_channels) {
     bool is_interleaved = (buffer_channels == 1) || (buf->dim[2].stride == 1 && buf->dim[0].stride == buf->dim[2].extent);
     bool is_packed = (buf->dim[1].stride == buf->dim[0].extent * buf->dim[0].stride);
-    if (is_interleaved && is_packed && texture_channels == buffer_channels) {
+    return is_interleaved && is_packed && texture_channels == buffer_channels;
+}
+
+// Copy pixels read from a texture into a buffer that can't take them directly.
+WEAK void deinterleave_readback(void *user_context, const void *src, GLint type,
+                                GLint texture_channels, halide_buffer_t *buf) {
+    // Premature optimization warning: interleaved_to_halide() could definitely
+    // be optimized, but ReadPixels() typically takes ~2-10x as long (especially on
+    // mobile devices), so the returns will be modest.
+#ifdef DEBUG_RUNTIME
+    int64_t t3 = halide_current_time_ns(user_context);
+#endif
+    switch (type) {
+    case GL_UNSIGNED_BYTE:
+        interleaved_to_halide<uint8_t>(user_context, (const uint8_t*)src, texture_channels, buf);
+        break;
+    case GL_UNSIGNED_SHORT:
+        interleaved_to_halide<uint16_t>(user_context, (const uint16_t*)src, texture_channels, buf);
+        break;
+    case GL_FLOAT:
+        interleaved_to_halide<float>(user_context, (const float*)src, texture_channels, buf);
+        break;
+    }
+#ifdef DEBUG_RUNTIME
+    int64_t t4 = halide_current_time_ns(user_context);
+    debug(user_context)<<"deinterleave time: "<<(t4-t3)/1e3<<"usec\n";
+#endif
+}
+
+// Start reading the texture of a buffer into a pixel buffer object, followed
+// by a fence, so that a later copy_to_host can wait for just that read instead
+// of stalling on ReadPixels.
+WEAK int start_readback(void *user_context, halide_buffer_t *buf) {
+    GLuint tex = (GLuint)buf->device;
+    GLint format, type, width, height, buffer_channels, texture_channels;
+    if (int err = setup_readback(user_context, buf, &format, &type, &width, &height,
+                                 &buffer_channels, &texture_channels)) {
+        return err;
+    }
+    size_t size = width * height * texture_channels * buf->type.bytes();
+
+    // Restart a readback of this texture that is already in flight, or else
+    // use an idle one.
+    Readback *r = find_readback(tex);
+    if (r) {
+        discard_readback(r);
+    } else {
+        r = find_readback(0);
+    }
+    if (!r) {
+        r = (Readback *)malloc(sizeof(Readback));
+        if (!r) {
+            error(user_context) << "OpenGL: malloc failed making readback";
+            return -1;
+        }
+        r->texture = 0;
+        r->pbo_size = 0;
+        r->fence = NULL;
+        global_state.GenBuffers(1, &r->pbo);
+        r->next = readbacks;
+        readbacks = r;
+        if (global_state.CheckAndReportError(user_context, "start_readback GenBuffers")) {
+            return 1;
+        }
+    }
+
+    global_state.BindBuffer(GL_PIXEL_PACK_BUFFER, r->pbo);
+    if (r->pbo_size < size) {
+        global_state.BufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        r->pbo_size = size;
+    }
+    global_state.PixelStorei(GL_PACK_ALIGNMENT, 1);
+    global_state.ReadPixels(0, 0, width, height, format, type, NULL);
+    global_state.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (global_state.CheckAndReportError(user_context, "start_readback ReadPixels")) {
+        return 1;
+    }
+
+    r->fence = global_state.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (!r->fence) {
+        error(user_context) << "OpenGL: FenceSync failed";
+        return 1;
+    }
+    r->texture = tex;
+    r->size = size;
+    r->type = type;
+    r->channels = texture_channels;
+    debug(user_context) << "Started readback of texture " << tex
+                        << " into pixel buffer " << r->pbo << "\n";
+    return 0;
+}
+
+// Wait for a readback started by start_readback, and copy what it read into
+// the host memory of the buffer.
+WEAK int finish_readback(void *user_context, Readback *r, halide_buffer_t *buf) {
+#ifdef DEBUG_RUNTIME
+    int64_t t1 = halide_current_time_ns(user_context);
+#endif
+    // Flush on the first wait, in case nothing has flushed the fence yet.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    GLenum status;
+    do {
+        status = global_state.ClientWaitSync(r->fence, flags, 1000000000);
+        flags = 0;
+    } while (status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_WAIT_FAILED) {
+        discard_readback(r);
+        global_state.CheckAndReportError(user_context, "copy_to_host ClientWaitSync");
+        error(user_context) << "OpenGL: waiting for readback failed";
+        return 1;
+    }
+#ifdef DEBUG_RUNTIME
+    int64_t t2 = halide_current_time_ns(user_context);
+    debug(user_context) << "readback wait time: " << (t2 - t1) / 1e3 << "usec\n";
+#endif
+
+    global_state.BindBuffer(GL_PIXEL_PACK_BUFFER, r->pbo);
+    const void *src = global_state.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, r->size, GL_MAP_READ_BIT);
+    if (!src) {
+        global_state.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        discard_readback(r);
+        global_state.CheckAndReportError(user_context, "copy_to_host MapBufferRange");
+        error(user_context) << "OpenGL: mapping readback pixel buffer failed";
+        return 1;
+    }
+
+    GLint buffer_channels = (buf->dimensions > 2) ? buf->dim[2].extent : 1;
+    if (is_direct_readback(buf, buffer_channels, r->channels)) {
+        memcpy(buf->host, src, r->size);
+    } else {
+        deinterleave_readback(user_context, src, r->type, r->channels, buf);
+    }
+
+    global_state.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    global_state.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    discard_readback(r);
+    if (global_state.CheckAndReportError(user_context, "copy_to_host UnmapBuffer")) {
+        return 1;
+    }
+    return 0;
+}
+
+// Copy image data from texture back to host memory.
+WEAK int halide_opengl_copy_to_host(void *user_context, halide_buffer_t *buf) {
+    if (!global_state.initialized) {
+        error(user_context) << "OpenGL runtime not initialized (halide_opengl_copy_to_host).";
+        return 1;
+    }
+
+    GLStateSaver state_saver;
+
+    if (!buf->host || !buf->device) {
+        debug_buffer(user_context, buf);
+        error(user_context) << "Invalid copy_to_host operation: host or dev NULL";
+        return 1;
+    }
+
+    // Finish the readback started by halide_opengl_begin_copy_to_host, if any.
+    uint64_t handle = buf->device;
+    if (handle != HALIDE_OPENGL_RENDER_TARGET) {
+        if (Readback *r = find_readback((GLuint)handle)) {
+            return finish_readback(user_context, r, buf);
+        }
+    }
+
+    GLint format, type, width, height, buffer_channels, texture_channels;
+    if (int err = setup_readback(user_context, buf, &format, &type, &width, &height,
+                                 &buffer_channels, &texture_channels)) {
+        return err;
+    }
+
+    if (is_direct_readback(buf, buffer_channels, texture_channels)) {
         global_state.PixelStorei(GL_PACK_ALIGNMENT, 1);
 #ifdef DEBUG_RUNTIME
         int64_t t1 = halide_current_time_ns(user_context);
@@ -1266,27 +1620,7 @@ WEAK int halide_opengl_copy_to_host(void *user_context, halide_buffer_t *buf) {
             return 1;
         }
 
-        // Premature optimization warning: interleaved_to_halide() could definitely
-        // be optimized, but ReadPixels() typically takes ~2-10x as long (especially on
-        // mobile devices), so the returns will be modest.
-#ifdef DEBUG_RUNTIME
-        int64_t t3 = halide_current_time_ns(user_context);
-#endif
-        switch (type) {
-        case GL_UNSIGNED_BYTE:
-            interleaved_to_halide<uint8_t>(user_context, (uint8_t*)tmp.ptr, texture_channels, buf);
-            break;
-        case GL_UNSIGNED_SHORT:
-            interleaved_to_halide<uint16_t>(user_context, (uint16_t*)tmp.ptr, texture_channels, buf);
-            break;
-        case GL_FLOAT:
-            interleaved_to_halide<float>(user_context, (float*)tmp.ptr, texture_channels, buf);
-            break;
-        }
-#ifdef DEBUG_RUNTIME
-        int64_t t4 = halide_current_time_ns(user_context);
-        debug(user_context)<<"deinterleave time: "<<(t4-t3)/1e3<<"usec\n";
-#endif
+        deinterleave_readback(user_context, tmp.ptr, type, texture_channels, buf);
     }
 
     return 0;
@@ -1579,6 +1913,7 @@ WEAK int halide_opengl_run(void *user_context,
             return 1;
         }
         GLuint tex = (handle == HALIDE_OPENGL_RENDER_TARGET) ? 0 : (GLuint)handle;
+        discard_readback_of(tex);
 
         // Check to see if the object name is actually a FBO
         if (bind_render_targets) {
@@ -1965,6 +2300,9 @@ WEAK void halide_opengl_context_lost(void *user_context) {
         mod->kernel->program_id = 0;
     }
 
+    release_texture_pool(false);
+    release_readbacks(false);
+
     global_state.init();
     return;
 }
@@ -2027,6 +2365,26 @@ WEAK uintptr_t halide_opengl_get_texture(void *user_context, halide_buffer_t *bu
     return handle == HALIDE_OPENGL_RENDER_TARGET ? 0 : (uintptr_t)handle;
 }
 
+WEAK int halide_opengl_begin_copy_to_host(void *user_context, halide_buffer_t *buf) {
+    if (!global_state.initialized) {
+        error(user_context) << "OpenGL runtime not initialized (halide_opengl_begin_copy_to_host).";
+        return 1;
+    }
+    if (!buf->host || !buf->device) {
+        debug_buffer(user_context, buf);
+        error(user_context) << "Invalid begin_copy_to_host operation: host or dev NULL";
+        return 1;
+    }
+    if (!buf->device_dirty() || buf->device == HALIDE_OPENGL_RENDER_TARGET ||
+        !global_state.have_async_readback) {
+        // halide_copy_to_host will read synchronously, if at all.
+        return 0;
+    }
+
+    GLStateSaver state_saver;
+    return start_readback(user_context, buf);
+}
+
 namespace {
 __attribute__((destructor))
 WEAK void halide_opengl_cleanup() {
@@ -8,9 +8,84 @@ extern "C" {
 extern void *malloc(size_t);
 extern void free(void *);
 
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK halide_first_touch_t custom_first_touch = NULL;
+
+// Allocations smaller than this are not worth spreading over nodes.
+#define FIRST_TOUCH_MIN_SIZE (1 << 20)
+#define FIRST_TOUCH_PAGE_SIZE 4096
+#define FIRST_TOUCH_PAGES_PER_TASK 16
+
+// Allocations of at least this many bytes are aligned to huge page
+// boundaries and advised to be backed by huge pages. Zero means
+// never. Read from HL_HUGE_PAGE_THRESHOLD_MB on first use unless set
+// explicitly.
+WEAK size_t huge_page_threshold = 0;
+WEAK bool huge_page_threshold_initialized = false;
+
+WEAK size_t get_huge_page_threshold() {
+    if (!huge_page_threshold_initialized) {
+        char *str = getenv("HL_HUGE_PAGE_THRESHOLD_MB");
+        if (str) {
+            int mb = atoi(str);
+            huge_page_threshold = mb > 0 ? (size_t)mb << 20 : 0;
+        }
+        huge_page_threshold_initialized = true;
+    }
+    return huge_page_threshold;
+}
+
+struct first_touch_closure {
+    char *ptr;
+    size_t size;
+};
+
+WEAK int first_touch_task(void *user_context, int idx, uint8_t *closure) {
+    first_touch_closure *c = (first_touch_closure *)closure;
+    size_t begin = (size_t)idx * FIRST_TOUCH_PAGE_SIZE * FIRST_TOUCH_PAGES_PER_TASK;
+    size_t end = begin + FIRST_TOUCH_PAGE_SIZE * FIRST_TOUCH_PAGES_PER_TASK;
+    if (end > c->size) {
+        end = c->size;
+    }
+    for (size_t i = begin; i < end; i += FIRST_TOUCH_PAGE_SIZE) {
+        c->ptr[i] = 0;
+    }
+    return 0;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK void halide_default_first_touch(void *user_context, void *ptr, size_t size) {
+    first_touch_closure c;
+    c.ptr = (char *)ptr;
+    c.size = size;
+    int pages_per_task = FIRST_TOUCH_PAGE_SIZE * FIRST_TOUCH_PAGES_PER_TASK;
+    int tasks = (int)((size + pages_per_task - 1) / pages_per_task);
+    halide_do_par_for(user_context, first_touch_task, 0, tasks, (uint8_t *)&c);
+}
+
+WEAK halide_first_touch_t halide_set_custom_first_touch(halide_first_touch_t user_first_touch) {
+    halide_first_touch_t result = custom_first_touch;
+    custom_first_touch = user_first_touch;
+    return result;
+}
+
+WEAK size_t halide_set_huge_page_threshold(size_t bytes) {
+    size_t result = get_huge_page_threshold();
+    huge_page_threshold = bytes;
+    return result;
+}
+
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
     // Allocate enough space for aligning the pointer we return.
-    const size_t alignment = halide_malloc_alignment();
+    const size_t threshold = get_huge_page_threshold();
+    const bool huge = threshold && x >= threshold;
+    const size_t alignment = huge ? HUGE_PAGE_SIZE : halide_malloc_alignment();
     void *orig = malloc(x + alignment);
     if (orig == NULL) {
         // Will result in a failed assertion and a call to halide_error
@@ -19,6 +94,17 @@ WEAK void *halide_default_malloc(void *user_context, size_t x) {
     // We want to store the original pointer prior to the pointer we return.
     void *ptr = (void *)(((size_t)orig + alignment + sizeof(void*) - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    if (huge) {
+        // Only whole huge pages can be advised. Failure just means
+        // we get regular pages.
+        size_t huge_bytes = x & ~((size_t)HUGE_PAGE_SIZE - 1);
+        if (huge_bytes) {
+            halide_host_advise_huge_pages(ptr, huge_bytes);
+        }
+    }
+    if (custom_first_touch && x >= FIRST_TOUCH_MIN_SIZE) {
+        custom_first_touch(user_context, ptr, x);
+    }
     return ptr;
 }
 
@@ -1,6 +1,8 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "scoped_spin_lock.h"
 
 // Note: The profiler thread may out-live any valid user_context, or
 // be used across many different user_contexts, so nothing it calls
@@ -9,13 +11,24 @@
 extern "C" {
 // Returns the address of the global halide_profiler state
 WEAK halide_profiler_state *halide_profiler_get_state() {
-    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, 0, NULL, NULL};
+    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, 0, NULL, NULL, NULL, NULL, NULL, 0, 0};
     return &s;
 }
 }
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// The number of heap allocations recorded per pipeline when
+// HL_PROFILER_MEMORY_LIFETIMES is set.
+#define MAX_RECORDED_ALLOCATIONS 1024
+
+// The largest allocation the compiler will place on the stack (see
+// can_allocation_fit_on_stack).
+#define STACK_ALLOCATION_LIMIT (16 * 1024)
+
+// Guards the allocation logs of all pipelines.
+WEAK int allocation_log_lock = 0;
+
 WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipeline_name, int num_funcs, const uint64_t *func_names) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -50,8 +63,27 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         free(p);
         return NULL;
     }
+    p->allocations = NULL;
+    p->branch_counts = NULL;
+    p->branch_names = NULL;
+    p->num_branches = 0;
+    p->first_run_start = 0;
+    p->num_allocations = 0;
+    p->dropped_allocations = 0;
+    const char *lifetimes = getenv("HL_PROFILER_MEMORY_LIFETIMES");
+    if (lifetimes && lifetimes[0] && lifetimes[0] != '0') {
+        // If this fails, lifetimes just aren't recorded.
+        p->allocations = (halide_profiler_allocation *)malloc(MAX_RECORDED_ALLOCATIONS * sizeof(halide_profiler_allocation));
+    }
     for (int i = 0; i < num_funcs; i++) {
         p->funcs[i].time = 0;
+        p->funcs[i].remote_cycles = 0;
+        p->funcs[i].remote_lock_wait_cycles = 0;
+        for (int c = 0; c < halide_profiler_num_counters; c++) {
+            p->funcs[i].counters[c] = 0;
+        }
+        p->funcs[i].ops = 0;
+        p->funcs[i].bytes = 0;
         p->funcs[i].name = (const char *)(func_names[i]);
         p->funcs[i].memory_current = 0;
         p->funcs[i].memory_peak = 0;
@@ -66,7 +98,7 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     return p;
 }
 
-WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
+WEAK halide_profiler_pipeline_stats *find_pipeline_of_func(halide_profiler_state *s, int func_id) {
     halide_profiler_pipeline_stats *p_prev = NULL;
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
@@ -77,19 +109,51 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
                 p->next = s->pipelines;
                 s->pipelines = p;
             }
-            halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
-            f->time += time;
-            f->active_threads_numerator += active_threads;
-            f->active_threads_denominator += 1;
-            p->time += time;
-            p->samples++;
-            p->active_threads_numerator += active_threads;
-            p->active_threads_denominator += 1;
-            return;
+            return p;
         }
         p_prev = p;
     }
-    // Someone must have called reset_state while a kernel was running. Do nothing.
+    // Someone must have called reset_state while a kernel was running.
+    return NULL;
+}
+
+WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, uint64_t remote_cycles,
+                    uint64_t remote_lock_wait_cycles, int active_threads) {
+    halide_profiler_pipeline_stats *p = find_pipeline_of_func(s, func_id);
+    if (p) {
+        halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+        f->time += time;
+        f->remote_cycles += remote_cycles;
+        f->remote_lock_wait_cycles += remote_lock_wait_cycles;
+        f->active_threads_numerator += active_threads;
+        f->active_threads_denominator += 1;
+        p->time += time;
+        p->samples++;
+        p->active_threads_numerator += active_threads;
+        p->active_threads_denominator += 1;
+    }
+}
+
+// Read the hardware counters of each thread that has run a pipeline
+// compiled with profile_by_thread, and bill the increase since the
+// last sample to the func it is running now.
+WEAK void bill_thread_counters(halide_profiler_state *s) {
+    for (halide_profiler_thread_state *t = s->threads; t;
+         t = (halide_profiler_thread_state *)(t->next)) {
+        int func = t->current_func;
+        halide_profiler_pipeline_stats *p = func >= 0 ? find_pipeline_of_func(s, func) : NULL;
+        for (int c = 0; c < halide_profiler_num_counters; c++) {
+            uint64_t count;
+            if (t->counter_handles[c] < 0 ||
+                halide_host_read_perf_counter(t->counter_handles[c], &count) != 0) {
+                continue;
+            }
+            if (p && count > t->last_counts[c]) {
+                p->funcs[func - p->first_func_id].counters[c] += count - t->last_counts[c];
+            }
+            t->last_counts[c] = count;
+        }
+    }
 }
 
 WEAK void sampling_profiler_thread(void *) {
@@ -102,26 +166,57 @@ WEAK void sampling_profiler_thread(void *) {
 
         uint64_t t1 = halide_current_time_ns(NULL);
         uint64_t t = t1;
+        // The last value of the remote cycle counter, if any.
+        uint64_t c = 0;
+        bool have_c = false;
+        // Likewise for the remote lock wait total.
+        uint64_t w = 0;
+        bool have_w = false;
         while (1) {
             int func, active_threads;
+            uint64_t cycles = 0, lock_wait = 0;
             if (s->get_remote_profiler_state) {
                 // Execution has disappeared into remote code running
                 // on an accelerator (e.g. Hexagon DSP)
                 s->get_remote_profiler_state(&func, &active_threads);
+                if (s->get_remote_profiler_cycles) {
+                    uint64_t c_now;
+                    s->get_remote_profiler_cycles(&c_now);
+                    if (have_c && c_now > c) {
+                        cycles = c_now - c;
+                    }
+                    c = c_now;
+                    have_c = true;
+                }
+                if (s->get_remote_profiler_lock_wait) {
+                    uint64_t w_now;
+                    s->get_remote_profiler_lock_wait(&w_now);
+                    if (have_w && w_now > w) {
+                        lock_wait = w_now - w;
+                    }
+                    w = w_now;
+                    have_w = true;
+                }
             } else {
                 func = s->current_func;
                 active_threads = s->active_threads;
+                have_c = false;
+                have_w = false;
             }
             uint64_t t_now = halide_current_time_ns(NULL);
             if (func == halide_profiler_please_stop) {
                 break;
             } else if (func >= 0) {
-                // Assume all time since I was last awake is due to
-                // the currently running func.
-                bill_func(s, func, t_now - t, active_threads);
+                // Assume all time (and remote cycles) since I was
+                // last awake is due to the currently running func.
+                bill_func(s, func, t_now - t, cycles, lock_wait, active_threads);
             }
             t = t_now;
 
+            if (s->threads) {
+                bill_thread_counters(s);
+            }
+
             // Release the lock, sleep, reacquire.
             int sleep_ms = s->sleep_time;
             halide_mutex_unlock(&s->lock);
@@ -133,6 +228,236 @@ WEAK void sampling_profiler_thread(void *) {
     halide_mutex_unlock(&s->lock);
 }
 
+// Kernels for measuring the roofline of the machine: a compute-bound
+// one doing independent chains of multiply-adds, and a
+// bandwidth-bound one summing a buffer much larger than the
+// caches. Each runs as a parallel loop over the thread pool.
+#define ROOFLINE_CHAINS 16
+#define ROOFLINE_ITERS (1 << 18)
+#define ROOFLINE_BUFFER_BYTES (128 << 20)
+
+struct roofline_closure {
+    const uint64_t *data;
+    int words_per_task;
+    // Results go here, so the work isn't optimized away.
+    volatile float float_sink;
+    volatile uint64_t int_sink;
+};
+
+WEAK void record_allocation(void *user_context, halide_profiler_pipeline_stats *p,
+                            int func_id, uint64_t size) {
+    uint64_t now = halide_current_time_ns(user_context) - p->first_run_start;
+    ScopedSpinLock lock(&allocation_log_lock);
+    if (p->num_allocations >= MAX_RECORDED_ALLOCATIONS) {
+        p->dropped_allocations++;
+        return;
+    }
+    halide_profiler_allocation *a = p->allocations + p->num_allocations++;
+    a->size = size;
+    a->start = now;
+    a->end = 0;
+    a->thread_id = halide_host_current_thread_id();
+    a->func_id = func_id;
+}
+
+WEAK void record_free(void *user_context, halide_profiler_pipeline_stats *p,
+                      int func_id, uint64_t size) {
+    uint64_t now = halide_current_time_ns(user_context) - p->first_run_start;
+    uint64_t thread_id = halide_host_current_thread_id();
+    ScopedSpinLock lock(&allocation_log_lock);
+    // Frees don't say which allocation they free, so match the most
+    // recent live allocation of the same Func and size, preferring
+    // one made by this thread.
+    halide_profiler_allocation *match = NULL;
+    for (int i = p->num_allocations - 1; i >= 0; i--) {
+        halide_profiler_allocation *a = p->allocations + i;
+        if (a->func_id == func_id && a->size == size && a->end == 0) {
+            if (a->thread_id == thread_id) {
+                match = a;
+                break;
+            }
+            if (!match) {
+                match = a;
+            }
+        }
+    }
+    if (match) {
+        match->end = now > match->start ? now : match->start + 1;
+    }
+}
+
+// The lifetime of the allocations of one Func, over the first run.
+struct func_lifetime {
+    uint64_t first_start, last_end, live_time, max_size;
+    int count, slot;
+};
+
+// Report the lifetimes of the allocations recorded during the first
+// run of a pipeline, and suggest ways to reduce the number and size
+// of them: hoisting allocations made many times per run, placing
+// small ones on the stack, and sharing storage between Funcs whose
+// allocations are never live at the same time.
+WEAK void print_allocation_lifetimes(void *user_context, halide_profiler_pipeline_stats *p) {
+    if (!p->allocations || p->num_allocations == 0) {
+        return;
+    }
+    func_lifetime *funcs = (func_lifetime *)malloc(p->num_funcs * sizeof(func_lifetime));
+    if (!funcs) {
+        return;
+    }
+
+    const halide_profiler_allocation *allocs = p->allocations;
+    const int n = p->num_allocations;
+    uint64_t run_end = 1;
+    for (int i = 0; i < n; i++) {
+        run_end = max(run_end, max(allocs[i].start, allocs[i].end));
+    }
+
+    // The live bytes peak when something is allocated.
+    uint64_t total = 0, peak = 0;
+    for (int i = 0; i < n; i++) {
+        total += allocs[i].size;
+        uint64_t live = 0;
+        for (int j = 0; j < n; j++) {
+            if (allocs[j].start <= allocs[i].start &&
+                (allocs[j].end == 0 || allocs[j].end > allocs[i].start)) {
+                live += allocs[j].size;
+            }
+        }
+        peak = max(peak, live);
+    }
+
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+    sstr << " allocation lifetimes (first run): " << n << " allocations, "
+         << total << " bytes in total, peak live " << peak << " bytes";
+    if (p->dropped_allocations) {
+        sstr << " (" << p->dropped_allocations << " more not recorded)";
+    }
+    sstr << "\n";
+    halide_print(user_context, sstr.str());
+
+    for (int f = 0; f < p->num_funcs; f++) {
+        funcs[f].first_start = run_end;
+        funcs[f].last_end = 0;
+        funcs[f].live_time = 0;
+        funcs[f].max_size = 0;
+        funcs[f].count = 0;
+        funcs[f].slot = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        func_lifetime &fl = funcs[allocs[i].func_id];
+        uint64_t end = allocs[i].end ? allocs[i].end : run_end;
+        fl.first_start = min(fl.first_start, allocs[i].start);
+        fl.last_end = max(fl.last_end, end);
+        fl.live_time += end - allocs[i].start;
+        fl.max_size = max(fl.max_size, allocs[i].size);
+        fl.count++;
+    }
+
+    for (int f = 0; f < p->num_funcs; f++) {
+        const func_lifetime &fl = funcs[f];
+        if (fl.count == 0) {
+            continue;
+        }
+        sstr.clear();
+        sstr << "  " << p->funcs[f].name << ": " << fl.count
+             << " allocations of up to " << fl.max_size << " bytes, live for "
+             << (int)((100 * fl.live_time) / run_end) << "% of the run\n";
+        if (fl.count > 1) {
+            sstr << "   suggestion: allocated " << fl.count << " times per run; storing it "
+                 << "at an outer loop level (store_at) would allocate it once\n";
+        }
+        if (fl.max_size <= STACK_ALLOCATION_LIMIT) {
+            sstr << "   suggestion: at most " << fl.max_size << " bytes; with a constant "
+                 << "size it could go on the stack (store_in(MemoryType::Stack))\n";
+        }
+        halide_print(user_context, sstr.str());
+    }
+
+    // Greedily pack the Funcs, in order of their first allocation,
+    // into slots of storage that hold one Func at a time.
+    int num_slots = 0;
+    uint64_t *slot_end = (uint64_t *)malloc(p->num_funcs * sizeof(uint64_t));
+    if (slot_end) {
+        for (;;) {
+            int next = -1;
+            for (int f = 0; f < p->num_funcs; f++) {
+                if (funcs[f].count && funcs[f].slot < 0 &&
+                    (next < 0 || funcs[f].first_start < funcs[next].first_start)) {
+                    next = f;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            int slot = 0;
+            while (slot < num_slots && slot_end[slot] > funcs[next].first_start) {
+                slot++;
+            }
+            if (slot == num_slots) {
+                num_slots++;
+            }
+            slot_end[slot] = funcs[next].last_end;
+            funcs[next].slot = slot;
+        }
+        free(slot_end);
+    }
+
+    for (int slot = 0; slot < num_slots; slot++) {
+        int members = 0;
+        uint64_t shared = 0, separate = 0;
+        sstr.clear();
+        sstr << " suggestion: ";
+        for (int f = 0; f < p->num_funcs; f++) {
+            if (funcs[f].count && funcs[f].slot == slot) {
+                sstr << (members ? ", " : "") << p->funcs[f].name;
+                shared = max(shared, funcs[f].max_size);
+                separate += funcs[f].max_size;
+                members++;
+            }
+        }
+        if (members > 1) {
+            sstr << " are never live at the same time and could share one buffer of "
+                 << shared << " bytes instead of " << separate << " bytes\n";
+            halide_print(user_context, sstr.str());
+        }
+    }
+
+    free(funcs);
+}
+
+WEAK int roofline_status = 0;  // 0: not measured, 1: measuring, 2: done
+
+WEAK int roofline_compute_task(void *user_context, int idx, uint8_t *closure) {
+    float acc[ROOFLINE_CHAINS];
+    for (int j = 0; j < ROOFLINE_CHAINS; j++) {
+        acc[j] = (float)(idx + j);
+    }
+    for (int i = 0; i < ROOFLINE_ITERS; i++) {
+        for (int j = 0; j < ROOFLINE_CHAINS; j++) {
+            acc[j] = acc[j] * 0.999f + 0.001f;
+        }
+    }
+    float sum = 0;
+    for (int j = 0; j < ROOFLINE_CHAINS; j++) {
+        sum += acc[j];
+    }
+    ((roofline_closure *)closure)->float_sink = sum;
+    return 0;
+}
+
+WEAK int roofline_stream_task(void *user_context, int idx, uint8_t *closure) {
+    roofline_closure *c = (roofline_closure *)closure;
+    const uint64_t *data = c->data + (size_t)idx * c->words_per_task;
+    uint64_t sum = 0;
+    for (int i = 0; i < c->words_per_task; i++) {
+        sum += data[i];
+    }
+    c->int_sink = sum;
+    return 0;
+}
+
 }}}
 
 namespace {
@@ -149,6 +474,58 @@ void sync_compare_max_and_swap(T *ptr, T val) {
     }
 }
 
+// Append the achieved arithmetic rate and bandwidth of a func, and
+// where it sits relative to the machine's roofline.
+template<typename P>
+void print_roofline(P &sstr, const halide_profiler_state *s, const halide_profiler_func_stats *fs) {
+    if (fs->time == 0 || (fs->ops == 0 && fs->bytes == 0)) {
+        return;
+    }
+    // Operations per nanosecond is billions of operations per second.
+    double gops = (double)fs->ops / fs->time;
+    double gbytes = (double)fs->bytes / fs->time;
+    sstr << " gop/s: " << gops;
+    sstr.erase(4);
+    sstr << "  gb/s: " << gbytes;
+    sstr.erase(4);
+    if (fs->bytes) {
+        sstr << "  ops/byte: " << (double)fs->ops / fs->bytes;
+        sstr.erase(4);
+    }
+    if (s->peak_gops > 0 && s->peak_gbytes > 0) {
+        // A func whose arithmetic intensity is above the ridge point
+        // of the roofline can't be limited by bandwidth.
+        double ridge = s->peak_gops / s->peak_gbytes;
+        if (fs->bytes == 0 || (double)fs->ops / fs->bytes >= ridge) {
+            sstr << "  compute-bound (" << (int)(100 * gops / s->peak_gops) << "% of peak)";
+        } else {
+            sstr << "  memory-bound (" << (int)(100 * gbytes / s->peak_gbytes) << "% of peak)";
+        }
+    }
+}
+
+// Append the per-run hardware counter stats for a func or pipeline.
+template<typename P>
+void print_counters(P &sstr, const uint64_t *counters, int runs) {
+    const uint64_t cycles = counters[halide_profiler_counter_cycles];
+    const uint64_t instructions = counters[halide_profiler_counter_instructions];
+    const uint64_t llc_misses = counters[halide_profiler_counter_llc_misses];
+    const uint64_t stall_cycles = counters[halide_profiler_counter_stall_cycles];
+    if (cycles) {
+        sstr << " cycles/run: " << cycles / runs;
+    }
+    if (cycles && instructions) {
+        sstr << "  ipc: " << (float)instructions / cycles;
+        sstr.erase(4);
+    }
+    if (llc_misses) {
+        sstr << "  llc misses/run: " << llc_misses / runs;
+    }
+    if (cycles && stall_cycles) {
+        sstr << "  stalled: " << (int)((100 * stall_cycles) / cycles) << "%";
+    }
+}
+
 }
 
 extern "C" {
@@ -190,10 +567,126 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
         return halide_error_out_of_memory(user_context);
     }
     p->runs++;
+    if (p->runs == 1 && p->allocations) {
+        p->first_run_start = halide_current_time_ns(user_context);
+    }
 
     return p->first_func_id;
 }
 
+// Called at the start of each run of a pipeline compiled with
+// profile_branches. The counts are kept across runs.
+WEAK int halide_profiler_register_branches(void *user_context,
+                                           void *pipeline_state,
+                                           int num_branches,
+                                           const uint64_t *branch_names) {
+    halide_profiler_pipeline_stats *p = (halide_profiler_pipeline_stats *)pipeline_state;
+    halide_assert(user_context, p != NULL);
+
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+
+    if (p->branch_counts) {
+        return 0;
+    }
+    uint64_t *counts = (uint64_t *)malloc(2 * num_branches * sizeof(uint64_t));
+    const char **names = (const char **)malloc(num_branches * sizeof(const char *));
+    if (!counts || !names) {
+        free(counts);
+        free(names);
+        return halide_error_out_of_memory(user_context);
+    }
+    for (int i = 0; i < num_branches; i++) {
+        counts[2 * i] = counts[2 * i + 1] = 0;
+        names[i] = (const char *)(branch_names[i]);
+    }
+    p->branch_names = names;
+    p->num_branches = num_branches;
+    p->branch_counts = counts;
+    return 0;
+}
+
+WEAK int halide_profiler_measure_roofline(void *user_context) {
+    if (roofline_status == 2 ||
+        !__sync_bool_compare_and_swap(&roofline_status, 0, 1)) {
+        return 0;
+    }
+
+    halide_start_clock(user_context);
+    const int tasks = 4 * halide_host_cpu_count();
+    roofline_closure c;
+
+    int64_t t0 = halide_current_time_ns(user_context);
+    halide_do_par_for(user_context, roofline_compute_task, 0, tasks, (uint8_t *)&c);
+    int64_t t1 = halide_current_time_ns(user_context);
+    // One multiply and one add per chain per iteration.
+    double ops = (double)tasks * ROOFLINE_ITERS * ROOFLINE_CHAINS * 2;
+    double gops = t1 > t0 ? ops / (t1 - t0) : 0;
+
+    double gbytes = 0;
+    uint64_t *data = (uint64_t *)malloc(ROOFLINE_BUFFER_BYTES);
+    if (data) {
+        // Touch every page first, so that the timed pass doesn't
+        // measure page faults.
+        memset(data, 1, ROOFLINE_BUFFER_BYTES);
+        c.data = data;
+        c.words_per_task = ROOFLINE_BUFFER_BYTES / sizeof(uint64_t) / tasks;
+        t0 = halide_current_time_ns(user_context);
+        halide_do_par_for(user_context, roofline_stream_task, 0, tasks, (uint8_t *)&c);
+        t1 = halide_current_time_ns(user_context);
+        double bytes = (double)c.words_per_task * tasks * sizeof(uint64_t);
+        gbytes = t1 > t0 ? bytes / (t1 - t0) : 0;
+        free(data);
+    }
+
+    halide_profiler_state *s = halide_profiler_get_state();
+    {
+        ScopedMutexLock lock(&s->lock);
+        s->peak_gops = gops;
+        s->peak_gbytes = gbytes;
+    }
+    roofline_status = 2;
+    return 0;
+}
+
+// Returns the state of the calling thread, creating it (and opening
+// its hardware counters) the first time the thread asks. Called at
+// the start of every parallel task by pipelines compiled with
+// profile_by_thread, so it avoids the lock: the list is only ever
+// prepended to while pipelines are running.
+WEAK halide_profiler_thread_state *halide_profiler_get_thread_state(halide_profiler_state *s) {
+    uint64_t id = halide_host_current_thread_id();
+    for (halide_profiler_thread_state *t = s->threads; t;
+         t = (halide_profiler_thread_state *)(t->next)) {
+        if (t->thread_id == id) {
+            return t;
+        }
+    }
+
+    halide_profiler_thread_state *t =
+        (halide_profiler_thread_state *)malloc(sizeof(halide_profiler_thread_state));
+    if (!t) {
+        // Writes to this go nowhere, and it is never sampled.
+        static halide_profiler_thread_state dummy;
+        return &dummy;
+    }
+    t->thread_id = id;
+    t->current_func = halide_profiler_outside_of_halide;
+    for (int c = 0; c < halide_profiler_num_counters; c++) {
+        t->counter_handles[c] = halide_host_open_perf_counter(c);
+        t->last_counts[c] = 0;
+        if (t->counter_handles[c] >= 0) {
+            halide_host_read_perf_counter(t->counter_handles[c], &t->last_counts[c]);
+        }
+    }
+    halide_profiler_thread_state *head;
+    do {
+        head = s->threads;
+        t->next = head;
+    } while (!__sync_bool_compare_and_swap(&s->threads, head, t));
+    return t;
+}
+
 WEAK void halide_profiler_stack_peak_update(void *user_context,
                                             void *pipeline_state,
                                             uint64_t *f_values) {
@@ -237,6 +730,10 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     // current desctructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
+    if (p_stats->allocations && p_stats->runs == 1) {
+        record_allocation(user_context, p_stats, func_id, incr);
+    }
+
     // Update per-pipeline memory stats
     __sync_add_and_fetch(&p_stats->num_allocs, 1);
     __sync_add_and_fetch(&p_stats->memory_total, incr);
@@ -273,6 +770,10 @@ WEAK void halide_profiler_memory_free(void *user_context,
     // current destructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
+    if (p_stats->allocations && p_stats->runs == 1) {
+        record_free(user_context, p_stats, func_id, decr);
+    }
+
     // Update per-pipeline memory stats
     __sync_sub_and_fetch(&p_stats->memory_current, decr);
 
@@ -280,6 +781,47 @@ WEAK void halide_profiler_memory_free(void *user_context,
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
 }
 
+WEAK int halide_profiler_write_profile_unlocked(void *user_context, halide_profiler_state *s,
+                                                const char *filename) {
+    void *f = fopen(filename, "w");
+    if (!f) {
+        error(user_context) << "Could not open profile output " << filename << "\n";
+        return halide_error_code_generic_error;
+    }
+
+    // Lines hold a pipeline name, a func name or a branch condition,
+    // so use a large buffer. Longer lines are truncated, and won't
+    // match anything when the profile is read back.
+    char line_buf[4096];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+    bool ok = true;
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->runs) continue;
+        sstr.clear();
+        sstr << "pipeline " << p->name << " " << p->runs << " " << p->time << "\n";
+        ok &= fwrite(sstr.str(), sstr.size(), 1, f) == 1;
+        for (int i = 0; i < p->num_funcs; i++) {
+            sstr.clear();
+            sstr << "func " << p->name << " " << p->funcs[i].name << " " << p->funcs[i].time << "\n";
+            ok &= fwrite(sstr.str(), sstr.size(), 1, f) == 1;
+        }
+        for (int i = 0; i < p->num_branches; i++) {
+            sstr.clear();
+            sstr << "branch " << p->name << " "
+                 << p->branch_counts[2 * i] << " " << p->branch_counts[2 * i + 1] << " "
+                 << p->branch_names[i] << "\n";
+            ok &= fwrite(sstr.str(), sstr.size(), 1, f) == 1;
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        error(user_context) << "Could not write profile output " << filename << "\n";
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
 
     char line_buf[1024];
@@ -306,6 +848,31 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+
+        uint64_t counters[halide_profiler_num_counters] = {0};
+        bool have_counters = false;
+        for (int i = 0; i < p->num_funcs; i++) {
+            for (int c = 0; c < halide_profiler_num_counters; c++) {
+                counters[c] += p->funcs[i].counters[c];
+                have_counters |= p->funcs[i].counters[c] != 0;
+            }
+        }
+        if (have_counters) {
+            sstr << " all threads:";
+            print_counters(sstr, counters, p->runs);
+            sstr << "\n";
+        }
+        bool have_roofline = false;
+        for (int i = 0; i < p->num_funcs; i++) {
+            have_roofline |= p->funcs[i].ops != 0 || p->funcs[i].bytes != 0;
+        }
+        if (have_roofline && s->peak_gops > 0) {
+            sstr << " machine peak gop/s: " << s->peak_gops;
+            sstr.erase(4);
+            sstr << "  peak gb/s: " << s->peak_gbytes;
+            sstr.erase(4);
+            sstr << "\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -374,11 +941,30 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+                if (fs->remote_cycles > 0) {
+                    sstr << " remote cycles/run: " << fs->remote_cycles / p->runs;
+                }
+                if (fs->remote_lock_wait_cycles > 0) {
+                    sstr << " lock wait cycles/run: " << fs->remote_lock_wait_cycles / p->runs;
+                }
+                if (have_counters) {
+                    print_counters(sstr, fs->counters, p->runs);
+                }
+                if (have_roofline) {
+                    print_roofline(sstr, s, fs);
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
             }
         }
+
+        print_allocation_lifetimes(user_context, p);
+    }
+
+    const char *profile_output = getenv("HL_PROFILE_OUTPUT");
+    if (profile_output && profile_output[0]) {
+        halide_profiler_write_profile_unlocked(user_context, s, profile_output);
     }
 }
 
@@ -388,14 +974,33 @@ WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_report_unlocked(user_context, s);
 }
 
+WEAK int halide_profiler_write_profile(void *user_context, const char *filename) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return halide_profiler_write_profile_unlocked(user_context, s, filename);
+}
+
 
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
     while (s->pipelines) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
         free(p->funcs);
+        free(p->allocations);
+        free(p->branch_counts);
+        free(p->branch_names);
         free(p);
     }
+    while (s->threads) {
+        halide_profiler_thread_state *t = s->threads;
+        s->threads = (halide_profiler_thread_state *)(t->next);
+        for (int c = 0; c < halide_profiler_num_counters; c++) {
+            if (t->counter_handles[c] >= 0) {
+                halide_host_close_perf_counter(t->counter_handles[c]);
+            }
+        }
+        free(t);
+    }
     s->first_free_id = 0;
 }
 
@@ -453,7 +1058,20 @@ WEAK void halide_windows_profiler_shutdown() {
 }
 
 WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
-    ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
+    halide_profiler_state *s = (halide_profiler_state *)state;
+    s->current_func = halide_profiler_outside_of_halide;
+    if (s->threads) {
+        // Stop billing the calling thread's counters, including when
+        // the pipeline exits early with an error.
+        uint64_t id = halide_host_current_thread_id();
+        for (halide_profiler_thread_state *t = s->threads; t;
+             t = (halide_profiler_thread_state *)(t->next)) {
+            if (t->thread_id == id) {
+                t->current_func = halide_profiler_outside_of_halide;
+                break;
+            }
+        }
+    }
 }
 
 } // extern "C"
@@ -12,6 +12,26 @@ WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_
     return 0;
 }
 
+WEAK __attribute__((always_inline)) int halide_profiler_set_thread_current_func(halide_profiler_thread_state *thread, int tok, int t) {
+    volatile int *ptr = &(thread->current_func);
+    asm volatile ("":::);
+    *ptr = tok + t;
+    asm volatile ("":::);
+    return 0;
+}
+
+WEAK __attribute__((always_inline)) int halide_profiler_count_ops(halide_profiler_pipeline_stats *p, int func_id, uint64_t ops, uint64_t bytes) {
+    halide_profiler_func_stats *f = p->funcs + func_id;
+    __sync_fetch_and_add(&(f->ops), ops);
+    __sync_fetch_and_add(&(f->bytes), bytes);
+    return 0;
+}
+
+WEAK __attribute__((always_inline)) int halide_profiler_count_branch(halide_profiler_pipeline_stats *p, int branch_id, int taken) {
+    __sync_fetch_and_add(p->branch_counts + 2 * branch_id + (taken ? 0 : 1), (uint64_t)1);
+    return 0;
+}
+
 WEAK __attribute__((always_inline)) int halide_profiler_incr_active_threads(halide_profiler_state *state) {
     volatile int *ptr = &(state->active_threads);
     asm volatile ("":::);
@@ -108,6 +108,11 @@ WEAK halide_free_t halide_set_custom_free(halide_free_t user_free) {
     return result;
 }
 
+// Huge pages are not supported on Hexagon.
+WEAK size_t halide_set_huge_page_threshold(size_t bytes) {
+    return 0;
+}
+
 // TODO: These should be calling custom_malloc/custom_free, but globals are not
 // initialized correctly when using mmap_dlopen. We need to fix this, then we
 // can enable the custom allocators.
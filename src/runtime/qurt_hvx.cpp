@@ -5,6 +5,27 @@
 
 using namespace Halide::Runtime::Internal::Qurt;
 
+namespace Halide { namespace Runtime { namespace Internal { namespace Qurt {
+
+// Whether a context locked for a whole pipeline is kept by the
+// calling thread when the pipeline returns, so that the next pipeline
+// run on that thread doesn't need to lock it again. Set by the
+// process hosting the pipelines, which must then unlock the context
+// itself.
+WEAK bool keep_hvx_locked = false;
+
+// The total number of cycles spent waiting in qurt_hvx_lock.
+WEAK uint64_t hvx_lock_wait_cycles = 0;
+
+__attribute__((always_inline))
+inline uint64_t read_pcycles() {
+    uint64_t cycles;
+    __asm__ __volatile__ ("%0 = upcycle" : "=r"(cycles));
+    return cycles;
+}
+
+}}}}  // namespace Halide::Runtime::Internal::Qurt
+
 extern "C" {
 
 WEAK int halide_qurt_hvx_lock(void *user_context, int size) {
@@ -17,8 +38,22 @@ WEAK int halide_qurt_hvx_lock(void *user_context, int size) {
         return -1;
     }
 
+    if (keep_hvx_locked) {
+        // This thread may still hold the context it kept from the
+        // last pipeline.
+        int held = qurt_hvx_get_mode();
+        if (held == (int)mode) {
+            return 0;
+        } else if (held >= 0) {
+            // Kept in the wrong mode.
+            qurt_hvx_unlock();
+        }
+    }
+
     debug(user_context) << "QuRT: qurt_hvx_lock(" << mode << ") ->\n";
+    uint64_t t0 = read_pcycles();
     int result = qurt_hvx_lock(mode);
+    __sync_fetch_and_add(&hvx_lock_wait_cycles, read_pcycles() - t0);
     debug(user_context) << "        " << result << "\n";
     if (result != QURT_EOK) {
         error(user_context) << "qurt_hvx_lock failed\n";
@@ -43,6 +78,20 @@ WEAK void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*
     halide_qurt_hvx_unlock(user_context);
 }
 
+WEAK void halide_qurt_hvx_unlock_or_keep_as_destructor(void *user_context, void * /*obj*/) {
+    if (!keep_hvx_locked) {
+        halide_qurt_hvx_unlock(user_context);
+    }
+}
+
+WEAK void halide_qurt_hvx_set_keep_locked(int keep) {
+    keep_hvx_locked = keep != 0;
+}
+
+WEAK uint64_t halide_qurt_hvx_lock_wait_cycles() {
+    return hvx_lock_wait_cycles;
+}
+
 // These need to inline, otherwise the extern call with the ptr
 // parameter breaks a lot of optimizations.
 __attribute__((always_inline))
@@ -32,6 +32,36 @@ int halide_host_cpu_count() {
     return 4;
 }
 
+// No NUMA support. Treat the machine as a single node.
+int halide_host_numa_node_count() {
+    return 1;
+}
+
+int halide_host_current_numa_node() {
+    return 0;
+}
+
+int halide_host_pin_thread_to_numa_node(int node) {
+    return 0;
+}
+
+// There is no clock to record a timeline with, so it is never
+// enabled on Hexagon.
+WEAK uint64_t halide_timeline_begin() {
+    return 0;
+}
+
+WEAK void halide_timeline_end(const char *name, const char *category,
+                              uint64_t begin_ns, int64_t arg0, int64_t arg1) {
+}
+
+WEAK void halide_set_timeline_file(const char *filename) {
+}
+
+WEAK int halide_timeline_flush() {
+    return 0;
+}
+
 #define STACK_SIZE 256*1024
 
 WEAK struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closure) {
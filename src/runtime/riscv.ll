@@ -0,0 +1,12 @@
+define weak_odr float @fast_inverse_f32(float %x) nounwind alwaysinline {
+       %y = fdiv float 1.000000e+00, %x
+       ret float %y
+}
+
+declare float @sqrt_f32(float)
+
+define weak_odr float @fast_inverse_sqrt_f32(float %x) nounwind alwaysinline {
+       %y = call float @sqrt_f32(float %x)
+       %z = fdiv float 1.000000e+00, %y
+       ret float %z
+}
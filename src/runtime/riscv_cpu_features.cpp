@@ -0,0 +1,11 @@
+#include "HalideRuntime.h"
+#include "cpu_features.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK CpuFeatures halide_get_cpu_features() {
+    // RISC-V has no CPU-specific Features.
+    return CpuFeatures();
+}
+
+}}} // namespace Halide::Runtime::Internal
@@ -6,6 +6,7 @@
 #include "HalideRuntimeMetal.h"
 #include "HalideRuntimeHexagonHost.h"
 #include "HalideRuntimeD3D12Compute.h"
+#include "HalideRuntimeVulkan.h"
 #include "HalideRuntimeQurt.h"
 #include "cpu_features.h"
 
@@ -17,9 +18,12 @@
 // cat src/runtime/runtime_internal.h src/runtime/HalideRuntime*.h | grep "^[^ ][^(]*halide_[^ ]*(" | grep -v '#define' | sed "s/[^(]*halide/halide/" | sed "s/(.*//" | sed "s/^h/    \(void *)\&h/" | sed "s/$/,/" | sort | uniq
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_adaptive_do_par_for,
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
+    (void *)&halide_can_reuse_device_allocations,
     (void *)&halide_can_use_target_features,
+    (void *)&halide_cancel_pipeline,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
@@ -28,15 +32,26 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_copy_to_host,
     (void *)&halide_copy_to_host_legacy,
     (void *)&halide_create_temp_file,
+    (void *)&halide_cuda_buffer_texture,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
     (void *)&halide_cuda_get_device_ptr,
     (void *)&halide_cuda_initialize_kernels,
+    (void *)&halide_cuda_launch_graph_begin,
+    (void *)&halide_cuda_launch_graph_end,
+    (void *)&halide_cuda_launch_graph_flush,
+    (void *)&halide_cuda_release_unused_device_allocations,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_set_launch_graphs,
+    (void *)&halide_cuda_set_mapped_host_memory,
+    (void *)&halide_cuda_set_stream_per_thread,
+    (void *)&halide_cuda_stream_fence,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
     (void *)&halide_debug_to_file,
     (void *)&halide_default_can_use_target_features,
+    (void *)&halide_default_first_touch,
+    (void *)&halide_device_allocation_cache_limit,
     (void *)&halide_device_and_host_free,
     (void *)&halide_device_and_host_free_as_destructor,
     (void *)&halide_device_and_host_malloc,
@@ -49,6 +64,11 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_device_release,
     (void *)&halide_device_sync,
     (void *)&halide_device_sync_legacy,
+    (void *)&halide_device_timing_is_enabled,
+    (void *)&halide_distributed_exchange_begin,
+    (void *)&halide_distributed_exchange_end,
+    (void *)&halide_distributed_num_ranks,
+    (void *)&halide_distributed_rank,
     (void *)&halide_do_par_for,
     (void *)&halide_do_parallel_tasks,
     (void *)&halide_do_task,
@@ -56,6 +76,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_double_to_string,
     (void *)&halide_downgrade_buffer_t,
     (void *)&halide_downgrade_buffer_t_device_fields,
+    (void *)&halide_enable_device_timing,
     (void *)&halide_error,
     (void *)&halide_error_access_out_of_bounds,
     (void *)&halide_error_bad_dimensions,
@@ -89,9 +110,13 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_float16_bits_to_float,
     (void *)&halide_free,
     (void *)&halide_get_cpu_features,
+    (void *)&halide_get_device_timing,
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
+    (void *)&halide_get_pipeline_control,
+    (void *)&halide_get_spin_policy,
     (void *)&halide_get_symbol,
+    (void *)&halide_get_thread_pool_stats,
     (void *)&halide_get_trace_file,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
@@ -105,6 +130,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_run,
     (void *)&halide_hexagon_set_performance,
     (void *)&halide_hexagon_set_performance_mode,
+    (void *)&halide_hexagon_set_performance_target,
+    (void *)&halide_hexagon_set_thread_policy,
     (void *)&halide_hexagon_wrap_device_handle,
     (void *)&halide_int64_to_string,
     (void *)&halide_join_thread,
@@ -112,18 +139,23 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_malloc,
     (void *)&halide_matlab_call_pipeline,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_set_func_size,
     (void *)&halide_memoization_cache_set_size,
     (void *)&halide_memoization_cache_store,
     (void *)&halide_metal_acquire_context,
+    (void *)&halide_metal_commit_command_buffer,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
     (void *)&halide_metal_get_buffer,
     (void *)&halide_metal_get_crop_offset,
     (void *)&halide_metal_initialize_kernels,
     (void *)&halide_metal_release_context,
+    (void *)&halide_metal_release_unused_device_allocations,
     (void *)&halide_metal_run,
+    (void *)&halide_metal_set_heap_allocation,
     (void *)&halide_metal_wrap_buffer,
     (void *)&halide_msan_annotate_buffer_is_initialized,
     (void *)&halide_msan_annotate_buffer_is_initialized_as_destructor,
@@ -135,12 +167,17 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_cl_mem,
     (void *)&halide_opencl_get_device_type,
     (void *)&halide_opencl_get_platform_name,
+    (void *)&halide_opencl_get_program_cache_dir,
     (void *)&halide_opencl_get_crop_offset,
     (void *)&halide_opencl_initialize_kernels,
+    (void *)&halide_opencl_release_unused_device_allocations,
     (void *)&halide_opencl_run,
     (void *)&halide_opencl_set_device_type,
+    (void *)&halide_opencl_set_out_of_order_queue,
     (void *)&halide_opencl_set_platform_name,
+    (void *)&halide_opencl_set_program_cache_dir,
     (void *)&halide_opencl_wrap_cl_mem,
+    (void *)&halide_opengl_begin_copy_to_host,
     (void *)&halide_opengl_context_lost,
     (void *)&halide_opengl_create_context,
     (void *)&halide_opengl_detach_texture,
@@ -154,10 +191,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_device_interface,
     (void *)&halide_openglcompute_initialize_kernels,
     (void *)&halide_openglcompute_run,
+    (void *)&halide_pipeline_control_init,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
+    (void *)&halide_profiler_measure_roofline,
     (void *)&halide_profiler_memory_allocate,
     (void *)&halide_profiler_memory_free,
     (void *)&halide_profiler_pipeline_start,
@@ -167,7 +206,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
+    (void *)&halide_register_device_allocation_pool,
+    (void *)&halide_register_device_timer,
     (void *)&halide_release_jit_module,
+    (void *)&halide_release_unused_device_allocations,
+    (void *)&halide_reset_thread_pool_stats,
+    (void *)&halide_reuse_device_allocations,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
@@ -175,31 +219,58 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_loop_task,
     (void *)&halide_set_custom_do_task,
+    (void *)&halide_set_custom_first_touch,
     (void *)&halide_set_custom_free,
     (void *)&halide_set_custom_get_library_symbol,
+    (void *)&halide_set_custom_get_pipeline_control,
     (void *)&halide_set_custom_get_symbol,
     (void *)&halide_set_custom_load_library,
     (void *)&halide_set_custom_malloc,
     (void *)&halide_set_custom_print,
     (void *)&halide_set_custom_trace,
+    (void *)&halide_set_device_allocation_cache_limit,
+    (void *)&halide_set_distributed_comm,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_huge_page_threshold,
+    (void *)&halide_set_numa_aware,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_pipeline_priority,
+    (void *)&halide_set_pipeline_thread_pool,
+    (void *)&halide_set_spin_policy,
+    (void *)&halide_set_timeline_file,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
     (void *)&halide_spawn_thread,
     (void *)&halide_start_clock,
+    (void *)&halide_strided_fallback_warning,
     (void *)&halide_string_to_string,
+    (void *)&halide_thread_pool_create,
+    (void *)&halide_thread_pool_destroy,
+    (void *)&halide_thread_pool_find,
+    (void *)&halide_timeline_flush,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
     (void *)&halide_uint64_to_string,
     (void *)&halide_upgrade_buffer_t,
     (void *)&halide_use_jit_module,
+    (void *)&halide_work_stealing_do_par_for,
     (void *)&halide_d3d12compute_acquire_context,
     (void *)&halide_d3d12compute_device_interface,
     (void *)&halide_d3d12compute_initialize_kernels,
     (void *)&halide_d3d12compute_release_context,
     (void *)&halide_d3d12compute_run,
+    (void *)&halide_vulkan_acquire_context,
+    (void *)&halide_vulkan_commit_command_buffer,
+    (void *)&halide_vulkan_detach_buffer,
+    (void *)&halide_vulkan_device_interface,
+    (void *)&halide_vulkan_get_buffer,
+    (void *)&halide_vulkan_get_crop_offset,
+    (void *)&halide_vulkan_initialize_kernels,
+    (void *)&halide_vulkan_release_context,
+    (void *)&halide_vulkan_release_unused_device_allocations,
+    (void *)&halide_vulkan_run,
+    (void *)&halide_vulkan_wrap_buffer,
 };
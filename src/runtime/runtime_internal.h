@@ -78,6 +78,7 @@ int fileno(void *);
 int fclose(void *);
 int close(int);
 size_t fwrite(const void *, size_t, size_t, void *);
+size_t fread(void *, size_t, size_t, void *);
 ssize_t write(int fd, const void *buf, size_t bytes);
 int remove(const char *pathname);
 int ioctl(int fd, unsigned long request, ...);
@@ -132,8 +133,47 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
                                         const uint64_t *func_names);
+WEAK int halide_profiler_register_branches(void *user_context,
+                                           void *pipeline_state,
+                                           int num_branches,
+                                           const uint64_t *branch_names);
+WEAK struct halide_profiler_thread_state *halide_profiler_get_thread_state(struct halide_profiler_state *s);
 WEAK int halide_host_cpu_count();
 
+// The NUMA topology of the host. Platforms without NUMA support
+// report a single node. Pinning returns zero on success.
+WEAK int halide_host_numa_node_count();
+WEAK int halide_host_current_numa_node();
+WEAK int halide_host_pin_thread_to_numa_node(int node);
+
+// Ask the OS to back a range of memory with huge pages. The range
+// should be aligned to HUGE_PAGE_SIZE. Returns zero on success;
+// platforms without transparent huge pages do nothing and return -1.
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+WEAK int halide_host_advise_huge_pages(void *ptr, size_t size);
+
+// An identifier for the calling thread, and its hardware performance
+// counters (see halide_profiler_counter_t) where the OS exposes
+// them. Opening a counter returns a handle, or -1 if it is
+// unavailable. Reading returns zero on success.
+WEAK uint64_t halide_host_current_thread_id();
+WEAK int halide_host_open_perf_counter(int counter);
+WEAK int halide_host_read_perf_counter(int handle, uint64_t *value);
+WEAK void halide_host_close_perf_counter(int handle);
+
+// Record an interval on the timeline (see halide_set_timeline_file).
+// halide_timeline_begin returns zero if the timeline is not being
+// recorded, in which case halide_timeline_end does nothing. The
+// arguments are the loop min and extent for tasks, the block and
+// thread counts for GPU kernels, and the size in bytes for copies.
+WEAK uint64_t halide_timeline_begin();
+WEAK void halide_timeline_end(const char *name, const char *category,
+                              uint64_t begin_ns, int64_t arg0, int64_t arg1);
+
+// Add a kernel or copy time measured on the device to the totals
+// returned by halide_get_device_timing.
+WEAK void halide_device_timing_add(bool is_copy, uint64_t ns);
+
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
 WEAK int halide_device_and_host_free(void *user_context, struct halide_buffer_t *buf);
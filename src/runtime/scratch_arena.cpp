@@ -0,0 +1,189 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The arenas that serve the heap allocations inside parallel loops of
+// pipelines compiled with the scratch_arena feature. Each iteration of
+// a parallel loop claims an arena on entry and hands it back on exit,
+// so there are only ever about as many arenas in use as there are
+// threads working. An arena is found by hashing the address of the
+// claiming thread's stack, so each worker thread keeps getting the
+// same arena back, and its memory stays warm in that core's caches.
+
+struct scratch_arena;
+
+// Every allocation is preceded by a header. The headers form a stack,
+// so that memory can be reclaimed when the most recent allocation is
+// freed, even if allocations are freed out of order.
+struct scratch_header {
+    scratch_arena *arena;
+    scratch_header *prev;
+    // Where the arena's cursor was before this allocation.
+    uint8_t *begin;
+    // The bytes this allocation counts towards the arena's usage.
+    size_t bytes;
+    bool freed;
+    // Served from halide_malloc, because the arena was full.
+    bool on_heap;
+};
+
+struct scratch_arena {
+    // Nonzero while claimed by a task.
+    int in_use;
+    uint8_t *memory, *cursor, *end;
+    scratch_header *top;
+    // The most memory, including overflow onto the heap, that the
+    // current task has used. The arena grows to fit it on release.
+    size_t in_use_bytes, high_water;
+};
+
+#define SCRATCH_ARENA_COUNT 256
+
+// The size an arena starts at.
+#define SCRATCH_ARENA_MIN_SIZE (64 * 1024)
+
+WEAK scratch_arena scratch_arenas[SCRATCH_ARENA_COUNT];
+
+WEAK size_t scratch_header_size() {
+    const size_t alignment = halide_malloc_alignment();
+    return (sizeof(scratch_header) + alignment - 1) & ~(alignment - 1);
+}
+
+WEAK void scratch_pop(void *user_context, scratch_arena *arena) {
+    scratch_header *h = arena->top;
+    arena->top = h->prev;
+    arena->cursor = h->begin;
+    arena->in_use_bytes -= h->bytes;
+    if (h->on_heap) {
+        halide_free(user_context, h);
+    }
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+// Called at the start of each iteration of a parallel loop that
+// makes heap allocations. Returns NULL if every arena is busy, in
+// which case the allocations go to the heap.
+WEAK __attribute__((used)) void *halide_scratch_acquire(void *user_context) {
+    int here;
+    uintptr_t hint = (uintptr_t)&here;
+    // Thread stacks are at least tens of kilobytes apart.
+    hint = (hint >> 16) ^ (hint >> 24);
+    for (int i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+        scratch_arena *arena = &scratch_arenas[(hint + i) % SCRATCH_ARENA_COUNT];
+        if (!arena->in_use && __sync_bool_compare_and_swap(&arena->in_use, 0, 1)) {
+            return arena;
+        }
+    }
+    return NULL;
+}
+
+// Serves a heap allocation inside a parallel loop by bumping the
+// cursor of the iteration's arena.
+WEAK __attribute__((used)) void *halide_scratch_malloc(void *user_context, void *ptr, uint64_t size) {
+    scratch_arena *arena = (scratch_arena *)ptr;
+    const size_t alignment = halide_malloc_alignment();
+    const size_t header_size = scratch_header_size();
+    // Count the worst-case alignment padding too.
+    const size_t bytes = alignment + header_size + size;
+    scratch_header *h = NULL;
+    uint8_t *begin = NULL;
+    if (arena) {
+        begin = arena->cursor;
+        arena->in_use_bytes += bytes;
+        if (arena->in_use_bytes > arena->high_water) {
+            arena->high_water = arena->in_use_bytes;
+        }
+        uint8_t *start = (uint8_t *)(((uintptr_t)begin + alignment - 1) & ~(alignment - 1));
+        if (arena->memory && start + header_size + size <= arena->end) {
+            h = (scratch_header *)start;
+            h->on_heap = false;
+            arena->cursor = start + header_size + size;
+        }
+    }
+    if (!h) {
+        h = (scratch_header *)halide_malloc(user_context, header_size + size);
+        if (!h) {
+            return NULL;
+        }
+        h->on_heap = true;
+    }
+    h->arena = arena;
+    h->freed = false;
+    if (arena) {
+        h->begin = begin;
+        h->bytes = bytes;
+        h->prev = arena->top;
+        arena->top = h;
+    }
+    return (uint8_t *)h + header_size;
+}
+
+// The free function of the allocations served by
+// halide_scratch_malloc.
+WEAK __attribute__((used)) void halide_scratch_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    scratch_header *h = (scratch_header *)((uint8_t *)ptr - scratch_header_size());
+    scratch_arena *arena = h->arena;
+    if (!arena) {
+        halide_free(user_context, h);
+        return;
+    }
+    h->freed = true;
+    while (arena->top && arena->top->freed) {
+        scratch_pop(user_context, arena);
+    }
+}
+
+// Called at the end of each iteration of a parallel loop (or on
+// error) to reset the arena and hand it back.
+WEAK __attribute__((used)) void halide_scratch_release(void *user_context, void *ptr) {
+    scratch_arena *arena = (scratch_arena *)ptr;
+    if (!arena) {
+        return;
+    }
+    while (arena->top) {
+        scratch_pop(user_context, arena);
+    }
+    // If the iteration didn't fit, grow the arena so that the next
+    // one will.
+    size_t size = arena->end - arena->memory;
+    if (arena->high_water > size) {
+        size = size ? size : SCRATCH_ARENA_MIN_SIZE;
+        while (size < arena->high_water) {
+            size *= 2;
+        }
+        if (arena->memory) {
+            halide_free(user_context, arena->memory);
+        }
+        arena->memory = (uint8_t *)halide_malloc(user_context, size);
+        arena->end = arena->memory ? arena->memory + size : NULL;
+    }
+    arena->cursor = arena->memory;
+    arena->in_use_bytes = 0;
+    __atomic_store_n(&arena->in_use, 0, __ATOMIC_RELEASE);
+}
+
+}
+
+namespace {
+#ifndef WINDOWS
+__attribute__((destructor))
+#endif
+WEAK void halide_scratch_arena_cleanup() {
+    for (int i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+        scratch_arena *arena = &scratch_arenas[i];
+        if (!arena->in_use && arena->memory) {
+            halide_free(NULL, arena->memory);
+            arena->memory = arena->cursor = arena->end = NULL;
+        }
+    }
+}
+}
@@ -0,0 +1,82 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The signature that last passed the checks on the inputs and outputs
+// of a pipeline compiled with the cache_shape_checks feature: the
+// fields of its buffers, other than the host and device pointers, and
+// the parameter values the checks depend on. Each pipeline has a
+// pointer to one of these, allocated when the checks first pass and
+// never freed.
+//
+// Readers don't take a lock. The sequence number is odd while the
+// signature is being rewritten, and a reader that sees it change while
+// comparing treats the call as a miss.
+struct shape_check_cache {
+    uint32_t sequence;
+    int32_t size;
+    uint64_t signature[1];
+};
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+// Returns 1 if the signature matches the one that last passed the
+// checks, so that they can be skipped, and 0 otherwise.
+WEAK __attribute__((used)) int halide_shape_check_cache_lookup(void **cache_ptr, const uint64_t *signature, int32_t size) {
+    shape_check_cache *cache = (shape_check_cache *)__atomic_load_n(cache_ptr, __ATOMIC_ACQUIRE);
+    if (!cache || cache->size != size) {
+        return 0;
+    }
+    uint32_t sequence = __atomic_load_n(&cache->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1) {
+        return 0;
+    }
+    bool match = true;
+    for (int32_t i = 0; i < size; i++) {
+        match &= __atomic_load_n(&cache->signature[i], __ATOMIC_RELAXED) == signature[i];
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return match && __atomic_load_n(&cache->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+// Remember a signature that has just passed the checks. If another
+// thread is storing one at the same time, one of them is dropped.
+WEAK __attribute__((used)) int halide_shape_check_cache_store(void **cache_ptr, const uint64_t *signature, int32_t size) {
+    shape_check_cache *cache = (shape_check_cache *)__atomic_load_n(cache_ptr, __ATOMIC_ACQUIRE);
+    uint32_t sequence;
+    if (!cache) {
+        cache = (shape_check_cache *)malloc(sizeof(shape_check_cache) + (size - 1) * sizeof(uint64_t));
+        if (!cache) {
+            return 0;
+        }
+        // Start out odd, as if being written.
+        cache->sequence = 1;
+        cache->size = size;
+        void *expected = NULL;
+        if (!__atomic_compare_exchange_n(cache_ptr, &expected, (void *)cache, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(cache);
+            return 0;
+        }
+        sequence = 0;
+    } else {
+        sequence = __atomic_load_n(&cache->sequence, __ATOMIC_RELAXED);
+        if ((sequence & 1) || cache->size != size ||
+            !__atomic_compare_exchange_n(&cache->sequence, &sequence, sequence + 1, false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return 0;
+        }
+    }
+    for (int32_t i = 0; i < size; i++) {
+        __atomic_store_n(&cache->signature[i], signature[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&cache->sequence, sequence + 2, __ATOMIC_RELEASE);
+    return 0;
+}
+
+}
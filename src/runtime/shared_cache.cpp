@@ -0,0 +1,722 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// A memoization cache shared by every process on a host, used instead
+// of cache.cpp when the target has the memoize_shared feature. Results
+// live in a file in a shared memory filesystem, mapped by every process
+// that uses it. The index is an open-addressed hash table in the same
+// mapping whose slots are claimed with compare-and-swap, so lookups and
+// stores never take a lock, and a process that dies part way through a
+// store can't block the others. Results are never evicted: the data
+// area is a bump allocator, and stores are skipped once it is full.
+
+extern "C" {
+
+extern int open(const char *, int, ...);
+extern int close(int);
+extern int ftruncate(int, long);
+extern long lseek(int, long, int);
+extern void *mmap(void *, size_t, int, int, int, long);
+extern int munmap(void *, size_t);
+extern int unlink(const char *);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal { namespace SharedCache {
+
+// The Linux values of the flags used here.
+#define SHARED_CACHE_O_RDWR 02
+#define SHARED_CACHE_O_CREAT 0100
+#define SHARED_CACHE_O_EXCL 0200
+#define SHARED_CACHE_O_CLOEXEC 02000000
+#define SHARED_CACHE_PROT_READ 1
+#define SHARED_CACHE_PROT_WRITE 2
+#define SHARED_CACHE_MAP_SHARED 1
+#define SHARED_CACHE_SEEK_END 2
+
+const uint64_t kSegmentMagic = 0x31434d48444c4148ULL;  // "HALDHMC1"
+const int64_t kDefaultSegmentSize = 64 << 20;
+const int64_t kMinSegmentSize = 1 << 20;
+// Enough for any target's vectors, so that processes built for
+// different targets can share a segment.
+const uint64_t kAlignment = 128;
+// How far a lookup or store probes from the home slot of a key before
+// giving up.
+const int kMaxProbes = 64;
+const int kMaxSharedFuncs = 256;
+const size_t kMaxNameLength = 63;
+
+// Per-Func statistics and budgets, in the segment so that they count
+// the work and memory of all processes.
+struct SharedFuncStats {
+    // 0 while free, 1 while a process writes the name, 2 once it can
+    // be read.
+    int32_t state;
+    uint32_t name_len;
+    char name[kMaxNameLength + 1];
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t compute_time_ns;
+    int64_t bytes;
+    int64_t max_bytes;
+};
+
+struct SharedSlot {
+    // The hash of the key, claimed with a compare-and-swap. Zero
+    // while the slot is free.
+    uint64_t hash;
+    // The offset of the entry in the segment, stored with release
+    // semantics once the entry is complete. Zero until then.
+    uint64_t entry;
+};
+
+struct SegmentHeader {
+    // Set last by the process that creates the segment.
+    uint64_t magic;
+    uint64_t size;
+    uint64_t num_slots;
+    uint64_t slots_offset;
+    // The end of the data allocated so far.
+    uint64_t data_end;
+    SharedFuncStats funcs[kMaxSharedFuncs];
+};
+
+// An entry is followed by the key, padded to eight bytes, the computed
+// bounds, and then a SharedBuffer and its dimensions for each element
+// of the Tuple. The data of the buffers comes after that.
+struct SharedEntry {
+    uint32_t key_size;
+    int32_t tuple_count;
+    int32_t dimensions;
+    int32_t padding;
+};
+
+struct SharedBuffer {
+    uint64_t data;
+    halide_type_t type;
+    int32_t padding;
+};
+
+WEAK __attribute((always_inline)) uint64_t round_up(uint64_t x, uint64_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+WEAK __attribute((always_inline)) uint8_t *entry_key(SharedEntry *entry) {
+    return (uint8_t *)(entry + 1);
+}
+
+WEAK __attribute((always_inline)) halide_dimension_t *entry_bounds(SharedEntry *entry) {
+    return (halide_dimension_t *)(entry_key(entry) + round_up(entry->key_size, 8));
+}
+
+WEAK __attribute((always_inline)) SharedBuffer *entry_buffer(SharedEntry *entry, int32_t i) {
+    uint8_t *first = (uint8_t *)(entry_bounds(entry) + entry->dimensions);
+    size_t stride = sizeof(SharedBuffer) + entry->dimensions * sizeof(halide_dimension_t);
+    return (SharedBuffer *)(first + i * stride);
+}
+
+WEAK __attribute((always_inline)) halide_dimension_t *buffer_dims(SharedBuffer *buf) {
+    return (halide_dimension_t *)(buf + 1);
+}
+
+WEAK uint64_t entry_bytes(size_t key_size, int32_t tuple_count, int32_t dimensions) {
+    return sizeof(SharedEntry) + round_up(key_size, 8) +
+        dimensions * sizeof(halide_dimension_t) +
+        tuple_count * (sizeof(SharedBuffer) + dimensions * sizeof(halide_dimension_t));
+}
+
+// The same hash as cache.cpp.
+WEAK uint64_t hash_key(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (key_size * m);
+    size_t i = 0;
+    for (; i + 8 <= key_size; i += 8) {
+        uint64_t w;
+        memcpy(&w, key + i, 8);
+        w *= m;
+        w ^= w >> 47;
+        w *= m;
+        h ^= w;
+        h *= m;
+    }
+    if (i < key_size) {
+        uint64_t w = 0;
+        memcpy(&w, key + i, key_size - i);
+        h ^= w;
+        h *= m;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    // Zero marks a free slot.
+    return h ? h : 1;
+}
+
+WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t *shape) {
+    for (int i = 0; i < buf->dimensions; i++) {
+        if (buf->dim[i] != shape[i]) return false;
+    }
+    return true;
+}
+
+// Generated code starts every cache key with a pointer to a string of
+// the form "<n>:<pipeline name><m>:<func name><k>:<definition hash>".
+// The pointer means nothing in another process, so the shared key has
+// the string itself in its place. Each part says how long it is, so
+// this can't make two different keys equal. The hash covers the Func's
+// definition, the target and the compiler, so that a pipeline that
+// reuses the names of another one doesn't find its results.
+struct CanonicalKey {
+    uint8_t *data;
+    size_t size;
+    const char *id;
+    const char *func_name;
+    size_t func_name_len;
+    uint64_t hash;
+    uint8_t local[256];
+
+    CanonicalKey() : data(NULL), size(0), id(NULL), func_name(NULL), func_name_len(0), hash(0) {}
+    ~CanonicalKey() {
+        if (data != NULL && data != local) {
+            halide_free(NULL, data);
+        }
+    }
+
+    bool init(void *user_context, const uint8_t *cache_key, int32_t key_size) {
+        if (key_size < (int32_t)sizeof(const char *)) {
+            return false;
+        }
+        memcpy(&id, cache_key, sizeof(const char *));
+        if (id == NULL) {
+            return false;
+        }
+
+        // Skip over the pipeline name, the func name, then the hash.
+        const char *p = id;
+        size_t len = 0;
+        for (int part = 0; part < 3; part++) {
+            len = 0;
+            while (*p >= '0' && *p <= '9') {
+                len = len * 10 + (*p++ - '0');
+            }
+            if (*p++ != ':') {
+                return false;
+            }
+            if (part == 1) {
+                func_name = p;
+                func_name_len = len;
+            }
+            p += len;
+        }
+
+        size_t id_len = p - id;
+        size_t rest = key_size - sizeof(const char *);
+        size = id_len + rest;
+        data = size <= sizeof(local) ? local : (uint8_t *)halide_malloc(user_context, size);
+        if (data == NULL) {
+            return false;
+        }
+        memcpy(data, id, id_len);
+        memcpy(data + id_len, cache_key + sizeof(const char *), rest);
+        hash = hash_key(data, size);
+        return true;
+    }
+};
+
+// The mapping of the segment in this process.
+WEAK halide_mutex segment_lock = { { 0 } };
+WEAK uint8_t *segment = NULL;
+WEAK uint64_t segment_size = 0;
+// Whether this process has tried to map the segment since the last
+// cleanup, so that a failure is only reported once.
+WEAK bool segment_tried = false;
+WEAK int64_t requested_segment_size = kDefaultSegmentSize;
+
+// The identifying string from the most recent cache key seen for each
+// Func in the segment, to skip the name comparison on the common path.
+WEAK const char *func_key_ids[kMaxSharedFuncs];
+
+WEAK __attribute((always_inline)) SegmentHeader *header() {
+    return (SegmentHeader *)segment;
+}
+
+WEAK __attribute((always_inline)) SharedSlot *slots() {
+    return (SharedSlot *)(segment + header()->slots_offset);
+}
+
+WEAK bool contains(const void *host) {
+    const uint8_t *p = (const uint8_t *)host;
+    return segment != NULL && p >= segment && p < segment + segment_size;
+}
+
+// Wait for another process to finish creating the segment.
+WEAK bool wait_for(void *user_context, int fd, uint64_t *size) {
+    for (int i = 0; i < 100; i++) {
+        long end = lseek(fd, 0, SHARED_CACHE_SEEK_END);
+        if (end > 0) {
+            *size = (uint64_t)end;
+            return true;
+        }
+        halide_sleep_ms(user_context, 10);
+    }
+    return false;
+}
+
+WEAK void init_segment(uint8_t *base, uint64_t size) {
+    SegmentHeader *h = (SegmentHeader *)base;
+    // The pages of a new file are zero, so all slots are already free.
+    uint64_t num_slots = 256;
+    while (num_slots * 4096 < size) {
+        num_slots *= 2;
+    }
+    h->size = size;
+    h->num_slots = num_slots;
+    h->slots_offset = round_up(sizeof(SegmentHeader), kAlignment);
+    h->data_end = round_up(h->slots_offset + num_slots * sizeof(SharedSlot), kAlignment);
+    __atomic_store_n(&h->magic, kSegmentMagic, __ATOMIC_RELEASE);
+}
+
+WEAK SegmentHeader *open_segment(void *user_context) {
+    const char *name = getenv("HL_MEMOIZATION_SEGMENT");
+    if (name == NULL || *name == 0) {
+        name = "/dev/shm/halide_memoization_cache";
+    }
+
+    int fd = open(name, SHARED_CACHE_O_RDWR | SHARED_CACHE_O_CREAT |
+                  SHARED_CACHE_O_EXCL | SHARED_CACHE_O_CLOEXEC, 0600);
+    bool created = fd >= 0;
+    if (!created) {
+        fd = open(name, SHARED_CACHE_O_RDWR | SHARED_CACHE_O_CLOEXEC);
+    }
+    uint64_t size = 0;
+    bool ok = fd >= 0;
+    if (ok && created) {
+        size = round_up(max(requested_segment_size, kMinSegmentSize), 4096);
+        ok = ftruncate(fd, (long)size) == 0;
+    } else if (ok) {
+        ok = wait_for(user_context, fd, &size) && size >= kMinSegmentSize;
+    }
+    uint8_t *base = NULL;
+    if (ok) {
+        base = (uint8_t *)mmap(NULL, size, SHARED_CACHE_PROT_READ | SHARED_CACHE_PROT_WRITE,
+                               SHARED_CACHE_MAP_SHARED, fd, 0);
+        if (base == (uint8_t *)-1) {
+            base = NULL;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (base != NULL) {
+        SegmentHeader *h = (SegmentHeader *)base;
+        if (created) {
+            init_segment(base, size);
+        } else {
+            for (int i = 0; i < 100 && __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != kSegmentMagic; i++) {
+                halide_sleep_ms(user_context, 10);
+            }
+            if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != kSegmentMagic || h->size != size) {
+                munmap(base, size);
+                base = NULL;
+            }
+        }
+    } else if (created) {
+        // Don't leave an empty segment for other processes to wait on.
+        unlink(name);
+    }
+
+    if (base == NULL) {
+        halide_print(user_context, "Could not map the shared memoization cache segment, "
+                     "so memoized Funcs will be recomputed every time\n");
+        return NULL;
+    }
+    debug(user_context) << "Mapped the shared memoization cache " << name
+                        << " (" << size << " bytes)\n";
+    segment_size = size;
+    __atomic_store_n(&segment, base, __ATOMIC_RELEASE);
+    return (SegmentHeader *)base;
+}
+
+WEAK SegmentHeader *get_segment(void *user_context) {
+    uint8_t *s = __atomic_load_n(&segment, __ATOMIC_ACQUIRE);
+    if (s != NULL || __atomic_load_n(&segment_tried, __ATOMIC_ACQUIRE)) {
+        return (SegmentHeader *)s;
+    }
+    ScopedMutexLock lock(&segment_lock);
+    if (segment_tried) {
+        return header();
+    }
+    SegmentHeader *h = open_segment(user_context);
+    __atomic_store_n(&segment_tried, true, __ATOMIC_RELEASE);
+    return h;
+}
+
+WEAK SharedFuncStats *find_func_stats(const char *name, size_t name_len, bool create) {
+    // Long names are truncated, which at worst merges the statistics
+    // of Funcs with the same prefix.
+    if (name_len > kMaxNameLength) {
+        name_len = kMaxNameLength;
+    }
+    for (int i = 0; i < kMaxSharedFuncs; i++) {
+        SharedFuncStats *f = &header()->funcs[i];
+        int32_t state = __atomic_load_n(&f->state, __ATOMIC_ACQUIRE);
+        if (state == 0) {
+            if (!create) {
+                return NULL;
+            }
+            if (__atomic_compare_exchange_n(&f->state, &state, 1, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                memcpy(f->name, name, name_len);
+                f->name[name_len] = 0;
+                f->name_len = (uint32_t)name_len;
+                __atomic_store_n(&f->state, 2, __ATOMIC_RELEASE);
+                return f;
+            }
+        }
+        // Another process is naming this record. It only has a few
+        // bytes to copy, but it may have died part way through.
+        for (int spins = 0; state == 1 && spins < 1000; spins++) {
+            halide_thread_yield();
+            state = __atomic_load_n(&f->state, __ATOMIC_ACQUIRE);
+        }
+        if (state == 2 && f->name_len == name_len && memcmp(f->name, name, name_len) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+WEAK SharedFuncStats *func_stats_for_key(const CanonicalKey &key) {
+    for (int i = 0; i < kMaxSharedFuncs; i++) {
+        if (__atomic_load_n(&func_key_ids[i], __ATOMIC_RELAXED) == key.id) {
+            return &header()->funcs[i];
+        }
+    }
+    SharedFuncStats *f = find_func_stats(key.func_name, key.func_name_len, true);
+    if (f) {
+        __atomic_store_n(&func_key_ids[f - header()->funcs], key.id, __ATOMIC_RELAXED);
+    }
+    return f;
+}
+
+WEAK bool entry_matches(SharedEntry *entry, const CanonicalKey &key,
+                        const halide_buffer_t *computed_bounds,
+                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    if (entry->key_size != key.size ||
+        entry->tuple_count != tuple_count ||
+        entry->dimensions != computed_bounds->dimensions ||
+        memcmp(entry_key(entry), key.data, key.size) != 0 ||
+        !buffer_has_shape(computed_bounds, entry_bounds(entry))) {
+        return false;
+    }
+    for (int32_t i = 0; i < tuple_count; i++) {
+        SharedBuffer *b = entry_buffer(entry, i);
+        if (tuple_buffers[i]->dimensions != entry->dimensions ||
+            tuple_buffers[i]->type != b->type ||
+            !buffer_has_shape(tuple_buffers[i], buffer_dims(b))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Probe for a matching entry. Entries are never removed, so the first
+// free slot ends the search. A slot whose entry isn't published yet
+// is skipped.
+WEAK SharedEntry *find_entry(const CanonicalKey &key, const halide_buffer_t *computed_bounds,
+                             int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedSlot *s = slots();
+    uint64_t mask = header()->num_slots - 1;
+    for (int i = 0; i < kMaxProbes; i++) {
+        SharedSlot *slot = &s[(key.hash + i) & mask];
+        uint64_t h = __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE);
+        if (h == 0) {
+            return NULL;
+        }
+        if (h != key.hash) {
+            continue;
+        }
+        uint64_t offset = __atomic_load_n(&slot->entry, __ATOMIC_ACQUIRE);
+        if (offset != 0) {
+            SharedEntry *entry = (SharedEntry *)(segment + offset);
+            if (entry_matches(entry, key, computed_bounds, tuple_count, tuple_buffers)) {
+                return entry;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Claim a free slot for the key and publish the entry in it. Returns
+// false if another process published the same result first, or there
+// is no free slot near the home slot of the key.
+WEAK bool publish_entry(const CanonicalKey &key, uint64_t offset,
+                        const halide_buffer_t *computed_bounds,
+                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedSlot *s = slots();
+    uint64_t mask = header()->num_slots - 1;
+    for (int i = 0; i < kMaxProbes; i++) {
+        SharedSlot *slot = &s[(key.hash + i) & mask];
+        uint64_t h = __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE);
+        if (h == 0 &&
+            __atomic_compare_exchange_n(&slot->hash, &h, key.hash, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&slot->entry, offset, __ATOMIC_RELEASE);
+            return true;
+        }
+        if (h == key.hash) {
+            uint64_t other = __atomic_load_n(&slot->entry, __ATOMIC_ACQUIRE);
+            if (other != 0 &&
+                entry_matches((SharedEntry *)(segment + other), key,
+                              computed_bounds, tuple_count, tuple_buffers)) {
+                return false;
+            }
+        }
+    }
+    return false;
+}
+
+WEAK uint64_t allocate(uint64_t bytes) {
+    bytes = round_up(bytes, kAlignment);
+    uint64_t end = __atomic_load_n(&header()->data_end, __ATOMIC_RELAXED);
+    do {
+        if (end + bytes > segment_size) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&header()->data_end, &end, end + bytes, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return end;
+}
+
+// The buffers of a miss are private to the process until they are
+// stored. Like cache.cpp, each has a header just before the contents,
+// which here only says when the lookup missed.
+struct CacheBlockHeader {
+    int64_t miss_time_ns;
+};
+
+WEAK __attribute((always_inline)) size_t header_bytes() {
+    size_t s = sizeof(CacheBlockHeader);
+    size_t mask = halide_malloc_alignment() - 1;
+    return (s + mask) & ~mask;
+}
+
+WEAK CacheBlockHeader *get_pointer_to_header(uint8_t *host) {
+    return (CacheBlockHeader *)(host - header_bytes());
+}
+
+}}}}  // namespace Halide::Runtime::Internal::SharedCache
+
+using namespace Halide::Runtime::Internal::SharedCache;
+
+extern "C" {
+
+WEAK void halide_memoization_cache_set_size(int64_t size) {
+    // The size of a segment is fixed by the process that creates it.
+    if (size == 0) {
+        size = kDefaultSegmentSize;
+    }
+    __atomic_store_n(&requested_segment_size, size, __ATOMIC_RELAXED);
+}
+
+WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
+                                         halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    CanonicalKey key;
+    if (get_segment(user_context) != NULL && key.init(user_context, cache_key, size)) {
+        SharedFuncStats *func = func_stats_for_key(key);
+        SharedEntry *entry = find_entry(key, computed_bounds, tuple_count, tuple_buffers);
+        if (entry) {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                buf->host = segment + entry_buffer(entry, i)->data;
+                buf->device = 0;
+                buf->device_interface = NULL;
+                buf->set_device_dirty(false);
+                // So that the data is copied if the buffer is later
+                // used on a device.
+                buf->set_host_dirty(true);
+            }
+            if (func) {
+                __atomic_fetch_add(&func->hits, (uint64_t)1, __ATOMIC_RELAXED);
+            }
+            return 0;
+        }
+        if (func) {
+            __atomic_fetch_add(&func->misses, (uint64_t)1, __ATOMIC_RELAXED);
+        }
+    }
+
+    // A miss. The caller computes into private storage, which the
+    // store copies into the segment.
+    halide_start_clock(user_context);
+    int64_t miss_time = halide_current_time_ns(user_context);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        halide_buffer_t *buf = tuple_buffers[i];
+
+        buf->host = ((uint8_t *)halide_malloc(user_context, buf->size_in_bytes() + header_bytes()));
+        if (buf->host == NULL) {
+            for (int32_t j = i; j > 0; j--) {
+                halide_free(user_context, get_pointer_to_header(tuple_buffers[j - 1]->host));
+                tuple_buffers[j - 1]->host = NULL;
+            }
+            return -1;
+        }
+        buf->host += header_bytes();
+        get_pointer_to_header(buf->host)->miss_time_ns = miss_time;
+    }
+
+    return 1;
+}
+
+WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache_key, int32_t size,
+                                        halide_buffer_t *computed_bounds,
+                                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    debug(user_context) << "halide_memoization_cache_store\n";
+
+    CanonicalKey key;
+    if (get_segment(user_context) == NULL || !key.init(user_context, cache_key, size)) {
+        return 0;
+    }
+
+    SharedFuncStats *func = func_stats_for_key(key);
+    int64_t cost = halide_current_time_ns(user_context) -
+        get_pointer_to_header(tuple_buffers[0]->host)->miss_time_ns;
+    if (func && cost > 0) {
+        __atomic_fetch_add(&func->compute_time_ns, (uint64_t)cost, __ATOMIC_RELAXED);
+    }
+
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < tuple_count; i++) {
+        // Only results on the host can be shared.
+        if (tuple_buffers[i]->device_dirty()) {
+            return 0;
+        }
+        bytes += round_up(tuple_buffers[i]->size_in_bytes(), kAlignment);
+    }
+    if (func) {
+        int64_t max_bytes = __atomic_load_n(&func->max_bytes, __ATOMIC_RELAXED);
+        if (max_bytes > 0 && __atomic_load_n(&func->bytes, __ATOMIC_RELAXED) + bytes > max_bytes) {
+            return 0;
+        }
+    }
+
+    // Another process may have stored the same result while this one
+    // was computing it.
+    if (find_entry(key, computed_bounds, tuple_count, tuple_buffers) != NULL) {
+        return 0;
+    }
+
+    int32_t dimensions = computed_bounds->dimensions;
+    uint64_t metadata_bytes = round_up(entry_bytes(key.size, tuple_count, dimensions), kAlignment);
+    uint64_t offset = allocate(metadata_bytes + bytes);
+    if (offset == 0) {
+        debug(user_context) << "The shared memoization cache is full\n";
+        return 0;
+    }
+
+    SharedEntry *entry = (SharedEntry *)(segment + offset);
+    entry->key_size = (uint32_t)key.size;
+    entry->tuple_count = tuple_count;
+    entry->dimensions = dimensions;
+    memcpy(entry_key(entry), key.data, key.size);
+    for (int32_t i = 0; i < dimensions; i++) {
+        entry_bounds(entry)[i] = computed_bounds->dim[i];
+    }
+    uint64_t data = offset + metadata_bytes;
+    for (int32_t i = 0; i < tuple_count; i++) {
+        halide_buffer_t *buf = tuple_buffers[i];
+        SharedBuffer *b = entry_buffer(entry, i);
+        b->data = data;
+        b->type = buf->type;
+        for (int32_t j = 0; j < dimensions; j++) {
+            buffer_dims(b)[j] = buf->dim[j];
+        }
+        memcpy(segment + data, buf->host, buf->size_in_bytes());
+        data += round_up(buf->size_in_bytes(), kAlignment);
+    }
+
+    // If this loses a race, the space stays allocated but unused.
+    if (publish_entry(key, offset, computed_bounds, tuple_count, tuple_buffers) && func) {
+        __atomic_fetch_add(&func->bytes, bytes, __ATOMIC_RELAXED);
+    }
+
+    debug(user_context) << "Exiting halide_memoization_cache_store\n";
+    return 0;
+}
+
+WEAK void halide_memoization_cache_release(void *user_context, void *host) {
+    // Hits point into the segment, and there is nothing to release.
+    if (!contains(host)) {
+        halide_free(user_context, get_pointer_to_header((uint8_t *)host));
+    }
+}
+
+WEAK int halide_memoization_cache_release_device(void *user_context, halide_buffer_t *buf) {
+    // Only host data is shared, so device allocations are never kept.
+    return halide_device_free(user_context, buf);
+}
+
+WEAK void halide_memoization_cache_cleanup() {
+    debug(NULL) << "halide_memoization_cache_cleanup\n";
+    // Unmap the segment. It stays in the filesystem, with its
+    // contents, for other processes and later runs, until the file is
+    // removed.
+    ScopedMutexLock lock(&segment_lock);
+    if (segment != NULL) {
+        munmap(segment, segment_size);
+    }
+    segment = NULL;
+    segment_size = 0;
+    segment_tried = false;
+    memset(func_key_ids, 0, sizeof(func_key_ids));
+}
+
+WEAK void halide_memoization_cache_set_func_size(const char *func_name, int64_t size) {
+    if (get_segment(NULL) == NULL) {
+        return;
+    }
+    SharedFuncStats *func = find_func_stats(func_name, strlen(func_name), true);
+    if (func) {
+        __atomic_store_n(&func->max_bytes, size, __ATOMIC_RELAXED);
+    }
+}
+
+WEAK int halide_memoization_cache_get_stats(halide_memoization_cache_func_stats_t *stats, int max_funcs) {
+    if (get_segment(NULL) == NULL) {
+        return 0;
+    }
+    int n = 0;
+    for (int i = 0; i < kMaxSharedFuncs; i++) {
+        SharedFuncStats *f = &header()->funcs[i];
+        if (__atomic_load_n(&f->state, __ATOMIC_ACQUIRE) != 2) {
+            continue;
+        }
+        if (n < max_funcs) {
+            stats[n].func_name = f->name;
+            stats[n].hits = __atomic_load_n(&f->hits, __ATOMIC_RELAXED);
+            stats[n].misses = __atomic_load_n(&f->misses, __ATOMIC_RELAXED);
+            stats[n].evictions = 0;
+            stats[n].compute_time_ns = __atomic_load_n(&f->compute_time_ns, __ATOMIC_RELAXED);
+            stats[n].bytes = __atomic_load_n(&f->bytes, __ATOMIC_RELAXED);
+            stats[n].max_bytes = __atomic_load_n(&f->max_bytes, __ATOMIC_RELAXED);
+        }
+        n++;
+    }
+    return n;
+}
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_cache_cleanup() {
+    halide_memoization_cache_cleanup();
+}
+
+}
+
+}
@@ -21,6 +21,61 @@ int gettid() {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// Parallel loops claim chunks of iterations sized so that each chunk
+// takes roughly this long, which amortizes the cost of claiming it.
+#define ADAPTIVE_CHUNK_TARGET_NS 50000
+
+// Picks how many iterations of a parallel loop to claim at a time
+// from a running estimate of the cost of an iteration. The first
+// chunk is a single iteration, to measure it. Chunks are sized by
+// time rather than by count, so faster cores (e.g. the big cores of a
+// big.LITTLE system) claim more iterations per chunk than slower
+// ones. Chunks are also capped so that at least two per thread
+// remain, which keeps the end of the loop balanced.
+struct adaptive_grain {
+    // Estimated nanoseconds per iteration, or zero if not yet measured.
+    int64_t ns_per_iter;
+
+    int next_chunk(int remaining, int threads) const {
+        int chunk = 1;
+        if (ns_per_iter > 0) {
+            int64_t c = ADAPTIVE_CHUNK_TARGET_NS / ns_per_iter;
+            chunk = c > remaining ? remaining : (int)c;
+        }
+        int balanced = remaining / (2 * threads);
+        if (chunk > balanced) {
+            chunk = balanced;
+        }
+        return chunk < 1 ? 1 : chunk;
+    }
+
+    void update(int64_t elapsed_ns, int iters) {
+        int64_t cost = elapsed_ns / iters;
+        if (cost < 1) {
+            cost = 1;
+        }
+        ns_per_iter = ns_per_iter ? (3 * ns_per_iter + cost) / 4 : cost;
+    }
+};
+
+// The priority of an invocation with the given control, which may be
+// NULL.
+__attribute__((always_inline)) int pipeline_priority(halide_pipeline_control_t *control) {
+    int priority = 0;
+    if (control) {
+        Synchronization::atomic_load_relaxed(&control->priority, &priority);
+    }
+    return priority;
+}
+
+__attribute__((always_inline)) bool pipeline_cancelled(halide_pipeline_control_t *control) {
+    int cancelled = 0;
+    if (control) {
+        Synchronization::atomic_load_relaxed(&control->cancelled, &cancelled);
+    }
+    return cancelled != 0;
+}
+
 struct work {
     halide_parallel_task_t task;
 
@@ -40,6 +95,12 @@ struct work {
     int next_semaphore;
     // which condition variable is the owner sleeping on. NULL if it isn't sleeping.
     bool owner_is_sleeping;
+    // How many iterations to claim at a time, for loop tasks that can
+    // run several iterations per call.
+    adaptive_grain grain;
+    // The priority and cancellation state of the invocation this job
+    // belongs to, or NULL.
+    halide_pipeline_control_t *control;
 
     bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
@@ -60,6 +121,14 @@ struct work {
     bool running() {
         return task.extent || active_workers;
     }
+
+    int priority() const {
+        return pipeline_priority(control);
+    }
+
+    bool cancelled() const {
+        return pipeline_cancelled(control);
+    }
 };
 
 #define MAX_THREADS 256
@@ -88,7 +157,10 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
-// The work queue and thread pool is weak, so one big work queue is shared by all halide functions
+// A work queue and the pool of threads that serve it. The default
+// one is weak, so one big work queue is shared by all halide
+// functions. Isolated pools made by halide_thread_pool_create each
+// have their own.
 struct work_queue_t {
     // all fields are protected by this mutex.
     halide_mutex mutex;
@@ -96,6 +168,23 @@ struct work_queue_t {
     // The desired number threads doing work (HL_NUM_THREADS).
     int desired_threads_working;
 
+    // Whether to pin workers to NUMA nodes and split parallel loops
+    // into per-node chunks (HL_NUMA_AWARE).
+    bool numa_aware;
+
+    // Whether to pin all the workers to one NUMA node, pin_node,
+    // instead.
+    bool pin_to_node;
+    int pin_node;
+
+    // How idle threads wait for work. See halide_spin_policy_t.
+    halide_spin_policy_t spin_policy;
+
+    // The name of an isolated pool, and the next one in the list of
+    // them. Protected by thread_pools_mutex rather than by mutex.
+    char name[64];
+    work_queue_t *next_pool;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -106,6 +195,13 @@ struct work_queue_t {
     // The number threads created
     int threads_created;
 
+    // The number of workers that have pinned themselves to a node.
+    int threads_pinned;
+
+    // The number of NUMA nodes the pool spreads over. One unless
+    // numa_aware is set and the host has several nodes.
+    int numa_nodes;
+
     // Workers sleep on one of two condition variables, to make it
     // easier to wake up the right number if a small number of tasks
     // are enqueued. There are A-team workers and B-team workers. The
@@ -136,6 +232,16 @@ struct work_queue_t {
     // to prevent deadlock due to oversubscription of threads.
     int threads_reserved;
 
+    // Bumped whenever sleeping threads are woken, so that polling
+    // threads can notice new work without taking the lock.
+    int wake_generation;
+
+    // When sleeping threads were last woken, for measuring the
+    // wake-up latency.
+    int64_t last_wake_ns;
+
+    halide_thread_pool_stats_t stats;
+
     bool running() const {
         return !shutdown;
     }
@@ -161,7 +267,19 @@ struct work_queue_t {
     }
 };
 
-WEAK work_queue_t work_queue = {};
+WEAK work_queue_t default_work_queue = {};
+
+// The isolated thread pools, which are work queues too.
+WEAK halide_mutex thread_pools_mutex = {};
+WEAK work_queue_t *thread_pools = NULL;
+
+// The work queue that the jobs of an invocation go on.
+WEAK work_queue_t &work_queue_for(const halide_pipeline_control_t *control) {
+    if (control && control->thread_pool) {
+        return *(work_queue_t *)control->thread_pool;
+    }
+    return default_work_queue;
+}
 
 #if EXTENDED_DEBUG
 WEAK void print_job(work *job, const char *indent, const char *prefix = NULL) {
@@ -176,7 +294,7 @@ WEAK void print_job(work *job, const char *indent, const char *prefix = NULL) {
     }
 }
 
-WEAK void dump_job_state() {
+WEAK void dump_job_state(work_queue_t &work_queue) {
     log_message("Dumping job state, jobs in queue:");
     work *job = work_queue.jobs;
     while (job != NULL) {
@@ -187,17 +305,102 @@ WEAK void dump_job_state() {
 }
 #else
 #define print_job(job, indent, prefix)
-#define dump_job_state()
+#define dump_job_state(work_queue)
 #endif
 
 WEAK void worker_thread(void *);
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+// Workers are passed their work queue.
+WEAK void pinned_worker_thread(void *arg) {
+    work_queue_t &work_queue = *(work_queue_t *)arg;
+    halide_mutex_lock(&work_queue.mutex);
+    // Deal the workers out to the nodes round-robin, unless the pool
+    // belongs to one node.
+    int node = work_queue.pin_to_node ? work_queue.pin_node :
+        work_queue.threads_pinned++ % work_queue.numa_nodes;
+    halide_mutex_unlock(&work_queue.mutex);
+    halide_host_pin_thread_to_numa_node(node);
+    worker_thread(arg);
+}
+
+WEAK void initialize_work_queue_already_locked(work_queue_t &work_queue) {
+    if (!work_queue.initialized) {
+        work_queue.assert_zeroed();
+
+        // Compute the desired number of threads to use. Other code
+        // can also mess with this value, but only when the work queue
+        // is locked.
+        if (!work_queue.desired_threads_working) {
+            work_queue.desired_threads_working = default_desired_num_threads();
+        }
+        work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
+
+        if (!work_queue.numa_aware) {
+            char *numa_str = getenv("HL_NUMA_AWARE");
+            work_queue.numa_aware = numa_str && atoi(numa_str);
+        }
+        work_queue.numa_nodes = (work_queue.numa_aware && !work_queue.pin_to_node) ? halide_host_numa_node_count() : 1;
+        work_queue.initialized = true;
+    }
+}
+
+// Call whenever sleeping threads are woken.
+WEAK void note_wakeup_already_locked(work_queue_t &work_queue) {
+    Synchronization::atomic_fetch_add_acquire_release(&work_queue.wake_generation, 1);
+    if (work_queue.workers_sleeping || work_queue.owners_sleeping) {
+        work_queue.last_wake_ns = halide_current_time_ns(NULL);
+    }
+}
+
+// Call when a thread returns from sleeping.
+WEAK void record_wakeup_already_locked(work_queue_t &work_queue) {
+    halide_thread_pool_stats_t &stats = work_queue.stats;
+    stats.wakeups++;
+    if (work_queue.last_wake_ns) {
+        int64_t latency = halide_current_time_ns(NULL) - work_queue.last_wake_ns;
+        if (latency > 0) {
+            stats.total_wakeup_latency_ns += latency;
+            if ((uint64_t)latency > stats.max_wakeup_latency_ns) {
+                stats.max_wakeup_latency_ns = latency;
+            }
+        }
+    }
+}
+
+// Wait for sleeping threads to be woken, without sleeping ourselves,
+// for as long as the spin policy allows. The lock is released while
+// polling. Returns whether there was a wake-up.
+WEAK bool poll_for_wakeup_already_locked(work_queue_t &work_queue, const halide_spin_policy_t &policy) {
+    int generation = work_queue.wake_generation;
+    halide_mutex_unlock(&work_queue.mutex);
+    bool woken = false;
+    for (int i = 0; i < policy.spin_count + policy.yield_count && !woken; i++) {
+        if (i >= policy.spin_count) {
+            halide_thread_yield();
+        }
+        int g;
+        Synchronization::atomic_load_acquire(&work_queue.wake_generation, &g);
+        woken = (g != generation);
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    return woken;
+}
+
+WEAK void worker_thread_already_locked(work_queue_t &work_queue, work *owned_job) {
+    // The invocation of the last job this thread worked on, whose
+    // spin policy applies when this thread runs out of work, and
+    // whether we've already polled since then.
+    halide_pipeline_control_t *last_control = NULL;
+    bool polled = false;
+
     while (owned_job ? owned_job->running() : !work_queue.shutdown) {
         work *job = work_queue.jobs;
         work **prev_ptr = &work_queue.jobs;
 
         if (owned_job) {
+            if (owned_job->exit_status == 0 && owned_job->cancelled()) {
+                owned_job->exit_status = halide_error_code_cancelled;
+            }
             if (owned_job->exit_status != 0) {
                 if (owned_job->active_workers == 0) {
                     while (job != owned_job) {
@@ -213,16 +416,39 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 // The wakeup can likely be only done under certain conditions, but it is only happening
                 // in when an error has already occured and it seems more important to ensure reliable
                 // termination than to optimize this path.
+                note_wakeup_already_locked(work_queue);
                 halide_cond_broadcast(&work_queue.wake_owners);
                 continue;
             }
         }
 
-        dump_job_state();
-
-        // Find a job to run, prefering things near the top of the stack.
+        dump_job_state(work_queue);
+
+        // Find a job to run, prefering jobs of the highest priority
+        // invocations, and then things near the top of the stack. If
+        // no job of the highest priority is runnable, fall back to
+        // the next highest, and so on.
+        int threshold = 0;
+        for (work *j = job; j; j = j->next_job) {
+            int p = j->priority();
+            if (j == job || p > threshold) {
+                threshold = p;
+            }
+        }
+        bool have_lower = false;
+        int lower = 0;
         while (job) {
             print_job(job, "", "Considering job ");
+            int priority = job->priority();
+            bool right_priority = priority >= threshold;
+            if (!right_priority && (!have_lower || priority > lower)) {
+                lower = priority;
+                have_lower = true;
+            }
+            // Don't start new tasks of cancelled invocations. Their
+            // owners will notice and unwind them.
+            bool cancelled = job->cancelled();
+
             // Only schedule tasks with enough free worker threads
             // around to complete. They may get stolen later, but only
             // by tasks which can themselves use them to complete
@@ -257,7 +483,8 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 log_message("Cannot add worker to job " << job->task.name);
             }              
               
-            if (enough_threads && can_use_this_thread_stack && can_add_worker) {
+            if (right_priority && !cancelled &&
+                enough_threads && can_use_this_thread_stack && can_add_worker) {
                 if (job->make_runnable()) {
                     break;
                 } else {
@@ -266,10 +493,30 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             }
             prev_ptr = &(job->next_job);
             job = job->next_job;
+
+            if (!job && have_lower) {
+                threshold = lower;
+                have_lower = false;
+                job = work_queue.jobs;
+                prev_ptr = &work_queue.jobs;
+            }
         }
 
         if (!job) {
-            // There is no runnable job. Go to sleep.
+            // There is no runnable job. Poll for a while, if the spin
+            // policy says to, then go to sleep.
+            halide_pipeline_control_t *control = owned_job ? owned_job->control : last_control;
+            halide_spin_policy_t policy =
+                (control && control->spin_policy) ? *control->spin_policy : work_queue.spin_policy;
+            if (!polled && policy.spin_count + policy.yield_count > 0) {
+                polled = true;
+                if (poll_for_wakeup_already_locked(work_queue, policy)) {
+                    work_queue.stats.polls_woken++;
+                }
+                continue;
+            }
+            polled = false;
+            work_queue.stats.parks++;
             if (owned_job) {
                 work_queue.owners_sleeping++;
                 owned_job->owner_is_sleeping = true;
@@ -288,10 +535,13 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 }
                 work_queue.workers_sleeping--;
             }
+            record_wakeup_already_locked(work_queue);
             continue;
         }
 
         log_message("Working on job " << job->task.name);
+        polled = false;
+        last_control = job->control;
 
         // Increment the active_worker count so that other threads
         // are aware that this job is still in progress even
@@ -317,6 +567,10 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             int total_iters = 0;
             int iters = 1;
             while (result == 0) {
+                if (job->cancelled()) {
+                    result = halide_error_code_cancelled;
+                    break;
+                }
                 // Claim as many iterations as possible
                 while ((job->task.extent - total_iters) > iters &&
                        job->make_runnable()) {
@@ -325,9 +579,12 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 if (iters == 0) break;
 
                 // Do them
+                uint64_t t_begin = halide_timeline_begin();
                 result = halide_do_loop_task(job->user_context, job->task.fn,
                                              job->task.min + total_iters, iters,
                                              job->task.closure, job);
+                halide_timeline_end(job->task.name ? job->task.name : "par_for", "task",
+                                    t_begin, job->task.min + total_iters, iters);
                 total_iters += iters;
                 iters = 0;
             }
@@ -344,10 +601,17 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 work_queue.jobs = job;
             }
         } else {
-            // Claim a task from it.
+            // Claim some iterations from it. Loop tasks that never
+            // block can run several iterations per call, so claim a
+            // chunk of them. Everything else runs one at a time.
+            int iters = 1;
+            bool chunked = !job->task_fn && job->task.min_threads == 0 && job->task.num_semaphores == 0;
+            if (chunked) {
+                iters = job->grain.next_chunk(job->task.extent, work_queue.desired_threads_working);
+            }
             work myjob = *job;
-            job->task.min++;
-            job->task.extent--;
+            job->task.min += iters;
+            job->task.extent -= iters;
 
             // If there were no more tasks pending for this job, remove it
             // from the stack.
@@ -357,15 +621,27 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
             // Release the lock and do the task.
             halide_mutex_unlock(&work_queue.mutex);
+            uint64_t t_begin = halide_timeline_begin();
+            int64_t t_start = chunked ? halide_current_time_ns(myjob.user_context) : 0;
             if (myjob.task_fn) {
                 result = halide_do_task(myjob.user_context, myjob.task_fn,
                                         myjob.task.min, myjob.task.closure);
             } else {
                 result = halide_do_loop_task(myjob.user_context, myjob.task.fn,
-                                             myjob.task.min, 1,
+                                             myjob.task.min, iters,
                                              myjob.task.closure, job);
             }
+            halide_timeline_end(myjob.task.name ? myjob.task.name : "par_for", "task",
+                                t_begin, myjob.task.min, iters);
+            int64_t elapsed = chunked ? halide_current_time_ns(myjob.user_context) - t_start : 0;
             halide_mutex_lock(&work_queue.mutex);
+            if (chunked) {
+                job->grain.update(elapsed, iters);
+            }
+            if (result == 0 && job->cancelled()) {
+                // Fail the job, which wakes its owner.
+                result = halide_error_code_cancelled;
+            }
         }
 
         if (result != 0) {
@@ -401,33 +677,27 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         log_message("Done working on job " << job->task.name);
 
-        if (wake_owners ||
-            (job->active_workers == 0 && (job->task.extent == 0 || job->exit_status != 0) && job->owner_is_sleeping)) {
+        bool job_done = job->active_workers == 0 && (job->task.extent == 0 || job->exit_status != 0);
+        if (wake_owners || (job_done && job->owner_is_sleeping)) {
             // The job is done or some owned job failed via sibling linkage. Wake up the owner.
+            note_wakeup_already_locked(work_queue);
             halide_cond_broadcast(&work_queue.wake_owners);
+        } else if (job_done) {
+            // The owner may be polling.
+            Synchronization::atomic_fetch_add_acquire_release(&work_queue.wake_generation, 1);
         }
     }
 }
 
 WEAK void worker_thread(void *arg) {
+    work_queue_t &work_queue = *(work_queue_t *)arg;
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked((work *)arg);
+    worker_thread_already_locked(work_queue, NULL);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
-    if (!work_queue.initialized) {
-        work_queue.assert_zeroed();
-
-        // Compute the desired number of threads to use. Other code
-        // can also mess with this value, but only when the work queue
-        // is locked.
-        if (!work_queue.desired_threads_working) {
-            work_queue.desired_threads_working = default_desired_num_threads();
-        }
-        work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
-        work_queue.initialized = true;
-    }
+WEAK void enqueue_work_already_locked(work_queue_t &work_queue, int num_jobs, work *jobs, work *task_parent) {
+    initialize_work_queue_already_locked(work_queue);
 
     // Gather some information about the work.
 
@@ -485,8 +755,13 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
             work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, NULL);
+            if (work_queue.pin_to_node || work_queue.numa_nodes > 1) {
+                work_queue.threads[work_queue.threads_created++] =
+                    halide_spawn_thread(pinned_worker_thread, &work_queue);
+            } else {
+                work_queue.threads[work_queue.threads_created++] =
+                    halide_spawn_thread(worker_thread, &work_queue);
+            }
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -525,6 +800,7 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         work_queue.target_a_team_size = workers_to_wake;
     }
 
+    note_wakeup_already_locked(work_queue);
     halide_cond_broadcast(&work_queue.wake_a_team);
     if (work_queue.target_a_team_size > work_queue.a_team_size) {
         halide_cond_broadcast(&work_queue.wake_b_team);
@@ -543,6 +819,242 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+// State for halide_work_stealing_do_par_for. The iteration space is
+// split into one contiguous range per slot, and the thread pool runs
+// one task per slot. Each range is packed into a single 64-bit word
+// (begin in the low half, end in the high half, both relative to the
+// loop min) so the thread working on a slot can pop iterations off
+// the front, and idle threads can split off the back half, with a
+// single compare-and-swap and without taking the work queue lock.
+struct work_stealing_slot {
+    uint64_t range;
+    // Keep slots on separate cache lines.
+    char padding[64 - sizeof(uint64_t)];
+};
+
+struct work_stealing_state {
+    halide_task_t f;
+    uint8_t *closure;
+    int min;
+    int num_slots;
+    work_stealing_slot *slots;
+    int exit_status;
+    halide_pipeline_control_t *control;
+
+    // In NUMA-aware mode the slots are divided into contiguous
+    // groups, one per node, and each thread takes a slot from its own
+    // node's group when it can. next_slot counts the slots claimed
+    // from each group.
+    int num_nodes;
+    int *next_slot;
+
+    int node_first_slot(int node) const {
+        return (node * num_slots) / num_nodes;
+    }
+
+    int node_of_slot(int slot) const {
+        int node = (slot * num_nodes) / num_slots;
+        while (node_first_slot(node + 1) <= slot) {
+            node++;
+        }
+        while (node_first_slot(node) > slot) {
+            node--;
+        }
+        return node;
+    }
+
+    // Pick a slot to work on, prefering the caller's NUMA node. The
+    // pool makes exactly one call per slot, so this always succeeds.
+    int claim_slot() {
+        int home = halide_host_current_numa_node();
+        for (int i = 0; i < num_nodes; i++) {
+            int node = (home + i) % num_nodes;
+            int first = node_first_slot(node);
+            int count = node_first_slot(node + 1) - first;
+            int idx = Synchronization::atomic_fetch_add_acquire_release(&next_slot[node], 1);
+            if (idx < count) {
+                return first + idx;
+            }
+        }
+        return -1;
+    }
+
+    // The i'th slot to try stealing from when slot s is empty. Slots
+    // on the same node are tried first.
+    int victim(int s, int i) const {
+        if (num_nodes == 1) {
+            return (s + i) % num_slots;
+        }
+        int node = node_of_slot(s);
+        int first = node_first_slot(node);
+        int count = node_first_slot(node + 1) - first;
+        if (i < count) {
+            return first + (s - first + i) % count;
+        } else {
+            return (first + count + (i - count)) % num_slots;
+        }
+    }
+};
+
+__attribute__((always_inline)) uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | (uint64_t)begin;
+}
+
+__attribute__((always_inline)) uint32_t range_begin(uint64_t range) {
+    return (uint32_t)(range & 0xffffffff);
+}
+
+__attribute__((always_inline)) uint32_t range_end(uint64_t range) {
+    return (uint32_t)(range >> 32);
+}
+
+// Take the first iteration from a slot. Only the thread working on
+// the slot does this.
+WEAK bool work_stealing_pop(work_stealing_slot *slot, uint32_t *idx) {
+    uint64_t old_range, new_range;
+    Synchronization::atomic_load_acquire(&slot->range, &old_range);
+    do {
+        uint32_t begin = range_begin(old_range);
+        uint32_t end = range_end(old_range);
+        if (begin >= end) {
+            return false;
+        }
+        *idx = begin;
+        new_range = pack_range(begin + 1, end);
+    } while (!Synchronization::atomic_cas_weak_relacq_relaxed(&slot->range, &old_range, &new_range));
+    return true;
+}
+
+// Take the back half of the iterations remaining in some other
+// slot. An iteration belongs to exactly one slot until it is run, so
+// a stale range can never compare equal to a newer one and there is
+// no ABA problem.
+WEAK bool work_stealing_steal(work_stealing_slot *victim, uint32_t *stolen_begin, uint32_t *stolen_end) {
+    uint64_t old_range, new_range;
+    Synchronization::atomic_load_acquire(&victim->range, &old_range);
+    do {
+        uint32_t begin = range_begin(old_range);
+        uint32_t end = range_end(old_range);
+        if (begin >= end) {
+            return false;
+        }
+        uint32_t mid = begin + (end - begin) / 2;
+        *stolen_begin = mid;
+        *stolen_end = end;
+        new_range = pack_range(begin, mid);
+    } while (!Synchronization::atomic_cas_weak_relacq_relaxed(&victim->range, &old_range, &new_range));
+    return true;
+}
+
+WEAK int work_stealing_loop_task(void *user_context, int min, int extent,
+                                 uint8_t *closure, void *task_parent) {
+    work_stealing_state *state = (work_stealing_state *)closure;
+    for (int t = min; t < min + extent; t++) {
+        int s = state->num_nodes > 1 ? state->claim_slot() : t;
+        if (s < 0) {
+            continue;
+        }
+        work_stealing_slot *slot = state->slots + s;
+        while (true) {
+            uint32_t idx;
+            while (work_stealing_pop(slot, &idx)) {
+                int exit_status;
+                Synchronization::atomic_load_relaxed(&state->exit_status, &exit_status);
+                if (exit_status != 0) {
+                    return exit_status;
+                }
+                if (pipeline_cancelled(state->control)) {
+                    exit_status = halide_error_code_cancelled;
+                    Synchronization::atomic_store_release(&state->exit_status, &exit_status);
+                    return exit_status;
+                }
+                int result = halide_do_task(user_context, state->f, state->min + (int)idx, state->closure);
+                if (result != 0) {
+                    Synchronization::atomic_store_release(&state->exit_status, &result);
+                    return result;
+                }
+            }
+
+            // This slot is empty. Refill it with half of the work
+            // remaining in the next non-empty slot. If every slot is
+            // empty, the remaining iterations are already being run
+            // by other threads and we're done.
+            bool stole = false;
+            for (int i = 1; i < state->num_slots && !stole; i++) {
+                int v = state->victim(s, i);
+                work_stealing_slot *victim = state->slots + v;
+                uint32_t begin, end;
+                if (work_stealing_steal(victim, &begin, &end)) {
+                    log_message("Slot " << s << " stole [" << begin << ", " << end << ") from slot " << v);
+                    uint64_t stolen = pack_range(begin, end);
+                    Synchronization::atomic_store_release(&slot->range, &stolen);
+                    stole = true;
+                }
+            }
+            if (!stole) {
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+// State for halide_adaptive_do_par_for. Iterations are handed out in
+// order from a single counter. Each thread claims a chunk with an
+// atomic fetch-add, sizing it from its own measurements of the cost
+// of an iteration.
+struct adaptive_state {
+    halide_task_t f;
+    uint8_t *closure;
+    int min;
+    int size;
+    int num_threads;
+    int next;
+    int exit_status;
+    halide_pipeline_control_t *control;
+};
+
+WEAK int adaptive_loop_task(void *user_context, int min, int extent,
+                            uint8_t *closure, void *task_parent) {
+    adaptive_state *state = (adaptive_state *)closure;
+    adaptive_grain grain;
+    grain.ns_per_iter = 0;
+    while (true) {
+        int next;
+        Synchronization::atomic_load_relaxed(&state->next, &next);
+        if (next >= state->size) {
+            break;
+        }
+        int chunk = grain.next_chunk(state->size - next, state->num_threads);
+        int begin = Synchronization::atomic_fetch_add_acquire_release(&state->next, chunk);
+        if (begin >= state->size) {
+            break;
+        }
+        int end = begin + chunk < state->size ? begin + chunk : state->size;
+
+        int64_t t_start = halide_current_time_ns(user_context);
+        for (int i = begin; i < end; i++) {
+            int exit_status;
+            Synchronization::atomic_load_relaxed(&state->exit_status, &exit_status);
+            if (exit_status != 0) {
+                return exit_status;
+            }
+            if (pipeline_cancelled(state->control)) {
+                exit_status = halide_error_code_cancelled;
+                Synchronization::atomic_store_release(&state->exit_status, &exit_status);
+                return exit_status;
+            }
+            int result = halide_do_task(user_context, state->f, state->min + i, state->closure);
+            if (result != 0) {
+                Synchronization::atomic_store_release(&state->exit_status, &result);
+                return result;
+            }
+        }
+        grain.update(halide_current_time_ns(user_context) - t_start, end - begin);
+    }
+    return 0;
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -550,6 +1062,46 @@ WEAK halide_do_parallel_tasks_t custom_do_parallel_tasks = halide_default_do_par
 WEAK halide_semaphore_init_t custom_semaphore_init = halide_default_semaphore_init;
 WEAK halide_semaphore_try_acquire_t custom_semaphore_try_acquire = halide_default_semaphore_try_acquire;
 WEAK halide_semaphore_release_t custom_semaphore_release = halide_default_semaphore_release;
+
+WEAK struct halide_pipeline_control_t *default_get_pipeline_control(void *user_context) {
+    return NULL;
+}
+
+WEAK halide_get_pipeline_control_t custom_get_pipeline_control = default_get_pipeline_control;
+
+// Stop the threads of a work queue and return it to its initial state.
+WEAK void shutdown_work_queue(work_queue_t &work_queue) {
+    if (work_queue.initialized) {
+        // Wake everyone up and tell them the party's over and it's time
+        // to go home
+        halide_mutex_lock(&work_queue.mutex);
+
+        work_queue.shutdown = true;
+        note_wakeup_already_locked(work_queue);
+        halide_cond_broadcast(&work_queue.wake_owners);
+        halide_cond_broadcast(&work_queue.wake_a_team);
+        halide_cond_broadcast(&work_queue.wake_b_team);
+        halide_mutex_unlock(&work_queue.mutex);
+
+        // Wait until they leave
+        for (int i = 0; i < work_queue.threads_created; i++) {
+            halide_join_thread(work_queue.threads[i]);
+        }
+
+        // Tidy up
+        work_queue.reset();
+    }
+}
+
+// Wake the threads of a work queue that may be waiting for a
+// semaphore.
+WEAK void wake_for_semaphore(work_queue_t &work_queue) {
+    halide_mutex_lock(&work_queue.mutex);
+    note_wakeup_already_locked(work_queue);
+    halide_cond_broadcast(&work_queue.wake_a_team);
+    halide_cond_broadcast(&work_queue.wake_owners);
+    halide_mutex_unlock(&work_queue.mutex);
+}
  
 }}}  // namespace Halide::Runtime::Internal
 
@@ -561,6 +1113,9 @@ namespace {
 __attribute__((destructor))
 WEAK void halide_thread_pool_cleanup() {
     halide_shutdown_thread_pool();
+    while (thread_pools) {
+        halide_thread_pool_destroy((halide_thread_pool_t *)thread_pools);
+    }
 }
 }
 
@@ -597,12 +1152,21 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.active_workers = 0;
     job.next_semaphore = 0;
     job.owner_is_sleeping = false;
+    job.grain.ns_per_iter = 0;
+    job.control = halide_get_pipeline_control(user_context);
     job.siblings = &job; // guarantees no other job points to the same siblings.
     job.sibling_count = 0;
     job.parent_job = NULL;
+    work_queue_t &work_queue = work_queue_for(job.control);
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(1, &job, NULL);
-    worker_thread_already_locked(&job);
+    initialize_work_queue_already_locked(work_queue);
+    if (work_queue.numa_nodes > 1) {
+        // Split the loop into contiguous per-node chunks.
+        halide_mutex_unlock(&work_queue.mutex);
+        return halide_work_stealing_do_par_for(user_context, f, min, size, closure);
+    }
+    enqueue_work_already_locked(work_queue, 1, &job, NULL);
+    worker_thread_already_locked(work_queue, &job);
     halide_mutex_unlock(&work_queue.mutex);
     return job.exit_status;
 }
@@ -611,6 +1175,7 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
                                           struct halide_parallel_task_t *tasks,
                                           void *task_parent) {
     work *jobs = (work *)__builtin_alloca(sizeof(work) * num_tasks);
+    halide_pipeline_control_t *control = halide_get_pipeline_control(user_context);
 
     for (int i = 0; i < num_tasks; i++) {
         if (tasks->extent <= 0) {
@@ -625,6 +1190,8 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         jobs[i].active_workers = 0;
         jobs[i].next_semaphore = 0;
         jobs[i].owner_is_sleeping = false;
+        jobs[i].grain.ns_per_iter = 0;
+        jobs[i].control = control;
         jobs[i].parent_job = (work *)task_parent;
     }
 
@@ -632,13 +1199,14 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         return 0;
     }
 
+    work_queue_t &work_queue = work_queue_for(control);
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(num_tasks, jobs, (work *)task_parent);
+    enqueue_work_already_locked(work_queue, num_tasks, jobs, (work *)task_parent);
     int exit_status = 0;
     for (int i = 0; i < num_tasks; i++) {
         // It doesn't matter what order we join the tasks in, because
         // we'll happily assist with siblings too.
-        worker_thread_already_locked(jobs + i);
+        worker_thread_already_locked(work_queue, jobs + i);
         if (jobs[i].exit_status != 0) {
             exit_status = jobs[i].exit_status;
         }
@@ -647,6 +1215,134 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return exit_status;
 }
 
+WEAK int halide_work_stealing_do_par_for(void *user_context, halide_task_t f,
+                                         int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    work_queue_t &work_queue = work_queue_for(halide_get_pipeline_control(user_context));
+    halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked(work_queue);
+    int num_slots = work_queue.desired_threads_working;
+    int num_nodes = work_queue.numa_nodes;
+    halide_mutex_unlock(&work_queue.mutex);
+    if (num_slots > size) {
+        num_slots = size;
+    }
+    if (num_nodes > num_slots) {
+        num_nodes = num_slots;
+    }
+
+    if (num_slots == 1) {
+        halide_pipeline_control_t *control = halide_get_pipeline_control(user_context);
+        for (int x = min; x < min + size; x++) {
+            if (pipeline_cancelled(control)) {
+                return halide_error_code_cancelled;
+            }
+            int result = halide_do_task(user_context, f, x, closure);
+            if (result) {
+                return result;
+            }
+        }
+        return 0;
+    }
+
+    work_stealing_slot *slots = (work_stealing_slot *)__builtin_alloca(sizeof(work_stealing_slot) * num_slots);
+    for (int i = 0; i < num_slots; i++) {
+        uint32_t begin = (uint32_t)(((int64_t)size * i) / num_slots);
+        uint32_t end = (uint32_t)(((int64_t)size * (i + 1)) / num_slots);
+        slots[i].range = pack_range(begin, end);
+    }
+
+    work_stealing_state state;
+    state.f = f;
+    state.closure = closure;
+    state.min = min;
+    state.num_slots = num_slots;
+    state.slots = slots;
+    state.exit_status = 0;
+    state.control = halide_get_pipeline_control(user_context);
+    state.num_nodes = num_nodes;
+    state.next_slot = (int *)__builtin_alloca(sizeof(int) * num_nodes);
+    for (int i = 0; i < num_nodes; i++) {
+        state.next_slot[i] = 0;
+    }
+
+    // The thread pool only sees one job with one task per slot, so
+    // the work queue lock is taken O(threads) times rather than once
+    // per iteration.
+    halide_parallel_task_t task;
+    task.fn = work_stealing_loop_task;
+    task.closure = (uint8_t *)&state;
+    task.name = NULL;
+    task.semaphores = NULL;
+    task.num_semaphores = 0;
+    task.min = 0;
+    task.extent = num_slots;
+    task.min_threads = 0;
+    task.serial = false;
+
+    int result = halide_do_parallel_tasks(user_context, 1, &task, NULL);
+    return result ? result : state.exit_status;
+}
+
+WEAK int halide_adaptive_do_par_for(void *user_context, halide_task_t f,
+                                    int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    work_queue_t &work_queue = work_queue_for(halide_get_pipeline_control(user_context));
+    halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked(work_queue);
+    int num_threads = work_queue.desired_threads_working;
+    halide_mutex_unlock(&work_queue.mutex);
+    if (num_threads > size) {
+        num_threads = size;
+    }
+
+    if (num_threads == 1) {
+        halide_pipeline_control_t *control = halide_get_pipeline_control(user_context);
+        for (int x = min; x < min + size; x++) {
+            if (pipeline_cancelled(control)) {
+                return halide_error_code_cancelled;
+            }
+            int result = halide_do_task(user_context, f, x, closure);
+            if (result) {
+                return result;
+            }
+        }
+        return 0;
+    }
+
+    adaptive_state state;
+    state.f = f;
+    state.closure = closure;
+    state.min = min;
+    state.size = size;
+    state.num_threads = num_threads;
+    state.next = 0;
+    state.exit_status = 0;
+    state.control = halide_get_pipeline_control(user_context);
+
+    // One task per thread, each of which claims chunks until the loop
+    // is done.
+    halide_parallel_task_t task;
+    task.fn = adaptive_loop_task;
+    task.closure = (uint8_t *)&state;
+    task.name = NULL;
+    task.semaphores = NULL;
+    task.num_semaphores = 0;
+    task.min = 0;
+    task.extent = num_threads;
+    task.min_threads = 0;
+    task.serial = false;
+
+    int result = halide_do_parallel_tasks(user_context, 1, &task, NULL);
+    return result ? result : state.exit_status;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -654,6 +1350,7 @@ WEAK int halide_set_num_threads(int n) {
     // Don't make this an atomic swap - we don't want to be changing
     // the desired number of threads while another thread is in the
     // middle of a sequence of non-atomic operations.
+    work_queue_t &work_queue = default_work_queue;
     halide_mutex_lock(&work_queue.mutex);
     if (n == 0) {
         n = default_desired_num_threads();
@@ -664,26 +1361,104 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
-WEAK void halide_shutdown_thread_pool() {
+WEAK bool halide_set_numa_aware(bool numa_aware) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    bool old = work_queue.numa_aware;
+    work_queue.numa_aware = numa_aware;
     if (work_queue.initialized) {
-        // Wake everyone up and tell them the party's over and it's time
-        // to go home
-        halide_mutex_lock(&work_queue.mutex);
+        work_queue.numa_nodes = numa_aware ? halide_host_numa_node_count() : 1;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
 
-        work_queue.shutdown = true;
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_b_team);
-        halide_mutex_unlock(&work_queue.mutex);
+WEAK void halide_set_spin_policy(const halide_spin_policy_t *policy) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    work_queue.spin_policy.spin_count = policy->spin_count > 0 ? policy->spin_count : 0;
+    work_queue.spin_policy.yield_count = policy->yield_count > 0 ? policy->yield_count : 0;
+    halide_mutex_unlock(&work_queue.mutex);
+}
 
-        // Wait until they leave
-        for (int i = 0; i < work_queue.threads_created; i++) {
-            halide_join_thread(work_queue.threads[i]);
-        }
+WEAK void halide_get_spin_policy(halide_spin_policy_t *policy) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    *policy = work_queue.spin_policy;
+    halide_mutex_unlock(&work_queue.mutex);
+}
 
-        // Tidy up
-        work_queue.reset();
+WEAK void halide_get_thread_pool_stats(halide_thread_pool_stats_t *stats) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    *stats = work_queue.stats;
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
+WEAK void halide_reset_thread_pool_stats() {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    memset(&work_queue.stats, 0, sizeof(work_queue.stats));
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
+WEAK void halide_shutdown_thread_pool() {
+    shutdown_work_queue(default_work_queue);
+}
+
+WEAK halide_thread_pool_t *halide_thread_pool_create(const char *name, int num_threads, int numa_node) {
+    if (num_threads < 0) {
+        halide_error(NULL, "halide_thread_pool_create: num_threads must be >= 0.");
+        return NULL;
+    }
+    work_queue_t *pool = (work_queue_t *)malloc(sizeof(work_queue_t));
+    if (!pool) {
+        return NULL;
     }
+    memset(pool, 0, sizeof(work_queue_t));
+    pool->desired_threads_working = num_threads;
+    if (numa_node >= 0) {
+        pool->pin_to_node = true;
+        pool->pin_node = numa_node;
+    }
+    if (name) {
+        strncpy(pool->name, name, sizeof(pool->name) - 1);
+    }
+
+    halide_mutex_lock(&thread_pools_mutex);
+    pool->next_pool = thread_pools;
+    thread_pools = pool;
+    halide_mutex_unlock(&thread_pools_mutex);
+    return (halide_thread_pool_t *)pool;
+}
+
+WEAK halide_thread_pool_t *halide_thread_pool_find(const char *name) {
+    halide_mutex_lock(&thread_pools_mutex);
+    work_queue_t *pool = thread_pools;
+    while (pool && strcmp(pool->name, name) != 0) {
+        pool = pool->next_pool;
+    }
+    halide_mutex_unlock(&thread_pools_mutex);
+    return (halide_thread_pool_t *)pool;
+}
+
+WEAK void halide_thread_pool_destroy(halide_thread_pool_t *p) {
+    if (!p) {
+        return;
+    }
+    work_queue_t *pool = (work_queue_t *)p;
+    halide_mutex_lock(&thread_pools_mutex);
+    work_queue_t **prev = &thread_pools;
+    while (*prev && *prev != pool) {
+        prev = &(*prev)->next_pool;
+    }
+    if (*prev) {
+        *prev = pool->next_pool;
+    }
+    halide_mutex_unlock(&thread_pools_mutex);
+
+    shutdown_work_queue(*pool);
+    free(pool);
 }
 
 struct halide_semaphore_impl_t {
@@ -701,11 +1476,14 @@ WEAK int halide_default_semaphore_release(halide_semaphore_t *s, int n) {
     int old_val = Halide::Runtime::Internal::Synchronization::atomic_fetch_add_acquire_release(&sem->value, n);
     // TODO(abadams|zvookin): Is this correct if an acquire can be for say count of 2 and the releases are 1 each?
     if (old_val == 0 && n != 0) { // Don't wake if nothing released.
-        // We may have just made a job runnable
-        halide_mutex_lock(&work_queue.mutex);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_mutex_unlock(&work_queue.mutex);
+        // We may have just made a job runnable, on any of the
+        // thread pools.
+        wake_for_semaphore(default_work_queue);
+        halide_mutex_lock(&thread_pools_mutex);
+        for (work_queue_t *pool = thread_pools; pool; pool = pool->next_pool) {
+            wake_for_semaphore(*pool);
+        }
+        halide_mutex_unlock(&thread_pools_mutex);
     }
     return old_val + n;
 }
@@ -762,6 +1540,45 @@ WEAK void halide_set_custom_parallel_runtime(
     custom_semaphore_release = semaphore_release;
 }
 
+WEAK halide_get_pipeline_control_t halide_set_custom_get_pipeline_control(halide_get_pipeline_control_t handler) {
+    halide_get_pipeline_control_t result = custom_get_pipeline_control;
+    custom_get_pipeline_control = handler;
+    return result;
+}
+
+WEAK struct halide_pipeline_control_t *halide_get_pipeline_control(void *user_context) {
+    return custom_get_pipeline_control(user_context);
+}
+
+WEAK void halide_pipeline_control_init(struct halide_pipeline_control_t *control, int priority) {
+    int cancelled = 0;
+    control->spin_policy = NULL;
+    control->thread_pool = NULL;
+    Synchronization::atomic_store_release(&control->priority, &priority);
+    Synchronization::atomic_store_release(&control->cancelled, &cancelled);
+}
+
+WEAK void halide_set_pipeline_priority(struct halide_pipeline_control_t *control, int priority) {
+    Synchronization::atomic_store_release(&control->priority, &priority);
+}
+
+WEAK void halide_set_pipeline_thread_pool(struct halide_pipeline_control_t *control,
+                                          struct halide_thread_pool_t *pool) {
+    control->thread_pool = pool;
+}
+
+WEAK void halide_cancel_pipeline(struct halide_pipeline_control_t *control) {
+    int cancelled = 1;
+    Synchronization::atomic_store_release(&control->cancelled, &cancelled);
+    // Wake up any owners sleeping on the jobs of the invocation, so
+    // that they can unwind them.
+    work_queue_t &work_queue = work_queue_for(control);
+    halide_mutex_lock(&work_queue.mutex);
+    note_wakeup_already_locked(work_queue);
+    halide_cond_broadcast(&work_queue.wake_owners);
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
 WEAK int halide_do_task(void *user_context, halide_task_t f, int idx,
                         uint8_t *closure) {
     return (*custom_do_task)(user_context, f, idx, closure);
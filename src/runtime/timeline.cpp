@@ -0,0 +1,178 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// A fixed-size log of complete (begin + end) events. Slots are
+// claimed with an atomic increment, so recording never takes a
+// lock. Events past the end of the log are counted and dropped.
+struct timeline_event {
+    char name[32];
+    const char *category;
+    uint64_t begin_ns, end_ns, thread;
+    int64_t arg0, arg1;
+};
+
+#define TIMELINE_MAX_EVENTS (1 << 18)
+
+enum {
+    timeline_uninitialized = 0,
+    timeline_disabled,
+    timeline_enabled
+};
+
+WEAK halide_mutex timeline_lock = {{0}};
+WEAK volatile int timeline_status = timeline_uninitialized;
+WEAK char timeline_filename[1024];
+WEAK timeline_event *timeline_events = NULL;
+WEAK uint32_t timeline_cursor = 0;
+WEAK uint32_t timeline_dropped = 0;
+
+WEAK void timeline_enable_already_locked(const char *filename) {
+    if (filename == NULL || filename[0] == 0) {
+        timeline_status = timeline_disabled;
+        return;
+    }
+    strncpy(timeline_filename, filename, sizeof(timeline_filename) - 1);
+    timeline_filename[sizeof(timeline_filename) - 1] = 0;
+    if (timeline_events == NULL) {
+        timeline_events = (timeline_event *)malloc(TIMELINE_MAX_EVENTS * sizeof(timeline_event));
+        if (timeline_events == NULL) {
+            timeline_status = timeline_disabled;
+            return;
+        }
+        halide_start_clock(NULL);
+    }
+    timeline_status = timeline_enabled;
+}
+
+// Write a timestamp or duration in nanoseconds as microseconds, which
+// is what the trace event format uses.
+WEAK void timeline_print_us(Printer<StringStreamPrinter, 256> &p, uint64_t ns) {
+    uint64_t frac = ns % 1000;
+    p << ns / 1000 << ".";
+    if (frac < 100) p << "0";
+    if (frac < 10) p << "0";
+    p << frac;
+}
+
+WEAK int timeline_write_already_locked() {
+    if (timeline_events == NULL) {
+        return 0;
+    }
+    void *f = fopen(timeline_filename, "w");
+    if (!f) {
+        halide_error(NULL, "Could not open timeline file for writing\n");
+        return -1;
+    }
+
+    const char *header = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    fwrite(header, 1, strlen(header), f);
+    char mem[256];
+    uint32_t count = timeline_cursor < TIMELINE_MAX_EVENTS ? timeline_cursor : TIMELINE_MAX_EVENTS;
+    for (uint32_t i = 0; i < count; i++) {
+        const timeline_event &e = timeline_events[i];
+        Printer<StringStreamPrinter, 256> p(NULL, mem);
+        p << (i ? ",\n" : "")
+          << "{\"name\": \"" << e.name
+          << "\", \"cat\": \"" << e.category
+          << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << e.thread
+          << ", \"ts\": ";
+        timeline_print_us(p, e.begin_ns);
+        p << ", \"dur\": ";
+        timeline_print_us(p, e.end_ns - e.begin_ns);
+        // The meaning of the two arguments depends on the category.
+        if (strcmp(e.category, "gpu") == 0) {
+            p << ", \"args\": {\"blocks\": " << e.arg0
+              << ", \"threads\": " << e.arg1 << "}}";
+        } else if (strcmp(e.category, "copy") == 0) {
+            p << ", \"args\": {\"bytes\": " << e.arg0 << "}}";
+        } else {
+            p << ", \"args\": {\"min\": " << e.arg0
+              << ", \"extent\": " << e.arg1 << "}}";
+        }
+        fwrite(p.str(), 1, p.size(), f);
+    }
+    Printer<StringStreamPrinter, 256> p(NULL, mem);
+    p << "\n], \"otherData\": {\"dropped_events\": " << timeline_dropped << "}}\n";
+    fwrite(p.str(), 1, p.size(), f);
+    return fclose(f);
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK uint64_t halide_timeline_begin() {
+    if (timeline_status != timeline_enabled) {
+        if (timeline_status == timeline_disabled) {
+            return 0;
+        }
+        ScopedMutexLock lock(&timeline_lock);
+        if (timeline_status == timeline_uninitialized) {
+            timeline_enable_already_locked(getenv("HL_TIMELINE_FILE"));
+        }
+        if (timeline_status != timeline_enabled) {
+            return 0;
+        }
+    }
+    // Zero means "not recording", so never return it as a time.
+    int64_t t = halide_current_time_ns(NULL);
+    return t > 0 ? (uint64_t)t : 1;
+}
+
+WEAK void halide_timeline_end(const char *name, const char *category,
+                              uint64_t begin_ns, int64_t arg0, int64_t arg1) {
+    if (begin_ns == 0) {
+        return;
+    }
+    uint64_t end_ns = (uint64_t)halide_current_time_ns(NULL);
+    uint32_t idx = __sync_fetch_and_add(&timeline_cursor, 1);
+    if (idx >= TIMELINE_MAX_EVENTS) {
+        __sync_fetch_and_add(&timeline_dropped, 1);
+        return;
+    }
+    timeline_event &e = timeline_events[idx];
+    int i = 0;
+    if (name) {
+        for (; i < (int)sizeof(e.name) - 1 && name[i]; i++) {
+            // Keep the output valid JSON.
+            e.name[i] = (name[i] == '"' || name[i] == '\\') ? '_' : name[i];
+        }
+    }
+    e.name[i] = 0;
+    e.category = category;
+    e.begin_ns = begin_ns;
+    e.end_ns = end_ns > begin_ns ? end_ns : begin_ns;
+    e.thread = halide_host_current_thread_id();
+    e.arg0 = arg0;
+    e.arg1 = arg1;
+}
+
+WEAK void halide_set_timeline_file(const char *filename) {
+    ScopedMutexLock lock(&timeline_lock);
+    timeline_enable_already_locked(filename);
+}
+
+WEAK int halide_timeline_flush() {
+    ScopedMutexLock lock(&timeline_lock);
+    if (timeline_status != timeline_enabled) {
+        return 0;
+    }
+    return timeline_write_already_locked();
+}
+
+namespace {
+#ifndef WINDOWS
+__attribute__((destructor))
+#endif
+WEAK void halide_timeline_cleanup() {
+    halide_timeline_flush();
+}
+}
+
+}
@@ -141,6 +141,113 @@ WEAK int halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = NULL;
 
+// Loads and stores are by far the most common events, so each thread
+// buffers its own rather than contending for the shared buffer
+// above. A thread's buffer is only locked by another thread when
+// flushing it, so the lock is almost never contended. Keep only one
+// in every halide_trace_sample_rate load and store events (set with
+// HL_TRACE_SAMPLE).
+const static int thread_buffer_size = 64 * 1024;
+const static int max_thread_buffers = 256;
+
+struct ThreadTraceBuffer {
+    uint64_t thread;
+    volatile int lock;
+    uint32_t cursor;
+    uint32_t sample_count;
+    uint8_t buf[thread_buffer_size];
+};
+
+WEAK ThreadTraceBuffer *halide_trace_thread_buffers[max_thread_buffers];
+WEAK uint32_t halide_trace_sample_rate = 1;
+WEAK uint32_t halide_trace_shared_sample_count = 0;
+
+// Find the calling thread's buffer, creating it if need be. Returns
+// NULL if there are too many threads, in which case the shared buffer
+// is used instead.
+WEAK ThreadTraceBuffer *get_thread_trace_buffer(void *user_context) {
+    uint64_t id = halide_host_current_thread_id();
+    uint32_t h = (uint32_t)((id ^ (id >> 12) ^ (id >> 32)) * 2654435761u);
+    ThreadTraceBuffer *fresh = NULL;
+    for (int i = 0; i < max_thread_buffers; i++) {
+        ThreadTraceBuffer **slot = &halide_trace_thread_buffers[(h + i) % max_thread_buffers];
+        ThreadTraceBuffer *b = *slot;
+        if (b == NULL) {
+            if (fresh == NULL) {
+                fresh = (ThreadTraceBuffer *)malloc(sizeof(ThreadTraceBuffer));
+                if (fresh == NULL) {
+                    return NULL;
+                }
+                fresh->thread = id;
+                fresh->lock = 0;
+                fresh->cursor = 0;
+                fresh->sample_count = 0;
+            }
+            if (__sync_bool_compare_and_swap(slot, NULL, fresh)) {
+                return fresh;
+            }
+            b = *slot;
+        }
+        if (b->thread == id) {
+            if (fresh) {
+                free(fresh);
+            }
+            return b;
+        }
+    }
+    if (fresh) {
+        free(fresh);
+    }
+    return NULL;
+}
+
+// Write out a thread's buffer. The caller must hold its lock. The
+// shared buffer goes first, as it holds any begin realization events
+// that the loads and stores in this one follow.
+WEAK void flush_thread_trace_buffer_already_locked(void *user_context, int fd, ThreadTraceBuffer *b) {
+    if (b->cursor) {
+        halide_trace_buffer->flush(user_context, fd);
+        bool success = (b->cursor == (uint32_t)write(fd, b->buf, b->cursor));
+        b->cursor = 0;
+        halide_assert(user_context, success && "Could not write to trace file");
+    }
+}
+
+WEAK void flush_all_thread_trace_buffers(void *user_context, int fd) {
+    for (int i = 0; i < max_thread_buffers; i++) {
+        ThreadTraceBuffer *b = halide_trace_thread_buffers[i];
+        if (b) {
+            ScopedSpinLock lock(&b->lock);
+            flush_thread_trace_buffer_already_locked(user_context, fd, b);
+        }
+    }
+}
+
+WEAK void fill_trace_packet(halide_trace_packet_t *packet, const halide_trace_event_t *e,
+                            int32_t id, uint32_t total_size) {
+    uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
+    uint32_t coords_bytes = e->dimensions * (uint32_t)sizeof(int32_t);
+    packet->size = total_size;
+    packet->id = id;
+    packet->type = e->type;
+    packet->event = e->event;
+    packet->parent_id = e->parent_id;
+    packet->value_index = e->value_index;
+    packet->dimensions = e->dimensions;
+    if (e->coordinates) {
+        memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
+    }
+    if (e->value) {
+        memcpy((void *)packet->value(), e->value, value_bytes);
+    }
+    memcpy((void *)packet->func(), e->func, strlen(e->func) + 1);
+    if (e->trace_tag) {
+        memcpy((void *)packet->trace_tag(), e->trace_tag, strlen(e->trace_tag) + 1);
+    } else {
+        *(char *)packet->trace_tag() = 0;
+    }
+}
+
 }}}
 
 extern "C" {
@@ -162,29 +269,43 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         uint32_t total_size_without_padding = header_bytes + value_bytes + coords_bytes + name_bytes + trace_tag_bytes;
         uint32_t total_size = (total_size_without_padding + 3) & ~3;
 
-        // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
-
         if (total_size > 4096) {
             print(NULL) << total_size << "\n";
         }
 
-        // Write a packet into it
-        packet->size = total_size;
-        packet->id = my_id;
-        packet->type = e->type;
-        packet->event = e->event;
-        packet->parent_id = e->parent_id;
-        packet->value_index = e->value_index;
-        packet->dimensions = e->dimensions;
-        if (e->coordinates) {
-            memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
-        }
-        if (e->value) {
-            memcpy((void *)packet->value(), e->value, value_bytes);
+        bool is_load_or_store = (e->event == halide_trace_load || e->event == halide_trace_store);
+        if (is_load_or_store) {
+            ThreadTraceBuffer *b = get_thread_trace_buffer(user_context);
+            if (b) {
+                ScopedSpinLock lock(&b->lock);
+                if (halide_trace_sample_rate > 1 &&
+                    (b->sample_count++ % halide_trace_sample_rate) != 0) {
+                    return my_id;
+                }
+                if (b->cursor + total_size > (uint32_t)thread_buffer_size) {
+                    flush_thread_trace_buffer_already_locked(user_context, fd, b);
+                }
+                fill_trace_packet((halide_trace_packet_t *)(b->buf + b->cursor), e, my_id, total_size);
+                b->cursor += total_size;
+                return my_id;
+            }
+            if (halide_trace_sample_rate > 1 &&
+                (__sync_fetch_and_add(&halide_trace_shared_sample_count, 1) % halide_trace_sample_rate) != 0) {
+                return my_id;
+            }
+        } else if (e->event == halide_trace_end_realization ||
+                   e->event == halide_trace_end_pipeline) {
+            // Everything that was computed in the realization has
+            // been buffered by now, so write it out ahead of the end
+            // event.
+            flush_all_thread_trace_buffers(user_context, fd);
         }
-        memcpy((void *)packet->func(), e->func, name_bytes);
-        memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
+
+        // Claim some space to write to in the trace buffer
+        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
+
+        // Write a packet into it
+        fill_trace_packet(packet, e, my_id, total_size);
 
         // Release it
         halide_trace_buffer->release_packet(packet);
@@ -327,17 +448,27 @@ WEAK void halide_set_trace_file(int fd) {
 extern int errno;
 
 WEAK int halide_get_trace_file(void *user_context) {
+    // This is called for every event, so avoid the lock once the file
+    // is known.
+    if (halide_trace_file >= 0) {
+        return halide_trace_file;
+    }
     ScopedSpinLock lock(&halide_trace_file_lock);
     if (halide_trace_file < 0) {
+        const char *sample_rate = getenv("HL_TRACE_SAMPLE");
+        if (sample_rate && atoi(sample_rate) > 1) {
+            halide_trace_sample_rate = (uint32_t)atoi(sample_rate);
+        }
         const char *trace_file_name = getenv("HL_TRACE_FILE");
         if (trace_file_name) {
             void *file = fopen(trace_file_name, "ab");
             halide_assert(user_context, file && "Failed to open trace file\n");
-            halide_set_trace_file(fileno(file));
-            halide_trace_file_internally_opened = file;
             if (!halide_trace_buffer) {
                 halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
             }
+            halide_trace_file_internally_opened = file;
+            __sync_synchronize();
+            halide_set_trace_file(fileno(file));
         } else {
             halide_set_trace_file(0);
         }
@@ -351,6 +482,14 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 
 WEAK int halide_shutdown_trace() {
     if (halide_trace_file_internally_opened) {
+        flush_all_thread_trace_buffers(NULL, halide_trace_file);
+        halide_trace_buffer->flush(NULL, halide_trace_file);
+        for (int i = 0; i < max_thread_buffers; i++) {
+            if (halide_trace_thread_buffers[i]) {
+                free(halide_trace_thread_buffers[i]);
+                halide_trace_thread_buffers[i] = NULL;
+            }
+        }
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
@@ -0,0 +1,1850 @@
+#include "HalideRuntimeVulkan.h"
+#include "scoped_spin_lock.h"
+#include "device_allocation_cache.h"
+#include "device_buffer_utils.h"
+#include "device_interface.h"
+#include "printer.h"
+
+#include "mini_vulkan.h"
+
+#define INLINE inline __attribute__((always_inline))
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+#define VK_FN(ret, fn, args) WEAK ret (VKAPI_CALL *fn) args;
+#include "vulkan_functions.h"
+
+// The default implementation of halide_vulkan_get_symbol attempts to load
+// the Vulkan loader shared library/DLL, and then get the symbol from it.
+WEAK void *lib_vulkan = NULL;
+
+extern "C" WEAK void *halide_vulkan_get_symbol(void *user_context, const char *name) {
+    // Only try to load the library if the library isn't already
+    // loaded, or we can't load the symbol from the process already.
+    void *symbol = halide_get_library_symbol(lib_vulkan, name);
+    if (symbol) {
+        return symbol;
+    }
+
+    const char *lib_names[] = {
+#ifdef WINDOWS
+        "vulkan-1.dll",
+#else
+        "libvulkan.so.1",
+        "libvulkan.so",
+        "libvulkan.1.dylib",
+        "libMoltenVK.dylib",
+#endif
+    };
+    for (size_t i = 0; i < sizeof(lib_names)/sizeof(lib_names[0]); i++) {
+        lib_vulkan = halide_load_library(lib_names[i]);
+        if (lib_vulkan) {
+            debug(user_context) << "    Loaded Vulkan loader library: " << lib_names[i] << "\n";
+            break;
+        }
+    }
+
+    return halide_get_library_symbol(lib_vulkan, name);
+}
+
+template <typename T>
+INLINE T get_vk_symbol(void *user_context, const char *name) {
+    T s = (T)halide_vulkan_get_symbol(user_context, name);
+    if (!s) {
+        error(user_context) << "Vulkan API not found: " << name << "\n";
+    }
+    return s;
+}
+
+// Load the Vulkan loader, and get the function pointers for the Vulkan API from it.
+WEAK void load_libvulkan(void *user_context) {
+    debug(user_context) << "    load_libvulkan (user_context: " << user_context << ")\n";
+    halide_assert(user_context, vkCreateInstance == NULL);
+
+    #define VK_FN(ret, fn, args) fn = get_vk_symbol<ret (VKAPI_CALL *)args>(user_context, #fn);
+    #include "vulkan_functions.h"
+}
+
+WEAK const char *get_vulkan_error_name(VkResult err) {
+    switch (err) {
+    case VK_SUCCESS: return "VK_SUCCESS";
+    case VK_NOT_READY: return "VK_NOT_READY";
+    case VK_TIMEOUT: return "VK_TIMEOUT";
+    case VK_INCOMPLETE: return "VK_INCOMPLETE";
+    case VK_ERROR_OUT_OF_HOST_MEMORY: return "VK_ERROR_OUT_OF_HOST_MEMORY";
+    case VK_ERROR_OUT_OF_DEVICE_MEMORY: return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+    case VK_ERROR_INITIALIZATION_FAILED: return "VK_ERROR_INITIALIZATION_FAILED";
+    case VK_ERROR_DEVICE_LOST: return "VK_ERROR_DEVICE_LOST";
+    case VK_ERROR_MEMORY_MAP_FAILED: return "VK_ERROR_MEMORY_MAP_FAILED";
+    case VK_ERROR_LAYER_NOT_PRESENT: return "VK_ERROR_LAYER_NOT_PRESENT";
+    case VK_ERROR_EXTENSION_NOT_PRESENT: return "VK_ERROR_EXTENSION_NOT_PRESENT";
+    case VK_ERROR_FEATURE_NOT_PRESENT: return "VK_ERROR_FEATURE_NOT_PRESENT";
+    case VK_ERROR_INCOMPATIBLE_DRIVER: return "VK_ERROR_INCOMPATIBLE_DRIVER";
+    case VK_ERROR_TOO_MANY_OBJECTS: return "VK_ERROR_TOO_MANY_OBJECTS";
+    case VK_ERROR_FORMAT_NOT_SUPPORTED: return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+    case VK_ERROR_FRAGMENTED_POOL: return "VK_ERROR_FRAGMENTED_POOL";
+    case VK_ERROR_OUT_OF_POOL_MEMORY: return "VK_ERROR_OUT_OF_POOL_MEMORY";
+    default: return "<Unknown error>";
+    }
+}
+
+extern WEAK halide_device_interface_t vulkan_device_interface;
+
+WEAK int create_vulkan_context(void *user_context);
+
+// The instance, device and queue created by the default
+// halide_vulkan_acquire_context, and the lock it serializes access
+// with.
+WEAK VkInstance instance = NULL;
+WEAK VkPhysicalDevice physical_device = NULL;
+WEAK VkDevice device = NULL;
+WEAK VkQueue queue = NULL;
+WEAK uint32_t queue_family_index = 0;
+volatile int WEAK thread_lock = 0;
+
+// A buffer and the memory bound to it. The memory of the buffers we
+// allocate is host visible, and mapped for as long as it exists.
+// Buffers wrapped around an application's VkBuffer are not mapped, and
+// are copied to and from the host through a staging buffer.
+struct vk_allocation {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint64_t size;
+    uint8_t *mapped;
+    bool owned;
+    // Links allocations whose destruction waits for a command batch.
+    vk_allocation *next;
+};
+
+struct device_handle {
+    vk_allocation *allocation;
+    uint64_t offset;
+};
+
+// The compute pipelines of a kernel are specialized on the workgroup
+// size, which the kernels declare as specialization constants.
+struct pipeline_entry {
+    int32_t threads[3];
+    VkPipeline pipeline;
+    pipeline_entry *next;
+};
+
+struct kernel_state {
+    char *name;
+    VkShaderModule shader;
+    // Made at the first run of the kernel, which is when we learn its
+    // arguments.
+    bool layout_created;
+    uint32_t num_buffers;
+    uint32_t push_constant_bytes;
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout layout;
+    pipeline_entry *pipelines;
+    kernel_state *next;
+};
+
+// Structure to hold the state of a module attached to the context.
+// Also used as a linked-list to keep track of all the different
+// modules that are attached to a context in order to release them all
+// when then context is released.
+struct module_state {
+    VkDevice device;
+    kernel_state *kernels;
+    module_state *next;
+};
+WEAK module_state *state_list = NULL;
+
+// Descriptor sets are allocated from pools owned by the command batch
+// that uses them, and all reset together when the batch is recycled.
+const uint32_t descriptor_pool_sets = 256;
+const uint32_t descriptor_pool_descriptors = 1024;
+const uint32_t max_kernel_buffers = 64;
+const uint32_t max_push_constant_bytes = 128;
+
+struct descriptor_pool {
+    VkDescriptorPool pool;
+    uint32_t sets_left;
+    uint32_t descriptors_left;
+    descriptor_pool *next;
+};
+
+// Kernel dispatches and device to device copies are recorded into a
+// command batch, which is only submitted when its results are needed:
+// by a device sync, by host access to a buffer, or at the end of the
+// pipeline. A global memory barrier separates each command from the
+// previous ones. Submitted batches are recycled once their fence has
+// signaled.
+struct command_batch {
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    descriptor_pool *pools;
+    uint32_t num_commands;
+    bool submitted;
+    // Allocations freed while commands of this batch might use them.
+    vk_allocation *garbage;
+    command_batch *next;
+};
+
+// The objects Halide makes on the acquired device. Only touched with
+// the context acquired.
+struct device_state {
+    VkDevice device;
+    VkPhysicalDevice physical_device;
+    VkQueue queue;
+    VkCommandPool command_pool;
+    VkPipelineCache pipeline_cache;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDeviceSize min_storage_buffer_offset_alignment;
+    command_batch *batches;
+    command_batch *pending;
+    command_batch *last_submitted;
+};
+WEAK device_state dev_state;
+
+// Device allocations freed while halide_can_reuse_device_allocations is
+// true, keyed by the VkDevice they were made on.
+WEAK device_allocation_cache allocation_cache;
+
+WEAK void free_allocation(VkDevice dev, vk_allocation *alloc) {
+    if (alloc->owned) {
+        if (alloc->mapped) {
+            vkUnmapMemory(dev, alloc->memory);
+        }
+        vkDestroyBuffer(dev, alloc->buffer, NULL);
+        vkFreeMemory(dev, alloc->memory, NULL);
+    }
+    free(alloc);
+}
+
+WEAK void free_cached_allocation(void *user_context, void *context, uint64_t handle) {
+    debug(user_context) << "Vulkan - Releasing: cached buffer " << (void *)handle << "\n";
+    free_allocation((VkDevice)context, (vk_allocation *)handle);
+}
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::Vulkan;
+
+extern "C" {
+
+WEAK int halide_vulkan_release_unused_device_allocations(void *user_context);
+
+// The default implementation of halide_vulkan_acquire_context uses the global
+// pointers above, and serializes access with a spin lock.
+// Overriding implementations of acquire/release must implement the following
+// behavior:
+// - halide_vulkan_acquire_context should always store a valid instance,
+//   physical device, device and queue in the out arguments, or return an
+//   error code.
+// - A call to halide_vulkan_acquire_context is followed by a matching call to
+//   halide_vulkan_release_context. halide_vulkan_acquire_context should block
+//   while a previous call (if any) has not yet been released via
+//   halide_vulkan_release_context.
+WEAK int halide_vulkan_acquire_context(void *user_context,
+                                       halide_vulkan_instance **instance_ret,
+                                       halide_vulkan_physical_device **physical_device_ret,
+                                       halide_vulkan_device **device_ret,
+                                       halide_vulkan_queue **queue_ret,
+                                       uint32_t *queue_family_index_ret,
+                                       bool create) {
+    halide_assert(user_context, &thread_lock != NULL);
+    while (__sync_lock_test_and_set(&thread_lock, 1)) { }
+
+    if (device == NULL && create) {
+        int err = create_vulkan_context(user_context);
+        if (err != 0) {
+            __sync_lock_release(&thread_lock);
+            return err;
+        }
+    }
+
+    *instance_ret = instance;
+    *physical_device_ret = physical_device;
+    *device_ret = device;
+    *queue_ret = queue;
+    *queue_family_index_ret = queue_family_index;
+    return 0;
+}
+
+WEAK int halide_vulkan_release_context(void *user_context) {
+    __sync_lock_release(&thread_lock);
+    return 0;
+}
+
+} // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+WEAK bool has_device_extension(VkExtensionProperties *extensions, uint32_t count, const char *name) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(extensions[i].extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pick the device requested by halide_get_gpu_device, or else the first
+// discrete GPU, or else the first integrated GPU, or else the first
+// device.
+WEAK VkPhysicalDevice select_physical_device(void *user_context, VkPhysicalDevice *devices, uint32_t count) {
+    int requested = halide_get_gpu_device(user_context);
+    if (requested >= 0) {
+        if ((uint32_t)requested >= count) {
+            error(user_context) << "Vulkan: device " << requested << " requested, but only "
+                                << count << " devices are available.\n";
+            return NULL;
+        }
+        return devices[requested];
+    }
+    VkPhysicalDeviceType preferred[] = {VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU};
+    for (int p = 0; p < 2; p++) {
+        for (uint32_t i = 0; i < count; i++) {
+            VkPhysicalDeviceProperties props;
+            vkGetPhysicalDeviceProperties(devices[i], &props);
+            if (props.deviceType == preferred[p]) {
+                return devices[i];
+            }
+        }
+    }
+    return devices[0];
+}
+
+// Create the instance, device and queue used by the default
+// halide_vulkan_acquire_context.
+WEAK int create_vulkan_context(void *user_context) {
+    debug(user_context) << "    create_vulkan_context (user_context: " << user_context << ")\n";
+
+    if (vkCreateInstance == NULL) {
+        load_libvulkan(user_context);
+        if (vkCreateInstance == NULL) {
+            error(user_context) << "Could not find Vulkan loader library\n";
+            return -1;
+        }
+    }
+
+    VkApplicationInfo app_info = {
+        VK_STRUCTURE_TYPE_APPLICATION_INFO, NULL,
+        "Halide", 0, "Halide", 0, VK_API_VERSION_1_1};
+    VkInstanceCreateInfo instance_info = {
+        VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO, NULL, 0,
+        &app_info, 0, NULL, 0, NULL};
+    debug(user_context) << "    vkCreateInstance -> ";
+    VkResult result = vkCreateInstance(&instance_info, NULL, &instance);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << get_vulkan_error_name(result) << "\n";
+        error(user_context) << "Vulkan: vkCreateInstance failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+    debug(user_context) << instance << "\n";
+
+    const uint32_t max_devices = 16;
+    VkPhysicalDevice devices[max_devices];
+    uint32_t device_count = max_devices;
+    result = vkEnumeratePhysicalDevices(instance, &device_count, devices);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || device_count == 0) {
+        error(user_context) << "Vulkan: no devices found.\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        return -1;
+    }
+    physical_device = select_physical_device(user_context, devices, device_count);
+    if (physical_device == NULL) {
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        return -1;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physical_device, &props);
+        debug(user_context) << "    Using device: " << props.deviceName << "\n";
+    }
+    #endif
+
+    // Find a queue family that supports compute.
+    const uint32_t max_families = 16;
+    VkQueueFamilyProperties families[max_families];
+    uint32_t family_count = max_families;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families);
+    uint32_t family = family_count;
+    for (uint32_t i = 0; i < family_count; i++) {
+        if (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            family = i;
+            break;
+        }
+    }
+    if (family == family_count) {
+        error(user_context) << "Vulkan: the device has no compute queue.\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        return -1;
+    }
+
+    // Enable the optional features the kernels may use, where the
+    // device has them. Kernels that need missing ones fail to build.
+    const uint32_t max_extensions = 512;
+    VkExtensionProperties *extensions = (VkExtensionProperties *)malloc(max_extensions * sizeof(VkExtensionProperties));
+    uint32_t extension_count = 0;
+    if (extensions) {
+        extension_count = max_extensions;
+        vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, extensions);
+    }
+    const char *enabled_extensions[2];
+    uint32_t enabled_extension_count = 0;
+
+    VkPhysicalDevice16BitStorageFeatures storage16 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES, NULL};
+    VkPhysicalDevice8BitStorageFeatures storage8 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES, NULL};
+    VkPhysicalDeviceShaderFloat16Int8Features float16_int8 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES, NULL};
+    VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &storage16};
+    if (has_device_extension(extensions, extension_count, "VK_KHR_8bit_storage")) {
+        enabled_extensions[enabled_extension_count++] = "VK_KHR_8bit_storage";
+        storage8.pNext = features.pNext;
+        features.pNext = &storage8;
+    }
+    if (has_device_extension(extensions, extension_count, "VK_KHR_shader_float16_int8")) {
+        enabled_extensions[enabled_extension_count++] = "VK_KHR_shader_float16_int8";
+        float16_int8.pNext = features.pNext;
+        features.pNext = &float16_int8;
+    }
+    free(extensions);
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    VkBool32 float64 = features.features.features[VK_FEATURE_SHADER_FLOAT64];
+    VkBool32 int64 = features.features.features[VK_FEATURE_SHADER_INT64];
+    VkBool32 int16 = features.features.features[VK_FEATURE_SHADER_INT16];
+    memset(&features.features, 0, sizeof(features.features));
+    features.features.features[VK_FEATURE_SHADER_FLOAT64] = float64;
+    features.features.features[VK_FEATURE_SHADER_INT64] = int64;
+    features.features.features[VK_FEATURE_SHADER_INT16] = int16;
+    storage16.uniformAndStorageBuffer16BitAccess = 0;
+    storage16.storagePushConstant16 = 0;
+    storage16.storageInputOutput16 = 0;
+    storage8.uniformAndStorageBuffer8BitAccess = 0;
+    storage8.storagePushConstant8 = 0;
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {
+        VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, NULL, 0,
+        family, 1, &priority};
+    VkDeviceCreateInfo device_info = {
+        VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO, &features, 0,
+        1, &queue_info, 0, NULL,
+        enabled_extension_count, enabled_extensions, NULL};
+    debug(user_context) << "    vkCreateDevice -> ";
+    result = vkCreateDevice(physical_device, &device_info, NULL, &device);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << get_vulkan_error_name(result) << "\n";
+        error(user_context) << "Vulkan: vkCreateDevice failed: " << get_vulkan_error_name(result) << "\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        physical_device = NULL;
+        device = NULL;
+        return result;
+    }
+    debug(user_context) << device << "\n";
+
+    vkGetDeviceQueue(device, family, 0, &queue);
+    queue_family_index = family;
+    return 0;
+}
+
+// Make the command pool and pipeline cache on a newly acquired device.
+WEAK int init_device_state(void *user_context, VkPhysicalDevice phys, VkDevice dev,
+                           VkQueue q, uint32_t family) {
+    if (dev_state.device == dev) {
+        return 0;
+    }
+    if (dev_state.device != NULL) {
+        error(user_context) << "Vulkan: the acquired device changed without a call to halide_device_release.\n";
+        return -1;
+    }
+    if (vkCreateDevice == NULL) {
+        // The application made the device; we still need the API.
+        load_libvulkan(user_context);
+        if (vkCreateDevice == NULL) {
+            error(user_context) << "Could not find Vulkan loader library\n";
+            return -1;
+        }
+    }
+
+    VkCommandPoolCreateInfo pool_info = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, NULL,
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, family};
+    VkCommandPool command_pool;
+    VkResult result = vkCreateCommandPool(dev, &pool_info, NULL, &command_pool);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateCommandPool failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, NULL, 0, 0, NULL};
+    VkPipelineCache pipeline_cache;
+    result = vkCreatePipelineCache(dev, &cache_info, NULL, &pipeline_cache);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreatePipelineCache failed: " << get_vulkan_error_name(result) << "\n";
+        vkDestroyCommandPool(dev, command_pool, NULL);
+        return result;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(phys, &props);
+
+    dev_state.device = dev;
+    dev_state.physical_device = phys;
+    dev_state.queue = q;
+    dev_state.command_pool = command_pool;
+    dev_state.pipeline_cache = pipeline_cache;
+    vkGetPhysicalDeviceMemoryProperties(phys, &dev_state.memory_properties);
+    dev_state.min_storage_buffer_offset_alignment = props.limits.minStorageBufferOffsetAlignment;
+    dev_state.batches = NULL;
+    dev_state.pending = NULL;
+    dev_state.last_submitted = NULL;
+    return 0;
+}
+
+class VulkanContext {
+    void *user_context;
+
+public:
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queue_family_index;
+    int error;
+
+    INLINE VulkanContext(void *user_context, bool create = true) : user_context(user_context),
+                                                                   instance(NULL),
+                                                                   physical_device(NULL),
+                                                                   device(NULL),
+                                                                   queue(NULL),
+                                                                   queue_family_index(0),
+                                                                   error(0) {
+        error = halide_vulkan_acquire_context(user_context, &instance, &physical_device,
+                                              &device, &queue, &queue_family_index, create);
+        if (error == 0 && device != NULL) {
+            error = init_device_state(user_context, physical_device, device, queue, queue_family_index);
+        } else if (error == 0 && create) {
+            error = -1;
+        }
+    }
+
+    INLINE ~VulkanContext() {
+        halide_vulkan_release_context(user_context);
+    }
+};
+
+// Pick the memory type for a buffer: device local and host visible if
+// there is such a type, or else just host visible.
+WEAK uint32_t select_memory_type(uint32_t type_bits) {
+    const VkFlags wanted[] = {
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+    for (int w = 0; w < 2; w++) {
+        for (uint32_t i = 0; i < dev_state.memory_properties.memoryTypeCount; i++) {
+            if ((type_bits & (1 << i)) &&
+                (dev_state.memory_properties.memoryTypes[i].propertyFlags & wanted[w]) == wanted[w]) {
+                return i;
+            }
+        }
+    }
+    return (uint32_t)-1;
+}
+
+WEAK vk_allocation *new_allocation(void *user_context, VkDevice dev, uint64_t size) {
+    vk_allocation *alloc = (vk_allocation *)malloc(sizeof(vk_allocation));
+    if (alloc == NULL) {
+        return NULL;
+    }
+    alloc->size = size;
+    alloc->owned = true;
+    alloc->mapped = NULL;
+    alloc->next = NULL;
+
+    VkBufferCreateInfo buffer_info = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, NULL, 0, size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_SHARING_MODE_EXCLUSIVE, 0, NULL};
+    VkResult result = vkCreateBuffer(dev, &buffer_info, NULL, &alloc->buffer);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << "    vkCreateBuffer failed: " << get_vulkan_error_name(result) << "\n";
+        free(alloc);
+        return NULL;
+    }
+
+    VkMemoryRequirements reqs;
+    vkGetBufferMemoryRequirements(dev, alloc->buffer, &reqs);
+    uint32_t memory_type = select_memory_type(reqs.memoryTypeBits);
+    if (memory_type == (uint32_t)-1) {
+        error(user_context) << "Vulkan: the device has no host visible memory for buffers.\n";
+        vkDestroyBuffer(dev, alloc->buffer, NULL);
+        free(alloc);
+        return NULL;
+    }
+    VkMemoryAllocateInfo memory_info = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, reqs.size, memory_type};
+    result = vkAllocateMemory(dev, &memory_info, NULL, &alloc->memory);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << "    vkAllocateMemory failed: " << get_vulkan_error_name(result) << "\n";
+        vkDestroyBuffer(dev, alloc->buffer, NULL);
+        free(alloc);
+        return NULL;
+    }
+    void *mapped = NULL;
+    if (vkBindBufferMemory(dev, alloc->buffer, alloc->memory, 0) != VK_SUCCESS ||
+        vkMapMemory(dev, alloc->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        vkDestroyBuffer(dev, alloc->buffer, NULL);
+        vkFreeMemory(dev, alloc->memory, NULL);
+        free(alloc);
+        return NULL;
+    }
+    alloc->mapped = (uint8_t *)mapped;
+    return alloc;
+}
+
+WEAK void reset_descriptor_pools(command_batch *batch) {
+    for (descriptor_pool *p = batch->pools; p; p = p->next) {
+        vkResetDescriptorPool(dev_state.device, p->pool, 0);
+        p->sets_left = descriptor_pool_sets;
+        p->descriptors_left = descriptor_pool_descriptors;
+    }
+}
+
+// Make a finished batch ready to record into again.
+WEAK void recycle_batch(command_batch *batch) {
+    vkResetFences(dev_state.device, 1, &batch->fence);
+    vkResetCommandBuffer(batch->command_buffer, 0);
+    reset_descriptor_pools(batch);
+    while (batch->garbage) {
+        vk_allocation *next = batch->garbage->next;
+        free_allocation(dev_state.device, batch->garbage);
+        batch->garbage = next;
+    }
+    batch->submitted = false;
+    if (dev_state.last_submitted == batch) {
+        dev_state.last_submitted = NULL;
+    }
+}
+
+// The batch to record the next commands into.
+WEAK command_batch *get_pending_batch(void *user_context) {
+    if (dev_state.pending) {
+        return dev_state.pending;
+    }
+
+    command_batch *batch = NULL;
+    for (command_batch *b = dev_state.batches; b; b = b->next) {
+        if (!b->submitted) {
+            batch = b;
+            break;
+        }
+        if (vkGetFenceStatus(dev_state.device, b->fence) == VK_SUCCESS) {
+            recycle_batch(b);
+            batch = b;
+            break;
+        }
+    }
+
+    if (batch == NULL) {
+        batch = (command_batch *)malloc(sizeof(command_batch));
+        if (batch == NULL) {
+            return NULL;
+        }
+        VkCommandBufferAllocateInfo alloc_info = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, NULL,
+            dev_state.command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1};
+        VkResult result = vkAllocateCommandBuffers(dev_state.device, &alloc_info, &batch->command_buffer);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkAllocateCommandBuffers failed: " << get_vulkan_error_name(result) << "\n";
+            free(batch);
+            return NULL;
+        }
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0};
+        result = vkCreateFence(dev_state.device, &fence_info, NULL, &batch->fence);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkCreateFence failed: " << get_vulkan_error_name(result) << "\n";
+            free(batch);
+            return NULL;
+        }
+        debug(user_context) << "Vulkan - Allocating: command batch " << batch << "\n";
+        batch->pools = NULL;
+        batch->garbage = NULL;
+        batch->submitted = false;
+        batch->next = dev_state.batches;
+        dev_state.batches = batch;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, NULL};
+    VkResult result = vkBeginCommandBuffer(batch->command_buffer, &begin_info);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkBeginCommandBuffer failed: " << get_vulkan_error_name(result) << "\n";
+        return NULL;
+    }
+    batch->num_commands = 0;
+    dev_state.pending = batch;
+    return batch;
+}
+
+WEAK void record_memory_barrier(command_batch *batch, VkFlags src_stages, VkFlags src_access,
+                                VkFlags dst_stages, VkFlags dst_access) {
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, src_access, dst_access};
+    vkCmdPipelineBarrier(batch->command_buffer, src_stages, dst_stages, 0,
+                         1, &barrier, 0, NULL, 0, NULL);
+}
+
+// Make the next command of the batch wait for the previous ones.
+WEAK void begin_command(command_batch *batch) {
+    if (batch->num_commands > 0) {
+        const VkFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        record_memory_barrier(batch,
+                              stages, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                              stages, (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                       VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT));
+    }
+    batch->num_commands++;
+}
+
+WEAK int commit_pending_batch(void *user_context) {
+    command_batch *batch = dev_state.pending;
+    if (batch == NULL || batch->num_commands == 0) {
+        // An empty batch stays pending for the next commands.
+        return 0;
+    }
+
+    // Make the results visible to the host once the fence signals.
+    record_memory_barrier(batch,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    dev_state.pending = NULL;
+
+    VkResult result = vkEndCommandBuffer(batch->command_buffer);
+    if (result == VK_SUCCESS) {
+        VkSubmitInfo submit_info = {
+            VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL, 0, NULL, NULL,
+            1, &batch->command_buffer, 0, NULL};
+        result = vkQueueSubmit(dev_state.queue, 1, &submit_info, batch->fence);
+    }
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: submitting command buffer failed: " << get_vulkan_error_name(result) << "\n";
+        vkResetCommandBuffer(batch->command_buffer, 0);
+        reset_descriptor_pools(batch);
+        return halide_error_code_device_run_failed;
+    }
+    debug(user_context) << "Vulkan - Submitted command batch " << batch
+                        << " of " << batch->num_commands << " commands\n";
+    batch->submitted = true;
+    dev_state.last_submitted = batch;
+    return 0;
+}
+
+// Submit the pending batch, and wait for all the submitted ones.
+WEAK int wait_for_batches(void *user_context) {
+    int err = commit_pending_batch(user_context);
+    for (command_batch *b = dev_state.batches; b; b = b->next) {
+        if (b->submitted) {
+            VkResult result = vkWaitForFences(dev_state.device, 1, &b->fence, 1, ~0ULL);
+            if (result != VK_SUCCESS) {
+                error(user_context) << "Vulkan: vkWaitForFences failed: " << get_vulkan_error_name(result) << "\n";
+                err = halide_error_code_device_sync_failed;
+            }
+            recycle_batch(b);
+        }
+    }
+    return err;
+}
+
+// Destroy an allocation once the commands that might use it are done.
+WEAK void free_allocation_after_commands(vk_allocation *alloc) {
+    command_batch *batch = dev_state.last_submitted;
+    if (dev_state.pending && dev_state.pending->num_commands > 0) {
+        batch = dev_state.pending;
+    }
+    if (batch) {
+        alloc->next = batch->garbage;
+        batch->garbage = alloc;
+    } else {
+        free_allocation(dev_state.device, alloc);
+    }
+}
+
+WEAK VkDescriptorSet allocate_descriptor_set(void *user_context, command_batch *batch, kernel_state *kernel) {
+    descriptor_pool *pool = batch->pools;
+    while (pool && (pool->sets_left == 0 || pool->descriptors_left < kernel->num_buffers)) {
+        pool = pool->next;
+    }
+    if (pool == NULL) {
+        pool = (descriptor_pool *)malloc(sizeof(descriptor_pool));
+        if (pool == NULL) {
+            return VK_NULL_HANDLE;
+        }
+        VkDescriptorPoolSize size = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptor_pool_descriptors};
+        VkDescriptorPoolCreateInfo pool_info = {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, NULL, 0,
+            descriptor_pool_sets, 1, &size};
+        VkResult result = vkCreateDescriptorPool(dev_state.device, &pool_info, NULL, &pool->pool);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkCreateDescriptorPool failed: " << get_vulkan_error_name(result) << "\n";
+            free(pool);
+            return VK_NULL_HANDLE;
+        }
+        pool->sets_left = descriptor_pool_sets;
+        pool->descriptors_left = descriptor_pool_descriptors;
+        pool->next = batch->pools;
+        batch->pools = pool;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, NULL,
+        pool->pool, 1, &kernel->set_layout};
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(dev_state.device, &alloc_info, &set);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkAllocateDescriptorSets failed: " << get_vulkan_error_name(result) << "\n";
+        return VK_NULL_HANDLE;
+    }
+    pool->sets_left--;
+    pool->descriptors_left -= kernel->num_buffers;
+    return set;
+}
+
+// The scalar arguments are packed into the push constants the way the
+// kernels declare them: each takes a slot of at least four bytes,
+// aligned to the slot size. Narrower values are zero-extended.
+INLINE uint32_t push_constant_slot_bytes(size_t arg_size) {
+    return arg_size < 4 ? 4 : (uint32_t)arg_size;
+}
+
+WEAK uint32_t pack_push_constants(size_t arg_sizes[], void *args[], int8_t arg_is_buffer[], uint8_t *data) {
+    uint32_t offset = 0;
+    for (size_t i = 0; arg_sizes[i] != 0; i++) {
+        if (arg_is_buffer[i]) {
+            continue;
+        }
+        uint32_t slot = push_constant_slot_bytes(arg_sizes[i]);
+        offset = (offset + slot - 1) / slot * slot;
+        if (data && offset + slot <= max_push_constant_bytes) {
+            memcpy(data + offset, args[i], arg_sizes[i]);
+        }
+        offset += slot;
+    }
+    return offset;
+}
+
+WEAK int create_kernel_layout(void *user_context, kernel_state *kernel,
+                              size_t arg_sizes[], int8_t arg_is_buffer[]) {
+    uint32_t num_buffers = 0;
+    for (size_t i = 0; arg_sizes[i] != 0; i++) {
+        if (arg_is_buffer[i]) {
+            num_buffers++;
+        }
+    }
+    if (num_buffers > max_kernel_buffers) {
+        error(user_context) << "Vulkan: kernel " << kernel->name << " uses " << num_buffers
+                            << " buffers, but at most " << max_kernel_buffers << " are supported.\n";
+        return -1;
+    }
+
+    VkDescriptorSetLayoutBinding bindings[max_kernel_buffers];
+    for (uint32_t i = 0; i < num_buffers; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = NULL;
+    }
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, NULL, 0,
+        num_buffers, bindings};
+    VkResult result = vkCreateDescriptorSetLayout(dev_state.device, &set_layout_info, NULL, &kernel->set_layout);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateDescriptorSetLayout failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+
+    uint32_t push_constant_bytes = pack_push_constants(arg_sizes, NULL, arg_is_buffer, NULL);
+    VkPushConstantRange range = {VK_SHADER_STAGE_COMPUTE_BIT, 0, push_constant_bytes};
+    VkPipelineLayoutCreateInfo layout_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, NULL, 0,
+        1, &kernel->set_layout,
+        push_constant_bytes > 0 ? 1u : 0u, &range};
+    result = vkCreatePipelineLayout(dev_state.device, &layout_info, NULL, &kernel->layout);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreatePipelineLayout failed: " << get_vulkan_error_name(result) << "\n";
+        vkDestroyDescriptorSetLayout(dev_state.device, kernel->set_layout, NULL);
+        return result;
+    }
+
+    kernel->num_buffers = num_buffers;
+    kernel->push_constant_bytes = push_constant_bytes;
+    kernel->layout_created = true;
+    return 0;
+}
+
+// Find or make the pipeline of a kernel for a workgroup size.
+WEAK VkPipeline get_pipeline(void *user_context, kernel_state *kernel, int threadsX, int threadsY, int threadsZ) {
+    for (pipeline_entry *p = kernel->pipelines; p; p = p->next) {
+        if (p->threads[0] == threadsX && p->threads[1] == threadsY && p->threads[2] == threadsZ) {
+            return p->pipeline;
+        }
+    }
+
+    pipeline_entry *entry = (pipeline_entry *)malloc(sizeof(pipeline_entry));
+    if (entry == NULL) {
+        return VK_NULL_HANDLE;
+    }
+    entry->threads[0] = threadsX;
+    entry->threads[1] = threadsY;
+    entry->threads[2] = threadsZ;
+
+    VkSpecializationMapEntry map_entries[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        map_entries[i].constantID = i;
+        map_entries[i].offset = i * sizeof(int32_t);
+        map_entries[i].size = sizeof(int32_t);
+    }
+    VkSpecializationInfo specialization = {3, map_entries, sizeof(entry->threads), entry->threads};
+    VkComputePipelineCreateInfo pipeline_info = {
+        VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO, NULL, 0,
+        {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0,
+         VK_SHADER_STAGE_COMPUTE_BIT, kernel->shader, "main", &specialization},
+        kernel->layout, VK_NULL_HANDLE, -1};
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VkResult result = vkCreateComputePipelines(dev_state.device, dev_state.pipeline_cache, 1,
+                                               &pipeline_info, NULL, &entry->pipeline);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateComputePipelines failed for kernel " << kernel->name
+                            << ": " << get_vulkan_error_name(result) << "\n";
+        free(entry);
+        return VK_NULL_HANDLE;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time for vkCreateComputePipelines: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    entry->next = kernel->pipelines;
+    kernel->pipelines = entry;
+    return entry->pipeline;
+}
+
+WEAK void release_kernels(VkDevice dev, module_state *state) {
+    kernel_state *kernel = state->kernels;
+    while (kernel) {
+        pipeline_entry *p = kernel->pipelines;
+        while (p) {
+            pipeline_entry *next = p->next;
+            vkDestroyPipeline(dev, p->pipeline, NULL);
+            free(p);
+            p = next;
+        }
+        if (kernel->layout_created) {
+            vkDestroyPipelineLayout(dev, kernel->layout, NULL);
+            vkDestroyDescriptorSetLayout(dev, kernel->set_layout, NULL);
+        }
+        vkDestroyShaderModule(dev, kernel->shader, NULL);
+        kernel_state *next = kernel->next;
+        free(kernel->name);
+        free(kernel);
+        kernel = next;
+    }
+    state->kernels = NULL;
+    state->device = NULL;
+}
+
+// Host access to the memory of a device buffer. Buffers that are not
+// mapped are copied through a staging buffer.
+struct host_view {
+    uint8_t *ptr;
+    device_handle *handle;
+    vk_allocation *staging;
+    uint64_t size;
+};
+
+WEAK int record_copy_and_wait(void *user_context, VkBuffer src, uint64_t src_offset,
+                              VkBuffer dst, uint64_t dst_offset, uint64_t size) {
+    command_batch *batch = get_pending_batch(user_context);
+    if (batch == NULL) {
+        return halide_error_code_device_buffer_copy_failed;
+    }
+    begin_command(batch);
+    VkBufferCopy region = {src_offset, dst_offset, size};
+    vkCmdCopyBuffer(batch->command_buffer, src, dst, 1, &region);
+    return wait_for_batches(user_context);
+}
+
+WEAK int begin_host_access(void *user_context, device_handle *handle, uint64_t size, host_view *view) {
+    view->handle = handle;
+    view->size = size;
+    view->staging = NULL;
+    if (handle->allocation->mapped) {
+        view->ptr = handle->allocation->mapped + handle->offset;
+        return 0;
+    }
+    view->staging = new_allocation(user_context, dev_state.device, size);
+    if (view->staging == NULL) {
+        error(user_context) << "Vulkan: could not allocate a staging buffer.\n";
+        return halide_error_code_out_of_memory;
+    }
+    view->ptr = view->staging->mapped;
+    return record_copy_and_wait(user_context, handle->allocation->buffer, handle->offset,
+                                view->staging->buffer, 0, size);
+}
+
+WEAK int end_host_access(void *user_context, host_view *view, bool written) {
+    if (view->staging == NULL) {
+        return 0;
+    }
+    int err = 0;
+    if (written) {
+        err = record_copy_and_wait(user_context, view->staging->buffer, 0,
+                                   view->handle->allocation->buffer, view->handle->offset, view->size);
+    }
+    free_allocation(dev_state.device, view->staging);
+    view->staging = NULL;
+    return err;
+}
+
+WEAK void do_device_to_device_copy(command_batch *batch, const device_copy &c,
+                                   uint64_t src_offset, uint64_t dst_offset, int d) {
+    if (d == 0) {
+        VkBufferCopy region = {c.src_begin + src_offset, dst_offset, c.chunk_size};
+        vkCmdCopyBuffer(batch->command_buffer,
+                        ((device_handle *)c.src)->allocation->buffer,
+                        ((device_handle *)c.dst)->allocation->buffer,
+                        1, &region);
+    } else {
+        // TODO: deal with negative strides. Currently the code in
+        // device_buffer_utils.h does not do so either.
+        uint64_t src_off = 0, dst_off = 0;
+        for (uint64_t i = 0; i < c.extent[d-1]; i++) {
+            do_device_to_device_copy(batch, c, src_offset + src_off, dst_offset + dst_off, d - 1);
+            dst_off += c.dst_stride_bytes[d-1];
+            src_off += c.src_stride_bytes[d-1];
+        }
+    }
+}
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
+
+extern "C" {
+
+WEAK int halide_vulkan_device_free(void *user_context, halide_buffer_t* buf) {
+    debug(user_context) << "halide_vulkan_device_free called on buf "
+                        << buf << " device is " << buf->device << "\n";
+    if (buf->device == 0) {
+        return 0;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    device_handle *handle = (device_handle *)buf->device;
+    halide_assert(user_context, handle->offset == 0 && "halide_vulkan_device_free on buffer obtained from halide_device_crop");
+
+    {
+        VulkanContext ctx(user_context, false);
+        if (ctx.error != 0) {
+            return ctx.error;
+        }
+        vk_allocation *alloc = handle->allocation;
+        if (ctx.device == NULL) {
+            // The device is gone, and its buffers with it.
+            free(alloc);
+        } else if (alloc->owned &&
+                   device_allocation_cache_put(user_context, &allocation_cache, ctx.device,
+                                               alloc->size, (uint64_t)alloc)) {
+            // Commands using a cached buffer run before those of its next
+            // user, as they are all on one queue and separated by barriers.
+            debug(user_context) << "    caching buffer " << alloc << "\n";
+        } else {
+            free_allocation_after_commands(alloc);
+        }
+    }
+
+    free(handle);
+    buf->device = 0;
+    buf->device_interface->impl->release_module();
+    buf->device_interface = NULL;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_initialize_kernels(void *user_context, void **state_ptr, const char* src, int size) {
+    debug(user_context)
+        << "halide_vulkan_initialize_kernels (user_context: " << user_context
+        << ", state_ptr: " << state_ptr
+        << ", program: " << (void *)src
+        << ", size: " << size << ")\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    // Create the state object if necessary. This only happens once, regardless
+    // of how many times halide_initialize_kernels/halide_release is called.
+    // halide_release traverses this list and releases the module objects, but
+    // it does not modify the list nodes created/inserted here.
+    module_state **state = (module_state**)state_ptr;
+    if (!(*state)) {
+        *state = (module_state*)malloc(sizeof(module_state));
+        if (*state == NULL) {
+            return halide_error_code_out_of_memory;
+        }
+        (*state)->device = NULL;
+        (*state)->kernels = NULL;
+        (*state)->next = state_list;
+        state_list = *state;
+    }
+
+    if ((*state)->device == ctx.device) {
+        return 0;
+    }
+
+    // The module is a sequence of kernels, each of which is a name and
+    // its SPIR-V, both prefixed with their size in bytes.
+    int offset = 0;
+    while (offset + 4 <= size) {
+        uint32_t name_size, code_size;
+        memcpy(&name_size, src + offset, 4);
+        const char *name = src + offset + 4;
+        offset += 4 + name_size;
+        if (offset + 4 > size) {
+            break;
+        }
+        memcpy(&code_size, src + offset, 4);
+        // Copy the code, as it must be aligned to four bytes.
+        uint32_t *code = (uint32_t *)malloc(code_size);
+        kernel_state *kernel = (kernel_state *)malloc(sizeof(kernel_state));
+        size_t name_len = strlen(name);
+        char *kernel_name = (char *)malloc(name_len + 1);
+        if (code == NULL || kernel == NULL || kernel_name == NULL) {
+            free(code);
+            free(kernel);
+            free(kernel_name);
+            return halide_error_code_out_of_memory;
+        }
+        memcpy(code, src + offset + 4, code_size);
+        memcpy(kernel_name, name, name_len + 1);
+        offset += 4 + code_size;
+
+        VkShaderModuleCreateInfo shader_info = {
+            VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, NULL, 0, code_size, code};
+        VkResult result = vkCreateShaderModule(ctx.device, &shader_info, NULL, &kernel->shader);
+        free(code);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkCreateShaderModule failed for kernel " << kernel_name
+                                << ": " << get_vulkan_error_name(result) << "\n";
+            free(kernel);
+            free(kernel_name);
+            return result;
+        }
+        debug(user_context) << "    created shader module for kernel " << kernel_name << "\n";
+        kernel->name = kernel_name;
+        kernel->layout_created = false;
+        kernel->pipelines = NULL;
+        kernel->next = (*state)->kernels;
+        (*state)->kernels = kernel;
+    }
+    (*state)->device = ctx.device;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_sync(void *user_context, struct halide_buffer_t *) {
+    debug(user_context)
+        << "halide_vulkan_device_sync (user_context: " << user_context << ")\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    int err = wait_for_batches(user_context);
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_device_release(void *user_context) {
+    debug(user_context)
+        << "halide_vulkan_device_release (user_context: " <<  user_context << ")\n";
+
+    // The VulkanContext object does not allow the context storage to be
+    // modified, so we use halide_vulkan_acquire_context directly.
+    VkInstance acquired_instance;
+    VkPhysicalDevice acquired_physical_device;
+    VkDevice acquired_device;
+    VkQueue acquired_queue;
+    uint32_t acquired_family;
+    int err = halide_vulkan_acquire_context(user_context, &acquired_instance, &acquired_physical_device,
+                                            &acquired_device, &acquired_queue, &acquired_family, false);
+    if (err != 0) {
+        return err;
+    }
+
+    if (acquired_device && dev_state.device == acquired_device) {
+        wait_for_batches(user_context);
+
+        // Return the cached allocations made on this device to the driver.
+        device_allocation_cache_release(user_context, &allocation_cache, acquired_device, free_cached_allocation);
+
+        // Unload the modules attached to this device. Note that the list
+        // nodes themselves are not freed, only the kernel objects are
+        // released. Subsequent calls to halide_init_kernels might re-create
+        // the kernels using the same list node.
+        for (module_state *state = state_list; state; state = state->next) {
+            if (state->device == acquired_device) {
+                release_kernels(acquired_device, state);
+            }
+        }
+
+        // A pending batch may be empty, and so was not waited for.
+        if (dev_state.pending) {
+            vkResetCommandBuffer(dev_state.pending->command_buffer, 0);
+            dev_state.pending = NULL;
+        }
+        command_batch *batch = dev_state.batches;
+        while (batch) {
+            command_batch *next = batch->next;
+            descriptor_pool *pool = batch->pools;
+            while (pool) {
+                descriptor_pool *next_pool = pool->next;
+                vkDestroyDescriptorPool(acquired_device, pool->pool, NULL);
+                free(pool);
+                pool = next_pool;
+            }
+            vkDestroyFence(acquired_device, batch->fence, NULL);
+            free(batch);
+            batch = next;
+        }
+        dev_state.batches = NULL;
+        dev_state.last_submitted = NULL;
+        vkDestroyPipelineCache(acquired_device, dev_state.pipeline_cache, NULL);
+        // Destroying the pool frees the command buffers.
+        vkDestroyCommandPool(acquired_device, dev_state.command_pool, NULL);
+        dev_state.device = NULL;
+
+        // Release the device itself, if we created it.
+        if (acquired_device == device) {
+            debug(user_context) << "    vkDestroyDevice " << device << "\n";
+            vkDestroyDevice(device, NULL);
+            device = NULL;
+            queue = NULL;
+            physical_device = NULL;
+            debug(user_context) << "    vkDestroyInstance " << instance << "\n";
+            vkDestroyInstance(instance, NULL);
+            instance = NULL;
+        }
+    }
+
+    halide_vulkan_release_context(user_context);
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_malloc(void *user_context, halide_buffer_t* buf) {
+    debug(user_context)
+        << "halide_vulkan_device_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    size_t size = buf->size_in_bytes();
+    halide_assert(user_context, size != 0);
+    if (buf->device) {
+        // This buffer already has a device allocation
+        return 0;
+    }
+
+    // Check all strides positive
+    for (int i = 0; i < buf->dimensions; i++) {
+        halide_assert(user_context, buf->dim[i].stride > 0);
+    }
+
+    debug(user_context) << "    allocating " << *buf << "\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    device_handle *handle = (device_handle *)malloc(sizeof(device_handle));
+    if (handle == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+
+    vk_allocation *alloc = NULL;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        device_allocation_cache_register(&allocation_cache, halide_vulkan_release_unused_device_allocations);
+        size = device_allocation_size_class(size);
+        uint64_t cached;
+        if (device_allocation_cache_take(&allocation_cache, ctx.device, size, &cached)) {
+            alloc = (vk_allocation *)cached;
+            debug(user_context) << "    reusing cached buffer " << alloc << "\n";
+        }
+    }
+    if (alloc == NULL) {
+        alloc = new_allocation(user_context, ctx.device, size);
+    }
+    if (alloc == NULL && !device_allocation_cache_empty(&allocation_cache)) {
+        // Return the unused allocations to the driver and try again.
+        wait_for_batches(user_context);
+        device_allocation_cache_release(user_context, &allocation_cache, ctx.device, free_cached_allocation);
+        alloc = new_allocation(user_context, ctx.device, size);
+    }
+    if (alloc == NULL) {
+        free(handle);
+        error(user_context) << "Vulkan: Failed to allocate buffer of size " << (int64_t)size << ".\n";
+        return halide_error_code_device_malloc_failed;
+    }
+
+    handle->allocation = alloc;
+    handle->offset = 0;
+
+    buf->device = (uint64_t)handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+
+    debug(user_context) << "    allocated buffer " << (void *)alloc->buffer << " of " << (int64_t)size << " bytes\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_copy_to_device(void *user_context, halide_buffer_t* buffer) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, buffer->host && buffer->device);
+    halide_assert(user_context, buffer->dimensions <= MAX_COPY_DIMS);
+    if (buffer->dimensions > MAX_COPY_DIMS) {
+        return -1;
+    }
+
+    // Wait for the commands that use the buffer before overwriting it.
+    int err = wait_for_batches(user_context);
+    if (err != 0) {
+        return err;
+    }
+
+    device_copy c = make_host_to_device_copy(buffer);
+    host_view view;
+    err = begin_host_access(user_context, (device_handle *)c.dst, buffer->size_in_bytes(), &view);
+    if (err == 0) {
+        c.dst = (uint64_t)view.ptr;
+        copy_memory(c, user_context);
+        err = end_host_access(user_context, &view, true);
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_copy_to_device: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_copy_to_host(void *user_context, halide_buffer_t* buffer) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, buffer->host && buffer->device);
+    halide_assert(user_context, buffer->dimensions <= MAX_COPY_DIMS);
+    if (buffer->dimensions > MAX_COPY_DIMS) {
+        return -1;
+    }
+
+    int err = wait_for_batches(user_context);
+    if (err != 0) {
+        return err;
+    }
+
+    device_copy c = make_device_to_host_copy(buffer);
+    host_view view;
+    err = begin_host_access(user_context, (device_handle *)c.src, buffer->size_in_bytes(), &view);
+    if (err == 0) {
+        c.src = (uint64_t)view.ptr;
+        copy_memory(c, user_context);
+        err = end_host_access(user_context, &view, false);
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_copy_to_host: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_run(void *user_context,
+                           void *state_ptr,
+                           const char* entry_name,
+                           int blocksX, int blocksY, int blocksZ,
+                           int threadsX, int threadsY, int threadsZ,
+                           int shared_mem_bytes,
+                           size_t arg_sizes[],
+                           void* args[],
+                           int8_t arg_is_buffer[],
+                           int num_attributes,
+                           float* vertex_buffer,
+                           int num_coords_dim0,
+                           int num_coords_dim1) {
+    debug(user_context)
+        << "halide_vulkan_run (user_context: " << user_context << ", "
+        << "entry: " << entry_name << ", "
+        << "blocks: " << blocksX << "x" << blocksY << "x" << blocksZ << ", "
+        << "threads: " << threadsX << "x" << threadsY << "x" << threadsZ << ")\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, state_ptr);
+    module_state *state = (module_state *)state_ptr;
+    kernel_state *kernel = state->kernels;
+    while (kernel && strcmp(kernel->name, entry_name) != 0) {
+        kernel = kernel->next;
+    }
+    if (kernel == NULL) {
+        error(user_context) << "Vulkan: could not find kernel " << entry_name << " in the module.\n";
+        return halide_error_code_device_run_failed;
+    }
+
+    if (!kernel->layout_created) {
+        int err = create_kernel_layout(user_context, kernel, arg_sizes, arg_is_buffer);
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    VkPipeline pipeline = get_pipeline(user_context, kernel, threadsX, threadsY, threadsZ);
+    if (pipeline == VK_NULL_HANDLE) {
+        return halide_error_code_device_run_failed;
+    }
+
+    command_batch *batch = get_pending_batch(user_context);
+    if (batch == NULL) {
+        error(user_context) << "Vulkan: Could not allocate command buffer.\n";
+        return halide_error_code_device_run_failed;
+    }
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    if (kernel->num_buffers > 0) {
+        set = allocate_descriptor_set(user_context, batch, kernel);
+        if (set == VK_NULL_HANDLE) {
+            return halide_error_code_device_run_failed;
+        }
+        VkDescriptorBufferInfo buffer_infos[max_kernel_buffers];
+        VkWriteDescriptorSet writes[max_kernel_buffers];
+        uint32_t binding = 0;
+        for (size_t i = 0; arg_sizes[i] != 0; i++) {
+            if (!arg_is_buffer[i]) {
+                continue;
+            }
+            halide_assert(user_context, arg_sizes[i] == sizeof(uint64_t));
+            device_handle *handle = (device_handle *)((halide_buffer_t *)args[i])->device;
+            if (handle->offset % dev_state.min_storage_buffer_offset_alignment != 0) {
+                error(user_context) << "Vulkan: kernel " << entry_name << " uses a crop at offset "
+                                    << handle->offset << ", which is not a multiple of the "
+                                    << "device's storage buffer alignment of "
+                                    << dev_state.min_storage_buffer_offset_alignment << " bytes.\n";
+                return halide_error_code_device_run_failed;
+            }
+            buffer_infos[binding].buffer = handle->allocation->buffer;
+            buffer_infos[binding].offset = handle->offset;
+            buffer_infos[binding].range = VK_WHOLE_SIZE;
+            VkWriteDescriptorSet write = {
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, set, binding, 0, 1,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buffer_infos[binding], NULL};
+            writes[binding] = write;
+            binding++;
+        }
+        vkUpdateDescriptorSets(dev_state.device, binding, writes, 0, NULL);
+    }
+
+    begin_command(batch);
+    vkCmdBindPipeline(batch->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    if (set != VK_NULL_HANDLE) {
+        vkCmdBindDescriptorSets(batch->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                kernel->layout, 0, 1, &set, 0, NULL);
+    }
+    if (kernel->push_constant_bytes > 0) {
+        uint8_t push_constants[max_push_constant_bytes];
+        memset(push_constants, 0, sizeof(push_constants));
+        pack_push_constants(arg_sizes, args, arg_is_buffer, push_constants);
+        vkCmdPushConstants(batch->command_buffer, kernel->layout, VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, kernel->push_constant_bytes, push_constants);
+    }
+    vkCmdDispatch(batch->command_buffer, blocksX, blocksY, blocksZ);
+
+    // The dispatch is submitted along with the commands recorded after
+    // it, when something needs its results.
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_and_host_malloc(void *user_context, struct halide_buffer_t *buffer) {
+    debug(user_context) << "halide_vulkan_device_and_host_malloc called.\n";
+    int result = halide_vulkan_device_malloc(user_context, buffer);
+    if (result == 0) {
+        // Our own allocations are always mapped.
+        device_handle *handle = (device_handle *)buffer->device;
+        buffer->host = handle->allocation->mapped;
+        debug(user_context) << "halide_vulkan_device_and_host_malloc"
+                            << " device = " << (void*)buffer->device
+                            << " host = " << buffer->host << "\n";
+    }
+    return result;
+}
+
+WEAK int halide_vulkan_device_and_host_free(void *user_context, struct halide_buffer_t *buffer) {
+    debug(user_context) << "halide_vulkan_device_and_host_free called.\n";
+    halide_vulkan_device_free(user_context, buffer);
+    buffer->host = NULL;
+    return 0;
+}
+
+WEAK int halide_vulkan_buffer_copy(void *user_context, struct halide_buffer_t *src,
+                                   const struct halide_device_interface_t *dst_device_interface,
+                                   struct halide_buffer_t *dst) {
+    if (dst->dimensions > MAX_COPY_DIMS) {
+        error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
+        return halide_error_code_device_buffer_copy_failed;
+    }
+
+    // We only handle copies to vulkan buffers or to host
+    halide_assert(user_context, dst_device_interface == NULL ||
+                  dst_device_interface == &vulkan_device_interface);
+
+    if ((src->device_dirty() || src->host == NULL) &&
+        src->device_interface != &vulkan_device_interface) {
+        halide_assert(user_context, dst_device_interface == &vulkan_device_interface);
+        // This is handled at the higher level.
+        return halide_error_code_incompatible_device_interface;
+    }
+
+    bool from_host = (src->device_interface != &vulkan_device_interface) ||
+                     (src->device == 0) ||
+                     (src->host_dirty() && src->host != NULL);
+    bool to_host = !dst_device_interface;
+
+    halide_assert(user_context, from_host || src->device);
+    halide_assert(user_context, to_host || dst->device);
+
+    device_copy c = make_buffer_copy(src, from_host, dst, to_host);
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    debug(user_context)
+        << "halide_vulkan_buffer_copy (user_context: " << user_context
+        << ", src: " << src << ", dst: " << dst << ")\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    int err = 0;
+    if (!from_host && !to_host) {
+        // Device only case
+        debug(user_context) << "halide_vulkan_buffer_copy device to device case.\n";
+        command_batch *batch = get_pending_batch(user_context);
+        if (batch == NULL) {
+            error(user_context) << "Vulkan: Could not allocate command buffer.\n";
+            return halide_error_code_device_buffer_copy_failed;
+        }
+        begin_command(batch);
+        do_device_to_device_copy(batch, c, ((device_handle *)c.src)->offset,
+                                 ((device_handle *)c.dst)->offset, dst->dimensions);
+    } else {
+        // Need to make sure all reads and writes to/from the device
+        // buffers are complete.
+        err = wait_for_batches(user_context);
+        host_view src_view, dst_view;
+        src_view.staging = dst_view.staging = NULL;
+        if (err == 0 && !from_host) {
+            err = begin_host_access(user_context, (device_handle *)c.src, src->size_in_bytes(), &src_view);
+            c.src = (uint64_t)src_view.ptr;
+        }
+        if (err == 0 && !to_host) {
+            err = begin_host_access(user_context, (device_handle *)c.dst, dst->size_in_bytes(), &dst_view);
+            c.dst = (uint64_t)dst_view.ptr;
+        }
+        if (err == 0) {
+            copy_memory(c, user_context);
+        }
+        if (!from_host) {
+            int e = end_host_access(user_context, &src_view, false);
+            err = err ? err : e;
+        }
+        if (!to_host) {
+            int e = end_host_access(user_context, &dst_view, err == 0);
+            err = err ? err : e;
+        }
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+namespace {
+
+WEAK int vulkan_device_crop_from_offset(void *user_context,
+                                        const struct halide_buffer_t *src,
+                                        int64_t offset,
+                                        struct halide_buffer_t *dst) {
+    dst->device_interface = src->device_interface;
+    device_handle *new_handle = (device_handle *)malloc(sizeof(device_handle));
+    if (new_handle == NULL) {
+        error(user_context) << "halide_vulkan_device_crop: malloc failed making device handle.\n";
+        return halide_error_code_out_of_memory;
+    }
+
+    // The crop shares the allocation of its parent, which outlives it.
+    new_handle->allocation = ((device_handle *)src->device)->allocation;
+    new_handle->offset = ((device_handle *)src->device)->offset + offset;
+    dst->device = (uint64_t)new_handle;
+    return 0;
+}
+
+}  // namespace
+
+WEAK int halide_vulkan_device_crop(void *user_context,
+                                   const struct halide_buffer_t *src,
+                                   struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_crop_byte_offset(src, dst);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_slice(void *user_context,
+                                    const struct halide_buffer_t *src,
+                                    int slice_dim, int slice_pos,
+                                    struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_slice_byte_offset(src, slice_dim, slice_pos);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_release_crop(void *user_context,
+                                           struct halide_buffer_t *buf) {
+    debug(user_context) << "halide_vulkan_device_release_crop called on buf "
+                        << buf << " device is " << buf->device << "\n";
+    if (buf->device == 0) {
+        return 0;
+    }
+    free((device_handle *)buf->device);
+    buf->device = 0;
+    return 0;
+}
+
+WEAK int halide_vulkan_wrap_buffer(void *user_context, struct halide_buffer_t *buf, uint64_t vk_buffer) {
+    halide_assert(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return -2;
+    }
+    device_handle *handle = (device_handle *)malloc(sizeof(device_handle));
+    vk_allocation *alloc = (vk_allocation *)malloc(sizeof(vk_allocation));
+    if (handle == NULL || alloc == NULL) {
+        free(handle);
+        free(alloc);
+        error(user_context) << "halide_vulkan_wrap_buffer: malloc failed making device handle.\n";
+        return halide_error_code_out_of_memory;
+    }
+    alloc->buffer = (VkBuffer)vk_buffer;
+    alloc->memory = VK_NULL_HANDLE;
+    alloc->size = buf->size_in_bytes();
+    alloc->mapped = NULL;
+    alloc->owned = false;
+    alloc->next = NULL;
+    handle->allocation = alloc;
+    handle->offset = 0;
+
+    buf->device = (uint64_t)handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+    return 0;
+}
+
+WEAK int halide_vulkan_detach_buffer(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+    device_handle *handle = (device_handle *)buf->device;
+    {
+        // The caller takes the buffer back, so submit the commands that
+        // use it.
+        VulkanContext ctx(user_context, false);
+        if (ctx.error == 0 && ctx.device != NULL) {
+            commit_pending_batch(user_context);
+        }
+    }
+    buf->device_interface->impl->release_module();
+    buf->device_interface = NULL;
+    free(handle->allocation);
+    free(handle);
+    buf->device = 0;
+    return 0;
+}
+
+WEAK uint64_t halide_vulkan_get_buffer(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+    return (uint64_t)(((device_handle *)buf->device)->allocation->buffer);
+}
+
+WEAK uint64_t halide_vulkan_get_crop_offset(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+    return ((device_handle *)buf->device)->offset;
+}
+
+WEAK void halide_vulkan_commit_command_buffer(void *user_context, void *obj) {
+    VulkanContext ctx(user_context, false);
+    if (ctx.error == 0 && ctx.device != NULL) {
+        commit_pending_batch(user_context);
+    }
+}
+
+WEAK int halide_vulkan_release_unused_device_allocations(void *user_context) {
+    VulkanContext ctx(user_context, false);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+    if (ctx.device == NULL) {
+        return 0;
+    }
+
+    // The cached buffers may still be used by submitted commands.
+    int err = wait_for_batches(user_context);
+    device_allocation_cache_release(user_context, &allocation_cache, ctx.device, free_cached_allocation);
+    return err;
+}
+
+WEAK const struct halide_device_interface_t *halide_vulkan_device_interface() {
+    return &vulkan_device_interface;
+}
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_vulkan_cleanup() {
+    halide_vulkan_device_release(NULL);
+}
+}
+
+} // extern "C" linkage
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+WEAK halide_device_interface_impl_t vulkan_device_interface_impl = {
+    halide_use_jit_module,
+    halide_release_jit_module,
+    halide_vulkan_device_malloc,
+    halide_vulkan_device_free,
+    halide_vulkan_device_sync,
+    halide_vulkan_device_release,
+    halide_vulkan_copy_to_host,
+    halide_vulkan_copy_to_device,
+    halide_vulkan_device_and_host_malloc,
+    halide_vulkan_device_and_host_free,
+    halide_vulkan_buffer_copy,
+    halide_vulkan_device_crop,
+    halide_vulkan_device_slice,
+    halide_vulkan_device_release_crop,
+    halide_vulkan_wrap_buffer,
+    halide_vulkan_detach_buffer
+};
+
+WEAK halide_device_interface_t vulkan_device_interface = {
+    halide_device_malloc,
+    halide_device_free,
+    halide_device_sync,
+    halide_device_release,
+    halide_copy_to_host,
+    halide_copy_to_device,
+    halide_device_and_host_malloc,
+    halide_device_and_host_free,
+    halide_buffer_copy,
+    halide_device_crop,
+    halide_device_slice,
+    halide_device_release_crop,
+    halide_device_wrap_native,
+    halide_device_detach_native,
+    NULL,
+    &vulkan_device_interface_impl
+};
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
@@ -0,0 +1,77 @@
+// Note that this header intentionally does not use include
+// guards. The intended usage of this file is to define the meaning of
+// the VK_FN macro, and then include this file, sometimes repeatedly
+// within the same compilation unit.
+
+#ifndef VK_FN
+#define VK_FN(ret, fn, args)
+#endif
+
+/* Instance and physical device APIs */
+VK_FN(VkResult, vkCreateInstance, (const VkInstanceCreateInfo *, const void *, VkInstance *));
+VK_FN(void, vkDestroyInstance, (VkInstance, const void *));
+VK_FN(VkResult, vkEnumeratePhysicalDevices, (VkInstance, uint32_t *, VkPhysicalDevice *));
+VK_FN(void, vkGetPhysicalDeviceProperties, (VkPhysicalDevice, VkPhysicalDeviceProperties *));
+VK_FN(void, vkGetPhysicalDeviceFeatures2, (VkPhysicalDevice, VkPhysicalDeviceFeatures2 *));
+VK_FN(void, vkGetPhysicalDeviceQueueFamilyProperties, (VkPhysicalDevice, uint32_t *, VkQueueFamilyProperties *));
+VK_FN(void, vkGetPhysicalDeviceMemoryProperties, (VkPhysicalDevice, VkPhysicalDeviceMemoryProperties *));
+VK_FN(VkResult, vkEnumerateDeviceExtensionProperties, (VkPhysicalDevice, const char *, uint32_t *, VkExtensionProperties *));
+
+/* Device APIs */
+VK_FN(VkResult, vkCreateDevice, (VkPhysicalDevice, const VkDeviceCreateInfo *, const void *, VkDevice *));
+VK_FN(void, vkDestroyDevice, (VkDevice, const void *));
+VK_FN(void, vkGetDeviceQueue, (VkDevice, uint32_t, uint32_t, VkQueue *));
+VK_FN(VkResult, vkDeviceWaitIdle, (VkDevice));
+
+/* Memory and buffer APIs */
+VK_FN(VkResult, vkCreateBuffer, (VkDevice, const VkBufferCreateInfo *, const void *, VkBuffer *));
+VK_FN(void, vkDestroyBuffer, (VkDevice, VkBuffer, const void *));
+VK_FN(void, vkGetBufferMemoryRequirements, (VkDevice, VkBuffer, VkMemoryRequirements *));
+VK_FN(VkResult, vkAllocateMemory, (VkDevice, const VkMemoryAllocateInfo *, const void *, VkDeviceMemory *));
+VK_FN(void, vkFreeMemory, (VkDevice, VkDeviceMemory, const void *));
+VK_FN(VkResult, vkBindBufferMemory, (VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize));
+VK_FN(VkResult, vkMapMemory, (VkDevice, VkDeviceMemory, VkDeviceSize, VkDeviceSize, VkFlags, void **));
+VK_FN(void, vkUnmapMemory, (VkDevice, VkDeviceMemory));
+
+/* Shader and pipeline APIs */
+VK_FN(VkResult, vkCreateShaderModule, (VkDevice, const VkShaderModuleCreateInfo *, const void *, VkShaderModule *));
+VK_FN(void, vkDestroyShaderModule, (VkDevice, VkShaderModule, const void *));
+VK_FN(VkResult, vkCreateDescriptorSetLayout, (VkDevice, const VkDescriptorSetLayoutCreateInfo *, const void *, VkDescriptorSetLayout *));
+VK_FN(void, vkDestroyDescriptorSetLayout, (VkDevice, VkDescriptorSetLayout, const void *));
+VK_FN(VkResult, vkCreatePipelineLayout, (VkDevice, const VkPipelineLayoutCreateInfo *, const void *, VkPipelineLayout *));
+VK_FN(void, vkDestroyPipelineLayout, (VkDevice, VkPipelineLayout, const void *));
+VK_FN(VkResult, vkCreatePipelineCache, (VkDevice, const VkPipelineCacheCreateInfo *, const void *, VkPipelineCache *));
+VK_FN(void, vkDestroyPipelineCache, (VkDevice, VkPipelineCache, const void *));
+VK_FN(VkResult, vkCreateComputePipelines, (VkDevice, VkPipelineCache, uint32_t, const VkComputePipelineCreateInfo *, const void *, VkPipeline *));
+VK_FN(void, vkDestroyPipeline, (VkDevice, VkPipeline, const void *));
+
+/* Descriptor APIs */
+VK_FN(VkResult, vkCreateDescriptorPool, (VkDevice, const VkDescriptorPoolCreateInfo *, const void *, VkDescriptorPool *));
+VK_FN(void, vkDestroyDescriptorPool, (VkDevice, VkDescriptorPool, const void *));
+VK_FN(VkResult, vkResetDescriptorPool, (VkDevice, VkDescriptorPool, VkFlags));
+VK_FN(VkResult, vkAllocateDescriptorSets, (VkDevice, const VkDescriptorSetAllocateInfo *, VkDescriptorSet *));
+VK_FN(void, vkUpdateDescriptorSets, (VkDevice, uint32_t, const VkWriteDescriptorSet *, uint32_t, const void *));
+
+/* Command buffer APIs */
+VK_FN(VkResult, vkCreateCommandPool, (VkDevice, const VkCommandPoolCreateInfo *, const void *, VkCommandPool *));
+VK_FN(void, vkDestroyCommandPool, (VkDevice, VkCommandPool, const void *));
+VK_FN(VkResult, vkAllocateCommandBuffers, (VkDevice, const VkCommandBufferAllocateInfo *, VkCommandBuffer *));
+VK_FN(VkResult, vkBeginCommandBuffer, (VkCommandBuffer, const VkCommandBufferBeginInfo *));
+VK_FN(VkResult, vkEndCommandBuffer, (VkCommandBuffer));
+VK_FN(VkResult, vkResetCommandBuffer, (VkCommandBuffer, VkFlags));
+VK_FN(void, vkCmdBindPipeline, (VkCommandBuffer, VkPipelineBindPoint, VkPipeline));
+VK_FN(void, vkCmdBindDescriptorSets, (VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t, const VkDescriptorSet *, uint32_t, const uint32_t *));
+VK_FN(void, vkCmdPushConstants, (VkCommandBuffer, VkPipelineLayout, VkFlags, uint32_t, uint32_t, const void *));
+VK_FN(void, vkCmdDispatch, (VkCommandBuffer, uint32_t, uint32_t, uint32_t));
+VK_FN(void, vkCmdCopyBuffer, (VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy *));
+VK_FN(void, vkCmdPipelineBarrier, (VkCommandBuffer, VkFlags, VkFlags, VkFlags, uint32_t, const VkMemoryBarrier *, uint32_t, const void *, uint32_t, const void *));
+
+/* Queue and synchronization APIs */
+VK_FN(VkResult, vkQueueSubmit, (VkQueue, uint32_t, const VkSubmitInfo *, VkFence));
+VK_FN(VkResult, vkCreateFence, (VkDevice, const VkFenceCreateInfo *, const void *, VkFence *));
+VK_FN(void, vkDestroyFence, (VkDevice, VkFence, const void *));
+VK_FN(VkResult, vkGetFenceStatus, (VkDevice, VkFence));
+VK_FN(VkResult, vkWaitForFences, (VkDevice, uint32_t, const VkFence *, VkBool32, uint64_t));
+VK_FN(VkResult, vkResetFences, (VkDevice, uint32_t, const VkFence *));
+
+#undef VK_FN
@@ -0,0 +1,12 @@
+#include "HalideRuntime.h"
+#include "cpu_features.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK CpuFeatures halide_get_cpu_features() {
+    // A module using simd128 or threads fails to validate on an engine
+    // without them, so there is nothing to detect at runtime.
+    return CpuFeatures();
+}
+
+}}} // namespace Halide::Runtime::Internal
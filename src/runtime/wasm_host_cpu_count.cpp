@@ -0,0 +1,14 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+// Provided by Emscripten. In a browser this is
+// navigator.hardwareConcurrency.
+extern int emscripten_num_logical_cores();
+
+WEAK int halide_host_cpu_count() {
+    return emscripten_num_logical_cores();
+}
+
+}
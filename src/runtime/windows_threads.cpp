@@ -28,6 +28,7 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API uint32_t GetCurrentThreadId();
 
 } // extern "C"
 
@@ -58,6 +59,40 @@ WEAK int halide_host_cpu_count() {
     }
 }
 
+// No NUMA support. Treat the machine as a single node.
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_host_current_numa_node() {
+    return 0;
+}
+
+WEAK int halide_host_pin_thread_to_numa_node(int node) {
+    return 0;
+}
+
+// No transparent huge pages.
+WEAK int halide_host_advise_huge_pages(void *ptr, size_t size) {
+    return -1;
+}
+
+WEAK uint64_t halide_host_current_thread_id() {
+    return GetCurrentThreadId();
+}
+
+// No hardware performance counters.
+WEAK int halide_host_open_perf_counter(int counter) {
+    return -1;
+}
+
+WEAK int halide_host_read_perf_counter(int handle, uint64_t *value) {
+    return -1;
+}
+
+WEAK void halide_host_close_perf_counter(int handle) {
+}
+
 WEAK halide_thread *halide_spawn_thread(void(*f)(void *), void *closure) {
     spawned_thread *t = (spawned_thread *)malloc(sizeof(spawned_thread));
     t->f = f;
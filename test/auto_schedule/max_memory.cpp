@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    MachineParams params = MachineParams::generic();
+    params.max_memory = 8 * 1024 * 1024;
+    if (MachineParams(params.to_string()).max_memory != params.max_memory) {
+        printf("max_memory did not round-trip through %s\n", params.to_string().c_str());
+        return -1;
+    }
+
+    const int size = 2048;
+    Buffer<float> input(size, size);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)((x + 3 * y) % 17);
+        }
+    }
+
+    Var x("x"), y("y");
+    std::vector<Func> stages;
+    Func in("in");
+    in(x, y) = input(clamp(x, 0, size - 1), clamp(y, 0, size - 1));
+    stages.push_back(in);
+    for (int i = 0; i < 4; i++) {
+        Func f("f" + std::to_string(i));
+        Func prev = stages.back();
+        f(x, y) = (prev(x - 1, y) + prev(x + 1, y) + prev(x, y - 1) + prev(x, y + 1)) * 0.25f;
+        stages.push_back(f);
+    }
+    Func out = stages.back();
+
+    // Provide estimates on the pipeline output
+    out.estimate(x, 0, size).estimate(y, 0, size);
+
+    // Auto-schedule the pipeline with a memory limit well below the
+    // size of a single intermediate computed at root.
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+
+    p.auto_schedule(target, params);
+
+    // Inspect the schedule
+    out.print_loop_nest();
+
+    // Run the schedule
+    Buffer<float> result = p.realize(size, size);
+
+    // Check a few points against a reference that blurs only the
+    // neighbourhood of each point.
+    for (int y = 0; y < result.height(); y += 97) {
+        for (int x = 0; x < result.width(); x += 89) {
+            std::function<float(int, int, int)> ref = [&](int i, int x, int y) -> float {
+                if (i == 0) {
+                    return input(std::min(std::max(x, 0), size - 1), std::min(std::max(y, 0), size - 1));
+                }
+                return (ref(i - 1, x - 1, y) + ref(i - 1, x + 1, y) +
+                        ref(i - 1, x, y - 1) + ref(i - 1, x, y + 1)) * 0.25f;
+            };
+            float correct = ref(4, x, y);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
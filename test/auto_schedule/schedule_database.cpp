@@ -0,0 +1,141 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+#ifndef _WIN32
+// Auto-schedule and run a fixed blur pipeline with the schedule database
+// pointed at the given directory.
+int run_child(const char *db_dir, int estimate) {
+    setenv("HL_AUTOSCHEDULE_DB", db_dir, 1);
+
+    Buffer<uint16_t> input(256, 256);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (x * 17 + y * 31) & 0xfff;
+        }
+    }
+
+    Var x("x"), y("y");
+    Func in_b("in_b"), blur_x("blur_x"), blur_y("blur_y");
+    in_b(x, y) = input(clamp(x, 0, input.width() - 1), clamp(y, 0, input.height() - 1));
+    blur_x(x, y) = (in_b(x - 1, y) + in_b(x, y) + in_b(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+    blur_y.estimate(x, 0, estimate).estimate(y, 0, estimate);
+
+    Pipeline p(blur_y);
+    p.auto_schedule(get_jit_target_from_environment());
+
+    Buffer<uint16_t> out = p.realize(input.width(), input.height());
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            auto in = [&](int x, int y) {
+                return input(std::min(std::max(x, 0), input.width() - 1),
+                             std::min(std::max(y, 0), input.height() - 1));
+            };
+            auto bx = [&](int x, int y) {
+                return (uint16_t)((in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3);
+            };
+            uint16_t correct = (bx(x, y - 1) + bx(x, y) + bx(x, y + 1)) / 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+std::vector<std::string> database_entries(const std::string &dir) {
+    std::vector<std::string> result;
+    DIR *d = opendir(dir.c_str());
+    if (!d) return result;
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 6 && name.substr(name.size() - 6) == ".sched") {
+            result.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    return result;
+}
+
+bool file_contains(const std::string &path, const char *needle) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    char line[4096];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = strstr(line, needle) != nullptr;
+    }
+    fclose(f);
+    return found;
+}
+#endif
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+#else
+    if (argc == 4 && strcmp(argv[1], "child") == 0) {
+        return run_child(argv[2], atoi(argv[3]));
+    }
+
+    // The database is meant to be shared across processes, so run the
+    // pipeline in child processes that share a database directory.
+    std::string dir = Internal::dir_make_temp();
+    std::string log = dir + "/log.txt";
+    std::string child = std::string("\"") + argv[0] + "\" child \"" + dir + "\"";
+
+    // The first run should search and save the grouping it found.
+    if (system((child + " 256").c_str()) != 0) {
+        printf("First run failed\n");
+        return -1;
+    }
+    if (database_entries(dir).size() != 1) {
+        printf("Expected one schedule database entry after the first run\n");
+        return -1;
+    }
+
+    // A second run of the same pipeline should reuse the entry.
+    std::string second = "HL_DEBUG_CODEGEN=1 " + child + " 256 2> \"" + log + "\"";
+    if (system(second.c_str()) != 0) {
+        printf("Second run failed\n");
+        return -1;
+    }
+    if (!file_contains(log, "Reusing grouping from schedule database entry")) {
+        printf("Second run did not reuse the schedule database entry\n");
+        return -1;
+    }
+    if (database_entries(dir).size() != 1) {
+        printf("Reusing a schedule should not add database entries\n");
+        return -1;
+    }
+
+    // Different estimates are a different key.
+    if (system((child + " 4096").c_str()) != 0) {
+        printf("Run with different estimates failed\n");
+        return -1;
+    }
+    if (database_entries(dir).size() != 2) {
+        printf("Expected a new schedule database entry for different estimates\n");
+        return -1;
+    }
+
+    for (const std::string &e : database_entries(dir)) {
+        remove(e.c_str());
+    }
+    remove(log.c_str());
+    rmdir(dir.c_str());
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int W = 1000;
+    int H = 1000;
+    Buffer<uint16_t> input(W + 1, H);
+
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    Func f("f");
+    f(x, y) = input(x, y) * input(x, y);
+
+    // Three pointwise consumers of the same producer, with the same
+    // bounds. They should be computed in one loop nest, so that f
+    // (or the input) is only brought into cache once.
+    Func g1("g1"), g2("g2"), g3("g3");
+    g1(x, y) = f(x, y) + f(x + 1, y);
+    g2(x, y) = f(x, y) - f(x + 1, y);
+    g3(x, y) = f(x, y) ^ f(x + 1, y);
+
+    g1.estimate(x, 0, W).estimate(y, 0, H);
+    g2.estimate(x, 0, W).estimate(y, 0, H);
+    g3.estimate(x, 0, W).estimate(y, 0, H);
+
+    Pipeline p({g1, g2, g3});
+
+    Target target = get_jit_target_from_environment();
+    std::string schedule = p.auto_schedule(target);
+
+    // Inspect the schedule
+    g1.print_loop_nest();
+
+    if (schedule.find("compute_with") == std::string::npos) {
+        printf("Expected the siblings to be fused:\n%s\n", schedule.c_str());
+        return -1;
+    }
+
+    Buffer<uint16_t> out_1(W, H), out_2(W, H), out_3(W, H);
+    p.realize({out_1, out_2, out_3});
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint16_t a = input(x, y) * input(x, y);
+            uint16_t b = input(x + 1, y) * input(x + 1, y);
+            uint16_t c1 = a + b, c2 = a - b, c3 = a ^ b;
+            if (out_1(x, y) != c1 || out_2(x, y) != c2 || out_3(x, y) != c3) {
+                printf("out(%d, %d) = {%d, %d, %d} instead of {%d, %d, %d}\n",
+                       x, y, out_1(x, y), out_2(x, y), out_3(x, y), c1, c2, c3);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int size = 4096;
+    Buffer<float> input(size, size);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)((x * 7 + y * 13) % 97);
+        }
+    }
+
+    Var x("x"), y("y");
+    Func in("in"), blur_x("blur_x"), blur("blur");
+    in(x, y) = input(clamp(x, 0, size - 1), clamp(y, 0, size - 1));
+    blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    // Adjacent tiles of blur along x share columns of blur_x, so blur_x
+    // should be slid along the serial tile loop over x.
+    blur(x, y) = blur_x(x - 2, y) + blur_x(x + 2, y) + blur_x(x, y - 1) + blur_x(x, y + 1);
+
+    // Provide estimates on the pipeline output
+    blur.estimate(x, 0, size).estimate(y, 0, size);
+
+    // Auto-schedule the pipeline
+    Target target = get_jit_target_from_environment();
+    Pipeline p(blur);
+
+    std::string schedule = p.auto_schedule(target);
+
+    // Inspect the schedule
+    blur.print_loop_nest();
+
+    if (schedule.find(".store_at(") == std::string::npos) {
+        printf("Expected blur_x to be stored outside of the loop it is computed at:\n%s\n",
+               schedule.c_str());
+        return -1;
+    }
+
+    // Run the schedule
+    Buffer<float> out = p.realize(size, size);
+
+    auto in_ref = [&](int x, int y) {
+        return input(std::min(std::max(x, 0), size - 1), std::min(std::max(y, 0), size - 1));
+    };
+    auto blur_x_ref = [&](int x, int y) {
+        return in_ref(x - 1, y) + in_ref(x, y) + in_ref(x + 1, y);
+    };
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = blur_x_ref(x - 2, y) + blur_x_ref(x + 2, y) +
+                blur_x_ref(x, y - 1) + blur_x_ref(x, y + 1);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
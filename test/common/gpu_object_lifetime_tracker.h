@@ -21,7 +21,7 @@ class GpuObjectLifetimeTracker {
             is_global(is_global), total_created(0), live_count(0) {}
     };
 
-    std::array<ObjectType, 13> object_types = {{
+    std::array<ObjectType, 15> object_types = {{
         // OpenCL objects
         {"clCreateContext", "clReleaseContext", true},
         {"clCreateCommandQueue", "clReleaseCommandQueue", true},
@@ -41,6 +41,10 @@ class GpuObjectLifetimeTracker {
         {"Allocating: new_command_queue", "Releasing: new_command_queue"},
         {"Allocating: new_library_with_source", "Releasing: new_library_with_source"},
 
+        // Vulkan objects
+        {"vkCreateInstance", "vkDestroyInstance", true},
+        {"vkCreateDevice", "vkDestroyDevice", true},
+
         // Hexagon objects
         {"halide_remote_load_library", "halide_remote_release_library"},
         {"ion_alloc", "ion_free"},
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+// Count calls to Halide's malloc and free
+
+int mallocs = 0;
+int frees = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    frees++;
+    free(((void**)ptr)[-1]);
+}
+
+int run(const Target &t, Param<int> &offset) {
+    // A chain of heap-allocated intermediates, one of them with a
+    // size that is only known at runtime.
+    Func f[5];
+    Var x, y;
+    f[0](x, y) = x + y + offset;
+    for (int i = 1; i < 5; i++) {
+        f[i](x, y) = f[i-1](x, y) + f[i-1](x + i, y) * 2;
+    }
+    for (int i = 0; i < 4; i++) {
+        f[i].compute_root().store_in(MemoryType::Heap);
+    }
+    f[2].bound_extent(y, offset + 100);
+    f[4].set_custom_allocator(my_malloc, my_free);
+
+    mallocs = frees = 0;
+    Buffer<int> out = f[4].realize(200, 100, t);
+
+    // Check against a reference computed on the host.
+    Buffer<int> ref(210, 100);
+    ref.for_each_element([&](int x, int y) { ref(x, y) = x + y + offset.get(); });
+    for (int i = 1; i < 5; i++) {
+        Buffer<int> next(210 - i * (i + 1) / 2, 100);
+        next.for_each_element([&](int x, int y) { next(x, y) = ref(x, y) + ref(x + i, y) * 2; });
+        ref = next;
+    }
+    for (int y = 0; y < 100; y++) {
+        for (int x = 0; x < 200; x++) {
+            if (out(x, y) != ref(x, y)) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), ref(x, y));
+                exit(-1);
+            }
+        }
+    }
+
+    if (mallocs != frees) {
+        printf("%d calls to malloc, but %d to free\n", mallocs, frees);
+        exit(-1);
+    }
+    return mallocs;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not running on GPU targets\n");
+        return 0;
+    }
+
+    Param<int> offset;
+    offset.set(0);
+
+    int without_arena = run(t, offset);
+    int with_arena = run(t.with_feature(Target::AllocationArena), offset);
+
+    // One malloc per intermediate without the arena. With it, one
+    // for the arena's state and one for a chunk big enough for all
+    // of them.
+    if (without_arena != 4 || with_arena != 2) {
+        printf("Expected 4 mallocs without the arena and 2 with it. Got %d and %d\n",
+               without_arena, with_arena);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -416,6 +416,29 @@ int main(int argc, char **argv) {
             });
     }
 
+    // Tiles produced asynchronously with no explicit fold factor
+    // should be double-buffered automatically.
+    {
+        Func producer, consumer;
+        Var x, y, xo, xi;
+
+        producer(x, y) = x + y;
+        consumer(x, y) = expensive(producer(x, y) + producer(x + 1, y));
+        consumer.compute_root().split(x, xo, xi, 8);
+        producer.store_at(consumer, y).compute_at(consumer, xo).async();
+
+        Buffer<int> out = consumer.realize(64, 8);
+
+        out.for_each_element([&](int x, int y) {
+                int correct = 2*(x + y) + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    exit(-1);
+                }
+            });
+    }
+
     // Computing other stages at the outermost var of an async stage
     // should include it in the async block.
     {
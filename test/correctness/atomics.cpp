@@ -0,0 +1,109 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Buffer<uint8_t> in(200, 150);
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            in(x, y) = (uint8_t)(x * 17 + y * 31 + (x * y) % 7);
+        }
+    }
+
+    int correct_hist[256] = {0};
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            correct_hist[in(x, y)]++;
+        }
+    }
+
+    // A histogram, which becomes an atomic add.
+    {
+        Func hist("hist");
+        Var x("x");
+        RDom r(in);
+        hist(x) = 0;
+        hist(clamp(in(r.x, r.y), 0, 255)) += 1;
+        hist.update(0).atomic().parallel(r.y);
+
+        Buffer<int> result = hist.realize(256);
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != correct_hist[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), correct_hist[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A float histogram, which needs a compare-and-swap loop, unless
+    // there's an atomic float add. The weights are integers, so the
+    // result doesn't depend on the order of the adds.
+    {
+        Func hist("hist_f");
+        Var x("x");
+        RDom r(in);
+        hist(x) = 0.0f;
+        hist(clamp(in(r.x, r.y), 0, 255)) += 2.0f;
+        hist.update(0).atomic().parallel(r.y);
+
+        Buffer<float> result = hist.realize(256);
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != 2.0f * correct_hist[i]) {
+                printf("hist_f(%d) = %f instead of %f\n", i, result(i), 2.0f * correct_hist[i]);
+                return -1;
+            }
+        }
+    }
+
+    // The maximum of each residue class mod 16, over a narrow type.
+    {
+        Func m("m");
+        Var x("x");
+        RDom r(in);
+        m(x) = cast<uint8_t>(0);
+        Expr site = (r.x + r.y) % 16;
+        m(site) = max(m(site), in(r.x, r.y));
+        m.update(0).atomic().parallel(r.y);
+
+        Buffer<uint8_t> result = m.realize(16);
+        for (int i = 0; i < 16; i++) {
+            uint8_t correct = 0;
+            for (int y = 0; y < in.height(); y++) {
+                for (int x = 0; x < in.width(); x++) {
+                    if ((x + y) % 16 == i && in(x, y) > correct) {
+                        correct = in(x, y);
+                    }
+                }
+            }
+            if (result(i) != correct) {
+                printf("m(%d) = %d instead of %d\n", i, result(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A histogram on the GPU.
+    Target t = get_jit_target_from_environment();
+    if (t.has_feature(Target::CUDA) || t.has_feature(Target::OpenCL)) {
+        Func hist("hist_gpu");
+        Var x("x");
+        RDom r(in);
+        hist(x) = 0;
+        hist(clamp(in(r.x, r.y), 0, 255)) += 1;
+        hist.compute_root();
+        RVar ryo, ryi;
+        hist.update(0).atomic().split(r.y, ryo, ryi, 16).gpu_blocks(ryo).gpu_threads(ryi);
+
+        Buffer<int> result = hist.realize(256);
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != correct_hist[i]) {
+                printf("hist_gpu(%d) = %d instead of %d\n", i, result(i), correct_hist[i]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int prefetches = 0;
+
+class CountPrefetches : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::prefetch)) {
+            prefetches++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2);
+    Var x, y;
+
+    // A vertical stencil that streams along the rows of its input.
+    Func blur;
+    blur(x, y) = input(x, y) + 2 * input(x, y + 1) + input(x, y + 2);
+    blur.vectorize(x, 8);
+
+    blur.add_custom_lowering_pass(new CountPrefetches);
+    Target t = get_jit_target_from_environment().with_feature(Target::AutoPrefetch);
+    blur.compile_jit(t);
+
+    if (prefetches == 0) {
+        printf("Expected a prefetch of the rows of the input\n");
+        return -1;
+    }
+
+    const int w = 64, h = 32;
+    Buffer<int> in(w, h + 2);
+    in.for_each_element([&](int i, int j) { in(i, j) = i * 5 - j * 3; });
+    input.set(in);
+    Buffer<int> result = blur.realize(w, h, t);
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            int correct = in(i, j) + 2 * in(i, j + 1) + in(i, j + 2);
+            if (result(i, j) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
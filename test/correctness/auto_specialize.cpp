@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int fast_paths = 0;
+
+// Count the branches on the automatically chosen conditions.
+class CountFastPaths : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        if (expr_uses_var(op->condition, stride_name)) {
+            fast_paths++;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    std::string stride_name;
+};
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2);
+    Param<int> radius;
+    Var x, y;
+
+    // Allow inputs with any innermost stride, and hint at the usual
+    // radius of the blur.
+    input.dim(0).set_stride(Expr());
+    radius.set_specialization_hints({1, 2});
+
+    RDom r(-radius, 2 * radius + 1);
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func blur;
+    blur(x, y) = sum(clamped(x + r, y));
+    blur.vectorize(x, 8);
+
+    CountFastPaths *counter = new CountFastPaths;
+    counter->stride_name = input.name() + ".stride.0";
+    blur.add_custom_lowering_pass(counter);
+    Target t = get_jit_target_from_environment().with_feature(Target::AutoSpecialize);
+    blur.compile_jit(t);
+
+    if (fast_paths == 0) {
+        printf("Expected fast paths for a dense input\n");
+        return -1;
+    }
+
+    const int w = 37, h = 5;
+    // A dense input, and one with a stride of two.
+    Buffer<int> dense(w, h), strided(2, w, h);
+    dense.for_each_element([&](int i, int j) { dense(i, j) = i * 7 + j; });
+    strided.for_each_element([&](int c, int i, int j) { strided(c, i, j) = i * 7 + j; });
+    Buffer<int> sliced = strided.sliced(0, 0);
+
+    for (int rad = 0; rad < 4; rad++) {
+        for (Buffer<int> in : {dense, sliced}) {
+            input.set(in);
+            radius.set(rad);
+            Buffer<int> result = blur.realize(w, h, t);
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                    int correct = 0;
+                    for (int k = -rad; k <= rad; k++) {
+                        int xk = std::min(std::max(i + k, 0), w - 1);
+                        correct += xk * 7 + j;
+                    }
+                    if (result(i, j) != correct) {
+                        printf("radius %d, stride %d: result(%d, %d) = %d instead of %d\n",
+                               rad, in.dim(0).stride(), i, j, result(i, j), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
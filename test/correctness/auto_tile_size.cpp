@@ -0,0 +1,42 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+Func blur(bool tiled) {
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    Func input("input");
+    input(x, y) = (x * 3 + y * 5) % 11;
+
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+    if (tiled) {
+        blur_y.tile(x, y, xo, yo, xi, yi, AutoTileSize(0.05f));
+        blur_x.compute_at(blur_y, xo);
+    }
+    return blur_y;
+}
+
+int main(int argc, char **argv) {
+    const int w = 300, h = 200;
+
+    Buffer<int> correct = blur(false).realize(w, h);
+
+    Func tiled = blur(true);
+    tiled.print_redundant_work();
+    Buffer<int> result = tiled.realize(w, h);
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            if (result(i, j) != correct(i, j)) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct(i, j));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
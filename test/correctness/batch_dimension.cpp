@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::BatchDimension);
+
+    // A pipeline written for one image, with an intermediate and
+    // some parallelism of its own.
+    ImageParam in(Int(32), 2);
+    Param<int> offset;
+    Func blur, out;
+    Var x, y;
+    blur(x, y) = in(x, y) + in(x + 1, y);
+    out(x, y) = blur(x, y) * 2 + offset;
+    blur.compute_root();
+    out.parallel(y);
+    offset.set(3);
+
+    // Run it on a batch of five images along a third dimension.
+    const int batch = 5;
+    Buffer<int> input(17, 8, batch);
+    input.for_each_element([&](int x, int y, int b) { input(x, y, b) = x * 3 + y * 5 + b * 7; });
+    in.set(input);
+
+    Buffer<int> output(16, 8, batch);
+    out.realize(output, t);
+    for (int b = 0; b < batch; b++) {
+        for (int y = 0; y < 8; y++) {
+            for (int x = 0; x < 16; x++) {
+                int correct = (input(x, y, b) + input(x + 1, y, b)) * 2 + 3;
+                if (output(x, y, b) != correct) {
+                    printf("output(%d, %d, %d) = %d instead of %d\n",
+                           x, y, b, output(x, y, b), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A bounds query on the input asks for one image's worth of each
+    // image in the batch.
+    Buffer<int> query(nullptr, 1, 1, 1);
+    in.set(query);
+    out.realize(output, t);
+    if (query.dim(0).extent() != 17 || query.dim(1).extent() != 8 ||
+        query.dim(2).min() != 0 || query.dim(2).extent() != batch ||
+        query.dim(2).stride() != 17 * 8) {
+        printf("Bounds query returned [%d, %d] x [%d, %d] x [%d, %d] with outer stride %d\n",
+               query.dim(0).min(), query.dim(0).extent(),
+               query.dim(1).min(), query.dim(1).extent(),
+               query.dim(2).min(), query.dim(2).extent(), query.dim(2).stride());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    // Conversions on the host round to nearest, with ties going to even.
+    if (bfloat16_t(1.0f + 1.0f / 256).to_bits() != 0x3f80 ||
+        bfloat16_t(1.0f + 3.0f / 256).to_bits() != 0x3f82 ||
+        (float)bfloat16_t::make_from_bits(0x4049) != 3.140625f) {
+        printf("Incorrect bfloat16 rounding on the host\n");
+        return -1;
+    }
+
+    Buffer<float> in(256, 16);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = (x - 128) * 1.37f + y * 0.01f;
+    });
+
+    {
+        // Convert to bfloat16 and back, vectorized.
+        Func to_bf, from_bf;
+        to_bf(x, y) = cast<bfloat16_t>(in(x, y));
+        from_bf(x, y) = cast<float>(to_bf(x, y)) * 2;
+        to_bf.compute_root().vectorize(x, 16);
+        from_bf.vectorize(x, 8);
+
+        Buffer<bfloat16_t> bf = to_bf.realize(256, 16);
+        Buffer<float> out = from_bf.realize(256, 16);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                bfloat16_t correct = bfloat16_t(in(x, y));
+                if (bf(x, y).to_bits() != correct.to_bits() ||
+                    out(x, y) != (float)correct * 2) {
+                    printf("bf(%d, %d) = %f and out(%d, %d) = %f instead of %f\n",
+                           x, y, (float)bf(x, y), x, y, out(x, y), (float)correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A dot product of bfloat16 inputs with float32 accumulation,
+        // and arithmetic that rounds each result to bfloat16.
+        Buffer<bfloat16_t> a(256, 16), b(256, 16);
+        a.for_each_element([&](int x, int y) { a(x, y) = bfloat16_t(in(x, y)); });
+        b.for_each_element([&](int x, int y) { b(x, y) = bfloat16_t(in(255 - x, y) * 0.5f); });
+
+        RDom r(0, 256);
+        Func dot, prod;
+        dot(y) = 0.0f;
+        dot(y) += cast<float>(a(r, y)) * cast<float>(b(r, y));
+        prod(x, y) = max(a(x, y) * b(x, y) + bfloat16_t(1.0f), bfloat16_t(0.0f));
+        prod.vectorize(x, 16);
+
+        Buffer<float> d = dot.realize(16);
+        Buffer<bfloat16_t> p = prod.realize(256, 16);
+        for (int y = 0; y < 16; y++) {
+            float correct = 0.0f;
+            for (int x = 0; x < 256; x++) {
+                correct += (float)a(x, y) * (float)b(x, y);
+
+                bfloat16_t ab = bfloat16_t((float)a(x, y) * (float)b(x, y));
+                float c = std::max((float)bfloat16_t((float)ab + 1.0f), 0.0f);
+                if ((float)p(x, y) != c) {
+                    printf("p(%d, %d) = %f instead of %f\n", x, y, (float)p(x, y), c);
+                    return -1;
+                }
+            }
+            if (d(y) != correct) {
+                printf("d(%d) = %f instead of %f\n", y, d(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
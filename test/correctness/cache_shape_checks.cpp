@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    printf("%s\n", msg);
+    error_occurred = true;
+}
+
+// Realize f over [0, 16) and return whether that failed.
+bool run(Func f, const Target &t) {
+    error_occurred = false;
+    Buffer<int> out(16);
+    f.realize(out, t);
+    return error_occurred;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::CacheShapeChecks);
+
+    ImageParam input(Int(32), 1, "input");
+    Param<int> offset("offset");
+    offset.set_range(0, 8);
+    Func f("f");
+    Var x("x");
+    f(x) = input(x + offset) * 2;
+    f.set_error_handler(my_error_handler);
+
+    Buffer<int> small(16), large(32);
+    small.fill(1);
+    large.fill(2);
+
+    struct Case {
+        const char *description;
+        Buffer<int> in;
+        int offset;
+        bool should_fail;
+    } cases[] = {
+        {"a valid call", large, 4, false},
+        // The same shapes again, which should skip the checks.
+        {"a repeated valid call", large, 4, false},
+        // The shape of the input changes, so that it's too small.
+        {"an input that is too small", small, 4, true},
+        {"a valid call with a smaller input", small, 0, false},
+        // Only the parameter changes, making the input too small.
+        {"an offset that is too large for the input", small, 4, true},
+        // The parameter is outside its declared range.
+        {"an offset out of range", large, 9, true},
+        {"a valid call after errors", large, 8, false},
+        {"a repeated valid call after errors", large, 8, false},
+    };
+
+    for (const Case &c : cases) {
+        input.set(c.in);
+        offset.set(c.offset);
+        bool failed = run(f, t);
+        if (failed != c.should_fail) {
+            printf("Error %s for %s\n", failed ? "incorrectly raised" : "not raised", c.description);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
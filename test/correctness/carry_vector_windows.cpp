@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int slices = 0;
+
+class CountSlices : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Shuffle *op) override {
+        if (op->is_slice() && op->vectors.size() == 1 &&
+            op->vectors[0].type().lanes() == 2 * op->type.lanes()) {
+            slices++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    ImageParam input(Int(16), 2);
+    Var x, y;
+
+    // A horizontal stencil computed inline, which loads overlapping
+    // vectors of each row.
+    Func blur;
+    blur(x, y) = input(x - 1, y) + 2 * input(x, y) + input(x + 1, y) + input(x + 9, y);
+    blur.vectorize(x, 8);
+
+    blur.add_custom_lowering_pass(new CountSlices);
+    blur.compile_jit(t);
+
+    if ((t.arch == Target::X86 || t.arch == Target::ARM) && slices == 0) {
+        printf("Expected the window of loads to be rewritten as slices of carried vectors\n");
+        return -1;
+    }
+
+    const int w = 123, h = 7;
+    Buffer<int16_t> in(w + 10, h);
+    in.set_min(-1, 0);
+    in.for_each_element([&](int i, int j) { in(i, j) = (int16_t)(i * 13 - j * 7); });
+    input.set(in);
+    Buffer<int16_t> result = blur.realize(w, h, t);
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            int16_t correct = in(i - 1, j) + 2 * in(i, j) + in(i + 1, j) + in(i + 9, j);
+            if (result(i, j) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Buffer<int> input(37, 23);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x * 3 + y * 5;
+    });
+
+    // A blur with a boundary condition, which partitioning would peel
+    // at both loop levels, with an unrolled and vectorized consumer.
+    // Run it without a budget, with a budget so small that nothing
+    // can be unrolled or partitioned, and with one in between.
+    for (int budget : {0, 1, 200}) {
+        Var x, y, xi, yi;
+        Func clamped = BoundaryConditions::repeat_edge(input);
+        Func blur_x, blur_y;
+        blur_x(x, y) = clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y);
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+        blur_y.tile(x, y, xi, yi, 8, 4).vectorize(xi, 4).unroll(xi).unroll(yi);
+        blur_x.compute_at(blur_y, x).vectorize(x, 4).unroll(x);
+        if (budget > 0) {
+            blur_x.code_size_budget(budget);
+            blur_y.code_size_budget(budget);
+        }
+
+        Buffer<int> out = blur_y.realize(64, 48);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int cx = std::min(std::max(x + dx, 0), input.width() - 1);
+                        int cy = std::min(std::max(y + dy, 0), input.height() - 1);
+                        correct += input(cx, cy);
+                    }
+                }
+                if (out(x, y) != correct) {
+                    printf("With a budget of %d: out(%d, %d) = %d instead of %d\n",
+                           budget, x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
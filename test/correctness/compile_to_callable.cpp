@@ -0,0 +1,62 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(UInt(8), 2);
+    Param<int> offset;
+    Param<float> gain;
+    Var x, y;
+    Func f;
+    f(x, y) = cast<int>(in(x, y) * gain) + offset;
+
+    Callable c = f.compile_to_callable({in, offset, gain});
+
+    Buffer<uint8_t> input(64, 48);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint8_t)(x + y * 3);
+    });
+
+    // Call it repeatedly with different arguments, including
+    // Runtime::Buffers and raw halide_buffer_t pointers.
+    for (int i = 0; i < 10; i++) {
+        Buffer<int> out(64, 48);
+        int result;
+        if (i % 3 == 0) {
+            result = c(input, i, 2.0f, out);
+        } else if (i % 3 == 1) {
+            Runtime::Buffer<uint8_t> runtime_input = *input.get();
+            result = c(runtime_input, i, 2.0f, out);
+        } else {
+            result = c(input.raw_buffer(), i, 2.0f, out.raw_buffer());
+        }
+        if (result != 0) {
+            printf("Callable returned %d\n", result);
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (int)(input(x, y) * 2.0f) + i;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Errors go to the Pipeline's error handler.
+    static bool error_occurred = false;
+    f.set_error_handler([](void *, const char *msg) { error_occurred = true; });
+    Callable c2 = f.compile_to_callable({in, offset, gain});
+    Buffer<int> too_big(100, 48);
+    int result = c2(input, 0, 1.0f, too_big);
+    if (result == 0 || !error_occurred) {
+        printf("Expected an out-of-bounds error\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -27,6 +27,30 @@ void testCompileToOutput(Func j) {
     Internal::assert_file_exists(expected_h);
 }
 
+void testMultiversionLoops(Func j) {
+    // Only the vectorized loop nests are duplicated for the first
+    // target, inside a single copy of the pipeline.
+    std::string fn_object = Internal::get_test_tmp_dir() + "compile_to_multitarget_multiversion";
+#ifdef _MSC_VER
+    std::string expected_lib = fn_object + ".lib";
+#else
+    std::string expected_lib = fn_object + ".a";
+#endif
+    std::string expected_h = fn_object + ".h";
+
+    Internal::ensure_no_file_exists(expected_lib);
+    Internal::ensure_no_file_exists(expected_h);
+
+    std::vector<Target> targets = {
+        Target("host-multiversion_loops-debug"),
+        Target("host-multiversion_loops"),
+    };
+    j.compile_to_multitarget_static_library(fn_object, j.infer_arguments(), targets);
+
+    Internal::assert_file_exists(expected_lib);
+    Internal::assert_file_exists(expected_h);
+}
+
 int main(int argc, char **argv) {
     Param<float> factor("factor");
     Func f, g, h, j;
@@ -39,8 +63,10 @@ int main(int argc, char **argv) {
     f.compute_root();
     g.compute_root();
     h.compute_root();
+    j.vectorize(x, 8);
 
     testCompileToOutput(j);
+    testMultiversionLoops(j);
 
     printf("Success!\n");
     return 0;
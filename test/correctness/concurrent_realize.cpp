@@ -0,0 +1,55 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Test that many threads can realize one shared Pipeline
+    // concurrently, binding their own Param values per call. Like
+    // thread_safety, this is intended to be run in a thread-sanitizer.
+    constexpr int num_threads = 8;
+    constexpr int iters = 64;
+
+    Param<int> offset;
+    ImageParam in(Int(32), 1);
+    Var x;
+    Func f;
+    f(x) = in(x) * 2 + offset;
+    f.vectorize(x, 8);
+
+    // Don't compile it ahead of time: the first calls race to
+    // compile it.
+    Pipeline p(f);
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]{
+            Buffer<int> input(64);
+            input.for_each_element([&](int x) { input(x) = x + t; });
+            for (int i = 0; i < iters; i++) {
+                Buffer<int> out(64);
+                p.realize(out, Target(), {{offset, t * 1000 + i}, {in, input}});
+                for (int x = 0; x < 64; x++) {
+                    if (out(x) != (x + t) * 2 + t * 1000 + i) {
+                        failures++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (failures) {
+        printf("%d incorrect values\n", (int)failures);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <math.h>
+
+using namespace Halide;
+
+// A scalar reference implementation of Philox4x32-10.
+void philox_reference(uint32_t c[4], const uint32_t key[2]) {
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < 10; r++) {
+        uint64_t p0 = (uint64_t)c[0] * 0xD2511F53u;
+        uint64_t p1 = (uint64_t)c[2] * 0xCD9E8D57u;
+        uint32_t next[4] = {(uint32_t)(p1 >> 32) ^ c[1] ^ k0, (uint32_t)p1,
+                            (uint32_t)(p0 >> 32) ^ c[3] ^ k1, (uint32_t)p0};
+        for (int i = 0; i < 4; i++) {
+            c[i] = next[i];
+        }
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+int check_philox() {
+    // The known answers from the Random123 distribution, followed by
+    // some random counters and keys.
+    const int known = 3, n = 1000;
+    const uint32_t known_answers[known][10] = {
+        {0, 0, 0, 0, 0, 0,
+         0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+         0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+        {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+         0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+    Buffer<uint32_t> in(6, n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 6; j++) {
+            in(j, i) = i < known ? known_answers[i][j] : (uint32_t)rand() * 65537u + (uint32_t)rand();
+        }
+    }
+
+    Var x("x");
+    Func f("philox");
+    std::vector<Expr> words = RandomNumbers::philox4x32({in(0, x), in(1, x), in(2, x), in(3, x)},
+                                                        {in(4, x), in(5, x)});
+    f(x) = Tuple(words);
+    f.vectorize(x, 8);
+    Realization r = f.realize(n);
+
+    for (int i = 0; i < n; i++) {
+        uint32_t c[4] = {in(0, i), in(1, i), in(2, i), in(3, i)};
+        uint32_t key[2] = {in(4, i), in(5, i)};
+        philox_reference(c, key);
+        for (int j = 0; j < 4; j++) {
+            uint32_t correct = i < known ? known_answers[i][6 + j] : c[j];
+            uint32_t actual = Buffer<uint32_t>(r[j])(i);
+            if (actual != correct) {
+                printf("Word %d of philox(%d) = %08x instead of %08x\n", j, i, actual, correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+template<typename T>
+void moments(Buffer<T> b, double *mean, double *variance) {
+    double sum = 0, sum_sq = 0;
+    b.for_each_value([&](T v) {
+        sum += v;
+        sum_sq += (double)v * v;
+    });
+    double count = (double)b.number_of_elements();
+    *mean = sum / count;
+    *variance = sum_sq / count - *mean * *mean;
+}
+
+int check_distributions() {
+    const int size = 512;
+    Var x("x"), y("y");
+    double mean, variance;
+
+    Func u = RandomNumbers::uniform(2, 17);
+    u.vectorize(u.args()[0], 8);
+    Buffer<float> uniform = u.realize(size, size);
+    moments(uniform, &mean, &variance);
+    float lo = 1, hi = 0;
+    uniform.for_each_value([&](float v) {
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    });
+    if (fabs(mean - 0.5) > 0.01 || fabs(variance - 1.0 / 12) > 0.01 || lo < 0 || hi >= 1) {
+        printf("Uniform samples have mean %f, variance %f and range [%f, %f]\n", mean, variance, lo, hi);
+        return -1;
+    }
+
+    // The sequence depends only on the coordinates, the seed and the
+    // stream, so another schedule gives the same numbers, and another
+    // stream gives different ones.
+    Func u2 = RandomNumbers::uniform(2, 17);
+    u2.parallel(u2.args()[1]);
+    Buffer<float> uniform2 = u2.realize(size, size);
+    Buffer<float> other_stream = RandomNumbers::uniform(2, 17, 1).realize(size, size);
+    int same = 0;
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            if (uniform(i, j) != uniform2(i, j)) {
+                printf("Uniform samples at (%d, %d) depend on the schedule\n", i, j);
+                return -1;
+            }
+            same += uniform(i, j) == other_stream(i, j);
+        }
+    }
+    if (same > 10) {
+        printf("%d samples were the same in two streams\n", same);
+        return -1;
+    }
+
+    Func n = RandomNumbers::normal(2, 3, 2.0f, 3.0f);
+    n.vectorize(n.args()[0], 8);
+    Buffer<float> normal = n.realize(size, size);
+    moments(normal, &mean, &variance);
+    if (fabs(mean - 2.0) > 0.05 || fabs(variance - 9.0) > 0.2) {
+        printf("Normal samples have mean %f and variance %f instead of 2 and 9\n", mean, variance);
+        return -1;
+    }
+
+    for (float l : {0.5f, 3.0f, 50.0f}) {
+        Func lambda("lambda");
+        lambda(x, y) = l;
+        Func p = RandomNumbers::poisson(lambda, 5);
+        p.vectorize(x, 8);
+        Buffer<int> poisson = p.realize(size, size);
+        moments(poisson, &mean, &variance);
+        if (fabs(mean - l) > 0.02 * l + 0.01 || fabs(variance - l) > 0.05 * l + 0.02) {
+            printf("Poisson samples with lambda %f have mean %f and variance %f\n", l, mean, variance);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (check_philox() != 0 || check_distributions() != 0) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountCopies : public IRMutator2 {
+    class Count : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const Call *op) override {
+            if (op->is_intrinsic(Call::copy_memory)) {
+                copies++;
+            } else if (op->is_intrinsic(Call::fill_memory)) {
+                fills++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int copies = 0, fills = 0;
+    };
+
+    bool copies, fills;
+
+public:
+    CountCopies(bool copies, bool fills) : copies(copies), fills(fills) {}
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        Count c;
+        s.accept(&c);
+        if ((c.copies > 0) != copies || (c.fills > 0) != fills) {
+            printf("There were %d copies and %d fills. Expected %s copies and %s fills\n",
+                   c.copies, c.fills, copies ? "some" : "no", fills ? "some" : "no");
+            exit(-1);
+        }
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    Buffer<uint16_t> input(1000, 100);
+    input.for_each_element([&](int x, int y) { input(x, y) = x * 3 + y * 7; });
+
+    {
+        // A copy of each row of a crop.
+        Func f;
+        f(x, y) = input(x + 5, y + 3);
+        f.add_custom_lowering_pass(new CountCopies(true, false));
+
+        Buffer<uint16_t> out = f.realize(900, 90);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != input(x + 5, y + 3)) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), input(x + 5, y + 3));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A zero-initialized accumulator, and a wrapper of the input
+        // that is copied a row per parallel task.
+        Func wrapper;
+        wrapper(x, y) = input(x, y);
+        Func g;
+        RDom r(0, 10);
+        g(x, y) = 0.0f;
+        g(x, y) += wrapper(x + r, y);
+        wrapper.compute_root().vectorize(x, 8, TailStrategy::RoundUp).parallel(y);
+        g.add_custom_lowering_pass(new CountCopies(true, true));
+
+        Buffer<float> out = g.realize(900, 90);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = 0.0f;
+                for (int i = 0; i < 10; i++) {
+                    correct += input(x + i, y);
+                }
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // Fills with a value whose bytes differ, copies with a
+        // stride, and short copies are left as loops.
+        Func fill, strided, short_copy;
+        fill(x, y) = cast<uint16_t>(0x1234);
+        strided(x, y) = input(2 * x, y);
+        short_copy(x, y) = input(x, y);
+        short_copy.bound(x, 0, 16);
+
+        fill.add_custom_lowering_pass(new CountCopies(false, false));
+        strided.add_custom_lowering_pass(new CountCopies(false, false));
+        short_copy.add_custom_lowering_pass(new CountCopies(false, false));
+
+        Buffer<uint16_t> a = fill.realize(100, 10);
+        Buffer<uint16_t> b = strided.realize(100, 10);
+        Buffer<uint16_t> c = short_copy.realize(16, 10);
+        for (int y = 0; y < 10; y++) {
+            for (int x = 0; x < 16; x++) {
+                if (a(x, y) != 0x1234 || b(x, y) != input(2 * x, y) || c(x, y) != input(x, y)) {
+                    printf("Incorrect result at %d, %d\n", x, y);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int versions = 0;
+
+class CountVersions : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        if (expr_uses_var(op->condition, "input.stride.0")) {
+            versions++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    const int w = 64, h = 16;
+
+    // An input whose innermost stride is allowed to be anything.
+    ImageParam input(Int(32), 2, "input");
+    input.dim(0).set_stride(Expr());
+
+    Var x, y;
+    Func f;
+    f(x, y) = input(x, y) * 2 + 1;
+    f.vectorize(x, 8);
+
+    f.add_custom_lowering_pass(new CountVersions);
+    f.compile_jit();
+
+    if (versions != 1) {
+        printf("Expected the pipeline to be versioned on the stride of input. Got %d versions\n",
+               versions);
+        return -1;
+    }
+
+    // A dense buffer, and one with a stride of two in dimension 0.
+    Buffer<int> dense(w, h);
+    Buffer<int> interleaved(2, w, h);
+    interleaved.fill(-1);
+    Buffer<int> strided = interleaved.sliced(0, 0);
+    for (int yi = 0; yi < h; yi++) {
+        for (int xi = 0; xi < w; xi++) {
+            dense(xi, yi) = xi + yi * w;
+            strided(xi, yi) = xi * 3 - yi;
+        }
+    }
+
+    for (Buffer<int> in : {dense, strided}) {
+        input.set(in);
+        Buffer<int> result = f.realize(w, h);
+        for (int yi = 0; yi < h; yi++) {
+            for (int xi = 0; xi < w; xi++) {
+                int correct = in(xi, yi) * 2 + 1;
+                if (result(xi, yi) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n",
+                           xi, yi, result(xi, yi), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
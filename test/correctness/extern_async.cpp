@@ -0,0 +1,120 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> calls;
+
+// Imagine this hands the work to a hardware codec. It fills in the
+// output on another thread, and releases the semaphore when it's done.
+extern "C" DLLEXPORT int fill_async(halide_semaphore_t *done, halide_buffer_t *out) {
+    if (out->is_bounds_query()) {
+        return 0;
+    }
+    if (!done) {
+        printf("Null semaphore passed to an asynchronous call\n");
+        return -1;
+    }
+    calls++;
+    std::thread worker([=]() {
+        Halide::Runtime::Buffer<int> buf(*out);
+        buf.for_each_element([&](int x, int y) { buf(x, y) = x * 3 + y; });
+        halide_semaphore_release(done, 1);
+    });
+    worker.detach();
+    return 0;
+}
+
+extern "C" DLLEXPORT int fail_async(halide_semaphore_t *done, halide_buffer_t *out) {
+    if (out->is_bounds_query()) {
+        return 0;
+    }
+    return 42;
+}
+
+bool error_occurred = false;
+void my_error_handler(void *, const char *msg) {
+    error_occurred = true;
+}
+
+int check(const Buffer<int> &result) {
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = (x * 3 + y) * 2 + 1;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x, y, xo, yo, xi, yi;
+
+    for (int schedule = 0; schedule < 3; schedule++) {
+        Func source;
+        source.define_extern("fill_async",
+                             {ExternFuncArgument::completion_semaphore()},
+                             Int(32), 2);
+
+        Func consumer;
+        consumer(x, y) = source(x, y) * 2 + 1;
+
+        if (schedule == 0) {
+            // Compute the whole thing up front.
+            source.compute_root();
+        } else if (schedule == 1) {
+            // Call the extern stage per tile.
+            consumer.tile(x, y, xo, yo, xi, yi, 16, 16).parallel(yo);
+            source.compute_at(consumer, xo);
+        } else {
+            // Overlap the extern stage with the consumer.
+            consumer.split(y, yo, yi, 8);
+            source.compute_at(consumer, yo).store_root().async();
+        }
+
+        calls = 0;
+        Buffer<int> result = consumer.realize(64, 64);
+        if (check(result) != 0) {
+            printf("Failure for schedule %d\n", schedule);
+            return -1;
+        }
+        int expected = schedule == 0 ? 1 : schedule == 1 ? 16 : 8;
+        if (calls != expected) {
+            printf("fill_async called %d times instead of %d for schedule %d\n",
+                   (int)calls, expected, schedule);
+            return -1;
+        }
+    }
+
+    // Errors returned from the call are reported without waiting on
+    // the semaphore.
+    {
+        Func source;
+        source.define_extern("fail_async",
+                             {ExternFuncArgument::completion_semaphore()},
+                             Int(32), 2);
+        Func consumer;
+        consumer(x, y) = source(x, y);
+        source.compute_root();
+        consumer.set_error_handler(my_error_handler);
+        consumer.realize(16, 16);
+        if (!error_occurred) {
+            printf("There should have been an error\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+
+using namespace Halide;
+
+// The error of actual in units in the last place of the correct
+// answer, as a float.
+double ulp_error(float actual, double correct) {
+    if (std::isinf(correct)) {
+        return actual == (float)correct ? 0 : INFINITY;
+    }
+    int exponent;
+    std::frexp(std::abs(correct), &exponent);
+    double ulp = std::max(std::ldexp(1.0, exponent - 24), std::ldexp(1.0, -149));
+    return std::abs(actual - correct) / ulp;
+}
+
+bool test(const char *name, std::function<Expr(Expr)> approx, double (*correct)(double),
+          float min, float max, int max_ulp_error) {
+    const int size = 100000;
+    Buffer<float> in(size);
+    for (int i = 0; i < size; i++) {
+        in(i) = (float)(min + (max - min) * (double)i / (size - 1));
+    }
+
+    Func f;
+    Var x;
+    f(x) = approx(in(x));
+    f.vectorize(x, 8);
+    Buffer<float> out = f.realize(size);
+
+    double worst = 0;
+    int worst_i = 0;
+    for (int i = 0; i < size; i++) {
+        double err = ulp_error(out(i), correct(in(i)));
+        if (!(err <= worst)) {
+            worst = err;
+            worst_i = i;
+        }
+    }
+    if (!(worst <= max_ulp_error)) {
+        printf("%s(%.9g) = %.9g instead of %.9g (%f ulp, more than %d)\n",
+               name, in(worst_i), out(worst_i), correct(in(worst_i)), worst, max_ulp_error);
+        return false;
+    }
+    return true;
+}
+
+double ref_sin(double x) { return std::sin(x); }
+double ref_cos(double x) { return std::cos(x); }
+double ref_tanh(double x) { return std::tanh(x); }
+double ref_exp(double x) { return std::exp(x); }
+double ref_log(double x) { return std::log(x); }
+
+int main(int argc, char **argv) {
+    // Each function at each of the precisions it provides, checked
+    // against the error it promises.
+    for (int ulp : {4, 30}) {
+        if (!test("fast_sin", [=](Expr x) { return fast_sin(x, ulp); }, ref_sin, -100.0f, 100.0f, ulp) ||
+            !test("fast_cos", [=](Expr x) { return fast_cos(x, ulp); }, ref_cos, -100.0f, 100.0f, ulp)) {
+            return -1;
+        }
+    }
+    for (int ulp : {3, 10, 55}) {
+        if (!test("fast_tanh", [=](Expr x) { return fast_tanh(x, ulp); }, ref_tanh, -10.0f, 10.0f, ulp)) {
+            return -1;
+        }
+    }
+    for (int ulp : {3, 85}) {
+        if (!test("fast_exp", [=](Expr x) { return fast_exp(x, ulp); }, ref_exp, -80.0f, 80.0f, ulp)) {
+            return -1;
+        }
+    }
+    for (int ulp : {4, 35}) {
+        if (!test("fast_log", [=](Expr x) { return fast_log(x, ulp); }, ref_log, 0.001f, 1000.0f, ulp)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountSharedMemory : public IRVisitor {
+public:
+    int barriers = 0, shared_allocations = 0;
+
+protected:
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::gpu_thread_barrier)) {
+            barriers++;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        if (op->name == "__shared") {
+            shared_allocations++;
+        }
+        IRVisitor::visit(op);
+    }
+};
+
+class CheckSharedMemory : public IRMutator2 {
+    bool expect_shared;
+public:
+    CheckSharedMemory(bool expect_shared) : expect_shared(expect_shared) {}
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountSharedMemory c;
+        s.accept(&c);
+
+        bool uses_shared = c.barriers > 0 || c.shared_allocations > 0;
+        if (uses_shared != expect_shared) {
+            printf("There were %d barriers and %d shared allocations. Expected %s\n",
+                   c.barriers, c.shared_allocations, expect_shared ? "some" : "none");
+            exit(-1);
+        }
+
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    if (!get_jit_target_from_environment().has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    Var x, y, xo, yo, xi, yi;
+
+    {
+        // A chain of pointwise stages with the same thread mapping
+        // should become a single thread loop, with the intermediates
+        // kept in registers.
+        Func f, g, h;
+        f(x, y) = x + 2 * y;
+        g(x, y) = f(x, y) * 3 + 1;
+        h(x, y) = g(x, y) - f(x, y);
+
+        h.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        f.compute_at(h, xo).gpu_threads(x, y);
+        g.compute_at(h, xo).gpu_threads(x, y);
+
+        h.add_custom_lowering_pass(new CheckSharedMemory(false));
+
+        Buffer<int> out = h.realize(64, 64);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (x + 2 * y) * 2 + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A stencil reads values other threads computed, so it must
+        // still go through shared memory.
+        Func f, g;
+        f(x, y) = x + 2 * y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+
+        g.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        f.compute_at(g, xo).gpu_threads(x, y);
+
+        g.add_custom_lowering_pass(new CheckSharedMemory(true));
+
+        Buffer<int> out = g.realize(64, 64);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = 2 * x + 1 + 4 * y;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
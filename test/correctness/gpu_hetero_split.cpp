@@ -0,0 +1,83 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &out, int offset) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = x + y * 3 + offset;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t(get_jit_target_from_environment());
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    Var x, y, xi, yi;
+
+    {
+        // Split an output's GPU block loop with a fixed fraction.
+        Func f;
+        f(x, y) = x + y * 3;
+        f.gpu_tile(x, y, xi, yi, 8, 8).hetero_split(y, 0.6f);
+
+        Buffer<int> out(100, 100);
+        f.realize(out);
+
+        // The device's region was copied back, and the host's region
+        // was computed in place, so the host has all of it.
+        assert(out.host_dirty() && !out.device_dirty());
+
+        if (check(out, 0)) {
+            return -1;
+        }
+    }
+
+    {
+        // Split an internal Func with a fraction given by a Param,
+        // including giving (nearly) everything to one side or the
+        // other.
+        Param<float> fraction;
+        Func f, g;
+        f(x, y) = x + y * 3;
+        g(x, y) = f(x, y) + 1;
+        f.compute_root().gpu_tile(x, y, xi, yi, 16, 4).hetero_split(y, fraction);
+
+        for (float v : {0.0f, 0.25f, 0.9f, 1.0f}) {
+            fraction.set(v);
+            Buffer<int> out = g.realize(64, 37);
+            if (check(out, 1)) {
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Split a serial loop outside the GPU loops, and let the
+        // runtime pick the fraction over several runs.
+        Var yo;
+        Func f;
+        f(x, y) = x + y * 3;
+        f.split(y, yo, y, 16).gpu_tile(x, y, xi, yi, 8, 8).hetero_split(yo);
+
+        for (int i = 0; i < 5; i++) {
+            Buffer<int> out = f.realize(80, 160);
+            if (check(out, 0)) {
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <algorithm>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    if (!t.features_any_of({Target::CUDACapability50,
+                            Target::CUDACapability61,
+                            Target::CUDACapability70})) {
+        printf("This test requires cuda enabled with cuda capability 5.0 or greater\n");
+        return 0;
+    }
+
+    const int W = 1000, H = 17;
+    Buffer<int> input(W, H);
+    input.for_each_value([](int &v) { v = (rand() & 0xff) - 128; });
+
+    Var y, u, w, l;
+
+    {
+        // Sum each row with one warp per row. Each lane sums a
+        // strided slice of the row, then the lanes combine their
+        // partial sums with warp shuffles.
+        RDom r(0, W);
+        Func out;
+        out(y) = 0;
+        out(y) += input(r, y);
+
+        RVar ro, ri;
+        out.update().split(r, ro, ri, 32);
+        Func intm = out.update().rfactor(ri, u);
+        out.compute_root().gpu_blocks(y);
+        out.update().gpu_blocks(y).gpu_lanes(ri);
+        intm.compute_at(out, y).gpu_lanes(u);
+        intm.update().gpu_lanes(u);
+
+        Buffer<int> result = out.realize(H);
+        for (int y = 0; y < H; y++) {
+            int correct = 0;
+            for (int x = 0; x < W; x++) {
+                correct += input(x, y);
+            }
+            if (result(y) != correct) {
+                printf("sum(%d) = %d instead of %d\n", y, result(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A max over a narrow type, across a number of lanes that is
+        // not a power of two.
+        Buffer<uint8_t> narrow(20, H);
+        narrow.for_each_value([](uint8_t &v) { v = rand() & 0xff; });
+
+        RDom r(0, 20);
+        Func out;
+        out(y) = cast<uint8_t>(0);
+        out(y) = max(out(y), narrow(r, y));
+        out.compute_root().gpu_blocks(y);
+        out.update().gpu_blocks(y).gpu_lanes(r);
+
+        Buffer<uint8_t> result = out.realize(H);
+        for (int y = 0; y < H; y++) {
+            uint8_t correct = 0;
+            for (int x = 0; x < 20; x++) {
+                correct = std::max(correct, narrow(x, y));
+            }
+            if (result(y) != correct) {
+                printf("max(%d) = %d instead of %d\n", y, result(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Sum each row with four warps per row. Each warp reduces with
+        // shuffles into shared memory, and a final shuffle reduction
+        // combines the warps.
+        RDom r(0, W);
+        Func out;
+        out(y) = 0;
+        out(y) += input(r, y);
+
+        RVar ro, ri, rw, rl;
+        out.update().split(r, ro, ri, 128);
+        Func per_thread = out.update().rfactor(ri, u);
+        out.update().split(ri, rw, rl, 32);
+        Func per_warp = out.update().rfactor(rw, w);
+
+        out.compute_root().gpu_blocks(y);
+        out.update().gpu_blocks(y).gpu_lanes(rw);
+        per_warp.compute_at(out, y).store_in(MemoryType::GPUShared).gpu_threads(w);
+        per_warp.update().gpu_threads(w).gpu_lanes(rl);
+        per_thread.compute_at(out, y).split(u, w, l, 32).gpu_threads(w).gpu_lanes(l);
+        per_thread.update().split(u, w, l, 32).gpu_threads(w).gpu_lanes(l);
+
+        Buffer<int> result = out.realize(H);
+        for (int y = 0; y < H; y++) {
+            int correct = 0;
+            for (int x = 0; x < W; x++) {
+                correct += input(x, y);
+            }
+            if (result(y) != correct) {
+                printf("block sum(%d) = %d instead of %d\n", y, result(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
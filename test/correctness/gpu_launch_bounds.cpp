@@ -0,0 +1,41 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    if (!t.has_feature(Target::CUDA)) {
+        printf("Not running test because cuda not enabled\n");
+        return 0;
+    }
+
+    Func f, g;
+    Var x, y, xi, yi;
+
+    f(x, y) = x * y;
+    f(x, y) += x + y;
+
+    // Launch bounds on the pure definition, using the block size from
+    // the schedule, and on the update with an explicit bound larger
+    // than the block size.
+    f.gpu_tile(x, y, xi, yi, 16, 16).gpu_launch_bounds(0, 4);
+    f.update().gpu_tile(x, y, xi, yi, 32, 4).gpu_launch_bounds(256, 2);
+
+    g(x, y) = f(x, y) * 2;
+    g.gpu_tile(x, y, xi, yi, 8, 8).gpu_launch_bounds(64);
+
+    Buffer<int> out = g.realize(100, 100, t);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x * y + x + y) * 2;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA)) {
+        printf("Not running test because cuda not enabled\n");
+        return 0;
+    }
+
+    // Must be set before the first pipeline runs.
+    setenv("HL_CUDA_LAUNCH_GRAPHS", "1", 1);
+
+    // A chain of small kernels, with a scalar parameter that changes
+    // between runs so that replayed graphs need updated arguments.
+    Param<int> offset;
+    ImageParam input(Int(32), 2);
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    std::vector<Func> stages;
+    Func prev = lambda(x, y, input(x, y));
+    for (int i = 0; i < 8; i++) {
+        Func f("f" + std::to_string(i));
+        f(x, y) = prev(x, y) + offset + i;
+        f.compute_root().gpu_tile(x, y, xi, yi, 8, 8, TailStrategy::Auto, DeviceAPI::CUDA);
+        stages.push_back(f);
+        prev = f;
+    }
+    Func out = stages.back();
+
+    // Run at two sizes, several times each, so that graphs are built,
+    // replayed, and replayed with different buffers and parameters.
+    for (int iter = 0; iter < 6; iter++) {
+        int size = (iter % 2) ? 37 : 64;
+        Buffer<int> in(size, size);
+        in.for_each_element([&](int x, int y) { in(x, y) = x + y * iter; });
+        input.set(in);
+        offset.set(iter);
+        Buffer<int> result = out.realize(size, size, t);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int correct = x + y * iter + 8 * iter + 28;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d at iteration %d\n",
+                           x, y, result(x, y), correct, iter);
+                    return -1;
+                }
+            }
+        }
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA)) {
+        printf("Not running test because cuda not enabled\n");
+        return 0;
+    }
+
+    // Must be set before the first device_and_host_malloc.
+    setenv("HL_CUDA_MAPPED_HOST_MEMORY", "1", 1);
+
+    // Both the input and the output live in host memory mapped into
+    // the device address space, so the pipeline makes no copies.
+    Buffer<int> in(nullptr, 256, 256), out(nullptr, 256, 256);
+    if (in.device_and_host_malloc(DeviceAPI::CUDA, t) != 0 ||
+        out.device_and_host_malloc(DeviceAPI::CUDA, t) != 0) {
+        printf("device_and_host_malloc failed\n");
+        return -1;
+    }
+    in.for_each_element([&](int x, int y) { in(x, y) = x + y * 256; });
+    in.set_host_dirty();
+
+    Func f("f");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = in(x, y) * 2 + 1;
+    f.gpu_tile(x, y, xi, yi, 16, 16, TailStrategy::Auto, DeviceAPI::CUDA);
+
+    // Run twice, updating the input in place in between.
+    for (int i = 0; i < 2; i++) {
+        f.realize(out, t);
+        out.copy_to_host();
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (x + y * 256 + i) * 2 + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        in.for_each_value([](int &v) { v++; });
+        in.set_host_dirty();
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+// Find the stats of a memoized Func.
+halide_memoization_cache_func_stats_t stats_for(const char *name) {
+    for (const halide_memoization_cache_func_stats_t &s :
+             Internal::JITSharedRuntime::memoization_cache_get_stats()) {
+        if (strcmp(s.func_name, name) == 0) {
+            return s;
+        }
+    }
+    halide_memoization_cache_func_stats_t none;
+    memset(&none, 0, sizeof(none));
+    return none;
+}
+
+int run(const char *name, bool consume_on_gpu, const Target &t) {
+    Param<int> p;
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // A memoized Func computed on the device, consumed either on the
+    // device or on the host.
+    Func f(name);
+    f(x, y) = x * 3 + y * 5 + p;
+    f.compute_root().memoize().gpu_tile(x, y, xi, yi, 8, 8);
+
+    Func g("g");
+    g(x, y) = f(x, y) + f(x + 1, y);
+    if (consume_on_gpu) {
+        g.gpu_tile(x, y, xi, yi, 8, 8);
+    }
+
+    const int values[] = {0, 1, 0, 1, 2, 0};
+    for (int v : values) {
+        p.set(v);
+        Buffer<int> out = g.realize(64, 64, t);
+        for (int j = 0; j < 64; j++) {
+            for (int i = 0; i < 64; i++) {
+                int correct = (i * 3 + j * 5 + v) * 2 + 3;
+                if (out(i, j) != correct) {
+                    printf("%s: out(%d, %d) = %d instead of %d with p = %d\n",
+                           name, i, j, out(i, j), correct, v);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    halide_memoization_cache_func_stats_t s = stats_for(name);
+    if (s.misses != 3 || s.hits != 3) {
+        printf("%s: %d misses and %d hits instead of 3 and 3\n", name, (int)s.misses, (int)s.hits);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    if (run("gpu_memoize_device", true, t) != 0 ||
+        run("gpu_memoize_host", false, t) != 0) {
+        return -1;
+    }
+
+    // With a tiny cache every result is evicted, which frees its
+    // device allocation, so every lookup misses.
+    Internal::JITSharedRuntime::memoization_cache_set_size(1);
+    {
+        Param<int> p;
+        Var x("x"), y("y"), xi("xi"), yi("yi");
+        Func f("gpu_memoize_evicted");
+        f(x, y) = x + y + p;
+        f.compute_root().memoize().gpu_tile(x, y, xi, yi, 8, 8);
+        Func g("g");
+        g(x, y) = f(x, y) * 2;
+        g.gpu_tile(x, y, xi, yi, 8, 8);
+        for (int v : {0, 0, 1, 0}) {
+            p.set(v);
+            Buffer<int> out = g.realize(32, 32, t);
+            for (int j = 0; j < 32; j++) {
+                for (int i = 0; i < 32; i++) {
+                    if (out(i, j) != (i + j + v) * 2) {
+                        printf("After eviction, out(%d, %d) = %d instead of %d\n",
+                               i, j, out(i, j), (i + j + v) * 2);
+                        return -1;
+                    }
+                }
+            }
+        }
+        if (stats_for("gpu_memoize_evicted").evictions == 0) {
+            printf("Expected evictions with a tiny cache\n");
+            return -1;
+        }
+    }
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t(get_jit_target_from_environment());
+    if (!t.has_feature(Target::CUDA)) {
+        printf("Not running test because cuda not enabled\n");
+        return 0;
+    }
+
+    Var x, y, n, xi, yi;
+
+    {
+        // Distribute a batch dimension across the devices.
+        Func f;
+        f(x, y, n) = x + y * 3 + n * 1000;
+        f.gpu_tile(x, y, xi, yi, 8, 8).gpu_multi_device(n);
+
+        Buffer<int> out = f.realize(32, 32, 7);
+        for (int k = 0; k < out.channels(); k++) {
+            for (int j = 0; j < out.height(); j++) {
+                for (int i = 0; i < out.width(); i++) {
+                    int correct = i + j * 3 + k * 1000;
+                    if (out(i, j, k) != correct) {
+                        printf("out(%d, %d, %d) = %d instead of %d\n", i, j, k, out(i, j, k), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    {
+        // Distribute a GPU block loop of a blur, with the halo region
+        // of the input copied to each chunk's device.
+        Buffer<int> in(70, 70);
+        in.for_each_element([&](int x, int y) { in(x, y) = x * 7 + y; });
+
+        Func wrapper, blur;
+        wrapper(x, y) = in(x, y);
+        blur(x, y) = wrapper(x, y) + wrapper(x, y + 1) + wrapper(x, y + 2);
+
+        Var yo;
+        blur.split(y, yo, y, 16).gpu_tile(x, y, xi, yi, 16, 4).gpu_multi_device(yo);
+        wrapper.compute_at(blur, yo).gpu_tile(x, y, xi, yi, 16, 4);
+
+        Buffer<int> out = blur.realize(64, 64);
+        for (int j = 0; j < out.height(); j++) {
+            for (int i = 0; i < out.width(); i++) {
+                int correct = in(i, j) + in(i, j + 1) + in(i, j + 2);
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    // Must be set before the runtime first allocates device memory.
+    setenv("HL_REUSE_DEVICE_ALLOCATIONS", "1", 1);
+
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+
+    f.compute_root().gpu_tile(x, y, xi, yi, 8, 8);
+    g.gpu_tile(x, y, xi, yi, 8, 8);
+
+    // Realize at a mix of sizes, so that the intermediate and the
+    // output reuse allocations made by earlier iterations, both of
+    // the same size and of slightly different sizes in the same size
+    // class.
+    const int sizes[] = {64, 64, 60, 100, 63, 64, 128, 100};
+    for (int size : sizes) {
+        Buffer<int> out = g.realize(size, size, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = ((x - 1) * 3 + y) + ((x + 1) * 3 + y);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d at size %d\n",
+                           x, y, out(x, y), correct, size);
+                    return -1;
+                }
+            }
+        }
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class FindSharedAllocation : public IRVisitor {
+public:
+    int64_t bytes = -1;
+
+protected:
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        if (op->memory_type == MemoryType::GPUShared) {
+            const int64_t *size = as_const_int(op->extents[0]);
+            if (size) {
+                bytes = *size * op->type.bytes();
+            }
+        }
+        IRVisitor::visit(op);
+    }
+};
+
+class CheckSharedSize : public IRMutator2 {
+    int64_t correct;
+public:
+    CheckSharedSize(int64_t correct) : correct(correct) {}
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        FindSharedAllocation f;
+        s.accept(&f);
+
+        if (f.bytes != correct) {
+            printf("Shared allocation is %d bytes instead of %d\n", (int)f.bytes, (int)correct);
+            exit(-1);
+        }
+
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature() || t.has_feature(Target::OpenGLCompute)) {
+        printf("Not running test because no gpu target with shared memory enabled\n");
+        return 0;
+    }
+
+    const int size = 256, tile_size = 32;
+    Buffer<float> input(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            input(x, y) = x * 17 + y;
+        }
+    }
+
+    for (int vectorize = 0; vectorize < 2; vectorize++) {
+        Var x("x"), y("y"), xi("xi"), yi("yi"), xv("xv");
+
+        // Transpose through a tile in shared memory. The tile is written
+        // along its rows and read along its columns, so every thread of
+        // a warp reads from a different row.
+        Func tile("tile"), out("out");
+        tile(x, y) = input(x, y);
+        out(x, y) = tile(y, x);
+
+        out.gpu_tile(x, y, xi, yi, tile_size, tile_size);
+        if (vectorize) {
+            // Stage the tile cooperatively with vectorized global loads.
+            tile.compute_at(out, x).split(x, x, xv, 4).vectorize(xv).gpu_threads(x, y);
+        } else {
+            tile.compute_at(out, x).gpu_threads(x, y);
+        }
+
+        // The rows of the tile should be padded by one float, so that
+        // the column reads hit different banks.
+        out.add_custom_lowering_pass(new CheckSharedSize((tile_size + 1) * tile_size * sizeof(float)));
+
+        Buffer<float> output = out.realize(size, size, t);
+
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                float correct = y * 17 + x;
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %f instead of %f\n",
+                           x, y, output(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
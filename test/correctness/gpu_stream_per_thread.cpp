@@ -0,0 +1,51 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA)) {
+        printf("Not running test because cuda not enabled\n");
+        return 0;
+    }
+
+    // Must be set before the runtime first launches a kernel.
+    setenv("HL_CUDA_STREAM_PER_THREAD", "1", 1);
+
+    // An async producer on the GPU, consumed by kernels launched from
+    // the iterations of a parallel loop. Each thread launches its
+    // kernels on its own stream, so the results are only correct if
+    // every thread waits for its kernels before handing their results
+    // to another.
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = x * 2 + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    h(x, y) = g(x, y) * 3;
+
+    f.compute_root().async().gpu_tile(x, y, xi, yi, 16, 16);
+    g.compute_at(h, y).gpu_tile(x, xi, 32);
+    h.parallel(y);
+
+    for (int i = 0; i < 5; i++) {
+        Buffer<int> out = h.realize(256, 256, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = ((x * 2 + y) + ((x + 1) * 2 + y)) * 3;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
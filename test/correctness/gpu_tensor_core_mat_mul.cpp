@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class FindWMMA : public IRVisitor {
+public:
+    std::string name;
+
+protected:
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (starts_with(op->name, "halide_ptx_wmma_")) {
+            name = op->name;
+        }
+        IRVisitor::visit(op);
+    }
+};
+
+class CheckForWMMA : public IRMutator2 {
+    std::string correct;
+public:
+    CheckForWMMA(const std::string &correct) : correct(correct) {}
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        FindWMMA f;
+        s.accept(&f);
+
+        if (f.name != correct) {
+            printf("Found tensor core call \"%s\" instead of \"%s\"\n", f.name.c_str(), correct.c_str());
+            exit(-1);
+        }
+
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA) || !t.has_feature(Target::CUDACapability70)) {
+        printf("Not running test because cuda capability 7.0 is not enabled\n");
+        return 0;
+    }
+
+    const int size = 64;
+    Buffer<float16_t> A(size, size), B(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            // Small integers, so every product and sum is exact
+            A(x, y) = float16_t((float)((x + 2 * y) % 5 - 2));
+            B(x, y) = float16_t((float)((3 * x + y) % 7 - 3));
+        }
+    }
+
+    for (int transpose_b = 0; transpose_b < 2; transpose_b++) {
+        Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+        RDom r(0, size);
+        RVar ro("ro"), ri("ri");
+
+        Func out("out");
+        out(x, y) = 0.0f;
+        if (transpose_b) {
+            out(x, y) += cast<float>(A(r, y)) * cast<float>(B(r, x));
+        } else {
+            out(x, y) += cast<float>(A(r, y)) * cast<float>(B(x, r));
+        }
+
+        // A single thread per block computes 16x16 tiles of the
+        // output, 16 elements of the reduction at a time, which is
+        // the shape of a wmma tile.
+        out.bound(x, 0, size).bound(y, 0, size);
+        out.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        out.update()
+            .split(x, xo, xi, 16)
+            .split(y, yo, yi, 16)
+            .split(r, ro, ri, 16)
+            .reorder(ri, xi, yi, ro, xo, yo)
+            .gpu_blocks(xo, yo);
+
+        out.add_custom_lowering_pass(new CheckForWMMA(transpose_b ?
+                                                      "halide_ptx_wmma_m16n16k16_row_col" :
+                                                      "halide_ptx_wmma_m16n16k16_row_row"));
+
+        Buffer<float> result = out.realize(size, size, t);
+
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                float correct = 0.0f;
+                for (int k = 0; k < size; k++) {
+                    float b = transpose_b ? (float)B(k, x) : (float)B(x, k);
+                    correct += (float)A(k, y) * b;
+                }
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "Halide.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+using namespace Halide;
+
+// The reference for sample_bilinear, with pixels centered at integer
+// coordinates and clamping at the edges.
+float reference_sample(const Buffer<float> &in, float x, float y) {
+    auto at = [&](int i, int j) {
+        i = std::min(std::max(i, in.dim(0).min()), in.dim(0).max());
+        j = std::min(std::max(j, in.dim(1).min()), in.dim(1).max());
+        return in(i, j);
+    };
+    float fx = floorf(x), fy = floorf(y);
+    float wx = x - fx, wy = y - fy;
+    int ix = (int)fx, iy = (int)fy;
+    float top = at(ix, iy) * (1 - wx) + at(ix + 1, iy) * wx;
+    float bottom = at(ix, iy + 1) * (1 - wx) + at(ix + 1, iy + 1) * wx;
+    return top * (1 - wy) + bottom * wy;
+}
+
+int check(const Buffer<float> &out, const Buffer<float> &in, float tolerance, const char *what) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = reference_sample(in, x * 0.37f - 2.1f, y * 0.61f - 1.5f) + in(x % in.width(), y % in.height());
+            if (fabsf(out(x, y) - correct) > tolerance) {
+                printf("%s: out(%d, %d) = %f instead of %f\n", what, x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    Buffer<float> input(64, 48);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = ((x * 17 + y * 31) % 64) / 64.0f;
+    });
+
+    for (int mode = 0; mode < 3; mode++) {
+        ImageParam in(Float(32), 2);
+        Var x("x"), y("y"), xi("xi"), yi("yi");
+        Func out("out");
+        // A resampling of the input, plus a plain load from it.
+        out(x, y) = (sample_bilinear(in, x * 0.37f - 2.1f, y * 0.61f - 1.5f) +
+                     in(x % 64, y % 48));
+
+        // The texture unit filters with weights of 8 bits of precision.
+        float tolerance = 1e-5f;
+        if (mode == 1) {
+            in.gpu_texture(false);
+        } else if (mode == 2) {
+            in.gpu_texture(true);
+            tolerance = 1.0f / 256;
+        }
+        if (t.has_gpu_feature()) {
+            out.gpu_tile(x, y, xi, yi, 16, 8);
+        }
+
+        in.set(input);
+        Buffer<float> result = out.realize(100, 80, t);
+        if (check(result, input, tolerance, mode == 0 ? "loads" : mode == 1 ? "texture" : "filtered texture") != 0) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check that dense vector loads and stores of various element types
+// and widths give the right answer on the gpu, both when they are
+// aligned well enough to become single 64- or 128-bit accesses and
+// when they are not.
+template<typename T>
+bool test(int vector_width, int offset) {
+    const int W = 256, H = 16;
+    Buffer<T> input(W + 16, H);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (T)(x * 3 + y * 5);
+        }
+    }
+
+    Var x("x"), y("y"), xi("xi"), xo("xo"), xoo("xoo"), xoi("xoi"), yo("yo"), yi("yi");
+    Func f("f");
+    f(x, y) = input(x + offset, y) + input(x + 1, y);
+
+    f.bound(x, 0, W)
+        .split(x, xo, xi, vector_width)
+        .vectorize(xi)
+        .gpu_tile(xo, y, xoo, yo, xoi, yi, 16, 1);
+
+    Buffer<T> out = f.realize(W, H);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            T correct = (T)(input(x + offset, y) + input(x + 1, y));
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f for %d-bit elements with vector width %d and offset %d\n",
+                       x, y, (double)out(x, y), (double)correct,
+                       (int)sizeof(T) * 8, vector_width, offset);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    for (int offset = 0; offset < 2; offset++) {
+        if (!test<uint8_t>(8, offset) ||
+            !test<uint8_t>(16, offset) ||
+            !test<uint8_t>(32, offset) ||
+            !test<uint16_t>(4, offset) ||
+            !test<uint16_t>(8, offset) ||
+            !test<float>(2, offset) ||
+            !test<float>(4, offset) ||
+            !test<float>(8, offset)) {
+            return -1;
+        }
+        // Not all gpu apis support doubles.
+        if (t.has_feature(Target::CUDA) && !test<double>(2, offset)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -399,6 +399,82 @@ int main(int argc, char **argv) {
         assert(b.dim(3).stride() == b2.dim(3).stride());
     }
 
+    {
+        // Check that buffers allocated from the pool recycle their
+        // memory, and don't share it while it's in use.
+        BufferPool::release_cached();
+        uint8_t *first = nullptr, *second = nullptr;
+        {
+            Buffer<float> a(nullptr, 100, 50);
+            a.allocate(BufferPool::allocate, BufferPool::deallocate);
+            assert(((uintptr_t)a.data() & 127) == 0);
+            a.fill(1.0f);
+            first = (uint8_t *)a.data();
+
+            Buffer<float> b = Buffer<float>::make_with_shape_of(a, BufferPool::allocate, BufferPool::deallocate);
+            second = (uint8_t *)b.data();
+            assert(second != first);
+            b.fill(2.0f);
+            a.for_each_value([](float v) { assert(v == 1.0f); });
+        }
+        assert(BufferPool::cached_bytes() > 0);
+
+        Buffer<float> c(nullptr, 100, 50);
+        c.allocate(BufferPool::allocate, BufferPool::deallocate);
+        assert((uint8_t *)c.data() == first || (uint8_t *)c.data() == second);
+
+        // Buffers of a similar size reuse the same size class.
+        void *p = BufferPool::halide_malloc(nullptr, 1000);
+        BufferPool::halide_free(nullptr, p);
+        void *q = BufferPool::halide_malloc(nullptr, 900);
+        assert(p == q);
+        BufferPool::halide_free(nullptr, q);
+
+        BufferPool::release_cached();
+        assert(BufferPool::cached_bytes() == 0);
+    }
+
+    {
+        // Check copies between interleaved and planar layouts, with
+        // and without a parallel for loop.
+        auto serial_par_for = [](void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+            for (int i = min; i < min + size; i++) {
+                f(user_context, i, closure);
+            }
+            return 0;
+        };
+        for (int c = 1; c <= 5; c++) {
+            for (int parallel = 0; parallel < 2; parallel++) {
+                halide_do_par_for_t do_par_for = parallel ? (halide_do_par_for_t)serial_par_for : nullptr;
+
+                Buffer<uint8_t> planar(301, 257, c);
+                planar.for_each_element([&](int x, int y, int c) {
+                    planar(x, y, c) = (uint8_t)(x + 3 * y + 7 * c);
+                });
+
+                Buffer<uint8_t> interleaved = Buffer<uint8_t>::make_interleaved(301, 257, c);
+                interleaved.copy_from(planar, do_par_for);
+                interleaved.for_each_element([&](int x, int y, int c) {
+                    assert(interleaved(x, y, c) == (uint8_t)(x + 3 * y + 7 * c));
+                });
+
+                Buffer<uint8_t> planar2(301, 257, c);
+                planar2.copy_from(interleaved, do_par_for);
+                planar2.for_each_element([&](int x, int y, int c) {
+                    assert(planar2(x, y, c) == planar(x, y, c));
+                });
+
+                // A crop copies row by row.
+                Buffer<uint8_t> crop(100, 100, c);
+                crop.set_min(50, 60, 0);
+                crop.copy_from(interleaved, do_par_for);
+                crop.for_each_element([&](int x, int y, int c) {
+                    assert(crop(x, y, c) == planar(x, y, c));
+                });
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -41,6 +41,27 @@ void test_round_trip(Buffer<T> buf, std::string format) {
         printf("test_round_trip: Difference of %d when saved and loaded as %s\n", diff, format.c_str());
         abort();
     }
+
+    if (format == "tmp" || format == "mat" || format == "ppm" || format == "pgm") {
+        // Check the memory-mapped paths agree with the regular ones.
+        std::string mapped_filename = Internal::get_test_tmp_dir() + "test_mapped." + format;
+        if (!Tools::save_mapped<Buffer<T>, Tools::Internal::CheckFail>(buf, mapped_filename)) {
+            abort();
+        }
+        Buffer<T> mapped;
+        if (!Tools::load_mapped<Buffer<T>, Tools::Internal::CheckFail>(mapped_filename, &mapped)) {
+            abort();
+        }
+        for (int d = 0; d < buf.dimensions(); ++d) {
+            mapped.translate(d, buf.dim(d).min() - mapped.dim(d).min());
+        }
+        buf.for_each_element([&](const int *pos) {
+            if (buf(pos) != mapped(pos)) {
+                printf("test_round_trip: Mismatch when saved and loaded mapped as %s\n", format.c_str());
+                abort();
+            }
+        });
+    }
 }
 
 // static -> static conversion test
@@ -224,8 +245,38 @@ void do_test() {
     }
 }
 
+void test_load_batch() {
+    std::vector<Buffer<uint8_t>> bufs;
+    std::vector<std::string> filenames;
+    for (int i = 0; i < 8; i++) {
+        Buffer<uint8_t> buf(64 + i, 48, 3);
+        buf.for_each_element([&](int x, int y, int c) {
+            buf(x, y, c) = (uint8_t)(x + y * i + c);
+        });
+        std::string filename = Internal::get_test_tmp_dir() + "test_batch_" + std::to_string(i) + (i % 2 ? ".ppm" : ".mat");
+        Tools::save_image(buf, filename);
+        bufs.push_back(buf);
+        filenames.push_back(filename);
+    }
+
+    std::cout << "Testing load_batch\n";
+    std::vector<Buffer<uint8_t>> loaded;
+    if (!Tools::load_batch<Buffer<uint8_t>, Tools::Internal::CheckFail>(filenames, &loaded, 4)) {
+        abort();
+    }
+    for (size_t i = 0; i < bufs.size(); i++) {
+        bufs[i].for_each_element([&](int x, int y, int c) {
+            if (bufs[i](x, y, c) != loaded[i](x, y, c)) {
+                printf("test_load_batch: Mismatch in %s at (%d, %d, %d)\n", filenames[i].c_str(), x, y, c);
+                abort();
+            }
+        });
+    }
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
+    test_load_batch();
     return 0;
 }
@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // Complex numbers, computed with vectors and an update, and
+        // read densely and at an offset.
+        Func c, f;
+        c(x, y) = Tuple(cast<float>(x), cast<float>(y));
+        c(x, y) = Tuple(c(x, y)[0] * 2 - c(x, y)[1], c(x, y)[1] + 1);
+        f(x, y) = c(x, y)[0] * c(x + 1, y)[1];
+
+        c.compute_root().store_interleaved().vectorize(x, 8);
+        c.update().vectorize(x, 8);
+        f.vectorize(x, 8);
+
+        Buffer<float> out = f.realize(100, 50);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = (x * 2.0f - y) * (y + 1.0f);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // Index and value pairs of different types but the same size,
+        // read at scattered locations.
+        Func arg, g;
+        RDom r(0, 10);
+        arg(x) = argmin(r, cast<float>((r - x % 7) * (r - x % 7) + x));
+        g(x) = arg((x * 37) % 100)[0] * 1000 + cast<int>(arg((x * 37) % 100)[1]);
+
+        arg.compute_root().store_interleaved();
+        g.vectorize(x, 4);
+
+        Buffer<int> out = g.realize(100);
+        for (int x = 0; x < out.width(); x++) {
+            int i = (x * 37) % 100;
+            int correct = (i % 7) * 1000 + i;
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// IR nodes come from per-thread free lists. Check that nodes can be
+// freed by threads other than the ones that allocated them, by
+// threads that are exiting, and after main returns.
+
+// Released during static destruction, after the main thread's
+// thread_locals are gone.
+Expr global_expr;
+
+struct ThreadLocalExpr {
+    Expr e;
+};
+
+Expr make_tree(int depth, int leaf) {
+    if (depth == 0) {
+        return Variable::make(Int(32), "v" + std::to_string(leaf));
+    }
+    Expr a = make_tree(depth - 1, leaf * 2);
+    Expr b = make_tree(depth - 1, leaf * 2 + 1);
+    return Add::make(Mul::make(a, b), Sub::make(b, a));
+}
+
+int count_leaves(const Expr &e) {
+    if (e.as<Variable>()) {
+        return 1;
+    } else if (const Add *add = e.as<Add>()) {
+        return count_leaves(add->a) + count_leaves(add->b);
+    } else if (const Mul *mul = e.as<Mul>()) {
+        return count_leaves(mul->a) + count_leaves(mul->b);
+    } else if (const Sub *sub = e.as<Sub>()) {
+        return count_leaves(sub->a) + count_leaves(sub->b);
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    global_expr = make_tree(4, 0);
+    static thread_local ThreadLocalExpr main_expr;
+    main_expr.e = make_tree(4, 0);
+
+    const int depth = 10;
+    // Each subtree is used twice, so the leaves are counted 4^depth times.
+    const int leaves = 1 << (2 * depth);
+
+    // Worker threads build trees and exit, and the main thread frees
+    // them, many times over the batch size of the free lists.
+    for (int round = 0; round < 20; round++) {
+        std::vector<Expr> trees(4);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < trees.size(); i++) {
+            threads.emplace_back([&trees, i]() {
+                static thread_local ThreadLocalExpr worker_expr;
+                worker_expr.e = make_tree(4, 0);
+                trees[i] = make_tree(depth, (int)i);
+            });
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        for (const Expr &e : trees) {
+            if (count_leaves(e) != leaves) {
+                printf("Tree built by another thread has %d leaves instead of %d\n",
+                       count_leaves(e), leaves);
+                return -1;
+            }
+        }
+    }
+
+    // Threads that allocate and free concurrently, handing trees to
+    // each other.
+    std::vector<Expr> handoff(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < handoff.size(); i++) {
+        threads.emplace_back([&handoff, i]() {
+            handoff[i] = make_tree(depth, (int)i);
+            for (int j = 0; j < 10; j++) {
+                Expr e = make_tree(depth - 2, j);
+                if (count_leaves(e) != (leaves >> 4)) {
+                    printf("Tree has the wrong number of leaves\n");
+                    exit(-1);
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    threads.clear();
+    for (size_t i = 0; i < handoff.size(); i++) {
+        threads.emplace_back([&handoff, i]() {
+            handoff[(i + 1) % handoff.size()] = Expr();
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+#ifndef _WIN32
+// Run one compile-and-realize of a fixed pipeline with the persistent
+// JIT cache pointed at the given directory.
+int run_child(const char *cache_dir) {
+    setenv("HL_JIT_CACHE_DIR", cache_dir, 1);
+
+    Func f("jit_object_cache_f"), g("jit_object_cache_g");
+    Var x("x"), y("y");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + 1, y) * 2;
+    f.compute_root();
+    g.vectorize(x, 8).parallel(y);
+
+    Buffer<int> out = g.realize(64, 32);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x * 3 + y) + (x * 3 + 3 + y) * 2;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+std::vector<std::string> cached_objects(const std::string &dir) {
+    std::vector<std::string> result;
+    DIR *d = opendir(dir.c_str());
+    if (!d) return result;
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 2 && name.substr(name.size() - 2) == ".o") {
+            result.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    return result;
+}
+
+bool file_contains(const std::string &path, const char *needle) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    char line[4096];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = strstr(line, needle) != nullptr;
+    }
+    fclose(f);
+    return found;
+}
+#endif
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+#else
+    if (argc == 3 && strcmp(argv[1], "child") == 0) {
+        return run_child(argv[2]);
+    }
+
+    // The cache only pays off across processes, so run the pipeline in
+    // child processes that share a cache directory.
+    std::string dir = Internal::dir_make_temp();
+    std::string log = dir + "/log.txt";
+    std::string child = std::string("\"") + argv[0] + "\" child \"" + dir + "\"";
+
+    // A cold run should compile and populate the cache.
+    if (system(child.c_str()) != 0) {
+        printf("Cold run failed\n");
+        return -1;
+    }
+    std::vector<std::string> objects = cached_objects(dir);
+    if (objects.size() != 1) {
+        printf("Expected one cached object after the cold run, got %d\n", (int)objects.size());
+        return -1;
+    }
+
+    // A warm run should load the object instead of compiling it.
+    std::string warm = "HL_DEBUG_CODEGEN=1 " + child + " 2> \"" + log + "\"";
+    if (system(warm.c_str()) != 0) {
+        printf("Warm run failed\n");
+        return -1;
+    }
+    if (!file_contains(log, "JIT cache hit")) {
+        printf("Warm run did not hit the JIT cache\n");
+        return -1;
+    }
+
+    // A corrupt cache entry should be ignored and recompiled.
+    FILE *f = fopen(objects[0].c_str(), "w");
+    fputs("not an object file", f);
+    fclose(f);
+    if (system(child.c_str()) != 0) {
+        printf("Run with a corrupt cache entry failed\n");
+        return -1;
+    }
+
+    for (const std::string &o : cached_objects(dir)) {
+        remove(o.c_str());
+    }
+    remove(log.c_str());
+    rmdir(dir.c_str());
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Build a fresh instance of the same pipeline definition, with a
+// different constant if asked.
+Pipeline make_pipeline(Param<int> &p, int k = 3) {
+    Func f("jit_shared_modules_f"), g("jit_shared_modules_g");
+    Var x("x"), y("y");
+    f(x, y) = x * k + y * p;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root();
+    g.vectorize(x, 8);
+    return Pipeline(g);
+}
+
+bool check(Pipeline pipeline, Param<int> &p, int value, int k = 3) {
+    p.set(value);
+    Buffer<int> out = pipeline.realize(32, 16);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x * k + y * value) + ((x + 1) * k + y * value);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Param<int> p1("p"), p2("p"), p3("p");
+    Pipeline a = make_pipeline(p1);
+    Pipeline b = make_pipeline(p2);
+    Pipeline c = make_pipeline(p3, 5);
+
+    // Equivalent pipelines should share their code, and different ones
+    // shouldn't.
+    void *fa = a.compile_jit(), *fb = b.compile_jit(), *fc = c.compile_jit();
+    if (fa != fb) {
+        printf("Equivalent pipelines were compiled separately\n");
+        return -1;
+    }
+    if (fa == fc) {
+        printf("Different pipelines share code\n");
+        return -1;
+    }
+
+    // Each should still run with its own parameter values.
+    if (!check(a, p1, 2) || !check(b, p2, 7) || !check(c, p3, 4, 5)) {
+        return -1;
+    }
+
+    // Once the pipelines sharing a module are gone, an equivalent
+    // pipeline should still compile and run.
+    a = Pipeline();
+    b = Pipeline();
+    Param<int> p4("p");
+    Pipeline d = make_pipeline(p4);
+    d.compile_jit();
+    if (!check(d, p4, 11)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
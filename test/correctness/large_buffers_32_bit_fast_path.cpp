@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int narrow_loads = 0, wide_loads = 0;
+
+class CountLoads : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == "input") {
+            if (op->index.type().element_of() == Int(32)) {
+                narrow_loads++;
+            } else {
+                wide_loads++;
+            }
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.bits != 64) {
+        printf("Skipping test, because large buffers need a 64-bit target.\n");
+        return 0;
+    }
+    t.set_feature(Target::LargeBuffers);
+
+    ImageParam input(Int(32), 2, "input");
+    Var x, y;
+    Func f;
+    f(x, y) = input(x, y) * 3 + input(x + 1, y + 1);
+    f.vectorize(x, 8);
+
+    f.add_custom_lowering_pass(new CountLoads);
+    f.compile_jit(t);
+
+    // There should be a copy of the pipeline that indexes the input
+    // with 32-bit math, and one that uses 64-bit math.
+    if (narrow_loads == 0 || wide_loads == 0) {
+        printf("Expected loads from input with both 32-bit and 64-bit indices. "
+               "Got %d and %d\n", narrow_loads, wide_loads);
+        return -1;
+    }
+
+    const int w = 67, h = 19;
+    Buffer<int> in(w + 1, h + 1);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x * 7 - y * 5;
+    });
+    input.set(in);
+    Buffer<int> out = f.realize(w, h, t);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int correct = in(x, y) * 3 + in(x + 1, y + 1);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int lowerings = 0;
+
+class CountLowerings : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        lowerings++;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::LazySpecializations);
+
+    Param<bool> use_square;
+    Param<int> offset;
+    ImageParam in(Int(32), 1);
+    Func f;
+    Var x;
+    f(x) = in(x) + offset;
+    f.specialize(use_square).vectorize(x, 4);
+    f.specialize(in.dim(0).stride() == 1 && offset == 0);
+    f.add_custom_lowering_pass(new CountLowerings);
+
+    Buffer<int> input(16);
+    input.for_each_element([&](int x) { input(x) = x * 3; });
+    in.set(input);
+
+    // Each combination of specializations is compiled the first time
+    // it's used, and then reused.
+    struct {
+        bool use_square;
+        int offset;
+        int lowerings;
+    } runs[] = {{true, 0, 1}, {true, 5, 2}, {true, 7, 2}, {false, 0, 3}, {false, 1, 4}, {true, 0, 4}};
+
+    for (auto r : runs) {
+        use_square.set(r.use_square);
+        offset.set(r.offset);
+        Buffer<int> out = f.realize(16, t);
+        for (int i = 0; i < 16; i++) {
+            if (out(i) != input(i) + r.offset) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), input(i) + r.offset);
+                return -1;
+            }
+        }
+        if (lowerings != r.lowerings) {
+            printf("Lowered %d times instead of %d\n", lowerings, r.lowerings);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -14,12 +14,22 @@ class Counter : public IRVisitor {
     using IRVisitor::visit;
 
     void visit(const Store *op) override {
+        bool old_in_store = in_store;
+        in_store = op->name == func;
         IRVisitor::visit(op);
+        in_store = old_in_store;
         if (op->name == func) {
             store_count++;
         }
     }
 
+    void visit(const Select *op) override {
+        IRVisitor::visit(op);
+        if (in_store) {
+            select_count++;
+        }
+    }
+
     void visit(const Call *op) override {
         IRVisitor::visit(op);
         if (op->name == "sin_f32") {
@@ -27,9 +37,11 @@ class Counter : public IRVisitor {
         }
     }
 
+    bool in_store = false;
+
 public:
-    int store_count, sin_count;
-    Counter(string f) : func(f), store_count(0), sin_count(0) {}
+    int store_count, sin_count, select_count;
+    Counter(string f) : func(f), store_count(0), sin_count(0), select_count(0) {}
 };
 
 // Check that the number of calls to sin is correct.
@@ -71,11 +83,36 @@ public:
     CheckStoreCount(string f, int c) : func(f), correct(c) {}
 };
 
+// Check that the number of selects in stores to a given func is correct
+class CheckSelectCount : public IRMutator2 {
+    string func;
+    int correct;
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        Counter c(func);
+        s.accept(&c);
+        if (c.select_count != correct) {
+            printf("There were %d selects in stores to %s instead of %d\n", c.select_count, func.c_str(), correct);
+            exit(-1);
+        }
+        return s;
+    }
+
+    CheckSelectCount(string f, int c) : func(f), correct(c) {}
+};
+
 void count_partitions(Func g, int correct) {
     g.add_custom_lowering_pass(new CheckStoreCount(g.name(), correct));
     g.compile_to_module(g.infer_arguments());
 }
 
+void count_selects(Func g, int correct) {
+    g.add_custom_lowering_pass(new CheckSelectCount(g.name(), correct));
+    g.compile_to_module(g.infer_arguments());
+}
+
 void count_sin_calls(Func g, int correct) {
     g.add_custom_lowering_pass(new CheckSinCount(correct));
     g.compile_to_module(g.infer_arguments());
@@ -125,6 +162,20 @@ int main(int argc, char **argv) {
         count_partitions(h, 5);
     }
 
+    // A constant exterior tests each dimension separately, so the
+    // selects that substitute the constant are peeled off every loop
+    // level, and none of the partitions select per element: the
+    // edges store the constant and the center stores the input.
+    {
+        Var y;
+        Func g;
+        g(x, y) = x + y;
+        g.compute_root();
+        Func h = BoundaryConditions::constant_exterior(g, 0, 0, 10, 0, 10);
+        count_partitions(h, 5);
+        count_selects(h, 0);
+    }
+
     // If you split and also have a boundary condition, or have
     // multiple boundary conditions at play (e.g. because you're
     // blurring an inlined Func that uses a boundary condition), then
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "Halide.h"
 #include "HalideRuntime.h"
 
@@ -362,6 +363,75 @@ int main(int argc, char **argv) {
         assert(call_count_with_arg == 1);
     }
 
+    {
+        // Test many distinct keys. Every key should be computed once
+        // and then hit, which exercises growing the hash tables.
+        call_count = 0;
+        Param<int32_t> coord;
+        Func count_calls;
+        count_calls.define_extern("count_calls", {}, UInt(8), 2);
+
+        Func f, g;
+        Var x, y;
+        f() = count_calls(coord, coord);
+        f.compute_root().memoize();
+        g(x, y) = f();
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int32_t i = 0; i < 1000; i++) {
+                coord.set(i);
+                Buffer<uint8_t> out = g.realize(2, 2);
+                assert(out(0, 0) == 42);
+            }
+            assert(call_count == 1000);
+        }
+    }
+
+    {
+        // Test per-Func statistics and budgets.
+        call_count = 0;
+        Param<int32_t> coord;
+        Func count_calls;
+        count_calls.define_extern("count_calls", {}, UInt(8), 2);
+
+        Func f("memoize_stats_f"), g;
+        Var x, y;
+        f() = count_calls(coord, coord);
+        f.compute_root().memoize();
+        g(x, y) = f();
+
+        // A budget of one byte leaves room for at most one result, so
+        // storing the result for coord 1 evicts the one for coord 0.
+        Internal::JITSharedRuntime::memoization_cache_set_func_size("memoize_stats_f", 1);
+        for (int32_t c : {0, 1, 0}) {
+            coord.set(c);
+            g.realize(2, 2);
+        }
+        assert(call_count == 3);
+
+        // Without the budget the results stay cached.
+        Internal::JITSharedRuntime::memoization_cache_set_func_size("memoize_stats_f", 0);
+        for (int32_t c : {2, 3, 2, 3}) {
+            coord.set(c);
+            g.realize(2, 2);
+        }
+        assert(call_count == 5);
+
+        bool found = false;
+        for (const halide_memoization_cache_func_stats_t &s :
+                 Internal::JITSharedRuntime::memoization_cache_get_stats()) {
+            if (strcmp(s.func_name, "memoize_stats_f") == 0) {
+                found = true;
+                assert(s.misses == 5);
+                assert(s.hits == 2);
+                assert(s.evictions >= 1);
+                assert(s.bytes > 0);
+                assert(s.max_bytes == 0);
+            }
+        }
+        assert(found);
+    }
+
     {
         // Test cache eviction
         Param<float> val;
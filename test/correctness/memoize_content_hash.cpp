@@ -0,0 +1,121 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+halide_memoization_cache_func_stats_t stats_for(const char *name) {
+    for (const halide_memoization_cache_func_stats_t &s :
+             Internal::JITSharedRuntime::memoization_cache_get_stats()) {
+        if (strcmp(s.func_name, name) == 0) {
+            return s;
+        }
+    }
+    halide_memoization_cache_func_stats_t none;
+    memset(&none, 0, sizeof(none));
+    return none;
+}
+
+ImageParam in(Float(32), 2, "in");
+Func f("memoize_content_hash_f"), g("g");
+Target t;
+
+// Run the pipeline on the given input over the same region, and check
+// whether f was found in the cache.
+int run(Buffer<float> input, bool expect_hit, const char *what) {
+    halide_memoization_cache_func_stats_t before = stats_for("memoize_content_hash_f");
+
+    in.set(input);
+    Buffer<float> out(input.width(), input.height());
+    out.set_min(input.dim(0).min(), input.dim(1).min());
+    g.realize(out, t);
+    for (int y = out.dim(1).min(); y <= out.dim(1).max(); y++) {
+        for (int x = out.dim(0).min(); x <= out.dim(0).max(); x++) {
+            float correct = input(x, y) * 2 + 1;
+            if (out(x, y) != correct) {
+                printf("%s: out(%d, %d) = %f instead of %f\n", what, x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    halide_memoization_cache_func_stats_t after = stats_for("memoize_content_hash_f");
+    bool hit = after.hits == before.hits + 1 && after.misses == before.misses;
+    bool miss = after.misses == before.misses + 1 && after.hits == before.hits;
+    if (expect_hit ? !hit : !miss) {
+        printf("%s: expected a %s\n", what, expect_hit ? "hit" : "miss");
+        return -1;
+    }
+    return 0;
+}
+
+Buffer<float> make_input(int w, int h) {
+    Buffer<float> b(w, h);
+    b.for_each_element([&](int x, int y) { b(x, y) = (float)(x * 7 + y * 13 % 101); });
+    return b;
+}
+
+// A dense copy of a buffer, with the same mins.
+Buffer<float> dense_copy(Buffer<float> b) {
+    Buffer<float> c(b.width(), b.height());
+    c.set_min(b.dim(0).min(), b.dim(1).min());
+    c.for_each_element([&](int x, int y) { c(x, y) = b(x, y); });
+    return c;
+}
+
+int main(int argc, char **argv) {
+    t = get_jit_target_from_environment();
+
+    Var x("x"), y("y");
+    f(x, y) = in(x, y) * 2;
+    f.compute_root().memoize(MemoizeKey::ContentHash);
+    g(x, y) = f(x, y) + 1;
+
+    // Leave room for the large results below.
+    Internal::JITSharedRuntime::memoization_cache_set_size(64 * 1024 * 1024);
+
+    // Different buffers with the same contents share a result.
+    Buffer<float> a = make_input(32, 16);
+    Buffer<float> b = make_input(32, 16);
+    if (run(a, false, "first run") != 0 ||
+        run(b, true, "copy of the input") != 0) {
+        return -1;
+    }
+    b(31, 15) += 1;
+    if (run(b, false, "changed input") != 0 ||
+        run(a, true, "original input") != 0) {
+        return -1;
+    }
+
+    // A buffer large enough to be hashed in parallel chunks.
+    Buffer<float> big = make_input(2048, 1024);
+    if (run(big, false, "large input") != 0 ||
+        run(dense_copy(big), true, "copy of the large input") != 0) {
+        return -1;
+    }
+    big(1000, 900) = -1;
+    if (run(big, false, "changed large input") != 0) {
+        return -1;
+    }
+
+    // Only the elements in a crop are hashed, in the same order as in
+    // a dense copy of it.
+    Buffer<float> crop = dense_copy(big);
+    crop.crop(0, 100, 300);
+    crop.crop(1, 50, 200);
+    if (run(crop, false, "cropped input") != 0 ||
+        run(dense_copy(crop), true, "dense copy of the crop") != 0) {
+        return -1;
+    }
+    // The same contents at a different place are a different input.
+    Buffer<float> moved = dense_copy(crop);
+    moved.set_min(0, 0);
+    if (run(moved, false, "moved crop") != 0) {
+        return -1;
+    }
+
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Halide.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+int call_count = 0;
+
+extern "C" int count_lut_calls(int scale, halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<uint8_t> buf(*out);
+        buf.for_each_element([&](int x) { buf(x) = (uint8_t)(x * scale); });
+    }
+    return 0;
+}
+
+// Run a pipeline with a memoized lookup table, and return how many
+// times the table was computed, or -1 if the output is wrong. The
+// names don't depend on the scale, only the definitions do.
+int run(const Target &t, int scale = 3) {
+    Func lut("memoize_shared_lut");
+    lut.define_extern("count_lut_calls", {scale}, UInt(8), 1);
+    lut.compute_root().memoize();
+
+    Func f("memoize_shared_f");
+    Var x("x");
+    f(x) = lut(x % 256) + 1;
+
+    call_count = 0;
+    Buffer<uint8_t> out = f.realize(1000, t);
+    for (int i = 0; i < 1000; i++) {
+        uint8_t correct = (uint8_t)((i % 256) * scale + 1);
+        if (out(i) != correct) {
+            printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+            return -1;
+        }
+    }
+    return call_count;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test on windows, which has no fork\n");
+    return 0;
+#else
+    Target t = get_jit_target_from_environment();
+    if (t.os != Target::Linux || t.has_gpu_feature()) {
+        printf("The shared memoization cache is only for Linux hosts\n");
+        return 0;
+    }
+    if (access("/dev/shm", W_OK) != 0) {
+        printf("No /dev/shm to put the segment in\n");
+        return 0;
+    }
+    t = t.with_feature(Target::MemoizeShared);
+
+    std::string segment = "/dev/shm/halide_test_memoize_shared_" + std::to_string(getpid());
+    setenv("HL_MEMOIZATION_SEGMENT", segment.c_str(), 1);
+    unlink(segment.c_str());
+
+    // Another process computes the table first. Fork before compiling
+    // anything, so that each process has its own JIT runtime.
+    pid_t child = fork();
+    if (child == 0) {
+        exit(run(t) == 1 ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("The first process did not compute the table exactly once\n");
+        unlink(segment.c_str());
+        return -1;
+    }
+
+    // This process finds the table in the segment.
+    int calls = run(t);
+    if (calls != 0) {
+        printf("The table was computed %d times in the second process instead of reused\n", calls);
+        unlink(segment.c_str());
+        return -1;
+    }
+
+    // The stats are those of both processes.
+    bool found = false;
+    for (const halide_memoization_cache_func_stats_t &s :
+             Internal::JITSharedRuntime::memoization_cache_get_stats()) {
+        if (strcmp(s.func_name, "memoize_shared_lut") == 0) {
+            found = true;
+            if (s.misses != 1 || s.hits != 1 || s.bytes < 256) {
+                printf("Stats for the table: %d misses, %d hits, %d bytes\n",
+                       (int)s.misses, (int)s.hits, (int)s.bytes);
+                unlink(segment.c_str());
+                return -1;
+            }
+        }
+    }
+    if (!found) {
+        printf("No stats for the table\n");
+        unlink(segment.c_str());
+        return -1;
+    }
+
+    // A pipeline with the same names but a different definition must
+    // not find the table in the segment.
+    calls = run(t, 5);
+    unlink(segment.c_str());
+    if (calls != 1) {
+        printf("The table with a different definition was computed %d times instead of once\n", calls);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
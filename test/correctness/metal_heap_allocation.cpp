@@ -0,0 +1,51 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::Metal)) {
+        printf("Not running test because Metal is not enabled in the target\n");
+        return 0;
+    }
+
+    // Must be set before the runtime first allocates device memory.
+    setenv("HL_METAL_HEAP_ALLOCATION", "1", 1);
+
+    // Intermediates small enough to be suballocated from a heap, and
+    // several dispatches that end up in the same command buffer.
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    h(x, y) = g(x, y - 1) * 2 - g(x, y + 1);
+
+    f.compute_root().gpu_tile(x, y, xi, yi, 8, 8);
+    g.compute_root().gpu_tile(x, y, xi, yi, 8, 8);
+    h.gpu_tile(x, y, xi, yi, 8, 8);
+
+    const int sizes[] = {64, 100, 64, 256};
+    for (int size : sizes) {
+        Buffer<int> out = h.realize(size, size, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                auto g_ref = [](int x, int y) { return ((x - 1) * 3 + y) + ((x + 1) * 3 + y); };
+                int correct = g_ref(x, y - 1) * 2 - g_ref(x, y + 1);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d at size %d\n",
+                           x, y, out(x, y), correct, size);
+                    return -1;
+                }
+            }
+        }
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
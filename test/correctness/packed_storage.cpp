@@ -0,0 +1,75 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // A bit mask, stored with dense vectors, and read both densely
+        // and at an offset.
+        Func mask, f;
+        mask(x, y) = (x + y) % 3 == 0;
+        f(x, y) = select(mask(x, y), 1, 0) + select(mask(x + 1, y), 2, 0);
+
+        mask.compute_root().store_packed(1).vectorize(x, 16, TailStrategy::RoundUp);
+        f.vectorize(x, 8);
+
+        Buffer<int> out = f.realize(100, 50);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = ((x + y) % 3 == 0 ? 1 : 0) + ((x + 1 + y) % 3 == 0 ? 2 : 0);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // Signed 4-bit weights are sign-extended when loaded.
+        Func weights, g;
+        weights(x) = cast<int8_t>(x % 16 - 8);
+        g(x) = cast<int>(weights(x)) * 3;
+
+        weights.compute_root().store_packed(4).vectorize(x, 8, TailStrategy::RoundUp);
+        g.vectorize(x, 4);
+
+        Buffer<int> out = g.realize(77);
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x % 16 - 8) * 3;
+            if (out(x) != correct) {
+                printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // 2-bit values updated one at a time, with a row per parallel
+        // task, and truncated when stored.
+        Func h, k;
+        h(x, y) = cast<uint8_t>(x + y);
+        h(x, y) += cast<uint8_t>(y);
+        k(x, y) = h(x, y);
+
+        h.compute_root().store_packed(2).parallel(y);
+        h.update().parallel(y);
+
+        Buffer<uint8_t> out = k.realize(37, 20);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = ((((x + y) & 3) + y) & 3);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+// Bounds inference runs the per-stage work of long pipelines on
+// several threads. Check that it finds the same regions, and so
+// computes the same results, as a serial run.
+
+const int stages = 40;
+const int width = 100;
+
+// Stage i reads stages i - 1 and i - 2 at different offsets, so each
+// producer's region is the union of the boxes its consumers require.
+Func make_pipeline(ImageParam in) {
+    Var x("x"), y("y");
+    std::vector<Func> s;
+    for (int i = 0; i < stages; i++) {
+        s.push_back(Func("s" + std::to_string(i)));
+    }
+    s[0](x, y) = in(x, y);
+    s[1](x, y) = s[0](x + 1, y) ^ 1;
+    for (int i = 2; i < stages; i++) {
+        s[i](x, y) = (s[i - 1](x - 1, y) + s[i - 2](x + 2, y + (i % 3) - 1)) & 0xffff;
+    }
+    for (int i = 0; i < stages - 1; i++) {
+        if (i >= stages - 4) {
+            s[i].compute_at(s[stages - 1], y);
+        } else if (i % 4 == 3) {
+            // Leave every fourth stage inlined.
+            continue;
+        } else {
+            s[i].compute_root();
+        }
+    }
+    return s[stages - 1];
+}
+
+#ifndef _WIN32
+struct Result {
+    Buffer<int> input_region;
+    Buffer<int> output;
+};
+
+Result run(const char *threads) {
+    setenv("HL_NUM_COMPILE_THREADS", threads, 1);
+
+    Result r;
+    {
+        ImageParam in(Int(32), 2, "in");
+        Func out = make_pipeline(in);
+        out.infer_input_bounds(width, width);
+        r.input_region = in.get();
+    }
+
+    {
+        ImageParam in(Int(32), 2, "in");
+        Func out = make_pipeline(in);
+        Buffer<int> in_buf(r.input_region.width(), r.input_region.height());
+        in_buf.set_min(r.input_region.min(0), r.input_region.min(1));
+        in_buf.for_each_element([&](int x, int y) {
+            in_buf(x, y) = (x * 17 + y * 31) & 0xff;
+        });
+        in.set(in_buf);
+        r.output = out.realize(width, width);
+    }
+
+    unsetenv("HL_NUM_COMPILE_THREADS");
+    return r;
+}
+#endif
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test on windows, which has no setenv\n");
+    return 0;
+#else
+    Result serial = run("1");
+    Result parallel = run("8");
+
+    for (int d = 0; d < 2; d++) {
+        if (serial.input_region.min(d) != parallel.input_region.min(d) ||
+            serial.input_region.extent(d) != parallel.input_region.extent(d)) {
+            printf("Dimension %d of the input region is [%d, %d] when bounds inference "
+                   "runs in parallel, instead of [%d, %d]\n",
+                   d, parallel.input_region.min(d), parallel.input_region.dim(d).max(),
+                   serial.input_region.min(d), serial.input_region.dim(d).max());
+            return -1;
+        }
+    }
+
+    for (int y = 0; y < width; y++) {
+        for (int x = 0; x < width; x++) {
+            if (serial.output(x, y) != parallel.output(x, y)) {
+                printf("output(%d, %d) = %d when bounds inference runs in parallel, "
+                       "instead of %d\n",
+                       x, y, parallel.output(x, y), serial.output(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Buffer<uint8_t> in(200, 150);
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            in(x, y) = (uint8_t)(x * 17 + y * 31 + (x * y) % 7);
+        }
+    }
+
+    // A histogram.
+    {
+        Func hist("hist");
+        Var x("x");
+        RDom r(in);
+        hist(x) = 0;
+        hist(clamp(in(r.x, r.y), 0, 255)) += 1;
+        hist.update(0).parallel_reduce(r.y);
+
+        Buffer<int> result = hist.realize(256);
+
+        int correct[256] = {0};
+        for (int y = 0; y < in.height(); y++) {
+            for (int x = 0; x < in.width(); x++) {
+                correct[in(x, y)]++;
+            }
+        }
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != correct[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A sum over columns, with a number of partial results that
+    // doesn't divide the reduction domain.
+    {
+        Func sum("sum");
+        Var x("x");
+        RDom r(0, in.height());
+        sum(x) = 0;
+        sum(x) += cast<int>(in(x, r));
+        sum.update(0).parallel_reduce(r, 7);
+
+        Buffer<int> result = sum.realize(in.width());
+
+        for (int x = 0; x < in.width(); x++) {
+            int correct = 0;
+            for (int y = 0; y < in.height(); y++) {
+                correct += in(x, y);
+            }
+            if (result(x) != correct) {
+                printf("sum(%d) = %d instead of %d\n", x, result(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    // An argmax, which has a Tuple-valued update.
+    {
+        Func arg_max("arg_max");
+        RDom r(0, in.width());
+        arg_max() = Tuple(0, cast<uint8_t>(0));
+        Expr better = in(r, 10) > arg_max()[1];
+        arg_max() = Tuple(select(better, r, arg_max()[0]),
+                          select(better, in(r, 10), arg_max()[1]));
+        arg_max.update(0).parallel_reduce(r);
+
+        Realization result = arg_max.realize();
+        Buffer<int> index = result[0];
+        Buffer<uint8_t> value = result[1];
+
+        int correct_index = 0;
+        uint8_t correct_value = 0;
+        for (int x = 0; x < in.width(); x++) {
+            if (in(x, 10) > correct_value) {
+                correct_index = x;
+                correct_value = in(x, 10);
+            }
+        }
+        if (index() != correct_index || value() != correct_value) {
+            printf("arg_max() = (%d, %d) instead of (%d, %d)\n",
+                   index(), value(), correct_index, correct_value);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -402,6 +402,34 @@ int vectorized_predicated_load_lut_test(const Target &t) {
     return 0;
 }
 
+int tail_strategy_predicate_test(const Target &t) {
+    const int size = 100;
+    Var x("x"), xo("xo"), xi("xi");
+    Func f("f"), g("g"), ref("ref");
+
+    g(x) = x * 3;
+    g.compute_root();
+
+    ref(x) = g(x) * 2 + 1;
+    Buffer<int> im_ref = ref.realize(size);
+
+    // The size isn't a multiple of the vector width, so the last
+    // iteration is partial, and there is no epilogue to do it in.
+    f(x) = g(x) * 2 + 1;
+    f.split(x, xo, xi, 32, TailStrategy::Predicate).vectorize(xi);
+
+    if (t.arch == Target::X86) {
+        f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(1, 1));
+    }
+
+    Buffer<int> im = f.realize(size);
+    auto func = [im_ref](int x, int y, int z) { return im_ref(x, y, z); };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -457,6 +485,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running tail strategy predicate test\n");
+    if (tail_strategy_predicate_test(t) != 0) {
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
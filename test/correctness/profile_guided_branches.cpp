@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include "test/common/halide_test_dirs.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Find the branch weights applied from the profile.
+class FindBranchWeights : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const IfThenElse *op) override {
+        const Call *c = op->condition.as<Call>();
+        if (c && c->is_intrinsic(Call::branch_weights)) {
+            taken = *as_const_int(c->args[1]);
+            not_taken = *as_const_int(c->args[2]);
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    int64_t taken = -1, not_taken = -1;
+};
+
+Func make_pipeline(Buffer<int> in) {
+    Var x("x");
+    RDom r(0, in.width(), "r");
+    // Taken nine times out of ten.
+    r.where(in(r) > 10);
+    Func f("f");
+    f(x) = 0;
+    f(r) = in(r) * 2;
+    return f;
+}
+
+int check_output(Buffer<int> in, Buffer<int> out) {
+    for (int i = 0; i < in.width(); i++) {
+        int correct = in(i) > 10 ? in(i) * 2 : 0;
+        if (out(i) != correct) {
+            printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not running on GPU targets\n");
+        return 0;
+    }
+
+#ifdef _WIN32
+    printf("Skipping test on windows, which has no setenv\n");
+    return 0;
+#else
+    const int size = 1000;
+    Buffer<int> in(size, "in");
+    for (int i = 0; i < size; i++) {
+        in(i) = (i % 10) ? 100 + i : i % 7;
+    }
+
+    std::string profile = get_test_tmp_dir() + "profile_guided_branches.txt";
+
+    // Take a profile.
+    setenv("HL_PROFILE_OUTPUT", profile.c_str(), 1);
+    Buffer<int> out = make_pipeline(in).realize(size, t.with_feature(Target::Profile)
+                                                           .with_feature(Target::ProfileBranches));
+    unsetenv("HL_PROFILE_OUTPUT");
+    if (check_output(in, out) != 0) {
+        return -1;
+    }
+
+    std::ifstream file(profile);
+    std::string line;
+    bool found = false;
+    while (std::getline(file, line)) {
+        found |= line.find("branch f 900 100 f.") == 0;
+    }
+    if (!found) {
+        printf("The profile did not count the branch of f:\n");
+        file.clear();
+        file.seekg(0);
+        while (std::getline(file, line)) {
+            printf("%s\n", line.c_str());
+        }
+        return -1;
+    }
+
+    // Compile again using the profile.
+    setenv("HL_PROFILE_INPUT", profile.c_str(), 1);
+    Func f = make_pipeline(in);
+    FindBranchWeights *weights = new FindBranchWeights;
+    f.add_custom_lowering_pass(weights);
+    out = f.realize(size, t);
+    unsetenv("HL_PROFILE_INPUT");
+    if (check_output(in, out) != 0) {
+        return -1;
+    }
+    if (weights->taken != 900 || weights->not_taken != 100) {
+        printf("The branch of f was weighted %d to %d instead of 900 to 100\n",
+               (int)weights->taken, (int)weights->not_taken);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
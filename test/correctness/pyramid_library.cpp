@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 123, H = 97, levels = 6;
+
+    Buffer<float> input(W, H, 3);
+    input.for_each_value([](float &v) { v = (rand() & 0xfff) / 4096.0f; });
+
+    Var x, y, c;
+    Func in;
+    in(x, y, c) = input(x, y, c);
+
+    Target target = get_jit_target_from_environment();
+
+    for (int schedule = 0; schedule < 2; schedule++) {
+        std::vector<Func> gaussian =
+            Pyramid::gaussian_pyramid(in, levels, {{0, W}, {0, H}});
+        std::vector<Func> laplacian = Pyramid::laplacian_pyramid(gaussian);
+        std::vector<Func> collapsed;
+        Func output = Pyramid::collapse_pyramid(laplacian, &collapsed);
+
+        if (schedule == 1) {
+            Pyramid::schedule_levels(gaussian, target);
+            // The coarsest level of the collapse is the coarsest level
+            // of the Gaussian pyramid, which is already scheduled.
+            collapsed.pop_back();
+            Pyramid::schedule_levels(collapsed, target, 2);
+        }
+
+        // Collapsing the Laplacian pyramid of an image gives back the
+        // image.
+        Buffer<float> result = output.realize(W, H, 3, target);
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    if (std::abs(result(x, y, c) - input(x, y, c)) > 1e-4f) {
+                        printf("result(%d, %d, %d) = %f instead of %f for schedule %d\n",
+                               x, y, c, result(x, y, c), input(x, y, c), schedule);
+                        return -1;
+                    }
+                }
+            }
+        }
+
+        // The coarsest level is an average of the image, and is
+        // bounded by its range.
+        Buffer<float> coarse = gaussian[levels - 1].realize(4, 4, 3, target);
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    if (coarse(x, y, c) < 0.0f || coarse(x, y, c) > 1.0f) {
+                        printf("coarse(%d, %d, %d) = %f is out of range for schedule %d\n",
+                               x, y, c, coarse(x, y, c), schedule);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
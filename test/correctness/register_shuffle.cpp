@@ -6,7 +6,8 @@ int main(int argc, char **argv) {
     Target t = get_jit_target_from_environment();
 
     if (!t.features_any_of({Target::CUDACapability50,
-                            Target::CUDACapability61})) {
+                            Target::CUDACapability61,
+                            Target::CUDACapability70})) {
         printf("This test requires cuda enabled with cuda capability 5.0 or greater\n");
         return 0;
     }
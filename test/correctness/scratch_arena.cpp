@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+// Count calls to Halide's malloc and free
+
+int mallocs = 0;
+int frees = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    __sync_fetch_and_add(&mallocs, 1);
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    __sync_fetch_and_add(&frees, 1);
+    free(((void**)ptr)[-1]);
+}
+
+int run(const Target &t, Param<int> &offset) {
+    // A chain of heap-allocated intermediates computed per row of a
+    // parallel loop, one of them with a size that is only known at
+    // runtime.
+    const int width = 200, height = 1000;
+    Func f[5];
+    Var x, y;
+    f[0](x, y) = x + y + offset;
+    for (int i = 1; i < 5; i++) {
+        f[i](x, y) = f[i-1](x, y) + f[i-1](x + i, y) * 2;
+    }
+    for (int i = 0; i < 4; i++) {
+        f[i].compute_at(f[4], y).store_in(MemoryType::Heap);
+    }
+    f[2].bound_extent(x, offset + width + 7);
+    f[4].parallel(y);
+    f[4].set_custom_allocator(my_malloc, my_free);
+
+    mallocs = frees = 0;
+    Buffer<int> out = f[4].realize(width, height, t);
+
+    // Check against a reference computed on the host.
+    Buffer<int> ref(width + 10, height);
+    ref.for_each_element([&](int x, int y) { ref(x, y) = x + y + offset.get(); });
+    for (int i = 1; i < 5; i++) {
+        Buffer<int> next(width + 10 - i * (i + 1) / 2, height);
+        next.for_each_element([&](int x, int y) { next(x, y) = ref(x, y) + ref(x + i, y) * 2; });
+        ref = next;
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (out(x, y) != ref(x, y)) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), ref(x, y));
+                exit(-1);
+            }
+        }
+    }
+    return mallocs;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Not running on GPU targets\n");
+        return 0;
+    }
+
+    Param<int> offset;
+    offset.set(0);
+
+    int without_arena = run(t, offset);
+    if (without_arena != 4 * 1000 || frees != mallocs) {
+        printf("Expected 4000 mallocs and as many frees without the arena. Got %d and %d\n",
+               without_arena, frees);
+        return -1;
+    }
+
+    // With the arenas, each thread only goes to the heap until its
+    // arena has grown to fit a row.
+    int with_arena = run(t.with_feature(Target::ScratchArena), offset);
+    if (with_arena * 4 > without_arena) {
+        printf("Expected far fewer than %d mallocs with scratch arenas. Got %d\n",
+               without_arena, with_arena);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Param<int> offset("offset");
+
+    // A constant table, which is compiled into the Module.
+    Buffer<int> table(16, "table");
+    for (int i = 0; i < 16; i++) {
+        table(i) = i * i;
+    }
+
+    Var x("x"), y("y");
+    Func g("g"), f("f");
+    g(x, y) = input(x, y) + table((x + y) & 15);
+    f(x, y) = g(x - 1, y) + g(x + 1, y) + offset;
+    f.vectorize(x, 4).parallel(y);
+    g.compute_at(f, y).vectorize(x, 4);
+    input.dim(0).set_bounds(0, 32).dim(1).set_bounds(0, 16);
+
+    Target target = get_jit_target_from_environment();
+    Module m = f.compile_to_module({input, offset}, "f", target);
+
+    std::vector<uint8_t> data = serialize_module(m);
+    Module loaded = deserialize_module(data);
+
+    std::ostringstream original_stmt, loaded_stmt;
+    original_stmt << m;
+    loaded_stmt << loaded;
+    if (original_stmt.str() != loaded_stmt.str()) {
+        printf("The deserialized Module differs from the original:\n%s\n", loaded_stmt.str().c_str());
+        return -1;
+    }
+
+    if (serialize_module(loaded) != data) {
+        printf("Serializing the deserialized Module gave different data\n");
+        return -1;
+    }
+
+    // Run the deserialized Module with the JIT.
+    Buffer<int> in(32, 16), out(30, 16);
+    out.set_min(1, 0);
+    in.for_each_element([&](int x, int y) { in(x, y) = x * 3 + y * 7; });
+    int offset_value = 5;
+
+    Internal::JITModule jit(loaded, loaded.functions().back());
+    const void *args[] = {in.raw_buffer(), &offset_value, out.raw_buffer()};
+    int result = jit.argv_function()(args);
+    if (result != 0) {
+        printf("The deserialized Module failed with error %d\n", result);
+        return -1;
+    }
+
+    for (int j = 0; j < out.height(); j++) {
+        for (int i = out.dim(0).min(); i <= out.dim(0).max(); i++) {
+            int correct = (in(i - 1, j) + table((i - 1 + j) & 15) +
+                           in(i + 1, j) + table((i + 1 + j) & 15) + offset_value);
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -49,6 +49,7 @@ struct Test {
     bool use_avx2{false};
     bool use_avx512{false};
     bool use_avx512_cannonlake{false};
+    bool use_avx512_cascadelake{false};
     bool use_avx512_knl{false};
     bool use_avx512_skylake{false};
     bool use_avx{false};
@@ -85,7 +86,8 @@ struct Test {
             .with_feature(Target::NoRuntime);
         use_avx512_knl = target.has_feature(Target::AVX512_KNL);
         use_avx512_cannonlake = target.has_feature(Target::AVX512_Cannonlake);
-        use_avx512_skylake = use_avx512_cannonlake || target.has_feature(Target::AVX512_Skylake);
+        use_avx512_cascadelake = target.has_feature(Target::AVX512_Cascadelake);
+        use_avx512_skylake = use_avx512_cannonlake || use_avx512_cascadelake || target.has_feature(Target::AVX512_Skylake);
         use_avx512 = use_avx512_knl || use_avx512_skylake || use_avx512_cannonlake || target.has_feature(Target::AVX512);
         use_avx2 = use_avx512 || target.has_feature(Target::AVX2);
         use_avx = use_avx2 || target.has_feature(Target::AVX);
@@ -627,9 +629,20 @@ struct Test {
             check("vpcmpeqq*ymm", 4, select(i64_1 == i64_2, i64(1), i64(2)));
             check("vpackusdw*ymm", 16, u16(clamp(i32_1, 0, max_u16)));
             check("vpcmpgtq*ymm", 4, select(i64_1 > i64_2, i64(1), i64(2)));
+
+            if (!use_avx512) {
+                check("vpgatherdd*ymm", 8, in_i32(i32(u8_1)));
+                check("vgatherdps*ymm", 8, in_f32(i32(u8_1)));
+                check("vpgatherdq*ymm", 4, in_i64(i32(u8_1)));
+                check("vgatherdpd*ymm", 4, in_f64(i32(u8_1)));
+            }
         }
 
         if (use_avx512) {
+            check("vpgatherdd*zmm", 16, in_i32(i32(u8_1)));
+            check("vgatherdps*zmm", 16, in_f32(i32(u8_1)));
+            check("vpgatherdq*zmm", 8, in_i64(i32(u8_1)));
+            check("vgatherdpd*zmm", 8, in_f64(i32(u8_1)));
 #if 0
             // Not yet implemented
             check("vrangeps", 16, clamp(f32_1, 3.0f, 9.0f));
@@ -652,6 +665,17 @@ struct Test {
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
         }
+        if (use_avx512_cascadelake) {
+            Expr u8_4 = in_u8(x + 48), i8_4 = in_i8(x + 48), i16_4 = in_i16(x + 48);
+            for (int w = 4; w <= 16; w *= 2) {
+                const char *suffix = w == 16 ? "*zmm" : w == 8 ? "*ymm" : "*xmm";
+                check(string("vpdpbusd") + suffix, w,
+                      i32_1 + i32(u8_1) * i32(i8_1) + i32(u8_2) * i32(i8_2) +
+                      i32(u8_3) * i32(i8_3) + i32(u8_4) * i32(i8_4));
+                check(string("vpdpwssd") + suffix, w,
+                      i32_1 + i32(i16_1) * i32(i16_2) + i32(i16_3) * i32(i16_4));
+            }
+        }
     }
 
     void check_neon_all() {
@@ -1423,6 +1447,26 @@ struct Test {
         // VTST I       -       Test Bits
         // check("vtst.32", 4, (bool1 & bool2) != 0);
 
+        if (!arm32 && target.has_feature(Target::ARMDotProd)) {
+            Expr i8_4 = in_i8(x + 48), u8_4 = in_u8(x + 48);
+            for (int w = 2; w <= 8; w *= 2) {
+                check("udot", w, u32_1 + u32(u8_1) * u8_2 + u32(u8_3) * u8_4 +
+                                 u32(u8_2) * u8_3 + u32(u8_4) * u8_1);
+                check("sdot", w, i32_1 + i32(i8_1) * i8_2 + i32(i8_3) * i8_4 +
+                                 i32(i8_2) * i8_3 + i32(i8_4) * i8_1);
+            }
+        }
+
+        if (!arm32 && target.has_feature(Target::ARMFp16)) {
+            Expr f16_1 = cast(Float(16), f32_1), f16_2 = cast(Float(16), f32_2);
+            for (int w = 1; w <= 4; w *= 2) {
+                check("fadd*.8h", 8*w, f16_1 + f16_2);
+                check("fsub*.8h", 8*w, f16_1 - f16_2);
+                check("fmul*.8h", 8*w, f16_1 * f16_2);
+                check("fmax*.8h", 8*w, max(f16_1, f16_2));
+            }
+        }
+
         // VUZP X       -       Unzip
         // VZIP X       -       Zip
         // Interleave or deinterleave two vectors. Given that we use
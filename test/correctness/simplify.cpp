@@ -1382,6 +1382,95 @@ void check_lets() {
 
 }
 
+// Finds uses of variables outside the lets that define them.
+class FindUnboundLetVars : public IRVisitor {
+    Scope<> bound;
+    const std::set<std::string> &let_names;
+
+    using IRVisitor::visit;
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(bound, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(bound, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Variable *op) override {
+        if (let_names.count(op->name) && !bound.contains(op->name)) {
+            unbound = op->name;
+        }
+    }
+
+public:
+    std::string unbound;
+    FindUnboundLetVars(const std::set<std::string> &n) : let_names(n) {}
+};
+
+// Check that simplifying a doesn't remove a let whose variable is
+// still used.
+void check_lets_kept(const Expr &a, const std::set<std::string> &let_names) {
+    Expr simpler = simplify(a);
+    FindUnboundLetVars f(let_names);
+    simpler.accept(&f);
+    if (!f.unbound.empty()) {
+        std::cerr
+            << "\nSimplification failure:\n"
+            << "Input: " << a << '\n'
+            << "Output: " << simpler << '\n'
+            << "The let defining " << f.unbound << " was removed\n";
+        abort();
+    }
+}
+
+void check_repeated_subexpressions() {
+    Expr x = Var("x"), y = Var("y"), t = Var("t"), u = Var("u");
+    Expr dummy = Call::make(Int(32), "dummy", {y}, Call::Extern);
+    Expr dummy2 = Call::make(Int(32), "dummy", {y + 1}, Call::Extern);
+
+    // Every use of a let variable in identical subexpressions must be
+    // counted, or dead let removal strips a let that is still used.
+    check_lets_kept(Let::make("t", dummy, min(t, y) + min(t, y)), {"t"});
+    check_lets_kept(Let::make("t", dummy, select(x < min(t, y), min(t, y), x)), {"t"});
+    check_lets_kept(Let::make("t", dummy, Let::make("u", t * y, (u + t) * (u + t))), {"t", "u"});
+
+    // The same, where the uses are of the part of the value that
+    // doesn't get substituted in.
+    check_lets_kept(Let::make("t", dummy + 4, (t * y) + (t * y)), {"t", "t.s"});
+    check_lets_kept(Let::make("t", dummy * 3, min(t, x) - min(t, x) + min(t, x)), {"t", "t.s"});
+
+    // Identical subexpressions inside and outside a let that shadows
+    // a variable refer to different values.
+    check(Let::make("t", dummy, min(t, y) + Let::make("t", 3, min(t, y))),
+          simplify(Let::make("t", dummy, min(t, y) + min(3, y))));
+    check(Let::make("t", 5, Let::make("t", dummy, min(t, y)) + min(t, y)),
+          simplify(Let::make("t", dummy, min(t, y)) + min(5, y)));
+    check_lets_kept(Let::make("t", dummy, min(t, y) + Let::make("t", dummy2, min(t, y))), {"t"});
+
+    // Facts learned from an if condition only hold inside the branches,
+    // so an identical subexpression outside the if must not see them.
+    Expr e = select(x < y, x + 1, y + 2);
+    check(Block::make(Evaluate::make(e),
+                      IfThenElse::make(x < y, Evaluate::make(e), Evaluate::make(e))),
+          Block::make(Evaluate::make(simplify(e)),
+                      IfThenElse::make(x < y, Evaluate::make(x + 1), Evaluate::make(y + 2))));
+    check(Block::make(IfThenElse::make(x < y, Evaluate::make(e)),
+                      Evaluate::make(e)),
+          Block::make(IfThenElse::make(x < y, Evaluate::make(x + 1)),
+                      Evaluate::make(simplify(e))));
+    check(IfThenElse::make(x < y,
+                           Evaluate::make(e),
+                           IfThenElse::make(y < x, Evaluate::make(e), Evaluate::make(e))),
+          IfThenElse::make(x < y,
+                           Evaluate::make(x + 1),
+                           IfThenElse::make(y < x, Evaluate::make(y + 2), Evaluate::make(y + 2))));
+}
+
 void check_inv(Expr before) {
     Expr after = simplify(before);
     internal_assert(before.same_as(after))
@@ -1432,6 +1521,7 @@ int main(int argc, char **argv) {
     check_boolean();
     check_overflow();
     check_bitwise();
+    check_repeated_subexpressions();
 
     // Miscellaneous cases that don't fit into one of the categories above.
     Expr x = Var("x"), y = Var("y");
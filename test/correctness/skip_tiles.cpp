@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+extern "C" DLLEXPORT int call_counter(int x) {
+    call_count++;
+    return x;
+}
+HalideExtern_1(int, call_counter, int);
+
+int test(bool mask_small_per_row) {
+    const int size = 128, tile = 16;
+    Buffer<uint8_t> mask(size, size);
+    mask.fill(0);
+    // Set a few pixels in three of the tiles.
+    mask(3, 5) = 1;
+    mask(100, 7) = 1;
+    mask(40, 120) = 1;
+    mask(41, 121) = 1;
+    const int active_tiles = 3;
+
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    RDom r(0, tile, 0, tile);
+
+    // A downsampled mask, with one value per tile.
+    Func mask_small("mask_small");
+    mask_small(xo, yo) = maximum(mask(xo * tile + r.x, yo * tile + r.y));
+
+    // An expensive producer, computed per tile.
+    Func g("g");
+    g(x, y) = call_counter(x + y * size);
+
+    Func f("f");
+    f(x, y) = -1;
+    f(x, y) = select(mask(x, y) != 0, g(x, y), f(x, y));
+
+    f.update()
+        .tile(x, y, xo, yo, xi, yi, tile, tile)
+        .skip_tiles_where(xo, mask_small(xo, yo) == 0);
+    g.compute_at(f, xo);
+    if (mask_small_per_row) {
+        mask_small.compute_at(f, yo);
+    } else {
+        mask_small.compute_root();
+    }
+
+    call_count = 0;
+    Buffer<int> out = f.realize(size, size);
+
+    if (call_count != active_tiles * tile * tile) {
+        printf("g was evaluated %d times instead of %d\n", call_count, active_tiles * tile * tile);
+        return -1;
+    }
+
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            int correct = mask(i, j) ? i + j * size : -1;
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (test(false) != 0 || test(true) != 0) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
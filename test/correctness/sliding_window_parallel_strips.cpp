@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> count(0);
+extern "C" DLLEXPORT int call_counter(int x, int y) {
+    count++;
+    return x + y;
+}
+HalideExtern_2(int, call_counter, int, int);
+
+int main(int argc, char **argv) {
+    const int w = 10, h = 32, strip = 8;
+    Var x, y;
+
+    Func f, g;
+    f(x, y) = call_counter(x, y);
+    g(x, y) = f(x, y) + f(x, y + 1);
+
+    // A line buffer, and a parallel loop over its consumer.
+    f.store_root().compute_at(g, y).slide_in_strips(strip);
+    g.parallel(y);
+
+    Buffer<int> result = g.realize(w, h);
+
+    // Each strip computes one row of f beyond the strip, once.
+    int expected = (h / strip) * (strip + 1) * w;
+    if (count != expected) {
+        printf("f was called %d times instead of %d times\n", (int)count, expected);
+        return -1;
+    }
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            int correct = (i + j) + (i + j + 1);
+            if (result(i, j) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
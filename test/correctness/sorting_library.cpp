@@ -0,0 +1,127 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    // Sorting networks of every small size.
+    for (int n = 1; n <= 12; n++) {
+        Buffer<int> input(n, 64);
+        input.for_each_value([](int &v) { v = rand() % 100; });
+
+        std::vector<Expr> values;
+        for (int i = 0; i < n; i++) {
+            values.push_back(input(i, y));
+        }
+        std::vector<Expr> sorted = Sorting::sorting_network(values);
+        Func f;
+        f(x, y) = 0;
+        for (int i = 0; i < n; i++) {
+            f(i, y) = sorted[i];
+        }
+        Buffer<int> result = f.realize(n, 64);
+
+        for (int j = 0; j < 64; j++) {
+            std::vector<int> correct;
+            for (int i = 0; i < n; i++) {
+                correct.push_back(input(i, j));
+            }
+            std::sort(correct.begin(), correct.end());
+            for (int i = 0; i < n; i++) {
+                if (result(i, j) != correct[i]) {
+                    printf("sorting_network with %d values: result(%d, %d) = %d instead of %d\n",
+                           n, i, j, result(i, j), correct[i]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A vectorized 3x3 median filter.
+    {
+        Buffer<uint8_t> input(66, 66);
+        input.for_each_value([](uint8_t &v) { v = (uint8_t)rand(); });
+
+        std::vector<Expr> window;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = 0; dx < 3; dx++) {
+                window.push_back(input(x + dx, y + dy));
+            }
+        }
+        Func median;
+        median(x, y) = Sorting::median(window);
+        median.vectorize(x, 16);
+        Buffer<uint8_t> result = median.realize(64, 64);
+
+        for (int j = 0; j < 64; j++) {
+            for (int i = 0; i < 64; i++) {
+                std::vector<uint8_t> w;
+                for (int dy = 0; dy < 3; dy++) {
+                    for (int dx = 0; dx < 3; dx++) {
+                        w.push_back(input(i + dx, j + dy));
+                    }
+                }
+                std::nth_element(w.begin(), w.begin() + 4, w.end());
+                if (result(i, j) != w[4]) {
+                    printf("median(%d, %d) = %d instead of %d\n", i, j, result(i, j), w[4]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Bitonic sort and radix sort of a whole Func.
+    {
+        const int size = 4096;
+        Buffer<uint32_t> input(size);
+        input.for_each_value([](uint32_t &v) { v = ((uint32_t)rand() << 16) ^ (uint32_t)rand(); });
+        std::vector<uint32_t> correct(input.data(), input.data() + size);
+        std::sort(correct.begin(), correct.end());
+
+        Func in;
+        in(x) = input(x);
+
+        Buffer<uint32_t> bitonic = Sorting::bitonic_sort(in, size).realize(size);
+        Buffer<uint32_t> radix = Sorting::radix_sort(in, size).realize(size);
+        for (int i = 0; i < size; i++) {
+            if (bitonic(i) != correct[i]) {
+                printf("bitonic_sort: result(%d) = %u instead of %u\n", i, bitonic(i), correct[i]);
+                return -1;
+            }
+            if (radix(i) != correct[i]) {
+                printf("radix_sort: result(%d) = %u instead of %u\n", i, radix(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    // Radix sort of a size that isn't a multiple of the chunk size,
+    // on a subset of the bits.
+    {
+        const int size = 3000;
+        Buffer<uint16_t> input(size);
+        input.for_each_value([](uint16_t &v) { v = (uint16_t)rand(); });
+
+        Func in;
+        in(x) = input(x) & 0xfff;
+        Buffer<uint16_t> radix = Sorting::radix_sort(in, size, 12).realize(size);
+
+        std::vector<uint16_t> correct;
+        for (int i = 0; i < size; i++) {
+            correct.push_back(input(i) & 0xfff);
+        }
+        std::sort(correct.begin(), correct.end());
+        for (int i = 0; i < size; i++) {
+            if (radix(i) != correct[i]) {
+                printf("radix_sort: result(%d) = %d instead of %d\n", i, radix(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
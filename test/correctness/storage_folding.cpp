@@ -97,7 +97,7 @@ int main(int argc, char **argv) {
 
         Buffer<int> im = g.realize(100, 1000, 3);
 
-        size_t expected_size = 101*4*sizeof(int) + sizeof(int);
+        size_t expected_size = 101*3*sizeof(int) + sizeof(int);
         if (custom_malloc_size == 0 || custom_malloc_size != expected_size) {
             printf("Scratch space allocated was %d instead of %d\n", (int)custom_malloc_size, (int)expected_size);
             return -1;
@@ -302,10 +302,9 @@ int main(int argc, char **argv) {
 
         // This is the same test as the above, except the stencil
         // requires 3 rows, of g, not 4. Test explicit storage folding
-        // by forcing it to fold over 3 elements. Automatic storage
-        // folding would prefer to fold by 4 elements to make modular
-        // arithmetic cheaper, but folding by 3 is valid and supported
-        // (e.g. if memory usage is a concern.)
+        // by forcing it to fold over 3 elements. (Automatic storage
+        // folding would also fold by 3, as rounding up to 4 would
+        // waste a third of the buffer.)
         g.compute_at(f, x).store_root().fold_storage(y, 3);
 
         f.set_custom_allocator(my_malloc, my_free);
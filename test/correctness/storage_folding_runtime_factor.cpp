@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+size_t custom_malloc_size = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    custom_malloc_size = x;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // A 5-tap vertical filter needs 5 scanlines of its input.
+        // That's not a power of two, but it shouldn't be rounded up
+        // to 8.
+        Func g, f;
+        g(x, y) = x * y;
+        f(x, y) = g(x, y - 2) + g(x, y - 1) + g(x, y) + g(x, y + 1) + g(x, y + 2);
+        g.store_root().compute_at(f, y);
+
+        f.set_custom_allocator(my_malloc, my_free);
+        Buffer<int> im = f.realize(100, 100);
+
+        // Halide allocates one extra scalar, so we account for that.
+        size_t expected_size = 100*5*sizeof(int) + sizeof(int);
+        if (custom_malloc_size == 0 || custom_malloc_size > expected_size) {
+            printf("Scratch space allocated was %d instead of %d\n", (int)custom_malloc_size, (int)expected_size);
+            return -1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 5 * x * y;
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // The same, with a radius only known at runtime. The fold
+        // factor has to be computed at runtime too.
+        Param<int> radius;
+        Func g, f;
+        g(x, y) = x * y;
+        f(x, y) = g(x, y - radius) + g(x, y + radius);
+        g.store_root().compute_at(f, y);
+
+        f.set_custom_allocator(my_malloc, my_free);
+
+        for (int r = 1; r <= 4; r++) {
+            custom_malloc_size = 0;
+            radius.set(r);
+            Buffer<int> im = f.realize(100, 100);
+
+            size_t expected_size = 100*(2*r + 1)*sizeof(int) + sizeof(int);
+            if (custom_malloc_size == 0 || custom_malloc_size > expected_size) {
+                printf("Scratch space allocated for radius %d was %d instead of %d\n",
+                       r, (int)custom_malloc_size, (int)expected_size);
+                return -1;
+            }
+
+            for (int y = 0; y < im.height(); y++) {
+                for (int x = 0; x < im.width(); x++) {
+                    int correct = 2 * x * y;
+                    if (im(x, y) != correct) {
+                        printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int allocations = 0;
+
+class CountAllocations : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        allocations++;
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    // A chain of pointwise compute_root stages. Each stage is dead
+    // once the next one has been computed, so all the intermediates
+    // fit in two buffers.
+    const int size = 1000;
+    const int stages = 6;
+    Var x;
+    std::vector<Func> chain(stages);
+    chain[0](x) = x;
+    for (int i = 1; i < stages; i++) {
+        chain[i](x) = chain[i - 1](x) * 2 + i;
+        chain[i - 1].compute_root();
+    }
+    Func out = chain.back();
+    out.bound(x, 0, size);
+
+    out.add_custom_lowering_pass(new CountAllocations);
+    Buffer<int> result = out.realize(size);
+
+    if (allocations != 2) {
+        printf("Expected the %d intermediates to share 2 allocations. Got %d\n",
+               stages - 1, allocations);
+        return -1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        int correct = i;
+        for (int j = 1; j < stages; j++) {
+            correct = correct * 2 + j;
+        }
+        if (result(i) != correct) {
+            printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int allocations = 0;
+
+class CountAllocations : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        allocations++;
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // A tone curve applied to a blurred image can overwrite the
+        // blurred image.
+        const int w = 64, h = 32;
+        Func input, blurred, curved, out;
+        input(x, y) = x + y * 3;
+        blurred(x, y) = (input(x, y) + input(x + 1, y)) / 2;
+        curved(x, y) = blurred(x, y) * blurred(x, y);
+        out(x, y) = curved(x, y) + curved(x, y + 1);
+
+        blurred.compute_root();
+        curved.compute_root().vectorize(x, 8, TailStrategy::GuardWithIf).store_in_place_of(blurred);
+
+        out.add_custom_lowering_pass(new CountAllocations);
+        Buffer<int> result = out.realize(w, h);
+
+        if (allocations != 1) {
+            printf("Expected one allocation shared by blurred and curved. Got %d\n", allocations);
+            return -1;
+        }
+
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                auto blur = [](int x, int y) {
+                    return ((x + y * 3) + (x + 1 + y * 3)) / 2;
+                };
+                int correct = blur(i, j) * blur(i, j) + blur(i, j + 1) * blur(i, j + 1);
+                if (result(i, j) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A Func can also overwrite a pipeline input it reads pointwise.
+        const int size = 100;
+        ImageParam input(Float(32), 1);
+        Func scaled, out;
+        scaled(x) = input(x) * 2.0f;
+        out(x) = scaled(x) + 1.0f;
+        scaled.compute_root().store_in_place_of(input);
+
+        Buffer<float> in(size);
+        in.for_each_element([&](int i) { in(i) = (float)i; });
+        input.set(in);
+
+        Buffer<float> result = out.realize(size);
+        for (int i = 0; i < size; i++) {
+            if (result(i) != i * 2.0f + 1.0f) {
+                printf("result(%d) = %f instead of %f\n", i, result(i), i * 2.0f + 1.0f);
+                return -1;
+            }
+            if (in(i) != i * 2.0f) {
+                printf("in(%d) = %f instead of %f\n", i, in(i), i * 2.0f);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int nontemporal_stores = 0;
+
+class CountNontemporalStores : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Store *op) override {
+        const Call *c = op->value.as<Call>();
+        if (c && c->is_intrinsic(Call::nontemporal)) {
+            nontemporal_stores++;
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    const int w = 256, h = 64;
+
+    Var x, y;
+    Func in, out;
+    in(x, y) = x + y;
+    out(x, y) = in(x, y) * 3 + in(x + 1, y);
+
+    in.compute_root();
+    out.vectorize(x, 8).parallel(y).store_nontemporal();
+
+    out.add_custom_lowering_pass(new CountNontemporalStores);
+    Buffer<int> result = out.realize(w, h);
+
+    if (nontemporal_stores == 0) {
+        printf("Expected the stores to out to be marked non-temporal\n");
+        return -1;
+    }
+
+    for (int yi = 0; yi < h; yi++) {
+        for (int xi = 0; xi < w; xi++) {
+            int correct = (xi + yi) * 3 + (xi + 1 + yi);
+            if (result(xi, yi) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       xi, yi, result(xi, yi), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
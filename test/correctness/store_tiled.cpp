@@ -0,0 +1,58 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y, c;
+
+    for (bool morton : {false, true}) {
+        // A separable blur whose intermediate is read down columns.
+        Func in, blur_y, blur_x;
+        in(x, y) = x * 3 + y * 5;
+        blur_y(x, y) = in(x, y - 1) + in(x, y) + in(x, y + 1);
+        blur_x(x, y) = blur_y(x - 1, y) + blur_y(x, y) + blur_y(x + 1, y);
+
+        in.compute_root().store_tiled(x, y, 8, 8, morton);
+        blur_y.compute_root().store_tiled(x, y, 16, 16, morton).vectorize(x, 4);
+
+        // The output isn't a multiple of the tile size.
+        Buffer<int> out = blur_x.realize(101, 37);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = 9 * (x * 3 + y * 5);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A transpose of an interleaved intermediate, tiled in its
+        // outer dimensions.
+        Func f, g;
+        f(c, x, y) = c + x * 3 + y * 1000;
+        g(x, y, c) = f(c, y, x);
+
+        f.compute_root().store_tiled(x, y, 4, 32);
+
+        Buffer<int> out = g.realize(50, 60, 3);
+        for (int c = 0; c < out.channels(); c++) {
+            for (int y = 0; y < out.height(); y++) {
+                for (int x = 0; x < out.width(); x++) {
+                    int correct = c + y * 3 + x * 1000;
+                    if (out(x, y, c) != correct) {
+                        printf("out(%d, %d, %d) = %d instead of %d\n",
+                               x, y, c, out(x, y, c), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
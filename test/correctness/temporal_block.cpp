@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> count(0);
+extern "C" DLLEXPORT int call_counter(int x, int y) {
+    count++;
+    return x + y;
+}
+HalideExtern_2(int, call_counter, int, int);
+
+const int stages = 6;
+
+// A chain of stencils that reach one pixel either way along x, and
+// one pixel up and two down along y.
+Func stencil_chain(bool blocked, bool vectorized) {
+    Var x, y;
+    Func input;
+    input(x, y) = (x * 7 + y * 13) % 17;
+
+    Func prev = input;
+    for (int k = 0; k < stages; k++) {
+        Func f("stage_" + std::to_string(k));
+        Expr e = prev(x - 1, y) + 2 * prev(x + 1, y - 1) + 3 * prev(x, y + 2);
+        f(x, y) = blocked ? call_counter(e % 1000, k) : e % 1000 + k;
+        f.compute_root();
+        if (blocked) {
+            f.temporal_block(x, y, 16, 8);
+        }
+        if (vectorized) {
+            f.vectorize(x, 4);
+        }
+        prev = f;
+    }
+
+    Func out;
+    out(x, y) = prev(x, y);
+    return out;
+}
+
+int main(int argc, char **argv) {
+    const int w = 50, h = 37;
+
+    Buffer<int> correct = stencil_chain(false, false).realize(w, h);
+
+    Buffer<int> result = stencil_chain(true, false).realize(w, h);
+
+    // Each stage is computed once over the region the next one needs,
+    // which grows by 2 along x and by 3 along y per stage.
+    int expected = 0;
+    for (int k = 0; k < stages; k++) {
+        expected += (w + 2 * k) * (h + 3 * k);
+    }
+    if (count != expected) {
+        printf("The stages were computed at %d points instead of %d\n", (int)count, expected);
+        return -1;
+    }
+
+    Buffer<int> vectorized = stencil_chain(true, true).realize(w, h);
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            if (result(i, j) != correct(i, j)) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct(i, j));
+                return -1;
+            }
+            if (vectorized(i, j) != correct(i, j)) {
+                printf("vectorized(%d, %d) = %d instead of %d\n", i, j, vectorized(i, j), correct(i, j));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
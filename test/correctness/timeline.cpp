@@ -0,0 +1,59 @@
+#include "Halide.h"
+#include "test/common/halide_test_dirs.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    std::string filename = Internal::get_test_tmp_dir() + "timeline.json";
+    Internal::ensure_no_file_exists(filename);
+
+    // Must be set before the runtime first records an event.
+    setenv("HL_TIMELINE_FILE", filename.c_str(), 1);
+
+    Func f;
+    Var x, y;
+    f(x, y) = x + y;
+    f.parallel(y);
+    Buffer<int> out = f.realize(100, 16);
+
+    // Write the timeline out now, rather than at exit.
+    Expr flush = Internal::Call::make(Int(32), "halide_timeline_flush", {}, Internal::Call::Extern);
+    if (evaluate<int>(flush) != 0) {
+        printf("halide_timeline_flush failed\n");
+        return -1;
+    }
+
+    std::ifstream in(filename);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string json = contents.str();
+
+    if (json.find("\"traceEvents\"") == std::string::npos) {
+        printf("No trace events in timeline:\n%s\n", json.c_str());
+        return -1;
+    }
+
+    // Every iteration of the parallel loop should have been recorded
+    // as a task, either individually or as part of a batch.
+    int tasks = 0;
+    for (size_t pos = json.find("\"cat\": \"task\""); pos != std::string::npos;
+         pos = json.find("\"cat\": \"task\"", pos + 1)) {
+        tasks++;
+    }
+    if (tasks == 0 || tasks > 16) {
+        printf("Expected between 1 and 16 task events. Got %d:\n%s\n", tasks, json.c_str());
+        return -1;
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "Halide.h"
+#include "test/common/halide_test_dirs.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    #ifdef _WIN32
+    printf("Test skipped on windows due to use of setenv\n");
+    #else
+    std::string filename = Internal::get_test_tmp_dir() + "tracing_sampled.bin";
+    Internal::ensure_no_file_exists(filename);
+
+    // Must be set before the first trace event.
+    setenv("HL_TRACE_FILE", filename.c_str(), 1);
+    setenv("HL_TRACE_SAMPLE", "10", 1);
+
+    const int width = 1000, height = 64;
+    Func f;
+    Var x, y;
+    f(x, y) = x + y;
+    f.parallel(y).trace_stores();
+    f.realize(width, height);
+
+    // Close the trace file to make sure everything is written.
+    Expr shutdown = Internal::Call::make(Int(32), "halide_shutdown_trace", {}, Internal::Call::Extern);
+    if (evaluate<int>(shutdown) != 0) {
+        printf("halide_shutdown_trace failed\n");
+        return -1;
+    }
+
+    std::ifstream in(filename, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Walk the packets, counting the stores, and checking that the
+    // end of the pipeline comes after all of them.
+    int stores = 0, stores_after_end = 0;
+    bool seen_end = false;
+    size_t pos = 0;
+    while (pos + sizeof(halide_trace_packet_t) <= data.size()) {
+        const halide_trace_packet_t *p = (const halide_trace_packet_t *)(&data[pos]);
+        if (p->size < sizeof(halide_trace_packet_t) || pos + p->size > data.size()) {
+            printf("Malformed packet at offset %d\n", (int)pos);
+            return -1;
+        }
+        if (p->event == halide_trace_store) {
+            stores++;
+            if (seen_end) {
+                stores_after_end++;
+            }
+        } else if (p->event == halide_trace_end_pipeline) {
+            seen_end = true;
+        }
+        pos += p->size;
+    }
+    if (pos != data.size()) {
+        printf("Trailing bytes in trace file\n");
+        return -1;
+    }
+
+    if (!seen_end || stores_after_end) {
+        printf("Stores were written after the end of the pipeline\n");
+        return -1;
+    }
+
+    // Stores are sampled independently on each thread, so allow for
+    // rounding on each one.
+    const int total = width * height;
+    if (stores < total / 10 || stores > total / 10 + height) {
+        printf("Expected about %d sampled stores. Got %d\n", total / 10, stores);
+        return -1;
+    }
+    #endif
+
+    printf("Success!\n");
+    return 0;
+}
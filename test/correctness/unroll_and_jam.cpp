@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    Buffer<int> input(70, 55);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 13 + y * 7) % 31;
+    });
+
+    {
+        // A vertical stencil, computing four rows in each iteration of
+        // the vectorized loop over x, including a partial block of rows
+        // at the end.
+        Func blur("blur");
+        blur(x, y) = input(x, y) + input(x, y + 1) * 2 + input(x, y + 2);
+        blur.unroll_and_jam(y, 4, TailStrategy::GuardWithIf).vectorize(x, 8);
+
+        Buffer<int> out = blur.realize(64, 53);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = input(x, y) + input(x, y + 1) * 2 + input(x, y + 2);
+                if (out(x, y) != correct) {
+                    printf("blur(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A matrix-vector style reduction, with a pure var jammed into
+        // the loop over the reduction domain.
+        Func sum("sum");
+        RDom r(0, 16);
+        sum(x, y) = 0;
+        sum(x, y) += input(x + r, y);
+        sum.update().reorder(r, x, y).unroll_and_jam(y, 2).unroll_and_jam(x, 2);
+
+        Buffer<int> out = sum.realize(50, 40);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = 0;
+                for (int i = 0; i < 16; i++) {
+                    correct += input(x + i, y);
+                }
+                if (out(x, y) != correct) {
+                    printf("sum(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
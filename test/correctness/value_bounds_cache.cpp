@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// The value bounds of each Func are cached across lowerings, keyed on
+// its definition. Lower pipelines that use the same names with
+// different definitions and schedules, and check that the region of
+// the input read, which depends on those value bounds, is always
+// right.
+
+Var x("x");
+
+// Returns the region of the input read by out(x) = in(g(x)), where
+// g(x) = f(x) + offset and f(x) = clamp(x, 10, hi).
+Buffer<float> input_read(int hi, int offset, bool compute_root) {
+    ImageParam in(Float(32), 1, "in");
+    Func f("f"), g("g"), out("out");
+
+    f(x) = clamp(x, 10, hi);
+    g(x) = f(x) + offset;
+    out(x) = in(g(x));
+
+    if (compute_root) {
+        f.compute_root();
+        g.compute_root();
+    }
+
+    out.infer_input_bounds(1024);
+    return in.get();
+}
+
+int check(int hi, int offset, bool compute_root) {
+    Buffer<float> in_buf = input_read(hi, offset, compute_root);
+    int min = 10 + offset, extent = hi - 10 + 1;
+    if (in_buf.min(0) != min || in_buf.extent(0) != extent) {
+        printf("With hi = %d, offset = %d and compute_root = %d, the input read was "
+               "[%d, %d] instead of [%d, %d]\n",
+               hi, offset, compute_root, in_buf.min(0), in_buf.min(0) + in_buf.extent(0) - 1,
+               min, min + extent - 1);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // The same definitions lowered twice, so the second time hits the cache.
+    if (check(20, 0, true) != 0) return -1;
+    if (check(20, 0, true) != 0) return -1;
+
+    // Only the schedule changes.
+    if (check(20, 0, false) != 0) return -1;
+    if (check(20, 0, true) != 0) return -1;
+
+    // f's definition changes. g's definition doesn't, but its value
+    // bounds depend on f's.
+    if (check(30, 0, true) != 0) return -1;
+    if (check(15, 0, false) != 0) return -1;
+
+    // g's definition changes.
+    if (check(15, 5, true) != 0) return -1;
+    if (check(15, 0, true) != 0) return -1;
+
+    printf("Success!\n");
+    return 0;
+}
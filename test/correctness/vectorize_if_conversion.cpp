@@ -0,0 +1,107 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that a vectorized store was if-converted, either by masking it
+// or by blending it with the old contents of memory, rather than
+// scalarizing the loop.
+class CheckIfConverted : public IRMutator2 {
+    class CountIfConvertedStores : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const Store *op) override {
+            if (op->value.type().is_vector() &&
+                (!is_one(op->predicate) || op->value.as<Select>())) {
+                count++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int count = 0;
+    };
+
+    std::string name;
+
+public:
+    CheckIfConverted(const std::string &n) : name(n) {}
+
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountIfConvertedStores c;
+        s.accept(&c);
+        if (c.count == 0) {
+            printf("The stores to %s were not if-converted:\n", name.c_str());
+            std::cout << s << "\n";
+            exit(-1);
+        }
+        return s;
+    }
+};
+
+template<typename T>
+int test(int vector_width, bool expensive) {
+    const int size = 1000;
+    Buffer<uint8_t> mask(size);
+    Buffer<T> input(size);
+    for (int i = 0; i < size; i++) {
+        // Mostly inactive, with some runs of active lanes.
+        mask(i) = (i % 37) < 5 || (i % 101) == 3;
+        input(i) = (T)(i * 7);
+    }
+
+    Var x("x");
+    Func f("f");
+    RDom r(0, size);
+    // An early-out on a value loaded from memory. The branch is
+    // safe to run on every lane, so it can be if-converted.
+    r.where(mask(r) != 0);
+
+    Expr value = input(r) * 3 + 1;
+    if (expensive) {
+        for (int i = 0; i < 8; i++) {
+            value = value * value + input(r) * (T)i;
+        }
+    }
+
+    f(x) = cast<T>(17);
+    f(r) = value;
+    f.update().vectorize(r, vector_width);
+    f.add_custom_lowering_pass(new CheckIfConverted(f.name()));
+
+    Buffer<T> out = f.realize(size);
+
+    for (int i = 0; i < size; i++) {
+        T correct = 17;
+        if (mask(i)) {
+            T in = input(i);
+            correct = (T)(in * 3 + 1);
+            if (expensive) {
+                for (int j = 0; j < 8; j++) {
+                    correct = (T)(correct * correct + in * (T)j);
+                }
+            }
+        }
+        if (out(i) != correct) {
+            printf("out(%d) = %d instead of %d\n", i, (int)out(i), (int)correct);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    for (int expensive = 0; expensive < 2; expensive++) {
+        if (test<int32_t>(8, expensive) != 0 ||
+            test<uint8_t>(16, expensive) != 0 ||
+            test<uint16_t>(8, expensive) != 0) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
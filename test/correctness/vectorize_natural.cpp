@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CheckStoreWidth : public IRMutator2 {
+    std::string name;
+    int lanes;
+public:
+    CheckStoreWidth(const std::string &name, int lanes) : name(name), lanes(lanes) {}
+    using IRMutator2::visit;
+
+    Stmt visit(const Store *op) override {
+        if (op->name == name && op->value.type().lanes() != lanes) {
+            printf("Store to %s has %d lanes instead of %d\n",
+                   name.c_str(), op->value.type().lanes(), lanes);
+            exit(-1);
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    const int W = 256, H = 8;
+    Buffer<uint8_t> input(W + 1, H);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (uint8_t)(x * 7 + y * 13);
+        }
+    }
+
+    Var x("x"), y("y");
+
+    // uint8 loads widened to int32. The width should be a whole
+    // vector of uint8, unless that's more than four vectors of int32.
+    {
+        Func f("f");
+        f(x, y) = cast<int32_t>(input(x, y)) + cast<int32_t>(input(x + 1, y)) * 3;
+        f.vectorize_natural(x);
+        int lanes = std::min(t.natural_vector_size<uint8_t>(), 4 * t.natural_vector_size<int32_t>());
+        f.add_custom_lowering_pass(new CheckStoreWidth("f", lanes));
+
+        Buffer<int32_t> out = f.realize(W, H, t);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int32_t correct = input(x, y) + input(x + 1, y) * 3;
+                if (out(x, y) != correct) {
+                    printf("f(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A purely 8-bit pipeline, with a size that isn't a multiple of
+    // the vector width.
+    {
+        Func g("g");
+        g(x, y) = input(x, y) / 2 + input(x + 1, y) / 2;
+        g.vectorize_natural(x, TailStrategy::GuardWithIf);
+        g.add_custom_lowering_pass(new CheckStoreWidth("g", t.natural_vector_size<uint8_t>()));
+
+        Buffer<uint8_t> out = g.realize(W - 3, H, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                uint8_t correct = input(x, y) / 2 + input(x + 1, y) / 2;
+                if (out(x, y) != correct) {
+                    printf("g(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f");
+    Var x("x");
+    RDom r(0, 100);
+
+    f(x) = 0;
+    f(r % 10) = f(r % 10) * 2 + r;
+
+    // The update isn't associative, so its result depends on the order
+    // the iterations run in, and it can't be performed atomically.
+    f.update(0).atomic().parallel(r);
+
+    f.realize(10);
+
+    printf("Success!\n");
+    return 0;
+}
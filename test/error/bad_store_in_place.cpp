@@ -0,0 +1,23 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f"), g("g"), h("h");
+    Var x("x");
+
+    f(x) = x;
+    // g reads f at a neighbouring site, which it would have
+    // overwritten already.
+    g(x) = f(x) + f(x + 1);
+    h(x) = g(x);
+
+    f.compute_root();
+    g.compute_root().store_in_place_of(f);
+
+    h.realize(10);
+
+    printf("There should have been an error\n");
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+
+    // Outputs are stored in the caller's buffers, which can't be
+    // tiled.
+    f.store_tiled(x, y, 8, 8);
+
+    Buffer<int> result = f.realize(16, 16);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "distributed.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+// Runs each rank on a thread of its own, and passes the messages
+// between them in memory.
+const int num_ranks = 3;
+thread_local int current_rank = 0;
+
+std::mutex comm_mutex;
+std::condition_variable comm_cond;
+
+// Messages in flight, keyed by source and destination. The ranks
+// share one runtime, and so the counter the tags come from, so the
+// tags don't match up. Messages between two ranks arrive in the order
+// they were sent, which is enough.
+std::map<std::pair<int, int>, std::vector<std::vector<char>>> mailboxes;
+
+// The contributions to the allgather in progress.
+std::vector<char> allgather_slots[num_ranks];
+int barrier_count = 0, barrier_generation = 0;
+
+void barrier(std::unique_lock<std::mutex> &lock) {
+    int generation = barrier_generation;
+    if (++barrier_count == num_ranks) {
+        barrier_count = 0;
+        barrier_generation++;
+        comm_cond.notify_all();
+    } else {
+        comm_cond.wait(lock, [&]() { return barrier_generation != generation; });
+    }
+}
+
+struct Request {
+    void *data;
+    size_t size;
+    int src, tag;
+};
+
+int rank(void *user_context) {
+    return current_rank;
+}
+
+int get_num_ranks(void *user_context) {
+    return num_ranks;
+}
+
+int allgather(void *user_context, const void *send, void *recv, size_t size) {
+    std::unique_lock<std::mutex> lock(comm_mutex);
+    allgather_slots[current_rank].assign((const char *)send, (const char *)send + size);
+    barrier(lock);
+    for (int r = 0; r < num_ranks; r++) {
+        memcpy((char *)recv + r * size, allgather_slots[r].data(), size);
+    }
+    // Nobody may start the next allgather until everyone has read
+    // this one.
+    barrier(lock);
+    return 0;
+}
+
+int isend(void *user_context, const void *data, size_t size, int dest, int tag, void **request) {
+    std::lock_guard<std::mutex> lock(comm_mutex);
+    mailboxes[std::make_pair(current_rank, dest)].emplace_back((const char *)data, (const char *)data + size);
+    comm_cond.notify_all();
+    // Sends are buffered, so there is nothing to wait for.
+    *request = new Request{nullptr, 0, 0, 0};
+    return 0;
+}
+
+int irecv(void *user_context, void *data, size_t size, int src, int tag, void **request) {
+    *request = new Request{data, size, src, tag};
+    return 0;
+}
+
+int wait(void *user_context, void *request) {
+    Request *r = (Request *)request;
+    int result = 0;
+    if (r->data) {
+        std::unique_lock<std::mutex> lock(comm_mutex);
+        auto &box = mailboxes[std::make_pair(r->src, current_rank)];
+        comm_cond.wait(lock, [&]() { return !box.empty(); });
+        if (box.front().size() != r->size) {
+            printf("Rank %d received %d bytes from rank %d instead of %d\n",
+                   current_rank, (int)box.front().size(), r->src, (int)r->size);
+            result = -1;
+        } else {
+            memcpy(r->data, box.front().data(), r->size);
+        }
+        box.erase(box.begin());
+    }
+    delete r;
+    return result;
+}
+
+const halide_distributed_comm_t fake_comm = {rank, get_num_ranks, allgather, isend, irecv, wait};
+
+int clamp(int x, int lo, int hi) {
+    return std::min(std::max(x, lo), hi);
+}
+
+int check(const Buffer<int32_t> &input, const Buffer<int32_t> &out, int rank) {
+    auto in = [&](int x, int y) {
+        return input(clamp(x, 0, input.width() - 1), clamp(y, 0, input.height() - 1));
+    };
+    auto blur_x = [&](int x, int y) {
+        return in(x - 1, y) + in(x, y) + in(x + 1, y);
+    };
+    auto blur_y = [&](int x, int y) {
+        return blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    };
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = blur_y(x, y) + blur_y(x, y + 2);
+            if (out(x, y) != correct) {
+                printf("Rank %d: out(%d, %d) = %d instead of %d\n", rank, x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Buffer<int32_t> input(64, 50);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 17 + y * 31) % 101;
+    });
+
+    // A single rank computes everything.
+    {
+        Buffer<int32_t> out(64, 50);
+        if (distributed(input, out) != 0 || check(input, out, 0) != 0) {
+            return -1;
+        }
+    }
+
+    // Each rank computes its slice of the distributed Funcs, and
+    // receives the rest of them from the other ranks.
+    halide_set_distributed_comm(&fake_comm);
+    for (int i = 0; i < 2; i++) {
+        std::vector<Buffer<int32_t>> outs;
+        std::vector<int> results(num_ranks);
+        for (int r = 0; r < num_ranks; r++) {
+            outs.emplace_back(64, 50);
+            outs.back().fill(0);
+        }
+        std::vector<std::thread> threads;
+        for (int r = 0; r < num_ranks; r++) {
+            threads.emplace_back([&, r]() {
+                current_rank = r;
+                results[r] = distributed(input, outs[r]);
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        for (int r = 0; r < num_ranks; r++) {
+            if (results[r] != 0) {
+                printf("Rank %d failed with %d\n", r, results[r]);
+                return -1;
+            }
+            if (check(input, outs[r], r) != 0) {
+                return -1;
+            }
+        }
+        for (const auto &m : mailboxes) {
+            if (!m.second.empty()) {
+                printf("Messages were left undelivered\n");
+                return -1;
+            }
+        }
+    }
+    halide_set_distributed_comm(nullptr);
+
+    printf("Success!\n");
+    return 0;
+}
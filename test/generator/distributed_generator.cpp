@@ -0,0 +1,29 @@
+#include "Halide.h"
+
+namespace {
+
+class Distributed : public Halide::Generator<Distributed> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+        Func blur_x, blur_y;
+        blur_x(x, y) = clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y);
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+        output(x, y) = blur_y(x, y) + blur_y(x, y + 2);
+
+        // blur_y is distributed like blur_x, so it can compute the
+        // interior of its slice while the halo of blur_x arrives. The
+        // output isn't, so every rank needs all of blur_y.
+        blur_x.compute_root().distribute(y).parallel(y);
+        blur_y.compute_root().distribute(y).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Distributed, distributed)
@@ -0,0 +1,118 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_frame_pipeline.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <thread>
+
+#include "frame_pipeline.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+const int W = 200, H = 100, frames = 50;
+
+// What frame_pipeline computes, for checking.
+Buffer<float> reference_stage(const Buffer<float> &in, float gain) {
+    Buffer<float> out(W, H);
+    out.for_each_element([&](int x, int y) {
+        out(x, y) = gain * (in(std::max(x - 1, 0), y) + in(x, y) + in(std::min(x + 1, W - 1), y));
+    });
+    return out;
+}
+
+void make_frame(Buffer<float> &frame, int f) {
+    frame.for_each_element([&](int x, int y) {
+        frame(x, y) = (float)((x + y * 3 + f * 7) % 17);
+    });
+}
+
+int main(int argc, char **argv) {
+    const float gains[] = {0.5f, 0.25f, 2.0f};
+
+    // Three stages, each an instance of the same AOT pipeline.
+    {
+        FramePipeline pipe(halide_type_of<float>(), {W, H});
+        for (float gain : gains) {
+            pipe.add_stage([=](halide_buffer_t *in, halide_buffer_t *out) {
+                return frame_pipeline(in, gain, out);
+            }, halide_type_of<float>(), {W, H});
+        }
+        pipe.start();
+
+        std::thread producer([&]() {
+            for (int f = 0; f < frames; f++) {
+                if (!pipe.push([&](Buffer<void> &frame) {
+                        Buffer<float> typed(frame);
+                        make_frame(typed, f);
+                    })) {
+                    break;
+                }
+            }
+            pipe.close();
+        });
+
+        int popped = 0;
+        bool ok = true;
+        while (pipe.pop([&](const Buffer<void> &frame) {
+            Buffer<float> expected(W, H);
+            make_frame(expected, popped);
+            for (float gain : gains) {
+                expected = reference_stage(expected, gain);
+            }
+            Buffer<const float> result(frame);
+            result.for_each_element([&](int x, int y) {
+                if (ok && result(x, y) != expected(x, y)) {
+                    printf("frame %d: output(%d, %d) = %f instead of %f\n",
+                           popped, x, y, result(x, y), expected(x, y));
+                    ok = false;
+                }
+            });
+            popped++;
+        })) {
+        }
+        producer.join();
+        pipe.join();
+
+        if (!ok) {
+            return -1;
+        }
+        if (popped != frames || pipe.error() != 0) {
+            printf("Popped %d of %d frames, error %d\n", popped, frames, pipe.error());
+            return -1;
+        }
+    }
+
+    // A failing stage stops the whole pipeline and reports its error.
+    {
+        FramePipeline pipe(halide_type_of<float>(), {W, H});
+        int calls = 0;
+        pipe.add_stage([&](halide_buffer_t *in, halide_buffer_t *out) {
+            return ++calls == 3 ? -7 : frame_pipeline(in, 1.0f, out);
+        }, halide_type_of<float>(), {W, H});
+        pipe.start();
+
+        std::thread producer([&]() {
+            for (int f = 0; f < frames; f++) {
+                if (!pipe.push([&](Buffer<void> &frame) {})) {
+                    break;
+                }
+            }
+            pipe.close();
+        });
+        int popped = 0;
+        while (pipe.pop([&](const Buffer<void> &) { popped++; })) {
+        }
+        producer.join();
+        pipe.join();
+
+        if (pipe.error() != -7 || popped > 2) {
+            printf("Failing stage: error %d after %d frames\n", pipe.error(), popped);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include "Halide.h"
+
+namespace {
+
+class FramePipelineStage : public Halide::Generator<FramePipelineStage> {
+public:
+    Input<Buffer<float>> input{"input", 2};
+    Input<float> gain{"gain"};
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+        output(x, y) = gain * (clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y));
+        output.parallel(y).vectorize(x, 8, TailStrategy::GuardWithIf);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(FramePipelineStage, frame_pipeline)
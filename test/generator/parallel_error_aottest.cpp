@@ -0,0 +1,87 @@
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "parallel_error.h"
+
+using namespace Halide::Runtime;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+const int failure_code = -42;
+
+std::atomic<int> tiles(0), errors(0);
+
+// Copies its input, and fails if any of it is negative.
+extern "C" DLLEXPORT
+int checked_stage(halide_buffer_t *input, halide_buffer_t *output) {
+    if (input->is_bounds_query()) {
+        for (int d = 0; d < 3; d++) {
+            input->dim[d].min = output->dim[d].min;
+            input->dim[d].extent = output->dim[d].extent;
+        }
+        return 0;
+    }
+    tiles++;
+    Buffer<int> in(*input), out(*output);
+    bool failed = false;
+    out.for_each_element([&](int x, int y, int z) {
+        failed = failed || in(x, y, z) < 0;
+        out(x, y, z) = in(x, y, z);
+    });
+    return failed ? failure_code : 0;
+}
+
+void my_halide_error(void *user_context, const char *msg) {
+    errors++;
+}
+
+int main(int argc, char **argv) {
+    halide_set_error_handler(&my_halide_error);
+
+    const int width = 64, height = 64, channels = 4;
+    Buffer<int> input(width, height, channels);
+    input.fill([](int x, int y, int z) { return x + y * width + z * width * height; });
+    Buffer<int> output(width, height, channels);
+
+    int result = parallel_error(input, output);
+    if (result != 0) {
+        printf("parallel_error returned %d\n", result);
+        return -1;
+    }
+    if (tiles != (height / 16) * channels || errors != 0) {
+        printf("The extern stage ran on %d tiles with %d errors, instead of %d tiles\n",
+               (int)tiles, (int)errors, (height / 16) * channels);
+        return -1;
+    }
+    output.for_each_element([&](int x, int y, int z) {
+        int correct = (input(x, y, z) + 1) * 2;
+        if (output(x, y, z) != correct) {
+            printf("output(%d, %d, %d) = %d instead of %d\n",
+                   x, y, z, output(x, y, z), correct);
+            exit(-1);
+        }
+    });
+
+    // Make a single tile fail. The error must be returned out of both
+    // parallel loops.
+    input(10, 40, 2) = -10;
+    result = parallel_error(input, output);
+    if (result != failure_code) {
+        printf("parallel_error returned %d instead of %d\n", result, failure_code);
+        return -1;
+    }
+    if (errors == 0) {
+        printf("The failure of the extern stage was not reported\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
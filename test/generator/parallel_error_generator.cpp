@@ -0,0 +1,37 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+class ParallelError : public Generator<ParallelError> {
+    Input<Buffer<int>> input{ "input", 3 };
+    Output<Buffer<int>> output{ "output", 3 };
+
+    Func work, checked;
+    Var x, y, z, yo, yi;
+
+public:
+    void generate() {
+        work(x, y, z) = input(x, y, z) + 1;
+
+        // The extern stage fails on some tiles, so each parallel
+        // loop has an error path out of its body.
+        std::vector<ExternFuncArgument> params = {work};
+        checked.define_extern("checked_stage", params, Int(32), {x, y, z});
+
+        output(x, y, z) = checked(x, y, z) * 2;
+    }
+
+    void schedule() {
+        // Nested parallel loops, with the failing stage inside the
+        // inner one.
+        output.split(y, yo, yi, 16).parallel(z).parallel(yo);
+        checked.compute_at(output, yo);
+        work.compute_at(output, yo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ParallelError, parallel_error)
@@ -0,0 +1,116 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "halide_parallel_runtime.h"
+#include "parallel_runtime.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+namespace {
+
+// Runs everything on the calling thread, so a pipeline can only
+// complete if waiting for async producers never blocks.
+class SerialExecutor : public Executor {
+public:
+    int concurrency() override {
+        return 1;
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+    }
+};
+
+// Runs each call on a thread of its own, so that loops really do run
+// concurrently, and nested loops get threads of their own.
+class ThreadExecutor : public Executor {
+    int threads;
+
+public:
+    explicit ThreadExecutor(int threads) : threads(threads) {}
+
+    int concurrency() override {
+        return threads;
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            for (int i = next++; i < n; i = next++) {
+                f(i);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int i = 1; i < std::min(n, threads); i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &t : pool) {
+            t.join();
+        }
+    }
+};
+
+int check(Executor *executor, const char *name, const Buffer<float> &reference) {
+    set_parallel_runtime(executor);
+    Buffer<float> out(reference.width(), reference.height(), reference.channels());
+    for (int i = 0; i < 3; i++) {
+        out.fill(0.0f);
+        int ret = parallel_runtime(out);
+        if (ret) {
+            printf("Non zero exit code with %s executor: %d\n", name, ret);
+            return -1;
+        }
+        for (int z = 0; z < out.channels(); z++) {
+            for (int y = 0; y < out.height(); y++) {
+                for (int x = 0; x < out.width(); x++) {
+                    if (out(x, y, z) != reference(x, y, z)) {
+                        printf("out(%d, %d, %d) = %f instead of %f with %s executor\n",
+                               x, y, z, out(x, y, z), reference(x, y, z), name);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+    set_parallel_runtime(nullptr);
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Buffer<float> reference(128, 128, 4);
+    int ret = parallel_runtime(reference);
+    if (ret) {
+        printf("Non zero exit code: %d\n", ret);
+        return -1;
+    }
+
+    SerialExecutor serial;
+    if (check(&serial, "serial", reference)) {
+        return -1;
+    }
+
+    ThreadExecutor threads(4);
+    if (check(&threads, "thread", reference)) {
+        return -1;
+    }
+
+#ifdef _OPENMP
+    OpenMPExecutor openmp;
+    if (check(&openmp, "OpenMP", reference)) {
+        return -1;
+    }
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "Halide.h"
+
+namespace {
+
+class ParallelRuntime : public Halide::Generator<ParallelRuntime> {
+public:
+    Output<Buffer<float>> output{"output", 3};
+
+    void generate() {
+        Var x, y, z, yo, yi;
+
+        Func producer, consumer;
+        producer(x, y, z) = sqrt(cast<float>(x + y * z));
+        consumer(x, y, z) = producer(x - 1, y, z) + producer(x + 1, y, z);
+        output(x, y, z) = consumer(x, y - 1, z) + consumer(x, y + 1, z);
+
+        // Nested parallel loops, with an async producer inside the
+        // inner one, so that the parallel runtime has to handle
+        // halide_do_parallel_tasks with semaphores from inside a task
+        // of an enclosing parallel loop.
+        output.split(y, yo, yi, 16).parallel(z).parallel(yo).vectorize(x, 8);
+        consumer.compute_at(output, yo).vectorize(x, 8);
+        producer.store_at(output, yo).compute_at(consumer, y).async();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ParallelRuntime, parallel_runtime)
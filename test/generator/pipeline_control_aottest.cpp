@@ -0,0 +1,208 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "pipeline_control.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+// The pipeline has no user_context argument, so every invocation
+// uses the same control. Jobs started after it changes use the new
+// one.
+std::atomic<halide_pipeline_control_t *> current_control(nullptr);
+
+halide_pipeline_control_t *get_control(void *user_context) {
+    return current_control;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    halide_set_custom_get_pipeline_control(get_control);
+
+    Buffer<float> reference(256, 256), out(256, 256);
+    int ret = pipeline_control(reference);
+    if (ret) {
+        printf("Non zero exit code: %d\n", ret);
+        return -1;
+    }
+
+    // A control that isn't cancelled doesn't change the result,
+    // whatever its priority.
+    halide_pipeline_control_t control;
+    for (int priority : {-1, 0, 10}) {
+        halide_pipeline_control_init(&control, priority);
+        current_control = &control;
+        out.fill(0.0f);
+        ret = pipeline_control(out);
+        if (ret) {
+            printf("Non zero exit code with priority %d: %d\n", priority, ret);
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != reference(x, y)) {
+                    printf("out(%d, %d) = %f instead of %f with priority %d\n",
+                           x, y, out(x, y), reference(x, y), priority);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A cancelled pipeline returns the cancellation error, with any
+    // number of threads.
+    for (int threads : {1, 3, 0}) {
+        halide_set_num_threads(threads);
+        halide_pipeline_control_init(&control, 0);
+        halide_cancel_pipeline(&control);
+        ret = pipeline_control(out);
+        if (ret != halide_error_code_cancelled) {
+            printf("Exit code %d instead of %d for a cancelled pipeline with %d threads\n",
+                   ret, halide_error_code_cancelled, threads);
+            return -1;
+        }
+    }
+
+    // Cancelling a running pipeline stops it, unless it finished
+    // first. Either way it returns promptly.
+    halide_pipeline_control_init(&control, 0);
+    std::thread canceller([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        halide_cancel_pipeline(&control);
+    });
+    ret = pipeline_control(out);
+    canceller.join();
+    if (ret != 0 && ret != halide_error_code_cancelled) {
+        printf("Exit code %d for a pipeline cancelled while running\n", ret);
+        return -1;
+    }
+
+    // Two concurrent invocations with different priorities both
+    // complete.
+    halide_pipeline_control_t high, low;
+    halide_pipeline_control_init(&high, 1);
+    halide_pipeline_control_init(&low, -1);
+    Buffer<float> out_high(256, 256), out_low(256, 256);
+    int ret_low = 0;
+    current_control = &low;
+    std::thread background([&]() {
+        ret_low = pipeline_control(out_low);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    current_control = &high;
+    ret = pipeline_control(out_high);
+    background.join();
+    if (ret || ret_low) {
+        printf("Non zero exit codes from concurrent pipelines: %d %d\n", ret, ret_low);
+        return -1;
+    }
+
+    // Spin policies, both global and per-pipeline, don't change the
+    // result. Report how long it takes parked threads to wake up.
+    halide_spin_policy_t park = {0, 0}, spin = {10000, 100};
+    for (int per_pipeline = 0; per_pipeline < 2; per_pipeline++) {
+        for (halide_spin_policy_t *policy : {&park, &spin}) {
+            halide_pipeline_control_init(&control, 0);
+            if (per_pipeline) {
+                control.spin_policy = policy;
+                current_control = &control;
+            } else {
+                halide_set_spin_policy(policy);
+                current_control = nullptr;
+            }
+            halide_reset_thread_pool_stats();
+            for (int i = 0; i < 10; i++) {
+                out.fill(0.0f);
+                ret = pipeline_control(out);
+                if (ret) {
+                    printf("Non zero exit code with spin policy {%d, %d}: %d\n",
+                           policy->spin_count, policy->yield_count, ret);
+                    return -1;
+                }
+                for (int y = 0; y < out.height(); y++) {
+                    for (int x = 0; x < out.width(); x++) {
+                        if (out(x, y) != reference(x, y)) {
+                            printf("out(%d, %d) = %f instead of %f with spin policy {%d, %d}\n",
+                                   x, y, out(x, y), reference(x, y),
+                                   policy->spin_count, policy->yield_count);
+                            return -1;
+                        }
+                    }
+                }
+            }
+            halide_thread_pool_stats_t stats;
+            halide_get_thread_pool_stats(&stats);
+            printf("%s spin policy {%d, %d}: %llu parks, %llu polls woken, mean wake-up latency %.1f us\n",
+                   per_pipeline ? "Per-pipeline" : "Global",
+                   policy->spin_count, policy->yield_count,
+                   (unsigned long long)stats.parks, (unsigned long long)stats.polls_woken,
+                   stats.wakeups ? stats.total_wakeup_latency_ns / (1000.0 * stats.wakeups) : 0.0);
+        }
+    }
+    halide_set_spin_policy(&park);
+
+    // Invocations on isolated thread pools, including two running at
+    // once on different pools, give the same result.
+    halide_thread_pool_t *batch_pool = halide_thread_pool_create("batch", 3, -1);
+    halide_thread_pool_t *latency_pool = halide_thread_pool_create("latency", 2, -1);
+    if (!batch_pool || !latency_pool ||
+        halide_thread_pool_find("batch") != batch_pool ||
+        halide_thread_pool_find("latency") != latency_pool ||
+        halide_thread_pool_find("none") != nullptr) {
+        printf("Could not create and find thread pools\n");
+        return -1;
+    }
+    halide_pipeline_control_init(&low, 0);
+    halide_pipeline_control_init(&high, 0);
+    halide_set_pipeline_thread_pool(&low, batch_pool);
+    halide_set_pipeline_thread_pool(&high, latency_pool);
+    out_low.fill(0.0f);
+    out_high.fill(0.0f);
+    current_control = &low;
+    std::thread batch([&]() {
+        ret_low = pipeline_control(out_low);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    current_control = &high;
+    ret = pipeline_control(out_high);
+    batch.join();
+    if (ret || ret_low) {
+        printf("Non zero exit codes from pipelines on isolated pools: %d %d\n", ret, ret_low);
+        return -1;
+    }
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out_low(x, y) != reference(x, y) || out_high(x, y) != reference(x, y)) {
+                printf("out(%d, %d) = %f and %f on isolated pools instead of %f\n",
+                       x, y, out_low(x, y), out_high(x, y), reference(x, y));
+                return -1;
+            }
+        }
+    }
+
+    // A cancelled invocation on an isolated pool is unwound too.
+    halide_cancel_pipeline(&high);
+    ret = pipeline_control(out_high);
+    if (ret != halide_error_code_cancelled) {
+        printf("Exit code %d instead of %d for a cancelled pipeline on an isolated pool\n",
+               ret, halide_error_code_cancelled);
+        return -1;
+    }
+
+    current_control = nullptr;
+    halide_thread_pool_destroy(batch_pool);
+    halide_thread_pool_destroy(latency_pool);
+    if (halide_thread_pool_find("batch") != nullptr) {
+        printf("Destroyed thread pool was still found\n");
+        return -1;
+    }
+    printf("Success!\n");
+    return 0;
+}
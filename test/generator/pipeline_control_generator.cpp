@@ -0,0 +1,24 @@
+#include "Halide.h"
+
+namespace {
+
+class PipelineControl : public Halide::Generator<PipelineControl> {
+public:
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y, yo, yi;
+
+        // Something slow enough to cancel part-way through.
+        RDom r(0, 256);
+        output(x, y) = sum(sqrt(cast<float>(x + y + r)));
+
+        // Nested parallel loops, so that cancellation has to unwind
+        // jobs owned by tasks of an enclosing job.
+        output.split(y, yo, yi, 8).parallel(yo).parallel(yi).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(PipelineControl, pipeline_control)
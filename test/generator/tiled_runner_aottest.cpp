@@ -0,0 +1,87 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_tiled_runner.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tiled_runner.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+const int W = 1000, H = 700;
+
+// The input image, computed on demand rather than held in memory.
+uint16_t source(int x, int y) {
+    return (uint16_t)((x * 7 + y * 13) % 1000);
+}
+
+int main(int argc, char **argv) {
+    Buffer<int> written(W, H);
+    written.fill(0);
+    int reads = 0, max_read_pixels = 0;
+
+    auto pipeline = [&](halide_buffer_t *in, halide_buffer_t *out) {
+        return tiled_runner(in, W, H, out);
+    };
+    auto read = [&](Buffer<uint16_t> &tile) {
+        reads++;
+        max_read_pixels = std::max(max_read_pixels, tile.width() * tile.height());
+        if (tile.dim(0).min() < 0 || tile.dim(0).max() >= W ||
+            tile.dim(1).min() < 0 || tile.dim(1).max() >= H) {
+            printf("Input tile out of bounds\n");
+            return false;
+        }
+        tile.for_each_element([&](int x, int y) {
+            tile(x, y) = source(x, y);
+        });
+        return true;
+    };
+    auto write = [&](const Buffer<uint16_t> &tile) {
+        bool ok = true;
+        tile.for_each_element([&](int x, int y) {
+            int expected = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    expected += source(std::min(std::max(x + dx, 0), W - 1),
+                                       std::min(std::max(y + dy, 0), H - 1));
+                }
+            }
+            if (tile(x, y) != expected) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, tile(x, y), expected);
+                ok = false;
+            }
+            written(x, y)++;
+        });
+        return ok;
+    };
+
+    TiledRunConfig config;
+    config.tile_extents = {128, 64};
+    int result = run_tiled<uint16_t, uint16_t>(pipeline, 2, {W, H}, read, write, config);
+    if (result != 0) {
+        printf("run_tiled failed: %d\n", result);
+        return -1;
+    }
+
+    // Every pixel should have been written exactly once.
+    int bad = 0;
+    written.for_each_value([&](int n) { bad += (n != 1); });
+    if (bad) {
+        printf("%d pixels not written exactly once\n", bad);
+        return -1;
+    }
+
+    // One input tile per output tile, each only slightly larger than
+    // the output tile.
+    const int tiles = ((W + 127) / 128) * ((H + 63) / 64);
+    if (reads != tiles || max_read_pixels > 130 * 66) {
+        printf("Unexpected reads: %d tiles, up to %d pixels each\n", reads, max_read_pixels);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "Halide.h"
+
+namespace {
+
+// A 3x3 box filter, with a boundary condition that depends on the
+// size of the whole image rather than on the size of the input
+// buffer, so that it can be run one tile at a time.
+class TiledRunner : public Halide::Generator<TiledRunner> {
+public:
+    Input<Buffer<uint16_t>> input{ "input", 2 };
+    Input<int32_t> width{ "width" };
+    Input<int32_t> height{ "height" };
+
+    Output<Buffer<uint16_t>> output{ "output", 2 };
+
+    void generate() {
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input, 0, width, 0, height);
+
+        RDom r(-1, 3, -1, 3);
+        output(x, y) = sum(clamped(x + r.x, y + r.y));
+    }
+
+    void schedule() {
+        output.vectorize(x, natural_vector_size<uint16_t>());
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TiledRunner, tiled_runner)
@@ -0,0 +1,110 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "halide_benchmark.h"
+#include "work_stealing.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    Buffer<float> reference(256, 256), out(256, 256);
+
+    double default_time = benchmark(10, 10, [&]() {
+        work_stealing(reference);
+    });
+
+    halide_do_par_for_t old_par_for = halide_set_custom_do_par_for(halide_work_stealing_do_par_for);
+
+    // Make sure the serial fallback and loops smaller than the thread
+    // count also work.
+    for (int threads : {1, 3, 0}) {
+        halide_set_num_threads(threads);
+        out.fill(0.0f);
+        int ret = work_stealing(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != reference(x, y)) {
+                    printf("out(%d, %d) = %f instead of %f with %d threads\n",
+                           x, y, out(x, y), reference(x, y), threads);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    double work_stealing_time = benchmark(10, 10, [&]() {
+        work_stealing(out);
+    });
+
+    // The same again with adaptively sized chunks.
+    halide_set_custom_do_par_for(halide_adaptive_do_par_for);
+    for (int threads : {1, 3, 0}) {
+        halide_set_num_threads(threads);
+        out.fill(0.0f);
+        int ret = work_stealing(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != reference(x, y)) {
+                    printf("adaptive out(%d, %d) = %f instead of %f with %d threads\n",
+                           x, y, out(x, y), reference(x, y), threads);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    double adaptive_time = benchmark(10, 10, [&]() {
+        work_stealing(out);
+    });
+
+    halide_set_custom_do_par_for(old_par_for);
+
+    // NUMA-aware mode, with pages of large allocations placed by a
+    // parallel first touch. On single-node hosts this is the same as
+    // the default thread pool.
+    halide_set_numa_aware(true);
+    halide_set_custom_first_touch(halide_default_first_touch);
+    {
+        Buffer<float> numa_out(1024, 1024);
+        Buffer<float> numa_reference(1024, 1024);
+        halide_set_numa_aware(false);
+        work_stealing(numa_reference);
+        halide_set_numa_aware(true);
+        int ret = work_stealing(numa_out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+        for (int y = 0; y < numa_out.height(); y++) {
+            for (int x = 0; x < numa_out.width(); x++) {
+                if (numa_out(x, y) != numa_reference(x, y)) {
+                    printf("numa_out(%d, %d) = %f instead of %f\n",
+                           x, y, numa_out(x, y), numa_reference(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+    halide_set_custom_first_touch(NULL);
+    halide_set_numa_aware(false);
+
+    printf("Default thread pool:    %f ms\n"
+           "Work-stealing par_for:  %f ms\n"
+           "Adaptive par_for:       %f ms\n",
+           default_time * 1e3, work_stealing_time * 1e3, adaptive_time * 1e3);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "Halide.h"
+
+namespace {
+
+class WorkStealing : public Halide::Generator<WorkStealing> {
+public:
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y, xo, xi;
+
+        // Iterations get more expensive as y increases, so an even
+        // up-front split of the rows is unbalanced and threads that
+        // finish early have to steal.
+        RDom r(0, 64);
+        Func work;
+        work(x, y) = sqrt(cast<float>(x + y));
+        output(x, y) = sum(select(r < y / 4, sqrt(work(x, y) + r), 0.0f));
+
+        // Nested parallelism, so that the work-stealing loop over y
+        // launches further parallel loops from inside its tasks.
+        output.split(x, xo, xi, 64).parallel(y).parallel(xo).vectorize(xi, 8);
+        work.compute_at(output, xo).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(WorkStealing, work_stealing)
@@ -2,6 +2,7 @@
 #include "IRPrinter.h"
 #include "CodeGen_X86.h"
 #include "CodeGen_C.h"
+#include "CodeGen_Vulkan_Dev.h"
 #include "CPlusPlusMangle.h"
 #include "Func.h"
 #include "Bounds.h"
@@ -14,9 +15,11 @@
 #include "Monotonic.h"
 #include "Reduction.h"
 #include "Interval.h"
+#include "ConstantInterval.h"
 #include "Associativity.h"
 #include "Generator.h"
 #include "AutoScheduleUtils.h"
+#include "MemoryFootprint.h"
 
 using namespace Halide;
 using namespace Halide::Internal;
@@ -24,6 +27,7 @@ using namespace Halide::Internal;
 int main(int argc, const char **argv) {
     IRPrinter::test();
     CodeGen_C::test();
+    CodeGen_Vulkan_Dev::test();
     ir_equality_test();
     bounds_test();
     expr_match_test();
@@ -36,9 +40,11 @@ int main(int argc, const char **argv) {
     is_monotonic_test();
     split_predicate_test();
     interval_test();
+    constant_interval_test();
     associativity_test();
     generator_test();
     propagate_estimate_test();
+    memory_footprint_test();
 
     return 0;
 }
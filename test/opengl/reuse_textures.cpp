@@ -0,0 +1,47 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#include "testing.h"
+
+using namespace Halide;
+
+int main() {
+    // This test must be run with an OpenGL target.
+    const Target target = get_jit_target_from_environment().with_feature(Target::OpenGL);
+
+    Func gpu("gpu"), cpu("cpu");
+    Var x, y, c;
+    Param<int> k;
+
+    gpu(x, y, c) = cast<uint8_t>(select(c == 0, 10 * x + y + k,
+                                        c == 1, 127,
+                                        k));
+    gpu.bound(c, 0, 3);
+    gpu.glsl(x, y, c);
+    gpu.compute_root();
+
+    cpu(x, y, c) = gpu(x, y, c);
+
+    // Each realization frees the texture of the previous one. Alternate
+    // sizes so that some reuse a pooled texture and some can't, and
+    // check that a reused texture never shows stale contents.
+    for (int i = 0; i < 8; i++) {
+        int size = (i % 2) ? 10 : 12;
+        k.set(i);
+        Buffer<uint8_t> out(size, size, 3);
+        cpu.realize(out, target);
+
+        if (!Testing::check_result<uint8_t>(out, [&](int x, int y, int c) {
+                switch (c) {
+                    case 0: return 10*x+y+i;
+                    case 1: return 127;
+                    case 2: return i;
+                    default: return -1;
+                } })) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -56,14 +56,36 @@ int main(int argc, char **argv) {
 
         cpu.compile_jit();
 
-        times[use_async] = benchmark(10, 1, [&]() {
+        // Measure the time the GPU spends on kernels and copies too,
+        // to see how much of it the CPU work overlaps. The result is
+        // consumed on the CPU, so each realize waits for the GPU.
+        Internal::JITSharedRuntime::device_timing_enable(true);
+        BenchmarkConfig config;
+        config.max_iters = 10;
+        config.device_times = [](double *kernel_time, double *copy_time) {
+            halide_device_timing_t timing = Internal::JITSharedRuntime::device_timing_get();
+            *kernel_time = timing.kernel_ns * 1e-9;
+            *copy_time = timing.copy_ns * 1e-9;
+        };
+        BenchmarkResult result = benchmark([&]() {
                 cpu.realize(out);
-            });
+            }, config);
+        times[use_async] = result.wall_time;
 
-        printf("%s: %f\n",
+        printf("%s: %f (kernels: %f, copies: %f, host: %f)\n",
                use_async ? "with async" : "without async",
-               times[use_async]);
+               result.wall_time, result.kernel_time,
+               result.copy_time, result.host_overhead);
+
+        if (result.kernel_time <= 0 &&
+            (target.has_feature(Target::CUDA) ||
+             target.has_feature(Target::OpenCL) ||
+             target.has_feature(Target::Metal))) {
+            printf("The device should have reported the time spent in kernels\n");
+            return -1;
+        }
     }
+    Internal::JITSharedRuntime::device_timing_enable(false);
 
     if (times[1] > 1.2*times[0]) {
         printf("Using async should have been faster\n");
@@ -13,7 +13,7 @@ std::mt19937 rng(0);
 
 template<typename T>
 bool test(int w, bool div) {
-    Func f, g, h;
+    Func f, g, h, r;
     Var x, y;
 
     size_t bits = sizeof(T)*8;
@@ -52,6 +52,10 @@ bool test(int w, bool div) {
 
         // Version that uses fast_integer_divide
         h(x, y) = Halide::fast_integer_divide(input(x, y), cast<uint8_t>(y + min_val));
+
+        // Version where the divisor is only known at runtime, but
+        // doesn't change over the vectorized loop
+        r(x, y) = input(x, y) / cast<T>(y + min_val);
     } else {
         // Test mod
         f(x, y) = input(x, y) % cast<T>(y + min_val);
@@ -61,19 +65,26 @@ bool test(int w, bool div) {
 
         // Version that uses fast_integer_modulo
         h(x, y) = Halide::fast_integer_modulo(input(x, y), cast<uint8_t>(y + min_val));
+
+        // Version where the modulus is only known at runtime, but
+        // doesn't change over the vectorized loop
+        r(x, y) = input(x, y) % cast<T>(y + min_val);
     }
 
     // Try dividing by all the known constants using vectors
     f.bound(y, 0, num_vals).bound(x, 0, input.width()).unroll(y);
     h.bound(x, 0, input.width());
+    r.bound(x, 0, input.width());
     if (w > 1) {
         f.vectorize(x);
         h.vectorize(x);
+        r.vectorize(x);
     }
 
     f.compile_jit();
     g.compile_jit();
     h.compile_jit();
+    r.compile_jit();
 
     Buffer<T> correct = g.realize(input.width(), num_vals);
     double t_correct = benchmark([&]() { g.realize(correct); });
@@ -84,7 +95,11 @@ bool test(int w, bool div) {
     Buffer<T> fast_dynamic = h.realize(input.width(), num_vals);
     double t_fast_dynamic = benchmark([&]() { h.realize(fast_dynamic); });
 
-    printf("%6.3f                  %6.3f\n", t_correct / t_fast, t_correct / t_fast_dynamic);
+    Buffer<T> fast_invariant = r.realize(input.width(), num_vals);
+    double t_fast_invariant = benchmark([&]() { r.realize(fast_invariant); });
+
+    printf("%6.3f                  %6.3f                  %6.3f\n",
+           t_correct / t_fast, t_correct / t_fast_dynamic, t_correct / t_fast_invariant);
 
     for (int y = 0; y < num_vals; y++) {
         for (int x = 0; x < input.width(); x++) {
@@ -97,6 +112,15 @@ bool test(int w, bool div) {
                        (T)(y + min_val));
                 return false;
             }
+            if (fast_invariant(x, y) != correct(x, y)) {
+                printf("fast_invariant(%d, %d) = %lld instead of %lld (%lld/%d)\n",
+                       x, y,
+                       (long long int)fast_invariant(x, y),
+                       (long long int)correct(x, y),
+                       (long long int)input(x, y),
+                       (T)(y + min_val));
+                return false;
+            }
         }
     }
 
@@ -112,7 +136,7 @@ int main(int argc, char **argv) {
     bool success = true;
     for (int i = 0; i < 2; i++) {
         const char *name = (i == 0 ? "divisor" : "modulus");
-        printf("type            const-%s speed-up  runtime-%s speed-up\n", name, name);
+        printf("type            const-%s speed-up  runtime-%s speed-up  invariant-%s speed-up\n", name, name, name);
         // Scalar
         success = success && test<int32_t>(1, i == 0);
         success = success && test<int16_t>(1, i == 0);
@@ -0,0 +1,99 @@
+#include "Halide.h"
+#include <cstdio>
+#include <cmath>
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    Func f, g, h, k;
+    Var x, y;
+
+    Param<int> calls_per_pixel;
+
+    RDom s(0, calls_per_pixel);
+    Expr arg = (x + 1) / 64.0f + (y + s) / 256.0f;
+    f(x, y) = sum(sin(arg) + cos(arg));
+    g(x, y) = sum(fast_sin(arg) + fast_cos(arg));
+    h(x, y) = sum(fast_sin(arg, 30) + fast_cos(arg, 30));
+    k(x, y) = sum(tanh(arg) - fast_tanh(arg));
+    f.vectorize(x, 8);
+    g.vectorize(x, 8);
+    h.vectorize(x, 8);
+    k.vectorize(x, 8);
+
+    Buffer<float> correct_result(2048, 768);
+    Buffer<float> fast_result(2048, 768);
+    Buffer<float> faster_result(2048, 768);
+
+    calls_per_pixel.set(1);
+
+    f.realize(correct_result);
+    g.realize(fast_result);
+    h.realize(faster_result);
+
+    calls_per_pixel.set(20);
+
+    // All profiling runs are done into the same buffer, to avoid
+    // cache weirdness.
+    Buffer<float> timing_scratch(256, 256);
+    double t1 = 1e3 * benchmark([&]() { f.realize(timing_scratch); });
+    double t2 = 1e3 * benchmark([&]() { g.realize(timing_scratch); });
+    double t3 = 1e3 * benchmark([&]() { h.realize(timing_scratch); });
+
+    RDom r(correct_result);
+    Func fast_error, faster_error;
+    Expr fast_delta = correct_result(r.x, r.y) - fast_result(r.x, r.y);
+    Expr faster_delta = correct_result(r.x, r.y) - faster_result(r.x, r.y);
+    fast_error() += cast<double>(fast_delta * fast_delta);
+    faster_error() += cast<double>(faster_delta * faster_delta);
+
+    Buffer<double> fast_err = fast_error.realize();
+    Buffer<double> faster_err = faster_error.realize();
+
+    calls_per_pixel.set(1);
+    Buffer<float> tanh_delta = k.realize(2048, 768);
+    float worst_tanh_delta = 0;
+    for (int y = 0; y < tanh_delta.height(); y++) {
+        for (int x = 0; x < tanh_delta.width(); x++) {
+            worst_tanh_delta = std::max(worst_tanh_delta, std::abs(tanh_delta(x, y)));
+        }
+    }
+
+    int timing_N = timing_scratch.width() * timing_scratch.height() * 20;
+    int correctness_N = fast_result.width() * fast_result.height();
+    fast_err(0) = sqrt(fast_err(0)/correctness_N);
+    faster_err(0) = sqrt(faster_err(0)/correctness_N);
+
+    printf("sin + cos: %f ns per pixel\n"
+           "fast_sin + fast_cos: %f ns per pixel (rms error = %0.10f)\n"
+           "fast_sin + fast_cos with a 30 ulp budget: %f ns per pixel (rms error = %0.10f)\n",
+           1000000*t1 / timing_N,
+           1000000*t2 / timing_N, fast_err(0),
+           1000000*t3 / timing_N, faster_err(0));
+
+    if (fast_err(0) > 0.000001) {
+        printf("Error for fast_sin + fast_cos too large\n");
+        return -1;
+    }
+
+    if (faster_err(0) > 0.00001) {
+        printf("Error for fast_sin + fast_cos with a 30 ulp budget too large\n");
+        return -1;
+    }
+
+    if (worst_tanh_delta > 0.000001f) {
+        printf("fast_tanh is off by %f\n", worst_tanh_delta);
+        return -1;
+    }
+
+    if (t1 < t2) {
+        printf("sin and cos are faster than fast_sin and fast_cos\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+
+    return 0;
+}
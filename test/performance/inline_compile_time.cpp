@@ -0,0 +1,61 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Build a chain of stages that each use the previous one several
+// times. As a tree this is exponentially large, but it only has a
+// linear number of distinct nodes.
+Expr make_chain(Expr x, int stages) {
+    Expr e = x;
+    for (int i = 0; i < stages; i++) {
+        e = e * e + e + i;
+        e = select(e > i, e - x, e * 3);
+    }
+    return e;
+}
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    // Two copies of the same graph that share no nodes. CSE has to
+    // discover that the copies are equal node by node, which used to
+    // require deep comparisons.
+    const int stages = 2000;
+    double cse_time = benchmark(3, 1, [&]() {
+        Expr e = Internal::common_subexpression_elimination(make_chain(x, stages) + make_chain(x, stages));
+    });
+    printf("CSE of two copies of a %d stage graph: %f ms\n", stages, cse_time * 1e3);
+
+    // Two graphs that only differ at their leaves.
+    double equal_time = benchmark(3, 1, [&]() {
+        Internal::graph_equal(make_chain(x, stages), make_chain(y, stages));
+    });
+    printf("Comparing two unequal %d stage graphs: %f ms\n", stages, equal_time * 1e3);
+
+    // A pipeline that inlines a chain of Funcs that each use the
+    // previous one several times at the same site.
+    double lower_time = benchmark(1, 1, [&]() {
+        Var v;
+        Func f[12];
+        f[0](v) = v;
+        for (int i = 1; i < 12; i++) {
+            f[i](v) = f[i - 1](v) * f[i - 1](v) + f[i - 1](v) + i;
+        }
+        f[11].compile_to_module({}, "inline_compile_time");
+    });
+    printf("Lowering a pipeline of 12 inlined Funcs: %f ms\n", lower_time * 1e3);
+
+    // All of these should be far faster than this if the work is
+    // linear in the number of distinct nodes.
+    if (cse_time > 2.0 || equal_time > 2.0) {
+        printf("CSE or IR comparison is too slow on large graphs\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -6,10 +6,10 @@ using namespace Halide;
 int main(int argc, char **argv) {
     Param<int> p;
 
-    const char *names[3] = {"heap", "pseudostack", "stack"};
+    const char *names[4] = {"heap", "pseudostack", "stack", "pooled heap"};
 
-    double t[3];
-    for (int i = 0; i < 3; i++) {
+    double t[4];
+    for (int i = 0; i < 4; i++) {
         Var x("x");
 
         Func in;
@@ -29,7 +29,7 @@ int main(int argc, char **argv) {
         chain.back().split(x, xo, xi, p, TailStrategy::RoundUp);
         for (size_t j = 0; j < chain.size() - 1; j++) {
             chain[j].compute_at(chain.back(), xo);
-            if (i != 0) {
+            if (i == 1 || i == 2) {
                 chain[j].store_in(MemoryType::Stack);
             }
             if (i == 2) {
@@ -50,6 +50,13 @@ int main(int argc, char **argv) {
         }
         chain.back().vectorize(xi, 8, TailStrategy::RoundUp);
 
+        if (i == 3) {
+            // Recycle the heap allocations instead of going back to
+            // the system allocator each time.
+            chain.back().set_custom_allocator(Runtime::BufferPool::halide_malloc,
+                                              Runtime::BufferPool::halide_free);
+        }
+
         // Make it too large for llvm to promote into registers or
         // bother unrolling. We're trying to compare stack to
         // pseudostack, not stack to register.
@@ -1,5 +1,7 @@
 #include "Halide.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string>
 
 using namespace Halide;
 
@@ -53,6 +55,12 @@ void my_print(void *, const char *msg) {
     }
 }
 
+std::string lifetime_report;
+
+void lifetime_print(void *, const char *msg) {
+    lifetime_report += msg;
+}
+
 // Return 0 if there is no error found
 int check_error(int exp_heap_peak, int exp_num_mallocs,
                 int exp_malloc_avg, int exp_stack_peak) {
@@ -332,6 +340,33 @@ int main(int argc, char **argv) {
         }
     }
 
+    #ifndef _WIN32
+    {
+        printf("Running allocation lifetime test...\n");
+        // Must be set before the pipeline first runs.
+        setenv("HL_PROFILER_MEMORY_LIFETIMES", "1", 1);
+
+        // g9 is too big for the stack, and is allocated once per row
+        // of f13.
+        const int size_x = 10000;
+        const int size_y = 8;
+        Func f13("f_13"), g9("g_9");
+        g9(x, y) = x;
+        f13(x, y) = g9(x, y);
+        g9.compute_at(f13, y);
+
+        f13.set_custom_print(&lifetime_print);
+        f13.realize(size_x, size_y, t);
+
+        if (lifetime_report.find("allocation lifetimes (first run)") == std::string::npos ||
+            lifetime_report.find("allocated 8 times per run") == std::string::npos) {
+            printf("Expected a repeated allocation of g_9 to be reported:\n%s\n",
+                   lifetime_report.c_str());
+            return -1;
+        }
+    }
+    #endif
+
     printf("Success!\n");
     return 0;
 }
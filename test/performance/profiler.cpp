@@ -1,10 +1,15 @@
 #include "Halide.h"
 #include <stdio.h>
+#include <string.h>
 
 using namespace Halide;
 
 int percentage = 0;
 float ms = 0;
+unsigned long long max_cycles = 0;
+std::string max_cycles_func;
+float max_intensity = 0;
+std::string max_intensity_func;
 void my_print(void *, const char *msg) {
     float this_ms;
     int this_percentage;
@@ -13,9 +18,34 @@ void my_print(void *, const char *msg) {
         ms = this_ms;
         percentage = this_percentage;
     }
+
+    // With profile_by_thread, per-func lines also carry hardware
+    // counters, if the OS lets us read them.
+    char name[64];
+    unsigned long long cycles;
+    const char *c = strstr(msg, " cycles/run: ");
+    if (c && sscanf(msg, " %63[^:]:", name) == 1 &&
+        sscanf(c, " cycles/run: %llu", &cycles) == 1 &&
+        strncmp(name, "fn", 2) == 0 &&
+        cycles > max_cycles) {
+        max_cycles = cycles;
+        max_cycles_func = name;
+    }
+
+    // With profile_roofline, per-func lines also carry the
+    // arithmetic intensity.
+    float intensity;
+    const char *i = strstr(msg, " ops/byte: ");
+    if (i && sscanf(msg, " %63[^:]:", name) == 1 &&
+        sscanf(i, " ops/byte: %f", &intensity) == 1 &&
+        strncmp(name, "fn", 2) == 0 &&
+        intensity > max_intensity) {
+        max_intensity = intensity;
+        max_intensity_func = name;
+    }
 }
 
-int main(int argc, char **argv) {
+int run_test(bool by_thread, bool roofline) {
     // Make a long chain of finely-interleaved Funcs, of which one is very expensive.
     Func f[30];
     Var c, x;
@@ -48,6 +78,16 @@ int main(int argc, char **argv) {
     }
 
     Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    if (by_thread) {
+        out.update().parallel(x, 100);
+        t = t.with_feature(Target::ProfileByThread);
+    }
+    if (roofline) {
+        t = t.with_feature(Target::ProfileRoofline);
+    }
+    percentage = 0;
+    max_cycles = 0;
+    max_intensity = 0;
     Buffer<float> im = out.realize(10, 1000, t);
 
     //out.compile_to_assembly("/dev/stdout", {}, t.with_feature(Target::JIT));
@@ -61,6 +101,37 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    if (by_thread) {
+        if (max_cycles == 0) {
+            printf("No hardware counters available\n");
+        } else if (max_cycles_func != "fn13") {
+            printf("Most cycles were billed to %s instead of fn13\n", max_cycles_func.c_str());
+            return -1;
+        }
+    }
+
+    // fn13 does hundreds of operations per value loaded, so it should
+    // be the most compute-bound.
+    if (roofline && max_intensity_func != "fn13") {
+        printf("The highest arithmetic intensity was billed to %s instead of fn13\n",
+               max_intensity_func.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (run_test(false, false) != 0) {
+        return -1;
+    }
+    if (run_test(true, false) != 0) {
+        return -1;
+    }
+    if (run_test(false, true) != 0) {
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
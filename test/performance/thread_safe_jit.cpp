@@ -88,16 +88,11 @@ void same_func_per_thread() {
     std::thread threads[16];
     test_func test;
 
-    // In this program, only one thread can call into the compiler
-    // at this point. The mutex guard is still included both to show that in
-    // general Halide compilation is not thread ssafe and also to keep
-    // the performance comparison slightly more equal by including
-    // (minimal) mutex cost on both paths.
-    {
-        std::lock_guard<std::mutex> lock(compiler_mutex);
-
-        test.f.compile_jit();
-    }
+    // The first realize compiles the pipeline, and the other threads
+    // wait for it, so there's no need to compile it ahead of time.
+    // The Func's Pipeline is made lazily though, so make it now,
+    // before the threads share it.
+    test.f.pipeline();
 
     for (auto &thread : threads) {
         thread = std::thread(same_func_per_thread_executor,
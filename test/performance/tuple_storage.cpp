@@ -0,0 +1,65 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare storing the elements of an index and value Tuple in a buffer
+// each (the default) with storing them interleaved in one buffer, for
+// a consumer that reads both elements at scattered locations, and one
+// that streams through only one of them.
+double run(bool interleaved, bool gather) {
+    const int size = 1 << 22;
+    Var x;
+    Func pairs, out;
+    pairs(x) = Tuple(x * 7 % 1024, cast<float>(x) * 0.5f);
+    if (gather) {
+        // A cheap hash of x, to read the pairs in no particular order.
+        Expr i = cast<int>((cast<uint32_t>(x) * 2654435761U) % size);
+        out(x) = cast<float>(pairs(i)[0]) + pairs(i)[1];
+    } else {
+        out(x) = pairs(x)[1] * 2;
+    }
+
+    pairs.compute_root().vectorize(x, 8).parallel(x, 1 << 16);
+    if (interleaved) {
+        pairs.store_interleaved();
+    }
+    out.vectorize(x, 8).parallel(x, 1 << 16);
+
+    Buffer<float> result(size);
+    out.compile_jit();
+    out.realize(result);
+    return benchmark(5, 5, [&]() { out.realize(result); });
+}
+
+int main(int argc, char **argv) {
+    double gather_split = run(false, true);
+    double gather_interleaved = run(true, true);
+    double stream_split = run(false, false);
+    double stream_interleaved = run(true, false);
+
+    printf("Reading both elements at scattered locations:\n"
+           "  separate buffers: %f ms\n"
+           "  interleaved:      %f ms\n"
+           "Reading one element in order:\n"
+           "  separate buffers: %f ms\n"
+           "  interleaved:      %f ms\n",
+           gather_split * 1e3, gather_interleaved * 1e3,
+           stream_split * 1e3, stream_interleaved * 1e3);
+
+    // Each layout should win its own case. Timing is noisy, so only
+    // fail if one loses badly.
+    if (gather_interleaved > gather_split * 1.5) {
+        printf("Interleaved storage was much slower for scattered reads\n");
+        return -1;
+    }
+    if (stream_split > stream_interleaved * 1.5) {
+        printf("Separate buffers were much slower for reading one element\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -3,8 +3,11 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -13,8 +16,14 @@
 #include <set>
 #include  <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 namespace Halide {
 namespace RunGen {
 
@@ -455,7 +464,7 @@ inline Buffer<> load_input_from_file(const std::string &pathname,
                               const halide_filter_argument_t &metadata) {
     Buffer<> b = Buffer<>(metadata.type, 0);
     info() << "Loading input " << metadata.name << " from " << pathname << " ...";
-    if (!Halide::Tools::load<Buffer<>, IOCheckFail>(pathname, &b)) {
+    if (!Halide::Tools::load_mapped<Buffer<>, IOCheckFail>(pathname, &b)) {
         fail() << "Unable to load input: " << pathname;
     }
     if (b.dimensions() != metadata.dimensions) {
@@ -584,6 +593,104 @@ inline Halide::Tools::FormatInfo best_save_format(const Buffer<> &b, const std::
     return best;
 }
 
+// Save a buffer to a file, converting it to the closest type and
+// dimensionality the file format supports.
+inline void save_output_to_file(const std::string &name, Buffer<> b, const std::string &pathname) {
+    info() << "Saving output " << name << " to " << pathname << " ...";
+
+    std::set<Halide::Tools::FormatInfo> savable_types;
+    if (!Halide::Tools::save_query<Buffer<>, IOCheckFail>(pathname, &savable_types)) {
+        fail() << "Unable to save output: " << pathname;
+    }
+    const Halide::Tools::FormatInfo best = best_save_format(b, savable_types);
+    if (best.dimensions != b.dimensions()) {
+        b = adjust_buffer_dims("Output", name, best.dimensions, b);
+    }
+    if (best.type != b.type()) {
+        warn() << "Image for argument \"" << name << "\" is of type "
+             << b.type() << " but is being saved as type "
+             << best.type << "; data loss may have occurred.";
+        b = Halide::Tools::ImageTypeConversion::convert_image(b, best.type);
+    }
+    if (!Halide::Tools::save_mapped<Buffer<const void>, IOCheckFail>(b.as<const void>(), pathname)) {
+        fail() << "Unable to save output: " << pathname;
+    }
+}
+
+// Helpers for batch mode, in which a buffer argument names a
+// directory, or a pattern with '*' in its last path component.
+inline bool is_directory(const std::string &path) {
+#ifdef _WIN32
+    return false;
+#else
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+inline bool is_batch_pattern(const std::string &s) {
+    return s.find('*') != std::string::npos || is_directory(s);
+}
+
+// Does 'name' match 'pattern', in which '*' matches any sequence of
+// characters?
+inline bool wildcard_match(const char *pattern, const char *name) {
+    if (*pattern == '*') {
+        return wildcard_match(pattern + 1, name) || (*name && wildcard_match(pattern, name + 1));
+    }
+    if (*pattern == 0 || *name == 0) {
+        return *pattern == *name;
+    }
+    return *pattern == *name && wildcard_match(pattern + 1, name + 1);
+}
+
+// Return the sorted list of files a batch pattern refers to.
+inline std::vector<std::string> list_batch_files(const std::string &pattern) {
+    std::vector<std::string> files;
+#ifdef _WIN32
+    fail() << "Directories and patterns of buffers are not supported on Windows: " << pattern;
+#else
+    std::string dir = pattern, file_pattern = "*";
+    if (!is_directory(pattern)) {
+        size_t slash = pattern.rfind('/');
+        dir = slash == std::string::npos ? "." : pattern.substr(0, slash);
+        file_pattern = slash == std::string::npos ? pattern : pattern.substr(slash + 1);
+    }
+    if (dir.find('*') != std::string::npos) {
+        fail() << "Only the last component of a path may contain '*': " << pattern;
+    }
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        fail() << "Unable to open directory: " << dir;
+    }
+    while (struct dirent *e = readdir(d)) {
+        std::string path = dir + "/" + e->d_name;
+        if (e->d_name[0] != '.' &&
+            wildcard_match(file_pattern.c_str(), e->d_name) &&
+            !is_directory(path)) {
+            files.push_back(path);
+        }
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+#endif
+    return files;
+}
+
+// The name of the output file for one item of a batch: the stem of
+// the input file replaces the '*' in an output pattern, or, if the
+// output names a directory, the input's file name is used as is.
+inline std::string batch_output_path(const std::string &pattern, const std::string &input_path) {
+    size_t slash = input_path.rfind('/');
+    std::string input_name = slash == std::string::npos ? input_path : input_path.substr(slash + 1);
+    size_t star = pattern.find('*');
+    if (star == std::string::npos) {
+        return pattern + "/" + input_name;
+    }
+    std::string stem = input_name.substr(0, input_name.rfind('.'));
+    return pattern.substr(0, star) + stem + pattern.substr(star + 1);
+}
+
 inline std::string scalar_to_string(const halide_type_t &type,
                                     const halide_scalar_value_t &value) {
     std::ostringstream o;
@@ -975,26 +1082,7 @@ public:
                 continue;
             }
 
-            info() << "Saving output " << arg_name << " to " << arg.raw_string << " ...";
-            Buffer<> &b = arg.buffer_value;
-
-            std::set<Halide::Tools::FormatInfo> savable_types;
-            if (!Halide::Tools::save_query<Buffer<>, IOCheckFail>(arg.raw_string, &savable_types)) {
-                fail() << "Unable to save output: " << arg.raw_string;
-            }
-            const Halide::Tools::FormatInfo best = best_save_format(b, savable_types);
-            if (best.dimensions != b.dimensions()) {
-                b = adjust_buffer_dims("Output", arg_name, best.dimensions, b);
-            }
-            if (best.type != b.type()) {
-                warn() << "Image for argument \"" << arg_name << "\" is of type "
-                     << b.type() << " but is being saved as type "
-                     << best.type << "; data loss may have occurred.";
-                b = Halide::Tools::ImageTypeConversion::convert_image(b, best.type);
-            }
-            if (!Halide::Tools::save<Buffer<const void>, IOCheckFail>(b.as<const void>(), arg.raw_string)) {
-                fail() << "Unable to save output: " << arg.raw_string;
-            }
+            save_output_to_file(arg_name, arg.buffer_value, arg.raw_string);
         }
     }
 
@@ -1133,17 +1221,24 @@ public:
         }
     }
 
+    // If 'device_timing' is true, the device is only synchronized at
+    // the end of each sample, and the time the device spent running
+    // kernels and copying, as measured by the device, is reported
+    // separately from the host overhead.
     void run_for_benchmark(double benchmark_min_time,
                            uint64_t benchmark_min_iters,
-                           uint64_t benchmark_max_iters) {
+                           uint64_t benchmark_max_iters,
+                           bool device_timing = false) {
         std::vector<void*> filter_argv = build_filter_argv();
 
-        const auto benchmark_inner = [this, &filter_argv]() {
+        const auto benchmark_inner = [this, &filter_argv, device_timing]() {
             // Ignore result since our halide_error() should catch everything.
             (void) halide_argv_call(&filter_argv[0]);
             // Ensure that all outputs are finished, otherwise we may just be
             // measuring how long it takes to do a kernel launch for GPU code.
-            this->device_sync_outputs();
+            if (!device_timing) {
+                this->device_sync_outputs();
+            }
         };
 
         info() << "Benchmarking filter...";
@@ -1153,6 +1248,18 @@ public:
         config.max_time = benchmark_min_time * 4;
         config.min_iters = benchmark_min_iters;
         config.max_iters = benchmark_max_iters;
+        if (device_timing) {
+            halide_enable_device_timing(nullptr, true);
+            config.device_sync = [this]() { this->device_sync_outputs(); };
+            config.device_times = [](double *kernel_time, double *copy_time) {
+                halide_device_timing_t timing;
+                if (halide_get_device_timing(nullptr, &timing, true) != 0) {
+                    fail() << "halide_get_device_timing failed";
+                }
+                *kernel_time = timing.kernel_ns * 1e-9;
+                *copy_time = timing.copy_ns * 1e-9;
+            };
+        }
         auto result = Halide::Tools::benchmark(benchmark_inner, config);
 
         out() << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
@@ -1160,6 +1267,88 @@ public:
               << result.iterations << " iterations, "
               << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n"
               << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n";
+        if (device_timing) {
+            out() << "Of the best case, the device spent " << result.kernel_time << " sec/iter running kernels and "
+                  << result.copy_time << " sec/iter copying, with " << result.host_overhead
+                  << " sec/iter of host overhead.\n";
+        }
+    }
+
+    // Call the filter from 'callers' threads at once for about
+    // 'duration' seconds, and report the number of calls completed per
+    // second and the distribution of their latencies. Each caller
+    // shares the inputs, but gets outputs of its own. If
+    // 'runtime_threads' is nonzero, the size of the Halide thread pool
+    // is set to it first, so that the mix of parallelism within and
+    // across calls can be explored.
+    void run_for_throughput(int callers, double duration, int runtime_threads) {
+        using Clock = Halide::Tools::SteadyClock<>::type;
+
+        if (runtime_threads > 0) {
+            halide_set_num_threads(runtime_threads);
+        }
+
+        std::vector<std::vector<Buffer<>>> outputs(callers);
+        std::vector<std::vector<void*>> filter_argvs(callers);
+        for (int i = 0; i < callers; i++) {
+            filter_argvs[i] = build_filter_argv();
+            outputs[i].reserve(args.size());
+            for (auto &arg_pair : args) {
+                auto &arg = arg_pair.second;
+                if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                    outputs[i].push_back(allocate_buffer(arg.buffer_value.type(), get_shape(arg.buffer_value)));
+                    filter_argvs[i][arg.index] = outputs[i].back().raw_buffer();
+                }
+            }
+        }
+
+        info() << "Measuring throughput with " << callers << " callers...";
+
+        std::vector<std::vector<double>> latencies(callers);
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+        auto caller = [&](int i) {
+            // One untimed call, to get everything warmed up.
+            (void) halide_argv_call(&filter_argvs[i][0]);
+            while (Clock::now() < deadline) {
+                auto t0 = Clock::now();
+                // Ignore result since our halide_error() should catch everything.
+                (void) halide_argv_call(&filter_argvs[i][0]);
+                for (auto &b : outputs[i]) {
+                    b.device_sync();
+                }
+                auto t1 = Clock::now();
+                latencies[i].push_back(std::chrono::duration<double>(t1 - t0).count());
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int i = 1; i < callers; i++) {
+            threads.emplace_back(caller, i);
+        }
+        caller(0);
+        for (auto &t : threads) {
+            t.join();
+        }
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<double> all;
+        for (const auto &l : latencies) {
+            all.insert(all.end(), l.begin(), l.end());
+        }
+        if (all.empty()) {
+            fail() << "No calls completed in " << duration << " seconds.";
+        }
+        std::sort(all.begin(), all.end());
+        auto percentile = [&](double p) {
+            return all[std::min(all.size() - 1, (size_t)(p * all.size()))];
+        };
+
+        out() << "Throughput for " << md->name << " with " << callers << " callers and "
+              << (runtime_threads > 0 ? std::to_string(runtime_threads) : std::string("default"))
+              << " runtime threads: " << (all.size() / elapsed) << " calls/sec, "
+              << (all.size() * megapixels_out() / elapsed) << " mpix/sec (" << all.size() << " calls).\n"
+              << "Latency p50 " << percentile(0.5) << " sec, p90 " << percentile(0.9)
+              << " sec, p99 " << percentile(0.99) << " sec, max " << all.back() << " sec.\n";
     }
 
     struct Output {
@@ -1185,6 +1374,141 @@ public:
         return v;
     }
 
+    // If any input buffer names a directory or a '*' pattern, expand
+    // each such input into its sorted list of files, and return the
+    // number of items in the batch; otherwise return zero. Every
+    // batched input must name the same number of files, and every
+    // output that is to be saved must also be a directory or pattern.
+    size_t expand_batch() {
+        size_t items = 0;
+        for (auto &arg_pair : args) {
+            auto &arg_name = arg_pair.first;
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind != halide_argument_kind_input_buffer ||
+                !is_batch_pattern(arg.raw_string)) {
+                continue;
+            }
+            std::vector<std::string> files = list_batch_files(arg.raw_string);
+            if (files.empty()) {
+                fail() << "No files found for input " << arg_name << ": " << arg.raw_string;
+            }
+            if (items != 0 && files.size() != items) {
+                fail() << "Input " << arg_name << " has " << files.size()
+                       << " files, but other batched inputs have " << items;
+            }
+            items = files.size();
+            batch_inputs[arg_name] = files;
+            if (batch_key.empty()) {
+                batch_key = arg_name;
+            }
+        }
+        if (items == 0) {
+            return 0;
+        }
+        for (auto &arg_pair : args) {
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind == halide_argument_kind_output_buffer &&
+                !arg.raw_string.empty() && !is_batch_pattern(arg.raw_string)) {
+                fail() << "Output " << arg_pair.first << " must be a directory or a pattern containing '*' "
+                       << "when inputs are batched: " << arg.raw_string;
+            }
+        }
+        return items;
+    }
+
+    // Run the filter once for each item found by expand_batch(). While
+    // the filter runs on one item, the inputs for the next are decoded
+    // on another thread, and the outputs of the previous one are
+    // encoded on a third. Two sets of output buffers are used in
+    // rotation, and are reused as long as the output shapes don't
+    // change from one item to the next.
+    void run_batch(const std::string &user_specified_output_shape) {
+        const size_t items = batch_inputs.begin()->second.size();
+
+        for (auto &it : batch_inputs) {
+            args.at(it.first).raw_string = it.second[0];
+        }
+        load_inputs(user_specified_output_shape);
+
+        using Inputs = std::map<std::string, Buffer<>>;
+        const auto load_item = [this](size_t k) {
+            Inputs inputs;
+            for (auto &it : batch_inputs) {
+                inputs[it.first] = load_input_from_file(it.second[k], *args.at(it.first).metadata);
+            }
+            return inputs;
+        };
+
+        struct OutputSet {
+            std::vector<Shape> constrained_shapes;
+            std::map<std::string, Buffer<>> buffers;
+            std::future<void> writer;
+        };
+        OutputSet output_sets[2];
+
+        std::future<Inputs> loader;
+        for (size_t k = 0; k < items; k++) {
+            if (k > 0) {
+                for (auto &it : loader.get()) {
+                    args.at(it.first).buffer_value = it.second;
+                }
+            }
+            if (k + 1 < items) {
+                loader = std::async(std::launch::async, load_item, k + 1);
+            }
+
+            std::vector<Shape> constrained_shapes = run_bounds_query();
+            adapt_input_buffers(constrained_shapes);
+
+            // Don't reuse this set of outputs until the previous
+            // encoding of it has finished.
+            OutputSet &outputs = output_sets[k % 2];
+            if (outputs.writer.valid()) {
+                outputs.writer.get();
+            }
+            if (outputs.constrained_shapes != constrained_shapes) {
+                allocate_output_buffers(constrained_shapes);
+                outputs.constrained_shapes = constrained_shapes;
+                outputs.buffers.clear();
+                for (auto &arg_pair : args) {
+                    if (arg_pair.second.metadata->kind == halide_argument_kind_output_buffer) {
+                        outputs.buffers[arg_pair.first] = arg_pair.second.buffer_value;
+                    }
+                }
+            } else {
+                for (auto &it : outputs.buffers) {
+                    args.at(it.first).buffer_value = it.second;
+                }
+            }
+
+            info() << "Running filter on item " << k << " of " << items << "...";
+            std::vector<void*> filter_argv = build_filter_argv();
+            // Ignore result since our halide_error() should catch everything.
+            (void) halide_argv_call(&filter_argv[0]);
+            copy_outputs_to_host();
+
+            std::vector<std::pair<std::string, std::string>> saves;
+            for (auto &it : outputs.buffers) {
+                const std::string &pattern = args.at(it.first).raw_string;
+                if (pattern.empty()) {
+                    continue;
+                }
+                saves.emplace_back(it.first, batch_output_path(pattern, batch_inputs.at(batch_key)[k]));
+            }
+            std::map<std::string, Buffer<>> buffers = outputs.buffers;
+            outputs.writer = std::async(std::launch::async, [saves, buffers]() {
+                for (const auto &s : saves) {
+                    save_output_to_file(s.first, buffers.at(s.first), s.second);
+                }
+            });
+        }
+        for (auto &outputs : output_sets) {
+            if (outputs.writer.valid()) {
+                outputs.writer.get();
+            }
+        }
+    }
+
     Buffer<> get_expected_output(const std::string &output) {
         auto it = args.find(output);
         if (it == args.end()) {
@@ -1291,6 +1615,10 @@ private:
     const struct halide_filter_metadata_t * const md;
     std::map<std::string, ArgData> args;
     std::map<std::string, Shape> output_shapes;
+    // The files for each batched input, and the input whose file
+    // names are used to name the outputs.
+    std::map<std::string, std::vector<std::string>> batch_inputs;
+    std::string batch_key;
 };
 
 }  // namespace RunGen
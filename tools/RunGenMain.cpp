@@ -48,6 +48,21 @@ Arguments:
     (We anticipate adding other image formats in the future, in particular,
     TIFF and TMP.)
 
+    To run the filter over many images, an input buffer may instead name a
+    directory, or a pattern with '*' in its last path component:
+
+        some_input_buffer=/path/to/inputs/
+        some_input_buffer=/path/to/inputs/*.png
+        some_output_buffer=/path/to/outputs/*_out.png
+
+    The filter is then run once per file, in sorted order; if several inputs
+    are batched, they must all match the same number of files, and are paired
+    up in order. Outputs must then also be batched: the stem of each file of
+    the first batched input (by name) replaces the '*' in an output pattern, and an
+    output directory gets files with the same names as that input's files.
+    The next item's inputs are decoded, and the previous item's outputs
+    encoded, while the filter runs. (Not supported on Windows.)
+
     For inputs, there are also "pseudo-file" specifiers you can use; currently
     supported are
 
@@ -128,6 +143,30 @@ Flags:
         Override the default maximum number of benchmarking iterations; ignored
         if --benchmarks is not also specified.
 
+    --benchmark_device_timing:
+        Time the device's work with CUDA events, OpenCL profiling info or
+        Metal GPU timestamps while benchmarking, and report the time spent
+        running kernels, copying, and on the host separately. The device is
+        only synchronized at the end of each set of iterations, so that
+        asynchronous launches overlap. Ignored if --benchmarks is not also
+        specified.
+
+    --throughput=NUM:
+        Instead of benchmarking single calls, call the filter from NUM
+        threads at once, each with its own output buffers, and report the
+        number of calls completed per second along with the 50th, 90th and
+        99th percentile latency of a call.
+
+    --throughput_time=DURATION_SECONDS [default = 1]:
+        How long to measure throughput for; ignored if --throughput is not
+        also specified.
+
+    --throughput_runtime_threads=NUM,NUM,...:
+        Measure throughput once for each of the given sizes of the Halide
+        thread pool (as set by halide_set_num_threads()), to find the best
+        balance between parallelism within and across calls; ignored if
+        --throughput is not also specified.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -292,6 +331,10 @@ int main(int argc, char **argv) {
     double benchmark_min_time = BenchmarkConfig().min_time;
     uint64_t benchmark_min_iters = BenchmarkConfig().min_iters;
     uint64_t benchmark_max_iters = BenchmarkConfig().max_iters;
+    bool benchmark_device_timing = false;
+    int throughput_callers = 0;
+    double throughput_time = 1.0;
+    std::vector<int> throughput_runtime_threads;
     std::string default_input_buffers;
     std::string default_input_scalars;
     for (int i = 1; i < argc; ++i) {
@@ -353,6 +396,29 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_max_iters)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_device_timing") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark_device_timing)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "throughput") {
+                if (!parse_scalar(flag_value, &throughput_callers) || throughput_callers < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "throughput_time") {
+                if (!parse_scalar(flag_value, &throughput_time)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "throughput_runtime_threads") {
+                for (const auto &n : split_string(flag_value, ",")) {
+                    int threads;
+                    if (!parse_scalar(n, &threads) || threads < 1) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    throughput_runtime_threads.push_back(threads);
+                }
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -385,8 +451,9 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    // It's OK to omit output arguments when we are benchmarking or tracking memory.
-    bool ok_to_omit_outputs = (benchmark || track_memory);
+    // It's OK to omit output arguments when we are benchmarking, measuring
+    // throughput or tracking memory.
+    bool ok_to_omit_outputs = (benchmark || track_memory || throughput_callers > 0);
 
     if (benchmark && track_memory) {
         warn() << "Using --track_memory with --benchmarks will produce inaccurate benchmark results.";
@@ -395,6 +462,16 @@ int main(int argc, char **argv) {
     // Check to be sure that all required arguments are specified.
     r.validate(seen_args, default_input_buffers, default_input_scalars, ok_to_omit_outputs);
 
+    // If any inputs name directories or patterns, process each item in
+    // turn, then we're done.
+    if (r.expand_batch() > 0) {
+        if (benchmark || track_memory || throughput_callers > 0) {
+            fail() << "--benchmarks, --throughput and --track_memory can't be used with batched inputs.";
+        }
+        r.run_batch(user_specified_output_shape);
+        return 0;
+    }
+
     // Parse all the input arguments, loading images as necessary.
     // (Don't handle outputs yet.)
     r.load_inputs(user_specified_output_shape);
@@ -412,8 +489,18 @@ int main(int argc, char **argv) {
         tracker.install();
     }
 
-    if (benchmark) {
-        r.run_for_benchmark(benchmark_min_time, benchmark_min_iters, benchmark_max_iters);
+    if (throughput_callers > 0) {
+        if (throughput_runtime_threads.empty()) {
+            r.run_for_throughput(throughput_callers, throughput_time, 0);
+        }
+        for (int threads : throughput_runtime_threads) {
+            r.run_for_throughput(throughput_callers, throughput_time, threads);
+        }
+        // The outputs above are thrown away; compute the ones to save.
+        r.run_for_output();
+    } else if (benchmark) {
+        r.run_for_benchmark(benchmark_min_time, benchmark_min_iters, benchmark_max_iters,
+                            benchmark_device_timing);
     } else {
         r.run_for_output();
     }
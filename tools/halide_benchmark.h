@@ -4,8 +4,12 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <limits>
+#include <string>
 
 namespace Halide {
 namespace Tools {
@@ -36,8 +40,8 @@ struct SteadyClock<false> {
 // if the callback doesn't include calls to device_sync(), the reported
 // time may only be that to queue the requests; if the callback *does*
 // include calls to device_sync(), it might exaggerate the sync overhead
-// for real-world use. For now, callers using this to benchmark GPU
-// code should measure with extreme caution.
+// for real-world use. To benchmark GPU code, use the adaptive version
+// with BenchmarkConfig::device_sync and device_times set.
 
 inline double benchmark(uint64_t samples, uint64_t iterations, std::function<void()> op) {
     using BenchmarkClock = SteadyClock<>::type;
@@ -64,13 +68,15 @@ inline double benchmark(uint64_t samples, uint64_t iterations, std::function<voi
 // Most callers should be able to get good results without needing to specify
 // custom BenchmarkConfig values.
 //
-// IMPORTANT NOTE: Using this tool for timing GPU code may be misleading,
-// as it does not account for time needed to synchronize to/from the GPU;
-// if the callback doesn't include calls to device_sync(), the reported
-// time may only be that to queue the requests; if the callback *does*
-// include calls to device_sync(), it might exaggerate the sync overhead
-// for real-world use. For now, callers using this to benchmark GPU
-// code should measure with extreme caution.
+// To benchmark GPU code, set the device_sync and device_times hooks of
+// the BenchmarkConfig. The callback should then only launch the work,
+// without calls to device_sync(): each sample waits for the device once
+// at its end, so that asynchronous launches overlap as they would in
+// real-world use, and the device's own measurements of the time it spent
+// running kernels and copying are reported separately from the time the
+// host spent on the rest. Without these hooks, the reported time may
+// only be that to queue the requests, or exaggerate the sync overhead,
+// depending on whether the callback includes calls to device_sync().
 
 constexpr uint64_t kBenchmarkMaxIterations = 1000000000;
 
@@ -94,6 +100,31 @@ struct BenchmarkConfig {
     // this. Controls accuracy. The closer to zero this gets the more
     // reliable the answer, but the longer it may take to run.
     double accuracy{0.03};
+
+    // Run the operation this many times before taking any
+    // measurements, e.g. to fault in memory or JIT-compile.
+    uint64_t warmup_iters{0};
+
+    // Take at least this many samples, even if it means exceeding
+    // max_time. Useful for getting a meaningful variance.
+    uint64_t min_samples{0};
+
+    // The name to record the result under when HL_BENCHMARK_JSON is
+    // set (see record_benchmark_result below). If empty, results are
+    // numbered in the order they are taken.
+    std::string name;
+
+    // For GPU code: wait for the device to finish the work queued by
+    // the operation, e.g. by calling device_sync() on its outputs. Run
+    // at the end of each sample, inside the timed region.
+    std::function<void()> device_sync;
+
+    // For GPU code: get the time in seconds the device spent running
+    // kernels and copying since the last call, as measured by the
+    // device, e.g. with halide_get_device_timing() (with device timing
+    // enabled by halide_enable_device_timing()) or
+    // JITSharedRuntime::device_timing_get().
+    std::function<void(double *kernel_time, double *copy_time)> device_times;
 };
 
 struct BenchmarkResult {
@@ -114,11 +145,99 @@ struct BenchmarkResult {
     // Will be <= config.accuracy unless max_iters is exceeded.
     double accuracy;
 
+    // Mean and standard deviation of the elapsed wall-clock time per
+    // iteration over the samples used for measurement (seconds).
+    double mean_time;
+    double stddev_time;
+
+    // With BenchmarkConfig::device_times set: the time per iteration
+    // the device spent running kernels and copying during the sample
+    // with the best wall time, and the rest of its wall time, spent by
+    // the host launching work and waiting for the device (seconds).
+    double kernel_time;
+    double copy_time;
+    double host_overhead;
+
     operator double() const { return wall_time; }
 };
 
+// If the environment variable HL_BENCHMARK_JSON names a file, append
+// a JSON object describing the result to it, on a line of its own, so
+// that the results of many benchmark runs (e.g. by 'make
+// benchmark_suite') can be collected in one file and compared across
+// Halide versions. Names are prefixed with HL_BENCHMARK_NAME if it is
+// set. The thread count recorded is the value of HL_NUM_THREADS, or
+// zero if the runtime's default was used.
+inline void record_benchmark_result(const std::string &name, const BenchmarkResult &result) {
+    const char *filename = getenv("HL_BENCHMARK_JSON");
+    if (!filename || !*filename) {
+        return;
+    }
+    static int unnamed = 0;
+    std::string full_name = name.empty() ? std::to_string(unnamed++) : name;
+    const char *prefix = getenv("HL_BENCHMARK_NAME");
+    if (prefix && *prefix) {
+        full_name = std::string(prefix) + "/" + full_name;
+    }
+    FILE *f = fopen(filename, "a");
+    if (!f) {
+        fprintf(stderr, "Could not open %s for writing\n", filename);
+        return;
+    }
+    const char *threads = getenv("HL_NUM_THREADS");
+    fprintf(f,
+            "{\"name\": \"%s\", \"threads\": %d, \"wall_time\": %g, "
+            "\"mean_time\": %g, \"stddev_time\": %g, \"samples\": %llu, "
+            "\"iterations\": %llu, \"accuracy\": %g",
+            full_name.c_str(), threads ? atoi(threads) : 0, result.wall_time,
+            result.mean_time, result.stddev_time,
+            (unsigned long long)result.samples,
+            (unsigned long long)result.iterations, result.accuracy);
+    if (result.kernel_time > 0 || result.copy_time > 0) {
+        fprintf(f, ", \"kernel_time\": %g, \"copy_time\": %g, \"host_overhead\": %g",
+                result.kernel_time, result.copy_time, result.host_overhead);
+    }
+    fprintf(f, "}\n");
+    fclose(f);
+}
+
 inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config = {}) {
-    BenchmarkResult result{0, 0, 0};
+    BenchmarkResult result{0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    for (uint64_t i = 0; i < config.warmup_iters; i++) {
+        op();
+    }
+
+    // Time one sample, and keep the device times per iteration of the
+    // best one.
+    double best_time = std::numeric_limits<double>::infinity();
+    double best_kernel_time = 0, best_copy_time = 0;
+    auto sample = [&](uint64_t iters) {
+        const uint64_t sample_iters = iters;
+        if (config.device_sync) {
+            config.device_sync();
+        }
+        double kernel_time = 0, copy_time = 0;
+        if (config.device_times) {
+            // Discard the times of work done before this sample.
+            config.device_times(&kernel_time, &copy_time);
+        }
+        double t = benchmark(1, iters, [&]() {
+            op();
+            if (--iters == 0 && config.device_sync) {
+                config.device_sync();
+            }
+        });
+        if (config.device_times) {
+            config.device_times(&kernel_time, &copy_time);
+        }
+        if (t < best_time) {
+            best_time = t;
+            best_kernel_time = kernel_time / sample_iters;
+            best_copy_time = copy_time / sample_iters;
+        }
+        return t;
+    };
 
     const double min_time = std::max(10 * 1e-6, config.min_time);
     const double max_time = std::max(config.min_time, config.max_time);
@@ -136,16 +255,21 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     double times[kMinSamples + 1] = {0};
 
     double total_time = 0;
+    // Sum and sum of squares of the per-iteration time of each sample.
+    double sum = 0, sum_sq = 0;
     uint64_t iters_per_sample = min_iters;
     while (result.iterations < max_iters) {
         result.samples = 0;
         result.iterations = 0;
         total_time = 0;
+        sum = sum_sq = 0;
         for (int i = 0; i < kMinSamples; i++) {
-            times[i] = benchmark(1, iters_per_sample, op);
+            times[i] = sample(iters_per_sample);
             result.samples++;
             result.iterations += iters_per_sample;
             total_time += times[i] * iters_per_sample;
+            sum += times[i];
+            sum_sq += times[i] * times[i];
         }
         std::sort(times, times + kMinSamples);
         if (times[0] * iters_per_sample * kMinSamples >= min_time) {
@@ -162,21 +286,35 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     // - No matter what, don't go over max_iters or max_time; this is important, in case
     // we happen to get faster results for the first samples, then happen to transition
     // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
-                 total_time < max_time &&
+    // - Take at least min_samples samples, if asked to.
+    while ((result.samples < config.min_samples ||
+            ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
+             total_time < max_time)) &&
                  result.iterations < max_iters) {
-        times[kMinSamples] = benchmark(1, iters_per_sample, op);
+        times[kMinSamples] = sample(iters_per_sample);
         result.samples++;
         result.iterations += iters_per_sample;
         total_time += times[kMinSamples] * iters_per_sample;
+        sum += times[kMinSamples];
+        sum_sq += times[kMinSamples] * times[kMinSamples];
         std::sort(times, times + kMinSamples + 1);
     }
     result.wall_time = times[0];
     result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
+    result.mean_time = sum / result.samples;
+    result.stddev_time = std::sqrt(std::max(0.0, sum_sq / result.samples - result.mean_time * result.mean_time));
+    if (config.device_times) {
+        result.kernel_time = best_kernel_time;
+        result.copy_time = best_copy_time;
+        result.host_overhead = std::max(0.0, result.wall_time - result.kernel_time - result.copy_time);
+    }
+
+    record_benchmark_result(config.name, result);
 
     return result;
 }
 
+
 }   // namespace Tools
 }   // mamespace Halide
 
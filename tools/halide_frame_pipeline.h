@@ -0,0 +1,255 @@
+#ifndef HALIDE_FRAME_PIPELINE_H
+#define HALIDE_FRAME_PIPELINE_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+// Run a chain of pipelines over a stream of frames, with each
+// pipeline (a "stage") working on a different frame at once. While
+// the last stage works on frame N, the first may already be working
+// on frame N + 2, so throughput approaches that of the slowest stage
+// rather than that of all the stages added together. This is the
+// across-frames counterpart of Func::async(), which only overlaps
+// stages within a single realization.
+//
+// Each stage is typically a separately compiled AOT pipeline. Stages
+// run on threads of their own and hand frames to one another through
+// bounded ring buffers of preallocated buffers, so memory use is
+// fixed and a slow stage applies back-pressure to the stages before
+// it. Each stage may use the Halide thread pool as usual. For
+// example:
+//
+//     FramePipeline pipe(halide_type_of<uint8_t>(), {1920, 1080, 3});
+//     pipe.add_stage([](halide_buffer_t *in, halide_buffer_t *out) {
+//         return denoise(in, out);
+//     }, halide_type_of<uint16_t>(), {1920, 1080, 3});
+//     pipe.add_stage([](halide_buffer_t *in, halide_buffer_t *out) {
+//         return tone_map(in, out);
+//     }, halide_type_of<uint8_t>(), {1920, 1080, 3});
+//     pipe.start();
+//
+//     // On one thread:
+//     while (have_frames) {
+//         pipe.push([&](Runtime::Buffer<void> &frame) { decode_into(frame); });
+//     }
+//     pipe.close();
+//
+//     // On another:
+//     while (pipe.pop([&](const Runtime::Buffer<void> &frame) { encode(frame); })) {
+//     }
+//
+// Frames come out in the order they went in.
+class FramePipeline {
+public:
+    // A stage reads the output of the stage before it, or the pushed
+    // frame for the first stage, and writes its own output. It
+    // returns zero on success, or an error code.
+    using Stage = std::function<int(halide_buffer_t *input, halide_buffer_t *output)>;
+
+    // Create a pipeline whose frames have the given type and shape,
+    // with queue_depth buffers between each pair of stages.
+    FramePipeline(halide_type_t frame_type, const std::vector<int> &frame_extents,
+                  int queue_depth = 2)
+        : queue_depth(queue_depth < 1 ? 1 : queue_depth) {
+        rings.emplace_back(new Ring(frame_type, frame_extents, this->queue_depth));
+    }
+
+    FramePipeline(const FramePipeline &) = delete;
+    FramePipeline &operator=(const FramePipeline &) = delete;
+
+    // Frames still in flight are discarded.
+    ~FramePipeline() {
+        for (auto &r : rings) {
+            r->abort();
+        }
+        join();
+    }
+
+    // Add a stage whose output has the given type and shape. Stages
+    // must all be added before start().
+    void add_stage(Stage stage, halide_type_t output_type, const std::vector<int> &output_extents) {
+        stages.push_back(std::move(stage));
+        rings.emplace_back(new Ring(output_type, output_extents, queue_depth));
+    }
+
+    // Start the stage threads.
+    void start() {
+        for (size_t i = 0; i < stages.size(); i++) {
+            threads.emplace_back([this, i]() { run_stage(i); });
+        }
+    }
+
+    // Feed in the next frame. 'fill' is given a buffer to write the
+    // frame into. Blocks while the first stage is queue_depth frames
+    // behind. Returns false, without calling 'fill', if the pipeline
+    // has failed or been closed.
+    bool push(const std::function<void(Runtime::Buffer<void> &)> &fill) {
+        Ring &in = *rings.front();
+        int slot = in.acquire_write();
+        if (slot < 0) {
+            return false;
+        }
+        fill(in.slots[slot]);
+        in.slots[slot].set_host_dirty();
+        in.commit_write();
+        return true;
+    }
+
+    // Take the next finished frame. 'consume' is given the output of
+    // the last stage, which is only valid during the call. Blocks
+    // until a frame is finished. Returns false once every frame
+    // pushed before close() has been popped, or the pipeline has
+    // failed.
+    bool pop(const std::function<void(const Runtime::Buffer<void> &)> &consume) {
+        Ring &out = *rings.back();
+        int slot = out.acquire_read();
+        if (slot < 0) {
+            return false;
+        }
+        consume(out.slots[slot]);
+        out.release_read();
+        return true;
+    }
+
+    // Signal that no more frames will be pushed. Frames already
+    // pushed still make their way through.
+    void close() {
+        rings.front()->close();
+    }
+
+    // Wait for the stage threads to finish. Only returns once the
+    // pipeline is closed and drained, or has failed.
+    void join() {
+        for (auto &t : threads) {
+            t.join();
+        }
+        threads.clear();
+    }
+
+    // The error code of the first stage to fail, or zero.
+    int error() {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        return error_code;
+    }
+
+private:
+    // A fixed set of buffers handed from one thread to another in
+    // order. A slot is only reused once the reader releases it.
+    struct Ring {
+        std::vector<Runtime::Buffer<void>> slots;
+        int head = 0, filled = 0;
+        bool closed = false, aborted = false;
+        std::mutex mutex;
+        std::condition_variable cond;
+
+        Ring(halide_type_t type, const std::vector<int> &extents, int depth) {
+            for (int i = 0; i < depth; i++) {
+                slots.emplace_back(type, extents);
+            }
+        }
+
+        // The slot to write the next frame into, or -1 if aborted.
+        int acquire_write() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return aborted || closed || filled < (int)slots.size(); });
+            if (aborted || closed) {
+                return -1;
+            }
+            return (head + filled) % (int)slots.size();
+        }
+
+        void commit_write() {
+            std::lock_guard<std::mutex> lock(mutex);
+            filled++;
+            cond.notify_all();
+        }
+
+        // The slot holding the next frame, or -1 if there are no more.
+        int acquire_read() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return aborted || closed || filled > 0; });
+            if (aborted || filled == 0) {
+                return -1;
+            }
+            return head;
+        }
+
+        void release_read() {
+            std::lock_guard<std::mutex> lock(mutex);
+            head = (head + 1) % (int)slots.size();
+            filled--;
+            cond.notify_all();
+        }
+
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            cond.notify_all();
+        }
+
+        void abort() {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = true;
+            cond.notify_all();
+        }
+    };
+
+    void fail(int err) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error_code == 0) {
+                error_code = err;
+            }
+        }
+        for (auto &r : rings) {
+            r->abort();
+        }
+    }
+
+    void run_stage(size_t i) {
+        Ring &in = *rings[i], &out = *rings[i + 1];
+        while (true) {
+            int src = in.acquire_read();
+            if (src < 0) {
+                break;
+            }
+            int dst = out.acquire_write();
+            if (dst < 0) {
+                break;
+            }
+            int err = stages[i](in.slots[src].raw_buffer(), out.slots[dst].raw_buffer());
+            if (err == 0) {
+                err = out.slots[dst].copy_to_host();
+            }
+            if (err != 0) {
+                fail(err);
+                break;
+            }
+            in.release_read();
+            out.commit_write();
+        }
+        out.close();
+    }
+
+    int queue_depth;
+    std::vector<Stage> stages;
+    // rings[i] is the input of stage i, and rings[i + 1] its output.
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<std::thread> threads;
+    std::mutex error_mutex;
+    int error_code = 0;
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_FRAME_PIPELINE_H
@@ -5,14 +5,17 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <atomic>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cctype>
 
@@ -26,6 +29,20 @@
 
 #include "HalideRuntime.h"  // for halide_type_t
 
+#if defined(_WIN32) && !defined(HALIDE_NO_MMAP)
+#define HALIDE_NO_MMAP
+#endif
+
+#ifndef HALIDE_NO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <new>
+
+#include "HalideBuffer.h"  // for mapping files into Halide::Runtime::Buffers
+#endif
+
 namespace Halide {
 namespace Tools {
 
@@ -330,25 +347,54 @@ struct FileOpener {
     FILE * const f;
 };
 
+// Swap the bytes of 'count' big-endian ElemTypes at 'src' into 'dst',
+// which may be the same place. A no-op copy for single-byte types.
+template<typename ElemType>
+void big_endian_to_native(const uint8_t *src, ElemType *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = read_big_endian<ElemType>(src + i * sizeof(ElemType));
+    }
+}
+
+template<>
+inline void big_endian_to_native(const uint8_t *src, uint8_t *dst, size_t count) {
+    memcpy(dst, src, count);
+}
+
 // Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
-// Multibyte elements are assumed to be big-endian.
+// Multibyte elements are assumed to be big-endian. The byte buffer is
+// interleaved; rows of interleaved images are copied in bulk.
 template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
     auto im_typed = im->template as<ElemType>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
         const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c+cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        ElemType *dst = &im_typed(xmin, y, cmin);
+        if (x_stride == channels && c_stride == 1) {
+            big_endian_to_native<ElemType>(src, dst, (size_t)width * channels);
+            return;
+        }
+        for (int c = 0; c < channels; c++) {
+            ElemType *dst_c = dst + c * c_stride;
+            const uint8_t *src_c = src + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                dst_c[x * x_stride] = read_big_endian<ElemType>(src_c);
+                src_c += channels * sizeof(ElemType);
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
+        ElemType *dst = &im_typed(xmin, y);
+        if (x_stride == 1) {
+            big_endian_to_native<ElemType>(src, dst, width);
+            return;
+        }
+        for (int x = 0; x < width; x++) {
+            dst[x * x_stride] = read_big_endian<ElemType>(src);
             src += sizeof(ElemType);
         }
     }
@@ -360,19 +406,29 @@ template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<typename std::add_const<ElemType>::type>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
         const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        const ElemType *src = &im_typed(xmin, y, cmin);
+        if (sizeof(ElemType) == 1 && x_stride == channels && c_stride == 1) {
+            memcpy(dst, src, (size_t)width * channels);
+            return;
+        }
+        for (int c = 0; c < channels; c++) {
+            const ElemType *src_c = src + c * c_stride;
+            uint8_t *dst_c = dst + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(src_c[x * x_stride], dst_c);
+                dst_c += channels * sizeof(ElemType);
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
+        const ElemType *src = &im_typed(xmin, y);
+        for (int x = 0; x < width; x++) {
+            write_big_endian<ElemType>(src[x * x_stride], dst);
             dst += sizeof(ElemType);
         }
     }
@@ -684,6 +740,9 @@ bool save_ppm(ImageType &im, const std::string &filename) {
 
 #ifndef HALIDE_NO_JPEG
 
+// The number of scanlines passed to libjpeg at once.
+constexpr int kJpegRowsPerCall = 16;
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_jpg(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -714,13 +773,26 @@ bool load_jpg(const std::string &filename, ImageType *im) {
 
     auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels);
+    // Decode several scanlines per call; this lets the library run its
+    // upsampling and color conversion over more than one row at a time.
+    const int rows_per_call = Internal::kJpegRowsPerCall;
+    std::vector<uint8_t> rows((size_t)width * channels * rows_per_call);
+    std::vector<JSAMPROW> row_ptrs(rows_per_call);
+    for (int i = 0; i < rows_per_call; i++) {
+        row_ptrs[i] = rows.data() + (size_t)width * channels * i;
+    }
     const int ymin = im->dim(1).min();
     const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *src = row.data();
-        jpeg_read_scanlines(&cinfo, &src, 1);
-        copy_to_image(row.data(), y, im);
+    for (int y = ymin; y <= ymax;) {
+        const int n = jpeg_read_scanlines(&cinfo, row_ptrs.data(), std::min(rows_per_call, ymax - y + 1));
+        if (!check(n > 0, "Error loading JPEG")) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            copy_to_image(row_ptrs[i], y + i, im);
+        }
+        y += n;
     }
 
     jpeg_finish_decompress(&cinfo);
@@ -773,13 +845,20 @@ bool save_jpg(ImageType &im, const std::string &filename) {
 
     auto copy_from_image = Internal::write_big_endian_row<uint8_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels);
+    const int rows_per_call = Internal::kJpegRowsPerCall;
+    std::vector<uint8_t> rows((size_t)width * channels * rows_per_call);
+    std::vector<JSAMPROW> row_ptrs(rows_per_call);
+    for (int i = 0; i < rows_per_call; i++) {
+        row_ptrs[i] = rows.data() + (size_t)width * channels * i;
+    }
     const int ymin = im.dim(1).min();
     const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *dst = row.data();
-        copy_from_image(im, y, dst);
-        jpeg_write_scanlines(&cinfo, &dst, 1);
+    for (int y = ymin; y <= ymax; y += rows_per_call) {
+        const int n = std::min(rows_per_call, ymax - y + 1);
+        for (int i = 0; i < n; i++) {
+            copy_from_image(im, y + i, row_ptrs[i]);
+        }
+        jpeg_write_scanlines(&cinfo, row_ptrs.data(), n);
     }
 
     jpeg_finish_compress(&cinfo);
@@ -831,12 +910,9 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_tmp(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
+// Read the header of a .tmp file, leaving f at the start of the payload.
+template<CheckFunc check>
+bool read_tmp_header(FileOpener &f, halide_type_t *im_type, std::vector<int> *im_dimensions) {
     if (!check(f.f != nullptr, "File could not be opened for reading")) {
         return false;
     }
@@ -851,8 +927,22 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = { header[0], header[1], header[2], header[3] };
+    *im_type = tmp_code_to_halide_type()[header[4]];
+    *im_dimensions = { header[0], header[1], header[2], header[3] };
+    return true;
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_tmp(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
+        return false;
+    }
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -905,14 +995,10 @@ bool write_planar_payload(ImageType &im, FileOpener &f) {
     return true;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_tmp(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    im.copy_to_host();
-
-    int32_t header[5] = { 1, 1, 1, 1, -1 };
+template<typename ImageType, CheckFunc check>
+bool make_tmp_header(const ImageType &im, int32_t (&header)[5]) {
+    header[0] = header[1] = header[2] = header[3] = 1;
+    header[4] = -1;
     for (int i = 0; i < im.dimensions(); ++i) {
         header[i] = im.dim(i).extent();
     }
@@ -923,7 +1009,18 @@ bool save_tmp(ImageType &im, const std::string &filename) {
             break;
         }
     }
-    if (!check(header[4] >= 0, "Unsupported type for .tmp file")) {
+    return check(header[4] >= 0, "Unsupported type for .tmp file");
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_tmp(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    int32_t header[5];
+    if (!make_tmp_header<ImageType, check>(im, header)) {
         return false;
     }
 
@@ -979,11 +1076,9 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
+// Read the headers of a .mat file, leaving f at the start of the payload.
+template<CheckFunc check>
+bool read_mat_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents_out) {
     if (!check(f.f != nullptr, "File could not be opened for reading")) {
         return false;
     }
@@ -1055,38 +1150,54 @@ bool load_mat(const std::string &filename, ImageType *im) {
     if (!check(f.read_array(payload_header), "Could not read .mat header\n")) {
         return false;
     }
-    halide_type_t type;
     switch (payload_header[0]) {
     case miINT8:
-        type = halide_type_of<int8_t>();
+        *type = halide_type_of<int8_t>();
         break;
     case miINT16:
-        type = halide_type_of<int16_t>();
+        *type = halide_type_of<int16_t>();
         break;
     case miINT32:
-        type = halide_type_of<int32_t>();
+        *type = halide_type_of<int32_t>();
         break;
     case miINT64:
-        type = halide_type_of<int64_t>();
+        *type = halide_type_of<int64_t>();
         break;
     case miUINT8:
-        type = halide_type_of<uint8_t>();
+        *type = halide_type_of<uint8_t>();
         break;
     case miUINT16:
-        type = halide_type_of<uint16_t>();
+        *type = halide_type_of<uint16_t>();
         break;
     case miUINT32:
-        type = halide_type_of<uint32_t>();
+        *type = halide_type_of<uint32_t>();
         break;
     case miUINT64:
-        type = halide_type_of<uint64_t>();
+        *type = halide_type_of<uint64_t>();
         break;
     case miSINGLE:
-        type = halide_type_of<float>();
+        *type = halide_type_of<float>();
         break;
     case miDOUBLE:
-        type = halide_type_of<double>();
+        *type = halide_type_of<double>();
         break;
+    default:
+        return check(false, "Could not parse this .mat file: unsupported payload type\n");
+    }
+
+    *extents_out = extents;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
     }
 
     *im = ImageType(type, extents);
@@ -1312,6 +1423,200 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+#ifndef HALIDE_NO_MMAP
+
+// The allocation behind a Buffer that aliases a memory-mapped file.
+struct MappedFile {
+    Halide::Runtime::AllocationHeader header;
+    void *addr;
+    size_t length;
+
+    static void release(void *p) {
+        // The Buffer has already destroyed the header.
+        MappedFile *m = (MappedFile *)p;
+        munmap(m->addr, m->length);
+        free(m);
+    }
+};
+
+// Map a file privately (writes don't reach the file), and make im a
+// Buffer of the given type and shape whose host pointer is the byte
+// 'offset' into it. The mapping is released along with the last
+// Buffer that refers to it.
+template<typename ImageType, CheckFunc check>
+bool map_file_into_image(const std::string &filename, size_t offset, halide_type_t type,
+                         const std::vector<halide_dimension_t> &shape, ImageType *im) {
+    size_t size = 1;
+    for (const halide_dimension_t &d : shape) {
+        size += (size_t)(d.extent - 1) * d.stride;
+    }
+    size *= type.bytes();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (!check(fd >= 0, "File could not be opened for reading")) {
+        return false;
+    }
+    struct stat st;
+    if (!check(fstat(fd, &st) == 0 && (size_t)st.st_size >= offset + size, "File is too short for its header")) {
+        close(fd);
+        return false;
+    }
+    // Offsets passed to mmap must be page-aligned, so map from the
+    // start of the file.
+    void *addr = mmap(nullptr, offset + size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (!check(addr != MAP_FAILED, "Could not map file")) {
+        return false;
+    }
+
+    MappedFile *m = (MappedFile *)malloc(sizeof(MappedFile));
+    new (&m->header) Halide::Runtime::AllocationHeader(MappedFile::release);
+    m->addr = addr;
+    m->length = offset + size;
+
+    Halide::Runtime::Buffer<> b(type, (uint8_t *)addr + offset, (int)shape.size(), shape.data());
+    b.adopt_host_allocation(&m->header);
+    *im = ImageType(std::move(b));
+    im->set_host_dirty();
+    return true;
+}
+
+// The shape of a compact planar image with the given extents.
+inline std::vector<halide_dimension_t> planar_shape(const std::vector<int> &extents) {
+    std::vector<halide_dimension_t> shape;
+    int stride = 1;
+    for (int e : extents) {
+        shape.emplace_back(0, e, stride);
+        stride *= e;
+    }
+    return shape;
+}
+
+// Like load_tmp, but the payload is mapped rather than read. Falls
+// back to load_tmp if the payload isn't aligned for its type.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_tmp_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    size_t offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
+            return false;
+        }
+        offset = ftell(f.f);
+    }
+    if (offset % im_type.bytes() != 0) {
+        return load_tmp<ImageType, check>(filename, im);
+    }
+    return map_file_into_image<ImageType, check>(filename, offset, im_type, planar_shape(im_dimensions), im);
+}
+
+// Like load_mat, but the payload is mapped rather than read. Falls
+// back to load_mat if the payload isn't aligned for its type.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t type;
+    std::vector<int> extents;
+    size_t offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!read_mat_header<check>(f, &type, &extents)) {
+            return false;
+        }
+        offset = ftell(f.f);
+    }
+    if (offset % type.bytes() != 0) {
+        return load_mat<ImageType, check>(filename, im);
+    }
+    return map_file_into_image<ImageType, check>(filename, offset, type, planar_shape(extents), im);
+}
+
+// Like load_pnm, but the pixels are mapped rather than read, so the
+// result is interleaved rather than planar. Sixteen-bit files are
+// big-endian, so those fall back to load_pnm.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_pnm_mapped(const std::string &filename, int channels, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    const char *hdr_fmt = channels == 3 ? "P6" : "P5";
+    int width, height, bit_depth;
+    size_t offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!read_pnm_header<check>(f, hdr_fmt, &width, &height, &bit_depth)) {
+            return false;
+        }
+        offset = ftell(f.f);
+    }
+    if (bit_depth != 8) {
+        return load_pnm<ImageType, check>(filename, channels, im);
+    }
+
+    std::vector<halide_dimension_t> shape = {{0, width, channels}, {0, height, width * channels}};
+    if (channels > 1) {
+        shape.emplace_back(0, channels, 1);
+    }
+    return map_file_into_image<ImageType, check>(filename, offset, halide_type_t(halide_type_uint, 8), shape, im);
+}
+
+// Copy the elements of im to dst in planar order, advancing dst.
+template<typename ImageType>
+void copy_planar_payload(ImageType &im, uint8_t *&dst) {
+    if (im.dimensions() == 0 || buffer_is_compact_planar(im)) {
+        memcpy(dst, im.begin(), im.size_in_bytes());
+        dst += im.size_in_bytes();
+    } else {
+        int d = im.dimensions() - 1;
+        for (int i = im.dim(d).min(); i <= im.dim(d).max(); i++) {
+            auto slice = im.sliced(d, i);
+            copy_planar_payload(slice, dst);
+        }
+    }
+}
+
+// Like save_tmp, but writes the file through a shared mapping rather
+// than with fwrite.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_tmp_mapped(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    int32_t header[5];
+    if (!make_tmp_header<ImageType, check>(im, header)) {
+        return false;
+    }
+
+    const size_t length = sizeof(header) + im.number_of_elements() * im.type().bytes();
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (!check(fd >= 0, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!check(ftruncate(fd, length) == 0, "Could not resize file")) {
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (!check(addr != MAP_FAILED, "Could not map file")) {
+        return false;
+    }
+
+    uint8_t *dst = (uint8_t *)addr;
+    memcpy(dst, header, sizeof(header));
+    dst += sizeof(header);
+    copy_planar_payload(im, dst);
+
+    return check(munmap(addr, length) == 0, "Could not write .tmp payload");
+}
+
+#endif  // HALIDE_NO_MMAP
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_tiff(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -1886,9 +2191,97 @@ bool save(ImageType &im, const std::string &filename) {
     return imageio.save(im_d, filename);
 }
 
+// Like load(), but for uncompressed formats (.tmp, .mat, 8-bit .pgm and
+// .ppm), map the file into memory instead of reading it. The Image
+// aliases the mapped file, which is unmapped when the last Image
+// referring to it is destroyed. Writes to the Image don't reach the
+// file. Images from .pgm and .ppm files are interleaved rather than
+// planar. Other formats, and platforms without mmap, use load().
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+#ifdef HALIDE_NO_MMAP
+    return load<ImageType, check>(filename, im);
+#else
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d;
+    const std::string ext = Internal::get_lowercase_extension(filename);
+    bool ok;
+    if (ext == "tmp") {
+        ok = Internal::load_tmp_mapped<DynamicImageType, check>(filename, &im_d);
+    } else if (ext == "mat") {
+        ok = Internal::load_mat_mapped<DynamicImageType, check>(filename, &im_d);
+    } else if (ext == "pgm") {
+        ok = Internal::load_pnm_mapped<DynamicImageType, check>(filename, 1, &im_d);
+    } else if (ext == "ppm") {
+        ok = Internal::load_pnm_mapped<DynamicImageType, check>(filename, 3, &im_d);
+    } else {
+        return load<ImageType, check>(filename, im);
+    }
+    if (!ok) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    *im = im_d.template as<typename ImageType::ElemType>();
+    im->set_host_dirty();
+    return true;
+#endif
+}
+
+// Like save(), but write .tmp files through a memory mapping.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_mapped(ImageType &im, const std::string &filename) {
+#ifndef HALIDE_NO_MMAP
+    if (Internal::get_lowercase_extension(filename) == "tmp") {
+        auto im_d = im.template as<const void>();
+        return Internal::save_tmp_mapped<decltype(im_d), check>(im_d, filename);
+    }
+#endif
+    return save<ImageType, check>(im, filename);
+}
+
 // Return a set of FormatInfo structs that contain the legal type-and-dimensions
 // that can be saved in this format. Most applications won't ever need to use
 // this call. Returns false upon failure.
+// Load several images at once, decoding up to 'threads' files
+// concurrently (one per hardware thread if 'threads' is zero).
+// (*images)[i] is loaded from filenames[i]. Returns false if any
+// load failed; the others are loaded regardless.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_batch(const std::vector<std::string> &filenames, std::vector<ImageType> *images, int threads = 0) {
+    images->clear();
+    images->resize(filenames.size());
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    threads = std::max(1, std::min(threads, (int)filenames.size()));
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> success{true};
+    auto worker = [&]() {
+        for (size_t i = next++; i < filenames.size(); i = next++) {
+            if (!load<ImageType, check>(filenames[i], &(*images)[i])) {
+                success = false;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+        t.join();
+    }
+    return success;
+}
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
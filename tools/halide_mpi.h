@@ -0,0 +1,105 @@
+#ifndef HALIDE_MPI_H
+#define HALIDE_MPI_H
+
+#include <limits.h>
+#include <mpi.h>
+
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Tools {
+
+// Run the Funcs of Halide pipelines scheduled with distribute() across
+// the ranks of an MPI communicator. Every rank runs the same
+// pipelines, in the same order, on the same global input and output
+// sizes, and computes its own slice of each distributed Func:
+//
+//     MPI_Init(&argc, &argv);
+//     set_mpi_comm(MPI_COMM_WORLD);
+//     ...
+//     set_mpi_comm(MPI_COMM_NULL);  // back to a single rank
+//     MPI_Finalize();
+//
+// The communicator must outlive all pipelines run while it is set.
+
+namespace Internal {
+namespace MPI {
+
+inline MPI_Comm &comm() {
+    static MPI_Comm c = MPI_COMM_NULL;
+    return c;
+}
+
+inline int rank(void *user_context) {
+    int r = 0;
+    MPI_Comm_rank(comm(), &r);
+    return r;
+}
+
+inline int num_ranks(void *user_context) {
+    int n = 1;
+    MPI_Comm_size(comm(), &n);
+    return n;
+}
+
+inline int allgather(void *user_context, const void *send, void *recv, size_t size) {
+    if (size > INT_MAX ||
+        MPI_Allgather(send, (int)size, MPI_BYTE, recv, (int)size, MPI_BYTE, comm()) != MPI_SUCCESS) {
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+// Slabs of more than INT_MAX bytes can't be sent as a single count of
+// bytes. Distribute over an outer dimension to make them smaller.
+inline int isend(void *user_context, const void *data, size_t size, int dest, int tag, void **request) {
+    if (size > INT_MAX) {
+        return halide_error_code_generic_error;
+    }
+    MPI_Request *r = new MPI_Request;
+    if (MPI_Isend(data, (int)size, MPI_BYTE, dest, tag, comm(), r) != MPI_SUCCESS) {
+        delete r;
+        return halide_error_code_generic_error;
+    }
+    *request = r;
+    return 0;
+}
+
+inline int irecv(void *user_context, void *data, size_t size, int src, int tag, void **request) {
+    if (size > INT_MAX) {
+        return halide_error_code_generic_error;
+    }
+    MPI_Request *r = new MPI_Request;
+    if (MPI_Irecv(data, (int)size, MPI_BYTE, src, tag, comm(), r) != MPI_SUCCESS) {
+        delete r;
+        return halide_error_code_generic_error;
+    }
+    *request = r;
+    return 0;
+}
+
+inline int wait(void *user_context, void *request) {
+    MPI_Request *r = (MPI_Request *)request;
+    int result = MPI_Wait(r, MPI_STATUS_IGNORE);
+    delete r;
+    return result == MPI_SUCCESS ? 0 : halide_error_code_generic_error;
+}
+
+}  // namespace MPI
+}  // namespace Internal
+
+// Set the communicator distributed pipelines run across, or go back
+// to a single rank that computes everything if it is MPI_COMM_NULL.
+inline void set_mpi_comm(MPI_Comm comm) {
+    namespace M = Internal::MPI;
+    static const halide_distributed_comm_t mpi_comm = {
+        M::rank, M::num_ranks, M::allgather, M::isend, M::irecv, M::wait
+    };
+    M::comm() = comm;
+    halide_set_distributed_comm(comm == MPI_COMM_NULL ? nullptr : &mpi_comm);
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_MPI_H
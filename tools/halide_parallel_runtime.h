@@ -0,0 +1,384 @@
+#ifndef HALIDE_PARALLEL_RUNTIME_H
+#define HALIDE_PARALLEL_RUNTIME_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "HalideRuntime.h"
+
+#ifdef HALIDE_PARALLEL_RUNTIME_TBB
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Halide {
+namespace Tools {
+
+// Run Halide pipelines on a task scheduler owned by the host
+// application (TBB, OpenMP, folly, ...) instead of Halide's own
+// thread pool, so that the two do not oversubscribe the machine.
+//
+// Wrap the scheduler in an Executor and install it with
+// set_parallel_runtime before calling any pipelines:
+//
+//     TBBExecutor executor(&my_arena);
+//     set_parallel_runtime(&executor);
+//     ...
+//     set_parallel_runtime(nullptr);  // back to Halide's thread pool
+//
+// This replaces the whole parallel runtime, including the
+// semaphore-based protocol of halide_do_parallel_tasks that async()
+// producers and consumers use, and nested parallel loops. Pipelines
+// never block a thread inside a task: a task is only started once the
+// semaphores it needs can be acquired, and a thread that has to wait
+// for tasks to complete runs other runnable tasks of the same call,
+// or of the calls it is nested inside, in the meantime. So a
+// pipeline completes on any executor, even one that runs everything
+// on the calling thread.
+//
+// The executor must outlive all pipelines run while it is installed,
+// and the runtime must not be switched while a pipeline is running.
+class Executor {
+public:
+    virtual ~Executor() {}
+
+    // The number of threads that may usefully work on a single loop.
+    virtual int concurrency() = 0;
+
+    // Call f(0) ... f(n - 1), in any order and with any degree of
+    // parallelism, and return once they have all returned. The
+    // calling thread may take part. f may itself call parallel_for.
+    virtual void parallel_for(int n, const std::function<void(int)> &f) = 0;
+};
+
+#ifdef HALIDE_PARALLEL_RUNTIME_TBB
+// An executor that runs loops in a TBB task arena, or in the arena of
+// the calling thread if none is given.
+class TBBExecutor : public Executor {
+    tbb::task_arena *arena;
+
+public:
+    explicit TBBExecutor(tbb::task_arena *arena = nullptr) : arena(arena) {}
+
+    int concurrency() override {
+        return arena ? arena->max_concurrency() : tbb::this_task_arena::max_concurrency();
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        auto body = [&]() {
+            tbb::parallel_for(0, n, 1, [&](int i) { f(i); });
+        };
+        if (arena) {
+            arena->execute(body);
+        } else {
+            body();
+        }
+    }
+};
+#endif
+
+#ifdef _OPENMP
+// An executor that runs loops as OpenMP parallel regions. Nested
+// calls run on the thread that makes them unless nested parallelism
+// is enabled in the OpenMP runtime.
+class OpenMPExecutor : public Executor {
+public:
+    int concurrency() override {
+        return omp_get_max_threads();
+    }
+
+    void parallel_for(int n, const std::function<void(int)> &f) override {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+    }
+};
+#endif
+
+namespace Internal {
+namespace ParallelRuntime {
+
+inline Executor *&executor() {
+    static Executor *e = nullptr;
+    return e;
+}
+
+// Semaphores are a count held in the storage of the halide_semaphore_t.
+static_assert(sizeof(std::atomic<int>) <= sizeof(halide_semaphore_t),
+              "halide_semaphore_t is too small to hold a std::atomic<int>");
+
+inline std::atomic<int> *semaphore_value(halide_semaphore_t *s) {
+    return reinterpret_cast<std::atomic<int> *>(s);
+}
+
+inline int semaphore_init(halide_semaphore_t *s, int n) {
+    new (s) std::atomic<int>(n);
+    return n;
+}
+
+inline int semaphore_release(halide_semaphore_t *s, int n) {
+    return semaphore_value(s)->fetch_add(n) + n;
+}
+
+inline bool semaphore_try_acquire(halide_semaphore_t *s, int n) {
+    if (n == 0) {
+        return true;
+    }
+    std::atomic<int> *value = semaphore_value(s);
+    int expected = value->load();
+    while (expected >= n) {
+        if (value->compare_exchange_weak(expected, expected - n)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline int do_task(void *user_context, halide_task_t f, int idx, uint8_t *closure) {
+    return f(user_context, idx, closure);
+}
+
+inline int do_loop_task(void *user_context, halide_loop_task_t f, int min, int extent,
+                        uint8_t *closure, void *task_parent) {
+    return f(user_context, min, extent, closure, task_parent);
+}
+
+inline int do_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+    std::atomic<int> exit_status(0);
+    executor()->parallel_for(size, [&](int i) {
+        int result = f(user_context, min + i, closure);
+        if (result != 0) {
+            int expected = 0;
+            exit_status.compare_exchange_strong(expected, result);
+        }
+    });
+    return exit_status;
+}
+
+// The state of one call to do_parallel_tasks. Its address is the
+// task_parent passed to the tasks it runs, so nested calls can find
+// their way back to it.
+struct TaskGroup {
+    struct Task {
+        halide_parallel_task_t task;
+        // The next iteration to hand out, relative to task.min. For
+        // non-serial tasks this may overshoot task.extent.
+        std::atomic<int> next;
+        // Held by whoever is running an iteration of a serial task.
+        std::atomic<bool> running;
+    };
+
+    void *user_context;
+    TaskGroup *parent;
+    int num_tasks;
+    std::unique_ptr<Task[]> tasks;
+    std::atomic<int> unfinished;
+    std::atomic<int> exit_status;
+    std::atomic<bool> failed;
+
+    TaskGroup(void *user_context, int n, const halide_parallel_task_t *t, TaskGroup *parent)
+        : user_context(user_context), parent(parent), num_tasks(0),
+          tasks(new Task[n]), unfinished(0), exit_status(0), failed(false) {
+        int total = 0;
+        for (int i = 0; i < n; i++) {
+            if (t[i].extent <= 0) {
+                continue;
+            }
+            Task &task = tasks[num_tasks++];
+            task.task = t[i];
+            task.next = 0;
+            task.running = false;
+            total += t[i].extent;
+        }
+        unfinished = total;
+    }
+
+    // Once a call has failed, no further iterations of it, or of any
+    // call nested inside it, are run. Iterations waiting on
+    // semaphores may never become runnable, so they are retired
+    // without acquiring them.
+    bool cancelled() const {
+        for (const TaskGroup *g = this; g; g = g->parent) {
+            if (g->failed) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool all_claimed() const {
+        for (int i = 0; i < num_tasks; i++) {
+            if (tasks[i].next < tasks[i].task.extent) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool acquire_semaphores(const halide_parallel_task_t &t) {
+        for (int i = 0; i < t.num_semaphores; i++) {
+            if (!semaphore_try_acquire(t.semaphores[i].semaphore, t.semaphores[i].count)) {
+                for (int j = 0; j < i; j++) {
+                    semaphore_release(t.semaphores[j].semaphore, t.semaphores[j].count);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void release_semaphores(const halide_parallel_task_t &t) {
+        for (int i = 0; i < t.num_semaphores; i++) {
+            semaphore_release(t.semaphores[i].semaphore, t.semaphores[i].count);
+        }
+    }
+
+    void run(const halide_parallel_task_t &t, int iteration) {
+        int result = t.fn(user_context, t.min + iteration, 1, t.closure, this);
+        if (result != 0) {
+            int expected = 0;
+            exit_status.compare_exchange_strong(expected, result);
+            failed = true;
+        }
+        unfinished--;
+    }
+
+    // Retire every unclaimed iteration of a task without running it.
+    bool retire(Task &task) {
+        const int extent = task.task.extent;
+        if (task.task.serial) {
+            bool expected = false;
+            if (!task.running.compare_exchange_strong(expected, true)) {
+                return false;
+            }
+            int next = task.next.exchange(extent);
+            task.running = false;
+            unfinished -= std::max(extent - next, 0);
+            return next < extent;
+        } else {
+            int next = task.next.exchange(extent);
+            unfinished -= std::max(extent - next, 0);
+            return next < extent;
+        }
+    }
+
+    // Run one runnable iteration of any task. Returns false if there
+    // was none.
+    bool run_one() {
+        const bool cancel = cancelled();
+        for (int i = 0; i < num_tasks; i++) {
+            Task &task = tasks[i];
+            const halide_parallel_task_t &t = task.task;
+            if (task.next >= t.extent) {
+                continue;
+            }
+            if (cancel) {
+                if (retire(task)) {
+                    return true;
+                }
+                continue;
+            }
+            if (t.serial) {
+                bool expected = false;
+                if (!task.running.compare_exchange_strong(expected, true)) {
+                    continue;
+                }
+                int next = task.next;
+                if (next >= t.extent || !acquire_semaphores(t)) {
+                    task.running = false;
+                    continue;
+                }
+                task.next = next + 1;
+                run(t, next);
+                task.running = false;
+                return true;
+            } else {
+                if (!acquire_semaphores(t)) {
+                    continue;
+                }
+                int next = task.next++;
+                if (next >= t.extent) {
+                    release_semaphores(t);
+                    continue;
+                }
+                run(t, next);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Work on this call until every iteration has been handed out
+    // (for helpers) or has finished (for the caller). When nothing
+    // here is runnable, help out with the calls this one is nested
+    // inside, as they may be what it is waiting for.
+    void work(bool until_finished) {
+        while (unfinished > 0 && (until_finished || !all_claimed())) {
+            if (run_one()) {
+                continue;
+            }
+            bool helped = false;
+            for (TaskGroup *g = parent; g && !helped; g = g->parent) {
+                helped = g->run_one();
+            }
+            if (!helped) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+inline int do_parallel_tasks(void *user_context, int num_tasks,
+                             halide_parallel_task_t *tasks, void *task_parent) {
+    TaskGroup group(user_context, num_tasks, tasks, (TaskGroup *)task_parent);
+    if (group.unfinished == 0) {
+        return 0;
+    }
+    int helpers = std::min(executor()->concurrency(), (int)group.unfinished);
+    if (helpers > 1) {
+        executor()->parallel_for(helpers, [&](int) { group.work(false); });
+    }
+    group.work(true);
+    return group.exit_status;
+}
+
+}  // namespace ParallelRuntime
+}  // namespace Internal
+
+// Install an executor as the parallel runtime of all Halide
+// pipelines in the process, or restore Halide's own thread pool if
+// executor is null.
+inline void set_parallel_runtime(Executor *executor) {
+    namespace P = Internal::ParallelRuntime;
+    P::executor() = executor;
+    if (executor) {
+        halide_set_custom_parallel_runtime(P::do_par_for, P::do_task, P::do_loop_task,
+                                           P::do_parallel_tasks, P::semaphore_init,
+                                           P::semaphore_try_acquire, P::semaphore_release);
+    } else {
+        halide_set_custom_parallel_runtime(halide_default_do_par_for,
+                                           halide_default_do_task,
+                                           halide_default_do_loop_task,
+                                           halide_default_do_parallel_tasks,
+                                           halide_default_semaphore_init,
+                                           halide_default_semaphore_try_acquire,
+                                           halide_default_semaphore_release);
+    }
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_PARALLEL_RUNTIME_H
@@ -0,0 +1,185 @@
+#ifndef HALIDE_TILED_RUNNER_H
+#define HALIDE_TILED_RUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+// Run a pipeline over an output that is too large to be resident in
+// memory, one tile at a time. For each output tile, the pipeline is
+// first called in bounds-query mode to find the region of the input
+// it needs; that region is then pulled from a user-provided source,
+// the tile is computed, and the result is handed to a user-provided
+// sink. Several tiles are in flight at once, so that reading the
+// input for one tile, computing another and writing out a third can
+// all proceed at the same time. Only the tiles in flight are ever
+// allocated, so memory use is bounded by the tile size and the number
+// of threads, not by the size of the image.
+//
+// The pipeline must have exactly one input and one output buffer of
+// interest. Any other arguments should be bound by the caller, e.g.:
+//
+//     run_tiled<uint16_t, uint8_t>(
+//         [&](halide_buffer_t *in, halide_buffer_t *out) {
+//             return my_filter(in, width, height, out);
+//         },
+//         2, {40000, 40000},
+//         [&](Runtime::Buffer<uint16_t> &tile) { return read_region(file, tile); },
+//         [&](const Runtime::Buffer<uint8_t> &tile) { return write_region(file, tile); });
+//
+// Note that a pipeline which clamps its accesses to the bounds of
+// its input buffer will report that it can cope with any input
+// region, and so will be passed degenerate input tiles. Pipelines
+// run this way should apply their boundary conditions using the size
+// of the whole image, passed in as a separate parameter (see
+// test/generator/tiled_runner_generator.cpp for an example).
+
+struct TiledRunConfig {
+    // The extent of each output tile in each dimension. Dimensions
+    // not listed (or listed as zero) are not split. Tiles at the edge
+    // of the output are shrunk to fit.
+    std::vector<int> tile_extents;
+
+    // The maximum number of tiles in flight at once. Reads from the
+    // source are serialized, as are writes to the sink, so three is
+    // enough to keep input, computation and output all busy. Each
+    // call to the pipeline may use the Halide thread pool as usual.
+    int threads{3};
+};
+
+// Process the output region [0, output_extents) in tiles. 'pipeline'
+// is called once per tile in bounds-query mode, and once to compute
+// it. 'read' is given an allocated input buffer covering the region
+// the tile needs, and must fill it in. 'write' is given each computed
+// output tile, in no particular order. Calls to 'read' are
+// serialized, as are calls to 'write', but they may be made from any
+// thread. Returns zero on success, the error code of the pipeline if
+// it fails, or -1 if 'read' or 'write' returns false. No more tiles
+// are started after the first failure.
+template<typename InT, typename OutT>
+int run_tiled(std::function<int(halide_buffer_t *input, halide_buffer_t *output)> pipeline,
+              int input_dimensions,
+              const std::vector<int> &output_extents,
+              std::function<bool(Runtime::Buffer<InT> &)> read,
+              std::function<bool(const Runtime::Buffer<OutT> &)> write,
+              const TiledRunConfig &config = TiledRunConfig()) {
+    const int dims = (int)output_extents.size();
+
+    // Work out the tiling of the output.
+    std::vector<int> tile_extents(dims), tiles_per_dim(dims);
+    int64_t num_tiles = 1;
+    for (int d = 0; d < dims; d++) {
+        int e = d < (int)config.tile_extents.size() ? config.tile_extents[d] : 0;
+        if (e <= 0 || e > output_extents[d]) {
+            e = output_extents[d];
+        }
+        tile_extents[d] = e;
+        tiles_per_dim[d] = e > 0 ? (output_extents[d] + e - 1) / e : 0;
+        num_tiles *= tiles_per_dim[d];
+    }
+
+    std::atomic<int64_t> next_tile{0};
+    std::atomic<int> result{0};
+    std::mutex read_mutex, write_mutex;
+
+    // Record the first failure only.
+    auto fail = [&](int err) {
+        int expected = 0;
+        result.compare_exchange_strong(expected, err);
+    };
+
+    auto worker = [&]() {
+        std::vector<halide_dimension_t> out_shape(dims), in_shape(input_dimensions);
+        while (result == 0) {
+            int64_t t = next_tile++;
+            if (t >= num_tiles) {
+                break;
+            }
+
+            // Find the region of the output this tile covers.
+            for (int d = 0; d < dims; d++) {
+                int idx = (int)(t % tiles_per_dim[d]);
+                t /= tiles_per_dim[d];
+                out_shape[d].min = idx * tile_extents[d];
+                out_shape[d].extent = std::min(tile_extents[d], output_extents[d] - out_shape[d].min);
+                out_shape[d].stride = 0;
+            }
+
+            // Ask the pipeline what region of the input it needs for
+            // it. This may also grow the output region, if the
+            // pipeline constrains the shape of its output.
+            for (int d = 0; d < input_dimensions; d++) {
+                in_shape[d] = halide_dimension_t();
+            }
+            Runtime::Buffer<InT> in_query(nullptr, in_shape);
+            Runtime::Buffer<OutT> out_query(nullptr, out_shape);
+            int err = pipeline(in_query.raw_buffer(), out_query.raw_buffer());
+            if (err != 0) {
+                fail(err);
+                break;
+            }
+
+            std::vector<int> in_mins(input_dimensions), in_extents(input_dimensions);
+            for (int d = 0; d < input_dimensions; d++) {
+                in_mins[d] = in_query.dim(d).min();
+                in_extents[d] = in_query.dim(d).extent();
+            }
+            Runtime::Buffer<InT> in(in_extents);
+            in.set_min(in_mins);
+            {
+                std::lock_guard<std::mutex> lock(read_mutex);
+                if (result != 0 || !read(in)) {
+                    fail(-1);
+                    break;
+                }
+            }
+            in.set_host_dirty();
+
+            std::vector<int> out_mins(dims), out_extents(dims);
+            for (int d = 0; d < dims; d++) {
+                out_mins[d] = out_query.dim(d).min();
+                out_extents[d] = out_query.dim(d).extent();
+            }
+            Runtime::Buffer<OutT> out(out_extents);
+            out.set_min(out_mins);
+            err = pipeline(in.raw_buffer(), out.raw_buffer());
+            if (err != 0) {
+                fail(err);
+                break;
+            }
+            out.copy_to_host();
+
+            {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                if (result != 0 || !write(out)) {
+                    fail(-1);
+                    break;
+                }
+            }
+        }
+    };
+
+    int threads = (int)std::max<int64_t>(1, std::min<int64_t>(config.threads, num_tiles));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+        t.join();
+    }
+    return result;
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_TILED_RUNNER_H
@@ -1,13 +1,18 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -19,6 +24,8 @@
 #define STDOUT_FILENO 1
 #endif
 #else
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
@@ -142,37 +149,159 @@ T get_value_as(const halide_trace_packet_t &p, int idx) {
     return value_as<double>(p.type, aligned_value);
 }
 
-struct PacketAndPayload : public halide_trace_packet_t {
-    uint8_t payload[4096];
+// Reads trace packets from a file descriptor. A trace in a regular file is
+// memory-mapped and its packets are used in place. Otherwise (e.g. when the
+// trace is piped in), a background thread reads it in large blocks of whole
+// packets, so that reading the trace overlaps rendering it.
+class PacketReader {
+    static constexpr size_t header_size = sizeof(halide_trace_packet_t);
+    // The runtime never emits packets larger than this.
+    static constexpr size_t max_packet_size = header_size + 4096;
+    static constexpr size_t block_size = 1 << 20;
+    static constexpr size_t max_blocks_queued = 4;
+
+    const int fd;
+
+    // The mapped trace, if it is mapped.
+    const uint8_t *mapped = nullptr;
+    size_t mapped_size = 0;
+
+    // The blocks read but not yet consumed, if the trace is streamed.
+    struct Block {
+        std::vector<uint8_t> data;
+        // The end of the last whole packet in data.
+        size_t end = 0;
+    };
+    std::deque<Block> blocks;
+    bool reader_done = false;
+    std::mutex mutex;
+    std::condition_variable blocks_changed;
+    std::thread reader;
+
+    // The block packets are currently being returned from.
+    Block current;
+    size_t cursor = 0;
+
+    // Check the size of the packet at p, given that the trace has at least
+    // available bytes from p on, and return whether the whole packet is
+    // there.
+    static bool whole_packet_at(const uint8_t *p, size_t available) {
+        if (available < header_size) {
+            return false;
+        }
+        uint32_t size;
+        memcpy(&size, p, sizeof(size));
+        if (size < header_size || size > max_packet_size) {
+            fail() << "Invalid trace packet of size " << size;
+        }
+        return size <= available;
+    }
 
-    static bool read_or_die(void *buf, size_t count) {
-        char *p = (char *)buf;
-        char *p_end = p + count;
-        while (p < p_end) {
-            int64_t bytes_read = ::read(STDIN_FILENO, p, p_end - p);
-            if (bytes_read == 0) {
+    static bool read_or_die(int fd, uint8_t *p, size_t count, size_t *bytes_read) {
+        *bytes_read = 0;
+        while (*bytes_read < count) {
+            int64_t n = ::read(fd, p + *bytes_read, count - *bytes_read);
+            if (n == 0) {
                 return false;  // EOF
-            } else if (bytes_read < 0) {
+            } else if (n < 0) {
                 fail() << "Unable to read packet";
             }
-            p += bytes_read;
+            *bytes_read += n;
         }
-        assert(p == p_end);
         return true;
     }
 
-    bool read() {
-        constexpr size_t header_size = sizeof(halide_trace_packet_t);
-        if (!read_or_die(this, header_size)) {
-            return false;  // EOF
+    void read_blocks() {
+        std::vector<uint8_t> partial;
+        bool eof = false;
+        while (!eof) {
+            Block b;
+            b.data.resize(block_size);
+            std::copy(partial.begin(), partial.end(), b.data.begin());
+            size_t bytes_read;
+            eof = !read_or_die(fd, b.data.data() + partial.size(), block_size - partial.size(), &bytes_read);
+            const size_t available = partial.size() + bytes_read;
+
+            // Keep the packet split at the end of the block for the next one.
+            while (whole_packet_at(b.data.data() + b.end, available - b.end)) {
+                uint32_t size;
+                memcpy(&size, b.data.data() + b.end, sizeof(size));
+                b.end += size;
+            }
+            partial.assign(b.data.begin() + b.end, b.data.begin() + available);
+            if (eof && !partial.empty()) {
+                // Shouldn't ever get EOF in the middle of a packet
+                fail() << "Unable to read packet payload of size " << partial.size();
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            blocks_changed.wait(lock, [&]() { return blocks.size() < max_blocks_queued; });
+            blocks.push_back(std::move(b));
+            reader_done = eof;
+            blocks_changed.notify_all();
         }
+    }
 
-        const size_t payload_size = this->size - header_size;
-        if (payload_size > sizeof(this->payload) || !read_or_die(this->payload, payload_size)) {
-            // Shouldn't ever get EOF here
-            fail() << "Unable to read packet payload of size " << payload_size;
+public:
+    explicit PacketReader(int fd) : fd(fd) {
+#ifndef _MSC_VER
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                madvise(m, st.st_size, MADV_SEQUENTIAL);
+                mapped = (const uint8_t *)m;
+                mapped_size = st.st_size;
+                info() << "Mapped " << mapped_size << " bytes of trace";
+                return;
+            }
         }
-        return true;
+#endif
+        reader = std::thread([this]() { read_blocks(); });
+    }
+
+    ~PacketReader() {
+        if (reader.joinable()) {
+            reader.join();
+        }
+#ifndef _MSC_VER
+        if (mapped) {
+            munmap((void *)mapped, mapped_size);
+        }
+#endif
+    }
+
+    PacketReader(const PacketReader &) = delete;
+    void operator=(const PacketReader &) = delete;
+
+    // Return the next packet, or nullptr at the end of the trace. The
+    // packet remains valid until the next call.
+    const halide_trace_packet_t *next() {
+        if (mapped) {
+            if (!whole_packet_at(mapped + cursor, mapped_size - cursor)) {
+                if (cursor != mapped_size) {
+                    fail() << "Unable to read packet payload of size " << mapped_size - cursor;
+                }
+                return nullptr;
+            }
+        } else {
+            while (cursor == current.end) {
+                std::unique_lock<std::mutex> lock(mutex);
+                blocks_changed.wait(lock, [&]() { return !blocks.empty() || reader_done; });
+                if (blocks.empty()) {
+                    return nullptr;
+                }
+                current = std::move(blocks.front());
+                blocks.pop_front();
+                cursor = 0;
+                blocks_changed.notify_all();
+            }
+        }
+        const uint8_t *p = (mapped ? mapped : current.data.data()) + cursor;
+        // Packet sizes are multiples of four, so packets are aligned.
+        const halide_trace_packet_t *packet = (const halide_trace_packet_t *)p;
+        cursor += packet->size;
+        return packet;
     }
 };
 
@@ -295,6 +424,10 @@ To just watch the trace instead of encoding a video replace the last
 line with something like:
  mplayer -demuxer rawvideo -rawvideo w=1920:h=1080:format=rgba:fps=30 -idle -fixed-vo -
 
+For large traces, save the trace to a file first and redirect it to
+stdin (HalideTraceViz <the args> < trace.bin), which lets
+HalideTraceViz map the file instead of reading it.
+
 The arguments to HalideTraceViz specify how to lay out and render the
 Funcs of interest. It acts like a stateful drawing API. The following
 parameters should be set zero or one times:
@@ -319,6 +452,13 @@ parameters should be set zero or one times:
  --hold frames: How many frames to output after the end of the
     trace. Defaults to 250.
 
+ --frame_skip n: Only output every nth frame, e.g. to reach a target
+    frame rate for a long trace without changing the timestep. The
+    skipped frames still advance the animation. Defaults to 1.
+
+ --threads n: How many threads to render with. Defaults to the number
+    of cores.
+
 The following parameters can be set once per Func. With the exception
 of label, they continue to take effect for all subsequently defined
 Funcs.
@@ -792,6 +932,10 @@ void process_args(int argc, char **argv, VizState *state) {
             // Already processed, just continue
         } else if (next == "--verbose" || next == "--no-verbose") {
             // Already processed, just continue
+        } else if (next == "--frame_skip" || next == "--threads") {
+            // Already processed, just skip the value
+            expect(i + 1 < argc, i);
+            i++;
         } else {
             expect(false, i);
         }
@@ -799,12 +943,58 @@ void process_args(int argc, char **argv, VizState *state) {
     }
 }
 
+// Run body(y_min, y_end) over horizontal bands covering [0, height), on up to
+// the given number of threads.
+void parallel_bands(int threads, int height, const std::function<void(int, int)> &body) {
+    threads = std::max(1, std::min(threads, height));
+    if (threads == 1) {
+        body(0, height);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(body, (height * i) / threads, (height * (i + 1)) / threads);
+    }
+    body(0, height / threads);
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
 // There are three layers - image data, an animation on top of
 // it, and text labels. These layers get composited.
+//
+// Drawing into the image and animation layers is deferred until the next
+// frame is rendered, and then done by horizontal bands in parallel. Each
+// band sees every draw in trace order, so the result doesn't depend on the
+// number of threads.
 struct Surface {
     const Point frame_size;
+    const int threads;
     std::vector<uint32_t> image, anim, anim_decay, text_buf, blend;
 
+    // A zoomed pixel drawn by a load or store. If update_image is set, each
+    // image pixel in the box becomes (pixel & image_mask) | image_bits.
+    struct PixelOp {
+        int x, y, izoom;
+        bool update_image;
+        uint32_t image_mask, image_bits;
+        uint32_t anim_color;
+    };
+
+    // A realization to fill, before the pixel op with the given index.
+    struct FillOp {
+        size_t before;
+        uint32_t color;
+        float zoom;
+        Point pos;
+        std::vector<Point> strides;
+        std::vector<int> coords;
+    };
+
+    std::vector<PixelOp> pixel_ops;
+    std::vector<FillOp> fill_ops;
+
     // Composite a single pixel of 'over' over a single pixel of 'under', writing the result into dst.
     // Note that under or over might be dst.
     static void composite_one(const uint32_t *under, const uint32_t *over, uint32_t *dst) {
@@ -827,41 +1017,28 @@ struct Surface {
         }
     }
 
-    void do_decay(int decay_factor, uint32_t *dst) {
-        if (decay_factor != 1) {
-            const uint32_t inv_d1 = (1 << 24) / std::max(1, decay_factor);
-            for (uint32_t *dst_end = dst + frame_elems(); dst < dst_end; ++dst) {
-                uint32_t color = *dst;
-                uint32_t rgb = color & 0x00ffffff;
-                uint32_t alpha = (color >> 24);
-                alpha *= inv_d1;
-                alpha &= 0xff000000;
-                *dst = alpha | rgb;
-            }
-        }
+    // Scale the alpha of a pixel by inv_d / 2^24.
+    static void decay_one(uint32_t inv_d, uint32_t *dst) {
+        uint32_t color = *dst;
+        uint32_t rgb = color & 0x00ffffff;
+        uint32_t alpha = (color >> 24);
+        alpha *= inv_d;
+        alpha &= 0xff000000;
+        *dst = alpha | rgb;
     }
 
-    // TODO this doesn't bounds-check against frame_size
-    void do_draw_pixel(const float zoom, const int x, const int y, const uint32_t color, uint32_t *dst) {
-        const int izoom = (int) ceil(zoom);
-        const int y_advance = frame_size.x - izoom;
-        dst += frame_size.x * y + x;
-        for (int dy = 0; dy < izoom; dy++) {
-            for (int dx = 0; dx < izoom; dx++) {
-                *dst++ = color;
-            }
-            dst += y_advance;
-        }
-    }
-
-    // Fill a rectangle in dst with color.
+    // Fill a rectangle in dst with color, clipped to the rows [band_min, band_end).
     // opaque RGB(1,1,1) is a "magic" color that means "fill with checkerboard".
     // dst is assumed to point to the start of a frame_size buffer.
-    void fill_rect(int left, int top, int width, int height, uint32_t color, uint32_t *dst) {
+    void fill_rect(int left, int top, int width, int height, uint32_t color, uint32_t *dst,
+                   int band_min, int band_end) {
         const int x_min = std::max(left, 0);
         const int x_end = std::min(left + width, frame_size.x);
-        const int y_min = std::max(top, 0);
-        const int y_end = std::min(top + height, frame_size.y);
+        const int y_min = std::max(top, band_min);
+        const int y_end = std::min(top + height, band_end);
+        if (x_min >= x_end || y_min >= y_end) {
+            return;
+        }
         const int y_stride = frame_size.x - (x_end - x_min);
         dst += y_min * frame_size.x + x_min;
         if (color == 0xff010101) {
@@ -885,34 +1062,49 @@ struct Surface {
     // Set all boxes corresponding to positions in a Func's allocation to
     // the given color. Recursive to handle arbitrary
     // dimensionalities. Used by begin and end realization events.
-    void do_fill_realization(uint32_t *dst, uint32_t color,
-                             const FuncInfo &fi, const halide_trace_packet_t &p,
+    void do_fill_realization(const FillOp &op, int band_min, int band_end,
                              int current_dimension = 0, int x_off = 0, int y_off = 0) {
-        if (2 * current_dimension == p.dimensions) {
-            const int x_min = x_off * fi.config.zoom + fi.config.pos.x;
-            const int y_min = y_off * fi.config.zoom + fi.config.pos.y;
-            const int izoom = (int) ceil(fi.config.zoom);
-            fill_rect(x_min, y_min, izoom, izoom, color, dst);
+        if (2 * current_dimension == (int)op.coords.size()) {
+            const int x_min = x_off * op.zoom + op.pos.x;
+            const int y_min = y_off * op.zoom + op.pos.y;
+            const int izoom = (int) ceil(op.zoom);
+            fill_rect(x_min, y_min, izoom, izoom, op.color, image.data(), band_min, band_end);
         } else {
-            const int *coords = p.coordinates();
-            const int min = coords[current_dimension * 2 + 0];
-            const int extent = coords[current_dimension * 2 + 1];
+            const int min = op.coords[current_dimension * 2 + 0];
+            const int extent = op.coords[current_dimension * 2 + 1];
             // If we don't have enough strides, assume subsequent dimensions have stride (0, 0)
-            const Point pt = current_dimension < (int)fi.config.strides.size() ? fi.config.strides.at(current_dimension) : Point{0, 0};
+            const Point pt = current_dimension < (int)op.strides.size() ? op.strides.at(current_dimension) : Point{0, 0};
             x_off += pt.x * min;
             y_off += pt.y * min;
             for (int i = 0; i < extent; i++) {
-                do_fill_realization(dst, color, fi, p, current_dimension + 1, x_off, y_off);
+                do_fill_realization(op, band_min, band_end, current_dimension + 1, x_off, y_off);
                 x_off += pt.x;
                 y_off += pt.y;
             }
         }
     }
 
+    // TODO this doesn't bounds-check against frame_size.x
+    void do_pixel_op(const PixelOp &op, int band_min, int band_end) {
+        const int y_min = std::max(op.y, band_min);
+        const int y_end = std::min(op.y + op.izoom, band_end);
+        for (int y = y_min; y < y_end; y++) {
+            const size_t row = (size_t) frame_size.x * y + op.x;
+            uint32_t *image_px = image.data() + row;
+            uint32_t *anim_px = anim.data() + row;
+            for (int dx = 0; dx < op.izoom; dx++) {
+                if (op.update_image) {
+                    image_px[dx] = (image_px[dx] & op.image_mask) | op.image_bits;
+                }
+                anim_px[dx] = op.anim_color;
+            }
+        }
+    }
 
 public:
-    Surface(const Point &fs)
+    Surface(const Point &fs, int threads)
         : frame_size(fs),
+          threads(threads),
           image(frame_elems()),
           anim(frame_elems()),
           anim_decay(frame_elems()),
@@ -930,10 +1122,6 @@ public:
         return this->blend.data();
     }
 
-    uint32_t get_image_pixel(const int x, const int y) const {
-        return image[frame_size.x * y + x];
-    }
-
     void draw_text(const std::string &text, const Point &pos, uint32_t color, float h_scale = 1.0f) {
         uint32_t *dst = text_buf.data();
 
@@ -964,49 +1152,72 @@ public:
         }
     }
 
-    void draw_anim_pixel(const float zoom, int x, int y, uint32_t color) {
-        do_draw_pixel(zoom, x, y, color, anim.data());
-    }
-
-    void draw_image_pixel(const float zoom, int x, int y, uint32_t color) {
-        do_draw_pixel(zoom, x, y, color, image.data());
+    // Draw a zoomed pixel in the animation layer, and optionally update
+    // some or all of the color channels of the image layer under it.
+    void draw_pixel(const float zoom, int x, int y, bool update_image,
+                    uint32_t image_mask, uint32_t image_bits, uint32_t anim_color) {
+        pixel_ops.push_back({x, y, (int) ceil(zoom), update_image, image_mask, image_bits, anim_color});
     }
 
     void fill_realization(uint32_t color, const FuncInfo &fi, const halide_trace_packet_t &p) {
-        do_fill_realization(image.data(), color, fi, p);
+        const int *coords = p.coordinates();
+        fill_ops.push_back({pixel_ops.size(), color, fi.config.zoom, fi.config.pos,
+                            fi.config.strides, std::vector<int>(coords, coords + p.dimensions)});
     }
 
-    void composite() {
-        // Composite text over anim over image
-        uint32_t *anim_decay_px  = anim_decay.data();
-        uint32_t *anim_px  = anim.data();
-        uint32_t *image_px = image.data();
-        uint32_t *text_px  = text_buf.data();
-        uint32_t *blend_px = blend.data();
-        for (size_t i = 0; i < image.size(); i++) {
-            // anim over anim_decay -> anim_decay
-            composite_one(anim_decay_px, anim_px, anim_decay_px);
-            // anim_decay over image -> blend
-            composite_one(image_px, anim_decay_px, blend_px);
-            // text over blend -> blend
-            composite_one(blend_px, text_px, blend_px);
-            anim_decay_px++;
-            anim_px++;
-            image_px++;
-            text_px++;
-            blend_px++;
+    // Do all the drawing since the last flush.
+    void flush() {
+        if (pixel_ops.empty() && fill_ops.empty()) {
+            return;
         }
+        // Small batches aren't worth the threads.
+        const int flush_threads = (fill_ops.empty() && pixel_ops.size() < 4096) ? 1 : threads;
+        parallel_bands(flush_threads, frame_size.y, [&](int band_min, int band_end) {
+            size_t next_fill = 0;
+            for (size_t i = 0; i <= pixel_ops.size(); i++) {
+                while (next_fill < fill_ops.size() && fill_ops[next_fill].before == i) {
+                    do_fill_realization(fill_ops[next_fill++], band_min, band_end);
+                }
+                if (i < pixel_ops.size()) {
+                    do_pixel_op(pixel_ops[i], band_min, band_end);
+                }
+            }
+        });
+        pixel_ops.clear();
+        fill_ops.clear();
     }
 
-    void decay_animations(int decay_factor_after_compute, int decay_factor_during_compute) {
-        // Decay the anim_decay
-        do_decay(decay_factor_after_compute, anim_decay.data());
-
-        // Also decay the anim
-        do_decay(decay_factor_during_compute, anim.data());
+    // Advance the animation by a frame: composite the animation over its
+    // decaying history, and then decay both. If output is set, first
+    // composite text over anim over image into the frame to write.
+    void render_frame(bool output, int decay_factor_after_compute, int decay_factor_during_compute) {
+        flush();
+        const uint32_t inv_after = (1 << 24) / std::max(1, decay_factor_after_compute);
+        const uint32_t inv_during = (1 << 24) / std::max(1, decay_factor_during_compute);
+        parallel_bands(threads, frame_size.y, [&](int band_min, int band_end) {
+            const size_t begin = (size_t) band_min * frame_size.x;
+            const size_t end = (size_t) band_end * frame_size.x;
+            for (size_t i = begin; i < end; i++) {
+                // anim over anim_decay -> anim_decay
+                composite_one(&anim_decay[i], &anim[i], &anim_decay[i]);
+                if (output) {
+                    // anim_decay over image -> blend
+                    composite_one(&image[i], &anim_decay[i], &blend[i]);
+                    // text over blend -> blend
+                    composite_one(&blend[i], &text_buf[i], &blend[i]);
+                }
+                if (decay_factor_after_compute != 1) {
+                    decay_one(inv_after, &anim_decay[i]);
+                }
+                if (decay_factor_during_compute != 1) {
+                    decay_one(inv_during, &anim[i]);
+                }
+            }
+        });
     }
 
     void clear_animations() {
+        flush();
         std::fill(anim.begin(), anim.end(), 0);
     }
 };
@@ -1014,7 +1225,7 @@ public:
 
 using FlagProcessor = std::function<void(VizState *state)>;
 
-int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
+int run(bool ignore_trace_tags, int threads, int frame_skip, FlagProcessor flag_processor) {
     // State that determines how different funcs get drawn
     VizState state;
 
@@ -1048,7 +1259,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
         flag_processor(&state);
 
         // allocate the surface after all tags and flags are processed
-        surface = std::unique_ptr<Surface>(new Surface(state.globals.frame_size));
+        surface = std::unique_ptr<Surface>(new Surface(state.globals.frame_size, threads));
 
         if (state.globals.auto_layout_grid.x < 0 || state.globals.auto_layout_grid.y < 0) {
             int cells_needed = 0;
@@ -1090,6 +1301,8 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
     std::list<std::pair<Label, int>> labels_being_drawn;
     size_t end_counter = 0;
     size_t packet_clock = 0;
+    size_t frame_counter = 0;
+    PacketReader reader(STDIN_FILENO);
     for (;;) {
         // Hold for some number of frames once the trace has finished.
         if (end_counter) {
@@ -1105,6 +1318,9 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
             const int64_t frame_bytes = surface->frame_elems() * sizeof(uint32_t);
 
             while (halide_clock > video_clock) {
+                // Skipped frames still advance the animation.
+                const bool output_frame = (frame_counter++ % frame_skip) == 0;
+
                 // Always render text last, since it's on top of everything
                 // and there's no need to re-render for every packet.
                 for (auto it = labels_being_drawn.begin(); it != labels_being_drawn.end(); ) {
@@ -1124,18 +1340,18 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                     }
                 }
 
-                // Composite text over anim over image
-                surface->composite();
+                // Composite text over anim over image, then decay the anim
+                surface->render_frame(output_frame, state.globals.decay_factor_after_compute, state.globals.decay_factor_during_compute);
 
                 // Dump the frame
-                int64_t bytes_written = write(STDOUT_FILENO, surface->frame_data(), frame_bytes);
-                if (bytes_written < frame_bytes) {
-                    fail() << "Could not write frame to stdout.";
+                if (output_frame) {
+                    int64_t bytes_written = write(STDOUT_FILENO, surface->frame_data(), frame_bytes);
+                    if (bytes_written < frame_bytes) {
+                        fail() << "Could not write frame to stdout.";
+                    }
                 }
 
                 video_clock += state.globals.timestep;
-
-                surface->decay_animations(state.globals.decay_factor_after_compute, state.globals.decay_factor_during_compute);
             }
 
             // Blank anim
@@ -1143,11 +1359,12 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
         }
 
         // Read a tracing packet
-        PacketAndPayload p;
-        if (!p.read()) {
+        const halide_trace_packet_t *packet = reader.next();
+        if (!packet) {
             end_counter++;
             continue;
         }
+        const halide_trace_packet_t &p = *packet;
         packet_clock++;
 
         // It's a pipeline begin/end event
@@ -1293,10 +1510,9 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                 // Update one or more of the color channels of the
                 // image layer in case it's a store or a load from
                 // the input.
-                if (p.event == halide_trace_store || fi.stats.num_realizations == 0 /* load from an input */) {
-                    // Get the old color, in case we're only
-                    // updating one of the color channels.
-                    uint32_t image_color = surface->get_image_pixel(x, y);
+                const bool update_image = (p.event == halide_trace_store || fi.stats.num_realizations == 0 /* load from an input */);
+                uint32_t image_mask = 0, image_bits = 0;
+                if (update_image) {
                     double value = get_value_as<double>(p, lane);
 
                     // Normalize it.
@@ -1308,20 +1524,18 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
 
                     if (fi.config.color_dim < 0) {
                         // Grayscale
-                        image_color = (int_value * 0x00010101) | 0xff000000;
+                        image_bits = (int_value * 0x00010101) | 0xff000000;
                     } else {
-                        // Color
+                        // Color: keep the other color channels.
                         uint32_t channel = coords[fi.config.color_dim * p.type.lanes + lane];
-                        uint32_t mask = ~(255 << (channel * 8));
-                        image_color &= mask;
-                        image_color |= int_value << (channel * 8);
+                        image_mask = ~(255 << (channel * 8));
+                        image_bits = int_value << (channel * 8);
                     }
-                    surface->draw_image_pixel(fi.config.zoom, x, y, image_color);
                 }
 
                 // Stores are orange, loads are blue.
                 uint32_t color = p.event == halide_trace_load ? 0xffffdd44 : 0xff44ddff;
-                surface->draw_anim_pixel(fi.config.zoom, x, y, color);
+                surface->draw_pixel(fi.config.zoom, x, y, update_image, image_mask, image_bits, color);
             }
             break;
         }
@@ -1395,6 +1609,8 @@ int main(int argc, char **argv) {
     }
 
     bool ignore_trace_tags = false;
+    int threads = std::max(1, (int) std::thread::hardware_concurrency());
+    int frame_skip = 1;
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "--ignore_tags")) {
             ignore_trace_tags = true;
@@ -1404,6 +1620,10 @@ int main(int argc, char **argv) {
             verbose = true;
         } else if (!strcmp(argv[i], "--no-verbose")) {
             verbose = false;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--frame_skip") && i + 1 < argc) {
+            frame_skip = std::max(1, atoi(argv[++i]));
         }
     }
 
@@ -1411,5 +1631,5 @@ int main(int argc, char **argv) {
         process_args(argc, argv, state);
     };
 
-    run(ignore_trace_tags, flag_processor);
+    run(ignore_trace_tags, threads, frame_skip, flag_processor);
 }